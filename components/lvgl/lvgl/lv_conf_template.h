@@ -80,6 +80,24 @@ typedef int16_t lv_coord_t;
 
 /* Automatically defrag. on free. Defrag. means joining the adjacent free cells. */
 #  define LV_MEM_AUTO_DEFRAG  1
+
+/* Time in ms `lv_task_handler` may spend on `lv_mem_defrag_step` when no task is due,
+ * giving back the empty slabs of the pools (and joining the free cells without TLSF)
+ * before an allocation fails for the lack of a large enough block. 0: don't use idle time*/
+#  define LV_MEM_IDLE_DEFRAG_TIME  0
+
+/* 1: Use a two-level segregated fit (TLSF) allocator. It allocates and frees in constant time
+ * regardless of the number of blocks and always joins the adjacent free cells.
+ * 0: Use a first fit search over all cells*/
+#  define LV_MEM_TLSF         0
+
+/* Number of block sizes allocated from pools (the objects, the nodes of the lists using `lv_ll_init_pool`
+ * and the first ext. data sizes, see `lv_mem_pool_add`).
+ * A pool allocates LV_MEM_POOL_SLAB_CNT blocks at once in a slab, so objects created and deleted
+ * together don't fragment the rest of the memory. Slabs without used blocks are given back if an
+ * allocation fails or on `lv_mem_defrag`. 0: don't use pools*/
+#  define LV_MEM_POOL_CNT       0
+#  define LV_MEM_POOL_SLAB_CNT  8
 #else       /*LV_MEM_CUSTOM*/
 #  define LV_MEM_CUSTOM_INCLUDE <stdlib.h>   /*Header for the dynamic memory function*/
 #  define LV_MEM_CUSTOM_ALLOC   malloc       /*Wrapper to malloc*/
@@ -134,6 +152,15 @@ typedef void * lv_anim_user_data_t;
 
 /* 1: Enable shadow drawing*/
 #define LV_USE_SHADOW           1
+#if LV_USE_SHADOW
+/* Number of precomputed shadow profiles (one per radius, width and opacity)
+ * kept in the LittlevGL heap for redrawing shadows. 0: disable the cache*/
+#define LV_SHADOW_CACHE_SIZE    4
+#endif
+
+/* Number of precomputed coverage tiles of rounded corners (one per radius and border width)
+ * kept in the LittlevGL heap for drawing corners as masked fills. 0: disable the cache*/
+#define LV_CORNER_CACHE_SIZE    4
 
 /* 1: Enable object groups (for keyboard/encoder navigation) */
 #define LV_USE_GROUP            1
@@ -151,6 +178,16 @@ typedef void * lv_group_user_data_t;
 typedef void * lv_fs_drv_user_data_t;
 #endif
 
+/* Size in bytes of the blocks cached for each file opened read only, 0 to read files
+ * straight from their drivers. Image decoding reads a line at a time, so a few blocks
+ * of a few lines each turn many small driver reads into a few large ones.
+ * The blocks are allocated from the LittlevGL heap when a file is opened and images in
+ * the image cache keep their files open, so mind LV_MEM_SIZE.*/
+#define LV_FS_CACHE_BLOCK_SIZE  0
+
+/* Blocks cached per file, unless a driver sets its own `cache_blocks` (1..255)*/
+#define LV_FS_CACHE_BLOCKS      2
+
 /*1: Add a `user_data` to drivers and objects*/
 #define LV_USE_USER_DATA        0
 
@@ -164,6 +201,12 @@ typedef void * lv_fs_drv_user_data_t;
 /* 1: Enable alpha indexed images */
 #define LV_IMG_CF_ALPHA         1
 
+/* Keep indexed and alpha images converted to `lv_color_t` (+ alpha) once all their lines were read,
+ * so they are redrawn without converting them again. Only images which need at most this many bytes
+ * converted are kept (allocated like LV_IMG_CACHE_CUSTOM). 0: convert in every draw
+ * Alpha images keep the color of the style they were opened with.*/
+#define LV_IMG_DECODER_LINE_CACHE   0
+
 /* Default image cache size. Image caching keeps the images opened.
  * If only the built-in image formats are used there is no real advantage of caching.
  * (I.e. no new image decoder is added)
@@ -172,6 +215,23 @@ typedef void * lv_fs_drv_user_data_t;
  * LV_IMG_CACHE_DEF_SIZE must be >= 1 */
 #define LV_IMG_CACHE_DEF_SIZE       1
 
+/* Images whose decoder can only read them line by line are decoded whole when they are cached.
+ * The cache holds at most LV_IMG_CACHE_MEM_SIZE bytes of such pixels. 0: don't decode whole images*/
+#define LV_IMG_CACHE_MEM_SIZE       0
+
+/* Number of recolored copies of cached images (`image.intense` > 0) kept, each for one
+ * source, recolor and intensity, so they are redrawn as plain copies. They count towards
+ * LV_IMG_CACHE_MEM_SIZE. 0: recolor the pixels in every draw*/
+#define LV_IMG_CACHE_RECOLOR        0
+
+/* 1: Allocate the decoded images with LV_IMG_CACHE_CUSTOM_ALLOC instead of `lv_mem_alloc` (e.g. in external RAM)*/
+#define LV_IMG_CACHE_CUSTOM         0
+#if LV_IMG_CACHE_CUSTOM
+#  define LV_IMG_CACHE_CUSTOM_INCLUDE <stdlib.h>   /*Header for the allocation functions*/
+#  define LV_IMG_CACHE_CUSTOM_ALLOC   malloc       /*Wrapper to malloc*/
+#  define LV_IMG_CACHE_CUSTOM_FREE    free         /*Wrapper to free*/
+#endif
+
 /*Declare the type of the user data of image decoder (can be e.g. `void *`, `int`, `struct`)*/
 typedef void * lv_img_decoder_user_data_t;
 
@@ -280,6 +340,23 @@ typedef void * lv_indev_drv_user_data_t;            /*Type of user data in the i
  * but with > 10,000 characters if you see issues probably you need to enable it.*/
 #define LV_FONT_FMT_TXT_LARGE   0
 
+/* 1: give every font in the built-in format a glyph id table for U+0000..U+00FF and a small
+ * kerning value cache, allocated (about 700 bytes) from the LittlevGL heap when the font is first used.
+ * Saves searching the font's tables for every letter drawn or measured.*/
+#define LV_FONT_FMT_TXT_CACHE   0
+
+/* 1: support fonts whose glyph bitmaps are compressed (`lv_font_conv` without `--no-compress`,
+ * or `tools/fontpack.py`). A glyph is unpacked to a buffer on the LittlevGL heap each time its
+ * bitmap is read, so it mostly costs time for glyphs missing from the glyph cache.*/
+#define LV_USE_FONT_COMPRESSED  0
+
+/* Keep the most recently drawn glyphs expanded to 8 bit opacity masks so they don't
+ * have to be unpacked from the font's bitmaps again. ASCII letters have their own
+ * entries, the other letters share LV_GLYPH_CACHE_SIZE entries (must be >= 1).
+ * The masks use at most LV_GLYPH_CACHE_MEM_SIZE bytes of the LittlevGL heap. 0: disable the cache*/
+#define LV_GLYPH_CACHE_SIZE      32
+#define LV_GLYPH_CACHE_MEM_SIZE  (4U * 1024U)
+
 /*Declare the type of the user data of fonts (can be e.g. `void *`, `int`, `struct`)*/
 typedef void * lv_font_user_data_t;
 
@@ -307,6 +384,61 @@ typedef void * lv_obj_user_data_t;
 /*1: enable `lv_obj_realaign()` based on `lv_obj_align()` parameters*/
 #define LV_USE_OBJ_REALIGN          1
 
+/*1: keep a contiguous array of each object's children, built on first use and dropped
+ * when a child is added, removed or reordered, for the refresh and hit-test traversals*/
+#define LV_USE_OBJ_CHILD_CACHE      0
+
+/*Number of children from which an object keeps a grid of the children that can be clicked in
+ * each of its cells, so pressing among hundreds of buttons only tests those near the point.
+ * Needs LV_USE_OBJ_CHILD_CACHE. 0: disable*/
+#define LV_OBJ_HIT_GRID             0
+
+/*1: `lv_obj_set_inv_defer(true)` lets `lv_obj_invalidate()` only mark objects, whose areas are
+ * computed once when their display is refreshed, leaving out children of marked objects*/
+#define LV_USE_OBJ_INV_DEFER        0
+
+/*1: `lv_obj_set_layout_defer(true)` lets containers only mark their layouts and fits when their
+ * children change, refreshing each once before the display is, so building long lists is linear*/
+#define LV_USE_OBJ_LAYOUT_DEFER     0
+
+/*1: `lv_obj_set_opa_layer()` lets an object and its children be drawn once into a cached layer
+ * (`w * h * LV_IMG_PX_SIZE_ALPHA_BYTE` bytes, allocated like LV_IMG_CACHE_CUSTOM) and blended with
+ * their opa scale as one image, so fading them redraws one image. Drawn directly if there is no memory*/
+#define LV_USE_OBJ_LAYER            0
+
+/*Number of opaque objects drawn over an object whose areas are left out when it's drawn,
+ * so covered parts of stacked panels or a screen under a message box aren't drawn. 0: disable*/
+#define LV_REFR_OCCLUDERS           0
+
+/*1: `lv_style_intern()` gives styles with the same content one shared, reference counted copy,
+ * so widgets created with copies of near-identical styles don't each keep their own*/
+#define LV_USE_STYLE_INTERN         0
+
+/*1: `lv_cmd_set_value/set_text/invalidate/call()` let other tasks queue changes to objects,
+ * applied at the start of `lv_task_handler()`, without locking or allocating. Up to
+ * LV_CMD_QUEUE_LEN (a power of 2) commands wait, further ones are dropped. Needs GCC's `__atomic` builtins*/
+#define LV_USE_CMD_QUEUE            0
+#if LV_USE_CMD_QUEUE
+#  define LV_CMD_QUEUE_LEN          32
+#  define LV_CMD_TEXT_MAX           32   /*Bytes of text a command holds, with the closing '\0'*/
+#endif
+
+/*1: `lv_blob_save()` stores a tree of objects (base objects, containers, buttons, labels and images)
+ * with their coordinates resolved into a blob to keep as a constant, `lv_blob_load()` creates
+ * the tree from it again without laying it out. Trees at most LV_BLOB_DEPTH_MAX deep*/
+#define LV_USE_BLOB                 0
+#if LV_USE_BLOB
+#  define LV_BLOB_DEPTH_MAX         16
+#endif
+
+/*1: accumulate the time each lv_task's callback takes and the times it was called,
+ * reported by `lv_task_prof_get()` along with the time `lv_task_handler()` was watched*/
+#define LV_USE_TASK_PROF            0
+#if LV_USE_TASK_PROF
+#  define LV_TASK_PROF_INCLUDE      "something.h"        /*Header for the counter*/
+#  define LV_TASK_PROF_TIME_EXPR    (cycles())           /*Free running 32-bit counter, e.g. CPU cycles*/
+#endif
+
 /* Enable to make the object clickable on a larger area.
  * LV_EXT_CLICK_AREA_OFF or 0: Disable this feature
  * LV_EXT_CLICK_AREA_TINY: The extra area can be adjusted horizontally and vertically (0..255 px)
@@ -392,6 +524,10 @@ typedef void * lv_obj_user_data_t;
 
 /*Store extra some info in labels (12 bytes) to speed up drawing of very long texts*/
 #  define LV_LABEL_LONG_TXT_HINT          0
+
+/* Cache the line breaks and line widths of labels so redrawing them (once per display buffer
+ * strip they cross) doesn't lay the text out again. Max. number of lines to cache (0: disable)*/
+#  define LV_LABEL_LINE_CACHE             0
 #endif
 
 /*LED (dependencies: -)*/
@@ -409,6 +545,12 @@ typedef void * lv_obj_user_data_t;
 
 /*Line meter (dependencies: *;)*/
 #define LV_USE_LMETER   1
+#if LV_USE_LMETER
+/* Keep the scale of line meters and gauges (lines and labels) pre-rendered in an image with alpha
+ * so a new needle position redraws only the needle over it. Needs `w * h * LV_IMG_PX_SIZE_ALPHA_BYTE`
+ * bytes per widget, allocated like LV_IMG_CACHE_CUSTOM. Drawn directly if there is no memory for it.*/
+#  define LV_LMETER_LAYER     0
+#endif
 
 /*Message box (dependencies: lv_rect, lv_btnm, lv_label)*/
 #define LV_USE_MBOX     1
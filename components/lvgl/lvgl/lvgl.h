@@ -27,6 +27,8 @@ extern "C" {
 #include "src/lv_core/lv_group.h"
 
 #include "src/lv_core/lv_refr.h"
+#include "src/lv_core/lv_cmd.h"
+#include "src/lv_core/lv_blob.h"
 #include "src/lv_core/lv_disp.h"
 
 #include "src/lv_themes/lv_theme.h"
@@ -68,6 +70,7 @@ extern "C" {
 #include "src/lv_objx/lv_spinbox.h"
 
 #include "src/lv_draw/lv_img_cache.h"
+#include "src/lv_draw/lv_glyph_cache.h"
 
 /*********************
  *      DEFINES
@@ -0,0 +1,577 @@
+/**
+ * @file lv_blob.c
+ * A blob is a header followed by the stored objects, parents before their children and children
+ * in the order they were created, each with its depth in the tree, and then the texts they use.
+ * Creating the objects again needs only a stack of the parents: the coordinates are written as
+ * they were stored and the containers' layouts and fits are only set back once their children are
+ * all created, so nothing is laid out or aligned again.
+ */
+
+/*********************
+ *      INCLUDES
+ *********************/
+#include "lv_blob.h"
+#if LV_USE_BLOB != 0
+#include "../lv_objx/lv_cont.h"
+#include "../lv_objx/lv_btn.h"
+#include "../lv_objx/lv_label.h"
+#include "../lv_objx/lv_img.h"
+#include <string.h>
+
+/*********************
+ *      DEFINES
+ *********************/
+#define LV_BLOB_MAGIC 0x424F4C42 /*"BLOB"*/
+
+/*No offset of a text, as it's always past the header*/
+#define LV_BLOB_NO_TEXT 0
+
+/**********************
+ *      TYPEDEFS
+ **********************/
+typedef enum {
+    LV_BLOB_OBJ,
+#if LV_USE_CONT
+    LV_BLOB_CONT,
+#endif
+#if LV_USE_BTN
+    LV_BLOB_BTN,
+#endif
+#if LV_USE_LABEL
+    LV_BLOB_LABEL,
+#endif
+#if LV_USE_IMG
+    LV_BLOB_IMG,
+#endif
+    LV_BLOB_INV,
+} lv_blob_kind_t;
+
+typedef struct
+{
+    uint32_t magic;
+    uint32_t size;       /*Of the whole blob*/
+    uint32_t node_cnt;
+    const void * ref;    /*Address of `lv_style_scr` in the firmware which saved the blob*/
+} lv_blob_head_t;
+
+typedef struct
+{
+    uint8_t kind;  /*From `lv_blob_kind_t`*/
+    uint8_t depth; /*0: the object saved, 1: its children...*/
+
+    uint8_t click : 1;
+    uint8_t drag : 1;
+    uint8_t drag_throw : 1;
+    uint8_t drag_parent : 1;
+    uint8_t hidden : 1;
+    uint8_t top : 1;
+    uint8_t opa_scale_en : 1;
+    uint8_t parent_event : 1;
+    uint8_t drag_dir : 2;
+    uint8_t opa_layer : 1;
+    uint8_t protect;
+    lv_opa_t opa_scale;
+    lv_coord_t ext_draw_pad;
+
+    lv_area_t area; /*Relative to the top left corner of the parent*/
+
+    lv_event_cb_t event_cb;
+    lv_signal_cb_t signal_cb;
+    lv_design_cb_t design_cb;
+    const lv_style_t * style_p;
+
+#if LV_USE_EXT_CLICK_AREA == LV_EXT_CLICK_AREA_TINY
+    uint8_t ext_click_pad_hor;
+    uint8_t ext_click_pad_ver;
+#endif
+#if LV_USE_EXT_CLICK_AREA == LV_EXT_CLICK_AREA_FULL
+    lv_area_t ext_click_pad;
+#endif
+#if LV_USE_USER_DATA
+    lv_obj_user_data_t user_data;
+#endif
+
+    union
+    {
+#if LV_USE_CONT
+        lv_cont_ext_t cont;
+#endif
+#if LV_USE_BTN
+        lv_btn_ext_t btn; /*Starts with a `lv_cont_ext_t` too*/
+#endif
+#if LV_USE_LABEL
+        struct
+        {
+            uint32_t text; /*Offset in the blob*/
+            lv_point_t offset;
+            uint16_t anim_speed;
+            uint8_t long_mode;
+            uint8_t align;
+            uint8_t recolor : 1;
+            uint8_t body_draw : 1;
+        } label;
+#endif
+#if LV_USE_IMG
+        struct
+        {
+            const void * src; /*A variable, or NULL and `src_str` is the offset of a file name or symbol*/
+            uint32_t src_str;
+            lv_point_t offset;
+            uint8_t auto_size;
+        } img;
+#endif
+    } ext;
+} lv_blob_node_t;
+
+typedef struct
+{
+    uint8_t * buf;     /*NULL while only counting*/
+    uint32_t node_cnt; /*Nodes so far*/
+    uint32_t str_pos;  /*Where the next text goes*/
+} lv_blob_ctx_t;
+
+/**********************
+ *  STATIC PROTOTYPES
+ **********************/
+static bool save_obj(const lv_obj_t * obj, const lv_obj_t * par, uint8_t depth, lv_blob_ctx_t * ctx);
+static void save_node(const lv_obj_t * obj, const lv_obj_t * par, lv_blob_node_t * node, lv_blob_ctx_t * ctx);
+static uint32_t save_str(const char * str, lv_blob_ctx_t * ctx);
+static lv_blob_kind_t get_kind(const lv_obj_t * obj);
+static lv_obj_t * load_obj(const uint8_t * blob, const lv_blob_node_t * node, lv_obj_t * par);
+static void load_done(lv_obj_t * obj, const lv_blob_node_t * node);
+static void area_move(lv_area_t * area, lv_coord_t x_ofs, lv_coord_t y_ofs);
+
+/**********************
+ *  STATIC VARIABLES
+ **********************/
+
+/**********************
+ *      MACROS
+ **********************/
+
+/**********************
+ *   GLOBAL FUNCTIONS
+ **********************/
+
+/**
+ * Store an object and its children in a blob: their types, coordinates, attributes, callbacks,
+ * style pointers and the texts of labels. Only base objects, containers, buttons, labels and
+ * images are stored, other types (with children of their own, like pages) make it fail.
+ * Pointers are stored as they are, so the blob is only valid for the firmware it was saved with,
+ * and the styles, callbacks and image sources must be static. Groups aren't stored.
+ * @param obj pointer to an object, typically a screen
+ * @param buf the blob is written here if it fits, can be NULL to only get the size
+ * @param buf_size size of `buf` in bytes
+ * @return size of the blob in bytes (nothing is written if greater than `buf_size`), 0: `obj`
+ * can't be stored
+ */
+uint32_t lv_blob_save(const lv_obj_t * obj, void * buf, uint32_t buf_size)
+{
+    /*Count the nodes and the texts' length first to know where the texts start*/
+    lv_blob_ctx_t ctx;
+    ctx.buf      = NULL;
+    ctx.node_cnt = 0;
+    ctx.str_pos  = 0;
+    if(save_obj(obj, lv_obj_get_parent(obj), 0, &ctx) == false) return 0;
+
+    uint32_t str_start = sizeof(lv_blob_head_t) + ctx.node_cnt * sizeof(lv_blob_node_t);
+    uint32_t size      = str_start + ctx.str_pos;
+    if(buf == NULL || size > buf_size) return size;
+
+    lv_blob_head_t * head = buf;
+    head->magic    = LV_BLOB_MAGIC;
+    head->size     = size;
+    head->node_cnt = ctx.node_cnt;
+    head->ref      = &lv_style_scr;
+
+    ctx.buf      = buf;
+    ctx.node_cnt = 0;
+    ctx.str_pos  = str_start;
+    save_obj(obj, lv_obj_get_parent(obj), 0, &ctx);
+
+    return size;
+}
+
+/**
+ * Create the objects stored in a blob with `lv_blob_save()`. Their coordinates, layouts and fits
+ * are set as they were stored without laying them out again. The blob must be kept, e.g. as a
+ * constant, while the objects exist: the labels' texts point into it.
+ * @param blob pointer to a blob
+ * @param parent the parent of the first stored object, NULL to create it as a screen
+ * @return the first stored object, NULL if `blob` isn't a blob of this firmware
+ */
+lv_obj_t * lv_blob_load(const void * blob, lv_obj_t * parent)
+{
+    const lv_blob_head_t * head = blob;
+    if(head->magic != LV_BLOB_MAGIC || head->ref != &lv_style_scr || head->node_cnt == 0) return NULL;
+
+    /*The objects the next node can be a child of, and their nodes*/
+    lv_obj_t * objs[LV_BLOB_DEPTH_MAX];
+    const lv_blob_node_t * obj_nodes[LV_BLOB_DEPTH_MAX];
+    uint8_t obj_cnt = 0;
+
+    const lv_blob_node_t * nodes = (const lv_blob_node_t *)(head + 1);
+    uint32_t i;
+    for(i = 0; i < head->node_cnt; i++) {
+        const lv_blob_node_t * node = &nodes[i];
+
+        /*The objects as deep or deeper than this one have all their children*/
+        while(obj_cnt > node->depth) {
+            obj_cnt--;
+            load_done(objs[obj_cnt], obj_nodes[obj_cnt]);
+        }
+
+        lv_obj_t * par     = node->depth == 0 ? parent : objs[node->depth - 1];
+        objs[obj_cnt]      = load_obj(blob, node, par);
+        obj_nodes[obj_cnt] = node;
+        obj_cnt++;
+    }
+
+    while(obj_cnt > 1) {
+        obj_cnt--;
+        load_done(objs[obj_cnt], obj_nodes[obj_cnt]);
+    }
+
+    /*Let the parent lay out the first object as it would a new child*/
+    load_done(objs[0], obj_nodes[0]);
+    if(parent != NULL) parent->signal_cb(parent, LV_SIGNAL_CHILD_CHG, objs[0]);
+    lv_obj_invalidate(objs[0]);
+
+    return objs[0];
+}
+
+/**********************
+ *   STATIC FUNCTIONS
+ **********************/
+
+/**
+ * Store an object and its children, or only count them while `ctx->buf` is NULL
+ * @param obj pointer to an object
+ * @param par the object the coordinates are relative to (NULL: the display)
+ * @param depth depth of `obj` in the stored tree
+ * @param ctx the blob written
+ * @return false: `obj` or a child can't be stored
+ */
+static bool save_obj(const lv_obj_t * obj, const lv_obj_t * par, uint8_t depth, lv_blob_ctx_t * ctx)
+{
+    if(depth >= LV_BLOB_DEPTH_MAX) return false;
+    if(get_kind(obj) == LV_BLOB_INV) return false;
+
+    lv_blob_node_t * node = NULL;
+    if(ctx->buf != NULL) {
+        node = (lv_blob_node_t *)(ctx->buf + sizeof(lv_blob_head_t)) + ctx->node_cnt;
+        node->depth = depth;
+    }
+    save_node(obj, par, node, ctx);
+    ctx->node_cnt++;
+
+    /*The oldest child first, as they are created again in this order*/
+    lv_obj_t * child;
+    LV_LL_READ_BACK(obj->child_ll, child)
+    {
+        if(save_obj(child, obj, depth + 1, ctx) == false) return false;
+    }
+
+    return true;
+}
+
+/**
+ * Fill the node of an object and store the texts it uses
+ * @param obj pointer to an object
+ * @param par the object the coordinates are relative to (NULL: the display)
+ * @param node the node to fill, NULL to only count the texts' length
+ * @param ctx the blob written
+ */
+static void save_node(const lv_obj_t * obj, const lv_obj_t * par, lv_blob_node_t * node, lv_blob_ctx_t * ctx)
+{
+    lv_blob_kind_t kind = get_kind(obj);
+
+#if LV_USE_LABEL
+    if(kind == LV_BLOB_LABEL) {
+        uint32_t text = save_str(lv_label_get_text(obj), ctx);
+        if(node != NULL) {
+            const lv_label_ext_t * ext = lv_obj_get_ext_attr(obj);
+            node->ext.label.text       = text;
+            node->ext.label.offset     = ext->offset;
+#if LV_USE_ANIMATION
+            node->ext.label.anim_speed = ext->anim_speed;
+#endif
+            node->ext.label.long_mode  = ext->long_mode;
+            node->ext.label.align      = ext->align;
+            node->ext.label.recolor    = ext->recolor;
+            node->ext.label.body_draw  = ext->body_draw;
+        }
+    }
+#endif
+
+#if LV_USE_IMG
+    if(kind == LV_BLOB_IMG) {
+        const lv_img_ext_t * ext = lv_obj_get_ext_attr(obj);
+        uint32_t src_str         = LV_BLOB_NO_TEXT;
+        if(ext->src_type == LV_IMG_SRC_FILE || ext->src_type == LV_IMG_SRC_SYMBOL) {
+            src_str = save_str(ext->src, ctx);
+        }
+        if(node != NULL) {
+            node->ext.img.src       = ext->src_type == LV_IMG_SRC_VARIABLE ? ext->src : NULL;
+            node->ext.img.src_str   = src_str;
+            node->ext.img.offset    = ext->offset;
+            node->ext.img.auto_size = ext->auto_size;
+        }
+    }
+#endif
+
+    if(node == NULL) return;
+
+    node->kind         = kind;
+    node->click        = obj->click;
+    node->drag         = obj->drag;
+    node->drag_throw   = obj->drag_throw;
+    node->drag_parent  = obj->drag_parent;
+    node->hidden       = obj->hidden;
+    node->top          = obj->top;
+    node->opa_scale_en = obj->opa_scale_en;
+    node->parent_event = obj->parent_event;
+    node->drag_dir     = obj->drag_dir;
+    node->opa_layer    = obj->opa_layer;
+    node->protect      = obj->protect;
+    node->opa_scale    = obj->opa_scale;
+    node->ext_draw_pad = obj->ext_draw_pad;
+
+    node->area = obj->coords;
+    if(par != NULL) area_move(&node->area, -par->coords.x1, -par->coords.y1);
+
+    node->event_cb  = obj->event_cb;
+    node->signal_cb = obj->signal_cb;
+    node->design_cb = obj->design_cb;
+    node->style_p   = obj->style_p;
+
+#if LV_USE_EXT_CLICK_AREA == LV_EXT_CLICK_AREA_TINY
+    node->ext_click_pad_hor = obj->ext_click_pad_hor;
+    node->ext_click_pad_ver = obj->ext_click_pad_ver;
+#endif
+#if LV_USE_EXT_CLICK_AREA == LV_EXT_CLICK_AREA_FULL
+    node->ext_click_pad = obj->ext_click_pad;
+#endif
+#if LV_USE_USER_DATA
+    node->user_data = obj->user_data;
+#endif
+
+#if LV_USE_CONT
+    if(kind == LV_BLOB_CONT) node->ext.cont = *(const lv_cont_ext_t *)lv_obj_get_ext_attr(obj);
+#endif
+#if LV_USE_BTN
+    if(kind == LV_BLOB_BTN) node->ext.btn = *(const lv_btn_ext_t *)lv_obj_get_ext_attr(obj);
+#endif
+}
+
+/**
+ * Store a text after the nodes, or only count its length while `ctx->buf` is NULL
+ * @param str a '\0' terminated text
+ * @param ctx the blob written
+ * @return offset of the text in the blob
+ */
+static uint32_t save_str(const char * str, lv_blob_ctx_t * ctx)
+{
+    uint32_t pos = ctx->str_pos;
+    uint32_t len = strlen(str) + 1;
+    if(ctx->buf != NULL) memcpy(ctx->buf + pos, str, len);
+    ctx->str_pos += len;
+    return pos;
+}
+
+/**
+ * Get how an object is stored from its type
+ * @param obj pointer to an object
+ * @return the kind of node, `LV_BLOB_INV` if it can't be stored
+ */
+static lv_blob_kind_t get_kind(const lv_obj_t * obj)
+{
+    lv_obj_type_t type;
+    lv_obj_get_type((lv_obj_t *)obj, &type);
+
+    if(strcmp(type.type[0], "lv_obj") == 0) return LV_BLOB_OBJ;
+#if LV_USE_CONT
+    if(strcmp(type.type[0], "lv_cont") == 0) return LV_BLOB_CONT;
+#endif
+#if LV_USE_BTN
+    if(strcmp(type.type[0], "lv_btn") == 0) return LV_BLOB_BTN;
+#endif
+#if LV_USE_LABEL
+    if(strcmp(type.type[0], "lv_label") == 0) return LV_BLOB_LABEL;
+#endif
+#if LV_USE_IMG
+    if(strcmp(type.type[0], "lv_img") == 0) return LV_BLOB_IMG;
+#endif
+
+    return LV_BLOB_INV;
+}
+
+/**
+ * Create the object of a node. A container's layout and fit are off until `load_done()`.
+ * @param blob pointer to the blob
+ * @param node the node of the object
+ * @param par the parent, NULL to create a screen
+ * @return the new object
+ */
+static lv_obj_t * load_obj(const uint8_t * blob, const lv_blob_node_t * node, lv_obj_t * par)
+{
+    lv_obj_t * obj = NULL;
+    switch(node->kind) {
+        case LV_BLOB_OBJ: obj = lv_obj_create(par, NULL); break;
+#if LV_USE_CONT
+        case LV_BLOB_CONT: obj = lv_cont_create(par, NULL); break;
+#endif
+#if LV_USE_BTN
+        case LV_BLOB_BTN: obj = lv_btn_create(par, NULL); break;
+#endif
+#if LV_USE_LABEL
+        case LV_BLOB_LABEL: obj = lv_label_create(par, NULL); break;
+#endif
+#if LV_USE_IMG
+        case LV_BLOB_IMG: obj = lv_img_create(par, NULL); break;
+#endif
+    }
+    lv_mem_assert(obj);
+
+    obj->click        = node->click;
+    obj->drag         = node->drag;
+    obj->drag_throw   = node->drag_throw;
+    obj->drag_parent  = node->drag_parent;
+    obj->hidden       = node->hidden;
+    obj->top          = node->top;
+    obj->opa_scale_en = node->opa_scale_en;
+    obj->parent_event = node->parent_event;
+    obj->drag_dir     = node->drag_dir;
+    obj->opa_layer    = node->opa_layer;
+    obj->protect      = node->protect;
+    obj->opa_scale    = node->opa_scale;
+    obj->ext_draw_pad = node->ext_draw_pad;
+
+    obj->event_cb  = node->event_cb;
+    obj->signal_cb = node->signal_cb;
+    obj->design_cb = node->design_cb;
+    obj->style_p   = node->style_p;
+
+#if LV_USE_EXT_CLICK_AREA == LV_EXT_CLICK_AREA_TINY
+    obj->ext_click_pad_hor = node->ext_click_pad_hor;
+    obj->ext_click_pad_ver = node->ext_click_pad_ver;
+#endif
+#if LV_USE_EXT_CLICK_AREA == LV_EXT_CLICK_AREA_FULL
+    obj->ext_click_pad = node->ext_click_pad;
+#endif
+#if LV_USE_USER_DATA
+    obj->user_data = node->user_data;
+#endif
+
+    /*Before the texts and images are set as labels break and crop their text to their size*/
+    obj->coords = node->area;
+    if(par != NULL) area_move(&obj->coords, par->coords.x1, par->coords.y1);
+
+#if LV_USE_CONT
+    lv_cont_ext_t * cont_ext = NULL;
+    if(node->kind == LV_BLOB_CONT) {
+        cont_ext  = lv_obj_get_ext_attr(obj);
+        *cont_ext = node->ext.cont;
+    }
+#if LV_USE_BTN
+    if(node->kind == LV_BLOB_BTN) {
+        lv_btn_ext_t * ext = lv_obj_get_ext_attr(obj);
+        *ext               = node->ext.btn;
+        cont_ext           = &ext->cont;
+    }
+#endif
+    if(cont_ext != NULL) {
+        /*Keep the children where they are stored while they are created*/
+        cont_ext->layout     = LV_LAYOUT_OFF;
+        cont_ext->fit_left   = LV_FIT_NONE;
+        cont_ext->fit_right  = LV_FIT_NONE;
+        cont_ext->fit_top    = LV_FIT_NONE;
+        cont_ext->fit_bottom = LV_FIT_NONE;
+    }
+#endif
+
+#if LV_USE_LABEL
+    if(node->kind == LV_BLOB_LABEL) {
+        lv_label_ext_t * ext = lv_obj_get_ext_attr(obj);
+        lv_label_long_mode_t long_mode = node->ext.label.long_mode;
+        ext->long_mode = long_mode;
+        ext->expand    = long_mode == LV_LABEL_LONG_SROLL || long_mode == LV_LABEL_LONG_SROLL_CIRC ||
+                         long_mode == LV_LABEL_LONG_CROP;
+        ext->align     = node->ext.label.align;
+        ext->recolor   = node->ext.label.recolor;
+        ext->body_draw = node->ext.label.body_draw;
+#if LV_USE_ANIMATION
+        ext->anim_speed = node->ext.label.anim_speed;
+#endif
+
+        /*The dots are written into the text so it needs a copy*/
+        const char * text = (const char *)blob + node->ext.label.text;
+        if(long_mode == LV_LABEL_LONG_DOT) lv_label_set_text(obj, text);
+        else lv_label_set_static_text(obj, text);
+
+        /*The scrolling modes animate the offset themselves*/
+        if(long_mode != LV_LABEL_LONG_SROLL && long_mode != LV_LABEL_LONG_SROLL_CIRC) {
+            ext->offset = node->ext.label.offset;
+        }
+    }
+#endif
+
+#if LV_USE_IMG
+    if(node->kind == LV_BLOB_IMG) {
+        lv_img_ext_t * ext = lv_obj_get_ext_attr(obj);
+        ext->auto_size     = node->ext.img.auto_size;
+        if(node->ext.img.src != NULL) lv_img_set_src(obj, node->ext.img.src);
+        else if(node->ext.img.src_str != LV_BLOB_NO_TEXT) lv_img_set_src(obj, blob + node->ext.img.src_str);
+        ext->offset = node->ext.img.offset;
+
+        /*Setting the source sized it to the image*/
+        obj->coords = node->area;
+        if(par != NULL) area_move(&obj->coords, par->coords.x1, par->coords.y1);
+    }
+#endif
+
+    return obj;
+}
+
+/**
+ * Set back the layout and fit of a container once all its children are created
+ * @param obj pointer to an object
+ * @param node the node of the object
+ */
+static void load_done(lv_obj_t * obj, const lv_blob_node_t * node)
+{
+#if LV_USE_CONT
+    const lv_cont_ext_t * stored = NULL;
+    if(node->kind == LV_BLOB_CONT) stored = &node->ext.cont;
+#if LV_USE_BTN
+    if(node->kind == LV_BLOB_BTN) stored = &node->ext.btn.cont;
+#endif
+    if(stored == NULL) return;
+
+    lv_cont_ext_t * ext = lv_obj_get_ext_attr(obj);
+    ext->layout         = stored->layout;
+    ext->fit_left       = stored->fit_left;
+    ext->fit_right      = stored->fit_right;
+    ext->fit_top        = stored->fit_top;
+    ext->fit_bottom     = stored->fit_bottom;
+#else
+    (void)obj;  /*Unused*/
+    (void)node; /*Unused*/
+#endif
+}
+
+/**
+ * Move an area
+ * @param area pointer to an area
+ * @param x_ofs moved by this much to the right
+ * @param y_ofs moved by this much down
+ */
+static void area_move(lv_area_t * area, lv_coord_t x_ofs, lv_coord_t y_ofs)
+{
+    area->x1 += x_ofs;
+    area->y1 += y_ofs;
+    area->x2 += x_ofs;
+    area->y2 += y_ofs;
+}
+
+#endif /*LV_USE_BLOB*/
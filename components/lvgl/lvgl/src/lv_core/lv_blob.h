@@ -0,0 +1,72 @@
+/**
+ * @file lv_blob.h
+ * Trees of objects stored in a blob, e.g. a constant in flash, and created again from it
+ */
+
+#ifndef LV_BLOB_H
+#define LV_BLOB_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*********************
+ *      INCLUDES
+ *********************/
+#ifdef LV_CONF_INCLUDE_SIMPLE
+#include "lv_conf.h"
+#else
+#include "../../../lv_conf.h"
+#endif
+
+#if LV_USE_BLOB
+
+#include "lv_obj.h"
+
+/*********************
+ *      DEFINES
+ *********************/
+
+/**********************
+ *      TYPEDEFS
+ **********************/
+
+/**********************
+ * GLOBAL PROTOTYPES
+ **********************/
+
+/**
+ * Store an object and its children in a blob: their types, coordinates, attributes, callbacks,
+ * style pointers and the texts of labels. Only base objects, containers, buttons, labels and
+ * images are stored, other types (with children of their own, like pages) make it fail.
+ * Pointers are stored as they are, so the blob is only valid for the firmware it was saved with,
+ * and the styles, callbacks and image sources must be static. Groups aren't stored.
+ * @param obj pointer to an object, typically a screen
+ * @param buf the blob is written here if it fits, can be NULL to only get the size
+ * @param buf_size size of `buf` in bytes
+ * @return size of the blob in bytes (nothing is written if greater than `buf_size`), 0: `obj`
+ * can't be stored
+ */
+uint32_t lv_blob_save(const lv_obj_t * obj, void * buf, uint32_t buf_size);
+
+/**
+ * Create the objects stored in a blob with `lv_blob_save()`. Their coordinates, layouts and fits
+ * are set as they were stored without laying them out again. The blob must be kept, e.g. as a
+ * constant, while the objects exist: the labels' texts point into it.
+ * @param blob pointer to a blob
+ * @param parent the parent of the first stored object, NULL to create it as a screen
+ * @return the first stored object, NULL if `blob` isn't a blob of this firmware
+ */
+lv_obj_t * lv_blob_load(const void * blob, lv_obj_t * parent);
+
+/**********************
+ *      MACROS
+ **********************/
+
+#endif /*LV_USE_BLOB*/
+
+#ifdef __cplusplus
+} /* extern "C" */
+#endif
+
+#endif /*LV_BLOB_H*/
@@ -0,0 +1,388 @@
+/**
+ * @file lv_cmd.c
+ * A bounded queue of commands many tasks put in and `lv_task_handler()` takes out.
+ * Every slot has a sequence number telling whether it waits to be written or read in the
+ * current pass over the ring, so the writers claim slots with one compare-and-swap of the
+ * head and neither they nor the reader ever wait for a lock.
+ */
+
+/*********************
+ *      INCLUDES
+ *********************/
+#include "lv_cmd.h"
+#if LV_USE_CMD_QUEUE != 0
+#include "../lv_objx/lv_bar.h"
+#include "../lv_objx/lv_slider.h"
+#include "../lv_objx/lv_gauge.h"
+#include "../lv_objx/lv_lmeter.h"
+#include "../lv_objx/lv_spinbox.h"
+#include "../lv_objx/lv_led.h"
+#include "../lv_objx/lv_sw.h"
+#include "../lv_objx/lv_cb.h"
+#include "../lv_objx/lv_roller.h"
+#include "../lv_objx/lv_ddlist.h"
+#include "../lv_objx/lv_label.h"
+#include "../lv_objx/lv_ta.h"
+#include <string.h>
+
+/*********************
+ *      DEFINES
+ *********************/
+
+/**********************
+ *      TYPEDEFS
+ **********************/
+typedef enum {
+    LV_CMD_SET_VALUE,
+    LV_CMD_SET_TEXT,
+    LV_CMD_INVALIDATE,
+    LV_CMD_CALL,
+} lv_cmd_type_t;
+
+typedef struct
+{
+    /*`pos`: free for the writer of queue position `pos`, `pos + 1`: written, waiting to be read*/
+    uint32_t seq;
+    lv_cmd_type_t type;
+    lv_obj_t * obj;
+    union
+    {
+        int32_t value;
+        char text[LV_CMD_TEXT_MAX];
+        struct
+        {
+            lv_cmd_cb_t cb;
+            void * user_data;
+        } call;
+    } arg;
+} lv_cmd_t;
+
+/**********************
+ *  STATIC PROTOTYPES
+ **********************/
+static lv_cmd_t * cmd_get(uint32_t * pos);
+static void cmd_put(lv_cmd_t * cmd, uint32_t pos);
+static void cmd_apply(const lv_cmd_t * cmd);
+static void set_value(lv_obj_t * obj, int32_t value);
+static void set_text(lv_obj_t * obj, const char * text);
+
+/**********************
+ *  STATIC VARIABLES
+ **********************/
+static lv_cmd_t cmd_ring[LV_CMD_QUEUE_LEN];
+static uint32_t cmd_head;   /*Next position to write, shared by the writers*/
+static uint32_t cmd_tail;   /*Next position to read, only used by `lv_cmd_run()`*/
+static uint32_t cmd_dropped;
+static lv_cmd_notify_cb_t notify_cb;
+
+/**********************
+ *      MACROS
+ **********************/
+
+/**********************
+ *   GLOBAL FUNCTIONS
+ **********************/
+
+/**
+ * Init the command queue. Called by `lv_init()`.
+ */
+void lv_cmd_init(void)
+{
+    uint32_t i;
+    for(i = 0; i < LV_CMD_QUEUE_LEN; i++) {
+        __atomic_store_n(&cmd_ring[i].seq, i, __ATOMIC_RELAXED);
+    }
+    cmd_tail = 0;
+    cmd_dropped = 0;
+    __atomic_store_n(&cmd_head, 0, __ATOMIC_RELEASE);
+}
+
+/**
+ * Apply the commands queued so far, in the order they were queued.
+ * Called at the start of `lv_task_handler()`, only call it from the task running that.
+ */
+void lv_cmd_run(void)
+{
+    /*Leave commands queued meanwhile to the next call so a busy writer can't hold up the refresh*/
+    uint32_t cnt;
+    for(cnt = 0; cnt < LV_CMD_QUEUE_LEN; cnt++) {
+        lv_cmd_t * slot = &cmd_ring[cmd_tail & (LV_CMD_QUEUE_LEN - 1)];
+        if(__atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE) != cmd_tail + 1) break;
+
+        /*Free the slot before applying the command so the writers have it back at once*/
+        lv_cmd_t cmd = *slot;
+        __atomic_store_n(&slot->seq, cmd_tail + LV_CMD_QUEUE_LEN, __ATOMIC_RELEASE);
+        cmd_tail++;
+
+        cmd_apply(&cmd);
+    }
+}
+
+/**
+ * Queue setting the value of a bar, slider, gauge (its first needle), line meter, spinbox,
+ * LED (brightness), switch or check box (0: off) or the selected option of a roller or drop down list.
+ * Can be called from any task. It never waits: if the queue is full the command is dropped.
+ * The object must exist until the command is applied.
+ * @param obj pointer to an object
+ * @param value the new value
+ * @return LV_RES_OK: queued, LV_RES_INV: the queue is full
+ */
+lv_res_t lv_cmd_set_value(lv_obj_t * obj, int32_t value)
+{
+    uint32_t pos;
+    lv_cmd_t * cmd = cmd_get(&pos);
+    if(cmd == NULL) return LV_RES_INV;
+
+    cmd->type = LV_CMD_SET_VALUE;
+    cmd->obj = obj;
+    cmd->arg.value = value;
+    cmd_put(cmd, pos);
+    return LV_RES_OK;
+}
+
+/**
+ * Queue setting the text of a label or text area. The text is copied to the command.
+ * Can be called from any task. It never waits: if the queue is full the command is dropped.
+ * The object must exist until the command is applied.
+ * @param obj pointer to a label or text area
+ * @param text '\0' terminated text of at most `LV_CMD_TEXT_MAX - 1` bytes
+ * @return LV_RES_OK: queued, LV_RES_INV: the text is too long or the queue is full
+ */
+lv_res_t lv_cmd_set_text(lv_obj_t * obj, const char * text)
+{
+    size_t len = strlen(text);
+    if(len >= LV_CMD_TEXT_MAX) return LV_RES_INV;
+
+    uint32_t pos;
+    lv_cmd_t * cmd = cmd_get(&pos);
+    if(cmd == NULL) return LV_RES_INV;
+
+    cmd->type = LV_CMD_SET_TEXT;
+    cmd->obj = obj;
+    memcpy(cmd->arg.text, text, len + 1);
+    cmd_put(cmd, pos);
+    return LV_RES_OK;
+}
+
+/**
+ * Queue redrawing an object, e.g. after changing data it draws from.
+ * Can be called from any task. It never waits: if the queue is full the command is dropped.
+ * The object must exist until the command is applied.
+ * @param obj pointer to an object
+ * @return LV_RES_OK: queued, LV_RES_INV: the queue is full
+ */
+lv_res_t lv_cmd_invalidate(lv_obj_t * obj)
+{
+    uint32_t pos;
+    lv_cmd_t * cmd = cmd_get(&pos);
+    if(cmd == NULL) return LV_RES_INV;
+
+    cmd->type = LV_CMD_INVALIDATE;
+    cmd->obj = obj;
+    cmd_put(cmd, pos);
+    return LV_RES_OK;
+}
+
+/**
+ * Queue calling a function from `lv_task_handler()`, where it can use any LittlevGL API.
+ * Unlike `lv_async_call()` nothing is allocated and it can be called from any task.
+ * It never waits: if the queue is full the command is dropped.
+ * @param cb function to call
+ * @param obj an object passed to `cb`, can be NULL
+ * @param user_data custom parameter passed to `cb`
+ * @return LV_RES_OK: queued, LV_RES_INV: the queue is full
+ */
+lv_res_t lv_cmd_call(lv_cmd_cb_t cb, lv_obj_t * obj, void * user_data)
+{
+    uint32_t pos;
+    lv_cmd_t * cmd = cmd_get(&pos);
+    if(cmd == NULL) return LV_RES_INV;
+
+    cmd->type = LV_CMD_CALL;
+    cmd->obj = obj;
+    cmd->arg.call.cb = cb;
+    cmd->arg.call.user_data = user_data;
+    cmd_put(cmd, pos);
+    return LV_RES_OK;
+}
+
+/**
+ * Set a function to call each time a command is queued
+ * @param cb the function or NULL
+ */
+void lv_cmd_set_notify_cb(lv_cmd_notify_cb_t cb)
+{
+    __atomic_store_n(&notify_cb, cb, __ATOMIC_RELEASE);
+}
+
+/**
+ * Get the number of commands dropped because the queue was full
+ * @return commands dropped since `lv_init()`
+ */
+uint32_t lv_cmd_get_dropped(void)
+{
+    return __atomic_load_n(&cmd_dropped, __ATOMIC_RELAXED);
+}
+
+/**********************
+ *   STATIC FUNCTIONS
+ **********************/
+
+/**
+ * Claim the slot at the head of the queue
+ * @param pos store the queue position of the slot here
+ * @return the slot to fill or NULL if the queue is full
+ */
+static lv_cmd_t * cmd_get(uint32_t * pos)
+{
+    uint32_t p = __atomic_load_n(&cmd_head, __ATOMIC_RELAXED);
+    while(1) {
+        lv_cmd_t * cmd = &cmd_ring[p & (LV_CMD_QUEUE_LEN - 1)];
+        int32_t dif = (int32_t)(__atomic_load_n(&cmd->seq, __ATOMIC_ACQUIRE) - p);
+        if(dif == 0) {
+            /*On failure `p` is loaded with the head another writer moved*/
+            if(__atomic_compare_exchange_n(&cmd_head, &p, p + 1, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+                *pos = p;
+                return cmd;
+            }
+        } else if(dif < 0) {
+            /*The slot still holds the command of the previous pass: full*/
+            __atomic_fetch_add(&cmd_dropped, 1, __ATOMIC_RELAXED);
+            return NULL;
+        } else {
+            p = __atomic_load_n(&cmd_head, __ATOMIC_RELAXED);
+        }
+    }
+}
+
+/**
+ * Hand a filled slot to the reader
+ * @param cmd the slot from `cmd_get()`
+ * @param pos its queue position
+ */
+static void cmd_put(lv_cmd_t * cmd, uint32_t pos)
+{
+    __atomic_store_n(&cmd->seq, pos + 1, __ATOMIC_RELEASE);
+
+    lv_cmd_notify_cb_t cb = __atomic_load_n(&notify_cb, __ATOMIC_ACQUIRE);
+    if(cb) cb();
+}
+
+/**
+ * Carry out a command
+ * @param cmd the command
+ */
+static void cmd_apply(const lv_cmd_t * cmd)
+{
+    switch(cmd->type) {
+        case LV_CMD_SET_VALUE: set_value(cmd->obj, cmd->arg.value); break;
+        case LV_CMD_SET_TEXT: set_text(cmd->obj, cmd->arg.text); break;
+        case LV_CMD_INVALIDATE: lv_obj_invalidate(cmd->obj); break;
+        case LV_CMD_CALL: cmd->arg.call.cb(cmd->obj, cmd->arg.call.user_data); break;
+    }
+}
+
+/**
+ * Set the value of an object with the setter of its type
+ * @param obj pointer to an object
+ * @param value the new value
+ */
+static void set_value(lv_obj_t * obj, int32_t value)
+{
+    lv_obj_type_t type;
+    lv_obj_get_type(obj, &type);
+    const char * t = type.type[0];
+
+#if LV_USE_SLIDER
+    if(strcmp(t, "lv_slider") == 0) {
+        lv_slider_set_value(obj, value, LV_ANIM_OFF);
+        return;
+    }
+#endif
+#if LV_USE_BAR
+    if(strcmp(t, "lv_bar") == 0) {
+        lv_bar_set_value(obj, value, LV_ANIM_OFF);
+        return;
+    }
+#endif
+#if LV_USE_GAUGE
+    if(strcmp(t, "lv_gauge") == 0) {
+        lv_gauge_set_value(obj, 0, value);
+        return;
+    }
+#endif
+#if LV_USE_LMETER
+    if(strcmp(t, "lv_lmeter") == 0) {
+        lv_lmeter_set_value(obj, value);
+        return;
+    }
+#endif
+#if LV_USE_SPINBOX
+    if(strcmp(t, "lv_spinbox") == 0) {
+        lv_spinbox_set_value(obj, value);
+        return;
+    }
+#endif
+#if LV_USE_LED
+    if(strcmp(t, "lv_led") == 0) {
+        lv_led_set_bright(obj, value);
+        return;
+    }
+#endif
+#if LV_USE_SW
+    if(strcmp(t, "lv_sw") == 0) {
+        if(value) lv_sw_on(obj, LV_ANIM_OFF);
+        else lv_sw_off(obj, LV_ANIM_OFF);
+        return;
+    }
+#endif
+#if LV_USE_CB
+    if(strcmp(t, "lv_cb") == 0) {
+        lv_cb_set_checked(obj, value != 0);
+        return;
+    }
+#endif
+#if LV_USE_ROLLER
+    if(strcmp(t, "lv_roller") == 0) {
+        lv_roller_set_selected(obj, value, LV_ANIM_OFF);
+        return;
+    }
+#endif
+#if LV_USE_DDLIST
+    if(strcmp(t, "lv_ddlist") == 0) {
+        lv_ddlist_set_selected(obj, value);
+        return;
+    }
+#endif
+
+    LV_LOG_WARN("lv_cmd_set_value: the object has no value");
+}
+
+/**
+ * Set the text of an object with the setter of its type
+ * @param obj pointer to a label or text area
+ * @param text the new text
+ */
+static void set_text(lv_obj_t * obj, const char * text)
+{
+    lv_obj_type_t type;
+    lv_obj_get_type(obj, &type);
+    const char * t = type.type[0];
+
+#if LV_USE_LABEL
+    if(strcmp(t, "lv_label") == 0) {
+        lv_label_set_text(obj, text);
+        return;
+    }
+#endif
+#if LV_USE_TA
+    if(strcmp(t, "lv_ta") == 0) {
+        lv_ta_set_text(obj, text);
+        return;
+    }
+#endif
+
+    LV_LOG_WARN("lv_cmd_set_text: the object has no text");
+}
+
+#endif /*LV_USE_CMD_QUEUE*/
@@ -0,0 +1,128 @@
+/**
+ * @file lv_cmd.h
+ * Commands other tasks queue for the task running `lv_task_handler()`
+ */
+
+#ifndef LV_CMD_H
+#define LV_CMD_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*********************
+ *      INCLUDES
+ *********************/
+#ifdef LV_CONF_INCLUDE_SIMPLE
+#include "lv_conf.h"
+#else
+#include "../../../lv_conf.h"
+#endif
+
+#if LV_USE_CMD_QUEUE
+
+#include "lv_obj.h"
+
+/*********************
+ *      DEFINES
+ *********************/
+#if (LV_CMD_QUEUE_LEN & (LV_CMD_QUEUE_LEN - 1)) != 0
+#error "LV_CMD_QUEUE_LEN must be a power of 2. See lv_conf.h"
+#endif
+
+/**********************
+ *      TYPEDEFS
+ **********************/
+
+/**
+ * Called by `lv_task_handler()` for a command given with `lv_cmd_call()`
+ * @param obj the object given
+ * @param user_data the user data given
+ */
+typedef void (*lv_cmd_cb_t)(lv_obj_t * obj, void * user_data);
+
+/**
+ * Called by the task queuing a command right after it is queued, e.g. to wake the task running
+ * `lv_task_handler()`
+ */
+typedef void (*lv_cmd_notify_cb_t)(void);
+
+/**********************
+ * GLOBAL PROTOTYPES
+ **********************/
+
+/**
+ * Init the command queue. Called by `lv_init()`.
+ */
+void lv_cmd_init(void);
+
+/**
+ * Apply the commands queued so far, in the order they were queued.
+ * Called at the start of `lv_task_handler()`, only call it from the task running that.
+ */
+void lv_cmd_run(void);
+
+/**
+ * Queue setting the value of a bar, slider, gauge (its first needle), line meter, spinbox,
+ * LED (brightness), switch or check box (0: off) or the selected option of a roller or drop down list.
+ * Can be called from any task. It never waits: if the queue is full the command is dropped.
+ * The object must exist until the command is applied.
+ * @param obj pointer to an object
+ * @param value the new value
+ * @return LV_RES_OK: queued, LV_RES_INV: the queue is full
+ */
+lv_res_t lv_cmd_set_value(lv_obj_t * obj, int32_t value);
+
+/**
+ * Queue setting the text of a label or text area. The text is copied to the command.
+ * Can be called from any task. It never waits: if the queue is full the command is dropped.
+ * The object must exist until the command is applied.
+ * @param obj pointer to a label or text area
+ * @param text '\0' terminated text of at most `LV_CMD_TEXT_MAX - 1` bytes
+ * @return LV_RES_OK: queued, LV_RES_INV: the text is too long or the queue is full
+ */
+lv_res_t lv_cmd_set_text(lv_obj_t * obj, const char * text);
+
+/**
+ * Queue redrawing an object, e.g. after changing data it draws from.
+ * Can be called from any task. It never waits: if the queue is full the command is dropped.
+ * The object must exist until the command is applied.
+ * @param obj pointer to an object
+ * @return LV_RES_OK: queued, LV_RES_INV: the queue is full
+ */
+lv_res_t lv_cmd_invalidate(lv_obj_t * obj);
+
+/**
+ * Queue calling a function from `lv_task_handler()`, where it can use any LittlevGL API.
+ * Unlike `lv_async_call()` nothing is allocated and it can be called from any task.
+ * It never waits: if the queue is full the command is dropped.
+ * @param cb function to call
+ * @param obj an object passed to `cb`, can be NULL
+ * @param user_data custom parameter passed to `cb`
+ * @return LV_RES_OK: queued, LV_RES_INV: the queue is full
+ */
+lv_res_t lv_cmd_call(lv_cmd_cb_t cb, lv_obj_t * obj, void * user_data);
+
+/**
+ * Set a function to call each time a command is queued
+ * @param cb the function or NULL
+ */
+void lv_cmd_set_notify_cb(lv_cmd_notify_cb_t cb);
+
+/**
+ * Get the number of commands dropped because the queue was full
+ * @return commands dropped since `lv_init()`
+ */
+uint32_t lv_cmd_get_dropped(void);
+
+/**********************
+ *      MACROS
+ **********************/
+
+#endif /*LV_USE_CMD_QUEUE*/
+
+#ifdef __cplusplus
+} /* extern "C" */
+#endif
+
+#endif /*LV_CMD_H*/
@@ -4,6 +4,8 @@ CSRCS += lv_disp.c
 CSRCS += lv_obj.c
 CSRCS += lv_refr.c
 CSRCS += lv_style.c
+CSRCS += lv_cmd.c
+CSRCS += lv_blob.c
 
 DEPPATH += --dep-path $(LVGL_DIR)/lvgl/src/lv_core
 VPATH += :$(LVGL_DIR)/lvgl/src/lv_core
@@ -1007,15 +1007,39 @@ static lv_obj_t * indev_search_obj(const lv_indev_proc_t * proc, lv_obj_t * obj)
 #else
     if(lv_area_is_point_on(&obj->coords, &proc->types.pointer.act_point)) {
 #endif
-        lv_obj_t * i;
-
-        LV_LL_READ(obj->child_ll, i)
+#if LV_USE_OBJ_CHILD_CACHE
+        uint16_t child_cnt;
+        lv_obj_t ** child_a = lv_obj_get_child_array(obj, &child_cnt);
+        if(child_a != NULL) {
+            uint16_t c;
+#if LV_OBJ_HIT_GRID
+            /*With many children only test those which can be clicked near the point*/
+            uint16_t hit_cnt;
+            const uint16_t * hits = lv_obj_get_child_hits(obj, &proc->types.pointer.act_point, &hit_cnt);
+            if(hits != NULL) {
+                for(c = 0; c < hit_cnt && found_p == NULL; c++) {
+                    found_p = indev_search_obj(proc, child_a[hits[c]]);
+                }
+            } else
+#endif
+            {
+                for(c = 0; c < child_cnt && found_p == NULL; c++) {
+                    found_p = indev_search_obj(proc, child_a[c]);
+                }
+            }
+        } else
+#endif
         {
-            found_p = indev_search_obj(proc, i);
+            lv_obj_t * i;
+
+            LV_LL_READ(obj->child_ll, i)
+            {
+                found_p = indev_search_obj(proc, i);
 
-            /*If a child was found then break*/
-            if(found_p != NULL) {
-                break;
+                /*If a child was found then break*/
+                if(found_p != NULL) {
+                    break;
+                }
             }
         }
 
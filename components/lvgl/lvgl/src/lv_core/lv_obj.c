@@ -16,7 +16,9 @@
 #include "../lv_misc/lv_anim.h"
 #include "../lv_misc/lv_task.h"
 #include "../lv_misc/lv_async.h"
+#include "lv_cmd.h"
 #include "../lv_misc/lv_fs.h"
+#include "../lv_misc/lv_math.h"
 #include "../lv_hal/lv_hal.h"
 #include <stdint.h>
 #include <string.h>
@@ -32,6 +34,10 @@
 #define LV_OBJ_DEF_WIDTH (LV_DPI)
 #define LV_OBJ_DEF_HEIGHT (2 * LV_DPI / 3)
 
+#if LV_USE_OBJ_CHILD_CACHE && LV_OBJ_HIT_GRID
+#define HIT_GRID_CELLS 64 /*Cells of a hit-test grid*/
+#endif
+
 /**********************
  *      TYPEDEFS
  **********************/
@@ -42,6 +48,19 @@ typedef struct _lv_event_temp_data
     struct _lv_event_temp_data * prev;
 } lv_event_temp_data_t;
 
+#if LV_USE_OBJ_CHILD_CACHE && LV_OBJ_HIT_GRID
+/*The indexes of the children clickable in cell `i` are `idx[start[i]]` to `idx[start[i + 1] - 1]`*/
+typedef struct _lv_obj_hit_grid_t
+{
+    lv_coord_t cell_w; /*Size of a cell when the grid was built. The cells are relative to the object*/
+    lv_coord_t cell_h;
+    uint8_t cols;
+    uint8_t rows;
+    uint32_t start[HIT_GRID_CELLS + 1];
+    uint16_t idx[];
+} lv_obj_hit_grid_t;
+#endif
+
 /**********************
  *  STATIC PROTOTYPES
  **********************/
@@ -51,6 +70,26 @@ static void refresh_children_style(lv_obj_t * obj);
 static void delete_children(lv_obj_t * obj);
 static void lv_event_mark_deleted(lv_obj_t * obj);
 static void lv_obj_del_async_cb(void * obj);
+static void invalidate_now(const lv_obj_t * obj);
+static void invalidate_area_now(const lv_obj_t * obj, const lv_area_t * area);
+#if LV_USE_OBJ_INV_DEFER
+static lv_disp_t * scr_shown_disp(const lv_obj_t * scr);
+static void inv_later_drop(lv_obj_t * obj);
+#endif
+#if LV_USE_OBJ_LAYOUT_DEFER
+static void layout_later_drop(lv_obj_t * obj);
+static void layout_settle(const lv_obj_t * obj);
+#endif
+#if LV_USE_OBJ_CHILD_CACHE
+static void child_cache_drop(lv_obj_t * obj);
+#if LV_OBJ_HIT_GRID
+static lv_obj_hit_grid_t * hit_grid_build(lv_obj_t * obj);
+static void hit_grid_cells(const lv_obj_t * obj, const lv_obj_hit_grid_t * grid, const lv_obj_t * child,
+                           lv_area_t * cells);
+static lv_coord_t hit_grid_cell(lv_coord_t d, lv_coord_t cell, uint8_t num);
+static void hit_grid_drop(lv_obj_t * obj);
+#endif
+#endif
 static bool lv_obj_design(lv_obj_t * obj, const lv_area_t * mask_p, lv_design_mode_t mode);
 static lv_res_t lv_obj_signal(lv_obj_t * obj, lv_signal_t sign, void * param);
 
@@ -60,6 +99,21 @@ static lv_res_t lv_obj_signal(lv_obj_t * obj, lv_signal_t sign, void * param);
 static bool lv_initialized = false;
 static lv_event_temp_data_t * event_temp_data_head;
 static const void * event_act_data;
+#if LV_USE_OBJ_INV_DEFER
+static bool inv_defer;
+static lv_obj_t ** inv_later; /*Objects marked while `inv_defer` is set*/
+static uint16_t inv_later_cnt;
+static uint16_t inv_later_size;
+#endif
+#if LV_USE_OBJ_LAYER
+static const lv_obj_t * layer_keep; /*Invalidated without changing its own layer*/
+#endif
+#if LV_USE_OBJ_LAYOUT_DEFER
+static bool layout_defer;
+static lv_obj_t ** layout_later; /*Objects whose layout is marked, refreshed last first*/
+static uint16_t layout_later_cnt;
+static uint16_t layout_later_size;
+#endif
 
 /**********************
  *      MACROS
@@ -84,8 +138,15 @@ void lv_init(void)
 
     /*Initialize the lv_misc modules*/
     lv_mem_init();
+
+    /*Allocate the objects from a pool. They are nodes of their parent's `child_ll`*/
+    lv_mem_pool_add(sizeof(lv_obj_t) + 2 * sizeof(lv_ll_node_t *));
     lv_task_core_init();
 
+#if LV_USE_CMD_QUEUE
+    lv_cmd_init();
+#endif
+
 #if LV_USE_FILESYSTEM
     lv_fs_init();
 #endif
@@ -147,6 +208,21 @@ lv_obj_t * lv_obj_create(lv_obj_t * parent, const lv_obj_t * copy)
 
         new_obj->par = NULL; /*Screens has no a parent*/
         lv_ll_init(&(new_obj->child_ll), sizeof(lv_obj_t));
+        new_obj->layout_later = 0;
+        new_obj->opa_layer    = 0;
+#if LV_USE_OBJ_CHILD_CACHE
+        new_obj->child_cache       = NULL;
+        new_obj->child_cache_valid = 0;
+        new_obj->inv_later = 0;
+#if LV_OBJ_HIT_GRID
+        new_obj->hit_grid = NULL;
+#endif
+#endif
+#if LV_USE_REFR_PROF
+        new_obj->prof_main  = 0;
+        new_obj->prof_post  = 0;
+        new_obj->prof_calls = 0;
+#endif
 
         /*Set coordinates to full screen size*/
         new_obj->coords.x1    = 0;
@@ -220,6 +296,22 @@ lv_obj_t * lv_obj_create(lv_obj_t * parent, const lv_obj_t * copy)
 
         new_obj->par = parent; /*Set the parent*/
         lv_ll_init(&(new_obj->child_ll), sizeof(lv_obj_t));
+        new_obj->layout_later = 0;
+        new_obj->opa_layer    = 0;
+#if LV_USE_OBJ_CHILD_CACHE
+        new_obj->child_cache       = NULL;
+        new_obj->child_cache_valid = 0;
+        new_obj->inv_later = 0;
+#if LV_OBJ_HIT_GRID
+        new_obj->hit_grid = NULL;
+#endif
+        child_cache_drop(parent);
+#endif
+#if LV_USE_REFR_PROF
+        new_obj->prof_main  = 0;
+        new_obj->prof_post  = 0;
+        new_obj->prof_calls = 0;
+#endif
 
         /*Set coordinates left top corner of parent*/
         new_obj->coords.x1    = parent->coords.x1;
@@ -334,6 +426,7 @@ lv_obj_t * lv_obj_create(lv_obj_t * parent, const lv_obj_t * copy)
         new_obj->parent_event = copy->parent_event;
 
         new_obj->opa_scale_en = copy->opa_scale_en;
+        new_obj->opa_layer    = copy->opa_layer;
         new_obj->protect      = copy->protect;
         new_obj->opa_scale    = copy->opa_scale;
 
@@ -374,7 +467,7 @@ lv_obj_t * lv_obj_create(lv_obj_t * parent, const lv_obj_t * copy)
  */
 lv_res_t lv_obj_del(lv_obj_t * obj)
 {
-    lv_obj_invalidate(obj);
+    invalidate_now(obj);
 
     /*Delete from the group*/
 #if LV_USE_GROUP
@@ -414,6 +507,9 @@ lv_res_t lv_obj_del(lv_obj_t * obj)
         lv_ll_rem(&d->scr_ll, obj);
     } else {
         lv_ll_rem(&(par->child_ll), obj);
+#if LV_USE_OBJ_CHILD_CACHE
+        child_cache_drop(par);
+#endif
     }
 
     /* Reset all input devices if the object to delete is used*/
@@ -440,6 +536,18 @@ lv_res_t lv_obj_del(lv_obj_t * obj)
 
     /*Delete the base objects*/
     if(obj->ext_attr != NULL) lv_mem_free(obj->ext_attr);
+#if LV_USE_OBJ_CHILD_CACHE
+    child_cache_drop(obj);
+#endif
+#if LV_USE_OBJ_INV_DEFER
+    if(obj->inv_later) inv_later_drop(obj);
+#endif
+#if LV_USE_OBJ_LAYOUT_DEFER
+    if(obj->layout_later) layout_later_drop(obj);
+#endif
+#if LV_USE_OBJ_LAYER
+    if(obj->opa_layer) lv_refr_layer_free(obj);
+#endif
     lv_mem_free(obj); /*Free the object itself*/
 
     /*Send a signal to the parent to notify it about the child delete*/
@@ -484,38 +592,221 @@ void lv_obj_clean(lv_obj_t * obj)
  */
 void lv_obj_invalidate(const lv_obj_t * obj)
 {
-    if(lv_obj_get_hidden(obj)) return;
+#if LV_USE_OBJ_INV_DEFER
+    if(inv_defer) {
+        if(obj->inv_later || lv_obj_get_hidden(obj)) return;
+
+        if(inv_later_cnt == inv_later_size) {
+            lv_obj_t ** later = NULL;
+            uint16_t size     = inv_later_size ? inv_later_size * 2 : 16;
+            if(size > inv_later_size) later = lv_mem_realloc(inv_later, size * sizeof(lv_obj_t *));
+            if(later == NULL) { /*Can't remember it so invalidate it now*/
+                invalidate_now(obj);
+                return;
+            }
+            inv_later      = later;
+            inv_later_size = size;
+        }
 
-    /*Invalidate the object only if it belongs to the 'LV_GC_ROOT(_lv_act_scr)'*/
-    lv_obj_t * obj_scr = lv_obj_get_screen(obj);
-    lv_disp_t * disp   = lv_obj_get_disp(obj_scr);
-    if(obj_scr == lv_disp_get_scr_act(disp) || obj_scr == lv_disp_get_layer_top(disp) ||
-       obj_scr == lv_disp_get_layer_sys(disp)) {
-        /*Truncate recursively to the parents*/
-        lv_area_t area_trunc;
-        lv_obj_t * par = lv_obj_get_parent(obj);
-        bool union_ok  = true;
-        /*Start with the original coordinates*/
-        lv_coord_t ext_size = obj->ext_draw_pad;
-        lv_area_copy(&area_trunc, &obj->coords);
-        area_trunc.x1 -= ext_size;
-        area_trunc.y1 -= ext_size;
-        area_trunc.x2 += ext_size;
-        area_trunc.y2 += ext_size;
+        ((lv_obj_t *)obj)->inv_later = 1;
+        inv_later[inv_later_cnt]     = (lv_obj_t *)obj;
+        inv_later_cnt++;
+        return;
+    }
+#endif
 
-        /*Check through all parents*/
-        while(par != NULL) {
-            union_ok = lv_area_intersect(&area_trunc, &area_trunc, &par->coords);
-            if(union_ok == false) break;       /*If no common parts with parent break;*/
-            if(lv_obj_get_hidden(par)) return; /*If the parent is hidden then the child is hidden and won't be drawn*/
+    invalidate_now(obj);
+}
 
-            par = lv_obj_get_parent(par);
+/**
+ * Mark a part of an object invalid so only it is redrawn. It isn't deferred by `lv_obj_set_inv_defer`.
+ * @param obj pointer to an object
+ * @param area the part to redraw, in absolute coordinates. It's truncated to the object and its parents.
+ */
+void lv_obj_invalidate_area(const lv_obj_t * obj, const lv_area_t * area)
+{
+    lv_area_t area_trunc;
+    lv_coord_t ext_size = obj->ext_draw_pad;
+    lv_area_copy(&area_trunc, &obj->coords);
+    area_trunc.x1 -= ext_size;
+    area_trunc.y1 -= ext_size;
+    area_trunc.x2 += ext_size;
+    area_trunc.y2 += ext_size;
+    if(lv_area_intersect(&area_trunc, &area_trunc, area) == false) return;
+
+    invalidate_area_now(obj, &area_trunc);
+}
+
+#if LV_USE_OBJ_INV_DEFER
+/**
+ * Enable or disable deferred invalidation. While it's enabled `lv_obj_invalidate` only marks the
+ * object and its area is invalidated when its display is refreshed, once however many times it was
+ * marked and not at all if one of its parents is marked too. The old area of a moved, resized,
+ * restyled, hidden or deleted object is still invalidated at once.
+ * @param en true: defer the invalidations
+ */
+void lv_obj_set_inv_defer(bool en)
+{
+    inv_defer = en;
+}
+
+/**
+ * Tell whether deferred invalidation is enabled
+ * @return true: `lv_obj_invalidate` only marks the objects
+ */
+bool lv_obj_get_inv_defer(void)
+{
+    return inv_defer;
+}
+
+/**
+ * Get the number of objects marked by deferred invalidations and not yet resolved
+ * @return number of marked objects
+ */
+uint16_t lv_obj_get_inv_later_cnt(void)
+{
+    return inv_later_cnt;
+}
+
+/**
+ * Invalidate the areas of the marked objects shown on a display. Called when it's refreshed.
+ * @param disp pointer to a display
+ */
+void lv_obj_inv_resolve(lv_disp_t * disp)
+{
+    uint16_t i;
+
+    /*The area of a child is truncated to its parent's so leave it out if the parent is marked too.
+     * Keep the marks until every object is checked*/
+    for(i = 0; i < inv_later_cnt; i++) {
+        lv_obj_t * obj = inv_later[i];
+        lv_obj_t * scr = obj;
+        bool covered   = false;
+        while(scr->par != NULL) {
+            scr = scr->par;
+            if(scr->inv_later) covered = true;
         }
 
-        if(union_ok) lv_inv_area(disp, &area_trunc);
+        if(covered == false && scr_shown_disp(scr) == disp) invalidate_now(obj);
     }
+
+    /*Keep the objects waiting for another display and forget the rest (resolved or not shown)*/
+    uint16_t kept = 0;
+    for(i = 0; i < inv_later_cnt; i++) {
+        lv_obj_t * obj    = inv_later[i];
+        lv_disp_t * shown = scr_shown_disp(lv_obj_get_screen(obj));
+        if(shown != NULL && shown != disp) {
+            inv_later[kept] = obj;
+            kept++;
+        } else {
+            obj->inv_later = 0;
+        }
+    }
+    inv_later_cnt = kept;
+
+    if(inv_later_cnt == 0 && inv_defer == false && inv_later != NULL) {
+        lv_mem_free(inv_later);
+        inv_later      = NULL;
+        inv_later_size = 0;
+    }
+}
+#endif
+
+#if LV_USE_OBJ_LAYOUT_DEFER
+/**
+ * Enable or disable deferred layouts. While it's enabled the layouts and fits of containers are
+ * only marked when their children, size or style change and refreshed once before the next display
+ * refresh, so building a container of N children takes O(N) rather than O(N^2) time. Reading an
+ * object's coordinates or size refreshes its own fit first, but positions set by its parent's layout
+ * are only applied then or by `lv_obj_layout_resolve`. Disabling refreshes the marked ones.
+ * @param en true: defer the layouts
+ */
+void lv_obj_set_layout_defer(bool en)
+{
+    layout_defer = en;
+    if(en == false) lv_obj_layout_resolve();
+}
+
+/**
+ * Tell whether deferred layouts are enabled
+ * @return true: containers' layouts are only marked
+ */
+bool lv_obj_get_layout_defer(void)
+{
+    return layout_defer;
+}
+
+/**
+ * Mark an object's layout to be refreshed later with an `LV_SIGNAL_REFR_LAYOUT` signal. Used by
+ * objects arranging their children.
+ * @param obj pointer to an object
+ * @return true: marked (or already marked); false: layouts aren't deferred or it couldn't be
+ * remembered, so refresh it now
+ */
+bool lv_obj_layout_later(lv_obj_t * obj)
+{
+    if(layout_defer == false) return false;
+    if(obj->layout_later) return true;
+
+    if(layout_later_cnt == layout_later_size) {
+        lv_obj_t ** later = NULL;
+        uint16_t size     = layout_later_size ? layout_later_size * 2 : 16;
+        if(size > layout_later_size) later = lv_mem_realloc(layout_later, size * sizeof(lv_obj_t *));
+        if(later == NULL) return false;
+        layout_later      = later;
+        layout_later_size = size;
+    }
+
+    obj->layout_later              = 1;
+    layout_later[layout_later_cnt] = obj;
+    layout_later_cnt++;
+    return true;
+}
+
+/**
+ * Refresh the layout of an object now if it's marked
+ * @param obj pointer to an object
+ */
+void lv_obj_layout_refresh(lv_obj_t * obj)
+{
+    if(obj->layout_later == 0) return;
+
+    layout_later_drop(obj);
+    obj->signal_cb(obj, LV_SIGNAL_REFR_LAYOUT, NULL);
+}
+
+/**
+ * Get the number of objects whose layouts are marked and not yet refreshed
+ * @return number of marked objects
+ */
+uint16_t lv_obj_get_layout_later_cnt(void)
+{
+    return layout_later_cnt;
 }
 
+/**
+ * Refresh every marked layout, including those marked again meanwhile. Called before each display
+ * refresh; call it to use the final coordinates of objects read directly from `coords`.
+ */
+void lv_obj_layout_resolve(void)
+{
+    /*The last marked go first: children are usually marked after their parents, whose layouts then
+     * see their final sizes. A parent a child's new size marks again is appended and done after it.*/
+    while(layout_later_cnt != 0) {
+        layout_later_cnt--;
+        lv_obj_t * obj    = layout_later[layout_later_cnt];
+        obj->layout_later = 0;
+        obj->signal_cb(obj, LV_SIGNAL_REFR_LAYOUT, NULL);
+    }
+
+    if(layout_defer == false && layout_later != NULL) {
+        lv_mem_free(layout_later);
+        layout_later      = NULL;
+        layout_later_size = 0;
+    }
+}
+#endif
+
 /*=====================
  * Setter functions
  *====================*/
@@ -541,7 +832,7 @@ void lv_obj_set_parent(lv_obj_t * obj, lv_obj_t * parent)
         return;
     }
 
-    lv_obj_invalidate(obj);
+    invalidate_now(obj);
 
     lv_point_t old_pos;
     old_pos.x = lv_obj_get_x(obj);
@@ -550,6 +841,10 @@ void lv_obj_set_parent(lv_obj_t * obj, lv_obj_t * parent)
     lv_obj_t * old_par = obj->par;
 
     lv_ll_chg_list(&obj->par->child_ll, &parent->child_ll, obj, true);
+#if LV_USE_OBJ_CHILD_CACHE
+    child_cache_drop(obj->par);
+    child_cache_drop(parent);
+#endif
     obj->par = parent;
     lv_obj_set_pos(obj, old_pos.x, old_pos.y);
 
@@ -576,6 +871,9 @@ void lv_obj_move_foreground(lv_obj_t * obj)
     lv_obj_invalidate(parent);
 
     lv_ll_chg_list(&parent->child_ll, &parent->child_ll, obj, true);
+#if LV_USE_OBJ_CHILD_CACHE
+    child_cache_drop(parent);
+#endif
 
     /*Notify the new parent about the child*/
     parent->signal_cb(parent, LV_SIGNAL_CHILD_CHG, obj);
@@ -597,6 +895,9 @@ void lv_obj_move_background(lv_obj_t * obj)
     lv_obj_invalidate(parent);
 
     lv_ll_chg_list(&parent->child_ll, &parent->child_ll, obj, false);
+#if LV_USE_OBJ_CHILD_CACHE
+    child_cache_drop(parent);
+#endif
 
     /*Notify the new parent about the child*/
     parent->signal_cb(parent, LV_SIGNAL_CHILD_CHG, obj);
@@ -632,8 +933,15 @@ void lv_obj_set_pos(lv_obj_t * obj, lv_coord_t x, lv_coord_t y)
      * occur without position change*/
     if(diff.x == 0 && diff.y == 0) return;
 
+    /*Let the parent move the pixels on the display instead if it can*/
+    lv_child_move_t move;
+    move.child  = obj;
+    move.diff   = diff;
+    move.copied = false;
+    par->signal_cb(par, LV_SIGNAL_CHILD_MOVE, &move);
+
     /*Invalidate the original area*/
-    lv_obj_invalidate(obj);
+    if(move.copied == false) invalidate_now(obj);
 
     /*Save the original coordinates*/
     lv_area_t ori;
@@ -645,6 +953,9 @@ void lv_obj_set_pos(lv_obj_t * obj, lv_coord_t x, lv_coord_t y)
     obj->coords.y2 += diff.y;
 
     refresh_children_position(obj, diff.x, diff.y);
+#if LV_USE_OBJ_CHILD_CACHE && LV_OBJ_HIT_GRID
+    hit_grid_drop(par);
+#endif
 
     /*Inform the object about its new coordinates*/
     obj->signal_cb(obj, LV_SIGNAL_CORD_CHG, &ori);
@@ -653,7 +964,7 @@ void lv_obj_set_pos(lv_obj_t * obj, lv_coord_t x, lv_coord_t y)
     par->signal_cb(par, LV_SIGNAL_CHILD_CHG, obj);
 
     /*Invalidate the new area*/
-    lv_obj_invalidate(obj);
+    if(move.copied == false) lv_obj_invalidate(obj);
 }
 
 /**
@@ -693,7 +1004,7 @@ void lv_obj_set_size(lv_obj_t * obj, lv_coord_t w, lv_coord_t h)
     }
 
     /*Invalidate the original area*/
-    lv_obj_invalidate(obj);
+    invalidate_now(obj);
 
     /*Save the original coordinates*/
     lv_area_t ori;
@@ -702,6 +1013,9 @@ void lv_obj_set_size(lv_obj_t * obj, lv_coord_t w, lv_coord_t h)
     /*Set the length and height*/
     obj->coords.x2 = obj->coords.x1 + w - 1;
     obj->coords.y2 = obj->coords.y1 + h - 1;
+#if LV_USE_OBJ_CHILD_CACHE && LV_OBJ_HIT_GRID
+    if(obj->par != NULL) hit_grid_drop(obj->par);
+#endif
 
     /*Send a signal to the object with its new coordinates*/
     obj->signal_cb(obj, LV_SIGNAL_CORD_CHG, &ori);
@@ -1084,6 +1398,9 @@ void lv_obj_set_ext_click_area(lv_obj_t * obj, uint8_t w, uint8_t h)
 {
     obj->ext_click_pad_hor = w;
     obj->ext_click_pad_ver = h;
+#if LV_USE_OBJ_CHILD_CACHE && LV_OBJ_HIT_GRID
+    if(obj->par != NULL) hit_grid_drop(obj->par);
+#endif
 }
 #endif
 
@@ -1114,6 +1431,9 @@ void lv_obj_set_ext_click_area(lv_obj_t * obj, lv_coord_t left, lv_coord_t right
     (void)top;    /*Unused*/
     (void)bottom; /*Unused*/
 #endif
+#if LV_USE_OBJ_CHILD_CACHE && LV_OBJ_HIT_GRID
+    if(obj->par != NULL) hit_grid_drop(obj->par);
+#endif
 }
 
 /*---------------------
@@ -1142,7 +1462,7 @@ void lv_obj_set_style(lv_obj_t * obj, const lv_style_t * style)
  */
 void lv_obj_refresh_style(lv_obj_t * obj)
 {
-    lv_obj_invalidate(obj);
+    invalidate_now(obj);
     obj->signal_cb(obj, LV_SIGNAL_STYLE_CHG, NULL);
     lv_obj_invalidate(obj);
 }
@@ -1181,7 +1501,7 @@ void lv_obj_report_style_mod(lv_style_t * style)
  */
 void lv_obj_set_hidden(lv_obj_t * obj, bool en)
 {
-    if(!obj->hidden) lv_obj_invalidate(obj); /*Invalidate when not hidden (hidden objects are ignored) */
+    if(!obj->hidden) invalidate_now(obj); /*Invalidate when not hidden (hidden objects are ignored) */
 
     obj->hidden = en == false ? 0 : 1;
 
@@ -1287,9 +1607,39 @@ void lv_obj_set_opa_scale_enable(lv_obj_t * obj, bool en)
 void lv_obj_set_opa_scale(lv_obj_t * obj, lv_opa_t opa_scale)
 {
     obj->opa_scale = opa_scale;
+
+#if LV_USE_OBJ_LAYER
+    /*The layer stays as it is, it's only blended differently*/
+    if(obj->opa_layer) {
+        layer_keep = obj;
+        invalidate_now(obj);
+        layer_keep = NULL;
+        return;
+    }
+#endif
+
     lv_obj_invalidate(obj);
 }
 
+#if LV_USE_OBJ_LAYER
+/**
+ * Draw an object and its children into a cached layer at full opacity and blend the layer with the
+ * object's opa scale in one pass while it's less than `LV_OPA_COVER`. The layer is drawn again only
+ * when something in it is invalidated, so changing the opa scale costs one blend of the layer.
+ * Overlapping children are blended with each other first, like one image.
+ * @param obj pointer to an object
+ * @param en true: draw it through a layer
+ */
+void lv_obj_set_opa_layer(lv_obj_t * obj, bool en)
+{
+    if(obj->opa_layer == (en ? 1 : 0)) return;
+
+    if(!en) lv_refr_layer_free(obj);
+    obj->opa_layer = en ? 1 : 0;
+    lv_obj_invalidate(obj);
+}
+#endif
+
 /**
  * Set a bit or bits in the protect filed
  * @param obj pointer to an object
@@ -1449,6 +1799,9 @@ void lv_obj_set_design_cb(lv_obj_t * obj, lv_design_cb_t design_cb)
  */
 void * lv_obj_allocate_ext_attr(lv_obj_t * obj, uint16_t ext_size)
 {
+    /*The ext. data of the first used object types are allocated from pools too*/
+    lv_mem_pool_add(ext_size);
+
     obj->ext_attr = lv_mem_realloc(obj->ext_attr, ext_size);
 
     return (void *)obj->ext_attr;
@@ -1603,6 +1956,72 @@ uint16_t lv_obj_count_children_recursive(const lv_obj_t * obj)
     return cnt;
 }
 
+#if LV_USE_OBJ_CHILD_CACHE
+/**
+ * Get the children of an object as a contiguous array in `child_ll` order (the youngest first).
+ * The array is built on the first call and kept until a child is added, removed or reordered,
+ * so it must not be used after changing the children.
+ * @param obj pointer to an object
+ * @param cnt store the number of children here
+ * @return the array of children, NULL if `obj` has no children or the array couldn't be
+ *         allocated (walk `child_ll` instead)
+ */
+lv_obj_t ** lv_obj_get_child_array(lv_obj_t * obj, uint16_t * cnt)
+{
+    if(obj->child_cache_valid == 0) {
+        uint16_t n = lv_obj_count_children(obj);
+        if(n > 0) {
+            obj->child_cache = lv_mem_alloc(n * sizeof(lv_obj_t *));
+            if(obj->child_cache == NULL) {
+                *cnt = 0;
+                return NULL;
+            }
+
+            lv_obj_t * i;
+            uint16_t c = 0;
+            LV_LL_READ(obj->child_ll, i) obj->child_cache[c++] = i;
+        }
+        obj->child_cache_cnt   = n;
+        obj->child_cache_valid = 1;
+    }
+
+    *cnt = obj->child_cache_cnt;
+    return obj->child_cache;
+}
+
+#if LV_OBJ_HIT_GRID
+/**
+ * Get the children of an object that may be clicked at a point, as indexes into the array of
+ * `lv_obj_get_child_array` in its order. An object with at least `LV_OBJ_HIT_GRID` children keeps
+ * a grid of which children's clickable areas reach each of its cells, built on the first call and
+ * dropped when a child is added, removed, reordered, moved or resized.
+ * @param obj pointer to an object
+ * @param point pointer to the point
+ * @param cnt store the number of children here
+ * @return the indexes, NULL if `obj` has fewer children or the grid couldn't be allocated (test
+ *         every child instead)
+ */
+const uint16_t * lv_obj_get_child_hits(lv_obj_t * obj, const lv_point_t * point, uint16_t * cnt)
+{
+    if(obj->hit_grid == NULL) {
+        obj->hit_grid = hit_grid_build(obj);
+        if(obj->hit_grid == NULL) {
+            *cnt = 0;
+            return NULL;
+        }
+    }
+
+    lv_obj_hit_grid_t * grid = obj->hit_grid;
+    lv_coord_t cx = hit_grid_cell(point->x - obj->coords.x1, grid->cell_w, grid->cols);
+    lv_coord_t cy = hit_grid_cell(point->y - obj->coords.y1, grid->cell_h, grid->rows);
+    uint16_t i = cy * grid->cols + cx;
+
+    *cnt = grid->start[i + 1] - grid->start[i];
+    return &grid->idx[grid->start[i]];
+}
+#endif
+#endif
+
 /*---------------------
  * Coordinate get
  *--------------------*/
@@ -1614,6 +2033,9 @@ uint16_t lv_obj_count_children_recursive(const lv_obj_t * obj)
  */
 void lv_obj_get_coords(const lv_obj_t * obj, lv_area_t * cords_p)
 {
+#if LV_USE_OBJ_LAYOUT_DEFER
+    if(layout_later_cnt != 0) layout_settle(obj);
+#endif
     lv_area_copy(cords_p, &obj->coords);
 }
 
@@ -1642,6 +2064,9 @@ void lv_obj_get_inner_coords(const lv_obj_t * obj, lv_area_t * coords_p)
 lv_coord_t lv_obj_get_x(const lv_obj_t * obj)
 {
     lv_coord_t rel_x;
+#if LV_USE_OBJ_LAYOUT_DEFER
+    if(layout_later_cnt != 0) layout_settle(obj);
+#endif
     lv_obj_t * parent = lv_obj_get_parent(obj);
     rel_x             = obj->coords.x1 - parent->coords.x1;
 
@@ -1656,6 +2081,9 @@ lv_coord_t lv_obj_get_x(const lv_obj_t * obj)
 lv_coord_t lv_obj_get_y(const lv_obj_t * obj)
 {
     lv_coord_t rel_y;
+#if LV_USE_OBJ_LAYOUT_DEFER
+    if(layout_later_cnt != 0) layout_settle(obj);
+#endif
     lv_obj_t * parent = lv_obj_get_parent(obj);
     rel_y             = obj->coords.y1 - parent->coords.y1;
 
@@ -1669,6 +2097,9 @@ lv_coord_t lv_obj_get_y(const lv_obj_t * obj)
  */
 lv_coord_t lv_obj_get_width(const lv_obj_t * obj)
 {
+#if LV_USE_OBJ_LAYOUT_DEFER
+    if(layout_later_cnt != 0) layout_settle(obj);
+#endif
     return lv_area_get_width(&obj->coords);
 }
 
@@ -1679,6 +2110,9 @@ lv_coord_t lv_obj_get_width(const lv_obj_t * obj)
  */
 lv_coord_t lv_obj_get_height(const lv_obj_t * obj)
 {
+#if LV_USE_OBJ_LAYOUT_DEFER
+    if(layout_later_cnt != 0) layout_settle(obj);
+#endif
     return lv_area_get_height(&obj->coords);
 }
 
@@ -1958,6 +2392,18 @@ lv_opa_t lv_obj_get_opa_scale(const lv_obj_t * obj)
     return LV_OPA_COVER;
 }
 
+#if LV_USE_OBJ_LAYER
+/**
+ * Tell whether an object is drawn through a cached layer
+ * @param obj pointer to an object
+ * @return true: it's drawn through a layer when its opa scale is set
+ */
+bool lv_obj_get_opa_layer(const lv_obj_t * obj)
+{
+    return obj->opa_layer == 0 ? false : true;
+}
+#endif
+
 /**
  * Get the protect field of an object
  * @param obj pointer to an object
@@ -2256,6 +2702,132 @@ static void refresh_children_style(lv_obj_t * obj)
     }
 }
 
+/**
+ * Invalidate the area of an object now even if invalidations are deferred
+ * @param obj pointer to an object
+ */
+static void invalidate_now(const lv_obj_t * obj)
+{
+    lv_area_t area;
+    lv_coord_t ext_size = obj->ext_draw_pad;
+    lv_area_copy(&area, &obj->coords);
+    area.x1 -= ext_size;
+    area.y1 -= ext_size;
+    area.x2 += ext_size;
+    area.y2 += ext_size;
+
+    invalidate_area_now(obj, &area);
+}
+
+/**
+ * Invalidate an area of an object truncated to its parents, if it's shown
+ * @param obj pointer to an object
+ * @param area the area, within the object's drawing area
+ */
+static void invalidate_area_now(const lv_obj_t * obj, const lv_area_t * area)
+{
+    if(lv_obj_get_hidden(obj)) return;
+
+#if LV_USE_OBJ_LAYER
+    /*The layers the object is drawn in change, even if it's not on the screen, but not the
+     * layer of an object whose opa scale changed*/
+    lv_refr_layer_inv_obj(obj == layer_keep ? lv_obj_get_parent(obj) : obj);
+#endif
+
+    /*Invalidate the object only if it belongs to the 'LV_GC_ROOT(_lv_act_scr)'*/
+    lv_obj_t * obj_scr = lv_obj_get_screen(obj);
+    lv_disp_t * disp   = lv_obj_get_disp(obj_scr);
+    if(obj_scr == lv_disp_get_scr_act(disp) || obj_scr == lv_disp_get_layer_top(disp) ||
+       obj_scr == lv_disp_get_layer_sys(disp)) {
+        /*Truncate recursively to the parents*/
+        lv_area_t area_trunc;
+        lv_obj_t * par = lv_obj_get_parent(obj);
+        bool union_ok  = true;
+        lv_area_copy(&area_trunc, area);
+
+        /*Check through all parents*/
+        while(par != NULL) {
+            union_ok = lv_area_intersect(&area_trunc, &area_trunc, &par->coords);
+            if(union_ok == false) break;       /*If no common parts with parent break;*/
+            if(lv_obj_get_hidden(par)) return; /*If the parent is hidden then the child is hidden and won't be drawn*/
+
+            par = lv_obj_get_parent(par);
+        }
+
+#if LV_USE_OBJ_LAYER
+        if(union_ok) lv_inv_obj_area(disp, &area_trunc);
+#else
+        if(union_ok) lv_inv_area(disp, &area_trunc);
+#endif
+    }
+}
+
+#if LV_USE_OBJ_INV_DEFER
+/**
+ * Get the display showing a screen as its active screen or one of its layers
+ * @param scr pointer to a screen
+ * @return the display or NULL if the screen isn't shown
+ */
+static lv_disp_t * scr_shown_disp(const lv_obj_t * scr)
+{
+    lv_disp_t * d = lv_disp_get_next(NULL);
+    while(d) {
+        if(scr == d->act_scr || scr == d->top_layer || scr == d->sys_layer) return d;
+        d = lv_disp_get_next(d);
+    }
+
+    return NULL;
+}
+
+/**
+ * Forget the mark of a deleted object
+ * @param obj pointer to the object
+ */
+static void inv_later_drop(lv_obj_t * obj)
+{
+    uint16_t i;
+    for(i = 0; i < inv_later_cnt; i++) {
+        if(inv_later[i] == obj) {
+            inv_later_cnt--;
+            inv_later[i] = inv_later[inv_later_cnt];
+            return;
+        }
+    }
+}
+#endif
+
+#if LV_USE_OBJ_LAYOUT_DEFER
+/**
+ * Forget the mark of an object's layout
+ * @param obj pointer to a marked object
+ */
+static void layout_later_drop(lv_obj_t * obj)
+{
+    uint16_t i = layout_later_cnt;
+    obj->layout_later = 0;
+
+    /*Usually it's one of the last marked*/
+    while(i > 0) {
+        i--;
+        if(layout_later[i] == obj) {
+            layout_later_cnt--;
+            layout_later[i] = layout_later[layout_later_cnt];
+            return;
+        }
+    }
+}
+
+/**
+ * Refresh an object's marked fit so its size is read right. Its parent's layout is left for
+ * later, as refreshing it each time a child is set up would make building it O(N^2) again.
+ * @param obj pointer to an object
+ */
+static void layout_settle(const lv_obj_t * obj)
+{
+    lv_obj_layout_refresh((lv_obj_t *)obj);
+}
+#endif
+
 /**
  * Called by 'lv_obj_del' to delete the children objects
  * @param obj pointer to an object (all of its children will be deleted)
@@ -2317,15 +2889,168 @@ static void delete_children(lv_obj_t * obj)
     /*Remove the object from parent's children list*/
     lv_obj_t * par = lv_obj_get_parent(obj);
     lv_ll_rem(&(par->child_ll), obj);
+#if LV_USE_OBJ_CHILD_CACHE
+    child_cache_drop(par);
+#endif
 
     /* Clean up the object specific data*/
     obj->signal_cb(obj, LV_SIGNAL_CLEANUP, NULL);
 
     /*Delete the base objects*/
     if(obj->ext_attr != NULL) lv_mem_free(obj->ext_attr);
+#if LV_USE_OBJ_CHILD_CACHE
+    child_cache_drop(obj);
+#endif
+#if LV_USE_OBJ_INV_DEFER
+    if(obj->inv_later) inv_later_drop(obj);
+#endif
+#if LV_USE_OBJ_LAYOUT_DEFER
+    if(obj->layout_later) layout_later_drop(obj);
+#endif
+#if LV_USE_OBJ_LAYER
+    if(obj->opa_layer) lv_refr_layer_free(obj);
+#endif
     lv_mem_free(obj); /*Free the object itself*/
 }
 
+#if LV_USE_OBJ_CHILD_CACHE
+/**
+ * Free the child array of an object after its children changed
+ * @param obj pointer to an object
+ */
+static void child_cache_drop(lv_obj_t * obj)
+{
+    if(obj->child_cache != NULL) {
+        lv_mem_free(obj->child_cache);
+        obj->child_cache = NULL;
+    }
+    obj->child_cache_valid = 0;
+#if LV_OBJ_HIT_GRID
+    hit_grid_drop(obj);
+#endif
+}
+
+#if LV_OBJ_HIT_GRID
+/**
+ * Build the hit-test grid of an object's children
+ * @param obj pointer to an object
+ * @return the grid, NULL if `obj` has too few children or there wasn't the memory
+ */
+static lv_obj_hit_grid_t * hit_grid_build(lv_obj_t * obj)
+{
+    uint16_t n;
+    lv_obj_t ** child_a = lv_obj_get_child_array(obj, &n);
+    if(child_a == NULL || n < LV_OBJ_HIT_GRID) return NULL;
+
+    lv_obj_hit_grid_t shape;
+    uint32_t cnt[HIT_GRID_CELLS];
+    lv_area_t cells;
+    lv_coord_t x, y;
+    uint32_t total = 0;
+    uint16_t c;
+
+    /*Shape the cells like the average child, e.g. a column of rows for a list of full width
+     * buttons, so each child is in few cells*/
+    lv_coord_t w = lv_area_get_width(&obj->coords);
+    lv_coord_t h = lv_area_get_height(&obj->coords);
+    uint32_t child_w = 0;
+    for(c = 0; c < n; c++) child_w += lv_area_get_width(&child_a[c]->coords);
+    child_w = LV_MATH_MAX(child_w / n, 1);
+    shape.cols   = LV_MATH_MIN(LV_MATH_MAX(w / (int32_t)child_w, 1), HIT_GRID_CELLS);
+    shape.rows   = HIT_GRID_CELLS / shape.cols;
+    shape.cell_w = LV_MATH_MAX((w + shape.cols - 1) / shape.cols, 1);
+    shape.cell_h = LV_MATH_MAX((h + shape.rows - 1) / shape.rows, 1);
+
+    /*Count the children reaching each cell, then place them in child order*/
+    memset(cnt, 0, sizeof(cnt));
+    for(c = 0; c < n; c++) {
+        hit_grid_cells(obj, &shape, child_a[c], &cells);
+        for(y = cells.y1; y <= cells.y2; y++) {
+            for(x = cells.x1; x <= cells.x2; x++) cnt[y * shape.cols + x]++;
+        }
+        total += lv_area_get_size(&cells);
+    }
+
+    lv_obj_hit_grid_t * grid = lv_mem_alloc(sizeof(lv_obj_hit_grid_t) + total * sizeof(uint16_t));
+    if(grid == NULL) return NULL;
+
+    memcpy(grid, &shape, sizeof(lv_obj_hit_grid_t));
+    grid->start[0] = 0;
+    for(c = 0; c < HIT_GRID_CELLS; c++) {
+        grid->start[c + 1] = grid->start[c] + cnt[c];
+        cnt[c]             = grid->start[c];
+    }
+    for(c = 0; c < n; c++) {
+        hit_grid_cells(obj, grid, child_a[c], &cells);
+        for(y = cells.y1; y <= cells.y2; y++) {
+            for(x = cells.x1; x <= cells.x2; x++) grid->idx[cnt[y * grid->cols + x]++] = c;
+        }
+    }
+
+    return grid;
+}
+
+/**
+ * Get the cells of a hit-test grid a child's clickable area reaches
+ * @param obj pointer to the object the grid belongs to
+ * @param grid pointer to the grid, only its shape is used
+ * @param child pointer to a child of `obj`
+ * @param cells store the first and last column and row here
+ */
+static void hit_grid_cells(const lv_obj_t * obj, const lv_obj_hit_grid_t * grid, const lv_obj_t * child,
+                           lv_area_t * cells)
+{
+    lv_area_t area;
+
+#if LV_USE_EXT_CLICK_AREA == LV_EXT_CLICK_AREA_TINY
+    area.x1 = child->coords.x1 - child->ext_click_pad_hor;
+    area.x2 = child->coords.x2 + child->ext_click_pad_hor;
+    area.y1 = child->coords.y1 - child->ext_click_pad_ver;
+    area.y2 = child->coords.y2 + child->ext_click_pad_ver;
+#elif LV_USE_EXT_CLICK_AREA == LV_EXT_CLICK_AREA_FULL
+    area.x1 = child->coords.x1 - child->ext_click_pad.x1;
+    area.x2 = child->coords.x2 + child->ext_click_pad.x2;
+    area.y1 = child->coords.y1 - child->ext_click_pad.y1;
+    area.y2 = child->coords.y2 + child->ext_click_pad.y2;
+#else
+    lv_area_copy(&area, &child->coords);
+#endif
+
+    /*Areas past the edges are in the cells at the edges, where points past them are looked up*/
+    cells->x1 = hit_grid_cell(area.x1 - obj->coords.x1, grid->cell_w, grid->cols);
+    cells->x2 = hit_grid_cell(area.x2 - obj->coords.x1, grid->cell_w, grid->cols);
+    cells->y1 = hit_grid_cell(area.y1 - obj->coords.y1, grid->cell_h, grid->rows);
+    cells->y2 = hit_grid_cell(area.y2 - obj->coords.y1, grid->cell_h, grid->rows);
+}
+
+/**
+ * Get the column or row of a hit-test grid a distance from its object's top left corner is in
+ * @param d the distance
+ * @param cell width or height of a cell
+ * @param num number of columns or rows
+ * @return the column or row, limited to the grid
+ */
+static lv_coord_t hit_grid_cell(lv_coord_t d, lv_coord_t cell, uint8_t num)
+{
+    if(d < 0) return 0;
+    d = d / cell;
+    return d >= num ? num - 1 : d;
+}
+
+/**
+ * Free the hit-test grid of an object after a child moved or its children changed
+ * @param obj pointer to an object
+ */
+static void hit_grid_drop(lv_obj_t * obj)
+{
+    if(obj->hit_grid != NULL) {
+        lv_mem_free(obj->hit_grid);
+        obj->hit_grid = NULL;
+    }
+}
+#endif
+#endif
+
 static void lv_event_mark_deleted(lv_obj_t * obj)
 {
     lv_event_temp_data_t * t = event_temp_data_head;
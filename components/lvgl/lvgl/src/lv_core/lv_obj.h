@@ -114,6 +114,8 @@ enum {
     LV_SIGNAL_STYLE_CHG, /**< Object's style has changed */
     LV_SIGNAL_REFR_EXT_DRAW_PAD, /**< Object's extra padding has changed */
     LV_SIGNAL_GET_TYPE, /**< LittlevGL needs to retrieve the object's type */
+    LV_SIGNAL_CHILD_MOVE, /**< A child is about to move, `param` is an ::lv_child_move_t */
+    LV_SIGNAL_REFR_LAYOUT, /**< Refresh the layout marked by `lv_obj_layout_later` */
 
     /*Input device related*/
     LV_SIGNAL_PRESSED,           /**< The object has been pressed*/
@@ -134,6 +136,15 @@ typedef uint8_t lv_signal_t;
 
 typedef lv_res_t (*lv_signal_cb_t)(struct _lv_obj_t * obj, lv_signal_t sign, void * param);
 
+/** Parameter of `LV_SIGNAL_CHILD_MOVE`. A parent which moves the child's pixels already on the
+ * display sets `copied` and invalidates what that leaves out of date itself, e.g. a page scrolling. */
+typedef struct
+{
+    struct _lv_obj_t * child; /**< The child about to move*/
+    lv_point_t diff;          /**< Its movement*/
+    bool copied;              /**< true: the parent moved the pixels, the child needs no invalidation*/
+} lv_child_move_t;
+
 /** Object alignment. */
 enum {
     LV_ALIGN_CENTER = 0,
@@ -185,6 +196,13 @@ typedef struct _lv_obj_t
 {
     struct _lv_obj_t * par; /**< Pointer to the parent object*/
     lv_ll_t child_ll;       /**< Linked list to store the children objects*/
+#if LV_USE_OBJ_CHILD_CACHE
+    struct _lv_obj_t ** child_cache; /**< The children in `child_ll` order, valid if `child_cache_valid`*/
+    uint16_t child_cache_cnt;        /**< Number of children in `child_cache`*/
+#if LV_OBJ_HIT_GRID
+    struct _lv_obj_hit_grid_t * hit_grid; /**< Children clickable in each cell, NULL if not built*/
+#endif
+#endif
 
     lv_area_t coords; /**< Coordinates of the object (x1, y1, x2, y2)*/
 
@@ -218,7 +236,11 @@ typedef struct _lv_obj_t
     uint8_t opa_scale_en : 1;   /**< 1: opa_scale is set*/
     uint8_t parent_event : 1;   /**< 1: Send the object's events to the parent too. */
     lv_drag_dir_t drag_dir : 2; /**<  Which directions the object can be dragged in */
-    uint8_t reserved : 6;       /**<  Reserved for future use*/
+    uint8_t child_cache_valid : 1; /**< 1: `child_cache` matches `child_ll`*/
+    uint8_t inv_later : 1;      /**< 1: Marked by a deferred `lv_obj_invalidate`*/
+    uint8_t layout_later : 1;   /**< 1: Marked by `lv_obj_layout_later`*/
+    uint8_t opa_layer : 1;      /**< 1: Drawn with its children through a cached layer when its opa scale is set*/
+    uint8_t reserved : 2;       /**<  Reserved for future use*/
     uint8_t protect;            /**< Automatically happening actions can be prevented. 'OR'ed values from
                                    `lv_protect_t`*/
     lv_opa_t opa_scale;         /**< Scale down the opacity by this factor. Effects all children as well*/
@@ -233,6 +255,12 @@ typedef struct _lv_obj_t
     lv_obj_user_data_t user_data; /**< Custom user data for object. */
 #endif
 
+#if LV_USE_REFR_PROF
+    uint32_t prof_main;         /**< `LV_REFR_PROF_TIME_EXPR` units spent in the main design phase*/
+    uint32_t prof_post;         /**< `LV_REFR_PROF_TIME_EXPR` units spent in the post design phase*/
+    uint32_t prof_calls;        /**< Times the object was drawn*/
+#endif
+
 } lv_obj_t;
 
 /*Protect some attributes (max. 8 bit)*/
@@ -305,6 +333,87 @@ void lv_obj_clean(lv_obj_t * obj);
  */
 void lv_obj_invalidate(const lv_obj_t * obj);
 
+/**
+ * Mark a part of an object invalid so only it is redrawn. It isn't deferred by `lv_obj_set_inv_defer`.
+ * @param obj pointer to an object
+ * @param area the part to redraw, in absolute coordinates. It's truncated to the object and its parents.
+ */
+void lv_obj_invalidate_area(const lv_obj_t * obj, const lv_area_t * area);
+
+#if LV_USE_OBJ_INV_DEFER
+/**
+ * Enable or disable deferred invalidation. While it's enabled `lv_obj_invalidate` only marks the
+ * object and its area is invalidated when its display is refreshed, once however many times it was
+ * marked and not at all if one of its parents is marked too. The old area of a moved, resized,
+ * restyled, hidden or deleted object is still invalidated at once.
+ * @param en true: defer the invalidations
+ */
+void lv_obj_set_inv_defer(bool en);
+
+/**
+ * Tell whether deferred invalidation is enabled
+ * @return true: `lv_obj_invalidate` only marks the objects
+ */
+bool lv_obj_get_inv_defer(void);
+
+/**
+ * Get the number of objects marked by deferred invalidations and not yet resolved
+ * @return number of marked objects
+ */
+uint16_t lv_obj_get_inv_later_cnt(void);
+
+/**
+ * Invalidate the areas of the marked objects shown on a display. Called when it's refreshed.
+ * @param disp pointer to a display
+ */
+void lv_obj_inv_resolve(lv_disp_t * disp);
+#endif
+
+#if LV_USE_OBJ_LAYOUT_DEFER
+/**
+ * Enable or disable deferred layouts. While it's enabled the layouts and fits of containers are
+ * only marked when their children, size or style change and refreshed once before the next display
+ * refresh, so building a container of N children takes O(N) rather than O(N^2) time. Reading an
+ * object's coordinates or size refreshes its own fit first, but positions set by its parent's layout
+ * are only applied then or by `lv_obj_layout_resolve`. Disabling refreshes the marked ones.
+ * @param en true: defer the layouts
+ */
+void lv_obj_set_layout_defer(bool en);
+
+/**
+ * Tell whether deferred layouts are enabled
+ * @return true: containers' layouts are only marked
+ */
+bool lv_obj_get_layout_defer(void);
+
+/**
+ * Mark an object's layout to be refreshed later with an `LV_SIGNAL_REFR_LAYOUT` signal. Used by
+ * objects arranging their children.
+ * @param obj pointer to an object
+ * @return true: marked (or already marked); false: layouts aren't deferred or it couldn't be
+ * remembered, so refresh it now
+ */
+bool lv_obj_layout_later(lv_obj_t * obj);
+
+/**
+ * Refresh the layout of an object now if it's marked
+ * @param obj pointer to an object
+ */
+void lv_obj_layout_refresh(lv_obj_t * obj);
+
+/**
+ * Get the number of objects whose layouts are marked and not yet refreshed
+ * @return number of marked objects
+ */
+uint16_t lv_obj_get_layout_later_cnt(void);
+
+/**
+ * Refresh every marked layout, including those marked again meanwhile. Called before each display
+ * refresh; call it to use the final coordinates of objects read directly from `coords`.
+ */
+void lv_obj_layout_resolve(void);
+#endif
+
 /*=====================
  * Setter functions
  *====================*/
@@ -527,6 +636,18 @@ void lv_obj_set_opa_scale_enable(lv_obj_t * obj, bool en);
  */
 void lv_obj_set_opa_scale(lv_obj_t * obj, lv_opa_t opa_scale);
 
+#if LV_USE_OBJ_LAYER
+/**
+ * Draw an object and its children into a cached layer at full opacity and blend the layer with the
+ * object's opa scale in one pass while it's less than `LV_OPA_COVER`. The layer is drawn again only
+ * when something in it is invalidated, so changing the opa scale costs one blend of the layer.
+ * Overlapping children are blended with each other first, like one image.
+ * @param obj pointer to an object
+ * @param en true: draw it through a layer
+ */
+void lv_obj_set_opa_layer(lv_obj_t * obj, bool en);
+#endif
+
 /**
  * Set a bit or bits in the protect filed
  * @param obj pointer to an object
@@ -676,6 +797,34 @@ uint16_t lv_obj_count_children(const lv_obj_t * obj);
  */
 uint16_t lv_obj_count_children_recursive(const lv_obj_t * obj);
 
+#if LV_USE_OBJ_CHILD_CACHE
+/**
+ * Get the children of an object as a contiguous array in `child_ll` order (the youngest first).
+ * The array is built on the first call and kept until a child is added, removed or reordered,
+ * so it must not be used after changing the children.
+ * @param obj pointer to an object
+ * @param cnt store the number of children here
+ * @return the array of children, NULL if `obj` has no children or the array couldn't be
+ *         allocated (walk `child_ll` instead)
+ */
+lv_obj_t ** lv_obj_get_child_array(lv_obj_t * obj, uint16_t * cnt);
+
+#if LV_OBJ_HIT_GRID
+/**
+ * Get the children of an object that may be clicked at a point, as indexes into the array of
+ * `lv_obj_get_child_array` in its order. An object with at least `LV_OBJ_HIT_GRID` children keeps
+ * a grid of which children's clickable areas reach each of its cells, built on the first call and
+ * dropped when a child is added, removed, reordered, moved or resized.
+ * @param obj pointer to an object
+ * @param point pointer to the point
+ * @param cnt store the number of children here
+ * @return the indexes, NULL if `obj` has fewer children or the grid couldn't be allocated (test
+ *         every child instead)
+ */
+const uint16_t * lv_obj_get_child_hits(lv_obj_t * obj, const lv_point_t * point, uint16_t * cnt);
+#endif
+#endif
+
 /*---------------------
  * Coordinate get
  *--------------------*/
@@ -863,6 +1012,15 @@ lv_opa_t lv_obj_get_opa_scale_enable(const lv_obj_t * obj);
  */
 lv_opa_t lv_obj_get_opa_scale(const lv_obj_t * obj);
 
+#if LV_USE_OBJ_LAYER
+/**
+ * Tell whether an object is drawn through a cached layer
+ * @param obj pointer to an object
+ * @return true: it's drawn through a layer when its opa scale is set
+ */
+bool lv_obj_get_opa_layer(const lv_obj_t * obj);
+#endif
+
 /**
  * Get the protect field of an object
  * @param obj pointer to an object
@@ -7,12 +7,14 @@
  *      INCLUDES
  *********************/
 #include <stddef.h>
+#include <string.h>
 #include "lv_refr.h"
 #include "lv_disp.h"
 #include "../lv_hal/lv_hal_tick.h"
 #include "../lv_hal/lv_hal_disp.h"
 #include "../lv_misc/lv_task.h"
 #include "../lv_misc/lv_mem.h"
+#include "../lv_misc/lv_math.h"
 #include "../lv_misc/lv_gc.h"
 #include "../lv_draw/lv_draw.h"
 
@@ -20,33 +22,130 @@
 #include LV_GC_INCLUDE
 #endif /* LV_ENABLE_GC */
 
+#if LV_USE_REFR_PROF
+#include LV_REFR_PROF_INCLUDE
+#endif
+
 /*********************
  *      DEFINES
  *********************/
 /* Draw translucent random colored areas on the invalidated (redrawn) areas*/
 #define MASK_AREA_DEBUG 0
 
+/*Most parts an object is drawn in when the objects drawn over it cover some of it*/
+#define LV_REFR_OCCL_PARTS 4
+
+#if LV_USE_OBJ_LAYER
+#if LV_IMG_CACHE_CUSTOM
+#include LV_IMG_CACHE_CUSTOM_INCLUDE
+#define LAYER_ALLOC(size) LV_IMG_CACHE_CUSTOM_ALLOC(size)
+#define LAYER_FREE(p) LV_IMG_CACHE_CUSTOM_FREE(p)
+#else
+#define LAYER_ALLOC(size) lv_mem_alloc(size)
+#define LAYER_FREE(p) lv_mem_free(p)
+#endif
+#endif
+
 /**********************
  *      TYPEDEFS
  **********************/
+#if LV_USE_REFR_PROF
+/*Types are told apart by their signal function, drawing is shared more often*/
+typedef struct
+{
+    lv_signal_cb_t signal_cb;
+    lv_refr_prof_t prof;
+} lv_refr_prof_type_t;
+#endif
+
+#if LV_REFR_OCCLUDERS
+/*An opaque object drawn later than the object being drawn and the part of it surely covered*/
+typedef struct
+{
+    lv_obj_t * obj;
+    lv_area_t area;
+} lv_refr_occl_t;
+#endif
+
+#if LV_USE_OBJ_LAYER
+/*The cached layer of an object: the object and its children drawn into an image with alpha channel*/
+typedef struct
+{
+    const lv_obj_t * obj;
+    uint8_t * data;   /*`LV_IMG_CF_TRUE_COLOR_ALPHA` pixels*/
+    lv_area_t area;   /*The area of the screen drawn into the layer*/
+    uint8_t valid : 1; /*0: draw the layer again before it's used*/
+} lv_refr_layer_t;
+#endif
 
 /**********************
  *  STATIC PROTOTYPES
  **********************/
+static void lv_refr_save_area(lv_disp_t * disp, const lv_area_t * area_p);
+static void lv_refr_add_prev(void);
 static void lv_refr_join_area(void);
+static void lv_refr_rank_areas(void);
 static void lv_refr_areas(void);
+static void lv_refr_keep_rest(void);
 static void lv_refr_area(const lv_area_t * area_p);
 static void lv_refr_area_part(const lv_area_t * area_p);
 static lv_obj_t * lv_refr_get_top_obj(const lv_area_t * area_p, lv_obj_t * obj);
 static void lv_refr_obj_and_children(lv_obj_t * top_p, const lv_area_t * mask_p);
 static void lv_refr_obj(lv_obj_t * obj, const lv_area_t * mask_ori_p);
+static void lv_refr_child(lv_obj_t * child_p, const lv_area_t * obj_mask_p);
 static void lv_refr_vdb_flush(void);
+static void lv_refr_wait_flush(void);
+#if LV_REFR_OCCLUDERS
+static void lv_refr_occl_push_children(lv_obj_t * obj, const lv_area_t * obj_mask_p);
+static void lv_refr_occl_push_levels(lv_obj_t * obj, const lv_area_t * mask_p, lv_area_t * obj_mask_p);
+static void lv_refr_occl_push(lv_obj_t * obj, const lv_area_t * mask_p);
+static void lv_refr_occl_pop(lv_obj_t * obj);
+static bool lv_refr_occl_clip(lv_area_t * area_p);
+static uint8_t lv_refr_occl_split(const lv_area_t * area_p, lv_area_t * parts);
+#endif
+static void lv_inv_area_core(lv_disp_t * disp, const lv_area_t * area_p);
+#if LV_USE_OBJ_LAYER
+static bool lv_refr_layer_draw(lv_obj_t * obj, const lv_area_t * mask_p);
+static bool lv_refr_layer_render(lv_refr_layer_t * layer, lv_obj_t * obj, const lv_area_t * area);
+static lv_refr_layer_t * lv_refr_layer_find(const lv_obj_t * obj);
+static void lv_refr_layer_set_px(lv_disp_drv_t * disp_drv, uint8_t * buf, lv_coord_t buf_w, lv_coord_t x,
+                                 lv_coord_t y, lv_color_t color, lv_opa_t opa);
+#endif
+#if LV_USE_REFR_PROF
+static void lv_refr_prof_add(lv_obj_t * obj, uint32_t main, uint32_t post);
+static uint16_t lv_refr_prof_insert(lv_refr_prof_t * buf, uint16_t cnt, uint16_t max, const lv_refr_prof_t * p);
+static void lv_refr_prof_walk(lv_obj_t * obj, lv_refr_prof_t * buf, uint16_t * cnt, uint16_t max);
+#endif
 
 /**********************
  *  STATIC VARIABLES
  **********************/
 static uint32_t px_num;
 static lv_disp_t * disp_refr; /*Display being refreshed*/
+static uint32_t refr_start;
+static bool refr_no_yield;    /*Set while `lv_refr_now` refreshes*/
+static bool refr_more;        /*Set while drawing a part which isn't the last of the refresh*/
+static bool refr_yield;       /*Set when the driver ended the refresh early*/
+static uint16_t refr_yield_at; /*The area the refresh ended in*/
+static lv_area_t refr_rest;    /*The part of that area not drawn*/
+static bool refr_rest_valid;
+static lv_area_t inv_new[LV_INV_BUF_SIZE]; /*The areas invalidated for this refresh, before the last one's are added*/
+static uint16_t inv_new_p;
+#if LV_REFR_OCCLUDERS
+static lv_refr_occl_t occl_stack[LV_REFR_OCCLUDERS]; /*The next one drawn is on the top*/
+static uint16_t occl_cnt;
+static uint16_t occl_floor; /*The occluders below it are drawn over a layer being drawn, not in it*/
+#endif
+#if LV_USE_OBJ_LAYER
+static lv_refr_layer_t * layers;
+static uint16_t layer_cnt;
+static uint16_t layer_size;
+static const lv_obj_t * layer_obj; /*The object being drawn into its layer*/
+#endif
+#if LV_USE_REFR_PROF
+static lv_refr_prof_type_t prof_types[LV_REFR_PROF_TYPES + 1]; /*The last one is "other"*/
+static uint16_t prof_type_cnt;
+#endif
 
 /**********************
  *      MACROS
@@ -73,6 +172,7 @@ void lv_refr_init(void)
  */
 void lv_refr_now(lv_disp_t * disp)
 {
+    refr_no_yield = true;
     if(disp) {
         lv_disp_refr_task(disp->refr_task);
     } else {
@@ -83,6 +183,7 @@ void lv_refr_now(lv_disp_t * disp)
             d = lv_disp_get_next(d);
         }
     }
+    refr_no_yield = false;
 }
 
 /**
@@ -93,45 +194,132 @@ void lv_refr_now(lv_disp_t * disp)
  */
 void lv_inv_area(lv_disp_t * disp, const lv_area_t * area_p)
 {
-    if(!disp) disp = lv_disp_get_default();
-    if(!disp) return;
+#if LV_USE_OBJ_LAYER
+    /*Whatever is drawn in the area, the layers over it might show it*/
+    if(area_p != NULL) {
+        uint16_t i;
+        for(i = 0; i < layer_cnt; i++) {
+            if(lv_area_is_on(&layers[i].area, area_p)) layers[i].valid = 0;
+        }
+    }
+#endif
 
-    /*Clear the invalidate buffer if the parameter is NULL*/
-    if(area_p == NULL) {
-        disp->inv_p = 0;
-        return;
+    lv_inv_area_core(disp, area_p);
+}
+
+#if LV_USE_OBJ_LAYER
+/**
+ * Invalidate the area of an object on display to redraw it.
+ * Unlike `lv_inv_area` the cached layers over the area are kept: only the layers the object is
+ * drawn in change, see `lv_refr_layer_inv_obj`.
+ * @param disp pointer to display where the area should be invalidated (NULL: the default display)
+ * @param area_p pointer to area which should be invalidated (NULL: delete the invalidated areas)
+ */
+void lv_inv_obj_area(lv_disp_t * disp, const lv_area_t * area_p)
+{
+    lv_inv_area_core(disp, area_p);
+}
+
+/**
+ * Mark the cached layers an object is drawn in to be drawn again: its own and its parents'
+ * @param obj pointer to an object (NULL: do nothing)
+ */
+void lv_refr_layer_inv_obj(const lv_obj_t * obj)
+{
+    if(layer_cnt == 0) return;
+
+    while(obj != NULL) {
+        if(obj->opa_layer) {
+            lv_refr_layer_t * layer = lv_refr_layer_find(obj);
+            if(layer) layer->valid = 0;
+        }
+        obj = lv_obj_get_parent(obj);
+    }
+}
+
+/**
+ * Free the cached layer of an object if it has one
+ * @param obj pointer to an object
+ */
+void lv_refr_layer_free(const lv_obj_t * obj)
+{
+    lv_refr_layer_t * layer = lv_refr_layer_find(obj);
+    if(layer == NULL) return;
+
+    if(layer->data) LAYER_FREE(layer->data);
+    layer_cnt--;
+    *layer = layers[layer_cnt];
+
+    if(layer_cnt == 0) {
+        lv_mem_free(layers);
+        layers     = NULL;
+        layer_size = 0;
     }
+}
+#endif
 
+/**
+ * Move the pixels already on a display inside an area instead of redrawing them, e.g. when
+ * scrolling. Only the strips left exposed and the invalidated areas moved along are redrawn.
+ * @param disp pointer to a display (NULL to use the default display)
+ * @param area_p pointer to the area whose content moves. Nothing else may be drawn over it.
+ * @param dx horizontal movement
+ * @param dy vertical movement
+ * @return true: the pixels are moved; false: the driver can't move them, invalidate `area_p`
+ * instead
+ */
+bool lv_refr_copy_area(lv_disp_t * disp, const lv_area_t * area_p, lv_coord_t dx, lv_coord_t dy)
+{
+    if(!disp) disp = lv_disp_get_default();
+    if(!disp) return false;
+
+    /*A true double buffer would have to be moved too*/
+    if(disp->driver.copy_cb == NULL || lv_disp_is_true_double_buf(disp)) return false;
+
+    /*Nothing would be left to move*/
+    if(LV_MATH_ABS(dx) >= lv_area_get_width(area_p) || LV_MATH_ABS(dy) >= lv_area_get_height(area_p)) return false;
+
+    /*The area must be on the screen as the display only holds those pixels*/
     lv_area_t scr_area;
     scr_area.x1 = 0;
     scr_area.y1 = 0;
     scr_area.x2 = lv_disp_get_hor_res(disp) - 1;
     scr_area.y2 = lv_disp_get_ver_res(disp) - 1;
+    if(lv_area_is_in(area_p, &scr_area) == false) return false;
+
+    /*What is still to be redrawn in the area is out of date where it lands too*/
+    lv_area_t a;
+    uint16_t inv_p = disp->inv_p;
+    uint16_t i;
+    for(i = 0; i < inv_p; i++) {
+        if(lv_area_intersect(&a, &disp->inv_areas[i], area_p) == false) continue;
+        a.x1 += dx;
+        a.y1 += dy;
+        a.x2 += dx;
+        a.y2 += dy;
+        if(lv_area_intersect(&a, &a, area_p)) lv_inv_area(disp, &a);
+    }
 
-    lv_area_t com_area;
-    bool suc;
-
-    suc = lv_area_intersect(&com_area, area_p, &scr_area);
+    disp->driver.copy_cb(&disp->driver, area_p, dx, dy);
 
-    /*The area is truncated to the screen*/
-    if(suc != false) {
-        if(disp->driver.rounder_cb) disp->driver.rounder_cb(&disp_refr->driver, &com_area);
+    /*Invalidate the strips the movement exposed*/
+    if(dx != 0) {
+        lv_area_copy(&a, area_p);
+        if(dx > 0) a.x2 = a.x1 + dx - 1;
+        else a.x1 = a.x2 + dx + 1;
+        lv_inv_area(disp, &a);
+    }
+    if(dy != 0) {
+        lv_area_copy(&a, area_p);
+        if(dy > 0) a.y2 = a.y1 + dy - 1;
+        else a.y1 = a.y2 + dy + 1;
+        lv_inv_area(disp, &a);
+    }
 
-        /*Save only if this area is not in one of the saved areas*/
-        uint16_t i;
-        for(i = 0; i < disp->inv_p; i++) {
-            if(lv_area_is_in(&com_area, &disp->inv_areas[i]) != false) return;
-        }
+    /*The pixels stay moved even if the move is undone, e.g. by a drag which didn't move*/
+    disp->inv_kept = disp->inv_p;
 
-        /*Save the area*/
-        if(disp->inv_p < LV_INV_BUF_SIZE) {
-            lv_area_copy(&disp->inv_areas[disp->inv_p], &com_area);
-        } else { /*If no place for the area add the screen*/
-            disp->inv_p = 0;
-            lv_area_copy(&disp->inv_areas[disp->inv_p], &scr_area);
-        }
-        disp->inv_p++;
-    }
+    return true;
 }
 
 /**
@@ -154,6 +342,20 @@ void lv_refr_set_disp_refreshing(lv_disp_t * disp)
     disp_refr = disp;
 }
 
+/**
+ * Join the invalidated areas of a display the way a refresh does.
+ * Exposed to benchmark the joining; the areas are still refreshed by the next refresh.
+ * @param disp the display whose areas to join
+ */
+void lv_refr_join_areas(lv_disp_t * disp)
+{
+    lv_disp_t * disp_prev = disp_refr;
+
+    disp_refr = disp;
+    lv_refr_join_area();
+    disp_refr = disp_prev;
+}
+
 /**
  * Called periodically to handle the refreshing
  * @param task pointer to the task itself
@@ -164,57 +366,68 @@ void lv_disp_refr_task(lv_task_t * task)
 
     uint32_t start = lv_tick_get();
 
-    disp_refr = task->user_data;
+    disp_refr  = task->user_data;
+    refr_start = start;
+
+#if LV_USE_OBJ_LAYOUT_DEFER
+    /*Lay out the containers marked since the last refresh, which invalidates what they move*/
+    if(lv_obj_get_layout_later_cnt() != 0) lv_obj_layout_resolve();
+#endif
+
+#if LV_USE_OBJ_INV_DEFER
+    /*Invalidate the objects marked since the last refresh*/
+    if(lv_obj_get_inv_later_cnt() != 0) lv_obj_inv_resolve(disp_refr);
+#endif
+
+    if(disp_refr->inv_p != 0 && disp_refr->driver.trace_cb) {
+        disp_refr->driver.trace_cb(&disp_refr->driver, LV_DISP_TRACE_REFR_START, NULL);
+    }
+
+    /* In true double buffered mode the buffer drawn into missed what the last refresh drew into
+     * the other one. Draw those areas again with the new ones instead of copying them over, once
+     * the display has let go of the buffer.*/
+    bool true_double = lv_disp_is_true_double_buf(disp_refr);
+    if(true_double && disp_refr->inv_p != 0) {
+        lv_refr_add_prev();
+        lv_refr_wait_flush();
+    }
 
     lv_refr_join_area();
 
+    if(disp_refr->driver.rank_cb) lv_refr_rank_areas();
+
     lv_refr_areas();
 
     /*If refresh happened ...*/
     if(disp_refr->inv_p != 0) {
-        /*In true double buffered mode copy the refreshed areas to the new VDB to keep it up to
-         * date*/
-        if(lv_disp_is_true_double_buf(disp_refr)) {
-            lv_disp_buf_t * vdb = lv_disp_get_buf(disp_refr);
+        /*In true double buffered mode leave the new areas for the other buffer, where the flush
+         * can see which of the areas drawn the display hasn't got, and flush the whole buffer once*/
+        if(true_double) {
+            memcpy(disp_refr->inv_prev, inv_new, inv_new_p * sizeof(lv_area_t));
+            disp_refr->inv_prev_p = inv_new_p;
 
-            /*Flush the content of the VDB*/
             lv_refr_vdb_flush();
+        }
 
-            /* With true double buffering the flushing should be only the address change of the
-             * current frame buffer. Wait until the address change is ready and copy the changed
-             * content to the other frame buffer (new active VDB) to keep the buffers synchronized*/
-            while(vdb->flushing)
-                ;
-
-            uint8_t * buf_act = (uint8_t *)vdb->buf_act;
-            uint8_t * buf_ina = (uint8_t *)vdb->buf_act == vdb->buf1 ? vdb->buf2 : vdb->buf1;
-
-            lv_coord_t hres = lv_disp_get_hor_res(disp_refr);
-            uint16_t a;
-            for(a = 0; a < disp_refr->inv_p; a++) {
-                if(disp_refr->inv_area_joined[a] == 0) {
-                    lv_coord_t y;
-                    uint32_t start_offs =
-                        (hres * disp_refr->inv_areas[a].y1 + disp_refr->inv_areas[a].x1) * sizeof(lv_color_t);
-                    uint32_t line_length = lv_area_get_width(&disp_refr->inv_areas[a]) * sizeof(lv_color_t);
-
-                    for(y = disp_refr->inv_areas[a].y1; y <= disp_refr->inv_areas[a].y2; y++) {
-                        memcpy(buf_act + start_offs, buf_ina + start_offs, line_length);
-                        start_offs += hres * sizeof(lv_color_t);
-                    }
-                }
-            }
-        } /*End of true double buffer handling*/
-
-        /*Clean up*/
-        memset(disp_refr->inv_areas, 0, sizeof(disp_refr->inv_areas));
-        memset(disp_refr->inv_area_joined, 0, sizeof(disp_refr->inv_area_joined));
-        disp_refr->inv_p = 0;
+        /*Clean up, keeping what the driver left to draw and refreshing it as soon as possible*/
+        if(refr_yield) {
+            lv_refr_keep_rest();
+            lv_task_ready(task);
+        } else {
+            memset(disp_refr->inv_areas, 0, sizeof(disp_refr->inv_areas));
+            memset(disp_refr->inv_area_joined, 0, sizeof(disp_refr->inv_area_joined));
+            disp_refr->inv_p = 0;
+        }
+        disp_refr->inv_kept = 0;
 
         /*Call monitor cb if present*/
         if(disp_refr->driver.monitor_cb) {
             disp_refr->driver.monitor_cb(&disp_refr->driver, lv_tick_elaps(start), px_num);
         }
+
+        if(disp_refr->driver.trace_cb) {
+            disp_refr->driver.trace_cb(&disp_refr->driver, LV_DISP_TRACE_REFR_END, NULL);
+        }
     }
 
     lv_draw_free_buf();
@@ -222,10 +435,174 @@ void lv_disp_refr_task(lv_task_t * task)
     LV_LOG_TRACE("lv_refr_task: ready");
 }
 
+#if LV_USE_REFR_PROF
+/**
+ * Get the objects on all displays which took longest to draw since the last reset
+ * @param buf the objects are stored here, longest first
+ * @param max size of `buf`
+ * @return number of objects stored
+ */
+uint16_t lv_refr_prof_get_objs(lv_refr_prof_t * buf, uint16_t max)
+{
+    uint16_t cnt = 0;
+    uint16_t i;
+    lv_disp_t * d;
+    lv_obj_t * scr;
+
+    LV_LL_READ(LV_GC_ROOT(_lv_disp_ll), d)
+    {
+        LV_LL_READ(d->scr_ll, scr)
+        {
+            lv_refr_prof_walk(scr, buf, &cnt, max);
+        }
+        lv_refr_prof_walk(d->top_layer, buf, &cnt, max);
+        lv_refr_prof_walk(d->sys_layer, buf, &cnt, max);
+    }
+
+    for(i = 0; i < cnt; i++) {
+        lv_obj_type_t type;
+        lv_obj_get_type(buf[i].obj, &type);
+        buf[i].type = type.type[0] != NULL ? type.type[0] : "unknown";
+    }
+
+    return cnt;
+}
+
+/**
+ * Get the draw times of the object types drawn since the last reset
+ * @param buf the types are stored here, longest first
+ * @param max size of `buf`
+ * @return number of types stored
+ */
+uint16_t lv_refr_prof_get_types(lv_refr_prof_t * buf, uint16_t max)
+{
+    uint16_t cnt = 0;
+    uint16_t i;
+
+    for(i = 0; i < prof_type_cnt; i++) {
+        cnt = lv_refr_prof_insert(buf, cnt, max, &prof_types[i].prof);
+    }
+    if(prof_types[LV_REFR_PROF_TYPES].prof.calls > 0) {
+        cnt = lv_refr_prof_insert(buf, cnt, max, &prof_types[LV_REFR_PROF_TYPES].prof);
+    }
+
+    return cnt;
+}
+
+/**
+ * Clear the draw times of all objects and types
+ */
+void lv_refr_prof_reset(void)
+{
+    lv_disp_t * d;
+    lv_obj_t * scr;
+
+    LV_LL_READ(LV_GC_ROOT(_lv_disp_ll), d)
+    {
+        LV_LL_READ(d->scr_ll, scr)
+        {
+            lv_refr_prof_walk(scr, NULL, NULL, 0);
+        }
+        lv_refr_prof_walk(d->top_layer, NULL, NULL, 0);
+        lv_refr_prof_walk(d->sys_layer, NULL, NULL, 0);
+    }
+
+    memset(prof_types, 0, sizeof(prof_types));
+    prof_type_cnt = 0;
+}
+#endif
+
 /**********************
  *   STATIC FUNCTIONS
  **********************/
 
+/**
+ * Invalidate an area on display to redraw it (`lv_inv_area` without the layers)
+ * @param disp pointer to display where the area should be invalidated (NULL: the default display)
+ * @param area_p pointer to area which should be invalidated (NULL: delete the invalidated areas)
+ */
+static void lv_inv_area_core(lv_disp_t * disp, const lv_area_t * area_p)
+{
+    if(!disp) disp = lv_disp_get_default();
+    if(!disp) return;
+
+    /*Clear the invalidate buffer if the parameter is NULL*/
+    if(area_p == NULL) {
+        disp->inv_p    = 0;
+        disp->inv_kept = 0;
+        return;
+    }
+
+    lv_area_t scr_area;
+    scr_area.x1 = 0;
+    scr_area.y1 = 0;
+    scr_area.x2 = lv_disp_get_hor_res(disp) - 1;
+    scr_area.y2 = lv_disp_get_ver_res(disp) - 1;
+
+    lv_area_t com_area;
+    bool suc;
+
+    suc = lv_area_intersect(&com_area, area_p, &scr_area);
+
+    /*The area is truncated to the screen*/
+    if(suc != false) {
+        if(disp->driver.rounder_cb) disp->driver.rounder_cb(&disp->driver, &com_area);
+        if(disp->driver.hold_cb && disp->driver.hold_cb(&disp->driver, &com_area)) return;
+
+        lv_refr_save_area(disp, &com_area);
+    }
+}
+
+/**
+ * Add an area to the invalidated areas of a display unless one of them holds it already
+ * @param disp pointer to a display
+ * @param area_p pointer to an area on the screen
+ */
+static void lv_refr_save_area(lv_disp_t * disp, const lv_area_t * area_p)
+{
+    /*Save only if this area is not in one of the saved areas*/
+    uint16_t i;
+    for(i = 0; i < disp->inv_p; i++) {
+        if(lv_area_is_in(area_p, &disp->inv_areas[i]) != false) return;
+    }
+
+    /*Save the area*/
+    if(disp->inv_p < LV_INV_BUF_SIZE) {
+        lv_area_copy(&disp->inv_areas[disp->inv_p], area_p);
+        disp->inv_p++;
+    } else { /*If no place for the area join it with the area it grows the least*/
+        lv_area_t joined_area;
+        uint32_t grow;
+        uint32_t best_grow = UINT32_MAX;
+        uint16_t best      = 0;
+        for(i = 0; i < disp->inv_p; i++) {
+            lv_area_join(&joined_area, area_p, &disp->inv_areas[i]);
+            grow = lv_area_get_size(&joined_area) - lv_area_get_size(&disp->inv_areas[i]);
+            if(grow < best_grow) {
+                best_grow = grow;
+                best      = i;
+            }
+        }
+        lv_area_join(&disp->inv_areas[best], area_p, &disp->inv_areas[best]);
+    }
+}
+
+/**
+ * Remember the areas invalidated for this refresh and add the last refresh's new areas to them,
+ * which the buffer being drawn into hasn't got yet
+ */
+static void lv_refr_add_prev(void)
+{
+    uint16_t i;
+
+    memcpy(inv_new, disp_refr->inv_areas, disp_refr->inv_p * sizeof(lv_area_t));
+    inv_new_p = disp_refr->inv_p;
+
+    for(i = 0; i < disp_refr->inv_prev_p; i++) {
+        lv_refr_save_area(disp_refr, &disp_refr->inv_prev[i]);
+    }
+}
+
 /**
  * Join the areas which has got common parts
  */
@@ -233,34 +610,73 @@ static void lv_refr_join_area(void)
 {
     uint32_t join_from;
     uint32_t join_in;
+    uint32_t cost = disp_refr->driver.inv_area_cost;
+    bool joined;
     lv_area_t joined_area;
-    for(join_in = 0; join_in < disp_refr->inv_p; join_in++) {
-        if(disp_refr->inv_area_joined[join_in] != 0) continue;
 
-        /*Check all areas to join them in 'join_in'*/
-        for(join_from = 0; join_from < disp_refr->inv_p; join_from++) {
-            /*Handle only unjoined areas and ignore itself*/
-            if(disp_refr->inv_area_joined[join_from] != 0 || join_in == join_from) {
-                continue;
-            }
+    /*With a cost per area joining can make further joins worthwhile so repeat until nothing changes*/
+    do {
+        joined = false;
+        for(join_in = 0; join_in < disp_refr->inv_p; join_in++) {
+            if(disp_refr->inv_area_joined[join_in] != 0) continue;
+
+            /*Check all areas to join them in 'join_in'*/
+            for(join_from = 0; join_from < disp_refr->inv_p; join_from++) {
+                /*Handle only unjoined areas and ignore itself*/
+                if(disp_refr->inv_area_joined[join_from] != 0 || join_in == join_from) {
+                    continue;
+                }
 
-            /*Check if the areas are on each other*/
-            if(lv_area_is_on(&disp_refr->inv_areas[join_in], &disp_refr->inv_areas[join_from]) == false) {
-                continue;
-            }
+                /*Without a cost only areas on each other can get smaller*/
+                if(cost == 0 &&
+                   lv_area_is_on(&disp_refr->inv_areas[join_in], &disp_refr->inv_areas[join_from]) == false) {
+                    continue;
+                }
 
-            lv_area_join(&joined_area, &disp_refr->inv_areas[join_in], &disp_refr->inv_areas[join_from]);
+                lv_area_join(&joined_area, &disp_refr->inv_areas[join_in], &disp_refr->inv_areas[join_from]);
 
-            /*Join two area only if the joined area size is smaller*/
-            if(lv_area_get_size(&joined_area) < (lv_area_get_size(&disp_refr->inv_areas[join_in]) +
-                                                 lv_area_get_size(&disp_refr->inv_areas[join_from]))) {
-                lv_area_copy(&disp_refr->inv_areas[join_in], &joined_area);
+                /*Join two area only if the joined area costs less than refreshing them separately*/
+                if(lv_area_get_size(&joined_area) < (lv_area_get_size(&disp_refr->inv_areas[join_in]) +
+                                                     lv_area_get_size(&disp_refr->inv_areas[join_from]) + cost)) {
+                    lv_area_copy(&disp_refr->inv_areas[join_in], &joined_area);
 
-                /*Mark 'join_form' is joined into 'join_in'*/
-                disp_refr->inv_area_joined[join_from] = 1;
+                    /*Mark 'join_form' is joined into 'join_in'*/
+                    disp_refr->inv_area_joined[join_from] = 1;
+                    joined                                 = true;
+                }
             }
         }
+    } while(joined && cost != 0);
+}
+
+/**
+ * Drop the joined areas and sort the rest by the rank the driver gives them
+ */
+static void lv_refr_rank_areas(void)
+{
+    uint32_t rank[LV_INV_BUF_SIZE];
+    uint16_t n = 0;
+    uint16_t i;
+    uint16_t j;
+
+    /*Insertion sort, stable so equal ranks keep their order. There are few areas.*/
+    for(i = 0; i < disp_refr->inv_p; i++) {
+        if(disp_refr->inv_area_joined[i]) continue;
+
+        lv_area_t area;
+        lv_area_copy(&area, &disp_refr->inv_areas[i]);
+        uint32_t r = disp_refr->driver.rank_cb(&disp_refr->driver, &area);
+        for(j = n; j > 0 && rank[j - 1] > r; j--) {
+            rank[j] = rank[j - 1];
+            lv_area_copy(&disp_refr->inv_areas[j], &disp_refr->inv_areas[j - 1]);
+        }
+        rank[j] = r;
+        lv_area_copy(&disp_refr->inv_areas[j], &area);
+        n++;
     }
+
+    memset(disp_refr->inv_area_joined, 0, sizeof(disp_refr->inv_area_joined));
+    disp_refr->inv_p = n;
 }
 
 /**
@@ -270,18 +686,52 @@ static void lv_refr_areas(void)
 {
     px_num = 0;
     uint32_t i;
+    uint32_t last = 0;
+
+    refr_yield      = false;
+    refr_rest_valid = false;
+    for(i = 0; i < disp_refr->inv_p; i++) {
+        if(disp_refr->inv_area_joined[i] == 0) last = i;
+    }
 
     for(i = 0; i < disp_refr->inv_p; i++) {
         /*Refresh the unjoined areas*/
         if(disp_refr->inv_area_joined[i] == 0) {
+            refr_more = i != last;
 
             lv_refr_area(&disp_refr->inv_areas[i]);
 
-            if(disp_refr->driver.monitor_cb) px_num += lv_area_get_size(&disp_refr->inv_areas[i]);
+            if(disp_refr->driver.monitor_cb) {
+                px_num += lv_area_get_size(&disp_refr->inv_areas[i]);
+                if(refr_rest_valid) px_num -= lv_area_get_size(&refr_rest);
+            }
+
+            if(refr_yield) {
+                refr_yield_at = i;
+                break;
+            }
         }
     }
 }
 
+/**
+ * Make what a refresh ended early by the driver didn't draw the invalidated areas
+ */
+static void lv_refr_keep_rest(void)
+{
+    uint16_t n = 0;
+    uint16_t i;
+
+    /*Never more areas are kept than were passed, so they can be moved down in place*/
+    if(refr_rest_valid) lv_area_copy(&disp_refr->inv_areas[n++], &refr_rest);
+    for(i = refr_yield_at + 1; i < disp_refr->inv_p; i++) {
+        if(disp_refr->inv_area_joined[i] == 0) lv_area_copy(&disp_refr->inv_areas[n++], &disp_refr->inv_areas[i]);
+    }
+
+    memset(disp_refr->inv_area_joined, 0, sizeof(disp_refr->inv_area_joined));
+    disp_refr->inv_p = n;
+}
+
 /**
  * Refresh an area if there is Virtual Display Buffer
  * @param area_p  pointer to an area to refresh
@@ -342,6 +792,7 @@ static void lv_refr_area(const lv_area_t * area_p)
         /*Always use the full row*/
         lv_coord_t row;
         lv_coord_t row_last = 0;
+        bool more_areas = refr_more;
         for(row = area_p->y1; row + max_row - 1 <= y2; row += max_row) {
             /*Calc. the next y coordinates of VDB*/
             vdb->area.x1 = area_p->x1;
@@ -350,7 +801,19 @@ static void lv_refr_area(const lv_area_t * area_p)
             vdb->area.y2 = row + max_row - 1;
             if(vdb->area.y2 > y2) vdb->area.y2 = y2;
             row_last = vdb->area.y2;
+            refr_more = more_areas || row_last != y2;
             lv_refr_area_part(area_p);
+
+            /*The driver may end the refresh between parts, leaving the rows below for later*/
+            if(refr_yield) {
+                if(row_last != y2) {
+                    lv_area_copy(&refr_rest, area_p);
+                    refr_rest.y1    = row_last + 1;
+                    refr_rest.y2    = y2;
+                    refr_rest_valid = true;
+                }
+                return;
+            }
         }
 
         /*If the last y coordinates are not handled yet ...*/
@@ -362,6 +825,7 @@ static void lv_refr_area(const lv_area_t * area_p)
             vdb->area.y2 = y2;
 
             /*Refresh this part too*/
+            refr_more = more_areas;
             lv_refr_area_part(area_p);
         }
     }
@@ -379,8 +843,7 @@ static void lv_refr_area_part(const lv_area_t * area_p)
     /*In non double buffered mode, before rendering the next part wait until the previous image is
      * flushed*/
     if(lv_disp_is_double_buf(disp_refr) == false) {
-        while(vdb->flushing)
-            ;
+        lv_refr_wait_flush();
     }
 
     lv_obj_t * top_p;
@@ -390,6 +853,18 @@ static void lv_refr_area_part(const lv_area_t * area_p)
     lv_area_t start_mask;
     lv_area_intersect(&start_mask, area_p, &vdb->area);
 
+    if(disp_refr->driver.trace_cb) {
+        disp_refr->driver.trace_cb(&disp_refr->driver, LV_DISP_TRACE_PART_START, &start_mask);
+    }
+
+#if LV_REFR_OCCLUDERS
+    /*The objects on the top and sys layer are drawn over the whole screen*/
+    occl_cnt = 0;
+    lv_refr_occl_push_children(lv_disp_get_layer_sys(disp_refr), &start_mask);
+    uint16_t sys_occl_cnt = occl_cnt;
+    lv_refr_occl_push_children(lv_disp_get_layer_top(disp_refr), &start_mask);
+#endif
+
     /*Get the most top object which is not covered by others*/
     top_p = lv_refr_get_top_obj(&start_mask, lv_disp_get_scr_act(disp_refr));
 
@@ -397,14 +872,28 @@ static void lv_refr_area_part(const lv_area_t * area_p)
     lv_refr_obj_and_children(top_p, &start_mask);
 
     /*Also refresh top and sys layer unconditionally*/
+#if LV_REFR_OCCLUDERS
+    occl_cnt = sys_occl_cnt;
+#endif
     lv_refr_obj_and_children(lv_disp_get_layer_top(disp_refr), &start_mask);
+#if LV_REFR_OCCLUDERS
+    occl_cnt = 0;
+#endif
     lv_refr_obj_and_children(lv_disp_get_layer_sys(disp_refr), &start_mask);
 
     /* In true double buffered mode flush only once when all areas were rendered.
      * In normal mode flush after every area */
     if(lv_disp_is_true_double_buf(disp_refr) == false) {
+        /*Let the driver end the refresh with this part, telling it before the flush*/
+        if(refr_more && !refr_no_yield && disp_refr->driver.yield_cb) {
+            refr_yield = disp_refr->driver.yield_cb(&disp_refr->driver, lv_tick_elaps(refr_start));
+        }
         lv_refr_vdb_flush();
     }
+
+    if(disp_refr->driver.trace_cb) {
+        disp_refr->driver.trace_cb(&disp_refr->driver, LV_DISP_TRACE_PART_END, &start_mask);
+    }
 }
 
 /**
@@ -419,14 +908,26 @@ static lv_obj_t * lv_refr_get_top_obj(const lv_area_t * area_p, lv_obj_t * obj)
 
     /*If this object is fully cover the draw area check the children too */
     if(lv_area_is_in(area_p, &obj->coords) && obj->hidden == 0) {
-        lv_obj_t * i;
-        LV_LL_READ(obj->child_ll, i)
+#if LV_USE_OBJ_CHILD_CACHE
+        uint16_t child_cnt;
+        lv_obj_t ** child_a = lv_obj_get_child_array(obj, &child_cnt);
+        if(child_a != NULL) {
+            uint16_t c;
+            for(c = 0; c < child_cnt && found_p == NULL; c++) {
+                found_p = lv_refr_get_top_obj(area_p, child_a[c]);
+            }
+        } else
+#endif
         {
-            found_p = lv_refr_get_top_obj(area_p, i);
+            lv_obj_t * i;
+            LV_LL_READ(obj->child_ll, i)
+            {
+                found_p = lv_refr_get_top_obj(area_p, i);
 
-            /*If a children is ok then break*/
-            if(found_p != NULL) {
-                break;
+                /*If a children is ok then break*/
+                if(found_p != NULL) {
+                    break;
+                }
             }
         }
 
@@ -455,6 +956,12 @@ static void lv_refr_obj_and_children(lv_obj_t * top_p, const lv_area_t * mask_p)
      * In this case use the screen directly */
     if(top_p == NULL) top_p = lv_disp_get_scr_act(disp_refr);
 
+#if LV_REFR_OCCLUDERS
+    /*The 'younger' siblings of the top object and its parents are drawn over it*/
+    lv_area_t top_mask;
+    lv_refr_occl_push_levels(top_p, mask_p, &top_mask);
+#endif
+
     /*Refresh the top object and its children*/
     lv_refr_obj(top_p, mask_p);
 
@@ -466,13 +973,34 @@ static void lv_refr_obj_and_children(lv_obj_t * top_p, const lv_area_t * mask_p)
 
     /*Do until not reach the screen*/
     while(par != NULL) {
-        /*object before border_p has to be redrawn*/
-        lv_obj_t * i = lv_ll_get_prev(&(par->child_ll), border_p);
+#if LV_USE_OBJ_CHILD_CACHE
+        uint16_t child_cnt;
+        lv_obj_t ** child_a = lv_obj_get_child_array(par, &child_cnt);
+        if(child_a != NULL) {
+            /*The objects before border_p in the array are younger and have to be redrawn*/
+            uint16_t c = 0;
+            while(c < child_cnt && child_a[c] != border_p) c++;
+            while(c > 0) {
+                c--;
+#if LV_REFR_OCCLUDERS
+                lv_refr_occl_pop(child_a[c]);
+#endif
+                lv_refr_obj(child_a[c], mask_p);
+            }
+        } else
+#endif
+        {
+            /*object before border_p has to be redrawn*/
+            lv_obj_t * i = lv_ll_get_prev(&(par->child_ll), border_p);
 
-        while(i != NULL) {
-            /*Refresh the objects*/
-            lv_refr_obj(i, mask_p);
-            i = lv_ll_get_prev(&(par->child_ll), i);
+            while(i != NULL) {
+                /*Refresh the objects*/
+#if LV_REFR_OCCLUDERS
+                lv_refr_occl_pop(i);
+#endif
+                lv_refr_obj(i, mask_p);
+                i = lv_ll_get_prev(&(par->child_ll), i);
+            }
         }
 
         /*Call the post draw design function of the parents of the to object*/
@@ -496,6 +1024,20 @@ static void lv_refr_obj(lv_obj_t * obj, const lv_area_t * mask_ori_p)
     /*Do not refresh hidden objects*/
     if(obj->hidden != 0) return;
 
+#if LV_REFR_OCCLUDERS
+    /*Leave out what the objects drawn after this one and its children cover*/
+    lv_area_t mask_occl;
+    lv_area_copy(&mask_occl, mask_ori_p);
+    if(lv_refr_occl_clip(&mask_occl) == false) return;
+    mask_ori_p = &mask_occl;
+    uint16_t occl_base = occl_cnt;
+#endif
+
+#if LV_USE_OBJ_LAYER
+    /*Blend the object and its children from its layer, unless it's being drawn into it*/
+    if(obj->opa_layer && obj != layer_obj && lv_refr_layer_draw(obj, mask_ori_p)) return;
+#endif
+
     bool union_ok; /* Store the return value of area_union */
     /* Truncate the original mask to the coordinates of the parent
      * because the parent and its children are visible only here */
@@ -512,9 +1054,30 @@ static void lv_refr_obj(lv_obj_t * obj, const lv_area_t * mask_ori_p)
 
     /*Draw the parent and its children only if they ore on 'mask_parent'*/
     if(union_ok != false) {
+#if LV_REFR_OCCLUDERS
+        /*The children are drawn over the object itself too, so draw it only in the parts
+         * nothing covers*/
+        lv_obj_get_coords(obj, &obj_area);
+        if(lv_area_intersect(&obj_mask, mask_ori_p, &obj_area)) {
+            lv_refr_occl_push_children(obj, &obj_mask);
+        }
+        lv_area_t main_parts[LV_REFR_OCCL_PARTS];
+        uint8_t main_part_cnt = lv_refr_occl_split(&obj_ext_mask, main_parts);
+        uint8_t p;
+#endif
 
         /* Redraw the object */
+#if LV_USE_REFR_PROF
+        uint32_t prof_start = LV_REFR_PROF_TIME_EXPR;
+#endif
+#if LV_REFR_OCCLUDERS
+        for(p = 0; p < main_part_cnt; p++) obj->design_cb(obj, &main_parts[p], LV_DESIGN_DRAW_MAIN);
+#else
         obj->design_cb(obj, &obj_ext_mask, LV_DESIGN_DRAW_MAIN);
+#endif
+#if LV_USE_REFR_PROF
+        uint32_t prof_main = (uint32_t)(LV_REFR_PROF_TIME_EXPR - prof_start);
+#endif
 
 #if MASK_AREA_DEBUG
         static lv_color_t debug_color = LV_COLOR_RED;
@@ -526,33 +1089,255 @@ static void lv_refr_obj(lv_obj_t * obj, const lv_area_t * mask_ori_p)
         lv_obj_get_coords(obj, &obj_area);
         union_ok = lv_area_intersect(&obj_mask, mask_ori_p, &obj_area);
         if(union_ok != false) {
-            lv_area_t mask_child; /*Mask from obj and its child*/
             lv_obj_t * child_p;
-            lv_area_t child_area;
-            LV_LL_READ_BACK(obj->child_ll, child_p)
+#if LV_USE_OBJ_CHILD_CACHE
+            uint16_t child_cnt;
+            lv_obj_t ** child_a = lv_obj_get_child_array(obj, &child_cnt);
+            if(child_a != NULL) {
+                /*The oldest child is at the end and drawn first*/
+                while(child_cnt > 0) {
+                    child_cnt--;
+#if LV_REFR_OCCLUDERS
+                    lv_refr_occl_pop(child_a[child_cnt]);
+#endif
+                    lv_refr_child(child_a[child_cnt], &obj_mask);
+                }
+            } else
+#endif
             {
-                lv_obj_get_coords(child_p, &child_area);
-                ext_size = child_p->ext_draw_pad;
-                child_area.x1 -= ext_size;
-                child_area.y1 -= ext_size;
-                child_area.x2 += ext_size;
-                child_area.y2 += ext_size;
-                /* Get the union (common parts) of original mask (from obj)
-                 * and its child */
-                union_ok = lv_area_intersect(&mask_child, &obj_mask, &child_area);
-
-                /*If the parent and the child has common area then refresh the child */
-                if(union_ok) {
-                    /*Refresh the next children*/
-                    lv_refr_obj(child_p, &mask_child);
+                LV_LL_READ_BACK(obj->child_ll, child_p)
+                {
+#if LV_REFR_OCCLUDERS
+                    lv_refr_occl_pop(child_p);
+#endif
+                    lv_refr_child(child_p, &obj_mask);
                 }
             }
         }
+#if LV_REFR_OCCLUDERS
+        occl_cnt = occl_base;
+#endif
 
         /* If all the children are redrawn make 'post draw' design */
+#if LV_USE_REFR_PROF
+        prof_start = LV_REFR_PROF_TIME_EXPR;
         obj->design_cb(obj, &obj_ext_mask, LV_DESIGN_DRAW_POST);
+        lv_refr_prof_add(obj, prof_main, (uint32_t)(LV_REFR_PROF_TIME_EXPR - prof_start));
+#else
+        obj->design_cb(obj, &obj_ext_mask, LV_DESIGN_DRAW_POST);
+#endif
+    }
+}
+
+/**
+ * Refresh a child of an object where it overlaps the parent's mask
+ * @param child_p pointer to a child object
+ * @param obj_mask_p the mask of the parent, the child is drawn only here
+ */
+static void lv_refr_child(lv_obj_t * child_p, const lv_area_t * obj_mask_p)
+{
+    lv_area_t mask_child; /*Mask from obj and its child*/
+    lv_area_t child_area;
+    lv_coord_t ext_size = child_p->ext_draw_pad;
+    lv_obj_get_coords(child_p, &child_area);
+    child_area.x1 -= ext_size;
+    child_area.y1 -= ext_size;
+    child_area.x2 += ext_size;
+    child_area.y2 += ext_size;
+
+    /* Get the union (common parts) of original mask (from obj)
+     * and its child. If they have common area then refresh the child */
+    if(lv_area_intersect(&mask_child, obj_mask_p, &child_area)) {
+        lv_refr_obj(child_p, &mask_child);
+    }
+}
+
+#if LV_REFR_OCCLUDERS
+/**
+ * Put the opaque children of an object on the occluder stack, the 'youngest' first
+ * so the next one drawn is on the top
+ * @param obj pointer to an object
+ * @param obj_mask_p the mask of the object, its children are drawn only here
+ */
+static void lv_refr_occl_push_children(lv_obj_t * obj, const lv_area_t * obj_mask_p)
+{
+#if LV_USE_OBJ_CHILD_CACHE
+    uint16_t child_cnt;
+    lv_obj_t ** child_a = lv_obj_get_child_array(obj, &child_cnt);
+    if(child_a != NULL) {
+        uint16_t c;
+        for(c = 0; c < child_cnt; c++) lv_refr_occl_push(child_a[c], obj_mask_p);
+        return;
+    }
+#endif
+
+    lv_obj_t * i;
+    LV_LL_READ(obj->child_ll, i)
+    {
+        lv_refr_occl_push(i, obj_mask_p);
+    }
+}
+
+/**
+ * Put the 'younger' siblings of an object and of its parents on the occluder stack, those of
+ * the screen's children first, as they are drawn after the object
+ * @param obj pointer to an object
+ * @param mask_p the area being refreshed
+ * @param obj_mask_p store the part of the area where the children of `obj` are drawn here
+ */
+static void lv_refr_occl_push_levels(lv_obj_t * obj, const lv_area_t * mask_p, lv_area_t * obj_mask_p)
+{
+    lv_obj_t * par = lv_obj_get_parent(obj);
+    lv_area_t par_mask;
+
+    if(par == NULL) {
+        lv_area_copy(&par_mask, mask_p);
+    } else {
+        lv_refr_occl_push_levels(par, mask_p, &par_mask);
+
+#if LV_USE_OBJ_CHILD_CACHE
+        uint16_t child_cnt;
+        lv_obj_t ** child_a = lv_obj_get_child_array(par, &child_cnt);
+        if(child_a != NULL) {
+            uint16_t c;
+            for(c = 0; c < child_cnt && child_a[c] != obj; c++) lv_refr_occl_push(child_a[c], &par_mask);
+        } else
+#endif
+        {
+            lv_obj_t * i = lv_ll_get_head(&par->child_ll);
+            while(i != NULL && i != obj) {
+                lv_refr_occl_push(i, &par_mask);
+                i = lv_ll_get_next(&par->child_ll, i);
+            }
+        }
+    }
+
+    lv_area_t obj_area;
+    lv_obj_get_coords(obj, &obj_area);
+    lv_area_intersect(obj_mask_p, &par_mask, &obj_area);
+}
+
+/**
+ * Put an object on the occluder stack if it surely covers a part of a mask.
+ * Only the part inside its radius is taken, the rest is left for the objects under it.
+ * @param obj pointer to an object
+ * @param mask_p the object is drawn only here
+ */
+static void lv_refr_occl_push(lv_obj_t * obj, const lv_area_t * mask_p)
+{
+    if(occl_cnt >= LV_REFR_OCCLUDERS) return;
+    if(obj->hidden != 0) return;
+
+    const lv_style_t * style = lv_obj_get_style(obj);
+    if(style->body.opa != LV_OPA_COVER || style->body.radius == LV_RADIUS_CIRCLE) return;
+
+    lv_area_t area;
+    lv_obj_get_coords(obj, &area);
+    area.x1 += style->body.radius;
+    area.y1 += style->body.radius;
+    area.x2 -= style->body.radius;
+    area.y2 -= style->body.radius;
+    if(lv_area_intersect(&area, mask_p, &area) == false) return;
+
+    if(lv_obj_get_opa_scale(obj) != LV_OPA_COVER) return;
+    if(obj->design_cb(obj, &area, LV_DESIGN_COVER_CHK) == false) return;
+
+    occl_stack[occl_cnt].obj = obj;
+    lv_area_copy(&occl_stack[occl_cnt].area, &area);
+    occl_cnt++;
+}
+
+/**
+ * Take an object off the occluder stack before it's drawn. It doesn't cover itself or what is
+ * drawn after it.
+ * @param obj pointer to the object to draw next
+ */
+static void lv_refr_occl_pop(lv_obj_t * obj)
+{
+    if(occl_cnt > 0 && occl_stack[occl_cnt - 1].obj == obj) occl_cnt--;
+}
+
+/**
+ * Leave out the parts of an area the objects on the occluder stack cover.
+ * An area is only cut where the rest of it is still a rectangle.
+ * @param area_p pointer to an area. Will be updated.
+ * @return false if the whole area is covered
+ */
+static bool lv_refr_occl_clip(lv_area_t * area_p)
+{
+    uint16_t i;
+    for(i = occl_cnt; i > occl_floor; i--) {
+        const lv_area_t * occl = &occl_stack[i - 1].area;
+        if(lv_area_is_on(area_p, occl) == false) continue;
+
+        if(occl->x1 <= area_p->x1 && occl->x2 >= area_p->x2) {
+            if(occl->y1 <= area_p->y1 && occl->y2 >= area_p->y2) return false;
+            if(occl->y1 <= area_p->y1)
+                area_p->y1 = occl->y2 + 1;
+            else if(occl->y2 >= area_p->y2)
+                area_p->y2 = occl->y1 - 1;
+        } else if(occl->y1 <= area_p->y1 && occl->y2 >= area_p->y2) {
+            if(occl->x1 <= area_p->x1)
+                area_p->x1 = occl->x2 + 1;
+            else if(occl->x2 >= area_p->x2)
+                area_p->x2 = occl->x1 - 1;
+        }
+    }
+
+    return true;
+}
+
+/**
+ * Split an area into the parts the objects on the occluder stack don't cover.
+ * An occluder covering only a small part of an area is ignored if it would split it.
+ * @param area_p pointer to an area
+ * @param parts store the parts here (at most `LV_REFR_OCCL_PARTS`)
+ * @return number of parts, 0 if the whole area is covered
+ */
+static uint8_t lv_refr_occl_split(const lv_area_t * area_p, lv_area_t * parts)
+{
+    uint8_t part_cnt = 1;
+    lv_area_copy(&parts[0], area_p);
+
+    uint16_t i;
+    for(i = occl_cnt; i > occl_floor && part_cnt > 0; i--) {
+        const lv_area_t * occl = &occl_stack[i - 1].area;
+        uint8_t p;
+        for(p = 0; p < part_cnt; p++) {
+            lv_area_t * part = &parts[p];
+            lv_area_t covered;
+            if(lv_area_intersect(&covered, part, occl) == false) continue;
+
+            /*Up to 4 parts remain: the rows above and below and the sides of the covered rows*/
+            lv_area_t rest[4];
+            uint8_t rest_cnt = 0;
+            if(covered.y1 > part->y1) lv_area_set(&rest[rest_cnt++], part->x1, part->y1, part->x2, covered.y1 - 1);
+            if(covered.y2 < part->y2) lv_area_set(&rest[rest_cnt++], part->x1, covered.y2 + 1, part->x2, part->y2);
+            if(covered.x1 > part->x1) lv_area_set(&rest[rest_cnt++], part->x1, covered.y1, covered.x1 - 1, covered.y2);
+            if(covered.x2 < part->x2) lv_area_set(&rest[rest_cnt++], covered.x2 + 1, covered.y1, part->x2, covered.y2);
+
+            if(rest_cnt > 1) {
+                if(part_cnt - 1 + rest_cnt > LV_REFR_OCCL_PARTS) continue;
+                if(lv_area_get_size(&covered) < lv_area_get_size(part) / 4) continue;
+            }
+
+            /*Replace the part with the rest. The new parts are off the occluder.*/
+            if(rest_cnt == 0) {
+                lv_area_copy(part, &parts[part_cnt - 1]);
+                part_cnt--;
+                p--;
+                continue;
+            }
+
+            lv_area_copy(part, &rest[0]);
+            uint8_t r;
+            for(r = 1; r < rest_cnt; r++) lv_area_copy(&parts[part_cnt++], &rest[r]);
+        }
     }
+
+    return part_cnt;
 }
+#endif
 
 /**
  * Flush the content of the VDB
@@ -564,8 +1349,7 @@ static void lv_refr_vdb_flush(void)
     /*In double buffered mode wait until the other buffer is flushed before flushing the current
      * one*/
     if(lv_disp_is_double_buf(disp_refr)) {
-        while(vdb->flushing)
-            ;
+        lv_refr_wait_flush();
     }
 
     vdb->flushing = 1;
@@ -581,3 +1365,297 @@ static void lv_refr_vdb_flush(void)
             vdb->buf_act = vdb->buf1;
     }
 }
+
+/**
+ * Wait until the VDB is not flushing, letting the driver's `wait_cb` block if it has one
+ */
+static void lv_refr_wait_flush(void)
+{
+    lv_disp_buf_t * vdb = lv_disp_get_buf(disp_refr);
+
+    while(vdb->flushing) {
+        if(disp_refr->driver.wait_cb) disp_refr->driver.wait_cb(&disp_refr->driver);
+    }
+}
+
+#if LV_USE_OBJ_LAYER
+/**
+ * Blend an object and its children from its layer with the object's opa scale.
+ * The layer is drawn first if it's missing or outdated.
+ * @param obj pointer to an object with `opa_layer` set
+ * @param mask_p the object is drawn only in this area
+ * @return true: the object is drawn; false: it's opaque or there is not enough memory for the layer,
+ * draw it directly
+ */
+static bool lv_refr_layer_draw(lv_obj_t * obj, const lv_area_t * mask_p)
+{
+    /*An opaque object is drawn as fast directly*/
+    lv_opa_t opa = lv_obj_get_opa_scale(obj);
+    if(opa >= LV_OPA_MAX) {
+        lv_refr_layer_free(obj);
+        return false;
+    }
+    if(opa < LV_OPA_MIN) return true;
+
+    /*The whole object, the part of it on the screen, is drawn into the layer*/
+    lv_area_t area;
+    lv_obj_get_coords(obj, &area);
+    area.x1 -= obj->ext_draw_pad;
+    area.y1 -= obj->ext_draw_pad;
+    area.x2 += obj->ext_draw_pad;
+    area.y2 += obj->ext_draw_pad;
+
+    lv_area_t scr_area;
+    scr_area.x1 = 0;
+    scr_area.y1 = 0;
+    scr_area.x2 = lv_disp_get_hor_res(disp_refr) - 1;
+    scr_area.y2 = lv_disp_get_ver_res(disp_refr) - 1;
+    if(lv_area_intersect(&area, &area, &scr_area) == false) return true;
+
+    lv_refr_layer_t * layer = lv_refr_layer_find(obj);
+    if(layer == NULL) {
+        if(layer_cnt == layer_size) {
+            uint16_t new_size         = layer_size ? layer_size * 2 : 4;
+            lv_refr_layer_t * new_buf = lv_mem_realloc(layers, new_size * sizeof(lv_refr_layer_t));
+            if(new_buf == NULL) return false;
+            layers     = new_buf;
+            layer_size = new_size;
+        }
+        layer = &layers[layer_cnt];
+        layer_cnt++;
+        memset(layer, 0, sizeof(lv_refr_layer_t));
+        layer->obj = obj;
+    }
+
+    if(layer->valid == 0 || memcmp(&layer->area, &area, sizeof(lv_area_t)) != 0) {
+        if(lv_refr_layer_render(layer, obj, &area) == false) {
+            lv_refr_layer_free(obj);
+            return false;
+        }
+        /*The layers of the children drawn into it might have moved the list*/
+        layer = lv_refr_layer_find(obj);
+    }
+
+    lv_draw_map(&layer->area, mask_p, layer->data, opa, false, true, LV_COLOR_BLACK, LV_OPA_TRANSP);
+
+    return true;
+}
+
+/**
+ * Draw an object and its children into its layer, opaque as if its opa scale was `LV_OPA_COVER`
+ * @param layer the layer of the object
+ * @param obj pointer to the object
+ * @param area the area of the screen to draw into the layer
+ * @return true: the layer is drawn; false: there was not enough memory for it
+ */
+static bool lv_refr_layer_render(lv_refr_layer_t * layer, lv_obj_t * obj, const lv_area_t * area)
+{
+    lv_coord_t w  = lv_area_get_width(area);
+    lv_coord_t h  = lv_area_get_height(area);
+    uint32_t size = (uint32_t)w * h * LV_IMG_PX_SIZE_ALPHA_BYTE;
+    if(layer->data == NULL || lv_area_get_size(&layer->area) != lv_area_get_size(area)) {
+        if(layer->data) LAYER_FREE(layer->data);
+        layer->data = LAYER_ALLOC(size);
+        if(layer->data == NULL) return false;
+    }
+
+    memset(layer->data, 0x00, size);
+    lv_area_copy(&layer->area, area);
+    /*Set before drawing so what's invalidated meanwhile is drawn again next time*/
+    layer->valid = 1;
+
+    /* Create a dummy display whose buffer is the layer, like the line meter's layer.
+     * The pixels are set with alpha by `lv_refr_layer_set_px`*/
+    lv_disp_t disp;
+    memset(&disp, 0, sizeof(lv_disp_t));
+
+    lv_disp_buf_t disp_buf;
+    lv_disp_buf_init(&disp_buf, layer->data, NULL, (uint32_t)w * h);
+    lv_area_copy(&disp_buf.area, area);
+
+    lv_disp_drv_init(&disp.driver);
+    disp.driver.buffer       = &disp_buf;
+    disp.driver.hor_res      = disp_refr->driver.hor_res;
+    disp.driver.ver_res      = disp_refr->driver.ver_res;
+    disp.driver.antialiasing = disp_refr->driver.antialiasing;
+    disp.driver.set_px_cb    = lv_refr_layer_set_px;
+
+    lv_disp_t * refr_ori       = disp_refr;
+    const lv_obj_t * layer_ori = layer_obj;
+    uint8_t opa_scale_en_ori   = obj->opa_scale_en;
+    lv_opa_t opa_scale_ori     = obj->opa_scale;
+#if LV_REFR_OCCLUDERS
+    /*The occluders so far are drawn over the layer on the screen, they don't cover anything in it*/
+    uint16_t occl_floor_ori = occl_floor;
+    occl_floor              = occl_cnt;
+#endif
+
+    disp_refr         = &disp;
+    layer_obj         = obj;
+    obj->opa_scale_en = 1;
+    obj->opa_scale    = LV_OPA_COVER;
+    lv_refr_obj(obj, area);
+    obj->opa_scale_en = opa_scale_en_ori;
+    obj->opa_scale    = opa_scale_ori;
+    layer_obj         = layer_ori;
+    disp_refr         = refr_ori;
+#if LV_REFR_OCCLUDERS
+    occl_floor = occl_floor_ori;
+#endif
+
+    return true;
+}
+
+/**
+ * Find the layer of an object
+ * @param obj pointer to an object
+ * @return the layer of the object or NULL if it has none
+ */
+static lv_refr_layer_t * lv_refr_layer_find(const lv_obj_t * obj)
+{
+    uint16_t i;
+    for(i = 0; i < layer_cnt; i++) {
+        if(layers[i].obj == obj) return &layers[i];
+    }
+
+    return NULL;
+}
+
+/**
+ * Blend a pixel into a layer keeping its alpha channel (`set_px_cb` of the layer's display)
+ * @param disp_drv the layer's display driver
+ * @param buf the layer's pixels (`LV_IMG_CF_TRUE_COLOR_ALPHA`)
+ * @param buf_w width of the layer
+ * @param x x coordinate of the pixel in the layer
+ * @param y y coordinate of the pixel in the layer
+ * @param color color of the pixel
+ * @param opa opacity of the pixel
+ */
+static void lv_refr_layer_set_px(lv_disp_drv_t * disp_drv, uint8_t * buf, lv_coord_t buf_w, lv_coord_t x,
+                                 lv_coord_t y, lv_color_t color, lv_opa_t opa)
+{
+    (void)disp_drv; /*Unused*/
+
+    if(opa <= LV_OPA_MIN) return;
+
+    uint8_t * px    = &buf[((uint32_t)y * buf_w + x) * LV_IMG_PX_SIZE_ALPHA_BYTE];
+    lv_opa_t px_opa = px[LV_IMG_PX_SIZE_ALPHA_BYTE - 1];
+    lv_color_t px_color;
+    memcpy(&px_color, px, sizeof(lv_color_t));
+
+    /*Mix with the alpha of the pixel under it (the 'over' operator)*/
+    if(opa < LV_OPA_MAX && px_opa > LV_OPA_MIN) {
+        lv_opa_t res_opa = 255 - ((uint16_t)((uint16_t)(255 - opa) * (255 - px_opa)) >> 8);
+        color            = lv_color_mix(color, px_color, (uint16_t)((uint16_t)opa * 255) / res_opa);
+        opa              = res_opa;
+    }
+
+    memcpy(px, &color, LV_IMG_PX_SIZE_ALPHA_BYTE - 1);
+    px[LV_IMG_PX_SIZE_ALPHA_BYTE - 1] = opa;
+}
+#endif
+
+#if LV_USE_REFR_PROF
+/**
+ * Add the time an object took to draw to its own and its type's
+ * @param obj pointer to the object just drawn
+ * @param main time of the main design phase
+ * @param post time of the post design phase
+ */
+static void lv_refr_prof_add(lv_obj_t * obj, uint32_t main, uint32_t post)
+{
+    lv_refr_prof_type_t * t = NULL;
+    uint16_t i;
+
+    obj->prof_main += main;
+    obj->prof_post += post;
+    obj->prof_calls++;
+
+    for(i = 0; i < prof_type_cnt; i++) {
+        if(prof_types[i].signal_cb == obj->signal_cb) {
+            t = &prof_types[i];
+            break;
+        }
+    }
+
+    if(t == NULL) {
+        if(prof_type_cnt < LV_REFR_PROF_TYPES) {
+            /*Ask the type only the first time, it takes a signal*/
+            lv_obj_type_t type;
+            lv_obj_get_type(obj, &type);
+            t = &prof_types[prof_type_cnt++];
+            t->signal_cb = obj->signal_cb;
+            t->prof.type = type.type[0] != NULL ? type.type[0] : "unknown";
+        } else {
+            t = &prof_types[LV_REFR_PROF_TYPES];
+            t->prof.type = "other";
+        }
+    }
+
+    t->prof.main += main;
+    t->prof.post += post;
+    t->prof.calls++;
+}
+
+/**
+ * Insert into a list kept longest first, dropping the shortest once it is full
+ * @param buf the list
+ * @param cnt number of entries in `buf`
+ * @param max size of `buf`
+ * @param p the entry to insert
+ * @return the new number of entries
+ */
+static uint16_t lv_refr_prof_insert(lv_refr_prof_t * buf, uint16_t cnt, uint16_t max, const lv_refr_prof_t * p)
+{
+    uint64_t total = p->main + p->post;
+    uint16_t i = cnt;
+
+    if(cnt == max) {
+        if(max == 0 || buf[max - 1].main + buf[max - 1].post >= total) return cnt;
+        i--;
+    } else {
+        cnt++;
+    }
+
+    while(i > 0 && buf[i - 1].main + buf[i - 1].post < total) {
+        buf[i] = buf[i - 1];
+        i--;
+    }
+    buf[i] = *p;
+
+    return cnt;
+}
+
+/**
+ * Collect the draw times of an object and its children, or clear them if `buf` is NULL
+ * @param obj pointer to an object
+ * @param buf list of the longest objects, as for `lv_refr_prof_insert`
+ * @param cnt number of entries in `buf`, updated
+ * @param max size of `buf`
+ */
+static void lv_refr_prof_walk(lv_obj_t * obj, lv_refr_prof_t * buf, uint16_t * cnt, uint16_t max)
+{
+    lv_obj_t * child;
+
+    if(obj == NULL) return;
+
+    if(buf == NULL) {
+        obj->prof_main  = 0;
+        obj->prof_post  = 0;
+        obj->prof_calls = 0;
+    } else if(obj->prof_calls > 0) {
+        lv_refr_prof_t p;
+        p.type  = NULL; /*Filled in only for the objects kept*/
+        p.obj   = obj;
+        p.main  = obj->prof_main;
+        p.post  = obj->prof_post;
+        p.calls = obj->prof_calls;
+        *cnt    = lv_refr_prof_insert(buf, *cnt, max, &p);
+    }
+
+    LV_LL_READ(obj->child_ll, child)
+    {
+        lv_refr_prof_walk(child, buf, cnt, max);
+    }
+}
+#endif
@@ -24,6 +24,18 @@ extern "C" {
  *      TYPEDEFS
  **********************/
 
+#if LV_USE_REFR_PROF
+/** Draw time of an object or of all objects of a type, in `LV_REFR_PROF_TIME_EXPR` units*/
+typedef struct
+{
+    const char * type; /**< Object type, "other" for the types past `LV_REFR_PROF_TYPES`*/
+    lv_obj_t * obj;    /**< The object, NULL for a type*/
+    uint64_t main;     /**< Spent in the main design phase*/
+    uint64_t post;     /**< Spent in the post design phase*/
+    uint32_t calls;    /**< Times drawn*/
+} lv_refr_prof_t;
+#endif
+
 /**********************
  *  STATIC PROTOTYPES
  **********************/
@@ -62,6 +74,41 @@ void lv_refr_now(lv_disp_t * disp);
  */
 void lv_inv_area(lv_disp_t * disp, const lv_area_t * area_p);
 
+#if LV_USE_OBJ_LAYER
+/**
+ * Invalidate the area of an object on display to redraw it.
+ * Unlike `lv_inv_area` the cached layers over the area are kept: only the layers the object is
+ * drawn in change, see `lv_refr_layer_inv_obj`.
+ * @param disp pointer to display where the area should be invalidated (NULL: the default display)
+ * @param area_p pointer to area which should be invalidated (NULL: delete the invalidated areas)
+ */
+void lv_inv_obj_area(lv_disp_t * disp, const lv_area_t * area_p);
+
+/**
+ * Mark the cached layers an object is drawn in to be drawn again: its own and its parents'
+ * @param obj pointer to an object (NULL: do nothing)
+ */
+void lv_refr_layer_inv_obj(const lv_obj_t * obj);
+
+/**
+ * Free the cached layer of an object if it has one
+ * @param obj pointer to an object
+ */
+void lv_refr_layer_free(const lv_obj_t * obj);
+#endif
+
+/**
+ * Move the pixels already on a display inside an area instead of redrawing them, e.g. when
+ * scrolling. Only the strips left exposed and the invalidated areas moved along are redrawn.
+ * @param disp pointer to a display (NULL to use the default display)
+ * @param area_p pointer to the area whose content moves. Nothing else may be drawn over it.
+ * @param dx horizontal movement
+ * @param dy vertical movement
+ * @return true: the pixels are moved; false: the driver can't move them, invalidate `area_p`
+ * instead
+ */
+bool lv_refr_copy_area(lv_disp_t * disp, const lv_area_t * area_p, lv_coord_t dx, lv_coord_t dy);
+
 /**
  * Get the display which is being refreshed
  * @return the display being refreshed
@@ -76,12 +123,42 @@ lv_disp_t * lv_refr_get_disp_refreshing(void);
  */
 void lv_refr_set_disp_refreshing(lv_disp_t * disp);
 
+/**
+ * Join the invalidated areas of a display the way a refresh does.
+ * Exposed to benchmark the joining; the areas are still refreshed by the next refresh.
+ * @param disp the display whose areas to join
+ */
+void lv_refr_join_areas(lv_disp_t * disp);
+
 /**
  * Called periodically to handle the refreshing
  * @param task pointer to the task itself
  */
 void lv_disp_refr_task(lv_task_t * task);
 
+#if LV_USE_REFR_PROF
+/**
+ * Get the objects on all displays which took longest to draw since the last reset
+ * @param buf the objects are stored here, longest first
+ * @param max size of `buf`
+ * @return number of objects stored
+ */
+uint16_t lv_refr_prof_get_objs(lv_refr_prof_t * buf, uint16_t max);
+
+/**
+ * Get the draw times of the object types drawn since the last reset
+ * @param buf the types are stored here, longest first
+ * @param max size of `buf`
+ * @return number of types stored
+ */
+uint16_t lv_refr_prof_get_types(lv_refr_prof_t * buf, uint16_t max);
+
+/**
+ * Clear the draw times of all objects and types
+ */
+void lv_refr_prof_reset(void);
+#endif
+
 /**********************
  *   STATIC FUNCTIONS
  **********************/
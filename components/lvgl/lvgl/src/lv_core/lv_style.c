@@ -9,6 +9,11 @@
 #include "lv_obj.h"
 #include "../lv_misc/lv_mem.h"
 #include "../lv_misc/lv_anim.h"
+#include "../lv_misc/lv_gc.h"
+
+#if defined(LV_GC_INCLUDE)
+#include LV_GC_INCLUDE
+#endif /* LV_ENABLE_GC */
 
 /*********************
  *      DEFINES
@@ -27,10 +32,22 @@
 /**********************
  *      TYPEDEFS
  **********************/
+#if LV_USE_STYLE_INTERN
+/*A shared copy of a style*/
+typedef struct
+{
+    lv_style_t style; /*First, so the style's address is the entry's*/
+    uint32_t hash;
+    uint32_t ref_cnt; /*Users which haven't given it back yet*/
+} lv_style_intern_t;
+#endif
 
 /**********************
  *  STATIC PROTOTYPES
  **********************/
+#if LV_USE_STYLE_INTERN
+static uint32_t style_hash(const lv_style_t * style);
+#endif
 #if LV_USE_ANIMATION
 static void style_animator(lv_style_anim_dsc_t * dsc, lv_anim_value_t val);
 static void style_animation_common_end_cb(lv_anim_t * a);
@@ -66,6 +83,11 @@ lv_style_t lv_style_btn_ina;
  */
 void lv_style_init(void)
 {
+#if LV_USE_STYLE_INTERN
+    /*The shared copies are nodes of the list. Allocate them from a pool*/
+    lv_ll_init_pool(&LV_GC_ROOT(_lv_style_intern_ll), sizeof(lv_style_intern_t));
+#endif
+
     /* Not White/Black/Gray colors are created by HSV model with
      * HUE = 210*/
 
@@ -274,6 +296,55 @@ void lv_style_mix(const lv_style_t * start, const lv_style_t * end, lv_style_t *
     }
 }
 
+#if LV_USE_STYLE_INTERN
+/**
+ * Get a shared copy of a style. Styles with the same content (compared byte by byte, so build
+ * them with `lv_style_copy` from a common base) get the same copy, so the objects of a screen
+ * created with copies of a few styles keep only one of each.
+ * @param style pointer to a style. It can be changed or freed after the call.
+ * @return pointer to the shared copy, which must not be changed, or NULL if out of memory.
+ *         Give it back with `lv_style_release` when no object uses it anymore.
+ */
+const lv_style_t * lv_style_intern(const lv_style_t * style)
+{
+    uint32_t hash = style_hash(style);
+
+    lv_style_intern_t * e;
+    LV_LL_READ(LV_GC_ROOT(_lv_style_intern_ll), e)
+    {
+        if(e->hash == hash && memcmp(&e->style, style, sizeof(lv_style_t)) == 0) {
+            e->ref_cnt++;
+            return &e->style;
+        }
+    }
+
+    e = lv_ll_ins_head(&LV_GC_ROOT(_lv_style_intern_ll));
+    if(e == NULL) return NULL;
+
+    lv_style_copy(&e->style, style);
+    e->hash    = hash;
+    e->ref_cnt = 1;
+
+    return &e->style;
+}
+
+/**
+ * Give back a shared copy of a style. It's freed when every user has given it back.
+ * @param style pointer to a style returned by `lv_style_intern` (NULL is ignored)
+ */
+void lv_style_release(const lv_style_t * style)
+{
+    if(style == NULL) return;
+
+    lv_style_intern_t * e = (lv_style_intern_t *)style;
+    e->ref_cnt--;
+    if(e->ref_cnt == 0) {
+        lv_ll_rem(&LV_GC_ROOT(_lv_style_intern_ll), e);
+        lv_mem_free(e);
+    }
+}
+#endif
+
 #if LV_USE_ANIMATION
 
 void lv_style_anim_init(lv_anim_t * a)
@@ -344,3 +415,22 @@ static void style_animation_common_end_cb(lv_anim_t * a)
 }
 
 #endif
+
+#if LV_USE_STYLE_INTERN
+/**
+ * Hash the content of a style (FNV-1a), to compare styles by their hash first
+ * @param style pointer to a style
+ * @return the hash
+ */
+static uint32_t style_hash(const lv_style_t * style)
+{
+    const uint8_t * p = (const uint8_t *)style;
+    uint32_t hash     = 2166136261U;
+    uint32_t i;
+    for(i = 0; i < sizeof(lv_style_t); i++) {
+        hash = (hash ^ p[i]) * 16777619U;
+    }
+
+    return hash;
+}
+#endif
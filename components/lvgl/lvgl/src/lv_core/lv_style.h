@@ -158,6 +158,24 @@ void lv_style_copy(lv_style_t * dest, const lv_style_t * src);
  */
 void lv_style_mix(const lv_style_t * start, const lv_style_t * end, lv_style_t * res, uint16_t ratio);
 
+#if LV_USE_STYLE_INTERN
+/**
+ * Get a shared copy of a style. Styles with the same content (compared byte by byte, so build
+ * them with `lv_style_copy` from a common base) get the same copy, so the objects of a screen
+ * created with copies of a few styles keep only one of each.
+ * @param style pointer to a style. It can be changed or freed after the call.
+ * @return pointer to the shared copy, which must not be changed, or NULL if out of memory.
+ *         Give it back with `lv_style_release` when no object uses it anymore.
+ */
+const lv_style_t * lv_style_intern(const lv_style_t * style);
+
+/**
+ * Give back a shared copy of a style. It's freed when every user has given it back.
+ * @param style pointer to a style returned by `lv_style_intern` (NULL is ignored)
+ */
+void lv_style_release(const lv_style_t * style);
+#endif
+
 #if LV_USE_ANIMATION
 
 /**
@@ -8,6 +8,7 @@ CSRCS += lv_draw_arc.c
 CSRCS += lv_draw_triangle.c
 CSRCS += lv_img_decoder.c
 CSRCS += lv_img_cache.c
+CSRCS += lv_glyph_cache.c
 
 DEPPATH += --dep-path $(LVGL_DIR)/lvgl/src/lv_draw
 VPATH += :$(LVGL_DIR)/lvgl/src/lv_draw
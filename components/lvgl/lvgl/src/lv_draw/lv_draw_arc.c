@@ -17,10 +17,24 @@
  *      TYPEDEFS
  **********************/
 
+/*A part of the arc inside a quadrant, as the sine and cosine of its start and end angle*/
+typedef struct
+{
+    int32_t start_sin;
+    int32_t start_cos;
+    int32_t end_sin;
+    int32_t end_cos;
+} arc_range_t;
+
 /**********************
  *  STATIC PROTOTYPES
  **********************/
-static uint16_t fast_atan2(int x, int y);
+static uint8_t quadrant_ranges(uint16_t quarter, uint16_t start_angle, uint16_t end_angle, arc_range_t * ranges);
+static void row_spans(lv_coord_t x_ofs, lv_coord_t y_ofs, lv_coord_t yi, lv_coord_t x_min, lv_coord_t x_max,
+                      const arc_range_t * ranges, uint8_t range_cnt, const lv_area_t * mask, lv_color_t color,
+                      lv_opa_t opa);
+static void ray_limit(int32_t sin_val, int32_t cos_val, lv_coord_t yi, lv_coord_t * x_min, lv_coord_t * x_max);
+static int32_t div_floor(int32_t a, int32_t b);
 static void ver_line(lv_coord_t x, lv_coord_t y, const lv_area_t * mask, lv_coord_t len, lv_color_t color,
                      lv_opa_t opa);
 static void hor_line(lv_coord_t x, lv_coord_t y, const lv_area_t * mask, lv_coord_t len, lv_color_t color,
@@ -59,10 +73,6 @@ void lv_draw_arc(lv_coord_t center_x, lv_coord_t center_y, uint16_t radius, cons
 
     lv_coord_t r_out = radius;
     lv_coord_t r_in  = r_out - thickness;
-    int16_t deg_base;
-    int16_t deg;
-    lv_coord_t x_start[4];
-    lv_coord_t x_end[4];
 
     lv_color_t color = style->line.color;
     lv_opa_t opa = opa_scale == LV_OPA_COVER ? style->body.opa : (uint16_t)((uint16_t)style->body.opa * opa_scale) >> 8;
@@ -82,77 +92,34 @@ void lv_draw_arc(lv_coord_t center_x, lv_coord_t center_y, uint16_t radius, cons
     if(deg_test(0, start_angle, end_angle))
         ver_line(center_x, center_y + r_in, mask, thickness - 1, color, opa); // Bottom middle
 
-    uint32_t r_out_sqr = r_out * r_out;
-    uint32_t r_in_sqr  = r_in * r_in;
-    int16_t xi;
-    int16_t yi;
+    /* Draw the quadrants row by row: the ring gives a span of every row and the rays of the start
+     * and end angle cut it where the arc begins and ends. Quadrant `q` holds the angles
+     * `q * 90 .. q * 90 + 90`, i.e. bottom right, top right, top left and bottom left*/
+    arc_range_t ranges[4][2];
+    uint8_t range_cnt[4];
+    uint8_t q;
+    for(q = 0; q < 4; q++) range_cnt[q] = quadrant_ranges(q * 90, start_angle, end_angle, ranges[q]);
+
+    int32_t r_out_sqr = (int32_t)r_out * r_out;
+    int32_t r_in_sqr  = (int32_t)r_in * r_in;
+    lv_coord_t x_out  = 0; /*Left most pixel of the row inside the outer circle*/
+    lv_coord_t x_in   = 0; /*Left most pixel of the row inside the inner circle (0 if none)*/
+    lv_coord_t yi;
     for(yi = -r_out; yi < 0; yi++) {
-        x_start[0] = LV_COORD_MIN;
-        x_start[1] = LV_COORD_MIN;
-        x_start[2] = LV_COORD_MIN;
-        x_start[3] = LV_COORD_MIN;
-        x_end[0]   = LV_COORD_MIN;
-        x_end[1]   = LV_COORD_MIN;
-        x_end[2]   = LV_COORD_MIN;
-        x_end[3]   = LV_COORD_MIN;
-        for(xi = -r_out; xi < 0; xi++) {
-
-            uint32_t r_act_sqr = xi * xi + yi * yi;
-            if(r_act_sqr > r_out_sqr) continue;
-
-            deg_base = fast_atan2(xi, yi) - 180;
-
-            deg = 180 + deg_base;
-            if(deg_test(deg, start_angle, end_angle)) {
-                if(x_start[0] == LV_COORD_MIN) x_start[0] = xi;
-            } else if(x_start[0] != LV_COORD_MIN && x_end[0] == LV_COORD_MIN) {
-                x_end[0] = xi - 1;
-            }
-
-            deg = 360 - deg_base;
-            if(deg_test(deg, start_angle, end_angle)) {
-                if(x_start[1] == LV_COORD_MIN) x_start[1] = xi;
-            } else if(x_start[1] != LV_COORD_MIN && x_end[1] == LV_COORD_MIN) {
-                x_end[1] = xi - 1;
-            }
-
-            deg = 180 - deg_base;
-            if(deg_test(deg, start_angle, end_angle)) {
-                if(x_start[2] == LV_COORD_MIN) x_start[2] = xi;
-            } else if(x_start[2] != LV_COORD_MIN && x_end[2] == LV_COORD_MIN) {
-                x_end[2] = xi - 1;
-            }
-
-            deg = deg_base;
-            if(deg_test(deg, start_angle, end_angle)) {
-                if(x_start[3] == LV_COORD_MIN) x_start[3] = xi;
-            } else if(x_start[3] != LV_COORD_MIN && x_end[3] == LV_COORD_MIN) {
-                x_end[3] = xi - 1;
-            }
-
-            if(r_act_sqr < r_in_sqr)
-                break; /*No need to continue the iteration in x once we found the inner edge of the
-                          arc*/
-        }
-
-        if(x_start[0] != LV_COORD_MIN) {
-            if(x_end[0] == LV_COORD_MIN) x_end[0] = xi - 1;
-            hor_line(center_x + x_start[0], center_y + yi, mask, x_end[0] - x_start[0], color, opa);
-        }
+        int32_t y_sqr = (int32_t)yi * yi;
+        while((int32_t)(x_out - 1) * (x_out - 1) + y_sqr <= r_out_sqr) x_out--;
+        while((int32_t)(x_in - 1) * (x_in - 1) + y_sqr < r_in_sqr) x_in--;
 
-        if(x_start[1] != LV_COORD_MIN) {
-            if(x_end[1] == LV_COORD_MIN) x_end[1] = xi - 1;
-            hor_line(center_x + x_start[1], center_y - yi, mask, x_end[1] - x_start[1], color, opa);
-        }
+        if(x_out > x_in - 1) continue;
 
-        if(x_start[2] != LV_COORD_MIN) {
-            if(x_end[2] == LV_COORD_MIN) x_end[2] = xi - 1;
-            hor_line(center_x - x_end[2], center_y + yi, mask, LV_MATH_ABS(x_end[2] - x_start[2]), color, opa);
+        if(center_y + yi >= mask->y1 && center_y + yi <= mask->y2) {
+            row_spans(center_x, center_y, yi, 1 - x_in, -x_out, ranges[1], range_cnt[1], mask, color, opa);
+            row_spans(center_x, center_y, yi, x_out, x_in - 1, ranges[2], range_cnt[2], mask, color, opa);
         }
 
-        if(x_start[3] != LV_COORD_MIN) {
-            if(x_end[3] == LV_COORD_MIN) x_end[3] = xi - 1;
-            hor_line(center_x - x_end[3], center_y - yi, mask, LV_MATH_ABS(x_end[3] - x_start[3]), color, opa);
+        if(center_y - yi >= mask->y1 && center_y - yi <= mask->y2) {
+            row_spans(center_x, center_y, -yi, 1 - x_in, -x_out, ranges[0], range_cnt[0], mask, color, opa);
+            row_spans(center_x, center_y, -yi, x_out, x_in - 1, ranges[3], range_cnt[3], mask, color, opa);
         }
 
 #if LV_ANTIALIAS
@@ -162,84 +129,120 @@ void lv_draw_arc(lv_coord_t center_x, lv_coord_t center_y, uint16_t radius, cons
     }
 }
 
-static uint16_t fast_atan2(int x, int y)
+/**********************
+ *   STATIC FUNCTIONS
+ **********************/
+
+/**
+ * Get the parts of an arc in a quadrant
+ * @param quarter the first angle of the quadrant (0, 90, 180 or 270)
+ * @param start_angle the start angle of the arc
+ * @param end_angle the end angle of the arc
+ * @param ranges store the parts here (at most 2)
+ * @return number of parts
+ */
+static uint8_t quadrant_ranges(uint16_t quarter, uint16_t start_angle, uint16_t end_angle, arc_range_t * ranges)
 {
-    // Fast XY vector to integer degree algorithm - Jan 2011 www.RomanBlack.com
-    // Converts any XY values including 0 to a degree value that should be
-    // within +/- 1 degree of the accurate value without needing
-    // large slow trig functions like ArcTan() or ArcCos().
-    // NOTE! at least one of the X or Y values must be non-zero!
-    // This is the full version, for all 4 quadrants and will generate
-    // the angle in integer degrees from 0-360.
-    // Any values of X and Y are usable including negative values provided
-    // they are between -1456 and 1456 so the 16bit multiply does not overflow.
-
-    unsigned char negflag;
-    unsigned char tempdegree;
-    unsigned char comp;
-    unsigned int degree; // this will hold the result
-    // signed int x;            // these hold the XY vector at the start
-    // signed int y;            // (and they will be destroyed)
-    unsigned int ux;
-    unsigned int uy;
-
-    // Save the sign flags then remove signs and get XY as unsigned ints
-    negflag = 0;
-    if(x < 0) {
-        negflag += 0x01; // x flag bit
-        x = (0 - x);     // is now +
-    }
-    ux = x; // copy to unsigned var before multiply
-    if(y < 0) {
-        negflag += 0x02; // y flag bit
-        y = (0 - y);     // is now +
+    uint16_t bounds[2][2];
+    uint8_t bound_cnt;
+    uint8_t cnt = 0;
+    uint8_t i;
+
+    if(start_angle <= end_angle) {
+        bounds[0][0] = start_angle;
+        bounds[0][1] = end_angle;
+        bound_cnt    = 1;
+    } else {
+        bounds[0][0] = start_angle;
+        bounds[0][1] = 360;
+        bounds[1][0] = 0;
+        bounds[1][1] = end_angle;
+        bound_cnt    = 2;
     }
-    uy = y; // copy to unsigned var before multiply
 
-    // 1. Calc the scaled "degrees"
-    if(ux > uy) {
-        degree = (uy * 45) / ux; // degree result will be 0-45 range
-        negflag += 0x10;         // octant flag bit
-    } else {
-        degree = (ux * 45) / uy; // degree result will be 0-45 range
+    for(i = 0; i < bound_cnt; i++) {
+        uint16_t a1 = LV_MATH_MAX(bounds[i][0], quarter);
+        uint16_t a2 = LV_MATH_MIN(bounds[i][1], quarter + 90);
+        if(a1 > a2) continue;
+
+        ranges[cnt].start_sin = lv_trigo_sin(a1);
+        ranges[cnt].start_cos = lv_trigo_sin(a1 + 90);
+        ranges[cnt].end_sin   = lv_trigo_sin(a2);
+        ranges[cnt].end_cos   = lv_trigo_sin(a2 + 90);
+        cnt++;
     }
 
-    // 2. Compensate for the 4 degree error curve
-    comp       = 0;
-    tempdegree = degree;  // use an unsigned char for speed!
-    if(tempdegree > 22) { // if top half of range
-        if(tempdegree <= 44) comp++;
-        if(tempdegree <= 41) comp++;
-        if(tempdegree <= 37) comp++;
-        if(tempdegree <= 32) comp++; // max is 4 degrees compensated
-    } else {                         // else is lower half of range
-        if(tempdegree >= 2) comp++;
-        if(tempdegree >= 6) comp++;
-        if(tempdegree >= 10) comp++;
-        if(tempdegree >= 15) comp++; // max is 4 degrees compensated
+    return cnt;
+}
+
+/**
+ * Fill the parts of the arc in a row of a quadrant
+ * @param x_ofs x coordinate of the center
+ * @param y_ofs y coordinate of the center
+ * @param yi the row relative to the center
+ * @param x_min first pixel of the ring in the row relative to the center
+ * @param x_max last pixel of the ring in the row relative to the center
+ * @param ranges parts of the arc in the quadrant
+ * @param range_cnt number of parts
+ * @param mask the arc will be drawn only in this mask
+ * @param color color of the arc
+ * @param opa opacity of the arc
+ */
+static void row_spans(lv_coord_t x_ofs, lv_coord_t y_ofs, lv_coord_t yi, lv_coord_t x_min, lv_coord_t x_max,
+                      const arc_range_t * ranges, uint8_t range_cnt, const lv_area_t * mask, lv_color_t color,
+                      lv_opa_t opa)
+{
+    uint8_t i;
+    for(i = 0; i < range_cnt; i++) {
+        lv_coord_t x1 = x_min;
+        lv_coord_t x2 = x_max;
+
+        /*Keep the pixels not before the start ray and not after the end ray*/
+        ray_limit(ranges[i].start_sin, ranges[i].start_cos, yi, &x1, &x2);
+        ray_limit(-ranges[i].end_sin, -ranges[i].end_cos, yi, &x1, &x2);
+        if(x1 > x2) continue;
+
+        hor_line(x_ofs + x1, y_ofs + yi, mask, x2 - x1, color, opa);
     }
-    degree += comp; // degree is now accurate to +/- 1 degree!
-
-    // Invert degree if it was X>Y octant, makes 0-45 into 90-45
-    if(negflag & 0x10) degree = (90 - degree);
-
-    // 3. Degree is now 0-90 range for this quadrant,
-    // need to invert it for whichever quadrant it was in
-    if(negflag & 0x02) {   // if -Y
-        if(negflag & 0x01) // if -Y -X
-            degree = (180 + degree);
-        else // else is -Y +X
-            degree = (180 - degree);
-    } else {               // else is +Y
-        if(negflag & 0x01) // if +Y -X
-            degree = (360 - degree);
+}
+
+/**
+ * Limit a row to the pixels whose angle is not smaller than a ray's.
+ * A pixel (x;y) is on that side if `x * cos - y * sin >= 0` (both angles in the same quadrant)
+ * @param sin_val sine of the ray's angle
+ * @param cos_val cosine of the ray's angle
+ * @param yi the row relative to the center
+ * @param x_min first pixel of the row. Will be updated.
+ * @param x_max last pixel of the row. Will be updated.
+ */
+static void ray_limit(int32_t sin_val, int32_t cos_val, lv_coord_t yi, lv_coord_t * x_min, lv_coord_t * x_max)
+{
+    int32_t ys = (int32_t)yi * sin_val;
+
+    if(cos_val > 0) {
+        int32_t x = -div_floor(-ys, cos_val);
+        if(x > *x_min) *x_min = x > LV_COORD_MAX ? LV_COORD_MAX : x;
+    } else if(cos_val < 0) {
+        int32_t x = div_floor(-ys, -cos_val);
+        if(x < *x_max) *x_max = x < LV_COORD_MIN ? LV_COORD_MIN : x;
+    } else if(ys > 0) {
+        *x_max = *x_min - 1; /*The ray is horizontal and the whole row is on the other side*/
     }
-    return degree;
 }
 
-/**********************
- *   STATIC FUNCTIONS
- **********************/
+/**
+ * Divide and round towards minus infinity
+ * @param a the dividend
+ * @param b the divisor (positive)
+ * @return `floor(a / b)`
+ */
+static int32_t div_floor(int32_t a, int32_t b)
+{
+    if(a >= 0) return a / b;
+
+    return -((-a + b - 1) / b);
+}
+
 static void ver_line(lv_coord_t x, lv_coord_t y, const lv_area_t * mask, lv_coord_t len, lv_color_t color, lv_opa_t opa)
 {
     lv_area_t area;
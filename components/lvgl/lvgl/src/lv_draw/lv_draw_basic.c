@@ -18,6 +18,7 @@
 
 #include <stddef.h>
 #include "lv_draw.h"
+#include "lv_glyph_cache.h"
 
 /*********************
  *      INCLUDES
@@ -34,9 +35,40 @@
 #define LV_ATTRIBUTE_MEM_ALIGN
 #endif
 
+/* The pixel loops are written once as kernels taking the kind of destination as a constant
+ * (`DRAW_DEST_...`). They are always inlined into a `switch` on the destination, so every case
+ * is compiled into its own loop without checking `set_px_cb` or the screen transparency per pixel*/
+#if defined(__GNUC__)
+#define DRAW_KERNEL static inline __attribute__((always_inline))
+#else
+#define DRAW_KERNEL static inline
+#endif
+
+#define DRAW_DEST_VDB 0        /*Native VDB*/
+#define DRAW_DEST_PX_CB 1      /*Through the driver's `set_px_cb`*/
+#define DRAW_DEST_VDB_TRANSP 2 /*Native VDB of a transparent screen (only with 32 bit colors)*/
+
+/*With RGB565 colors fill and blend using 32 bit words: spread a pixel's channels apart
+ * to mix them with one multiply and store two pixels at a time*/
+#if LV_COLOR_DEPTH == 16 && LV_COLOR_16_SWAP == 0 && defined(__GNUC__)
+#define LV_DRAW_565_WORD 1
+#else
+#define LV_DRAW_565_WORD 0
+#endif
+
+#if LV_DRAW_565_WORD
+#define SPREAD_565_MASK LV_COLOR_SPREAD_MASK
+#define SPREAD_565(c) ((((uint32_t)(c)) | ((uint32_t)(c) << 16)) & SPREAD_565_MASK)
+#define JOIN_565(w) ((uint16_t)((w) | ((w) >> 16)))
+#endif
+
 /**********************
  *      TYPEDEFS
  **********************/
+#if LV_DRAW_565_WORD
+/*Two adjacent pixels, allowed to alias the `lv_color_t` buffer they are read from*/
+typedef uint32_t lv_color_pair_t __attribute__((__may_alias__));
+#endif
 
 /**********************
  *  STATIC PROTOTYPES
@@ -44,11 +76,48 @@
 static void sw_mem_blend(lv_color_t * dest, const lv_color_t * src, uint32_t length, lv_opa_t opa);
 static void sw_color_fill(lv_color_t * mem, lv_coord_t mem_width, const lv_area_t * fill_area, lv_color_t color,
                           lv_opa_t opa);
+static inline lv_color_t map_px_color(const uint8_t * px_p, bool alpha_byte);
+static uint8_t draw_dest_get(const lv_disp_t * disp);
+DRAW_KERNEL void letter_px_kernel(lv_disp_t * disp, lv_color_t * vdb_px, lv_coord_t x, lv_coord_t y, lv_color_t color,
+                                  lv_opa_t px_opa, const uint8_t dest);
+DRAW_KERNEL void letter_bitmap_kernel(lv_disp_t * disp, const lv_font_glyph_dsc_t * g, const uint8_t * map_p,
+                                      const uint8_t * bpp_opa_table, uint8_t bitmask_init,
+                                      const lv_area_t * rows_cols, lv_coord_t pos_x, lv_coord_t pos_y,
+                                      lv_color_t color, lv_opa_t opa, const uint8_t dest);
+DRAW_KERNEL void map_px_kernel(lv_disp_t * disp, const lv_area_t * masked_a, const uint8_t * map_p,
+                               lv_coord_t map_width, lv_opa_t opa, bool chroma_key, bool alpha_byte,
+                               lv_color_t recolor, lv_opa_t recolor_opa, const uint8_t dest);
+static void map_row_chroma(lv_color_t * dest, const lv_color_t * src, lv_coord_t length, lv_opa_t opa,
+                           lv_color_t chroma);
+static void map_row_alpha(lv_color_t * dest, const uint8_t * src, lv_coord_t length, lv_opa_t opa, bool chroma_key,
+                          lv_color_t chroma);
+static void map_row_recolor(lv_color_t * dest, const uint8_t * src, lv_coord_t length, lv_opa_t opa, bool alpha_byte,
+                            bool chroma_key, lv_color_t chroma, lv_color_t recolor, lv_opa_t recolor_opa);
 
 #if LV_COLOR_DEPTH == 32 && LV_COLOR_SCREEN_TRANSP
 static inline lv_color_t color_mix_2_alpha(lv_color_t bg_color, lv_opa_t bg_opa, lv_color_t fg_color, lv_opa_t fg_opa);
 #endif
 
+#if LV_GLYPH_CACHE_MEM_SIZE
+static void draw_letter_mask(const lv_point_t * pos_p, const lv_area_t * mask_p, const lv_font_t * font_p,
+                             const lv_glyph_cache_entry_t * glyph, lv_color_t color, lv_opa_t opa);
+DRAW_KERNEL void letter_mask_kernel(lv_disp_t * disp, const lv_font_glyph_dsc_t * g, const uint8_t * map_p,
+                                    const lv_area_t * rows_cols, lv_coord_t pos_x, lv_coord_t pos_y, lv_color_t color,
+                                    lv_opa_t opa, const uint8_t dest);
+#endif
+
+static void report_draw(lv_disp_t * disp, lv_disp_draw_type_t type, const lv_area_t * area, lv_color_t color,
+                        lv_opa_t opa);
+static void report_letter(lv_disp_t * disp, lv_coord_t pos_x, lv_coord_t pos_y, const lv_area_t * mask_p,
+                          const lv_font_t * font_p, uint32_t letter, const lv_font_glyph_dsc_t * g, lv_color_t color,
+                          lv_opa_t opa);
+
+#if LV_DRAW_565_WORD
+static inline uint16_t mix_565(uint32_t fg_term, uint16_t bg, uint32_t bg_mix);
+static void fill_565(lv_color_t * mem, uint32_t length, lv_color_t color);
+static void fill_565_opa(lv_color_t * mem, uint32_t length, lv_color_t color, lv_opa_t opa);
+#endif
+
 /**********************
  *  STATIC VARIABLES
  **********************/
@@ -84,6 +153,12 @@ void lv_draw_px(lv_coord_t x, lv_coord_t y, const lv_area_t * mask_p, lv_color_t
     lv_disp_buf_t * vdb = lv_disp_get_buf(disp);
     uint32_t vdb_width  = lv_area_get_width(&vdb->area);
 
+    if(disp->driver.draw_cb) {
+        lv_area_t px_a;
+        lv_area_set(&px_a, x, y, x, y);
+        report_draw(disp, LV_DISP_DRAW_PX, &px_a, color, opa);
+    }
+
     /*Make the coordinates relative to VDB*/
     x -= vdb->area.x1;
     y -= vdb->area.y1;
@@ -141,6 +216,8 @@ void lv_draw_fill(const lv_area_t * cords_p, const lv_area_t * mask_p, lv_color_
     lv_disp_t * disp    = lv_refr_get_disp_refreshing();
     lv_disp_buf_t * vdb = lv_disp_get_buf(disp);
 
+    if(disp->driver.draw_cb) report_draw(disp, LV_DISP_DRAW_FILL, &res_a, color, opa);
+
     lv_area_t vdb_rel_a; /*Stores relative coordinates on vdb*/
     vdb_rel_a.x1 = res_a.x1 - vdb->area.x1;
     vdb_rel_a.y1 = res_a.y1 - vdb->area.y1;
@@ -248,6 +325,15 @@ void lv_draw_letter(const lv_point_t * pos_p, const lv_area_t * mask_p, const lv
         return;
     }
 
+#if LV_GLYPH_CACHE_MEM_SIZE
+    /*Draw from the expanded mask if the glyph is or can be cached*/
+    const lv_glyph_cache_entry_t * glyph = lv_glyph_cache_get(font_p, letter);
+    if(glyph) {
+        draw_letter_mask(pos_p, mask_p, font_p, glyph, color, opa);
+        return;
+    }
+#endif
+
     lv_font_glyph_dsc_t g;
     bool g_ret = lv_font_get_glyph_dsc(font_p, &g, letter, '\0');
     if(g_ret == false) return;
@@ -257,7 +343,6 @@ void lv_draw_letter(const lv_point_t * pos_p, const lv_area_t * mask_p, const lv
 
     const uint8_t * bpp_opa_table;
     uint8_t bitmask_init;
-    uint8_t bitmask;
 
     switch(g.bpp) {
         case 1:
@@ -286,89 +371,32 @@ void lv_draw_letter(const lv_point_t * pos_p, const lv_area_t * mask_p, const lv
     /*If the letter is completely out of mask don't draw it */
     if(pos_x + g.box_w < mask_p->x1 || pos_x > mask_p->x2 || pos_y + g.box_h < mask_p->y1 || pos_y > mask_p->y2) return;
 
-    lv_disp_t * disp    = lv_refr_get_disp_refreshing();
-    lv_disp_buf_t * vdb = lv_disp_get_buf(disp);
-
-    lv_coord_t vdb_width     = lv_area_get_width(&vdb->area);
-    lv_color_t * vdb_buf_tmp = vdb->buf_act;
-    lv_coord_t col, row;
+    lv_disp_t * disp = lv_refr_get_disp_refreshing();
 
-    uint8_t width_byte_scr = g.box_w >> 3; /*Width in bytes (on the screen finally) (e.g. w = 11 -> 2 bytes wide)*/
-    if(g.box_w & 0x7) width_byte_scr++;
-    uint16_t width_bit = g.box_w * g.bpp; /*Letter width in bits*/
+    if(disp->driver.draw_cb) report_letter(disp, pos_x, pos_y, mask_p, font_p, letter, &g, color, opa);
 
     /* Calculate the col/row start/end on the map*/
-    lv_coord_t col_start = pos_x >= mask_p->x1 ? 0 : mask_p->x1 - pos_x;
-    lv_coord_t col_end   = pos_x + g.box_w <= mask_p->x2 ? g.box_w : mask_p->x2 - pos_x + 1;
-    lv_coord_t row_start = pos_y >= mask_p->y1 ? 0 : mask_p->y1 - pos_y;
-    lv_coord_t row_end   = pos_y + g.box_h <= mask_p->y2 ? g.box_h : mask_p->y2 - pos_y + 1;
-
-    /*Set a pointer on VDB to the first pixel of the letter*/
-    vdb_buf_tmp += ((pos_y - vdb->area.y1) * vdb_width) + pos_x - vdb->area.x1;
-
-    /*If the letter is partially out of mask the move there on VDB*/
-    vdb_buf_tmp += (row_start * vdb_width) + col_start;
-
-    /*Move on the map too*/
-    uint32_t bit_ofs = (row_start * width_bit) + (col_start * g.bpp);
-    map_p += bit_ofs >> 3;
-
-    uint8_t letter_px;
-    lv_opa_t px_opa;
-    uint16_t col_bit;
-    col_bit = bit_ofs & 0x7; /* "& 0x7" equals to "% 8" just faster */
-
-    bool scr_transp = false;
-#if LV_COLOR_DEPTH == 32 && LV_COLOR_SCREEN_TRANSP
-    scr_transp = disp->driver.screen_transp;
-#endif
-
-    for(row = row_start; row < row_end; row++) {
-        bitmask = bitmask_init >> col_bit;
-        for(col = col_start; col < col_end; col++) {
-            letter_px = (*map_p & bitmask) >> (8 - col_bit - g.bpp);
-            if(letter_px != 0) {
-                if(opa == LV_OPA_COVER) {
-                    px_opa = g.bpp == 8 ? letter_px : bpp_opa_table[letter_px];
-                } else {
-                    px_opa = g.bpp == 8 ? (uint16_t)((uint16_t)letter_px * opa) >> 8
-                                        : (uint16_t)((uint16_t)bpp_opa_table[letter_px] * opa) >> 8;
-                }
-
-                if(disp->driver.set_px_cb) {
-                    disp->driver.set_px_cb(&disp->driver, (uint8_t *)vdb->buf_act, vdb_width,
-                                           (col + pos_x) - vdb->area.x1, (row + pos_y) - vdb->area.y1, color, px_opa);
-                } else if(vdb_buf_tmp->full != color.full) {
-                    if(px_opa > LV_OPA_MAX)
-                        *vdb_buf_tmp = color;
-                    else if(px_opa > LV_OPA_MIN) {
-                        if(scr_transp == false) {
-                            *vdb_buf_tmp = lv_color_mix(color, *vdb_buf_tmp, px_opa);
-                        } else {
+    lv_area_t rows_cols;
+    rows_cols.x1 = pos_x >= mask_p->x1 ? 0 : mask_p->x1 - pos_x;
+    rows_cols.x2 = (pos_x + g.box_w <= mask_p->x2 ? g.box_w : mask_p->x2 - pos_x + 1) - 1;
+    rows_cols.y1 = pos_y >= mask_p->y1 ? 0 : mask_p->y1 - pos_y;
+    rows_cols.y2 = (pos_y + g.box_h <= mask_p->y2 ? g.box_h : mask_p->y2 - pos_y + 1) - 1;
+
+    switch(draw_dest_get(disp)) {
+        case DRAW_DEST_PX_CB:
+            letter_bitmap_kernel(disp, &g, map_p, bpp_opa_table, bitmask_init, &rows_cols, pos_x, pos_y, color, opa,
+                                 DRAW_DEST_PX_CB);
+            break;
 #if LV_COLOR_DEPTH == 32 && LV_COLOR_SCREEN_TRANSP
-                            *vdb_buf_tmp = color_mix_2_alpha(*vdb_buf_tmp, (*vdb_buf_tmp).ch.alpha, color, px_opa);
+        case DRAW_DEST_VDB_TRANSP:
+            letter_bitmap_kernel(disp, &g, map_p, bpp_opa_table, bitmask_init, &rows_cols, pos_x, pos_y, color, opa,
+                                 DRAW_DEST_VDB_TRANSP);
+            break;
 #endif
-                        }
-                    }
-                }
-            }
-
-            vdb_buf_tmp++;
-
-            if(col_bit < 8 - g.bpp) {
-                col_bit += g.bpp;
-                bitmask = bitmask >> g.bpp;
-            } else {
-                col_bit = 0;
-                bitmask = bitmask_init;
-                map_p++;
-            }
-        }
-        col_bit += ((g.box_w - col_end) + col_start) * g.bpp;
-
-        map_p += (col_bit >> 3);
-        col_bit = col_bit & 0x7;
-        vdb_buf_tmp += vdb_width - (col_end - col_start); /*Next row in VDB*/
+        default:
+            letter_bitmap_kernel(disp, &g, map_p, bpp_opa_table, bitmask_init, &rows_cols, pos_x, pos_y, color, opa,
+                                 DRAW_DEST_VDB);
+            break;
     }
 }
 
@@ -416,6 +444,8 @@ void lv_draw_map(const lv_area_t * cords_p, const lv_area_t * mask_p, const uint
     lv_disp_t * disp    = lv_refr_get_disp_refreshing();
     lv_disp_buf_t * vdb = lv_disp_get_buf(disp);
 
+    if(disp->driver.draw_cb) report_draw(disp, LV_DISP_DRAW_MAP, &masked_a, recolor, opa);
+
     /*Stores coordinates relative to the current VDB*/
     masked_a.x1 = masked_a.x1 - vdb->area.x1;
     masked_a.y1 = masked_a.y1 - vdb->area.y1;
@@ -468,94 +498,380 @@ void lv_draw_map(const lv_area_t * cords_p, const lv_area_t * mask_p, const uint
         }
     }
 
+    /*Translucent plain pixels are mixed into the VDB a row at a time*/
+    else if(chroma_key == false && alpha_byte == false && recolor_opa == LV_OPA_TRANSP &&
+            disp->driver.set_px_cb == NULL && scr_transp == false) {
+        for(row = masked_a.y1; row <= masked_a.y2; row++) {
+#if LV_USE_GPU
+            if(disp->driver.gpu_blend_cb == false) {
+                sw_mem_blend(vdb_buf_tmp, (lv_color_t *)map_p, map_useful_w, opa);
+            } else {
+                disp->driver.gpu_blend_cb(&disp->driver, vdb_buf_tmp, (lv_color_t *)map_p, map_useful_w, opa);
+            }
+#else
+            sw_mem_blend(vdb_buf_tmp, (lv_color_t *)map_p, map_useful_w, opa);
+#endif
+            map_p += map_width * px_size_byte; /*Next row on the map*/
+            vdb_buf_tmp += vdb_width;          /*Next row on the VDB*/
+        }
+    }
+
+    /* Chroma keyed, alpha and recolored maps on a native VDB: choose the matching row loop once
+     * instead of testing every case on every pixel*/
+    else if(disp->driver.set_px_cb == NULL && scr_transp == false) {
+        for(row = masked_a.y1; row <= masked_a.y2; row++) {
+            if(recolor_opa != LV_OPA_TRANSP) {
+                map_row_recolor(vdb_buf_tmp, map_p, map_useful_w, opa, alpha_byte, chroma_key,
+                                disp->driver.color_chroma_key, recolor, recolor_opa);
+            } else if(alpha_byte) {
+                map_row_alpha(vdb_buf_tmp, map_p, map_useful_w, opa, chroma_key, disp->driver.color_chroma_key);
+            } else {
+                map_row_chroma(vdb_buf_tmp, (const lv_color_t *)map_p, map_useful_w, opa,
+                               disp->driver.color_chroma_key);
+            }
+
+            map_p += map_width * px_size_byte; /*Next row on the map*/
+            vdb_buf_tmp += vdb_width;          /*Next row on the VDB*/
+        }
+    }
+
     /*In the other cases every pixel need to be checked one-by-one*/
+    else if(disp->driver.set_px_cb) {
+        map_px_kernel(disp, &masked_a, map_p, map_width, opa, chroma_key, alpha_byte, recolor, recolor_opa,
+                      DRAW_DEST_PX_CB);
+    }
+#if LV_COLOR_DEPTH == 32 && LV_COLOR_SCREEN_TRANSP
     else {
+        map_px_kernel(disp, &masked_a, map_p, map_width, opa, chroma_key, alpha_byte, recolor, recolor_opa,
+                      DRAW_DEST_VDB_TRANSP);
+    }
+#endif
+}
 
-        lv_coord_t col;
-        lv_color_t last_img_px  = LV_COLOR_BLACK;
-        lv_color_t recolored_px = lv_color_mix(recolor, last_img_px, recolor_opa);
-        for(row = masked_a.y1; row <= masked_a.y2; row++) {
-            for(col = 0; col < map_useful_w; col++) {
-                lv_opa_t opa_result  = opa;
-                uint8_t * px_color_p = (uint8_t *)&map_p[(uint32_t)col * px_size_byte];
-                lv_color_t px_color;
+/**********************
+ *   STATIC FUNCTIONS
+ **********************/
+
+/**
+ * Read a pixel's color from a map
+ * @param px_p pointer to the pixel
+ * @param alpha_byte true: the pixel has an alpha byte too, so it might be unaligned
+ * @return the color of the pixel
+ */
+static inline lv_color_t map_px_color(const uint8_t * px_p, bool alpha_byte)
+{
+    lv_color_t px_color;
+
+    if(alpha_byte == false) return *((const lv_color_t *)px_p);
 
-                /*Calculate with the pixel level alpha*/
-                if(alpha_byte) {
 #if LV_COLOR_DEPTH == 8 || LV_COLOR_DEPTH == 1
-                    px_color.full = px_color_p[0];
+    px_color.full = px_p[0];
 #elif LV_COLOR_DEPTH == 16
-                    /*Because of Alpha byte 16 bit color can start on odd address which can cause
-                     * crash*/
-                    px_color.full = px_color_p[0] + (px_color_p[1] << 8);
+    /*Because of Alpha byte 16 bit color can start on odd address which can cause crash*/
+    px_color.full = px_p[0] + (px_p[1] << 8);
 #elif LV_COLOR_DEPTH == 32
-                    px_color = *((lv_color_t *)px_color_p);
+    px_color = *((const lv_color_t *)px_p);
 #endif
-                    lv_opa_t px_opa = *(px_color_p + LV_IMG_PX_SIZE_ALPHA_BYTE - 1);
-                    if(px_opa == LV_OPA_TRANSP)
-                        continue;
-                    else if(px_opa != LV_OPA_COVER)
-                        opa_result = (uint32_t)((uint32_t)px_opa * opa_result) >> 8;
-                } else {
-                    px_color = *((lv_color_t *)px_color_p);
-                }
 
-                /*Handle chroma key*/
-                if(chroma_key && px_color.full == disp->driver.color_chroma_key.full) continue;
+    return px_color;
+}
+
+/**
+ * Get the kind of destination the draw kernels need to write
+ * @param disp the display being refreshed
+ * @return a `DRAW_DEST_...` constant
+ */
+static uint8_t draw_dest_get(const lv_disp_t * disp)
+{
+    if(disp->driver.set_px_cb) return DRAW_DEST_PX_CB;
 
-                /*Re-color the pixel if required*/
-                if(recolor_opa != LV_OPA_TRANSP) {
-                    if(last_img_px.full != px_color.full) { /*Minor acceleration: calculate only for
-                                                               new colors (save the last)*/
-                        last_img_px  = px_color;
-                        recolored_px = lv_color_mix(recolor, last_img_px, recolor_opa);
-                    }
-                    /*Handle custom VDB write is present*/
-                    if(disp->driver.set_px_cb) {
-                        disp->driver.set_px_cb(&disp->driver, (uint8_t *)vdb->buf_act, vdb_width, col + masked_a.x1,
-                                               row, recolored_px, opa_result);
-                    }
-                    /*Normal native VDB write*/
-                    else {
-                        if(opa_result == LV_OPA_COVER)
-                            vdb_buf_tmp[col].full = recolored_px.full;
-                        else
-                            vdb_buf_tmp[col] = lv_color_mix(recolored_px, vdb_buf_tmp[col], opa_result);
-                    }
-                } else {
-                    /*Handle custom VDB write is present*/
-                    if(disp->driver.set_px_cb) {
-                        disp->driver.set_px_cb(&disp->driver, (uint8_t *)vdb->buf_act, vdb_width, col + masked_a.x1,
-                                               row, px_color, opa_result);
-                    }
-                    /*Normal native VDB write*/
-                    else {
-
-                        if(opa_result == LV_OPA_COVER)
-                            vdb_buf_tmp[col] = px_color;
-                        else {
-                            if(scr_transp == false) {
-                                vdb_buf_tmp[col] = lv_color_mix(px_color, vdb_buf_tmp[col], opa_result);
-                            } else {
 #if LV_COLOR_DEPTH == 32 && LV_COLOR_SCREEN_TRANSP
-                                vdb_buf_tmp[col] = color_mix_2_alpha(vdb_buf_tmp[col], vdb_buf_tmp[col].ch.alpha,
-                                                                     px_color, opa_result);
+    if(disp->driver.screen_transp) return DRAW_DEST_VDB_TRANSP;
 #endif
-                            }
-                        }
-                    }
+
+    return DRAW_DEST_VDB;
+}
+
+/**
+ * Draw a pixel of a letter
+ * @param disp the display being refreshed
+ * @param vdb_px pointer to the pixel in the VDB
+ * @param x x coordinate of the pixel relative to the VDB
+ * @param y y coordinate of the pixel relative to the VDB
+ * @param color color of letter
+ * @param px_opa opacity of the pixel
+ * @param dest a `DRAW_DEST_...` constant
+ */
+DRAW_KERNEL void letter_px_kernel(lv_disp_t * disp, lv_color_t * vdb_px, lv_coord_t x, lv_coord_t y, lv_color_t color,
+                                  lv_opa_t px_opa, const uint8_t dest)
+{
+    if(dest == DRAW_DEST_PX_CB) {
+        lv_disp_buf_t * vdb = lv_disp_get_buf(disp);
+        disp->driver.set_px_cb(&disp->driver, (uint8_t *)vdb->buf_act, lv_area_get_width(&vdb->area), x, y, color,
+                               px_opa);
+        return;
+    }
+
+    if(vdb_px->full == color.full) return;
+
+    if(px_opa > LV_OPA_MAX) {
+        *vdb_px = color;
+    } else if(px_opa > LV_OPA_MIN) {
+        if(dest == DRAW_DEST_VDB) {
+            *vdb_px = lv_color_mix(color, *vdb_px, px_opa);
+        } else {
+#if LV_COLOR_DEPTH == 32 && LV_COLOR_SCREEN_TRANSP
+            *vdb_px = color_mix_2_alpha(*vdb_px, (*vdb_px).ch.alpha, color, px_opa);
+#endif
+        }
+    }
+}
+
+/**
+ * Draw the pixels of a letter from its bitmap. The kernel of `lv_draw_letter`.
+ * @param disp the display being refreshed
+ * @param g descriptor of the glyph
+ * @param map_p the bitmap of the glyph
+ * @param bpp_opa_table maps the pixels' value to opacity (NULL with 8 bpp)
+ * @param bitmask_init mask of the first pixel of a byte
+ * @param rows_cols the rows and columns of the glyph to draw (in the bitmap)
+ * @param pos_x x coordinate of the glyph's left-top corner
+ * @param pos_y y coordinate of the glyph's left-top corner
+ * @param color color of letter
+ * @param opa opacity of letter
+ * @param dest a `DRAW_DEST_...` constant
+ */
+DRAW_KERNEL void letter_bitmap_kernel(lv_disp_t * disp, const lv_font_glyph_dsc_t * g, const uint8_t * map_p,
+                                      const uint8_t * bpp_opa_table, uint8_t bitmask_init,
+                                      const lv_area_t * rows_cols, lv_coord_t pos_x, lv_coord_t pos_y,
+                                      lv_color_t color, lv_opa_t opa, const uint8_t dest)
+{
+    lv_disp_buf_t * vdb      = lv_disp_get_buf(disp);
+    lv_coord_t vdb_width     = lv_area_get_width(&vdb->area);
+    lv_coord_t vdb_x         = pos_x - vdb->area.x1;
+    lv_coord_t vdb_y         = pos_y - vdb->area.y1;
+    lv_color_t * vdb_buf_tmp = vdb->buf_act;
+    lv_coord_t col_start     = rows_cols->x1;
+    lv_coord_t col_end       = rows_cols->x2 + 1;
+    lv_coord_t col, row;
+
+    uint16_t width_bit = g->box_w * g->bpp; /*Letter width in bits*/
+
+    /*Set a pointer on VDB to the first pixel of the letter which is in the mask*/
+    vdb_buf_tmp += ((vdb_y + rows_cols->y1) * vdb_width) + vdb_x + col_start;
+
+    /*Move on the map too*/
+    uint32_t bit_ofs = (rows_cols->y1 * width_bit) + (col_start * g->bpp);
+    map_p += bit_ofs >> 3;
+
+    uint8_t letter_px;
+    lv_opa_t px_opa;
+    uint8_t bitmask;
+    uint16_t col_bit;
+    col_bit = bit_ofs & 0x7; /* "& 0x7" equals to "% 8" just faster */
+
+    for(row = rows_cols->y1; row <= rows_cols->y2; row++) {
+        bitmask = bitmask_init >> col_bit;
+        for(col = col_start; col < col_end; col++) {
+            letter_px = (*map_p & bitmask) >> (8 - col_bit - g->bpp);
+            if(letter_px != 0) {
+                if(opa == LV_OPA_COVER) {
+                    px_opa = g->bpp == 8 ? letter_px : bpp_opa_table[letter_px];
+                } else {
+                    px_opa = g->bpp == 8 ? (uint16_t)((uint16_t)letter_px * opa) >> 8
+                                         : (uint16_t)((uint16_t)bpp_opa_table[letter_px] * opa) >> 8;
                 }
+
+                letter_px_kernel(disp, vdb_buf_tmp, col + vdb_x, row + vdb_y, color, px_opa, dest);
             }
 
-            map_p += map_width * px_size_byte; /*Next row on the map*/
-            vdb_buf_tmp += vdb_width;          /*Next row on the VDB*/
+            vdb_buf_tmp++;
+
+            if(col_bit < 8 - g->bpp) {
+                col_bit += g->bpp;
+                bitmask = bitmask >> g->bpp;
+            } else {
+                col_bit = 0;
+                bitmask = bitmask_init;
+                map_p++;
+            }
         }
+        col_bit += ((g->box_w - col_end) + col_start) * g->bpp;
+
+        map_p += (col_bit >> 3);
+        col_bit = col_bit & 0x7;
+        vdb_buf_tmp += vdb_width - (col_end - col_start); /*Next row in VDB*/
     }
 }
 
-/**********************
- *   STATIC FUNCTIONS
- **********************/
+/**
+ * Draw a map pixel by pixel. The kernel of `lv_draw_map` for `set_px_cb` and transparent screens.
+ * @param disp the display being refreshed
+ * @param masked_a the area to draw relative to the VDB
+ * @param map_p pointer to the first pixel to draw in the map
+ * @param map_width width of the map
+ * @param opa opacity of the map
+ * @param chroma_key true: skip the pixels with the chroma key color
+ * @param alpha_byte true: extra alpha byte is inserted for every pixel
+ * @param recolor mix the pixels with this color
+ * @param recolor_opa the intense of recoloring
+ * @param dest a `DRAW_DEST_...` constant
+ */
+DRAW_KERNEL void map_px_kernel(lv_disp_t * disp, const lv_area_t * masked_a, const uint8_t * map_p,
+                               lv_coord_t map_width, lv_opa_t opa, bool chroma_key, bool alpha_byte,
+                               lv_color_t recolor, lv_opa_t recolor_opa, const uint8_t dest)
+{
+    lv_disp_buf_t * vdb      = lv_disp_get_buf(disp);
+    lv_coord_t vdb_width     = lv_area_get_width(&vdb->area);
+    lv_color_t * vdb_buf_tmp = vdb->buf_act + (uint32_t)vdb_width * masked_a->y1 + masked_a->x1;
+    uint8_t px_size_byte     = alpha_byte ? LV_IMG_PX_SIZE_ALPHA_BYTE : sizeof(lv_color_t);
+    lv_coord_t map_useful_w  = lv_area_get_width(masked_a);
+    lv_coord_t row;
+    lv_coord_t col;
+
+    lv_color_t last_img_px  = LV_COLOR_BLACK;
+    lv_color_t recolored_px = lv_color_mix(recolor, last_img_px, recolor_opa);
+    for(row = masked_a->y1; row <= masked_a->y2; row++) {
+        for(col = 0; col < map_useful_w; col++) {
+            lv_opa_t opa_result        = opa;
+            const uint8_t * px_color_p = &map_p[(uint32_t)col * px_size_byte];
+            lv_color_t px_color        = map_px_color(px_color_p, alpha_byte);
+
+            /*Calculate with the pixel level alpha*/
+            if(alpha_byte) {
+                lv_opa_t px_opa = *(px_color_p + LV_IMG_PX_SIZE_ALPHA_BYTE - 1);
+                if(px_opa == LV_OPA_TRANSP)
+                    continue;
+                else if(px_opa != LV_OPA_COVER)
+                    opa_result = (uint32_t)((uint32_t)px_opa * opa_result) >> 8;
+            }
+
+            /*Handle chroma key*/
+            if(chroma_key && px_color.full == disp->driver.color_chroma_key.full) continue;
+
+            /*Re-color the pixel if required*/
+            if(recolor_opa != LV_OPA_TRANSP) {
+                if(last_img_px.full != px_color.full) { /*Minor acceleration: calculate only for
+                                                           new colors (save the last)*/
+                    last_img_px  = px_color;
+                    recolored_px = lv_color_mix(recolor, last_img_px, recolor_opa);
+                }
+                px_color = recolored_px;
+            }
+
+            if(dest == DRAW_DEST_PX_CB) {
+                disp->driver.set_px_cb(&disp->driver, (uint8_t *)vdb->buf_act, vdb_width, col + masked_a->x1, row,
+                                       px_color, opa_result);
+            } else if(opa_result == LV_OPA_COVER) {
+                vdb_buf_tmp[col] = px_color;
+            } else if(dest == DRAW_DEST_VDB || recolor_opa != LV_OPA_TRANSP) {
+                vdb_buf_tmp[col] = lv_color_mix(px_color, vdb_buf_tmp[col], opa_result);
+            } else {
+#if LV_COLOR_DEPTH == 32 && LV_COLOR_SCREEN_TRANSP
+                vdb_buf_tmp[col] = color_mix_2_alpha(vdb_buf_tmp[col], vdb_buf_tmp[col].ch.alpha, px_color, opa_result);
+#endif
+            }
+        }
+
+        map_p += map_width * px_size_byte; /*Next row on the map*/
+        vdb_buf_tmp += vdb_width;          /*Next row on the VDB*/
+    }
+}
+
+/**
+ * Draw a row of a chroma keyed map: copy or blend the runs between the chroma keyed pixels
+ * @param dest pointer to the first pixel in the VDB
+ * @param src pointer to the first pixel of the map
+ * @param length number of pixels
+ * @param opa opacity of the map
+ * @param chroma the chroma key color
+ */
+static void map_row_chroma(lv_color_t * dest, const lv_color_t * src, lv_coord_t length, lv_opa_t opa,
+                           lv_color_t chroma)
+{
+    lv_coord_t col = 0;
+    while(col < length) {
+        /*Skip the keyed pixels, then find the end of the run*/
+        while(col < length && src[col].full == chroma.full) col++;
+        lv_coord_t run_start = col;
+        while(col < length && src[col].full != chroma.full) col++;
+
+        if(col > run_start) sw_mem_blend(&dest[run_start], &src[run_start], col - run_start, opa);
+    }
+}
+
+/**
+ * Draw a row of a map with alpha byte
+ * @param dest pointer to the first pixel in the VDB
+ * @param src pointer to the first pixel of the map
+ * @param length number of pixels
+ * @param opa opacity of the map
+ * @param chroma_key true: skip the pixels with `chroma` color too
+ * @param chroma the chroma key color
+ */
+static void map_row_alpha(lv_color_t * dest, const uint8_t * src, lv_coord_t length, lv_opa_t opa, bool chroma_key,
+                          lv_color_t chroma)
+{
+    lv_coord_t col;
+    for(col = 0; col < length; col++, src += LV_IMG_PX_SIZE_ALPHA_BYTE) {
+        lv_opa_t px_opa = src[LV_IMG_PX_SIZE_ALPHA_BYTE - 1];
+        if(px_opa == LV_OPA_TRANSP) continue;
+
+        lv_color_t px_color = map_px_color(src, true);
+        if(chroma_key && px_color.full == chroma.full) continue;
+
+        if(px_opa != LV_OPA_COVER) px_opa = (uint32_t)((uint32_t)px_opa * opa) >> 8;
+        else px_opa = opa;
+
+        if(px_opa == LV_OPA_COVER)
+            dest[col] = px_color;
+        else
+            dest[col] = lv_color_mix(px_color, dest[col], px_opa);
+    }
+}
+
+/**
+ * Draw a row of a recolored map
+ * @param dest pointer to the first pixel in the VDB
+ * @param src pointer to the first pixel of the map
+ * @param length number of pixels
+ * @param opa opacity of the map
+ * @param alpha_byte true: the map has alpha byte too
+ * @param chroma_key true: skip the pixels with `chroma` color
+ * @param chroma the chroma key color
+ * @param recolor mix this color to the pixels
+ * @param recolor_opa the intensity of recoloring
+ */
+static void map_row_recolor(lv_color_t * dest, const uint8_t * src, lv_coord_t length, lv_opa_t opa, bool alpha_byte,
+                            bool chroma_key, lv_color_t chroma, lv_color_t recolor, lv_opa_t recolor_opa)
+{
+    uint8_t px_size_byte    = alpha_byte ? LV_IMG_PX_SIZE_ALPHA_BYTE : sizeof(lv_color_t);
+    lv_color_t last_img_px  = LV_COLOR_BLACK;
+    lv_color_t recolored_px = lv_color_mix(recolor, last_img_px, recolor_opa);
+    lv_coord_t col;
+    for(col = 0; col < length; col++, src += px_size_byte) {
+        lv_opa_t opa_result = opa;
+        if(alpha_byte) {
+            lv_opa_t px_opa = src[LV_IMG_PX_SIZE_ALPHA_BYTE - 1];
+            if(px_opa == LV_OPA_TRANSP) continue;
+            if(px_opa != LV_OPA_COVER) opa_result = (uint32_t)((uint32_t)px_opa * opa) >> 8;
+        }
+
+        lv_color_t px_color = map_px_color(src, alpha_byte);
+        if(chroma_key && px_color.full == chroma.full) continue;
+
+        /*Calculate only for new colors*/
+        if(last_img_px.full != px_color.full) {
+            last_img_px  = px_color;
+            recolored_px = lv_color_mix(recolor, last_img_px, recolor_opa);
+        }
+
+        if(opa_result == LV_OPA_COVER)
+            dest[col] = recolored_px;
+        else
+            dest[col] = lv_color_mix(recolored_px, dest[col], opa_result);
+    }
+}
 
 /**
  * Blend pixels to destination memory using opacity
@@ -569,10 +885,7 @@ static void sw_mem_blend(lv_color_t * dest, const lv_color_t * src, uint32_t len
     if(opa == LV_OPA_COVER) {
         memcpy(dest, src, length * sizeof(lv_color_t));
     } else {
-        uint32_t col;
-        for(col = 0; col < length; col++) {
-            dest[col] = lv_color_mix(src[col], dest[col], opa);
-        }
+        lv_color_mix_n(dest, src, length, opa);
     }
 }
 
@@ -605,9 +918,13 @@ static void sw_color_fill(lv_color_t * mem, lv_coord_t mem_width, const lv_area_
         if(opa == LV_OPA_COVER) {
 
             /*Fill the first row with 'color'*/
+#if LV_DRAW_565_WORD
+            fill_565(&mem[fill_area->x1], fill_area->x2 - fill_area->x1 + 1, color);
+#else
             for(col = fill_area->x1; col <= fill_area->x2; col++) {
                 mem[col] = color;
             }
+#endif
 
             /*Copy the first row to all other rows*/
             lv_color_t * mem_first = &mem[fill_area->x1];
@@ -626,6 +943,16 @@ static void sw_color_fill(lv_color_t * mem, lv_coord_t mem_width, const lv_area_
             scr_transp = disp->driver.screen_transp;
 #endif
 
+#if LV_DRAW_565_WORD
+            if(scr_transp == false) {
+                for(row = fill_area->y1; row <= fill_area->y2; row++) {
+                    fill_565_opa(&mem[fill_area->x1], fill_area->x2 - fill_area->x1 + 1, color, opa);
+                    mem += mem_width;
+                }
+                return;
+            }
+#endif
+
             lv_color_t bg_tmp  = LV_COLOR_BLACK;
             lv_color_t opa_tmp = lv_color_mix(color, bg_tmp, opa);
             for(row = fill_area->y1; row <= fill_area->y2; row++) {
@@ -651,6 +978,57 @@ static void sw_color_fill(lv_color_t * mem, lv_coord_t mem_width, const lv_area_
     }
 }
 
+/**
+ * Report a fill, pixel or map to the display driver's `draw_cb`
+ * @param disp the display being refreshed
+ * @param type the kind of primitive
+ * @param area the area drawn, in absolute coordinates
+ * @param color the color drawn
+ * @param opa the opacity it is drawn with
+ */
+static void report_draw(lv_disp_t * disp, lv_disp_draw_type_t type, const lv_area_t * area, lv_color_t color,
+                        lv_opa_t opa)
+{
+    lv_disp_draw_t draw;
+
+    memset(&draw, 0, sizeof(draw));
+    draw.type  = type;
+    draw.opa   = opa;
+    draw.color = color;
+    lv_area_copy(&draw.area, area);
+    disp->driver.draw_cb(&disp->driver, &draw);
+}
+
+/**
+ * Report a letter to the display driver's `draw_cb`
+ * @param disp the display being refreshed
+ * @param pos_x left of the glyph's box
+ * @param pos_y top of the glyph's box
+ * @param mask_p the letter is drawn only on this area
+ * @param font_p pointer to font
+ * @param letter the letter
+ * @param g the glyph's descriptor
+ * @param color color of letter
+ * @param opa opacity of letter
+ */
+static void report_letter(lv_disp_t * disp, lv_coord_t pos_x, lv_coord_t pos_y, const lv_area_t * mask_p,
+                          const lv_font_t * font_p, uint32_t letter, const lv_font_glyph_dsc_t * g, lv_color_t color,
+                          lv_opa_t opa)
+{
+    lv_disp_draw_t draw;
+
+    draw.type  = LV_DISP_DRAW_LETTER;
+    draw.opa   = opa;
+    draw.color = color;
+    lv_area_copy(&draw.area, mask_p);
+    draw.pos.x  = pos_x;
+    draw.pos.y  = pos_y;
+    draw.font   = font_p;
+    draw.letter = letter;
+    draw.glyph  = g;
+    disp->driver.draw_cb(&disp->driver, &draw);
+}
+
 #if LV_COLOR_DEPTH == 32 && LV_COLOR_SCREEN_TRANSP
 /**
  * Mix two colors. Both color can have alpha value. It requires ARGB888 colors.
@@ -705,3 +1083,172 @@ static inline lv_color_t color_mix_2_alpha(lv_color_t bg_color, lv_opa_t bg_opa,
     }
 }
 #endif
+
+#if LV_GLYPH_CACHE_MEM_SIZE
+/**
+ * Draw a letter from its cached opacity mask
+ * @param pos_p left-top coordinate of the latter
+ * @param mask_p the letter will be drawn only on this area  (truncated to VDB area)
+ * @param font_p pointer to font
+ * @param glyph the cached glyph
+ * @param color color of letter
+ * @param opa opacity of letter (0..255)
+ */
+static void draw_letter_mask(const lv_point_t * pos_p, const lv_area_t * mask_p, const lv_font_t * font_p,
+                             const lv_glyph_cache_entry_t * glyph, lv_color_t color, lv_opa_t opa)
+{
+    const lv_font_glyph_dsc_t * g = &glyph->dsc;
+
+    lv_coord_t pos_x = pos_p->x + g->ofs_x;
+    lv_coord_t pos_y = pos_p->y + (font_p->line_height - font_p->base_line) - g->box_h - g->ofs_y;
+
+    if(glyph->mask == NULL) return;
+
+    /*If the letter is completely out of mask don't draw it */
+    if(pos_x + g->box_w < mask_p->x1 || pos_x > mask_p->x2 || pos_y + g->box_h < mask_p->y1 || pos_y > mask_p->y2) return;
+
+    lv_disp_t * disp = lv_refr_get_disp_refreshing();
+
+    if(disp->driver.draw_cb) report_letter(disp, pos_x, pos_y, mask_p, font_p, glyph->letter, g, color, opa);
+
+    /* Calculate the col/row start/end on the map*/
+    lv_area_t rows_cols;
+    rows_cols.x1 = pos_x >= mask_p->x1 ? 0 : mask_p->x1 - pos_x;
+    rows_cols.x2 = (pos_x + g->box_w <= mask_p->x2 ? g->box_w : mask_p->x2 - pos_x + 1) - 1;
+    rows_cols.y1 = pos_y >= mask_p->y1 ? 0 : mask_p->y1 - pos_y;
+    rows_cols.y2 = (pos_y + g->box_h <= mask_p->y2 ? g->box_h : mask_p->y2 - pos_y + 1) - 1;
+
+    switch(draw_dest_get(disp)) {
+        case DRAW_DEST_PX_CB:
+            letter_mask_kernel(disp, g, glyph->mask, &rows_cols, pos_x, pos_y, color, opa, DRAW_DEST_PX_CB);
+            break;
+#if LV_COLOR_DEPTH == 32 && LV_COLOR_SCREEN_TRANSP
+        case DRAW_DEST_VDB_TRANSP:
+            letter_mask_kernel(disp, g, glyph->mask, &rows_cols, pos_x, pos_y, color, opa, DRAW_DEST_VDB_TRANSP);
+            break;
+#endif
+        default:
+            letter_mask_kernel(disp, g, glyph->mask, &rows_cols, pos_x, pos_y, color, opa, DRAW_DEST_VDB);
+            break;
+    }
+}
+
+/**
+ * Draw the pixels of a cached letter mask. The kernel of `draw_letter_mask`.
+ * @param disp the display being refreshed
+ * @param g descriptor of the glyph
+ * @param map_p the opacity mask of the glyph
+ * @param rows_cols the rows and columns of the glyph to draw (in the mask)
+ * @param pos_x x coordinate of the glyph's left-top corner
+ * @param pos_y y coordinate of the glyph's left-top corner
+ * @param color color of letter
+ * @param opa opacity of letter
+ * @param dest a `DRAW_DEST_...` constant
+ */
+DRAW_KERNEL void letter_mask_kernel(lv_disp_t * disp, const lv_font_glyph_dsc_t * g, const uint8_t * map_p,
+                                    const lv_area_t * rows_cols, lv_coord_t pos_x, lv_coord_t pos_y, lv_color_t color,
+                                    lv_opa_t opa, const uint8_t dest)
+{
+    lv_disp_buf_t * vdb      = lv_disp_get_buf(disp);
+    lv_coord_t vdb_width     = lv_area_get_width(&vdb->area);
+    lv_coord_t vdb_x         = pos_x - vdb->area.x1;
+    lv_coord_t vdb_y         = pos_y - vdb->area.y1;
+    lv_color_t * vdb_buf_tmp = vdb->buf_act;
+    lv_coord_t col, row;
+
+    /*Set a pointer on VDB to the first pixel of the letter which is in the mask*/
+    vdb_buf_tmp += ((vdb_y + rows_cols->y1) * vdb_width) + vdb_x + rows_cols->x1;
+    map_p += rows_cols->y1 * g->box_w + rows_cols->x1;
+
+    for(row = rows_cols->y1; row <= rows_cols->y2; row++) {
+        for(col = rows_cols->x1; col <= rows_cols->x2; col++) {
+            lv_opa_t px_opa = map_p[col - rows_cols->x1];
+            if(px_opa != 0) {
+                if(opa != LV_OPA_COVER) px_opa = (uint16_t)((uint16_t)px_opa * opa) >> 8;
+                letter_px_kernel(disp, vdb_buf_tmp, col + vdb_x, row + vdb_y, color, px_opa, dest);
+            }
+
+            vdb_buf_tmp++;
+        }
+
+        map_p += g->box_w;
+        vdb_buf_tmp += vdb_width - lv_area_get_width(rows_cols); /*Next row in VDB*/
+    }
+}
+#endif
+
+#if LV_DRAW_565_WORD
+/**
+ * Mix an RGB565 foreground, already spread and multiplied by its 0..32 mix ratio, with
+ * a background color
+ * @param fg_term `SPREAD_565(fg) * mix`
+ * @param bg background color
+ * @param bg_mix `32 - mix`
+ * @return the mixed color
+ */
+static inline uint16_t mix_565(uint32_t fg_term, uint16_t bg, uint32_t bg_mix)
+{
+    uint32_t w = ((fg_term + SPREAD_565(bg) * bg_mix) >> 5) & SPREAD_565_MASK;
+    return JOIN_565(w);
+}
+
+/**
+ * Set pixels to a color storing two at a time
+ * @param mem pointer to the first pixel
+ * @param length number of pixels
+ * @param color fill color
+ */
+static void fill_565(lv_color_t * mem, uint32_t length, lv_color_t color)
+{
+    /*Store single pixels until the destination is word aligned*/
+    if(length && ((lv_uintptr_t)mem & 0x2)) {
+        *mem++ = color;
+        length--;
+    }
+
+    lv_color_pair_t * pair = (lv_color_pair_t *)mem;
+    lv_color_pair_t c2     = (uint32_t)color.full | ((uint32_t)color.full << 16);
+    uint32_t i;
+    for(i = 0; i < length / 2; i++) {
+        pair[i] = c2;
+    }
+
+    if(length & 0x1) mem[length - 1] = color;
+}
+
+/**
+ * Mix pixels with a color, two at a time. Runs of the same background are only mixed once.
+ * @param mem pointer to the first pixel
+ * @param length number of pixels
+ * @param color fill color
+ * @param opa opacity of 'color'
+ */
+static void fill_565_opa(lv_color_t * mem, uint32_t length, lv_color_t color, lv_opa_t opa)
+{
+    uint32_t mix     = ((uint32_t)opa + 4) >> 3;
+    uint32_t fg_term = SPREAD_565(color.full) * mix;
+    uint32_t bg_mix  = 32 - mix;
+
+    if(length && ((lv_uintptr_t)mem & 0x2)) {
+        mem->full = mix_565(fg_term, mem->full, bg_mix);
+        mem++;
+        length--;
+    }
+
+    lv_color_pair_t * pair = (lv_color_pair_t *)mem;
+    uint32_t bg2  = 0;
+    uint32_t res2 = (uint32_t)mix_565(fg_term, 0, bg_mix) * 0x10001;
+    uint32_t i;
+    for(i = 0; i < length / 2; i++) {
+        /*If the background changed recalculate the result*/
+        if(pair[i] != bg2) {
+            bg2  = pair[i];
+            res2 = (uint32_t)mix_565(fg_term, bg2 & 0xFFFF, bg_mix) |
+                   ((uint32_t)mix_565(fg_term, bg2 >> 16, bg_mix) << 16);
+        }
+        pair[i] = res2;
+    }
+
+    if(length & 0x1) mem[length - 1].full = mix_565(fg_term, mem[length - 1].full, bg_mix);
+}
+#endif
@@ -8,7 +8,9 @@
  *********************/
 #include "lv_draw_img.h"
 #include "lv_img_cache.h"
+#include "../lv_core/lv_refr.h"
 #include "../lv_misc/lv_log.h"
+#include <string.h>
 
 /*********************
  *      DEFINES
@@ -23,6 +25,8 @@
  **********************/
 static lv_res_t lv_img_draw_core(const lv_area_t * coords, const lv_area_t * mask, const void * src,
                                  const lv_style_t * style, lv_opa_t opa_scale);
+static void report_img(lv_disp_t * disp, const lv_area_t * coords, const lv_area_t * mask_com, const void * src,
+                       const lv_img_cache_entry_t * cdsc, const lv_style_t * style, lv_opa_t opa);
 
 /**********************
  *  STATIC VARIABLES
@@ -460,6 +464,19 @@ static lv_res_t lv_img_draw_core(const lv_area_t * coords, const lv_area_t * mas
     /* The decoder open could open the image and gave the entire uncompressed image.
      * Just draw it!*/
     else if(cdsc->dec_dsc.img_data) {
+        lv_disp_t * disp = lv_refr_get_disp_refreshing();
+        if(disp->driver.draw_cb) report_img(disp, coords, &mask_com, src, cdsc, style, opa);
+#if LV_IMG_CACHE_MEM_SIZE && LV_IMG_CACHE_RECOLOR
+        /*Draw recolored images from their kept recolored copy*/
+        if(style->image.intense != LV_OPA_TRANSP) {
+            const uint8_t * recolored =
+                lv_img_cache_get_recolored(cdsc, style->image.color, style->image.intense, disp->driver.color_chroma_key);
+            if(recolored) {
+                lv_draw_map(coords, mask, recolored, opa, chroma_keyed, alpha_byte, style->image.color, LV_OPA_TRANSP);
+                return LV_RES_OK;
+            }
+        }
+#endif
         lv_draw_map(coords, mask, cdsc->dec_dsc.img_data, opa, chroma_keyed, alpha_byte, style->image.color,
                     style->image.intense);
     }
@@ -492,3 +509,35 @@ static lv_res_t lv_img_draw_core(const lv_area_t * coords, const lv_area_t * mas
 
     return LV_RES_OK;
 }
+
+/**
+ * Report an image about to be drawn to the display driver's `draw_cb`
+ * @param disp the display being refreshed
+ * @param coords the coordinates of the image
+ * @param mask_com the part of the image drawn
+ * @param src the image's source
+ * @param cdsc the image opened from the cache, with its decoded pixels
+ * @param style style of the image
+ * @param opa opacity of the image
+ */
+static void report_img(lv_disp_t * disp, const lv_area_t * coords, const lv_area_t * mask_com, const void * src,
+                       const lv_img_cache_entry_t * cdsc, const lv_style_t * style, lv_opa_t opa)
+{
+    lv_disp_draw_t draw;
+
+    memset(&draw, 0, sizeof(draw));
+    draw.type         = LV_DISP_DRAW_IMG;
+    draw.opa          = opa > LV_OPA_MAX ? LV_OPA_COVER : opa;
+    draw.color        = style->image.color;
+    lv_area_copy(&draw.area, mask_com);
+    draw.pos.x        = coords->x1;
+    draw.pos.y        = coords->y1;
+    draw.src          = src;
+    draw.map          = cdsc->dec_dsc.img_data;
+    draw.size.x       = cdsc->dec_dsc.header.w;
+    draw.size.y       = cdsc->dec_dsc.header.h;
+    draw.recolor_opa  = style->image.intense;
+    draw.chroma_keyed = lv_img_color_format_is_chroma_keyed(cdsc->dec_dsc.header.cf);
+    draw.alpha_byte   = lv_img_color_format_has_alpha(cdsc->dec_dsc.header.cf);
+    disp->driver.draw_cb(&disp->driver, &draw);
+}
@@ -29,6 +29,10 @@ typedef uint8_t cmd_state_t;
  *  STATIC PROTOTYPES
  **********************/
 static uint8_t hex_char_to_num(char hex);
+#if LV_LABEL_LINE_CACHE
+static bool lines_match(const lv_draw_label_hint_t * hint, const char * txt, const lv_font_t * font,
+                        lv_coord_t letter_space, lv_txt_flag_t flag);
+#endif
 
 /**********************
  *  STATIC VARIABLES
@@ -63,7 +67,14 @@ void lv_draw_label(const lv_area_t * coords, const lv_area_t * mask, const lv_st
     if((flag & LV_TXT_FLAG_EXPAND) == 0) {
         /*Normally use the label's width as width*/
         w = lv_area_get_width(coords);
-    } else {
+    }
+#if LV_LABEL_LINE_CACHE
+    else if(hint && lines_match(hint, txt, font, style->text.letter_space, flag)) {
+        /*The width of the expanded text is known from the last layout*/
+        w = hint->w;
+    }
+#endif
+    else {
         /*If EXAPND is enabled then not limit the text's width to the object's width*/
         lv_point_t p;
         lv_txt_get_size(&p, txt, style->text.font, style->text.letter_space, style->text.line_space, LV_COORD_MAX,
@@ -89,43 +100,67 @@ void lv_draw_label(const lv_area_t * coords, const lv_area_t * mask, const lv_st
 
     uint32_t line_start     = 0;
     int32_t last_line_start = -1;
+    uint32_t line_end;
+
+#if LV_LABEL_LINE_CACHE
+    /*With the line layout cached jump straight to the first visible line*/
+    const uint32_t * lines = NULL;
+    if(hint && line_height > 0) lines = lv_draw_label_hint_lines(hint, txt, font, style->text.letter_space, w, flag);
+    const lv_coord_t * widths = NULL;
+    uint32_t line_i = 0;
+    if(lines) {
+        widths = (const lv_coord_t *)&lines[hint->line_cnt + 1];
+        if(pos.y + line_height < mask->y1) {
+            line_i = (mask->y1 - pos.y - 1) / line_height;
+            pos.y += line_i * line_height;
+        }
+        if(line_i >= hint->line_cnt) return;
+        line_start = lines[line_i];
+        line_end   = lines[line_i + 1];
+    } else
+#endif
+    {
+        /*Check the hint to use the cached info*/
+        if(hint && y_ofs == 0) {
+            /*If the label changed too much recalculate the hint.*/
+            if(LV_MATH_ABS(hint->coord_y - coords->y1) > LV_LABEL_HINT_UPDATE_TH - 2 * line_height) {
+                hint->line_start = -1;
+            }
+            last_line_start = hint->line_start;
+        }
 
-    /*Check the hint to use the cached info*/
-    if(hint && y_ofs == 0) {
-        /*If the label changed too much recalculate the hint.*/
-        if(LV_MATH_ABS(hint->coord_y - coords->y1) > LV_LABEL_HINT_UPDATE_TH - 2 * line_height) {
-            hint->line_start = -1;
+        /*Use the hint if it's valid*/
+        if(hint && last_line_start >= 0) {
+            line_start = last_line_start;
+            pos.y += hint->y;
         }
-        last_line_start = hint->line_start;
-    }
 
-    /*Use the hint if it's valid*/
-    if(hint && last_line_start >= 0) {
-        line_start = last_line_start;
-        pos.y += hint->y;
-    }
+        line_end = line_start + lv_txt_get_next_line(&txt[line_start], font, style->text.letter_space, w, flag);
 
-    uint32_t line_end = line_start + lv_txt_get_next_line(&txt[line_start], font, style->text.letter_space, w, flag);
+        /*Go the first visible line*/
+        while(pos.y + line_height < mask->y1) {
+            /*Go to next line*/
+            line_start = line_end;
+            line_end += lv_txt_get_next_line(&txt[line_start], font, style->text.letter_space, w, flag);
+            pos.y += line_height;
 
-    /*Go the first visible line*/
-    while(pos.y + line_height < mask->y1) {
-        /*Go to next line*/
-        line_start = line_end;
-        line_end += lv_txt_get_next_line(&txt[line_start], font, style->text.letter_space, w, flag);
-        pos.y += line_height;
+            /*Save at the threshold coordinate*/
+            if(hint && pos.y >= -LV_LABEL_HINT_UPDATE_TH && hint->line_start < 0) {
+                hint->line_start = line_start;
+                hint->y          = pos.y - coords->y1;
+                hint->coord_y    = coords->y1;
+            }
 
-        /*Save at the threshold coordinate*/
-        if(hint && pos.y >= -LV_LABEL_HINT_UPDATE_TH && hint->line_start < 0) {
-            hint->line_start = line_start;
-            hint->y          = pos.y - coords->y1;
-            hint->coord_y    = coords->y1;
+            if(txt[line_start] == '\0') return;
         }
-
-        if(txt[line_start] == '\0') return;
     }
 
     /*Align to middle*/
     if(flag & LV_TXT_FLAG_CENTER) {
+#if LV_LABEL_LINE_CACHE
+        if(widths) line_width = widths[line_i];
+        else
+#endif
         line_width = lv_txt_get_width(&txt[line_start], line_end - line_start, font, style->text.letter_space, flag);
 
         pos.x += (lv_area_get_width(coords) - line_width) / 2;
@@ -133,6 +168,10 @@ void lv_draw_label(const lv_area_t * coords, const lv_area_t * mask, const lv_st
     }
     /*Align to the right*/
     else if(flag & LV_TXT_FLAG_RIGHT) {
+#if LV_LABEL_LINE_CACHE
+        if(widths) line_width = widths[line_i];
+        else
+#endif
         line_width = lv_txt_get_width(&txt[line_start], line_end - line_start, font, style->text.letter_space, flag);
         pos.x += lv_area_get_width(coords) - line_width;
     }
@@ -159,8 +198,8 @@ void lv_draw_label(const lv_area_t * coords, const lv_area_t * mask, const lv_st
         uint32_t letter;
         uint32_t letter_next;
         while(i < line_end) {
-            letter      = lv_txt_encoded_next(txt, &i);
-            letter_next = lv_txt_encoded_next(&txt[i], NULL);
+            letter      = lv_txt_next(txt, &i, flag);
+            letter_next = lv_txt_next(&txt[i], NULL, flag);
 
             /*Handle the re-color command*/
             if((flag & LV_TXT_FLAG_RECOLOR) != 0) {
@@ -225,11 +264,22 @@ void lv_draw_label(const lv_area_t * coords, const lv_area_t * mask, const lv_st
         }
         /*Go to next line*/
         line_start = line_end;
+#if LV_LABEL_LINE_CACHE
+        if(lines) {
+            line_i++;
+            if(line_i >= hint->line_cnt) break;
+            line_end = lines[line_i + 1];
+        } else
+#endif
         line_end += lv_txt_get_next_line(&txt[line_start], font, style->text.letter_space, w, flag);
 
         pos.x = coords->x1;
         /*Align to middle*/
         if(flag & LV_TXT_FLAG_CENTER) {
+#if LV_LABEL_LINE_CACHE
+            if(widths) line_width = widths[line_i];
+            else
+#endif
             line_width =
                 lv_txt_get_width(&txt[line_start], line_end - line_start, font, style->text.letter_space, flag);
 
@@ -238,6 +288,10 @@ void lv_draw_label(const lv_area_t * coords, const lv_area_t * mask, const lv_st
         }
         /*Align to the right*/
         else if(flag & LV_TXT_FLAG_RIGHT) {
+#if LV_LABEL_LINE_CACHE
+            if(widths) line_width = widths[line_i];
+            else
+#endif
             line_width =
                 lv_txt_get_width(&txt[line_start], line_end - line_start, font, style->text.letter_space, flag);
             pos.x += lv_area_get_width(coords) - line_width;
@@ -250,10 +304,212 @@ void lv_draw_label(const lv_area_t * coords, const lv_area_t * mask, const lv_st
     }
 }
 
+#if LV_LABEL_LINE_CACHE
+/**
+ * Forget the line layout stored in a hint. Has to be called when the text changes.
+ * @param hint pointer to a hint
+ */
+void lv_draw_label_hint_clear(lv_draw_label_hint_t * hint)
+{
+    if(hint->lines) {
+        lv_mem_free(hint->lines);
+        hint->lines = NULL;
+    }
+    hint->line_cnt = 0;
+}
+
+/**
+ * Get the line layout of a text from a hint, laying it out if the text or its parameters changed
+ * @param hint pointer to a hint
+ * @param txt 0 terminated text
+ * @param font font of the text
+ * @param letter_space letter space of the text
+ * @param w width to break the lines at
+ * @param flag settings for the text from 'txt_flag_t' enum
+ * @return the start of every line followed by the end of the text and the line widths,
+ *         or NULL if the text has too many lines or there wasn't enough memory
+ */
+const uint32_t * lv_draw_label_hint_lines(lv_draw_label_hint_t * hint, const char * txt, const lv_font_t * font,
+                                         lv_coord_t letter_space, lv_coord_t w, lv_txt_flag_t flag)
+{
+    if(lines_match(hint, txt, font, letter_space, flag) && hint->w == w) return hint->lines;
+
+    lv_draw_label_hint_clear(hint);
+    hint->txt          = txt;
+    hint->font         = font;
+    hint->w            = w;
+    hint->letter_space = letter_space;
+    hint->flag         = flag;
+
+    /*Count the lines to allocate the right size. Past the limit mark the text as not cacheable.*/
+    uint32_t cnt = 0;
+    uint32_t i   = 0;
+    while(txt[i] != '\0') {
+        uint16_t len = lv_txt_get_next_line(&txt[i], font, letter_space, w, flag);
+        if(len == 0 || cnt >= LV_LABEL_LINE_CACHE) {
+            hint->line_cnt = LV_LABEL_LINE_CACHE + 1;
+            return NULL;
+        }
+        i += len;
+        cnt++;
+    }
+
+    if(cnt == 0) {
+        hint->line_cnt = LV_LABEL_LINE_CACHE + 1;
+        return NULL;
+    }
+
+    uint32_t * lines = lv_mem_alloc((cnt + 1) * sizeof(uint32_t) + cnt * sizeof(lv_coord_t));
+    if(lines == NULL) {
+        hint->line_cnt = LV_LABEL_LINE_CACHE + 1;
+        return NULL;
+    }
+
+    lv_coord_t * widths = (lv_coord_t *)&lines[cnt + 1];
+    uint32_t l;
+    i = 0;
+    for(l = 0; l < cnt; l++) {
+        uint16_t len = lv_txt_get_next_line(&txt[i], font, letter_space, w, flag);
+        lines[l] = i;
+        widths[l] = (flag & (LV_TXT_FLAG_CENTER | LV_TXT_FLAG_RIGHT)) ?
+                    lv_txt_get_width(&txt[i], len, font, letter_space, flag) : 0;
+        i += len;
+    }
+    lines[cnt] = i;
+
+    hint->lines    = lines;
+    hint->line_cnt = cnt;
+    return lines;
+}
+
+/**
+ * Update the line layout stored in a hint after its text was edited. Only the lines around the
+ * edit are laid out again, the others are kept (moved by the length of the edit).
+ * @param hint pointer to a hint
+ * @param txt the edited text (it can be at an other address than before the edit)
+ * @param pos byte index of the edit
+ * @param len number of bytes inserted at `pos` or the negative number of bytes removed from `pos`
+ * @param first store the index of the first line which changed here
+ * @param last store the index of the last line which changed here
+ *             (the last line of the text if the number of lines changed)
+ * @return true: the layout is updated; false: the hint has no layout (anymore) so the text has to
+ *         be laid out again
+ */
+bool lv_draw_label_hint_edit(lv_draw_label_hint_t * hint, const char * txt, uint32_t pos, int32_t len,
+                             uint32_t * first, uint32_t * last)
+{
+    if(hint->lines == NULL) {
+        lv_draw_label_hint_clear(hint);
+        return false;
+    }
+
+    uint32_t * lines = hint->lines;
+    uint32_t cnt     = hint->line_cnt;
+    uint32_t ins_end = pos + (len > 0 ? len : 0); /*End of the edit in the new text*/
+    uint32_t i;
+    uint32_t l;
+
+    /*Find the line of the edit. The lines before it look into the next line to find where to break
+     *so lay out from two lines earlier.*/
+    uint32_t l_min = 0;
+    uint32_t l_max = cnt - 1;
+    while(l_min < l_max) {
+        l = (l_min + l_max + 1) / 2;
+        if(lines[l] <= pos)
+            l_min = l;
+        else
+            l_max = l - 1;
+    }
+    uint32_t l_start = l_min >= 2 ? l_min - 2 : 0;
+
+    /*Lay out lines until one starts where an old line after the edit started.
+     *The text and so the lines are the same from there.*/
+    uint32_t n   = 0;     /*Number of new lines*/
+    uint32_t j   = l_min; /*The first old line which can be the same*/
+    bool synced = false;
+    i           = lines[l_start];
+    while(txt[i] != '\0') {
+        if(i >= ins_end) {
+            while(j < cnt && (int32_t)lines[j] + len < (int32_t)i) j++;
+            if(j < cnt && (int32_t)lines[j] + len == (int32_t)i) {
+                synced = true;
+                break;
+            }
+        }
+        uint16_t line_len = lv_txt_get_next_line(&txt[i], hint->font, hint->letter_space, hint->w, hint->flag);
+        if(line_len == 0) break;
+        i += line_len;
+        n++;
+    }
+    if(txt[i] == '\0') {
+        j      = cnt;
+        synced = true;
+    }
+
+    uint32_t new_cnt = l_start + n + cnt - j;
+    if(synced == false || new_cnt == 0 || new_cnt > LV_LABEL_LINE_CACHE) {
+        lv_draw_label_hint_clear(hint);
+        return false;
+    }
+
+    /*With an other number of lines build a new layout from the parts of the old one*/
+    uint32_t * new_lines = lines;
+    if(new_cnt != cnt) {
+        new_lines = lv_mem_alloc((new_cnt + 1) * sizeof(uint32_t) + new_cnt * sizeof(lv_coord_t));
+        if(new_lines == NULL) {
+            lv_draw_label_hint_clear(hint);
+            return false;
+        }
+        memcpy(new_lines, lines, l_start * sizeof(uint32_t));
+        memcpy(&new_lines[new_cnt + 1], &lines[cnt + 1], l_start * sizeof(lv_coord_t));
+    }
+    lv_coord_t * widths     = (lv_coord_t *)&lines[cnt + 1];
+    lv_coord_t * new_widths = (lv_coord_t *)&new_lines[new_cnt + 1];
+
+    /*The lines after the new ones only moved*/
+    for(l = j; l <= cnt; l++) {
+        new_lines[l - j + l_start + n] = lines[l] + len;
+        if(l < cnt) new_widths[l - j + l_start + n] = widths[l];
+    }
+
+    /*Store the new lines*/
+    bool need_w = (hint->flag & (LV_TXT_FLAG_CENTER | LV_TXT_FLAG_RIGHT)) ? true : false;
+    i           = lines[l_start];
+    for(l = l_start; l < l_start + n; l++) {
+        uint16_t line_len = lv_txt_get_next_line(&txt[i], hint->font, hint->letter_space, hint->w, hint->flag);
+        new_lines[l]      = i;
+        new_widths[l] = need_w ? lv_txt_get_width(&txt[i], line_len, hint->font, hint->letter_space, hint->flag) : 0;
+        i += line_len;
+    }
+
+    if(new_lines != lines) lv_mem_free(lines);
+    hint->lines    = new_lines;
+    hint->line_cnt = new_cnt;
+    hint->txt      = txt;
+
+    *first = l_start;
+    *last  = new_cnt != cnt ? new_cnt - 1 : l_start + (n > 0 ? n - 1 : 0);
+    return true;
+}
+#endif
+
 /**********************
  *   STATIC FUNCTIONS
  **********************/
 
+#if LV_LABEL_LINE_CACHE
+/**
+ * Check if a hint was laid out for a text with the given parameters (any width)
+ */
+static bool lines_match(const lv_draw_label_hint_t * hint, const char * txt, const lv_font_t * font,
+                        lv_coord_t letter_space, lv_txt_flag_t flag)
+{
+    return hint->line_cnt != 0 && hint->txt == txt && hint->font == font && hint->letter_space == letter_space &&
+           hint->flag == flag;
+}
+
+#endif
+
 /**
  * Convert a hexadecimal characters to a number (0..15)
  * @param hex Pointer to a hexadecimal character (0..9, A..F)
@@ -38,6 +38,22 @@ typedef struct {
     /** The 'y1' coordinate of the label when the hint was saved.
      * Used to invalidate the hint if the label has moved too much. */
     int32_t coord_y;
+
+#if LV_LABEL_LINE_CACHE
+    /** Start index of every line followed by the end of the text, then the width of every line.
+     * NULL if the text isn't laid out or has more than `LV_LABEL_LINE_CACHE` lines.*/
+    uint32_t * lines;
+
+    /** Number of lines in `lines`. 0: not laid out yet*/
+    uint16_t line_cnt;
+
+    /** The text and parameters `lines` was laid out with*/
+    const char * txt;
+    const lv_font_t * font;
+    lv_coord_t w;
+    lv_coord_t letter_space;
+    lv_txt_flag_t flag;
+#endif
 }lv_draw_label_hint_t;
 
 /**********************
@@ -60,6 +76,44 @@ void lv_draw_label(const lv_area_t * coords, const lv_area_t * mask, const lv_st
                    const char * txt, lv_txt_flag_t flag, lv_point_t * offset, uint16_t sel_start, uint16_t sel_end,
                    lv_draw_label_hint_t * hint);
 
+#if LV_LABEL_LINE_CACHE
+/**
+ * Forget the line layout stored in a hint. Has to be called when the text changes.
+ * @param hint pointer to a hint
+ */
+void lv_draw_label_hint_clear(lv_draw_label_hint_t * hint);
+
+/**
+ * Get the line layout of a text from a hint, laying it out if the text or its parameters changed
+ * @param hint pointer to a hint
+ * @param txt 0 terminated text
+ * @param font font of the text
+ * @param letter_space letter space of the text
+ * @param w width to break the lines at
+ * @param flag settings for the text from 'txt_flag_t' enum
+ * @return the start of every line followed by the end of the text and the line widths,
+ *         or NULL if the text has too many lines or there wasn't enough memory
+ */
+const uint32_t * lv_draw_label_hint_lines(lv_draw_label_hint_t * hint, const char * txt, const lv_font_t * font,
+                                         lv_coord_t letter_space, lv_coord_t w, lv_txt_flag_t flag);
+
+/**
+ * Update the line layout stored in a hint after its text was edited. Only the lines around the
+ * edit are laid out again, the others are kept (moved by the length of the edit).
+ * @param hint pointer to a hint
+ * @param txt the edited text (it can be at an other address than before the edit)
+ * @param pos byte index of the edit
+ * @param len number of bytes inserted at `pos` or the negative number of bytes removed from `pos`
+ * @param first store the index of the first line which changed here
+ * @param last store the index of the last line which changed here
+ *             (the last line of the text if the number of lines changed)
+ * @return true: the layout is updated; false: the hint has no layout (anymore) so the text has to
+ *         be laid out again
+ */
+bool lv_draw_label_hint_edit(lv_draw_label_hint_t * hint, const char * txt, uint32_t pos, int32_t len,
+                             uint32_t * first, uint32_t * last);
+#endif
+
 /**********************
  *      MACROS
  **********************/
@@ -15,6 +15,8 @@
 /*********************
  *      DEFINES
  *********************/
+/*Skew lines at least this wide (after measuring the ending) are drawn one row or column at a time*/
+#define LINE_SPAN_MIN_WIDTH 2
 
 /**********************
  *      TYPEDEFS
@@ -54,6 +56,9 @@ static void line_init(line_draw_t * line, const lv_point_t * p1, const lv_point_
 static bool line_next(line_draw_t * line);
 static bool line_next_y(line_draw_t * line);
 static bool line_next_x(line_draw_t * line);
+static void line_draw_spans(const line_draw_t * main_line, const lv_coord_t * segs, lv_coord_t seg_cnt,
+                            const lv_point_t * pattern, lv_coord_t width, const lv_area_t * mask, lv_color_t color,
+                            lv_opa_t opa);
 
 /**********************
  *  STATIC VARIABLES
@@ -261,9 +266,13 @@ static void line_draw_skew(line_draw_t * main_line, bool dir_ori, const lv_area_
     width = style->line.width;
 
     /* The pattern stores the points of the line ending. It has the good direction and length.
-     * The worth case is the 45° line where pattern can have 1.41 x `width` points*/
-
-    lv_point_t * pattern = lv_draw_get_buf(width * 2 * sizeof(lv_point_t));
+     * The worth case is the 45° line where pattern can have 1.41 x `width` points.
+     * After it the start of the line's segments are stored: one segment per step in y (rather
+     * horizontal lines) or x (rather vertical lines)*/
+    lv_coord_t seg_max = (main_line->hor ? main_line->dy : main_line->dx) + 2;
+    uint32_t pattern_size = width * 2 * sizeof(lv_point_t);
+    uint8_t * buf = lv_draw_get_buf(pattern_size + seg_max * sizeof(lv_coord_t));
+    lv_point_t * pattern = (lv_point_t *)buf;
     lv_coord_t i = 0;
 
     /*Create a perpendicular pattern (a small line)*/
@@ -274,7 +283,7 @@ static void line_draw_skew(line_draw_t * main_line, bool dir_ori, const lv_area_
 
         uint32_t width_sqr = width * width;
         /* Run for a lot of times. Meanwhile the real width will be determined as well */
-        for(i = 0; i < (lv_coord_t)sizeof(pattern); i++) {
+        for(i = 0; i < width * 2; i++) {
             pattern[i].x = pattern_line.p_act.x;
             pattern[i].y = pattern_line.p_act.y;
 
@@ -450,9 +459,16 @@ static void line_draw_skew(line_draw_t * main_line, bool dir_ori, const lv_area_
     lv_area_t draw_area;
     bool first_run = true;
 
+    /* Wide lines only record their segments while walking the line and then fill each row (or
+     * column) once instead of every segment once per pattern point*/
+    lv_coord_t * segs  = width >= LINE_SPAN_MIN_WIDTH ? (lv_coord_t *)(buf + pattern_size) : NULL;
+    lv_coord_t seg_cnt = 0;
+
     if(main_line->hor) {
         while(line_next_y(main_line)) {
-            for(i = 0; i < width; i++) {
+            if(segs) segs[seg_cnt++] = prev_p.x;
+
+            for(i = 0; i < width && segs == NULL; i++) {
                 draw_area.x1 = prev_p.x + pattern[i].x;
                 draw_area.y1 = prev_p.y + pattern[i].y;
                 draw_area.x2 = draw_area.x1 + main_line->p_act.x - prev_p.x - 1;
@@ -483,7 +499,13 @@ static void line_draw_skew(line_draw_t * main_line, bool dir_ori, const lv_area_
             prev_p.y = main_line->p_act.y;
         }
 
-        for(i = 0; i < width; i++) {
+        if(segs) {
+            segs[seg_cnt++] = prev_p.x;
+            segs[seg_cnt]   = main_line->p_act.x + 1;
+            line_draw_spans(main_line, segs, seg_cnt, pattern, width, mask, style->line.color, opa);
+        }
+
+        for(i = 0; i < width && segs == NULL; i++) {
             draw_area.x1 = prev_p.x + pattern[i].x;
             draw_area.y1 = prev_p.y + pattern[i].y;
             draw_area.x2 = draw_area.x1 + main_line->p_act.x - prev_p.x;
@@ -510,7 +532,9 @@ static void line_draw_skew(line_draw_t * main_line, bool dir_ori, const lv_area_
     else {
 
         while(line_next_x(main_line)) {
-            for(i = 0; i < width; i++) {
+            if(segs) segs[seg_cnt++] = prev_p.y;
+
+            for(i = 0; i < width && segs == NULL; i++) {
                 draw_area.x1 = prev_p.x + pattern[i].x;
                 draw_area.y1 = prev_p.y + pattern[i].y;
                 draw_area.x2 = draw_area.x1;
@@ -543,7 +567,13 @@ static void line_draw_skew(line_draw_t * main_line, bool dir_ori, const lv_area_
         }
 
         /*Draw the last part*/
-        for(i = 0; i < width; i++) {
+        if(segs) {
+            segs[seg_cnt++] = prev_p.y;
+            segs[seg_cnt]   = main_line->p_act.y + 1;
+            line_draw_spans(main_line, segs, seg_cnt, pattern, width, mask, style->line.color, opa);
+        }
+
+        for(i = 0; i < width && segs == NULL; i++) {
             draw_area.x1 = prev_p.x + pattern[i].x;
             draw_area.y1 = prev_p.y + pattern[i].y;
             draw_area.x2 = draw_area.x1;
@@ -569,6 +599,72 @@ static void line_draw_skew(line_draw_t * main_line, bool dir_ori, const lv_area_
     }
 }
 
+/**
+ * Fill a wide skew line one row (rather horizontal lines) or column (rather vertical lines) at a
+ * time. Every segment of the line is repeated along the pattern, so a row gets a segment from each
+ * pattern point and these join into one span between the outermost ones.
+ * @param main_line the line
+ * @param segs start of the segments in x (rather horizontal lines) or y (rather vertical lines)
+ * followed by the end of the line + 1
+ * @param seg_cnt number of segments
+ * @param pattern the perpendicular ending, relative to the line
+ * @param width number of points in `pattern`
+ * @param mask the line will be drawn only on this area
+ * @param color color of the line
+ * @param opa opacity of the line
+ */
+static void line_draw_spans(const line_draw_t * main_line, const lv_coord_t * segs, lv_coord_t seg_cnt,
+                            const lv_point_t * pattern, lv_coord_t width, const lv_area_t * mask, lv_color_t color,
+                            lv_opa_t opa)
+{
+    bool hor = main_line->hor;
+
+    /*The segments step by one in the minor axis and so do the pattern's points*/
+    lv_coord_t minor_start = hor ? main_line->p1.y : main_line->p1.x;
+    lv_coord_t minor_step  = hor ? main_line->sy : main_line->sx;
+    lv_coord_t pat_first   = hor ? pattern[0].y : pattern[0].x;
+    lv_coord_t pat_last    = hor ? pattern[width - 1].y : pattern[width - 1].x;
+    lv_coord_t pat_step    = pat_last >= pat_first ? 1 : -1;
+    lv_coord_t dir         = pat_step * minor_step;
+    lv_coord_t seg_last    = seg_cnt - 1;
+
+    /*Rows or columns touched by the line, inside the mask*/
+    lv_coord_t first = minor_start + LV_MATH_MIN(0, seg_last * minor_step) + LV_MATH_MIN(pat_first, pat_last);
+    lv_coord_t last  = minor_start + LV_MATH_MAX(0, seg_last * minor_step) + LV_MATH_MAX(pat_first, pat_last);
+    first            = LV_MATH_MAX(first, hor ? mask->y1 : mask->x1);
+    last             = LV_MATH_MIN(last, hor ? mask->y2 : mask->x2);
+
+    lv_area_t span_area;
+    lv_coord_t c;
+    for(c = first; c <= last; c++) {
+        /*Segment `k` reaches this row from pattern point `i` if k = a - i * dir*/
+        lv_coord_t a = (c - minor_start - pat_first) * minor_step;
+        lv_coord_t i1;
+        lv_coord_t i2;
+        if(dir > 0) {
+            i1 = LV_MATH_MAX(0, a - seg_last);
+            i2 = LV_MATH_MIN(width - 1, a);
+        } else {
+            i1 = LV_MATH_MAX(0, -a);
+            i2 = LV_MATH_MIN(width - 1, seg_last - a);
+        }
+        if(i1 > i2) continue;
+
+        lv_coord_t k1   = a - i1 * dir;
+        lv_coord_t k2   = a - i2 * dir;
+        lv_coord_t ofs1 = hor ? pattern[i1].x : pattern[i1].y;
+        lv_coord_t ofs2 = hor ? pattern[i2].x : pattern[i2].y;
+        lv_coord_t v1   = LV_MATH_MIN(segs[k1] + ofs1, segs[k2] + ofs2);
+        lv_coord_t v2   = LV_MATH_MAX(segs[k1 + 1] + ofs1, segs[k2 + 1] + ofs2) - 1;
+
+        if(hor)
+            lv_area_set(&span_area, v1, c, v2, c);
+        else
+            lv_area_set(&span_area, c, v1, c, v2);
+        lv_draw_fill(&span_area, mask, color, opa);
+    }
+}
+
 static void line_init(line_draw_t * line, const lv_point_t * p1, const lv_point_t * p2)
 {
     line->p1.x = p1->x;
@@ -10,6 +10,7 @@
 #include "../lv_misc/lv_circ.h"
 #include "../lv_misc/lv_math.h"
 #include "../lv_core/lv_refr.h"
+#include "../lv_misc/lv_mem.h"
 
 /*********************
  *      DEFINES
@@ -24,9 +25,49 @@
 /*Add extra radius with LV_SHADOW_BOTTOM to cover anti-aliased corners*/
 #define SHADOW_BOTTOM_AA_EXTRA_RADIUS 3
 
+/*Larger shadow profiles are computed on every redraw instead of being cached*/
+#define SHADOW_CACHE_MAX_PROFILE_SIZE 2048
+
+/*Corners with larger coverage tiles are drawn circle step by circle step instead*/
+#define CORNER_CACHE_MAX_TILE_SIZE 2048
+
+/*Border width which identifies the tiles of the body's corners*/
+#define CORNER_TILE_BODY LV_COORD_MIN
+
 /**********************
  *      TYPEDEFS
  **********************/
+#if LV_USE_SHADOW && LV_SHADOW_CACHE_SIZE
+typedef struct
+{
+    uint8_t * data;    /*The profile or NULL if the entry is unused*/
+    uint32_t life;     /*Value of `shadow_cache_life` when the profile was last used*/
+    lv_coord_t radius; /*Radius and width after anti-aliasing corrections*/
+    lv_coord_t swidth;
+    lv_opa_t opa;
+    uint8_t type; /*LV_SHADOW_FULL or LV_SHADOW_BOTTOM*/
+} lv_shadow_cache_t;
+#endif
+
+#if LV_CORNER_CACHE_SIZE
+/*A row of a corner's coverage tile*/
+typedef struct
+{
+    lv_coord_t full_x1; /*First and last fully covered pixel of the row (`full_x1 > full_x2`: none)*/
+    lv_coord_t full_x2;
+    lv_coord_t first; /*First and last covered pixel of the row (`first > last`: none)*/
+    lv_coord_t last;
+} lv_corner_row_t;
+
+typedef struct
+{
+    lv_corner_row_t * rows; /*The tile or NULL if the entry is unused*/
+    uint32_t life;          /*Value of `corner_cache_life` when the tile was last used*/
+    lv_coord_t radius;      /*Radius and border width after anti-aliasing corrections*/
+    lv_coord_t bwidth;      /*`CORNER_TILE_BODY` for the body*/
+    bool aa;
+} lv_corner_cache_t;
+#endif
 
 /**********************
  *  STATIC PROTOTYPES
@@ -49,10 +90,33 @@ static void lv_draw_shadow_bottom(const lv_area_t * coords, const lv_area_t * ma
                                   lv_opa_t opa_scale);
 static void lv_draw_shadow_full_straight(const lv_area_t * coords, const lv_area_t * mask, const lv_style_t * style,
                                          const lv_opa_t * map);
+static void lv_draw_shadow_full_profile(lv_coord_t radius, lv_coord_t swidth, lv_opa_t opa, lv_coord_t * curve_x,
+                                        uint32_t * line_1d_blur, uint16_t * line_len, lv_opa_t * blur_map);
+static void lv_draw_shadow_bottom_profile(lv_coord_t radius, lv_coord_t swidth, lv_opa_t opa, lv_coord_t * curve_x,
+                                          lv_opa_t * line_1d_blur);
+static uint8_t * lv_draw_shadow_get_profile(uint8_t type, lv_coord_t radius, lv_coord_t swidth, lv_opa_t opa,
+                                            uint32_t size, bool * ready);
 #endif
 
 static uint16_t lv_draw_cont_radius_corr(uint16_t r, lv_coord_t w, lv_coord_t h);
 
+#if LV_CORNER_CACHE_SIZE
+static void lv_draw_rect_main_corner_tile(const lv_area_t * coords, const lv_area_t * mask, const lv_style_t * style,
+                                          lv_opa_t opa, lv_coord_t radius, bool aa, const lv_corner_row_t * rows);
+static void lv_draw_rect_border_corner_tile(const lv_area_t * coords, const lv_area_t * mask, const lv_style_t * style,
+                                            lv_opa_t opa, lv_coord_t radius, bool aa, const lv_corner_row_t * rows);
+static const lv_corner_row_t * lv_draw_corner_get_tile(lv_coord_t radius, lv_coord_t bwidth, bool aa);
+static void lv_draw_corner_tile_main(lv_corner_row_t * rows, lv_coord_t n, lv_coord_t radius, bool aa);
+static void lv_draw_corner_tile_border(lv_corner_row_t * rows, lv_coord_t n, lv_coord_t radius, lv_coord_t bwidth,
+                                       bool aa);
+static void lv_draw_corner_tile_px(lv_corner_row_t * rows, lv_coord_t n, lv_coord_t dx, lv_coord_t dy, lv_opa_t cov);
+static void lv_draw_corner_tile_row(lv_corner_row_t * rows, lv_coord_t n, lv_coord_t dy, lv_coord_t dx1,
+                                    lv_coord_t dx2);
+static void lv_draw_corner_tile_blend_row(const lv_corner_row_t * rows, lv_coord_t n, lv_coord_t dy, lv_coord_t x,
+                                          lv_coord_t y, int8_t dir, bool run, const lv_area_t * mask, lv_color_t color,
+                                          lv_opa_t opa);
+#endif
+
 #if LV_ANTIALIAS
 static lv_opa_t antialias_get_opa_circ(lv_coord_t seg, lv_coord_t px_id, lv_opa_t opa);
 #endif
@@ -60,6 +124,15 @@ static lv_opa_t antialias_get_opa_circ(lv_coord_t seg, lv_coord_t px_id, lv_opa_
 /**********************
  *  STATIC VARIABLES
  **********************/
+#if LV_USE_SHADOW && LV_SHADOW_CACHE_SIZE
+static lv_shadow_cache_t shadow_cache[LV_SHADOW_CACHE_SIZE];
+static uint32_t shadow_cache_life;
+#endif
+
+#if LV_CORNER_CACHE_SIZE
+static lv_corner_cache_t corner_cache[LV_CORNER_CACHE_SIZE];
+static uint32_t corner_cache_life;
+#endif
 
 /**********************
  *      MACROS
@@ -207,6 +280,14 @@ static void lv_draw_rect_main_corner(const lv_area_t * coords, const lv_area_t *
 
     radius = lv_draw_cont_radius_corr(radius, width, height);
 
+#if LV_CORNER_CACHE_SIZE
+    const lv_corner_row_t * tile = lv_draw_corner_get_tile(radius, CORNER_TILE_BODY, aa);
+    if(tile) {
+        lv_draw_rect_main_corner_tile(coords, mask, style, opa, radius, aa, tile);
+        return;
+    }
+#endif
+
     lv_point_t lt_origo; /*Left  Top    origo*/
     lv_point_t lb_origo; /*Left  Bottom origo*/
     lv_point_t rt_origo; /*Right Top    origo*/
@@ -724,6 +805,14 @@ static void lv_draw_rect_border_corner(const lv_area_t * coords, const lv_area_t
 
     radius = lv_draw_cont_radius_corr(radius, width, height);
 
+#if LV_CORNER_CACHE_SIZE
+    const lv_corner_row_t * tile = lv_draw_corner_get_tile(radius, bwidth, aa);
+    if(tile) {
+        lv_draw_rect_border_corner_tile(coords, mask, style, opa, radius, aa, tile);
+        return;
+    }
+#endif
+
     lv_point_t lt_origo; /*Left  Top    origo*/
     lv_point_t lb_origo; /*Left  Bottom origo*/
     lv_point_t rt_origo; /*Right Top    origo*/
@@ -1122,16 +1211,25 @@ static void lv_draw_shadow(const lv_area_t * coords, const lv_area_t * mask, con
     radius            = lv_draw_cont_radius_corr(radius, width, height);
     lv_area_t area_tmp;
 
+    /* With anti-aliasing the shadow starts on the edge pixels of `coords`
+     * and the corners reach further because of their extra radius*/
+    lv_coord_t aa = lv_disp_get_antialiasing(lv_refr_get_disp_refreshing()) ? 1 : 0;
+    lv_coord_t corner = radius + aa * (SHADOW_BOTTOM_AA_EXTRA_RADIUS + 1);
+
     /*Check horizontally without radius*/
     lv_area_copy(&area_tmp, coords);
-    area_tmp.x1 += radius;
-    area_tmp.x2 -= radius;
+    area_tmp.x1 += corner;
+    area_tmp.x2 -= corner;
+    area_tmp.y1 += aa;
+    area_tmp.y2 -= aa;
     if(lv_area_is_in(mask, &area_tmp) != false) return;
 
     /*Check vertically without radius*/
     lv_area_copy(&area_tmp, coords);
-    area_tmp.y1 += radius;
-    area_tmp.y2 -= radius;
+    area_tmp.x1 += aa;
+    area_tmp.x2 -= aa;
+    area_tmp.y1 += corner;
+    area_tmp.y2 -= corner;
     if(lv_area_is_in(mask, &area_tmp) != false) return;
 
     if(style->body.shadow.type == LV_SHADOW_FULL) {
@@ -1168,39 +1266,33 @@ static void lv_draw_shadow_full(const lv_area_t * coords, const lv_area_t * mask
 
     radius += aa;
 
-    /*Allocate a draw buffer the buffer required to draw the shadow*/
-    int16_t filter_width = 2 * swidth + 1;
-    uint32_t curve_x_size = ((radius + swidth + 1) + 3) & ~0x3; /*Round to 4*/
-    curve_x_size *= sizeof(lv_coord_t);
-    uint32_t line_1d_blur_size = (filter_width + 3) & ~0x3;     /*Round to 4*/
-    line_1d_blur_size *= sizeof(uint32_t);
-    uint32_t line_2d_blur_size = ((radius + swidth + 1) + 3) & ~0x3;     /*Round to 4*/
-    line_2d_blur_size *= sizeof(lv_opa_t);
-
-    uint8_t * draw_buf = lv_draw_get_buf(curve_x_size + line_1d_blur_size + line_2d_blur_size);
-
-    /*Divide the draw buffer*/
-    lv_coord_t  * curve_x = (lv_coord_t *)&draw_buf[0]; /*Stores the 'x' coordinates of a quarter circle.*/
-    uint32_t * line_1d_blur = (uint32_t *)&draw_buf[curve_x_size];
-    lv_opa_t * line_2d_blur = (lv_opa_t *)&draw_buf[curve_x_size + line_1d_blur_size];
-
-    memset(curve_x, 0, curve_x_size);
-    lv_point_t circ;
-    lv_coord_t circ_tmp;
-    lv_circ_init(&circ, &circ_tmp, radius);
-    while(lv_circ_cont(&circ)) {
-        curve_x[LV_CIRC_OCT1_Y(circ)] = LV_CIRC_OCT1_X(circ);
-        curve_x[LV_CIRC_OCT2_Y(circ)] = LV_CIRC_OCT2_X(circ);
-        lv_circ_next(&circ, &circ_tmp);
-    }
-    int16_t line;
-    /*1D Blur horizontally*/
     lv_opa_t opa = opa_scale == LV_OPA_COVER ? style->body.opa : (uint16_t)((uint16_t)style->body.opa * opa_scale) >> 8;
-    for(line = 0; line < filter_width; line++) {
-        line_1d_blur[line] = (uint32_t)((uint32_t)(filter_width - line) * (opa * 2) << SHADOW_OPA_EXTRA_PRECISION) /
-                             (filter_width * filter_width);
+
+    /*Get the profile of the blurred corner: the 'x' coordinates of a quarter circle and, for every
+     * line, the number of shadow pixels and their opacities. It only depends on the radius,
+     * the shadow width and the opacity so it is reused from the cache if possible.*/
+    uint16_t line_num = radius + swidth + 1;
+    int16_t filter_width = 2 * swidth + 1;
+    uint32_t curve_x_size = ((line_num + 3) & ~0x3) * sizeof(lv_coord_t);            /*Round to 4*/
+    uint32_t line_1d_blur_size = ((filter_width + 3) & ~0x3) * sizeof(uint32_t);     /*Round to 4*/
+    uint32_t line_len_size = ((line_num + 3) & ~0x3) * sizeof(uint16_t);             /*Round to 4*/
+    uint32_t blur_map_size = (uint32_t)line_num * line_num * sizeof(lv_opa_t);
+
+    bool ready;
+    uint8_t * profile = lv_draw_shadow_get_profile(LV_SHADOW_FULL, radius, swidth, opa,
+                                                   curve_x_size + line_1d_blur_size + line_len_size + blur_map_size, &ready);
+
+    /*Divide the profile*/
+    lv_coord_t * curve_x = (lv_coord_t *)&profile[0];
+    uint32_t * line_1d_blur = (uint32_t *)&profile[curve_x_size];
+    uint16_t * line_len = (uint16_t *)&profile[curve_x_size + line_1d_blur_size];
+    lv_opa_t * blur_map = (lv_opa_t *)&profile[curve_x_size + line_1d_blur_size + line_len_size];
+
+    if(ready == false) {
+        lv_draw_shadow_full_profile(radius, swidth, opa, curve_x, line_1d_blur, line_len, blur_map);
     }
 
+    int16_t line;
     uint16_t col;
 
     lv_point_t point_rt;
@@ -1222,44 +1314,9 @@ static void lv_draw_shadow_full(const lv_area_t * coords, const lv_area_t * mask
 
     ofs_lt.x = coords->x1 + radius + aa;
     ofs_lt.y = coords->y1 + radius + aa;
-    bool line_ready;
-    for(line = 0; line <= radius + swidth; line++) { /*Check all rows and make the 1D blur to 2D*/
-        line_ready = false;
-        for(col = 0; col <= radius + swidth; col++) { /*Check all pixels in a 1D blur line (from the origo to last
-                                                         shadow pixel (radius + swidth))*/
-
-            /*Sum the opacities from the lines above and below this 'row'*/
-            int16_t line_rel;
-            uint32_t px_opa_sum = 0;
-            for(line_rel = -swidth; line_rel <= swidth; line_rel++) {
-                /*Get the relative x position of the 'line_rel' to 'line'*/
-                int16_t col_rel;
-                if(line + line_rel < 0) { /*Below the radius, here is the blur of the edge */
-                    col_rel = radius - curve_x[line] - col;
-                } else if(line + line_rel > radius) { /*Above the radius, here won't be more 1D blur*/
-                    break;
-                } else { /*Blur from the curve*/
-                    col_rel = curve_x[line + line_rel] - curve_x[line] - col;
-                }
-
-                /*Add the value of the 1D blur on 'col_rel' position*/
-                if(col_rel < -swidth) { /*Outside of the blurred area. */
-                    if(line_rel == -swidth)
-                        line_ready = true; /*If no data even on the very first line then it wont't
-                                              be anything else in this line*/
-                    break;                 /*Break anyway because only smaller 'col_rel' values will come */
-                } else if(col_rel > swidth)
-                    px_opa_sum += line_1d_blur[0]; /*Inside the not blurred area*/
-                else
-                    px_opa_sum += line_1d_blur[swidth - col_rel]; /*On the 1D blur (+ swidth to align to the center)*/
-            }
-
-            line_2d_blur[col] = px_opa_sum >> SHADOW_OPA_EXTRA_PRECISION;
-            if(line_ready) {
-                col++; /*To make this line to the last one ( drawing will go to '< col')*/
-                break;
-            }
-        }
+    for(line = 0; line < line_num; line++) {
+        lv_opa_t * line_2d_blur = &blur_map[line * line_num];
+        col = line_len[line];
 
         /*Flush the line*/
         point_rt.x = curve_x[line] + ofs_rt.x + 1;
@@ -1320,33 +1377,28 @@ static void lv_draw_shadow_bottom(const lv_area_t * coords, const lv_area_t * ma
     radius += aa * SHADOW_BOTTOM_AA_EXTRA_RADIUS;
     swidth += aa;
 
+    lv_opa_t opa = opa_scale == LV_OPA_COVER ? style->body.opa : (uint16_t)((uint16_t)style->body.opa * opa_scale) >> 8;
+
+    /*Get the 'x' coordinates of a quarter circle and the 1D blur, from the cache if possible*/
     uint32_t curve_x_size = ((radius + 1) + 3) & ~0x3; /*Round to 4*/
     curve_x_size *= sizeof(lv_coord_t);
-    lv_opa_t line_1d_blur_size = (swidth + 3) & ~0x3;     /*Round to 4*/
+    uint32_t line_1d_blur_size = (swidth + 3) & ~0x3; /*Round to 4*/
     line_1d_blur_size *= sizeof(lv_opa_t);
 
-    uint8_t * draw_buf = lv_draw_get_buf(curve_x_size + line_1d_blur_size);
+    bool ready;
+    uint8_t * profile = lv_draw_shadow_get_profile(LV_SHADOW_BOTTOM, radius, swidth, opa,
+                                                   curve_x_size + line_1d_blur_size, &ready);
 
-    /*Divide the draw buffer*/
-    lv_coord_t  * curve_x = (lv_coord_t *)&draw_buf[0]; /*Stores the 'x' coordinates of a quarter circle.*/
-    lv_opa_t * line_1d_blur = (lv_opa_t *)&draw_buf[curve_x_size];
+    /*Divide the profile*/
+    lv_coord_t  * curve_x = (lv_coord_t *)&profile[0]; /*Stores the 'x' coordinates of a quarter circle.*/
+    lv_opa_t * line_1d_blur = (lv_opa_t *)&profile[curve_x_size];
 
-    lv_point_t circ;
-    lv_coord_t circ_tmp;
-    lv_circ_init(&circ, &circ_tmp, radius);
-    while(lv_circ_cont(&circ)) {
-        curve_x[LV_CIRC_OCT1_Y(circ)] = LV_CIRC_OCT1_X(circ);
-        curve_x[LV_CIRC_OCT2_Y(circ)] = LV_CIRC_OCT2_X(circ);
-        lv_circ_next(&circ, &circ_tmp);
+    if(ready == false) {
+        lv_draw_shadow_bottom_profile(radius, swidth, opa, curve_x, line_1d_blur);
     }
 
     int16_t col;
 
-    lv_opa_t opa = opa_scale == LV_OPA_COVER ? style->body.opa : (uint16_t)((uint16_t)style->body.opa * opa_scale) >> 8;
-    for(col = 0; col < swidth; col++) {
-        line_1d_blur[col] = (uint32_t)((uint32_t)(swidth - col) * opa / 2) / (swidth);
-    }
-
     lv_point_t point_l;
     lv_point_t point_r;
     lv_area_t area_mid;
@@ -1460,7 +1512,651 @@ static void lv_draw_shadow_full_straight(const lv_area_t * coords, const lv_area
     }
 }
 
+/**
+ * Calculate the profile of a full shadow's corner
+ * @param radius radius of the corner (corrected and including anti-aliasing)
+ * @param swidth width of the shadow
+ * @param opa opacity of the shadow
+ * @param curve_x store the 'x' coordinates of a quarter circle here (`radius + swidth + 1` elements)
+ * @param line_1d_blur buffer for the 1D blur (`2 * swidth + 1` elements)
+ * @param line_len store the number of pixels of each line here (`radius + swidth + 1` elements)
+ * @param blur_map store the opacity of each pixel here, a line of `radius + swidth + 1` opacities
+ * for every line
+ */
+static void lv_draw_shadow_full_profile(lv_coord_t radius, lv_coord_t swidth, lv_opa_t opa, lv_coord_t * curve_x,
+                                        uint32_t * line_1d_blur, uint16_t * line_len, lv_opa_t * blur_map)
+{
+    uint16_t line_num    = radius + swidth + 1;
+    int16_t filter_width = 2 * swidth + 1;
+
+    memset(curve_x, 0, line_num * sizeof(lv_coord_t));
+    memset(blur_map, 0, (uint32_t)line_num * line_num * sizeof(lv_opa_t));
+    lv_point_t circ;
+    lv_coord_t circ_tmp;
+    lv_circ_init(&circ, &circ_tmp, radius);
+    while(lv_circ_cont(&circ)) {
+        curve_x[LV_CIRC_OCT1_Y(circ)] = LV_CIRC_OCT1_X(circ);
+        curve_x[LV_CIRC_OCT2_Y(circ)] = LV_CIRC_OCT2_X(circ);
+        lv_circ_next(&circ, &circ_tmp);
+    }
+    int16_t line;
+    /*1D Blur horizontally*/
+    for(line = 0; line < filter_width; line++) {
+        line_1d_blur[line] = (uint32_t)((uint32_t)(filter_width - line) * (opa * 2) << SHADOW_OPA_EXTRA_PRECISION) /
+                             (filter_width * filter_width);
+    }
+
+    uint16_t col;
+    bool line_ready;
+    for(line = 0; line < line_num; line++) { /*Check all rows and make the 1D blur to 2D*/
+        lv_opa_t * line_2d_blur = &blur_map[line * line_num];
+        line_ready = false;
+        for(col = 0; col < line_num; col++) { /*Check all pixels in a 1D blur line (from the origo to last
+                                                 shadow pixel (radius + swidth))*/
+
+            /*Sum the opacities from the lines above and below this 'row'*/
+            int16_t line_rel;
+            uint32_t px_opa_sum = 0;
+            for(line_rel = -swidth; line_rel <= swidth; line_rel++) {
+                /*Get the relative x position of the 'line_rel' to 'line'*/
+                int16_t col_rel;
+                if(line + line_rel < 0) { /*Below the radius, here is the blur of the edge */
+                    col_rel = radius - curve_x[line] - col;
+                } else if(line + line_rel > radius) { /*Above the radius, here won't be more 1D blur*/
+                    break;
+                } else { /*Blur from the curve*/
+                    col_rel = curve_x[line + line_rel] - curve_x[line] - col;
+                }
+
+                /*Add the value of the 1D blur on 'col_rel' position*/
+                if(col_rel < -swidth) { /*Outside of the blurred area. */
+                    if(line_rel == -swidth)
+                        line_ready = true; /*If no data even on the very first line then it wont't
+                                              be anything else in this line*/
+                    break;                 /*Break anyway because only smaller 'col_rel' values will come */
+                } else if(col_rel > swidth)
+                    px_opa_sum += line_1d_blur[0]; /*Inside the not blurred area*/
+                else
+                    px_opa_sum += line_1d_blur[swidth - col_rel]; /*On the 1D blur (+ swidth to align to the center)*/
+            }
+
+            line_2d_blur[col] = px_opa_sum >> SHADOW_OPA_EXTRA_PRECISION;
+            if(line_ready) {
+                col++; /*To make this line to the last one ( drawing will go to '< col')*/
+                break;
+            }
+        }
+        line_len[line] = col;
+    }
+}
+
+/**
+ * Calculate the profile of a bottom shadow
+ * @param radius radius of the corners (corrected and including anti-aliasing)
+ * @param swidth width of the shadow (including anti-aliasing)
+ * @param opa opacity of the shadow
+ * @param curve_x store the 'x' coordinates of a quarter circle here (`radius + 1` elements)
+ * @param line_1d_blur store the opacity of the blur here (`swidth` elements)
+ */
+static void lv_draw_shadow_bottom_profile(lv_coord_t radius, lv_coord_t swidth, lv_opa_t opa, lv_coord_t * curve_x,
+                                          lv_opa_t * line_1d_blur)
+{
+    lv_point_t circ;
+    lv_coord_t circ_tmp;
+    lv_circ_init(&circ, &circ_tmp, radius);
+    while(lv_circ_cont(&circ)) {
+        curve_x[LV_CIRC_OCT1_Y(circ)] = LV_CIRC_OCT1_X(circ);
+        curve_x[LV_CIRC_OCT2_Y(circ)] = LV_CIRC_OCT2_X(circ);
+        lv_circ_next(&circ, &circ_tmp);
+    }
+
+    int16_t col;
+    for(col = 0; col < swidth; col++) {
+        line_1d_blur[col] = (uint32_t)((uint32_t)(swidth - col) * opa / 2) / (swidth);
+    }
+}
+
+/**
+ * Get a buffer for a shadow profile. Profiles are kept in a cache of the `LV_SHADOW_CACHE_SIZE`
+ * most recently used ones so redrawing the same shadow doesn't need to calculate it again.
+ * @param type LV_SHADOW_FULL or LV_SHADOW_BOTTOM
+ * @param radius radius of the shadow's corners
+ * @param swidth width of the shadow
+ * @param opa opacity of the shadow
+ * @param size size of the profile in bytes
+ * @param ready set to true if the buffer already contains the profile, false if it needs to
+ * be calculated
+ * @return pointer to the buffer of the profile
+ */
+static uint8_t * lv_draw_shadow_get_profile(uint8_t type, lv_coord_t radius, lv_coord_t swidth, lv_opa_t opa,
+                                            uint32_t size, bool * ready)
+{
+    *ready = false;
+
+#if LV_SHADOW_CACHE_SIZE
+    if(size <= SHADOW_CACHE_MAX_PROFILE_SIZE) {
+        uint16_t i;
+        lv_shadow_cache_t * oldest = &shadow_cache[0];
+
+        shadow_cache_life++;
+        for(i = 0; i < LV_SHADOW_CACHE_SIZE; i++) {
+            lv_shadow_cache_t * c = &shadow_cache[i];
+            if(c->data && c->type == type && c->radius == radius && c->swidth == swidth && c->opa == opa) {
+                c->life = shadow_cache_life;
+                *ready  = true;
+                return c->data;
+            }
+
+            /*Prefer an unused entry, else the least recently used one*/
+            if(oldest->data && (c->data == NULL || c->life < oldest->life)) oldest = c;
+        }
+
+        /*Replace the least recently used profile*/
+        if(oldest->data) lv_mem_free(oldest->data);
+        oldest->data = lv_mem_alloc(size);
+        if(oldest->data) {
+            oldest->life   = shadow_cache_life;
+            oldest->radius = radius;
+            oldest->swidth = swidth;
+            oldest->opa    = opa;
+            oldest->type   = type;
+            return oldest->data;
+        }
+    }
+#else
+    (void)type;
+    (void)radius;
+    (void)swidth;
+    (void)opa;
+#endif
+
+    /*Not cached: calculate it in the draw buffer*/
+    return lv_draw_get_buf(size);
+}
+
+#endif
+
+#if LV_CORNER_CACHE_SIZE
+
+/**
+ * Draw the corners of a rectangle's body from a coverage tile
+ * @param coords the coordinates of the original rectangle
+ * @param mask the rectangle will be drawn only  on this area
+ * @param style pointer to a style
+ * @param opa opacity of the body
+ * @param radius radius of the corners after corrections
+ * @param aa true: the tile is anti-aliased
+ * @param rows the tile from `lv_draw_corner_get_tile()`
+ */
+static void lv_draw_rect_main_corner_tile(const lv_area_t * coords, const lv_area_t * mask, const lv_style_t * style,
+                                          lv_opa_t opa, lv_coord_t radius, bool aa, const lv_corner_row_t * rows)
+{
+    lv_color_t mcolor = style->body.main_color;
+    lv_color_t gcolor = style->body.grad_color;
+    lv_color_t act_color = mcolor;
+    lv_coord_t height = lv_area_get_height(coords);
+    lv_coord_t n      = radius + aa + 1;
+
+    lv_coord_t x_left   = coords->x1 + radius + aa;
+    lv_coord_t x_right  = coords->x2 - radius - aa;
+    lv_coord_t y_top    = coords->y1 + radius + aa;
+    lv_coord_t y_bottom = coords->y2 - radius - aa;
+
+    bool solid = mcolor.full == gcolor.full;
+    lv_area_t row_area;
+
+    /*With a single color the part between the corners is one fill for all rows*/
+    if(solid) {
+        row_area.x1 = x_left + 1;
+        row_area.x2 = x_right - 1;
+        row_area.y1 = y_top - n + 1;
+        row_area.y2 = y_top;
+        lv_draw_fill(&row_area, mask, mcolor, opa);
+
+        row_area.y1 = y_bottom;
+        row_area.y2 = y_bottom + n - 1;
+        lv_draw_fill(&row_area, mask, mcolor, opa);
+    }
+
+    lv_coord_t dy;
+    uint8_t bottom;
+    for(dy = 0; dy < n; dy++) {
+        for(bottom = 0; bottom < 2; bottom++) {
+            lv_coord_t y = bottom ? y_bottom + dy : y_top - dy;
+            if(y < mask->y1 || y > mask->y2) continue;
+
+            if(!solid) {
+                uint8_t mix = (uint32_t)((uint32_t)(coords->y2 - y) * 255) / height;
+                act_color   = lv_color_mix(mcolor, gcolor, mix);
+
+                /*The first and last line of anti-aliased corners has the pure colors*/
+                if(aa && dy == n - 1) act_color = bottom ? gcolor : mcolor;
+
+                row_area.x1 = x_left + 1;
+                row_area.x2 = x_right - 1;
+                row_area.y1 = y;
+                row_area.y2 = y;
+                lv_draw_fill(&row_area, mask, act_color, opa);
+            }
+
+            lv_draw_corner_tile_blend_row(rows, n, dy, x_right, y, 1, true, mask, act_color, opa);
+            lv_draw_corner_tile_blend_row(rows, n, dy, x_left, y, -1, true, mask, act_color, opa);
+        }
+    }
+}
+
+/**
+ * Draw the corners of a rectangle's border from a coverage tile
+ * @param coords the coordinates of the original rectangle
+ * @param mask the rectangle will be drawn only  on this area
+ * @param style pointer to a style
+ * @param opa opacity of the border
+ * @param radius radius of the corners after corrections
+ * @param aa true: the tile is anti-aliased
+ * @param rows the tile from `lv_draw_corner_get_tile()`
+ */
+static void lv_draw_rect_border_corner_tile(const lv_area_t * coords, const lv_area_t * mask, const lv_style_t * style,
+                                            lv_opa_t opa, lv_coord_t radius, bool aa, const lv_corner_row_t * rows)
+{
+    lv_color_t color      = style->body.border.color;
+    lv_border_part_t part = style->body.border.part;
+    lv_coord_t n          = radius + aa + 1;
+
+    uint8_t corner;
+    for(corner = 0; corner < 4; corner++) {
+        bool right  = (corner & 0x1) != 0;
+        bool bottom = (corner & 0x2) != 0;
+        if((part & (bottom ? LV_BORDER_BOTTOM : LV_BORDER_TOP)) == 0) continue;
+        if((part & (right ? LV_BORDER_RIGHT : LV_BORDER_LEFT)) == 0) continue;
+
+        lv_coord_t x_origo = right ? coords->x2 - radius - aa : coords->x1 + radius + aa;
+        lv_coord_t y_origo = bottom ? coords->y2 - radius - aa : coords->y1 + radius + aa;
+
+        lv_coord_t dy;
+        for(dy = 0; dy < n; dy++) {
+            lv_coord_t y = bottom ? y_origo + dy : y_origo - dy;
+            if(y < mask->y1 || y > mask->y2) continue;
+
+            lv_draw_corner_tile_blend_row(rows, n, dy, x_origo, y, right ? 1 : -1, true, mask, color, opa);
+        }
+    }
+}
+
+/**
+ * Blend a row of a coverage tile
+ * @param rows the tile
+ * @param n width and height of the tile
+ * @param dy index of the row
+ * @param x x coordinate of the corner's origo
+ * @param y y coordinate of the row on the screen
+ * @param dir 1: the tile grows to the right, -1: to the left
+ * @param run true: draw the fully covered run too, false: only the partially covered pixels
+ * @param mask the pixels will be drawn only on this area
+ * @param color color of the pixels
+ * @param opa opacity of fully covered pixels
+ */
+static void lv_draw_corner_tile_blend_row(const lv_corner_row_t * rows, lv_coord_t n, lv_coord_t dy, lv_coord_t x,
+                                          lv_coord_t y, int8_t dir, bool run, const lv_area_t * mask, lv_color_t color,
+                                          lv_opa_t opa)
+{
+    const lv_corner_row_t * row = &rows[dy];
+    const uint8_t * cov         = (const uint8_t *)&rows[n] + (uint32_t)dy * n;
+    bool has_run                = row->full_x1 <= row->full_x2;
+
+    lv_disp_t * disp    = lv_refr_get_disp_refreshing();
+    lv_disp_buf_t * vdb = lv_disp_get_buf(disp);
+    bool direct         = disp->driver.set_px_cb == NULL && disp->driver.draw_cb == NULL;
+#if LV_COLOR_DEPTH == 32 && LV_COLOR_SCREEN_TRANSP
+    if(disp->driver.screen_transp) direct = false;
+#endif
+
+    /*Blend straight into the VDB unless the pixels have to go through the driver*/
+    lv_color_t * vdb_row = vdb->buf_act;
+    vdb_row += (uint32_t)(y - vdb->area.y1) * lv_area_get_width(&vdb->area);
+    vdb_row -= vdb->area.x1;
+
+    if(run && has_run) {
+        lv_area_t run_area;
+        run_area.x1 = dir > 0 ? x + row->full_x1 : x - row->full_x2;
+        run_area.x2 = dir > 0 ? x + row->full_x2 : x - row->full_x1;
+        run_area.y1 = y;
+        run_area.y2 = y;
+        if(!direct) {
+            lv_draw_fill(&run_area, mask, color, opa);
+        } else if(lv_area_intersect(&run_area, &run_area, mask)) {
+            lv_color_t * px_p = &vdb_row[run_area.x1];
+            uint32_t len      = lv_area_get_width(&run_area);
+            if(opa > LV_OPA_MAX) {
+                while(len--) *px_p++ = color;
+            } else {
+                for(; len; len--, px_p++) *px_p = lv_color_mix(color, *px_p, opa);
+            }
+        }
+    }
+
+    lv_coord_t dx;
+    for(dx = row->first; dx <= row->last; dx++) {
+        if(has_run && dx == row->full_x1) {
+            dx = row->full_x2;
+            continue;
+        }
+
+        lv_opa_t px_opa = opa == LV_OPA_COVER ? cov[dx] : (uint16_t)((uint16_t)cov[dx] * opa) >> 8;
+        lv_coord_t px_x = x + dir * dx;
+        if(!direct) {
+            lv_draw_px(px_x, y, mask, color, px_opa);
+        } else if(px_x >= mask->x1 && px_x <= mask->x2 && px_opa >= LV_OPA_MIN) {
+            vdb_row[px_x] = px_opa > LV_OPA_MAX ? color : lv_color_mix(color, vdb_row[px_x], px_opa);
+        }
+    }
+}
+
+/**
+ * Get the coverage tile of a corner. Tiles are kept in a cache of the `LV_CORNER_CACHE_SIZE` most
+ * recently used ones so the corners are drawn as masked fills instead of walking the circle.
+ * A tile holds the right bottom quarter (the others are mirrored) as `n` rows of `lv_corner_row_t`
+ * followed by `n * n` coverage bytes, where `n = radius + aa + 1`.
+ * @param radius radius of the corner after corrections
+ * @param bwidth width of the border after corrections or `CORNER_TILE_BODY` for the body
+ * @param aa true: anti-alias the edges
+ * @return pointer to the tile or NULL if it's too large or there is no memory for it
+ */
+static const lv_corner_row_t * lv_draw_corner_get_tile(lv_coord_t radius, lv_coord_t bwidth, bool aa)
+{
+    lv_coord_t n  = radius + aa + 1;
+    uint32_t size = (uint32_t)n * (sizeof(lv_corner_row_t) + n);
+    if(size > CORNER_CACHE_MAX_TILE_SIZE) return NULL;
+
+    uint16_t i;
+    lv_corner_cache_t * oldest = &corner_cache[0];
+
+    corner_cache_life++;
+    for(i = 0; i < LV_CORNER_CACHE_SIZE; i++) {
+        lv_corner_cache_t * c = &corner_cache[i];
+        if(c->rows && c->radius == radius && c->bwidth == bwidth && c->aa == aa) {
+            c->life = corner_cache_life;
+            return c->rows;
+        }
+
+        /*Prefer an unused entry, else the least recently used one*/
+        if(oldest->rows && (c->rows == NULL || c->life < oldest->life)) oldest = c;
+    }
+
+    /*Replace the least recently used tile*/
+    if(oldest->rows) lv_mem_free(oldest->rows);
+    oldest->rows = lv_mem_alloc(size);
+    if(oldest->rows == NULL) return NULL;
+
+    oldest->life   = corner_cache_life;
+    oldest->radius = radius;
+    oldest->bwidth = bwidth;
+    oldest->aa     = aa;
+
+    lv_corner_row_t * rows = oldest->rows;
+    uint8_t * cov          = (uint8_t *)&rows[n];
+    memset(cov, 0, (uint32_t)n * n);
+
+    if(bwidth == CORNER_TILE_BODY)
+        lv_draw_corner_tile_main(rows, n, radius, aa);
+    else
+        lv_draw_corner_tile_border(rows, n, radius, bwidth, aa);
+
+    /*Find the fully covered run and the last covered pixel of the rows.
+     * The body's run always starts at the origo to join the middle part*/
+    lv_coord_t dy;
+    for(dy = 0; dy < n; dy++) {
+        const uint8_t * c    = &cov[(uint32_t)dy * n];
+        lv_corner_row_t * row = &rows[dy];
+        lv_coord_t dx         = 0;
+
+        if(bwidth != CORNER_TILE_BODY) {
+            while(dx < n && c[dx] != LV_OPA_COVER) dx++;
+        }
+        row->full_x1 = dx;
+        while(dx < n && c[dx] == LV_OPA_COVER) dx++;
+        row->full_x2 = dx - 1;
+
+        row->first = 0;
+        while(row->first < n && c[row->first] == 0) row->first++;
+        row->last = n - 1;
+        while(row->last >= 0 && c[row->last] == 0) row->last--;
+    }
+
+    return rows;
+}
+
+/**
+ * Calculate the coverage of a body's corner the same way `lv_draw_rect_main_corner()` draws it
+ * @param rows the tile with cleared coverage
+ * @param n width and height of the tile
+ * @param radius radius of the corner
+ * @param aa true: anti-alias the edge
+ */
+static void lv_draw_corner_tile_main(lv_corner_row_t * rows, lv_coord_t n, lv_coord_t radius, bool aa)
+{
+    lv_point_t cir;
+    lv_coord_t cir_tmp;
+    lv_circ_init(&cir, &cir_tmp, radius);
+
+#if LV_ANTIALIAS
+    lv_coord_t out_y_seg_start = 0;
+    lv_coord_t out_x_last      = radius;
+    lv_coord_t seg_size;
+    lv_coord_t i;
+#else
+    (void)aa;
+#endif
+
+    while(lv_circ_cont(&cir)) {
+#if LV_ANTIALIAS
+        /*New step in y on the outter circle*/
+        if(aa && out_x_last != cir.x) {
+            seg_size = cir.y - out_y_seg_start;
+            for(i = 0; i < seg_size; i++) {
+                lv_opa_t aa_opa;
+                if(seg_size > CIRCLE_AA_NON_LINEAR_OPA_THRESHOLD) {
+                    aa_opa = antialias_get_opa_circ(seg_size, i, LV_OPA_COVER);
+                } else {
+                    aa_opa = LV_OPA_COVER - lv_draw_aa_get_opa(seg_size, i, LV_OPA_COVER);
+                }
+                lv_draw_corner_tile_px(rows, n, out_y_seg_start + i, out_x_last + 1, aa_opa);
+                lv_draw_corner_tile_px(rows, n, out_x_last + 1, out_y_seg_start + i, aa_opa);
+            }
+
+            out_x_last      = cir.x;
+            out_y_seg_start = cir.y;
+        }
+#endif
+        lv_draw_corner_tile_row(rows, n, cir.y, 0, cir.x);
+        lv_draw_corner_tile_row(rows, n, cir.x, 0, cir.y);
+
+        lv_circ_next(&cir, &cir_tmp);
+    }
+
+#if LV_ANTIALIAS
+    if(aa) {
+        /*Last parts of the anti-alias*/
+        seg_size = cir.y - out_y_seg_start;
+        for(i = 0; i < seg_size; i++) {
+            lv_opa_t aa_opa = LV_OPA_COVER - lv_draw_aa_get_opa(seg_size, i, LV_OPA_COVER);
+            lv_draw_corner_tile_px(rows, n, out_y_seg_start + i, out_x_last + 1, aa_opa);
+            lv_draw_corner_tile_px(rows, n, out_x_last + 1, out_y_seg_start + i, aa_opa);
+        }
+
+        /*In some cases the last pixel is not drawn*/
+        if(LV_MATH_ABS(out_x_last - out_y_seg_start) == seg_size) {
+            lv_draw_corner_tile_px(rows, n, out_x_last, out_x_last, LV_OPA_COVER >> 1);
+        }
+    }
 #endif
+}
+
+/**
+ * Calculate the coverage of a border's corner the same way `lv_draw_rect_border_corner()` draws it
+ * @param rows the tile with cleared coverage
+ * @param n width and height of the tile
+ * @param radius radius of the corner
+ * @param bwidth width of the border after corrections
+ * @param aa true: anti-alias the edges
+ */
+static void lv_draw_corner_tile_border(lv_corner_row_t * rows, lv_coord_t n, lv_coord_t radius, lv_coord_t bwidth,
+                                       bool aa)
+{
+    lv_point_t cir_out;
+    lv_coord_t tmp_out;
+    lv_circ_init(&cir_out, &tmp_out, radius);
+
+    lv_point_t cir_in;
+    lv_coord_t tmp_in;
+    lv_coord_t radius_in = radius - bwidth;
+    if(radius_in < 0) radius_in = 0;
+    lv_circ_init(&cir_in, &tmp_in, radius_in);
+
+    lv_coord_t act_w1;
+    lv_coord_t act_w2;
+
+#if LV_ANTIALIAS
+    lv_coord_t out_y_seg_start = 0;
+    lv_coord_t out_x_last      = radius;
+    lv_coord_t in_y_seg_start  = 0;
+    lv_coord_t in_x_last       = radius - bwidth;
+    lv_coord_t seg_size;
+    lv_coord_t i;
+    lv_opa_t aa_opa;
+#else
+    (void)aa;
+#endif
+
+    while(cir_out.y <= cir_out.x) {
+        /*Calculate the actual width to avoid overwriting pixels*/
+        if(cir_in.y < cir_in.x) {
+            act_w1 = cir_out.x - cir_in.x;
+            act_w2 = act_w1;
+        } else {
+            act_w1 = cir_out.x - cir_out.y;
+            act_w2 = act_w1 - 1;
+        }
+
+#if LV_ANTIALIAS
+        if(aa) {
+            /*New step in y on the outter circle*/
+            if(out_x_last != cir_out.x) {
+                seg_size = cir_out.y - out_y_seg_start;
+                for(i = 0; i < seg_size; i++) {
+                    if(seg_size > CIRCLE_AA_NON_LINEAR_OPA_THRESHOLD) {
+                        aa_opa = antialias_get_opa_circ(seg_size, i, LV_OPA_COVER);
+                    } else {
+                        aa_opa = LV_OPA_COVER - lv_draw_aa_get_opa(seg_size, i, LV_OPA_COVER);
+                    }
+                    lv_draw_corner_tile_px(rows, n, out_x_last + 1, out_y_seg_start + i, aa_opa);
+                    lv_draw_corner_tile_px(rows, n, out_y_seg_start + i, out_x_last + 1, aa_opa);
+                }
+
+                out_x_last      = cir_out.x;
+                out_y_seg_start = cir_out.y;
+            }
+
+            /*New step in y on the inner circle*/
+            if(in_x_last != cir_in.x) {
+                seg_size = cir_out.y - in_y_seg_start;
+                for(i = 0; i < seg_size; i++) {
+                    if(seg_size > CIRCLE_AA_NON_LINEAR_OPA_THRESHOLD) {
+                        aa_opa = LV_OPA_COVER - antialias_get_opa_circ(seg_size, i, LV_OPA_COVER);
+                    } else {
+                        aa_opa = lv_draw_aa_get_opa(seg_size, i, LV_OPA_COVER);
+                    }
+                    lv_draw_corner_tile_px(rows, n, in_x_last - 1, in_y_seg_start + i, aa_opa);
+
+                    /*Be sure the pixels on the middle are not drawn twice*/
+                    if(in_x_last - 1 != in_y_seg_start + i) {
+                        lv_draw_corner_tile_px(rows, n, in_y_seg_start + i, in_x_last - 1, aa_opa);
+                    }
+                }
+
+                in_x_last      = cir_in.x;
+                in_y_seg_start = cir_out.y;
+            }
+        }
+#endif
+        lv_draw_corner_tile_row(rows, n, cir_out.y, cir_out.x - act_w2, cir_out.x);
+        for(i = cir_out.x - act_w1; i <= cir_out.x; i++) {
+            lv_draw_corner_tile_row(rows, n, i, cir_out.y, cir_out.y);
+        }
+
+        lv_circ_next(&cir_out, &tmp_out);
+
+        /*The internal circle will be ready faster
+         * so check it! */
+        if(cir_in.y < cir_in.x) {
+            lv_circ_next(&cir_in, &tmp_in);
+        }
+    }
+
+#if LV_ANTIALIAS
+    if(aa) {
+        /*Last parts of the outer anti-alias*/
+        seg_size = cir_out.y - out_y_seg_start;
+        for(i = 0; i < seg_size; i++) {
+            aa_opa = LV_OPA_COVER - lv_draw_aa_get_opa(seg_size, i, LV_OPA_COVER);
+            lv_draw_corner_tile_px(rows, n, out_x_last + 1, out_y_seg_start + i, aa_opa);
+            lv_draw_corner_tile_px(rows, n, out_y_seg_start + i, out_x_last + 1, aa_opa);
+        }
+
+        /*In some cases the last pixel in the outer middle is not drawn*/
+        if(LV_MATH_ABS(out_x_last - out_y_seg_start) == seg_size) {
+            lv_draw_corner_tile_px(rows, n, out_x_last, out_x_last, LV_OPA_COVER >> 1);
+        }
+
+        /*Last parts of the inner anti-alias*/
+        seg_size = cir_in.y - in_y_seg_start;
+        for(i = 0; i < seg_size; i++) {
+            aa_opa = lv_draw_aa_get_opa(seg_size, i, LV_OPA_COVER);
+            lv_draw_corner_tile_px(rows, n, in_x_last - 1, in_y_seg_start + i, aa_opa);
+            if(in_x_last - 1 != in_y_seg_start + i) {
+                lv_draw_corner_tile_px(rows, n, in_y_seg_start + i, in_x_last - 1, aa_opa);
+            }
+        }
+    }
+#endif
+}
+
+/**
+ * Add coverage to a pixel of a tile
+ * @param rows the tile
+ * @param n width and height of the tile
+ * @param dx x distance from the origo
+ * @param dy y distance from the origo
+ * @param cov coverage of the pixel
+ */
+static void lv_draw_corner_tile_px(lv_corner_row_t * rows, lv_coord_t n, lv_coord_t dx, lv_coord_t dy, lv_opa_t cov)
+{
+    if(dx < 0 || dy < 0 || dx >= n || dy >= n) return;
+
+    /*Pixels covered twice add up the way blending them twice would*/
+    uint8_t * p = (uint8_t *)&rows[n] + (uint32_t)dy * n + dx;
+    *p          = *p + (uint16_t)((uint16_t)cov * (LV_OPA_COVER - *p)) / LV_OPA_COVER;
+}
+
+/**
+ * Fully cover a run of a tile's row
+ * @param rows the tile
+ * @param n width and height of the tile
+ * @param dy index of the row
+ * @param dx1 first pixel of the run
+ * @param dx2 last pixel of the run
+ */
+static void lv_draw_corner_tile_row(lv_corner_row_t * rows, lv_coord_t n, lv_coord_t dy, lv_coord_t dx1,
+                                    lv_coord_t dx2)
+{
+    if(dy < 0 || dy >= n) return;
+    if(dx1 < 0) dx1 = 0;
+    if(dx2 >= n) dx2 = n - 1;
+    if(dx1 > dx2) return;
+
+    memset((uint8_t *)&rows[n] + (uint32_t)dy * n + dx1, LV_OPA_COVER, dx2 - dx1 + 1);
+}
+
+#endif /*LV_CORNER_CACHE_SIZE*/
 
 static uint16_t lv_draw_cont_radius_corr(uint16_t r, lv_coord_t w, lv_coord_t h)
 {
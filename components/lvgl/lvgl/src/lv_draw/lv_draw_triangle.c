@@ -17,12 +17,21 @@
  *      TYPEDEFS
  **********************/
 
+/*A not horizontal edge of a polygon, directed downwards*/
+typedef struct
+{
+    lv_coord_t x_top;
+    lv_coord_t y_top;
+    lv_coord_t y_bottom;
+    lv_coord_t dx;
+} poly_edge_t;
+
 /**********************
  *  STATIC PROTOTYPES
  **********************/
-void tri_draw_flat(const lv_point_t * points, const lv_area_t * mask, const lv_style_t * style, lv_opa_t opa);
-void tri_draw_tall(const lv_point_t * points, const lv_area_t * mask, const lv_style_t * style, lv_opa_t opa);
-static void point_swap(lv_point_t * p1, lv_point_t * p2);
+static void poly_fill(const lv_point_t * points, uint32_t point_cnt, const lv_area_t * mask, lv_color_t color,
+                      lv_opa_t opa);
+static lv_coord_t edge_cross(const poly_edge_t * edge, lv_coord_t y);
 
 /**********************
  *  STATIC VARIABLES
@@ -56,30 +65,12 @@ void lv_draw_triangle(const lv_point_t * points, const lv_area_t * mask, const l
 
     lv_opa_t opa = opa_scale == LV_OPA_COVER ? style->body.opa : (uint16_t)((uint16_t)style->body.opa * opa_scale) >> 8;
 
-    /*Is the triangle flat or tall?*/
-    lv_coord_t x_min = LV_MATH_MIN(LV_MATH_MIN(points[0].x, points[1].x), points[2].x);
-    lv_coord_t x_max = LV_MATH_MAX(LV_MATH_MAX(points[0].x, points[1].x), points[2].x);
-    lv_coord_t y_min = LV_MATH_MIN(LV_MATH_MIN(points[0].y, points[1].y), points[2].y);
-    lv_coord_t y_max = LV_MATH_MAX(LV_MATH_MAX(points[0].y, points[1].y), points[2].y);
-
-    /* Draw the tall rectangles from vertical lines
-     * and from the flat triangles from horizontal lines
-     * to minimize the number of lines.
-     * Some pixels are overdrawn on the common edges of the triangles
-     * so use it only if the triangle has no opacity*/
-
-    /* Draw from horizontal lines*/
-    if(x_max - x_min < y_max - y_min) {
-        tri_draw_tall(points, mask, style, opa);
-    }
-    /*Else flat so draw from vertical lines*/
-    else {
-        tri_draw_flat(points, mask, style, opa);
-    }
+    poly_fill(points, 3, mask, style->body.main_color, opa);
 }
 
 /**
- * Draw a polygon from triangles. Only convex polygons are supported
+ * Draw a polygon. Convex and concave polygons are supported too.
+ * Self-intersecting polygons are filled with the even-odd rule.
  * @param points an array of points
  * @param point_cnt number of points
  * @param mask polygon will be drawn only in this mask
@@ -92,253 +83,154 @@ void lv_draw_polygon(const lv_point_t * points, uint32_t point_cnt, const lv_are
     if(point_cnt < 3) return;
     if(points == NULL) return;
 
-    uint32_t i;
-    lv_point_t tri[3];
-    tri[0].x = points[0].x;
-    tri[0].y = points[0].y;
-    for(i = 0; i < point_cnt - 1; i++) {
-        tri[1].x = points[i].x;
-        tri[1].y = points[i].y;
-        tri[2].x = points[i + 1].x;
-        tri[2].y = points[i + 1].y;
-        lv_draw_triangle(tri, mask, style, opa_scale);
-    }
+    lv_opa_t opa = opa_scale == LV_OPA_COVER ? style->body.opa : (uint16_t)((uint16_t)style->body.opa * opa_scale) >> 8;
+
+    poly_fill(points, point_cnt, mask, style->body.main_color, opa);
 }
 
 /**********************
  *   STATIC FUNCTIONS
  **********************/
 
-void tri_draw_flat(const lv_point_t * points, const lv_area_t * mask, const lv_style_t * style, lv_opa_t opa)
+/**
+ * Fill a polygon row by row with horizontal spans.
+ * A pixel is drawn if it's on or right of a left edge and left of a right edge,
+ * and on or below a top edge and above a bottom edge.
+ * This way polygons sharing an edge neither overlap nor leave a gap.
+ * Rows with the same single span are merged into one rectangle.
+ * @param points an array of points
+ * @param point_cnt number of points
+ * @param mask polygon will be drawn only in this mask
+ * @param color color of the polygon
+ * @param opa opacity of the polygon
+ */
+static void poly_fill(const lv_point_t * points, uint32_t point_cnt, const lv_area_t * mask, lv_color_t color,
+                      lv_opa_t opa)
 {
-    /*Return if the points are out of the mask*/
-    if(points[0].x < mask->x1 && points[1].x < mask->x1 && points[2].x < mask->x1) {
-        return;
-    }
-
-    if(points[0].x > mask->x2 && points[1].x > mask->x2 && points[2].x > mask->x2) {
-        return;
-    }
-
-    if(points[0].y < mask->y1 && points[1].y < mask->y1 && points[2].y < mask->y1) {
-        return;
-    }
-
-    if(points[0].y > mask->y2 && points[1].y > mask->y2 && points[2].y > mask->y2) {
-        return;
+    lv_coord_t y_min = LV_COORD_MAX;
+    lv_coord_t y_max = LV_COORD_MIN;
+    lv_coord_t x_min = LV_COORD_MAX;
+    lv_coord_t x_max = LV_COORD_MIN;
+    uint32_t i;
+    for(i = 0; i < point_cnt; i++) {
+        x_min = LV_MATH_MIN(x_min, points[i].x);
+        x_max = LV_MATH_MAX(x_max, points[i].x);
+        y_min = LV_MATH_MIN(y_min, points[i].y);
+        y_max = LV_MATH_MAX(y_max, points[i].y);
     }
 
-    lv_point_t tri[3];
-
-    memcpy(tri, points, sizeof(tri));
-
-    /*Sort the vertices according to their y coordinate (0: y max, 1: y mid, 2:y min)*/
-    if(tri[1].y < tri[0].y) point_swap(&tri[1], &tri[0]);
-    if(tri[2].y < tri[1].y) point_swap(&tri[2], &tri[1]);
-    if(tri[1].y < tri[0].y) point_swap(&tri[1], &tri[0]);
-
-    /*Draw the triangle*/
-    lv_point_t edge1;
-    lv_coord_t dx1  = LV_MATH_ABS(tri[0].x - tri[1].x);
-    lv_coord_t sx1  = tri[0].x < tri[1].x ? 1 : -1;
-    lv_coord_t dy1  = LV_MATH_ABS(tri[0].y - tri[1].y);
-    lv_coord_t sy1  = tri[0].y < tri[1].y ? 1 : -1;
-    lv_coord_t err1 = (dx1 > dy1 ? dx1 : -dy1) / 2;
-    lv_coord_t err_tmp1;
-
-    lv_point_t edge2;
-    lv_coord_t dx2  = LV_MATH_ABS(tri[0].x - tri[2].x);
-    lv_coord_t sx2  = tri[0].x < tri[2].x ? 1 : -1;
-    lv_coord_t dy2  = LV_MATH_ABS(tri[0].y - tri[2].y);
-    lv_coord_t sy2  = tri[0].y < tri[2].y ? 1 : -1;
-    lv_coord_t err2 = (dx1 > dy2 ? dx2 : -dy2) / 2;
-    lv_coord_t err_tmp2;
-
-    lv_coord_t y1_tmp;
-    lv_coord_t y2_tmp;
-
-    edge1.x = tri[0].x;
-    edge1.y = tri[0].y;
-    edge2.x = tri[0].x;
-    edge2.y = tri[0].y;
-    lv_area_t act_area;
-    lv_area_t draw_area;
-
-    while(1) {
-        act_area.x1 = edge1.x;
-        act_area.x2 = edge2.x;
-        act_area.y1 = edge1.y;
-        act_area.y2 = edge2.y;
-
-        /* Get the area of a line.
-         * Adjust it a little bit to perfectly match (no redrawn pixels) with the adjacent triangles*/
-        draw_area.x1 = LV_MATH_MIN(act_area.x1, act_area.x2) + 1;
-        draw_area.x2 = LV_MATH_MAX(act_area.x1, act_area.x2);
-        draw_area.y1 = LV_MATH_MIN(act_area.y1, act_area.y2) - 1;
-        draw_area.y2 = LV_MATH_MAX(act_area.y1, act_area.y2) - 1;
-
-        lv_draw_fill(&draw_area, mask, style->body.main_color, opa);
-
-        /*Calc. the next point of edge1*/
-        y1_tmp = edge1.y;
-        do {
-            if(edge1.x == tri[1].x && edge1.y == tri[1].y) {
-
-                dx1  = LV_MATH_ABS(tri[1].x - tri[2].x);
-                sx1  = tri[1].x < tri[2].x ? 1 : -1;
-                dy1  = LV_MATH_ABS(tri[1].y - tri[2].y);
-                sy1  = tri[1].y < tri[2].y ? 1 : -1;
-                err1 = (dx1 > dy1 ? dx1 : -dy1) / 2;
-            } else if(edge1.x == tri[2].x && edge1.y == tri[2].y) {
-                return;
-            }
-            err_tmp1 = err1;
-            if(err_tmp1 > -dx1) {
-                err1 -= dy1;
-                edge1.x += sx1;
-            }
-            if(err_tmp1 < dy1) {
-                err1 += dx1;
-                edge1.y += sy1;
-            }
-        } while(edge1.y == y1_tmp);
-
-        /*Calc. the next point of edge2*/
-        y2_tmp = edge2.y;
-        do {
-            if(edge2.x == tri[2].x && edge2.y == tri[2].y) return;
-            err_tmp2 = err2;
-            if(err_tmp2 > -dx2) {
-                err2 -= dy2;
-                edge2.x += sx2;
-            }
-            if(err_tmp2 < dy2) {
-                err2 += dx2;
-                edge2.y += sy2;
-            }
-        } while(edge2.y == y2_tmp);
+    /*Return if the polygon is out of the mask*/
+    if(x_max < mask->x1 || x_min > mask->x2 || y_max < mask->y1 || y_min > mask->y2) return;
+
+    /*Collect the edges sorted by their top. Horizontal edges never cross a row so skip them*/
+    uint8_t * buf        = lv_draw_get_buf(point_cnt * (sizeof(poly_edge_t) + sizeof(poly_edge_t *) + sizeof(lv_coord_t)));
+    poly_edge_t * edges  = (poly_edge_t *)buf;
+    poly_edge_t ** act   = (poly_edge_t **)(buf + point_cnt * sizeof(poly_edge_t));
+    lv_coord_t * x_cross = (lv_coord_t *)(buf + point_cnt * (sizeof(poly_edge_t) + sizeof(poly_edge_t *)));
+    uint32_t edge_cnt    = 0;
+    for(i = 0; i < point_cnt; i++) {
+        const lv_point_t * p1 = &points[i];
+        const lv_point_t * p2 = &points[i + 1 < point_cnt ? i + 1 : 0];
+        if(p1->y == p2->y) continue;
+        if(p1->y > p2->y) {
+            const lv_point_t * tmp = p1;
+            p1                     = p2;
+            p2                     = tmp;
+        }
+
+        poly_edge_t edge;
+        edge.x_top    = p1->x;
+        edge.y_top    = p1->y;
+        edge.y_bottom = p2->y;
+        edge.dx       = p2->x - p1->x;
+
+        uint32_t j = edge_cnt;
+        while(j > 0 && edges[j - 1].y_top > edge.y_top) {
+            edges[j] = edges[j - 1];
+            j--;
+        }
+        edges[j] = edge;
+        edge_cnt++;
     }
-}
-
-void tri_draw_tall(const lv_point_t * points, const lv_area_t * mask, const lv_style_t * style, lv_opa_t opa)
-{
-    /*
-     * Better to draw from vertical lines
-     * |\
-     * | |
-     * | |
-     * |  \
-     * |   |
-     * |___|
-     */
-
-    lv_point_t tri[3];
-
-    memcpy(tri, points, sizeof(tri));
-
-    /*Sort the vertices according to their x coordinate (0: x max, 1: x mid, 2:x min)*/
-    if(tri[1].x < tri[0].x) point_swap(&tri[1], &tri[0]);
-    if(tri[2].x < tri[1].x) point_swap(&tri[2], &tri[1]);
-    if(tri[1].x < tri[0].x) point_swap(&tri[1], &tri[0]);
-
-    /*Draw the triangle*/
-    lv_point_t edge1;
-    lv_coord_t dx1  = LV_MATH_ABS(tri[0].x - tri[1].x);
-    lv_coord_t sx1  = tri[0].x < tri[1].x ? 1 : -1;
-    lv_coord_t dy1  = LV_MATH_ABS(tri[0].y - tri[1].y);
-    lv_coord_t sy1  = tri[0].y < tri[1].y ? 1 : -1;
-    lv_coord_t err1 = (dx1 > dy1 ? dx1 : -dy1) / 2;
-    lv_coord_t err_tmp1;
-
-    lv_point_t edge2;
-    lv_coord_t dx2  = LV_MATH_ABS(tri[0].x - tri[2].x);
-    lv_coord_t sx2  = tri[0].x < tri[2].x ? 1 : -1;
-    lv_coord_t dy2  = LV_MATH_ABS(tri[0].y - tri[2].y);
-    lv_coord_t sy2  = tri[0].y < tri[2].y ? 1 : -1;
-    lv_coord_t err2 = (dx1 > dy2 ? dx2 : -dy2) / 2;
-    lv_coord_t err_tmp2;
-
-    lv_coord_t x1_tmp;
-    lv_coord_t x2_tmp;
-
-    edge1.x = tri[0].x;
-    edge1.y = tri[0].y;
-    edge2.x = tri[0].x;
-    edge2.y = tri[0].y;
-    lv_area_t act_area;
-    lv_area_t draw_area;
-
-    while(1) {
-        act_area.x1 = edge1.x;
-        act_area.x2 = edge2.x;
-        act_area.y1 = edge1.y;
-        act_area.y2 = edge2.y;
-
-        draw_area.x1 = LV_MATH_MIN(act_area.x1, act_area.x2);
-        draw_area.x2 = LV_MATH_MAX(act_area.x1, act_area.x2);
-        draw_area.y1 = LV_MATH_MIN(act_area.y1, act_area.y2);
-        draw_area.y2 = LV_MATH_MAX(act_area.y1, act_area.y2) - 1;
-
-        lv_draw_fill(&draw_area, mask, style->body.main_color, opa);
-
-        /*Calc. the next point of edge1*/
-        x1_tmp = edge1.x;
-        do {
-            if(edge1.y == tri[1].y && edge1.x == tri[1].x) {
-
-                dx1  = LV_MATH_ABS(tri[1].x - tri[2].x);
-                sx1  = tri[1].x < tri[2].x ? 1 : -1;
-                dy1  = LV_MATH_ABS(tri[1].y - tri[2].y);
-                sy1  = tri[1].y < tri[2].y ? 1 : -1;
-                err1 = (dx1 > dy1 ? dx1 : -dy1) / 2;
-            } else if(edge1.y == tri[2].y && edge1.x == tri[2].x) {
-                return;
-            }
-            err_tmp1 = err1;
-            if(err_tmp1 > -dx1) {
-                err1 -= dy1;
-                edge1.x += sx1;
-            }
-            if(err_tmp1 < dy1) {
-                err1 += dx1;
-                edge1.y += sy1;
-            }
-        } while(edge1.x == x1_tmp);
 
-        /*Calc. the next point of edge2*/
-        x2_tmp = edge2.x;
-        do {
-            if(edge2.y == tri[2].y && edge2.x == tri[2].x) {
-                return;
+    lv_coord_t y_start = LV_MATH_MAX(y_min, mask->y1);
+    lv_coord_t y_end   = LV_MATH_MIN(y_max - 1, mask->y2);
+    uint32_t next_edge = 0;
+    uint32_t act_cnt   = 0;
+    lv_area_t pending;
+    bool pending_valid = false;
+    lv_area_t span;
+    lv_coord_t y;
+    for(y = y_start; y <= y_end; y++) {
+        /*Update the edges crossing this row*/
+        while(next_edge < edge_cnt && edges[next_edge].y_top <= y) {
+            act[act_cnt++] = &edges[next_edge];
+            next_edge++;
+        }
+
+        uint32_t cross_cnt = 0;
+        for(i = 0; i < act_cnt; i++) {
+            if(act[i]->y_bottom <= y) {
+                act[i] = act[act_cnt - 1];
+                act_cnt--;
+                i--;
+                continue;
             }
 
-            err_tmp2 = err2;
-            if(err_tmp2 > -dx2) {
-                err2 -= dy2;
-                edge2.x += sx2;
+            /*Keep the crossings sorted*/
+            lv_coord_t x = edge_cross(act[i], y);
+            uint32_t j   = cross_cnt;
+            while(j > 0 && x_cross[j - 1] > x) {
+                x_cross[j] = x_cross[j - 1];
+                j--;
             }
-            if(err_tmp2 < dy2) {
-                err2 += dx2;
-                edge2.y += sy2;
+            x_cross[j] = x;
+            cross_cnt++;
+        }
+
+        /*A single span which continues the previous row's can be merged into it*/
+        if(cross_cnt == 2 && pending_valid && pending.y2 == y - 1 && pending.x1 == x_cross[0] &&
+           pending.x2 == x_cross[1] - 1) {
+            pending.y2 = y;
+            continue;
+        }
+
+        if(pending_valid) {
+            lv_draw_fill(&pending, mask, color, opa);
+            pending_valid = false;
+        }
+
+        if(cross_cnt == 2) {
+            if(x_cross[0] < x_cross[1]) {
+                lv_area_set(&pending, x_cross[0], y, x_cross[1] - 1, y);
+                pending_valid = true;
             }
-        } while(edge2.x == x2_tmp);
+            continue;
+        }
+
+        for(i = 0; i + 1 < cross_cnt; i += 2) {
+            if(x_cross[i] >= x_cross[i + 1]) continue;
+            lv_area_set(&span, x_cross[i], y, x_cross[i + 1] - 1, y);
+            lv_draw_fill(&span, mask, color, opa);
+        }
     }
+
+    if(pending_valid) lv_draw_fill(&pending, mask, color, opa);
 }
 
 /**
- * Swap two points
- * p1 pointer to the first point
- * p2 pointer to the second point
+ * Get the first pixel on or right of where an edge crosses a row
+ * @param edge pointer to an edge
+ * @param y the row (`y_top <= y < y_bottom`)
+ * @return the x coordinate of the pixel
  */
-static void point_swap(lv_point_t * p1, lv_point_t * p2)
+static lv_coord_t edge_cross(const poly_edge_t * edge, lv_coord_t y)
 {
-    lv_point_t tmp;
-    tmp.x = p1->x;
-    tmp.y = p1->y;
+    int32_t dy  = edge->y_bottom - edge->y_top;
+    int32_t num = (int32_t)(y - edge->y_top) * edge->dx;
 
-    p1->x = p2->x;
-    p1->y = p2->y;
+    /*Round up: x_top + ceil(num / dy)*/
+    if(num >= 0) return edge->x_top + (num + dy - 1) / dy;
 
-    p2->x = tmp.x;
-    p2->y = tmp.y;
+    return edge->x_top - (-num) / dy;
 }
@@ -37,7 +37,8 @@ extern "C" {
 void lv_draw_triangle(const lv_point_t * points, const lv_area_t * mask, const lv_style_t * style, lv_opa_t opa_scale);
 
 /**
- * Draw a polygon from triangles. Only convex polygons are supported
+ * Draw a polygon. Convex and concave polygons are supported too.
+ * Self-intersecting polygons are filled with the even-odd rule.
  * @param points an array of points
  * @param point_cnt number of points
  * @param mask polygon will be drawn only in this mask
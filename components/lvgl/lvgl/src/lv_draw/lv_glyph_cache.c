@@ -0,0 +1,173 @@
+/**
+ * @file lv_glyph_cache.c
+ *
+ */
+
+/*********************
+ *      INCLUDES
+ *********************/
+#include "lv_glyph_cache.h"
+#include "../lv_misc/lv_mem.h"
+#include "../lv_misc/lv_types.h"
+#include <string.h>
+
+#if LV_GLYPH_CACHE_MEM_SIZE
+
+/*********************
+ *      DEFINES
+ *********************/
+/*Letters with their own entry*/
+#define LV_GLYPH_CACHE_ASCII_FIRST 0x20
+#define LV_GLYPH_CACHE_ASCII_LAST 0x7E
+#define LV_GLYPH_CACHE_ASCII_CNT (LV_GLYPH_CACHE_ASCII_LAST - LV_GLYPH_CACHE_ASCII_FIRST + 1)
+
+#if LV_GLYPH_CACHE_SIZE < 1
+#error "LV_GLYPH_CACHE_SIZE must be >= 1. See lv_conf.h"
+#endif
+
+/**********************
+ *      TYPEDEFS
+ **********************/
+
+/**********************
+ *  STATIC PROTOTYPES
+ **********************/
+static void entry_free(lv_glyph_cache_entry_t * entry);
+static void expand_bitmap(uint8_t * mask, const uint8_t * map_p, const lv_font_glyph_dsc_t * dsc);
+
+/**********************
+ *  STATIC VARIABLES
+ **********************/
+static lv_glyph_cache_entry_t ascii_cache[LV_GLYPH_CACHE_ASCII_CNT];
+static lv_glyph_cache_entry_t hash_cache[LV_GLYPH_CACHE_SIZE];
+
+/*Bytes of masks in the cache*/
+static uint32_t mem_used;
+
+/**********************
+ *      MACROS
+ **********************/
+
+/**********************
+ *   GLOBAL FUNCTIONS
+ **********************/
+
+/**
+ * Get a glyph expanded to an opacity mask, adding it to the cache if required.
+ * ASCII letters each have their own entry, the others share `LV_GLYPH_CACHE_SIZE` hashed entries.
+ * @param font_p pointer to font
+ * @param letter a letter
+ * @return pointer to the cache entry or NULL if the glyph is not found or doesn't fit into the cache
+ */
+const lv_glyph_cache_entry_t * lv_glyph_cache_get(const lv_font_t * font_p, uint32_t letter)
+{
+    lv_glyph_cache_entry_t * entry;
+
+    if(letter >= LV_GLYPH_CACHE_ASCII_FIRST && letter <= LV_GLYPH_CACHE_ASCII_LAST) {
+        entry = &ascii_cache[letter - LV_GLYPH_CACHE_ASCII_FIRST];
+    } else {
+        uint32_t hash = (letter ^ ((lv_uintptr_t)font_p >> 2)) * 2654435761U;
+        entry         = &hash_cache[(hash >> 16) % LV_GLYPH_CACHE_SIZE];
+    }
+
+    if(entry->font == font_p && entry->letter == letter) return entry;
+
+    /*Not cached: replace the glyph of the entry*/
+    entry_free(entry);
+
+    lv_font_glyph_dsc_t g;
+    if(lv_font_get_glyph_dsc(font_p, &g, letter, '\0') == false) return NULL;
+    if(g.bpp != 1 && g.bpp != 2 && g.bpp != 4 && g.bpp != 8) return NULL;
+
+    uint32_t size = (uint32_t)g.box_w * g.box_h;
+    if(size > 0) {
+        if(mem_used + size > LV_GLYPH_CACHE_MEM_SIZE) return NULL;
+
+        const uint8_t * map_p = lv_font_get_glyph_bitmap(font_p, letter);
+        if(map_p == NULL) return NULL;
+
+        entry->mask = lv_mem_alloc(size);
+        if(entry->mask == NULL) return NULL;
+
+        expand_bitmap(entry->mask, map_p, &g);
+        mem_used += size;
+    }
+
+    entry->font   = font_p;
+    entry->letter = letter;
+    entry->dsc    = g;
+
+    return entry;
+}
+
+/**
+ * Remove the glyphs of a font from the cache.
+ * Required before a font which was drawn is freed or modified.
+ * @param font_p pointer to a font or NULL to free every cached glyph
+ */
+void lv_glyph_cache_invalidate_font(const lv_font_t * font_p)
+{
+    uint16_t i;
+    for(i = 0; i < LV_GLYPH_CACHE_ASCII_CNT; i++) {
+        if(font_p == NULL || ascii_cache[i].font == font_p) entry_free(&ascii_cache[i]);
+    }
+
+    for(i = 0; i < LV_GLYPH_CACHE_SIZE; i++) {
+        if(font_p == NULL || hash_cache[i].font == font_p) entry_free(&hash_cache[i]);
+    }
+}
+
+/**********************
+ *   STATIC FUNCTIONS
+ **********************/
+
+/**
+ * Free the mask of an entry and mark it unused
+ * @param entry pointer to a cache entry
+ */
+static void entry_free(lv_glyph_cache_entry_t * entry)
+{
+    if(entry->mask) {
+        lv_mem_free(entry->mask);
+        mem_used -= (uint32_t)entry->dsc.box_w * entry->dsc.box_h;
+    }
+
+    entry->mask   = NULL;
+    entry->font   = NULL;
+    entry->letter = 0;
+}
+
+/**
+ * Expand a glyph's bitmap to one opacity per pixel
+ * @param mask store the opacities here (`box_w * box_h` bytes)
+ * @param map_p the glyph's bitmap, pixels packed MSB first with no padding between the rows
+ * @param dsc glyph information
+ */
+static void expand_bitmap(uint8_t * mask, const uint8_t * map_p, const lv_font_glyph_dsc_t * dsc)
+{
+    /*clang-format off*/
+    static const uint8_t bpp1_opa_table[2]  = {0, 255};          /*Opacity mapping with bpp = 1 (Just for compatibility)*/
+    static const uint8_t bpp2_opa_table[4]  = {0, 85, 170, 255}; /*Opacity mapping with bpp = 2*/
+    static const uint8_t bpp4_opa_table[16] = {0,  17, 34,  51,  /*Opacity mapping with bpp = 4*/
+                                               68, 85, 102, 119, 136, 153, 170, 187, 204, 221, 238, 255};
+    /*clang-format on*/
+
+    uint32_t px_cnt = (uint32_t)dsc->box_w * dsc->box_h;
+    uint32_t i;
+
+    if(dsc->bpp == 8) {
+        memcpy(mask, map_p, px_cnt);
+        return;
+    }
+
+    const uint8_t * opa_table = dsc->bpp == 1 ? bpp1_opa_table : (dsc->bpp == 2 ? bpp2_opa_table : bpp4_opa_table);
+    uint8_t px_mask           = (1 << dsc->bpp) - 1;
+    uint32_t bit_ofs          = 0;
+    for(i = 0; i < px_cnt; i++) {
+        uint8_t letter_px = (map_p[bit_ofs >> 3] >> (8 - (bit_ofs & 0x7) - dsc->bpp)) & px_mask;
+        mask[i]           = opa_table[letter_px];
+        bit_ofs += dsc->bpp;
+    }
+}
+
+#endif /*LV_GLYPH_CACHE_MEM_SIZE*/
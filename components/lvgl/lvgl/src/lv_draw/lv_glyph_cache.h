@@ -0,0 +1,77 @@
+/**
+ * @file lv_glyph_cache.h
+ *
+ */
+
+#ifndef LV_GLYPH_CACHE_H
+#define LV_GLYPH_CACHE_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*********************
+ *      INCLUDES
+ *********************/
+#ifdef LV_CONF_INCLUDE_SIMPLE
+#include "lv_conf.h"
+#else
+#include "../../../lv_conf.h"
+#endif
+
+#include "../lv_font/lv_font.h"
+
+/*********************
+ *      DEFINES
+ *********************/
+
+/**********************
+ *      TYPEDEFS
+ **********************/
+
+/**
+ * Unpacking a glyph's 1, 2 or 4 bpp bitmap pixel by pixel every time it's drawn is slow.
+ *
+ * To avoid it the most recently drawn glyphs are kept expanded to 8 bit opacity masks.
+ */
+typedef struct
+{
+    const lv_font_t * font;   /**< Font of the glyph or NULL if the entry is unused*/
+    uint32_t letter;          /**< Unicode code point of the glyph*/
+    lv_font_glyph_dsc_t dsc;  /**< Glyph information*/
+    uint8_t * mask;           /**< `dsc.box_w * dsc.box_h` opacities, row by row*/
+} lv_glyph_cache_entry_t;
+
+/**********************
+ * GLOBAL PROTOTYPES
+ **********************/
+
+#if LV_GLYPH_CACHE_MEM_SIZE
+
+/**
+ * Get a glyph expanded to an opacity mask, adding it to the cache if required.
+ * ASCII letters each have their own entry, the others share `LV_GLYPH_CACHE_SIZE` hashed entries.
+ * @param font_p pointer to font
+ * @param letter a letter
+ * @return pointer to the cache entry or NULL if the glyph is not found or doesn't fit into the cache
+ */
+const lv_glyph_cache_entry_t * lv_glyph_cache_get(const lv_font_t * font_p, uint32_t letter);
+
+/**
+ * Remove the glyphs of a font from the cache.
+ * Required before a font which was drawn is freed or modified.
+ * @param font_p pointer to a font or NULL to free every cached glyph
+ */
+void lv_glyph_cache_invalidate_font(const lv_font_t * font_p);
+
+#endif
+
+/**********************
+ *      MACROS
+ **********************/
+
+#ifdef __cplusplus
+} /* extern "C" */
+#endif
+
+#endif /*LV_GLYPH_CACHE_H*/
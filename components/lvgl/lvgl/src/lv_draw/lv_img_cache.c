@@ -9,6 +9,7 @@
 #include "lv_img_cache.h"
 #include "../lv_hal/lv_hal_tick.h"
 #include "../lv_misc/lv_gc.h"
+#include "lv_draw_img.h"
 
 #if defined(LV_GC_INCLUDE)
 #include LV_GC_INCLUDE
@@ -16,9 +17,6 @@
 /*********************
  *      DEFINES
  *********************/
-/*Decrement life with this value in every open*/
-#define LV_IMG_CACHE_AGING 1
-
 /*Boost life by this factor (multiply time_to_open with this value)*/
 #define LV_IMG_CACHE_LIFE_GAIN 1
 
@@ -26,23 +24,74 @@
  * "die" from very high values */
 #define LV_IMG_CACHE_LIFE_LIMIT 1000
 
+/*An image is cached in one of this many entries following the position given by the hash of
+ * its source, so looking it up doesn't depend on the size of the cache*/
+#define LV_IMG_CACHE_PROBE 4
+
 #if LV_IMG_CACHE_DEF_SIZE < 1
 #error "LV_IMG_CACHE_DEF_SIZE must be >= 1. See lv_conf.h"
 #endif
 
+#if LV_IMG_CACHE_MEM_SIZE
+#if LV_IMG_CACHE_CUSTOM
+#include LV_IMG_CACHE_CUSTOM_INCLUDE
+#define IMG_CACHE_ALLOC(size) LV_IMG_CACHE_CUSTOM_ALLOC(size)
+#define IMG_CACHE_FREE(p) LV_IMG_CACHE_CUSTOM_FREE(p)
+#else
+#define IMG_CACHE_ALLOC(size) lv_mem_alloc(size)
+#define IMG_CACHE_FREE(p) lv_mem_free(p)
+#endif
+#endif
+
 /**********************
  *      TYPEDEFS
  **********************/
+#if LV_IMG_CACHE_MEM_SIZE && LV_IMG_CACHE_RECOLOR
+/*Recolored pixels of a cached image*/
+typedef struct
+{
+    lv_img_cache_entry_t * entry; /*The image, NULL if the variant is empty*/
+    lv_color_t color;
+    lv_color_t chroma;
+    lv_opa_t intense;
+    uint32_t last_use; /*`open_cnt` when it was last asked for*/
+    uint8_t * buf;
+    uint32_t size;
+} lv_img_cache_recolor_t;
+#endif
 
 /**********************
  *  STATIC PROTOTYPES
  **********************/
+static uint16_t img_cache_home(const void * src);
+static int32_t img_cache_life(const lv_img_cache_entry_t * entry);
+static void img_cache_close(lv_img_cache_entry_t * entry);
+#if LV_IMG_CACHE_MEM_SIZE
+static void img_cache_decode(lv_img_cache_entry_t * entry);
+#endif
+#if LV_IMG_CACHE_MEM_SIZE && LV_IMG_CACHE_RECOLOR
+static void img_cache_recolor_free(lv_img_cache_recolor_t * v);
+static lv_img_cache_recolor_t * img_cache_recolor_oldest(void);
+#endif
 
 /**********************
  *  STATIC VARIABLES
  **********************/
 static uint16_t entry_cnt;
 
+/*Incremented in every open. Entries store their `life` relative to it so they age without
+ * being touched.*/
+static uint32_t open_cnt;
+
+#if LV_IMG_CACHE_MEM_SIZE
+/*Bytes of pixels decoded by the cache*/
+static uint32_t decoded_size;
+#endif
+
+#if LV_IMG_CACHE_MEM_SIZE && LV_IMG_CACHE_RECOLOR
+static lv_img_cache_recolor_t recolored[LV_IMG_CACHE_RECOLOR];
+#endif
+
 /**********************
  *      MACROS
  **********************/
@@ -68,42 +117,42 @@ lv_img_cache_entry_t * lv_img_cache_open(const void * src, const lv_style_t * st
 
     lv_img_cache_entry_t * cache = LV_GC_ROOT(_lv_img_cache_array);
 
-    /*Decrement all lifes. Make the entries older*/
-    uint16_t i;
-    for(i = 0; i < entry_cnt; i++) {
-        if(cache[i].life > INT32_MIN + LV_IMG_CACHE_AGING) {
-            cache[i].life -= LV_IMG_CACHE_AGING;
-        }
-    }
+    /*Make the entries older*/
+    open_cnt++;
 
-    /*Is the image cached?*/
+    /*Is the image cached? Look only at the entries it can be cached in and remember the one with
+     * the least life to reuse it if not.*/
+    uint16_t probe_cnt                = entry_cnt < LV_IMG_CACHE_PROBE ? entry_cnt : LV_IMG_CACHE_PROBE;
+    uint16_t home                     = img_cache_home(src);
     lv_img_cache_entry_t * cached_src = NULL;
-    for(i = 0; i < entry_cnt; i++) {
-        if(cache[i].dec_dsc.src == src) {
-            /* If opened increment its life.
-             * Image difficult to open should live longer to keep avoid frequent their recaching.
-             * Therefore increase `life` with `time_to_open`*/
-            cached_src = &cache[i];
-            cached_src->life += cached_src->dec_dsc.time_to_open * LV_IMG_CACHE_LIFE_GAIN;
-            if(cached_src->life > LV_IMG_CACHE_LIFE_LIMIT) cached_src->life = LV_IMG_CACHE_LIFE_LIMIT;
-            LV_LOG_TRACE("image draw: image found in the cache");
+    lv_img_cache_entry_t * weakest    = NULL;
+    uint16_t i;
+    for(i = 0; i < probe_cnt; i++) {
+        lv_img_cache_entry_t * entry = &cache[(home + i) % entry_cnt];
+        if(entry->dec_dsc.src == src) {
+            cached_src = entry;
             break;
         }
+
+        if(weakest == NULL || img_cache_life(entry) < img_cache_life(weakest)) weakest = entry;
     }
 
+    if(cached_src) {
+        /* If opened increment its life.
+         * Image difficult to open should live longer to keep avoid frequent their recaching.
+         * Therefore increase `life` with `time_to_open`*/
+        int32_t life = img_cache_life(cached_src) + cached_src->dec_dsc.time_to_open * LV_IMG_CACHE_LIFE_GAIN;
+        if(life > LV_IMG_CACHE_LIFE_LIMIT) life = LV_IMG_CACHE_LIFE_LIMIT;
+        cached_src->life = (int32_t)(open_cnt + life);
+        LV_LOG_TRACE("image draw: image found in the cache");
+    }
     /*The image is not cached then cache it now*/
-    if(cached_src == NULL) {
-        /*Find an entry to reuse. Select the entry with the least life*/
-        cached_src = &cache[0];
-        for(i = 1; i < entry_cnt; i++) {
-            if(cache[i].life < cached_src->life) {
-                cached_src = &cache[i];
-            }
-        }
+    else {
+        cached_src = weakest;
 
         /*Close the decoder to reuse if it was opened (has a valid source)*/
         if(cached_src->dec_dsc.src) {
-            lv_img_decoder_close(&cached_src->dec_dsc);
+            img_cache_close(cached_src);
             LV_LOG_INFO("image draw: cache miss, close and reuse an entry");
         } else {
             LV_LOG_INFO("image draw: cache miss, cached to an empty entry");
@@ -117,13 +166,18 @@ lv_img_cache_entry_t * lv_img_cache_open(const void * src, const lv_style_t * st
         if(open_res == LV_RES_INV) {
             LV_LOG_WARN("Image draw cannot open the image resource");
             lv_img_decoder_close(&cached_src->dec_dsc);
-            memset(&cached_src->dec_dsc, 0, sizeof(lv_img_decoder_dsc_t));
-            memset(cached_src, 0, sizeof(lv_img_cache_entry_t));
-            cached_src->life = INT32_MIN; /*Make the empty entry very "weak" to force its use  */
+            memset(cached_src, 0, sizeof(lv_img_cache_entry_t)); /*An empty entry is the first to be reused*/
             return NULL;
         }
 
-        cached_src->life = 0;
+        cached_src->life = (int32_t)open_cnt;
+
+#if LV_IMG_CACHE_MEM_SIZE
+        /*Decode the whole image now if the decoder could only read it line by line*/
+        if(cached_src->dec_dsc.img_data == NULL && cached_src->dec_dsc.error_msg == NULL) {
+            img_cache_decode(cached_src);
+        }
+#endif
 
         /*If `time_to_open` was not set in the open function set it here*/
         if(cached_src->dec_dsc.time_to_open == 0) {
@@ -180,16 +234,242 @@ void lv_img_cache_invalidate_src(const void * src)
     uint16_t i;
     for(i = 0; i < entry_cnt; i++) {
         if(cache[i].dec_dsc.src == src || src == NULL) {
-            if(cache[i].dec_dsc.src != NULL) {
-                lv_img_decoder_close(&cache[i].dec_dsc);
-            }
+            img_cache_close(&cache[i]);
+        }
+    }
+}
+
+#if LV_IMG_CACHE_MEM_SIZE && LV_IMG_CACHE_RECOLOR
+/**
+ * Get the pixels of a cached image mixed with a color, as they are drawn with `image.intense`.
+ * They are recolored in the first call and kept, within `LV_IMG_CACHE_MEM_SIZE`, until the image
+ * is closed or `LV_IMG_CACHE_RECOLOR` other variants were asked for since.
+ * @param entry pointer to a cache entry whose whole image is decoded (`dec_dsc.img_data`)
+ * @param color mix the pixels with this color
+ * @param intense the intensity of recoloring
+ * @param chroma the display's chroma key color, left as it is in chroma keyed images
+ * @return the recolored pixels in the image's format or NULL if they couldn't be kept
+ */
+const uint8_t * lv_img_cache_get_recolored(lv_img_cache_entry_t * entry, lv_color_t color, lv_opa_t intense,
+                                           lv_color_t chroma)
+{
+    const lv_img_header_t * header = &entry->dec_dsc.header;
+    bool chroma_keyed = lv_img_color_format_is_chroma_keyed(header->cf);
+    uint16_t i;
+
+    if(!chroma_keyed) chroma.full = 0; /*Not part of the key then*/
+
+    for(i = 0; i < LV_IMG_CACHE_RECOLOR; i++) {
+        lv_img_cache_recolor_t * v = &recolored[i];
+        if(v->entry == entry && v->color.full == color.full && v->intense == intense &&
+           v->chroma.full == chroma.full) {
+            v->last_use = open_cnt;
+            return v->buf;
+        }
+    }
+
+    /*`img_data` holds `lv_color_t` pixels followed by an alpha byte if the format has alpha*/
+    uint8_t px_size = lv_img_color_format_has_alpha(header->cf) ? LV_IMG_PX_SIZE_ALPHA_BYTE : sizeof(lv_color_t);
+    uint32_t px_cnt = (uint32_t)header->w * header->h;
+    uint32_t size   = px_cnt * px_size;
+    if(size == 0 || size > LV_IMG_CACHE_MEM_SIZE) return NULL;
+
+    /*Make room among the other variants only, a decoded image costs more to get back*/
+    lv_img_cache_recolor_t * v = img_cache_recolor_oldest();
+    img_cache_recolor_free(v);
+    while(decoded_size + size > LV_IMG_CACHE_MEM_SIZE) {
+        lv_img_cache_recolor_t * old = img_cache_recolor_oldest();
+        if(old->entry == NULL) return NULL;
+        img_cache_recolor_free(old);
+    }
+
+    uint8_t * buf = IMG_CACHE_ALLOC(size);
+    if(buf == NULL) {
+        LV_LOG_WARN("image draw: no memory to recolor the image");
+        return NULL;
+    }
 
-            memset(&cache[i].dec_dsc, 0, sizeof(lv_img_decoder_dsc_t));
-            memset(&cache[i], 0, sizeof(lv_img_cache_entry_t));
+    /*Mixed as `lv_draw_map` does it. Chroma keyed pixels are left transparent and no other pixel
+     * may become transparent.*/
+    const uint8_t * src = entry->dec_dsc.img_data;
+    uint8_t * dest      = buf;
+    lv_color_t px;
+    uint32_t p;
+    for(p = 0; p < px_cnt; p++) {
+        memcpy(&px, src, sizeof(lv_color_t));
+        if(!chroma_keyed || px.full != chroma.full) {
+            px = lv_color_mix(color, px, intense);
+            if(chroma_keyed && px.full == chroma.full) px.full ^= 1;
         }
+        memcpy(dest, &px, sizeof(lv_color_t));
+        if(px_size == LV_IMG_PX_SIZE_ALPHA_BYTE) dest[LV_IMG_PX_SIZE_ALPHA_BYTE - 1] = src[LV_IMG_PX_SIZE_ALPHA_BYTE - 1];
+        src += px_size;
+        dest += px_size;
     }
+
+    v->entry    = entry;
+    v->color    = color;
+    v->chroma   = chroma;
+    v->intense  = intense;
+    v->last_use = open_cnt;
+    v->buf      = buf;
+    v->size     = size;
+    decoded_size += size;
+
+    return buf;
 }
+#endif
 
 /**********************
  *   STATIC FUNCTIONS
  **********************/
+
+/**
+ * Get the first entry an image source can be cached in
+ * @param src an image source
+ * @return index of the entry
+ */
+static uint16_t img_cache_home(const void * src)
+{
+    uint32_t hash = (uint32_t)((lv_uintptr_t)src >> 2) * 2654435761U;
+    return (hash >> 16) % entry_cnt;
+}
+
+/**
+ * Get the life of an entry
+ * @param entry pointer to a cache entry
+ * @return the life left, the smallest possible for an empty entry
+ */
+static int32_t img_cache_life(const lv_img_cache_entry_t * entry)
+{
+    if(entry->dec_dsc.src == NULL) return INT32_MIN;
+
+    return (int32_t)((uint32_t)entry->life - open_cnt);
+}
+
+/**
+ * Close the image of an entry, freeing its decoded pixels, and mark it empty
+ * @param entry pointer to a cache entry
+ */
+static void img_cache_close(lv_img_cache_entry_t * entry)
+{
+#if LV_IMG_CACHE_MEM_SIZE && LV_IMG_CACHE_RECOLOR
+    uint16_t i;
+    for(i = 0; i < LV_IMG_CACHE_RECOLOR; i++) {
+        if(recolored[i].entry == entry) img_cache_recolor_free(&recolored[i]);
+    }
+#endif
+
+#if LV_IMG_CACHE_MEM_SIZE
+    if(entry->decoded) {
+        entry->dec_dsc.img_data = NULL;
+        IMG_CACHE_FREE(entry->decoded);
+        decoded_size -= entry->decoded_size;
+    }
+#endif
+
+    if(entry->dec_dsc.src != NULL) {
+        lv_img_decoder_close(&entry->dec_dsc);
+    }
+
+    memset(&entry->dec_dsc, 0, sizeof(lv_img_decoder_dsc_t));
+    memset(entry, 0, sizeof(lv_img_cache_entry_t));
+}
+
+#if LV_IMG_CACHE_MEM_SIZE
+/**
+ * Read every line of an opened image into a buffer and let it be drawn from there.
+ * The weakest other decoded images are closed to keep the decoded pixels within
+ * `LV_IMG_CACHE_MEM_SIZE`. The image is left to be read line by line if it doesn't fit.
+ * @param entry pointer to a cache entry with an opened image
+ */
+static void img_cache_decode(lv_img_cache_entry_t * entry)
+{
+    lv_img_cache_entry_t * cache = LV_GC_ROOT(_lv_img_cache_array);
+    const lv_img_header_t * header = &entry->dec_dsc.header;
+
+    /*Lines are read as `lv_color_t` pixels followed by an alpha byte if the format has alpha*/
+    uint8_t px_size    = lv_img_color_format_has_alpha(header->cf) ? LV_IMG_PX_SIZE_ALPHA_BYTE : sizeof(lv_color_t);
+    uint32_t line_size = (uint32_t)header->w * px_size;
+    uint32_t size      = line_size * header->h;
+    if(size == 0 || size > LV_IMG_CACHE_MEM_SIZE) return;
+
+    while(decoded_size + size > LV_IMG_CACHE_MEM_SIZE) {
+#if LV_IMG_CACHE_RECOLOR
+        /*Recolored variants go first, they are quicker to make again*/
+        lv_img_cache_recolor_t * old = img_cache_recolor_oldest();
+        if(old->entry != NULL) {
+            img_cache_recolor_free(old);
+            continue;
+        }
+#endif
+
+        lv_img_cache_entry_t * weakest = NULL;
+        uint16_t i;
+        for(i = 0; i < entry_cnt; i++) {
+            if(cache[i].decoded == NULL || &cache[i] == entry) continue;
+            if(weakest == NULL || img_cache_life(&cache[i]) < img_cache_life(weakest)) weakest = &cache[i];
+        }
+
+        if(weakest == NULL) return;
+        img_cache_close(weakest);
+    }
+
+    uint8_t * buf = IMG_CACHE_ALLOC(size);
+    if(buf == NULL) {
+        LV_LOG_WARN("image draw: no memory to decode the image");
+        return;
+    }
+
+    lv_coord_t y;
+    for(y = 0; y < header->h; y++) {
+        if(lv_img_decoder_read_line(&entry->dec_dsc, 0, y, header->w, &buf[y * line_size]) != LV_RES_OK) {
+            IMG_CACHE_FREE(buf);
+            return;
+        }
+    }
+
+    /*The decoder kept the image converted itself while it was read*/
+    if(entry->dec_dsc.img_data) {
+        IMG_CACHE_FREE(buf);
+        return;
+    }
+
+    entry->decoded          = buf;
+    entry->decoded_size     = size;
+    entry->dec_dsc.img_data = buf;
+    decoded_size += size;
+}
+#endif
+
+#if LV_IMG_CACHE_MEM_SIZE && LV_IMG_CACHE_RECOLOR
+/**
+ * Free the pixels of a recolored variant and mark it empty
+ * @param v pointer to a variant
+ */
+static void img_cache_recolor_free(lv_img_cache_recolor_t * v)
+{
+    if(v->entry == NULL) return;
+
+    IMG_CACHE_FREE(v->buf);
+    decoded_size -= v->size;
+    memset(v, 0, sizeof(lv_img_cache_recolor_t));
+}
+
+/**
+ * Get the recolored variant to reuse
+ * @return an empty variant or, if there is none, the one asked for longest ago
+ */
+static lv_img_cache_recolor_t * img_cache_recolor_oldest(void)
+{
+    lv_img_cache_recolor_t * oldest = &recolored[0];
+    uint16_t i;
+
+    for(i = 0; i < LV_IMG_CACHE_RECOLOR; i++) {
+        if(recolored[i].entry == NULL) return &recolored[i];
+        if((int32_t)(recolored[i].last_use - oldest->last_use) < 0) oldest = &recolored[i];
+    }
+
+    return oldest;
+}
+#endif
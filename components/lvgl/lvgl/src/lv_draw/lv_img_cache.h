@@ -33,9 +33,14 @@ typedef struct
     lv_img_decoder_dsc_t dec_dsc; /**< Image information */
 
     /** Count the cache entries's life. Add `time_tio_open` to `life` when the entry is used.
-     * Decrement all lifes by one every in every ::lv_img_cache_open.
-     * If life == 0 the entry can be reused */
+     * Stored relative to the number of ::lv_img_cache_open calls so it decrements by one in every
+     * call. The entry with the least life is reused */
     int32_t life;
+
+    /** The whole image decoded by the cache if its decoder could only read it line by line.
+     * `dec_dsc.img_data` points here. */
+    uint8_t * decoded;
+    uint32_t decoded_size;
 } lv_img_cache_entry_t;
 
 /**********************
@@ -67,6 +72,21 @@ void lv_img_cache_set_size(uint16_t new_slot_num);
  */
 void lv_img_cache_invalidate_src(const void * src);
 
+#if LV_IMG_CACHE_MEM_SIZE && LV_IMG_CACHE_RECOLOR
+/**
+ * Get the pixels of a cached image mixed with a color, as they are drawn with `image.intense`.
+ * They are recolored in the first call and kept, within `LV_IMG_CACHE_MEM_SIZE`, until the image
+ * is closed or `LV_IMG_CACHE_RECOLOR` other variants were asked for since.
+ * @param entry pointer to a cache entry whose whole image is decoded (`dec_dsc.img_data`)
+ * @param color mix the pixels with this color
+ * @param intense the intensity of recoloring
+ * @param chroma the display's chroma key color, left as it is in chroma keyed images
+ * @return the recolored pixels in the image's format or NULL if they couldn't be kept
+ */
+const uint8_t * lv_img_cache_get_recolored(lv_img_cache_entry_t * entry, lv_color_t color, lv_opa_t intense,
+                                           lv_color_t chroma);
+#endif
+
 /**********************
  *      MACROS
  **********************/
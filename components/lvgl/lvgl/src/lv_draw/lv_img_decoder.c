@@ -22,6 +22,17 @@
 #define CF_BUILT_IN_FIRST LV_IMG_CF_TRUE_COLOR
 #define CF_BUILT_IN_LAST LV_IMG_CF_ALPHA_8BIT
 
+#if LV_IMG_DECODER_LINE_CACHE
+#if LV_IMG_CACHE_CUSTOM
+#include LV_IMG_CACHE_CUSTOM_INCLUDE
+#define LINE_CACHE_ALLOC(size) LV_IMG_CACHE_CUSTOM_ALLOC(size)
+#define LINE_CACHE_FREE(p) LV_IMG_CACHE_CUSTOM_FREE(p)
+#else
+#define LINE_CACHE_ALLOC(size) lv_mem_alloc(size)
+#define LINE_CACHE_FREE(p) lv_mem_free(p)
+#endif
+#endif
+
 /**********************
  *      TYPEDEFS
  **********************/
@@ -31,6 +42,11 @@ typedef struct
     lv_fs_file_t * f;
 #endif
     lv_color_t * palette;
+#if LV_IMG_DECODER_LINE_CACHE
+    uint8_t * lines;      /*The image converted to `lv_color_t` (+ alpha byte) as far as it was read*/
+    uint8_t * line_done;  /*One bit for every line telling it's already converted in `lines`*/
+    lv_coord_t lines_left;
+#endif
 } lv_img_decoder_built_in_data_t;
 
 /**********************
@@ -42,6 +58,11 @@ static lv_res_t lv_img_decoder_built_in_line_alpha(lv_img_decoder_dsc_t * dsc, l
                                                    lv_coord_t len, uint8_t * buf);
 static lv_res_t lv_img_decoder_built_in_line_indexed(lv_img_decoder_dsc_t * dsc, lv_coord_t x, lv_coord_t y,
                                                      lv_coord_t len, uint8_t * buf);
+#if LV_IMG_DECODER_LINE_CACHE
+static void lv_img_decoder_built_in_line_cache_init(lv_img_decoder_dsc_t * dsc);
+static lv_res_t lv_img_decoder_built_in_line_cached(lv_img_decoder_dsc_t * dsc, lv_coord_t x, lv_coord_t y,
+                                                    lv_coord_t len, uint8_t * buf);
+#endif
 
 /**********************
  *  STATIC VARIABLES
@@ -402,6 +423,9 @@ lv_res_t lv_img_decoder_built_in_open(lv_img_decoder_t * decoder, lv_img_decoder
         }
 
         dsc->img_data = NULL;
+#if LV_IMG_DECODER_LINE_CACHE
+        lv_img_decoder_built_in_line_cache_init(dsc);
+#endif
         return LV_RES_OK;
 #else
         LV_LOG_WARN("Indexed (palette) images are not enabled in lv_conf.h. See LV_IMG_CF_INDEXED");
@@ -413,6 +437,9 @@ lv_res_t lv_img_decoder_built_in_open(lv_img_decoder_t * decoder, lv_img_decoder
             cf == LV_IMG_CF_ALPHA_8BIT) {
 #if LV_IMG_CF_ALPHA
         dsc->img_data = NULL;
+#if LV_IMG_DECODER_LINE_CACHE
+        lv_img_decoder_built_in_line_cache_init(dsc);
+#endif
         return LV_RES_OK; /*Nothing to process*/
 #else
         LV_LOG_WARN("Alpha indexed images are not enabled in lv_conf.h. See LV_IMG_CF_ALPHA");
@@ -447,6 +474,13 @@ lv_res_t lv_img_decoder_built_in_read_line(lv_img_decoder_t * decoder, lv_img_de
 
     lv_res_t res = LV_RES_INV;
 
+#if LV_IMG_DECODER_LINE_CACHE
+    lv_img_decoder_built_in_data_t * user_data = dsc->user_data;
+    if(user_data && user_data->lines) {
+        return lv_img_decoder_built_in_line_cached(dsc, x, y, len, buf);
+    }
+#endif
+
     if(dsc->header.cf == LV_IMG_CF_TRUE_COLOR || dsc->header.cf == LV_IMG_CF_TRUE_COLOR_ALPHA ||
        dsc->header.cf == LV_IMG_CF_TRUE_COLOR_CHROMA_KEYED) {
         /* For TRUE_COLOR images read line required only for files.
@@ -487,6 +521,13 @@ void lv_img_decoder_built_in_close(lv_img_decoder_t * decoder, lv_img_decoder_ds
         }
 #endif
         if(user_data->palette) lv_mem_free(user_data->palette);
+#if LV_IMG_DECODER_LINE_CACHE
+        if(user_data->lines) {
+            LINE_CACHE_FREE(user_data->lines);
+            lv_mem_free(user_data->line_done);
+            dsc->img_data = NULL;
+        }
+#endif
 
         lv_mem_free(user_data);
 
@@ -720,3 +761,77 @@ static lv_res_t lv_img_decoder_built_in_line_indexed(lv_img_decoder_dsc_t * dsc,
     return LV_RES_INV;
 #endif
 }
+
+#if LV_IMG_DECODER_LINE_CACHE
+/**
+ * Allocate a buffer to keep the lines of an indexed or alpha image once they are converted.
+ * Nothing happens if the converted image would be larger than `LV_IMG_DECODER_LINE_CACHE`
+ * or there is no memory for it. Then the lines are converted in every read.
+ * @param dsc pointer to decoder descriptor of an opened indexed or alpha image
+ */
+static void lv_img_decoder_built_in_line_cache_init(lv_img_decoder_dsc_t * dsc)
+{
+    uint8_t px_size = lv_img_color_format_has_alpha(dsc->header.cf) ? LV_IMG_PX_SIZE_ALPHA_BYTE : sizeof(lv_color_t);
+    uint32_t size   = (uint32_t)dsc->header.w * dsc->header.h * px_size;
+    if(size == 0 || size > LV_IMG_DECODER_LINE_CACHE) return;
+
+    if(dsc->user_data == NULL) {
+        dsc->user_data = lv_mem_alloc(sizeof(lv_img_decoder_built_in_data_t));
+        if(dsc->user_data == NULL) return;
+        memset(dsc->user_data, 0, sizeof(lv_img_decoder_built_in_data_t));
+    }
+
+    lv_img_decoder_built_in_data_t * user_data = dsc->user_data;
+    uint32_t done_size                         = (dsc->header.h + 7) >> 3;
+    user_data->line_done                       = lv_mem_alloc(done_size);
+    if(user_data->line_done == NULL) return;
+
+    user_data->lines = LINE_CACHE_ALLOC(size);
+    if(user_data->lines == NULL) {
+        lv_mem_free(user_data->line_done);
+        user_data->line_done = NULL;
+        return;
+    }
+
+    memset(user_data->line_done, 0, done_size);
+    user_data->lines_left = dsc->header.h;
+}
+
+/**
+ * Read pixels of an image with a line cache. A line is converted as a whole the first
+ * time it is read. When every line is converted `img_data` is set to the cache so later draws
+ * use the converted image directly.
+ * @param dsc pointer to decoder descriptor
+ * @param x start x coordinate
+ * @param y start y coordinate
+ * @param len number of pixels to decode
+ * @param buf a buffer to store the decoded pixels
+ * @return LV_RES_OK: ok; LV_RES_INV: failed
+ */
+static lv_res_t lv_img_decoder_built_in_line_cached(lv_img_decoder_dsc_t * dsc, lv_coord_t x, lv_coord_t y,
+                                                    lv_coord_t len, uint8_t * buf)
+{
+    lv_img_decoder_built_in_data_t * user_data = dsc->user_data;
+    uint8_t px_size = lv_img_color_format_has_alpha(dsc->header.cf) ? LV_IMG_PX_SIZE_ALPHA_BYTE : sizeof(lv_color_t);
+    uint8_t * line  = &user_data->lines[(uint32_t)y * dsc->header.w * px_size];
+
+    if((user_data->line_done[y >> 3] & (1 << (y & 0x7))) == 0) {
+        lv_res_t res;
+        if(dsc->header.cf == LV_IMG_CF_ALPHA_1BIT || dsc->header.cf == LV_IMG_CF_ALPHA_2BIT ||
+           dsc->header.cf == LV_IMG_CF_ALPHA_4BIT || dsc->header.cf == LV_IMG_CF_ALPHA_8BIT) {
+            res = lv_img_decoder_built_in_line_alpha(dsc, 0, y, dsc->header.w, line);
+        } else {
+            res = lv_img_decoder_built_in_line_indexed(dsc, 0, y, dsc->header.w, line);
+        }
+        if(res != LV_RES_OK) return res;
+
+        user_data->line_done[y >> 3] |= 1 << (y & 0x7);
+        user_data->lines_left--;
+        if(user_data->lines_left == 0) dsc->img_data = user_data->lines;
+    }
+
+    memcpy(buf, &line[x * px_size], len * px_size);
+
+    return LV_RES_OK;
+}
+#endif
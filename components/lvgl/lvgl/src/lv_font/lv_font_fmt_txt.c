@@ -11,20 +11,53 @@
 #include "../lv_misc/lv_types.h"
 #include "../lv_misc/lv_log.h"
 #include "../lv_misc/lv_utils.h"
+#include "../lv_misc/lv_mem.h"
+#include <string.h>
 
 /*********************
  *      DEFINES
  *********************/
+#if LV_USE_FONT_COMPRESSED
+/*After this many repeats a 6 bit count follows*/
+#define RLE_REPEAT_MAX  11
+#endif
 
 /**********************
  *      TYPEDEFS
  **********************/
+#if LV_USE_FONT_COMPRESSED
+typedef enum {
+    RLE_STATE_SINGLE = 0,
+    RLE_STATE_REPEAT,
+    RLE_STATE_COUNTER,
+} rle_state_t;
+
+/*Read position and state of a glyph's run-length decoder*/
+typedef struct {
+    const uint8_t * in;
+    uint32_t rdp;       /*Read position in bits*/
+    uint8_t bpp;
+    uint8_t prev_v;
+    uint8_t cnt;
+    rle_state_t state;
+} rle_t;
+#endif
 
 /**********************
  *  STATIC PROTOTYPES
  **********************/
 static uint32_t get_glyph_dsc_id(const lv_font_t * font, uint32_t letter);
+static uint32_t search_glyph_dsc_id(const lv_font_fmt_txt_dsc_t * fdsc, uint32_t letter);
 static int8_t get_kern_value(const lv_font_t * font, uint32_t gid_left, uint32_t gid_right);
+static int8_t search_kern_value(const lv_font_fmt_txt_dsc_t * fdsc, uint32_t gid_left, uint32_t gid_right);
+#if LV_FONT_FMT_TXT_CACHE
+static lv_font_fmt_txt_cache_t * get_cache(lv_font_fmt_txt_dsc_t * fdsc);
+#endif
+#if LV_USE_FONT_COMPRESSED
+static const uint8_t * decompress(const uint8_t * in, uint16_t w, uint16_t h, uint8_t bpp, bool prefilter);
+static uint8_t rle_next(rle_t * rle);
+static inline uint8_t get_bits(const uint8_t * in, uint32_t bit_pos, uint8_t len);
+#endif
 static int32_t unicode_list_compare(const void * ref, const void * element);
 static int32_t kern_pair_8_compare(const void * ref, const void * element);
 static int32_t kern_pair_16_compare(const void * ref, const void * element);
@@ -32,6 +65,11 @@ static int32_t kern_pair_16_compare(const void * ref, const void * element);
 /**********************
  *  STATIC VARIABLES
  **********************/
+#if LV_USE_FONT_COMPRESSED
+/*The last unpacked glyph followed by two rows of one pixel per byte*/
+static uint8_t * decompr_buf;
+static uint32_t decompr_buf_size;
+#endif
 
 /**********************
  * GLOBAL PROTOTYPES
@@ -46,7 +84,9 @@ static int32_t kern_pair_16_compare(const void * ref, const void * element);
  **********************/
 
 /**
- * Used as `get_glyph_bitmap` callback in LittelvGL's native font format if the font is uncompressed.
+ * Used as `get_glyph_bitmap` callback in LittelvGL's native font format.
+ * The bitmap of a compressed font is unpacked to a buffer which is reused by the next call,
+ * so copy it (as the glyph cache does) if it is needed later.
  * @param font pointer to font
  * @param unicode_letter an unicode letter which bitmap should be get
  * @return pointer to the bitmap or NULL if not found
@@ -59,6 +99,16 @@ const uint8_t * lv_font_get_bitmap_fmt_txt(const lv_font_t * font, uint32_t unic
 
     const lv_font_fmt_txt_glyph_dsc_t * gdsc = &fdsc->glyph_dsc[gid];
 
+    if(fdsc->bitmap_format != LV_FONT_FMT_TXT_PLAIN) {
+#if LV_USE_FONT_COMPRESSED
+        return decompress(&fdsc->glyph_bitmap[gdsc->bitmap_index], gdsc->box_w, gdsc->box_h, fdsc->bpp,
+                          fdsc->bitmap_format == LV_FONT_FMT_TXT_COMPRESSED);
+#else
+        LV_LOG_WARN("lv_font_get_bitmap_fmt_txt: compressed font but LV_USE_FONT_COMPRESSED is 0");
+        return NULL;
+#endif
+    }
+
     if(gdsc) return &fdsc->glyph_bitmap[gdsc->bitmap_index];
 
     /*If not returned earlier then the letter is not found in this font*/
@@ -113,9 +163,33 @@ static uint32_t get_glyph_dsc_id(const lv_font_t * font, uint32_t letter)
 
     lv_font_fmt_txt_dsc_t * fdsc = (lv_font_fmt_txt_dsc_t *) font->dsc;
 
+#if LV_FONT_FMT_TXT_CACHE
+    /*The first letters are simply indexed*/
+    if(letter < LV_FONT_FMT_TXT_CACHE_GID_CNT) {
+        lv_font_fmt_txt_cache_t * cache = get_cache(fdsc);
+        if(cache) return cache->gid[letter];
+    }
+#endif
+
     /*Check the chacge first*/
     if(letter == fdsc->last_letter) return fdsc->last_glyph_id;
 
+    uint32_t glyph_id = search_glyph_dsc_id(fdsc, letter);
+
+    /*Update the cache*/
+    fdsc->last_letter = letter;
+    fdsc->last_glyph_id = glyph_id;
+    return glyph_id;
+}
+
+/**
+ * Find the glyph id of a letter in the cmap tables of a font
+ * @param fdsc pointer to a font descriptor
+ * @param letter an UNICODE letter code
+ * @return the glyph id or 0 if the font doesn't have the letter
+ */
+static uint32_t search_glyph_dsc_id(const lv_font_fmt_txt_dsc_t * fdsc, uint32_t letter)
+{
     uint16_t i;
     for(i = 0; i < fdsc->cmap_num; i++) {
 
@@ -150,14 +224,9 @@ static uint32_t get_glyph_dsc_id(const lv_font_t * font, uint32_t letter)
             }
         }
 
-        /*Update the cache*/
-        fdsc->last_letter = letter;
-        fdsc->last_glyph_id = glyph_id;
         return glyph_id;
     }
 
-    fdsc->last_letter = letter;
-    fdsc->last_glyph_id = 0;
     return 0;
 
 }
@@ -166,6 +235,32 @@ static int8_t get_kern_value(const lv_font_t * font, uint32_t gid_left, uint32_t
 {
     lv_font_fmt_txt_dsc_t * fdsc = (lv_font_fmt_txt_dsc_t *) font->dsc;
 
+#if LV_FONT_FMT_TXT_CACHE
+    /*The table is allocated by the glyph id lookups before*/
+    if(fdsc->cache) {
+        lv_font_fmt_txt_kern_cache_t * k =
+            &fdsc->cache->kern[(gid_left * 31 + gid_right) & (LV_FONT_FMT_TXT_CACHE_KERN_CNT - 1)];
+        if(k->gid_left != gid_left || k->gid_right != gid_right) {
+            k->gid_left  = gid_left;
+            k->gid_right = gid_right;
+            k->value     = search_kern_value(fdsc, gid_left, gid_right);
+        }
+        return k->value;
+    }
+#endif
+
+    return search_kern_value(fdsc, gid_left, gid_right);
+}
+
+/**
+ * Find the kerning value of a glyph pair in the kerning tables of a font
+ * @param fdsc pointer to a font descriptor
+ * @param gid_left glyph id of the left letter
+ * @param gid_right glyph id of the right letter
+ * @return the kerning value
+ */
+static int8_t search_kern_value(const lv_font_fmt_txt_dsc_t * fdsc, uint32_t gid_left, uint32_t gid_right)
+{
     int8_t value = 0;
 
     if(fdsc->kern_classes == 0) {
@@ -217,6 +312,171 @@ static int8_t get_kern_value(const lv_font_t * font, uint32_t gid_left, uint32_t
     return value;
 }
 
+#if LV_FONT_FMT_TXT_CACHE
+/**
+ * Get the lookup tables of a font, building them on its first use
+ * @param fdsc pointer to a font descriptor
+ * @return the tables or NULL if they couldn't be allocated
+ */
+static lv_font_fmt_txt_cache_t * get_cache(lv_font_fmt_txt_dsc_t * fdsc)
+{
+    if(fdsc->cache) return fdsc->cache;
+
+    lv_font_fmt_txt_cache_t * cache = lv_mem_alloc(sizeof(lv_font_fmt_txt_cache_t));
+    if(cache == NULL) return NULL;
+
+    uint32_t i;
+    cache->gid[0] = 0;
+    for(i = 1; i < LV_FONT_FMT_TXT_CACHE_GID_CNT; i++) {
+        cache->gid[i] = search_glyph_dsc_id(fdsc, i);
+    }
+    memset(cache->kern, 0, sizeof(cache->kern));
+
+    fdsc->cache = cache;
+    return cache;
+}
+#endif
+
+#if LV_USE_FONT_COMPRESSED
+/**
+ * Unpack the run-length encoded bitmap of a glyph.
+ * The pixels are stored row after row as one stream of `bpp` bit values in the format of `lv_font_conv`.
+ * @param in the glyph's compressed bitmap
+ * @param w width of the glyph
+ * @param h height of the glyph
+ * @param bpp bit per pixel: 1, 2, 4 or 8
+ * @param prefilter true: every row was XORed with the one above before the compression
+ * @return the bitmap packed MSB first without padding between the rows, as an uncompressed font stores it,
+ *         or NULL if there is no memory to unpack it
+ */
+static const uint8_t * decompress(const uint8_t * in, uint16_t w, uint16_t h, uint8_t bpp, bool prefilter)
+{
+    uint32_t size = ((uint32_t)w * h * bpp + 7) >> 3;
+    if(size == 0) return in;
+
+    /*Grow the buffer to fit the largest glyph seen so far*/
+    if(size + 2 * (uint32_t)w > decompr_buf_size) {
+        uint8_t * buf = lv_mem_realloc(decompr_buf, size + 2 * (uint32_t)w);
+        if(buf == NULL) {
+            LV_LOG_WARN("lv_font_get_bitmap_fmt_txt: no memory to unpack a glyph");
+            return NULL;
+        }
+        decompr_buf = buf;
+        decompr_buf_size = size + 2 * (uint32_t)w;
+    }
+
+    uint8_t * out = decompr_buf;
+    uint8_t * line = decompr_buf + size;    /*The pixels of the previous row*/
+    uint8_t * diff = line + w;              /*The XOR of this row and the previous*/
+
+    memset(out, 0, size);
+    memset(line, 0, w);
+
+    rle_t rle;
+    rle.in = in;
+    rle.rdp = 0;
+    rle.bpp = bpp;
+    rle.prev_v = 0;
+    rle.cnt = 0;
+    rle.state = RLE_STATE_SINGLE;
+
+    uint32_t wrp = 0;
+    uint16_t x;
+    uint16_t y;
+    for(y = 0; y < h; y++) {
+        for(x = 0; x < w; x++) diff[x] = rle_next(&rle);
+
+        for(x = 0; x < w; x++) {
+            /*Without the prefilter every row counts as the first*/
+            line[x] = prefilter ? line[x] ^ diff[x] : diff[x];
+            out[wrp >> 3] |= line[x] << (8 - (wrp & 0x7) - bpp);
+            wrp += bpp;
+        }
+    }
+
+    return out;
+}
+
+/**
+ * Read the next pixel of a run-length encoded bitmap.
+ * A value repeating the one before starts a run: every following 1 bit repeats it once more, until
+ * a 0 bit and a new value. The `RLE_REPEAT_MAX`th 1 bit is followed by a 6 bit count of further repeats.
+ * @param rle pointer to the decoder's state
+ * @return the pixel value
+ */
+static uint8_t rle_next(rle_t * rle)
+{
+    uint8_t v;
+
+    if(rle->state == RLE_STATE_SINGLE) {
+        v = get_bits(rle->in, rle->rdp, rle->bpp);
+        if(rle->rdp != 0 && rle->prev_v == v) {
+            rle->cnt = 0;
+            rle->state = RLE_STATE_REPEAT;
+        }
+        rle->prev_v = v;
+        rle->rdp += rle->bpp;
+    }
+    else if(rle->state == RLE_STATE_REPEAT) {
+        uint8_t bit = get_bits(rle->in, rle->rdp, 1);
+        rle->cnt++;
+        rle->rdp += 1;
+        if(bit == 1) {
+            v = rle->prev_v;
+            if(rle->cnt == RLE_REPEAT_MAX) {
+                rle->cnt = get_bits(rle->in, rle->rdp, 6);
+                rle->rdp += 6;
+                if(rle->cnt != 0) {
+                    rle->state = RLE_STATE_COUNTER;
+                } else {
+                    v = get_bits(rle->in, rle->rdp, rle->bpp);
+                    rle->prev_v = v;
+                    rle->rdp += rle->bpp;
+                    rle->state = RLE_STATE_SINGLE;
+                }
+            }
+        } else {
+            v = get_bits(rle->in, rle->rdp, rle->bpp);
+            rle->prev_v = v;
+            rle->rdp += rle->bpp;
+            rle->state = RLE_STATE_SINGLE;
+        }
+    }
+    else {
+        v = rle->prev_v;
+        rle->cnt--;
+        if(rle->cnt == 0) {
+            v = get_bits(rle->in, rle->rdp, rle->bpp);
+            rle->prev_v = v;
+            rle->rdp += rle->bpp;
+            rle->state = RLE_STATE_SINGLE;
+        }
+    }
+
+    return v;
+}
+
+/**
+ * Read bits from a stream packed MSB first
+ * @param in the stream
+ * @param bit_pos index of the first bit to read
+ * @param len number of bits to read: 1..8
+ * @return the bits as a number
+ */
+static inline uint8_t get_bits(const uint8_t * in, uint32_t bit_pos, uint8_t len)
+{
+    uint32_t byte_pos = bit_pos >> 3;
+    bit_pos = bit_pos & 0x7;
+    uint8_t mask = (1 << len) - 1;
+
+    /*The value is within one byte*/
+    if(bit_pos + len <= 8) return (in[byte_pos] >> (8 - bit_pos - len)) & mask;
+
+    uint16_t in16 = (in[byte_pos] << 8) + in[byte_pos + 1];
+    return (in16 >> (16 - bit_pos - len)) & mask;
+}
+#endif /*LV_USE_FONT_COMPRESSED*/
+
 static int32_t kern_pair_8_compare(const void * ref, const void * element)
 {
     const uint8_t * ref8_p = ref;
@@ -152,10 +152,35 @@ typedef struct {
 /** Bitmap formats*/
 typedef enum {
     LV_FONT_FMT_TXT_PLAIN      = 0,
-    LV_FONT_FMT_TXT_COMPRESSED = 1,
+    LV_FONT_FMT_TXT_COMPRESSED = 1,                 /*Run-length encoded, each row XORed with the one above*/
+    LV_FONT_FMT_TXT_COMPRESSED_NO_PREFILTER = 2,    /*Run-length encoded rows*/
 }lv_font_fmt_txt_bitmap_format_t;
 
 
+#if LV_FONT_FMT_TXT_CACHE
+/*Number of letters from U+0000 with their glyph id in `lv_font_fmt_txt_cache_t`*/
+#define LV_FONT_FMT_TXT_CACHE_GID_CNT    256
+
+/*Number of kerning values in `lv_font_fmt_txt_cache_t` (power of 2)*/
+#define LV_FONT_FMT_TXT_CACHE_KERN_CNT   32
+
+/*A kerning value of a glyph pair*/
+typedef struct {
+    uint16_t gid_left;      /*0: unused entry*/
+    uint16_t gid_right;
+    int8_t value;
+}lv_font_fmt_txt_kern_cache_t;
+
+/*Lookup tables built when a font is first used*/
+typedef struct {
+    /*Glyph id of the first letters, 0 if the font doesn't have the letter*/
+    uint16_t gid[LV_FONT_FMT_TXT_CACHE_GID_CNT];
+
+    /*Recently used kerning values indexed by a hash of the glyph ids*/
+    lv_font_fmt_txt_kern_cache_t kern[LV_FONT_FMT_TXT_CACHE_KERN_CNT];
+}lv_font_fmt_txt_cache_t;
+#endif
+
 /*Describe store additional data for fonts */
 typedef struct {
     /*The bitmaps os all glyphs*/
@@ -196,6 +221,11 @@ typedef struct {
     uint32_t last_letter;
     uint32_t last_glyph_id;
 
+#if LV_FONT_FMT_TXT_CACHE
+    /*Glyph id table and kerning cache. NULL until the font is used*/
+    lv_font_fmt_txt_cache_t * cache;
+#endif
+
 }lv_font_fmt_txt_dsc_t;
 
 /**********************
@@ -203,7 +233,9 @@ typedef struct {
  **********************/
 
 /**
- * Used as `get_glyph_bitmap` callback in LittelvGL's native font format if the font is uncompressed.
+ * Used as `get_glyph_bitmap` callback in LittelvGL's native font format.
+ * The bitmap of a compressed font is unpacked to a buffer which is reused by the next call,
+ * so copy it (as the glyph cache does) if it is needed later.
  * @param font pointer to font
  * @param unicode_letter an unicode letter which bitmap should be get
  * @return pointer to the bitmap or NULL if not found
@@ -62,6 +62,14 @@ void lv_disp_drv_init(lv_disp_drv_t * driver)
     driver->buffer           = NULL;
     driver->rotated          = 0;
     driver->color_chroma_key = LV_COLOR_TRANSP;
+    driver->inv_area_cost    = 0;
+    driver->wait_cb          = NULL;
+    driver->trace_cb         = NULL;
+    driver->copy_cb          = NULL;
+    driver->draw_cb          = NULL;
+    driver->yield_cb         = NULL;
+    driver->rank_cb          = NULL;
+    driver->hold_cb          = NULL;
 
 #if LV_ANTIALIAS
     driver->antialiasing = true;
@@ -133,7 +141,9 @@ lv_disp_t * lv_disp_drv_register(lv_disp_drv_t * driver)
     disp_def                 = disp; /*Temporarily change the default screen to create the default screens on the
                                         new display*/
 
-    disp->inv_p = 0;
+    disp->inv_p      = 0;
+    disp->inv_kept   = 0;
+    disp->inv_prev_p = 0;
 
     disp->act_scr   = lv_obj_create(NULL, NULL); /*Create a default screen on the display*/
     disp->top_layer = lv_obj_create(NULL, NULL); /*Create top layer on the display*/
@@ -316,8 +326,9 @@ uint16_t lv_disp_get_inv_buf_size(lv_disp_t * disp)
 void lv_disp_pop_from_inv_buf(lv_disp_t * disp, uint16_t num)
 {
 
-    if(disp->inv_p < num)
-        disp->inv_p = 0;
+    /*The areas a copy exposed are needed even if the copy is undone*/
+    if(disp->inv_p < disp->inv_kept + num)
+        disp->inv_p = disp->inv_kept;
     else
         disp->inv_p -= num;
 }
@@ -22,6 +22,7 @@ extern "C" {
 #include "../lv_misc/lv_area.h"
 #include "../lv_misc/lv_ll.h"
 #include "../lv_misc/lv_task.h"
+#include "../lv_font/lv_font.h"
 
 /*********************
  *      DEFINES
@@ -41,6 +42,47 @@ extern "C" {
 struct _disp_t;
 struct _disp_drv_t;
 
+/** Refresh stages reported to a display driver's `trace_cb`*/
+enum {
+    LV_DISP_TRACE_REFR_START, /**< A refresh of the invalidated areas starts*/
+    LV_DISP_TRACE_REFR_END,   /**< The refresh is finished*/
+    LV_DISP_TRACE_PART_START, /**< Rendering a part of an area into the VDB starts*/
+    LV_DISP_TRACE_PART_END,   /**< The part is rendered (and flushed unless true double buffered)*/
+};
+typedef uint8_t lv_disp_trace_t;
+
+/** Primitives reported to a display driver's `draw_cb`*/
+enum {
+    LV_DISP_DRAW_FILL,   /**< `area` filled with `color` mixed by `opa`*/
+    LV_DISP_DRAW_PX,     /**< The pixel at `area.x1`, `area.y1` set to `color` mixed by `opa`*/
+    LV_DISP_DRAW_LETTER, /**< The glyph `glyph` of `letter` in `font` drawn with its top-left corner at
+                              `pos` in `color` with `opa`, clipped to `area`*/
+    LV_DISP_DRAW_MAP,    /**< An image or other pixel map drawn in `area`*/
+    LV_DISP_DRAW_IMG,    /**< The image `src`, decoded to the `size` pixels of `map`, about to be drawn with
+                              its top-left corner at `pos` with `opa`, clipped to `area`. Reported just before
+                              the `LV_DISP_DRAW_MAP` drawing `map`*/
+};
+typedef uint8_t lv_disp_draw_type_t;
+
+/** A primitive drawn into the VDB, see `draw_cb` in `lv_disp_drv_t`*/
+typedef struct
+{
+    lv_disp_draw_type_t type;
+    lv_opa_t opa;
+    lv_color_t color;
+    lv_area_t area;                    /**< Absolute coordinates, already clipped to the VDB*/
+    lv_point_t pos;                    /**< Letters only*/
+    const lv_font_t * font;            /**< Letters only*/
+    uint32_t letter;                   /**< Letters only*/
+    const lv_font_glyph_dsc_t * glyph; /**< Letters only*/
+    const void * src;                  /**< Images only: the source given to `lv_draw_img()`*/
+    const uint8_t * map;               /**< Images only*/
+    lv_point_t size;                   /**< Images only: width and height of `map`*/
+    lv_opa_t recolor_opa;              /**< Images only: mix of `color` in each pixel*/
+    uint8_t chroma_keyed : 1;          /**< Images only*/
+    uint8_t alpha_byte : 1;            /**< Images only*/
+} lv_disp_draw_t;
+
 /**
  * Structure for holding display buffer information.
  */
@@ -74,6 +116,11 @@ typedef struct _disp_drv_t
 #endif
     uint32_t rotated : 1; /**< 1: turn the display by 90 degree. @warning Does not update coordinates for you!*/
 
+    /** Cost of refreshing an area on its own (e.g. the per-message overhead of a remote display),
+     * in pixels. Invalidated areas are joined whenever that saves more than the extra pixels drawn.
+     * 0: only join overlapping areas whose union is smaller than the two.*/
+    uint32_t inv_area_cost;
+
 #if LV_COLOR_SCREEN_TRANSP
     /**Handle if the the screen doesn't have a solid (opa == LV_OPA_COVER) background.
      * Use only if required because it's slower.*/
@@ -98,6 +145,39 @@ typedef struct _disp_drv_t
      * number of flushed pixels */
     void (*monitor_cb)(struct _disp_drv_t * disp_drv, uint32_t time, uint32_t px);
 
+    /** OPTIONAL: Called repeatedly while LittlevGL waits for a flush to finish instead of
+     * busy waiting. E.g. block on a semaphore given where `lv_disp_flush_ready()` is called*/
+    void (*wait_cb)(struct _disp_drv_t * disp_drv);
+
+    /** OPTIONAL: Called when each refresh and the rendering of each part of an area starts and
+     * ends, e.g. to record a timeline. `area` is the part rendered, NULL for the refresh*/
+    void (*trace_cb)(struct _disp_drv_t * disp_drv, lv_disp_trace_t event, const lv_area_t * area);
+
+    /** OPTIONAL: Move the pixels already on the display inside `area` by `dx`, `dy`, keeping only
+     * what lands in `area`. Lets a scrolled page send only the strip it exposes. Called between
+     * refreshes, so a driver with a flush in progress must apply it after that flush*/
+    void (*copy_cb)(struct _disp_drv_t * disp_drv, const lv_area_t * area, lv_coord_t dx, lv_coord_t dy);
+
+    /** OPTIONAL: Called with each fill, pixel, letter, image and map before it is drawn into the VDB, in
+     * drawing order, e.g. to send a remote display the primitives instead of the pixels*/
+    void (*draw_cb)(struct _disp_drv_t * disp_drv, const lv_disp_draw_t * draw);
+
+    /** OPTIONAL: Called before flushing each part of a refresh but its last with the mS the refresh
+     * took so far. Return true to end the refresh with this part, e.g. to handle waiting input first.
+     * The parts not drawn stay invalidated, joined with new ones on the next refresh, which is due
+     * at once. Not called in true double buffered mode or by `lv_refr_now`*/
+    bool (*yield_cb)(struct _disp_drv_t * disp_drv, uint32_t elapsed);
+
+    /** OPTIONAL: Rank each invalidated area once they are joined. Lower ranks are refreshed first,
+     * equal ones in the order they were invalidated. E.g. to draw what is under the user's finger
+     * before the rest of a large refresh*/
+    uint32_t (*rank_cb)(struct _disp_drv_t * disp_drv, const lv_area_t * area);
+
+    /** OPTIONAL: Called with each area invalidated, after rounding. Return true to keep the area from
+     * this refresh, e.g. to hold back a fast changing part of the screen and invalidate it again
+     * later with the other changes to it merged in*/
+    bool (*hold_cb)(struct _disp_drv_t * disp_drv, const lv_area_t * area);
+
 #if LV_USE_GPU
     /** OPTIONAL: Blend two memories using opacity (GPU only)*/
     void (*gpu_blend_cb)(struct _disp_drv_t * disp_drv, lv_color_t * dest, const lv_color_t * src, uint32_t length,
@@ -142,6 +222,12 @@ typedef struct _disp_t
     lv_area_t inv_areas[LV_INV_BUF_SIZE];
     uint8_t inv_area_joined[LV_INV_BUF_SIZE];
     uint32_t inv_p : 10;
+    uint32_t inv_kept : 10; /**< Number of invalidated areas `lv_disp_pop_from_inv_buf` keeps, see `lv_refr_copy_area`*/
+
+    /** Areas newly invalidated for the last refresh in true double buffered mode. The buffer drawn
+     * into next hasn't got them yet, and the display only needs these from the buffer flushed.*/
+    lv_area_t inv_prev[LV_INV_BUF_SIZE];
+    uint16_t inv_prev_p;
 
     /*Miscellaneous data*/
     uint32_t last_activity_time; /**< Last time there was activity on this display */
@@ -26,21 +26,60 @@
 #define LV_ANIM_RESOLUTION 1024
 #define LV_ANIM_RES_SHIFT 10
 
+/*Number of animations room is first made for. It's doubled when it runs out*/
+#define LV_ANIM_ARRAY_MIN 8
+
+/*Bytes an animation takes in all the arrays*/
+#define LV_ANIM_ENTRY_SIZE                                                                                             \
+    (sizeof(lv_anim_t) + sizeof(void *) + sizeof(lv_anim_exec_xcb_t) + sizeof(lv_anim_path_cb_t) +                     \
+     2 * sizeof(int32_t) + sizeof(uint16_t) + sizeof(int16_t))
+
 /**********************
  *      TYPEDEFS
  **********************/
 
+/*The running animations as parallel arrays, in one block, so the task steps them in a few
+ * tight loops instead of chasing list nodes. The fields read on every step are kept in their
+ * own arrays; `desc` holds the rest of each descriptor and is brought up to date with them
+ * before it's handed to a callback*/
+typedef struct
+{
+    lv_anim_t * desc;
+    void ** var;
+    lv_anim_exec_xcb_t * exec_cb;
+    lv_anim_path_cb_t * path_cb;
+    int32_t * start;
+    int32_t * end;
+    uint16_t * time;
+    int16_t * act_time;
+    uint16_t cnt;
+    uint16_t size;
+} anim_array_t;
+
 /**********************
  *  STATIC PROTOTYPES
  **********************/
 static void anim_task(lv_task_t * param);
-static bool anim_ready_handler(lv_anim_t * a);
+static void anim_ready_handler(uint16_t i);
+static bool anim_reserve(void);
+static void anim_layout(anim_array_t * arr, uint8_t * mem, uint16_t size);
+static void anim_remove(uint16_t i);
+static lv_anim_t * anim_desc(uint16_t i);
+static lv_anim_value_t anim_value(uint16_t i);
 
 /**********************
  *  STATIC VARIABLES
  **********************/
 static uint32_t last_task_run;
-static bool anim_list_changed;
+static lv_anim_pace_cb_t anim_pace_cb;
+static lv_anim_offload_cb_t anim_offload_cb;
+static anim_array_t anims;
+
+/*Index of the animation `anim_task` is handling, and the end of those it handles this time. Kept
+ * pointing at the same animations when one is deleted meanwhile*/
+static int32_t run_i;
+static int32_t run_end;
+static bool run_gone; /*The animation being handled was deleted*/
 
 /**********************
  *      MACROS
@@ -55,7 +94,9 @@ static bool anim_list_changed;
  */
 void lv_anim_core_init(void)
 {
-    lv_ll_init(&LV_GC_ROOT(_lv_anim_ll), sizeof(lv_anim_t));
+    LV_GC_ROOT(_lv_anim_mem) = NULL;
+    memset(&anims, 0, sizeof(anims));
+    run_end = 0;
     last_task_run = lv_tick_get();
     lv_task_create(anim_task, LV_DISP_DEF_REFR_PERIOD, LV_TASK_PRIO_MID, NULL);
 }
@@ -87,21 +128,30 @@ void lv_anim_create(lv_anim_t * a)
     /* Do not let two animations for the  same 'var' with the same 'fp'*/
     if(a->exec_cb != NULL) lv_anim_del(a->var, a->exec_cb); /*fp == NULL would delete all animations of var*/
 
-    /*Add the new animation to the animation linked list*/
-    lv_anim_t * new_anim = lv_ll_ins_head(&LV_GC_ROOT(_lv_anim_ll));
+    /*Add the new animation to the end of the arrays. If it's created by a callback of
+     * `anim_task` it's first stepped the next time*/
+    lv_anim_t * new_anim = anim_reserve() ? &anims.desc[anims.cnt] : NULL;
     lv_mem_assert(new_anim);
     if(new_anim == NULL) return;
 
     /*Initialize the animation descriptor*/
     a->playback_now = 0;
+    a->started      = 0;
+    a->offloaded    = 0;
+
+    uint16_t i = anims.cnt;
     memcpy(new_anim, a, sizeof(lv_anim_t));
+    anims.var[i]      = a->var;
+    anims.exec_cb[i]  = a->exec_cb;
+    anims.path_cb[i]  = a->path_cb;
+    anims.start[i]    = a->start;
+    anims.end[i]      = a->end;
+    anims.time[i]     = a->time;
+    anims.act_time[i] = a->act_time;
+    anims.cnt++;
 
     /*Set the start value*/
-    if(new_anim->exec_cb) new_anim->exec_cb(new_anim->var, new_anim->start);
-
-    /* Creating an animation changed the linked list.
-     * It's important if it happens in a ready callback. (see `anim_task`)*/
-    anim_list_changed = true;
+    if(a->exec_cb) a->exec_cb(a->var, a->start);
 
     LV_LOG_TRACE("animation created")
 }
@@ -115,23 +165,26 @@ void lv_anim_create(lv_anim_t * a)
  */
 bool lv_anim_del(void * var, lv_anim_exec_xcb_t exec_cb)
 {
-    lv_anim_t * a;
-    lv_anim_t * a_next;
     bool del = false;
-    a        = lv_ll_get_head(&LV_GC_ROOT(_lv_anim_ll));
-    while(a != NULL) {
-        /*'a' might be deleted, so get the next object while 'a' is valid*/
-        a_next = lv_ll_get_next(&LV_GC_ROOT(_lv_anim_ll), a);
-
-        if(a->var == var && (a->exec_cb == exec_cb || exec_cb == NULL)) {
-            lv_ll_rem(&LV_GC_ROOT(_lv_anim_ll), a);
-            lv_mem_free(a);
-            anim_list_changed = true; /*Read by `anim_task`. It need to know if a delete occurred in
-                                         the linked list*/
-            del = true;
+    int32_t i = 0;
+    while(i < anims.cnt) {
+        if(anims.var[i] != var || (anims.exec_cb[i] != exec_cb && exec_cb != NULL)) {
+            i++;
+            continue;
         }
 
-        a = a_next;
+        /*Leave an offloaded animation where it would be now. The callbacks might delete
+         * animations too, so find it again afterwards*/
+        lv_anim_t * a = anim_desc(i);
+        if(a->offloaded) {
+            a->offloaded = 0;
+            a->exec_cb(a->var, a->path_cb(a));
+            if(anim_offload_cb) anim_offload_cb(a, false);
+            i = 0;
+            continue;
+        }
+        anim_remove(i);
+        del = true;
     }
 
     return del;
@@ -143,11 +196,30 @@ bool lv_anim_del(void * var, lv_anim_exec_xcb_t exec_cb)
  */
 uint16_t lv_anim_count_running(void)
 {
-    uint16_t cnt = 0;
-    lv_anim_t * a;
-    LV_LL_READ(LV_GC_ROOT(_lv_anim_ll), a) cnt++;
+    return anims.cnt;
+}
 
-    return cnt++;
+/**
+ * Set a callback to pace the animations to the output.
+ * While it returns `true` the animations' time keeps running but their new values are only
+ * applied when they finish. Once it returns `false` every animation jumps to its current value.
+ * @param pace_cb the callback or NULL to apply the values on every animation step
+ */
+void lv_anim_set_pace_cb(lv_anim_pace_cb_t pace_cb)
+{
+    anim_pace_cb = pace_cb;
+}
+
+/**
+ * Set a callback to let the output run animations itself.
+ * It's asked when each one shot animation starts. An offloaded animation's time keeps running but
+ * only its end value is applied, or its current value if it is deleted earlier, and the callback is
+ * called again after that.
+ * @param offload_cb the callback or NULL to run every animation here
+ */
+void lv_anim_set_offload_cb(lv_anim_offload_cb_t offload_cb)
+{
+    anim_offload_cb = offload_cb;
 }
 
 /**
@@ -378,48 +450,71 @@ static void anim_task(lv_task_t * param)
 {
     (void)param;
 
-    lv_anim_t * a;
-    LV_LL_READ(LV_GC_ROOT(_lv_anim_ll), a)
-    {
-        a->has_run = 0;
-    }
-
     uint32_t elaps = lv_tick_elaps(last_task_run);
+    if(elaps > INT16_MAX) elaps = INT16_MAX;
+
+    /*Step the time of every animation in one pass over its arrays*/
+    int16_t * act_time = anims.act_time;
+    uint16_t * time    = anims.time;
+    uint16_t i;
+    for(i = 0; i < anims.cnt; i++) {
+        int32_t t = act_time[i] + (int32_t)elaps;
+        if(t > time[i]) t = time[i];
+        act_time[i] = t;
+    }
 
-    a = lv_ll_get_head(&LV_GC_ROOT(_lv_anim_ll));
-
-    while(a != NULL) {
-        /*It can be set by `lv_anim_del()` typically in `end_cb`. If set then an animation delete
-         * happened in `anim_ready_handler` which could make this linked list reading corrupt
-         * because the list is changed meanwhile
-         */
-        anim_list_changed = false;
-
-        if(!a->has_run) {
-            a->has_run = 1; /*The list readying might be reseted so need to know which anim has run already*/
-            a->act_time += elaps;
-            if(a->act_time >= 0) {
-                if(a->act_time > a->time) a->act_time = a->time;
-
-                int32_t new_value;
-                new_value = a->path_cb(a);
+    /*While the output is behind only apply the values of the finishing animations*/
+    bool held = anim_pace_cb != NULL && anim_pace_cb();
+
+    /*Apply them. A callback can create and delete animations, so the arrays are read through
+     * `anims` again after each one and `run_i` is moved back if animations before it go.
+     * The animations created meanwhile are at the end and are handled next time*/
+    run_end = anims.cnt;
+    for(run_i = 0; run_i < run_end; run_i++) {
+        i        = run_i;
+        run_gone = false;
+        if(anims.act_time[i] < 0) continue;
+
+        lv_anim_t * a = &anims.desc[i];
+        if(!a->started) {
+            a->started = 1;
+            if(anim_offload_cb && anims.exec_cb[i] && a->repeat == 0 && a->playback == 0 &&
+               anims.act_time[i] < anims.time[i]) {
+                a->offloaded = anim_offload_cb(anim_desc(i), true);
+                if(run_gone) continue;
+                i = run_i;
+                a = &anims.desc[i];
+            }
+        }
 
-                /*Apply the calculated value*/
-                if(a->exec_cb) a->exec_cb(a->var, new_value);
+        bool ready = anims.act_time[i] >= anims.time[i];
+        if((!held && !a->offloaded) || ready) {
+            /*Apply the calculated value*/
+            if(anims.exec_cb[i]) {
+                anims.exec_cb[i](anims.var[i], anim_value(i));
+                if(run_gone) continue;
+                i = run_i;
+                a = &anims.desc[i];
+            }
 
-                /*If the time is elapsed the animation is ready*/
-                if(a->act_time >= a->time) {
-                    anim_ready_handler(a);
-                }
+            if(a->offloaded) {
+                a->offloaded = 0;
+                anim_offload_cb(anim_desc(i), false);
+                if(run_gone) continue;
+                i = run_i;
             }
         }
 
-        /* If the linked list changed due to anim. delete then it's not safe to continue
-         * the reading of the list from here -> start from the head*/
-        if(anim_list_changed)
-            a = lv_ll_get_head(&LV_GC_ROOT(_lv_anim_ll));
-        else
-            a = lv_ll_get_next(&LV_GC_ROOT(_lv_anim_ll), a);
+        /*If the time is elapsed the animation is ready*/
+        if(ready) anim_ready_handler(i);
+    }
+    run_end = 0;
+
+    /*Give back the memory once every animation is done*/
+    if(anims.cnt == 0 && anims.size > 0) {
+        lv_mem_free(LV_GC_ROOT(_lv_anim_mem));
+        LV_GC_ROOT(_lv_anim_mem) = NULL;
+        memset(&anims, 0, sizeof(anims));
     }
 
     last_task_run = lv_tick_get();
@@ -428,46 +523,175 @@ static void anim_task(lv_task_t * param)
 /**
  * Called when an animation is ready to do the necessary thinks
  * e.g. repeat, play back, delete etc.
- * @param a pointer to an animation descriptor
- * @return true: animation delete occurred nnd the `LV_GC_ROOT(_lv_anim_ll)` has changed
+ * @param i index of the animation
  * */
-static bool anim_ready_handler(lv_anim_t * a)
+static void anim_ready_handler(uint16_t i)
 {
+    lv_anim_t * a = &anims.desc[i];
 
     /*Delete the animation if
      * - no repeat and no play back (simple one shot animation)
      * - no repeat, play back is enabled and play back is ready */
     if((a->repeat == 0 && a->playback == 0) || (a->repeat == 0 && a->playback == 1 && a->playback_now == 1)) {
 
-        /*Create copy from the animation and delete the animation from the list.
+        /*Create copy from the animation and delete the animation from the arrays.
          * This way the `ready_cb` will see the animations like it's animation is ready deleted*/
         lv_anim_t a_tmp;
-        memcpy(&a_tmp, a, sizeof(lv_anim_t));
-        lv_ll_rem(&LV_GC_ROOT(_lv_anim_ll), a);
-        lv_mem_free(a);
-        anim_list_changed = true;
+        memcpy(&a_tmp, anim_desc(i), sizeof(lv_anim_t));
+        anim_remove(i);
 
         /* Call the callback function at the end*/
         if(a_tmp.ready_cb != NULL) a_tmp.ready_cb(&a_tmp);
     }
     /*If the animation is not deleted then restart it*/
     else {
-        a->act_time = -a->repeat_pause; /*Restart the animation*/
+        anims.act_time[i] = -a->repeat_pause; /*Restart the animation*/
         /*Swap the start and end values in play back mode*/
         if(a->playback != 0) {
             /*If now turning back use the 'playback_pause*/
-            if(a->playback_now == 0) a->act_time = -a->playback_pause;
+            if(a->playback_now == 0) anims.act_time[i] = -a->playback_pause;
 
             /*Toggle the play back state*/
             a->playback_now = a->playback_now == 0 ? 1 : 0;
             /*Swap the start and end values*/
             int32_t tmp;
-            tmp      = a->start;
-            a->start = a->end;
-            a->end   = tmp;
+            tmp             = anims.start[i];
+            anims.start[i]  = anims.end[i];
+            anims.end[i]    = tmp;
         }
     }
+}
+
+/**
+ * Make room for one more animation, moving the arrays to a block twice as large if they're full
+ * @return true: there is room; false: out of memory
+ */
+static bool anim_reserve(void)
+{
+    if(anims.cnt < anims.size) return true;
+    if(anims.size >= UINT16_MAX / 2) return false;
+
+    uint16_t size = anims.size ? anims.size * 2 : LV_ANIM_ARRAY_MIN;
+    uint8_t * mem = lv_mem_alloc(size * LV_ANIM_ENTRY_SIZE);
+    if(mem == NULL) return false;
+
+    anim_array_t arr;
+    anim_layout(&arr, mem, size);
+    uint16_t cnt = anims.cnt;
+    if(cnt > 0) {
+        memcpy(arr.desc, anims.desc, cnt * sizeof(lv_anim_t));
+        memcpy(arr.var, anims.var, cnt * sizeof(void *));
+        memcpy(arr.exec_cb, anims.exec_cb, cnt * sizeof(lv_anim_exec_xcb_t));
+        memcpy(arr.path_cb, anims.path_cb, cnt * sizeof(lv_anim_path_cb_t));
+        memcpy(arr.start, anims.start, cnt * sizeof(int32_t));
+        memcpy(arr.end, anims.end, cnt * sizeof(int32_t));
+        memcpy(arr.time, anims.time, cnt * sizeof(uint16_t));
+        memcpy(arr.act_time, anims.act_time, cnt * sizeof(int16_t));
+    }
+    arr.cnt = cnt;
 
-    return anim_list_changed;
+    if(LV_GC_ROOT(_lv_anim_mem)) lv_mem_free(LV_GC_ROOT(_lv_anim_mem));
+    LV_GC_ROOT(_lv_anim_mem) = mem;
+    anims = arr;
+
+    return true;
+}
+
+/**
+ * Point the arrays into a block, the widest elements first so each array stays aligned
+ * @param arr the arrays to set
+ * @param mem a block of `size * LV_ANIM_ENTRY_SIZE` bytes
+ * @param size number of animations the block has room for
+ */
+static void anim_layout(anim_array_t * arr, uint8_t * mem, uint16_t size)
+{
+    arr->desc = (lv_anim_t *)mem;
+    mem += size * sizeof(lv_anim_t);
+    arr->var = (void **)mem;
+    mem += size * sizeof(void *);
+    arr->exec_cb = (lv_anim_exec_xcb_t *)mem;
+    mem += size * sizeof(lv_anim_exec_xcb_t);
+    arr->path_cb = (lv_anim_path_cb_t *)mem;
+    mem += size * sizeof(lv_anim_path_cb_t);
+    arr->start = (int32_t *)mem;
+    mem += size * sizeof(int32_t);
+    arr->end = (int32_t *)mem;
+    mem += size * sizeof(int32_t);
+    arr->time = (uint16_t *)mem;
+    mem += size * sizeof(uint16_t);
+    arr->act_time = (int16_t *)mem;
+
+    arr->size = size;
+}
+
+/**
+ * Delete an animation from the arrays, keeping the others in order
+ * @param i index of the animation
+ */
+static void anim_remove(uint16_t i)
+{
+    uint16_t n = anims.cnt - i - 1;
+
+    memmove(&anims.desc[i], &anims.desc[i + 1], n * sizeof(lv_anim_t));
+    memmove(&anims.var[i], &anims.var[i + 1], n * sizeof(void *));
+    memmove(&anims.exec_cb[i], &anims.exec_cb[i + 1], n * sizeof(lv_anim_exec_xcb_t));
+    memmove(&anims.path_cb[i], &anims.path_cb[i + 1], n * sizeof(lv_anim_path_cb_t));
+    memmove(&anims.start[i], &anims.start[i + 1], n * sizeof(int32_t));
+    memmove(&anims.end[i], &anims.end[i + 1], n * sizeof(int32_t));
+    memmove(&anims.time[i], &anims.time[i + 1], n * sizeof(uint16_t));
+    memmove(&anims.act_time[i], &anims.act_time[i + 1], n * sizeof(int16_t));
+    anims.cnt--;
+
+    /*Keep `anim_task` on the animation it's handling*/
+    if(i < run_end) {
+        if(i == run_i) run_gone = true;
+        if(i <= run_i) run_i--;
+        run_end--;
+    }
+}
+
+/**
+ * Get the descriptor of an animation brought up to date, to hand to a callback
+ * @param i index of the animation
+ * @return pointer to the descriptor. It's only valid until an animation is created or deleted.
+ */
+static lv_anim_t * anim_desc(uint16_t i)
+{
+    lv_anim_t * a = &anims.desc[i];
+
+    a->var      = anims.var[i];
+    a->exec_cb  = anims.exec_cb[i];
+    a->path_cb  = anims.path_cb[i];
+    a->start    = anims.start[i];
+    a->end      = anims.end[i];
+    a->time     = anims.time[i];
+    a->act_time = anims.act_time[i];
+
+    return a;
+}
+
+/**
+ * Get the current value of an animation. Linear ones are calculated from the arrays, the path
+ * callback of the others is called with the descriptor.
+ * @param i index of the animation
+ * @return the current value to set
+ */
+static lv_anim_value_t anim_value(uint16_t i)
+{
+    if(anims.path_cb[i] != lv_anim_path_linear) return anims.path_cb[i](anim_desc(i));
+
+    uint32_t step;
+    if(anims.time[i] == anims.act_time[i]) {
+        step = LV_ANIM_RESOLUTION;
+    } else {
+        step = ((int32_t)anims.act_time[i] * LV_ANIM_RESOLUTION) / anims.time[i];
+    }
+
+    int32_t new_value;
+    new_value = (int32_t)step * (anims.end[i] - anims.start[i]);
+    new_value = new_value >> LV_ANIM_RES_SHIFT;
+    new_value += anims.start[i];
+
+    return (lv_anim_value_t)new_value;
 }
 #endif
@@ -64,6 +64,15 @@ typedef lv_anim_value_t (*lv_anim_path_cb_t)(const struct _lv_anim_t *);
 /** Callback to call when the animation is ready*/
 typedef void (*lv_anim_ready_cb_t)(struct _lv_anim_t *);
 
+/** Asked before animations are applied. Return `true` while the output still hasn't
+ * delivered the previous frame to hold the animated values where they are*/
+typedef bool (*lv_anim_pace_cb_t)(void);
+
+/** Asked with `start == true` when an animation starts. Return `true` if the output runs the
+ * animation itself, then its values aren't applied until it ends or is deleted, when it's called
+ * again with `start == false`*/
+typedef bool (*lv_anim_offload_cb_t)(const struct _lv_anim_t * a, bool start);
+
 /** Describes an animation*/
 typedef struct _lv_anim_t
 {
@@ -85,7 +94,8 @@ typedef struct _lv_anim_t
     uint8_t repeat : 1;   /**< Repeat the animation infinitely*/
     /*Animation system use these - user shouldn't set*/
     uint8_t playback_now : 1; /**< Play back is in progress*/
-    uint32_t has_run : 1;     /**< Indicates the animation has run in this round*/
+    uint32_t started : 1;     /**< The offload callback was asked about the animation*/
+    uint32_t offloaded : 1;   /**< The output runs the animation, see `lv_anim_set_offload_cb`*/
 } lv_anim_t;
 
 
@@ -259,6 +269,25 @@ static inline bool lv_anim_custom_del(lv_anim_t * a, lv_anim_custom_exec_cb_t ex
  */
 uint16_t lv_anim_count_running(void);
 
+/**
+ * Set a callback to pace the animations to the output.
+ * While it returns `true` the animations' time keeps running but their new values are only
+ * applied when they finish. Once it returns `false` every animation jumps to its current value.
+ * This way a slow display (e.g. a network link) gets one redraw per delivered frame
+ * instead of every intermediate step.
+ * @param pace_cb the callback or NULL to apply the values on every animation step
+ */
+void lv_anim_set_pace_cb(lv_anim_pace_cb_t pace_cb);
+
+/**
+ * Set a callback to let the output run animations itself, e.g. a browser moving a snapshot of an
+ * object with a transform. It's asked when each one shot animation (no repeat or play back)
+ * starts. An offloaded animation's time keeps running but only its end value is applied, or its
+ * current value if it is deleted earlier, and the callback is called again after that.
+ * @param offload_cb the callback or NULL to run every animation here
+ */
+void lv_anim_set_offload_cb(lv_anim_offload_cb_t offload_cb);
+
 /**
  * Calculate the time of an animation with a given speed and the start and end values
  * @param speed speed of animation in unit/sec
@@ -32,6 +32,31 @@
  *   GLOBAL FUNCTIONS
  **********************/
 
+/**
+ * Mix a run of colors into another, as `dest[i] = lv_color_mix(src[i], dest[i], mix)`
+ * @param dest the colors to mix into, replaced with the results
+ * @param src the colors to mix in
+ * @param n number of colors
+ * @param mix the ratio of 'src' (0..255)
+ */
+void lv_color_mix_n(lv_color_t * dest, const lv_color_t * src, uint32_t n, uint8_t mix)
+{
+    uint32_t i;
+#if LV_COLOR_MIX_SPREAD
+    uint32_t m      = ((uint32_t)mix + 4) >> 3;
+    uint32_t bg_mix = 32 - m;
+
+    for(i = 0; i < n; i++) {
+        uint32_t w = lv_color_spread(src[i]) * m + lv_color_spread(dest[i]) * bg_mix;
+        dest[i]    = lv_color_join((w >> 5) & LV_COLOR_SPREAD_MASK);
+    }
+#else
+    for(i = 0; i < n; i++) {
+        dest[i] = lv_color_mix(src[i], dest[i], mix);
+    }
+#endif
+}
+
 /**********************
  *   STATIC FUNCTIONS
  **********************/
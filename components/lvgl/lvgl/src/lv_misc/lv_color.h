@@ -78,6 +78,18 @@ enum {
 #define LV_OPA_MIN 16  /*Opacities below this will be transparent*/
 #define LV_OPA_MAX 251 /*Opacities above this will fully cover*/
 
+/*With RGB565 and RGB332 colors 'lv_color_mix' spreads the channels of a color apart in a
+ * 32 bit word, leaving room above each for a 5 bit mix ratio, so one multiply mixes all of them*/
+#if LV_COLOR_DEPTH == 16 && LV_COLOR_16_SWAP == 0
+#define LV_COLOR_MIX_SPREAD 1
+#define LV_COLOR_SPREAD_MASK 0x07E0F81F
+#elif LV_COLOR_DEPTH == 8
+#define LV_COLOR_MIX_SPREAD 1
+#define LV_COLOR_SPREAD_MASK 0x00E01C03
+#else
+#define LV_COLOR_MIX_SPREAD 0
+#endif
+
 #if LV_COLOR_DEPTH == 1
 #define LV_COLOR_SIZE 8
 #elif LV_COLOR_DEPTH == 8
@@ -323,8 +335,52 @@ static inline uint32_t lv_color_to32(lv_color_t color)
 #endif
 }
 
+#if LV_COLOR_MIX_SPREAD
+/**
+ * Spread the channels of a color apart, green in the upper half word
+ * @param color a color
+ * @return the channels with 5 free bits above each
+ */
+static inline uint32_t lv_color_spread(lv_color_t color)
+{
+#if LV_COLOR_DEPTH == 16
+    return ((uint32_t)color.full | ((uint32_t)color.full << 16)) & LV_COLOR_SPREAD_MASK;
+#else
+    return ((uint32_t)color.full | ((uint32_t)color.full << 8) | ((uint32_t)color.full << 16)) & LV_COLOR_SPREAD_MASK;
+#endif
+}
+
+/**
+ * Join spread channels back into a color
+ * @param w channels spread by 'lv_color_spread', with nothing between them
+ * @return the color
+ */
+static inline lv_color_t lv_color_join(uint32_t w)
+{
+    lv_color_t ret;
+#if LV_COLOR_DEPTH == 16
+    ret.full = (uint16_t)(w | (w >> 16));
+#else
+    ret.full = (uint8_t)(w | (w >> 8) | (w >> 16));
+#endif
+    return ret;
+}
+#endif
+
+/**
+ * Mix two colors
+ * @param c1 the first color
+ * @param c2 the second color
+ * @param mix the ratio of 'c1' (0..255). RGB565 and RGB332 colors are mixed in 32 steps.
+ * @return the mixed color
+ */
 static inline lv_color_t lv_color_mix(lv_color_t c1, lv_color_t c2, uint8_t mix)
 {
+#if LV_COLOR_MIX_SPREAD
+    uint32_t m = ((uint32_t)mix + 4) >> 3;
+    uint32_t w = lv_color_spread(c1) * m + lv_color_spread(c2) * (32 - m);
+    return lv_color_join((w >> 5) & LV_COLOR_SPREAD_MASK);
+#else
     lv_color_t ret;
 #if LV_COLOR_DEPTH != 1
     /*LV_COLOR_DEPTH == 8, 16 or 32*/
@@ -349,6 +405,7 @@ static inline lv_color_t lv_color_mix(lv_color_t c1, lv_color_t c2, uint8_t mix)
 #endif
 
     return ret;
+#endif
 }
 
 /**
@@ -448,6 +505,15 @@ lv_color_t lv_color_hsv_to_rgb(uint16_t h, uint8_t s, uint8_t v);
  */
 lv_color_hsv_t lv_color_rgb_to_hsv(uint8_t r, uint8_t g, uint8_t b);
 
+/**
+ * Mix a run of colors into another, as `dest[i] = lv_color_mix(src[i], dest[i], mix)`
+ * @param dest the colors to mix into, replaced with the results
+ * @param src the colors to mix in
+ * @param n number of colors
+ * @param mix the ratio of 'src' (0..255)
+ */
+void lv_color_mix_n(lv_color_t * dest, const lv_color_t * src, uint32_t n, uint8_t mix);
+
 /**********************
  *      MACROS
  **********************/
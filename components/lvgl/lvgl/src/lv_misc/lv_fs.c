@@ -32,11 +32,31 @@
 /**********************
  *      TYPEDEFS
  **********************/
+#if LV_FS_CACHE_BLOCK_SIZE
+typedef struct
+{
+    uint32_t start; /*Offset in the file of the first byte held, UINT32_MAX if empty*/
+    uint32_t len;   /*Bytes held, fewer than LV_FS_CACHE_BLOCK_SIZE at the end of the file*/
+    uint8_t * data;
+} lv_fs_cache_block_t;
+
+typedef struct _lv_fs_cache_t
+{
+    uint32_t pos;   /*Read position the caller sees. The driver's is only set before reading.*/
+    uint8_t num;
+    uint8_t next;   /*Block replaced on the next miss*/
+    lv_fs_cache_block_t block[];
+} lv_fs_cache_t;
+#endif
 
 /**********************
  *  STATIC PROTOTYPES
  **********************/
 static const char * lv_fs_get_real_path(const char * path);
+#if LV_FS_CACHE_BLOCK_SIZE
+static lv_fs_cache_t * lv_fs_cache_create(uint8_t num);
+static lv_fs_res_t lv_fs_cache_read(lv_fs_file_t * file_p, uint8_t * buf, uint32_t btr, uint32_t * br);
+#endif
 
 /**********************
  *  STATIC VARIABLES
@@ -86,6 +106,9 @@ lv_fs_res_t lv_fs_open(lv_fs_file_t * file_p, const char * path, lv_fs_mode_t mo
 {
     file_p->drv    = NULL;
     file_p->file_d = NULL;
+#if LV_FS_CACHE_BLOCK_SIZE
+    file_p->cache = NULL;
+#endif
 
     if(path == NULL) return LV_FS_RES_INV_PARAM;
 
@@ -125,6 +148,14 @@ lv_fs_res_t lv_fs_open(lv_fs_file_t * file_p, const char * path, lv_fs_mode_t mo
         file_p->file_d = NULL;
         file_p->drv    = NULL;
     }
+#if LV_FS_CACHE_BLOCK_SIZE
+    /*Files that are only read get their blocks cached, or are read directly if the
+     * cache can't be allocated*/
+    else if(mode == LV_FS_MODE_RD && file_p->drv->cache_blocks && file_p->drv->read_cb &&
+            file_p->drv->seek_cb) {
+        file_p->cache = lv_fs_cache_create(file_p->drv->cache_blocks);
+    }
+#endif
 
     return res;
 }
@@ -147,6 +178,12 @@ lv_fs_res_t lv_fs_close(lv_fs_file_t * file_p)
     lv_fs_res_t res = file_p->drv->close_cb(file_p->drv, file_p->file_d);
 
     lv_mem_free(file_p->file_d); /*Clean up*/
+#if LV_FS_CACHE_BLOCK_SIZE
+    if(file_p->cache) {
+        lv_mem_free(file_p->cache);
+        file_p->cache = NULL;
+    }
+#endif
     file_p->file_d = NULL;
     file_p->drv    = NULL;
     file_p->file_d = NULL;
@@ -195,6 +232,14 @@ lv_fs_res_t lv_fs_read(lv_fs_file_t * file_p, void * buf, uint32_t btr, uint32_t
     if(file_p->drv->read_cb == NULL) return LV_FS_RES_NOT_IMP;
 
     uint32_t br_tmp = 0;
+#if LV_FS_CACHE_BLOCK_SIZE
+    if(file_p->cache) {
+        lv_fs_res_t res = lv_fs_cache_read(file_p, buf, btr, &br_tmp);
+        if(br != NULL) *br = br_tmp;
+        return res;
+    }
+#endif
+
     lv_fs_res_t res = file_p->drv->read_cb(file_p->drv, file_p->file_d, buf, btr, &br_tmp);
     if(br != NULL) *br = br_tmp;
 
@@ -221,6 +266,11 @@ lv_fs_res_t lv_fs_write(lv_fs_file_t * file_p, const void * buf, uint32_t btw, u
         return LV_FS_RES_NOT_IMP;
     }
 
+#if LV_FS_CACHE_BLOCK_SIZE
+    /*Only files opened read only are cached*/
+    if(file_p->cache) return LV_FS_RES_DENIED;
+#endif
+
     uint32_t bw_tmp = 0;
     lv_fs_res_t res = file_p->drv->write_cb(file_p->drv, file_p->file_d, buf, btw, &bw_tmp);
     if(bw != NULL) *bw = bw_tmp;
@@ -244,6 +294,14 @@ lv_fs_res_t lv_fs_seek(lv_fs_file_t * file_p, uint32_t pos)
         return LV_FS_RES_NOT_IMP;
     }
 
+#if LV_FS_CACHE_BLOCK_SIZE
+    /*The driver is only moved once a block has to be read*/
+    if(file_p->cache) {
+        file_p->cache->pos = pos;
+        return LV_FS_RES_OK;
+    }
+#endif
+
     lv_fs_res_t res = file_p->drv->seek_cb(file_p->drv, file_p->file_d, pos);
 
     return res;
@@ -262,6 +320,13 @@ lv_fs_res_t lv_fs_tell(lv_fs_file_t * file_p, uint32_t * pos)
         return LV_FS_RES_INV_PARAM;
     }
 
+#if LV_FS_CACHE_BLOCK_SIZE
+    if(file_p->cache) {
+        *pos = file_p->cache->pos;
+        return LV_FS_RES_OK;
+    }
+#endif
+
     if(file_p->drv->tell_cb == NULL) {
         pos = 0;
         return LV_FS_RES_NOT_IMP;
@@ -474,6 +539,9 @@ lv_fs_res_t lv_fs_free_space(char letter, uint32_t * total_p, uint32_t * free_p)
 void lv_fs_drv_init(lv_fs_drv_t * drv)
 {
     memset(drv, 0, sizeof(lv_fs_drv_t));
+#if LV_FS_CACHE_BLOCK_SIZE
+    drv->cache_blocks = LV_FS_CACHE_BLOCKS;
+#endif
 }
 
 /**
@@ -638,4 +706,101 @@ static const char * lv_fs_get_real_path(const char * path)
     return path;
 }
 
+#if LV_FS_CACHE_BLOCK_SIZE
+/**
+ * Allocate a cache of empty blocks for a file
+ * @param num number of blocks
+ * @return the cache or NULL if out of memory
+ */
+static lv_fs_cache_t * lv_fs_cache_create(uint8_t num)
+{
+    uint32_t head = sizeof(lv_fs_cache_t) + num * sizeof(lv_fs_cache_block_t);
+    lv_fs_cache_t * cache;
+    uint8_t i;
+
+    head = (head + 3) & ~3; /*Keep the data word aligned*/
+    cache = lv_mem_alloc(head + (uint32_t)num * LV_FS_CACHE_BLOCK_SIZE);
+    if(cache == NULL) return NULL;
+
+    cache->pos  = 0;
+    cache->num  = num;
+    cache->next = 0;
+    for(i = 0; i < num; i++) {
+        cache->block[i].start = UINT32_MAX;
+        cache->block[i].len   = 0;
+        cache->block[i].data  = (uint8_t *)cache + head + (uint32_t)i * LV_FS_CACHE_BLOCK_SIZE;
+    }
+
+    return cache;
+}
+
+/**
+ * Read from a cached file, through its blocks for reads shorter than a block and
+ * straight into `buf` from where the cached blocks end for longer ones
+ * @param file_p pointer to a lv_fs_file_t variable with a cache
+ * @param buf pointer to a buffer where the read bytes are stored
+ * @param btr Bytes To Read
+ * @param br the number of real read bytes (Bytes Read)
+ * @return LV_FS_RES_OK or any error from lv_fs_res_t enum
+ */
+static lv_fs_res_t lv_fs_cache_read(lv_fs_file_t * file_p, uint8_t * buf, uint32_t btr, uint32_t * br)
+{
+    lv_fs_cache_t * cache = file_p->cache;
+    lv_fs_drv_t * drv     = file_p->drv;
+    lv_fs_res_t res       = LV_FS_RES_OK;
+    lv_fs_cache_block_t * block;
+    uint32_t start;
+    uint32_t ofs;
+    uint32_t n;
+    uint8_t i;
+
+    *br = 0;
+    while(btr > 0) {
+        start = cache->pos - cache->pos % LV_FS_CACHE_BLOCK_SIZE;
+        block = NULL;
+        for(i = 0; i < cache->num; i++) {
+            if(cache->block[i].start == start) {
+                block = &cache->block[i];
+                break;
+            }
+        }
+
+        if(block == NULL) {
+            if(btr >= LV_FS_CACHE_BLOCK_SIZE) {
+                /*Caching a block or more read at once would only add a copy*/
+                n   = 0;
+                res = drv->seek_cb(drv, file_p->file_d, cache->pos);
+                if(res == LV_FS_RES_OK) res = drv->read_cb(drv, file_p->file_d, buf, btr, &n);
+                if(res == LV_FS_RES_OK) {
+                    cache->pos += n;
+                    *br += n;
+                }
+                break;
+            }
+
+            block        = &cache->block[cache->next];
+            cache->next  = (cache->next + 1) % cache->num;
+            block->start = UINT32_MAX;
+            block->len   = 0;
+            res = drv->seek_cb(drv, file_p->file_d, start);
+            if(res == LV_FS_RES_OK) res = drv->read_cb(drv, file_p->file_d, block->data, LV_FS_CACHE_BLOCK_SIZE, &block->len);
+            if(res != LV_FS_RES_OK) break;
+            block->start = start;
+        }
+
+        ofs = cache->pos - start;
+        if(ofs >= block->len) break; /*End of the file*/
+        n = block->len - ofs;
+        if(n > btr) n = btr;
+        memcpy(buf, block->data + ofs, n);
+        cache->pos += n;
+        buf += n;
+        btr -= n;
+        *br += n;
+    }
+
+    return res;
+}
+#endif
+
 #endif /*LV_USE_FILESYSTEM*/
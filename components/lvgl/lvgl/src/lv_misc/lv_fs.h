@@ -67,6 +67,9 @@ typedef struct _lv_fs_drv_t
     char letter;
     uint16_t file_size;
     uint16_t rddir_size;
+#if LV_FS_CACHE_BLOCK_SIZE
+    uint8_t cache_blocks; /*Blocks cached for each file opened read only, 0 for none. LV_FS_CACHE_BLOCKS by default.*/
+#endif
     bool (*ready_cb)(struct _lv_fs_drv_t * drv);
 
     lv_fs_res_t (*open_cb)(struct _lv_fs_drv_t * drv, void * file_p, const char * path, lv_fs_mode_t mode);
@@ -94,6 +97,9 @@ typedef struct
 {
     void * file_d;
     lv_fs_drv_t * drv;
+#if LV_FS_CACHE_BLOCK_SIZE
+    struct _lv_fs_cache_t * cache; /*Blocks read ahead, NULL if uncached*/
+#endif
 } lv_fs_file_t;
 
 typedef struct
@@ -36,9 +36,10 @@ extern "C" {
     prefix lv_ll_t _lv_indev_ll; /*Linked list of screens*/                                                            \
     prefix lv_ll_t _lv_drv_ll;                                                                                         \
     prefix lv_ll_t _lv_file_ll;                                                                                        \
-    prefix lv_ll_t _lv_anim_ll;                                                                                        \
+    prefix void * _lv_anim_mem;  /*Block holding the arrays of running animations*/                                    \
     prefix lv_ll_t _lv_group_ll;                                                                                       \
     prefix lv_ll_t _lv_img_defoder_ll;                                                                                 \
+    prefix lv_ll_t _lv_style_intern_ll; /*Shared copies of styles given by `lv_style_intern`*/                          \
     prefix lv_img_cache_entry_t * _lv_img_cache_array;                                                                 \
     prefix void * _lv_task_act;                                                                                        \
     prefix void * _lv_draw_buf; 
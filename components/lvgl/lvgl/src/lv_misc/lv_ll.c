@@ -68,6 +68,20 @@ void lv_ll_init(lv_ll_t * ll_p, uint32_t node_size)
     ll_p->n_size = node_size;
 }
 
+/**
+ * Initialize a linked list whose nodes are allocated from the pool of their size
+ * (see `lv_mem_pool_add`), for lists whose nodes are inserted and removed often
+ * @param ll_p pointer to ll_dsc variable
+ * @param node_size the size of 1 node in bytes
+ */
+void lv_ll_init_pool(lv_ll_t * ll_p, uint32_t node_size)
+{
+    lv_ll_init(ll_p, node_size);
+
+    /*Lists of the same node size share the pool*/
+    lv_mem_pool_add(ll_p->n_size + LL_NODE_META_SIZE);
+}
+
 /**
  * Add a new head to a linked list
  * @param ll_p pointer to linked list
@@ -199,14 +213,15 @@ void lv_ll_clear(lv_ll_t * ll_p)
     i      = lv_ll_get_head(ll_p);
     i_next = NULL;
 
+    /*All the nodes go, so there are no neighbours to link*/
     while(i != NULL) {
         i_next = lv_ll_get_next(ll_p, i);
-
-        lv_ll_rem(ll_p, i);
         lv_mem_free(i);
-
         i = i_next;
     }
+
+    ll_p->head = NULL;
+    ll_p->tail = NULL;
 }
 
 /**
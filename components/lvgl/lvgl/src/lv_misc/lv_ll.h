@@ -48,6 +48,14 @@ typedef struct
  */
 void lv_ll_init(lv_ll_t * ll_p, uint32_t node_size);
 
+/**
+ * Initialize a linked list whose nodes are allocated from the pool of their size
+ * (see `lv_mem_pool_add`), for lists whose nodes are inserted and removed often
+ * @param ll_p pointer to ll_dsc variable
+ * @param node_size the size of 1 node in bytes
+ */
+void lv_ll_init_pool(lv_ll_t * ll_p, uint32_t node_size);
+
 /**
  * Add a new head to a linked list
  * @param ll_p pointer to linked list
@@ -9,6 +9,9 @@
  *********************/
 #include "lv_mem.h"
 #include "lv_math.h"
+#include "../lv_hal/lv_hal_tick.h"
+#include <stdbool.h>
+#include <stddef.h>
 #include <string.h>
 
 #if LV_MEM_CUSTOM != 0
@@ -27,6 +30,47 @@
 #define MEM_UNIT uint32_t
 #endif
 
+#if LV_MEM_CUSTOM == 0 && LV_MEM_TLSF
+#define MEM_USE_TLSF 1
+#else
+#define MEM_USE_TLSF 0
+#endif
+
+#if LV_MEM_CUSTOM == 0 && LV_MEM_POOL_CNT
+#define MEM_USE_POOL 1
+#else
+#define MEM_USE_POOL 0
+#endif
+
+#if MEM_USE_TLSF
+/*Every power of 2 range of free block sizes is split in this many lists (log2)*/
+#define TLSF_SL_LOG2 3
+#define TLSF_SL_CNT (1 << TLSF_SL_LOG2)
+
+#ifdef LV_MEM_ENV64
+#define TLSF_ALIGN_LOG2 3
+#else
+#define TLSF_ALIGN_LOG2 2
+#endif
+
+/*Blocks smaller than this are kept in the first level 0 lists, evenly spaced by the alignment*/
+#define TLSF_FL_SHIFT (TLSF_SL_LOG2 + TLSF_ALIGN_LOG2)
+#define TLSF_SMALL_SIZE (1U << TLSF_FL_SHIFT)
+
+/*The first level lists: the small blocks and one for every power of 2 up to LV_MEM_SIZE*/
+#define TLSF_FL_CNT                                                                                                    \
+    (LV_MEM_SIZE < (1UL << 12) ? 12 - TLSF_FL_SHIFT + 1 :                                                              \
+     LV_MEM_SIZE < (1UL << 14) ? 14 - TLSF_FL_SHIFT + 1 :                                                              \
+     LV_MEM_SIZE < (1UL << 16) ? 16 - TLSF_FL_SHIFT + 1 :                                                              \
+     LV_MEM_SIZE < (1UL << 18) ? 18 - TLSF_FL_SHIFT + 1 :                                                              \
+     LV_MEM_SIZE < (1UL << 20) ? 20 - TLSF_FL_SHIFT + 1 :                                                              \
+     LV_MEM_SIZE < (1UL << 22) ? 22 - TLSF_FL_SHIFT + 1 :                                                              \
+     LV_MEM_SIZE < (1UL << 24) ? 24 - TLSF_FL_SHIFT + 1 : 30 - TLSF_FL_SHIFT + 1)
+
+/*A free block has to store the two free list links and the `prev_phys` of the next block*/
+#define TLSF_MIN_SIZE (3 * sizeof(lv_mem_tlsf_blk_t *))
+#endif
+
 /**********************
  *      TYPEDEFS
  **********************/
@@ -38,8 +82,14 @@ typedef union
 {
     struct
     {
-        MEM_UNIT used : 1;    // 1: if the entry is used
-        MEM_UNIT d_size : 31; // Size off the data (1 means 4 bytes)
+        MEM_UNIT used : 1;      // 1: if the entry is used
+        MEM_UNIT pool : 1;      // 1: if the entry is in a slab of a pool
+#if MEM_USE_TLSF
+        MEM_UNIT prev_free : 1; // 1: if the previous entry is free
+        MEM_UNIT d_size : 29;   // Size off the data (1 means 4 bytes)
+#else
+        MEM_UNIT d_size : 30;   // Size off the data (1 means 4 bytes)
+#endif
     } s;
     MEM_UNIT header; // The header (used + d_size)
 } lv_mem_header_t;
@@ -50,15 +100,69 @@ typedef struct
     uint8_t first_data; /*First data byte in the allocated data (Just for easily create a pointer)*/
 } lv_mem_ent_t;
 
+#if MEM_USE_POOL
+/*A slab: one allocation holding LV_MEM_POOL_SLAB_CNT entries of a pool*/
+typedef struct _lv_mem_slab_t
+{
+    struct _lv_mem_slab_t * next;
+} lv_mem_slab_t;
+
+typedef struct
+{
+    uint32_t size;           /*Data size of the entries*/
+    lv_mem_ent_t * free_ent; /*Unused entries, linked through their data*/
+    lv_mem_slab_t * slabs;
+} lv_mem_pool_t;
+#endif
+
+#if MEM_USE_TLSF
+/* A TLSF block. `prev_phys` overlaps the last bytes of the previous block's data so it's valid only
+ * if that block is free. The free list links are stored in the first bytes of the data.*/
+typedef struct _lv_mem_tlsf_blk_t
+{
+    struct _lv_mem_tlsf_blk_t * prev_phys;
+    lv_mem_header_t header;
+} lv_mem_tlsf_blk_t;
+#endif
+
 #endif /* LV_ENABLE_GC */
 
 /**********************
  *  STATIC PROTOTYPES
  **********************/
 #if LV_MEM_CUSTOM == 0
+static void * builtin_alloc(uint32_t size);
+static void builtin_free(lv_mem_ent_t * e);
+#endif
+
+#if MEM_USE_POOL
+static lv_mem_pool_t * pool_find(uint32_t size);
+static void * pool_alloc(uint32_t size);
+static void pool_free(lv_mem_ent_t * e);
+static bool pool_flush(void);
+static bool pool_flush_one(lv_mem_pool_t * pool);
+static inline lv_mem_ent_t * slab_ent(lv_mem_slab_t * slab, uint32_t size, uint32_t i);
+#endif
+
+#if LV_MEM_CUSTOM == 0 && MEM_USE_TLSF == 0
 static lv_mem_ent_t * ent_get_next(lv_mem_ent_t * act_e);
 static void * ent_alloc(lv_mem_ent_t * e, uint32_t size);
 static void ent_trunc(lv_mem_ent_t * e, uint32_t size);
+static bool ent_defrag_step(void);
+#endif
+
+#if MEM_USE_TLSF
+static void * tlsf_alloc(uint32_t size);
+static void tlsf_free(lv_mem_tlsf_blk_t * b);
+static void tlsf_trunc(lv_mem_tlsf_blk_t * b, uint32_t size);
+static void tlsf_insert(lv_mem_tlsf_blk_t * b);
+static void tlsf_remove(lv_mem_tlsf_blk_t * b);
+static void tlsf_mapping(uint32_t size, uint8_t * fl, uint8_t * sl);
+static uint8_t tlsf_msb(uint32_t x);
+static uint8_t tlsf_lsb(uint32_t x);
+static inline uint8_t * tlsf_data(lv_mem_tlsf_blk_t * b);
+static inline lv_mem_tlsf_blk_t * tlsf_next_phys(lv_mem_tlsf_blk_t * b);
+static inline lv_mem_tlsf_blk_t ** tlsf_links(lv_mem_tlsf_blk_t * b);
 #endif
 
 /**********************
@@ -66,10 +170,34 @@ static void ent_trunc(lv_mem_ent_t * e, uint32_t size);
  **********************/
 #if LV_MEM_CUSTOM == 0
 static uint8_t * work_mem;
+static bool defrag_dirty;   /*Memory was freed since the last complete pass of `lv_mem_defrag_step`*/
+#if MEM_USE_POOL
+static uint8_t defrag_pool; /*The next pool to give back the empty slabs of*/
+#endif
+#if MEM_USE_TLSF == 0
+static lv_mem_ent_t * defrag_ent; /*The next entry to join the following free entries to. NULL: the first*/
+#endif
+#endif
+
+#if MEM_USE_TLSF
+static uint32_t tlsf_fl_map;                                        /*Bit `fl`: `tlsf_sl_map[fl] != 0`*/
+static uint32_t tlsf_sl_map[TLSF_FL_CNT];                           /*Bit `sl`: list `fl`, `sl` has blocks*/
+static lv_mem_tlsf_blk_t * tlsf_lists[TLSF_FL_CNT][TLSF_SL_CNT];    /*Free blocks in each size range*/
+static lv_mem_tlsf_blk_t * tlsf_last;                               /*Zero size, used block closing the pool*/
+#endif
+
+#if MEM_USE_POOL
+static lv_mem_pool_t pools[LV_MEM_POOL_CNT];
+static uint8_t pool_cnt;
 #endif
 
 static uint32_t zero_mem; /*Give the address of this variable if 0 byte should be allocated*/
 
+#if LV_ENABLE_GC == 0
+static uint32_t used_size; /*Bytes of data allocated*/
+static uint32_t peak_size; /*Most of `used_size` since the last `lv_mem_reset_peak`*/
+#endif
+
 /**********************
  *      MACROS
  **********************/
@@ -85,6 +213,14 @@ void lv_mem_init(void)
 {
 #if LV_MEM_CUSTOM == 0
 
+    defrag_dirty = false;
+#if MEM_USE_POOL
+    defrag_pool = 0;
+#endif
+#if MEM_USE_TLSF == 0
+    defrag_ent = NULL;
+#endif
+
 #if LV_MEM_ADR == 0
     /*Allocate a large array to store the dynamically allocated data*/
     static LV_MEM_ATTR MEM_UNIT work_mem_int[LV_MEM_SIZE / sizeof(MEM_UNIT)];
@@ -93,11 +229,36 @@ void lv_mem_init(void)
     work_mem = (uint8_t *)LV_MEM_ADR;
 #endif
 
+#if MEM_USE_POOL
+    memset(pools, 0, sizeof(pools));
+    pool_cnt = 0;
+#endif
+
+#if MEM_USE_TLSF
+    memset(tlsf_sl_map, 0, sizeof(tlsf_sl_map));
+    memset(tlsf_lists, 0, sizeof(tlsf_lists));
+    tlsf_fl_map = 0;
+
+    /*One free block covers the pool. It's closed by a zero size used block at the end */
+    lv_mem_tlsf_blk_t * full = (lv_mem_tlsf_blk_t *)work_mem;
+    tlsf_last = (lv_mem_tlsf_blk_t *)&work_mem[LV_MEM_SIZE - sizeof(lv_mem_header_t) - sizeof(lv_mem_tlsf_blk_t *)];
+    full->header.header      = 0;
+    full->header.s.d_size    = (uint8_t *)tlsf_last + sizeof(lv_mem_tlsf_blk_t *) - tlsf_data(full);
+
+    tlsf_last->prev_phys          = full;
+    tlsf_last->header.header      = 0;
+    tlsf_last->header.s.used      = 1;
+    tlsf_last->header.s.prev_free = 1;
+    tlsf_last->header.s.d_size    = 0;
+
+    tlsf_insert(full);
+#else
     lv_mem_ent_t * full = (lv_mem_ent_t *)work_mem;
-    full->header.s.used = 0;
+    full->header.header = 0;
     /*The total mem size id reduced by the first header and the close patterns */
     full->header.s.d_size = LV_MEM_SIZE - sizeof(lv_mem_header_t);
 #endif
+#endif
 }
 
 /**
@@ -126,22 +287,13 @@ void * lv_mem_alloc(uint32_t size)
 #endif
     void * alloc = NULL;
 
-#if LV_MEM_CUSTOM == 0
-    /*Use the built-in allocators*/
-    lv_mem_ent_t * e = NULL;
-
-    // Search for a appropriate entry
-    do {
-        // Get the next entry
-        e = ent_get_next(e);
-
-        /*If there is next entry then try to allocate there*/
-        if(e != NULL) {
-            alloc = ent_alloc(e, size);
-        }
-        // End if there is not next entry OR the alloc. is successful
-    } while(e != NULL && alloc == NULL);
-
+#if MEM_USE_POOL
+    /*Use the pool of the size if any. Give back the empty slabs if there is no memory otherwise*/
+    alloc = pool_alloc(size);
+    if(alloc == NULL) alloc = builtin_alloc(size);
+    if(alloc == NULL && pool_flush()) alloc = builtin_alloc(size);
+#elif LV_MEM_CUSTOM == 0
+    alloc = builtin_alloc(size);
 #else
 /*Use custom, user defined malloc function*/
 #if LV_ENABLE_GC == 1 /*gc must not include header*/
@@ -164,6 +316,13 @@ void * lv_mem_alloc(uint32_t size)
 
     if(alloc == NULL) LV_LOG_WARN("Couldn't allocate memory");
 
+#if LV_ENABLE_GC == 0
+    if(alloc != NULL) {
+        used_size += lv_mem_get_size(alloc);
+        if(used_size > peak_size) peak_size = used_size;
+    }
+#endif
+
     return alloc;
 }
 
@@ -180,27 +339,25 @@ void lv_mem_free(const void * data)
     memset((void *)data, 0xbb, lv_mem_get_size(data));
 #endif
 
+#if LV_MEM_CUSTOM == 0
+    defrag_dirty = true;
+#endif
+
 #if LV_ENABLE_GC == 0
     /*e points to the header*/
     lv_mem_ent_t * e = (lv_mem_ent_t *)((uint8_t *)data - sizeof(lv_mem_header_t));
+    used_size -= e->header.s.d_size;
+#if MEM_USE_POOL
+    if(e->header.s.pool) {
+        pool_free(e);
+        return;
+    }
+#endif
     e->header.s.used = 0;
 #endif
 
 #if LV_MEM_CUSTOM == 0
-#if LV_MEM_AUTO_DEFRAG
-    /* Make a simple defrag.
-     * Join the following free entries after this*/
-    lv_mem_ent_t * e_next;
-    e_next = ent_get_next(e);
-    while(e_next != NULL) {
-        if(e_next->header.s.used == 0) {
-            e->header.s.d_size += e_next->header.s.d_size + sizeof(e->header);
-        } else {
-            break;
-        }
-        e_next = ent_get_next(e_next);
-    }
-#endif
+    builtin_free(e);
 #else /*Use custom, user defined free function*/
 #if LV_ENABLE_GC == 0
     LV_MEM_CUSTOM_FREE(e);
@@ -237,7 +394,15 @@ void * lv_mem_realloc(void * data_p, uint32_t new_size)
     /* Truncate the memory if the new size is smaller. */
     if(new_size < old_size) {
         lv_mem_ent_t * e = (lv_mem_ent_t *)((uint8_t *)data_p - sizeof(lv_mem_header_t));
+#if MEM_USE_POOL
+        if(e->header.s.pool) return data_p; /*Entries of a slab can't be split*/
+#endif
+#if MEM_USE_TLSF
+        tlsf_trunc((lv_mem_tlsf_blk_t *)((uint8_t *)e - offsetof(lv_mem_tlsf_blk_t, header)), new_size);
+#else
         ent_trunc(e, new_size);
+#endif
+        used_size -= old_size - e->header.s.d_size;
         return &e->first_data;
     }
 #endif
@@ -269,12 +434,41 @@ void * lv_mem_realloc(void * data_p, uint32_t new_size)
 
 #endif /* lv_enable_gc */
 
+/**
+ * Allocate the blocks of a size from a pool. They are kept in slabs of
+ * `LV_MEM_POOL_SLAB_CNT` blocks so objects of the same size created and deleted
+ * often don't fragment the rest of the memory.
+ * Nothing happens if the size already has a pool or there are `LV_MEM_POOL_CNT` pools.
+ * @param size size of the blocks in bytes
+ */
+void lv_mem_pool_add(uint32_t size)
+{
+#if MEM_USE_POOL
+    /*Round the size up like `lv_mem_alloc`*/
+    size = (size + sizeof(MEM_UNIT) - 1) & ~(sizeof(MEM_UNIT) - 1);
+    if(size < sizeof(void *)) size = sizeof(void *);
+
+    if(pool_find(size) != NULL || pool_cnt >= LV_MEM_POOL_CNT) return;
+
+    memset(&pools[pool_cnt], 0, sizeof(lv_mem_pool_t));
+    pools[pool_cnt].size = size;
+    pool_cnt++;
+#else
+    (void)size; /*Unused*/
+#endif
+}
+
 /**
  * Join the adjacent free memory blocks
  */
 void lv_mem_defrag(void)
 {
-#if LV_MEM_CUSTOM == 0
+#if MEM_USE_POOL
+    /*Give back the empty slabs first*/
+    pool_flush();
+#endif
+
+#if LV_MEM_CUSTOM == 0 && MEM_USE_TLSF == 0
     lv_mem_ent_t * e_free;
     lv_mem_ent_t * e_next;
     e_free = ent_get_next(NULL);
@@ -289,7 +483,7 @@ void lv_mem_defrag(void)
             }
         }
 
-        if(e_free == NULL) return;
+        if(e_free == NULL) break;
 
         /*Joint the following free entries to the free*/
         e_next = ent_get_next(e_free);
@@ -303,12 +497,63 @@ void lv_mem_defrag(void)
             e_next = ent_get_next(e_next);
         }
 
-        if(e_next == NULL) return;
+        if(e_next == NULL) break;
 
         /*Continue from the lastly checked entry*/
         e_free = e_next;
     }
 #endif
+
+#if LV_MEM_CUSTOM == 0
+    /*Nothing is left for the steps*/
+    defrag_dirty = false;
+#if MEM_USE_POOL
+    defrag_pool = 0;
+#endif
+#if MEM_USE_TLSF == 0
+    defrag_ent = NULL;
+#endif
+#endif
+}
+
+/**
+ * Do a part of `lv_mem_defrag` in limited time, continuing where the previous step stopped:
+ * give back the empty slabs of the next pool or join the free entries after the next entry.
+ * Returns at once if nothing was freed since the last complete pass.
+ * @param time_ms time to spend in milliseconds. At least one pool or entry is processed.
+ * @return true: the pass is complete, false: more steps are needed
+ */
+bool lv_mem_defrag_step(uint32_t time_ms)
+{
+#if LV_MEM_CUSTOM == 0
+    if(defrag_dirty == false) return true;
+
+    uint32_t start = lv_tick_get();
+    do {
+#if MEM_USE_POOL
+        if(defrag_pool < pool_cnt) {
+            pool_flush_one(&pools[defrag_pool]);
+            defrag_pool++;
+            continue;
+        }
+#endif
+#if MEM_USE_TLSF == 0
+        /*Adjacent free blocks are always joined by TLSF*/
+        if(ent_defrag_step() == false) continue;
+#endif
+        /*The pass is complete*/
+#if MEM_USE_POOL
+        defrag_pool = 0;
+#endif
+        defrag_dirty = false;
+        return true;
+    } while(lv_tick_elaps(start) < time_ms);
+
+    return false;
+#else
+    (void)time_ms; /*Unused*/
+    return true;
+#endif
 }
 
 /**
@@ -321,12 +566,17 @@ void lv_mem_monitor(lv_mem_monitor_t * mon_p)
     /*Init the data*/
     memset(mon_p, 0, sizeof(lv_mem_monitor_t));
 #if LV_MEM_CUSTOM == 0
+#if MEM_USE_TLSF
+    lv_mem_tlsf_blk_t * e;
+    for(e = (lv_mem_tlsf_blk_t *)work_mem; e != tlsf_last; e = tlsf_next_phys(e)) {
+#else
     lv_mem_ent_t * e;
     e = NULL;
 
     e = ent_get_next(e);
 
     while(e != NULL) {
+#endif
         if(e->header.s.used == 0) {
             mon_p->free_cnt++;
             mon_p->free_size += e->header.s.d_size;
@@ -337,15 +587,49 @@ void lv_mem_monitor(lv_mem_monitor_t * mon_p)
             mon_p->used_cnt++;
         }
 
+#if MEM_USE_TLSF == 0
         e = ent_get_next(e);
+#endif
     }
+
+#if MEM_USE_POOL
+    uint8_t p;
+    for(p = 0; p < pool_cnt; p++) {
+        lv_mem_ent_t * pe;
+        for(pe = pools[p].free_ent; pe != NULL; pe = *(lv_mem_ent_t **)&pe->first_data) {
+            mon_p->pool_free_size += pools[p].size;
+        }
+    }
+#endif
+
     mon_p->total_size = LV_MEM_SIZE;
     mon_p->used_pct   = 100 - (100U * mon_p->free_size) / mon_p->total_size;
-    mon_p->frag_pct   = (uint32_t)mon_p->free_biggest_size * 100U / mon_p->free_size;
-    mon_p->frag_pct   = 100 - mon_p->frag_pct;
+
+    /*The unused entries of the pools are free memory only for their own size*/
+    uint32_t free_all = mon_p->free_size + mon_p->pool_free_size;
+    mon_p->frag_pct   = free_all ? 100 - (uint32_t)mon_p->free_biggest_size * 100U / free_all : 0;
 #endif
 }
 
+#if LV_ENABLE_GC == 0
+/**
+ * Get the most data allocated at once since `lv_mem_init` or the last `lv_mem_reset_peak`
+ * @return the high-water mark in bytes
+ */
+uint32_t lv_mem_get_peak(void)
+{
+    return peak_size;
+}
+
+/**
+ * Start a new high-water mark from the data allocated now, e.g. to measure one part of an application
+ */
+void lv_mem_reset_peak(void)
+{
+    peak_size = used_size;
+}
+#endif
+
 /**
  * Give the size of an allocated memory
  * @param data pointer to an allocated memory
@@ -378,6 +662,196 @@ uint32_t lv_mem_get_size(const void * data)
  **********************/
 
 #if LV_MEM_CUSTOM == 0
+/**
+ * Allocate from the work memory
+ * @param size size of the new memory in bytes, already rounded up to the alignment
+ * @return pointer to the allocated memory or NULL if not enough memory
+ */
+static void * builtin_alloc(uint32_t size)
+{
+#if MEM_USE_TLSF
+    return tlsf_alloc(size);
+#else
+    void * alloc     = NULL;
+    lv_mem_ent_t * e = NULL;
+
+    // Search for a appropriate entry
+    do {
+        // Get the next entry
+        e = ent_get_next(e);
+
+        /*If there is next entry then try to allocate there*/
+        if(e != NULL) {
+            alloc = ent_alloc(e, size);
+        }
+        // End if there is not next entry OR the alloc. is successful
+    } while(e != NULL && alloc == NULL);
+
+    return alloc;
+#endif
+}
+
+/**
+ * Give back an entry to the work memory
+ * @param e pointer to an entry already marked as unused
+ */
+static void builtin_free(lv_mem_ent_t * e)
+{
+#if MEM_USE_TLSF
+    /*Adjacent free blocks are always joined*/
+    tlsf_free((lv_mem_tlsf_blk_t *)((uint8_t *)e - offsetof(lv_mem_tlsf_blk_t, header)));
+#elif LV_MEM_AUTO_DEFRAG
+    /* Make a simple defrag.
+     * Join the following free entries after this*/
+    lv_mem_ent_t * e_next;
+    e_next = ent_get_next(e);
+    while(e_next != NULL) {
+        if(e_next->header.s.used == 0) {
+            e->header.s.d_size += e_next->header.s.d_size + sizeof(e->header);
+            if(e_next == defrag_ent) defrag_ent = e; /*Don't let the defrag. step continue from inside `e`*/
+        } else {
+            break;
+        }
+        e_next = ent_get_next(e_next);
+    }
+#else
+    (void)e; /*Unused*/
+#endif
+}
+#endif
+
+#if MEM_USE_POOL
+/**
+ * Get the pool of a size
+ * @param size size of the data in bytes, already rounded up to the alignment
+ * @return pointer to the pool or NULL if the size has no pool
+ */
+static lv_mem_pool_t * pool_find(uint32_t size)
+{
+    uint8_t i;
+    for(i = 0; i < pool_cnt; i++) {
+        if(pools[i].size == size) return &pools[i];
+    }
+
+    return NULL;
+}
+
+/**
+ * Allocate an entry from the pool of a size. Allocate a new slab for the pool if it's full.
+ * @param size size of the data in bytes, already rounded up to the alignment
+ * @return pointer to the data or NULL if the size has no pool or not enough memory
+ */
+static void * pool_alloc(uint32_t size)
+{
+    lv_mem_pool_t * pool = pool_find(size);
+    if(pool == NULL) return NULL;
+
+    if(pool->free_ent == NULL) {
+        lv_mem_slab_t * slab =
+            builtin_alloc(sizeof(lv_mem_slab_t) + LV_MEM_POOL_SLAB_CNT * (sizeof(lv_mem_header_t) + size));
+        if(slab == NULL) return NULL;
+
+        slab->next  = pool->slabs;
+        pool->slabs = slab;
+
+        uint32_t i;
+        for(i = 0; i < LV_MEM_POOL_SLAB_CNT; i++) {
+            lv_mem_ent_t * e   = slab_ent(slab, size, i);
+            e->header.header   = 0;
+            e->header.s.pool   = 1;
+            e->header.s.d_size = size;
+            pool_free(e);
+        }
+    }
+
+    lv_mem_ent_t * e = pool->free_ent;
+    pool->free_ent   = *(lv_mem_ent_t **)&e->first_data;
+    e->header.s.used = 1;
+
+    return &e->first_data;
+}
+
+/**
+ * Give back an entry to its pool
+ * @param e pointer to an entry of a pool
+ */
+static void pool_free(lv_mem_ent_t * e)
+{
+    lv_mem_pool_t * pool = pool_find(e->header.s.d_size);
+
+    e->header.s.used                 = 0;
+    *(lv_mem_ent_t **)&e->first_data = pool->free_ent;
+    pool->free_ent                   = e;
+}
+
+/**
+ * Give back the slabs without used entries to the work memory
+ * @return true: at least one slab was given back
+ */
+static bool pool_flush(void)
+{
+    bool flushed = false;
+    uint8_t p;
+    for(p = 0; p < pool_cnt; p++) {
+        if(pool_flush_one(&pools[p])) flushed = true;
+    }
+
+    return flushed;
+}
+
+/**
+ * Give back the slabs of a pool without used entries to the work memory
+ * @param pool pointer to a pool
+ * @return true: at least one slab was given back
+ */
+static bool pool_flush_one(lv_mem_pool_t * pool)
+{
+    bool flushed = false;
+    lv_mem_slab_t ** slab_p = &pool->slabs;
+
+    /*Collect the unused entries again, leaving out those of the freed slabs*/
+    pool->free_ent = NULL;
+    while(*slab_p) {
+        lv_mem_slab_t * slab = *slab_p;
+        uint32_t i;
+        for(i = 0; i < LV_MEM_POOL_SLAB_CNT; i++) {
+            if(slab_ent(slab, pool->size, i)->header.s.used) break;
+        }
+
+        if(i == LV_MEM_POOL_SLAB_CNT) {
+            *slab_p = slab->next;
+
+            lv_mem_ent_t * e = (lv_mem_ent_t *)((uint8_t *)slab - sizeof(lv_mem_header_t));
+            e->header.s.used = 0;
+            builtin_free(e);
+            flushed = true;
+        } else {
+            for(i = 0; i < LV_MEM_POOL_SLAB_CNT; i++) {
+                lv_mem_ent_t * e = slab_ent(slab, pool->size, i);
+                if(e->header.s.used == 0) pool_free(e);
+            }
+            slab_p = &slab->next;
+        }
+    }
+
+    return flushed;
+}
+
+/**
+ * Get an entry of a slab
+ * @param slab pointer to a slab
+ * @param size data size of the pool's entries
+ * @param i index of the entry
+ * @return pointer to the entry
+ */
+static inline lv_mem_ent_t * slab_ent(lv_mem_slab_t * slab, uint32_t size, uint32_t i)
+{
+    uint8_t * ents = (uint8_t *)slab + sizeof(lv_mem_slab_t);
+    return (lv_mem_ent_t *)&ents[i * (sizeof(lv_mem_header_t) + size)];
+}
+#endif
+
+#if LV_MEM_CUSTOM == 0 && MEM_USE_TLSF == 0
 /**
  * Give the next entry after 'act_e'
  * @param act_e pointer to an entry
@@ -453,7 +927,7 @@ static void ent_trunc(lv_mem_ent_t * e, uint32_t size)
     if(e->header.s.d_size != size) {
         uint8_t * e_data             = &e->first_data;
         lv_mem_ent_t * after_new_e   = (lv_mem_ent_t *)&e_data[size];
-        after_new_e->header.s.used   = 0;
+        after_new_e->header.header   = 0;
         after_new_e->header.s.d_size = e->header.s.d_size - size - sizeof(lv_mem_header_t);
     }
 
@@ -461,4 +935,231 @@ static void ent_trunc(lv_mem_ent_t * e, uint32_t size)
     e->header.s.d_size = size;
 }
 
+/**
+ * Join the free entries following the next entry of `lv_mem_defrag_step` to it if it's free
+ * and move on to the entry after them
+ * @return true: the last entry was reached
+ */
+static bool ent_defrag_step(void)
+{
+    lv_mem_ent_t * e = defrag_ent != NULL ? defrag_ent : ent_get_next(NULL);
+
+    if(e->header.s.used == 0) {
+        lv_mem_ent_t * e_next = ent_get_next(e);
+        while(e_next != NULL && e_next->header.s.used == 0) {
+            e->header.s.d_size += e_next->header.s.d_size + sizeof(e->header);
+            e_next = ent_get_next(e_next);
+        }
+    }
+
+    defrag_ent = ent_get_next(e);
+    return defrag_ent == NULL;
+}
+
+#endif
+
+#if MEM_USE_TLSF
+/**
+ * Allocate from the free block lists in constant time
+ * @param size size of the new memory in bytes, already rounded up to the alignment
+ * @return pointer to the allocated memory or NULL if there is no large enough free block
+ */
+static void * tlsf_alloc(uint32_t size)
+{
+    if(size < TLSF_MIN_SIZE) size = TLSF_MIN_SIZE;
+
+    /*Round up to the next list so every block in that list is large enough*/
+    uint32_t search_size = size;
+    if(search_size >= TLSF_SMALL_SIZE) search_size += (1U << (tlsf_msb(search_size) - TLSF_SL_LOG2)) - 1;
+
+    uint8_t fl;
+    uint8_t sl;
+    tlsf_mapping(search_size, &fl, &sl);
+    if(fl >= TLSF_FL_CNT) return NULL;
+
+    /*Find the first non-empty list with the same or larger blocks*/
+    uint32_t sl_map = tlsf_sl_map[fl] & (~0U << sl);
+    if(sl_map == 0) {
+        uint32_t fl_map = fl + 1 < 32 ? tlsf_fl_map & (~0U << (fl + 1)) : 0;
+        if(fl_map == 0) return NULL;
+
+        fl     = tlsf_lsb(fl_map);
+        sl_map = tlsf_sl_map[fl];
+    }
+    sl = tlsf_lsb(sl_map);
+
+    lv_mem_tlsf_blk_t * b = tlsf_lists[fl][sl];
+    tlsf_remove(b);
+    b->header.s.used                      = 1;
+    tlsf_next_phys(b)->header.s.prev_free = 0;
+
+    /*Give back the remainder if it's large enough for a block*/
+    tlsf_trunc(b, size);
+
+    return tlsf_data(b);
+}
+
+/**
+ * Free a block and join it with the adjacent free blocks
+ * @param b pointer to a block
+ */
+static void tlsf_free(lv_mem_tlsf_blk_t * b)
+{
+    b->header.s.used = 0;
+
+    if(b->header.s.prev_free) {
+        lv_mem_tlsf_blk_t * prev = b->prev_phys;
+        tlsf_remove(prev);
+        prev->header.s.d_size += b->header.s.d_size + sizeof(lv_mem_header_t);
+        b = prev;
+    }
+
+    lv_mem_tlsf_blk_t * next = tlsf_next_phys(b);
+    if(next->header.s.used == 0) {
+        tlsf_remove(next);
+        b->header.s.d_size += next->header.s.d_size + sizeof(lv_mem_header_t);
+        next = tlsf_next_phys(b);
+    }
+
+    next->prev_phys          = b;
+    next->header.s.prev_free = 1;
+
+    tlsf_insert(b);
+}
+
+/**
+ * Truncate a used block to the given size and free the rest if it's large enough for a block
+ * @param b pointer to a used block
+ * @param size new size in bytes
+ */
+static void tlsf_trunc(lv_mem_tlsf_blk_t * b, uint32_t size)
+{
+    /*Round the size up to the alignment*/
+    size = (size + (1U << TLSF_ALIGN_LOG2) - 1) & ~((1U << TLSF_ALIGN_LOG2) - 1);
+    if(size < TLSF_MIN_SIZE) size = TLSF_MIN_SIZE;
+
+    if(b->header.s.d_size < size + sizeof(lv_mem_header_t) + TLSF_MIN_SIZE) return;
+
+    /*The remainder's `prev_phys` overlaps the end of the truncated data*/
+    lv_mem_tlsf_blk_t * rest  = (lv_mem_tlsf_blk_t *)(tlsf_data(b) + size - sizeof(lv_mem_tlsf_blk_t *));
+    rest->header.header      = 0;
+    rest->header.s.used      = 1;
+    rest->header.s.d_size    = b->header.s.d_size - size - sizeof(lv_mem_header_t);
+    b->header.s.d_size       = size;
+
+    tlsf_free(rest);
+}
+
+/**
+ * Put a free block to the head of the list of its size
+ * @param b pointer to a free block
+ */
+static void tlsf_insert(lv_mem_tlsf_blk_t * b)
+{
+    uint8_t fl;
+    uint8_t sl;
+    tlsf_mapping(b->header.s.d_size, &fl, &sl);
+
+    lv_mem_tlsf_blk_t * head = tlsf_lists[fl][sl];
+    tlsf_links(b)[0]         = head;
+    tlsf_links(b)[1]         = NULL;
+    if(head) tlsf_links(head)[1] = b;
+
+    tlsf_lists[fl][sl] = b;
+    tlsf_sl_map[fl] |= 1U << sl;
+    tlsf_fl_map |= 1U << fl;
+}
+
+/**
+ * Remove a free block from the list of its size
+ * @param b pointer to a free block
+ */
+static void tlsf_remove(lv_mem_tlsf_blk_t * b)
+{
+    uint8_t fl;
+    uint8_t sl;
+    tlsf_mapping(b->header.s.d_size, &fl, &sl);
+
+    lv_mem_tlsf_blk_t * next = tlsf_links(b)[0];
+    lv_mem_tlsf_blk_t * prev = tlsf_links(b)[1];
+    if(next) tlsf_links(next)[1] = prev;
+    if(prev) {
+        tlsf_links(prev)[0] = next;
+    } else {
+        tlsf_lists[fl][sl] = next;
+        if(next == NULL) {
+            tlsf_sl_map[fl] &= ~(1U << sl);
+            if(tlsf_sl_map[fl] == 0) tlsf_fl_map &= ~(1U << fl);
+        }
+    }
+}
+
+/**
+ * Get the free list of a block size
+ * @param size size of a block's data in bytes
+ * @param fl store the first level index here
+ * @param sl store the second level index here
+ */
+static void tlsf_mapping(uint32_t size, uint8_t * fl, uint8_t * sl)
+{
+    if(size < TLSF_SMALL_SIZE) {
+        *fl = 0;
+        *sl = size >> TLSF_ALIGN_LOG2;
+    } else {
+        uint8_t msb = tlsf_msb(size);
+        *sl         = (size >> (msb - TLSF_SL_LOG2)) - TLSF_SL_CNT;
+        *fl         = msb - TLSF_FL_SHIFT + 1;
+    }
+}
+
+/**
+ * Get the index of the most significant set bit
+ * @param x a non-zero value
+ * @return index of the bit
+ */
+static uint8_t tlsf_msb(uint32_t x)
+{
+#if defined(__GNUC__)
+    return 31 - __builtin_clz(x);
+#else
+    uint8_t i = 0;
+    while(x >>= 1) i++;
+    return i;
+#endif
+}
+
+/**
+ * Get the index of the least significant set bit
+ * @param x a non-zero value
+ * @return index of the bit
+ */
+static uint8_t tlsf_lsb(uint32_t x)
+{
+#if defined(__GNUC__)
+    return __builtin_ctz(x);
+#else
+    uint8_t i = 0;
+    while((x & 1) == 0) {
+        x >>= 1;
+        i++;
+    }
+    return i;
+#endif
+}
+
+static inline uint8_t * tlsf_data(lv_mem_tlsf_blk_t * b)
+{
+    return (uint8_t *)&b->header + sizeof(lv_mem_header_t);
+}
+
+static inline lv_mem_tlsf_blk_t * tlsf_next_phys(lv_mem_tlsf_blk_t * b)
+{
+    return (lv_mem_tlsf_blk_t *)(tlsf_data(b) + b->header.s.d_size - sizeof(lv_mem_tlsf_blk_t *));
+}
+
+/*Next and previous free block of a free block*/
+static inline lv_mem_tlsf_blk_t ** tlsf_links(lv_mem_tlsf_blk_t * b)
+{
+    return (lv_mem_tlsf_blk_t **)tlsf_data(b);
+}
 #endif
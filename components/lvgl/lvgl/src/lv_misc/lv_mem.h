@@ -21,6 +21,7 @@ extern "C" {
 
 #include <stdint.h>
 #include <stddef.h>
+#include <stdbool.h>
 #include "lv_log.h"
 
 /*********************
@@ -52,6 +53,7 @@ typedef struct
     uint32_t free_size; /**< Size of available memory */
     uint32_t free_biggest_size;
     uint32_t used_cnt;
+    uint32_t pool_free_size; /**< Size of the unused entries kept by the pools */
     uint8_t used_pct; /**< Percentage used */
     uint8_t frag_pct; /**< Amount of fragmentation */
 } lv_mem_monitor_t;
@@ -87,11 +89,29 @@ void lv_mem_free(const void * data);
  */
 void * lv_mem_realloc(void * data_p, uint32_t new_size);
 
+/**
+ * Allocate the blocks of a size from a pool. They are kept in slabs of
+ * `LV_MEM_POOL_SLAB_CNT` blocks so objects of the same size created and deleted
+ * often don't fragment the rest of the memory.
+ * Nothing happens if the size already has a pool or there are `LV_MEM_POOL_CNT` pools.
+ * @param size size of the blocks in bytes
+ */
+void lv_mem_pool_add(uint32_t size);
+
 /**
  * Join the adjacent free memory blocks
  */
 void lv_mem_defrag(void);
 
+/**
+ * Do a part of `lv_mem_defrag` in limited time, continuing where the previous step stopped:
+ * give back the empty slabs of the next pool or join the free entries after the next entry.
+ * Returns at once if nothing was freed since the last complete pass.
+ * @param time_ms time to spend in milliseconds. At least one pool or entry is processed.
+ * @return true: the pass is complete, false: more steps are needed
+ */
+bool lv_mem_defrag_step(uint32_t time_ms);
+
 /**
  * Give information about the work memory of dynamic allocation
  * @param mon_p pointer to a dm_mon_p variable,
@@ -99,6 +119,19 @@ void lv_mem_defrag(void);
  */
 void lv_mem_monitor(lv_mem_monitor_t * mon_p);
 
+#if LV_ENABLE_GC == 0
+/**
+ * Get the most data allocated at once since `lv_mem_init` or the last `lv_mem_reset_peak`
+ * @return the high-water mark in bytes
+ */
+uint32_t lv_mem_get_peak(void);
+
+/**
+ * Start a new high-water mark from the data allocated now, e.g. to measure one part of an application
+ */
+void lv_mem_reset_peak(void);
+#endif
+
 /**
  * Give the size of an allocated memory
  * @param data pointer to an allocated memory
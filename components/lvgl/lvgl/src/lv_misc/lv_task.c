@@ -9,13 +9,19 @@
  *********************/
 #include <stddef.h>
 #include "lv_task.h"
+#include "lv_math.h"
 #include "../lv_hal/lv_hal_tick.h"
 #include "lv_gc.h"
+#include "../lv_core/lv_cmd.h"
 
 #if defined(LV_GC_INCLUDE)
 #include LV_GC_INCLUDE
 #endif /* LV_ENABLE_GC */
 
+#if LV_USE_TASK_PROF
+#include LV_TASK_PROF_INCLUDE
+#endif
+
 /*********************
  *      DEFINES
  *********************/
@@ -31,6 +37,10 @@
  *  STATIC PROTOTYPES
  **********************/
 static bool lv_task_exec(lv_task_t * task);
+static uint32_t lv_task_time_remaining(lv_task_t * task);
+#if LV_USE_TASK_PROF
+static uint16_t lv_task_prof_insert(lv_task_prof_t * buf, uint16_t cnt, uint16_t max, lv_task_t * task);
+#endif
 
 /**********************
  *  STATIC VARIABLES
@@ -40,6 +50,17 @@ static uint8_t idle_last = 0;
 static bool task_deleted;
 static bool task_created;
 
+/*Tick when the first task is due. Invalid if the tasks changed since it was calculated.*/
+static uint32_t next_run;
+static bool next_run_valid;
+
+#if LV_USE_TASK_PROF
+/*Time since the reset, until `prof_last`, and the part of it spent in the handler*/
+static uint64_t prof_elapsed;
+static uint64_t prof_busy;
+static uint32_t prof_last;
+#endif
+
 /**********************
  *      MACROS
  **********************/
@@ -53,7 +74,12 @@ static bool task_created;
  */
 void lv_task_core_init(void)
 {
-    lv_ll_init(&LV_GC_ROOT(_lv_task_ll), sizeof(lv_task_t));
+    /*Tasks are created and deleted often, e.g. by the widgets' animations and timers*/
+    lv_ll_init_pool(&LV_GC_ROOT(_lv_task_ll), sizeof(lv_task_t));
+
+#if LV_USE_TASK_PROF
+    prof_last = LV_TASK_PROF_TIME_EXPR;
+#endif
 
     /*Initially enable the lv_task handling*/
     lv_task_enable(true);
@@ -61,14 +87,16 @@ void lv_task_core_init(void)
 
 /**
  * Call it  periodically to handle lv_tasks.
+ * @return time until the next task is due in milliseconds (0: call it again right away)
+ *         or `LV_NO_TASK_READY` if there are no enabled tasks
  */
-LV_ATTRIBUTE_TASK_HANDLER void lv_task_handler(void)
+LV_ATTRIBUTE_TASK_HANDLER uint32_t lv_task_handler(void)
 {
     LV_LOG_TRACE("lv_task_handler started");
 
     /*Avoid concurrent running of the task handler*/
     static bool task_handler_mutex = false;
-    if(task_handler_mutex) return;
+    if(task_handler_mutex) return LV_NO_TASK_READY;
     task_handler_mutex = true;
 
     static uint32_t idle_period_start = 0;
@@ -77,11 +105,32 @@ LV_ATTRIBUTE_TASK_HANDLER void lv_task_handler(void)
 
     if(lv_task_run == false) {
         task_handler_mutex = false; /*Release mutex*/
-        return;
+        return LV_NO_TASK_READY;
     }
 
+#if LV_USE_TASK_PROF
+    uint32_t prof_start = LV_TASK_PROF_TIME_EXPR;
+    prof_elapsed += (uint32_t)(prof_start - prof_last);
+    prof_last = prof_start;
+#endif
+
+#if LV_USE_CMD_QUEUE
+    /*Apply what other tasks queued before the tasks run*/
+    lv_cmd_run();
+#endif
+
     handler_start = lv_tick_get();
 
+    /*Don't walk the tasks if none of them is due yet*/
+    int32_t time_till_next = next_run_valid ? (int32_t)(next_run - handler_start) : 0;
+    if(time_till_next > 0) {
+#if LV_USE_TASK_PROF
+        prof_busy += (uint32_t)(LV_TASK_PROF_TIME_EXPR - prof_start);
+#endif
+        task_handler_mutex = false; /*Release the mutex*/
+        return time_till_next;
+    }
+
     /* Run all task from the highest to the lowest priority
      * If a lower priority task is executed check task again from the highest priority
      * but on the priority of executed tasks don't run tasks before the executed*/
@@ -153,9 +202,38 @@ LV_ATTRIBUTE_TASK_HANDLER void lv_task_handler(void)
         idle_period_start = lv_tick_get();
     }
 
+    /*Find when the first task will be due*/
+    uint32_t min_time = LV_NO_TASK_READY;
+    lv_task_t * task;
+    LV_LL_READ(LV_GC_ROOT(_lv_task_ll), task)
+    {
+        if(task->prio == LV_TASK_PRIO_OFF) break; /*The disabled tasks are the last ones*/
+
+        uint32_t time = lv_task_time_remaining(task);
+        if(time < min_time) min_time = time;
+    }
+
+#if LV_MEM_CUSTOM == 0 && LV_MEM_IDLE_DEFRAG_TIME
+    /*Spend some of the time until then on defragmenting the memory*/
+    if(min_time > LV_MEM_IDLE_DEFRAG_TIME) {
+        uint32_t defrag_start = lv_tick_get();
+        lv_mem_defrag_step(LV_MEM_IDLE_DEFRAG_TIME);
+        if(min_time != LV_NO_TASK_READY) min_time -= LV_MATH_MIN(lv_tick_elaps(defrag_start), min_time);
+    }
+#endif
+
+    next_run       = lv_tick_get() + min_time;
+    next_run_valid = min_time != LV_NO_TASK_READY;
+
+#if LV_USE_TASK_PROF
+    prof_busy += (uint32_t)(LV_TASK_PROF_TIME_EXPR - prof_start);
+#endif
+
     task_handler_mutex = false; /*Release the mutex*/
 
     LV_LOG_TRACE("lv_task_handler ready");
+
+    return min_time;
 }
 /**
  * Create an "empty" task. It needs to initialzed with at least
@@ -205,7 +283,14 @@ lv_task_t * lv_task_create_basic(void)
 
     new_task->user_data = NULL;
 
-    task_created = true;
+#if LV_USE_TASK_PROF
+    new_task->prof_time  = 0;
+    new_task->prof_max   = 0;
+    new_task->prof_calls = 0;
+#endif
+
+    task_created   = true;
+    next_run_valid = false;
 
     return new_task;
 }
@@ -255,6 +340,7 @@ void lv_task_del(lv_task_t * task)
     lv_mem_free(task);
 
     if(LV_GC_ROOT(_lv_task_act) == task) task_deleted = true; /*The active task was deleted*/
+    next_run_valid = false;
 }
 
 /**
@@ -266,6 +352,8 @@ void lv_task_set_prio(lv_task_t * task, lv_task_prio_t prio)
 {
     if(task->prio == prio) return;
 
+    next_run_valid = false;
+
     /*Find the tasks with new priority*/
     lv_task_t * i;
     LV_LL_READ(LV_GC_ROOT(_lv_task_ll), i)
@@ -291,7 +379,8 @@ void lv_task_set_prio(lv_task_t * task, lv_task_prio_t prio)
  */
 void lv_task_set_period(lv_task_t * task, uint32_t period)
 {
-    task->period = period;
+    task->period   = period;
+    next_run_valid = false;
 }
 
 /**
@@ -301,6 +390,7 @@ void lv_task_set_period(lv_task_t * task, uint32_t period)
 void lv_task_ready(lv_task_t * task)
 {
     task->last_run = lv_tick_get() - task->period - 1;
+    next_run_valid = false;
 }
 
 /**
@@ -320,6 +410,7 @@ void lv_task_once(lv_task_t * task)
 void lv_task_reset(lv_task_t * task)
 {
     task->last_run = lv_tick_get();
+    next_run_valid = false;
 }
 
 /**
@@ -328,7 +419,8 @@ void lv_task_reset(lv_task_t * task)
  */
 void lv_task_enable(bool en)
 {
-    lv_task_run = en;
+    lv_task_run    = en;
+    next_run_valid = false;
 }
 
 /**
@@ -340,6 +432,60 @@ uint8_t lv_task_get_idle(void)
     return idle_last;
 }
 
+#if LV_USE_TASK_PROF
+/**
+ * Get the tasks which ran longest since the last reset
+ * @param buf the tasks are stored here, longest first
+ * @param max size of `buf`
+ * @return number of tasks stored
+ */
+uint16_t lv_task_prof_get(lv_task_prof_t * buf, uint16_t max)
+{
+    uint16_t cnt = 0;
+    lv_task_t * task;
+
+    LV_LL_READ(LV_GC_ROOT(_lv_task_ll), task)
+    {
+        if(task->prof_calls > 0) cnt = lv_task_prof_insert(buf, cnt, max, task);
+    }
+
+    return cnt;
+}
+
+/**
+ * Get how long `lv_task_handler` was watched and ran since the last reset, in
+ * `LV_TASK_PROF_TIME_EXPR` units. The time it ran but not in the tasks' callbacks went on
+ * the queued commands, walking the tasks, defragmenting and tasks deleted since. Only
+ * correct if it's called more often than the counter wraps.
+ * @param elapsed store the time since the reset here
+ * @param busy store the time spent in `lv_task_handler` here
+ */
+void lv_task_prof_get_handler(uint64_t * elapsed, uint64_t * busy)
+{
+    *elapsed = prof_elapsed + (uint32_t)(LV_TASK_PROF_TIME_EXPR - prof_last);
+    *busy    = prof_busy;
+}
+
+/**
+ * Clear the run times of all tasks and of the handler
+ */
+void lv_task_prof_reset(void)
+{
+    lv_task_t * task;
+
+    LV_LL_READ(LV_GC_ROOT(_lv_task_ll), task)
+    {
+        task->prof_time  = 0;
+        task->prof_max   = 0;
+        task->prof_calls = 0;
+    }
+
+    prof_elapsed = 0;
+    prof_busy    = 0;
+    prof_last    = LV_TASK_PROF_TIME_EXPR;
+}
+#endif
+
 /**********************
  *   STATIC FUNCTIONS
  **********************/
@@ -359,7 +505,18 @@ static bool lv_task_exec(lv_task_t * task)
         task->last_run = lv_tick_get();
         task_deleted   = false;
         task_created   = false;
+#if LV_USE_TASK_PROF
+        uint32_t prof_start = LV_TASK_PROF_TIME_EXPR;
+#endif
         if(task->task_cb) task->task_cb(task);
+#if LV_USE_TASK_PROF
+        if(task_deleted == false) {
+            uint32_t t = LV_TASK_PROF_TIME_EXPR - prof_start;
+            task->prof_time += t;
+            if(t > task->prof_max) task->prof_max = t;
+            task->prof_calls++;
+        }
+#endif
 
         /*Delete if it was a one shot lv_task*/
         if(task_deleted == false) { /*The task might be deleted by itself as well*/
@@ -372,3 +529,51 @@ static bool lv_task_exec(lv_task_t * task)
 
     return exec;
 }
+
+/**
+ * Get the time until a task is due
+ * @param task pointer to lv_task
+ * @return the time in milliseconds, 0 if it's already due
+ */
+static uint32_t lv_task_time_remaining(lv_task_t * task)
+{
+    uint32_t elp = lv_tick_elaps(task->last_run);
+    if(elp >= task->period) return 0;
+
+    return task->period - elp;
+}
+
+#if LV_USE_TASK_PROF
+/**
+ * Add a task to a list of the longest running ones
+ * @param buf list, longest first
+ * @param cnt number of entries in `buf`
+ * @param max size of `buf`
+ * @param task the task to add, if it ran longer than the last one of a full list
+ * @return new number of entries
+ */
+static uint16_t lv_task_prof_insert(lv_task_prof_t * buf, uint16_t cnt, uint16_t max, lv_task_t * task)
+{
+    uint16_t i = cnt;
+
+    if(cnt == max) {
+        if(max == 0 || buf[max - 1].time >= task->prof_time) return cnt;
+        i--;
+    } else {
+        cnt++;
+    }
+
+    while(i > 0 && buf[i - 1].time < task->prof_time) {
+        buf[i] = buf[i - 1];
+        i--;
+    }
+    buf[i].task    = task;
+    buf[i].task_cb = task->task_cb;
+    buf[i].time    = task->prof_time;
+    buf[i].max     = task->prof_max;
+    buf[i].calls   = task->prof_calls;
+    buf[i].prio    = task->prio;
+
+    return cnt;
+}
+#endif
@@ -31,6 +31,9 @@ extern "C" {
 #ifndef LV_ATTRIBUTE_TASK_HANDLER
 #define LV_ATTRIBUTE_TASK_HANDLER
 #endif
+
+/*Returned by `lv_task_handler` if no task waits to run*/
+#define LV_NO_TASK_READY 0xFFFFFFFF
 /**********************
  *      TYPEDEFS
  **********************/
@@ -69,8 +72,27 @@ typedef struct _lv_task_t
 
     uint8_t prio : 3; /**< Task priority */
     uint8_t once : 1; /**< 1: one shot task */
+
+#if LV_USE_TASK_PROF
+    uint64_t prof_time;  /**< `LV_TASK_PROF_TIME_EXPR` units spent in `task_cb`*/
+    uint32_t prof_max;   /**< Longest single call*/
+    uint32_t prof_calls; /**< Times `task_cb` was called*/
+#endif
 } lv_task_t;
 
+#if LV_USE_TASK_PROF
+/** Run time of a task since the last reset, in `LV_TASK_PROF_TIME_EXPR` units*/
+typedef struct
+{
+    lv_task_t * task;     /**< The task*/
+    lv_task_cb_t task_cb; /**< Its callback, to tell the tasks apart*/
+    uint64_t time;        /**< Spent in the callback*/
+    uint32_t max;         /**< Longest single call*/
+    uint32_t calls;       /**< Times called*/
+    lv_task_prio_t prio;  /**< Its priority*/
+} lv_task_prof_t;
+#endif
+
 /**********************
  * GLOBAL PROTOTYPES
  **********************/
@@ -84,8 +106,10 @@ void lv_task_core_init(void);
 
 /**
  * Call it  periodically to handle lv_tasks.
+ * @return time until the next task is due in milliseconds (0: call it again right away)
+ *         or `LV_NO_TASK_READY` if there are no enabled tasks
  */
-LV_ATTRIBUTE_TASK_HANDLER void lv_task_handler(void);
+LV_ATTRIBUTE_TASK_HANDLER uint32_t lv_task_handler(void);
 
 //! @endcond
 
@@ -166,6 +190,31 @@ void lv_task_enable(bool en);
  */
 uint8_t lv_task_get_idle(void);
 
+#if LV_USE_TASK_PROF
+/**
+ * Get the tasks which ran longest since the last reset
+ * @param buf the tasks are stored here, longest first
+ * @param max size of `buf`
+ * @return number of tasks stored
+ */
+uint16_t lv_task_prof_get(lv_task_prof_t * buf, uint16_t max);
+
+/**
+ * Get how long `lv_task_handler` was watched and ran since the last reset, in
+ * `LV_TASK_PROF_TIME_EXPR` units. The time it ran but not in the tasks' callbacks went on
+ * the queued commands, walking the tasks, defragmenting and tasks deleted since. Only
+ * correct if it's called more often than the counter wraps.
+ * @param elapsed store the time since the reset here
+ * @param busy store the time spent in `lv_task_handler` here
+ */
+void lv_task_prof_get_handler(uint64_t * elapsed, uint64_t * busy);
+
+/**
+ * Clear the run times of all tasks and of the handler
+ */
+void lv_task_prof_reset(void);
+#endif
+
 /**********************
  *      MACROS
  **********************/
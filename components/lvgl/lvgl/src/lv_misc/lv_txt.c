@@ -156,12 +156,12 @@ uint16_t lv_txt_get_next_line(const char * txt, const lv_font_t * font, lv_coord
     uint32_t letter      = 0;
     uint32_t letter_next = 0;
 
-    letter_next = lv_txt_encoded_next(txt, &i_next);
+    letter_next = lv_txt_next(txt, &i_next, flag);
 
     while(txt[i] != '\0') {
         letter      = letter_next;
         i           = i_next;
-        letter_next = lv_txt_encoded_next(txt, &i_next);
+        letter_next = lv_txt_next(txt, &i_next, flag);
 
         /*Handle the recolor command*/
         if((flag & LV_TXT_FLAG_RECOLOR) != 0) {
@@ -189,12 +189,12 @@ uint16_t lv_txt_get_next_line(const char * txt, const lv_font_t * font, lv_coord
                 } else {
                     /* Now this character is out of the area so it will be first character of the next line*/
                     /* But 'i' already points to the next character (because of lv_txt_utf8_next) step beck one*/
-                    lv_txt_encoded_prev(txt, &i);
+                    lv_txt_prev(txt, &i, flag);
                 }
 
                 /* Do not let to return without doing nothing.
                  * Find at least one character (Avoid infinite loop )*/
-                if(i == 0) lv_txt_encoded_next(txt, &i);
+                if(i == 0) lv_txt_next(txt, &i, flag);
 
                 return i;
             }
@@ -237,8 +237,8 @@ lv_coord_t lv_txt_get_width(const char * txt, uint16_t length, const lv_font_t *
 
     if(length != 0) {
         while(i < length) {
-            letter      = lv_txt_encoded_next(txt, &i);
-            letter_next = lv_txt_encoded_next(&txt[i], NULL);
+            letter      = lv_txt_next(txt, &i, flag);
+            letter_next = lv_txt_next(&txt[i], NULL, flag);
             if((flag & LV_TXT_FLAG_RECOLOR) != 0) {
                 if(lv_txt_is_cmd(&cmd_state, letter) != false) {
                     continue;
@@ -346,6 +346,21 @@ void lv_txt_cut(char * txt, uint32_t pos, uint32_t len)
     }
 }
 
+/**
+ * Check if a text has only 7 bit (ASCII) characters, so it can be given `LV_TXT_FLAG_ASCII`
+ * @param txt a '\0' terminated string
+ * @return true: every byte is below 0x80
+ */
+bool lv_txt_is_ascii(const char * txt)
+{
+    while(*txt != '\0') {
+        if(*txt & 0x80) return false;
+        txt++;
+    }
+
+    return true;
+}
+
 #if LV_TXT_ENC == LV_TXT_ENC_UTF8
 /*******************************
  *   UTF-8 ENCODER/DECOER
@@ -44,6 +44,7 @@ enum {
     LV_TXT_FLAG_EXPAND  = 0x02, /**< Ignore width to avoid automatic word wrapping*/
     LV_TXT_FLAG_CENTER  = 0x04, /**< Align the text to the middle*/
     LV_TXT_FLAG_RIGHT   = 0x08, /**< Align the text to the right*/
+    LV_TXT_FLAG_ASCII   = 0x10, /**< The text has only 7 bit characters so step it byte by byte*/
 };
 typedef uint8_t lv_txt_flag_t;
 
@@ -128,6 +129,13 @@ void lv_txt_ins(char * txt_buf, uint32_t pos, const char * ins_txt);
  */
 void lv_txt_cut(char * txt, uint32_t pos, uint32_t len);
 
+/**
+ * Check if a text has only 7 bit (ASCII) characters, so it can be given `LV_TXT_FLAG_ASCII`
+ * @param txt a '\0' terminated string
+ * @return true: every byte is below 0x80
+ */
+bool lv_txt_is_ascii(const char * txt);
+
 /***************************************************************
  *  GLOBAL FUNCTION POINTERS FOR CAHRACTER ENCODING INTERFACE
  ***************************************************************/
@@ -198,6 +206,39 @@ extern uint32_t (*lv_encoded_get_char_id)(const char *, uint32_t);
  */
 extern uint32_t (*lv_txt_get_encoded_length)(const char *);
 
+/**
+ * Decode the next character of a text drawn or measured with `flag`. A text flagged
+ * `LV_TXT_FLAG_ASCII` is stepped a byte at a time without calling the decoder.
+ * @param txt pointer to '\0' terminated string
+ * @param i start index in 'txt', moved to the next character. NULL to use txt[0].
+ * @param flag the text's flags from 'txt_flag_t' enum
+ * @return the decoded Unicode character
+ */
+static inline uint32_t lv_txt_next(const char * txt, uint32_t * i, lv_txt_flag_t flag)
+{
+    if(flag & LV_TXT_FLAG_ASCII) {
+        if(i == NULL) return (uint8_t)txt[0];
+        return (uint8_t)txt[(*i)++];
+    }
+    return lv_txt_encoded_next(txt, i);
+}
+
+/**
+ * Step back to the previous character of a text drawn or measured with `flag`
+ * @param txt pointer to '\0' terminated string
+ * @param i index in 'txt', moved to the previous character
+ * @param flag the text's flags from 'txt_flag_t' enum
+ * @return the decoded Unicode character
+ */
+static inline uint32_t lv_txt_prev(const char * txt, uint32_t * i, lv_txt_flag_t flag)
+{
+    if(flag & LV_TXT_FLAG_ASCII) {
+        if(*i == 0) return 0;
+        return (uint8_t)txt[--(*i)];
+    }
+    return lv_txt_encoded_prev(txt, i);
+}
+
 /**********************
  *      MACROS
  **********************/
@@ -26,6 +26,8 @@
  *  STATIC PROTOTYPES
  **********************/
 static lv_res_t lv_canvas_signal(lv_obj_t * canvas, lv_signal_t sign, void * param);
+static void lv_canvas_invalidate_area(lv_obj_t * canvas, lv_coord_t x1, lv_coord_t y1, lv_coord_t x2, lv_coord_t y2);
+static void lv_canvas_get_points_area(const lv_point_t * points, uint32_t point_cnt, lv_area_t * area);
 
 /**********************
  *  STATIC VARIABLES
@@ -134,7 +136,7 @@ void lv_canvas_set_px(lv_obj_t * canvas, lv_coord_t x, lv_coord_t y, lv_color_t
     lv_canvas_ext_t * ext = lv_obj_get_ext_attr(canvas);
 
     lv_img_buf_set_px_color(&ext->dsc, x, y, c);
-    lv_obj_invalidate(canvas);
+    lv_canvas_invalidate_area(canvas, x, y, x, y);
 }
 
 /**
@@ -249,6 +251,8 @@ void lv_canvas_copy_buf(lv_obj_t * canvas, const void * to_copy, lv_coord_t x, l
         px += ext->dsc.header.w * px_size;
         to_copy8 += w * px_size;
     }
+
+    lv_canvas_invalidate_area(canvas, x, y, x + w - 1, y + h - 1);
 }
 
 /**
@@ -421,7 +425,30 @@ void lv_canvas_rotate(lv_obj_t * canvas, lv_img_dsc_t * img, int16_t angle, lv_c
         }
     }
 
-    lv_obj_invalidate(canvas);
+    /*Only the source image rotated around the pivot could be written (+1 px for the mixed neighbours)*/
+    int32_t sina = lv_trigo_sin(angle);
+    int32_t cosa = lv_trigo_sin(angle + 90);
+    int32_t x_min = INT32_MAX;
+    int32_t y_min = INT32_MAX;
+    int32_t x_max = INT32_MIN;
+    int32_t y_max = INT32_MIN;
+    uint8_t i;
+    for(i = 0; i < 4; i++) {
+        int32_t xt = (i & 1 ? img_width : 0) - pivot_x;
+        int32_t yt = (i & 2 ? img_height : 0) - pivot_y;
+        x = ((cosa * xt - sina * yt) >> LV_TRIGO_SHIFT) + pivot_x + offset_x;
+        y = ((sina * xt + cosa * yt) >> LV_TRIGO_SHIFT) + pivot_y + offset_y;
+        x_min = LV_MATH_MIN(x_min, x);
+        y_min = LV_MATH_MIN(y_min, y);
+        x_max = LV_MATH_MAX(x_max, x);
+        y_max = LV_MATH_MAX(y_max, y);
+    }
+
+    x_min = LV_MATH_MAX(x_min - 2, 0);
+    y_min = LV_MATH_MAX(y_min - 2, 0);
+    x_max = LV_MATH_MIN(x_max + 2, dest_width - 1);
+    y_max = LV_MATH_MIN(y_max + 2, dest_height - 1);
+    if(x_min <= x_max && y_min <= y_max) lv_canvas_invalidate_area(canvas, x_min, y_min, x_max, y_max);
 }
 
 /**
@@ -440,6 +467,8 @@ void lv_canvas_fill_bg(lv_obj_t * canvas, lv_color_t color)
             lv_img_buf_set_px_color(dsc, x, y, color);
         }
     }
+
+    lv_obj_invalidate(canvas);
 }
 
 /**
@@ -489,6 +518,10 @@ void lv_canvas_draw_rect(lv_obj_t * canvas, lv_coord_t x, lv_coord_t y, lv_coord
     lv_draw_rect(&coords, &mask, style, LV_OPA_COVER);
 
     lv_refr_set_disp_refreshing(refr_ori);
+
+    /*The anti-aliased edges of rounded corners can be 1 px out of `coords`*/
+    lv_coord_t ext = style->body.shadow.width + 1;
+    lv_canvas_invalidate_area(canvas, coords.x1 - ext, coords.y1 - ext, coords.x2 + ext, coords.y2 + ext);
 }
 
 /**
@@ -548,6 +581,11 @@ void lv_canvas_draw_text(lv_obj_t * canvas, lv_coord_t x, lv_coord_t y, lv_coord
                   NULL);
 
     lv_refr_set_disp_refreshing(refr_ori);
+
+    /*The lines are aligned in `max_w` so only the height is measured*/
+    lv_point_t size;
+    lv_txt_get_size(&size, txt, style->text.font, style->text.letter_space, style->text.line_space, max_w, flag);
+    lv_canvas_invalidate_area(canvas, coords.x1, coords.y1, coords.x2, coords.y1 + size.y - 1);
 }
 
 /**
@@ -600,6 +638,8 @@ void lv_canvas_draw_img(lv_obj_t * canvas, lv_coord_t x, lv_coord_t y, const voi
     lv_draw_img(&coords, &mask, src, style, LV_OPA_COVER);
 
     lv_refr_set_disp_refreshing(refr_ori);
+
+    lv_canvas_invalidate_area(canvas, coords.x1, coords.y1, coords.x2, coords.y2);
 }
 
 /**
@@ -643,6 +683,11 @@ void lv_canvas_draw_line(lv_obj_t * canvas, const lv_point_t * points, uint32_t
     }
 
     lv_refr_set_disp_refreshing(refr_ori);
+
+    lv_area_t a;
+    lv_canvas_get_points_area(points, point_cnt, &a);
+    lv_coord_t w = style->line.width;
+    lv_canvas_invalidate_area(canvas, a.x1 - w, a.y1 - w, a.x2 + w, a.y2 + w);
 }
 
 /**
@@ -683,6 +728,10 @@ void lv_canvas_draw_polygon(lv_obj_t * canvas, const lv_point_t * points, uint32
     lv_draw_polygon(points, point_cnt, &mask, style, LV_OPA_COVER);
 
     lv_refr_set_disp_refreshing(refr_ori);
+
+    lv_area_t a;
+    lv_canvas_get_points_area(points, point_cnt, &a);
+    lv_canvas_invalidate_area(canvas, a.x1, a.y1, a.x2, a.y2);
 }
 
 /**
@@ -727,6 +776,8 @@ void lv_canvas_draw_arc(lv_obj_t * canvas, lv_coord_t x, lv_coord_t y, lv_coord_
     lv_draw_arc(x, y, r, &mask, start_angle, end_angle, style, LV_OPA_COVER);
 
     lv_refr_set_disp_refreshing(refr_ori);
+
+    lv_canvas_invalidate_area(canvas, x - r, y - r, x + r, y + r);
 }
 
 /**********************
@@ -762,4 +813,56 @@ static lv_res_t lv_canvas_signal(lv_obj_t * canvas, lv_signal_t sign, void * par
     return res;
 }
 
+/**
+ * Redraw only the part of the canvas a drawing changed. The display's invalidated areas
+ * join the many small parts of a frame.
+ * @param canvas pointer to a canvas object
+ * @param x1 left coordinate of the changed part on the canvas's buffer
+ * @param y1 top coordinate of the changed part on the canvas's buffer
+ * @param x2 right coordinate of the changed part on the canvas's buffer
+ * @param y2 bottom coordinate of the changed part on the canvas's buffer
+ */
+static void lv_canvas_invalidate_area(lv_obj_t * canvas, lv_coord_t x1, lv_coord_t y1, lv_coord_t x2, lv_coord_t y2)
+{
+    lv_canvas_ext_t * ext = lv_obj_get_ext_attr(canvas);
+
+    /*An offset or a tiled buffer shows a pixel elsewhere or several times*/
+    if(ext->img.offset.x != 0 || ext->img.offset.y != 0 || lv_obj_get_width(canvas) > ext->dsc.header.w ||
+       lv_obj_get_height(canvas) > ext->dsc.header.h) {
+        lv_obj_invalidate(canvas);
+        return;
+    }
+
+    lv_area_t a;
+    a.x1 = canvas->coords.x1 + LV_MATH_MAX(x1, 0);
+    a.y1 = canvas->coords.y1 + LV_MATH_MAX(y1, 0);
+    a.x2 = canvas->coords.x1 + LV_MATH_MIN(x2, ext->dsc.header.w - 1);
+    a.y2 = canvas->coords.y1 + LV_MATH_MIN(y2, ext->dsc.header.h - 1);
+    if(a.x1 > a.x2 || a.y1 > a.y2) return;
+
+    lv_obj_invalidate_area(canvas, &a);
+}
+
+/**
+ * Get the area the points of a line or polygon are in
+ * @param points pointer to the points
+ * @param point_cnt number of points
+ * @param area store the area here
+ */
+static void lv_canvas_get_points_area(const lv_point_t * points, uint32_t point_cnt, lv_area_t * area)
+{
+    area->x1 = LV_COORD_MAX;
+    area->y1 = LV_COORD_MAX;
+    area->x2 = LV_COORD_MIN;
+    area->y2 = LV_COORD_MIN;
+
+    uint32_t i;
+    for(i = 0; i < point_cnt; i++) {
+        area->x1 = LV_MATH_MIN(area->x1, points[i].x);
+        area->y1 = LV_MATH_MIN(area->y1, points[i].y);
+        area->x2 = LV_MATH_MAX(area->x2, points[i].x);
+        area->y2 = LV_MATH_MAX(area->y2, points[i].y);
+    }
+}
+
 #endif
@@ -9,8 +9,10 @@
 #include "lv_chart.h"
 #if LV_USE_CHART != 0
 
+#include "../lv_core/lv_disp.h"
 #include "../lv_core/lv_refr.h"
 #include "../lv_draw/lv_draw.h"
+#include "../lv_misc/lv_math.h"
 #include "../lv_themes/lv_theme.h"
 
 /*********************
@@ -35,6 +37,9 @@
 static bool lv_chart_design(lv_obj_t * chart, const lv_area_t * mask, lv_design_mode_t mode);
 static lv_res_t lv_chart_signal(lv_obj_t * chart, lv_signal_t sign, void * param);
 static void lv_chart_draw_div(lv_obj_t * chart, const lv_area_t * mask);
+static void lv_chart_shift_next(lv_obj_t * chart);
+static bool lv_chart_scroll_copy(lv_obj_t * chart);
+static bool lv_chart_covered(lv_obj_t * par, const lv_obj_t * child, const lv_area_t * area);
 static void lv_chart_draw_lines(lv_obj_t * chart, const lv_area_t * mask);
 static void lv_chart_draw_points(lv_obj_t * chart, const lv_area_t * mask);
 static void lv_chart_draw_cols(lv_obj_t * chart, const lv_area_t * mask);
@@ -173,6 +178,7 @@ lv_chart_series_t * lv_chart_add_series(lv_obj_t * chart, lv_color_t color)
     }
 
     ser->start_point = 0;
+    ser->next_set    = 0;
 
     uint16_t i;
     lv_coord_t * p_tmp = ser->points;
@@ -203,6 +209,7 @@ void lv_chart_clear_serie(lv_obj_t * chart, lv_chart_series_t * serie)
     }
 
     serie->start_point = 0;
+    serie->next_set    = 0;
 }
 
 /*=====================
@@ -416,6 +423,28 @@ void lv_chart_set_next(lv_obj_t * chart, lv_chart_series_t * ser, lv_coord_t y)
         if(ext->type & LV_CHART_TYPE_AREA) lv_chart_inv_lines(chart, ser->start_point);
 
         ser->start_point = (ser->start_point + 1) % ext->point_cnt; /*update the x for next incoming y*/
+    } else if(ext->update_mode == LV_CHART_UPDATE_MODE_SCROLL) {
+        /*A second data before the other series got theirs shifts this series alone*/
+        if(ser->next_set) {
+            ser->points[ser->start_point] = ser->next;
+            ser->start_point              = (ser->start_point + 1) % ext->point_cnt;
+            ser->next_set                 = 0;
+            lv_chart_refresh(chart);
+        }
+
+        ser->next     = y;
+        ser->next_set = 1;
+
+        /*Scroll once every series has its new data*/
+        lv_chart_series_t * s;
+        LV_LL_READ(ext->series_ll, s)
+        {
+            if(s->next_set == 0) return;
+        }
+
+        bool copied = lv_chart_scroll_copy(chart);
+        lv_chart_shift_next(chart);
+        if(copied == false) lv_chart_refresh(chart);
     }
 }
 
@@ -429,6 +458,9 @@ void lv_chart_set_update_mode(lv_obj_t * chart, lv_chart_update_mode_t update_mo
     lv_chart_ext_t * ext = lv_obj_get_ext_attr(chart);
     if(ext->update_mode == update_mode) return;
 
+    /*Don't lose the data waiting for the other series*/
+    if(ext->update_mode == LV_CHART_UPDATE_MODE_SCROLL) lv_chart_shift_next(chart);
+
     ext->update_mode = update_mode;
     lv_obj_invalidate(chart);
 }
@@ -759,7 +791,7 @@ static void lv_chart_draw_lines(lv_obj_t * chart, const lv_area_t * mask)
     {
         style.line.color = ser->color;
 
-        lv_coord_t start_point = ext->update_mode == LV_CHART_UPDATE_MODE_SHIFT ? ser->start_point : 0;
+        lv_coord_t start_point = ext->update_mode != LV_CHART_UPDATE_MODE_CIRCULAR ? ser->start_point : 0;
 
         p1.x = 0 + x_ofs;
         p2.x = 0 + x_ofs;
@@ -820,7 +852,7 @@ static void lv_chart_draw_points(lv_obj_t * chart, const lv_area_t * mask)
 
     LV_LL_READ_BACK(ext->series_ll, ser)
     {
-        lv_coord_t start_point = ext->update_mode == LV_CHART_UPDATE_MODE_SHIFT ? ser->start_point : 0;
+        lv_coord_t start_point = ext->update_mode != LV_CHART_UPDATE_MODE_CIRCULAR ? ser->start_point : 0;
 
         style_point.body.main_color = ser->color;
         style_point.body.grad_color = lv_color_mix(LV_COLOR_BLACK, ser->color, ext->series.dark);
@@ -883,7 +915,7 @@ static void lv_chart_draw_cols(lv_obj_t * chart, const lv_area_t * mask)
         /*Draw the current point of all data line*/
         LV_LL_READ_BACK(ext->series_ll, ser)
         {
-            lv_coord_t start_point = ext->update_mode == LV_CHART_UPDATE_MODE_SHIFT ? ser->start_point : 0;
+            lv_coord_t start_point = ext->update_mode != LV_CHART_UPDATE_MODE_CIRCULAR ? ser->start_point : 0;
 
             col_a.x1 = x_act;
             col_a.x2 = col_a.x1 + col_w;
@@ -941,7 +973,7 @@ static void lv_chart_draw_vertical_lines(lv_obj_t * chart, const lv_area_t * mas
     /*Go through all data lines*/
     LV_LL_READ_BACK(ext->series_ll, ser)
     {
-        lv_coord_t start_point = ext->update_mode == LV_CHART_UPDATE_MODE_SHIFT ? ser->start_point : 0;
+        lv_coord_t start_point = ext->update_mode != LV_CHART_UPDATE_MODE_CIRCULAR ? ser->start_point : 0;
         style.line.color       = ser->color;
 
         p1.x  = 0 + x_ofs;
@@ -974,7 +1006,8 @@ static void lv_chart_draw_vertical_lines(lv_obj_t * chart, const lv_area_t * mas
 }
 
 /**
- * Draw the data lines as areas on a chart
+ * Draw the data lines as areas on a chart.
+ * Every run of valid points is filled as one polygon closed by the bottom of the chart.
  * @param obj pointer to chart object
  */
 static void lv_chart_draw_areas(lv_obj_t * chart, const lv_area_t * mask)
@@ -982,59 +1015,58 @@ static void lv_chart_draw_areas(lv_obj_t * chart, const lv_area_t * mask)
     lv_chart_ext_t * ext = lv_obj_get_ext_attr(chart);
 
     uint16_t i;
-    lv_point_t p1;
-    lv_point_t p2;
     lv_coord_t w     = lv_obj_get_width(chart);
     lv_coord_t h     = lv_obj_get_height(chart);
     lv_coord_t x_ofs = chart->coords.x1;
     lv_coord_t y_ofs = chart->coords.y1;
     int32_t y_tmp;
-    lv_coord_t p_prev;
     lv_coord_t p_act;
     lv_chart_series_t * ser;
     lv_opa_t opa_scale = lv_obj_get_opa_scale(chart);
     lv_style_t style;
     lv_style_copy(&style, &lv_style_plain);
 
+    if(ext->point_cnt < 2) return;
+
+    /*The points of a run and the two corners at the bottom*/
+    lv_point_t * poly = lv_mem_alloc(sizeof(lv_point_t) * (ext->point_cnt + 2));
+    lv_mem_assert(poly);
+    if(poly == NULL) return;
+
     /*Go through all data lines*/
     LV_LL_READ_BACK(ext->series_ll, ser)
     {
-        lv_coord_t start_point = ext->update_mode == LV_CHART_UPDATE_MODE_SHIFT ? ser->start_point : 0;
+        lv_coord_t start_point = ext->update_mode != LV_CHART_UPDATE_MODE_CIRCULAR ? ser->start_point : 0;
         style.body.main_color  = ser->color;
         style.body.opa         = ext->series.opa;
 
-        p2.x = 0 + x_ofs;
-
-        p_prev = start_point;
-        y_tmp  = (int32_t)((int32_t)ser->points[p_prev] - ext->ymin) * h;
-        y_tmp  = y_tmp / (ext->ymax - ext->ymin);
-        p2.y   = h - y_tmp + y_ofs;
-
-        for(i = 1; i < ext->point_cnt; i++) {
-            p1.x = p2.x;
-            p1.y = p2.y;
-
+        uint16_t run_cnt = 0;
+        for(i = 0; i <= ext->point_cnt; i++) {
             p_act = (start_point + i) % ext->point_cnt;
-            p2.x  = ((w * i) / (ext->point_cnt - 1)) + x_ofs;
 
-            y_tmp = (int32_t)((int32_t)ser->points[p_act] - ext->ymin) * h;
-            y_tmp = y_tmp / (ext->ymax - ext->ymin);
-            p2.y  = h - y_tmp + y_ofs;
+            if(i < ext->point_cnt && ser->points[p_act] != LV_CHART_POINT_DEF) {
+                y_tmp = (int32_t)((int32_t)ser->points[p_act] - ext->ymin) * h;
+                y_tmp = y_tmp / (ext->ymax - ext->ymin);
 
-            if(ser->points[p_prev] != LV_CHART_POINT_DEF && ser->points[p_act] != LV_CHART_POINT_DEF) {
-                lv_point_t triangle_points[3];
-                triangle_points[0]   = p1;
-                triangle_points[1]   = p2;
-                triangle_points[2].x = p1.x;
-                triangle_points[2].y = chart->coords.y2;
-                lv_draw_triangle(triangle_points, mask, &style, opa_scale);
-                triangle_points[2].x = p2.x;
-                triangle_points[0].y = chart->coords.y2;
-                lv_draw_triangle(triangle_points, mask, &style, opa_scale);
+                run_cnt++;
+                poly[run_cnt].x = ((w * i) / (ext->point_cnt - 1)) + x_ofs;
+                poly[run_cnt].y = h - y_tmp + y_ofs;
+                continue;
             }
-            p_prev = p_act;
+
+            /*The run has ended: close it at the bottom and fill it*/
+            if(run_cnt >= 2) {
+                poly[0].x           = poly[1].x;
+                poly[0].y           = chart->coords.y2;
+                poly[run_cnt + 1].x = poly[run_cnt].x;
+                poly[run_cnt + 1].y = chart->coords.y2;
+                lv_draw_polygon(poly, run_cnt + 2, mask, &style, opa_scale);
+            }
+            run_cnt = 0;
         }
     }
+
+    lv_mem_free(poly);
 }
 
 static void lv_chart_draw_y_ticks(lv_obj_t * chart, const lv_area_t * mask)
@@ -1334,4 +1366,176 @@ static void lv_chart_inv_cols(lv_obj_t * chart, uint16_t i)
     lv_inv_area(lv_obj_get_disp(chart), &col_a);
 }
 
+
+/**
+ * Add the new data waiting in each series of a chart in `LV_CHART_UPDATE_MODE_SCROLL`
+ * @param chart pointer to chart object
+ */
+static void lv_chart_shift_next(lv_obj_t * chart)
+{
+    lv_chart_ext_t * ext = lv_obj_get_ext_attr(chart);
+    lv_chart_series_t * ser;
+
+    LV_LL_READ(ext->series_ll, ser)
+    {
+        if(ser->next_set == 0) continue;
+
+        ser->points[ser->start_point] = ser->next;
+        ser->start_point              = (ser->start_point + 1) % ext->point_cnt;
+        ser->next_set                 = 0;
+    }
+}
+
+/**
+ * Move the drawn series of a chart one point to the left on the display before they shift, and
+ * invalidate only what that leaves out of date: the newest and oldest points, the vertical division
+ * lines and the border and axes around them. It works only when the points are a whole number of
+ * pixels apart and nothing is drawn over the chart.
+ * @param chart pointer to chart object
+ * @return true: the pixels are moved; false: the chart has to be invalidated as usual
+ */
+static bool lv_chart_scroll_copy(lv_obj_t * chart)
+{
+    lv_chart_ext_t * ext     = lv_obj_get_ext_attr(chart);
+    const lv_style_t * style = lv_obj_get_style(chart);
+    lv_coord_t w             = lv_obj_get_width(chart);
+
+    /*Columns and vertical lines aren't drawn one step apart*/
+    if(ext->type & (LV_CHART_TYPE_COLUMN | LV_CHART_TYPE_VERTICAL_LINE)) return false;
+    if(ext->point_cnt < 2 || w % (ext->point_cnt - 1) != 0) return false;
+    lv_coord_t step = w / (ext->point_cnt - 1);
+
+    /*The gradient is vertical so the background looks the same along the movement if nothing shows through*/
+    if(lv_obj_get_hidden(chart) || lv_obj_get_opa_scale(chart) != LV_OPA_COVER) return false;
+    if(style->body.opa != LV_OPA_COVER) return false;
+
+    lv_obj_t * scr   = lv_obj_get_screen(chart);
+    lv_disp_t * disp = lv_obj_get_disp(scr);
+    if(scr != lv_disp_get_scr_act(disp) && scr != lv_disp_get_layer_top(disp) &&
+       scr != lv_disp_get_layer_sys(disp)) {
+        return false;
+    }
+
+    /*The plot inside the border and rounded corners*/
+    lv_area_t plot;
+    lv_coord_t inset = LV_MATH_MAX(style->body.border.width, style->body.radius);
+    lv_area_copy(&plot, &chart->coords);
+    plot.x1 += inset;
+    plot.y1 += inset;
+    plot.x2 -= inset;
+    plot.y2 -= inset;
+    if(plot.x1 > plot.x2 || plot.y1 > plot.y2) return false;
+
+    /*Clip it to the parents and check nothing drawn after the chart covers it*/
+    if(lv_chart_covered(chart, NULL, &plot)) return false;
+    lv_obj_t * child = chart;
+    lv_obj_t * par   = lv_obj_get_parent(chart);
+    while(par != NULL) {
+        if(lv_obj_get_hidden(par)) return false;
+        if(lv_area_intersect(&plot, &plot, &par->coords) == false) return false;
+        if(lv_chart_covered(par, child, &plot)) return false;
+
+        child = par;
+        par   = lv_obj_get_parent(par);
+    }
+
+    /*The layers are drawn over the screen*/
+    if(child != lv_disp_get_layer_sys(disp)) {
+        if(lv_chart_covered(lv_disp_get_layer_sys(disp), NULL, &plot)) return false;
+        if(child != lv_disp_get_layer_top(disp) && lv_chart_covered(lv_disp_get_layer_top(disp), NULL, &plot)) {
+            return false;
+        }
+    }
+
+    if(lv_refr_copy_area(disp, &plot, -step, 0) == false) return false;
+
+    /*The newest line and the end of the oldest one, with the width of the lines or points*/
+    lv_area_t a;
+    lv_coord_t pad = ext->series.width + 1;
+    lv_area_set(&a, plot.x2 - step - pad, plot.y1, plot.x2, plot.y2);
+    lv_inv_area(disp, &a);
+    lv_area_set(&a, plot.x1, plot.y1, plot.x1 + pad, plot.y2);
+    lv_inv_area(disp, &a);
+
+    /*The vertical division lines stay where they are*/
+    if(ext->vdiv_cnt != 0) {
+        uint8_t div_i;
+        for(div_i = 0; div_i <= ext->vdiv_cnt + 1; div_i++) {
+            lv_coord_t x = (int32_t)((int32_t)(w - style->line.width) * div_i) / (ext->vdiv_cnt + 1);
+            x += chart->coords.x1;
+            lv_area_set(&a, x - step - style->line.width, plot.y1, x + style->line.width, plot.y2);
+            if(lv_area_intersect(&a, &a, &plot)) lv_inv_area(disp, &a);
+        }
+    }
+
+    /*Around the plot the border and corners, and the series drawn over them. Data out of range
+     *are drawn over the axes too*/
+    lv_coord_t around = pad;
+    lv_chart_series_t * ser;
+    LV_LL_READ(ext->series_ll, ser)
+    {
+        uint16_t i;
+        for(i = 0; i < ext->point_cnt; i++) {
+            lv_coord_t y = ser->points[i];
+            if(y != LV_CHART_POINT_DEF && (y < ext->ymin || y > ext->ymax)) around = chart->ext_draw_pad;
+        }
+        if(ser->next_set && (ser->next < ext->ymin || ser->next > ext->ymax)) around = chart->ext_draw_pad;
+    }
+    around = LV_MATH_MIN(around, chart->ext_draw_pad);
+
+    lv_area_t full;
+    lv_area_copy(&full, &chart->coords);
+    full.x1 -= around;
+    full.y1 -= around;
+    full.x2 += around;
+    full.y2 += around;
+    if(full.y1 < plot.y1) {
+        lv_area_set(&a, full.x1, full.y1, full.x2, plot.y1 - 1);
+        lv_inv_area(disp, &a);
+    }
+    if(full.y2 > plot.y2) {
+        lv_area_set(&a, full.x1, plot.y2 + 1, full.x2, full.y2);
+        lv_inv_area(disp, &a);
+    }
+    if(full.x1 < plot.x1) {
+        lv_area_set(&a, full.x1, plot.y1, plot.x1 - 1, plot.y2);
+        lv_inv_area(disp, &a);
+    }
+    if(full.x2 > plot.x2) {
+        lv_area_set(&a, plot.x2 + 1, plot.y1, full.x2, plot.y2);
+        lv_inv_area(disp, &a);
+    }
+
+    return true;
+}
+
+/**
+ * Check whether the children of an object drawn after one of them are on an area
+ * @param par pointer to an object
+ * @param child pointer to a child of `par`, NULL to check all children
+ * @param area pointer to an area
+ * @return true: one of the children is on `area`
+ */
+static bool lv_chart_covered(lv_obj_t * par, const lv_obj_t * child, const lv_area_t * area)
+{
+    lv_obj_t * i;
+    lv_area_t a;
+
+    /*The children are drawn from the tail so the ones drawn later are before `child`*/
+    LV_LL_READ(par->child_ll, i)
+    {
+        if(i == child) break;
+        if(lv_obj_get_hidden(i)) continue;
+
+        lv_area_copy(&a, &i->coords);
+        a.x1 -= i->ext_draw_pad;
+        a.y1 -= i->ext_draw_pad;
+        a.x2 += i->ext_draw_pad;
+        a.y2 += i->ext_draw_pad;
+        if(lv_area_is_on(&a, area)) return true;
+    }
+
+    return false;
+}
+
 #endif
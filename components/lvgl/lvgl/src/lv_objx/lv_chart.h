@@ -53,6 +53,8 @@ typedef uint8_t lv_chart_type_t;
 enum {
     LV_CHART_UPDATE_MODE_SHIFT,     /**< Shift old data to the left and add the new one o the right*/
     LV_CHART_UPDATE_MODE_CIRCULAR,  /**< Add the new data in a circular way*/
+    LV_CHART_UPDATE_MODE_SCROLL,    /**< Shift like `LV_CHART_UPDATE_MODE_SHIFT` once every series has a new
+                                         data, moving the drawn series on the display instead of redrawing them*/
 };
 typedef uint8_t lv_chart_update_mode_t;
 
@@ -61,6 +63,8 @@ typedef struct
     lv_coord_t * points;
     lv_color_t color;
     uint16_t start_point;
+    lv_coord_t next;       /*The new data waiting for the other series in `LV_CHART_UPDATE_MODE_SCROLL`*/
+    uint8_t next_set : 1;  /*1: `next` is set*/
 } lv_chart_series_t;
 
 /** Data of axis */
@@ -94,7 +98,7 @@ typedef struct
     lv_chart_axis_cfg_t y_axis;
     lv_chart_axis_cfg_t x_axis;
     uint16_t margin;
-    uint8_t update_mode : 1;
+    uint8_t update_mode : 2;
     struct
     {
         lv_coord_t width; /*Line width or point radius*/
@@ -40,6 +40,7 @@ static void lv_cont_layout_center(lv_obj_t * cont);
 static void lv_cont_layout_pretty(lv_obj_t * cont);
 static void lv_cont_layout_grid(lv_obj_t * cont);
 static void lv_cont_refr_autofit(lv_obj_t * cont);
+static void lv_cont_refr(lv_obj_t * cont);
 
 /**********************
  *  STATIC VARIABLES
@@ -133,6 +134,11 @@ void lv_cont_set_layout(lv_obj_t * cont, lv_layout_t layout)
 
     /*Send a signal to refresh the layout*/
     cont->signal_cb(cont, LV_SIGNAL_CHILD_CHG, NULL);
+
+#if LV_USE_OBJ_LAYOUT_DEFER
+    /*Apply it at once so the container's size can be used straight away*/
+    lv_obj_layout_refresh(cont);
+#endif
 }
 
 /**
@@ -159,6 +165,11 @@ void lv_cont_set_fit4(lv_obj_t * cont, lv_fit_t left, lv_fit_t right, lv_fit_t t
 
     /*Send a signal to refresh the layout*/
     cont->signal_cb(cont, LV_SIGNAL_CHILD_CHG, NULL);
+
+#if LV_USE_OBJ_LAYOUT_DEFER
+    /*Apply it at once so the container's size can be used straight away*/
+    lv_obj_layout_refresh(cont);
+#endif
 }
 
 /*=====================
@@ -240,19 +251,21 @@ static lv_res_t lv_cont_signal(lv_obj_t * cont, lv_signal_t sign, void * param)
     if(res != LV_RES_OK) return res;
 
     if(sign == LV_SIGNAL_STYLE_CHG) { /*Recalculate the padding if the style changed*/
-        lv_cont_refr_layout(cont);
-        lv_cont_refr_autofit(cont);
+        lv_cont_refr(cont);
     } else if(sign == LV_SIGNAL_CHILD_CHG) {
-        lv_cont_refr_layout(cont);
-        lv_cont_refr_autofit(cont);
+        lv_cont_refr(cont);
     } else if(sign == LV_SIGNAL_CORD_CHG) {
         if(lv_obj_get_width(cont) != lv_area_get_width(param) || lv_obj_get_height(cont) != lv_area_get_height(param)) {
-            lv_cont_refr_layout(cont);
-            lv_cont_refr_autofit(cont);
+            lv_cont_refr(cont);
         }
     } else if(sign == LV_SIGNAL_PARENT_SIZE_CHG) {
         /*FLOOD and FILL fit needs to be refreshed if the parent size has changed*/
         lv_cont_refr_autofit(cont);
+#if LV_USE_OBJ_LAYOUT_DEFER
+    } else if(sign == LV_SIGNAL_REFR_LAYOUT) {
+        lv_cont_refr_layout(cont);
+        lv_cont_refr_autofit(cont);
+#endif
 
     } else if(sign == LV_SIGNAL_GET_TYPE) {
         lv_obj_type_t * buf = param;
@@ -266,6 +279,25 @@ static lv_res_t lv_cont_signal(lv_obj_t * cont, lv_signal_t sign, void * param)
     return res;
 }
 
+/**
+ * Refresh the layout and the fit of a container, or only mark them while layouts are deferred
+ * @param cont pointer to a container object
+ */
+static void lv_cont_refr(lv_obj_t * cont)
+{
+#if LV_USE_OBJ_LAYOUT_DEFER
+    lv_cont_ext_t * ext = lv_obj_get_ext_attr(cont);
+    if(ext->layout == LV_LAYOUT_OFF && ext->fit_left == LV_FIT_NONE && ext->fit_right == LV_FIT_NONE &&
+       ext->fit_top == LV_FIT_NONE && ext->fit_bottom == LV_FIT_NONE) {
+        return;
+    }
+    if(lv_obj_layout_later(cont)) return;
+#endif
+
+    lv_cont_refr_layout(cont);
+    lv_cont_refr_autofit(cont);
+}
+
 /**
  * Refresh the layout of a container
  * @param cont pointer to an object which layout should be refreshed
@@ -553,8 +553,9 @@ static bool lv_ddlist_design(lv_obj_t * ddlist, const lv_area_t * mask, lv_desig
                 new_style.text.color = sel_style->text.color;
                 new_style.text.opa   = sel_style->text.opa;
                 lv_txt_flag_t flag   = lv_ddlist_get_txt_flag(ddlist);
+                lv_draw_label_hint_t * hint = lv_label_get_draw_hint(ext->label, &new_style, &flag);
                 lv_draw_label(&ext->label->coords, &mask_sel, &new_style, opa_scale, lv_label_get_text(ext->label),
-                              flag, NULL, -1, -1, NULL);
+                              flag, NULL, -1, -1, hint);
             }
         }
 
@@ -686,6 +687,14 @@ static lv_res_t lv_ddlist_signal(lv_obj_t * ddlist, lv_signal_t sign, void * par
     } else if(sign == LV_SIGNAL_GET_EDITABLE) {
         bool * editable = (bool *)param;
         *editable       = true;
+    } else if(sign == LV_SIGNAL_CHILD_MOVE) {
+        /*The opened list draws the selected option where it scrolls to, so move it on the display.
+         *(Not in an other type like the roller which draws the selection at a fixed place.)*/
+        lv_child_move_t * move = param;
+        if(move->child == lv_page_get_scrl(ddlist) && move->copied == false && ext->opened && !ext->force_sel &&
+           ddlist->design_cb == lv_ddlist_design) {
+            move->copied = lv_page_scroll_copy(ddlist, &move->diff);
+        }
     } else if(sign == LV_SIGNAL_GET_TYPE) {
         lv_obj_type_t * buf = param;
         uint8_t i;
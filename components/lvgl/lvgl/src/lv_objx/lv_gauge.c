@@ -10,6 +10,7 @@
 #if LV_USE_GAUGE != 0
 
 #include "../lv_draw/lv_draw.h"
+#include "../lv_core/lv_refr.h"
 #include "../lv_themes/lv_theme.h"
 #include "../lv_misc/lv_txt.h"
 #include "../lv_misc/lv_math.h"
@@ -36,8 +37,11 @@
  **********************/
 static bool lv_gauge_design(lv_obj_t * gauge, const lv_area_t * mask, lv_design_mode_t mode);
 static lv_res_t lv_gauge_signal(lv_obj_t * gauge, lv_signal_t sign, void * param);
+static void lv_gauge_draw_static(lv_obj_t * gauge, const lv_area_t * mask);
 static void lv_gauge_draw_scale(lv_obj_t * gauge, const lv_area_t * mask);
 static void lv_gauge_draw_needle(lv_obj_t * gauge, const lv_area_t * mask);
+static void lv_gauge_get_needle_end(const lv_obj_t * gauge, int16_t value, lv_point_t * p_end);
+static void lv_gauge_inv_needle(lv_obj_t * gauge, uint8_t needle_id);
 
 /**********************
  *  STATIC VARIABLES
@@ -177,9 +181,10 @@ void lv_gauge_set_value(lv_obj_t * gauge, uint8_t needle_id, int16_t value)
     else if(value < min)
         value = min;
 
+    /*Only the needle moves so redraw where it was and where it will be*/
+    lv_gauge_inv_needle(gauge, needle_id);
     ext->values[needle_id] = value;
-
-    lv_obj_invalidate(gauge);
+    lv_gauge_inv_needle(gauge, needle_id);
 }
 
 /**
@@ -265,35 +270,17 @@ static bool lv_gauge_design(lv_obj_t * gauge, const lv_area_t * mask, lv_design_
     }
     /*Draw the object*/
     else if(mode == LV_DESIGN_DRAW_MAIN) {
-
-        /* Store the real pointer because of 'lv_group'
-         * If the object is in focus 'lv_obj_get_style()' will give a pointer to tmp style
-         * and to the real object style. It is important because of style change tricks below*/
-        const lv_style_t * style_ori_p = gauge->style_p;
-        const lv_style_t * style       = lv_obj_get_style(gauge);
-        lv_gauge_ext_t * ext           = lv_obj_get_ext_attr(gauge);
-
-        lv_gauge_draw_scale(gauge, mask);
-
-        /*Draw the ancestor line meter with max value to show the rainbow like line colors*/
-        uint16_t line_cnt_tmp = ext->lmeter.line_cnt;
-        ancestor_design(gauge, mask, mode); /*To draw lines*/
-
-        /*Temporally modify the line meter to draw longer lines where labels are*/
-        lv_style_t style_tmp;
-        lv_style_copy(&style_tmp, style);
-        ext->lmeter.line_cnt         = ext->label_count;                 /*Only to labels*/
-        style_tmp.body.padding.left  = style_tmp.body.padding.left * 2;  /*Longer lines*/
-        style_tmp.body.padding.right = style_tmp.body.padding.right * 2; /*Longer lines*/
-        gauge->style_p               = &style_tmp;
-
-        ancestor_design(gauge, mask, mode); /*To draw lines*/
-
-        ext->lmeter.line_cnt = line_cnt_tmp; /*Restore the parameters*/
-        gauge->style_p       = style_ori_p;  /*Restore the ORIGINAL style pointer*/
-
+#if LV_LMETER_LAYER
+        /*Only the needles change when the value changes so the rest comes from the layer*/
+        lv_gauge_ext_t * ext = lv_obj_get_ext_attr(gauge);
+        if(ext->lmeter.layer_rendering == 0) {
+            lv_lmeter_draw_layer(gauge, mask, lv_gauge_draw_static);
+            lv_gauge_draw_needle(gauge, mask);
+            return true;
+        }
+#endif
+        lv_gauge_draw_static(gauge, mask);
         lv_gauge_draw_needle(gauge, mask);
-
     }
     /*Post draw when the children are drawn*/
     else if(mode == LV_DESIGN_DRAW_POST) {
@@ -334,6 +321,40 @@ static lv_res_t lv_gauge_signal(lv_obj_t * gauge, lv_signal_t sign, void * param
     return res;
 }
 
+/**
+ * Draw the parts of a gauge which don't depend on the needles: the scale labels and lines
+ * @param gauge pointer to gauge object
+ * @param mask mask of drawing
+ */
+static void lv_gauge_draw_static(lv_obj_t * gauge, const lv_area_t * mask)
+{
+    /* Store the real pointer because of 'lv_group'
+     * If the object is in focus 'lv_obj_get_style()' will give a pointer to tmp style
+     * and to the real object style. It is important because of style change tricks below*/
+    const lv_style_t * style_ori_p = gauge->style_p;
+    const lv_style_t * style       = lv_obj_get_style(gauge);
+    lv_gauge_ext_t * ext           = lv_obj_get_ext_attr(gauge);
+
+    lv_gauge_draw_scale(gauge, mask);
+
+    /*Draw the ancestor line meter with max value to show the rainbow like line colors*/
+    uint16_t line_cnt_tmp = ext->lmeter.line_cnt;
+    ancestor_design(gauge, mask, LV_DESIGN_DRAW_MAIN); /*To draw lines*/
+
+    /*Temporally modify the line meter to draw longer lines where labels are*/
+    lv_style_t style_tmp;
+    lv_style_copy(&style_tmp, style);
+    ext->lmeter.line_cnt         = ext->label_count;                 /*Only to labels*/
+    style_tmp.body.padding.left  = style_tmp.body.padding.left * 2;  /*Longer lines*/
+    style_tmp.body.padding.right = style_tmp.body.padding.right * 2; /*Longer lines*/
+    gauge->style_p               = &style_tmp;
+
+    ancestor_design(gauge, mask, LV_DESIGN_DRAW_MAIN); /*To draw lines*/
+
+    ext->lmeter.line_cnt = line_cnt_tmp; /*Restore the parameters*/
+    gauge->style_p       = style_ori_p;  /*Restore the ORIGINAL style pointer*/
+}
+
 /**
  * Draw the scale on a gauge
  * @param gauge pointer to gauge object
@@ -396,17 +417,10 @@ static void lv_gauge_draw_needle(lv_obj_t * gauge, const lv_area_t * mask)
     const lv_style_t * style = lv_gauge_get_style(gauge, LV_GAUGE_STYLE_MAIN);
     lv_opa_t opa_scale       = lv_obj_get_opa_scale(gauge);
 
-    lv_coord_t r      = lv_obj_get_width(gauge) / 2 - style->body.padding.left;
-    lv_coord_t x_ofs  = lv_obj_get_width(gauge) / 2 + gauge->coords.x1;
-    lv_coord_t y_ofs  = lv_obj_get_height(gauge) / 2 + gauge->coords.y1;
-    uint16_t angle    = lv_lmeter_get_scale_angle(gauge);
-    int16_t angle_ofs = 90 + (360 - angle) / 2;
-    int16_t min       = lv_gauge_get_min_value(gauge);
-    int16_t max       = lv_gauge_get_max_value(gauge);
+    lv_coord_t x_ofs = lv_obj_get_width(gauge) / 2 + gauge->coords.x1;
+    lv_coord_t y_ofs = lv_obj_get_height(gauge) / 2 + gauge->coords.y1;
     lv_point_t p_mid;
     lv_point_t p_end;
-    lv_point_t p_end_low;
-    lv_point_t p_end_high;
     uint8_t i;
 
     lv_style_copy(&style_needle, style);
@@ -414,28 +428,7 @@ static void lv_gauge_draw_needle(lv_obj_t * gauge, const lv_area_t * mask)
     p_mid.x = x_ofs;
     p_mid.y = y_ofs;
     for(i = 0; i < ext->needle_count; i++) {
-        /*Calculate the end point of a needle*/
-        int16_t needle_angle =
-            (ext->values[i] - min) * angle * (1 << LV_GAUGE_INTERPOLATE_SHIFT) / (max - min); //+ angle_ofs;
-
-        int16_t needle_angle_low  = (needle_angle >> LV_GAUGE_INTERPOLATE_SHIFT) + angle_ofs;
-        int16_t needle_angle_high = needle_angle_low + 1;
-
-        p_end_low.y = (lv_trigo_sin(needle_angle_low) * r) / LV_TRIGO_SIN_MAX + y_ofs;
-        p_end_low.x = (lv_trigo_sin(needle_angle_low + 90) * r) / LV_TRIGO_SIN_MAX + x_ofs;
-
-        p_end_high.y = (lv_trigo_sin(needle_angle_high) * r) / LV_TRIGO_SIN_MAX + y_ofs;
-        p_end_high.x = (lv_trigo_sin(needle_angle_high + 90) * r) / LV_TRIGO_SIN_MAX + x_ofs;
-
-        uint16_t rem  = needle_angle & ((1 << LV_GAUGE_INTERPOLATE_SHIFT) - 1);
-        int16_t x_mod = ((LV_MATH_ABS(p_end_high.x - p_end_low.x)) * rem) >> LV_GAUGE_INTERPOLATE_SHIFT;
-        int16_t y_mod = ((LV_MATH_ABS(p_end_high.y - p_end_low.y)) * rem) >> LV_GAUGE_INTERPOLATE_SHIFT;
-
-        if(p_end_high.x < p_end_low.x) x_mod = -x_mod;
-        if(p_end_high.y < p_end_low.y) y_mod = -y_mod;
-
-        p_end.x = p_end_low.x + x_mod;
-        p_end.y = p_end_low.y + y_mod;
+        lv_gauge_get_needle_end(gauge, ext->values[i], &p_end);
 
         /*Draw the needle with the corresponding color*/
         if(ext->needle_colors == NULL)
@@ -462,4 +455,73 @@ static void lv_gauge_draw_needle(lv_obj_t * gauge, const lv_area_t * mask)
     lv_draw_rect(&nm_cord, mask, &style_neddle_mid, lv_obj_get_opa_scale(gauge));
 }
 
+/**
+ * Get the end point of a needle
+ * @param gauge pointer to gauge object
+ * @param value the value the needle shows
+ * @param p_end store the end point here
+ */
+static void lv_gauge_get_needle_end(const lv_obj_t * gauge, int16_t value, lv_point_t * p_end)
+{
+    const lv_style_t * style = lv_gauge_get_style(gauge, LV_GAUGE_STYLE_MAIN);
+
+    lv_coord_t r      = lv_obj_get_width(gauge) / 2 - style->body.padding.left;
+    lv_coord_t x_ofs  = lv_obj_get_width(gauge) / 2 + gauge->coords.x1;
+    lv_coord_t y_ofs  = lv_obj_get_height(gauge) / 2 + gauge->coords.y1;
+    uint16_t angle    = lv_lmeter_get_scale_angle(gauge);
+    int16_t angle_ofs = 90 + (360 - angle) / 2;
+    int16_t min       = lv_gauge_get_min_value(gauge);
+    int16_t max       = lv_gauge_get_max_value(gauge);
+    lv_point_t p_end_low;
+    lv_point_t p_end_high;
+
+    /*Calculate the end point of a needle*/
+    int16_t needle_angle = (value - min) * angle * (1 << LV_GAUGE_INTERPOLATE_SHIFT) / (max - min); //+ angle_ofs;
+
+    int16_t needle_angle_low  = (needle_angle >> LV_GAUGE_INTERPOLATE_SHIFT) + angle_ofs;
+    int16_t needle_angle_high = needle_angle_low + 1;
+
+    p_end_low.y = (lv_trigo_sin(needle_angle_low) * r) / LV_TRIGO_SIN_MAX + y_ofs;
+    p_end_low.x = (lv_trigo_sin(needle_angle_low + 90) * r) / LV_TRIGO_SIN_MAX + x_ofs;
+
+    p_end_high.y = (lv_trigo_sin(needle_angle_high) * r) / LV_TRIGO_SIN_MAX + y_ofs;
+    p_end_high.x = (lv_trigo_sin(needle_angle_high + 90) * r) / LV_TRIGO_SIN_MAX + x_ofs;
+
+    uint16_t rem  = needle_angle & ((1 << LV_GAUGE_INTERPOLATE_SHIFT) - 1);
+    int16_t x_mod = ((LV_MATH_ABS(p_end_high.x - p_end_low.x)) * rem) >> LV_GAUGE_INTERPOLATE_SHIFT;
+    int16_t y_mod = ((LV_MATH_ABS(p_end_high.y - p_end_low.y)) * rem) >> LV_GAUGE_INTERPOLATE_SHIFT;
+
+    if(p_end_high.x < p_end_low.x) x_mod = -x_mod;
+    if(p_end_high.y < p_end_low.y) y_mod = -y_mod;
+
+    p_end->x = p_end_low.x + x_mod;
+    p_end->y = p_end_low.y + y_mod;
+}
+
+/**
+ * Invalidate the area of a needle
+ * @param gauge pointer to gauge object
+ * @param needle_id the id of the needle
+ */
+static void lv_gauge_inv_needle(lv_obj_t * gauge, uint8_t needle_id)
+{
+    lv_gauge_ext_t * ext     = lv_obj_get_ext_attr(gauge);
+    const lv_style_t * style = lv_gauge_get_style(gauge, LV_GAUGE_STYLE_MAIN);
+
+    lv_point_t p_end;
+    lv_gauge_get_needle_end(gauge, ext->values[needle_id], &p_end);
+
+    /*The needle goes from the middle to the end and can be wider by its width*/
+    lv_coord_t x_ofs = lv_obj_get_width(gauge) / 2 + gauge->coords.x1;
+    lv_coord_t y_ofs = lv_obj_get_height(gauge) / 2 + gauge->coords.y1;
+    lv_coord_t pad   = style->line.width + 1;
+    lv_area_t a;
+    a.x1 = LV_MATH_MIN(x_ofs, p_end.x) - pad;
+    a.y1 = LV_MATH_MIN(y_ofs, p_end.y) - pad;
+    a.x2 = LV_MATH_MAX(x_ofs, p_end.x) + pad;
+    a.y2 = LV_MATH_MAX(y_ofs, p_end.y) + pad;
+
+    lv_inv_area(lv_obj_get_disp(gauge), &a);
+}
+
 #endif
@@ -107,6 +107,9 @@ static inline void lv_gauge_set_range(lv_obj_t * gauge, int16_t min, int16_t max
 static inline void lv_gauge_set_critical_value(lv_obj_t * gauge, int16_t value)
 {
     lv_lmeter_set_value(gauge, value);
+#if LV_LMETER_LAYER
+    lv_lmeter_invalidate_layer(gauge); /*The label lines might change even if the others don't*/
+#endif
 }
 
 /**
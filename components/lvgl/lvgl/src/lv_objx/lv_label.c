@@ -36,6 +36,12 @@
 static lv_res_t lv_label_signal(lv_obj_t * label, lv_signal_t sign, void * param);
 static bool lv_label_design(lv_obj_t * label, const lv_area_t * mask, lv_design_mode_t mode);
 static void lv_label_refr_text(lv_obj_t * label);
+static void lv_label_refr_edit(lv_obj_t * label, uint32_t pos, int32_t len);
+#if LV_LABEL_LINE_CACHE
+static lv_txt_flag_t lv_label_get_draw_flag(const lv_obj_t * label);
+static const uint32_t * lv_label_get_lines(const lv_obj_t * label);
+static lv_coord_t lv_label_get_lines_h(const lv_obj_t * label);
+#endif
 static void lv_label_revert_dots(lv_obj_t * label);
 
 #if LV_USE_ANIMATION
@@ -86,6 +92,7 @@ lv_obj_t * lv_label_create(lv_obj_t * par, const lv_obj_t * copy)
 
     ext->text       = NULL;
     ext->static_txt = 0;
+    ext->ascii      = 0;
     ext->recolor    = 0;
     ext->body_draw  = 0;
     ext->align      = LV_LABEL_ALIGN_LEFT;
@@ -100,6 +107,10 @@ lv_obj_t * lv_label_create(lv_obj_t * par, const lv_obj_t * copy)
     ext->hint.line_start = -1;
     ext->hint.coord_y    = 0;
     ext->hint.y          = 0;
+#if LV_LABEL_LINE_CACHE
+    ext->hint.lines    = NULL;
+    ext->hint.line_cnt = 0;
+#endif
 
 #if LV_LABEL_TEXT_SEL
     ext->txt_sel_start = LV_LABEL_TEXT_SEL_OFF;
@@ -486,6 +497,7 @@ void lv_label_get_letter_pos(const lv_obj_t * label, uint16_t index, lv_point_t
 
     if(ext->recolor != 0) flag |= LV_TXT_FLAG_RECOLOR;
     if(ext->expand != 0) flag |= LV_TXT_FLAG_EXPAND;
+    if(ext->ascii != 0) flag |= LV_TXT_FLAG_ASCII;
     if(ext->align == LV_LABEL_ALIGN_CENTER) flag |= LV_TXT_FLAG_CENTER;
 
     /*If the width will be expanded  the set the max length to very big */
@@ -493,16 +505,36 @@ void lv_label_get_letter_pos(const lv_obj_t * label, uint16_t index, lv_point_t
         max_w = LV_COORD_MAX;
     }
 
-    index = lv_txt_encoded_get_byte_id(txt, index);
-
-    /*Search the line of the index letter */;
-    while(txt[new_line_start] != '\0') {
-        new_line_start += lv_txt_get_next_line(&txt[line_start], font, style->text.letter_space, max_w, flag);
-        if(index < new_line_start || txt[new_line_start] == '\0')
-            break; /*The line of 'index' letter begins at 'line_start'*/
+    if(ext->ascii == 0) index = lv_txt_encoded_get_byte_id(txt, index);
+
+#if LV_LABEL_LINE_CACHE
+    /*With the lines laid out find the line of the letter without going through the lines before it*/
+    const uint32_t * lines = lv_label_get_lines(label);
+    if(lines) {
+        uint32_t l_min = 0;
+        uint32_t l_max = ext->hint.line_cnt - 1;
+        while(l_min < l_max) {
+            uint32_t l = (l_min + l_max + 1) / 2;
+            if(lines[l] <= index)
+                l_min = l;
+            else
+                l_max = l - 1;
+        }
+        line_start     = lines[l_min];
+        new_line_start = lines[l_min + 1];
+        y              = l_min * (letter_height + style->text.line_space);
+    } else
+#endif
+    {
+        /*Search the line of the index letter */;
+        while(txt[new_line_start] != '\0') {
+            new_line_start += lv_txt_get_next_line(&txt[line_start], font, style->text.letter_space, max_w, flag);
+            if(index < new_line_start || txt[new_line_start] == '\0')
+                break; /*The line of 'index' letter begins at 'line_start'*/
 
-        y += letter_height + style->text.line_space;
-        line_start = new_line_start;
+            y += letter_height + style->text.line_space;
+            line_start = new_line_start;
+        }
     }
 
     /*If the last character is line break then go to the next line*/
@@ -555,6 +587,7 @@ uint16_t lv_label_get_letter_on(const lv_obj_t * label, lv_point_t * pos)
 
     if(ext->recolor != 0) flag |= LV_TXT_FLAG_RECOLOR;
     if(ext->expand != 0) flag |= LV_TXT_FLAG_EXPAND;
+    if(ext->ascii != 0) flag |= LV_TXT_FLAG_ASCII;
     if(ext->align == LV_LABEL_ALIGN_CENTER) flag |= LV_TXT_FLAG_CENTER;
 
     /*If the width will be expanded set the max length to very big */
@@ -591,10 +624,10 @@ uint16_t lv_label_get_letter_on(const lv_obj_t * label, lv_point_t * pos)
         while(i <= new_line_start - 1) {
             /* Get the current letter.
              * Be careful 'i' already points to the next character*/
-            letter = lv_txt_encoded_next(txt, &i);
+            letter = lv_txt_next(txt, &i, flag);
 
             /*Get the next letter too for kerning*/
-            letter_next = lv_txt_encoded_next(&txt[i], NULL);
+            letter_next = lv_txt_next(&txt[i], NULL, flag);
 
             /*Handle the recolor command*/
             if((flag & LV_TXT_FLAG_RECOLOR) != 0) {
@@ -613,7 +646,7 @@ uint16_t lv_label_get_letter_on(const lv_obj_t * label, lv_point_t * pos)
         }
     }
 
-    return lv_encoded_get_char_id(txt, i);
+    return (flag & LV_TXT_FLAG_ASCII) ? i : lv_encoded_get_char_id(txt, i);
 }
 
 /**
@@ -649,6 +682,38 @@ uint16_t lv_label_get_text_sel_end(const lv_obj_t * label)
 #endif
 }
 
+/**
+ * Get the hint to draw the text of a label again with `lv_draw_label`, e.g. a highlighted part of it,
+ * with the line layout the label cached so only the visible lines are laid out.
+ * @param label pointer to a label object
+ * @param style the style the text will be drawn with
+ * @param flag the text flags the text will be drawn with. Replaced with the label's own if the hint
+ * can be used.
+ * @return the hint or NULL if the text has to be laid out again
+ */
+lv_draw_label_hint_t * lv_label_get_draw_hint(const lv_obj_t * label, const lv_style_t * style, lv_txt_flag_t * flag)
+{
+#if LV_LABEL_LINE_CACHE
+    lv_label_ext_t * ext           = lv_obj_get_ext_attr(label);
+    const lv_style_t * label_style = lv_obj_get_style(label);
+
+    /*With an other layout the label's own drawing and this one would lay the text out in turns*/
+    if(ext->long_mode == LV_LABEL_LONG_SROLL || ext->long_mode == LV_LABEL_LONG_SROLL_CIRC) return NULL;
+    if(style->text.font != label_style->text.font || style->text.letter_space != label_style->text.letter_space ||
+       style->text.line_space != label_style->text.line_space) {
+        return NULL;
+    }
+
+    *flag = lv_label_get_draw_flag(label);
+    return &ext->hint;
+#else
+    (void)label; /*Unused*/
+    (void)style; /*Unused*/
+    (void)flag;  /*Unused*/
+    return NULL;
+#endif
+}
+
 /**
  * Check if a character is drawn under a point.
  * @param label Label object
@@ -670,6 +735,7 @@ bool lv_label_is_char_under_pos(const lv_obj_t * label, lv_point_t * pos)
 
     if(ext->recolor != 0) flag |= LV_TXT_FLAG_RECOLOR;
     if(ext->expand != 0) flag |= LV_TXT_FLAG_EXPAND;
+    if(ext->ascii != 0) flag |= LV_TXT_FLAG_ASCII;
     if(ext->align == LV_LABEL_ALIGN_CENTER) flag |= LV_TXT_FLAG_CENTER;
 
     /*If the width will be expanded set the max length to very big */
@@ -707,10 +773,10 @@ bool lv_label_is_char_under_pos(const lv_obj_t * label, lv_point_t * pos)
         while(i <= new_line_start - 1) {
             /* Get the current letter
              * Be careful 'i' already points to the next character */
-            letter = lv_txt_encoded_next(txt, &i);
+            letter = lv_txt_next(txt, &i, flag);
 
             /*Get the next letter for kerning*/
-            letter_next = lv_txt_encoded_next(&txt[i], NULL);
+            letter_next = lv_txt_next(&txt[i], NULL, flag);
 
             /*Handle the recolor command*/
             if((flag & LV_TXT_FLAG_RECOLOR) != 0) {
@@ -751,23 +817,26 @@ void lv_label_ins_text(lv_obj_t * label, uint32_t pos, const char * txt)
     /*Can not append to static text*/
     if(ext->static_txt != 0) return;
 
-    lv_obj_invalidate(label);
-
-    /*Allocate space for the new text*/
+    /*Allocate space for the new text. Leave some room after it to not move the whole text in the
+     *memory for every inserted character.*/
     uint32_t old_len = strlen(ext->text);
     uint32_t ins_len = strlen(txt);
     uint32_t new_len = ins_len + old_len;
-    ext->text        = lv_mem_realloc(ext->text, new_len + 1);
-    lv_mem_assert(ext->text);
-    if(ext->text == NULL) return;
+    if(lv_mem_get_size(ext->text) < new_len + 1) {
+        ext->text = lv_mem_realloc(ext->text, new_len + 1 + new_len / 4);
+        lv_mem_assert(ext->text);
+        if(ext->text == NULL) return;
+    }
 
     if(pos == LV_LABEL_POS_LAST) {
         pos = lv_txt_get_encoded_length(ext->text);
     }
 
+    uint32_t byte_pos = lv_txt_encoded_get_byte_id(ext->text, pos);
     lv_txt_ins(ext->text, pos, txt);
+    if(ext->ascii != 0 && lv_txt_is_ascii(txt) == false) ext->ascii = 0;
 
-    lv_label_refr_text(label);
+    lv_label_refr_edit(label, byte_pos, ins_len);
 }
 
 /**
@@ -784,14 +853,15 @@ void lv_label_cut_text(lv_obj_t * label, uint32_t pos, uint32_t cnt)
     /*Can not append to static text*/
     if(ext->static_txt != 0) return;
 
-    lv_obj_invalidate(label);
+    char * label_txt  = lv_label_get_text(label);
+    uint32_t byte_pos = lv_txt_encoded_get_byte_id(label_txt, pos);
+    uint32_t byte_cnt = lv_txt_encoded_get_byte_id(&label_txt[byte_pos], cnt);
 
-    char * label_txt = lv_label_get_text(label);
     /*Delete the characters*/
     lv_txt_cut(label_txt, pos, cnt);
 
     /*Refresh the label*/
-    lv_label_refr_text(label);
+    lv_label_refr_edit(label, byte_pos, -(int32_t)byte_cnt);
 }
 
 /**********************
@@ -845,6 +915,7 @@ static bool lv_label_design(lv_obj_t * label, const lv_area_t * mask, lv_design_
         lv_txt_flag_t flag = LV_TXT_FLAG_NONE;
         if(ext->recolor != 0) flag |= LV_TXT_FLAG_RECOLOR;
         if(ext->expand != 0) flag |= LV_TXT_FLAG_EXPAND;
+        if(ext->ascii != 0) flag |= LV_TXT_FLAG_ASCII;
         if(ext->align == LV_LABEL_ALIGN_CENTER) flag |= LV_TXT_FLAG_CENTER;
         if(ext->align == LV_LABEL_ALIGN_RIGHT) flag |= LV_TXT_FLAG_RIGHT;
 
@@ -861,8 +932,10 @@ static bool lv_label_design(lv_obj_t * label, const lv_area_t * mask, lv_design_
             }
         }
 
+        /*The hint also holds the cached line layout of the text so pass it for every label then*/
         lv_draw_label_hint_t * hint = &ext->hint;
-        if(ext->long_mode == LV_LABEL_LONG_SROLL_CIRC || lv_obj_get_height(label) < LV_LABEL_HINT_HEIGHT_LIMIT)
+        if(ext->long_mode == LV_LABEL_LONG_SROLL_CIRC ||
+           (LV_LABEL_LINE_CACHE == 0 && lv_obj_get_height(label) < LV_LABEL_HINT_HEIGHT_LIMIT))
             hint = NULL;
 
         lv_draw_label(&coords, mask, style, opa_scale, ext->text, flag, &ext->offset,
@@ -919,14 +992,22 @@ static lv_res_t lv_label_signal(lv_obj_t * label, lv_signal_t sign, void * param
             ext->text = NULL;
         }
         lv_label_dot_tmp_free(label);
+#if LV_LABEL_LINE_CACHE
+        lv_draw_label_hint_clear(&ext->hint);
+#endif
     } else if(sign == LV_SIGNAL_STYLE_CHG) {
         /*Revert dots for proper refresh*/
         lv_label_revert_dots(label);
 
         lv_label_refr_text(label);
     } else if(sign == LV_SIGNAL_CORD_CHG) {
-        if(lv_area_get_width(&label->coords) != lv_area_get_width(param) ||
-           lv_area_get_height(&label->coords) != lv_area_get_height(param)) {
+        bool w_chg = lv_area_get_width(&label->coords) != lv_area_get_width(param) ? true : false;
+        bool h_chg = lv_area_get_height(&label->coords) != lv_area_get_height(param) ? true : false;
+#if LV_LABEL_LINE_CACHE
+        /*Nothing to refresh if the label got the height of its laid out text*/
+        if(h_chg && lv_label_get_lines_h(label) == lv_obj_get_height(label)) h_chg = false;
+#endif
+        if(w_chg || h_chg) {
             lv_label_revert_dots(label);
             lv_label_refr_text(label);
         }
@@ -961,7 +1042,13 @@ static void lv_label_refr_text(lv_obj_t * label)
 
     if(ext->text == NULL) return;
 
+    /*ASCII text is stepped byte by byte. Characters replaced by dots were checked before*/
+    if(ext->dot_end == LV_LABEL_DOT_END_INV || ext->ascii != 0) ext->ascii = lv_txt_is_ascii(ext->text);
+
     ext->hint.line_start = -1; /*The hint is invalid if the text changes*/
+#if LV_LABEL_LINE_CACHE
+    lv_draw_label_hint_clear(&ext->hint);
+#endif
 
     lv_coord_t max_w         = lv_obj_get_width(label);
     const lv_style_t * style = lv_obj_get_style(label);
@@ -977,6 +1064,7 @@ static void lv_label_refr_text(lv_obj_t * label)
     lv_txt_flag_t flag = LV_TXT_FLAG_NONE;
     if(ext->recolor != 0) flag |= LV_TXT_FLAG_RECOLOR;
     if(ext->expand != 0) flag |= LV_TXT_FLAG_EXPAND;
+    if(ext->ascii != 0) flag |= LV_TXT_FLAG_ASCII;
     lv_txt_get_size(&size, ext->text, font, style->text.letter_space, style->text.line_space, max_w, flag);
 
     /*Set the full size in expand mode*/
@@ -1113,6 +1201,108 @@ static void lv_label_refr_text(lv_obj_t * label)
     lv_obj_invalidate(label);
 }
 
+/**
+ * Refresh the label after its text was edited
+ * @param label pointer to a label object
+ * @param pos byte index of the edit
+ * @param len number of bytes inserted at `pos` or the negative number of bytes removed from `pos`
+ */
+static void lv_label_refr_edit(lv_obj_t * label, uint32_t pos, int32_t len)
+{
+    lv_label_ext_t * ext = lv_obj_get_ext_attr(label);
+
+#if LV_LABEL_LINE_CACHE
+    /*In break mode only the lines around the edit need to be laid out and redrawn again if the lines
+     *are laid out with the current settings*/
+    const lv_style_t * style = lv_obj_get_style(label);
+    uint32_t first;
+    uint32_t last;
+    if(ext->long_mode == LV_LABEL_LONG_BREAK && ext->hint.lines != NULL && ext->hint.font == style->text.font &&
+       ext->hint.letter_space == style->text.letter_space && ext->hint.w == lv_obj_get_width(label) &&
+       ext->hint.flag == lv_label_get_draw_flag(label) &&
+       lv_draw_label_hint_edit(&ext->hint, ext->text, pos, len, &first, &last)) {
+        ext->hint.line_start = -1;
+
+        lv_coord_t line_h = lv_font_get_line_height(style->text.font) + style->text.line_space;
+        lv_coord_t h      = lv_label_get_lines_h(label);
+        if(h != lv_obj_get_height(label)) {
+            lv_obj_invalidate(label);
+            lv_obj_set_height(label, h);
+        } else {
+            lv_area_t area;
+            area.x1 = label->coords.x1;
+            area.x2 = label->coords.x2;
+            area.y1 = label->coords.y1 + first * line_h;
+            area.y2 = label->coords.y1 + (last + 1) * line_h - 1;
+            lv_obj_invalidate_area(label, &area);
+        }
+        return;
+    }
+#endif
+
+    lv_obj_invalidate(label);
+    lv_label_refr_text(label);
+}
+
+#if LV_LABEL_LINE_CACHE
+/**
+ * Get the text flags a label is drawn with (in other than the roll modes)
+ * @param label pointer to a label object
+ * @return the flags from `lv_txt_flag_t`
+ */
+static lv_txt_flag_t lv_label_get_draw_flag(const lv_obj_t * label)
+{
+    lv_label_ext_t * ext = lv_obj_get_ext_attr(label);
+    lv_txt_flag_t flag   = LV_TXT_FLAG_NONE;
+    if(ext->recolor != 0) flag |= LV_TXT_FLAG_RECOLOR;
+    if(ext->expand != 0) flag |= LV_TXT_FLAG_EXPAND;
+    if(ext->ascii != 0) flag |= LV_TXT_FLAG_ASCII;
+    if(ext->align == LV_LABEL_ALIGN_CENTER) flag |= LV_TXT_FLAG_CENTER;
+    if(ext->align == LV_LABEL_ALIGN_RIGHT) flag |= LV_TXT_FLAG_RIGHT;
+    return flag;
+}
+
+/**
+ * Get the line layout a label in break mode is drawn with. Lay out its text if it's not cached.
+ * @param label pointer to a label object
+ * @return the line layout (see `lv_draw_label_hint_lines`) or NULL if it can't be cached
+ */
+static const uint32_t * lv_label_get_lines(const lv_obj_t * label)
+{
+    lv_label_ext_t * ext     = lv_obj_get_ext_attr(label);
+    const lv_style_t * style = lv_obj_get_style(label);
+    if(ext->long_mode != LV_LABEL_LONG_BREAK || ext->text == NULL) return NULL;
+    if(lv_font_get_line_height(style->text.font) + style->text.line_space <= 0) return NULL;
+
+    return lv_draw_label_hint_lines(&ext->hint, ext->text, style->text.font, style->text.letter_space,
+                                    lv_obj_get_width(label), lv_label_get_draw_flag(label));
+}
+
+/**
+ * Get the height of the text of a label in break mode from its cached line layout.
+ * It's the height `lv_txt_get_size` gives.
+ * @param label pointer to a label object
+ * @return the height or -1 if the lines are not laid out with the current settings
+ */
+static lv_coord_t lv_label_get_lines_h(const lv_obj_t * label)
+{
+    lv_label_ext_t * ext     = lv_obj_get_ext_attr(label);
+    const lv_style_t * style = lv_obj_get_style(label);
+    if(ext->long_mode != LV_LABEL_LONG_BREAK || ext->hint.lines == NULL || ext->hint.txt != ext->text ||
+       ext->hint.font != style->text.font || ext->hint.letter_space != style->text.letter_space ||
+       ext->hint.w != lv_obj_get_width(label) || ext->hint.flag != lv_label_get_draw_flag(label)) {
+        return -1;
+    }
+
+    lv_coord_t line_h = lv_font_get_line_height(style->text.font) + style->text.line_space;
+    uint32_t txt_len  = ext->hint.lines[ext->hint.line_cnt];
+    lv_coord_t h      = ext->hint.line_cnt * line_h;
+    if(ext->text[txt_len - 1] == '\n' || ext->text[txt_len - 1] == '\r') h += line_h;
+
+    return h - style->text.line_space;
+}
+#endif
+
 static void lv_label_revert_dots(lv_obj_t * label)
 {
     lv_label_ext_t * ext = lv_obj_get_ext_attr(label);
@@ -85,6 +85,7 @@ typedef struct
 
     lv_label_long_mode_t long_mode : 3; /*Determinate what to do with the long texts*/
     uint8_t static_txt : 1;             /*Flag to indicate the text is static*/
+    uint8_t ascii : 1;                  /*The text has only 7 bit characters (see `LV_TXT_FLAG_ASCII`)*/
     uint8_t align : 2;                  /*Align type from 'lv_label_align_t'*/
     uint8_t recolor : 1;                /*Enable in-line letter re-coloring*/
     uint8_t expand : 1;                 /*Ignore real width (used by the library with LV_LABEL_LONG_ROLL)*/
@@ -300,6 +301,17 @@ uint16_t lv_label_get_text_sel_start(const lv_obj_t * label);
  */
 uint16_t lv_label_get_text_sel_end(const lv_obj_t * label);
 
+/**
+ * Get the hint to draw the text of a label again with `lv_draw_label`, e.g. a highlighted part of it,
+ * with the line layout the label cached so only the visible lines are laid out.
+ * @param label pointer to a label object
+ * @param style the style the text will be drawn with
+ * @param flag the text flags the text will be drawn with. Replaced with the label's own if the hint
+ * can be used.
+ * @return the hint or NULL if the text has to be laid out again
+ */
+lv_draw_label_hint_t * lv_label_get_draw_hint(const lv_obj_t * label, const lv_style_t * style, lv_txt_flag_t * flag);
+
 /*=====================
  * Other functions
  *====================*/
@@ -18,6 +18,7 @@
  *      DEFINES
  *********************/
 #define LV_LIST_LAYOUT_DEF LV_LAYOUT_COL_M
+#define LV_LIST_VIRT_EXTRA 2 /*Rows of a virtual list kept with buttons beyond each end of the view*/
 
 #if LV_USE_ANIMATION == 0
 #undef LV_LIST_DEF_ANIM_TIME
@@ -37,6 +38,8 @@ static void lv_list_btn_single_select(lv_obj_t * btn);
 static bool lv_list_is_list_btn(lv_obj_t * list_btn);
 static bool lv_list_is_list_img(lv_obj_t * list_btn);
 static bool lv_list_is_list_label(lv_obj_t * list_btn);
+static lv_res_t lv_list_scrl_signal(lv_obj_t * scrl, lv_signal_t sign, void * param);
+static void lv_list_virt_refr(lv_obj_t * list, bool refill);
 
 /**********************
  *  STATIC VARIABLES
@@ -47,6 +50,7 @@ static lv_signal_cb_t img_signal;
 static lv_signal_cb_t label_signal;
 static lv_signal_cb_t ancestor_page_signal;
 static lv_signal_cb_t ancestor_btn_signal;
+static lv_signal_cb_t ancestor_scrl_signal;
 #if LV_USE_GROUP
 /*Used to make the last clicked button pressed (selected) when the list become focused and
  * `click_focus == 1`*/
@@ -90,6 +94,12 @@ lv_obj_t * lv_list_create(lv_obj_t * par, const lv_obj_t * copy)
     ext->styles_btn[LV_BTN_STATE_INA]     = &lv_style_btn_ina;
     ext->single_mode                      = false;
     ext->size                             = 0;
+    ext->item_refr_ip                     = 0;
+    ext->item_cb                          = NULL;
+    ext->item_cnt                         = 0;
+    ext->item_base                        = 0;
+    ext->item_rows                        = 0;
+    ext->item_pitch                       = 0;
 
 #if LV_USE_GROUP
     ext->last_sel     = NULL;
@@ -366,6 +376,48 @@ void lv_list_set_style(lv_obj_t * list, lv_list_style_t type, const lv_style_t *
     }
 }
 
+/**
+ * Make a list virtual: it shows `cnt` items but has buttons only for the rows in view and a few
+ * around them. As the list scrolls, the buttons leaving the view are given to the items coming
+ * into it. The existing buttons are deleted.
+ * @param list pointer to a list object
+ * @param cnt number of items. Can be called again to change it (the buttons are filled again).
+ * @param item_cb sets the text (and anything else) of a button to show an item.
+ *                Every button has to be as high as the first item's.
+ *                NULL to make the list ordinary again.
+ */
+void lv_list_set_virtual(lv_obj_t * list, uint32_t cnt, lv_list_item_cb_t item_cb)
+{
+    lv_list_ext_t * ext = lv_obj_get_ext_attr(list);
+    lv_obj_t * scrl     = lv_page_get_scrl(list);
+
+    if(item_cb == NULL) {
+        if(ext->item_cb == NULL) return;
+        ext->item_cb  = NULL;
+        ext->item_cnt = 0;
+        lv_obj_set_signal_cb(scrl, ancestor_scrl_signal);
+        lv_list_clean(list);
+        lv_page_set_scrl_fit2(list, LV_FIT_FLOOD, LV_FIT_TIGHT);
+        lv_page_set_scrl_layout(list, LV_LIST_LAYOUT_DEF);
+        return;
+    }
+
+    if(ext->item_cb == NULL) {
+        /*The list places the buttons, a layout or fit would need all the items*/
+        lv_list_clean(list);
+        lv_page_set_scrl_layout(list, LV_LAYOUT_OFF);
+        lv_page_set_scrl_fit2(list, LV_FIT_FLOOD, LV_FIT_NONE);
+        if(ancestor_scrl_signal == NULL) ancestor_scrl_signal = lv_obj_get_signal_cb(scrl);
+        lv_obj_set_signal_cb(scrl, lv_list_scrl_signal);
+        ext->item_base  = 0;
+        ext->item_pitch = 0;
+    }
+
+    ext->item_cb  = item_cb;
+    ext->item_cnt = cnt;
+    lv_list_virt_refr(list, true);
+}
+
 /*=====================
  * Getter functions
  *====================*/
@@ -518,6 +570,21 @@ uint16_t lv_list_get_size(const lv_obj_t * list)
     return ext->size;
 }
 
+/**
+ * Get the item a button of a virtual list shows
+ * @param list pointer to a virtual list
+ * @param btn pointer to a button of the list
+ * @return the index of the item
+ */
+uint32_t lv_list_get_btn_item(const lv_obj_t * list, const lv_obj_t * btn)
+{
+    lv_list_ext_t * ext            = lv_obj_get_ext_attr(list);
+    const lv_style_t * scrl_style = lv_obj_get_style(lv_page_get_scrl(list));
+    if(ext->item_pitch == 0) return 0;
+
+    return ext->item_base + (lv_obj_get_y(btn) - scrl_style->body.padding.top) / ext->item_pitch;
+}
+
 #if LV_USE_GROUP
 /**
  * Get the currently selected button
@@ -664,6 +731,41 @@ void lv_list_focus(const lv_obj_t * btn, lv_anim_enable_t anim)
     lv_page_focus(list, btn, anim == LV_ANIM_OFF ? 0 : lv_list_get_anim_time(list));
 }
 
+/**
+ * Scroll a virtual list to show an item at its top (or as near as it can be)
+ * @param list pointer to a virtual list
+ * @param index index of the item
+ */
+void lv_list_show_item(lv_obj_t * list, uint32_t index)
+{
+    lv_list_ext_t * ext = lv_obj_get_ext_attr(list);
+    if(ext->item_cb == NULL || index >= ext->item_cnt || ext->item_pitch == 0) return;
+
+    lv_obj_t * scrl               = lv_page_get_scrl(list);
+    const lv_style_t * bg_style   = lv_obj_get_style(list);
+    const lv_style_t * scrl_style = lv_obj_get_style(scrl);
+
+    /*Put the item in the middle of the window of rows*/
+    uint32_t base = index > ext->item_rows / 2 ? index - ext->item_rows / 2 : 0;
+    if(base + ext->item_rows > ext->item_cnt) base = ext->item_cnt - ext->item_rows;
+
+    ext->item_refr_ip = 1;
+    if(base != ext->item_base) {
+        /*Every row gets an other item*/
+        lv_obj_t * btn = lv_list_get_next_btn(list, NULL);
+        while(btn) {
+            lv_obj_set_hidden(btn, true);
+            btn = lv_list_get_next_btn(list, btn);
+        }
+        ext->item_base = base;
+    }
+    lv_obj_set_y(scrl, bg_style->body.padding.top - scrl_style->body.padding.top -
+                           (lv_coord_t)(index - base) * ext->item_pitch);
+    ext->item_refr_ip = 0;
+
+    lv_list_virt_refr(list, false);
+}
+
 /**********************
  *   STATIC FUNCTIONS
  **********************/
@@ -679,6 +781,13 @@ static lv_res_t lv_list_signal(lv_obj_t * list, lv_signal_t sign, void * param)
 {
     lv_res_t res;
 
+    /*The buttons of a virtual list get other items while the scrollable moves under them so the
+     *pixels of the scrollable can't be moved with it*/
+    if(sign == LV_SIGNAL_CHILD_MOVE) {
+        lv_list_ext_t * ext = lv_obj_get_ext_attr(list);
+        if(ext->item_refr_ip) return LV_RES_OK;
+    }
+
     /* Include the ancient signal function */
     res = ancestor_page_signal(list, sign, param);
     if(res != LV_RES_OK) return res;
@@ -816,6 +925,14 @@ static lv_res_t lv_list_signal(lv_obj_t * list, lv_signal_t sign, void * param)
             if(buf->type[i] == NULL) break;
         }
         buf->type[i] = "lv_list";
+    } else if(sign == LV_SIGNAL_CORD_CHG) {
+        /*More or less rows can be in view*/
+        if(lv_obj_get_height(list) != lv_area_get_height(param)) lv_list_virt_refr(list, false);
+    } else if(sign == LV_SIGNAL_STYLE_CHG) {
+        /*The buttons can be an other height*/
+        lv_list_ext_t * ext = lv_obj_get_ext_attr(list);
+        ext->item_pitch     = 0;
+        lv_list_virt_refr(list, true);
     }
     return res;
 }
@@ -952,4 +1069,160 @@ static bool lv_list_is_list_img(lv_obj_t * list_img)
     return false;
 }
 
+/**
+ * Signal function of the scrollable part of a virtual list
+ * @param scrl pointer to the scrollable of a virtual list
+ * @param sign a signal type from lv_signal_t enum
+ * @param param pointer to a signal specific variable
+ * @return LV_RES_OK: the object is not deleted in the function; LV_RES_INV: the object is deleted
+ */
+static lv_res_t lv_list_scrl_signal(lv_obj_t * scrl, lv_signal_t sign, void * param)
+{
+    lv_res_t res;
+
+    /* Include the ancient signal function */
+    res = ancestor_scrl_signal(scrl, sign, param);
+    if(res != LV_RES_OK) return res;
+
+    if(sign == LV_SIGNAL_CORD_CHG) {
+        /*Other rows came into view*/
+        lv_list_virt_refr(lv_obj_get_parent(scrl), false);
+    }
+
+    return res;
+}
+
+/**
+ * Give the buttons of a virtual list to the rows in view and a few around them.
+ * Move the window of rows along the items if the view is near its end.
+ * @param list pointer to a list object
+ * @param refill true: call `item_cb` for the buttons which keep their row too (the items changed)
+ */
+static void lv_list_virt_refr(lv_obj_t * list, bool refill)
+{
+    lv_list_ext_t * ext = lv_obj_get_ext_attr(list);
+    if(ext->item_cb == NULL || ext->item_refr_ip) return;
+    ext->item_refr_ip = 1;
+
+    lv_obj_t * scrl               = lv_page_get_scrl(list);
+    const lv_style_t * bg_style   = lv_obj_get_style(list);
+    const lv_style_t * scrl_style = lv_obj_get_style(scrl);
+    lv_obj_t * btn;
+
+    /*Measure a button with the first item. The rows of the buttons are lost so free all of them.*/
+    if(ext->item_pitch == 0 && ext->item_cnt > 0) {
+        btn = lv_list_get_next_btn(list, NULL);
+        while(btn) {
+            lv_obj_set_hidden(btn, true);
+            btn = lv_list_get_next_btn(list, btn);
+        }
+        btn = lv_list_get_next_btn(list, NULL);
+        if(btn == NULL) {
+            btn = lv_list_add_btn(list, NULL, "");
+            lv_obj_set_hidden(btn, true);
+        }
+        ext->item_cb(list, btn, 0);
+        ext->item_pitch = lv_obj_get_height(btn) + scrl_style->body.padding.inner;
+        if(ext->item_pitch < 1) ext->item_pitch = 1;
+    }
+
+    /*The scrollable holds a window of rows because the coordinates can't reach the end of a long
+     *list*/
+    uint32_t rows = ext->item_cnt;
+    if(ext->item_pitch > 0 && rows > (uint32_t)(LV_COORD_MAX / 2) / ext->item_pitch) {
+        rows = (LV_COORD_MAX / 2) / ext->item_pitch;
+    }
+    if(ext->item_base + rows > ext->item_cnt) {
+        ext->item_base = ext->item_cnt - rows;
+        refill         = true;
+    }
+    ext->item_rows = rows;
+
+    lv_coord_t h = scrl_style->body.padding.top + scrl_style->body.padding.bottom;
+    if(rows > 0) h += (lv_coord_t)rows * ext->item_pitch - scrl_style->body.padding.inner;
+    lv_obj_set_height(scrl, h);
+
+    if(rows == 0) {
+        btn = lv_list_get_next_btn(list, NULL);
+        while(btn) {
+            lv_obj_set_hidden(btn, true);
+            btn = lv_list_get_next_btn(list, btn);
+        }
+        ext->item_refr_ip = 0;
+        return;
+    }
+
+    /*Rows in view*/
+    lv_coord_t pitch    = ext->item_pitch;
+    lv_coord_t view_top = list->coords.y1 + bg_style->body.padding.top - scrl->coords.y1 -
+                          scrl_style->body.padding.top;
+    lv_coord_t view_h = lv_obj_get_height(list) - bg_style->body.padding.top - bg_style->body.padding.bottom;
+    int32_t first     = view_top > 0 ? view_top / pitch : 0;
+    int32_t last      = view_top + view_h > 0 ? (view_top + view_h) / pitch : 0;
+    int32_t shown     = last - first + 1;
+
+    /*Near an end of the window move it to have the view in its middle.
+     *The rows of the buttons and the scrollable move the opposite ways so nothing moves on the
+     *display.*/
+    if((first < shown && ext->item_base > 0) ||
+       (last >= (int32_t)rows - shown && ext->item_base + rows < ext->item_cnt)) {
+        int32_t base = (int32_t)ext->item_base + first - ((int32_t)rows - shown) / 2;
+        if(base > (int32_t)(ext->item_cnt - rows)) base = ext->item_cnt - rows;
+        if(base < 0) base = 0;
+        int32_t shift = base - (int32_t)ext->item_base;
+        if(shift != 0) {
+            lv_coord_t dy = shift * pitch;
+            btn           = lv_list_get_next_btn(list, NULL);
+            while(btn) {
+                lv_obj_set_y(btn, lv_obj_get_y(btn) - dy);
+                btn = lv_list_get_next_btn(list, btn);
+            }
+            lv_obj_set_y(scrl, lv_obj_get_y(scrl) + dy);
+            ext->item_base = base;
+            first -= shift;
+            last -= shift;
+        }
+    }
+
+    int32_t r_first = LV_MATH_MAX(first - LV_LIST_VIRT_EXTRA, 0);
+    int32_t r_last  = LV_MATH_MIN(last + LV_LIST_VIRT_EXTRA, (int32_t)rows - 1);
+
+    /*Free the buttons of the rows far from the view*/
+    btn = lv_list_get_next_btn(list, NULL);
+    while(btn) {
+        if(lv_obj_get_hidden(btn) == false) {
+            int32_t r = (lv_obj_get_y(btn) - scrl_style->body.padding.top) / pitch;
+            if(r < r_first || r > r_last) lv_obj_set_hidden(btn, true);
+        }
+        btn = lv_list_get_next_btn(list, btn);
+    }
+
+    /*Give a button to the rows around the view which don't have one*/
+    int32_t r;
+    for(r = r_first; r <= r_last; r++) {
+        lv_coord_t y       = scrl_style->body.padding.top + r * pitch;
+        lv_obj_t * btn_free = NULL;
+        btn                 = lv_list_get_next_btn(list, NULL);
+        while(btn) {
+            if(lv_obj_get_hidden(btn)) {
+                if(btn_free == NULL) btn_free = btn;
+            } else if(lv_obj_get_y(btn) == y) {
+                break;
+            }
+            btn = lv_list_get_next_btn(list, btn);
+        }
+
+        if(btn == NULL) {
+            btn = btn_free ? btn_free : lv_list_add_btn(list, NULL, "");
+            lv_obj_set_y(btn, y);
+            lv_obj_set_hidden(btn, false);
+            ext->item_cb(list, btn, ext->item_base + r);
+        } else if(refill) {
+            ext->item_cb(list, btn, ext->item_base + r);
+        }
+    }
+
+    ext->item_refr_ip = 0;
+}
+
 #endif
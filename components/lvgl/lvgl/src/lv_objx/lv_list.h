@@ -47,6 +47,9 @@ extern "C" {
 /**********************
  *      TYPEDEFS
  **********************/
+/** Fills a button of a virtual list with an item, see `lv_list_set_virtual`*/
+typedef void (*lv_list_item_cb_t)(lv_obj_t * list, lv_obj_t * btn, uint32_t index);
+
 /*Data of list*/
 typedef struct
 {
@@ -57,6 +60,13 @@ typedef struct
     uint16_t size;                                    /*the number of items(buttons) in the list*/
 
     uint8_t single_mode : 1; /* whether single selected mode is enabled */
+    uint8_t item_refr_ip : 1; /*1: the buttons of a virtual list are being rearranged*/
+
+    lv_list_item_cb_t item_cb; /*Fills the buttons of a virtual list, NULL if the list isn't virtual*/
+    uint32_t item_cnt;         /*Number of items of a virtual list*/
+    uint32_t item_base;        /*Item on the first row of the scrollable*/
+    uint16_t item_rows;        /*Number of rows the scrollable has room for*/
+    lv_coord_t item_pitch;     /*Height of a button and the gap after it, 0 if not measured yet*/
 
 #if LV_USE_GROUP
     lv_obj_t * last_sel;     /* The last selected button. It will be reverted when the list is focused again */
@@ -129,6 +139,21 @@ bool lv_list_remove(const lv_obj_t * list, uint16_t index);
  */
 void lv_list_set_single_mode(lv_obj_t * list, bool mode);
 
+/**
+ * Make a list virtual: it shows `cnt` items but has buttons only for the rows in view and a few
+ * around them. As the list scrolls, the buttons leaving the view are given to the items coming
+ * into it. The existing buttons are deleted.
+ * A virtual list has a window of rows in its scrollable which is moved along the items when the
+ * view gets near its end, so the scroll bar shows the position in this window only.
+ * Keypad navigation and `lv_list_focus` work with the buttons which exist.
+ * @param list pointer to a list object
+ * @param cnt number of items. Can be called again to change it (the buttons are filled again).
+ * @param item_cb sets the text (and anything else) of a button to show an item.
+ *                Every button has to be as high as the first item's.
+ *                NULL to make the list ordinary again.
+ */
+void lv_list_set_virtual(lv_obj_t * list, uint32_t cnt, lv_list_item_cb_t item_cb);
+
 #if LV_USE_GROUP
 
 /**
@@ -250,6 +275,14 @@ int32_t lv_list_get_btn_index(const lv_obj_t * list, const lv_obj_t * btn);
  */
 uint16_t lv_list_get_size(const lv_obj_t * list);
 
+/**
+ * Get the item a button of a virtual list shows
+ * @param list pointer to a virtual list
+ * @param btn pointer to a button of the list
+ * @return the index of the item
+ */
+uint32_t lv_list_get_btn_item(const lv_obj_t * list, const lv_obj_t * btn);
+
 #if LV_USE_GROUP
 /**
  * Get the currently selected button. Can be used while navigating in the list with a keypad.
@@ -329,6 +362,13 @@ void lv_list_down(const lv_obj_t * list);
  */
 void lv_list_focus(const lv_obj_t * btn, lv_anim_enable_t anim);
 
+/**
+ * Scroll a virtual list to show an item at its top (or as near as it can be)
+ * @param list pointer to a virtual list
+ * @param index index of the item
+ */
+void lv_list_show_item(lv_obj_t * list, uint32_t index);
+
 /**********************
  *      MACROS
  **********************/
@@ -13,6 +13,8 @@
 #include "../lv_themes/lv_theme.h"
 #include "../lv_core/lv_group.h"
 #include "../lv_misc/lv_math.h"
+#include "../lv_core/lv_refr.h"
+#include <string.h>
 
 /*********************
  *      DEFINES
@@ -20,6 +22,21 @@
 #define LV_LMETER_LINE_UPSCALE 5 /*2^x upscale of line to make rounding*/
 #define LV_LMETER_LINE_UPSCALE_MASK ((1 << LV_LMETER_LINE_UPSCALE) - 1)
 
+#if LV_LMETER_LAYER
+#define LV_LMETER_LAYER_BAND 16 /*The layer is blitted in bands of this many rows...*/
+#define LV_LMETER_LAYER_RUNS 4  /*...and at most this many parts in a band, leaving out the transparent columns*/
+#define LV_LMETER_LAYER_GAP 16  /*Transparent columns narrower than this are blitted with the parts around them*/
+
+#if LV_IMG_CACHE_CUSTOM
+#include LV_IMG_CACHE_CUSTOM_INCLUDE
+#define LAYER_ALLOC(size) LV_IMG_CACHE_CUSTOM_ALLOC(size)
+#define LAYER_FREE(p) LV_IMG_CACHE_CUSTOM_FREE(p)
+#else
+#define LAYER_ALLOC(size) lv_mem_alloc(size)
+#define LAYER_FREE(p) lv_mem_free(p)
+#endif
+#endif
+
 /**********************
  *      TYPEDEFS
  **********************/
@@ -29,7 +46,16 @@
  **********************/
 static bool lv_lmeter_design(lv_obj_t * lmeter, const lv_area_t * mask, lv_design_mode_t mode);
 static lv_res_t lv_lmeter_signal(lv_obj_t * lmeter, lv_signal_t sign, void * param);
+static void lv_lmeter_draw_lines(lv_obj_t * lmeter, const lv_area_t * mask);
+static int16_t lv_lmeter_get_level(const lv_lmeter_ext_t * ext);
 static lv_coord_t lv_lmeter_coord_round(int32_t x);
+#if LV_LMETER_LAYER
+static bool lv_lmeter_render_layer(lv_obj_t * lmeter, const lv_area_t * area, lv_lmeter_layer_cb_t render_cb);
+static void lv_lmeter_find_layer_parts(lv_obj_t * lmeter);
+static void lv_lmeter_free_layer(lv_obj_t * lmeter);
+static void lv_lmeter_layer_set_px(lv_disp_drv_t * disp_drv, uint8_t * buf, lv_coord_t buf_w, lv_coord_t x,
+                                   lv_coord_t y, lv_color_t color, lv_opa_t opa);
+#endif
 
 /**********************
  *  STATIC VARIABLES
@@ -73,6 +99,12 @@ lv_obj_t * lv_lmeter_create(lv_obj_t * par, const lv_obj_t * copy)
     ext->cur_value   = 0;
     ext->line_cnt    = 21;  /*Odd scale number looks better*/
     ext->scale_angle = 240; /*(scale_num - 1) * N looks better */
+#if LV_LMETER_LAYER
+    memset(&ext->layer, 0, sizeof(ext->layer));
+    ext->layer_parts     = NULL;
+    ext->layer_part_cnt  = 0;
+    ext->layer_rendering = 0;
+#endif
 
     /*The signal and design functions are not copied so set them here*/
     lv_obj_set_signal_cb(new_lmeter, lv_lmeter_signal);
@@ -140,6 +172,9 @@ void lv_lmeter_set_range(lv_obj_t * lmeter, int16_t min, int16_t max)
 
     ext->max_value = max;
     ext->min_value = min;
+#if LV_LMETER_LAYER
+    lv_lmeter_invalidate_layer(lmeter);
+#endif
     if(ext->cur_value > max) {
         ext->cur_value = max;
         lv_lmeter_set_value(lmeter, ext->cur_value);
@@ -164,6 +199,9 @@ void lv_lmeter_set_scale(lv_obj_t * lmeter, uint16_t angle, uint8_t line_cnt)
 
     ext->scale_angle = angle;
     ext->line_cnt    = line_cnt;
+#if LV_LMETER_LAYER
+    lv_lmeter_invalidate_layer(lmeter);
+#endif
 
     lv_obj_invalidate(lmeter);
 }
@@ -227,6 +265,80 @@ uint16_t lv_lmeter_get_scale_angle(const lv_obj_t * lmeter)
     return ext->scale_angle;
 }
 
+#if LV_LMETER_LAYER
+
+/*=====================
+ * Other functions
+ *====================*/
+
+/**
+ * Draw the static part of a line meter from its pre-rendered layer.
+ * The layer is rendered with `render_cb` first if it's missing or outdated.
+ * If there is no memory for it `render_cb` draws directly.
+ * @param lmeter pointer to a line meter object
+ * @param mask the object is drawn only in this area
+ * @param render_cb draws the static part (the line meter's design while rendering)
+ */
+void lv_lmeter_draw_layer(lv_obj_t * lmeter, const lv_area_t * mask, lv_lmeter_layer_cb_t render_cb)
+{
+    lv_lmeter_ext_t * ext = lv_obj_get_ext_attr(lmeter);
+
+    /*The lines can be out of the object by their width*/
+    lv_area_t area;
+    lv_obj_get_coords(lmeter, &area);
+    area.x1 -= lmeter->ext_draw_pad;
+    area.y1 -= lmeter->ext_draw_pad;
+    area.x2 += lmeter->ext_draw_pad;
+    area.y2 += lmeter->ext_draw_pad;
+
+    bool focused = false;
+#if LV_USE_GROUP
+    lv_group_t * g = lv_obj_get_group(lmeter);
+    focused        = lv_group_get_focused(g) == lmeter;
+#endif
+    bool aa            = lv_disp_get_antialiasing(lv_refr_get_disp_refreshing());
+    lv_opa_t opa_scale = lv_obj_get_opa_scale(lmeter);
+
+    if(ext->layer.data == NULL || memcmp(&area, &ext->layer_area, sizeof(lv_area_t)) != 0 ||
+       ext->layer_level != lv_lmeter_get_level(ext) || ext->layer_opa_scale != opa_scale ||
+       ext->layer_focused != focused || ext->layer_aa != aa) {
+        if(lv_lmeter_render_layer(lmeter, &area, render_cb) == false) {
+            /*No memory for the layer: draw as without it*/
+            ext->layer_rendering = 1;
+            render_cb(lmeter, mask);
+            ext->layer_rendering = 0;
+            return;
+        }
+        ext->layer_level     = lv_lmeter_get_level(ext);
+        ext->layer_opa_scale = opa_scale;
+        ext->layer_focused   = focused ? 1 : 0;
+        ext->layer_aa        = aa ? 1 : 0;
+    }
+
+    /*Blit only the parts with something drawn. The opacity scale is in the layer already.*/
+    uint16_t i;
+    for(i = 0; i < ext->layer_part_cnt; i++) {
+        lv_area_t part_mask;
+        if(lv_area_intersect(&part_mask, mask, &ext->layer_parts[i]) == false) continue;
+
+        lv_draw_map(&ext->layer_area, &part_mask, ext->layer.data, LV_OPA_COVER, false, true, LV_COLOR_BLACK,
+                    LV_OPA_TRANSP);
+    }
+}
+
+/**
+ * Render the layer of a line meter again when it's drawn the next time.
+ * Call it if something drawn in the layer changed.
+ * @param lmeter pointer to a line meter object
+ */
+void lv_lmeter_invalidate_layer(lv_obj_t * lmeter)
+{
+    lv_lmeter_ext_t * ext = lv_obj_get_ext_attr(lmeter);
+    lv_area_set(&ext->layer_area, 0, 0, -1, -1);
+}
+
+#endif
+
 /**********************
  *   STATIC FUNCTIONS
  **********************/
@@ -249,70 +361,14 @@ static bool lv_lmeter_design(lv_obj_t * lmeter, const lv_area_t * mask, lv_desig
     }
     /*Draw the object*/
     else if(mode == LV_DESIGN_DRAW_MAIN) {
-        lv_lmeter_ext_t * ext    = lv_obj_get_ext_attr(lmeter);
-        const lv_style_t * style = lv_obj_get_style(lmeter);
-        lv_opa_t opa_scale       = lv_obj_get_opa_scale(lmeter);
-        lv_style_t style_tmp;
-        lv_style_copy(&style_tmp, style);
-
-#if LV_USE_GROUP
-        lv_group_t * g = lv_obj_get_group(lmeter);
-        if(lv_group_get_focused(g) == lmeter) {
-            style_tmp.line.width += 1;
+#if LV_LMETER_LAYER
+        lv_lmeter_ext_t * ext = lv_obj_get_ext_attr(lmeter);
+        if(ext->layer_rendering == 0) {
+            lv_lmeter_draw_layer(lmeter, mask, lv_lmeter_draw_lines);
+            return true;
         }
 #endif
-
-        lv_coord_t r_out = lv_obj_get_width(lmeter) / 2;
-        lv_coord_t r_in  = r_out - style->body.padding.left;
-        if(r_in < 1) r_in = 1;
-
-        lv_coord_t x_ofs  = lv_obj_get_width(lmeter) / 2 + lmeter->coords.x1;
-        lv_coord_t y_ofs  = lv_obj_get_height(lmeter) / 2 + lmeter->coords.y1;
-        int16_t angle_ofs = 90 + (360 - ext->scale_angle) / 2;
-        int16_t level =
-            (int32_t)((int32_t)(ext->cur_value - ext->min_value) * ext->line_cnt) / (ext->max_value - ext->min_value);
-        uint8_t i;
-
-        style_tmp.line.color = style->body.main_color;
-
-        /*Calculate every coordinate in a bigger size to make rounding later*/
-        r_out = r_out << LV_LMETER_LINE_UPSCALE;
-        r_in  = r_in << LV_LMETER_LINE_UPSCALE;
-
-        for(i = 0; i < ext->line_cnt; i++) {
-            /*Calculate the position a scale label*/
-            int16_t angle = (i * ext->scale_angle) / (ext->line_cnt - 1) + angle_ofs;
-
-            lv_coord_t y_out = (int32_t)((int32_t)lv_trigo_sin(angle) * r_out) >> LV_TRIGO_SHIFT;
-            lv_coord_t x_out = (int32_t)((int32_t)lv_trigo_sin(angle + 90) * r_out) >> LV_TRIGO_SHIFT;
-            lv_coord_t y_in  = (int32_t)((int32_t)lv_trigo_sin(angle) * r_in) >> LV_TRIGO_SHIFT;
-            lv_coord_t x_in  = (int32_t)((int32_t)lv_trigo_sin(angle + 90) * r_in) >> LV_TRIGO_SHIFT;
-
-            /*Rounding*/
-            x_out = lv_lmeter_coord_round(x_out);
-            x_in  = lv_lmeter_coord_round(x_in);
-            y_out = lv_lmeter_coord_round(y_out);
-            y_in  = lv_lmeter_coord_round(y_in);
-
-            lv_point_t p1;
-            lv_point_t p2;
-
-            p2.x = x_in + x_ofs;
-            p2.y = y_in + y_ofs;
-
-            p1.x = x_out + x_ofs;
-            p1.y = y_out + y_ofs;
-
-            if(i >= level)
-                style_tmp.line.color = style->line.color;
-            else {
-                style_tmp.line.color =
-                    lv_color_mix(style->body.grad_color, style->body.main_color, (255 * i) / ext->line_cnt);
-            }
-
-            lv_draw_line(&p1, &p2, mask, &style_tmp, opa_scale);
-        }
-
+        lv_lmeter_draw_lines(lmeter, mask);
     }
     /*Post draw when the children are drawn*/
     else if(mode == LV_DESIGN_DRAW_POST) {
@@ -337,9 +393,14 @@ static lv_res_t lv_lmeter_signal(lv_obj_t * lmeter, lv_signal_t sign, void * par
     if(res != LV_RES_OK) return res;
 
     if(sign == LV_SIGNAL_CLEANUP) {
-        /*Nothing to cleanup. (No dynamically allocated memory in 'ext')*/
+#if LV_LMETER_LAYER
+        lv_lmeter_free_layer(lmeter);
+#endif
     } else if(sign == LV_SIGNAL_STYLE_CHG) {
         lv_obj_refresh_ext_draw_pad(lmeter);
+#if LV_LMETER_LAYER
+        lv_lmeter_invalidate_layer(lmeter);
+#endif
     } else if(sign == LV_SIGNAL_REFR_EXT_DRAW_PAD) {
         const lv_style_t * style = lv_lmeter_get_style(lmeter, LV_LMETER_STYLE_MAIN);
         lmeter->ext_draw_pad     = LV_MATH_MAX(lmeter->ext_draw_pad, style->line.width);
@@ -355,6 +416,87 @@ static lv_res_t lv_lmeter_signal(lv_obj_t * lmeter, lv_signal_t sign, void * par
     return res;
 }
 
+/**
+ * Draw the lines of a line meter
+ * @param lmeter pointer to a line meter object
+ * @param mask the lines are drawn only in this area
+ */
+static void lv_lmeter_draw_lines(lv_obj_t * lmeter, const lv_area_t * mask)
+{
+    lv_lmeter_ext_t * ext    = lv_obj_get_ext_attr(lmeter);
+    const lv_style_t * style = lv_obj_get_style(lmeter);
+    lv_opa_t opa_scale       = lv_obj_get_opa_scale(lmeter);
+    lv_style_t style_tmp;
+    lv_style_copy(&style_tmp, style);
+
+#if LV_USE_GROUP
+    lv_group_t * g = lv_obj_get_group(lmeter);
+    if(lv_group_get_focused(g) == lmeter) {
+        style_tmp.line.width += 1;
+    }
+#endif
+
+    lv_coord_t r_out = lv_obj_get_width(lmeter) / 2;
+    lv_coord_t r_in  = r_out - style->body.padding.left;
+    if(r_in < 1) r_in = 1;
+
+    lv_coord_t x_ofs  = lv_obj_get_width(lmeter) / 2 + lmeter->coords.x1;
+    lv_coord_t y_ofs  = lv_obj_get_height(lmeter) / 2 + lmeter->coords.y1;
+    int16_t angle_ofs = 90 + (360 - ext->scale_angle) / 2;
+    int16_t level     = lv_lmeter_get_level(ext);
+    uint8_t i;
+
+    style_tmp.line.color = style->body.main_color;
+
+    /*Calculate every coordinate in a bigger size to make rounding later*/
+    r_out = r_out << LV_LMETER_LINE_UPSCALE;
+    r_in  = r_in << LV_LMETER_LINE_UPSCALE;
+
+    for(i = 0; i < ext->line_cnt; i++) {
+        /*Calculate the position a scale label*/
+        int16_t angle = (i * ext->scale_angle) / (ext->line_cnt - 1) + angle_ofs;
+
+        lv_coord_t y_out = (int32_t)((int32_t)lv_trigo_sin(angle) * r_out) >> LV_TRIGO_SHIFT;
+        lv_coord_t x_out = (int32_t)((int32_t)lv_trigo_sin(angle + 90) * r_out) >> LV_TRIGO_SHIFT;
+        lv_coord_t y_in  = (int32_t)((int32_t)lv_trigo_sin(angle) * r_in) >> LV_TRIGO_SHIFT;
+        lv_coord_t x_in  = (int32_t)((int32_t)lv_trigo_sin(angle + 90) * r_in) >> LV_TRIGO_SHIFT;
+
+        /*Rounding*/
+        x_out = lv_lmeter_coord_round(x_out);
+        x_in  = lv_lmeter_coord_round(x_in);
+        y_out = lv_lmeter_coord_round(y_out);
+        y_in  = lv_lmeter_coord_round(y_in);
+
+        lv_point_t p1;
+        lv_point_t p2;
+
+        p2.x = x_in + x_ofs;
+        p2.y = y_in + y_ofs;
+
+        p1.x = x_out + x_ofs;
+        p1.y = y_out + y_ofs;
+
+        if(i >= level)
+            style_tmp.line.color = style->line.color;
+        else {
+            style_tmp.line.color =
+                lv_color_mix(style->body.grad_color, style->body.main_color, (255 * i) / ext->line_cnt);
+        }
+
+        lv_draw_line(&p1, &p2, mask, &style_tmp, opa_scale);
+    }
+}
+
+/**
+ * Get how many lines are drawn with the value colors
+ * @param ext pointer to the line meter's ext. data
+ * @return the number of lines below the current value
+ */
+static int16_t lv_lmeter_get_level(const lv_lmeter_ext_t * ext)
+{
+    return (int32_t)((int32_t)(ext->cur_value - ext->min_value) * ext->line_cnt) / (ext->max_value - ext->min_value);
+}
+
 /**
  * Round a coordinate which is upscaled  (>=x.5 -> x + 1;   <x.5 -> x)
  * @param x a coordinate which is greater then it should be
@@ -379,4 +521,172 @@ static lv_coord_t lv_lmeter_coord_round(int32_t x)
 #endif
 }
 
+
+#if LV_LMETER_LAYER
+/**
+ * Render the static part of a line meter into its layer, an image with alpha channel
+ * @param lmeter pointer to a line meter object
+ * @param area the area of the layer
+ * @param render_cb draws the static part
+ * @return true: the layer is rendered; false: there was not enough memory for it
+ */
+static bool lv_lmeter_render_layer(lv_obj_t * lmeter, const lv_area_t * area, lv_lmeter_layer_cb_t render_cb)
+{
+    lv_lmeter_ext_t * ext = lv_obj_get_ext_attr(lmeter);
+    lv_coord_t w          = lv_area_get_width(area);
+    lv_coord_t h          = lv_area_get_height(area);
+    if(w <= 0 || h <= 0) return false;
+
+    /*The parts to blit are stored after the pixels*/
+    uint32_t size      = (uint32_t)w * h * LV_IMG_PX_SIZE_ALPHA_BYTE;
+    uint32_t parts_ofs = (size + 3) & ~0x3;
+    uint32_t part_max  = ((h + LV_LMETER_LAYER_BAND - 1) / LV_LMETER_LAYER_BAND) * LV_LMETER_LAYER_RUNS;
+    if(ext->layer.data == NULL || ext->layer.header.w != w || ext->layer.header.h != h) {
+        lv_lmeter_free_layer(lmeter);
+        uint8_t * data = LAYER_ALLOC(parts_ofs + part_max * sizeof(lv_area_t));
+        if(data == NULL) return false;
+        ext->layer.data      = data;
+        ext->layer.data_size = size;
+        ext->layer_parts     = (lv_area_t *)&data[parts_ofs];
+    }
+
+    ext->layer.header.always_zero = 0;
+    ext->layer.header.cf          = LV_IMG_CF_TRUE_COLOR_ALPHA;
+    ext->layer.header.w           = w;
+    ext->layer.header.h           = h;
+    memset((uint8_t *)ext->layer.data, 0x00, size);
+    lv_area_copy(&ext->layer_area, area);
+
+    /* Create a dummy display whose buffer is the layer, like the canvas does.
+     * The pixels are set with alpha by `lv_lmeter_layer_set_px`*/
+    lv_disp_t * refr_ori = lv_refr_get_disp_refreshing();
+
+    lv_disp_t disp;
+    memset(&disp, 0, sizeof(lv_disp_t));
+
+    lv_disp_buf_t disp_buf;
+    lv_disp_buf_init(&disp_buf, (void *)ext->layer.data, NULL, (uint32_t)w * h);
+    lv_area_copy(&disp_buf.area, area);
+
+    lv_disp_drv_init(&disp.driver);
+    disp.driver.buffer       = &disp_buf;
+    disp.driver.hor_res      = refr_ori->driver.hor_res;
+    disp.driver.ver_res      = refr_ori->driver.ver_res;
+    disp.driver.antialiasing = refr_ori->driver.antialiasing;
+    disp.driver.set_px_cb    = lv_lmeter_layer_set_px;
+
+    lv_refr_set_disp_refreshing(&disp);
+    ext->layer_rendering = 1;
+    render_cb(lmeter, area);
+    ext->layer_rendering = 0;
+    lv_refr_set_disp_refreshing(refr_ori);
+
+    lv_lmeter_find_layer_parts(lmeter);
+
+    return true;
+}
+
+/**
+ * Collect the parts of a rendered layer which are not transparent:
+ * in every band of rows the runs of columns with a visible pixel
+ * @param lmeter pointer to a line meter object
+ */
+static void lv_lmeter_find_layer_parts(lv_obj_t * lmeter)
+{
+    lv_lmeter_ext_t * ext = lv_obj_get_ext_attr(lmeter);
+    const uint8_t * data  = ext->layer.data;
+    lv_coord_t w          = ext->layer.header.w;
+    lv_coord_t h          = ext->layer.header.h;
+    uint32_t stride       = (uint32_t)w * LV_IMG_PX_SIZE_ALPHA_BYTE;
+
+    ext->layer_part_cnt = 0;
+
+    lv_coord_t band_y;
+    for(band_y = 0; band_y < h; band_y += LV_LMETER_LAYER_BAND) {
+        lv_coord_t band_h = LV_MATH_MIN(LV_LMETER_LAYER_BAND, h - band_y);
+        uint16_t run_cnt  = 0;
+        lv_area_t * run   = NULL;
+        lv_coord_t x;
+        for(x = 0; x < w; x++) {
+            const uint8_t * px = &data[band_y * stride + (x + 1) * LV_IMG_PX_SIZE_ALPHA_BYTE - 1]; /*Alpha byte*/
+            lv_coord_t y;
+            for(y = 0; y < band_h; y++, px += stride) {
+                if(*px != LV_OPA_TRANSP) break;
+            }
+            if(y == band_h) continue; /*Transparent column*/
+
+            /*Continue the last run over a narrow gap or if there can't be more runs*/
+            if(run && (x - run->x2 <= LV_LMETER_LAYER_GAP || run_cnt == LV_LMETER_LAYER_RUNS)) {
+                run->x2 = x;
+                continue;
+            }
+
+            run = &ext->layer_parts[ext->layer_part_cnt];
+            lv_area_set(run, x, band_y, x, band_y + band_h - 1);
+            ext->layer_part_cnt++;
+            run_cnt++;
+        }
+    }
+
+    /*Make the parts absolute*/
+    uint16_t i;
+    for(i = 0; i < ext->layer_part_cnt; i++) {
+        lv_area_t * part = &ext->layer_parts[i];
+        part->x1 += ext->layer_area.x1;
+        part->x2 += ext->layer_area.x1;
+        part->y1 += ext->layer_area.y1;
+        part->y2 += ext->layer_area.y1;
+    }
+}
+
+/**
+ * Free the layer of a line meter
+ * @param lmeter pointer to a line meter object
+ */
+static void lv_lmeter_free_layer(lv_obj_t * lmeter)
+{
+    lv_lmeter_ext_t * ext = lv_obj_get_ext_attr(lmeter);
+    if(ext->layer.data == NULL) return;
+
+    LAYER_FREE((uint8_t *)ext->layer.data);
+    ext->layer.data      = NULL;
+    ext->layer.data_size = 0;
+    ext->layer_parts     = NULL;
+    ext->layer_part_cnt  = 0;
+}
+
+/**
+ * Blend a pixel into a layer keeping its alpha channel (`set_px_cb` of the layer's display)
+ * @param disp_drv the layer's display driver
+ * @param buf the layer's pixels (`LV_IMG_CF_TRUE_COLOR_ALPHA`)
+ * @param buf_w width of the layer
+ * @param x x coordinate of the pixel in the layer
+ * @param y y coordinate of the pixel in the layer
+ * @param color color of the pixel
+ * @param opa opacity of the pixel
+ */
+static void lv_lmeter_layer_set_px(lv_disp_drv_t * disp_drv, uint8_t * buf, lv_coord_t buf_w, lv_coord_t x,
+                                   lv_coord_t y, lv_color_t color, lv_opa_t opa)
+{
+    (void)disp_drv; /*Unused*/
+
+    if(opa <= LV_OPA_MIN) return;
+
+    uint8_t * px     = &buf[((uint32_t)y * buf_w + x) * LV_IMG_PX_SIZE_ALPHA_BYTE];
+    lv_opa_t px_opa  = px[LV_IMG_PX_SIZE_ALPHA_BYTE - 1];
+    lv_color_t px_color;
+    memcpy(&px_color, px, sizeof(lv_color_t));
+
+    /*Mix with the alpha of the pixel under it (the 'over' operator)*/
+    if(opa < LV_OPA_MAX && px_opa > LV_OPA_MIN) {
+        lv_opa_t res_opa = 255 - ((uint16_t)((uint16_t)(255 - opa) * (255 - px_opa)) >> 8);
+        color            = lv_color_mix(color, px_color, (uint16_t)((uint16_t)opa * 255) / res_opa);
+        opa              = res_opa;
+    }
+
+    memcpy(px, &color, LV_IMG_PX_SIZE_ALPHA_BYTE - 1);
+    px[LV_IMG_PX_SIZE_ALPHA_BYTE - 1] = opa;
+}
+#endif
+
 #endif
@@ -22,6 +22,9 @@ extern "C" {
 #if LV_USE_LMETER != 0
 
 #include "../lv_core/lv_obj.h"
+#if LV_LMETER_LAYER
+#include "../lv_draw/lv_img_decoder.h"
+#endif
 
 /*********************
  *      DEFINES
@@ -40,8 +43,28 @@ typedef struct
     int16_t cur_value;
     int16_t min_value;
     int16_t max_value;
+#if LV_LMETER_LAYER
+    lv_img_dsc_t layer;         /*The pre-rendered scale (`layer.data == NULL`: not rendered)*/
+    lv_area_t layer_area;       /*Where the layer was rendered*/
+    lv_area_t * layer_parts;    /*The parts of the layer which are not transparent*/
+    uint16_t layer_part_cnt;
+    int16_t layer_level;        /*Number of lines drawn with the value colors in the layer*/
+    lv_opa_t layer_opa_scale;   /*Opacity scale the layer was rendered with*/
+    uint8_t layer_focused : 1;  /*The layer was rendered with the focused style*/
+    uint8_t layer_aa : 1;       /*The layer was rendered with anti-aliasing*/
+    uint8_t layer_rendering : 1; /*1: the layer is being rendered so draw directly*/
+#endif
 } lv_lmeter_ext_t;
 
+#if LV_LMETER_LAYER
+/**
+ * Draws the static part of a line meter (or of an object based on it) into `mask`
+ * @param lmeter pointer to a line meter object
+ * @param mask the part is drawn only in this area
+ */
+typedef void (*lv_lmeter_layer_cb_t)(lv_obj_t * lmeter, const lv_area_t * mask);
+#endif
+
 /*Styles*/
 enum {
     LV_LMETER_STYLE_MAIN,
@@ -151,6 +174,31 @@ static inline const lv_style_t * lv_lmeter_get_style(const lv_obj_t * lmeter, lv
     return lv_obj_get_style(lmeter);
 }
 
+#if LV_LMETER_LAYER
+
+/*=====================
+ * Other functions
+ *====================*/
+
+/**
+ * Draw the static part of a line meter from its pre-rendered layer.
+ * The layer is rendered with `render_cb` first if it's missing or outdated.
+ * If there is no memory for it `render_cb` draws directly.
+ * @param lmeter pointer to a line meter object
+ * @param mask the object is drawn only in this area
+ * @param render_cb draws the static part (the line meter's design while rendering)
+ */
+void lv_lmeter_draw_layer(lv_obj_t * lmeter, const lv_area_t * mask, lv_lmeter_layer_cb_t render_cb);
+
+/**
+ * Render the layer of a line meter again when it's drawn the next time.
+ * Call it if something drawn in the layer changed.
+ * @param lmeter pointer to a line meter object
+ */
+void lv_lmeter_invalidate_layer(lv_obj_t * lmeter);
+
+#endif
+
 /**********************
  *      MACROS
  **********************/
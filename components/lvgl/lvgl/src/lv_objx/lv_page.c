@@ -13,6 +13,7 @@
 #include "../lv_draw/lv_draw.h"
 #include "../lv_themes/lv_theme.h"
 #include "../lv_core/lv_refr.h"
+#include "../lv_core/lv_disp.h"
 #include "../lv_misc/lv_anim.h"
 #include "../lv_misc/lv_math.h"
 
@@ -46,6 +47,8 @@ static bool lv_scrl_design(lv_obj_t * scrl, const lv_area_t * mask, lv_design_mo
 static lv_res_t lv_page_signal(lv_obj_t * page, lv_signal_t sign, void * param);
 static lv_res_t lv_page_scrollable_signal(lv_obj_t * scrl, lv_signal_t sign, void * param);
 static void scrl_def_event_cb(lv_obj_t * scrl, lv_event_t event);
+static bool lv_page_get_view(lv_obj_t * page, lv_area_t * view);
+static bool lv_page_covered(lv_obj_t * par, const lv_obj_t * child, const lv_area_t * area, bool after);
 #if LV_USE_ANIMATION
 static void edge_flash_anim(void * page, lv_anim_value_t v);
 static void edge_flash_anim_end(lv_anim_t * a);
@@ -623,6 +626,133 @@ void lv_page_start_edge_flash(lv_obj_t * page)
 #endif
 }
 
+/**
+ * Move the pixels of a child on the display when it is about to move, and invalidate only what that
+ * leaves out of date, e.g. for a page scrolling. It works only where nothing but the child is drawn
+ * over a background which looks the same along the movement, like plain colors.
+ * Not intended to use directly by the user but by object types handling `LV_SIGNAL_CHILD_MOVE`.
+ * @param par pointer to the parent of `child`. Its own drawing mustn't change along the movement.
+ * @param child pointer to the child about to move
+ * @param view the part to move in which `par` draws only `child` over its background. It has to be
+ * covered by `child` both before and after the move.
+ * @param diff the movement of the child
+ * @return true: the pixels are moved; false: the child has to be invalidated as usual
+ */
+bool lv_page_copy_child(lv_obj_t * par, lv_obj_t * child, const lv_area_t * view_p, const lv_point_t * diff)
+{
+    if(lv_obj_get_hidden(par) || lv_obj_get_opa_scale(par) != LV_OPA_COVER) return false;
+
+    lv_obj_t * scr   = lv_obj_get_screen(par);
+    lv_disp_t * disp = lv_obj_get_disp(scr);
+    if(scr != lv_disp_get_scr_act(disp) && scr != lv_disp_get_layer_top(disp) &&
+       scr != lv_disp_get_layer_sys(disp)) {
+        return false;
+    }
+
+    lv_area_t view;
+    lv_area_copy(&view, view_p);
+
+    /*What the child covers before and after the move, clipped by the parents*/
+    lv_area_t a;
+    lv_area_t clip;
+    lv_obj_get_coords(child, &a);
+    a.x1 -= child->ext_draw_pad;
+    a.y1 -= child->ext_draw_pad;
+    a.x2 += child->ext_draw_pad;
+    a.y2 += child->ext_draw_pad;
+    lv_area_copy(&clip, &a);
+    clip.x1 += diff->x;
+    clip.y1 += diff->y;
+    clip.x2 += diff->x;
+    clip.y2 += diff->y;
+    lv_area_join(&clip, &clip, &a);
+    if(lv_area_intersect(&clip, &clip, &par->coords) == false) return false;
+
+    /*Gradients are vertical so they move with the child only horizontally*/
+    const lv_style_t * style_child = lv_obj_get_style(child);
+    bool bg_open = style_child->body.opa < LV_OPA_COVER; /*Something under the child shows through*/
+    if(bg_open && style_child->body.opa > LV_OPA_TRANSP && diff->y != 0 &&
+       style_child->body.main_color.full != style_child->body.grad_color.full) {
+        return false;
+    }
+
+    /*Go through the parents clipping to them, checking nothing drawn after the child covers
+     *the view and, while they show through, that they are plain under it*/
+    lv_obj_t * obj = par;
+    while(par != NULL) {
+        if(par != obj) {
+            if(lv_obj_get_hidden(par)) return false;
+            if(par->design_cb == lv_page_design) {
+                /*An outer page draws its border and scrollbars over it*/
+                if(lv_page_get_view(par, &a) == false) return false;
+                if(lv_area_intersect(&view, &view, &a) == false) return false;
+            } else if(par->design_cb != ancestor_design && par->design_cb != lv_scrl_design) {
+                return false;
+            }
+
+            if(lv_area_intersect(&clip, &clip, &par->coords) == false) return false;
+            if(lv_area_intersect(&view, &view, &par->coords) == false) return false;
+        }
+        if(lv_page_covered(par, child, &view, true)) return false;
+
+        if(bg_open) {
+            if(lv_page_covered(par, child, &view, false)) return false;
+
+            const lv_style_t * style = lv_obj_get_style(par);
+            bool border = style->body.border.width > 0 && style->body.border.opa > LV_OPA_TRANSP;
+            if(style->body.opa > LV_OPA_TRANSP || border) {
+                lv_coord_t inset = LV_MATH_MAX(border ? style->body.border.width : 0, style->body.radius);
+                lv_area_copy(&a, &par->coords);
+                a.x1 += inset;
+                a.y1 += inset;
+                a.x2 -= inset;
+                a.y2 -= inset;
+                if(lv_area_is_in(&view, &a) == false) return false;
+            }
+            if(style->body.opa > LV_OPA_TRANSP && diff->y != 0 &&
+               style->body.main_color.full != style->body.grad_color.full) {
+                return false;
+            }
+            if(style->body.opa == LV_OPA_COVER) bg_open = false;
+        }
+
+        child = par;
+        par   = lv_obj_get_parent(par);
+    }
+    if(bg_open) return false;
+
+    /*The layers are drawn over the screen*/
+    if(child != lv_disp_get_layer_sys(disp)) {
+        if(lv_page_covered(lv_disp_get_layer_sys(disp), NULL, &view, true)) return false;
+        if(child != lv_disp_get_layer_top(disp) &&
+           lv_page_covered(lv_disp_get_layer_top(disp), NULL, &view, true)) {
+            return false;
+        }
+    }
+
+    if(lv_refr_copy_area(disp, &view, diff->x, diff->y) == false) return false;
+
+    /*Redraw the rest of the child's old and new area as usual*/
+    if(clip.y1 < view.y1) {
+        lv_area_set(&a, clip.x1, clip.y1, clip.x2, view.y1 - 1);
+        lv_inv_area(disp, &a);
+    }
+    if(clip.y2 > view.y2) {
+        lv_area_set(&a, clip.x1, view.y2 + 1, clip.x2, clip.y2);
+        lv_inv_area(disp, &a);
+    }
+    if(clip.x1 < view.x1) {
+        lv_area_set(&a, clip.x1, view.y1, view.x1 - 1, view.y2);
+        lv_inv_area(disp, &a);
+    }
+    if(clip.x2 > view.x2) {
+        lv_area_set(&a, view.x2 + 1, view.y1, clip.x2, view.y2);
+        lv_inv_area(disp, &a);
+    }
+
+    return true;
+}
+
 /**********************
  *   STATIC FUNCTIONS
  **********************/
@@ -869,6 +999,13 @@ static lv_res_t lv_page_signal(lv_obj_t * page, lv_signal_t sign, void * param)
     } else if(sign == LV_SIGNAL_GET_EDITABLE) {
         bool * editable = (bool *)param;
         *editable       = true;
+    } else if(sign == LV_SIGNAL_CHILD_MOVE) {
+        /*Move the scrolled content on the display instead of redrawing all of it*/
+        lv_child_move_t * move = param;
+        /*Pages with their own design (e.g. text areas) draw over the content. They decide themselves.*/
+        if(move->child == ext->scrl && move->copied == false && page->design_cb == lv_page_design) {
+            move->copied = lv_page_scroll_copy(page, &move->diff);
+        }
     } else if(sign == LV_SIGNAL_GET_TYPE) {
         lv_obj_type_t * buf = param;
         uint8_t i;
@@ -1087,6 +1224,119 @@ static void scrl_def_event_cb(lv_obj_t * scrl, lv_event_t event)
     /*clang-format on*/
 }
 
+/**
+ * Move the pixels of a page's scrollable on the display when it is about to scroll, and invalidate
+ * only what that leaves out of date. It works only where nothing but the scrollable is drawn over
+ * a background which looks the same along the movement, like plain colors.
+ * @param page pointer to a page object
+ * @param diff the movement of the scrollable
+ * @return true: the pixels are moved; false: the scrollable has to be invalidated as usual
+ */
+bool lv_page_scroll_copy(lv_obj_t * page, const lv_point_t * diff)
+{
+    lv_page_ext_t * ext = lv_obj_get_ext_attr(page);
+    lv_obj_t * scrl     = ext->scrl;
+
+    if(scrl->design_cb != lv_scrl_design) return false;
+
+#if LV_USE_GROUP
+    /*The focused style may change the scrollable's too (see `lv_scrl_design`)*/
+    lv_group_t * g = lv_obj_get_group(page);
+    if(g && lv_group_get_focused(g) == page) return false;
+#endif
+
+    lv_area_t view;
+    if(lv_page_get_view(page, &view) == false) return false;
+
+    /*The scrollable has to cover the view before and after the move, apart from its rounded corners*/
+    const lv_style_t * style_scrl = lv_page_get_style(page, LV_PAGE_STYLE_SCRL);
+    lv_coord_t r = LV_MATH_MIN(style_scrl->body.radius, LV_MATH_MIN(lv_obj_get_width(scrl), lv_obj_get_height(scrl)) / 2);
+    lv_area_t a;
+    lv_area_copy(&a, &scrl->coords);
+    a.x1 += r;
+    a.y1 += r;
+    a.x2 -= r;
+    a.y2 -= r;
+    if(lv_area_intersect(&view, &view, &a) == false) return false;
+    a.x1 += diff->x;
+    a.y1 += diff->y;
+    a.x2 += diff->x;
+    a.y2 += diff->y;
+    if(lv_area_intersect(&view, &view, &a) == false) return false;
+
+    return lv_page_copy_child(page, scrl, &view, diff);
+}
+
+/**
+ * Get the part of a page where nothing but its scrollable is drawn, inside its border, rounded
+ * corners and scrollbars
+ * @param page pointer to a page object
+ * @param view store the area here
+ * @return false: no such part, e.g. while an edge flash is drawn
+ */
+static bool lv_page_get_view(lv_obj_t * page, lv_area_t * view)
+{
+    lv_page_ext_t * ext      = lv_obj_get_ext_attr(page);
+    const lv_style_t * style = lv_page_get_style(page, LV_PAGE_STYLE_BG);
+
+#if LV_USE_ANIMATION
+    if(ext->edge_flash.left_ip || ext->edge_flash.right_ip || ext->edge_flash.top_ip || ext->edge_flash.bottom_ip) {
+        return false;
+    }
+#endif
+
+    lv_coord_t inset = LV_MATH_MAX(style->body.border.width, style->body.radius);
+    lv_area_copy(view, &page->coords);
+    view->x1 += inset;
+    view->y1 += inset;
+    view->x2 -= inset;
+    view->y2 -= inset;
+
+    if(ext->sb.ver_draw && (ext->sb.mode & LV_SB_MODE_HIDE) == 0) {
+        view->x2 = LV_MATH_MIN(view->x2, page->coords.x1 + ext->sb.ver_area.x1 - 1);
+    }
+    if(ext->sb.hor_draw && (ext->sb.mode & LV_SB_MODE_HIDE) == 0) {
+        view->y2 = LV_MATH_MIN(view->y2, page->coords.y1 + ext->sb.hor_area.y1 - 1);
+    }
+
+    return view->x1 <= view->x2 && view->y1 <= view->y2;
+}
+
+/**
+ * Check whether the children of an object drawn after or before one of them are on an area
+ * @param par pointer to an object
+ * @param child pointer to a child of `par`, NULL to check all children
+ * @param area pointer to an area
+ * @param after true: check the children drawn after `child`; false: the ones drawn before it
+ * @return true: one of the children is on `area`
+ */
+static bool lv_page_covered(lv_obj_t * par, const lv_obj_t * child, const lv_area_t * area, bool after)
+{
+    lv_obj_t * i;
+    lv_area_t a;
+    bool check = after;
+
+    /*The children are drawn from the tail so the ones drawn later are before `child`*/
+    LV_LL_READ(par->child_ll, i)
+    {
+        if(i == child) {
+            if(after) break;
+            check = true;
+            continue;
+        }
+        if(check == false || lv_obj_get_hidden(i)) continue;
+
+        lv_area_copy(&a, &i->coords);
+        a.x1 -= i->ext_draw_pad;
+        a.y1 -= i->ext_draw_pad;
+        a.x2 += i->ext_draw_pad;
+        a.y2 += i->ext_draw_pad;
+        if(lv_area_is_on(&a, area)) return true;
+    }
+
+    return false;
+}
+
 /**
  * Refresh the position and size of the scroll bars.
  * @param page pointer to a page object
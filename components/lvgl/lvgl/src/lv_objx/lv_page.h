@@ -403,6 +403,31 @@ void lv_page_scroll_ver(lv_obj_t * page, lv_coord_t dist);
  * @param page
  */
 void lv_page_start_edge_flash(lv_obj_t * page);
+
+/**
+ * Not intended to use directly by the user but by object types handling `LV_SIGNAL_CHILD_MOVE`.
+ * Move the pixels of a child on the display when it is about to move, and invalidate only what that
+ * leaves out of date.
+ * @param par pointer to the parent of `child`. Its own drawing mustn't change along the movement.
+ * @param child pointer to the child about to move
+ * @param view_p the part to move in which `par` draws only `child` over its background. It has to be
+ * covered by `child` both before and after the move.
+ * @param diff the movement of the child
+ * @return true: the pixels are moved; false: the child has to be invalidated as usual
+ */
+bool lv_page_copy_child(lv_obj_t * par, lv_obj_t * child, const lv_area_t * view_p, const lv_point_t * diff);
+
+/**
+ * Not intended to use directly by the user but by object types handling `LV_SIGNAL_CHILD_MOVE`.
+ * Move the pixels of a page's scrollable on the display when it is about to scroll, and invalidate
+ * only what that leaves out of date. The page's own drawing has to look the same along the movement
+ * or move with the scrollable, so types drawing more than a page check that first.
+ * @param page pointer to a page object
+ * @param diff the movement of the scrollable
+ * @return true: the pixels are moved; false: the scrollable has to be invalidated as usual
+ */
+bool lv_page_scroll_copy(lv_obj_t * page, const lv_point_t * diff);
+
 /**********************
  *      MACROS
  **********************/
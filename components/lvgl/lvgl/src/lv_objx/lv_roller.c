@@ -38,6 +38,7 @@ static void inf_normalize(void * roller_scrl);
 static void scroll_anim_ready_cb(lv_anim_t * a);
 #endif
 static void draw_bg(lv_obj_t * roller, const lv_area_t * mask);
+static void get_sel_area(lv_obj_t * roller, lv_area_t * sel_area);
 
 /**********************
  *  STATIC VARIABLES
@@ -312,15 +313,10 @@ static bool lv_roller_design(lv_obj_t * roller, const lv_area_t * mask, lv_desig
     else if(mode == LV_DESIGN_DRAW_MAIN) {
         draw_bg(roller, mask);
 
-        const lv_style_t * style = lv_roller_get_style(roller, LV_ROLLER_STYLE_BG);
-        lv_opa_t opa_scale       = lv_obj_get_opa_scale(roller);
-        const lv_font_t * font   = style->text.font;
-        lv_roller_ext_t * ext    = lv_obj_get_ext_attr(roller);
-        lv_coord_t font_h        = lv_font_get_line_height(font);
+        lv_opa_t opa_scale    = lv_obj_get_opa_scale(roller);
+        lv_roller_ext_t * ext = lv_obj_get_ext_attr(roller);
         lv_area_t rect_area;
-        rect_area.y1 = roller->coords.y1 + lv_obj_get_height(roller) / 2 - font_h / 2 - style->text.line_space / 2;
-        if((font_h & 0x1) && (style->text.line_space & 0x1)) rect_area.y1--; /*Compensate the two rounding error*/
-        rect_area.y2 = rect_area.y1 + font_h + style->text.line_space - 1;
+        get_sel_area(roller, &rect_area);
         lv_area_t roller_coords;
         lv_obj_get_coords(roller, &roller_coords);
         lv_obj_get_inner_coords(roller, &roller_coords);
@@ -334,17 +330,11 @@ static bool lv_roller_design(lv_obj_t * roller, const lv_area_t * mask, lv_desig
     else if(mode == LV_DESIGN_DRAW_POST) {
         const lv_style_t * style = lv_roller_get_style(roller, LV_ROLLER_STYLE_BG);
         lv_roller_ext_t * ext    = lv_obj_get_ext_attr(roller);
-        const lv_font_t * font   = style->text.font;
-        lv_coord_t font_h        = lv_font_get_line_height(font);
         lv_opa_t opa_scale       = lv_obj_get_opa_scale(roller);
 
         /*Redraw the text on the selected area with a different color*/
         lv_area_t rect_area;
-        rect_area.y1 = roller->coords.y1 + lv_obj_get_height(roller) / 2 - font_h / 2 - style->text.line_space / 2;
-        if((font_h & 0x1) && (style->text.line_space & 0x1)) rect_area.y1--; /*Compensate the two rounding error*/
-        rect_area.y2 = rect_area.y1 + font_h + style->text.line_space - 1;
-        rect_area.x1 = roller->coords.x1;
-        rect_area.x2 = roller->coords.x2;
+        get_sel_area(roller, &rect_area);
         lv_area_t mask_sel;
         bool area_ok;
         area_ok = lv_area_intersect(&mask_sel, mask, &rect_area);
@@ -366,8 +356,9 @@ static bool lv_roller_design(lv_obj_t * roller, const lv_area_t * mask, lv_desig
             lv_style_copy(&new_style, style);
             new_style.text.color = sel_style->text.color;
             new_style.text.opa   = sel_style->text.opa;
+            lv_draw_label_hint_t * hint = lv_label_get_draw_hint(ext->ddlist.label, &new_style, &txt_align);
             lv_draw_label(&ext->ddlist.label->coords, &mask_sel, &new_style, opa_scale,
-                          lv_label_get_text(ext->ddlist.label), txt_align, NULL, -1, -1, NULL);
+                          lv_label_get_text(ext->ddlist.label), txt_align, NULL, -1, -1, hint);
         }
     }
 
@@ -457,6 +448,27 @@ static lv_res_t lv_roller_signal(lv_obj_t * roller, lv_signal_t sign, void * par
                 ext->ddlist.sel_opt_id_ori = ori_id;
             }
         }
+    } else if(sign == LV_SIGNAL_CHILD_MOVE) {
+        /*Move the options on the display and redraw only the fixed selection where the options slide
+         *under it and where its old pixels slide to*/
+        lv_child_move_t * move = param;
+        if(move->child == lv_page_get_scrl(roller) && move->copied == false && roller->design_cb == lv_roller_design &&
+           lv_page_scroll_copy(roller, &move->diff)) {
+            lv_coord_t ext_size = ext->ddlist.sel_style->body.shadow.width;
+            lv_area_t sel_area;
+            get_sel_area(roller, &sel_area);
+            sel_area.x1 -= ext_size;
+            sel_area.y1 -= ext_size;
+            sel_area.x2 += ext_size;
+            sel_area.y2 += ext_size;
+            lv_obj_invalidate_area(roller, &sel_area);
+            sel_area.x1 += move->diff.x;
+            sel_area.y1 += move->diff.y;
+            sel_area.x2 += move->diff.x;
+            sel_area.y2 += move->diff.y;
+            lv_obj_invalidate_area(roller, &sel_area);
+            move->copied = true;
+        }
     } else if(sign == LV_SIGNAL_GET_TYPE) {
         lv_obj_type_t * buf = param;
         uint8_t i;
@@ -543,6 +555,23 @@ static lv_res_t lv_roller_scrl_signal(lv_obj_t * roller_scrl, lv_signal_t sign,
  * @param roller pointer to a roller object
  * @param mask pointer to the current mask (from the design function)
  */
+/**
+ * Get the area of the selected option. It's at the middle of the roller wherever the options are.
+ * @param roller pointer to a roller object
+ * @param sel_area store the area here. It's as wide as the roller.
+ */
+static void get_sel_area(lv_obj_t * roller, lv_area_t * sel_area)
+{
+    const lv_style_t * style = lv_roller_get_style(roller, LV_ROLLER_STYLE_BG);
+    lv_coord_t font_h        = lv_font_get_line_height(style->text.font);
+
+    sel_area->y1 = roller->coords.y1 + lv_obj_get_height(roller) / 2 - font_h / 2 - style->text.line_space / 2;
+    if((font_h & 0x1) && (style->text.line_space & 0x1)) sel_area->y1--; /*Compensate the two rounding error*/
+    sel_area->y2 = sel_area->y1 + font_h + style->text.line_space - 1;
+    sel_area->x1 = roller->coords.x1;
+    sel_area->x2 = roller->coords.x2;
+}
+
 static void draw_bg(lv_obj_t * roller, const lv_area_t * mask)
 {
     const lv_style_t * style = lv_roller_get_style(roller, LV_ROLLER_STYLE_BG);
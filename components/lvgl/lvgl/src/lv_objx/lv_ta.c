@@ -393,10 +393,8 @@ void lv_ta_del_char(lv_obj_t * ta)
     }
 
     char * label_txt = lv_label_get_text(ext->label);
-    /*Delete a character*/
-    lv_txt_cut(label_txt, ext->cursor.pos - 1, 1);
-    /*Refresh the label*/
-    lv_label_set_text(ext->label, label_txt);
+    /*Delete a character (the label lays out only the lines around it again)*/
+    lv_label_cut_text(ext->label, ext->cursor.pos - 1, 1);
     lv_ta_clear_selection(ta);
 
     /*Don't let 'width == 0' because cursor will not be visible*/
@@ -566,8 +564,16 @@ void lv_ta_set_cursor_pos(lv_obj_t * ta, int16_t pos)
 
     /*Check the bottom*/
     if(label_cords.y1 + cur_pos.y + font_h + style->body.padding.bottom > ta_cords.y2) {
-        lv_obj_set_y(label_par, -(cur_pos.y - lv_obj_get_height(ta) + font_h + style->body.padding.top +
-                                  style->body.padding.bottom));
+        lv_coord_t y = -(cur_pos.y - lv_obj_get_height(ta) + font_h + style->body.padding.top +
+                         style->body.padding.bottom);
+
+        /*Don't go past the bottom, the page would move it back and so all the text is redrawn*/
+        lv_coord_t y_min = lv_obj_get_height(ta) - lv_obj_get_height(label_par) - style->body.padding.bottom;
+        if(lv_obj_get_height(label_par) + style->body.padding.top + style->body.padding.bottom > lv_obj_get_height(ta) &&
+           y < y_min) {
+            y = y_min;
+        }
+        lv_obj_set_y(label_par, y);
     }
     /*Check the left (use the font_h as general unit)*/
     if(lv_obj_get_x(label_par) + cur_pos.x < font_h) {
@@ -28,7 +28,10 @@
 static bool lv_table_design(lv_obj_t * table, const lv_area_t * mask, lv_design_mode_t mode);
 static lv_res_t lv_table_signal(lv_obj_t * table, lv_signal_t sign, void * param);
 static lv_coord_t get_row_height(lv_obj_t * table, uint16_t row_id);
+static lv_coord_t row_height(lv_obj_t * table, uint16_t row_id);
 static void refr_size(lv_obj_t * table);
+static void refr_obj_size(lv_obj_t * table);
+static void refr_cell(lv_obj_t * table, uint16_t row, uint16_t col);
 
 /**********************
  *  STATIC VARIABLES
@@ -74,6 +77,7 @@ lv_obj_t * lv_table_create(lv_obj_t * par, const lv_obj_t * copy)
     ext->cell_style[3] = &lv_style_plain;
     ext->col_cnt       = 0;
     ext->row_cnt       = 0;
+    ext->row_h         = NULL;
 
     uint16_t i;
     for(i = 0; i < LV_TABLE_COL_MAX; i++) {
@@ -155,7 +159,7 @@ void lv_table_set_cell_value(lv_obj_t * table, uint16_t row, uint16_t col, const
     ext->cell_data[cell] = lv_mem_realloc(ext->cell_data[cell], strlen(txt) + 2); /*+1: trailing '\0; +1: format byte*/
     strcpy(ext->cell_data[cell] + 1, txt);                                        /*Leave the format byte*/
     ext->cell_data[cell][0] = format.format_byte;
-    refr_size(table);
+    refr_cell(table, row, col);
 }
 
 /**
@@ -263,6 +267,7 @@ void lv_table_set_cell_align(lv_obj_t * table, uint16_t row, uint16_t col, lv_la
     format.format_byte      = ext->cell_data[cell][0];
     format.s.align          = align;
     ext->cell_data[cell][0] = format.format_byte;
+    refr_cell(table, row, col);
 }
 
 /**
@@ -294,6 +299,7 @@ void lv_table_set_cell_type(lv_obj_t * table, uint16_t row, uint16_t col, uint8_
     format.format_byte      = ext->cell_data[cell][0];
     format.s.type           = type;
     ext->cell_data[cell][0] = format.format_byte;
+    refr_cell(table, row, col);
 }
 
 /**
@@ -322,6 +328,7 @@ void lv_table_set_cell_crop(lv_obj_t * table, uint16_t row, uint16_t col, bool c
     format.format_byte      = ext->cell_data[cell][0];
     format.s.crop           = crop;
     ext->cell_data[cell][0] = format.format_byte;
+    refr_cell(table, row, col);
 }
 
 /**
@@ -617,11 +624,18 @@ static bool lv_table_design(lv_obj_t * table, const lv_area_t * mask, lv_design_
 
         cell_area.y2 = table->coords.y1 + bg_style->body.padding.top;
         for(row = 0; row < ext->row_cnt; row++) {
-            h_row = get_row_height(table, row);
+            h_row = row_height(table, row);
 
             cell_area.y1 = cell_area.y2;
             cell_area.y2 = cell_area.y1 + h_row;
 
+            /*Lay out only the rows and cells being redrawn*/
+            if(cell_area.y1 > mask->y2) break;
+            if(cell_area.y2 < mask->y1) {
+                cell += ext->col_cnt;
+                continue;
+            }
+
             cell_area.x2 = table->coords.x1 + bg_style->body.padding.left;
 
             for(col = 0; col < ext->col_cnt; col++) {
@@ -654,9 +668,10 @@ static bool lv_table_design(lv_obj_t * table, const lv_area_t * mask, lv_design_
                     }
                 }
 
-                lv_draw_rect(&cell_area, mask, cell_style, opa_scale);
+                bool cell_on = lv_area_is_on(&cell_area, mask);
+                if(cell_on) lv_draw_rect(&cell_area, mask, cell_style, opa_scale);
 
-                if(ext->cell_data[cell]) {
+                if(cell_on && ext->cell_data[cell]) {
 
                     txt_area.x1 = cell_area.x1 + cell_style->body.padding.left;
                     txt_area.x2 = cell_area.x2 - cell_style->body.padding.right;
@@ -752,6 +767,13 @@ static lv_res_t lv_table_signal(lv_obj_t * table, lv_signal_t sign, void * param
                 ext->cell_data[cell] = NULL;
             }
         }
+        if(ext->row_h) {
+            lv_mem_free(ext->row_h);
+            ext->row_h = NULL;
+        }
+    } else if(sign == LV_SIGNAL_STYLE_CHG) {
+        /*The row heights depend on the cell styles which may have been modified too*/
+        refr_size(table);
     } else if(sign == LV_SIGNAL_GET_TYPE) {
         lv_obj_type_t * buf = param;
         uint8_t i;
@@ -764,7 +786,39 @@ static lv_res_t lv_table_signal(lv_obj_t * table, lv_signal_t sign, void * param
     return res;
 }
 
+/**
+ * Measure every row of a table again and refresh its size
+ * @param table pointer to a table object
+ */
 static void refr_size(lv_obj_t * table)
+{
+    lv_table_ext_t * ext = lv_obj_get_ext_attr(table);
+
+    if(ext->row_cnt == 0) {
+        lv_mem_free(ext->row_h);
+        ext->row_h = NULL;
+    } else {
+        /*Without memory for the heights each row is measured when it's drawn*/
+        lv_coord_t * row_h = lv_mem_realloc(ext->row_h, ext->row_cnt * sizeof(lv_coord_t));
+        if(row_h == NULL) lv_mem_free(ext->row_h);
+        ext->row_h = row_h;
+    }
+
+    if(ext->row_h) {
+        uint16_t i;
+        for(i = 0; i < ext->row_cnt; i++) {
+            ext->row_h[i] = get_row_height(table, i);
+        }
+    }
+
+    refr_obj_size(table);
+}
+
+/**
+ * Set the size of a table to its columns and rows
+ * @param table pointer to a table object
+ */
+static void refr_obj_size(lv_obj_t * table)
 {
     lv_coord_t h = 0;
     lv_coord_t w = 0;
@@ -776,7 +830,7 @@ static void refr_size(lv_obj_t * table)
         w += ext->col_w[i];
     }
     for(i = 0; i < ext->row_cnt; i++) {
-        h += get_row_height(table, i);
+        h += row_height(table, i);
     }
 
     const lv_style_t * bg_style = lv_obj_get_style(table);
@@ -788,6 +842,73 @@ static void refr_size(lv_obj_t * table)
     lv_obj_invalidate(table);
 }
 
+/**
+ * Refresh a table after the content or format of a cell changed. Only the cell is invalidated
+ * while its row keeps its height.
+ * @param table pointer to a table object
+ * @param row id of the cell's row
+ * @param col id of the cell's column
+ */
+static void refr_cell(lv_obj_t * table, uint16_t row, uint16_t col)
+{
+    lv_table_ext_t * ext = lv_obj_get_ext_attr(table);
+
+    if(ext->row_h == NULL) {
+        refr_size(table);
+        return;
+    }
+
+    lv_coord_t h = get_row_height(table, row);
+    if(h != ext->row_h[row]) {
+        ext->row_h[row] = h;
+        refr_obj_size(table);
+        return;
+    }
+
+    /*The cell is drawn from the first cell merged with it to the last*/
+    uint16_t row_start = row * ext->col_cnt;
+    lv_table_cell_format_t format;
+    uint16_t col_first = col;
+    while(col_first > 0 && ext->cell_data[row_start + col_first - 1] != NULL) {
+        format.format_byte = ext->cell_data[row_start + col_first - 1][0];
+        if(format.s.right_merge == 0) break;
+        col_first--;
+    }
+    uint16_t col_last = col;
+    while(col_last < ext->col_cnt - 1 && ext->cell_data[row_start + col_last] != NULL) {
+        format.format_byte = ext->cell_data[row_start + col_last][0];
+        if(format.s.right_merge == 0) break;
+        col_last++;
+    }
+
+    const lv_style_t * bg_style = lv_obj_get_style(table);
+    lv_area_t cell_area;
+    uint16_t i;
+    cell_area.x1 = table->coords.x1 + bg_style->body.padding.left;
+    for(i = 0; i < col_first; i++) cell_area.x1 += ext->col_w[i];
+    cell_area.x2 = cell_area.x1;
+    for(i = col_first; i <= col_last; i++) cell_area.x2 += ext->col_w[i];
+    cell_area.y1 = table->coords.y1 + bg_style->body.padding.top;
+    for(i = 0; i < row; i++) cell_area.y1 += ext->row_h[i];
+    cell_area.y2 = cell_area.y1 + ext->row_h[row];
+
+    lv_obj_invalidate_area(table, &cell_area);
+}
+
+/**
+ * Get the height of a row as measured when the table last changed, if there was memory to keep it
+ * @param table pointer to a table object
+ * @param row_id id of the row
+ * @return the height of the row
+ */
+static lv_coord_t row_height(lv_obj_t * table, uint16_t row_id)
+{
+    lv_table_ext_t * ext = lv_obj_get_ext_attr(table);
+    if(ext->row_h) return ext->row_h[row_id];
+
+    return get_row_height(table, row_id);
+}
+
 static lv_coord_t get_row_height(lv_obj_t * table, uint16_t row_id)
 {
     lv_table_ext_t * ext = lv_obj_get_ext_attr(table);
@@ -67,6 +67,7 @@ typedef struct
     char ** cell_data;
     const lv_style_t * cell_style[LV_TABLE_CELL_STYLE_CNT];
     lv_coord_t col_w[LV_TABLE_COL_MAX];
+    lv_coord_t * row_h; /*Height of each row, NULL if unknown*/
 } lv_table_ext_t;
 
 /*Styles*/
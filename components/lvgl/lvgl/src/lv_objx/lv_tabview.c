@@ -12,6 +12,7 @@
 #include "lv_btnm.h"
 #include "../lv_themes/lv_theme.h"
 #include "../lv_misc/lv_anim.h"
+#include "../lv_misc/lv_math.h"
 #include "../lv_core/lv_disp.h"
 
 /*********************
@@ -42,11 +43,13 @@ static void tabpage_pressing_handler(lv_obj_t * tabview, lv_obj_t * tabpage);
 static void tabpage_press_lost_handler(lv_obj_t * tabview, lv_obj_t * tabpage);
 static void tab_btnm_event_cb(lv_obj_t * tab_btnm, lv_event_t event);
 static void tabview_realign(lv_obj_t * tabview);
+static bool tabview_content_copy(lv_obj_t * tabview, const lv_point_t * diff);
 
 /**********************
  *  STATIC VARIABLES
  **********************/
 static lv_signal_cb_t ancestor_signal;
+static lv_design_cb_t ancestor_design;
 static lv_signal_cb_t page_signal;
 static lv_signal_cb_t page_scrl_signal;
 static const char * tab_def[] = {""};
@@ -74,6 +77,7 @@ lv_obj_t * lv_tabview_create(lv_obj_t * par, const lv_obj_t * copy)
     lv_mem_assert(new_tabview);
     if(new_tabview == NULL) return NULL;
     if(ancestor_signal == NULL) ancestor_signal = lv_obj_get_signal_cb(new_tabview);
+    if(ancestor_design == NULL) ancestor_design = lv_obj_get_design_cb(new_tabview);
 
     /*Allocate the tab type specific extended data*/
     lv_tabview_ext_t * ext = lv_obj_allocate_ext_attr(new_tabview, sizeof(lv_tabview_ext_t));
@@ -729,6 +733,12 @@ static lv_res_t lv_tabview_signal(lv_obj_t * tabview, lv_signal_t sign, void * p
     } else if(sign == LV_SIGNAL_GET_EDITABLE) {
         bool * editable = (bool *)param;
         *editable       = true;
+    } else if(sign == LV_SIGNAL_CHILD_MOVE) {
+        /*Slide the tabs already on the display instead of redrawing them in every step*/
+        lv_child_move_t * move = param;
+        if(move->child == ext->content && move->copied == false) {
+            move->copied = tabview_content_copy(tabview, &move->diff);
+        }
     } else if(sign == LV_SIGNAL_GET_TYPE) {
         lv_obj_type_t * buf = param;
         uint8_t i;
@@ -1115,4 +1125,45 @@ static void tabview_realign(lv_obj_t * tabview)
 
     lv_tabview_set_tab_act(tabview, ext->tab_cur, LV_ANIM_OFF);
 }
+/**
+ * Move the pixels of the tabs on the display when they are about to slide, e.g. while switching
+ * tabs, so only the part of the tabs coming into view is drawn.
+ * @param tabview pointer to a tab view object
+ * @param diff the movement of the tabs
+ * @return true: the pixels are moved; false: the tabs have to be invalidated as usual
+ */
+static bool tabview_content_copy(lv_obj_t * tabview, const lv_point_t * diff)
+{
+    lv_tabview_ext_t * ext = lv_obj_get_ext_attr(tabview);
+    lv_obj_t * content     = ext->content;
+
+    if(tabview->design_cb != ancestor_design || content->design_cb != ancestor_design) return false;
+
+    /*The tabs have to cover the tab view's inner part before and after the move*/
+    const lv_style_t * style         = lv_obj_get_style(tabview);
+    const lv_style_t * style_content = lv_obj_get_style(content);
+    lv_coord_t inset                 = LV_MATH_MAX(style->body.border.width, style->body.radius);
+    lv_coord_t r                     = style_content->body.radius;
+    lv_area_t view;
+    lv_area_t a;
+    lv_area_copy(&view, &tabview->coords);
+    view.x1 += inset;
+    view.y1 += inset;
+    view.x2 -= inset;
+    view.y2 -= inset;
+    lv_area_copy(&a, &content->coords);
+    a.x1 += r;
+    a.y1 += r;
+    a.x2 -= r;
+    a.y2 -= r;
+    if(lv_area_intersect(&view, &view, &a) == false) return false;
+    a.x1 += diff->x;
+    a.y1 += diff->y;
+    a.x2 += diff->x;
+    a.y2 += diff->y;
+    if(lv_area_intersect(&view, &view, &a) == false) return false;
+
+    return lv_page_copy_child(tabview, content, &view, diff);
+}
+
 #endif
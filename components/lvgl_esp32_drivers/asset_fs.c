@@ -0,0 +1,272 @@
+/**
+* Flash asset partition for the LittleVGL websocket driver
+*
+* Maps the "assets" data partition, an image packed by tools/mkassets.py, into the
+* address space so the web server sends its files straight from flash and LittlevGL
+* reads them through an lv_fs drive, or draws images in place without copying them.
+* Keeping the page, icon and images out of the app makes it smaller and quicker to
+* update.
+*
+*/
+
+/*********************
+ *      INCLUDES
+ *********************/
+#include "asset_fs.h"
+#include "websocket_driver.h"
+
+#if WS_DRIVER_ASSETS
+
+#include "esp_log.h"
+#include "esp_partition.h"
+#include "string.h"
+#if WS_DRIVER_IMG_DEC
+#include "img_dec.h"
+#endif
+
+
+/*********************
+ *      DEFINES
+ *********************/
+#define ASSET_LABEL    "assets"
+#define ASSET_MAGIC    "LVAS"
+#define ASSET_NAME_LEN 20
+
+
+/**********************
+ *      TYPEDEFS
+ **********************/
+// Table of contents entry, as packed by tools/mkassets.py
+typedef struct
+{
+	char name[ASSET_NAME_LEN];
+	uint32_t offset;
+	uint32_t len;
+	uint32_t etag;
+} asset_entry_t;
+
+// An open lv_fs file
+typedef struct
+{
+	const uint8_t* data;
+	uint32_t len;
+	uint32_t pos;
+} asset_file_t;
+
+
+/**********************
+ *  STATIC VARIABLES
+ **********************/
+static const char* TAG = "asset_fs";
+
+static const uint8_t* image = NULL;
+static const asset_entry_t* entries;
+static uint32_t num_entries;
+static spi_flash_mmap_handle_t image_handle;
+
+
+/**********************
+ *  STATIC PROTOTYPES
+ **********************/
+static bool image_valid(uint32_t size);
+#if LV_USE_FILESYSTEM
+static bool fs_ready(lv_fs_drv_t * drv);
+static lv_fs_res_t fs_open(lv_fs_drv_t * drv, void * file_p, const char * path, lv_fs_mode_t mode);
+static lv_fs_res_t fs_close(lv_fs_drv_t * drv, void * file_p);
+static lv_fs_res_t fs_read(lv_fs_drv_t * drv, void * file_p, void * buf, uint32_t btr, uint32_t * br);
+static lv_fs_res_t fs_seek(lv_fs_drv_t * drv, void * file_p, uint32_t pos);
+static lv_fs_res_t fs_tell(lv_fs_drv_t * drv, void * file_p, uint32_t * pos_p);
+static lv_fs_res_t fs_size(lv_fs_drv_t * drv, void * file_p, uint32_t * size_p);
+#endif
+
+
+/**********************
+ *   GLOBAL FUNCTIONS
+ **********************/
+// Map the asset partition and, if LittlevGL has a file system, register it as drive
+// letter.  Call after lv_init().  Returns false, leaving every asset missing, if there
+// is no partition or it doesn't hold a valid image.
+bool asset_fs_init(char letter)
+{
+	const esp_partition_t* part;
+	const void* ptr;
+
+	part = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY, ASSET_LABEL);
+	if (part == NULL) {
+		ESP_LOGE(TAG, "No \"%s\" partition", ASSET_LABEL);
+		return false;
+	}
+	if (esp_partition_mmap(part, 0, part->size, SPI_FLASH_MMAP_DATA, &ptr, &image_handle) != ESP_OK) {
+		ESP_LOGE(TAG, "Could not map the %u byte \"%s\" partition", part->size, ASSET_LABEL);
+		return false;
+	}
+	image = ptr;
+	if (!image_valid(part->size)) {
+		ESP_LOGE(TAG, "\"%s\" partition holds no asset image, flash it with make flash", ASSET_LABEL);
+		spi_flash_munmap(image_handle);
+		image = NULL;
+		return false;
+	}
+
+#if LV_USE_FILESYSTEM
+	static lv_fs_drv_t drv;
+
+	lv_fs_drv_init(&drv);
+	drv.letter = letter;
+	drv.file_size = sizeof(asset_file_t);
+	drv.ready_cb = fs_ready;
+	drv.open_cb = fs_open;
+	drv.close_cb = fs_close;
+	drv.read_cb = fs_read;
+	drv.seek_cb = fs_seek;
+	drv.tell_cb = fs_tell;
+	drv.size_cb = fs_size;
+#if LV_FS_CACHE_BLOCK_SIZE
+	// Reads are already copies from mapped flash
+	drv.cache_blocks = 0;
+#endif
+	lv_fs_drv_register(&drv);
+#endif
+
+	ESP_LOGI(TAG, "Mapped %u assets from 0x%x", num_entries, part->address);
+	return true;
+}
+
+
+// Look up the asset called name, name_len long and not necessarily terminated,
+// loading asset
+bool asset_fs_find(const char* name, uint16_t name_len, asset_t* asset)
+{
+	uint32_t i;
+
+	if ((image == NULL) || (name_len >= ASSET_NAME_LEN)) return false;
+
+	for (i=0; i<num_entries; i++) {
+		if ((memcmp(entries[i].name, name, name_len) == 0) && (entries[i].name[name_len] == '\0')) {
+			asset->data = image + entries[i].offset;
+			asset->len = entries[i].len;
+			asset->etag = entries[i].etag;
+			return true;
+		}
+	}
+	return false;
+}
+
+
+// Load dsc to draw the LittlevGL .bin image called name in place from flash, as if
+// it had been compiled in.  A PNG or JPEG is left for the image decoders to size.
+bool asset_fs_img(const char* name, lv_img_dsc_t* dsc)
+{
+	asset_t asset;
+
+	if (!asset_fs_find(name, strlen(name), &asset) || (asset.len < sizeof(lv_img_header_t))) {
+		return false;
+	}
+#if WS_DRIVER_IMG_DEC
+	if (img_dec_is_encoded(asset.data, asset.len)) {
+		memset(&dsc->header, 0, sizeof(lv_img_header_t));
+		dsc->header.cf = LV_IMG_CF_RAW;
+		dsc->data = asset.data;
+		dsc->data_size = asset.len;
+		return true;
+	}
+#endif
+	memcpy(&dsc->header, asset.data, sizeof(lv_img_header_t));
+	if ((dsc->header.always_zero != 0) || (dsc->header.cf == LV_IMG_CF_UNKNOWN)) {
+		return false;
+	}
+	dsc->data = asset.data + sizeof(lv_img_header_t);
+	dsc->data_size = asset.len - sizeof(lv_img_header_t);
+	return true;
+}
+
+
+/**********************
+ *   STATIC FUNCTIONS
+ **********************/
+// Check the mapped image's table of contents, which must fit the partition's size bytes
+// along with every file it lists
+static bool image_valid(uint32_t size)
+{
+	uint32_t i;
+
+	if ((size < 8) || (memcmp(image, ASSET_MAGIC, 4) != 0)) return false;
+	memcpy(&num_entries, image + 4, sizeof(uint32_t));
+	if (num_entries > (size - 8) / sizeof(asset_entry_t)) return false;
+	entries = (const asset_entry_t*) (image + 8);
+
+	for (i=0; i<num_entries; i++) {
+		if ((memchr(entries[i].name, '\0', ASSET_NAME_LEN) == NULL) ||
+			(entries[i].offset > size) || (entries[i].len > size - entries[i].offset)) {
+			return false;
+		}
+	}
+	return true;
+}
+
+
+#if LV_USE_FILESYSTEM
+static bool fs_ready(lv_fs_drv_t * drv)
+{
+	return (image != NULL);
+}
+
+
+// Assets are read only
+static lv_fs_res_t fs_open(lv_fs_drv_t * drv, void * file_p, const char * path, lv_fs_mode_t mode)
+{
+	asset_file_t* f = file_p;
+	asset_t asset;
+
+	if (mode & LV_FS_MODE_WR) return LV_FS_RES_DENIED;
+	if (!asset_fs_find(path, strlen(path), &asset)) return LV_FS_RES_NOT_EX;
+
+	f->data = asset.data;
+	f->len = asset.len;
+	f->pos = 0;
+	return LV_FS_RES_OK;
+}
+
+
+static lv_fs_res_t fs_close(lv_fs_drv_t * drv, void * file_p)
+{
+	return LV_FS_RES_OK;
+}
+
+
+static lv_fs_res_t fs_read(lv_fs_drv_t * drv, void * file_p, void * buf, uint32_t btr, uint32_t * br)
+{
+	asset_file_t* f = file_p;
+
+	if (btr > f->len - f->pos) btr = f->len - f->pos;
+	memcpy(buf, f->data + f->pos, btr);
+	f->pos += btr;
+	*br = btr;
+	return LV_FS_RES_OK;
+}
+
+
+static lv_fs_res_t fs_seek(lv_fs_drv_t * drv, void * file_p, uint32_t pos)
+{
+	asset_file_t* f = file_p;
+
+	f->pos = (pos < f->len) ? pos : f->len;
+	return LV_FS_RES_OK;
+}
+
+
+static lv_fs_res_t fs_tell(lv_fs_drv_t * drv, void * file_p, uint32_t * pos_p)
+{
+	*pos_p = ((asset_file_t*) file_p)->pos;
+	return LV_FS_RES_OK;
+}
+
+
+static lv_fs_res_t fs_size(lv_fs_drv_t * drv, void * file_p, uint32_t * size_p)
+{
+	*size_p = ((asset_file_t*) file_p)->len;
+	return LV_FS_RES_OK;
+}
+#endif /* LV_USE_FILESYSTEM */
+
+#endif /* WS_DRIVER_ASSETS */
@@ -0,0 +1,49 @@
+/**
+* Flash asset partition for the LittleVGL websocket driver
+*
+* Maps the "assets" data partition, an image packed by tools/mkassets.py, into the
+* address space so the web server sends its files straight from flash and LittlevGL
+* reads them through an lv_fs drive, or draws images in place without copying them.
+* Keeping the page, icon and images out of the app makes it smaller and quicker to
+* update.
+*
+*/
+#ifndef ASSET_FS_H
+#define ASSET_FS_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*********************
+ *      INCLUDES
+ *********************/
+#include <stdint.h>
+#include <stdbool.h>
+#include "lvgl/lvgl.h"
+
+
+/**********************
+ *      TYPEDEFS
+ **********************/
+typedef struct
+{
+	const uint8_t* data;    // in mapped flash
+	uint32_t len;
+	uint32_t etag;          // FNV-1a hash of the data, computed when packed
+} asset_t;
+
+
+/**********************
+ * GLOBAL PROTOTYPES
+ **********************/
+bool asset_fs_init(char letter);
+bool asset_fs_find(const char* name, uint16_t name_len, asset_t* asset);
+bool asset_fs_img(const char* name, lv_img_dsc_t* dsc);
+
+
+#ifdef __cplusplus
+} /* extern "C" */
+#endif
+
+#endif /* ASSET_FS_H */
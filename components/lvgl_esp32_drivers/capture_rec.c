@@ -0,0 +1,522 @@
+/**
+* Frame capture for the LittleVGL websocket driver
+*
+* A capture records exactly what a viewer is sent, so no browser need be connected.
+* The capture task opens a loopback connection to the raw viewer port and says hello as
+* a page would, without acknowledgements, so it gets the whole screen and then every
+* message a page announcing the same encodings would, held back only by TCP.  It
+* answers the server's pings and writes every other message to the "capture" flash
+* partition a sector at a time, erasing each just before it is written.  Browsers'
+* pointer events are queued by the websocket server task under a spinlock and written
+* by the capture task with the time they arrived.
+*
+* The partition holds a header of CAPTURE_MAGIC, CAPTURE_VERSION, LV_COLOR_DEPTH and the
+* big-endian horizontal and vertical resolution, then records of the big-endian time in
+* mS since the capture started, a type and the big-endian length of what follows.  The
+* type is the first byte of the message's raw viewer header (FIN bit and opcode), or
+* TYPE_POINTER for a pointer event of the client number, flag and big-endian x and y.
+* The records end with an erased (all 0xFF) time or at the end of the partition.
+* Pointer events are written up to POLL_MS after messages that came later, so a player
+* sorts the records by time.
+*
+*/
+
+/*********************
+ *      INCLUDES
+ *********************/
+#include "capture_rec.h"
+#include "websocket_driver.h"
+#include "websocket.h"
+#include "lvgl/lvgl.h"
+#include "esp_log.h"
+#include "esp_heap_caps.h"
+#include "esp_partition.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include <stdio.h>
+#include <string.h>
+
+
+/*********************
+ *      DEFINES
+ *********************/
+#define CAPTURE_LABEL      "capture"
+#define CAPTURE_MAGIC      "LVCP"
+#define CAPTURE_VERSION    1
+#define CAPTURE_HEADER_LEN 10
+
+#define RECORD_HEADER_LEN  9
+#define TYPE_POINTER       0xFF
+#define POINTER_LEN        6
+#define END_TIME           0xFFFFFFFF
+
+// Flash erase unit, the unit the capture is written in
+#define SECTOR_LEN         4096
+
+// Pointer events queued between passes of the capture task, more are dropped
+#define POINTER_RING_LEN   64
+
+// Longest control message payload, as in websocket
+#define CONTROL_MAX        125
+
+// How often the capture task checks for pointer events and being stopped, in mS
+#define POLL_MS            100
+
+// Size of each part of a download
+#define CHUNK_LEN          1024
+
+
+/**********************
+ *      TYPEDEFS
+ **********************/
+typedef enum
+{
+	CAP_IDLE,
+	CAP_CAPTURING,
+	CAP_STOPPING,     // Asked to stop, still writing what it has
+	CAP_BUSY          // Being downloaded
+} cap_state_t;
+
+typedef struct
+{
+	uint32_t time;
+	uint16_t x;
+	uint16_t y;
+	uint8_t num;
+	uint8_t flag;
+} cap_pointer_t;
+
+// Where the capture task is in the messages it is being sent
+typedef struct
+{
+	uint8_t header[WS_RAW_HEADER_LEN];
+	uint8_t header_len;
+	uint32_t remain;          // Payload bytes still to come
+	bool control;
+	uint8_t control_len;
+	uint8_t control_data[CONTROL_MAX];
+} cap_parser_t;
+
+
+/**********************
+ *  STATIC VARIABLES
+ **********************/
+static const char* TAG = "capture_rec";
+
+static const esp_partition_t* part = NULL;
+static uint16_t port;
+static uint8_t hello_msg[WS_RAW_HEADER_LEN + 32];
+static uint8_t hello_msg_len;
+static TaskHandle_t capture_handle;
+
+static volatile cap_state_t state = CAP_IDLE;
+static portMUX_TYPE cap_mux = portMUX_INITIALIZER_UNLOCKED;
+
+// Bytes of the partition the last capture filled
+static uint32_t captured_len = 0;
+
+// Only used by the capture task
+static uint8_t* sector;
+static uint32_t sector_fill;
+static uint32_t offset;             // Partition offset of the sector being filled
+static int64_t start_us;
+static cap_parser_t parser;
+
+static cap_pointer_t pointers[POINTER_RING_LEN];
+static uint32_t pointer_head = 0;
+static uint32_t pointer_tail = 0;
+static uint32_t pointers_dropped;
+
+
+/**********************
+ *  STATIC PROTOTYPES
+ **********************/
+static void capture_task(void* pvParameters);
+static void capture_run();
+static bool cap_begin(cap_state_t from, cap_state_t to);
+static bool cap_feed(struct netconn* conn, const uint8_t* data, uint32_t len);
+static bool cap_pointers();
+static bool cap_record(uint32_t time, uint8_t type, uint32_t len);
+static bool cap_append(const void* data, uint32_t len);
+static void cap_flush();
+static uint32_t cap_scan();
+static void put_be32(uint8_t* p, uint32_t v);
+static uint32_t get_be32(const uint8_t* p);
+
+
+/**********************
+ *   GLOBAL FUNCTIONS
+ **********************/
+// Find the capture partition and start the capture task, which captures from the raw
+// viewer port raw_port saying hello (a page's hello message of hello_len bytes).
+// Returns false, leaving captures unavailable, if there is no partition.
+bool capture_rec_init(uint16_t raw_port, const uint8_t* hello, uint8_t hello_len)
+{
+	part = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY, CAPTURE_LABEL);
+	if (part == NULL) {
+		ESP_LOGE(TAG, "No \"%s\" partition", CAPTURE_LABEL);
+		return false;
+	}
+	sector = heap_caps_malloc(SECTOR_LEN, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+	if ((sector == NULL) || (hello_len > sizeof(hello_msg) - WS_RAW_HEADER_LEN)) {
+		ESP_LOGE(TAG, "Could not allocate the capture buffer");
+		part = NULL;
+		return false;
+	}
+
+	port = raw_port;
+	hello_msg[0] = 0x80 | WEBSOCKET_OPCODE_BIN;
+	put_be32(&hello_msg[1], hello_len);
+	memcpy(&hello_msg[WS_RAW_HEADER_LEN], hello, hello_len);
+	hello_msg_len = WS_RAW_HEADER_LEN + hello_len;
+
+	captured_len = cap_scan();
+	if (captured_len > 0) ESP_LOGI(TAG, "%u bytes captured", captured_len);
+	websocket_driver_create_task(&capture_task, "capture_task", 3000, NULL, WS_DRIVER_TELEMETRY_PRIO, &capture_handle,
+		WS_DRIVER_NET_CORE, false);
+	return true;
+}
+
+
+// Erase the last capture and start a new one.  Fails while capturing or busy.
+bool capture_rec_start()
+{
+	if ((part == NULL) || !cap_begin(CAP_IDLE, CAP_CAPTURING)) return false;
+	xTaskNotifyGive(capture_handle);
+	return true;
+}
+
+
+// Stop capturing.  What was captured is written in the background.
+void capture_rec_stop()
+{
+	(void) cap_begin(CAP_CAPTURING, CAP_STOPPING);
+}
+
+
+// Queue a pointer event client num sent, if capturing
+void capture_rec_pointer(uint8_t num, uint8_t flag, uint16_t x, uint16_t y)
+{
+	cap_pointer_t* p;
+
+	portENTER_CRITICAL(&cap_mux);
+	if (state == CAP_CAPTURING) {
+		if ((pointer_head - pointer_tail) < POINTER_RING_LEN) {
+			p = &pointers[pointer_head++ % POINTER_RING_LEN];
+			p->time = (esp_timer_get_time() - start_us) / 1000;
+			p->num = num;
+			p->flag = flag;
+			p->x = x;
+			p->y = y;
+		} else {
+			pointers_dropped++;
+		}
+	}
+	portEXIT_CRITICAL(&cap_mux);
+}
+
+
+// Send the last capture as the body of an HTTP response, or 409 Conflict while one is
+// being made
+void capture_rec_write(struct netconn* conn)
+{
+	const static char CONFLICT[] = "HTTP/1.1 409 Conflict\r\nContent-Length: 0\r\nConnection: close\r\n\r\n";
+	char buf[CHUNK_LEN];
+	uint32_t pos, n;
+	int len;
+
+	if ((part == NULL) || !cap_begin(CAP_IDLE, CAP_BUSY)) {
+		netconn_write(conn, CONFLICT, sizeof(CONFLICT) - 1, NETCONN_NOCOPY);
+		return;
+	}
+
+	len = sprintf(buf, "HTTP/1.1 200 OK\r\nContent-Type: application/octet-stream\r\nContent-Length: %u\r\n"
+		"Content-Disposition: attachment; filename=\"capture.bin\"\r\nCache-Control: no-store\r\n"
+		"Connection: close\r\n\r\n", captured_len);
+	if (netconn_write(conn, buf, len, NETCONN_COPY) == ERR_OK) {
+		for (pos=0; pos < captured_len; pos += n) {
+			n = LV_MATH_MIN(sizeof(buf), captured_len - pos);
+			if ((esp_partition_read(part, pos, buf, n) != ESP_OK) ||
+				(netconn_write(conn, buf, n, NETCONN_COPY) != ERR_OK)) {
+				break;
+			}
+		}
+	}
+
+	(void) cap_begin(CAP_BUSY, CAP_IDLE);
+}
+
+
+/**********************
+ *   STATIC FUNCTIONS
+ **********************/
+static void capture_task(void* pvParameters)
+{
+	for (;;) {
+		ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+		capture_run();
+		portENTER_CRITICAL(&cap_mux);
+		state = CAP_IDLE;
+		portEXIT_CRITICAL(&cap_mux);
+	}
+}
+
+
+// Capture until stopped, the partition is full or the driver drops the connection
+static void capture_run()
+{
+	struct netconn* conn;
+	struct netbuf* inbuf;
+	ip_addr_t addr;
+	uint8_t header[CAPTURE_HEADER_LEN];
+	void* data;
+	u16_t len;
+	err_t err;
+	bool ok = true;
+
+	portENTER_CRITICAL(&cap_mux);
+	start_us = esp_timer_get_time();
+	pointer_tail = pointer_head;
+	pointers_dropped = 0;
+	portEXIT_CRITICAL(&cap_mux);
+	captured_len = 0;
+	offset = 0;
+	sector_fill = 0;
+	memset(&parser, 0, sizeof(parser));
+	// So a capture cut short by a reset isn't read as the end of the last one
+	esp_partition_erase_range(part, 0, SECTOR_LEN);
+
+	memcpy(header, CAPTURE_MAGIC, 4);
+	header[4] = CAPTURE_VERSION;
+	header[5] = LV_COLOR_DEPTH;
+	header[6] = LV_HOR_RES_MAX >> 8;
+	header[7] = LV_HOR_RES_MAX & 0xFF;
+	header[8] = LV_VER_RES_MAX >> 8;
+	header[9] = LV_VER_RES_MAX & 0xFF;
+	cap_append(header, sizeof(header));
+
+	IP_ADDR4(&addr, 127, 0, 0, 1);
+	conn = netconn_new(NETCONN_TCP);
+	if ((conn == NULL) || (netconn_connect(conn, &addr, port) != ERR_OK) ||
+		(netconn_write(conn, hello_msg, hello_msg_len, NETCONN_COPY) != ERR_OK)) {
+		ESP_LOGE(TAG, "Could not connect to port %d", port);
+		ok = false;
+	} else {
+		ESP_LOGI(TAG, "Capturing");
+		netconn_set_recvtimeout(conn, POLL_MS);
+	}
+
+	while (ok && (state == CAP_CAPTURING)) {
+		// Pointer events go between messages
+		if ((parser.header_len == 0) && !cap_pointers()) break;
+		err = netconn_recv(conn, &inbuf);
+		if (err == ERR_TIMEOUT) continue;
+		if (err != ERR_OK) {
+			ESP_LOGW(TAG, "Connection closed by the driver");
+			break;
+		}
+		do {
+			netbuf_data(inbuf, &data, &len);
+			ok = cap_feed(conn, data, len);
+		} while (ok && (netbuf_next(inbuf) >= 0));
+		netbuf_delete(inbuf);
+	}
+	if (ok && (parser.header_len == 0)) (void) cap_pointers();
+
+	if (conn != NULL) {
+		netconn_close(conn);
+		netconn_delete(conn);
+	}
+	cap_flush();
+	ESP_LOGI(TAG, "Captured %u bytes%s", captured_len, (offset >= part->size) ? ", partition full" : "");
+	if (pointers_dropped > 0) ESP_LOGW(TAG, "%u pointer events dropped", pointers_dropped);
+}
+
+
+// Change the state from from to to, returning false if it wasn't from
+static bool cap_begin(cap_state_t from, cap_state_t to)
+{
+	bool ok;
+
+	portENTER_CRITICAL(&cap_mux);
+	ok = (state == from);
+	if (ok) state = to;
+	portEXIT_CRITICAL(&cap_mux);
+
+	return ok;
+}
+
+
+// Take in what the driver sent, recording messages, with the pointer events queued
+// after each, and answering pings.  Returns false once the partition is full.
+static bool cap_feed(struct netconn* conn, const uint8_t* data, uint32_t len)
+{
+	cap_parser_t* ps = &parser;
+	uint8_t pong[WS_RAW_HEADER_LEN];
+	uint32_t n;
+
+	while (len > 0) {
+		if (ps->header_len < WS_RAW_HEADER_LEN) {
+			ps->header[ps->header_len++] = *data++;
+			len--;
+			if (ps->header_len < WS_RAW_HEADER_LEN) continue;
+			ps->remain = get_be32(&ps->header[1]);
+			// Opcodes 8 and up are control messages
+			ps->control = (ps->header[0] & 0x08) != 0;
+			ps->control_len = 0;
+			if (ps->control && (ps->remain > CONTROL_MAX)) return false;
+			if (!ps->control && !cap_record((esp_timer_get_time() - start_us) / 1000, ps->header[0], ps->remain)) {
+				return false;
+			}
+		} else {
+			n = LV_MATH_MIN(len, ps->remain);
+			if (ps->control) {
+				memcpy(&ps->control_data[ps->control_len], data, n);
+				ps->control_len += n;
+			} else if (!cap_append(data, n)) {
+				return false;
+			}
+			data += n;
+			len -= n;
+			ps->remain -= n;
+		}
+
+		if (ps->remain > 0) continue;
+		if (ps->control && ((ps->header[0] & 0x0F) == WEBSOCKET_OPCODE_PING)) {
+			pong[0] = 0x80 | WEBSOCKET_OPCODE_PONG;
+			put_be32(&pong[1], ps->control_len);
+			netconn_write(conn, pong, sizeof(pong), NETCONN_COPY);
+			if (ps->control_len > 0) netconn_write(conn, ps->control_data, ps->control_len, NETCONN_COPY);
+		}
+		ps->header_len = 0;
+		if (!cap_pointers()) return false;
+	}
+	return true;
+}
+
+
+// Record the pointer events queued.  Returns false once the partition is full.
+static bool cap_pointers()
+{
+	cap_pointer_t p;
+	uint8_t rec[POINTER_LEN];
+	bool ok = true;
+
+	for (;;) {
+		portENTER_CRITICAL(&cap_mux);
+		if (pointer_tail == pointer_head) {
+			portEXIT_CRITICAL(&cap_mux);
+			break;
+		}
+		p = pointers[pointer_tail++ % POINTER_RING_LEN];
+		portEXIT_CRITICAL(&cap_mux);
+
+		rec[0] = p.num;
+		rec[1] = p.flag;
+		rec[2] = p.x >> 8;
+		rec[3] = p.x & 0xFF;
+		rec[4] = p.y >> 8;
+		rec[5] = p.y & 0xFF;
+		ok = ok && cap_record(p.time, TYPE_POINTER, POINTER_LEN) && cap_append(rec, POINTER_LEN);
+	}
+	return ok;
+}
+
+
+static bool cap_record(uint32_t time, uint8_t type, uint32_t len)
+{
+	uint8_t rec[RECORD_HEADER_LEN];
+
+	// Keep clear of the end marker
+	put_be32(rec, LV_MATH_MIN(time, END_TIME - 1));
+	rec[4] = type;
+	put_be32(&rec[5], len);
+	return cap_append(rec, sizeof(rec));
+}
+
+
+// Add data to the capture, writing each sector as it fills.  Returns false once the
+// partition is full.
+static bool cap_append(const void* data, uint32_t len)
+{
+	const uint8_t* p = data;
+	uint32_t n;
+
+	while (len > 0) {
+		if (offset >= part->size) return false;
+		n = LV_MATH_MIN(len, SECTOR_LEN - sector_fill);
+		memcpy(&sector[sector_fill], p, n);
+		sector_fill += n;
+		p += n;
+		len -= n;
+		if (sector_fill == SECTOR_LEN) {
+			if ((esp_partition_erase_range(part, offset, SECTOR_LEN) != ESP_OK) ||
+				(esp_partition_write(part, offset, sector, SECTOR_LEN) != ESP_OK)) {
+				ESP_LOGE(TAG, "Could not write at 0x%x", offset);
+				offset = part->size;
+				return false;
+			}
+			offset += SECTOR_LEN;
+			captured_len = offset;
+			sector_fill = 0;
+		}
+	}
+	return true;
+}
+
+
+// Write the sector being filled, and erase the next so the records end there
+static void cap_flush()
+{
+	uint32_t end = offset;
+
+	if ((sector_fill > 0) && (offset < part->size)) {
+		memset(&sector[sector_fill], 0xFF, SECTOR_LEN - sector_fill);
+		if ((esp_partition_erase_range(part, offset, SECTOR_LEN) == ESP_OK) &&
+			(esp_partition_write(part, offset, sector, SECTOR_LEN) == ESP_OK)) {
+			end = offset + sector_fill;
+		}
+		offset += SECTOR_LEN;
+	}
+	if (offset < part->size) {
+		esp_partition_erase_range(part, offset, SECTOR_LEN);
+	}
+	captured_len = end;
+}
+
+
+// Returns the length of the capture in the partition, 0 if there is none
+static uint32_t cap_scan()
+{
+	uint8_t buf[RECORD_HEADER_LEN];
+	uint32_t pos = CAPTURE_HEADER_LEN;
+
+	if ((esp_partition_read(part, 0, buf, 5) != ESP_OK) || (memcmp(buf, CAPTURE_MAGIC, 4) != 0) ||
+		(buf[4] != CAPTURE_VERSION)) {
+		return 0;
+	}
+	while (pos + RECORD_HEADER_LEN <= part->size) {
+		if ((esp_partition_read(part, pos, buf, RECORD_HEADER_LEN) != ESP_OK) || (get_be32(buf) == END_TIME) ||
+			(get_be32(&buf[5]) > part->size)) {
+			break;
+		}
+		pos += RECORD_HEADER_LEN + get_be32(&buf[5]);
+	}
+	return LV_MATH_MIN(pos, part->size);
+}
+
+
+static void put_be32(uint8_t* p, uint32_t v)
+{
+	p[0] = v >> 24;
+	p[1] = v >> 16;
+	p[2] = v >> 8;
+	p[3] = v;
+}
+
+
+static uint32_t get_be32(const uint8_t* p)
+{
+	return ((uint32_t) p[0] << 24) | ((uint32_t) p[1] << 16) | ((uint32_t) p[2] << 8) | p[3];
+}
@@ -0,0 +1,37 @@
+/**
+* Frame capture for the LittleVGL websocket driver
+*
+* Records the messages a viewer is sent, and the pointer input browsers send, to a
+* flash partition for tools/capture_play.py to play back.
+*
+*/
+#ifndef CAPTURE_REC_H
+#define CAPTURE_REC_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*********************
+ *      INCLUDES
+ *********************/
+#include <stdint.h>
+#include <stdbool.h>
+#include "lwip/api.h"
+
+
+/**********************
+ * GLOBAL PROTOTYPES
+ **********************/
+bool capture_rec_init(uint16_t raw_port, const uint8_t* hello, uint8_t hello_len);
+bool capture_rec_start();
+void capture_rec_stop();
+void capture_rec_pointer(uint8_t num, uint8_t flag, uint16_t x, uint16_t y);
+void capture_rec_write(struct netconn* conn);
+
+
+#ifdef __cplusplus
+} /* extern "C" */
+#endif
+
+#endif /* CAPTURE_REC_H */
@@ -2,4 +2,18 @@
 
 COMPONENT_SRCDIRS := . 
 COMPONENT_ADD_INCLUDEDIRS := .
-COMPONENT_EMBED_FILES := ./index.html ./favicon.ico
+
+# With the asset partition the page and icon are packed by Makefile.projbuild instead
+ifndef CONFIG_WEBSOCKET_DRIVER_ASSETS
+COMPONENT_EMBED_FILES := $(COMPONENT_BUILD_DIR)/index.html.gz ./favicon.ico
+COMPONENT_EXTRA_CLEAN := index.html.gz
+
+# The page is served gzip compressed, recompress it whenever it changes
+$(COMPONENT_BUILD_DIR)/index.html.gz: $(COMPONENT_PATH)/index.html
+	gzip -9 -n -c $< > $@
+endif
+
+# The TLS server's certificate and key, kept out of the repository
+ifdef CONFIG_WEBSOCKET_DRIVER_TLS
+COMPONENT_EMBED_TXTFILES := $(PROJECT_PATH)/certs/server_cert.pem $(PROJECT_PATH)/certs/server_key.pem
+endif
@@ -0,0 +1,578 @@
+/**
+* Draw command stream for the LittleVGL websocket driver
+*
+* LittleVGL reports each primitive it draws through the display driver's draw_cb, which
+* records it in a list kept for the buffer being drawn.  When the buffer is flushed the
+* sender task packs its list into commands a browser replays on its canvas to draw the
+* same pixels, then resets the list before LittleVGL gets the buffer back, so the LVGL
+* task only ever records into one list while the sender packs the other.  A list whose
+* buffer drew anything that can't be replayed, such as a recoloured image, or more
+* primitives than the list holds is marked invalid and its buffer is sent as pixels.
+*
+* Commands follow a region header with the encoding PIXEL_ENC_DRAW.  Coordinates are
+* absolute and every command draws within the region, each colour is a big-endian
+* RGB565 value and opacities are those LittleVGL drew with:
+*   0x00  end of the commands
+*   0x01  x1 y1 x2 y2 colour          fill the area
+*   0x02  x1 y1 x2 y2 colour opa      blend the colour over the area
+*   0x03  x y colour opa              blend the colour into one pixel, set it at 255
+*   0x04  id w h bpp bitmap           define glyph slot id from its packed bitmap
+*   0x05  x1 y1 x2 y2                 clip the following letters to the area
+*   0x06  colour opa                  colour and opacity of the following letters
+*   0x07  id x y                      draw glyph slot id with its box's top left at
+*                                     the signed x, y
+*   0x08  id w h y rows pixels        set rows y to y + rows - 1 of the w x h image in
+*                                     image slot id
+*   0x09  id x y x1 y1 x2 y2          draw image slot id with its top left at the
+*                                     signed x, y, clipped to the area
+* The blends are LittleVGL's own: fills mix 5-bit fractions of 32, pixels and letters
+* 8-bit ones of 255 and letters skip pixels already their colour, so a browser replaying
+* them over the pixels it already has reproduces the buffer exactly.
+*
+* Glyphs are kept in a small direct-mapped table of the fonts and letters each slot was
+* last defined with and the clients known to have the definition.  The bitmaps are used
+* where the font holds them, so this only suits fonts whose bitmaps stay in place like
+* the built-in ones; a buffer with letters from a compressed font is sent as pixels.  Only the sender task uses the table.
+*
+* Opaque true color images drawn straight from a C array, such as wallpapers and icons,
+* are cached the same way in bands of rows.  Each band is sent, as full width rows of
+* pixels, before the first command drawing from it for a client that hasn't had it.
+* Images can change while their descriptor stays the same, as a canvas does, so the
+* LVGL task hashes the bands an image covers as it draws it and a band whose hash differs
+* from the one it was sent with is sent again.  The sender hashes the pixels it copies
+* too, sending the buffer as pixels if the image changed after it was drawn.
+*
+*/
+
+/*********************
+ *      INCLUDES
+ *********************/
+#include "draw_stream.h"
+#include "esp_log.h"
+#include "esp_heap_caps.h"
+#include "string.h"
+
+
+/*********************
+ *      DEFINES
+ *********************/
+// Glyph table slots (must be a power of 2 no larger than 256, each id being a byte)
+#define GLYPH_SLOTS   256
+
+// Image table slots (a power of 2 no larger than 256), the rows in each band of an
+// image and the most bands, images taller than 512 rows not being cached
+#define IMAGE_SLOTS      8
+#define IMAGE_BAND_ROWS  16
+#define IMAGE_MAX_BANDS  32
+
+// Commands, see above
+#define CMD_END     0x00
+#define CMD_FILL    0x01
+#define CMD_BLEND   0x02
+#define CMD_PX      0x03
+#define CMD_GLYPH   0x04
+#define CMD_CLIP    0x05
+#define CMD_COLOR   0x06
+#define CMD_LETTER  0x07
+#define CMD_ROWS    0x08
+#define CMD_IMAGE   0x09
+
+
+/**********************
+ *      TYPEDEFS
+ **********************/
+typedef struct
+{
+	lv_disp_draw_type_t type;
+	lv_opa_t opa;
+	lv_color_t color;
+	lv_area_t area;           // Area filled or the pixel set, the clip area of a letter or image
+	lv_coord_t x;             // Top left of a letter's box or an image
+	lv_coord_t y;
+	const lv_font_t* font;
+	uint32_t letter;
+	const void* src;          // The image's descriptor
+	const uint8_t* bitmap;    // The font's packed bitmap of the letter, or the image's pixels
+	lv_coord_t w;
+	lv_coord_t h;
+	uint8_t bpp;
+	uint8_t band;             // First band of an image drawn and the number drawn from
+	uint8_t bands;
+	uint32_t hashes;          // Index of the hash of the first band in its list's hashes
+} draw_op_t;
+
+typedef struct
+{
+	const lv_color_t* buf;    // LittleVGL buffer drawn into
+	draw_op_t* ops;
+	uint32_t num_ops;
+	uint32_t* hashes;         // Of the image bands drawn, up to max_list_ops of them
+	uint32_t num_hashes;
+	bool valid;               // Cleared once something not recorded was drawn
+	bool image_drawn;         // Set until the map drawing a recorded image is reported
+} draw_list_t;
+
+typedef struct
+{
+	const lv_font_t* font;    // NULL while the slot is unused
+	uint32_t letter;
+	uint32_t known;           // Clients sent the definition, one bit per client
+	uint32_t packed;          // pack_seq of the last pack that defined the slot
+} glyph_slot_t;
+
+typedef struct
+{
+	const void* src;          // Image descriptor, NULL while the slot is unused
+	const uint8_t* map;       // Its pixels
+	lv_coord_t w;
+	lv_coord_t h;
+	uint32_t hash[IMAGE_MAX_BANDS];    // Of each band when it was last packed
+	uint32_t known[IMAGE_MAX_BANDS];   // Clients sent each band, one bit per client
+	uint32_t packed[IMAGE_MAX_BANDS];  // pack_seq of the last pack that sent each band
+} image_slot_t;
+
+
+/**********************
+ *  STATIC VARIABLES
+ **********************/
+static const char* TAG = "draw_stream";
+
+static draw_list_t lists[2];
+static uint32_t max_list_ops = 0;
+
+// Set by the sender task while browsers take commands, recording stops otherwise
+static volatile bool recording = false;
+
+static glyph_slot_t glyphs[GLYPH_SLOTS];
+static image_slot_t images[IMAGE_SLOTS];
+static uint32_t pack_seq = 0;
+
+
+/**********************
+ *  STATIC PROTOTYPES
+ **********************/
+static draw_list_t* find_list(const lv_color_t* buf);
+static uint8_t glyph_slot(const lv_font_t* font, uint32_t letter);
+static bool record_image(draw_list_t* list, draw_op_t* op, const lv_disp_draw_t* draw);
+static uint8_t image_slot(const draw_op_t* op);
+static uint32_t hash_band(const draw_op_t* op, uint32_t band, uint8_t* buf);
+static inline uint32_t band_rows(lv_coord_t h, uint32_t band);
+static inline uint8_t* pack_u16(uint8_t* buf, uint16_t v);
+static inline uint8_t* pack_area(uint8_t* buf, const lv_area_t* area);
+
+
+/**********************
+ *   GLOBAL FUNCTIONS
+ **********************/
+// Allocate a list of up to max_ops primitives and image band hashes for each of
+// LittleVGL's two buffers, with the heap capabilities caps
+bool draw_stream_init(const lv_color_t* buf1, const lv_color_t* buf2, uint32_t max_ops, uint32_t caps)
+{
+	int i;
+
+	for (i=0; i<2; i++) {
+		lists[i].buf = (i == 0) ? buf1 : buf2;
+		lists[i].ops = heap_caps_malloc(max_ops * sizeof(draw_op_t), caps);
+		lists[i].hashes = heap_caps_malloc(max_ops * sizeof(uint32_t), caps);
+		lists[i].num_ops = 0;
+		lists[i].num_hashes = 0;
+		lists[i].valid = true;
+		lists[i].image_drawn = false;
+	}
+	if ((lists[0].ops == NULL) || (lists[1].ops == NULL) ||
+		(lists[0].hashes == NULL) || (lists[1].hashes == NULL)) {
+		ESP_LOGW(TAG, "Could not allocate %u draw commands, sending pixels", max_ops);
+		for (i=0; i<2; i++) {
+			heap_caps_free(lists[i].ops);
+			heap_caps_free(lists[i].hashes);
+			lists[i].ops = NULL;
+			lists[i].hashes = NULL;
+		}
+		return false;
+	}
+	memset(glyphs, 0, sizeof(glyphs));
+	memset(images, 0, sizeof(images));
+	max_list_ops = max_ops;
+	return true;
+}
+
+
+// Display driver draw_cb, recording a primitive drawn into the buffer being drawn
+void draw_stream_record(lv_disp_drv_t * drv, const lv_disp_draw_t * draw)
+{
+	draw_list_t* list = find_list(drv->buffer->buf_act);
+	draw_op_t* op;
+
+	if ((list == NULL) || !list->valid) return;
+	// The map drawing an image just recorded is covered by it
+	if (list->image_drawn) {
+		list->image_drawn = false;
+		if (draw->type == LV_DISP_DRAW_MAP) return;
+	}
+	if (!recording || (draw->type == LV_DISP_DRAW_MAP) || (list->num_ops == max_list_ops)) {
+		list->valid = false;
+		return;
+	}
+
+	op = &list->ops[list->num_ops];
+	op->type = draw->type;
+	op->opa = draw->opa;
+	op->color = draw->color;
+	lv_area_copy(&op->area, &draw->area);
+	if (draw->type == LV_DISP_DRAW_LETTER) {
+		// A glyph with an empty box draws nothing
+		if ((draw->glyph->box_w == 0) || (draw->glyph->box_h == 0)) return;
+		// A compressed font's bitmap is unpacked to a buffer the next letter reuses
+		if ((draw->font->get_glyph_bitmap == lv_font_get_bitmap_fmt_txt) &&
+			(((const lv_font_fmt_txt_dsc_t*) draw->font->dsc)->bitmap_format != LV_FONT_FMT_TXT_PLAIN)) {
+			list->valid = false;
+			return;
+		}
+		op->bitmap = lv_font_get_glyph_bitmap(draw->font, draw->letter);
+		if (op->bitmap == NULL) {
+			list->valid = false;
+			return;
+		}
+		op->x = draw->pos.x;
+		op->y = draw->pos.y;
+		op->font = draw->font;
+		op->letter = draw->letter;
+		op->w = draw->glyph->box_w;
+		op->h = draw->glyph->box_h;
+		op->bpp = draw->glyph->bpp;
+	} else if (draw->type == LV_DISP_DRAW_IMG) {
+		if (!record_image(list, op, draw)) {
+			list->valid = false;
+			return;
+		}
+		list->image_drawn = true;
+	}
+	list->num_ops++;
+}
+
+
+// Start or stop recording what LittleVGL draws.  A buffer drawn partly while stopped is
+// sent as pixels.
+void draw_stream_set_active(bool active)
+{
+	recording = active;
+}
+
+
+// Forget which glyphs and image bands the clients whose bits are set in clients were
+// sent, so they are sent again before they are next used
+void draw_stream_forget(uint32_t clients)
+{
+	int i, j;
+
+	for (i=0; i<GLYPH_SLOTS; i++) {
+		glyphs[i].known &= ~clients;
+	}
+	for (i=0; i<IMAGE_SLOTS; i++) {
+		for (j=0; j<IMAGE_MAX_BANDS; j++) {
+			images[i].known[j] &= ~clients;
+		}
+	}
+}
+
+
+// Returns true if what was drawn into the buffer color_map can be replayed
+bool draw_stream_valid(const lv_color_t* color_map)
+{
+	draw_list_t* list = find_list(color_map);
+
+	return (list != NULL) && list->valid && (list->num_ops > 0);
+}
+
+
+// Pack the commands that drew the buffer color_map into buf, defining the glyphs and
+// sending the image bands used that the clients whose bits are set in clients haven't
+// been sent.  Returns the number of bytes packed, loading images with those of the
+// image bands, or -1 if the buffer can't be replayed or its commands are longer than
+// max_len, when it must be sent as pixels.
+int draw_stream_pack(const lv_color_t* color_map, uint8_t* buf, uint32_t max_len, uint32_t clients, uint32_t* images_len)
+{
+	draw_list_t* list = find_list(color_map);
+	const draw_op_t* op;
+	image_slot_t* image;
+	uint8_t* end = buf + max_len;
+	uint8_t* p = buf;
+	lv_area_t clip;
+	lv_color_t color;
+	lv_opa_t opa = LV_OPA_TRANSP;
+	uint32_t i, j, len, band, hash;
+	uint8_t id;
+	bool letter_style = false;
+
+	*images_len = 0;
+	if (!draw_stream_valid(color_map)) return -1;
+
+	pack_seq++;
+	lv_area_set(&clip, 0, 0, -1, -1);
+	color.full = 0;
+	for (i=0; i<list->num_ops; i++) {
+		op = &list->ops[i];
+		switch (op->type) {
+			case LV_DISP_DRAW_FILL:
+				if ((end - p) < 12) return -1;
+				*p++ = (op->opa == LV_OPA_COVER) ? CMD_FILL : CMD_BLEND;
+				p = pack_area(p, &op->area);
+				p = pack_u16(p, op->color.full);
+				if (op->opa != LV_OPA_COVER) *p++ = op->opa;
+				break;
+			case LV_DISP_DRAW_PX:
+				if ((end - p) < 8) return -1;
+				*p++ = CMD_PX;
+				p = pack_u16(p, op->area.x1);
+				p = pack_u16(p, op->area.y1);
+				p = pack_u16(p, op->color.full);
+				*p++ = op->opa;
+				break;
+			case LV_DISP_DRAW_LETTER:
+				id = glyph_slot(op->font, op->letter);
+				if (((glyphs[id].known & clients) != clients) && (glyphs[id].packed != pack_seq)) {
+					len = ((uint32_t) op->w * op->h * op->bpp + 7) / 8;
+					if ((uint32_t) (end - p) < (5 + len)) return -1;
+					*p++ = CMD_GLYPH;
+					*p++ = id;
+					*p++ = op->w;
+					*p++ = op->h;
+					*p++ = op->bpp;
+					memcpy(p, op->bitmap, len);
+					p += len;
+					glyphs[id].packed = pack_seq;
+				}
+				if ((end - p) < 22) return -1;
+				if ((clip.x1 != op->area.x1) || (clip.y1 != op->area.y1) ||
+					(clip.x2 != op->area.x2) || (clip.y2 != op->area.y2)) {
+					*p++ = CMD_CLIP;
+					p = pack_area(p, &op->area);
+					lv_area_copy(&clip, &op->area);
+				}
+				if (!letter_style || (color.full != op->color.full) || (opa != op->opa)) {
+					*p++ = CMD_COLOR;
+					p = pack_u16(p, op->color.full);
+					*p++ = op->opa;
+					color = op->color;
+					opa = op->opa;
+					letter_style = true;
+				}
+				*p++ = CMD_LETTER;
+				*p++ = id;
+				p = pack_u16(p, (uint16_t) op->x);
+				p = pack_u16(p, (uint16_t) op->y);
+				break;
+			case LV_DISP_DRAW_IMG:
+				id = image_slot(op);
+				image = &images[id];
+				for (j=0; j<op->bands; j++) {
+					band = op->band + j;
+					hash = list->hashes[op->hashes + j];
+					if (image->hash[band] != hash) {
+						// The band changed since it was sent
+						image->hash[band] = hash;
+						image->known[band] = 0;
+						image->packed[band] = 0;
+					}
+					if (((image->known[band] & clients) == clients) || (image->packed[band] == pack_seq)) {
+						continue;
+					}
+					len = band_rows(op->h, band) * op->w * sizeof(lv_color_t);
+					if ((uint32_t) (end - p) < (9 + len)) return -1;
+					*p++ = CMD_ROWS;
+					*p++ = id;
+					p = pack_u16(p, op->w);
+					p = pack_u16(p, op->h);
+					p = pack_u16(p, band * IMAGE_BAND_ROWS);
+					*p++ = band_rows(op->h, band);
+					if (hash_band(op, band, p) != hash) return -1;
+					p += len;
+					*images_len += 9 + len;
+					image->packed[band] = pack_seq;
+				}
+				if ((end - p) < 14) return -1;
+				*p++ = CMD_IMAGE;
+				*p++ = id;
+				p = pack_u16(p, (uint16_t) op->x);
+				p = pack_u16(p, (uint16_t) op->y);
+				p = pack_area(p, &op->area);
+				break;
+			default:
+				return -1;
+		}
+	}
+	if (p == end) return -1;
+	*p++ = CMD_END;
+	return p - buf;
+}
+
+
+// Record that the commands last packed were queued for the clients whose bits are set in
+// clients, along with the glyphs and image bands they sent.  Commands that aren't sent
+// need not be.
+void draw_stream_commit(uint32_t clients)
+{
+	int i, j;
+
+	for (i=0; i<GLYPH_SLOTS; i++) {
+		if (glyphs[i].packed == pack_seq) glyphs[i].known |= clients;
+	}
+	for (i=0; i<IMAGE_SLOTS; i++) {
+		for (j=0; j<IMAGE_MAX_BANDS; j++) {
+			if (images[i].packed[j] == pack_seq) images[i].known[j] |= clients;
+		}
+	}
+}
+
+
+// Empty the list of the buffer color_map before LittleVGL draws into it again
+void draw_stream_reset(const lv_color_t* color_map)
+{
+	draw_list_t* list = find_list(color_map);
+
+	if (list != NULL) {
+		list->num_ops = 0;
+		list->num_hashes = 0;
+		list->valid = true;
+		list->image_drawn = false;
+	}
+}
+
+
+/**********************
+ *   STATIC FUNCTIONS
+ **********************/
+// Returns the list of a buffer, or NULL if draw_stream_init() failed or wasn't given it
+static draw_list_t* find_list(const lv_color_t* buf)
+{
+	int i;
+
+	for (i=0; i<2; i++) {
+		if ((lists[i].ops != NULL) && (lists[i].buf == buf)) return &lists[i];
+	}
+	return NULL;
+}
+
+
+// Returns the slot of a glyph, taking it over from the glyph that had it if necessary
+static uint8_t glyph_slot(const lv_font_t* font, uint32_t letter)
+{
+	uint32_t h = letter * 31 + (uint32_t) ((uintptr_t) font >> 2);
+	glyph_slot_t* slot;
+
+	h ^= h >> 8;
+	slot = &glyphs[h & (GLYPH_SLOTS - 1)];
+	if ((slot->font != font) || (slot->letter != letter)) {
+		slot->font = font;
+		slot->letter = letter;
+		slot->known = 0;
+		slot->packed = 0;
+	}
+	return h & (GLYPH_SLOTS - 1);
+}
+
+
+// Fill in op for an image drawn straight from the pixels of its descriptor, hashing the
+// bands it draws from.  Returns false if it must be sent as pixels.
+static bool record_image(draw_list_t* list, draw_op_t* op, const lv_disp_draw_t* draw)
+{
+	const lv_img_dsc_t* dsc = draw->src;
+	uint32_t first, last, band;
+
+	// Only unscaled, opaque and unrecoloured true color images can be cached
+	if (lv_img_src_get_type(draw->src) != LV_IMG_SRC_VARIABLE) return false;
+	if ((draw->map != dsc->data) || draw->chroma_keyed || draw->alpha_byte ||
+		(draw->opa != LV_OPA_COVER) || (draw->recolor_opa != LV_OPA_TRANSP)) {
+		return false;
+	}
+	if ((draw->size.y > IMAGE_MAX_BANDS * IMAGE_BAND_ROWS) ||
+		(draw->area.x1 < draw->pos.x) || (draw->area.x2 >= draw->pos.x + draw->size.x) ||
+		(draw->area.y1 < draw->pos.y) || (draw->area.y2 >= draw->pos.y + draw->size.y)) {
+		return false;
+	}
+	first = (draw->area.y1 - draw->pos.y) / IMAGE_BAND_ROWS;
+	last = (draw->area.y2 - draw->pos.y) / IMAGE_BAND_ROWS;
+	if ((list->num_hashes + (last - first + 1)) > max_list_ops) return false;
+
+	op->x = draw->pos.x;
+	op->y = draw->pos.y;
+	op->src = draw->src;
+	op->bitmap = draw->map;
+	op->w = draw->size.x;
+	op->h = draw->size.y;
+	op->band = first;
+	op->bands = last - first + 1;
+	op->hashes = list->num_hashes;
+	for (band=first; band<=last; band++) {
+		list->hashes[list->num_hashes++] = hash_band(op, band, NULL);
+	}
+	return true;
+}
+
+
+// Returns the slot of the image an op draws, taking it over from the image that had it
+// if necessary
+static uint8_t image_slot(const draw_op_t* op)
+{
+	uint32_t h = (uint32_t) ((uintptr_t) op->src >> 2);
+	image_slot_t* slot;
+
+	h ^= h >> 8;
+	slot = &images[h & (IMAGE_SLOTS - 1)];
+	if ((slot->src != op->src) || (slot->map != op->bitmap) || (slot->w != op->w) || (slot->h != op->h)) {
+		memset(slot, 0, sizeof(image_slot_t));
+		slot->src = op->src;
+		slot->map = op->bitmap;
+		slot->w = op->w;
+		slot->h = op->h;
+	}
+	return h & (IMAGE_SLOTS - 1);
+}
+
+
+// Returns the FNV-1a hash of the pixels of one band of the image an op draws, also
+// packing them into buf as big-endian values if it isn't NULL
+static uint32_t hash_band(const draw_op_t* op, uint32_t band, uint8_t* buf)
+{
+	const lv_color_t* px = (const lv_color_t*) op->bitmap + band * IMAGE_BAND_ROWS * op->w;
+	uint32_t n = band_rows(op->h, band) * op->w;
+	uint32_t hash = 2166136261u;
+	uint32_t i;
+
+	if (buf == NULL) {
+		for (i=0; i<n; i++) {
+			hash = (hash ^ px[i].full) * 16777619u;
+		}
+	} else {
+		for (i=0; i<n; i++) {
+			hash = (hash ^ px[i].full) * 16777619u;
+			buf = pack_u16(buf, px[i].full);
+		}
+	}
+	return hash;
+}
+
+
+// Returns the number of rows in a band of an image h rows high
+static inline uint32_t band_rows(lv_coord_t h, uint32_t band)
+{
+	return LV_MATH_MIN(IMAGE_BAND_ROWS, h - band * IMAGE_BAND_ROWS);
+}
+
+
+static inline uint8_t* pack_u16(uint8_t* buf, uint16_t v)
+{
+	*buf++ = (v >> 8) & 0xFF;
+	*buf++ =  v       & 0xFF;
+	return buf;
+}
+
+
+static inline uint8_t* pack_area(uint8_t* buf, const lv_area_t* area)
+{
+	buf = pack_u16(buf, area->x1);
+	buf = pack_u16(buf, area->y1);
+	buf = pack_u16(buf, area->x2);
+	buf = pack_u16(buf, area->y2);
+	return buf;
+}
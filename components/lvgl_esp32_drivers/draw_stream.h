@@ -0,0 +1,42 @@
+/**
+* Draw command stream for the LittleVGL websocket driver
+*
+* Records the fills, pixels and letters LittleVGL draws into each of its buffers so a
+* flushed strip can be sent to browsers as the commands that drew it instead of its
+* pixels.  Glyph bitmaps and the pixels of images are sent once and then referred to by
+* a table slot.
+*
+*/
+#ifndef DRAW_STREAM_H
+#define DRAW_STREAM_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*********************
+ *      INCLUDES
+ *********************/
+#include <stdint.h>
+#include <stdbool.h>
+#include "lvgl/lvgl.h"
+
+
+/**********************
+ * GLOBAL PROTOTYPES
+ **********************/
+bool draw_stream_init(const lv_color_t* buf1, const lv_color_t* buf2, uint32_t max_ops, uint32_t caps);
+void draw_stream_record(lv_disp_drv_t * drv, const lv_disp_draw_t * draw);
+void draw_stream_set_active(bool active);
+void draw_stream_forget(uint32_t clients);
+bool draw_stream_valid(const lv_color_t* color_map);
+int draw_stream_pack(const lv_color_t* color_map, uint8_t* buf, uint32_t max_len, uint32_t clients, uint32_t* images_len);
+void draw_stream_commit(uint32_t clients);
+void draw_stream_reset(const lv_color_t* color_map);
+
+
+#ifdef __cplusplus
+} /* extern "C" */
+#endif
+
+#endif /* DRAW_STREAM_H */
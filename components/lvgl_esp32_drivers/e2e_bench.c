@@ -0,0 +1,613 @@
+/**
+* End-to-end benchmark for the LittleVGL websocket driver
+*
+* Each scene runs for BENCH_SCENE_MS while an lv_task steps it.  The driver reports
+* every refresh, packed message and client write, and browsers told to acknowledge
+* messages return the number of messages they have received and how long the last one
+* took to decode.  The count is matched against a short per-client ring of write
+* completion times to get the acknowledgement time.  Memory is measured alongside: the
+* most lv_mem held, the least internal heap free at any hook and the most bytes lwIP
+* held unacknowledged for all clients after a write, so savings and regressions show
+* per scene.
+*
+*/
+
+/*********************
+ *      INCLUDES
+ *********************/
+#include "e2e_bench.h"
+#include "websocket_driver.h"
+
+#if WS_DRIVER_BENCHMARK
+
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_heap_caps.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+#include "websocket_server.h"
+#include "frame_tx.h"
+#include <stdio.h>
+#include "string.h"
+
+
+/*********************
+ *      DEFINES
+ *********************/
+// Time in mS each scene runs and the period in mS it is stepped at
+#define BENCH_SCENE_MS        5000
+#define BENCH_STEP_MS         LV_DISP_DEF_REFR_PERIOD
+
+// Writes remembered per client to match acknowledgements against (must be a power of 2)
+#define ACK_RING_LEN          32
+
+// Longest control message sent to the browsers
+#define BENCH_MSG_LEN         1024
+
+// Same variants as lv_apps/benchmark
+#define SHADOW_WIDTH          (LV_DPI / 8)
+#define OPACITY               LV_OPA_60
+
+#define NUM_BARS              6
+#define NUM_LIST_ITEMS        30
+
+// Columns of the summary table, the first of them timings shown in one table on the
+// screen and the rest memory in another, and the longest text in a cell
+#define NUM_COLS              12
+#define TIME_COLS             8
+#define FIELD_LEN             16
+
+
+/**********************
+ *      TYPEDEFS
+ **********************/
+typedef struct
+{
+	uint32_t ms;          // Length of the scene
+	uint32_t refr;        // Refreshes rendered
+	uint32_t render_ms;   // Time spent rendering them
+	uint32_t msgs;        // Messages packed
+	uint32_t pack_us;     // Time spent packing them
+	uint32_t writes;      // Messages written to clients
+	uint32_t write_us;    // Time spent writing them
+	uint32_t bytes;       // Bytes written to clients
+	uint32_t acks;        // Messages acknowledged by clients
+	uint64_t ack_us;      // Time from each write completing to its acknowledgement
+	uint64_t decode_us;   // Time browsers spent decoding the acknowledged messages
+	uint8_t clients;      // Clients connected when it started
+	uint32_t mem_peak;    // Most lv_mem allocated at once
+	uint32_t heap_min;    // Least internal heap free
+	uint32_t unsent_peak; // Most bytes lwIP held unacknowledged for all clients
+} bench_stats_t;
+
+typedef struct
+{
+	const char* name;
+	void (*create)(lv_obj_t* scr, int variant);
+	void (*step)(uint32_t step);
+	int variant;
+} bench_scene_t;
+
+typedef struct
+{
+	uint16_t len;
+	char text[BENCH_MSG_LEN];
+} bench_msg_t;
+
+enum {
+	VARIANT_PLAIN,
+	VARIANT_SHADOW,
+	VARIANT_OPACITY,
+};
+
+
+/**********************
+ *  STATIC PROTOTYPES
+ **********************/
+static void script_task(lv_task_t* task);
+static void start_scene(int n);
+static void finish();
+static lv_obj_t* new_screen();
+static void show_menu(bool results);
+static void create_table(lv_obj_t* parent, int first_col, int num_cols);
+static void run_btn_event_cb(lv_obj_t* btn, lv_event_t event);
+static void format_fields(int n, char fields[][FIELD_LEN]);
+static int format_row(char* buf, int len, int n);
+static void send_msg(const char* text, int len);
+static void sample_heap();
+static void bench_tx_task(void* pvParameters);
+static int16_t triangle(uint32_t t, int16_t max);
+static void full_create(lv_obj_t* scr, int variant);
+static void full_step(uint32_t step);
+static void list_create(lv_obj_t* scr, int variant);
+static void list_step(uint32_t step);
+static void bars_create(lv_obj_t* scr, int variant);
+static void bars_step(uint32_t step);
+
+
+/**********************
+ *  STATIC VARIABLES
+ **********************/
+static const char* TAG = "e2e_bench";
+
+static const bench_scene_t scenes[] = {
+	{"Full screen", full_create, full_step, VARIANT_PLAIN},
+	{"List scroll", list_create, list_step, VARIANT_PLAIN},
+	{"Bars", bars_create, bars_step, VARIANT_PLAIN},
+	{"Bars shadow", bars_create, bars_step, VARIANT_SHADOW},
+	{"Bars opacity", bars_create, bars_step, VARIANT_OPACITY},
+};
+#define NUM_SCENES (sizeof(scenes) / sizeof(scenes[0]))
+
+// Columns of the summary table
+static const char* COLUMNS[NUM_COLS] = {
+	"scene", "fps", "render_ms", "pack_us", "send_us", "ack_ms", "decode_us", "kB/s",
+	"clients", "lvmem_kB", "free_kB", "tcp_kB"
+};
+
+// Protects the measurements, which are reported by several tasks
+static SemaphoreHandle_t stats_mutex;
+static bool running = false;
+static bench_stats_t cur;
+static bench_stats_t results[NUM_SCENES];
+
+// Write completion times by the client's message count
+static uint32_t ring_seq[WEBSOCKET_SERVER_MAX_CLIENTS][ACK_RING_LEN];
+static int64_t ring_time[WEBSOCKET_SERVER_MAX_CLIENTS][ACK_RING_LEN];
+
+// Bytes lwIP held for each client after its last write
+static uint32_t unsent[WEBSOCKET_SERVER_MAX_CLIENTS];
+
+// Control messages waiting to be sent to the browsers
+static QueueHandle_t msg_queue;
+
+// Script state
+static lv_task_t* script = NULL;
+static int scene;
+static uint32_t scene_start;
+static uint32_t steps;
+
+// Scene objects and styles
+static lv_obj_t* full_obj;
+static lv_obj_t* list;
+static lv_obj_t* bars[NUM_BARS];
+static lv_style_t style_full;
+static lv_style_t style_bg;
+static lv_style_t style_bar_bg;
+static lv_style_t style_bar_indic;
+
+
+/**********************
+ *   GLOBAL FUNCTIONS
+ **********************/
+// Show the benchmark's start screen in place of the application.  Call after
+// websocket_driver_init().
+void e2e_bench_create()
+{
+	stats_mutex = xSemaphoreCreateMutex();
+	msg_queue = xQueueCreate(2, sizeof(bench_msg_t));
+	xTaskCreatePinnedToCore(&bench_tx_task, "bench_tx_task", 2500, NULL, WS_DRIVER_HTTP_PRIO, NULL, WS_DRIVER_NET_CORE);
+
+	show_menu(false);
+}
+
+
+// Run the scenes, telling the connected browsers to acknowledge each message
+void e2e_bench_start()
+{
+	static const char START_MSG[] = "{\"bench\":true}";
+
+	if (script != NULL) return;
+
+	// The first scene replaces the screen, so don't start it from the run button's
+	// event
+	send_msg(START_MSG, sizeof(START_MSG) - 1);
+	scene = -1;
+	script = lv_task_create(script_task, BENCH_STEP_MS, LV_TASK_PRIO_MID, NULL);
+}
+
+
+// Called from the display driver's monitor callback after each refresh
+void e2e_bench_rendered(uint32_t time_ms, uint32_t px)
+{
+	xSemaphoreTake(stats_mutex, portMAX_DELAY);
+	if (running) {
+		cur.refr++;
+		cur.render_ms += time_ms;
+		sample_heap();
+	}
+	xSemaphoreGive(stats_mutex);
+}
+
+
+// Called by the sender task after packing a message of len bytes in us uS
+void e2e_bench_packed(uint32_t len, uint32_t us)
+{
+	xSemaphoreTake(stats_mutex, portMAX_DELAY);
+	if (running) {
+		cur.msgs++;
+		cur.pack_us += us;
+		sample_heap();
+	}
+	xSemaphoreGive(stats_mutex);
+}
+
+
+// Called by a client's transmit task after writing its seq'th message since it
+// connected, with queued bytes lwIP hasn't had acknowledged yet
+void e2e_bench_written(uint8_t num, uint32_t seq, uint32_t len, uint32_t us, uint32_t queued)
+{
+	uint32_t total = 0;
+	int i;
+
+	xSemaphoreTake(stats_mutex, portMAX_DELAY);
+	if (running) {
+		cur.writes++;
+		cur.write_us += us;
+		cur.bytes += len;
+		ring_seq[num][seq & (ACK_RING_LEN - 1)] = seq;
+		ring_time[num][seq & (ACK_RING_LEN - 1)] = esp_timer_get_time();
+		unsent[num] = queued;
+		for (i=0; i<WEBSOCKET_SERVER_MAX_CLIENTS; i++) {
+			total += unsent[i];
+		}
+		cur.unsent_peak = LV_MATH_MAX(cur.unsent_peak, total);
+		sample_heap();
+	}
+	xSemaphoreGive(stats_mutex);
+}
+
+
+// Called when a browser acknowledges its seq'th message since it connected, which took
+// decode_us uS to decode.  Acknowledgements for writes no longer remembered are ignored.
+void e2e_bench_ack(uint8_t num, uint32_t seq, uint32_t decode_us)
+{
+	int i = seq & (ACK_RING_LEN - 1);
+
+	xSemaphoreTake(stats_mutex, portMAX_DELAY);
+	if (running && (ring_seq[num][i] == seq) && (seq != 0)) {
+		cur.acks++;
+		cur.ack_us += esp_timer_get_time() - ring_time[num][i];
+		cur.decode_us += decode_us;
+		ring_seq[num][i] = 0;
+	}
+	xSemaphoreGive(stats_mutex);
+}
+
+
+// Called when a client connects, its message count restarting
+void e2e_bench_connect(uint8_t num)
+{
+	xSemaphoreTake(stats_mutex, portMAX_DELAY);
+	memset(ring_seq[num], 0, sizeof(ring_seq[num]));
+	unsent[num] = 0;
+	xSemaphoreGive(stats_mutex);
+}
+
+
+/**********************
+ *   STATIC FUNCTIONS
+ **********************/
+// steps the current scene, moving on to the next one when its time is up
+static void script_task(lv_task_t* task)
+{
+	uint32_t elapsed = lv_tick_elaps(scene_start);
+
+	if (scene < 0) {
+		start_scene(0);
+		return;
+	}
+	if (elapsed < BENCH_SCENE_MS) {
+		scenes[scene].step(steps++);
+		return;
+	}
+
+	xSemaphoreTake(stats_mutex, portMAX_DELAY);
+	running = false;
+	cur.ms = elapsed;
+	cur.mem_peak = lv_mem_get_peak();
+	results[scene] = cur;
+	xSemaphoreGive(stats_mutex);
+
+	if (++scene < NUM_SCENES) {
+		start_scene(scene);
+	} else {
+		finish();
+	}
+}
+
+static void start_scene(int n)
+{
+	lv_obj_t* scr = new_screen();
+	frame_tx_stats_t st;
+	int i;
+
+	// The scene's memory is measured from before its objects are created
+	xSemaphoreTake(stats_mutex, portMAX_DELAY);
+	memset(&cur, 0, sizeof(cur));
+	for (i=0; i<WEBSOCKET_SERVER_MAX_CLIENTS; i++) {
+		if (frame_tx_get_stats(i, &st)) cur.clients++;
+	}
+	cur.heap_min = UINT32_MAX;
+	sample_heap();
+	xSemaphoreGive(stats_mutex);
+	lv_mem_reset_peak();
+
+	scene = n;
+	steps = 0;
+	scenes[n].create(scr, scenes[n].variant);
+
+	ESP_LOGI(TAG, "Running %s", scenes[n].name);
+	xSemaphoreTake(stats_mutex, portMAX_DELAY);
+	sample_heap();
+	running = true;
+	xSemaphoreGive(stats_mutex);
+	scene_start = lv_tick_get();
+}
+
+// logs the summary table, shows it on the screen and sends it to the browsers
+static void finish()
+{
+	static char msg[BENCH_MSG_LEN];
+	char row[NUM_COLS * FIELD_LEN];
+	int i, n, len;
+
+	lv_task_del(script);
+	script = NULL;
+
+	n = snprintf(msg, sizeof(msg), "{\"bench\":false,\"report\":\"");
+	for (i=-1; i<(int) NUM_SCENES; i++) {
+		len = format_row(row, sizeof(row), i);
+		ESP_LOGI(TAG, "%s", row);
+		if (n + len + 8 < sizeof(msg)) {
+			n += snprintf(&msg[n], sizeof(msg) - n, "%s\\n", row);
+		}
+	}
+	n += snprintf(&msg[n], sizeof(msg) - n, "\"}");
+	send_msg(msg, n);
+
+	show_menu(true);
+}
+
+// creates a plain screen, loads it and deletes the previous one
+static lv_obj_t* new_screen()
+{
+	lv_obj_t* old = lv_disp_get_scr_act(NULL);
+	lv_obj_t* scr = lv_obj_create(NULL, NULL);
+
+	lv_scr_load(scr);
+	if (old != NULL) lv_obj_del(old);
+
+	return scr;
+}
+
+// shows the run button and, after a run, the summary tables
+static void show_menu(bool results)
+{
+	lv_obj_t* scr = new_screen();
+	lv_obj_t* label;
+	lv_obj_t* btn;
+	lv_obj_t* page;
+
+	label = lv_label_create(scr, NULL);
+	lv_label_set_text(label, "End-to-end benchmark");
+	lv_obj_align(label, NULL, LV_ALIGN_IN_TOP_MID, 0, LV_DPI / 10);
+
+	btn = lv_btn_create(scr, NULL);
+	lv_btn_set_fit(btn, LV_FIT_TIGHT);
+	lv_obj_set_event_cb(btn, run_btn_event_cb);
+	label = lv_label_create(btn, NULL);
+	lv_label_set_text(label, results ? "Run again" : "Run");
+	lv_obj_align(btn, NULL, LV_ALIGN_IN_BOTTOM_MID, 0, -LV_DPI / 10);
+
+	if (!results) return;
+
+	// The timing and memory tables don't both fit on small displays so they scroll
+	// between the title and the button
+	page = lv_page_create(scr, NULL);
+	lv_page_set_style(page, LV_PAGE_STYLE_BG, &lv_style_transp_tight);
+	lv_page_set_style(page, LV_PAGE_STYLE_SCRL, &lv_style_transp_fit);
+	lv_page_set_scrl_layout(page, LV_LAYOUT_COL_M);
+	lv_obj_set_size(page, lv_obj_get_width(scr), lv_obj_get_y(btn) - LV_DPI / 3 - LV_DPI / 10);
+	lv_obj_align(page, NULL, LV_ALIGN_IN_TOP_MID, 0, LV_DPI / 3);
+	create_table(page, 1, TIME_COLS - 1);
+	create_table(page, TIME_COLS, NUM_COLS - TIME_COLS);
+}
+
+// creates a table of the scene names and num_cols columns of results from first_col
+static void create_table(lv_obj_t* parent, int first_col, int num_cols)
+{
+	lv_obj_t* table = lv_table_create(parent, NULL);
+	char fields[NUM_COLS][FIELD_LEN];
+	int i, col;
+
+	lv_table_set_col_cnt(table, num_cols + 1);
+	lv_table_set_row_cnt(table, NUM_SCENES + 1);
+	for (col=0; col<=num_cols; col++) {
+		lv_table_set_cell_value(table, 0, col, COLUMNS[(col == 0) ? 0 : first_col + col - 1]);
+		lv_table_set_col_width(table, col, (col == 0) ? lv_disp_get_hor_res(NULL) / 5 :
+			(lv_disp_get_hor_res(NULL) * 4 / 5 - LV_DPI / 4) / (TIME_COLS - 1));
+	}
+	for (i=0; i<NUM_SCENES; i++) {
+		format_fields(i, fields);
+		for (col=0; col<=num_cols; col++) {
+			lv_table_set_cell_value(table, i + 1, col, fields[(col == 0) ? 0 : first_col + col - 1]);
+		}
+	}
+}
+
+static void run_btn_event_cb(lv_obj_t* btn, lv_event_t event)
+{
+	if (event == LV_EVENT_CLICKED) {
+		e2e_bench_start();
+	}
+}
+
+// Format one scene's results as the fields of a row of the summary table
+static void format_fields(int n, char fields[][FIELD_LEN])
+{
+	const bench_stats_t* r = &results[n];
+	uint32_t ms = LV_MATH_MAX(r->ms, 1);
+	uint32_t fps10 = r->refr * 10000 / ms;
+	uint32_t render10 = r->refr ? r->render_ms * 10 / r->refr : 0;
+	uint32_t ack10 = r->acks ? (uint32_t) (r->ack_us / r->acks / 100) : 0;
+
+	snprintf(fields[0], FIELD_LEN, "%s", scenes[n].name);
+	snprintf(fields[1], FIELD_LEN, "%u.%u", fps10 / 10, fps10 % 10);
+	snprintf(fields[2], FIELD_LEN, "%u.%u", render10 / 10, render10 % 10);
+	snprintf(fields[3], FIELD_LEN, "%u", r->msgs ? r->pack_us / r->msgs : 0);
+	snprintf(fields[4], FIELD_LEN, "%u", r->writes ? r->write_us / r->writes : 0);
+	snprintf(fields[5], FIELD_LEN, "%u.%u", ack10 / 10, ack10 % 10);
+	snprintf(fields[6], FIELD_LEN, "%u", r->acks ? (uint32_t) (r->decode_us / r->acks) : 0);
+	snprintf(fields[7], FIELD_LEN, "%u", (uint32_t) ((uint64_t) r->bytes * 1000 / 1024 / ms));
+	snprintf(fields[8], FIELD_LEN, "%u", r->clients);
+	snprintf(fields[9], FIELD_LEN, "%u.%u", r->mem_peak / 1024, (r->mem_peak % 1024) * 10 / 1024);
+	snprintf(fields[10], FIELD_LEN, "%u", r->heap_min / 1024);
+	snprintf(fields[11], FIELD_LEN, "%u.%u", r->unsent_peak / 1024, (r->unsent_peak % 1024) * 10 / 1024);
+}
+
+// Format a row of the summary table for the log, returning its length.  Row -1 is the
+// header.
+static int format_row(char* buf, int len, int n)
+{
+	char fields[NUM_COLS][FIELD_LEN];
+	int col, pos = 0;
+
+	for (col=0; col<NUM_COLS; col++) {
+		if (n < 0) {
+			strcpy(fields[col], COLUMNS[col]);
+		} else if (col == 0) {
+			format_fields(n, fields);
+		}
+		if (pos < len) {
+			pos += snprintf(&buf[pos], len - pos, (col == 0) ? "%-13s" : "%10s", fields[col]);
+		}
+	}
+
+	return LV_MATH_MIN(pos, len - 1);
+}
+
+// Queue a control message for the browsers.  It is sent by bench_tx_task since
+// writing to a client may block.
+static void send_msg(const char* text, int len)
+{
+	static bench_msg_t msg;
+
+	msg.len = LV_MATH_MIN(len, BENCH_MSG_LEN);
+	memcpy(msg.text, text, msg.len);
+	(void) xQueueSendToBack(msg_queue, &msg, 0);
+}
+
+// sends control messages to every connected browser
+static void bench_tx_task(void* pvParameters) {
+	static bench_msg_t msg;
+	int i;
+
+	for (;;) {
+		xQueueReceive(msg_queue, &msg, portMAX_DELAY);
+		for (i=0; i<WEBSOCKET_SERVER_MAX_CLIENTS; i++) {
+			(void) frame_tx_send_text(i, msg.text, msg.len);
+		}
+	}
+	vTaskDelete(NULL);
+}
+
+// Lowers the scene's least free internal heap to what is free now.  Called with
+// stats_mutex held.
+static void sample_heap()
+{
+	uint32_t free = heap_caps_get_free_size(MALLOC_CAP_INTERNAL);
+
+	if (free < cur.heap_min) cur.heap_min = free;
+}
+
+// Returns a value moving from 0 to max and back as t increases
+static int16_t triangle(uint32_t t, int16_t max)
+{
+	if (max <= 0) return 0;
+	t %= 2 * max;
+	return (t < max) ? t : 2 * max - t;
+}
+
+// The whole screen changes color every step so every refresh redraws and sends it all
+static void full_create(lv_obj_t* scr, int variant)
+{
+	lv_style_copy(&style_full, &lv_style_plain);
+	full_obj = lv_obj_create(scr, NULL);
+	lv_obj_set_size(full_obj, lv_obj_get_width(scr), lv_obj_get_height(scr));
+	lv_obj_set_style(full_obj, &style_full);
+}
+
+static void full_step(uint32_t step)
+{
+	style_full.body.main_color = lv_color_hsv_to_rgb((step * 7) % 360, 100, 100);
+	style_full.body.grad_color = lv_color_hsv_to_rgb((step * 7 + 180) % 360, 100, 100);
+	lv_obj_refresh_style(full_obj);
+}
+
+// A long list scrolled back and forth
+static void list_create(lv_obj_t* scr, int variant)
+{
+	char txt[16];
+	int i;
+
+	list = lv_list_create(scr, NULL);
+	lv_obj_set_size(list, lv_obj_get_width(scr), lv_obj_get_height(scr));
+	for (i=0; i<NUM_LIST_ITEMS; i++) {
+		sprintf(txt, "Item %d", i + 1);
+		(void) lv_list_add_btn(list, LV_SYMBOL_FILE, txt);
+	}
+}
+
+static void list_step(uint32_t step)
+{
+	lv_obj_t* scrl = lv_page_get_scrl(list);
+	int16_t range = lv_obj_get_height(scrl) - lv_obj_get_height(list);
+
+	lv_obj_set_y(scrl, -triangle(step * 4, range));
+}
+
+// Bars moving at different rates over a gradient, optionally with shadows or
+// translucent
+static void bars_create(lv_obj_t* scr, int variant)
+{
+	lv_coord_t w = lv_obj_get_width(scr);
+	lv_coord_t h = lv_obj_get_height(scr);
+	int i;
+
+	lv_style_copy(&style_bg, &lv_style_plain);
+	style_bg.body.main_color = LV_COLOR_NAVY;
+	style_bg.body.grad_color = LV_COLOR_TEAL;
+	lv_obj_set_style(scr, &style_bg);
+
+	lv_style_copy(&style_bar_bg, &lv_style_pretty);
+	lv_style_copy(&style_bar_indic, &lv_style_pretty_color);
+	if (variant == VARIANT_SHADOW) {
+		style_bar_bg.body.shadow.width = SHADOW_WIDTH;
+		style_bar_indic.body.shadow.width = SHADOW_WIDTH;
+	} else if (variant == VARIANT_OPACITY) {
+		style_bar_bg.body.opa = OPACITY;
+		style_bar_indic.body.opa = OPACITY;
+	}
+
+	for (i=0; i<NUM_BARS; i++) {
+		bars[i] = lv_bar_create(scr, NULL);
+		lv_bar_set_style(bars[i], LV_BAR_STYLE_BG, &style_bar_bg);
+		lv_bar_set_style(bars[i], LV_BAR_STYLE_INDIC, &style_bar_indic);
+		lv_obj_set_size(bars[i], w - 2 * SHADOW_WIDTH - LV_DPI / 4, h / (2 * NUM_BARS + 1));
+		lv_obj_set_pos(bars[i], SHADOW_WIDTH + LV_DPI / 8, (2 * i + 1) * h / (2 * NUM_BARS + 1));
+	}
+}
+
+static void bars_step(uint32_t step)
+{
+	int i;
+
+	for (i=0; i<NUM_BARS; i++) {
+		lv_bar_set_value(bars[i], triangle(step * (i + 2) + i * 17, 100), LV_ANIM_OFF);
+	}
+}
+
+#endif /* WS_DRIVER_BENCHMARK */
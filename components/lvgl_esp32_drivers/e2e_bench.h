@@ -0,0 +1,47 @@
+/**
+* End-to-end benchmark for the LittleVGL websocket driver
+*
+* Runs a script of scenes in place of the demo, modelled on lv_apps/benchmark's
+* wallpaper, shadow and opacity variants, and measures each frame on its whole way to
+* the browsers: the time LittleVGL spends rendering a refresh, packing a flush into
+* messages, writing each message to a client and the time until the client
+* acknowledges it, along with the time the browser took to decode it, and the peak
+* LittlevGL heap, internal heap and lwIP send buffer use of each scene.  A summary table
+* is logged, shown on the screen and sent to the browsers at the end.
+*
+*/
+#ifndef E2E_BENCH_H
+#define E2E_BENCH_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*********************
+ *      INCLUDES
+ *********************/
+#include <stdint.h>
+#include <stdbool.h>
+#include "lvgl/lvgl.h"
+
+
+/**********************
+ * GLOBAL PROTOTYPES
+ **********************/
+void e2e_bench_create();
+void e2e_bench_start();
+bool e2e_bench_running();
+
+// Measurement hooks called by the driver
+void e2e_bench_rendered(uint32_t time_ms, uint32_t px);
+void e2e_bench_packed(uint32_t len, uint32_t us);
+void e2e_bench_written(uint8_t num, uint32_t seq, uint32_t len, uint32_t us, uint32_t queued);
+void e2e_bench_ack(uint8_t num, uint32_t seq, uint32_t decode_us);
+void e2e_bench_connect(uint8_t num);
+
+
+#ifdef __cplusplus
+} /* extern "C" */
+#endif
+
+#endif /* E2E_BENCH_H */
@@ -0,0 +1,1587 @@
+/**
+* Per-client frame transmission for the LittleVGL websocket driver
+*
+* Packed websocket message payloads are held in a small pool of reference counted frame
+* buffers.  Each client has its own sender task and a short queue of pending frames so
+* a slow client only delays itself.  When a client's queue is full its oldest pending
+* frame is dropped for that client and its area remembered as damage that must be
+* resent once the client has caught up.  Damage is kept as a short list of rectangles,
+* overlapping ones being joined when that doesn't grow the area sent, so a client
+* that fell behind during an animation catches up in one message.  A copy moves what a
+* client is missing along with the pixels, so damage under a copy is remembered where it
+* lands too, including that of frames dropped while the copy is still queued.
+*
+* A client in lossy mode is sent frames of approximate pixels, packed separately from
+* everyone else's.  Their areas are kept in a second list like the damage and handed
+* back by frame_tx_take_refine() for exact pixels once the client has had nothing new
+* to write for FRAME_TX_REFINE_MS.  A client held at 8 bits per pixel is never refined.
+*
+* A client that reported the part of the screen it shows is only kept up to date there.
+* Its damage is clipped to that viewport, and when the viewport moves the part newly
+* shown becomes damage, resent like any other.
+*
+* A hidden client, such as a browser tab in the background, is queued no pixel frames.
+* What they cover becomes its damage, resent once it is shown again.
+*
+* A client taking draw commands can only replay them with the glyphs defined by the
+* frames before, so once it has dropped one it skips the rest as damage until a frame
+* defines every glyph it uses again for the client.  Those are packed after
+* frame_tx_draw_clients() has handed back the clients that need them.
+*
+* A frame may instead hold a text message for one client, written in order with its
+* pixel frames.  Dropping one loses it, as it covers no area to resend.
+*
+* Frames queued with more set are written as fragments of one message, which the
+* browser decodes and presents at once.  The message ends at the first frame without
+* more, which frame_tx_end() queues as an empty one, or before any other message: text
+* from frame_tx_send_text() or a frame that is not a fragment.  A client's sender
+* doesn't wait for credits while its message is open, as continuing it numbers no new
+* message.  A fragment dropped as damage leaves the rest of the message to be sent.
+*
+* A browser that acknowledges the messages it has decoded is given a number of credits
+* by frame_tx_set_credits().  Its sender waits while that many messages are
+* unacknowledged, leaving the frames produced meanwhile in its queue to be dropped as
+* damage, so how far its picture lags is bounded by the credits rather than by how much
+* lwIP and the network will buffer.  Messages are numbered implicitly, by counting them
+* on both sides since the connection opened.
+*
+* A client given a token when it said hello is parked when its connection goes: its
+* damage, the areas of the frames still queued for it and those it was sent
+* approximately are kept with the token, and every frame sent while it is away adds its
+* area.  The areas of the last FRAME_TX_HISTORY messages written are remembered too, so
+* when the browser reconnects within WS_DRIVER_RESUME mS saying how many messages it
+* applied, frame_tx_resume() can make all of that the new connection's damage, to be
+* resent like any other.  Otherwise, or if it applied too few messages for the history
+* to cover, it is sent the whole screen as a new client.
+*
+* Writes return after the websocket server's send timeout with whatever the client's
+* TCP send buffer accepted, so a sender only holds its client's lock for that long at a
+* time and gives up on a client that accepts nothing for CLIENT_STALL_MS.
+*
+* Control traffic goes ahead of pixels.  Text from frame_tx_send_text() is written
+* before the sender's next frame, and frames longer than WS_DRIVER_FRAGMENT bytes are
+* written as several websocket fragments.  The server leaves its pings and pongs for the
+* task writing to the client rather than waiting for it, and they go between fragments.
+*
+*/
+
+/*********************
+ *      INCLUDES
+ *********************/
+#include "frame_tx.h"
+#include "websocket_driver.h"
+#include "esp_log.h"
+#include "esp_heap_caps.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+#include "websocket.h"
+#include "websocket_server.h"
+#include "websocket_deflate.h"
+#include <stdlib.h>
+#include <string.h>
+#if WS_DRIVER_BENCHMARK
+#include "lwip/tcp.h"
+#include "e2e_bench.h"
+#endif
+#if WS_DRIVER_TRACE
+#include "trace_rec.h"
+#endif
+
+
+/*********************
+ *      DEFINES
+ *********************/
+#define NUM_FRAMES WS_DRIVER_FRAME_BUFS
+
+// Frames a client may have waiting, leaving one for the sender to pack into
+#define QUEUE_DEPTH (NUM_FRAMES - 1)
+
+// Time in mS to wait for a client to free a frame before taking the pending frames of
+// the client furthest behind
+#define RECLAIM_WAIT_MS 10
+
+// Time in mS a client may accept no data before it is disconnected
+#define CLIENT_STALL_MS 5000
+
+// Longest stored block a fragment holds
+#define STORED_MAX_LEN 65535
+
+// Whether a frame covers an area of the screen, to be resent if it is missed
+#define HAS_AREA(f) (!(f)->text && !(f)->end)
+
+
+/**********************
+ *      TYPEDEFS
+ **********************/
+typedef struct
+{
+	QueueHandle_t queue;      // Pending frames, oldest first
+	SemaphoreHandle_t lock;   // Held by the client's task while it is writing
+	struct netconn* conn;     // NULL when the slot is not in use
+	int num_damage;           // Number of areas the client has missed
+	lv_area_t damage[FRAME_TX_MAX_DAMAGE];
+	int copies;               // Number of copies pending
+	lv_area_t copy_area;      // Areas of the pending copies joined
+	bool lossy;               // Set when the client takes approximate frames
+	bool held;                // Set when it is held at 8 bits, never refined
+	int num_refine;           // Number of areas sent approximately
+	lv_area_t refine[FRAME_TX_MAX_DAMAGE];
+	TickType_t lossy_tick;    // Tick count when the last approximate frame was queued
+	bool clipped;             // Set when the client is only sent what is in viewport
+	lv_area_t viewport;       // Area the client shows, empty if x2 < x1
+	bool draw;                // Set when the client takes draw commands
+	bool draw_lost;           // Set once a draw frame was dropped, until a reset arrives
+	bool draw_forget;         // Set when the client's glyphs must all be defined again
+	uint32_t sent;            // Frames written since the client connected
+	uint32_t dropped;         // Frames dropped since the client connected
+	uint32_t cost;            // Average time in uS to write 1 kB, 0 until measured
+	uint32_t weight;          // Percentage cost is scaled by when adapting to the client
+	uint32_t bytes;           // Frame bytes written since the client connected, wrapping
+	uint32_t write_us;        // Time in uS spent writing frames, wrapping
+	uint32_t seq;             // Connection number, telling reconnections apart
+	uint32_t credits;         // Messages the client may have unacknowledged, 0 for no limit
+	uint32_t numbered;        // Binary messages whose writes have started
+	struct netconn* open;     // Connection a message of fragments is open on, or NULL
+	bool zopen;               // Set when the open message is compressed
+	uint32_t acked;           // Messages the client has acknowledged decoding
+	uint32_t token;           // Token to park the client under when it goes, 0 for none
+	lv_area_t history[FRAME_TX_HISTORY]; // Areas of the last messages, by number
+	TaskHandle_t task;        // The client's sender
+	volatile uint32_t urgent; // Text messages waiting to be written, ahead of the frames
+} client_tx_t;
+
+#if WS_DRIVER_RESUME
+typedef struct
+{
+	uint32_t token;           // 0 when the entry is free
+	uint8_t num;              // Client slot it had
+	TickType_t tick;          // Tick count when it went
+	uint32_t numbered;        // Binary messages whose writes had started
+	lv_area_t history[FRAME_TX_HISTORY];
+	int num_damage;           // Number of areas it is missing
+	lv_area_t damage[FRAME_TX_MAX_DAMAGE];
+	bool clipped;             // Its viewport, as for a connected client
+	lv_area_t viewport;
+} parked_t;
+#endif
+
+
+/**********************
+ *  STATIC VARIABLES
+ **********************/
+static const char* TAG = "frame_tx";
+
+static frame_t frames[NUM_FRAMES];
+
+// Longest websocket fragment written, 0 for no limit
+static volatile uint32_t fragment_len = WS_DRIVER_FRAGMENT;
+
+#if WS_DRIVER_ZERO_COPY
+// Frames sending buffers that belong to the caller, free while they have no users
+static frame_t wrapped[FRAME_TX_WRAPPED];
+#endif
+
+// Frames with no users
+static QueueHandle_t free_queue;
+
+// Protects the frame reference counts and the client state
+static SemaphoreHandle_t frame_mutex;
+
+// Bytes of frames queued for all clients, wrapping
+static volatile uint32_t queued_bytes = 0;
+
+// Connections made since startup
+static uint32_t connect_seq = 0;
+
+static client_tx_t tx[WEBSOCKET_SERVER_MAX_CLIENTS];
+
+// Bit per client with a connection, so broadcasts visit only the connected clients
+static uint32_t connected = 0;
+
+// Bit per client that is hidden
+static uint32_t hidden = 0;
+
+// Frames each client may have waiting, lowered while memory is short
+static int depth = QUEUE_DEPTH;
+
+#if WEBSOCKET_SERVER_DEFLATE
+// Held while a frame is compressed, by the first sender that needs it
+static SemaphoreHandle_t deflate_mutex;
+static uint16_t deflate_table[WS_DEFLATE_TABLE_LEN];
+#endif
+
+#if WS_DRIVER_RESUME
+// Clients whose connection went, waiting for their browser to come back
+static parked_t parked[WEBSOCKET_SERVER_MAX_CLIENTS];
+#endif
+
+
+/**********************
+ *  STATIC PROTOTYPES
+ **********************/
+static void client_tx_task(void* pvParameters);
+static void wait_credit(int num);
+static err_t client_write(int num, struct netconn* conn, const void* data, size_t len, uint8_t flags);
+static err_t close_message(int num, struct netconn* conn);
+static err_t write_frame(int num, struct netconn* conn, const frame_t* f, bool cont, bool zipped);
+#if WEBSOCKET_SERVER_DEFLATE
+static bool frame_deflate(frame_t* f);
+#endif
+static void frame_unref_locked(frame_t* frame);
+static void post_locked(int num, frame_t* frame);
+static void drop_locked(int num, frame_t* frame);
+static void draw_lost_locked(int num, const frame_t* frame);
+static void copy_damage_locked(int num, const frame_t* frame);
+static void copy_areas_locked(lv_area_t* list, int* num_areas, const frame_t* frame);
+static void add_damage_locked(int num, const lv_area_t* area);
+static void expose_locked(int num, const lv_area_t* old);
+static void add_area_locked(lv_area_t* list, int* num_areas, const lv_area_t* area);
+#if WS_DRIVER_RESUME
+static parked_t* park_locked(int num);
+static void park_damage_locked(parked_t* p, const lv_area_t* area);
+static void park_lost_locked(int num, const frame_t* frame);
+static bool park_expired_locked(parked_t* p);
+#endif
+
+
+/**********************
+ *   GLOBAL FUNCTIONS
+ **********************/
+// Allocate buf_len byte frames with the heap capabilities caps and start the client
+// senders.  Nothing is left allocated if a frame doesn't fit so the caller may retry
+// with smaller frames.
+bool frame_tx_init(uint32_t buf_len, uint32_t caps)
+{
+	int i;
+	frame_t* f;
+
+	for (i=0; i<NUM_FRAMES; i++) {
+		frames[i].buf = heap_caps_malloc(buf_len, caps);
+		if (frames[i].buf == NULL) {
+			ESP_LOGW(TAG, "Could not allocate frame buffer %d (%u bytes)", i, buf_len);
+			while (--i >= 0) {
+				heap_caps_free(frames[i].buf);
+			}
+			return false;
+		}
+	}
+
+	free_queue = xQueueCreate(NUM_FRAMES, sizeof(frame_t*));
+	frame_mutex = xSemaphoreCreateMutex();
+#if WEBSOCKET_SERVER_DEFLATE
+	deflate_mutex = xSemaphoreCreateMutex();
+#endif
+
+	for (i=0; i<NUM_FRAMES; i++) {
+		frames[i].refs = 0;
+		f = &frames[i];
+		xQueueSendToBack(free_queue, &f, 0);
+	}
+
+	for (i=0; i<WEBSOCKET_SERVER_MAX_CLIENTS; i++) {
+		tx[i].queue = xQueueCreate(QUEUE_DEPTH, sizeof(frame_t*));
+		tx[i].lock = xSemaphoreCreateMutex();
+		tx[i].conn = NULL;
+		tx[i].num_damage = 0;
+		tx[i].num_refine = 0;
+		tx[i].credits = 0;
+		websocket_driver_create_task(&client_tx_task, "client_tx_task", 2500, (void*) (intptr_t) i, WS_DRIVER_CLIENT_TX_PRIO, &tx[i].task, WS_DRIVER_NET_CORE, WS_DRIVER_SENDER_STACKS_PSRAM);
+	}
+
+	return true;
+}
+
+
+// Get an unused frame to pack a message into.  If every frame is in use for longer
+// than RECLAIM_WAIT_MS, the pending frames of the client with the most waiting are
+// taken back so only that client falls behind.
+frame_t* frame_tx_get()
+{
+	int i;
+	int laggard;
+	UBaseType_t n, most;
+	frame_t* f;
+
+	if (xQueueReceive(free_queue, &f, RECLAIM_WAIT_MS / portTICK_PERIOD_MS) != pdTRUE) {
+		xSemaphoreTake(frame_mutex, portMAX_DELAY);
+		laggard = -1;
+		most = 0;
+		for (i=0; i<WEBSOCKET_SERVER_MAX_CLIENTS; i++) {
+			n = uxQueueMessagesWaiting(tx[i].queue);
+			if (n > most) {
+				laggard = i;
+				most = n;
+			}
+		}
+		if (laggard >= 0) {
+			while (xQueueReceive(tx[laggard].queue, &f, 0) == pdTRUE) {
+				drop_locked(laggard, f);
+			}
+		}
+		xSemaphoreGive(frame_mutex);
+
+		// Only blocks if all frames are being written to clients
+		xQueueReceive(free_queue, &f, portMAX_DELAY);
+	}
+
+	f->refs = 1;
+	f->copy = false;
+	f->lossy = false;
+	f->draw = false;
+	f->text = false;
+	f->more = false;
+	f->end = false;
+	f->draw_reset = 0;
+	f->zbuf = NULL;
+	f->ztried = false;
+	f->release_cb = NULL;
+	return f;
+}
+
+
+#if WS_DRIVER_ZERO_COPY
+// Get a frame sending the len bytes of message payload at buf, which the caller keeps
+// unchanged until release_cb is called with release_arg once the last client is done
+// with it.  The callback is made by whichever task drops the last reference, with the
+// frames locked.  Returns NULL if FRAME_TX_WRAPPED such frames are already in use.
+frame_t* frame_tx_wrap(uint8_t* buf, uint32_t len, void (*release_cb)(void* arg), void* release_arg)
+{
+	int i;
+	frame_t* f = NULL;
+
+	xSemaphoreTake(frame_mutex, portMAX_DELAY);
+	for (i=0; i<FRAME_TX_WRAPPED; i++) {
+		if (wrapped[i].refs == 0) {
+			f = &wrapped[i];
+			f->refs = 1;
+			break;
+		}
+	}
+	xSemaphoreGive(frame_mutex);
+	if (f == NULL) return NULL;
+
+	f->buf = buf;
+	f->len = len;
+	f->copy = false;
+	f->lossy = false;
+	f->draw = false;
+	f->text = false;
+	f->more = false;
+	f->end = false;
+	f->draw_reset = 0;
+	f->zbuf = NULL;
+	f->ztried = false;
+	f->release_cb = release_cb;
+	f->release_arg = release_arg;
+	return f;
+}
+#endif
+
+
+// Queue a packed frame for all connected clients.  The caller's reference is passed on.
+void frame_tx_send(frame_t* frame)
+{
+	frame_tx_send_to(frame, UINT32_MAX);
+}
+
+
+// Queue a packed frame for the connected clients whose bits are set in clients.  The
+// caller's reference is passed on.
+void frame_tx_send_to(frame_t* frame, uint32_t clients)
+{
+	uint32_t bits;
+
+	xSemaphoreTake(frame_mutex, portMAX_DELAY);
+	for (bits = clients & connected; bits != 0; bits &= bits - 1) {
+		post_locked(__builtin_ctz(bits), frame);
+	}
+#if WS_DRIVER_RESUME
+	// Whatever changes on the screen is missed by the clients that are away
+	for (int i=0; i<WEBSOCKET_SERVER_MAX_CLIENTS; i++) {
+		if ((parked[i].token != 0) && HAS_AREA(frame) && !park_expired_locked(&parked[i])) {
+			park_damage_locked(&parked[i], &frame->area);
+		}
+	}
+#endif
+	queued_bytes += frame->len;
+	frame_unref_locked(frame);
+	xSemaphoreGive(frame_mutex);
+}
+
+
+// Queue a packed frame for one client.  The caller's reference is passed on.
+void frame_tx_send_client(uint8_t num, frame_t* frame)
+{
+	xSemaphoreTake(frame_mutex, portMAX_DELAY);
+	if (tx[num].conn != NULL) {
+		post_locked(num, frame);
+	}
+	frame_unref_locked(frame);
+	xSemaphoreGive(frame_mutex);
+}
+
+
+// Queue the end of the message the frames queued with more set have continued for the
+// connected clients whose bits are set in clients.  Nothing is written to a client
+// whose message has already ended.
+void frame_tx_end(uint32_t clients)
+{
+	frame_t* f = frame_tx_get();
+
+	f->len = 0;
+	f->end = true;
+	lv_area_set(&f->area, 0, 0, -1, -1);
+	frame_tx_send_to(f, clients);
+}
+
+
+void frame_tx_release(frame_t* frame)
+{
+	xSemaphoreTake(frame_mutex, portMAX_DELAY);
+	frame_unref_locked(frame);
+	xSemaphoreGive(frame_mutex);
+}
+
+
+// Called from the websocket callback when a client connects
+void frame_tx_connect(uint8_t num, struct netconn* conn)
+{
+	xSemaphoreTake(frame_mutex, portMAX_DELAY);
+	tx[num].conn = conn;
+	connected |= 1 << num;
+	hidden &= ~(1 << num);
+	tx[num].num_damage = 0;
+	tx[num].copies = 0;
+	tx[num].lossy = false;
+	tx[num].held = false;
+	tx[num].num_refine = 0;
+	tx[num].clipped = false;
+	tx[num].draw = false;
+	tx[num].draw_lost = false;
+	tx[num].draw_forget = true;
+	tx[num].sent = 0;
+	tx[num].dropped = 0;
+	tx[num].cost = 0;
+	tx[num].weight = 100;
+	tx[num].bytes = 0;
+	tx[num].write_us = 0;
+	tx[num].seq = ++connect_seq;
+	tx[num].credits = 0;
+	tx[num].numbered = 0;
+	tx[num].open = NULL;
+	tx[num].zopen = false;
+	tx[num].acked = 0;
+	tx[num].token = 0;
+	xSemaphoreGive(frame_mutex);
+}
+
+
+// Called from the websocket callback before a client's connection is closed.  Waits
+// for any write in progress so the connection isn't deleted out from under it.
+void frame_tx_disconnect(uint8_t num)
+{
+	frame_t* f;
+#if WS_DRIVER_RESUME
+	parked_t* p = NULL;
+#endif
+
+	xSemaphoreTake(tx[num].lock, portMAX_DELAY);
+	xSemaphoreTake(frame_mutex, portMAX_DELAY);
+	if (tx[num].conn != NULL) {
+		ESP_LOGI(TAG, "client %d: %u frames sent, %u dropped", num, tx[num].sent, tx[num].dropped);
+#if WS_DRIVER_RESUME
+		if (tx[num].token != 0) {
+			p = park_locked(num);
+		}
+#endif
+	}
+	tx[num].conn = NULL;
+	connected &= ~(1 << num);
+	hidden &= ~(1 << num);
+	tx[num].num_damage = 0;
+	tx[num].copies = 0;
+	tx[num].num_refine = 0;
+	tx[num].credits = 0;
+	while (xQueueReceive(tx[num].queue, &f, 0) == pdTRUE) {
+#if WS_DRIVER_RESUME
+		// A parked client misses the frames it was still to be written too
+		if ((p != NULL) && HAS_AREA(f)) {
+			park_damage_locked(p, &f->area);
+		}
+#endif
+		frame_unref_locked(f);
+	}
+	xSemaphoreGive(frame_mutex);
+	xSemaphoreGive(tx[num].lock);
+
+	// Stop its sender waiting for credits
+	xTaskNotifyGive(tx[num].task);
+}
+
+
+// Once a client has caught up, load areas with up to max_areas of the areas it missed,
+// removing them from its damage.  Returns the number of areas loaded.
+int frame_tx_take_damage(uint8_t num, lv_area_t* areas, int max_areas)
+{
+	int n = 0;
+
+	xSemaphoreTake(frame_mutex, portMAX_DELAY);
+	if ((tx[num].conn != NULL) && !(hidden & (1 << num)) && (uxQueueMessagesWaiting(tx[num].queue) == 0)) {
+		while ((n < max_areas) && (tx[num].num_damage > 0)) {
+			lv_area_copy(&areas[n++], &tx[num].damage[--tx[num].num_damage]);
+		}
+	}
+	xSemaphoreGive(frame_mutex);
+
+	return n;
+}
+
+
+// Record an area a client still needs to be sent
+void frame_tx_add_damage(uint8_t num, const lv_area_t* area)
+{
+	xSemaphoreTake(frame_mutex, portMAX_DELAY);
+	if (tx[num].conn != NULL) {
+		add_damage_locked(num, area);
+	}
+	xSemaphoreGive(frame_mutex);
+}
+
+
+// Choose whether a client is sent approximate frames, and if so whether what it was sent
+// is refined once its link is idle or it is held at the approximation
+void frame_tx_set_lossy(uint8_t num, bool lossy, bool refine)
+{
+	xSemaphoreTake(frame_mutex, portMAX_DELAY);
+	if (tx[num].conn != NULL) {
+		tx[num].lossy = lossy;
+		tx[num].held = lossy && !refine;
+	}
+	xSemaphoreGive(frame_mutex);
+}
+
+
+// Only keep a client up to date in the area viewport of the screen from now on, and
+// resend it what it hadn't been sent there
+void frame_tx_set_viewport(uint8_t num, const lv_area_t* viewport)
+{
+	lv_area_t old;
+
+	xSemaphoreTake(frame_mutex, portMAX_DELAY);
+	if (tx[num].conn != NULL) {
+		lv_area_copy(&old, &tx[num].viewport);
+		lv_area_copy(&tx[num].viewport, viewport);
+		if (tx[num].clipped) {
+			expose_locked(num, &old);
+		}
+		tx[num].clipped = true;
+	}
+	xSemaphoreGive(frame_mutex);
+}
+
+
+// Load viewport with the area of the screen a client is kept up to date in, returning
+// false if it is the whole screen
+bool frame_tx_get_viewport(uint8_t num, lv_area_t* viewport)
+{
+	bool clipped;
+
+	xSemaphoreTake(frame_mutex, portMAX_DELAY);
+	clipped = tx[num].clipped;
+	lv_area_copy(viewport, &tx[num].viewport);
+	xSemaphoreGive(frame_mutex);
+
+	return clipped;
+}
+
+
+// Returns the connected clients, one bit per client
+uint32_t frame_tx_connected()
+{
+	return connected;
+}
+
+
+// Stop queueing a client pixel frames while it is hidden, collecting their areas as its
+// damage instead, or resend it that damage once it is shown
+void frame_tx_set_hidden(uint8_t num, bool hide)
+{
+	xSemaphoreTake(frame_mutex, portMAX_DELAY);
+	if (tx[num].conn != NULL) {
+		if (hide) {
+			hidden |= 1 << num;
+		} else {
+			hidden &= ~(1 << num);
+		}
+	}
+	xSemaphoreGive(frame_mutex);
+}
+
+
+// Returns the hidden clients, one bit per client
+uint32_t frame_tx_hidden()
+{
+	return hidden;
+}
+
+
+// Returns the connected clients that would be written a frame queued now: those shown
+// and, if they acknowledge what they decode, with credits left.  One bit per client.
+uint32_t frame_tx_consumers()
+{
+	uint32_t clients = 0;
+	uint32_t bits;
+	int i;
+
+	xSemaphoreTake(frame_mutex, portMAX_DELAY);
+	for (bits = connected & ~hidden; bits != 0; bits &= bits - 1) {
+		i = __builtin_ctz(bits);
+		if ((tx[i].credits == 0) || ((tx[i].numbered - tx[i].acked) < tx[i].credits)) {
+			clients |= 1 << i;
+		}
+	}
+	xSemaphoreGive(frame_mutex);
+
+	return clients;
+}
+
+
+// Returns the connected clients that are in lossy mode, or that aren't, one bit per
+// client
+uint32_t frame_tx_clients(bool lossy)
+{
+	int i;
+	uint32_t clients = 0;
+	uint32_t bits;
+
+	xSemaphoreTake(frame_mutex, portMAX_DELAY);
+	for (bits = connected; bits != 0; bits &= bits - 1) {
+		i = __builtin_ctz(bits);
+		if (tx[i].lossy == lossy) {
+			clients |= 1 << i;
+		}
+	}
+	xSemaphoreGive(frame_mutex);
+
+	return clients;
+}
+
+
+// Choose whether a client is sent draw commands
+void frame_tx_set_draw(uint8_t num, bool draw)
+{
+	xSemaphoreTake(frame_mutex, portMAX_DELAY);
+	if (tx[num].conn != NULL) {
+		tx[num].draw = draw;
+	}
+	xSemaphoreGive(frame_mutex);
+}
+
+
+// Let a client that acknowledges the messages it decodes have up to credits of them
+// unacknowledged, 0 for no limit
+void frame_tx_set_credits(uint8_t num, uint32_t credits)
+{
+	xSemaphoreTake(frame_mutex, portMAX_DELAY);
+	if (tx[num].conn != NULL) {
+		tx[num].credits = credits;
+	}
+	xSemaphoreGive(frame_mutex);
+	xTaskNotifyGive(tx[num].task);
+}
+
+
+// Write websocket fragments of at most len bytes, 0 for no limit, from the next message
+// on.  Stored blocks are at most 65535 bytes so that is the limit with deflate.
+void frame_tx_set_fragment(uint32_t len)
+{
+	fragment_len = len;
+}
+
+
+// Limit the frames every client may have waiting to frames, between 1 and the queue
+// depth.  A client that falls further behind has the older ones dropped, their areas
+// joined into damage and resent as one, so fewer messages are held in its lwIP send
+// buffer while memory is short.
+void frame_tx_set_depth(int frames)
+{
+	xSemaphoreTake(frame_mutex, portMAX_DELAY);
+	depth = LV_MATH_MAX(LV_MATH_MIN(frames, QUEUE_DEPTH), 1);
+	xSemaphoreGive(frame_mutex);
+}
+
+
+// Called from the websocket callback when a client reports having decoded its first
+// count messages
+void frame_tx_ack(uint8_t num, uint32_t count)
+{
+	xSemaphoreTake(frame_mutex, portMAX_DELAY);
+	// Ignore a count beyond what was sent, or older than the last
+	if ((tx[num].conn != NULL) && ((count - tx[num].acked) <= (tx[num].numbered - tx[num].acked))) {
+		tx[num].acked = count;
+	}
+	xSemaphoreGive(frame_mutex);
+	xTaskNotifyGive(tx[num].task);
+}
+
+
+// Returns the connected clients taking draw commands, which are never in lossy mode,
+// one bit per client.  forget is loaded with those that must be sent every glyph again
+// and the next draw frame packed for them must have them in its draw_reset.
+uint32_t frame_tx_draw_clients(uint32_t* forget)
+{
+	int i;
+	uint32_t clients = 0;
+	uint32_t bits;
+
+	*forget = 0;
+	xSemaphoreTake(frame_mutex, portMAX_DELAY);
+	for (bits = connected; bits != 0; bits &= bits - 1) {
+		i = __builtin_ctz(bits);
+		if (tx[i].draw && !tx[i].lossy) {
+			clients |= 1 << i;
+			if (tx[i].draw_forget) {
+				*forget |= 1 << i;
+				tx[i].draw_forget = false;
+			}
+		}
+	}
+	xSemaphoreGive(frame_mutex);
+
+	return clients;
+}
+
+
+// Once a client has had nothing new to write for FRAME_TX_REFINE_MS and has no damage,
+// load areas with up to max_areas of the areas it was sent approximately, removing
+// them from its list.  Returns the number of areas loaded.
+int frame_tx_take_refine(uint8_t num, lv_area_t* areas, int max_areas)
+{
+	int n = 0;
+
+	xSemaphoreTake(frame_mutex, portMAX_DELAY);
+	if ((tx[num].conn != NULL) && !(hidden & (1 << num)) && (tx[num].num_damage == 0) && (uxQueueMessagesWaiting(tx[num].queue) == 0) &&
+		((xTaskGetTickCount() - tx[num].lossy_tick) >= pdMS_TO_TICKS(FRAME_TX_REFINE_MS))) {
+		while ((n < max_areas) && (tx[num].num_refine > 0)) {
+			lv_area_copy(&areas[n++], &tx[num].refine[--tx[num].num_refine]);
+		}
+	}
+	xSemaphoreGive(frame_mutex);
+
+	return n;
+}
+
+
+// Returns true if any client has missed areas still to be resent or refined
+bool frame_tx_damage_pending()
+{
+	int i;
+	bool pending = false;
+
+	xSemaphoreTake(frame_mutex, portMAX_DELAY);
+	for (i=0; i<WEBSOCKET_SERVER_MAX_CLIENTS; i++) {
+		if ((tx[i].conn != NULL) && !(hidden & (1 << i)) && ((tx[i].num_damage > 0) || (tx[i].num_refine > 0))) {
+			pending = true;
+		}
+	}
+	xSemaphoreGive(frame_mutex);
+
+	return pending;
+}
+
+
+// Returns true while any frame is being packed or is still to be written to a client
+bool frame_tx_in_flight()
+{
+#if WS_DRIVER_ZERO_COPY
+	for (int i=0; i<FRAME_TX_WRAPPED; i++) {
+		if (wrapped[i].refs != 0) return true;
+	}
+#endif
+	return (uxQueueMessagesWaiting(free_queue) < NUM_FRAMES);
+}
+
+
+// Returns the running total of bytes queued by frame_tx_send().  The difference
+// between two calls is what was produced for every client in between.
+uint32_t frame_tx_queued_bytes()
+{
+	return queued_bytes;
+}
+
+
+// Returns the average time in uS the slowest connected client takes to accept 1 kB,
+// scaled by its weight, or 0 before any client has been measured
+uint32_t frame_tx_slowest_cost()
+{
+	int i;
+	uint32_t cost = 0;
+	uint32_t c;
+
+	xSemaphoreTake(frame_mutex, portMAX_DELAY);
+	for (i=0; i<WEBSOCKET_SERVER_MAX_CLIENTS; i++) {
+		if (tx[i].conn == NULL) continue;
+		c = tx[i].cost * tx[i].weight / 100;
+		if (c > cost) {
+			cost = c;
+		}
+	}
+	xSemaphoreGive(frame_mutex);
+
+	return cost;
+}
+
+
+// Set the percentage a client's cost is scaled by in frame_tx_slowest_cost(), so a
+// client known to be on a poor link counts as slower than its writes have measured
+void frame_tx_set_weight(uint8_t num, uint32_t weight)
+{
+	xSemaphoreTake(frame_mutex, portMAX_DELAY);
+	tx[num].weight = weight;
+	xSemaphoreGive(frame_mutex);
+}
+
+
+// Load stats with a snapshot of a client's counters.  Returns false if the client
+// isn't connected.
+bool frame_tx_get_stats(uint8_t num, frame_tx_stats_t* stats)
+{
+	bool connected;
+
+	xSemaphoreTake(frame_mutex, portMAX_DELAY);
+	connected = (tx[num].conn != NULL);
+	stats->sent = tx[num].sent;
+	stats->dropped = tx[num].dropped;
+	stats->bytes = tx[num].bytes;
+	stats->write_us = tx[num].write_us;
+	stats->cost = tx[num].cost;
+	stats->queued = uxQueueMessagesWaiting(tx[num].queue);
+	stats->unacked = tx[num].credits ? (tx[num].numbered - tx[num].acked) : 0;
+	stats->seq = tx[num].seq;
+	xSemaphoreGive(frame_mutex);
+
+	return connected;
+}
+
+
+// Write a text message to one client between its frames, ending any message of
+// fragments first.  Blocks until the client has accepted it, so must not be called from
+// LVGL.  Returns false if the client isn't connected or was dropped for failing to
+// accept it.
+bool frame_tx_send_text(uint8_t num, const char* text, uint32_t len)
+{
+	struct netconn* conn;
+	char header[10];
+	err_t err;
+
+	xSemaphoreTake(tx[num].lock, portMAX_DELAY);
+	conn = tx[num].conn;
+	xSemaphoreGive(tx[num].lock);
+
+	if (conn == NULL) return false;
+
+	// The sender leaves the client's lock to this before its next frame
+	__sync_fetch_and_add(&tx[num].urgent, 1);
+	ws_server_lock_client(num);
+	__sync_fetch_and_sub(&tx[num].urgent, 1);
+	err = close_message(num, conn);
+	if (err == ERR_OK) {
+		err = client_write(num, conn, header, ws_fill_client_header(&clients[num], header, WEBSOCKET_OPCODE_TEXT, len, true),
+			NETCONN_COPY | NETCONN_MORE);
+	}
+	if (err == ERR_OK) {
+		err = client_write(num, conn, text, len, NETCONN_COPY);
+	}
+	ws_server_unlock_client(num);
+
+	if (err != ERR_OK) {
+		ws_server_drop_client(num, conn);
+		return false;
+	}
+	return true;
+}
+
+
+// Park a client under token when its connection goes, so its browser can resume
+void frame_tx_set_token(uint8_t num, uint32_t token)
+{
+	xSemaphoreTake(frame_mutex, portMAX_DELAY);
+	if (tx[num].conn != NULL) {
+		tx[num].token = token;
+	}
+	xSemaphoreGive(frame_mutex);
+}
+
+
+// Called when a browser reconnects as client num with the token of the session it lost,
+// having applied its first applied messages.  Makes what it is missing the client's
+// damage, in its old viewport, and returns true, or returns false if it must be sent the
+// whole screen: the token is unknown or expired, the history doesn't reach back to what
+// it applied or, with same_slot set, it came back in another slot.  A browser usually
+// sees its connection fail before the driver does, so a client still connected with the
+// token is taken to be gone and parked first; the websocket server drops it once a
+// write or ping fails.
+bool frame_tx_resume(uint8_t num, uint32_t token, uint32_t applied, bool same_slot)
+{
+	bool resumed = false;
+
+#if WS_DRIVER_RESUME
+	parked_t* p;
+	uint32_t n;
+	int i;
+	int old = -1;
+
+	xSemaphoreTake(frame_mutex, portMAX_DELAY);
+	for (i=0; i<WEBSOCKET_SERVER_MAX_CLIENTS; i++) {
+		if ((token != 0) && (i != num) && (tx[i].conn != NULL) && (tx[i].token == token)) {
+			old = i;
+		}
+	}
+	xSemaphoreGive(frame_mutex);
+	if (old >= 0) {
+		frame_tx_disconnect(old);
+	}
+
+	xSemaphoreTake(frame_mutex, portMAX_DELAY);
+	for (i=0; i<WEBSOCKET_SERVER_MAX_CLIENTS; i++) {
+		p = &parked[i];
+		if ((token == 0) || (p->token != token) || park_expired_locked(p)) continue;
+		p->token = 0;
+		if ((tx[num].conn == NULL) || (same_slot && (p->num != num)) ||
+			((p->numbered - applied) > FRAME_TX_HISTORY)) {
+			break;
+		}
+		tx[num].clipped = p->clipped;
+		lv_area_copy(&tx[num].viewport, &p->viewport);
+		for (n = applied + 1; n != p->numbered + 1; n++) {
+			add_damage_locked(num, &p->history[n & (FRAME_TX_HISTORY - 1)]);
+		}
+		while (p->num_damage > 0) {
+			add_damage_locked(num, &p->damage[--p->num_damage]);
+		}
+		resumed = true;
+		break;
+	}
+	xSemaphoreGive(frame_mutex);
+#else
+	(void) num;
+	(void) token;
+	(void) applied;
+	(void) same_slot;
+#endif
+
+	return resumed;
+}
+
+
+/**********************
+ *   STATIC FUNCTIONS
+ **********************/
+// writes frames to one client
+static void client_tx_task(void* pvParameters) {
+	int num = (intptr_t) pvParameters;
+	frame_t* f;
+	struct netconn* conn;
+	bool cont;
+	bool zipped;
+	err_t err;
+	int64_t start;
+	uint32_t us;
+	uint32_t cost;
+#if WS_DRIVER_BENCHMARK
+	uint32_t unsent;
+#endif
+
+	for(;;) {
+		wait_credit(num);
+		xQueueReceive(tx[num].queue, &f, portMAX_DELAY);
+
+		// Draw commands after a lost frame may use glyphs it defined
+		if (f->draw) {
+			xSemaphoreTake(frame_mutex, portMAX_DELAY);
+			if (tx[num].draw_lost) {
+				if (f->draw_reset & (1 << num)) {
+					tx[num].draw_lost = false;
+				} else {
+					drop_locked(num, f);
+					f = NULL;
+				}
+			}
+			xSemaphoreGive(frame_mutex);
+			if (f == NULL) continue;
+		}
+
+		xSemaphoreTake(tx[num].lock, portMAX_DELAY);
+		conn = tx[num].conn;
+		xSemaphoreGive(tx[num].lock);
+
+		err = ERR_OK;
+		if (conn != NULL) {
+			// Compressed before the client is locked, so its pings aren't held up
+			zipped = false;
+#if WEBSOCKET_SERVER_DEFLATE
+			if (clients[num].deflate && !f->end) {
+				zipped = frame_deflate(f);
+			}
+#endif
+
+			// Text messages for the client go ahead of it
+			while (tx[num].urgent != 0) {
+				vTaskDelay(1);
+			}
+			
+			// The server's pings and pongs must not be sent part way through, though
+			// they may come between the fragments of a message.
+			ws_server_lock_client(num);
+			start = esp_timer_get_time();
+			if (!f->more) {
+				err = close_message(num, conn);
+			}
+			cont = (tx[num].open == conn);
+			
+			// Counted before it is written, since the client may acknowledge the
+			// message before the write returns.  A message of fragments covers all
+			// their areas.
+			if ((f->len > 0) && !f->text) {
+				xSemaphoreTake(frame_mutex, portMAX_DELAY);
+				if (cont) {
+					lv_area_join(&tx[num].history[tx[num].numbered & (FRAME_TX_HISTORY - 1)],
+						&tx[num].history[tx[num].numbered & (FRAME_TX_HISTORY - 1)], &f->area);
+				} else {
+					tx[num].numbered++;
+					lv_area_copy(&tx[num].history[tx[num].numbered & (FRAME_TX_HISTORY - 1)], &f->area);
+				}
+				xSemaphoreGive(frame_mutex);
+			}
+			
+			if ((err == ERR_OK) && !f->end) {
+				if (f->more) {
+					tx[num].open = conn;
+				}
+				err = write_frame(num, conn, f, cont, zipped);
+			}
+#if WS_DRIVER_BENCHMARK
+			// What lwIP still holds of the client's writes, read without its lock as
+			// only a statistic
+			unsent = TCP_SND_BUF - tcp_sndbuf(conn->pcb.tcp);
+#endif
+			ws_server_unlock_client(num);
+			if ((err == ERR_OK) && (f->len > 0)) {
+				// Average the time the write took scaled to 1 kB
+				us = (uint32_t) (esp_timer_get_time() - start);
+				cost = (uint32_t) ((uint64_t) us * 1024 / f->len);
+				tx[num].cost = (tx[num].cost == 0) ? cost : (tx[num].cost * 3 + cost) / 4;
+				tx[num].sent++;
+				tx[num].bytes += f->len;
+				tx[num].write_us += us;
+#if WS_DRIVER_BENCHMARK
+				e2e_bench_written(num, tx[num].sent, f->len, us, unsent);
+#endif
+#if WS_DRIVER_TRACE
+				trace_rec_span(TRACE_WRITE, (uint32_t) start, num, &f->area, f->len);
+#endif
+			}
+		}
+
+		xSemaphoreTake(frame_mutex, portMAX_DELAY);
+		if (f->copy && (tx[num].copies > 0)) {
+			tx[num].copies--;
+		}
+#if WS_DRIVER_RESUME
+		if (((conn == NULL) || (err != ERR_OK)) && HAS_AREA(f)) {
+			park_lost_locked(num, f);
+		}
+#endif
+		frame_unref_locked(f);
+		xSemaphoreGive(frame_mutex);
+
+		if (err != ERR_OK) {
+			// Disconnect the client unless that already happened while we were writing
+			ws_server_drop_client(num, conn);
+		}
+	}
+	vTaskDelete(NULL);
+}
+
+
+// Wait while a client has all the messages its credits allow unacknowledged, so frames
+// queued meanwhile are dropped and resent as damage.  A message still open can't be
+// acknowledged until it ends, so the sender goes on while there is one, leaving the
+// client one message over if the next frame doesn't continue it.  Gives up on a client that
+// acknowledges nothing for CLIENT_STALL_MS.
+static void wait_credit(int num)
+{
+	struct netconn* conn;
+	uint32_t acked;
+	bool waiting;
+
+	for (;;) {
+		xSemaphoreTake(frame_mutex, portMAX_DELAY);
+		conn = tx[num].conn;
+		acked = tx[num].acked;
+		waiting = (conn != NULL) && (tx[num].credits != 0) && ((tx[num].numbered - acked) >= tx[num].credits) &&
+			(tx[num].open != conn);
+		xSemaphoreGive(frame_mutex);
+		if (!waiting) return;
+
+		if ((ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(CLIENT_STALL_MS)) == 0) && (tx[num].acked == acked)) {
+			ESP_LOGW(TAG, "client %d stopped acknowledging", num);
+			ws_server_drop_client(num, conn);
+			return;
+		}
+	}
+}
+
+
+// Write data to a client as its TCP send buffer accepts it, holding the client's lock
+// only for one attempt at a time.  A TLS client's data is encrypted a record at a time
+// as it goes.  Fails if the client disconnects or makes no progress for CLIENT_STALL_MS.
+static err_t client_write(int num, struct netconn* conn, const void* data, size_t len, uint8_t flags)
+{
+	const uint8_t* p = data;
+	size_t written;
+	TickType_t progress = xTaskGetTickCount();
+	err_t err;
+
+	while (len > 0) {
+		written = 0;
+		xSemaphoreTake(tx[num].lock, portMAX_DELAY);
+		if (tx[num].conn == conn) {
+			err = ws_write_partly(&clients[num], p, len, flags, &written);
+		} else {
+			err = ERR_CLSD;
+		}
+		xSemaphoreGive(tx[num].lock);
+
+		if ((err != ERR_OK) && (err != ERR_WOULDBLOCK)) {
+			return err;
+		}
+		if (written > 0) {
+			p += written;
+			len -= written;
+			progress = xTaskGetTickCount();
+		} else if ((xTaskGetTickCount() - progress) >= pdMS_TO_TICKS(CLIENT_STALL_MS)) {
+			ESP_LOGW(TAG, "client %d stalled", num);
+			return ERR_TIMEOUT;
+		}
+	}
+
+	return ERR_OK;
+}
+
+
+// End the message of fragments open on a client's connection, if there is one, with an
+// empty last fragment.  Must be called with the client's websocket write lock held.
+static err_t close_message(int num, struct netconn* conn)
+{
+	char header[10];
+
+	if (tx[num].open != conn) return ERR_OK;
+	tx[num].open = NULL;
+	return client_write(num, conn, header, ws_fill_client_header(&clients[num], header, WEBSOCKET_OPCODE_CONT, 0, true), NETCONN_COPY);
+}
+
+
+// Write a frame as a message, or a fragment of the one open if cont is set.  The header
+// is small and gets copied, the payload doesn't.  A client that takes permessage-deflate
+// is sent the compressed payload if zipped is set, unless the message it continues
+// started uncompressed.  A fragment that didn't compress continuing a compressed
+// message is sent as stored blocks.  Payloads longer than fragment_len go as several
+// websocket fragments, with the pings and pongs left for the client sent in between.
+// Must be called with the client's websocket write lock held.
+static err_t write_frame(int num, struct netconn* conn, const frame_t* f, bool cont, bool zipped)
+{
+	char header[10];
+	const uint8_t* payload = f->buf;
+	uint32_t len = f->len;
+	uint32_t pos = 0;
+	uint32_t n;
+	uint32_t frag = fragment_len;   // Read once, it may be changed meanwhile
+	bool fin;
+	int header_len;
+	err_t err = ERR_OK;
+#if WEBSOCKET_SERVER_DEFLATE
+	uint8_t block[5];
+
+	if (!cont) {
+		tx[num].zopen = zipped && f->more;
+	} else if (tx[num].zopen && !zipped) {
+		// A fragment of one stored block at a time
+		for (pos = 0; (err == ERR_OK) && (pos < f->len); pos += n) {
+			n = LV_MATH_MIN(f->len - pos, ((frag != 0) && (frag < STORED_MAX_LEN)) ? frag : STORED_MAX_LEN);
+			if (pos > 0) {
+				err = ws_send_control_pending(&clients[num]);
+				if (err != ERR_OK) break;
+			}
+			header_len = ws_fill_client_header(&clients[num], header, WEBSOCKET_OPCODE_CONT, n + sizeof(block), false);
+			err = client_write(num, conn, header, header_len, NETCONN_COPY | NETCONN_MORE);
+			block[0] = 0; // Not the last block, stored
+			block[1] = n & 0xff;
+			block[2] = n >> 8;
+			block[3] = ~n & 0xff;
+			block[4] = (~n >> 8) & 0xff;
+			if (err == ERR_OK) {
+				err = client_write(num, conn, block, sizeof(block), NETCONN_COPY | NETCONN_MORE);
+			}
+			if (err == ERR_OK) {
+				err = client_write(num, conn, f->buf + pos, n, NETCONN_NOCOPY);
+			}
+		}
+		return err;
+	}
+	if (zipped && (!cont || tx[num].zopen)) {
+		// The tail of the sync flush only comes off the end of the message
+		payload = f->zbuf;
+		len = f->more ? f->zlen : (f->zlen - WS_DEFLATE_TAIL_LEN);
+	} else {
+		zipped = false;
+	}
+#endif
+
+	// A message continued is ended by close_message(), otherwise the last fragment ends
+	// it unless more follow
+	do {
+		n = len - pos;
+		if ((frag != 0) && (n > frag)) n = frag;
+		fin = (pos + n == len) && !cont && !f->more;
+		if ((pos == 0) && !cont) {
+			header_len = ws_fill_client_header(&clients[num], header, f->text ? WEBSOCKET_OPCODE_TEXT : WEBSOCKET_OPCODE_BIN, n, fin);
+			if (zipped) {
+				header[0] |= WS_HEADER_COMPRESSED;
+			}
+		} else {
+			if (pos > 0) {
+				err = ws_send_control_pending(&clients[num]);
+				if (err != ERR_OK) break;
+			}
+			header_len = ws_fill_client_header(&clients[num], header, WEBSOCKET_OPCODE_CONT, n, fin);
+		}
+		err = client_write(num, conn, header, header_len, NETCONN_COPY | NETCONN_MORE);
+		if (err == ERR_OK) {
+			err = client_write(num, conn, payload + pos, n, NETCONN_NOCOPY);
+		}
+		pos += n;
+	} while ((err == ERR_OK) && (pos < len));
+	return err;
+}
+
+
+#if WEBSOCKET_SERVER_DEFLATE
+// Compress a frame's payload for permessage-deflate the first time a client that takes
+// it is about to be written the frame, keeping the result with the frame for the rest.
+// Returns false if it didn't get shorter, is too short to bother with or there was no
+// memory for it.
+static bool frame_deflate(frame_t* f)
+{
+	xSemaphoreTake(deflate_mutex, portMAX_DELAY);
+	if (!f->ztried) {
+		f->ztried = true;
+		if (f->len >= WS_DEFLATE_MIN_LEN) {
+			f->zbuf = malloc(f->len);
+		}
+		if (f->zbuf != NULL) {
+			f->zlen = ws_deflate(f->buf, f->len, f->zbuf, f->len, deflate_table);
+			if (f->zlen == 0) {
+				free(f->zbuf);
+				f->zbuf = NULL;
+			}
+		}
+	}
+	xSemaphoreGive(deflate_mutex);
+
+	return (f->zbuf != NULL);
+}
+#endif
+
+
+// Must be called with frame_mutex held
+static void frame_unref_locked(frame_t* frame)
+{
+	if (--frame->refs == 0) {
+#if WEBSOCKET_SERVER_DEFLATE
+		free(frame->zbuf);
+		frame->zbuf = NULL;
+#endif
+		if (frame->release_cb != NULL) {
+			frame->release_cb(frame->release_arg);
+		} else {
+			xQueueSendToBack(free_queue, &frame, 0);
+		}
+	}
+}
+
+
+// Queue frame for a client, dropping its oldest pending frame if its queue is full.
+// Must be called with frame_mutex held.
+static void post_locked(int num, frame_t* frame)
+{
+	frame_t* old;
+
+	// A hidden client misses the frame, though not text meant for it or the end of its
+	// message
+	if ((hidden & (1 << num)) && HAS_AREA(frame)) {
+		draw_lost_locked(num, frame);
+		add_damage_locked(num, &frame->area);
+		return;
+	}
+	while ((uxQueueMessagesWaiting(tx[num].queue) >= depth) &&
+		(xQueueReceive(tx[num].queue, &old, 0) == pdTRUE)) {
+		drop_locked(num, old);
+	}
+	if (frame->copy) {
+		copy_damage_locked(num, frame);
+		if (tx[num].copies++ == 0) {
+			lv_area_copy(&tx[num].copy_area, &frame->area);
+		} else {
+			lv_area_join(&tx[num].copy_area, &tx[num].copy_area, &frame->area);
+		}
+	}
+	if (frame->lossy && !tx[num].held) {
+		add_area_locked(tx[num].refine, &tx[num].num_refine, &frame->area);
+		tx[num].lossy_tick = xTaskGetTickCount();
+	}
+	frame->refs++;
+	xQueueSendToBack(tx[num].queue, &frame, 0);
+}
+
+
+// Drop a frame taken from the front of a client's queue, remembering its area as
+// damage.  Must be called with frame_mutex held.
+static void drop_locked(int num, frame_t* frame)
+{
+	if (frame->copy) {
+		tx[num].copies--;
+	}
+	draw_lost_locked(num, frame);
+	if (HAS_AREA(frame)) {
+		add_damage_locked(num, &frame->area);
+
+		// The copies still queued move whatever the frame would have drawn
+		if (tx[num].copies > 0) {
+			add_damage_locked(num, &tx[num].copy_area);
+		}
+	}
+	frame_unref_locked(frame);
+	tx[num].dropped++;
+}
+
+
+// Note that a client missed a frame of draw commands, if it was one.  The glyphs it
+// defined must be sent again, as must those of a reset already waiting to be packed if
+// this was one.  Must be called with frame_mutex held.
+static void draw_lost_locked(int num, const frame_t* frame)
+{
+	if (frame->draw) {
+		if (!tx[num].draw_lost || (frame->draw_reset & (1 << num))) {
+			tx[num].draw_forget = true;
+		}
+		tx[num].draw_lost = true;
+	}
+}
+
+
+// Add where a copy moves a client's damage to, as what was missing there moves with the
+// pixels, and the same for the areas it has approximately.  Must be called with
+// frame_mutex held.
+static void copy_damage_locked(int num, const frame_t* frame)
+{
+	copy_areas_locked(tx[num].damage, &tx[num].num_damage, frame);
+	copy_areas_locked(tx[num].refine, &tx[num].num_refine, frame);
+}
+
+
+// Add where a copy moves the areas of a list to.  Must be called with frame_mutex held.
+static void copy_areas_locked(lv_area_t* list, int* num_areas, const frame_t* frame)
+{
+	int i;
+	int n = 0;
+	lv_area_t moved[FRAME_TX_MAX_DAMAGE];
+
+	for (i=0; i<*num_areas; i++) {
+		if (!lv_area_intersect(&moved[n], &list[i], &frame->area)) continue;
+		moved[n].x1 += frame->dx;
+		moved[n].y1 += frame->dy;
+		moved[n].x2 += frame->dx;
+		moved[n].y2 += frame->dy;
+		if (lv_area_intersect(&moved[n], &moved[n], &frame->area)) n++;
+	}
+	for (i=0; i<n; i++) {
+		add_area_locked(list, num_areas, &moved[i]);
+	}
+}
+
+
+// Add an area to a client's damage, the part in its viewport if it has one.  Must be
+// called with frame_mutex held.
+static void add_damage_locked(int num, const lv_area_t* area)
+{
+	lv_area_t a;
+
+	if (!tx[num].clipped) {
+		add_area_locked(tx[num].damage, &tx[num].num_damage, area);
+	} else if (lv_area_intersect(&a, area, &tx[num].viewport)) {
+		add_area_locked(tx[num].damage, &tx[num].num_damage, &a);
+	}
+}
+
+
+// Add the part of a client's viewport outside the old one to its damage, as the rows
+// above and below the old one and the columns either side.  Must be called with
+// frame_mutex held.
+static void expose_locked(int num, const lv_area_t* old)
+{
+	const lv_area_t* vp = &tx[num].viewport;
+	lv_area_t in;
+	lv_area_t a;
+
+	if (!lv_area_intersect(&in, old, vp)) {
+		if ((vp->x1 <= vp->x2) && (vp->y1 <= vp->y2)) {
+			add_damage_locked(num, vp);
+		}
+		return;
+	}
+	lv_area_copy(&a, vp);
+	a.y2 = in.y1 - 1;
+	if (a.y1 <= a.y2) add_damage_locked(num, &a);
+	lv_area_copy(&a, vp);
+	a.y1 = in.y2 + 1;
+	if (a.y1 <= a.y2) add_damage_locked(num, &a);
+	a.y1 = in.y1;
+	a.y2 = in.y2;
+	a.x2 = in.x1 - 1;
+	if (a.x1 <= a.x2) add_damage_locked(num, &a);
+	a.x1 = in.x2 + 1;
+	a.x2 = vp->x2;
+	if (a.x1 <= a.x2) add_damage_locked(num, &a);
+}
+
+
+// Add an area to a list of up to FRAME_TX_MAX_DAMAGE areas.  Like lv_refr_join_area(),
+// overlapping areas are joined when the result is smaller than the two separately.
+// When the list is full the area is joined with the one that grows the least.  Must be
+// called with frame_mutex held.
+static void add_area_locked(lv_area_t* list, int* num_areas, const lv_area_t* area)
+{
+	int i;
+	int best;
+	uint32_t grow, best_grow;
+	lv_area_t joined;
+	lv_area_t a;
+	lv_area_t* d = list;
+
+	lv_area_copy(&a, area);
+
+	// Absorb existing areas until none can be joined
+	i = 0;
+	while (i < *num_areas) {
+		lv_area_join(&joined, &a, &d[i]);
+		if (lv_area_is_on(&a, &d[i]) &&
+			(lv_area_get_size(&joined) < lv_area_get_size(&a) + lv_area_get_size(&d[i]))) {
+			lv_area_copy(&a, &joined);
+			lv_area_copy(&d[i], &d[--(*num_areas)]);
+			i = 0;
+		} else {
+			i++;
+		}
+	}
+
+	// Have the resync task run
+	websocket_driver_wake();
+
+	if (*num_areas < FRAME_TX_MAX_DAMAGE) {
+		lv_area_copy(&d[(*num_areas)++], &a);
+		return;
+	}
+
+	best = 0;
+	best_grow = UINT32_MAX;
+	for (i=0; i<*num_areas; i++) {
+		lv_area_join(&joined, &a, &d[i]);
+		grow = lv_area_get_size(&joined) - lv_area_get_size(&d[i]);
+		if (grow < best_grow) {
+			best = i;
+			best_grow = grow;
+		}
+	}
+	lv_area_join(&d[best], &a, &d[best]);
+}
+
+
+#if WS_DRIVER_RESUME
+// Park a client whose connection is going with its damage and the areas it has
+// approximately, taking the entry of the client that went longest ago if none are free.
+// Returns the entry, for the areas of the frames still queued to be added.  Must be
+// called with frame_mutex held.
+static parked_t* park_locked(int num)
+{
+	parked_t* p = &parked[0];
+	int i;
+
+	for (i=0; i<WEBSOCKET_SERVER_MAX_CLIENTS; i++) {
+		if ((parked[i].token == 0) || park_expired_locked(&parked[i])) {
+			p = &parked[i];
+			break;
+		}
+		if ((parked[i].tick - p->tick) > (TickType_t) INT32_MAX) {
+			p = &parked[i];
+		}
+	}
+
+	p->token = tx[num].token;
+	p->num = num;
+	p->tick = xTaskGetTickCount();
+	p->numbered = tx[num].numbered;
+	memcpy(p->history, tx[num].history, sizeof(p->history));
+	p->clipped = tx[num].clipped;
+	lv_area_copy(&p->viewport, &tx[num].viewport);
+	p->num_damage = 0;
+	for (i=0; i<tx[num].num_damage; i++) {
+		park_damage_locked(p, &tx[num].damage[i]);
+	}
+	for (i=0; i<tx[num].num_refine; i++) {
+		park_damage_locked(p, &tx[num].refine[i]);
+	}
+	return p;
+}
+
+
+// Add an area to a parked client's damage, the part in its viewport if it had one.
+// Must be called with frame_mutex held.
+static void park_damage_locked(parked_t* p, const lv_area_t* area)
+{
+	lv_area_t a;
+
+	if (!p->clipped) {
+		add_area_locked(p->damage, &p->num_damage, area);
+	} else if (lv_area_intersect(&a, area, &p->viewport)) {
+		add_area_locked(p->damage, &p->num_damage, &a);
+	}
+}
+
+
+// Add the area of a frame a client's sender took from its queue but never wrote, as
+// the connection had gone, to its parked entry.  Must be called with frame_mutex held.
+static void park_lost_locked(int num, const frame_t* frame)
+{
+	int i;
+
+	for (i=0; i<WEBSOCKET_SERVER_MAX_CLIENTS; i++) {
+		if ((parked[i].token != 0) && (parked[i].token == tx[num].token) && (parked[i].num == num)) {
+			park_damage_locked(&parked[i], &frame->area);
+		}
+	}
+}
+
+
+// Frees the entry of a parked client that has been away more than WS_DRIVER_RESUME mS,
+// returning true if it did.  Must be called with frame_mutex held.
+static bool park_expired_locked(parked_t* p)
+{
+	if ((xTaskGetTickCount() - p->tick) < pdMS_TO_TICKS(WS_DRIVER_RESUME)) return false;
+	p->token = 0;
+	return true;
+}
+#endif
@@ -0,0 +1,132 @@
+/**
+* Per-client frame transmission for the LittleVGL websocket driver
+*
+* Packed websocket message payloads are held in a small pool of reference counted frame
+* buffers.  Each client has its own sender task and a short queue of pending frames so
+* a slow client only delays itself.  When a client's queue is full its oldest pending
+* frame is dropped for that client and its area remembered as damage that must be
+* resent once the client has caught up.
+*
+* A client that loses its connection is parked for a while, its missing areas still
+* collected, so a browser reconnecting with its token is only resent those.
+*
+*/
+#ifndef FRAME_TX_H
+#define FRAME_TX_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*********************
+ *      INCLUDES
+ *********************/
+#include <stdint.h>
+#include <stdbool.h>
+#include "lwip/api.h"
+#include "lvgl/lvgl.h"
+
+
+/*********************
+ *      DEFINES
+ *********************/
+// Maximum number of separate areas remembered for a client that dropped frames
+#define FRAME_TX_MAX_DAMAGE 8
+
+// Number of the last messages written to a client whose areas are remembered, so one
+// that reconnects can be resent those it never applied.  A power of 2.
+#define FRAME_TX_HISTORY 16
+
+// Time in mS a client in lossy mode must have had nothing new to write before the areas
+// it was sent approximately are refined
+#define FRAME_TX_REFINE_MS 300
+
+// Number of buffers owned by the caller that may be sent as frames at once, see
+// frame_tx_wrap()
+#define FRAME_TX_WRAPPED 2
+
+
+/**********************
+ *      TYPEDEFS
+ **********************/
+typedef struct
+{
+	uint8_t* buf;      // Websocket message payload
+	uint32_t len;      // Length of the payload
+	lv_area_t area;    // Screen area covered by the message
+	bool copy;         // Set when the message moves the pixels in area by dx, dy
+	lv_coord_t dx;
+	lv_coord_t dy;
+	bool lossy;        // Set when the pixels are approximate and must be refined later
+	bool draw;         // Set when the message holds draw commands
+	bool text;         // Set when the message is text, not pixels, and covers no area
+	bool more;         // Set when the client's next frame continues the message
+	bool end;          // Set when the frame only ends a message, see frame_tx_end()
+	uint32_t draw_reset; // Clients the draw commands define every glyph they use for
+	uint8_t* zbuf;     // The payload compressed for permessage-deflate, NULL if it wasn't
+	uint32_t zlen;     // Length of the compressed payload, sync flush tail included
+	bool ztried;       // Set once compressing the payload has been tried
+	int refs;          // Number of users of the frame
+	void (*release_cb)(void* arg); // Called instead of reusing a wrapped frame's buffer
+	void* release_arg;
+} frame_t;
+
+typedef struct
+{
+	uint32_t sent;      // Frames written since the client connected
+	uint32_t dropped;   // Frames dropped since the client connected
+	uint32_t bytes;     // Frame bytes written, wrapping
+	uint32_t write_us;  // Time in uS spent writing frames, wrapping
+	uint32_t cost;      // Average time in uS to write 1 kB, 0 until measured
+	uint32_t queued;    // Frames waiting to be written
+	uint32_t unacked;   // Messages written but not acknowledged, 0 without credits
+	uint32_t seq;       // Changes each time the client slot is reconnected
+} frame_tx_stats_t;
+
+
+/**********************
+ * GLOBAL PROTOTYPES
+ **********************/
+bool frame_tx_init(uint32_t buf_len, uint32_t caps);
+frame_t* frame_tx_get();
+frame_t* frame_tx_wrap(uint8_t* buf, uint32_t len, void (*release_cb)(void* arg), void* release_arg);
+void frame_tx_send(frame_t* frame);
+void frame_tx_send_to(frame_t* frame, uint32_t clients);
+void frame_tx_send_client(uint8_t num, frame_t* frame);
+void frame_tx_end(uint32_t clients);
+void frame_tx_release(frame_t* frame);
+void frame_tx_connect(uint8_t num, struct netconn* conn);
+void frame_tx_disconnect(uint8_t num);
+int frame_tx_take_damage(uint8_t num, lv_area_t* areas, int max_areas);
+void frame_tx_add_damage(uint8_t num, const lv_area_t* area);
+void frame_tx_set_lossy(uint8_t num, bool lossy, bool refine);
+uint32_t frame_tx_clients(bool lossy);
+void frame_tx_set_viewport(uint8_t num, const lv_area_t* viewport);
+bool frame_tx_get_viewport(uint8_t num, lv_area_t* viewport);
+uint32_t frame_tx_connected();
+void frame_tx_set_hidden(uint8_t num, bool hide);
+uint32_t frame_tx_hidden();
+uint32_t frame_tx_consumers();
+void frame_tx_set_draw(uint8_t num, bool draw);
+void frame_tx_set_credits(uint8_t num, uint32_t credits);
+void frame_tx_set_fragment(uint32_t len);
+void frame_tx_set_depth(int frames);
+void frame_tx_ack(uint8_t num, uint32_t count);
+uint32_t frame_tx_draw_clients(uint32_t* forget);
+int frame_tx_take_refine(uint8_t num, lv_area_t* areas, int max_areas);
+bool frame_tx_damage_pending();
+bool frame_tx_in_flight();
+uint32_t frame_tx_queued_bytes();
+uint32_t frame_tx_slowest_cost();
+void frame_tx_set_weight(uint8_t num, uint32_t weight);
+bool frame_tx_get_stats(uint8_t num, frame_tx_stats_t* stats);
+bool frame_tx_send_text(uint8_t num, const char* text, uint32_t len);
+void frame_tx_set_token(uint8_t num, uint32_t token);
+bool frame_tx_resume(uint8_t num, uint32_t token, uint32_t applied, bool same_slot);
+
+
+#ifdef __cplusplus
+} /* extern "C" */
+#endif
+
+#endif /* FRAME_TX_H */
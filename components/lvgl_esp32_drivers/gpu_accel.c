@@ -0,0 +1,195 @@
+/**
+* Fill acceleration for LittleVGL
+*
+* Provides a gpu_fill_cb for the display driver.  Opaque fills are done two pixels at
+* a time and large ones are split with a worker task on the other core, which fills
+* the bottom half of the area while the calling task fills the top half.
+*
+* The ESP32 has no memory to memory DMA available to applications so the second core
+* is the only offload.  Blending is left to LittleVGL's software path since it is done
+* a row at a time, too little work to hand to another core.
+*
+* Whole strips can't be rendered on both cores at once: LittleVGL 6 draws through the
+* display's single VDB and updates its image, glyph and label caches and its heap while
+* drawing, none of which may be used by two tasks at the same time.  Splitting fills
+* is the part of rendering that can be shared, and packing and sending each rendered
+* strip already runs on the network core while LittleVGL renders the next one.
+*
+*/
+
+/*********************
+ *      INCLUDES
+ *********************/
+#include "gpu_accel.h"
+#include "websocket_driver.h"
+#include "esp_log.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "string.h"
+
+
+/*********************
+ *      DEFINES
+ *********************/
+// Smallest fill in pixels worth waking the worker for
+#define SPLIT_FILL_MIN_PX 4096
+
+
+/**********************
+ *      TYPEDEFS
+ **********************/
+typedef struct
+{
+	lv_color_t* row;       // First pixel of the first row to fill
+	lv_coord_t stride;     // Width of the buffer in pixels
+	lv_coord_t w;
+	lv_coord_t h;
+	lv_color_t color;
+} fill_job_t;
+
+#if LV_COLOR_DEPTH == 16
+// Two adjacent pixels, allowed to alias the lv_color_t buffer they are stored into
+typedef uint32_t color_pair_t __attribute__((__may_alias__));
+#endif
+
+
+/**********************
+ *  STATIC VARIABLES
+ **********************/
+static const char* TAG = "gpu_accel";
+
+static gpu_accel_stats_t stats;
+
+#if WS_DRIVER_SPLIT_FILL
+// Work for the worker task and the semaphore it gives when done.  Only the LVGL task
+// fills so a single job is enough.
+static TaskHandle_t worker_task = NULL;
+static SemaphoreHandle_t worker_done;
+static fill_job_t worker_job;
+#endif
+
+
+/**********************
+ *  STATIC PROTOTYPES
+ **********************/
+static void fill_rows(const fill_job_t* job);
+#if WS_DRIVER_SPLIT_FILL
+static void fill_task(void* pvParameters);
+#endif
+
+
+/**********************
+ *   GLOBAL FUNCTIONS
+ **********************/
+void gpu_accel_init()
+{
+	memset(&stats, 0, sizeof(stats));
+	
+#if WS_DRIVER_SPLIT_FILL
+	// Fill on the core LVGL isn't pinned to, or else the one it is being set up from
+#if defined(WS_DRIVER_LVGL_PINNED)
+	int core = (WS_DRIVER_LVGL_CORE == 0) ? 1 : 0;
+#else
+	int core = (xPortGetCoreID() == 0) ? 1 : 0;
+#endif
+	
+	worker_done = xSemaphoreCreateBinary();
+	xTaskCreatePinnedToCore(&fill_task, "fill_task", 1500, NULL, 10, &worker_task, core);
+	ESP_LOGI(TAG, "Opaque fills of %d pixels or more are shared with core %d", SPLIT_FILL_MIN_PX, core);
+#else
+	ESP_LOGI(TAG, "Opaque fills are done word at a time on one core");
+#endif
+}
+
+
+// gpu_fill_cb: fill fill_area, relative to dest_buf which is dest_width pixels wide,
+// with the opaque color
+void gpu_accel_fill(lv_disp_drv_t * drv, lv_color_t * dest_buf, lv_coord_t dest_width, const lv_area_t * fill_area, lv_color_t color)
+{
+	fill_job_t job;
+	
+	job.row = &dest_buf[fill_area->y1 * dest_width + fill_area->x1];
+	job.stride = dest_width;
+	job.w = lv_area_get_width(fill_area);
+	job.h = lv_area_get_height(fill_area);
+	job.color = color;
+	
+	stats.fills++;
+	stats.pixels += (uint32_t) job.w * job.h;
+	
+#if WS_DRIVER_SPLIT_FILL
+	if ((job.h > 1) && ((uint32_t) job.w * job.h >= SPLIT_FILL_MIN_PX)) {
+		// The worker takes the bottom half
+		worker_job = job;
+		worker_job.h = job.h / 2;
+		worker_job.row = &job.row[(job.h - worker_job.h) * dest_width];
+		job.h -= worker_job.h;
+		xTaskNotifyGive(worker_task);
+		
+		fill_rows(&job);
+		xSemaphoreTake(worker_done, portMAX_DELAY);
+		stats.split_fills++;
+		return;
+	}
+#endif
+	
+	fill_rows(&job);
+}
+
+
+void gpu_accel_get_stats(gpu_accel_stats_t* stats_p)
+{
+	*stats_p = stats;
+}
+
+
+/**********************
+ *   STATIC FUNCTIONS
+ **********************/
+// Fill the first row of a job a word at a time where possible and copy it to the rest
+static void fill_rows(const fill_job_t* job)
+{
+	lv_color_t* p = job->row;
+	lv_coord_t n = job->w;
+	lv_coord_t i;
+	
+#if LV_COLOR_DEPTH == 16
+	color_pair_t* pair;
+	color_pair_t c2 = (uint32_t) job->color.full | ((uint32_t) job->color.full << 16);
+	
+	if ((n > 0) && ((uintptr_t) p & 0x2)) {
+		*p++ = job->color;
+		n--;
+	}
+	pair = (color_pair_t*) p;
+	for (i=0; i<n/2; i++) {
+		pair[i] = c2;
+	}
+	if (n & 0x1) {
+		p[n - 1] = job->color;
+	}
+#else
+	for (i=0; i<n; i++) {
+		p[i] = job->color;
+	}
+#endif
+	
+	for (i=1; i<job->h; i++) {
+		memcpy(&job->row[i * job->stride], job->row, job->w * sizeof(lv_color_t));
+	}
+}
+
+
+#if WS_DRIVER_SPLIT_FILL
+// fills its part of a split job each time it is notified
+static void fill_task(void* pvParameters)
+{
+	for (;;) {
+		ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+		fill_rows(&worker_job);
+		xSemaphoreGive(worker_done);
+	}
+	vTaskDelete(NULL);
+}
+#endif
@@ -0,0 +1,47 @@
+/**
+* Fill acceleration for LittleVGL
+*
+* Provides a gpu_fill_cb for the display driver.  Opaque fills are done two pixels at
+* a time and large ones are split with a worker task on the other core, which fills
+* the bottom half of the area while the calling task fills the top half.
+*
+*/
+#ifndef GPU_ACCEL_H
+#define GPU_ACCEL_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*********************
+ *      INCLUDES
+ *********************/
+#include <stdint.h>
+#include <stdbool.h>
+#include "lvgl/lvgl.h"
+
+
+/**********************
+ *      TYPEDEFS
+ **********************/
+typedef struct
+{
+	uint32_t fills;        // Opaque fills done by gpu_accel_fill()
+	uint32_t split_fills;  // Fills shared with the worker on the other core
+	uint32_t pixels;       // Pixels filled
+} gpu_accel_stats_t;
+
+
+/**********************
+ * GLOBAL PROTOTYPES
+ **********************/
+void gpu_accel_init();
+void gpu_accel_fill(lv_disp_drv_t * drv, lv_color_t * dest_buf, lv_coord_t dest_width, const lv_area_t * fill_area, lv_color_t color);
+void gpu_accel_get_stats(gpu_accel_stats_t* stats_p);
+
+
+#ifdef __cplusplus
+} /* extern "C" */
+#endif
+
+#endif /* GPU_ACCEL_H */
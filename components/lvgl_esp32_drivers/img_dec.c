@@ -0,0 +1,1392 @@
+/**
+* Streaming PNG and JPEG image decoders for the LittleVGL websocket driver
+*
+* Both decoders read their source forward only, keeping just what the next line needs:
+* for a PNG the current and previous rows and a deflate window no bigger than the
+* image, for a JPEG the component planes of one row of MCUs.  A line above the last one
+* decoded restarts the image from its first compressed byte, which LittlevGL's image
+* cache avoids by reading each image once from top to bottom.  Interlaced PNGs and
+* progressive or arithmetic coded JPEGs are left to other decoders.
+*
+*/
+
+/*********************
+ *      INCLUDES
+ *********************/
+#include "img_dec.h"
+#include "websocket_driver.h"
+
+#if WS_DRIVER_IMG_DEC
+
+#include "esp_heap_caps.h"
+#include "string.h"
+#include <strings.h>
+
+
+/*********************
+ *      DEFINES
+ *********************/
+// Bytes of a file read from lv_fs at once
+#define READ_BUF_LEN        512
+
+// Deflate's longest code, largest window and code counts
+#define MAX_BITS            15
+#define MAX_WIN             32768
+#define MAX_LCODES          286
+#define MAX_DCODES          30
+#define FIX_LCODES          288
+
+// Fixed point of the JPEG inverse DCT
+#define FIX(x)              ((int) ((x) * 4096 + 0.5))
+
+
+/**********************
+ *      TYPEDEFS
+ **********************/
+typedef enum
+{
+	FORMAT_NONE,
+	FORMAT_PNG,
+	FORMAT_JPG
+} format_t;
+
+// Where an image's compressed bytes come from
+typedef struct
+{
+	const uint8_t* data;    // of a variable, or NULL for a file
+	uint32_t len;
+	uint32_t pos;           // of the next byte
+#if LV_USE_FILESYSTEM
+	bool opened;
+	lv_fs_file_t file;
+	uint32_t buf_start;     // position of buf[0]
+	uint32_t buf_len;
+	uint8_t buf[READ_BUF_LEN];
+#endif
+} src_t;
+
+// What a PNG's chunks before its image data say about it
+typedef struct
+{
+	uint32_t w;
+	uint32_t h;
+	uint8_t depth;
+	uint8_t color_type;
+	bool trns;
+	uint16_t key[3];        // transparent colour of a grey or RGB image
+	uint32_t idat_pos;      // of the first IDAT chunk's length
+} png_hdr_t;
+
+typedef enum
+{
+	INF_HEADER,
+	INF_BLOCK,
+	INF_STORED,
+	INF_HUFF,
+	INF_DONE
+} inf_mode_t;
+
+typedef struct
+{
+	src_t src;
+	png_hdr_t hdr;
+	uint8_t pal[256][4];    // RGBA
+	int channels;
+	int bpp;                // bytes a filter looks back, at least 1
+	int row_len;            // without the filter type byte
+	uint8_t* cur;           // filter type byte and the row
+	uint8_t* prev;
+	lv_coord_t row_y;       // row in cur, or -1 before the first
+	uint32_t chunk_left;    // bytes of image data left in the current IDAT chunk
+	// Inflate state
+	inf_mode_t mode;
+	bool last;
+	uint32_t bits;          // first bit lowest
+	int num_bits;
+	uint32_t stored_left;
+	int copy_len;           // of a match not yet all copied
+	uint32_t copy_dist;
+	uint8_t* win;
+	uint32_t win_mask;
+	uint32_t win_pos;       // bytes inflated
+	uint16_t len_count[MAX_BITS + 1];
+	uint16_t len_sym[FIX_LCODES];
+	uint16_t dist_count[MAX_BITS + 1];
+	uint16_t dist_sym[MAX_DCODES];
+} png_dec_t;
+
+typedef struct
+{
+	uint16_t count[17];     // codes of each length
+	uint8_t sym[256];
+} jpg_huff_t;
+
+typedef struct
+{
+	uint8_t id;
+	uint8_t h;
+	uint8_t v;
+	uint8_t tq;
+	uint8_t td;
+	uint8_t ta;
+	int dc_pred;
+	int stride;
+	uint8_t* plane;         // samples of one row of MCUs
+} jpg_comp_t;
+
+typedef struct
+{
+	src_t src;
+	uint16_t w;
+	uint16_t h;
+	int num_comps;
+	jpg_comp_t comp[3];
+	int h_max;
+	int v_max;
+	int mcus_x;
+	uint16_t restart_interval;
+	uint32_t scan_pos;      // of the first entropy coded byte
+	uint16_t qt[4][64];     // in zig-zag order
+	jpg_huff_t dc[4];
+	jpg_huff_t ac[4];
+	// Entropy decoder state
+	uint32_t bits;          // first bit highest
+	int num_bits;
+	int marker;             // that ended the entropy coded data, or 0
+	uint16_t restart_left;  // MCUs until the next restart marker
+	int next_row;           // row of MCUs to decode next
+	int held_row;           // row of MCUs in the planes, or -1
+} jpg_dec_t;
+
+
+/**********************
+ *  STATIC PROTOTYPES
+ **********************/
+static lv_res_t png_info(lv_img_decoder_t* decoder, const void* src, lv_img_header_t* header);
+static lv_res_t png_open(lv_img_decoder_t* decoder, lv_img_decoder_dsc_t* dsc);
+static lv_res_t png_read_line(lv_img_decoder_t* decoder, lv_img_decoder_dsc_t* dsc, lv_coord_t x,
+	lv_coord_t y, lv_coord_t len, uint8_t* buf);
+static void png_close(lv_img_decoder_t* decoder, lv_img_decoder_dsc_t* dsc);
+static bool png_header(src_t* s, png_hdr_t* hdr, uint8_t (*pal)[4]);
+static void png_restart(png_dec_t* d);
+static bool png_row(png_dec_t* d);
+static uint32_t png_sample(const uint8_t* row, uint32_t i, int depth);
+static uint8_t png_sample8(const uint8_t* row, uint32_t i, int depth);
+static int idat_byte(png_dec_t* d);
+static int inf_bits(png_dec_t* d, int n);
+static int inf_decode(png_dec_t* d, const uint16_t* count, const uint16_t* sym);
+static int inf_build(uint16_t* count, uint16_t* sym, const uint8_t* lengths, int n);
+static bool inf_fixed(png_dec_t* d);
+static bool inf_dynamic(png_dec_t* d);
+static int inf_read(png_dec_t* d, uint8_t* out, int len);
+static lv_res_t jpg_info(lv_img_decoder_t* decoder, const void* src, lv_img_header_t* header);
+static lv_res_t jpg_open(lv_img_decoder_t* decoder, lv_img_decoder_dsc_t* dsc);
+static lv_res_t jpg_read_line(lv_img_decoder_t* decoder, lv_img_decoder_dsc_t* dsc, lv_coord_t x,
+	lv_coord_t y, lv_coord_t len, uint8_t* buf);
+static void jpg_close(lv_img_decoder_t* decoder, lv_img_decoder_dsc_t* dsc);
+static bool jpg_header(jpg_dec_t* d, bool tables);
+static void jpg_restart(jpg_dec_t* d);
+static int jpg_byte(jpg_dec_t* d);
+static int jpg_bits(jpg_dec_t* d, int n);
+static int jpg_decode(jpg_dec_t* d, const jpg_huff_t* h);
+static bool jpg_block(jpg_dec_t* d, jpg_comp_t* c, int* coef);
+static bool jpg_mcu_row(jpg_dec_t* d);
+static void jpg_idct(int* coef, uint8_t* out, int stride);
+static void idct_1d(const int* s, int step, int* o);
+static format_t src_format(const uint8_t* data, uint32_t len);
+static bool src_open(src_t* s, const void* src, format_t format);
+static void src_close(src_t* s);
+static int src_byte(src_t* s);
+static uint32_t src_u16(src_t* s);
+static uint32_t src_u32(src_t* s);
+static void* dec_alloc(uint32_t len);
+static void put_px(uint8_t** buf, uint8_t r, uint8_t g, uint8_t b);
+
+
+/**********************
+ *  STATIC VARIABLES
+ **********************/
+static const uint8_t PNG_SIGNATURE[] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+static const uint8_t JPG_SIGNATURE[] = {0xFF, 0xD8, 0xFF};
+
+// Shortest length and extra bits of each deflate length code from 257
+static const uint16_t LEN_BASE[] = {3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+	35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258};
+static const uint8_t LEN_EXTRA[] = {0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+	3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0};
+
+// Shortest distance and extra bits of each deflate distance code
+static const uint16_t DIST_BASE[] = {1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+	257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577};
+static const uint8_t DIST_EXTRA[] = {0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+	7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13};
+
+// Order the code length code lengths of a dynamic block are sent in
+static const uint8_t CLEN_ORDER[] = {16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15};
+
+// Position in an 8x8 block of each coefficient in zig-zag order
+static const uint8_t DEZIGZAG[] = {
+	 0,  1,  8, 16,  9,  2,  3, 10, 17, 24, 32, 25, 18, 11,  4,  5,
+	12, 19, 26, 33, 40, 48, 41, 34, 27, 20, 13,  6,  7, 14, 21, 28,
+	35, 42, 49, 56, 57, 50, 43, 36, 29, 22, 15, 23, 30, 37, 44, 51,
+	58, 59, 52, 45, 38, 31, 39, 46, 53, 60, 61, 54, 47, 55, 62, 63};
+
+
+/**********************
+ *   GLOBAL FUNCTIONS
+ **********************/
+// Register the decoders, which LittlevGL tries before its own.  Call after lv_init().
+bool img_dec_init()
+{
+	lv_img_decoder_t* dec;
+
+	if ((dec = lv_img_decoder_create()) == NULL) return false;
+	lv_img_decoder_set_info_cb(dec, png_info);
+	lv_img_decoder_set_open_cb(dec, png_open);
+	lv_img_decoder_set_read_line_cb(dec, png_read_line);
+	lv_img_decoder_set_close_cb(dec, png_close);
+
+	if ((dec = lv_img_decoder_create()) == NULL) return false;
+	lv_img_decoder_set_info_cb(dec, jpg_info);
+	lv_img_decoder_set_open_cb(dec, jpg_open);
+	lv_img_decoder_set_read_line_cb(dec, jpg_read_line);
+	lv_img_decoder_set_close_cb(dec, jpg_close);
+	return true;
+}
+
+
+// Check if len bytes of data are a PNG or JPEG file, for an lv_img_dsc_t of colour
+// format LV_IMG_CF_RAW
+bool img_dec_is_encoded(const uint8_t* data, uint32_t len)
+{
+	return (src_format(data, len) != FORMAT_NONE);
+}
+
+
+/**********************
+ *   STATIC FUNCTIONS
+ **********************/
+//
+// PNG decoder
+//
+static lv_res_t png_info(lv_img_decoder_t* decoder, const void* src, lv_img_header_t* header)
+{
+	src_t s;
+	png_hdr_t hdr;
+	bool ok;
+
+	(void) decoder;
+
+	if (!src_open(&s, src, FORMAT_PNG)) return LV_RES_INV;
+	ok = png_header(&s, &hdr, NULL);
+	src_close(&s);
+	if (!ok) return LV_RES_INV;
+
+	header->always_zero = 0;
+	header->w = hdr.w;
+	header->h = hdr.h;
+	header->cf = ((hdr.color_type & 4) || hdr.trns) ? LV_IMG_CF_TRUE_COLOR_ALPHA : LV_IMG_CF_TRUE_COLOR;
+	return LV_RES_OK;
+}
+
+
+static lv_res_t png_open(lv_img_decoder_t* decoder, lv_img_decoder_dsc_t* dsc)
+{
+	png_dec_t* d;
+	uint32_t raw_len, win_len;
+
+	(void) decoder;
+
+	if ((d = dec_alloc(sizeof(png_dec_t))) == NULL) return LV_RES_INV;
+	memset(d, 0, sizeof(png_dec_t));
+	dsc->user_data = d;
+
+	if (!src_open(&d->src, dsc->src, FORMAT_PNG) || !png_header(&d->src, &d->hdr, d->pal)) {
+		png_close(decoder, dsc);
+		return LV_RES_INV;
+	}
+
+	d->channels = (d->hdr.color_type == 2) ? 3 : (d->hdr.color_type == 4) ? 2 : (d->hdr.color_type == 6) ? 4 : 1;
+	d->bpp = (d->channels * d->hdr.depth + 7) / 8;
+	d->row_len = (d->hdr.w * d->channels * d->hdr.depth + 7) / 8;
+
+	// No match reaches further back than the start of the image
+	raw_len = d->hdr.h * (d->row_len + 1);
+	for (win_len = 256; (win_len < raw_len) && (win_len < MAX_WIN); win_len <<= 1);
+	d->win_mask = win_len - 1;
+
+	d->cur = dec_alloc(d->row_len + 1);
+	d->prev = dec_alloc(d->row_len + 1);
+	d->win = dec_alloc(win_len);
+	if ((d->cur == NULL) || (d->prev == NULL) || (d->win == NULL)) {
+		png_close(decoder, dsc);
+		return LV_RES_INV;
+	}
+
+	png_restart(d);
+	return LV_RES_OK;
+}
+
+
+static lv_res_t png_read_line(lv_img_decoder_t* decoder, lv_img_decoder_dsc_t* dsc, lv_coord_t x,
+	lv_coord_t y, lv_coord_t len, uint8_t* buf)
+{
+	png_dec_t* d = dsc->user_data;
+	const uint8_t* row;
+	uint8_t r, g, b, a;
+	uint32_t v;
+	int i;
+
+	(void) decoder;
+
+	if (y < d->row_y) png_restart(d);
+	while (d->row_y < y) {
+		if (!png_row(d)) {
+			// Start again on the next read rather than decode garbage
+			png_restart(d);
+			return LV_RES_INV;
+		}
+	}
+
+	row = d->cur + 1;
+	for (i=x; i<x+len; i++) {
+		a = 0xFF;
+		switch (d->hdr.color_type) {
+			case 3:
+				v = png_sample(row, i, d->hdr.depth);
+				r = d->pal[v][0];
+				g = d->pal[v][1];
+				b = d->pal[v][2];
+				a = d->pal[v][3];
+				break;
+
+			case 2:
+			case 6:
+				r = png_sample8(row, i * d->channels, d->hdr.depth);
+				g = png_sample8(row, i * d->channels + 1, d->hdr.depth);
+				b = png_sample8(row, i * d->channels + 2, d->hdr.depth);
+				if (d->hdr.color_type == 6) {
+					a = png_sample8(row, i * d->channels + 3, d->hdr.depth);
+				} else if (d->hdr.trns && (png_sample(row, i * 3, d->hdr.depth) == d->hdr.key[0]) &&
+					(png_sample(row, i * 3 + 1, d->hdr.depth) == d->hdr.key[1]) &&
+					(png_sample(row, i * 3 + 2, d->hdr.depth) == d->hdr.key[2])) {
+					a = 0;
+				}
+				break;
+
+			default:
+				// Grey, with or without alpha
+				v = png_sample(row, i * d->channels, d->hdr.depth);
+				r = png_sample8(row, i * d->channels, d->hdr.depth);
+				g = r;
+				b = r;
+				if (d->hdr.color_type == 4) {
+					a = png_sample8(row, i * 2 + 1, d->hdr.depth);
+				} else if (d->hdr.trns && (v == d->hdr.key[0])) {
+					a = 0;
+				}
+				break;
+		}
+		put_px(&buf, r, g, b);
+		if (dsc->header.cf == LV_IMG_CF_TRUE_COLOR_ALPHA) *buf++ = a;
+	}
+	return LV_RES_OK;
+}
+
+
+static void png_close(lv_img_decoder_t* decoder, lv_img_decoder_dsc_t* dsc)
+{
+	png_dec_t* d = dsc->user_data;
+
+	(void) decoder;
+
+	if (d == NULL) return;
+	src_close(&d->src);
+	heap_caps_free(d->cur);
+	heap_caps_free(d->prev);
+	heap_caps_free(d->win);
+	heap_caps_free(d);
+	dsc->user_data = NULL;
+}
+
+
+// Read the chunks of a PNG up to its first IDAT, with s past the signature, loading
+// hdr and if given pal.  Images LittlevGL can't size and interlaced ones are refused.
+static bool png_header(src_t* s, png_hdr_t* hdr, uint8_t (*pal)[4])
+{
+	uint32_t len, type, i;
+	bool have_ihdr = false;
+
+	if (pal != NULL) {
+		for (i=0; i<256; i++) {
+			pal[i][0] = pal[i][1] = pal[i][2] = 0;
+			pal[i][3] = 0xFF;
+		}
+	}
+	memset(hdr, 0, sizeof(png_hdr_t));
+
+	while (true) {
+		hdr->idat_pos = s->pos;
+		len = src_u32(s);
+		type = src_u32(s);
+		if (s->pos > s->len) return false;
+
+		if (type == 0x49484452) {                       // IHDR
+			if (len < 13) return false;
+			hdr->w = src_u32(s);
+			hdr->h = src_u32(s);
+			hdr->depth = src_byte(s);
+			hdr->color_type = src_byte(s);
+			if ((src_byte(s) != 0) || (src_byte(s) != 0) || (src_byte(s) != 0)) return false;
+			if ((hdr->w == 0) || (hdr->h == 0) || (hdr->w > 2047) || (hdr->h > 2047)) return false;
+			switch (hdr->color_type) {
+				case 0:
+					if ((hdr->depth & (hdr->depth - 1)) || (hdr->depth > 16)) return false;
+					break;
+				case 3:
+					if ((hdr->depth & (hdr->depth - 1)) || (hdr->depth > 8)) return false;
+					break;
+				case 2:
+				case 4:
+				case 6:
+					if ((hdr->depth != 8) && (hdr->depth != 16)) return false;
+					break;
+				default:
+					return false;
+			}
+			have_ihdr = true;
+			len -= 13;
+		} else if (!have_ihdr) {
+			return false;
+		} else if (type == 0x49444154) {                // IDAT
+			return true;
+		} else if ((type == 0x504C5445) && (pal != NULL)) {    // PLTE
+			for (i=0; (i < len / 3) && (i < 256); i++) {
+				pal[i][0] = src_byte(s);
+				pal[i][1] = src_byte(s);
+				pal[i][2] = src_byte(s);
+			}
+			len -= i * 3;
+		} else if (type == 0x74524E53) {                // tRNS
+			hdr->trns = true;
+			if (hdr->color_type == 3) {
+				for (i=0; (i < len) && (i < 256); i++) {
+					if (pal != NULL) pal[i][3] = src_byte(s);
+					else (void) src_byte(s);
+				}
+				len -= i;
+			} else {
+				for (i=0; (i < len / 2) && (i < 3); i++) hdr->key[i] = src_u16(s);
+				len -= i * 2;
+			}
+		} else if (type == 0x49454E44) {                // IEND
+			return false;
+		}
+
+		// Skip the rest of the chunk and its CRC
+		s->pos += len + 4;
+	}
+}
+
+
+// Go back to the start of the image data
+static void png_restart(png_dec_t* d)
+{
+	d->src.pos = d->hdr.idat_pos;
+	d->chunk_left = 0;
+	d->mode = INF_HEADER;
+	d->last = false;
+	d->bits = 0;
+	d->num_bits = 0;
+	d->copy_len = 0;
+	d->win_pos = 0;
+	d->row_y = -1;
+}
+
+
+// Inflate and unfilter the next row into cur
+static bool png_row(png_dec_t* d)
+{
+	uint8_t* t = d->prev;
+	uint8_t* row;
+	const uint8_t* up;
+	int i, a, b, c, p, pa, pb, pc;
+
+	d->prev = d->cur;
+	d->cur = t;
+	if (inf_read(d, d->cur, d->row_len + 1) != d->row_len + 1) return false;
+
+	// The row above the first is all zeros
+	row = d->cur + 1;
+	up = d->prev + 1;
+	if (d->row_y < 0) memset(d->prev, 0, d->row_len + 1);
+
+	switch (d->cur[0]) {
+		case 0:
+			break;
+
+		case 1:
+			for (i=d->bpp; i<d->row_len; i++) row[i] += row[i - d->bpp];
+			break;
+
+		case 2:
+			for (i=0; i<d->row_len; i++) row[i] += up[i];
+			break;
+
+		case 3:
+			for (i=0; i<d->row_len; i++) {
+				a = (i >= d->bpp) ? row[i - d->bpp] : 0;
+				row[i] += (a + up[i]) >> 1;
+			}
+			break;
+
+		case 4:
+			for (i=0; i<d->row_len; i++) {
+				a = (i >= d->bpp) ? row[i - d->bpp] : 0;
+				b = up[i];
+				c = (i >= d->bpp) ? up[i - d->bpp] : 0;
+				p = a + b - c;
+				pa = (p > a) ? p - a : a - p;
+				pb = (p > b) ? p - b : b - p;
+				pc = (p > c) ? p - c : c - p;
+				row[i] += ((pa <= pb) && (pa <= pc)) ? a : (pb <= pc) ? b : c;
+			}
+			break;
+
+		default:
+			return false;
+	}
+	d->row_y++;
+	return true;
+}
+
+
+// Sample i of a row of depth bit samples
+static uint32_t png_sample(const uint8_t* row, uint32_t i, int depth)
+{
+	switch (depth) {
+		case 16:
+			return (row[i * 2] << 8) | row[i * 2 + 1];
+		case 8:
+			return row[i];
+		default:
+			return (row[(i * depth) >> 3] >> (8 - depth - ((i * depth) & 7))) & ((1 << depth) - 1);
+	}
+}
+
+
+// The same scaled to 8 bits
+static uint8_t png_sample8(const uint8_t* row, uint32_t i, int depth)
+{
+	if (depth == 16) return row[i * 2];
+	if (depth == 8) return row[i];
+	return png_sample(row, i, depth) * 255 / ((1 << depth) - 1);
+}
+
+
+// Next byte of the zlib stream the IDAT chunks hold between them, or -1 past its end
+static int idat_byte(png_dec_t* d)
+{
+	while (d->chunk_left == 0) {
+		if (d->src.pos != d->hdr.idat_pos) d->src.pos += 4;    // CRC
+		d->chunk_left = src_u32(&d->src);
+		if (src_u32(&d->src) != 0x49444154) return -1;
+	}
+	d->chunk_left--;
+	return src_byte(&d->src);
+}
+
+
+//
+// Inflate, after Mark Adler's puff
+//
+// Next n bits of the zlib stream, first bit lowest, or -1 past its end
+static int inf_bits(png_dec_t* d, int n)
+{
+	int b, v;
+
+	while (d->num_bits < n) {
+		if ((b = idat_byte(d)) < 0) return -1;
+		d->bits |= (uint32_t) b << d->num_bits;
+		d->num_bits += 8;
+	}
+	v = d->bits & ((1UL << n) - 1);
+	d->bits >>= n;
+	d->num_bits -= n;
+	return v;
+}
+
+
+// Decode a symbol with the canonical code of count codes of each length, or -1
+static int inf_decode(png_dec_t* d, const uint16_t* count, const uint16_t* sym)
+{
+	int code = 0, first = 0, index = 0, len, bit;
+
+	for (len=1; len<=MAX_BITS; len++) {
+		if ((bit = inf_bits(d, 1)) < 0) return -1;
+		code |= bit;
+		if (code - count[len] < first) return sym[index + (code - first)];
+		index += count[len];
+		first += count[len];
+		first <<= 1;
+		code <<= 1;
+	}
+	return -1;
+}
+
+
+// Build the canonical code of the n symbols' lengths, returning -1 if there are too
+// many codes of some length
+static int inf_build(uint16_t* count, uint16_t* sym, const uint8_t* lengths, int n)
+{
+	uint16_t offs[MAX_BITS + 1];
+	int left = 1, len, i;
+
+	memset(count, 0, (MAX_BITS + 1) * sizeof(uint16_t));
+	for (i=0; i<n; i++) count[lengths[i]]++;
+	if (count[0] == n) return 0;
+
+	for (len=1; len<=MAX_BITS; len++) {
+		left = (left << 1) - count[len];
+		if (left < 0) return -1;
+	}
+
+	offs[1] = 0;
+	for (len=1; len<MAX_BITS; len++) offs[len + 1] = offs[len] + count[len];
+	for (i=0; i<n; i++) {
+		if (lengths[i] != 0) sym[offs[lengths[i]]++] = i;
+	}
+	return left;
+}
+
+
+static bool inf_fixed(png_dec_t* d)
+{
+	uint8_t lengths[FIX_LCODES];
+	int i;
+
+	for (i=0; i<144; i++) lengths[i] = 8;
+	for (; i<256; i++) lengths[i] = 9;
+	for (; i<280; i++) lengths[i] = 7;
+	for (; i<FIX_LCODES; i++) lengths[i] = 8;
+	(void) inf_build(d->len_count, d->len_sym, lengths, FIX_LCODES);
+
+	for (i=0; i<MAX_DCODES; i++) lengths[i] = 5;
+	(void) inf_build(d->dist_count, d->dist_sym, lengths, MAX_DCODES);
+	return true;
+}
+
+
+// Read the code lengths of a dynamic block and build its codes
+static bool inf_dynamic(png_dec_t* d)
+{
+	uint8_t lengths[MAX_LCODES + MAX_DCODES];
+	int nlen, ndist, ncode, i, sym, len, rep;
+
+	nlen = inf_bits(d, 5) + 257;
+	ndist = inf_bits(d, 5) + 1;
+	ncode = inf_bits(d, 4) + 4;
+	if ((nlen > MAX_LCODES) || (ndist > MAX_DCODES) || (ncode < 4)) return false;
+
+	memset(lengths, 0, 19);
+	for (i=0; i<ncode; i++) {
+		if ((sym = inf_bits(d, 3)) < 0) return false;
+		lengths[CLEN_ORDER[i]] = sym;
+	}
+	if (inf_build(d->len_count, d->len_sym, lengths, 19) != 0) return false;
+
+	i = 0;
+	while (i < nlen + ndist) {
+		if ((sym = inf_decode(d, d->len_count, d->len_sym)) < 0) return false;
+		if (sym < 16) {
+			lengths[i++] = sym;
+			continue;
+		}
+		len = 0;
+		if (sym == 16) {
+			if (i == 0) return false;
+			len = lengths[i - 1];
+			rep = 3 + inf_bits(d, 2);
+		} else if (sym == 17) {
+			rep = 3 + inf_bits(d, 3);
+		} else {
+			rep = 11 + inf_bits(d, 7);
+		}
+		if ((rep < 3) || (i + rep > nlen + ndist)) return false;
+		while (rep--) lengths[i++] = len;
+	}
+	if (lengths[256] == 0) return false;
+
+	return (inf_build(d->len_count, d->len_sym, lengths, nlen) >= 0) &&
+		(inf_build(d->dist_count, d->dist_sym, &lengths[nlen], ndist) >= 0);
+}
+
+
+// Inflate up to len bytes into out, stopping part way through a block or match when
+// out is full, and returning the bytes inflated or -1 on an error
+static int inf_read(png_dec_t* d, uint8_t* out, int len)
+{
+	uint8_t c;
+	int n = 0, sym, v;
+
+	while (n < len) {
+		if (d->copy_len > 0) {
+			while ((d->copy_len > 0) && (n < len)) {
+				c = d->win[(d->win_pos - d->copy_dist) & d->win_mask];
+				d->win[d->win_pos++ & d->win_mask] = c;
+				out[n++] = c;
+				d->copy_len--;
+			}
+			continue;
+		}
+
+		switch (d->mode) {
+			case INF_HEADER:
+				// Deflate, with no preset dictionary
+				v = inf_bits(d, 16);
+				if ((v < 0) || ((v & 0x0F) != 8) || (v & 0x2000) ||
+					((((v & 0xFF) << 8) | (v >> 8)) % 31 != 0)) return -1;
+				d->mode = INF_BLOCK;
+				break;
+
+			case INF_BLOCK:
+				if (d->last) {
+					d->mode = INF_DONE;
+					break;
+				}
+				d->last = (inf_bits(d, 1) == 1);
+				v = inf_bits(d, 2);
+				if (v == 0) {
+					d->bits >>= d->num_bits & 7;
+					d->num_bits &= ~7;
+					d->stored_left = inf_bits(d, 16);
+					if ((inf_bits(d, 16) ^ 0xFFFF) != d->stored_left) return -1;
+					d->mode = INF_STORED;
+				} else if (v == 1) {
+					if (!inf_fixed(d)) return -1;
+					d->mode = INF_HUFF;
+				} else if (v == 2) {
+					if (!inf_dynamic(d)) return -1;
+					d->mode = INF_HUFF;
+				} else {
+					return -1;
+				}
+				break;
+
+			case INF_STORED:
+				if (d->stored_left == 0) {
+					d->mode = INF_BLOCK;
+					break;
+				}
+				if ((v = inf_bits(d, 8)) < 0) return -1;
+				d->win[d->win_pos++ & d->win_mask] = v;
+				out[n++] = v;
+				d->stored_left--;
+				break;
+
+			case INF_HUFF:
+				sym = inf_decode(d, d->len_count, d->len_sym);
+				if (sym < 0) return -1;
+				if (sym < 256) {
+					d->win[d->win_pos++ & d->win_mask] = sym;
+					out[n++] = sym;
+				} else if (sym == 256) {
+					d->mode = INF_BLOCK;
+				} else {
+					sym -= 257;
+					if (sym >= 29) return -1;
+					if ((v = inf_bits(d, LEN_EXTRA[sym])) < 0) return -1;
+					d->copy_len = LEN_BASE[sym] + v;
+					sym = inf_decode(d, d->dist_count, d->dist_sym);
+					if ((sym < 0) || (sym >= 30)) return -1;
+					if ((v = inf_bits(d, DIST_EXTRA[sym])) < 0) return -1;
+					d->copy_dist = DIST_BASE[sym] + v;
+					if ((d->copy_dist > d->win_pos) || (d->copy_dist > d->win_mask + 1)) return -1;
+				}
+				break;
+
+			default:
+				// The image needs more than the stream holds
+				return -1;
+		}
+	}
+	return n;
+}
+
+
+//
+// JPEG decoder
+//
+static lv_res_t jpg_info(lv_img_decoder_t* decoder, const void* src, lv_img_header_t* header)
+{
+	jpg_dec_t* d;
+	bool ok;
+
+	(void) decoder;
+
+	// Too big for the stack, with its tables
+	if ((d = dec_alloc(sizeof(jpg_dec_t))) == NULL) return LV_RES_INV;
+	ok = src_open(&d->src, src, FORMAT_JPG);
+	if (ok) {
+		ok = jpg_header(d, false);
+		src_close(&d->src);
+	}
+	header->always_zero = 0;
+	header->w = d->w;
+	header->h = d->h;
+	header->cf = LV_IMG_CF_TRUE_COLOR;
+	heap_caps_free(d);
+	return ok ? LV_RES_OK : LV_RES_INV;
+}
+
+
+static lv_res_t jpg_open(lv_img_decoder_t* decoder, lv_img_decoder_dsc_t* dsc)
+{
+	jpg_dec_t* d;
+	jpg_comp_t* c;
+	int i;
+
+	(void) decoder;
+
+	if ((d = dec_alloc(sizeof(jpg_dec_t))) == NULL) return LV_RES_INV;
+	memset(d, 0, sizeof(jpg_dec_t));
+	dsc->user_data = d;
+
+	if (!src_open(&d->src, dsc->src, FORMAT_JPG) || !jpg_header(d, true)) {
+		jpg_close(decoder, dsc);
+		return LV_RES_INV;
+	}
+
+	for (i=0; i<d->num_comps; i++) {
+		c = &d->comp[i];
+		c->stride = d->mcus_x * c->h * 8;
+		if ((c->plane = dec_alloc(c->stride * c->v * 8)) == NULL) {
+			jpg_close(decoder, dsc);
+			return LV_RES_INV;
+		}
+	}
+
+	jpg_restart(d);
+	return LV_RES_OK;
+}
+
+
+static lv_res_t jpg_read_line(lv_img_decoder_t* decoder, lv_img_decoder_dsc_t* dsc, lv_coord_t x,
+	lv_coord_t y, lv_coord_t len, uint8_t* buf)
+{
+	jpg_dec_t* d = dsc->user_data;
+	const uint8_t* rows[3];
+	int mcu_row = y / (d->v_max * 8);
+	int ry = y % (d->v_max * 8);
+	int i, yy, cb, cr;
+
+	(void) decoder;
+
+	if (mcu_row != d->held_row) {
+		if (mcu_row < d->next_row) jpg_restart(d);
+		while (d->next_row <= mcu_row) {
+			if (!jpg_mcu_row(d)) {
+				jpg_restart(d);
+				return LV_RES_INV;
+			}
+			d->next_row++;
+		}
+		d->held_row = mcu_row;
+	}
+
+	for (i=0; i<d->num_comps; i++) {
+		rows[i] = d->comp[i].plane + (ry * d->comp[i].v / d->v_max) * d->comp[i].stride;
+	}
+
+	if (d->num_comps == 1) {
+		for (i=x; i<x+len; i++) put_px(&buf, rows[0][i], rows[0][i], rows[0][i]);
+		return LV_RES_OK;
+	}
+
+	// Nearest chroma samples, converted as JFIF specifies
+	for (i=x; i<x+len; i++) {
+		yy = rows[0][i * d->comp[0].h / d->h_max] << 16;
+		cb = rows[1][i * d->comp[1].h / d->h_max] - 128;
+		cr = rows[2][i * d->comp[2].h / d->h_max] - 128;
+		put_px(&buf, LV_MATH_MIN(LV_MATH_MAX((yy + 91881 * cr + 32768) >> 16, 0), 255),
+			LV_MATH_MIN(LV_MATH_MAX((yy - 22554 * cb - 46802 * cr + 32768) >> 16, 0), 255),
+			LV_MATH_MIN(LV_MATH_MAX((yy + 116130 * cb + 32768) >> 16, 0), 255));
+	}
+	return LV_RES_OK;
+}
+
+
+static void jpg_close(lv_img_decoder_t* decoder, lv_img_decoder_dsc_t* dsc)
+{
+	jpg_dec_t* d = dsc->user_data;
+	int i;
+
+	(void) decoder;
+
+	if (d == NULL) return;
+	src_close(&d->src);
+	for (i=0; i<3; i++) heap_caps_free(d->comp[i].plane);
+	heap_caps_free(d);
+	dsc->user_data = NULL;
+}
+
+
+// Read the markers of a JPEG up to its frame header, or with tables, up to its first
+// scan, with the source past the SOI marker.  Only baseline and extended sequential
+// Huffman coded frames of grey or YCbCr 8-bit samples are accepted, in a single scan.
+static bool jpg_header(jpg_dec_t* d, bool tables)
+{
+	src_t* s = &d->src;
+	jpg_huff_t* h;
+	jpg_comp_t* c;
+	uint32_t len, end, total;
+	int m, i, j, v;
+
+	d->num_comps = 0;
+	d->restart_interval = 0;
+	s->pos = 2;
+
+	while (true) {
+		// Markers may be padded with 0xFF
+		if (src_byte(s) != 0xFF) return false;
+		while ((m = src_byte(s)) == 0xFF);
+		if ((m < 0) || (m == 0xD9)) return false;
+		len = src_u16(s);
+		if (len < 2) return false;
+		end = s->pos + len - 2;
+
+		if ((m == 0xC0) || (m == 0xC1)) {
+			if (src_byte(s) != 8) return false;
+			d->h = src_u16(s);
+			d->w = src_u16(s);
+			d->num_comps = src_byte(s);
+			if ((d->w == 0) || (d->h == 0) || (d->w > 2047) || (d->h > 2047)) return false;
+			if ((d->num_comps != 1) && (d->num_comps != 3)) return false;
+			if (!tables) return true;
+
+			d->h_max = 1;
+			d->v_max = 1;
+			for (i=0; i<d->num_comps; i++) {
+				c = &d->comp[i];
+				c->id = src_byte(s);
+				v = src_byte(s);
+				c->tq = src_byte(s) & 3;
+				c->h = v >> 4;
+				c->v = v & 0x0F;
+				if ((c->h < 1) || (c->h > 4) || (c->v < 1) || (c->v > 4)) return false;
+				// A lone component's blocks are its MCUs, whatever its sampling
+				if (d->num_comps == 1) c->h = c->v = 1;
+				d->h_max = LV_MATH_MAX(d->h_max, c->h);
+				d->v_max = LV_MATH_MAX(d->v_max, c->v);
+			}
+			d->mcus_x = (d->w + d->h_max * 8 - 1) / (d->h_max * 8);
+		} else if ((m >= 0xC2) && (m <= 0xCF) && (m != 0xC4) && (m != 0xC8) && (m != 0xCC)) {
+			// Progressive, lossless or arithmetic coded
+			return false;
+		} else if (!tables) {
+			// Only the frame header is wanted
+		} else if (m == 0xDB) {
+			while (s->pos < end) {
+				v = src_byte(s);
+				if ((v & 0x0F) > 3) return false;
+				for (i=0; i<64; i++) {
+					d->qt[v & 3][i] = (v >> 4) ? src_u16(s) : src_byte(s);
+				}
+			}
+		} else if (m == 0xC4) {
+			while (s->pos < end) {
+				v = src_byte(s);
+				if (((v & 0x0F) > 3) || (v >> 4 > 1)) return false;
+				h = (v >> 4) ? &d->ac[v & 3] : &d->dc[v & 3];
+				h->count[0] = 0;
+				for (i=1, total=0; i<=16; i++) {
+					h->count[i] = src_byte(s);
+					total += h->count[i];
+				}
+				if (total > 256) return false;
+				for (i=0; i<total; i++) h->sym[i] = src_byte(s);
+			}
+		} else if (m == 0xDD) {
+			d->restart_interval = src_u16(s);
+		} else if (m == 0xDA) {
+			if ((d->num_comps == 0) || (src_byte(s) != d->num_comps)) return false;
+			for (i=0; i<d->num_comps; i++) {
+				v = src_byte(s);
+				for (j=0; (j < d->num_comps) && (d->comp[j].id != v); j++);
+				if (j != i) return false;
+				v = src_byte(s);
+				d->comp[i].td = (v >> 4) & 3;
+				d->comp[i].ta = v & 3;
+			}
+			s->pos = end;
+			d->scan_pos = end;
+			return (s->pos <= s->len);
+		}
+		s->pos = end;
+		if (s->pos > s->len) return false;
+	}
+}
+
+
+// Go back to the start of the scan
+static void jpg_restart(jpg_dec_t* d)
+{
+	int i;
+
+	d->src.pos = d->scan_pos;
+	d->bits = 0;
+	d->num_bits = 0;
+	d->marker = 0;
+	d->restart_left = d->restart_interval;
+	for (i=0; i<d->num_comps; i++) d->comp[i].dc_pred = 0;
+	d->next_row = 0;
+	d->held_row = -1;
+}
+
+
+// Next byte of entropy coded data, or zeros once a marker has been read
+static int jpg_byte(jpg_dec_t* d)
+{
+	int b, m;
+
+	if (d->marker != 0) return 0;
+	b = src_byte(&d->src);
+	if (b == 0xFF) {
+		while ((m = src_byte(&d->src)) == 0xFF);
+		if (m == 0) return 0xFF;
+		d->marker = (m < 0) ? 0xD9 : m;
+		return 0;
+	}
+	if (b < 0) {
+		d->marker = 0xD9;
+		return 0;
+	}
+	return b;
+}
+
+
+// Next n bits, first bit highest
+static int jpg_bits(jpg_dec_t* d, int n)
+{
+	int v;
+
+	if (n == 0) return 0;
+	while (d->num_bits < n) {
+		d->bits |= (uint32_t) jpg_byte(d) << (24 - d->num_bits);
+		d->num_bits += 8;
+	}
+	v = d->bits >> (32 - n);
+	d->bits <<= n;
+	d->num_bits -= n;
+	return v;
+}
+
+
+// Decode a symbol, or return -1
+static int jpg_decode(jpg_dec_t* d, const jpg_huff_t* h)
+{
+	int code = 0, first = 0, index = 0, len;
+
+	for (len=1; len<=16; len++) {
+		code |= jpg_bits(d, 1);
+		if (code - h->count[len] < first) return h->sym[index + (code - first)];
+		index += h->count[len];
+		first += h->count[len];
+		first <<= 1;
+		code <<= 1;
+	}
+	return -1;
+}
+
+
+// Decode and dequantize one block of c's coefficients into coef
+static bool jpg_block(jpg_dec_t* d, jpg_comp_t* c, int* coef)
+{
+	const uint16_t* q = d->qt[c->tq];
+	int k, rs, s, v;
+
+	memset(coef, 0, 64 * sizeof(int));
+
+	if (((s = jpg_decode(d, &d->dc[c->td])) < 0) || (s > 16)) return false;
+	v = jpg_bits(d, s);
+	if ((s != 0) && (v < (1 << (s - 1)))) v -= (1 << s) - 1;
+	c->dc_pred += v;
+	coef[0] = c->dc_pred * q[0];
+
+	for (k=1; k<64; ) {
+		if ((rs = jpg_decode(d, &d->ac[c->ta])) < 0) return false;
+		s = rs & 0x0F;
+		if (s == 0) {
+			if (rs != 0xF0) break;
+			k += 16;
+			continue;
+		}
+		k += rs >> 4;
+		if (k > 63) return false;
+		v = jpg_bits(d, s);
+		if (v < (1 << (s - 1))) v -= (1 << s) - 1;
+		coef[DEZIGZAG[k]] = v * q[k];
+		k++;
+	}
+	return true;
+}
+
+
+// Decode the next row of MCUs into the component planes
+static bool jpg_mcu_row(jpg_dec_t* d)
+{
+	int coef[64];
+	jpg_comp_t* c;
+	int mx, i, bx, by;
+
+	for (mx=0; mx<d->mcus_x; mx++) {
+		if (d->restart_interval != 0) {
+			if (d->restart_left == 0) {
+				// Skip to the marker, which must be the next restart
+				while (d->marker == 0) (void) jpg_byte(d);
+				if ((d->marker < 0xD0) || (d->marker > 0xD7)) return false;
+				d->bits = 0;
+				d->num_bits = 0;
+				d->marker = 0;
+				for (i=0; i<d->num_comps; i++) d->comp[i].dc_pred = 0;
+				d->restart_left = d->restart_interval;
+			}
+			d->restart_left--;
+		}
+
+		for (i=0; i<d->num_comps; i++) {
+			c = &d->comp[i];
+			for (by=0; by<c->v; by++) {
+				for (bx=0; bx<c->h; bx++) {
+					if (!jpg_block(d, c, coef)) return false;
+					jpg_idct(coef, c->plane + by * 8 * c->stride + (mx * c->h + bx) * 8, c->stride);
+				}
+			}
+		}
+	}
+	return true;
+}
+
+
+// Inverse DCT of a block into 8 rows of out, columns then rows, in the integer
+// arithmetic of the IJG's islow method
+static void jpg_idct(int* coef, uint8_t* out, int stride)
+{
+	int tmp[64], o[8];
+	int i, j, v;
+
+	for (i=0; i<8; i++) {
+		if ((coef[i + 8] | coef[i + 16] | coef[i + 24] | coef[i + 32] | coef[i + 40] |
+			coef[i + 48] | coef[i + 56]) == 0) {
+			// Flat column, which most are
+			for (j=0; j<8; j++) tmp[j * 8 + i] = coef[i] * 4;
+		} else {
+			idct_1d(&coef[i], 8, o);
+			for (j=0; j<8; j++) tmp[j * 8 + i] = (o[j] + 512) >> 10;
+		}
+	}
+
+	for (i=0; i<8; i++) {
+		idct_1d(&tmp[i * 8], 1, o);
+		for (j=0; j<8; j++) {
+			// Undo the scaling, round and level shift
+			v = (o[j] + 65536 + (128 << 17)) >> 17;
+			out[j] = (v < 0) ? 0 : (v > 255) ? 255 : v;
+		}
+		out += stride;
+	}
+}
+
+
+// One dimension of the inverse DCT of the 8 values step apart from s, into o scaled
+// up by 4096
+static void idct_1d(const int* s, int step, int* o)
+{
+	int t0, t1, t2, t3, p1, p2, p3, p4, p5, x0, x1, x2, x3;
+
+	// Even part
+	p2 = s[2 * step];
+	p3 = s[6 * step];
+	p1 = (p2 + p3) * FIX(0.5411961);
+	t2 = p1 + p3 * FIX(-1.847759065);
+	t3 = p1 + p2 * FIX(0.765366865);
+	t0 = (s[0] + s[4 * step]) * 4096;
+	t1 = (s[0] - s[4 * step]) * 4096;
+	x0 = t0 + t3;
+	x3 = t0 - t3;
+	x1 = t1 + t2;
+	x2 = t1 - t2;
+
+	// Odd part
+	t0 = s[7 * step];
+	t1 = s[5 * step];
+	t2 = s[3 * step];
+	t3 = s[step];
+	p3 = t0 + t2;
+	p4 = t1 + t3;
+	p1 = t0 + t3;
+	p2 = t1 + t2;
+	p5 = (p3 + p4) * FIX(1.175875602);
+	t0 = t0 * FIX(0.298631336);
+	t1 = t1 * FIX(2.053119869);
+	t2 = t2 * FIX(3.072711026);
+	t3 = t3 * FIX(1.501321110);
+	p1 = p5 + p1 * FIX(-0.899976223);
+	p2 = p5 + p2 * FIX(-2.562915447);
+	p3 = p3 * FIX(-1.961570560);
+	p4 = p4 * FIX(-0.390180644);
+	t3 += p1 + p4;
+	t2 += p2 + p3;
+	t1 += p2 + p4;
+	t0 += p1 + p3;
+
+	o[0] = x0 + t3;
+	o[7] = x0 - t3;
+	o[1] = x1 + t2;
+	o[6] = x1 - t2;
+	o[2] = x2 + t1;
+	o[5] = x2 - t1;
+	o[3] = x3 + t0;
+	o[4] = x3 - t0;
+}
+
+
+//
+// Sources
+//
+static format_t src_format(const uint8_t* data, uint32_t len)
+{
+	if ((len >= sizeof(PNG_SIGNATURE)) && (memcmp(data, PNG_SIGNATURE, sizeof(PNG_SIGNATURE)) == 0)) {
+		return FORMAT_PNG;
+	}
+	if ((len >= sizeof(JPG_SIGNATURE)) && (memcmp(data, JPG_SIGNATURE, sizeof(JPG_SIGNATURE)) == 0)) {
+		return FORMAT_JPG;
+	}
+	return FORMAT_NONE;
+}
+
+
+// Open src if it's an image of format, a variable holding the file or a file named
+// for it, leaving s past the signature
+static bool src_open(src_t* s, const void* src, format_t format)
+{
+	const lv_img_dsc_t* img = src;
+	uint32_t sig_len = (format == FORMAT_PNG) ? sizeof(PNG_SIGNATURE) : 2;
+
+	s->data = NULL;
+	s->len = 0;
+	s->pos = sig_len;
+#if LV_USE_FILESYSTEM
+	s->opened = false;
+#endif
+
+	if (lv_img_src_get_type(src) == LV_IMG_SRC_VARIABLE) {
+		if ((img->header.cf < LV_IMG_CF_RAW) || (img->header.cf > LV_IMG_CF_RAW_CHROMA_KEYED) ||
+			(src_format(img->data, img->data_size) != format)) {
+			return false;
+		}
+		s->data = img->data;
+		s->len = img->data_size;
+		return true;
+	}
+
+#if LV_USE_FILESYSTEM
+	const char* ext;
+	uint8_t sig[sizeof(PNG_SIGNATURE)];
+	uint32_t br;
+
+	if (lv_img_src_get_type(src) != LV_IMG_SRC_FILE) return false;
+	ext = lv_fs_get_ext(src);
+	if (format == FORMAT_PNG) {
+		if (strcasecmp(ext, "png") != 0) return false;
+	} else if ((strcasecmp(ext, "jpg") != 0) && (strcasecmp(ext, "jpeg") != 0)) {
+		return false;
+	}
+
+	if (lv_fs_open(&s->file, src, LV_FS_MODE_RD) != LV_FS_RES_OK) return false;
+	s->opened = true;
+	if ((lv_fs_size(&s->file, &s->len) != LV_FS_RES_OK) ||
+		(lv_fs_read(&s->file, sig, sizeof(sig), &br) != LV_FS_RES_OK) || (src_format(sig, br) != format)) {
+		src_close(s);
+		return false;
+	}
+	s->buf_start = 0;
+	s->buf_len = 0;
+	return true;
+#else
+	return false;
+#endif
+}
+
+
+static void src_close(src_t* s)
+{
+#if LV_USE_FILESYSTEM
+	if (s->opened) {
+		(void) lv_fs_close(&s->file);
+		s->opened = false;
+	}
+#endif
+}
+
+
+// Byte at s->pos and move past it, or -1 past the end
+static int src_byte(src_t* s)
+{
+	if (s->pos >= s->len) {
+		s->pos++;
+		return -1;
+	}
+	if (s->data != NULL) return s->data[s->pos++];
+
+#if LV_USE_FILESYSTEM
+	uint32_t br;
+
+	if ((s->pos < s->buf_start) || (s->pos >= s->buf_start + s->buf_len)) {
+		if ((s->pos != s->buf_start + s->buf_len) && (lv_fs_seek(&s->file, s->pos) != LV_FS_RES_OK)) return -1;
+		if ((lv_fs_read(&s->file, s->buf, READ_BUF_LEN, &br) != LV_FS_RES_OK) || (br == 0)) return -1;
+		s->buf_start = s->pos;
+		s->buf_len = br;
+	}
+	return s->buf[s->pos++ - s->buf_start];
+#else
+	return -1;
+#endif
+}
+
+
+static uint32_t src_u16(src_t* s)
+{
+	uint32_t v = (src_byte(s) & 0xFF) << 8;
+
+	return v | (src_byte(s) & 0xFF);
+}
+
+
+static uint32_t src_u32(src_t* s)
+{
+	uint32_t v = src_u16(s) << 16;
+
+	return v | src_u16(s);
+}
+
+
+// Decoder state and buffers go in PSRAM when there is some
+static void* dec_alloc(uint32_t len)
+{
+	void* p = heap_caps_malloc(len, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+
+	return (p != NULL) ? p : heap_caps_malloc(len, MALLOC_CAP_8BIT);
+}
+
+
+// Store a pixel as LittlevGL's colour and move buf past it
+static void put_px(uint8_t** buf, uint8_t r, uint8_t g, uint8_t b)
+{
+	lv_color_t c = lv_color_make(r, g, b);
+
+	memcpy(*buf, &c, sizeof(lv_color_t));
+	*buf += sizeof(lv_color_t);
+}
+
+#endif /* WS_DRIVER_IMG_DEC */
@@ -0,0 +1,37 @@
+/**
+* Streaming PNG and JPEG image decoders for the LittleVGL websocket driver
+*
+* Registers decoders with LittlevGL for PNG images and baseline JPEG photos, given
+* either as files (".png", ".jpg" or ".jpeg" on any lv_fs drive) or as lv_img_dsc_t
+* variables of colour format LV_IMG_CF_RAW holding the file as it is.  Images are
+* decoded a line at a time, so the image cache decodes each one once into its own
+* bounded memory and only the compressed file has to be kept in flash.
+*
+*/
+#ifndef IMG_DEC_H
+#define IMG_DEC_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*********************
+ *      INCLUDES
+ *********************/
+#include <stdint.h>
+#include <stdbool.h>
+#include "lvgl/lvgl.h"
+
+
+/**********************
+ * GLOBAL PROTOTYPES
+ **********************/
+bool img_dec_init();
+bool img_dec_is_encoded(const uint8_t* data, uint32_t len);
+
+
+#ifdef __cplusplus
+} /* extern "C" */
+#endif
+
+#endif /* IMG_DEC_H */
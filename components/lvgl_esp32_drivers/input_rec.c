@@ -0,0 +1,391 @@
+/**
+* Pointer input recorder for the LittleVGL websocket driver
+*
+* The websocket server task records events as they arrive and the LVGL task takes
+* them back out during a replay, with the state guarded by a spinlock.  Downloads
+* and uploads run in an HTTP handler task and hold the recorder busy rather than the
+* lock while they use the network, so neither recording nor replay can start then.
+*
+* Times are LittleVGL ticks since recording started.  A replay hands each event to
+* LittleVGL once that long has passed since the replay started, so presses and drags
+* land on the same frames as closely as the pointer read period allows.  Replays
+* are only deterministic from the same starting screen, so restart the board or
+* return to the same screen before each run.
+*
+*/
+
+/*********************
+ *      INCLUDES
+ *********************/
+#include "input_rec.h"
+#include "websocket_driver.h"
+#include "lvgl/lvgl.h"
+#include "esp_log.h"
+#include "esp_heap_caps.h"
+#include "freertos/FreeRTOS.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+
+/*********************
+ *      DEFINES
+ *********************/
+// Longest line of an upload, longer ones are skipped
+#define LINE_LEN        48
+
+// Size of the buffer each part of a download is formatted into, and the most one
+// event can take
+#define CHUNK_LEN       1024
+#define EVENT_TEXT_LEN  32
+
+// How long an upload waits for each part of its body
+#define UPLOAD_WAIT_MS  1000
+
+
+/**********************
+ *      TYPEDEFS
+ **********************/
+typedef enum
+{
+	REC_IDLE,
+	REC_RECORDING,
+	REC_REPLAYING,
+	REC_BUSY          // Being downloaded or uploaded
+} rec_state_t;
+
+typedef struct
+{
+	uint32_t time;    // mS from the start of the recording
+	uint16_t x;
+	uint16_t y;
+	uint8_t flag;     // 0 released, otherwise pressed
+} input_event_t;
+
+
+/**********************
+ *  STATIC VARIABLES
+ **********************/
+static const char* TAG = "input_rec";
+
+static input_event_t* events = NULL;
+static uint32_t max_events;
+static uint32_t num_events = 0;
+static uint32_t pos = 0;                // Next event to replay
+static uint32_t start;                  // lv_tick_get() when recording or replay started
+static rec_state_t state = REC_IDLE;
+static portMUX_TYPE rec_mux = portMUX_INITIALIZER_UNLOCKED;
+
+
+/**********************
+ *  STATIC PROTOTYPES
+ **********************/
+static bool rec_begin(rec_state_t from, rec_state_t to);
+static bool rec_parse(const char* line, input_event_t* e);
+static void rec_reply(struct netconn* conn, const char* status, const char* text);
+
+
+/**********************
+ *   GLOBAL FUNCTIONS
+ **********************/
+// Allocate room for num_events events, in PSRAM when the board has it
+bool input_rec_init(uint32_t num)
+{
+	uint32_t caps = MALLOC_CAP_8BIT;
+
+	if (heap_caps_get_free_size(MALLOC_CAP_SPIRAM) > 0) {
+		caps |= MALLOC_CAP_SPIRAM;
+	}
+	events = heap_caps_malloc(num * sizeof(input_event_t), caps);
+	if (events == NULL) {
+		ESP_LOGE(TAG, "Could not allocate %u input events", num);
+		return false;
+	}
+	max_events = num;
+	return true;
+}
+
+
+// Discard the recording and start a new one.  Fails while replaying or busy.
+bool input_rec_record()
+{
+	bool ok;
+
+	portENTER_CRITICAL(&rec_mux);
+	ok = (events != NULL) && ((state == REC_IDLE) || (state == REC_RECORDING));
+	if (ok) {
+		num_events = 0;
+		start = lv_tick_get();
+		state = REC_RECORDING;
+	}
+	portEXIT_CRITICAL(&rec_mux);
+
+	if (ok) ESP_LOGI(TAG, "Recording");
+	return ok;
+}
+
+
+// Start replaying the recording from the beginning, in place of live input.  Fails
+// when there's nothing recorded or while busy.
+bool input_rec_replay()
+{
+	bool ok;
+
+	portENTER_CRITICAL(&rec_mux);
+	ok = (num_events > 0) && (state != REC_BUSY);
+	if (ok) {
+		pos = 0;
+		start = lv_tick_get();
+		state = REC_REPLAYING;
+	}
+	portEXIT_CRITICAL(&rec_mux);
+
+	if (ok) {
+		ESP_LOGI(TAG, "Replaying %u events over %u mS", num_events, events[num_events - 1].time);
+		websocket_driver_wake();
+	}
+	return ok;
+}
+
+
+// Stop recording or replaying
+void input_rec_stop()
+{
+	portENTER_CRITICAL(&rec_mux);
+	if ((state == REC_RECORDING) || (state == REC_REPLAYING)) {
+		state = REC_IDLE;
+	}
+	portEXIT_CRITICAL(&rec_mux);
+}
+
+
+// Record a pointer event received from a browser.  Returns false while a replay is
+// running, when live input should be ignored.
+bool input_rec_pointer(uint8_t flag, uint16_t x, uint16_t y)
+{
+	input_event_t* e;
+	bool live = true;
+	bool full = false;
+
+	portENTER_CRITICAL(&rec_mux);
+	if (state == REC_RECORDING) {
+		if (num_events < max_events) {
+			e = &events[num_events++];
+			e->time = lv_tick_elaps(start);
+			e->x = x;
+			e->y = y;
+			e->flag = flag;
+		} else {
+			state = REC_IDLE;
+			full = true;
+		}
+	} else if (state == REC_REPLAYING) {
+		live = false;
+	}
+	portEXIT_CRITICAL(&rec_mux);
+
+	if (full) ESP_LOGW(TAG, "Recording full after %u events, stopped", max_events);
+	return live;
+}
+
+
+// Returns the time in mS until the next replayed event is due, UINT32_MAX when not
+// replaying
+uint32_t input_rec_wait()
+{
+	uint32_t wait = UINT32_MAX;
+	uint32_t elapsed;
+
+	portENTER_CRITICAL(&rec_mux);
+	if (state == REC_REPLAYING) {
+		elapsed = lv_tick_elaps(start);
+		wait = (events[pos].time > elapsed) ? events[pos].time - elapsed : 0;
+	}
+	portEXIT_CRITICAL(&rec_mux);
+
+	return wait;
+}
+
+
+// Load the next replayed event if it is due, returning true while more are due.  The
+// values are left alone when none is, and the replay ends after its last event.
+bool input_rec_next(uint8_t* flag, uint16_t* x, uint16_t* y)
+{
+	const input_event_t* e;
+	bool more = false;
+	bool done = false;
+
+	portENTER_CRITICAL(&rec_mux);
+	if ((state == REC_REPLAYING) && (events[pos].time <= lv_tick_elaps(start))) {
+		e = &events[pos++];
+		*flag = e->flag;
+		*x = e->x;
+		*y = e->y;
+		if (pos == num_events) {
+			state = REC_IDLE;
+			done = true;
+		} else {
+			more = (events[pos].time <= lv_tick_elaps(start));
+		}
+	}
+	portEXIT_CRITICAL(&rec_mux);
+
+	if (done) ESP_LOGI(TAG, "Replay done after %u mS", lv_tick_elaps(start));
+	return more;
+}
+
+
+// Send the recording on conn as a text download
+void input_rec_write(struct netconn* conn)
+{
+	const static char HEADER[] = "HTTP/1.1 200 OK\r\nContent-Type: text/plain\r\n"
+		"Content-Disposition: attachment; filename=\"input.txt\"\r\nCache-Control: no-store\r\n"
+		"Connection: close\r\n\r\n# mS flag x y\n";
+	char* buf;
+	uint32_t i;
+	int n = 0;
+
+	buf = malloc(CHUNK_LEN);
+	if ((buf == NULL) || !rec_begin(REC_IDLE, REC_BUSY)) {
+		free(buf);
+		rec_reply(conn, "409 Conflict", "Stop recording or replaying first\n");
+		return;
+	}
+
+	netconn_write(conn, HEADER, sizeof(HEADER) - 1, NETCONN_NOCOPY);
+	for (i=0; i<num_events; i++) {
+		if (n > (CHUNK_LEN - EVENT_TEXT_LEN)) {
+			netconn_write(conn, buf, n, NETCONN_COPY);
+			n = 0;
+		}
+		n += sprintf(&buf[n], "%u %u %u %u\n", events[i].time, events[i].flag, events[i].x, events[i].y);
+	}
+	if (n > 0) {
+		netconn_write(conn, buf, n, NETCONN_COPY);
+	}
+
+	(void) rec_begin(REC_BUSY, REC_IDLE);
+	free(buf);
+}
+
+
+// Replace the recording with the text uploaded in the body of the request req, parsed
+// from the first len bytes received from conn, in buf
+void input_rec_read(struct netconn* conn, const ws_request_t* req, const char* buf, uint16_t len)
+{
+	struct netbuf* inbuf = NULL;
+	input_event_t e;
+	char line[LINE_LEN];
+	char text[64];
+	const char* p;
+	char* data;
+	uint16_t datalen;
+	uint32_t content_len, received;
+	uint32_t n = 0;
+	uint32_t last = 0;
+	int line_len = 0;
+	bool ok = true;
+
+	if ((req->content_len == 0) || (req->body == NULL)) {
+		rec_reply(conn, "411 Length Required", "");
+		return;
+	}
+	content_len = req->content_len;
+	if (!rec_begin(REC_IDLE, REC_BUSY)) {
+		rec_reply(conn, "409 Conflict", "Stop recording or replaying first\n");
+		return;
+	}
+
+	// Parse the body a line at a time as its parts arrive
+	data = (char*) req->body;
+	datalen = len - (req->body - buf);
+	received = 0;
+	netconn_set_recvtimeout(conn, UPLOAD_WAIT_MS);
+	for (;;) {
+		for (p=data; (p < data + datalen) && (received < content_len); p++, received++) {
+			if (*p != '\n') {
+				if (line_len < (LINE_LEN - 1)) line[line_len++] = *p;
+				continue;
+			}
+			line[line_len] = '\0';
+			line_len = 0;
+			if (!rec_parse(line, &e)) continue;
+			if ((e.time < last) || (n == max_events)) {
+				ok = false;
+				continue;
+			}
+			events[n++] = e;
+			last = e.time;
+		}
+		if (inbuf) netbuf_delete(inbuf);
+		inbuf = NULL;
+		if (received >= content_len) break;
+		if (netconn_recv(conn, &inbuf) != ERR_OK) {
+			ok = false;
+			break;
+		}
+		netbuf_data(inbuf, (void**)&data, &datalen);
+	}
+	if (inbuf) netbuf_delete(inbuf);
+	if (line_len > 0) {
+		line[line_len] = '\0';
+		if (rec_parse(line, &e) && (e.time >= last) && (n < max_events)) {
+			events[n++] = e;
+		}
+	}
+
+	num_events = n;
+	(void) rec_begin(REC_BUSY, REC_IDLE);
+
+	ESP_LOGI(TAG, "Loaded %u events", n);
+	if (ok) {
+		sprintf(text, "%u events\n", n);
+		rec_reply(conn, "200 OK", text);
+	} else {
+		sprintf(text, "%u events, out of order, too many or truncated\n", n);
+		rec_reply(conn, "400 Bad Request", text);
+	}
+}
+
+
+/**********************
+ *   STATIC FUNCTIONS
+ **********************/
+// Change the state from from to to, returning false if it wasn't from
+static bool rec_begin(rec_state_t from, rec_state_t to)
+{
+	bool ok;
+
+	portENTER_CRITICAL(&rec_mux);
+	ok = (events != NULL) && (state == from);
+	if (ok) state = to;
+	portEXIT_CRITICAL(&rec_mux);
+
+	return ok;
+}
+
+
+// Parse one "mS flag x y" line, returning false for comments and anything else
+static bool rec_parse(const char* line, input_event_t* e)
+{
+	unsigned int time, flag, x, y;
+
+	if (sscanf(line, "%u %u %u %u", &time, &flag, &x, &y) != 4) return false;
+	e->time = time;
+	e->flag = (flag != 0);
+	e->x = x;
+	e->y = y;
+	return true;
+}
+
+
+static void rec_reply(struct netconn* conn, const char* status, const char* text)
+{
+	char header[128];
+	int n;
+
+	n = snprintf(header, sizeof(header), "HTTP/1.1 %s\r\nContent-Type: text/plain\r\nContent-Length: %u\r\n"
+		"Cache-Control: no-store\r\nConnection: close\r\n\r\n", status, (unsigned int) strlen(text));
+	netconn_write(conn, header, n, NETCONN_COPY);
+	netconn_write(conn, text, strlen(text), NETCONN_COPY);
+}
@@ -0,0 +1,45 @@
+/**
+* Pointer input recorder for the LittleVGL websocket driver
+*
+* Records the pointer events browsers send, with the time each arrived, and replays
+* them through websocket_driver_read() in place of live input so performance runs
+* before and after a change see exactly the same workload.  Recordings are
+* downloaded and uploaded as text, one "mS flag x y" line per event, so they can be
+* kept across firmware builds.
+*
+*/
+#ifndef INPUT_REC_H
+#define INPUT_REC_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*********************
+ *      INCLUDES
+ *********************/
+#include <stdint.h>
+#include <stdbool.h>
+#include "lwip/api.h"
+#include "websocket.h"
+
+
+/**********************
+ * GLOBAL PROTOTYPES
+ **********************/
+bool input_rec_init(uint32_t num_events);
+bool input_rec_record();
+bool input_rec_replay();
+void input_rec_stop();
+bool input_rec_pointer(uint8_t flag, uint16_t x, uint16_t y);
+uint32_t input_rec_wait();
+bool input_rec_next(uint8_t* flag, uint16_t* x, uint16_t* y);
+void input_rec_write(struct netconn* conn);
+void input_rec_read(struct netconn* conn, const ws_request_t* req, const char* buf, uint16_t len);
+
+
+#ifdef __cplusplus
+} /* extern "C" */
+#endif
+
+#endif /* INPUT_REC_H */
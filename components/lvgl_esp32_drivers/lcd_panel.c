@@ -0,0 +1,248 @@
+/**
+* Local SPI LCD of the LittleVGL websocket driver
+*
+* Each strip is queued as the commands setting the panel's column and row window
+* followed by its pixels in chunks the SPI driver sends by DMA from the draw buffer
+* itself, so the flush returns at once and the strip goes out while the sender task
+* packs the same buffer for the browsers.  The panel takes big-endian RGB565, which is
+* how LittlevGL stores pixels with LV_COLOR_16_SWAP set, so nothing is copied.  The
+* interrupt ending the last chunk calls the done callback.
+*
+* The D/C line is set before each transaction from the level kept in its user field.
+*
+*/
+
+/*********************
+ *      INCLUDES
+ *********************/
+#include <string.h>
+#include "lcd_panel.h"
+#include "websocket_driver.h"
+#include "esp_log.h"
+#include "driver/gpio.h"
+#include "driver/spi_master.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+
+/*********************
+ *      DEFINES
+ *********************/
+// MIPI DCS commands
+#define CMD_SWRESET     0x01
+#define CMD_SLPOUT      0x11
+#define CMD_INVON       0x21
+#define CMD_DISPON      0x29
+#define CMD_CASET       0x2A
+#define CMD_RASET       0x2B
+#define CMD_RAMWR       0x2C
+#define CMD_MADCTL      0x36
+#define CMD_COLMOD      0x3A
+
+// COLMOD for 16 bits per pixel
+#define COLMOD_RGB565   0x55
+
+// Time in mS the panel needs after a reset and after leaving sleep
+#define RESET_MS        120
+#define SLPOUT_MS       120
+
+// Bytes of pixels in each DMA transaction
+#define CHUNK_LEN       (16 * LV_HOR_RES_MAX * sizeof(lv_color_t))
+
+// Transactions of the largest strip: the window and write commands, then its pixels
+#define MAX_TRANS       (5 + (WS_DRIVER_MAX_LINES * LV_HOR_RES_MAX * sizeof(lv_color_t) + CHUNK_LEN - 1) / CHUNK_LEN)
+
+// Bits of a transaction's user field
+#define TRANS_DATA      0x01
+#define TRANS_LAST      0x02
+
+
+/**********************
+ *  STATIC VARIABLES
+ **********************/
+static const char* TAG = "lcd_panel";
+
+static spi_device_handle_t spi;
+static int dc_pin;
+static lcd_panel_done_cb_t done;
+
+// The transactions of the strip being sent, each strip's results are collected by
+// the next
+static spi_transaction_t trans[MAX_TRANS];
+static int queued = 0;
+
+
+/**********************
+ *  STATIC PROTOTYPES
+ **********************/
+static void send_cmd(uint8_t cmd, const uint8_t* data, int len);
+static int set_cmd(int n, uint8_t cmd, const uint8_t* data, int len);
+static void pre_transfer(spi_transaction_t* t);
+static void post_transfer(spi_transaction_t* t);
+
+
+/**********************
+ *   GLOBAL FUNCTIONS
+ **********************/
+// Set up the SPI bus and the panel, leaving it on with whatever it last showed.
+// done_cb is called from the SPI interrupt as each strip finishes.  Returns false if
+// the bus can't be set up.
+bool lcd_panel_init(const lcd_panel_config_t* config, lcd_panel_done_cb_t done_cb)
+{
+	spi_bus_config_t bus = {
+		.mosi_io_num = config->mosi_pin,
+		.miso_io_num = -1,
+		.sclk_io_num = config->clk_pin,
+		.quadwp_io_num = -1,
+		.quadhd_io_num = -1,
+		.max_transfer_sz = CHUNK_LEN,
+	};
+	spi_device_interface_config_t dev = {
+		.clock_speed_hz = config->clock_mhz * 1000 * 1000,
+		.mode = 0,
+		.spics_io_num = config->cs_pin,
+		.queue_size = MAX_TRANS,
+		.pre_cb = pre_transfer,
+		.post_cb = post_transfer,
+	};
+	uint8_t colmod = COLMOD_RGB565;
+
+	dc_pin = config->dc_pin;
+	done = done_cb;
+	if ((spi_bus_initialize(config->host, &bus, 1) != ESP_OK) ||
+		(spi_bus_add_device(config->host, &dev, &spi) != ESP_OK)) {
+		ESP_LOGE(TAG, "can't set up SPI host %d", config->host);
+		return false;
+	}
+
+	gpio_pad_select_gpio(dc_pin);
+	gpio_set_direction(dc_pin, GPIO_MODE_OUTPUT);
+	if (config->rst_pin >= 0) {
+		gpio_pad_select_gpio(config->rst_pin);
+		gpio_set_direction(config->rst_pin, GPIO_MODE_OUTPUT);
+		gpio_set_level(config->rst_pin, 0);
+		vTaskDelay(pdMS_TO_TICKS(10));
+		gpio_set_level(config->rst_pin, 1);
+	} else {
+		send_cmd(CMD_SWRESET, NULL, 0);
+	}
+	vTaskDelay(pdMS_TO_TICKS(RESET_MS));
+
+	send_cmd(CMD_SLPOUT, NULL, 0);
+	vTaskDelay(pdMS_TO_TICKS(SLPOUT_MS));
+	send_cmd(CMD_COLMOD, &colmod, 1);
+	send_cmd(CMD_MADCTL, &config->madctl, 1);
+	if (config->invert) send_cmd(CMD_INVON, NULL, 0);
+	send_cmd(CMD_DISPON, NULL, 0);
+
+	if (config->bckl_pin >= 0) {
+		gpio_pad_select_gpio(config->bckl_pin);
+		gpio_set_direction(config->bckl_pin, GPIO_MODE_OUTPUT);
+		gpio_set_level(config->bckl_pin, 1);
+	}
+	ESP_LOGI(TAG, "panel on SPI host %d at %d MHz", config->host, config->clock_mhz);
+	return true;
+}
+
+
+// Start sending the pixels of area in color_map to the panel.  The previous strip must
+// be done, as it is once LittlevGL has its buffer back.
+void lcd_panel_flush(const lv_area_t* area, const lv_color_t* color_map)
+{
+	spi_transaction_t* t;
+	const uint8_t* src = (const uint8_t*) color_map;
+	uint32_t len = lv_area_get_size(area) * sizeof(lv_color_t);
+	uint32_t chunk;
+	uint8_t window[4];
+	int n = 0;
+	int i;
+
+	while (queued > 0) {
+		(void) spi_device_get_trans_result(spi, &t, portMAX_DELAY);
+		queued--;
+	}
+
+	window[0] = area->x1 >> 8;
+	window[1] = area->x1 & 0xFF;
+	window[2] = area->x2 >> 8;
+	window[3] = area->x2 & 0xFF;
+	n = set_cmd(n, CMD_CASET, window, 4);
+	window[0] = area->y1 >> 8;
+	window[1] = area->y1 & 0xFF;
+	window[2] = area->y2 >> 8;
+	window[3] = area->y2 & 0xFF;
+	n = set_cmd(n, CMD_RASET, window, 4);
+	n = set_cmd(n, CMD_RAMWR, NULL, 0);
+	while ((len > 0) && (n < MAX_TRANS)) {
+		chunk = LV_MATH_MIN(len, CHUNK_LEN);
+		memset(&trans[n], 0, sizeof(spi_transaction_t));
+		trans[n].length = chunk * 8;
+		trans[n].tx_buffer = src;
+		trans[n].user = (void*) TRANS_DATA;
+		src += chunk;
+		len -= chunk;
+		n++;
+	}
+	trans[n - 1].user = (void*) ((uintptr_t) trans[n - 1].user | TRANS_LAST);
+
+	for (i=0; i<n; i++) {
+		if (spi_device_queue_trans(spi, &trans[i], portMAX_DELAY) != ESP_OK) break;
+		queued++;
+	}
+	if (i < n) {
+		// The strip can't end, release it as if it had
+		ESP_LOGE(TAG, "can't queue a strip");
+		done();
+	}
+}
+
+
+/**********************
+ *   STATIC FUNCTIONS
+ **********************/
+// Send a command and its parameters, waiting for them to go.  Only used before the
+// first strip is queued.
+static void send_cmd(uint8_t cmd, const uint8_t* data, int len)
+{
+	int n = set_cmd(0, cmd, data, len);
+
+	for (int i=0; i<n; i++) {
+		(void) spi_device_transmit(spi, &trans[i]);
+	}
+}
+
+
+// Fill in trans[n] onwards with a command and its parameters, which are copied into
+// the transaction, returning the index of the next transaction
+static int set_cmd(int n, uint8_t cmd, const uint8_t* data, int len)
+{
+	memset(&trans[n], 0, sizeof(spi_transaction_t));
+	trans[n].flags = SPI_TRANS_USE_TXDATA;
+	trans[n].length = 8;
+	trans[n].tx_data[0] = cmd;
+	trans[n].user = (void*) 0;
+	n++;
+	if (len > 0) {
+		memset(&trans[n], 0, sizeof(spi_transaction_t));
+		trans[n].flags = SPI_TRANS_USE_TXDATA;
+		trans[n].length = len * 8;
+		memcpy(trans[n].tx_data, data, len);
+		trans[n].user = (void*) TRANS_DATA;
+		n++;
+	}
+	return n;
+}
+
+
+// Set D/C for the transaction about to be sent
+static void pre_transfer(spi_transaction_t* t)
+{
+	gpio_set_level(dc_pin, (uintptr_t) t->user & TRANS_DATA);
+}
+
+
+// Report the end of a strip
+static void post_transfer(spi_transaction_t* t)
+{
+	if ((uintptr_t) t->user & TRANS_LAST) done();
+}
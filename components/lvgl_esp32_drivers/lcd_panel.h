@@ -0,0 +1,56 @@
+/**
+* Local SPI LCD of the LittleVGL websocket driver
+*
+* Sends the strips LittlevGL draws to a MIPI DCS panel (ILI9341, ILI9486, ST7789,
+* ST7796 and the like) on an SPI bus by DMA, straight from the draw buffer, so the
+* display can be shown on a local panel while the browsers are sent the same strips.
+*
+*/
+#ifndef LCD_PANEL_H
+#define LCD_PANEL_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*********************
+ *      INCLUDES
+ *********************/
+#include <stdint.h>
+#include <stdbool.h>
+#include "lvgl/lvgl.h"
+
+
+/**********************
+ *      TYPEDEFS
+ **********************/
+// Called from the SPI interrupt once the panel has been sent a strip
+typedef void (*lcd_panel_done_cb_t)();
+
+typedef struct
+{
+	int host;
+	int clock_mhz;
+	int mosi_pin;
+	int clk_pin;
+	int cs_pin;
+	int dc_pin;
+	int rst_pin;
+	int bckl_pin;
+	uint8_t madctl;
+	bool invert;
+} lcd_panel_config_t;
+
+
+/**********************
+ * GLOBAL PROTOTYPES
+ **********************/
+bool lcd_panel_init(const lcd_panel_config_t* config, lcd_panel_done_cb_t done_cb);
+void lcd_panel_flush(const lv_area_t* area, const lv_color_t* color_map);
+
+
+#ifdef __cplusplus
+} /* extern "C" */
+#endif
+
+#endif /* LCD_PANEL_H */
@@ -0,0 +1,653 @@
+/**
+* Microbenchmarks for LittleVGL's hot primitives and the websocket driver's packing and
+* TLS record encryption
+*
+* Each case is run BENCH_ITERS times in a batch and the fastest of BENCH_BATCHES
+* batches is reported, so a batch an interrupt or another task landed in doesn't count.
+* Times are counts of the CPU cycle counter, which counts nanoseconds in the host build.
+*
+* Drawing is done straight into the default display's draw buffer, set up as LittleVGL
+* sets it up for a refresh, with the display driver's GPU and draw stream hooks
+* removed so the software paths are what is measured.  The screen is invalidated
+* afterwards so the first refresh draws over whatever the benchmarks left.
+*
+* Random patterns come from a fixed seed so every run times the same work.
+*
+*/
+
+/*********************
+ *      INCLUDES
+ *********************/
+#include "micro_bench.h"
+#include "websocket_driver.h"
+
+#if WS_DRIVER_MICROBENCH
+
+#include "esp_log.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "xtensa/hal.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include "string.h"
+#if WS_DRIVER_TLS
+#include "websocket_tls.h"
+#include "mbedtls/gcm.h"
+#endif
+
+
+/*********************
+ *      DEFINES
+ *********************/
+// Calls timed in a batch and batches run of each case
+#define BENCH_ITERS           32
+#define BENCH_BATCHES         5
+
+// Most rows of the draw buffer used
+#define BENCH_ROWS            32
+
+// Invalidated areas in each join pattern (at most LV_INV_BUF_SIZE)
+#define JOIN_AREAS            LV_INV_BUF_SIZE
+
+// Live blocks and largest block of the heap churn
+#define CHURN_SLOTS           16
+#define CHURN_MAX_LEN         256
+
+// Size of the rectangles drawn
+#define RECT_W                100
+#define RECT_H                30
+
+// Longest text in a cell of the results
+#define FIELD_LEN             28
+
+
+/**********************
+ *      TYPEDEFS
+ **********************/
+typedef void (*bench_fn_t)(void* arg);
+
+typedef struct
+{
+	const char* name;
+	const lv_font_t* font;
+} bench_font_t;
+
+typedef struct
+{
+	const lv_area_t* areas;
+	int num;
+} join_arg_t;
+
+typedef struct
+{
+	lv_color_t* dest;
+	uint32_t n;
+	lv_opa_t opa;
+} mix_arg_t;
+
+typedef struct
+{
+	lv_area_t area;
+	lv_opa_t opa;
+} fill_arg_t;
+
+typedef struct
+{
+	const lv_font_t* font;
+} letter_arg_t;
+
+typedef struct
+{
+	const lv_style_t* style;
+} rect_arg_t;
+
+typedef struct
+{
+	void* slots[CHURN_SLOTS];
+} churn_arg_t;
+
+typedef struct
+{
+	lv_area_t area;
+	const lv_color_t* src;
+	bool encode;
+	uint32_t len;
+} pack_arg_t;
+
+#if WS_DRIVER_TLS
+typedef struct
+{
+	mbedtls_gcm_context gcm;
+	uint8_t iv[12];
+	uint8_t tag[16];
+	uint32_t len;
+} tls_arg_t;
+#endif
+
+
+/**********************
+ *  STATIC PROTOTYPES
+ **********************/
+static uint32_t bench_time(bench_fn_t fn, void* arg);
+static void bench_report(const char* group, const char* name, uint32_t cycles, uint32_t units, const char* unit);
+static uint32_t bench_rand();
+static void rand_areas(lv_area_t* areas, int num, lv_coord_t x, lv_coord_t y, lv_coord_t w, lv_coord_t h, lv_coord_t min_len, lv_coord_t max_len);
+
+static void bench_join();
+static void join_once(void* arg);
+static void bench_mix();
+static void mix_channels_once(void* arg);
+static void mix_once(void* arg);
+static void mix_n_once(void* arg);
+static void bench_fill();
+static void fill_once(void* arg);
+static void map_once(void* arg);
+static void bench_letters();
+static void letters_once(void* arg);
+static void bench_rects();
+static void rect_once(void* arg);
+static void bench_churn();
+static void churn_once(void* arg);
+static void bench_pack();
+static void pack_once(void* arg);
+#if WS_DRIVER_TLS
+static void bench_tls();
+static void tls_once(void* arg);
+#endif
+
+
+/**********************
+ *  STATIC VARIABLES
+ **********************/
+static const char* TAG = "micro_bench";
+
+static lv_disp_t* disp;
+static lv_area_t mask;
+static lv_coord_t bench_rows;
+
+static lv_color_t* map_buf;
+static uint8_t* pack_buf;
+
+static uint32_t rand_state;
+
+static const char* letters_text = "The quick brown fox jumps over the lazy dog 0123456789";
+
+static const bench_font_t fonts[] = {
+#if LV_FONT_ROBOTO_12
+	{"roboto_12", &lv_font_roboto_12},
+#endif
+#if LV_FONT_ROBOTO_16
+	{"roboto_16", &lv_font_roboto_16},
+#endif
+#if LV_FONT_ROBOTO_22
+	{"roboto_22", &lv_font_roboto_22},
+#endif
+#if LV_FONT_ROBOTO_28
+	{"roboto_28", &lv_font_roboto_28},
+#endif
+#if LV_FONT_UNSCII_8
+	{"unscii_8", &lv_font_unscii_8},
+#endif
+};
+
+
+/**********************
+ *   GLOBAL FUNCTIONS
+ **********************/
+void micro_bench_run()
+{
+	lv_disp_buf_t* vdb;
+	lv_area_t vdb_area;
+	lv_disp_drv_t drv;
+	lv_disp_t* refr_prev;
+	uint32_t buf_len;
+
+	disp = lv_disp_get_default();
+	if (disp == NULL) return;
+	vdb = lv_disp_get_buf(disp);
+
+	buf_len = lv_disp_get_hor_res(disp) * BENCH_ROWS * sizeof(lv_color_t);
+	map_buf = malloc(buf_len);
+	pack_buf = malloc(buf_len + 64);
+	if ((map_buf == NULL) || (pack_buf == NULL)) {
+		ESP_LOGE(TAG, "No memory for the benchmarks");
+		free(map_buf);
+		free(pack_buf);
+		return;
+	}
+
+	// Draw into the top rows of the draw buffer, as a refresh of them would
+	vdb_area = vdb->area;
+	bench_rows = LV_MATH_MIN(BENCH_ROWS, vdb->size / lv_disp_get_hor_res(disp));
+	mask.x1 = 0;
+	mask.y1 = 0;
+	mask.x2 = lv_disp_get_hor_res(disp) - 1;
+	mask.y2 = bench_rows - 1;
+	vdb->area = mask;
+
+	drv = disp->driver;
+	disp->driver.gpu_fill_cb = NULL;
+	disp->driver.gpu_blend_cb = NULL;
+	disp->driver.set_px_cb = NULL;
+	disp->driver.draw_cb = NULL;
+	refr_prev = lv_refr_get_disp_refreshing();
+	lv_refr_set_disp_refreshing(disp);
+
+	rand_state = 0x2545F491;
+	ESP_LOGI(TAG, "%-8s %-26s %12s %14s", "group", "case", "cycles/call", "cycles/unit");
+
+	bench_join();
+	bench_mix();
+	bench_fill();
+	bench_letters();
+	bench_rects();
+	bench_churn();
+	bench_pack();
+#if WS_DRIVER_TLS
+	bench_tls();
+#endif
+
+	lv_refr_set_disp_refreshing(refr_prev);
+	disp->driver = drv;
+	vdb->area = vdb_area;
+	lv_obj_invalidate(lv_disp_get_scr_act(disp));
+
+	free(map_buf);
+	free(pack_buf);
+}
+
+
+/**********************
+ *   STATIC FUNCTIONS
+ **********************/
+// Returns the cycles one call of fn took in the fastest batch
+static uint32_t bench_time(bench_fn_t fn, void* arg)
+{
+	uint32_t best = UINT32_MAX;
+	uint32_t start;
+	uint32_t t;
+	int b, i;
+
+	for (b=0; b<BENCH_BATCHES; b++) {
+		start = xthal_get_ccount();
+		for (i=0; i<BENCH_ITERS; i++) {
+			fn(arg);
+		}
+		t = xthal_get_ccount() - start;
+		if (t < best) best = t;
+	}
+
+	// Let the idle task in between cases
+	vTaskDelay(1);
+
+	return best / BENCH_ITERS;
+}
+
+
+// Log a result, with the cycles per unit of work (pixel, letter...) to a tenth when
+// units is non-zero
+static void bench_report(const char* group, const char* name, uint32_t cycles, uint32_t units, const char* unit)
+{
+	char per_unit[FIELD_LEN];
+	uint32_t tenths;
+
+	if (units != 0) {
+		tenths = (uint32_t) (((uint64_t) cycles * 10 + units / 2) / units);
+		snprintf(per_unit, sizeof(per_unit), "%u.%u/%s", tenths / 10, tenths % 10, unit);
+	} else {
+		per_unit[0] = '\0';
+	}
+	ESP_LOGI(TAG, "%-8s %-26s %12u %14s", group, name, cycles, per_unit);
+}
+
+
+// xorshift32
+static uint32_t bench_rand()
+{
+	rand_state ^= rand_state << 13;
+	rand_state ^= rand_state >> 17;
+	rand_state ^= rand_state << 5;
+	return rand_state;
+}
+
+
+// Fill areas with num random areas min_len to max_len pixels on a side, within the
+// w x h area at x, y
+static void rand_areas(lv_area_t* areas, int num, lv_coord_t x, lv_coord_t y, lv_coord_t w, lv_coord_t h, lv_coord_t min_len, lv_coord_t max_len)
+{
+	lv_coord_t aw, ah;
+	int i;
+
+	for (i=0; i<num; i++) {
+		aw = min_len + bench_rand() % (max_len - min_len + 1);
+		ah = min_len + bench_rand() % (max_len - min_len + 1);
+		aw = LV_MATH_MIN(aw, w);
+		ah = LV_MATH_MIN(ah, h);
+		areas[i].x1 = x + bench_rand() % (w - aw + 1);
+		areas[i].y1 = y + bench_rand() % (h - ah + 1);
+		areas[i].x2 = areas[i].x1 + aw - 1;
+		areas[i].y2 = areas[i].y1 + ah - 1;
+	}
+}
+
+
+// lv_refr_join_areas() on areas scattered over the screen, clustered together and in
+// full width strips
+static void bench_join()
+{
+	lv_coord_t hor_res = lv_disp_get_hor_res(disp);
+	lv_coord_t ver_res = lv_disp_get_ver_res(disp);
+	lv_area_t areas[JOIN_AREAS];
+	join_arg_t arg;
+	int i;
+
+	arg.areas = areas;
+	arg.num = JOIN_AREAS;
+
+	rand_areas(areas, JOIN_AREAS, 0, 0, hor_res, ver_res, 8, 48);
+	bench_report("join", "scattered", bench_time(join_once, &arg), JOIN_AREAS, "area");
+
+	rand_areas(areas, JOIN_AREAS, hor_res / 4, ver_res / 4, hor_res / 2, ver_res / 2, 16, 96);
+	bench_report("join", "clustered", bench_time(join_once, &arg), JOIN_AREAS, "area");
+
+	rand_areas(areas, JOIN_AREAS, 0, 0, hor_res, ver_res, 1, 24);
+	for (i=0; i<JOIN_AREAS; i++) {
+		areas[i].x1 = 0;
+		areas[i].x2 = hor_res - 1;
+	}
+	bench_report("join", "strips", bench_time(join_once, &arg), JOIN_AREAS, "area");
+
+	disp->inv_p = 0;
+}
+
+
+static void join_once(void* arg)
+{
+	join_arg_t* a = (join_arg_t*) arg;
+
+	memcpy(disp->inv_areas, a->areas, a->num * sizeof(lv_area_t));
+	memset(disp->inv_area_joined, 0, a->num);
+	disp->inv_p = a->num;
+	lv_refr_join_areas(disp);
+}
+
+
+// A row of random pixels mixed into the draw buffer by the per channel lv_color_mix()
+// LittleVGL had before, by today's lv_color_mix() and by lv_color_mix_n()
+static void bench_mix()
+{
+	lv_disp_buf_t* vdb = lv_disp_get_buf(disp);
+	mix_arg_t arg;
+	int i;
+
+	for (i=0; i<lv_area_get_size(&mask); i++) {
+		map_buf[i] = lv_color_hex(bench_rand());
+	}
+
+	arg.dest = vdb->buf_act;
+	arg.n = lv_area_get_width(&mask);
+	arg.opa = LV_OPA_50;
+	bench_report("color", "mix per channel", bench_time(mix_channels_once, &arg), arg.n, "px");
+	bench_report("color", "lv_color_mix", bench_time(mix_once, &arg), arg.n, "px");
+	bench_report("color", "lv_color_mix_n", bench_time(mix_n_once, &arg), arg.n, "px");
+}
+
+
+static void mix_channels_once(void* arg)
+{
+	mix_arg_t* a = (mix_arg_t*) arg;
+	lv_color_t c1, c2;
+	uint32_t i;
+
+	for (i=0; i<a->n; i++) {
+		c1 = map_buf[i];
+		c2 = a->dest[i];
+		a->dest[i].ch.red = (uint16_t)((uint16_t)c1.ch.red * a->opa + (c2.ch.red * (255 - a->opa))) >> 8;
+#if LV_COLOR_DEPTH == 16 && LV_COLOR_16_SWAP
+		uint16_t g_1 = (c1.ch.green_h << 3) + c1.ch.green_l;
+		uint16_t g_2 = (c2.ch.green_h << 3) + c2.ch.green_l;
+		uint16_t g_out = (uint16_t)((uint16_t)g_1 * a->opa + (g_2 * (255 - a->opa))) >> 8;
+		a->dest[i].ch.green_h = g_out >> 3;
+		a->dest[i].ch.green_l = g_out & 0x7;
+#else
+		a->dest[i].ch.green = (uint16_t)((uint16_t)c1.ch.green * a->opa + (c2.ch.green * (255 - a->opa))) >> 8;
+#endif
+		a->dest[i].ch.blue = (uint16_t)((uint16_t)c1.ch.blue * a->opa + (c2.ch.blue * (255 - a->opa))) >> 8;
+	}
+}
+
+
+static void mix_once(void* arg)
+{
+	mix_arg_t* a = (mix_arg_t*) arg;
+	uint32_t i;
+
+	for (i=0; i<a->n; i++) {
+		a->dest[i] = lv_color_mix(map_buf[i], a->dest[i], a->opa);
+	}
+}
+
+
+static void mix_n_once(void* arg)
+{
+	mix_arg_t* a = (mix_arg_t*) arg;
+
+	lv_color_mix_n(a->dest, map_buf, a->n, a->opa);
+}
+
+
+// lv_draw_fill() (sw_color_fill) and lv_draw_map() (sw_mem_blend, or mixing each
+// pixel when translucent) bench_rows high at several widths and opacities
+static void bench_fill()
+{
+	static const lv_coord_t widths[] = {1, 8, 32, 0};
+	static const lv_opa_t opas[] = {LV_OPA_COVER, LV_OPA_50, LV_OPA_20};
+	char name[FIELD_LEN];
+	fill_arg_t arg;
+	uint32_t px;
+	int w, o;
+
+	for (w=0; w<sizeof(widths)/sizeof(widths[0]); w++) {
+		arg.area = mask;
+		if (widths[w] != 0) arg.area.x2 = widths[w] - 1;
+		px = lv_area_get_size(&arg.area);
+		for (o=0; o<sizeof(opas)/sizeof(opas[0]); o++) {
+			arg.opa = opas[o];
+			snprintf(name, sizeof(name), "%dx%d opa %d", lv_area_get_width(&arg.area), bench_rows, opas[o]);
+			bench_report("fill", name, bench_time(fill_once, &arg), px, "px");
+			bench_report("map", name, bench_time(map_once, &arg), px, "px");
+		}
+	}
+}
+
+
+static void fill_once(void* arg)
+{
+	fill_arg_t* a = (fill_arg_t*) arg;
+
+	lv_draw_fill(&a->area, &mask, LV_COLOR_MAKE(0x20, 0x80, 0xC0), a->opa);
+}
+
+
+static void map_once(void* arg)
+{
+	fill_arg_t* a = (fill_arg_t*) arg;
+
+	// The map is as wide as the area, like an image of its size
+	lv_draw_map(&a->area, &mask, (const uint8_t*) map_buf, a->opa, false, false, LV_COLOR_BLACK, LV_OPA_TRANSP);
+}
+
+
+// lv_draw_letter() for a line of text in each built-in font
+static void bench_letters()
+{
+	char name[FIELD_LEN];
+	letter_arg_t arg;
+	const lv_font_fmt_txt_dsc_t* dsc;
+	int f;
+
+	for (f=0; f<sizeof(fonts)/sizeof(fonts[0]); f++) {
+		arg.font = fonts[f].font;
+		dsc = (const lv_font_fmt_txt_dsc_t*) arg.font->dsc;
+		snprintf(name, sizeof(name), "%s %d bpp", fonts[f].name, dsc->bpp);
+		bench_report("letter", name, bench_time(letters_once, &arg), strlen(letters_text), "letter");
+	}
+}
+
+
+static void letters_once(void* arg)
+{
+	letter_arg_t* a = (letter_arg_t*) arg;
+	lv_point_t pos = {0, 0};
+	const char* c;
+
+	for (c=letters_text; *c != '\0'; c++) {
+		lv_draw_letter(&pos, &mask, a->font, *c, LV_COLOR_BLACK, LV_OPA_COVER);
+		pos.x += lv_font_get_glyph_width(a->font, *c, c[1]);
+		if (pos.x > mask.x2 - a->font->line_height) pos.x = 0;
+	}
+}
+
+
+// lv_draw_rect() plain, with radius, border and shadow
+static void bench_rects()
+{
+	lv_style_t style;
+	rect_arg_t arg;
+	uint32_t px = RECT_W * RECT_H;
+
+	lv_style_copy(&style, &lv_style_plain);
+	style.body.main_color = LV_COLOR_MAKE(0x20, 0x80, 0xC0);
+	style.body.grad_color = style.body.main_color;
+	arg.style = &style;
+	bench_report("rect", "plain", bench_time(rect_once, &arg), px, "px");
+
+	style.body.grad_color = LV_COLOR_MAKE(0x10, 0x40, 0x60);
+	bench_report("rect", "gradient", bench_time(rect_once, &arg), px, "px");
+
+	style.body.radius = 10;
+	bench_report("rect", "radius 10", bench_time(rect_once, &arg), px, "px");
+
+	style.body.border.width = 2;
+	style.body.border.color = LV_COLOR_BLACK;
+	style.body.border.opa = LV_OPA_COVER;
+	bench_report("rect", "radius 10 border 2", bench_time(rect_once, &arg), px, "px");
+
+	style.body.radius = 0;
+	style.body.border.width = 0;
+	style.body.shadow.width = 8;
+	style.body.shadow.color = LV_COLOR_GRAY;
+	bench_report("rect", "shadow 8", bench_time(rect_once, &arg), px, "px");
+
+	style.body.radius = 10;
+	bench_report("rect", "radius 10 shadow 8", bench_time(rect_once, &arg), px, "px");
+
+	style.body.opa = LV_OPA_50;
+	bench_report("rect", "radius 10 shadow 8 opa 50", bench_time(rect_once, &arg), px, "px");
+}
+
+
+static void rect_once(void* arg)
+{
+	rect_arg_t* a = (rect_arg_t*) arg;
+	lv_area_t coords;
+
+	// Shadows reach outside the rectangle, so leave room for them in the buffer
+	coords.x1 = 16;
+	coords.y1 = 0;
+	coords.x2 = coords.x1 + RECT_W - 1;
+	coords.y2 = coords.y1 + RECT_H - 1;
+	lv_draw_rect(&coords, &mask, a->style, LV_OPA_COVER);
+}
+
+
+// lv_mem_alloc() and lv_mem_free() replacing random blocks among a set kept live
+static void bench_churn()
+{
+	churn_arg_t arg;
+	int i;
+
+	for (i=0; i<CHURN_SLOTS; i++) {
+		arg.slots[i] = lv_mem_alloc(1 + bench_rand() % CHURN_MAX_LEN);
+	}
+	bench_report("mem", "alloc + free", bench_time(churn_once, &arg), 0, NULL);
+	for (i=0; i<CHURN_SLOTS; i++) {
+		lv_mem_free(arg.slots[i]);
+	}
+}
+
+
+static void churn_once(void* arg)
+{
+	churn_arg_t* a = (churn_arg_t*) arg;
+	int i = bench_rand() % CHURN_SLOTS;
+
+	lv_mem_free(a->slots[i]);
+	a->slots[i] = lv_mem_alloc(1 + bench_rand() % CHURN_MAX_LEN);
+}
+
+
+// websocket_driver_pack() of the full width of the buffer as left by the rectangles,
+// and of noise no encoding can shrink, raw and encoded
+static void bench_pack()
+{
+	lv_disp_buf_t* vdb = lv_disp_get_buf(disp);
+	pack_arg_t arg;
+	uint32_t px;
+	uint32_t t;
+	char name[FIELD_LEN];
+
+	arg.area = mask;
+	px = lv_area_get_size(&mask);
+
+	arg.src = vdb->buf_act;
+	arg.encode = false;
+	bench_report("pack", "drawn raw", bench_time(pack_once, &arg), px, "px");
+	arg.encode = true;
+	t = bench_time(pack_once, &arg);
+	snprintf(name, sizeof(name), "drawn encoded %u%%", arg.len * 100 / (px * (uint32_t) sizeof(lv_color_t)));
+	bench_report("pack", name, t, px, "px");
+
+	arg.src = map_buf;
+	arg.encode = false;
+	bench_report("pack", "noise raw", bench_time(pack_once, &arg), px, "px");
+	arg.encode = true;
+	bench_report("pack", "noise encoded", bench_time(pack_once, &arg), px, "px");
+}
+
+
+static void pack_once(void* arg)
+{
+	pack_arg_t* a = (pack_arg_t*) arg;
+
+	a->len = websocket_driver_pack(pack_buf, &a->area, a->src, lv_area_get_width(&a->area), a->encode);
+}
+
+#if WS_DRIVER_TLS
+// A TLS client's frames are encrypted a record at a time with the suite the server
+// prefers, so its cost per byte bounds what a client can be sent
+static void bench_tls()
+{
+	const uint8_t key[16] = {0};
+	tls_arg_t arg;
+
+	memset(&arg, 0, sizeof(arg));
+	arg.len = LV_MATH_MIN(WEBSOCKET_SERVER_TLS_RECORD_LEN, lv_area_get_size(&mask) * sizeof(lv_color_t));
+	mbedtls_gcm_init(&arg.gcm);
+	if (mbedtls_gcm_setkey(&arg.gcm, MBEDTLS_CIPHER_ID_AES, key, 128) == 0) {
+		bench_report("tls", "AES-128-GCM record", bench_time(tls_once, &arg), arg.len, "B");
+	}
+	mbedtls_gcm_free(&arg.gcm);
+}
+
+
+static void tls_once(void* arg)
+{
+	tls_arg_t* a = (tls_arg_t*) arg;
+
+	(void) mbedtls_gcm_crypt_and_tag(&a->gcm, MBEDTLS_GCM_ENCRYPT, a->len, a->iv, sizeof(a->iv), NULL, 0,
+		(const uint8_t*) map_buf, pack_buf, sizeof(a->tag), a->tag);
+}
+#endif
+
+#endif /* WS_DRIVER_MICROBENCH */
@@ -0,0 +1,36 @@
+/**
+* Microbenchmarks for LittleVGL's hot primitives and the websocket driver's packing
+*
+* Times joining invalidated areas, fills and image copies at several widths and
+* opacities, letters in each built-in font, rectangles with radius and shadow, heap
+* churn and the driver's pixel packing, each with the CPU cycle counter, and logs a
+* table of the results.  Run once at startup, after the display is registered and
+* before the user interface is created.
+*
+*/
+#ifndef MICRO_BENCH_H
+#define MICRO_BENCH_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*********************
+ *      INCLUDES
+ *********************/
+#include <stdint.h>
+#include <stdbool.h>
+#include "lvgl/lvgl.h"
+
+
+/**********************
+ * GLOBAL PROTOTYPES
+ **********************/
+void micro_bench_run();
+
+
+#ifdef __cplusplus
+} /* extern "C" */
+#endif
+
+#endif /* MICRO_BENCH_H */
@@ -0,0 +1,221 @@
+/**
+* Pipeline monitor panel for the LittleVGL websocket driver
+*
+* Refreshes rendered and flushes packed are counted by the driver's hooks into wrapping
+* totals, and the clients' write counters are read from frame_tx.  An lv_task compares
+* them with their values at its last run, charting the refreshes produced against the
+* frames the slowest client was delivered and listing the rest, so the only work done
+* between updates is a few additions.
+*
+*/
+
+/*********************
+ *      INCLUDES
+ *********************/
+#include "pipe_mon.h"
+#include "websocket_driver.h"
+
+#if WS_DRIVER_PIPE_MON
+
+#include "esp_heap_caps.h"
+#include "websocket_server.h"
+#include "frame_tx.h"
+#include <stdio.h>
+#include "string.h"
+
+
+/*********************
+ *      DEFINES
+ *********************/
+// Updates shown by the chart and the most frames a second it shows
+#define CHART_POINTS          30
+#define CHART_MAX_FPS         64
+
+// Longest text of the panel: the display lines, two per client and one per heap region
+#define INFO_LEN              (192 + WEBSOCKET_SERVER_MAX_CLIENTS * 96)
+
+
+/**********************
+ *  STATIC PROTOTYPES
+ **********************/
+static void pipe_mon_task(lv_task_t* task);
+static int format_heap(char* buf, int len, const char* region, uint32_t caps);
+static void win_close_action(lv_obj_t* btn, lv_event_t event);
+
+
+/**********************
+ *  STATIC VARIABLES
+ **********************/
+// Totals, wrapping, counted by the LVGL task and the sender task
+static volatile uint32_t render_cnt = 0;
+static volatile uint32_t render_ms = 0;
+static volatile uint32_t encode_cnt = 0;
+static volatile uint32_t encode_us = 0;
+
+// Their values and each client's counters when the panel was last updated
+static uint32_t last_render_cnt, last_render_ms, last_encode_cnt, last_encode_us;
+static frame_tx_stats_t last_clients[WEBSOCKET_SERVER_MAX_CLIENTS];
+
+static lv_obj_t* win = NULL;
+static lv_obj_t* chart;
+static lv_chart_series_t* produced_ser;
+static lv_chart_series_t* delivered_ser;
+static lv_obj_t* info_label;
+static lv_task_t* refr_task;
+
+
+/**********************
+ *   GLOBAL FUNCTIONS
+ **********************/
+// Show the panel over the right half of the active screen of the default display, until
+// its close button is clicked.  Call after the application has built its screen.
+void pipe_mon_create()
+{
+	lv_coord_t hres = lv_disp_get_hor_res(NULL);
+	lv_coord_t vres = lv_disp_get_ver_res(NULL);
+	lv_obj_t* btn;
+	int i;
+
+	if (win != NULL) return;
+
+	win = lv_win_create(lv_disp_get_scr_act(NULL), NULL);
+	lv_win_set_title(win, "Pipeline");
+	lv_obj_set_size(win, hres / 2, vres);
+	lv_obj_align(win, NULL, LV_ALIGN_IN_TOP_RIGHT, 0, 0);
+	btn = lv_win_add_btn(win, LV_SYMBOL_CLOSE);
+	lv_obj_set_event_cb(btn, win_close_action);
+	lv_win_set_layout(win, LV_LAYOUT_COL_L);
+
+	// Red are the refreshes rendered, blue the frames the slowest client was written
+	chart = lv_chart_create(win, NULL);
+	lv_obj_set_size(chart, lv_win_get_width(win) - LV_DPI / 5, vres / 4);
+	lv_chart_set_point_count(chart, CHART_POINTS);
+	lv_chart_set_range(chart, 0, CHART_MAX_FPS);
+	lv_chart_set_type(chart, LV_CHART_TYPE_LINE);
+	lv_chart_set_series_width(chart, 2);
+	produced_ser = lv_chart_add_series(chart, LV_COLOR_RED);
+	delivered_ser = lv_chart_add_series(chart, LV_COLOR_BLUE);
+	for (i=0; i<CHART_POINTS; i++) {
+		lv_chart_set_next(chart, produced_ser, 0);
+		lv_chart_set_next(chart, delivered_ser, 0);
+	}
+
+	info_label = lv_label_create(win, NULL);
+	lv_label_set_text(info_label, "");
+
+	last_render_cnt = render_cnt;
+	last_render_ms = render_ms;
+	last_encode_cnt = encode_cnt;
+	last_encode_us = encode_us;
+	for (i=0; i<WEBSOCKET_SERVER_MAX_CLIENTS; i++) {
+		if (!frame_tx_get_stats(i, &last_clients[i])) memset(&last_clients[i], 0, sizeof(frame_tx_stats_t));
+	}
+	refr_task = lv_task_create(pipe_mon_task, WS_DRIVER_PIPE_MON_MS, LV_TASK_PRIO_LOW, NULL);
+
+#if WS_DRIVER_RATE_CAPS
+	// Everything in the window changes together once an update
+	(void) websocket_driver_cap_obj(win, WS_DRIVER_PIPE_MON_MS);
+#endif
+}
+
+
+// Called from the display driver's monitor callback after each refresh
+void pipe_mon_rendered(uint32_t time_ms)
+{
+	render_cnt++;
+	render_ms += time_ms;
+}
+
+
+// Called by the sender task after packing each flush
+void pipe_mon_encoded(uint32_t us)
+{
+	encode_cnt++;
+	encode_us += us;
+}
+
+
+/**********************
+ *   STATIC FUNCTIONS
+ **********************/
+// Show what happened since the last update
+static void pipe_mon_task(lv_task_t* task)
+{
+	static char buf[INFO_LEN];
+	frame_tx_stats_t cur;
+	uint32_t refr, refr_ms, enc, enc_us, sent, us;
+	uint32_t slowest = UINT32_MAX;
+	int i, n;
+
+	(void) task;
+
+	refr = render_cnt - last_render_cnt;
+	refr_ms = render_ms - last_render_ms;
+	enc = encode_cnt - last_encode_cnt;
+	enc_us = encode_us - last_encode_us;
+	last_render_cnt += refr;
+	last_render_ms += refr_ms;
+	last_encode_cnt += enc;
+	last_encode_us += enc_us;
+
+	n = snprintf(buf, sizeof(buf), "Produced %u fps\nRender %u.%u ms\nPack %u.%u ms\n",
+		refr * 1000 / WS_DRIVER_PIPE_MON_MS,
+		refr ? refr_ms / refr : 0, refr ? (refr_ms * 10 / refr) % 10 : 0,
+		enc ? enc_us / enc / 1000 : 0, enc ? (enc_us / enc / 100) % 10 : 0);
+
+	for (i=0; i<WEBSOCKET_SERVER_MAX_CLIENTS; i++) {
+		if (!frame_tx_get_stats(i, &cur)) continue;
+
+		// Counters restart when a client connects
+		if (cur.seq != last_clients[i].seq) {
+			memset(&last_clients[i], 0, sizeof(frame_tx_stats_t));
+		}
+		sent = cur.sent - last_clients[i].sent;
+		us = cur.write_us - last_clients[i].write_us;
+		slowest = LV_MATH_MIN(slowest, sent);
+		if (n < sizeof(buf)) {
+			n += snprintf(&buf[n], sizeof(buf) - n, "#%d %u fps, %u dropped\n   send %u.%u ms, queue %u\n",
+				i, sent * 1000 / WS_DRIVER_PIPE_MON_MS, cur.dropped - last_clients[i].dropped,
+				sent ? us / sent / 1000 : 0, sent ? (us / sent / 100) % 10 : 0, cur.queued);
+		}
+		last_clients[i] = cur;
+	}
+
+	n += format_heap(&buf[n], sizeof(buf) - n, "Internal", MALLOC_CAP_INTERNAL);
+	n += format_heap(&buf[n], sizeof(buf) - n, "PSRAM", MALLOC_CAP_SPIRAM);
+	if ((n > 0) && (n <= sizeof(buf))) buf[n - 1] = '\0';
+	lv_label_set_text(info_label, buf);
+
+	lv_chart_set_next(chart, produced_ser, LV_MATH_MIN(refr * 1000 / WS_DRIVER_PIPE_MON_MS, CHART_MAX_FPS));
+	lv_chart_set_next(chart, delivered_ser, (slowest == UINT32_MAX) ? 0 :
+		LV_MATH_MIN(slowest * 1000 / WS_DRIVER_PIPE_MON_MS, CHART_MAX_FPS));
+}
+
+// Load buf with a heap region's free and least free kB, returning its length as
+// snprintf() does, or 0 for a region the board doesn't have
+static int format_heap(char* buf, int len, const char* region, uint32_t caps)
+{
+	multi_heap_info_t info;
+
+	if (len <= 0) return 0;
+	heap_caps_get_info(&info, caps);
+	if ((info.total_free_bytes + info.total_allocated_bytes) == 0) return 0;
+	return snprintf(buf, len, "%s %u kB free, %u min\n", region,
+		(uint32_t) info.total_free_bytes / 1024, (uint32_t) info.minimum_free_bytes / 1024);
+}
+
+// Called when the window's close button is clicked
+static void win_close_action(lv_obj_t* btn, lv_event_t event)
+{
+	(void) btn;
+
+	if (event != LV_EVENT_CLICKED) return;
+
+	lv_obj_del(win);
+	win = NULL;
+
+	lv_task_del(refr_task);
+	refr_task = NULL;
+}
+
+#endif /* WS_DRIVER_PIPE_MON */
@@ -0,0 +1,41 @@
+/**
+* Pipeline monitor panel for the LittleVGL websocket driver
+*
+* A window in the style of lv_apps/sysmon showing, in place of the CPU and memory, how
+* the remote display pipeline is keeping up: the time LittleVGL spends rendering each
+* refresh, the time the sender takes to pack each flush, each client's write time,
+* queue depth and frames delivered against the refreshes produced, and the free heap of
+* each memory region.  It is updated every WS_DRIVER_PIPE_MON_MS, and with refresh rate
+* caps its window is refreshed no more often, so it costs little of what it measures.
+*
+*/
+#ifndef PIPE_MON_H
+#define PIPE_MON_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*********************
+ *      INCLUDES
+ *********************/
+#include <stdint.h>
+#include <stdbool.h>
+#include "lvgl/lvgl.h"
+
+
+/**********************
+ * GLOBAL PROTOTYPES
+ **********************/
+void pipe_mon_create();
+
+// Measurement hooks called by the driver
+void pipe_mon_rendered(uint32_t time_ms);
+void pipe_mon_encoded(uint32_t us);
+
+
+#ifdef __cplusplus
+} /* extern "C" */
+#endif
+
+#endif /* PIPE_MON_H */
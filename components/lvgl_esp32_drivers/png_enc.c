@@ -0,0 +1,358 @@
+/**
+* Streaming PNG encoder for the LittleVGL websocket driver
+*
+* Rows are stored unfiltered as 8-bit RGB and compressed in a single deflate block
+* with the fixed Huffman codes, so no code tables are built or sent.  The only matches
+* looked for are against the pixel to the left and the row above, which is what the
+* flat fills and repeated rows of a user interface are made of, so only the current
+* and previous rows are kept.  Compressed data is written out as an IDAT chunk
+* whenever CHUNK_LEN bytes of it have collected.
+*
+*/
+
+/*********************
+ *      INCLUDES
+ *********************/
+#include "png_enc.h"
+#include "websocket_driver.h"
+
+#if WS_DRIVER_SNAPSHOT
+
+#include <stdlib.h>
+#include "string.h"
+
+
+/*********************
+ *      DEFINES
+ *********************/
+// Compressed bytes collected into each IDAT chunk
+#define CHUNK_LEN           2048
+
+// Deflate's limits on a match
+#define MIN_MATCH           3
+#define MAX_MATCH           258
+#define MAX_DIST            32768
+
+// Largest number of bytes Adler-32 can sum before its sums must be reduced
+#define ADLER_NMAX          5552
+
+
+/**********************
+ *      TYPEDEFS
+ **********************/
+struct png_enc
+{
+	png_enc_write_t write;
+	void* ctx;
+	bool ok;
+	lv_coord_t w;
+	int row_len;            // Filter type byte and 3 bytes per pixel
+	bool first_row;
+	uint8_t* cur;
+	uint8_t* prev;
+	uint32_t bits;          // Bits not yet a whole byte, first bit lowest
+	int num_bits;
+	uint32_t adler;
+	int out_len;
+	uint8_t out[CHUNK_LEN];
+};
+
+
+/**********************
+ *  STATIC VARIABLES
+ **********************/
+static const uint8_t SIGNATURE[] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+
+// Shortest length and extra bits of each deflate length code from 257
+static const uint16_t LEN_BASE[] = {3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+	35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258};
+static const uint8_t LEN_EXTRA[] = {0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+	3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0};
+
+// Shortest distance and extra bits of each deflate distance code
+static const uint16_t DIST_BASE[] = {1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+	257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577};
+static const uint8_t DIST_EXTRA[] = {0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+	7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13};
+
+// CRC-32 a nibble at a time
+static const uint32_t CRC_TABLE[] = {
+	0x00000000, 0x1DB71064, 0x3B6E20C8, 0x26D930AC, 0x76DC4190, 0x6B6B51F4, 0x4DB26158, 0x5005713C,
+	0xEDB88320, 0xF00F9344, 0xD6D6A3E8, 0xCB61B38C, 0x9B64C2B0, 0x86D3D2D4, 0xA00AE278, 0xBDBDF21C
+};
+
+
+/**********************
+ *  STATIC PROTOTYPES
+ **********************/
+static void write_chunk(png_enc_t* enc, const char* type, const uint8_t* data, int len);
+static void flush_idat(png_enc_t* enc);
+static void put_bits(png_enc_t* enc, uint32_t value, int n);
+static void put_code(png_enc_t* enc, uint32_t code, int n);
+static void put_symbol(png_enc_t* enc, int sym);
+static void put_match(png_enc_t* enc, int len, int dist);
+static int match_len(const uint8_t* a, const uint8_t* b, int max);
+static uint32_t crc_update(uint32_t crc, const uint8_t* data, int len);
+static uint32_t adler_update(uint32_t adler, const uint8_t* data, int len);
+static void put_be32(uint8_t* p, uint32_t v);
+
+
+/**********************
+ *   GLOBAL FUNCTIONS
+ **********************/
+// Start a w x h image, writing its header.  Returns NULL if there isn't memory for it.
+png_enc_t* png_enc_begin(lv_coord_t w, lv_coord_t h, png_enc_write_t write, void* ctx)
+{
+	png_enc_t* enc;
+	uint8_t ihdr[13];
+
+	enc = malloc(sizeof(png_enc_t));
+	if (enc == NULL) return NULL;
+	enc->row_len = 1 + 3 * w;
+	enc->cur = malloc(enc->row_len);
+	enc->prev = malloc(enc->row_len);
+	if ((enc->cur == NULL) || (enc->prev == NULL)) {
+		free(enc->cur);
+		free(enc->prev);
+		free(enc);
+		return NULL;
+	}
+	enc->write = write;
+	enc->ctx = ctx;
+	enc->ok = true;
+	enc->w = w;
+	enc->first_row = true;
+	enc->bits = 0;
+	enc->num_bits = 0;
+	enc->adler = 1;
+	enc->out_len = 0;
+
+	enc->ok = write(ctx, SIGNATURE, sizeof(SIGNATURE));
+	put_be32(&ihdr[0], w);
+	put_be32(&ihdr[4], h);
+	ihdr[8] = 8;            // Bits per channel
+	ihdr[9] = 2;            // RGB
+	ihdr[10] = 0;           // Deflate
+	ihdr[11] = 0;           // Adaptive filtering
+	ihdr[12] = 0;           // Not interlaced
+	write_chunk(enc, "IHDR", ihdr, sizeof(ihdr));
+
+	// zlib header for a 32 kB window, then the one final block with fixed codes
+	enc->out[enc->out_len++] = 0x78;
+	enc->out[enc->out_len++] = 0x01;
+	put_bits(enc, 1, 1);
+	put_bits(enc, 1, 2);
+
+	return enc;
+}
+
+
+// Add the next row of w pixels.  Returns false once the write function has failed.
+bool png_enc_row(png_enc_t* enc, const lv_color_t* row)
+{
+	uint8_t* swap;
+	uint32_t c;
+	int i, len, up_len;
+	lv_coord_t x;
+
+	if (!enc->ok) return false;
+
+	enc->cur[0] = 0;        // No filter
+	for (x = 0; x < enc->w; x++) {
+		c = lv_color_to32(row[x]);
+		enc->cur[1 + 3 * x] = (c >> 16) & 0xFF;
+		enc->cur[2 + 3 * x] = (c >> 8) & 0xFF;
+		enc->cur[3 + 3 * x] = c & 0xFF;
+	}
+	enc->adler = adler_update(enc->adler, enc->cur, enc->row_len);
+
+	i = 0;
+	while (i < enc->row_len) {
+		// Repeats of the pixel to the left, then of the row above, which is row_len back
+		len = (i > 3) ? match_len(&enc->cur[i], &enc->cur[i - 3], enc->row_len - i) : 0;
+		if (!enc->first_row && (enc->row_len <= MAX_DIST)) {
+			up_len = match_len(&enc->cur[i], &enc->prev[i], enc->row_len - i);
+			if ((up_len >= MIN_MATCH) && (up_len > len)) {
+				put_match(enc, up_len, enc->row_len);
+				i += up_len;
+				continue;
+			}
+		}
+		if (len >= MIN_MATCH) {
+			put_match(enc, len, 3);
+			i += len;
+		} else {
+			put_symbol(enc, enc->cur[i]);
+			i++;
+		}
+	}
+
+	swap = enc->prev;
+	enc->prev = enc->cur;
+	enc->cur = swap;
+	enc->first_row = false;
+
+	return enc->ok;
+}
+
+
+// Finish the image and free the encoder.  Returns whether all of it was written.
+bool png_enc_end(png_enc_t* enc)
+{
+	bool ok;
+
+	put_symbol(enc, 256);   // End of block
+	if (enc->num_bits > 0) put_bits(enc, 0, 8 - enc->num_bits);
+	if (enc->out_len > CHUNK_LEN - 4) flush_idat(enc);
+	put_be32(&enc->out[enc->out_len], enc->adler);
+	enc->out_len += 4;
+	flush_idat(enc);
+	write_chunk(enc, "IEND", NULL, 0);
+
+	ok = enc->ok;
+	free(enc->cur);
+	free(enc->prev);
+	free(enc);
+	return ok;
+}
+
+
+/**********************
+ *   STATIC FUNCTIONS
+ **********************/
+static void write_chunk(png_enc_t* enc, const char* type, const uint8_t* data, int len)
+{
+	uint8_t hdr[8];
+	uint8_t crc_buf[4];
+	uint32_t crc;
+
+	put_be32(&hdr[0], len);
+	memcpy(&hdr[4], type, 4);
+	crc = crc_update(0xFFFFFFFF, &hdr[4], 4);
+	crc = crc_update(crc, data, len) ^ 0xFFFFFFFF;
+	put_be32(crc_buf, crc);
+
+	if (enc->ok) enc->ok = enc->write(enc->ctx, hdr, sizeof(hdr));
+	if (enc->ok && (len > 0)) enc->ok = enc->write(enc->ctx, data, len);
+	if (enc->ok) enc->ok = enc->write(enc->ctx, crc_buf, sizeof(crc_buf));
+}
+
+
+static void flush_idat(png_enc_t* enc)
+{
+	if (enc->out_len > 0) {
+		write_chunk(enc, "IDAT", enc->out, enc->out_len);
+		enc->out_len = 0;
+	}
+}
+
+
+// Add the low n bits of value, first bit lowest, as deflate packs everything but codes
+static void put_bits(png_enc_t* enc, uint32_t value, int n)
+{
+	enc->bits |= value << enc->num_bits;
+	enc->num_bits += n;
+	while (enc->num_bits >= 8) {
+		enc->out[enc->out_len++] = enc->bits & 0xFF;
+		enc->bits >>= 8;
+		enc->num_bits -= 8;
+		if (enc->out_len == CHUNK_LEN) flush_idat(enc);
+	}
+}
+
+
+// Add an n bit Huffman code, which deflate packs starting from its highest bit
+static void put_code(png_enc_t* enc, uint32_t code, int n)
+{
+	uint32_t rev = 0;
+	int i;
+
+	for (i = 0; i < n; i++) {
+		rev = (rev << 1) | ((code >> i) & 1);
+	}
+	put_bits(enc, rev, n);
+}
+
+
+// Add a literal/length symbol in the fixed code
+static void put_symbol(png_enc_t* enc, int sym)
+{
+	if (sym < 144) {
+		put_code(enc, 0x30 + sym, 8);
+	} else if (sym < 256) {
+		put_code(enc, 0x190 + sym - 144, 9);
+	} else if (sym < 280) {
+		put_code(enc, sym - 256, 7);
+	} else {
+		put_code(enc, 0xC0 + sym - 280, 8);
+	}
+}
+
+
+static void put_match(png_enc_t* enc, int len, int dist)
+{
+	int i;
+
+	for (i = sizeof(LEN_BASE) / sizeof(LEN_BASE[0]) - 1; LEN_BASE[i] > len; i--);
+	put_symbol(enc, 257 + i);
+	if (LEN_EXTRA[i]) put_bits(enc, len - LEN_BASE[i], LEN_EXTRA[i]);
+
+	for (i = sizeof(DIST_BASE) / sizeof(DIST_BASE[0]) - 1; DIST_BASE[i] > dist; i--);
+	put_code(enc, i, 5);
+	if (DIST_EXTRA[i]) put_bits(enc, dist - DIST_BASE[i], DIST_EXTRA[i]);
+}
+
+
+// Number of leading bytes a and b have in common, up to max and a single match
+static int match_len(const uint8_t* a, const uint8_t* b, int max)
+{
+	int n = 0;
+
+	if (max > MAX_MATCH) max = MAX_MATCH;
+	while ((n < max) && (a[n] == b[n])) n++;
+	return n;
+}
+
+
+static uint32_t crc_update(uint32_t crc, const uint8_t* data, int len)
+{
+	int i;
+
+	for (i = 0; i < len; i++) {
+		crc ^= data[i];
+		crc = (crc >> 4) ^ CRC_TABLE[crc & 0x0F];
+		crc = (crc >> 4) ^ CRC_TABLE[crc & 0x0F];
+	}
+	return crc;
+}
+
+
+static uint32_t adler_update(uint32_t adler, const uint8_t* data, int len)
+{
+	uint32_t s1 = adler & 0xFFFF;
+	uint32_t s2 = adler >> 16;
+	int n;
+
+	while (len > 0) {
+		n = (len < ADLER_NMAX) ? len : ADLER_NMAX;
+		len -= n;
+		while (n--) {
+			s1 += *data++;
+			s2 += s1;
+		}
+		s1 %= 65521;
+		s2 %= 65521;
+	}
+	return (s2 << 16) | s1;
+}
+
+
+static void put_be32(uint8_t* p, uint32_t v)
+{
+	p[0] = (v >> 24) & 0xFF;
+	p[1] = (v >> 16) & 0xFF;
+	p[2] = (v >> 8) & 0xFF;
+	p[3] = v & 0xFF;
+}
+
+#endif /* WS_DRIVER_SNAPSHOT */
@@ -0,0 +1,45 @@
+/**
+* Streaming PNG encoder for the LittleVGL websocket driver
+*
+* Encodes a screen a row at a time into an RGB PNG, handing the file to a write
+* function in pieces as they fill, so a screenshot never needs more than a few rows
+* of memory.
+*
+*/
+#ifndef PNG_ENC_H
+#define PNG_ENC_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*********************
+ *      INCLUDES
+ *********************/
+#include <stdint.h>
+#include <stdbool.h>
+#include "lvgl/lvgl.h"
+
+
+/**********************
+ *      TYPEDEFS
+ **********************/
+// Writes len bytes of the file, returning false to abandon it
+typedef bool (*png_enc_write_t)(void* ctx, const uint8_t* data, int len);
+
+typedef struct png_enc png_enc_t;
+
+
+/**********************
+ * GLOBAL PROTOTYPES
+ **********************/
+png_enc_t* png_enc_begin(lv_coord_t w, lv_coord_t h, png_enc_write_t write, void* ctx);
+bool png_enc_row(png_enc_t* enc, const lv_color_t* row);
+bool png_enc_end(png_enc_t* enc);
+
+
+#ifdef __cplusplus
+} /* extern "C" */
+#endif
+
+#endif /* PNG_ENC_H */
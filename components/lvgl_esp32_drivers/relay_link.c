@@ -0,0 +1,150 @@
+/**
+* Upstream relay link of the LittleVGL websocket driver
+*
+* The device connects out to the relay and the connection is made a client at once,
+* with the raw framing of the raw TCP port: frames with the first byte of a websocket
+* header and a 32 bit big-endian length, unmasked.  A websocket client would have to
+* mask every frame it sends, which is a pass over every byte of every strip, so the
+* relay speaks the raw framing to the device and websockets to the browsers.  To the
+* rest of the driver the relay is one more viewer, with its own credits, encodings and
+* pings.
+*
+* The slot the relay was given is checked every POLL_MS, and once it has been closed,
+* by either end, the link reconnects.  Failed connections are retried after a delay
+* that doubles from RETRY_MIN_MS up to RETRY_MAX_MS, and starts again from the bottom
+* once a connection has been made.
+*
+*/
+
+/*********************
+ *      INCLUDES
+ *********************/
+#include "relay_link.h"
+#include "websocket_driver.h"
+#include "websocket_server.h"
+#include "esp_log.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "lwip/api.h"
+
+
+/*********************
+ *      DEFINES
+ *********************/
+// Delay in mS before retrying a failed connection, doubling on each failure
+#define RETRY_MIN_MS    2000
+#define RETRY_MAX_MS    30000
+
+// How often the relay's slot is checked for being closed, in mS
+#define POLL_MS         1000
+
+
+/**********************
+ *  STATIC VARIABLES
+ **********************/
+static const char* TAG = "relay_link";
+
+static const char* relay_host;
+static uint16_t relay_port;
+static int relay_recv_timeout;
+static relay_link_cb_t relay_callback;
+
+
+/**********************
+ *  STATIC PROTOTYPES
+ **********************/
+static void relay_task(void* pvParameters);
+static struct netconn* relay_open();
+static bool relay_open_slot(int num, struct netconn* conn);
+
+
+/**********************
+ *   GLOBAL FUNCTIONS
+ **********************/
+// Start keeping a connection to the relay at host (a name or dotted address) on
+// port.  The connection is given recv_timeout and made a raw client with callback.
+bool relay_link_start(const char* host, uint16_t port, int recv_timeout, relay_link_cb_t callback)
+{
+	relay_host = host;
+	relay_port = port;
+	relay_recv_timeout = recv_timeout;
+	relay_callback = callback;
+	if (websocket_driver_create_task(&relay_task, "relay_task", 3000, NULL, WS_DRIVER_SERVER_PRIO, NULL,
+		WS_DRIVER_NET_CORE, false) != pdPASS) {
+		ESP_LOGE(TAG, "can't start the relay link");
+		return false;
+	}
+	return true;
+}
+
+
+/**********************
+ *   STATIC FUNCTIONS
+ **********************/
+// Connects to the relay, waits for the connection to close and reconnects
+static void relay_task(void* pvParameters)
+{
+	struct netconn* conn;
+	int retry_ms = RETRY_MIN_MS;
+	int num;
+
+	for (;;) {
+		conn = relay_open();
+		if (conn == NULL) {
+			vTaskDelay(pdMS_TO_TICKS(retry_ms));
+			retry_ms = LV_MATH_MIN(2 * retry_ms, RETRY_MAX_MS);
+			continue;
+		}
+
+		// A connection that can't be admitted is closed and deleted by the server
+		netconn_set_recvtimeout(conn, relay_recv_timeout);
+		num = ws_server_add_client_raw(conn, "/", relay_callback);
+		if (num < 0) {
+			ESP_LOGW(TAG, "no client slot for the relay");
+			vTaskDelay(pdMS_TO_TICKS(retry_ms));
+			retry_ms = LV_MATH_MIN(2 * retry_ms, RETRY_MAX_MS);
+			continue;
+		}
+		ESP_LOGI(TAG, "relay %s:%d is client %d", relay_host, relay_port, num);
+		retry_ms = RETRY_MIN_MS;
+
+		while (relay_open_slot(num, conn)) {
+			vTaskDelay(pdMS_TO_TICKS(POLL_MS));
+		}
+		ESP_LOGI(TAG, "relay closed");
+	}
+}
+
+
+// Resolves the relay and connects to it
+static struct netconn* relay_open()
+{
+	struct netconn* conn;
+	ip_addr_t addr;
+
+	if (netconn_gethostbyname(relay_host, &addr) != ERR_OK) {
+		ESP_LOGW(TAG, "can't resolve %s", relay_host);
+		return NULL;
+	}
+	conn = netconn_new(NETCONN_TCP);
+	if (conn == NULL) return NULL;
+	if (netconn_connect(conn, &addr, relay_port) != ERR_OK) {
+		ESP_LOGW(TAG, "can't connect to %s:%d", relay_host, relay_port);
+		netconn_delete(conn);
+		return NULL;
+	}
+	return conn;
+}
+
+
+// Whether slot num is still the relay's connection
+static bool relay_open_slot(int num, struct netconn* conn)
+{
+	bool open;
+
+	xSemaphoreTake(xwebsocket_mutex, portMAX_DELAY);
+	open = (clients[num].conn == conn) && ws_is_connected(&clients[num]);
+	xSemaphoreGive(xwebsocket_mutex);
+	return open;
+}
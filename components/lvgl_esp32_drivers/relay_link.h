@@ -0,0 +1,40 @@
+/**
+* Upstream relay link of the LittleVGL websocket driver
+*
+* Keeps one outbound connection to a relay (tools/ws_relay.py) which decodes the
+* stream once and fans it out to any number of browsers, so the device packs and
+* sends each frame once however many people are watching.
+*
+*/
+#ifndef RELAY_LINK_H
+#define RELAY_LINK_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*********************
+ *      INCLUDES
+ *********************/
+#include <stdint.h>
+#include <stdbool.h>
+#include "websocket.h"
+
+
+/**********************
+ *      TYPEDEFS
+ **********************/
+typedef void (*relay_link_cb_t)(uint8_t num, WEBSOCKET_TYPE_t type, char* msg, uint64_t len);
+
+
+/**********************
+ * GLOBAL PROTOTYPES
+ **********************/
+bool relay_link_start(const char* host, uint16_t port, int recv_timeout, relay_link_cb_t callback);
+
+
+#ifdef __cplusplus
+} /* extern "C" */
+#endif
+
+#endif /* RELAY_LINK_H */
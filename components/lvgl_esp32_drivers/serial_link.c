@@ -0,0 +1,211 @@
+/**
+* Serial viewer link of the LittleVGL websocket driver
+*
+* A UART carries the raw viewer protocol: frames with the first byte of a websocket
+* header and a 32 bit big-endian length, unmasked, as on the raw TCP port.  Rather
+* than teach the client slots, the per-client senders and the input path a second kind
+* of connection, the link opens a loopback connection to the raw port and copies bytes
+* both ways, so everything past that port treats a serial viewer as any other.  At 2-3
+* Mbaud the extra copy through lwIP's loopback is small next to the UART.
+*
+* The UART has no connection to follow, so the first bytes the viewer sends open a
+* session, which lasts while it keeps sending (it answers the server's pings, so a live
+* viewer always does).  After IDLE_MS of silence the session is closed, and the next
+* bytes open a new one.  Bytes sent while the loopback can't be opened are dropped.
+*
+*/
+
+/*********************
+ *      INCLUDES
+ *********************/
+#include "serial_link.h"
+#include "websocket_driver.h"
+#include "esp_log.h"
+#include "driver/uart.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "lwip/api.h"
+
+
+/*********************
+ *      DEFINES
+ *********************/
+// Time in mS the viewer may send nothing before its session is closed
+#define IDLE_MS         10000
+
+// UART driver ring buffers.  Received input is small; the transmit ring lets a whole
+// strip be queued while the last one drains.
+#define RX_RING_LEN     2048
+#define TX_RING_LEN     8192
+
+// Bytes read from the UART at a time
+#define RX_CHUNK_LEN    512
+
+// How often the relay to the UART checks for its session closing, in mS
+#define POLL_MS         100
+
+
+/**********************
+ *  STATIC VARIABLES
+ **********************/
+static const char* TAG = "serial_link";
+
+static int port_num;
+static uint16_t raw_port;
+
+// The open session, only changed by to_net_task
+static struct netconn* volatile link = NULL;
+static volatile bool closing = false;
+
+// Given by to_uart_task when it stops using the session
+static SemaphoreHandle_t link_done;
+static TaskHandle_t to_uart_handle;
+
+
+/**********************
+ *  STATIC PROTOTYPES
+ **********************/
+static void to_net_task(void* pvParameters);
+static void to_uart_task(void* pvParameters);
+static struct netconn* link_open();
+static void link_close();
+
+
+/**********************
+ *   GLOBAL FUNCTIONS
+ **********************/
+// Start relaying between UART uart, at baud on tx_pin and rx_pin (-1 for its default
+// pins), and the raw viewer port.  Returns false if the UART can't be set up.
+bool serial_link_start(int uart, int baud, int tx_pin, int rx_pin, uint16_t port)
+{
+	uart_config_t config = {
+		.baud_rate = baud,
+		.data_bits = UART_DATA_8_BITS,
+		.parity = UART_PARITY_DISABLE,
+		.stop_bits = UART_STOP_BITS_1,
+		.flow_ctrl = UART_HW_FLOWCTRL_DISABLE,
+	};
+
+	port_num = uart;
+	raw_port = port;
+	if ((uart_param_config(uart, &config) != ESP_OK) ||
+		(uart_set_pin(uart, (tx_pin < 0) ? UART_PIN_NO_CHANGE : tx_pin, (rx_pin < 0) ? UART_PIN_NO_CHANGE : rx_pin,
+			UART_PIN_NO_CHANGE, UART_PIN_NO_CHANGE) != ESP_OK) ||
+		(uart_driver_install(uart, RX_RING_LEN, TX_RING_LEN, 0, NULL, 0) != ESP_OK)) {
+		ESP_LOGE(TAG, "can't set up UART %d", uart);
+		return false;
+	}
+
+	link_done = xSemaphoreCreateBinary();
+	websocket_driver_create_task(&to_uart_task, "serial_tx_task", 3000, NULL, WS_DRIVER_SERVER_PRIO, &to_uart_handle,
+		WS_DRIVER_NET_CORE, false);
+	websocket_driver_create_task(&to_net_task, "serial_rx_task", 3000, NULL, WS_DRIVER_SERVER_PRIO, NULL,
+		WS_DRIVER_NET_CORE, false);
+	ESP_LOGI(TAG, "serial viewer on UART %d at %d baud", uart, baud);
+	return true;
+}
+
+
+/**********************
+ *   STATIC FUNCTIONS
+ **********************/
+// Copies what the viewer sends into its session, opening it first if need be
+static void to_net_task(void* pvParameters)
+{
+	static uint8_t buf[RX_CHUNK_LEN];
+	size_t avail;
+	int n;
+
+	for (;;) {
+		// uart_read_bytes() waits for all it is asked for, so wait for one byte and
+		// then take what else has arrived
+		n = uart_read_bytes(port_num, buf, 1, pdMS_TO_TICKS(IDLE_MS));
+		if ((n == 1) && (uart_get_buffered_data_len(port_num, &avail) == ESP_OK) && (avail > 0)) {
+			n += uart_read_bytes(port_num, buf + 1, LV_MATH_MIN(avail, sizeof(buf) - 1), 0);
+		}
+
+		// The server may have ended the session meanwhile
+		if ((link != NULL) && (xSemaphoreTake(link_done, 0) == pdTRUE)) {
+			netconn_delete(link);
+			link = NULL;
+			ESP_LOGI(TAG, "session closed by the driver");
+		}
+
+		if (n <= 0) {
+			if (link != NULL) {
+				ESP_LOGI(TAG, "viewer idle, closing its session");
+				link_close();
+			}
+			continue;
+		}
+
+		if (link == NULL) {
+			link = link_open();
+			if (link == NULL) continue;
+			xTaskNotifyGive(to_uart_handle);
+		}
+		if (netconn_write(link, buf, n, NETCONN_COPY) != ERR_OK) {
+			link_close();
+		}
+	}
+}
+
+
+// Copies what the driver sends on the session to the UART, for each session in turn
+static void to_uart_task(void* pvParameters)
+{
+	struct netconn* conn;
+	struct netbuf* inbuf;
+	void* data;
+	u16_t len;
+	err_t err;
+
+	for (;;) {
+		ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+		conn = link;
+		do {
+			err = netconn_recv(conn, &inbuf);
+			if (err == ERR_OK) {
+				do {
+					netbuf_data(inbuf, &data, &len);
+					uart_write_bytes(port_num, data, len);
+				} while (netbuf_next(inbuf) >= 0);
+				netbuf_delete(inbuf);
+			}
+		} while (((err == ERR_OK) || (err == ERR_TIMEOUT)) && !closing);
+		xSemaphoreGive(link_done);
+	}
+}
+
+
+// Connects to the raw viewer port over loopback
+static struct netconn* link_open()
+{
+	struct netconn* conn;
+	ip_addr_t addr;
+
+	IP_ADDR4(&addr, 127, 0, 0, 1);
+	conn = netconn_new(NETCONN_TCP);
+	if (conn == NULL) return NULL;
+	if (netconn_connect(conn, &addr, raw_port) != ERR_OK) {
+		ESP_LOGW(TAG, "can't open a session on port %d", raw_port);
+		netconn_delete(conn);
+		return NULL;
+	}
+	netconn_set_recvtimeout(conn, POLL_MS);
+	closing = false;
+	ESP_LOGI(TAG, "session opened");
+	return conn;
+}
+
+
+// Ends the session once to_uart_task has let go of it
+static void link_close()
+{
+	closing = true;
+	netconn_close(link);
+	xSemaphoreTake(link_done, portMAX_DELAY);
+	netconn_delete(link);
+	link = NULL;
+}
@@ -0,0 +1,33 @@
+/**
+* Serial viewer link of the LittleVGL websocket driver
+*
+* Relays the raw viewer protocol between a UART and the driver's raw TCP port, so a
+* viewer on a USB-UART gets the same sessions, frames and input handling as one on
+* the network.
+*
+*/
+#ifndef SERIAL_LINK_H
+#define SERIAL_LINK_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*********************
+ *      INCLUDES
+ *********************/
+#include <stdint.h>
+#include <stdbool.h>
+
+
+/**********************
+ * GLOBAL PROTOTYPES
+ **********************/
+bool serial_link_start(int uart, int baud, int tx_pin, int rx_pin, uint16_t raw_port);
+
+
+#ifdef __cplusplus
+} /* extern "C" */
+#endif
+
+#endif /* SERIAL_LINK_H */
@@ -0,0 +1,227 @@
+/**
+* Shadow framebuffer for the LittleVGL websocket driver
+*
+* Maintains a copy of what the browsers are displaying so that flushed regions can be
+* compared against it in fixed size tiles.  Only tiles that actually changed need to be
+* sent.  The buffer is allocated in PSRAM when available.
+*
+*/
+
+/*********************
+ *      INCLUDES
+ *********************/
+#include "shadow_fb.h"
+#include "websocket_driver.h"
+
+#if WS_DRIVER_SHADOW
+
+#include "esp_log.h"
+#include "esp_heap_caps.h"
+#include <stdlib.h>
+#include "string.h"
+
+
+/*********************
+ *      DEFINES
+ *********************/
+#define TILE_SIZE WS_DRIVER_TILE_SIZE
+
+
+/**********************
+ *  STATIC VARIABLES
+ **********************/
+static const char* TAG = "shadow_fb";
+
+// Copy of the screen as last sent to the browsers
+static lv_color_t* shadow_buf = NULL;
+static lv_coord_t shadow_w;
+static lv_coord_t shadow_h;
+
+// Per-tile flags forcing a tile to be sent the next time it is flushed even if unchanged
+static uint8_t* force_map = NULL;
+static int tiles_w;
+static int tiles_h;
+
+
+/**********************
+ *   GLOBAL FUNCTIONS
+ **********************/
+bool shadow_fb_init(lv_coord_t hor_res, lv_coord_t ver_res)
+{
+	uint32_t len = (uint32_t) hor_res * ver_res * sizeof(lv_color_t);
+
+	shadow_buf = heap_caps_malloc(len, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+	if (shadow_buf == NULL) {
+		shadow_buf = heap_caps_malloc(len, MALLOC_CAP_8BIT);
+	}
+
+	tiles_w = (hor_res + TILE_SIZE - 1) / TILE_SIZE;
+	tiles_h = (ver_res + TILE_SIZE - 1) / TILE_SIZE;
+	force_map = malloc(tiles_w * tiles_h);
+
+	if ((shadow_buf == NULL) || (force_map == NULL)) {
+		ESP_LOGW(TAG, "Could not allocate %u bytes, running without a shadow framebuffer", len);
+		if (shadow_buf) heap_caps_free(shadow_buf);
+		if (force_map) free(force_map);
+		shadow_buf = NULL;
+		force_map = NULL;
+		return false;
+	}
+
+	shadow_w = hor_res;
+	shadow_h = ver_res;
+	memset(shadow_buf, 0, len);
+	shadow_fb_invalidate();
+
+	ESP_LOGI(TAG, "Allocated %u bytes for a %dx%d shadow framebuffer", len, hor_res, ver_res);
+	return true;
+}
+
+
+bool shadow_fb_enabled()
+{
+	return (shadow_buf != NULL);
+}
+
+
+// Return the shadow framebuffer, loading stride with its width in pixels
+const lv_color_t* shadow_fb_get_buf(lv_coord_t * stride)
+{
+	*stride = shadow_w;
+	return shadow_buf;
+}
+
+
+// Force every tile to be sent the next time it is flushed (e.g. when a new client
+// needs the full screen)
+void shadow_fb_invalidate()
+{
+	if (force_map) {
+		memset(force_map, 1, tiles_w * tiles_h);
+	}
+}
+
+
+// Force the tiles covering area to be sent the next time they are flushed
+void shadow_fb_invalidate_area(const lv_area_t * area)
+{
+	int tx, ty;
+
+	if (force_map) {
+		for (ty = area->y1 / TILE_SIZE; ty <= area->y2 / TILE_SIZE; ty++) {
+			for (tx = area->x1 / TILE_SIZE; tx <= area->x2 / TILE_SIZE; tx++) {
+				force_map[ty * tiles_w + tx] = 1;
+			}
+		}
+	}
+}
+
+
+// Move the pixels inside area by dx, dy as the browsers do for a copy, keeping only
+// those that land inside it
+void shadow_fb_copy(const lv_area_t * area, lv_coord_t dx, lv_coord_t dy)
+{
+	lv_coord_t y, y_end, y_step;
+	lv_coord_t x1, x2;
+	int tx, ty;
+	bool forced = false;
+
+	if (shadow_buf == NULL) return;
+
+	// Rows are moved starting from the side they move towards so none is overwritten
+	// before it is copied
+	x1 = LV_MATH_MAX(area->x1, area->x1 + dx);
+	x2 = LV_MATH_MIN(area->x2, area->x2 + dx);
+	if (dy > 0) {
+		y = area->y2;
+		y_end = area->y1 + dy - 1;
+		y_step = -1;
+	} else {
+		y = area->y1;
+		y_end = area->y2 + dy + 1;
+		y_step = 1;
+	}
+	for (; y != y_end; y += y_step) {
+		memmove(&shadow_buf[y * shadow_w + x1], &shadow_buf[(y - dy) * shadow_w + x1 - dx],
+			(x2 - x1 + 1) * sizeof(lv_color_t));
+	}
+
+	// Tiles still to be sent may have moved anywhere in the area
+	for (ty = area->y1 / TILE_SIZE; ty <= area->y2 / TILE_SIZE; ty++) {
+		for (tx = area->x1 / TILE_SIZE; tx <= area->x2 / TILE_SIZE; tx++) {
+			if (force_map[ty * tiles_w + tx]) forced = true;
+		}
+	}
+	if (forced) {
+		shadow_fb_invalidate_area(area);
+	}
+}
+
+
+// Compare the flushed area against the shadow framebuffer, updating it, and return the
+// changed portions of the area as horizontal spans of tiles.  Returns the number of
+// areas loaded into changed.
+int shadow_fb_update(const lv_area_t * area, const lv_color_t * color_map, lv_area_t * changed, int max_changed)
+{
+	int n = 0;
+	int tx, ty;
+	int span_start;
+	bool tile_changed;
+	lv_coord_t area_w = lv_area_get_width(area);
+	lv_coord_t x1, x2, y, y1, y2;
+	size_t row_len;
+	const lv_color_t* src;
+	lv_color_t* dst;
+
+	for (ty = area->y1 / TILE_SIZE; ty <= area->y2 / TILE_SIZE; ty++) {
+		y1 = LV_MATH_MAX(area->y1, ty * TILE_SIZE);
+		y2 = LV_MATH_MIN(area->y2, ty * TILE_SIZE + TILE_SIZE - 1);
+		span_start = -1;
+
+		for (tx = area->x1 / TILE_SIZE; tx <= area->x2 / TILE_SIZE + 1; tx++) {
+			tile_changed = false;
+
+			if (tx <= area->x2 / TILE_SIZE) {
+				x1 = LV_MATH_MAX(area->x1, tx * TILE_SIZE);
+				x2 = LV_MATH_MIN(area->x2, tx * TILE_SIZE + TILE_SIZE - 1);
+				row_len = (x2 - x1 + 1) * sizeof(lv_color_t);
+
+				tile_changed = force_map[ty * tiles_w + tx] != 0;
+				force_map[ty * tiles_w + tx] = 0;
+
+				for (y = y1; y <= y2; y++) {
+					src = &color_map[(y - area->y1) * area_w + (x1 - area->x1)];
+					dst = &shadow_buf[y * shadow_w + x1];
+					if (memcmp(src, dst, row_len) != 0) {
+						memcpy(dst, src, row_len);
+						tile_changed = true;
+					}
+				}
+			}
+
+			// Collect runs of changed tiles in this tile row into a single span
+			if (tile_changed) {
+				if (span_start < 0) span_start = tx;
+			} else if (span_start >= 0) {
+				if (n < max_changed) {
+					changed[n].x1 = LV_MATH_MAX(area->x1, span_start * TILE_SIZE);
+					changed[n].y1 = y1;
+					changed[n].x2 = LV_MATH_MIN(area->x2, tx * TILE_SIZE - 1);
+					changed[n].y2 = y2;
+				}
+				n++;
+				span_start = -1;
+			}
+		}
+	}
+
+	if (n > max_changed) {
+		// Too fragmented, just send the whole area
+		lv_area_copy(&changed[0], area);
+		n = 1;
+	}
+
+	return n;
+}
+
+#endif /* WS_DRIVER_SHADOW */
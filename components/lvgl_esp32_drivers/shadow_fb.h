@@ -0,0 +1,40 @@
+/**
+* Shadow framebuffer for the LittleVGL websocket driver
+*
+* Maintains a copy of what the browsers are displaying so that flushed regions can be
+* compared against it in fixed size tiles.  Only tiles that actually changed need to be
+* sent.  The buffer is allocated in PSRAM when available.
+*
+*/
+#ifndef SHADOW_FB_H
+#define SHADOW_FB_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*********************
+ *      INCLUDES
+ *********************/
+#include <stdint.h>
+#include <stdbool.h>
+#include "lvgl/lvgl.h"
+
+
+/**********************
+ * GLOBAL PROTOTYPES
+ **********************/
+bool shadow_fb_init(lv_coord_t hor_res, lv_coord_t ver_res);
+bool shadow_fb_enabled();
+const lv_color_t* shadow_fb_get_buf(lv_coord_t * stride);
+void shadow_fb_invalidate();
+void shadow_fb_invalidate_area(const lv_area_t * area);
+void shadow_fb_copy(const lv_area_t * area, lv_coord_t dx, lv_coord_t dy);
+int shadow_fb_update(const lv_area_t * area, const lv_color_t * color_map, lv_area_t * changed, int max_changed);
+
+
+#ifdef __cplusplus
+} /* extern "C" */
+#endif
+
+#endif /* SHADOW_FB_H */
@@ -0,0 +1,286 @@
+/**
+* Render and transport trace recorder for the LittleVGL websocket driver
+*
+* Events are recorded by the LVGL, sender, client sender and websocket server tasks
+* into a ring buffer guarded by a spinlock, so recording costs a timestamp and a
+* short copy.  Spans are recorded when they end, with the time they started.
+* Recording pauses while the buffer is being downloaded.
+*
+* Events are identified by the task that recorded them.  Only tasks that live as long
+* as the driver record events, so their names can still be looked up when the trace
+* is downloaded.
+*
+*/
+
+/*********************
+ *      INCLUDES
+ *********************/
+#include "trace_rec.h"
+#include "websocket_driver.h"
+#include "esp_log.h"
+#include "esp_heap_caps.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+
+/*********************
+ *      DEFINES
+ *********************/
+// Distinct recording tasks named in a download
+#define MAX_TRACE_TASKS 32
+
+// Size of the buffer each part of a download is formatted into, and the most one
+// event can take
+#define CHUNK_LEN       1024
+#define EVENT_JSON_LEN  192
+
+
+/**********************
+ *      TYPEDEFS
+ **********************/
+typedef struct
+{
+	uint32_t start;      // esp_timer time in uS
+	uint32_t dur;        // Length in uS, 0 for pointer events
+	TaskHandle_t task;   // Task that recorded the event
+	uint8_t type;
+	uint8_t num;         // Client number
+	lv_area_t area;      // Area, or x, y and flag for pointer events
+	uint32_t bytes;      // Bytes, or the sequence number for pointer events
+} trace_event_t;
+
+
+/**********************
+ *  STATIC VARIABLES
+ **********************/
+static const char* TAG = "trace_rec";
+
+static const char* type_names[] = {"refresh", "render", "flush", "pack", "write", "input"};
+
+static trace_event_t* events = NULL;
+static uint32_t max_events;
+static uint32_t head = 0;             // Events recorded, the next goes at head % max_events
+static bool paused = false;
+static portMUX_TYPE trace_mux = portMUX_INITIALIZER_UNLOCKED;
+
+
+/**********************
+ *  STATIC PROTOTYPES
+ **********************/
+static trace_event_t* trace_alloc_locked();
+static int trace_task_id(TaskHandle_t* tasks, int* num_tasks, TaskHandle_t task);
+static int trace_json(char* buf, const trace_event_t* e, uint32_t base, int tid);
+
+
+/**********************
+ *   GLOBAL FUNCTIONS
+ **********************/
+// Allocate the buffer for num_events events, in PSRAM when the board has it
+bool trace_rec_init(uint32_t num_events)
+{
+	uint32_t caps = MALLOC_CAP_8BIT;
+
+	if (heap_caps_get_free_size(MALLOC_CAP_SPIRAM) > 0) {
+		caps |= MALLOC_CAP_SPIRAM;
+	}
+	events = heap_caps_malloc(num_events * sizeof(trace_event_t), caps);
+	if (events == NULL) {
+		ESP_LOGE(TAG, "Could not allocate %u trace events", num_events);
+		return false;
+	}
+	max_events = num_events;
+	ESP_LOGI(TAG, "Recording the last %u events", num_events);
+	return true;
+}
+
+
+// Time in uS for the start of a span
+uint32_t trace_rec_now()
+{
+	return (uint32_t) esp_timer_get_time();
+}
+
+
+// Record a span of type that started at start and ends now, for client num when it
+// is a write, covering area (NULL for none) and bytes
+void trace_rec_span(uint8_t type, uint32_t start, uint8_t num, const lv_area_t* area, uint32_t bytes)
+{
+	uint32_t now = trace_rec_now();
+	trace_event_t* e;
+
+	portENTER_CRITICAL(&trace_mux);
+	e = trace_alloc_locked();
+	if (e != NULL) {
+		e->start = start;
+		e->dur = now - start;
+		e->type = type;
+		e->num = num;
+		if (area != NULL) {
+			lv_area_copy(&e->area, area);
+		} else {
+			lv_area_set(&e->area, 0, 0, -1, -1);
+		}
+		e->bytes = bytes;
+	}
+	portEXIT_CRITICAL(&trace_mux);
+}
+
+
+// Record a pointer event received from client num
+void trace_rec_input(uint8_t num, uint8_t flag, uint16_t x, uint16_t y, uint16_t seq)
+{
+	uint32_t now = trace_rec_now();
+	trace_event_t* e;
+
+	portENTER_CRITICAL(&trace_mux);
+	e = trace_alloc_locked();
+	if (e != NULL) {
+		e->start = now;
+		e->dur = 0;
+		e->type = TRACE_INPUT;
+		e->num = num;
+		e->area.x1 = x;
+		e->area.y1 = y;
+		e->area.x2 = flag;
+		e->area.y2 = 0;
+		e->bytes = seq;
+	}
+	portEXIT_CRITICAL(&trace_mux);
+}
+
+
+// Send the recorded events on conn as a Chrome trace JSON download, oldest first with
+// times relative to the oldest.  Events aren't recorded while this runs.
+void trace_rec_write(struct netconn* conn)
+{
+	const static char HEADER[] = "HTTP/1.1 200 OK\r\nContent-Type: application/json\r\n"
+		"Content-Disposition: attachment; filename=\"trace.json\"\r\nCache-Control: no-store\r\n"
+		"Connection: close\r\n\r\n";
+	const static char NOT_AVAILABLE[] = "HTTP/1.1 503 Service Unavailable\r\nContent-Length: 0\r\n\r\n";
+	TaskHandle_t tasks[MAX_TRACE_TASKS];
+	int num_tasks = 0;
+	char* buf;
+	uint32_t first, last, i, base;
+	const trace_event_t* e;
+	int n, t;
+	bool comma = false;
+
+	buf = malloc(CHUNK_LEN);
+	if ((buf == NULL) || (events == NULL)) {
+		free(buf);
+		netconn_write(conn, NOT_AVAILABLE, sizeof(NOT_AVAILABLE) - 1, NETCONN_NOCOPY);
+		return;
+	}
+
+	portENTER_CRITICAL(&trace_mux);
+	paused = true;
+	last = head;
+	portEXIT_CRITICAL(&trace_mux);
+
+	first = (last > max_events) ? last - max_events : 0;
+	base = (last != first) ? events[first % max_events].start : 0;
+
+	netconn_write(conn, HEADER, sizeof(HEADER) - 1, NETCONN_NOCOPY);
+	n = sprintf(buf, "{\"traceEvents\":[");
+	for (i=first; i!=last; i++) {
+		e = &events[i % max_events];
+		if (n > (CHUNK_LEN - EVENT_JSON_LEN)) {
+			netconn_write(conn, buf, n, NETCONN_COPY);
+			n = 0;
+		}
+		if (comma) buf[n++] = ',';
+		n += trace_json(&buf[n], e, base, trace_task_id(tasks, &num_tasks, e->task));
+		comma = true;
+	}
+
+	// Name each task's track
+	for (t=0; t<num_tasks; t++) {
+		if (n > (CHUNK_LEN - EVENT_JSON_LEN)) {
+			netconn_write(conn, buf, n, NETCONN_COPY);
+			n = 0;
+		}
+		if (comma) buf[n++] = ',';
+		n += sprintf(&buf[n], "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"%s\"}}",
+			t, pcTaskGetTaskName(tasks[t]));
+		comma = true;
+	}
+	if (n > (CHUNK_LEN - EVENT_JSON_LEN)) {
+		netconn_write(conn, buf, n, NETCONN_COPY);
+		n = 0;
+	}
+	n += sprintf(&buf[n], "],\"displayTimeUnit\":\"ms\"}");
+	netconn_write(conn, buf, n, NETCONN_COPY);
+
+	portENTER_CRITICAL(&trace_mux);
+	paused = false;
+	portEXIT_CRITICAL(&trace_mux);
+
+	free(buf);
+}
+
+
+/**********************
+ *   STATIC FUNCTIONS
+ **********************/
+// Returns the slot for the next event, overwriting the oldest, or NULL while paused.
+// Call with trace_mux held.
+static trace_event_t* trace_alloc_locked()
+{
+	trace_event_t* e;
+
+	if (paused || (events == NULL)) return NULL;
+	e = &events[head % max_events];
+	head++;
+	e->task = xTaskGetCurrentTaskHandle();
+	return e;
+}
+
+
+// Return the track number of task, adding it to tasks if it is new.  Tasks beyond
+// MAX_TRACE_TASKS share the last track.
+static int trace_task_id(TaskHandle_t* tasks, int* num_tasks, TaskHandle_t task)
+{
+	int i;
+
+	for (i=0; i<*num_tasks; i++) {
+		if (tasks[i] == task) return i;
+	}
+	if (*num_tasks == MAX_TRACE_TASKS) return MAX_TRACE_TASKS - 1;
+	tasks[i] = task;
+	(*num_tasks)++;
+	return i;
+}
+
+
+// Load buf with the JSON of one event on track tid, returning its length, at most
+// EVENT_JSON_LEN - 1
+static int trace_json(char* buf, const trace_event_t* e, uint32_t base, int tid)
+{
+	int n;
+
+	if (e->type == TRACE_INPUT) {
+		return sprintf(buf, "{\"name\":\"%s\",\"ph\":\"i\",\"s\":\"g\",\"ts\":%u,\"pid\":1,\"tid\":%d,"
+			"\"args\":{\"client\":%u,\"x\":%d,\"y\":%d,\"pressed\":%d,\"seq\":%u}}",
+			type_names[e->type], e->start - base, tid, e->num, e->area.x1, e->area.y1, e->area.x2, e->bytes);
+	}
+
+	n = sprintf(buf, "{\"name\":\"%s\",\"ph\":\"X\",\"ts\":%u,\"dur\":%u,\"pid\":1,\"tid\":%d,\"args\":{",
+		type_names[e->type], e->start - base, e->dur, tid);
+	if (e->type == TRACE_WRITE) {
+		n += sprintf(&buf[n], "\"client\":%u,", e->num);
+	}
+	if (e->area.x2 >= e->area.x1) {
+		n += sprintf(&buf[n], "\"x1\":%d,\"y1\":%d,\"x2\":%d,\"y2\":%d,",
+			e->area.x1, e->area.y1, e->area.x2, e->area.y2);
+	}
+	if ((e->type == TRACE_PACK) || (e->type == TRACE_WRITE)) {
+		n += sprintf(&buf[n], "\"bytes\":%u,", e->bytes);
+	}
+	// Replace the trailing comma, if any, with the end of the arguments
+	if (buf[n - 1] == ',') n--;
+	n += sprintf(&buf[n], "}}");
+	return n;
+}
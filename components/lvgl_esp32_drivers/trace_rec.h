@@ -0,0 +1,53 @@
+/**
+* Render and transport trace recorder for the LittleVGL websocket driver
+*
+* Keeps the last WS_DRIVER_TRACE_EVENTS timestamped events of LittleVGL's refreshes, the
+* parts of areas it renders, the flushes handed to the sender, the messages packed
+* and written to each client and the pointer events received, in a ring buffer.  The
+* buffer is downloaded as Chrome trace JSON (chrome://tracing or ui.perfetto.dev) so
+* the time a frame spent in each task can be seen on one timeline.
+*
+*/
+#ifndef TRACE_REC_H
+#define TRACE_REC_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*********************
+ *      INCLUDES
+ *********************/
+#include <stdint.h>
+#include <stdbool.h>
+#include "lvgl/lvgl.h"
+#include "lwip/api.h"
+
+
+/*********************
+ *      DEFINES
+ *********************/
+// Event types
+#define TRACE_REFR   0    // LittleVGL refresh of the invalidated areas
+#define TRACE_RENDER 1    // Rendering a part of an area, its area
+#define TRACE_FLUSH  2    // Handing a rendered buffer to the sender, its area
+#define TRACE_PACK   3    // Packing a message, its area and bytes
+#define TRACE_WRITE  4    // Writing a message to a client, its area and bytes
+#define TRACE_INPUT  5    // Pointer event received from a client
+
+
+/**********************
+ * GLOBAL PROTOTYPES
+ **********************/
+bool trace_rec_init(uint32_t num_events);
+uint32_t trace_rec_now();
+void trace_rec_span(uint8_t type, uint32_t start, uint8_t num, const lv_area_t* area, uint32_t bytes);
+void trace_rec_input(uint8_t num, uint8_t flag, uint16_t x, uint16_t y, uint16_t seq);
+void trace_rec_write(struct netconn* conn);
+
+
+#ifdef __cplusplus
+} /* extern "C" */
+#endif
+
+#endif /* TRACE_REC_H */
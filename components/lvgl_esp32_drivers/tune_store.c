@@ -0,0 +1,212 @@
+/**
+* Runtime tuning of the LittleVGL websocket driver
+*
+* The parameters are saved as one blob in the driver's NVS namespace.  One saved by a
+* build whose websocket_driver_config_t differs in size is ignored, so a firmware
+* update that adds parameters starts again from its menuconfig values.
+*
+* Each parameter has a name and the range it may be set in.  A request setting several
+* sets none of them if any is unknown or out of range.  A preset named in a request sets
+* the parameters it covers, and those named after it change its values.
+*
+*/
+
+/*********************
+ *      INCLUDES
+ *********************/
+#include "tune_store.h"
+#include "esp_log.h"
+#include "nvs.h"
+#include "websocket_server.h"
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+
+/*********************
+ *      DEFINES
+ *********************/
+#define NVS_NAMESPACE "ws_driver"
+#define NVS_KEY "config"
+
+#define NUM_PARAMS (sizeof(params) / sizeof(params[0]))
+
+
+/**********************
+ *      TYPEDEFS
+ **********************/
+typedef struct
+{
+	const char* name;
+	uint16_t offset;   // Of its field in websocket_driver_config_t
+	uint32_t min;
+	uint32_t max;
+} param_t;
+
+
+/**********************
+ *  STATIC VARIABLES
+ **********************/
+static const char* TAG = "tune_store";
+
+static const param_t params[] = {
+	{ "max_lines", offsetof(websocket_driver_config_t, max_lines), WS_DRIVER_MIN_LINES, LV_VER_RES_MAX },
+	{ "frame_size", offsetof(websocket_driver_config_t, frame_size), 0, 65536 },
+	{ "lvgl_stack", offsetof(websocket_driver_config_t, lvgl_stack), 2048, 32768 },
+	{ "lvgl_prio", offsetof(websocket_driver_config_t, lvgl_prio), 1, configMAX_PRIORITIES - 1 },
+	{ "sender_prio", offsetof(websocket_driver_config_t, sender_prio), 1, configMAX_PRIORITIES - 1 },
+	{ "credits", offsetof(websocket_driver_config_t, credits), 0, 16 },
+	{ "fragment", offsetof(websocket_driver_config_t, fragment), 0, 65535 },
+	{ "frame_budget", offsetof(websocket_driver_config_t, frame_budget), 0, 1000 },
+	{ "preempt", offsetof(websocket_driver_config_t, preempt), 0, 1000 },
+	{ "refr_slice", offsetof(websocket_driver_config_t, refr_slice), 0, 5000 },
+	{ "near_first", offsetof(websocket_driver_config_t, near_first), 0, 1000 },
+	{ "refr_period", offsetof(websocket_driver_config_t, refr_period), 1, 1000 },
+	{ "max_clients", offsetof(websocket_driver_config_t, max_clients), 1, WEBSOCKET_SERVER_MAX_CLIENTS },
+	{ "wifi_save", offsetof(websocket_driver_config_t, wifi_save), 0, 1 },
+	{ "encodings", offsetof(websocket_driver_config_t, encodings), 0, 15 },
+};
+
+// Names of the performance presets, by number
+static const char* presets[] = { "custom", "throughput", "latency", "low_memory" };
+
+
+/**********************
+ *  STATIC PROTOTYPES
+ **********************/
+static const param_t* find_param(const char* name, int len);
+static int find_preset(const char* name, int len);
+
+
+/**********************
+ *   GLOBAL FUNCTIONS
+ **********************/
+// Load the saved parameters into cfg, leaving it as it is and returning false if none
+// were saved
+bool tune_store_load(websocket_driver_config_t* cfg)
+{
+	websocket_driver_config_t saved;
+	size_t len = sizeof(saved);
+	nvs_handle handle;
+	esp_err_t err;
+	
+	if (nvs_open(NVS_NAMESPACE, NVS_READONLY, &handle) != ESP_OK) return false;
+	err = nvs_get_blob(handle, NVS_KEY, &saved, &len);
+	nvs_close(handle);
+	if ((err != ESP_OK) || (len != sizeof(saved))) return false;
+	
+	*cfg = saved;
+	ESP_LOGI(TAG, "Using the saved configuration");
+	return true;
+}
+
+
+bool tune_store_save(const websocket_driver_config_t* cfg)
+{
+	nvs_handle handle;
+	esp_err_t err;
+	
+	if (nvs_open(NVS_NAMESPACE, NVS_READWRITE, &handle) != ESP_OK) return false;
+	err = nvs_set_blob(handle, NVS_KEY, cfg, sizeof(*cfg));
+	if (err == ESP_OK) err = nvs_commit(handle);
+	nvs_close(handle);
+	if (err != ESP_OK) ESP_LOGE(TAG, "Could not save the configuration");
+	return (err == ESP_OK);
+}
+
+
+// Forget the saved parameters, so the next start uses the menuconfig values
+bool tune_store_erase()
+{
+	nvs_handle handle;
+	esp_err_t err;
+	
+	if (nvs_open(NVS_NAMESPACE, NVS_READWRITE, &handle) != ESP_OK) return false;
+	err = nvs_erase_key(handle, NVS_KEY);
+	if (err == ESP_OK) err = nvs_commit(handle);
+	nvs_close(handle);
+	return (err == ESP_OK) || (err == ESP_ERR_NVS_NOT_FOUND);
+}
+
+
+// Set the parameters named in a query string of name=value pairs separated by &,
+// changing cfg only if every one is known and in range
+bool tune_store_parse(websocket_driver_config_t* cfg, const char* query, uint16_t len)
+{
+	websocket_driver_config_t tuned = *cfg;
+	const char* end = query + len;
+	const char* p = query;
+	const char* eq;
+	const char* amp;
+	const param_t* param;
+	char value[12];
+	char* value_end;
+	unsigned long v;
+	
+	while (p < end) {
+		amp = memchr(p, '&', end - p);
+		if (amp == NULL) amp = end;
+		eq = memchr(p, '=', amp - p);
+		if ((eq == NULL) || ((amp - eq - 1) == 0) || ((amp - eq - 1) >= (int) sizeof(value))) return false;
+		if (((eq - p) == 6) && (memcmp(p, "preset", 6) == 0)) {
+			if (!websocket_driver_config_preset(&tuned, find_preset(eq + 1, amp - eq - 1))) return false;
+			p = amp + 1;
+			continue;
+		}
+		param = find_param(p, eq - p);
+		if (param == NULL) return false;
+		
+		memcpy(value, eq + 1, amp - eq - 1);
+		value[amp - eq - 1] = '\0';
+		v = strtoul(value, &value_end, 10);
+		if ((*value_end != '\0') || (v < param->min) || (v > param->max)) return false;
+		*(uint32_t*) ((uint8_t*) &tuned + param->offset) = v;
+		p = amp + 1;
+	}
+	
+	*cfg = tuned;
+	return true;
+}
+
+
+// Write the parameters as a JSON object into buf, returning its length
+int tune_store_format(const websocket_driver_config_t* cfg, char* buf, int len)
+{
+	int n = 0;
+	int i;
+	
+	n += snprintf(buf + n, len - n, "{");
+	for (i=0; (i<NUM_PARAMS) && (n < len); i++) {
+		n += snprintf(buf + n, len - n, "%s\"%s\":%u", (i == 0) ? "" : ",", params[i].name,
+			(unsigned) *(const uint32_t*) ((const uint8_t*) cfg + params[i].offset));
+	}
+	if (n < len) n += snprintf(buf + n, len - n, "}\n");
+	return (n < len) ? n : len - 1;
+}
+
+
+/**********************
+ *   STATIC FUNCTIONS
+ **********************/
+static const param_t* find_param(const char* name, int len)
+{
+	int i;
+	
+	for (i=0; i<NUM_PARAMS; i++) {
+		if ((strlen(params[i].name) == len) && (memcmp(params[i].name, name, len) == 0)) return &params[i];
+	}
+	return NULL;
+}
+
+
+// Returns the number of the preset named, or -1
+static int find_preset(const char* name, int len)
+{
+	int i;
+	
+	for (i=0; i<(sizeof(presets) / sizeof(presets[0])); i++) {
+		if ((strlen(presets[i]) == len) && (memcmp(presets[i], name, len) == 0)) return i;
+	}
+	return -1;
+}
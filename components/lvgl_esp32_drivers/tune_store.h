@@ -0,0 +1,37 @@
+/**
+* Runtime tuning of the LittleVGL websocket driver
+*
+* Keeps the driver's tunable parameters in NVS and converts them to and from the JSON
+* served on /config and the name=value pairs posted to it.
+*
+*/
+#ifndef TUNE_STORE_H
+#define TUNE_STORE_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*********************
+ *      INCLUDES
+ *********************/
+#include <stdint.h>
+#include <stdbool.h>
+#include "websocket_driver.h"
+
+
+/**********************
+ * GLOBAL PROTOTYPES
+ **********************/
+bool tune_store_load(websocket_driver_config_t* cfg);
+bool tune_store_save(const websocket_driver_config_t* cfg);
+bool tune_store_erase();
+bool tune_store_parse(websocket_driver_config_t* cfg, const char* query, uint16_t len);
+int tune_store_format(const websocket_driver_config_t* cfg, char* buf, int len);
+
+
+#ifdef __cplusplus
+} /* extern "C" */
+#endif
+
+#endif /* TUNE_STORE_H */
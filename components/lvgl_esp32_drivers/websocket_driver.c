@@ -15,6 +15,7 @@
 #include "websocket_driver.h"
 #include "esp_system.h"
 #include "esp_log.h"
+#include "esp_heap_caps.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "freertos/queue.h"
@@ -22,17 +23,388 @@
 #include "lwip/api.h"
 #include "lwip/tcp.h"
 #include "lvgl.h"
+#include "lvgl/src/lv_misc/lv_gc.h"
 #include "string.h"
+#include <stdio.h>
 #include "websocket.h"
 #include "websocket_server.h"
+#include "shadow_fb.h"
+#include "frame_tx.h"
+#include "esp_timer.h"
+#if WS_DRIVER_BENCHMARK
+#include "e2e_bench.h"
+#endif
+#if WS_DRIVER_PIPE_MON
+#include "pipe_mon.h"
+#endif
+#if WS_DRIVER_TRACE
+#include "trace_rec.h"
+#endif
+#if WS_DRIVER_INPUT_REC
+#include "input_rec.h"
+#endif
+#if WS_DRIVER_CAPTURE
+#include "capture_rec.h"
+#endif
+#if WS_DRIVER_WIFI_LINK
+#include "wifi_link.h"
+#endif
+#if WS_DRIVER_WIFI_POWER
+#include "wifi_power.h"
+#endif
+#if WS_DRIVER_SERIAL
+#include "serial_link.h"
+#endif
+#if WS_DRIVER_LCD
+#include "lcd_panel.h"
+#endif
+#if WS_DRIVER_RELAY
+#include "relay_link.h"
+#endif
+#if WS_DRIVER_DRAW_STREAM
+#include "draw_stream.h"
+#endif
+#if WS_DRIVER_ASSETS
+#include "asset_fs.h"
+#endif
+#if WS_DRIVER_IMG_DEC
+#include "img_dec.h"
+#endif
+#if WS_DRIVER_SNAPSHOT
+#include "png_enc.h"
+#endif
+#if WS_DRIVER_TUNE
+#include "tune_store.h"
+#endif
 
 
 /*********************
  *      DEFINES
  *********************/
+// Region header, followed by the echoed input sequence number when that is enabled
+#if WS_DRIVER_INPUT_SEQ
+#define PIXEL_BUF_HEADER_LEN  15
+#else
 #define PIXEL_BUF_HEADER_LEN  13
-#define WS_BUF_HEADER_MAX_LEN 10
-#define STATIC_BUF_EXTRA_LEN  (PIXEL_BUF_HEADER_LEN + WS_BUF_HEADER_MAX_LEN)
+#endif
+
+// Aligned region header, for browsers announcing ENC_CAP_ALIGNED, see pack_header().
+// Its data is padded to a multiple of 4 bytes, so a region can take this many more
+// bytes than its data with either header.
+#define PIXEL_ALIGNED_HEADER_LEN 16
+#if WS_DRIVER_ALIGNED
+#define PIXEL_REGION_EXTRA_LEN (PIXEL_ALIGNED_HEADER_LEN + 3)
+
+// The second byte of an aligned header, where the other has the upper byte of the
+// screen width, which never has bit 7 set
+#define PIXEL_ALIGNED_MARK    (0x80 | PIXEL_ALIGNED_HEADER_LEN)
+#else
+#define PIXEL_REGION_EXTRA_LEN PIXEL_BUF_HEADER_LEN
+#endif
+
+// Maximum number of changed regions sent in one message when the shadow framebuffer
+// or full-frame buffers are enabled, each region requiring its own pixel header
+#if WS_DRIVER_SHADOW || WS_DRIVER_FULL_FRAME
+#define MAX_FLUSH_REGIONS     32
+#else
+#define MAX_FLUSH_REGIONS     1
+#endif
+
+// The websocket header is sent separately so frames only hold the payload
+#define STATIC_BUF_EXTRA_LEN  (MAX_FLUSH_REGIONS * PIXEL_REGION_EXTRA_LEN)
+
+// Room left in front of each draw buffer for the header of a strip sent from it,
+// keeping the pixels word aligned.  Either header fits.
+#if WS_DRIVER_ZERO_COPY
+#define DRAW_BUF_HEADROOM     ((PIXEL_BUF_HEADER_LEN + 3) & ~3)
+#else
+#define DRAW_BUF_HEADROOM     0
+#endif
+
+// Frames are either large enough for a whole flush or a fixed size, in which case
+// regions are split across as many messages as they need
+#if (WS_DRIVER_FRAME_SIZE != 0) && (WS_DRIVER_FRAME_SIZE < (PIXEL_REGION_EXTRA_LEN + LV_HOR_RES_MAX * ((LV_COLOR_DEPTH + 7) / 8)))
+#error "Frame buffer size must hold at least one row of pixels"
+#endif
+
+// Sets of clients are passed around as one bit per client
+#if WEBSOCKET_SERVER_MAX_CLIENTS > 32
+#error "The driver supports at most 32 websocket clients"
+#endif
+
+// Pointer events buffered between LVGL input reads (must be a power of 2)
+#define POINTER_RING_LEN      32
+
+// Sessions, each with its own display and pointer: one per client slot when every
+// browser gets its own display, otherwise one shared by all of them
+#if WS_DRIVER_SESSIONS
+#define NUM_SESSIONS          WEBSOCKET_SERVER_MAX_CLIENTS
+#else
+#define NUM_SESSIONS          1
+#endif
+
+// Age in mS after which queued pointer moves are skipped rather than replayed
+#define POINTER_STALE_MS      1000
+
+// A browser's batch of the pointer moves made during one animation frame: MOVES_MAGIC,
+// the number of moves, the big-endian sequence number of the batch and then for each
+// move, oldest first, its big-endian x and y and how many mS before the batch was sent
+// it was made, up to 255.  Presses and releases are always sent on their own.
+#define MOVES_MAGIC           'M'
+#define MOVES_HDR_LEN         4
+#define MOVE_LEN              5
+
+// A browser's batch of the pointer events made during one animation frame in protocol
+// version 2: INPUT_MAGIC, the sequence number of the batch as a varint and then each
+// event, oldest first.  An event is a byte with the pointer it is for in bits 7:4 and
+// the buttons held after it in bits 3:0, then the change in its x and y since that
+// pointer's last event in the batch, from 0, 0 for its first, as zigzag varints, and
+// the mS since the event before as a varint, for the first how long before the batch
+// was sent it was made.  Varints are 7 bits a byte, least significant first, with bit 7
+// set in all but the last byte.  Pointer 0 is the mouse or the first touch and drives
+// LittlevGL's pointer, pressed while INPUT_PRESSED is held.
+#define INPUT_MAGIC           'I'
+#define INPUT_MIN_LEN         6
+#define INPUT_POINTERS        16
+#define INPUT_PRESSED         0x01
+
+// A browser scrolling what is under a point, as a mouse wheel or trackpad does:
+// SCROLL_MAGIC, SCROLL_BY or SCROLL_FLING, the big-endian x and y of the point and then
+// the big-endian signed x and y distance in pixels, or with SCROLL_FLING the velocity in
+// pixels per second.  Positive values scroll right and down, moving the content left and
+// up like the browser's own wheel deltas.
+#define SCROLL_MAGIC          'W'
+#define SCROLL_LEN            10
+#define SCROLL_BY             0
+#define SCROLL_FLING          1
+
+// mS without scroll deltas after which a scroll ends, so for example a roller settles
+#define SCROLL_END_MS         150
+
+// A browser's batch of the keys typed during one animation frame: KEYS_MAGIC, the number
+// of keys and then each key's big-endian Unicode code point, or the LV_KEY_ code of an
+// editing or navigation key.  Each key is pressed and released.
+#define KEYS_MAGIC            'K'
+#define KEYS_HDR_LEN          2
+#define KEY_LEN               4
+
+// Keys buffered between LVGL keypad reads (must be a power of 2)
+#define KEY_RING_LEN          64
+
+// A browser's viewport, sent whenever the part of the screen it shows changes:
+// VIEWPORT_MAGIC and the big-endian x, y, width and height of that part.  The browser is
+// then only sent what changes there.
+#define VIEWPORT_MAGIC        'V'
+#define VIEWPORT_LEN          9
+
+// A browser asking for the screen scaled down by 2^shift: SCALE_MAGIC and the shift, at
+// most THUMB_MAX_SHIFT.  A shift of 0 goes back to full size.
+#define SCALE_MAGIC           'Z'
+#define SCALE_LEN             2
+#define THUMB_MAX_SHIFT       2
+
+// A browser's page being hidden or shown: VISIBLE_MAGIC and 0 when hidden, 1 when shown.
+// A hidden browser is sent nothing until it is shown, then what it missed.
+#define VISIBLE_MAGIC         'S'
+#define VISIBLE_LEN           2
+
+// Time in mS an HTTP handler waits for a request before serving other connections
+#define HTTP_POLL_MS          50
+
+// Time in mS an accepted connection may stay silent before it is closed
+#define HTTP_IDLE_MS          1000
+
+// Longest request read through a TLS session
+#define TLS_REQ_LEN           1024
+
+// Period in mS at which clients that dropped frames are checked for having caught up
+#define RESYNC_PERIOD_MS      50
+
+// Longest time in mS LVGL blocks in websocket_driver_wait() before checking its buffer
+#define FLUSH_WAIT_MS         100
+
+// Interval in mS over which the slowest client's load is measured to adapt the
+// refresh period, and the percentage of its time the client should be busy writing
+#define ADAPT_INTERVAL_MS     250
+#define ADAPT_LOAD_PCT        75
+
+// Length of a telemetry message: the display fields and one entry per client
+#define TELEMETRY_LEN         (128 + WEBSOCKET_SERVER_MAX_CLIENTS * 160)
+
+#if WS_DRIVER_HEATMAP
+// Heatmap tiles across the largest display, and the length of a heatmap message: its
+// fields and two counts of up to 9 digits per tile
+#define HEAT_TILES            (((LV_HOR_RES_MAX + WS_DRIVER_HEATMAP_TILE - 1) / WS_DRIVER_HEATMAP_TILE) * \
+                               ((LV_VER_RES_MAX + WS_DRIVER_HEATMAP_TILE - 1) / WS_DRIVER_HEATMAP_TILE))
+#define HEATMAP_LEN           (128 + HEAT_TILES * 20)
+#endif
+
+// Length of the /metrics text: the heap, LVGL memory and client lines, and the lines
+// for each task
+#define METRICS_LEN           (2048 + WEBSOCKET_SERVER_MAX_CLIENTS * 320 + METRICS_PROF_LEN + METRICS_TASK_PROF_LEN)
+#define METRICS_TASK_LEN      160
+
+// Objects listed by LVGL's draw profiler, longest to draw first, and the length of
+// its lines for them and each object type
+#define METRICS_PROF_OBJS     10
+#if LV_USE_REFR_PROF
+#define METRICS_PROF_LEN      ((LV_REFR_PROF_TYPES + 1 + METRICS_PROF_OBJS) * 224)
+#else
+#define METRICS_PROF_LEN      0
+#endif
+
+// LVGL tasks listed by its task profiler, longest running first, and the length of
+// their lines
+#define METRICS_TASK_PROFS    16
+#if LV_USE_TASK_PROF
+#define METRICS_TASK_PROF_LEN (METRICS_TASK_PROFS * 256 + 128)
+#else
+#define METRICS_TASK_PROF_LEN 0
+#endif
+
+// Time in mS /metrics waits for the LVGL task to read LVGL's memory monitor
+#define METRICS_MEM_WAIT_MS   100
+
+// Time in mS /snapshot waits for the LVGL task to draw a screen no browser has seen
+#define SNAPSHOT_WAIT_MS      500
+
+// Time in mS between tries to apply a WiFi power profile before WiFi has started
+#define WIFI_POWER_RETRY_MS   1000
+
+// Pixel data encodings carried in bits 7:6 of the pixel depth byte
+#define PIXEL_ENC_RAW         0x00
+#define PIXEL_ENC_RLE         0x40
+
+// In place of pixel data, the header is followed by the 16-bit x and y of the source of a
+// copy to the region, see websocket_driver_copy()
+#define PIXEL_ENC_COPY        0x80
+
+// In place of pixel data, the header is followed by a single pixel the whole region is
+// filled with
+#define PIXEL_ENC_FILL        0xC0
+
+// Set in the pixel depth byte when each pixel is the little-endian lv_color_t value
+#define PIXEL_ORDER_LE        0x01
+
+// Set in the pixel depth byte when the header is followed by a 16-bit input sequence
+// number
+#define PIXEL_INPUT_SEQ       0x02
+
+// Set in a browser's viewer options message to be sent approximate pixels
+#define VIEW_LOSSY            0x01
+
+// Set in the pixel depth byte of a raw region when its pixel data is a palette of
+// colours followed by the index of each pixel's colour in it, see pack_palette()
+#define PIXEL_PALETTE         0x04
+
+// Native pixels are copied as-is so their byte order depends on the color format.
+// Swapped 16-bit colors are already in the big-endian order of the default format.
+#if WS_DRIVER_NATIVE && ((LV_COLOR_DEPTH == 32) || ((LV_COLOR_DEPTH == 16) && (LV_COLOR_16_SWAP == 0)))
+#define PIXEL_ORDER           PIXEL_ORDER_LE
+#else
+#define PIXEL_ORDER           0
+#endif
+
+// In place of pixel data, the header is followed by the commands that drew the region,
+// see draw_stream.c
+#define PIXEL_ENC_DRAW        (PIXEL_ENC_COPY | PIXEL_PALETTE)
+
+// Set in a browser's viewer options message to be sent draw commands
+#define VIEW_DRAW             0x02
+
+// Set in a browser's viewer options when it acknowledges the binary messages it has
+// decoded, with a 4 byte message of their big-endian count
+#define VIEW_ACKS             0x04
+
+// Set in a browser's viewer options when it previews drags itself and wants to be told
+// the area each of its presses started scrolling, see send_drag_hint()
+#define VIEW_HINTS            0x08
+
+// Set in a browser's viewer options when it runs the animations it is described, see
+// anim_offload()
+#define VIEW_ANIMS            0x10
+
+// A browser's hello, sent when it connects: HELLO_MAGIC, the protocol version it speaks,
+// its viewer options, the big-endian ENC_CAP bits of the encodings it decodes, the pixel
+// depth it prefers or 0 and its big-endian viewport width and height.  Later versions
+// may append fields: a hello of HELLO_VIEWPORT_LEN bytes goes on with the big-endian x
+// and y of the viewport, which is the part of the screen the browser shows, as in a
+// viewport message, and one of HELLO_RESUME_LEN bytes with the big-endian token the
+// driver gave the connection the browser lost and the number of messages it applied on
+// it.  The driver answers with a text message of its own version, the encodings it will
+// use and the token of the new connection, see viewer_hello().
+#define HELLO_MAGIC           'H'
+#define HELLO_LEN             10
+#define HELLO_VIEWPORT_LEN    14
+#define HELLO_RESUME_LEN      22
+#if WS_DRIVER_INPUT_V2
+#define PROTO_VERSION         2
+#else
+#define PROTO_VERSION         1
+#endif
+
+// Time in mS a client is given to say hello, and perhaps resume a session, before it is
+// sent the whole screen anyway
+#define HELLO_WAIT_MS         250
+
+// Encodings a browser can announce in its hello
+#define ENC_CAP_RLE           0x0001
+#define ENC_CAP_PALETTE       0x0002
+#define ENC_CAP_FILL          0x0004
+#define ENC_CAP_COPY          0x0008
+#define ENC_CAP_GZIP          0x0010
+#define ENC_CAP_ALIGNED       0x0020
+
+// Encodings assumed for a browser that sent no hello, those every page decoded before
+// the hello was added
+#define ENC_CAP_LEGACY        (ENC_CAP_RLE | ENC_CAP_PALETTE | ENC_CAP_FILL | ENC_CAP_COPY)
+
+// Encodings this build can send
+#if WS_DRIVER_RLE
+#define ENC_CAP_DRIVER_RLE    ENC_CAP_RLE
+#else
+#define ENC_CAP_DRIVER_RLE    0
+#endif
+#if WS_DRIVER_PALETTE
+#define ENC_CAP_DRIVER_PAL    ENC_CAP_PALETTE
+#else
+#define ENC_CAP_DRIVER_PAL    0
+#endif
+#if WS_DRIVER_FILL
+#define ENC_CAP_DRIVER_FILL   ENC_CAP_FILL
+#else
+#define ENC_CAP_DRIVER_FILL   0
+#endif
+#if WS_DRIVER_SCROLL_COPY
+#define ENC_CAP_DRIVER_COPY   ENC_CAP_COPY
+#else
+#define ENC_CAP_DRIVER_COPY   0
+#endif
+#if WS_DRIVER_ALIGNED
+#define ENC_CAP_DRIVER_ALIGN  ENC_CAP_ALIGNED
+#else
+#define ENC_CAP_DRIVER_ALIGN  0
+#endif
+#define ENC_CAP_DRIVER        (ENC_CAP_DRIVER_RLE | ENC_CAP_DRIVER_PAL | ENC_CAP_DRIVER_FILL | ENC_CAP_DRIVER_COPY | ENC_CAP_DRIVER_ALIGN)
+
+// Encodings pack_frame() chooses between, and the header it packs, so clients differing
+// only in the others can share a frame
+#define ENC_CAP_PIXELS        (ENC_CAP_RLE | ENC_CAP_PALETTE | ENC_CAP_FILL | ENC_CAP_ALIGNED)
+
+// Most colours a palette can hold, each pixel then taking 4 bits
+#define PALETTE_MAX           16
+
+// Rows of one colour are sent as a fill when they are the rest of a region or at least
+// this many pixels, enough to pay for splitting the region with another header even
+// when the run-length encoding would have shrunk them
+#define FILL_MIN_PIXELS       1024
+
+// Longest run and longest literal sequence a single RLE control byte can describe
+#define RLE_MAX_RUN           129
+#define RLE_MAX_LITERAL       128
+
+// Objects whose animations the browsers can run at once
+#define ANIM_OFFLOADS         4
 
 
 /**********************
@@ -40,11 +412,183 @@
  **********************/
 typedef struct
 {
-	SemaphoreHandle_t mutex;
+	uint32_t time;    // lv_tick_get() when the event happened in the browser
 	uint8_t flag;
 	uint16_t x;
 	uint16_t y;
-} pointer_t;
+	uint16_t seq;     // Sequence number from the browser, 0 if it sent none
+	uint8_t num;      // Client that sent it
+} pointer_event_t;
+
+typedef struct
+{
+	struct netconn* conn;
+	TickType_t accepted;  // Tick count when the connection was accepted
+} http_conn_t;
+
+typedef struct
+{
+	uint8_t version;      // Protocol version of the browser's hello, 0 if it sent none
+	uint32_t encodings;   // ENC_CAP bits of the encodings it decodes
+	uint8_t depth;        // Pixel depth it prefers, 0 for no preference
+	uint16_t view_w;      // Its viewport, 0 x 0 if unknown
+	uint16_t view_h;
+	bool hints;           // Set when it wants to be told what its presses drag
+	bool anims;           // Set when it runs the animations it is described
+	bool held;            // Set when it is held at 8 bits per pixel
+	uint8_t shift;        // Its screen is scaled down by 2^shift
+	uint32_t connected;   // lv_tick_get() when it connected
+	uint32_t input;       // lv_tick_get() at its last pointer event, or when it connected
+} viewer_t;
+
+#if WS_DRIVER_ANIM_OFFLOAD
+// An animation the browsers run on the snapshot of an object, see anim_offload()
+typedef struct
+{
+	uint8_t id;           // Snapshot the browsers take and animate
+	bool snap;            // Set for the first animation, the browsers snapshot the area
+	char prop;            // 'x', 'y' or 'o' for opacity, 0 to drop the snapshot
+	uint8_t path;         // Index in anim_paths
+	int32_t from;
+	int32_t to;
+	int32_t base;         // Value the snapshot was taken at
+	uint32_t at;          // mS of the animation already run
+	uint32_t ms;          // Its duration
+} anim_msg_t;
+
+// An object hidden while the browsers animate its snapshot
+typedef struct
+{
+	lv_obj_t* obj;        // NULL if the slot is free
+	uint8_t id;
+	uint8_t refs;         // Its animations the browsers run
+	bool hidden;          // Whether it was hidden before
+	lv_coord_t x;         // Where the snapshot was taken
+	lv_coord_t y;
+	lv_area_t area;       // Area of the snapshot
+	lv_area_t clip;       // Area its parents show it in
+} anim_offload_t;
+#endif
+
+typedef struct
+{
+	lv_disp_drv_t* drv;
+	lv_area_t area;             // Area held by color_map
+	lv_color_t* color_map;
+	bool copy;                  // Set to move the pixels in area by dx, dy instead
+#if WS_DRIVER_SHADOW
+	bool join;                  // Set to send area from the shadow framebuffer instead
+#endif
+	lv_coord_t dx;
+	lv_coord_t dy;
+	int num_regions;            // Parts of area that changed
+	uint16_t input_seq;         // Last pointer event processed before the flush
+	uint8_t session;            // Session of the display flushed
+	uint32_t clients;           // Clients that see the display
+#if WS_DRIVER_WHOLE_SCREEN
+	bool whole;                 // Set when the flush is a strip of a whole-screen refresh
+	bool whole_end;             // Set for the last strip of one
+#endif
+#if WS_DRIVER_LOSSY
+	uint32_t refine;            // Clients the flush refines, sent exact pixels
+#endif
+#if WS_DRIVER_ANIM_OFFLOAD
+	bool anim;                  // Set to describe an animation of area instead, clipped
+	anim_msg_t anim_msg;        // to regions[0]
+#endif
+	lv_area_t regions[MAX_FLUSH_REGIONS];
+} flush_job_t;
+
+typedef struct
+{
+	lv_disp_t* disp;            // Display the session's clients see, NULL until created
+	lv_indev_t* indev;          // Pointer reading the session's events
+	// Single producer (websocket task), single consumer (LVGL) ring of pointer events.
+	// Each index is only written by one side so no lock is needed.
+	pointer_event_t ring[POINTER_RING_LEN];
+	volatile uint32_t head;
+	volatile uint32_t tail;
+	// Newest event that didn't fit in the ring, double buffered: the websocket task fills
+	// the slot latest_seq doesn't point at and then advances it, so LVGL always finds a
+	// whole event without a lock.  latest_head is head when it was filled, the event only
+	// follows the ring's while head hasn't moved since.  latest_read is the latest_seq
+	// LVGL last took.
+	pointer_event_t latest[2];
+	uint32_t latest_head[2];
+	volatile uint32_t latest_seq;
+	volatile uint32_t latest_read;
+	pointer_event_t pointer;    // Last pointer event passed to LVGL
+#if WS_DRIVER_INPUT_SEQ
+	// Client and sequence number of a press whose dragged area is still to be reported
+	// to the client, or -1
+	int hint_client;
+	uint16_t hint_seq;
+#endif
+#if WS_DRIVER_INPUT_LEASE
+	// Client whose input the session takes, or -1, the connection it had when it took
+	// the lease (its slot may since have been reused) and when it last sent an event.
+	// Only the websocket task uses these.
+	int controller;
+	struct netconn* controller_conn;
+	uint32_t lease_tick;
+	pointer_event_t last;       // Controller's last event pushed
+#endif
+#if WS_DRIVER_SESSIONS
+	lv_disp_buf_t disp_buf;     // Draw buffers, allocated when the display is created
+#endif
+#if WS_DRIVER_FAIR_REFR
+	// Weight of the display's share of the refresh slice, and the mS its refresh may take
+	// in this pass of the LVGL loop, 0 for the whole slice.  Only the LVGL task uses these.
+	uint8_t refr_weight;
+	uint32_t refr_share;
+#endif
+#if WS_DRIVER_KEYS
+	// Keypad reading the session's keys, with a single producer, single consumer ring of
+	// them like the pointer's, the last key passed to LVGL and whether it is still to be
+	// released
+	lv_indev_t* keypad;
+	uint32_t keys[KEY_RING_LEN];
+	volatile uint32_t key_head;
+	volatile uint32_t key_tail;
+	uint32_t key;
+	bool key_down;
+#endif
+#if WS_DRIVER_SCROLL
+	// Scroll distance summed and the last fling velocity (x << 16 | y, 0 if none) sent by
+	// the clients since the LVGL task last took them, and the point they scrolled at
+	volatile int32_t scroll_dx;
+	volatile int32_t scroll_dy;
+	volatile uint32_t fling;
+	volatile uint32_t scroll_at;
+	// Only the LVGL task uses these: the object scrolled, the directions it was scrolled
+	// in and the task ending the scroll once the deltas stop
+	lv_obj_t* scroll_obj;
+	lv_drag_dir_t scroll_dir;
+	lv_task_t* scroll_end;
+#endif
+} session_t;
+
+#if WS_DRIVER_SNAPSHOT
+typedef struct
+{
+	struct netconn* conn;
+	bool started;         // Set once the HTTP header has been sent
+} png_conn_t;
+#endif
+
+#if WS_DRIVER_RATE_CAPS
+typedef struct
+{
+	lv_disp_t* disp;            // NULL while the cap is not in use
+	lv_obj_t* obj;              // Object whose area is capped, NULL for a fixed area
+	lv_signal_cb_t signal_cb;   // The object's own signal function
+	lv_area_t area;             // Area capped, without an object
+	uint32_t period;            // Least mS between refreshes of the area
+	uint32_t last;              // lv_tick_get() when it was last refreshed
+	lv_area_t held;             // Join of the areas held since then
+	bool holding;
+} rate_cap_t;
+#endif
 
 
 /**********************
@@ -52,399 +596,5763 @@ typedef struct
  **********************/
 static const char* TAG = "websocket_driver";
  
+// Parameters in use, the menuconfig values unless changed by websocket_driver_init() or
+// websocket_driver_set_config()
+static websocket_driver_config_t config;
+
+#if WS_DRIVER_TUNE
+// Held while /config changes the parameters
+static SemaphoreHandle_t tune_lock;
+#endif
+
 // Connection state
 static bool websocket_connected = false;
 
-// Inner-task queue
+#if WS_DRIVER_YIELD
+// Set when the driver ends a refresh early, until the refresh's last flush
+static bool refr_yielded = false;
+#endif
+
+#if WS_DRIVER_LOSSY
+// Lossy clients whose approximate areas are being redrawn exactly
+static uint32_t refining = 0;
+#endif
+
+#if WS_DRIVER_DRAW_STREAM
+// Clients the next draw frame must define every glyph it uses for
+static uint32_t draw_resetting = 0;
+#endif
+
+// What each browser announced in its hello, written by its websocket task and read by
+// the sender task
+static volatile viewer_t viewers[WEBSOCKET_SERVER_MAX_CLIENTS];
+
+#if WS_DRIVER_INPUT_LEASE
+// Clients told they are viewers since they connected or were last told they control
+static volatile uint32_t role_told = 0;
+#endif
+
+#if WS_DRIVER_THUMBNAILS
+// Pixels scaled down for thumbnail clients, allocated when the first asks for one, and
+// held while they are scaled into and packed from.  Large enough for a draw buffer at
+// half size, or the whole screen with a shadow framebuffer to resend from.
+static lv_color_t* thumb_buf = NULL;
+static SemaphoreHandle_t thumb_mutex;
+#endif
+
+// Accepted connections waiting for an HTTP handler task, including idle ones being
+// polled for a request
 static QueueHandle_t client_queue;
-const static int client_queue_size = 5;
+const static int client_queue_size = 8;
+
+// Flushed buffers waiting for the sender task.  LVGL won't flush its other buffer
+// until lv_disp_flush_ready() is called so only one can be outstanding.
+static QueueHandle_t flush_queue;
+const static int flush_queue_size = 1;
+
+// Given each time the sender task releases a buffer back to LVGL
+static SemaphoreHandle_t flush_done;
+
+#if WS_DRIVER_LCD
+// Set once the panel is ready to be sent the application's display
+static bool lcd_ready = false;
+static lv_disp_drv_t* volatile lcd_drv = NULL;
+
+// Count of the sender task and the panel still using the buffer last flushed
+static volatile uint32_t lcd_holds = 0;
+#endif
+
+#if WS_DRIVER_ZERO_COPY
+// Draw buffers with DRAW_BUF_HEADROOM bytes in front of them, which strips are sent from
+static lv_color_t* zero_copy_bufs[2];
+#endif
+
+#if WS_DRIVER_SHADOW
+// Held while the shadow framebuffer is changed or sent from, so a client resent part of
+// it gets the pixels from before a change with the change after them, or from after it
+static SemaphoreHandle_t shadow_mutex;
+
+// Set while the shadow may not hold the whole screen, after a flush or copy was sent to
+// nobody, and until the screen is next redrawn for a joining client.  With a snapshot
+// what nobody sees still reaches the shadow, so it is only stale until the screen is
+// first drawn.
+static volatile bool shadow_stale = true;
+#endif
+
+#if WS_DRIVER_SNAPSHOT
+// Set by /snapshot for the LVGL task to draw the screen into the shadow when nobody has
+// watched it since the device started
+static SemaphoreHandle_t snapshot_done;
+static volatile bool snapshot_request = false;
+#endif
+
+// Pixel depth in bits
+static int pixel_depth;
+
+// Size in bytes of each packed message buffer
+static uint32_t frame_buf_len;
+
+// Lines each draw buffer holds
+static int draw_lines;
+
+// Session 0 is the display and pointer the application registered, the others are
+// created as their clients first connect
+static session_t sessions[NUM_SESSIONS];
+
+// Clients connected since the LVGL task last started them off with the whole screen
+static volatile uint32_t join_pending = 0;
+
+// Joining clients that haven't said hello yet, which the whole screen waits for in case
+// they resume a session
+static volatile uint32_t hello_wait = 0;
+
+#if WS_DRIVER_CONSUMER_REFR
+// Sessions whose display isn't refreshed since no browser would take its frames
+static volatile uint32_t refr_paused = 0;
+#endif
+
+#if WS_DRIVER_SESSIONS
+// Called to build the user interface of each session display created
+static websocket_driver_session_cb_t session_cb = NULL;
+
+// Clients whose session has a display of its own.  Joining clients are sent nothing
+// until the LVGL task gives them their display.
+static volatile uint32_t session_own = 0;
+
+// Size in pixels and memory capabilities of each draw buffer of session 0, which the
+// other sessions' buffers match
+static uint32_t session_buf_size = 0;
+static uint32_t session_buf_caps = 0;
+
+// LVGL memory used once session 0's user interface was built, which the free memory
+// must have room for before another session is created since LVGL halts when it runs out
+static uint32_t session_mem = 0;
+#endif
+
+#if WS_DRIVER_ANIM_OFFLOAD
+// Objects whose snapshots the browsers animate, only used by the LVGL task, and the id
+// of the last snapshot
+static anim_offload_t anim_offloads[ANIM_OFFLOADS];
+static uint8_t anim_offload_id = 0;
+
+// Animation paths the browsers know, by the names they are sent
+static const lv_anim_path_cb_t anim_path_cbs[] = {
+	lv_anim_path_linear, lv_anim_path_ease_in, lv_anim_path_ease_out, lv_anim_path_ease_in_out,
+	lv_anim_path_overshoot, lv_anim_path_bounce, lv_anim_path_step
+};
+static const char* const anim_paths[] = {
+	"linear", "ease_in", "ease_out", "ease_in_out", "overshoot", "bounce", "step"
+};
+#endif
+
+// Task evaluating LVGL, woken whenever LVGL has something to do
+static TaskHandle_t run_task = NULL;
+
+// Work done by its loop, only written by it
+static websocket_driver_run_stats_t run_stats;
+
+// LVGL tasks that only need to run while they have work to do
+static lv_task_t* anim_task;
+static lv_task_t* resync;
+
+#if WS_DRIVER_RATE_CAPS
+// Parts of the screen refreshed at most once a period, and set while their held areas are
+// being invalidated so they aren't held again
+static rate_cap_t rate_caps[WS_DRIVER_RATE_CAPS];
+static bool caps_releasing = false;
+#endif
+
+#if WS_DRIVER_TELEMETRY
+// Refresh totals accumulated by websocket_driver_monitor() in the LVGL task, wrapping
+static volatile uint32_t render_cnt = 0;
+static volatile uint32_t render_ms = 0;
+static volatile uint32_t render_px = 0;
+#endif
+
+#if WS_DRIVER_HEATMAP
+// Flushes of the first display's tiles counted by the LVGL task and bytes packed for them
+// by the sender task, row by row, wrapping
+static volatile uint32_t heat_flushes[HEAT_TILES];
+static volatile uint32_t heat_bytes[HEAT_TILES];
+#endif
+
+#if WS_DRIVER_METRICS
+// LVGL's memory monitor, read by the LVGL task when /metrics asks for it since LVGL's
+// heap can't be walked from other tasks
+static SemaphoreHandle_t metrics_lock;
+static SemaphoreHandle_t mem_mon_done;
+static volatile bool mem_mon_request = false;
+static lv_mem_monitor_t mem_mon;
+// Time in uS, wrapping, the sender task spent packing flushed buffers and LVGL spent
+// waiting for it to release one.  Waits near the packing time mean rendering is held up
+// by the sender instead of overlapping with it.
+static volatile uint32_t encode_us = 0;
+static volatile uint32_t encode_jobs = 0;
+static volatile uint32_t flush_wait_us = 0;
+static volatile uint32_t flush_waits = 0;
+#if LV_USE_REFR_PROF
+// Draw profiler totals, read along with the memory monitor
+static lv_refr_prof_t prof_types[LV_REFR_PROF_TYPES + 1];
+static lv_refr_prof_t prof_objs[METRICS_PROF_OBJS];
+static uint16_t num_prof_types = 0;
+static uint16_t num_prof_objs = 0;
+#endif
+#if LV_USE_TASK_PROF
+// Task profiler totals, read along with the memory monitor
+static lv_task_prof_t task_profs[METRICS_TASK_PROFS];
+static uint16_t num_task_profs = 0;
+static uint64_t task_prof_elapsed;
+static uint64_t task_prof_busy;
+#endif
+#endif
+
+
+/**********************
+ *  STATIC PROTOTYPES
+ **********************/
+static void websocket_callback(uint8_t num, WEBSOCKET_TYPE_t type, char* msg, uint64_t len);
+static void set_view_options(uint8_t num, uint8_t options, bool held);
+static void viewer_hello(uint8_t num, const uint8_t* msg, uint32_t len);
+static uint32_t viewer_encodings(uint32_t clients);
+static uint32_t viewer_group(uint32_t clients);
+static void set_viewport(uint8_t num, const uint8_t* msg);
+static int clip_regions(lv_area_t* regions, int num_regions, const lv_area_t* viewport);
+#if WS_DRIVER_THUMBNAILS
+static void set_scale(uint8_t num, uint8_t shift);
+static uint32_t viewer_thumbs(uint32_t clients);
+static void thumb_area_down(lv_area_t* area, uint8_t shift);
+static void thumb_scale(lv_color_t* dst, lv_coord_t dst_stride, const lv_area_t* dst_area, const lv_color_t* src, const lv_area_t* src_area, uint8_t shift);
+#endif
+static void thumb_area_up(lv_area_t* area, uint8_t shift);
+#if !WS_DRIVER_ASSETS
+static uint32_t http_etag(const uint8_t* data, uint32_t len);
+#endif
+static bool http_etag_listed(const ws_request_t* req, const char* tag, int n);
+static int http_range(const ws_request_t* req, uint32_t len, uint32_t* first, uint32_t* last);
+static void http_send_file(struct netconn *conn, const ws_request_t* req, const char* headers, const uint8_t* data, uint32_t len, uint32_t etag);
+#if WS_DRIVER_ASSETS
+static void http_send_asset(struct netconn *conn, const ws_request_t* req, const char* path, uint16_t path_len);
+#endif
+static void http_serve(http_conn_t* c);
+#if WS_DRIVER_INPUT_REC
+static void http_send_input_ctl(struct netconn *conn, const char* cmd);
+#endif
+#if WS_DRIVER_CAPTURE
+static void http_send_capture_ctl(struct netconn *conn, const char* cmd);
+#endif
+#if WS_DRIVER_SNAPSHOT
+static void http_send_snapshot(struct netconn *conn);
+static void http_send_snapshot_png(struct netconn *conn);
+static bool snapshot_ready();
+static bool png_write(void* ctx, const uint8_t* data, int len);
+#endif
+#if WS_DRIVER_METRICS
+static void http_send_metrics(struct netconn *conn);
+static int metrics_text(char* buf, int len);
+static int metrics_heap(char* buf, int len, const char* region, uint32_t caps);
+#endif
+#if WS_DRIVER_TUNE
+static void http_send_config(struct netconn *conn, const ws_request_t* req, bool get);
+#endif
+static void server_task(void* pvParameters);
+#if WS_DRIVER_RAW_PORT
+static void raw_server_task(void* pvParameters);
+#endif
+#if WS_DRIVER_TLS
+static void tls_server_task(void* pvParameters);
+static void tls_serve(struct netconn* conn, ws_tls_t* tls);
+#endif
+static void server_handle_task(void* pvParameters);
+static void sender_task(void* pvParameters);
+#if WS_DRIVER_MEM_LOW
+static void govern_memory();
+#endif
+static void send_flush(const flush_job_t* job);
+static void release_buf(lv_disp_drv_t* drv);
+#if WS_DRIVER_LCD
+static void lcd_flushed();
+#endif
+#if WS_DRIVER_SCROLL_COPY
+static void send_copy(const flush_job_t* job);
+static void send_copy_damage(const lv_area_t* area, uint32_t clients);
+#endif
+static void resync_task(lv_task_t* task);
+#if WS_DRIVER_SHADOW
+static void send_join(const flush_job_t* job);
+static void send_shadow(uint8_t num, lv_area_t* areas, int num_areas, bool lossy);
+#endif
+static frame_t* pack_groups(const flush_job_t* job, const lv_area_t* regions, int num_regions, bool lossy, uint32_t clients, uint32_t* last_clients);
+static frame_t* pack_flush(const flush_job_t* job, const lv_color_t* src, const lv_area_t* src_area, lv_area_t* regions, int num_regions, bool lossy, uint32_t clients, uint8_t shift, uint32_t* len);
+#if WS_DRIVER_ZERO_COPY
+static frame_t* wrap_flush(const flush_job_t* job, const lv_area_t* regions, int num_regions, uint32_t clients, uint32_t* frame_clients);
+static void wrap_released(void* arg);
+#endif
+#if WS_DRIVER_DRAW_STREAM
+static frame_t* pack_draw(const flush_job_t* job, uint32_t clients, uint32_t* images_len);
+#endif
+static int pack_frame(frame_t* frame, lv_area_t* regions, int num_regions, const lv_color_t* src, lv_coord_t x0, lv_coord_t y0, lv_coord_t stride, uint16_t input_seq, bool lossy, uint32_t encodings, uint8_t shift);
+static uint8_t* pack_region(uint8_t* buf, const lv_area_t* region, const lv_color_t* src, lv_coord_t stride, uint16_t input_seq, uint32_t encodings, uint8_t shift);
+static uint8_t* pack_header(uint8_t* buf, const lv_area_t* region, uint16_t input_seq, uint8_t shift, bool aligned);
+#if WS_DRIVER_PALETTE
+static int palette_build(lv_color_t* palette, const lv_color_t* src, lv_coord_t w, lv_coord_t h, lv_coord_t stride);
+static uint32_t palette_len(int colours, uint32_t pixels);
+static uint32_t pack_palette(uint8_t* buf, const lv_color_t* palette, int colours, const lv_color_t* src, lv_coord_t w, lv_coord_t h, lv_coord_t stride);
+#endif
+#if WS_DRIVER_LOSSY
+static uint8_t* pack_lossy(uint8_t* buf, const lv_area_t* region, const lv_color_t* src, lv_coord_t stride, uint16_t input_seq, uint32_t encodings, uint8_t shift);
+#if WS_DRIVER_RLE
+static uint32_t pack_rle332(uint8_t* buf, const lv_color_t* src, lv_coord_t w, lv_coord_t h, lv_coord_t stride, uint32_t max_len);
+#endif
+#endif
+#if WS_DRIVER_FILL
+static uint8_t* pack_fill(uint8_t* buf, const lv_area_t* region, lv_color_t c, uint16_t input_seq, uint8_t shift, bool aligned);
+static lv_coord_t uniform_rows(const lv_color_t* src, lv_coord_t w, lv_coord_t h, lv_coord_t stride);
+#endif
+static inline uint8_t* pack_pixel(uint8_t* buf, lv_color_t c);
+#if WS_DRIVER_RLE
+static uint32_t pack_rle(uint8_t* buf, const lv_color_t* src, lv_coord_t w, lv_coord_t h, lv_coord_t stride, uint32_t max_len);
+#endif
+static void pointer_input(uint8_t num, uint8_t flag, uint16_t x, uint16_t y, uint16_t seq, uint8_t age);
+static void push_pointer(uint8_t num, uint8_t flag, uint16_t x, uint16_t y, uint16_t seq, uint8_t age);
+#if WS_DRIVER_INPUT_V2
+static void compact_input(uint8_t num, const uint8_t* m, const uint8_t* end);
+static const uint8_t* read_varint(const uint8_t* m, const uint8_t* end, uint32_t* value);
+#endif
+static bool ring_push(session_t* s, uint8_t num, uint8_t flag, uint16_t x, uint16_t y, uint16_t seq, uint8_t age);
+static bool pointer_pending(const session_t* s);
+static bool latest_take(session_t* s, pointer_event_t* ev);
+#if WS_DRIVER_INPUT_LEASE
+static bool lease_take(session_t* s, uint8_t num, uint8_t flag);
+static void send_role(uint8_t num, bool controller);
+#endif
+#if WS_DRIVER_INPUT_SEQ
+static void send_drag_hint(lv_indev_t* indev, uint8_t num, uint16_t seq);
+#endif
+#if WS_DRIVER_INPUT_SEQ || WS_DRIVER_SCROLL
+static lv_drag_dir_t scroll_dirs(lv_obj_t* obj);
+#endif
+#if WS_DRIVER_SCROLL
+static void scroll_input(uint8_t num, const uint8_t* m);
+static void scroll_apply(session_t* s);
+static lv_obj_t* scroll_target(session_t* s, lv_point_t* p, lv_drag_dir_t dir);
+static lv_obj_t* scroll_find(lv_obj_t* obj, const lv_point_t* p, lv_drag_dir_t dir);
+static void scroll_fling(lv_obj_t* scrl, int32_t vx, int32_t vy);
+static void scroll_fling_ready(lv_anim_t* a);
+static void scroll_end_task(lv_task_t* task);
+static void scroll_end(lv_obj_t* scrl);
+#endif
+static int client_session(uint8_t num);
+static uint32_t session_clients(int s);
+static int disp_session(const lv_disp_drv_t* drv);
+static int indev_session(const lv_indev_drv_t* drv);
+#if WS_DRIVER_KEYS
+static int keypad_session(const lv_indev_drv_t* drv);
+static void key_input(uint8_t num, const uint8_t* m, int n);
+static void key_focus(session_t* s);
+static bool is_ta(lv_obj_t* obj);
+#endif
+static bool shadow_kept(int s);
+#if WS_DRIVER_WHOLE_SCREEN
+static bool whole_screen_refr(lv_disp_t* disp);
+#endif
+#if WS_DRIVER_SNAPSHOT
+static void snapshot_draw();
+#endif
+static void boot_draw();
+static void join_clients();
+#if WS_DRIVER_RESUME
+static uint32_t hello_expire();
+#endif
+#if WS_DRIVER_SESSIONS
+static bool session_create(int s);
+#endif
+static int num_connected_clients();
+static uint32_t run_next_wait();
+static void lvgl_task(void* pvParameters);
+#if WS_DRIVER_ADAPT_REFR
+static void adapt_refr_period();
+#else
+static void set_refr_period();
+#endif
+#if WS_DRIVER_PAUSE_HIDDEN
+static void set_hidden(uint8_t num, bool hidden);
+static uint32_t skip_hidden(uint32_t clients, const lv_area_t* area);
+#endif
+#if WS_DRIVER_CONSUMER_REFR
+static void pause_refresh();
+#endif
+#if WS_DRIVER_FAIR_REFR
+static void share_refresh();
+#endif
+#if WS_DRIVER_WIFI_POWER
+static uint32_t wifi_power_update();
+#endif
+#if WS_DRIVER_ANIM_PACE
+static bool anim_pace();
+#endif
+#if WS_DRIVER_ANIM_OFFLOAD
+static bool anim_offload(const lv_anim_t* a, bool start);
+static char anim_prop(const lv_anim_t* a);
+static bool anim_covered(lv_disp_t* disp, lv_obj_t* obj, const lv_area_t* clip);
+static void anim_queue(lv_obj_t* obj, const anim_offload_t* o, anim_msg_t* msg);
+static void send_anim(const flush_job_t* job);
+#endif
+#if WS_DRIVER_RATE_CAPS
+static int cap_slot(lv_disp_t* disp, lv_obj_t* obj);
+static void cap_area(const rate_cap_t* c, lv_area_t* area);
+static lv_res_t cap_signal(lv_obj_t* obj, lv_signal_t sign, void* param);
+static void caps_release();
+static uint32_t caps_wait();
+#endif
+static bool run_task_idle(lv_task_t* task);
+static void pace_indev_reads();
+static void pace_read(lv_task_t* task, bool pending);
+#if WS_DRIVER_PREEMPT
+static bool input_waiting(const session_t* s);
+#endif
+#if WS_DRIVER_TELEMETRY
+static void telemetry_task(void* pvParameters);
+static int telemetry_client(char* buf, int len, uint8_t num, const frame_tx_stats_t* prev, const frame_tx_stats_t* cur);
+#endif
+#if WS_DRIVER_HEATMAP
+static void heat_add(volatile uint32_t* counts, const lv_area_t* area, uint32_t n, bool share);
+static void heatmap_task(void* pvParameters);
+#endif
+#if WS_DRIVER_STACKS_PSRAM
+static bool start_server_psram();
+static QueueHandle_t create_queue_psram(UBaseType_t len, UBaseType_t item_size);
+#endif
+
+ 
+/**********************
+ *   GLOBAL FUNCTIONS
+ **********************/
+// Fill cfg with the values set in menuconfig, those its performance preset covers
+// taken from the preset
+void websocket_driver_config_default(websocket_driver_config_t* cfg)
+{
+	memset(cfg, 0, sizeof(*cfg));
+	cfg->max_lines = WS_DRIVER_MAX_LINES;
+	cfg->frame_size = WS_DRIVER_FRAME_SIZE;
+#if WS_DRIVER_LVGL_TASK
+	cfg->lvgl_stack = WS_DRIVER_LVGL_STACK;
+	cfg->lvgl_prio = WS_DRIVER_LVGL_PRIO;
+#endif
+	cfg->sender_prio = WS_DRIVER_SENDER_PRIO;
+	cfg->credits = WS_DRIVER_CREDITS;
+	cfg->fragment = WS_DRIVER_FRAGMENT;
+	cfg->frame_budget = WS_DRIVER_FRAME_BUDGET;
+	cfg->preempt = WS_DRIVER_PREEMPT;
+	cfg->refr_slice = WS_DRIVER_REFR_SLICE;
+	cfg->near_first = WS_DRIVER_NEAR_FIRST;
+	cfg->refr_period = LV_DISP_DEF_REFR_PERIOD;
+	cfg->max_clients = WEBSOCKET_SERVER_MAX_CLIENTS;
+#if WS_DRIVER_WIFI_POWER
+	cfg->wifi_save = 1;
+#endif
+	cfg->encodings = ENC_CAP_DRIVER;
+#if WS_DRIVER_PRESET != WS_DRIVER_PRESET_CUSTOM
+	(void) websocket_driver_config_preset(cfg, WS_DRIVER_PRESET);
+#endif
+}
+
+
+// Set the parameters a preset covers in cfg, leaving the rest.  Throughput draws in the
+// tallest strips memory allows into buffers holding whole flushes and lets browsers queue
+// the most messages.  Latency draws short strips, near the pointer first, refreshes more
+// often and ends long refreshes early, keeping WiFi out of power save.  Low memory draws
+// the fewest lines into small fixed size buffers for one browser and saves WiFi power.
+// Returns false for an unknown preset.
+bool websocket_driver_config_preset(websocket_driver_config_t* cfg, int preset)
+{
+	switch (preset) {
+		case WS_DRIVER_PRESET_CUSTOM:
+			break;
+		case WS_DRIVER_PRESET_THROUGHPUT:
+			cfg->max_lines = LV_VER_RES_MAX;
+			cfg->frame_size = 0;
+			cfg->credits = 8;
+			cfg->fragment = 0;
+			cfg->frame_budget = 50;
+			cfg->preempt = 0;
+			cfg->refr_slice = 100;
+			cfg->near_first = 0;
+			cfg->refr_period = 30;
+			cfg->max_clients = WEBSOCKET_SERVER_MAX_CLIENTS;
+			cfg->wifi_save = 0;
+			cfg->encodings = ENC_CAP_DRIVER;
+			break;
+		case WS_DRIVER_PRESET_LATENCY:
+			cfg->max_lines = 40;
+			cfg->frame_size = 0;
+			cfg->credits = 2;
+			cfg->fragment = 1024;
+			cfg->frame_budget = 16;
+			cfg->preempt = 10;
+			cfg->refr_slice = 30;
+			cfg->near_first = 64;
+			cfg->refr_period = 16;
+			cfg->max_clients = LV_MATH_MIN(2, WEBSOCKET_SERVER_MAX_CLIENTS);
+			cfg->wifi_save = 0;
+			cfg->encodings = ENC_CAP_DRIVER;
+			break;
+		case WS_DRIVER_PRESET_LOW_MEMORY:
+			cfg->max_lines = WS_DRIVER_MIN_LINES;
+			cfg->frame_size = 4096;
+			cfg->credits = 2;
+			cfg->fragment = 1024;
+			cfg->frame_budget = 33;
+			cfg->preempt = 30;
+			cfg->refr_slice = 100;
+			cfg->near_first = 64;
+			cfg->refr_period = 50;
+			cfg->max_clients = 1;
+			cfg->wifi_save = 1;
+			cfg->encodings = ENC_CAP_DRIVER;
+			break;
+		default:
+			return false;
+	}
+	return true;
+}
+
+
+// Start the driver with cfg's parameters, or the menuconfig values if it is NULL.  With
+// WS_DRIVER_TUNE parameters saved from /config take their place, so NVS must be
+// initialized first.
+void websocket_driver_init(const websocket_driver_config_t* cfg)
+{
+	ESP_LOGI(TAG, "Initialization.");
+	
+	if (cfg != NULL) {
+		config = *cfg;
+	} else {
+		websocket_driver_config_default(&config);
+	}
+#if WS_DRIVER_TUNE
+	tune_lock = xSemaphoreCreateMutex();
+	(void) tune_store_load(&config);
+#endif
+	frame_tx_set_fragment(config.fragment);
+	ws_server_set_max_clients(config.max_clients);
+	
+	flush_queue = xQueueCreate(flush_queue_size, sizeof(flush_job_t));
+	flush_done = xSemaphoreCreateBinary();
+#if WS_DRIVER_SHADOW
+	shadow_mutex = xSemaphoreCreateMutex();
+#endif
+#if WS_DRIVER_SNAPSHOT
+	snapshot_done = xSemaphoreCreateBinary();
+#endif
+#if WS_DRIVER_THUMBNAILS
+	thumb_mutex = xSemaphoreCreateMutex();
+#endif
+#if WS_DRIVER_TRACE
+	(void) trace_rec_init(WS_DRIVER_TRACE_EVENTS);
+#endif
+#if WS_DRIVER_INPUT_REC
+	(void) input_rec_init(WS_DRIVER_INPUT_REC_EVENTS);
+#endif
+#if WS_DRIVER_CAPTURE
+	// Captured as a page announcing the encodings every page decodes would be sent them,
+	// less its acknowledgements
+	static const uint8_t capture_hello[HELLO_LEN] = {
+		HELLO_MAGIC, PROTO_VERSION, 0, ENC_CAP_LEGACY >> 8, ENC_CAP_LEGACY & 0xFF, 0, 0, 0, 0, 0
+	};
+	(void) capture_rec_init(WS_DRIVER_RAW_PORT, capture_hello, sizeof(capture_hello));
+#endif
+#if WS_DRIVER_WIFI_LINK
+	wifi_link_init(WS_DRIVER_WEAK_RSSI);
+#endif
+#if WS_DRIVER_WIFI_POWER
+	wifi_power_init(WS_DRIVER_WIFI_SAVE_TX_POWER, WS_DRIVER_WIFI_HT40);
+#endif
+#if WS_DRIVER_METRICS
+	metrics_lock = xSemaphoreCreateMutex();
+	mem_mon_done = xSemaphoreCreateBinary();
+	memset(&mem_mon, 0, sizeof(mem_mon));
+#endif
+	
+	// lv_init() only creates the animation task
+	anim_task = lv_ll_get_head(&LV_GC_ROOT(_lv_task_ll));
+	resync = lv_task_create(resync_task, RESYNC_PERIOD_MS, LV_TASK_PRIO_LOW, NULL);
+#if LV_USE_CMD_QUEUE
+	lv_cmd_set_notify_cb(websocket_driver_wake);
+#endif
+#if WS_DRIVER_ANIM_PACE
+	lv_anim_set_pace_cb(anim_pace);
+#endif
+#if WS_DRIVER_ANIM_OFFLOAD
+	memset(anim_offloads, 0, sizeof(anim_offloads));
+	lv_anim_set_offload_cb(anim_offload);
+#endif
+#if LV_USE_OBJ_LAYOUT_DEFER
+	// Lists and other containers the application builds a child at a time are laid out once
+	lv_obj_set_layout_defer(true);
+#endif
+	
+#if WS_DRIVER_STACKS_PSRAM
+	if (!start_server_psram())
+#endif
+	ws_server_start();
+#if WS_DRIVER_STACKS_PSRAM
+	client_queue = create_queue_psram(client_queue_size, sizeof(http_conn_t));
+#else
+	client_queue = xQueueCreate(client_queue_size, sizeof(http_conn_t));
+#endif
+	websocket_driver_create_task(&server_task, "server_task", 3000, NULL, WS_DRIVER_SERVER_PRIO, NULL, WS_DRIVER_NET_CORE, WS_DRIVER_STACKS_PSRAM);
+	for (int i=0; i<WS_DRIVER_HTTP_TASKS; i++) {
+		websocket_driver_create_task(&server_handle_task, "server_handle_task", 4000, NULL, WS_DRIVER_HTTP_PRIO, NULL, WS_DRIVER_NET_CORE, WS_DRIVER_STACKS_PSRAM);
+	}
+	websocket_driver_create_task(&sender_task, "sender_task", 3000, NULL, config.sender_prio, NULL, WS_DRIVER_NET_CORE, WS_DRIVER_SENDER_STACKS_PSRAM);
+#if WS_DRIVER_RAW_PORT
+	websocket_driver_create_task(&raw_server_task, "raw_server_task", 3000, NULL, WS_DRIVER_SERVER_PRIO, NULL, WS_DRIVER_NET_CORE, WS_DRIVER_STACKS_PSRAM);
+#endif
+#if WS_DRIVER_TLS
+	// The handshake's public key operations need a deep stack
+	websocket_driver_create_task(&tls_server_task, "tls_server_task", 8192, NULL, WS_DRIVER_HTTP_PRIO, NULL, WS_DRIVER_NET_CORE, WS_DRIVER_STACKS_PSRAM);
+#endif
+#if WS_DRIVER_SERIAL
+	serial_link_start(WS_DRIVER_SERIAL_UART, WS_DRIVER_SERIAL_BAUD, WS_DRIVER_SERIAL_TX_PIN, WS_DRIVER_SERIAL_RX_PIN, WS_DRIVER_RAW_PORT);
+#endif
+#if WS_DRIVER_RELAY
+	relay_link_start(WS_DRIVER_RELAY_HOST, WS_DRIVER_RELAY_PORT, HTTP_IDLE_MS, websocket_callback);
+#endif
+#if WS_DRIVER_TELEMETRY
+	websocket_driver_create_task(&telemetry_task, "telemetry_task", 3000, NULL, WS_DRIVER_TELEMETRY_PRIO, NULL, WS_DRIVER_NET_CORE, WS_DRIVER_STACKS_PSRAM);
+#endif
+#if WS_DRIVER_HEATMAP
+	websocket_driver_create_task(&heatmap_task, "heatmap_task", 3000, NULL, WS_DRIVER_TELEMETRY_PRIO, NULL, WS_DRIVER_NET_CORE, WS_DRIVER_STACKS_PSRAM);
+#endif
+	
+#if LV_COLOR_DEPTH == 32
+	pixel_depth = 32;
+#elif LV_COLOR_DEPTH == 16
+	pixel_depth = 16;
+#else
+	pixel_depth = 8;
+#endif
+	
+	memset(sessions, 0, sizeof(sessions));
+	for (int i=0; i<NUM_SESSIONS; i++) {
+#if WS_DRIVER_INPUT_SEQ
+		sessions[i].hint_client = -1;
+#endif
+#if WS_DRIVER_INPUT_LEASE
+		sessions[i].controller = -1;
+#endif
+#if WS_DRIVER_FAIR_REFR
+		sessions[i].refr_weight = 1;
+#endif
+	}
+
+#if WS_DRIVER_SHADOW
+	(void) shadow_fb_init(LV_HOR_RES_MAX, LV_VER_RES_MAX);
+#endif
+#if WS_DRIVER_ASSETS
+	(void) asset_fs_init(WS_DRIVER_ASSET_LETTER);
+#endif
+#if WS_DRIVER_IMG_DEC
+	(void) img_dec_init();
+#endif
+}
+
+
+void websocket_driver_get_config(websocket_driver_config_t* cfg)
+{
+	*cfg = config;
+}
+
+
+// Change the parameters in use.  The live ones apply at once, the others are kept for
+// websocket_driver_get_config() but only take effect when passed to
+// websocket_driver_init() at the next start.
+void websocket_driver_set_config(const websocket_driver_config_t* cfg)
+{
+	config = *cfg;
+	frame_tx_set_fragment(config.fragment);
+	ws_server_set_max_clients(config.max_clients);
+	websocket_driver_wake();
+}
+
+
+// Create a task as xTaskCreatePinnedToCore() does, but with its stack in PSRAM when
+// psram is set and the stacks of either WS_DRIVER_STACKS_PSRAM option may be there.
+// Its task control block is in internal memory.  Neither is freed if the task ends,
+// which none of the driver's do.  Falls back to internal memory if PSRAM is short.
+BaseType_t websocket_driver_create_task(TaskFunction_t fn, const char* name, uint32_t stack, void* arg,
+	UBaseType_t prio, TaskHandle_t* handle, BaseType_t core, bool psram)
+{
+#if WS_DRIVER_STACKS_PSRAM || WS_DRIVER_SENDER_STACKS_PSRAM
+	StackType_t* stack_buf;
+	StaticTask_t* task_buf;
+	TaskHandle_t task;
+	
+	if (psram) {
+		stack_buf = heap_caps_malloc(stack, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+		task_buf = heap_caps_malloc(sizeof(StaticTask_t), MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+		if ((stack_buf != NULL) && (task_buf != NULL)) {
+			task = xTaskCreateStaticPinnedToCore(fn, name, stack, arg, prio, stack_buf, task_buf, core);
+			if (handle) *handle = task;
+			return (task != NULL) ? pdPASS : pdFAIL;
+		}
+		heap_caps_free(stack_buf);
+		heap_caps_free(task_buf);
+		ESP_LOGW(TAG, "No PSRAM for the stack of %s", name);
+	}
+#else
+	(void) psram;
+#endif
+	return xTaskCreatePinnedToCore(fn, name, stack, arg, prio, handle, core);
+}
+
+
+// Allocate LVGL's two draw buffers and the packed message buffers, initializing
+// disp_buf.  The buffers are placed in PSRAM when present, otherwise in internal
+// memory leaving WS_DRIVER_HEAP_RESERVE bytes free, and hold as many lines as fit so
+// boards with more memory redraw the screen in fewer flushes.  With
+// WS_DRIVER_DRAW_INTERNAL only the message buffers go to PSRAM, as with WS_DRIVER_LCD,
+// which also sets up the panel and keeps the draw buffers in DMA capable memory.
+// Returns the size of each draw buffer in pixels, or 0 if even WS_DRIVER_MIN_LINES
+// could not be allocated.
+// Call after websocket_driver_init().
+uint32_t websocket_driver_init_buf(lv_disp_buf_t * disp_buf)
+{
+#if WS_DRIVER_LCD
+	// The panel is sent the draw buffers by DMA, which can't reach PSRAM
+	uint32_t caps = MALLOC_CAP_DMA | MALLOC_CAP_8BIT;
+	const lcd_panel_config_t lcd = {
+		.host = WS_DRIVER_LCD_HOST,
+		.clock_mhz = WS_DRIVER_LCD_CLOCK_MHZ,
+		.mosi_pin = WS_DRIVER_LCD_MOSI_PIN,
+		.clk_pin = WS_DRIVER_LCD_CLK_PIN,
+		.cs_pin = WS_DRIVER_LCD_CS_PIN,
+		.dc_pin = WS_DRIVER_LCD_DC_PIN,
+		.rst_pin = WS_DRIVER_LCD_RST_PIN,
+		.bckl_pin = WS_DRIVER_LCD_BCKL_PIN,
+		.madctl = WS_DRIVER_LCD_MADCTL,
+		.invert = WS_DRIVER_LCD_INVERT,
+	};
+#else
+	uint32_t caps = MALLOC_CAP_8BIT;
+#endif
+	uint32_t frame_caps;
+	uint32_t line_len = LV_HOR_RES_MAX * sizeof(lv_color_t);
+	// Lines are chosen so every session's display can have its two buffers
+	uint32_t line_cost = 2 * line_len * NUM_SESSIONS;
+	uint32_t fixed_cost = 0;
+	// Fixed size frames must hold at least one row of pixels
+	uint32_t frame_size = (config.frame_size == 0) ? 0 :
+		LV_MATH_MAX(config.frame_size, PIXEL_REGION_EXTRA_LEN + LV_HOR_RES_MAX * ((LV_COLOR_DEPTH + 7) / 8));
+	size_t avail;
+	size_t largest;
+	int lines;
+	uint8_t* buf1;
+	uint8_t* buf2;
+	bool frames_ok;
+	
+#if WS_DRIVER_LCD
+	lcd_ready = lcd_panel_init(&lcd, lcd_flushed);
+#endif
+	
+#if WS_DRIVER_DRAW_INTERNAL || WS_DRIVER_LCD
+	// Only the message buffers, which are packed once and written out, go to PSRAM
+	if (heap_caps_get_free_size(MALLOC_CAP_SPIRAM) > 0) {
+		frame_caps = MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT;
+	} else {
+		frame_caps = caps;
+	}
+#else
+	if (heap_caps_get_free_size(MALLOC_CAP_SPIRAM) > 0) {
+		caps = MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT;
+	}
+	frame_caps = caps;
+#endif
+	avail = heap_caps_get_free_size(caps);
+	if (!(caps & MALLOC_CAP_SPIRAM)) {
+		avail = (avail > WS_DRIVER_HEAP_RESERVE) ? avail - WS_DRIVER_HEAP_RESERVE : 0;
+	}
+	largest = heap_caps_get_largest_free_block(caps);
+	
+	// Frames holding a whole flush grow with the draw buffers
+	if ((frame_caps == caps) && (frame_size == 0)) {
+		line_cost += WS_DRIVER_FRAME_BUFS * line_len;
+		fixed_cost = WS_DRIVER_FRAME_BUFS * STATIC_BUF_EXTRA_LEN;
+	} else if (frame_caps == caps) {
+		fixed_cost = WS_DRIVER_FRAME_BUFS * frame_size;
+	}
+	avail = (avail > fixed_cost) ? avail - fixed_cost : 0;
+	
+	lines = LV_MATH_MIN(avail / line_cost, largest / line_len);
+	lines = LV_MATH_MAX(LV_MATH_MIN(lines, (int) config.max_lines), WS_DRIVER_MIN_LINES);
+#if WS_DRIVER_FULL_FRAME
+	// Screen-sized buffers put LVGL in true double buffered mode, backing off to strips
+	// if they don't fit
+	lines = LV_VER_RES_MAX;
+#endif
+	
+	// The estimate ignores fragmentation so back off until everything fits
+	for (;;) {
+		frame_buf_len = (frame_size == 0) ? lines * line_len + STATIC_BUF_EXTRA_LEN : frame_size;
+		buf1 = heap_caps_malloc(DRAW_BUF_HEADROOM + lines * line_len, caps);
+		buf2 = heap_caps_malloc(DRAW_BUF_HEADROOM + lines * line_len, caps);
+		frames_ok = (buf1 != NULL) && (buf2 != NULL) && frame_tx_init(frame_buf_len, frame_caps);
+		if (frames_ok) break;
+		
+		if (buf1) heap_caps_free(buf1);
+		if (buf2) heap_caps_free(buf2);
+		if ((lines == WS_DRIVER_MIN_LINES) && (caps != frame_caps) && !WS_DRIVER_LCD) {
+			// Internal memory is too short, draw in PSRAM after all
+			caps = frame_caps;
+			continue;
+		}
+		if (lines == WS_DRIVER_MIN_LINES) {
+			ESP_LOGE(TAG, "Could not allocate draw buffers");
+			return 0;
+		}
+		lines = LV_MATH_MAX(lines * 3 / 4, WS_DRIVER_MIN_LINES);
+	}
+	
+	buf1 += DRAW_BUF_HEADROOM;
+	buf2 += DRAW_BUF_HEADROOM;
+	lv_disp_buf_init(disp_buf, buf1, buf2, lines * LV_HOR_RES_MAX);
+	draw_lines = lines;
+#if WS_DRIVER_ZERO_COPY
+	zero_copy_bufs[0] = (lv_color_t*) buf1;
+	zero_copy_bufs[1] = (lv_color_t*) buf2;
+#endif
+#if WS_DRIVER_SESSIONS
+	session_buf_size = lines * LV_HOR_RES_MAX;
+	session_buf_caps = caps;
+#endif
+#if WS_DRIVER_DRAW_STREAM
+	(void) draw_stream_init((lv_color_t*) buf1, (lv_color_t*) buf2, WS_DRIVER_DRAW_OPS, caps);
+#endif
+	ESP_LOGI(TAG, "Drawing %d lines at a time in %s", lines, (caps & MALLOC_CAP_SPIRAM) ? "PSRAM" : "internal memory");
+	return lines * LV_HOR_RES_MAX;
+}
+
+
+bool websocket_driver_available()
+{
+	return websocket_connected;
+}
+
+
+// Start evaluating LVGL.  With WS_DRIVER_LVGL_TASK a task with its own stack,
+// priority and core is created and this returns, otherwise LVGL is evaluated from
+// the calling task and this never returns.  Between calls to lv_task_handler() the
+// task sleeps until the next lv_task is due or it is woken by websocket_driver_wake().
+// Display refresh, animation, input and resync tasks are only waited for while they
+// have work, so the task is idle while nothing changes.  The screen is drawn once at
+// the start, and after that LVGL is not evaluated while no browser is connected.
+void websocket_driver_run()
+{
+#if WS_DRIVER_LVGL_TASK
+	xTaskCreatePinnedToCore(&lvgl_task, "lvgl_task", config.lvgl_stack, NULL, config.lvgl_prio, NULL, WS_DRIVER_LVGL_CORE);
+	ESP_LOGI(TAG, "LVGL task started, priority %d", config.lvgl_prio);
+#else
+	lvgl_task(NULL);
+#endif
+}
+
+
+// Wake the task evaluating LVGL.  Must be called by other tasks after giving LVGL
+// work, for example with lv_async_call().  Commands queued with lv_cmd_set_value() and
+// the like wake it themselves.
+void websocket_driver_wake()
+{
+	if (run_task != NULL) {
+		xTaskNotifyGive(run_task);
+	}
+}
+
+
+// Load stats with the work done by the task evaluating LVGL.  The longest pass starts
+// again from 0 after each call.
+void websocket_driver_get_run_stats(websocket_driver_run_stats_t* stats)
+{
+	*stats = run_stats;
+	run_stats.max_pass_us = 0;
+}
+
+
+// Called from the application's WiFi event handler with the MAC address of each
+// station that joins or leaves the soft-AP, so the browsers' links are matched to
+// their stations without waiting for the next sample
+void websocket_driver_station(const uint8_t* mac, bool connected)
+{
+#if WS_DRIVER_WIFI_LINK
+	wifi_link_station(mac, connected);
+#endif
+}
+
+
+#if WS_DRIVER_SESSIONS
+// Set the function building the user interface of each session display.  It is called
+// by the LVGL task with the new display as the default when a client first connects to
+// a slot other than the first, whose client sees the display the application
+// registered.  The display is kept for the next client of its slot.
+void websocket_driver_set_session_cb(websocket_driver_session_cb_t cb)
+{
+	session_cb = cb;
+}
+#endif
+
+
+#if WS_DRIVER_FAIR_REFR
+// Set how much of the refresh slice a session's display gets, relative to the others
+// with something to draw and multiplied by the browsers showing it: 1 (the default) to
+// 255, 0 for 1.  Displays also get more of it the more pixels they have to redraw.
+void websocket_driver_set_session_weight(int session, uint8_t weight)
+{
+	if ((session < 0) || (session >= NUM_SESSIONS)) return;
+	sessions[session].refr_weight = (weight == 0) ? 1 : weight;
+}
+#endif
+
+
+// Hand the buffer to the sender task so LVGL can render into its other buffer while
+// this one is packed.  The sender task calls lv_disp_flush_ready() as soon as the
+// buffer has been packed into a frame, leaving the frame to be written to each client
+// by its own task.  With WS_DRIVER_LCD the application's display is sent to the panel
+// meanwhile, and the buffer is released once that is done too.
+void websocket_driver_flush(lv_disp_drv_t * drv, const lv_area_t * area, lv_color_t * color_map)
+{
+	flush_job_t job;
+	int s = disp_session(drv);
+#if WS_DRIVER_FULL_FRAME || WS_DRIVER_WHOLE_SCREEN
+	lv_disp_t* disp = lv_refr_get_disp_refreshing();
+#endif
+#if WS_DRIVER_FULL_FRAME || WS_DRIVER_HEATMAP
+	int i;
+#endif
+#if WS_DRIVER_TRACE
+	uint32_t start = trace_rec_now();
+#endif
+	
+#if WS_DRIVER_LCD
+	// The panel is sent the strip while it is packed, and LVGL gets the buffer back
+	// from whichever is done with it last
+	if (lcd_ready && (s == 0)) {
+		lcd_drv = drv;
+		lcd_holds = 2;
+		lcd_panel_flush(area, color_map);
+	}
+#endif
+	
+	job.clients = session_clients(s);
+#if WS_DRIVER_PAUSE_HIDDEN
+	job.clients = skip_hidden(job.clients, area);
+#endif
+	if ((websocket_connected && (job.clients != 0)) || shadow_kept(s)) {
+		job.drv = drv;
+		lv_area_copy(&job.area, area);
+		job.color_map = color_map;
+		job.copy = false;
+#if WS_DRIVER_SHADOW
+		job.join = false;
+#endif
+#if WS_DRIVER_ANIM_OFFLOAD
+		job.anim = false;
+#endif
+		lv_area_copy(&job.regions[0], area);
+		job.num_regions = 1;
+		job.input_seq = sessions[s].pointer.seq;
+		job.session = s;
+#if WS_DRIVER_LOSSY
+		job.refine = refining;
+#endif
+		
+#if WS_DRIVER_FULL_FRAME
+		// A screen-sized buffer is flushed once per refresh, only the areas newly
+		// invalidated for it need sending, not those redrawn from the refresh before
+		// which the clients have.  Any beyond MAX_FLUSH_REGIONS are joined into the last.
+		if (lv_disp_is_true_double_buf(disp)) {
+			job.num_regions = 0;
+			for (i=0; i<disp->inv_prev_p; i++) {
+				if (job.num_regions < MAX_FLUSH_REGIONS) {
+					lv_area_copy(&job.regions[job.num_regions++], &disp->inv_prev[i]);
+				} else {
+					lv_area_join(&job.regions[MAX_FLUSH_REGIONS - 1], &job.regions[MAX_FLUSH_REGIONS - 1], &disp->inv_prev[i]);
+				}
+			}
+		}
+#endif
+		
+#if WS_DRIVER_WHOLE_SCREEN
+		// The screen is drawn top to bottom, ending with the strip at its bottom
+		job.whole = whole_screen_refr(disp);
+		job.whole_end = job.whole && (area->y2 == lv_disp_get_ver_res(disp) - 1);
+#if WS_DRIVER_YIELD
+		// A whole screen cut short still ends its message
+		job.whole_end = job.whole_end || (job.whole && refr_yielded);
+		refr_yielded = false;
+#endif
+#endif
+#if WS_DRIVER_HEATMAP
+		if (s == 0) {
+			for (i=0; i<job.num_regions; i++) heat_add(heat_flushes, &job.regions[i], 1, false);
+		}
+#endif
+		xQueueSendToBack(flush_queue, &job, portMAX_DELAY);
+#if WS_DRIVER_TRACE
+		trace_rec_span(TRACE_FLUSH, start, 0, area, 0);
+#endif
+	} else {
+#if WS_DRIVER_SHADOW
+		if (s == 0) shadow_stale = true;
+#endif
+#if WS_DRIVER_DRAW_STREAM
+		draw_stream_reset(color_map);
+#endif
+		release_buf(drv);
+	}
+}
+
+
+#if WS_DRIVER_SCROLL_COPY
+// Called by LVGL when a page scrolls.  The copy is queued behind the buffer still
+// being packed, if any, so the browsers apply it in order between the frames.
+void websocket_driver_copy(lv_disp_drv_t * drv, const lv_area_t * area, lv_coord_t dx, lv_coord_t dy)
+{
+	flush_job_t job;
+	int s = disp_session(drv);
+
+	// A browser connecting later is sent the whole screen
+	job.clients = session_clients(s);
+#if WS_DRIVER_PAUSE_HIDDEN
+	job.clients = skip_hidden(job.clients, area);
+#endif
+	if ((!websocket_connected || (job.clients == 0)) && !shadow_kept(s)) {
+#if WS_DRIVER_SHADOW
+		if (s == 0) shadow_stale = true;
+#endif
+		return;
+	}
+
+	job.drv = drv;
+	lv_area_copy(&job.area, area);
+	job.color_map = NULL;
+	job.copy = true;
+#if WS_DRIVER_SHADOW
+	job.join = false;
+#endif
+#if WS_DRIVER_ANIM_OFFLOAD
+	job.anim = false;
+#endif
+	job.dx = dx;
+	job.dy = dy;
+	job.num_regions = 0;
+	job.input_seq = sessions[s].pointer.seq;
+	job.session = s;
+#if WS_DRIVER_LOSSY
+	job.refine = 0;
+#endif
+	xQueueSendToBack(flush_queue, &job, portMAX_DELAY);
+}
+#endif
+
+
+// Called by LVGL while it waits for a buffer to be released, blocking until the
+// sender task has packed it
+void websocket_driver_wait(lv_disp_drv_t * drv)
+{
+#if WS_DRIVER_METRICS
+	int64_t start = esp_timer_get_time();
+#endif
+	(void) xSemaphoreTake(flush_done, FLUSH_WAIT_MS / portTICK_PERIOD_MS);
+#if WS_DRIVER_METRICS
+	flush_wait_us += (uint32_t) (esp_timer_get_time() - start);
+	flush_waits++;
+#endif
+}
+
+
+// Round an area out to the WS_DRIVER_ALIGN grid, within the screen, so every region
+// sent starts on an aligned column and row
+void websocket_driver_rounder(lv_disp_drv_t * drv, lv_area_t * area)
+{
+#if WS_DRIVER_ALIGN > 1
+	area->x1 = (area->x1 / WS_DRIVER_ALIGN) * WS_DRIVER_ALIGN;
+	area->y1 = (area->y1 / WS_DRIVER_ALIGN) * WS_DRIVER_ALIGN;
+	area->x2 = LV_MATH_MIN((area->x2 / WS_DRIVER_ALIGN) * WS_DRIVER_ALIGN + WS_DRIVER_ALIGN - 1, drv->hor_res - 1);
+	area->y2 = LV_MATH_MIN((area->y2 / WS_DRIVER_ALIGN) * WS_DRIVER_ALIGN + WS_DRIVER_ALIGN - 1, drv->ver_res - 1);
+#endif
+}
+
+
+// Returns the next buffered pointer event of the pointer's session, or the last one if
+// none are waiting, and true while there are more so LVGL sees every press and release.
+// Moves that have been queued too long are skipped but changes in state never are.  Once
+// the ring is empty the newest event that overflowed it, if any, ends up where the
+// pointer really is.
+bool websocket_driver_read(lv_indev_drv_t * drv, lv_indev_data_t * data)
+{
+	session_t* s = &sessions[indev_session(drv)];
+	pointer_event_t* pointer = &s->pointer;
+	uint32_t t = s->tail;
+	pointer_event_t ev;
+	
+#if WS_DRIVER_SESSIONS
+	// Objects the event callbacks create land on the display of the session whose
+	// input they handle
+	lv_disp_set_default(s->disp);
+#endif
+	
+#if WS_DRIVER_INPUT_REC
+	// A replay stands in for the browsers
+	uint32_t wait = (s == &sessions[0]) ? input_rec_wait() : UINT32_MAX;
+	if (wait != UINT32_MAX) {
+		bool more = (wait == 0) && input_rec_next(&pointer->flag, &pointer->x, &pointer->y);
+		pointer->seq = 0;
+		s->tail = s->head;
+		data->point.x = (int16_t) pointer->x;
+		data->point.y = (int16_t) pointer->y;
+		data->state = (pointer->flag == 0) ? LV_INDEV_STATE_REL : LV_INDEV_STATE_PR;
+		return more;
+	}
+#endif
+	
+#if WS_DRIVER_INPUT_SEQ
+	// LVGL has processed the press by now
+	if (s->hint_client >= 0) {
+		send_drag_hint(s->indev, s->hint_client, s->hint_seq);
+		s->hint_client = -1;
+	}
+#endif
+	
+	while (t != s->head) {
+		__sync_synchronize();
+		ev = s->ring[t & (POINTER_RING_LEN - 1)];
+		t++;
+		if ((ev.flag == pointer->flag) && (t != s->head) &&
+			(lv_tick_elaps(ev.time) > POINTER_STALE_MS)) {
+			continue;
+		}
+#if WS_DRIVER_INPUT_SEQ
+		if ((ev.flag != 0) && (pointer->flag == 0) && viewers[ev.num].hints) {
+			s->hint_client = ev.num;
+			s->hint_seq = ev.seq;
+		}
+#endif
+		*pointer = ev;
+		break;
+	}
+	__sync_synchronize();
+	s->tail = t;
+	if ((t == s->head) && latest_take(s, &ev)) *pointer = ev;
+	
+	data->point.x = (int16_t) pointer->x;
+	data->point.y = (int16_t) pointer->y;
+	data->state = (pointer->flag == 0) ? LV_INDEV_STATE_REL : LV_INDEV_STATE_PR;
+	
+	return (t != s->head);
+}
+
+#if WS_DRIVER_KEYS
+// Returns the next buffered key of the keypad's session pressed and then released, and
+// true while there is more to read, so LVGL takes a whole batch of keys in one read.
+bool websocket_driver_read_keys(lv_indev_drv_t * drv, lv_indev_data_t * data)
+{
+	session_t* s = &sessions[keypad_session(drv)];
+	uint32_t t = s->key_tail;
+	
+	if (!s->key_down && (t != s->key_head)) {
+		__sync_synchronize();
+		s->key = s->keys[t & (KEY_RING_LEN - 1)];
+		__sync_synchronize();
+		s->key_tail = ++t;
+		s->key_down = true;
+		key_focus(s);
+		data->key = s->key;
+		data->state = LV_INDEV_STATE_PR;
+		return true;
+	}
+	
+	s->key_down = false;
+	data->key = s->key;
+	data->state = LV_INDEV_STATE_REL;
+	return (t != s->key_head);
+}
+#endif
+
+
+#if WS_DRIVER_YIELD
+// LVGL yield callback, called between the parts of a refresh.  Once a refresh has taken
+// WS_DRIVER_PREEMPT mS it ends with the part about to be flushed if the display's session
+// has input waiting, so the input is handled before the rest is drawn along with what
+// the input changes.  Once it has taken WS_DRIVER_REFR_SLICE mS, or with WS_DRIVER_FAIR_REFR
+// its display's share of that, it ends regardless, the next refresh carrying on where it
+// stopped after the LVGL loop has run its other tasks and kept to its frame budget.
+bool websocket_driver_yield(lv_disp_drv_t * drv, uint32_t elapsed)
+{
+	refr_yielded = false;
+#if WS_DRIVER_REFR_SLICE
+	uint32_t slice = config.refr_slice;
+#if WS_DRIVER_FAIR_REFR
+	if (sessions[disp_session(drv)].refr_share != 0) slice = sessions[disp_session(drv)].refr_share;
+#endif
+	if ((slice != 0) && (elapsed >= slice)) {
+		run_stats.slices++;
+		refr_yielded = true;
+		return true;
+	}
+#endif
+#if WS_DRIVER_PREEMPT
+	if ((config.preempt == 0) || (elapsed < config.preempt)) return false;
+	if (!input_waiting(&sessions[disp_session(drv)])) return false;
+	
+	// Have the input read before the refresh task runs again
+	pace_indev_reads();
+	refr_yielded = true;
+	return true;
+#else
+	return false;
+#endif
+}
+#endif
+
+
+#if WS_DRIVER_NEAR_FIRST
+// LVGL rank callback, called for each area of a refresh before any is drawn.  Areas
+// within WS_DRIVER_NEAR_FIRST pixels of where the session's display was last pressed, or
+// overlapping the object its keypad types into, rank 0 and are drawn and sent first, the
+// rest following nearest first.  Before the display has had any input every area ranks 0,
+// keeping LVGL's order.
+uint32_t websocket_driver_rank(lv_disp_drv_t * drv, const lv_area_t * area)
+{
+	session_t* s = &sessions[disp_session(drv)];
+	int32_t dx;
+	int32_t dy;
+	
+	if (config.near_first == 0) return 0;
+#if WS_DRIVER_KEYS
+	if ((s->keypad != NULL) && (s->keypad->group != NULL)) {
+		lv_obj_t* focused = lv_group_get_focused(s->keypad->group);
+		lv_area_t common;
+		
+		if ((focused != NULL) && lv_area_intersect(&common, area, &focused->coords)) return 0;
+	}
+#endif
+	if (s->pointer.time == 0) return 0;
+	
+	// Distance from the point to the nearest pixel of the area, along each axis
+	dx = LV_MATH_MAX(area->x1 - (int32_t) s->pointer.x, (int32_t) s->pointer.x - area->x2);
+	dy = LV_MATH_MAX(area->y1 - (int32_t) s->pointer.y, (int32_t) s->pointer.y - area->y2);
+	dx = LV_MATH_MAX(dx, 0);
+	dy = LV_MATH_MAX(dy, 0);
+	if ((dx <= (int32_t) config.near_first) && (dy <= (int32_t) config.near_first)) return 0;
+	return dx + dy;
+}
+#endif
+
+
+#if WS_DRIVER_RATE_CAPS
+// Cap the refresh rate of an area of disp, NULL for the default display, to once every
+// period mS.  Areas invalidated inside it are held and joined, then invalidated together
+// once period has passed since it was last refreshed, so a fast changing part of the
+// screen such as a spinner or a sensor reading can't take the bandwidth the rest needs.
+// Areas reaching outside it are not held.  Returns the cap's number for
+// websocket_driver_uncap(), or -1 if all WS_DRIVER_RATE_CAPS are in use.  Like other
+// LVGL calls it must be made from the task running LVGL.
+int websocket_driver_cap_area(lv_disp_t* disp, const lv_area_t* area, uint32_t period)
+{
+	int i;
+	
+	if (disp == NULL) disp = lv_disp_get_default();
+	i = cap_slot(NULL, NULL);
+	if ((disp == NULL) || (i < 0)) return -1;
+	
+	memset(&rate_caps[i], 0, sizeof(rate_cap_t));
+	rate_caps[i].area = *area;
+	rate_caps[i].period = period;
+	rate_caps[i].last = lv_tick_get();
+	rate_caps[i].disp = disp;
+	return i;
+}
+
+
+// Cap the refresh rate of an object as websocket_driver_cap_area() does, following it
+// as it moves.  Capping an object again changes its period, and the cap ends when the
+// object is deleted.  Set the object's own signal function, if any, first.
+int websocket_driver_cap_obj(lv_obj_t* obj, uint32_t period)
+{
+	lv_disp_t* disp = lv_obj_get_disp(obj);
+	int i = cap_slot(disp, obj);
+	
+	if (i >= 0) {
+		rate_caps[i].period = period;
+		return i;
+	}
+	i = cap_slot(NULL, NULL);
+	if (i < 0) return -1;
+	
+	memset(&rate_caps[i], 0, sizeof(rate_cap_t));
+	rate_caps[i].obj = obj;
+	rate_caps[i].signal_cb = lv_obj_get_signal_cb(obj);
+	rate_caps[i].period = period;
+	rate_caps[i].last = lv_tick_get();
+	rate_caps[i].disp = disp;
+	lv_obj_set_signal_cb(obj, cap_signal);
+	return i;
+}
+
+
+// End a cap, invalidating what it held
+void websocket_driver_uncap(int cap)
+{
+	rate_cap_t* c;
+	
+	if ((cap < 0) || (cap >= WS_DRIVER_RATE_CAPS)) return;
+	c = &rate_caps[cap];
+	if (c->disp == NULL) return;
+	if ((c->obj != NULL) && (lv_obj_get_signal_cb(c->obj) == cap_signal)) {
+		lv_obj_set_signal_cb(c->obj, c->signal_cb);
+	}
+	if (c->holding) lv_inv_area(c->disp, &c->held);
+	c->disp = NULL;
+}
+
+
+// LVGL hold callback, called with each area invalidated.  Holds areas inside a capped
+// part of the screen until caps_release() invalidates them again.
+bool websocket_driver_hold(lv_disp_drv_t * drv, const lv_area_t * area)
+{
+	rate_cap_t* c;
+	lv_area_t capped;
+	int i;
+	
+	if (caps_releasing) return false;
+	for (i=0; i<WS_DRIVER_RATE_CAPS; i++) {
+		c = &rate_caps[i];
+		if ((c->disp == NULL) || (&c->disp->driver != drv)) continue;
+		cap_area(c, &capped);
+		if (!lv_area_is_in(area, &capped)) continue;
+		
+		if (c->holding) {
+			lv_area_join(&c->held, &c->held, area);
+		} else {
+			c->held = *area;
+			c->holding = true;
+		}
+		return true;
+	}
+	return false;
+}
+#endif
+
+
+#if WS_DRIVER_MONITOR
+// LVGL monitor callback, called after each refresh with the time it took in mS and the
+// number of pixels redrawn
+void websocket_driver_monitor(lv_disp_drv_t * drv, uint32_t time, uint32_t px)
+{
+#if WS_DRIVER_TELEMETRY
+	render_cnt++;
+	render_ms += time;
+	render_px += px;
+#endif
+#if WS_DRIVER_BENCHMARK
+	e2e_bench_rendered(time, px);
+#endif
+#if WS_DRIVER_PIPE_MON
+	pipe_mon_rendered(time);
+#endif
+}
+#endif
+
+
+#if WS_DRIVER_TRACE
+// LVGL trace callback, recording each refresh and each part of an area rendered.  Only
+// the LVGL task calls it.
+void websocket_driver_trace(lv_disp_drv_t * drv, lv_disp_trace_t event, const lv_area_t * area)
+{
+	static uint32_t refr_start;
+	static uint32_t part_start;
+	
+	switch (event) {
+		case LV_DISP_TRACE_REFR_START:
+			refr_start = trace_rec_now();
+			break;
+		case LV_DISP_TRACE_REFR_END:
+			trace_rec_span(TRACE_REFR, refr_start, 0, NULL, 0);
+			break;
+		case LV_DISP_TRACE_PART_START:
+			part_start = trace_rec_now();
+			break;
+		case LV_DISP_TRACE_PART_END:
+			trace_rec_span(TRACE_RENDER, part_start, 0, area, 0);
+			break;
+	}
+}
+#endif
+
+
+#if WS_DRIVER_MICROBENCH
+// Pack the area's pixels from src, a buffer stride pixels wide, into buf the way a flush
+// sends them, with this build's encodings or as raw pixels, returning the bytes packed.
+// buf must hold the area's pixels and a region header.
+uint32_t websocket_driver_pack(uint8_t* buf, const lv_area_t* area, const lv_color_t* src, lv_coord_t stride, bool encode)
+{
+	uint32_t encodings = encode ? (ENC_CAP_DRIVER & ENC_CAP_PIXELS & ~ENC_CAP_ALIGNED) : 0;
+	
+	return pack_region(buf, area, src, stride, 0, encodings, 0) - buf;
+}
+#endif
+
+
+/**********************
+ *   STATIC FUNCTIONS
+ **********************/
+#if WS_DRIVER_STACKS_PSRAM
+// Start the websocket server with its stack in PSRAM, returning false if there isn't
+// the memory
+static bool start_server_psram()
+{
+	StackType_t* stack_buf = heap_caps_malloc(WEBSOCKET_SERVER_TASK_STACK_DEPTH, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+	StaticTask_t* task_buf = heap_caps_malloc(sizeof(StaticTask_t), MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+	
+	if ((stack_buf == NULL) || (task_buf == NULL)) {
+		heap_caps_free(stack_buf);
+		heap_caps_free(task_buf);
+		ESP_LOGW(TAG, "No PSRAM for the stack of ws_server_task");
+		return false;
+	}
+	ws_server_start_static(stack_buf, task_buf);
+	return true;
+}
+
+
+// Create a queue whose items are held in PSRAM, or in internal memory if PSRAM is short
+static QueueHandle_t create_queue_psram(UBaseType_t len, UBaseType_t item_size)
+{
+	uint8_t* storage = heap_caps_malloc(len * item_size, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+	StaticQueue_t* queue_buf = heap_caps_malloc(sizeof(StaticQueue_t), MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+	
+	if ((storage != NULL) && (queue_buf != NULL)) return xQueueCreateStatic(len, item_size, storage, queue_buf);
+	heap_caps_free(storage);
+	heap_caps_free(queue_buf);
+	return xQueueCreate(len, item_size);
+}
+#endif
+
+
+// handles websocket events
+void websocket_callback(uint8_t num, WEBSOCKET_TYPE_t type, char* msg, uint64_t len) {
+	const static char* TAG = "websocket_callback";
+
+	switch(type) {
+		case WEBSOCKET_CONNECT:
+			ESP_LOGI(TAG, "client %i connected!", num);
+			frame_tx_connect(num, clients[num].conn);
+			viewers[num].version = 0;
+			viewers[num].encodings = ENC_CAP_LEGACY;
+			viewers[num].depth = 0;
+			viewers[num].view_w = 0;
+			viewers[num].view_h = 0;
+			viewers[num].hints = false;
+			viewers[num].anims = false;
+			viewers[num].held = false;
+			viewers[num].shift = 0;
+			viewers[num].connected = lv_tick_get();
+			viewers[num].input = viewers[num].connected;
+#if WS_DRIVER_INPUT_LEASE
+			__sync_fetch_and_and(&role_told, ~(1u << num));
+#endif
+#if WS_DRIVER_WIFI_LINK
+			wifi_link_connect(num, clients[num].conn);
+#endif
+#if WS_DRIVER_BENCHMARK
+			e2e_bench_connect(num);
+#endif
+			websocket_connected = true;
+			// The LVGL task sends the client the whole screen, once it has said hello
+#if WS_DRIVER_RESUME
+			__sync_fetch_and_or(&hello_wait, 1u << num);
+#endif
+			__sync_fetch_and_or(&join_pending, 1u << num);
+			websocket_driver_wake();
+			break;
+		case WEBSOCKET_DISCONNECT_EXTERNAL:
+			ESP_LOGI(TAG, "client %i sent a disconnect message", num);
+			frame_tx_disconnect(num);
+#if WS_DRIVER_WIFI_LINK
+			wifi_link_disconnect(num);
+#endif
+			if (num_connected_clients() == 0) {
+				websocket_connected = false;
+#if WS_DRIVER_WIFI_POWER
+				websocket_driver_wake();
+#endif
+			}
+			break;
+		case WEBSOCKET_DISCONNECT_INTERNAL:
+			ESP_LOGI(TAG, "client %i was disconnected", num);
+			frame_tx_disconnect(num);
+#if WS_DRIVER_WIFI_LINK
+			wifi_link_disconnect(num);
+#endif
+			if (num_connected_clients() == 0) {
+				websocket_connected = false;
+#if WS_DRIVER_WIFI_POWER
+				websocket_driver_wake();
+#endif
+			}
+			break;
+		case WEBSOCKET_DISCONNECT_ERROR:
+			ESP_LOGI(TAG, "client %i was disconnected due to an error", num);
+			frame_tx_disconnect(num);
+#if WS_DRIVER_WIFI_LINK
+			wifi_link_disconnect(num);
+#endif
+			if (num_connected_clients() == 0) {
+				websocket_connected = false;
+#if WS_DRIVER_WIFI_POWER
+				websocket_driver_wake();
+#endif
+			}
+			break;
+		case WEBSOCKET_BIN:
+#if WS_DRIVER_INPUT_V2
+			// Batch of pointer events, only sent by a browser speaking version 2
+			if ((viewers[num].version >= 2) && ((uint32_t) len >= INPUT_MIN_LEN) && (msg[0] == INPUT_MAGIC)) {
+				compact_input(num, (const uint8_t*) &msg[1], (const uint8_t*) &msg[len]);
+			}
+			else
+#endif
+			// Pointer event, optionally followed by its sequence number
+			if (((uint32_t) len == 5) || ((uint32_t) len == 7)) {
+				pointer_input(num, (uint8_t) msg[0],
+					((uint8_t) msg[1] << 8) | (uint8_t) msg[2],
+					((uint8_t) msg[3] << 8) | (uint8_t) msg[4],
+					((uint32_t) len == 7) ? ((uint8_t) msg[5] << 8) | (uint8_t) msg[6] : 0, 0);
+			}
+			// Batch of pointer moves
+			else if (((uint32_t) len > MOVES_HDR_LEN) && (msg[0] == MOVES_MAGIC) &&
+				((uint32_t) len == MOVES_HDR_LEN + (uint8_t) msg[1] * MOVE_LEN)) {
+				const uint8_t* m = (const uint8_t*) &msg[MOVES_HDR_LEN];
+				for (int i=0; i<(uint8_t) msg[1]; i++, m+=MOVE_LEN) {
+					pointer_input(num, 1, (m[0] << 8) | m[1], (m[2] << 8) | m[3],
+						((uint8_t) msg[2] << 8) | (uint8_t) msg[3], m[4]);
+				}
+			}
+			// Acknowledgement of the binary messages decoded
+			else if ((uint32_t) len == 4) {
+				frame_tx_ack(num, ((uint8_t) msg[0] << 24) | ((uint8_t) msg[1] << 16) | ((uint8_t) msg[2] << 8) | (uint8_t) msg[3]);
+#if WS_DRIVER_CONSUMER_REFR
+				// The credits it frees may let a paused display draw again
+				if (refr_paused != 0) websocket_driver_wake();
+#endif
+			}
+			// Viewer options, from a page older than the hello
+			else if ((uint32_t) len == 1) {
+				set_view_options(num, (uint8_t) msg[0], false);
+				__sync_fetch_and_and(&hello_wait, ~(1u << num));
+				websocket_driver_wake();
+			}
+			else if (((uint32_t) len >= HELLO_LEN) && (msg[0] == HELLO_MAGIC)) {
+				viewer_hello(num, (const uint8_t*) msg, (uint32_t) len);
+			}
+			else if (((uint32_t) len == VIEWPORT_LEN) && (msg[0] == VIEWPORT_MAGIC)) {
+				set_viewport(num, (const uint8_t*) &msg[1]);
+			}
+#if WS_DRIVER_SCROLL
+			else if (((uint32_t) len == SCROLL_LEN) && (msg[0] == SCROLL_MAGIC)) {
+				scroll_input(num, (const uint8_t*) &msg[1]);
+			}
+#endif
+#if WS_DRIVER_KEYS
+			else if (((uint32_t) len > KEYS_HDR_LEN) && (msg[0] == KEYS_MAGIC) &&
+				((uint32_t) len == KEYS_HDR_LEN + (uint8_t) msg[1] * KEY_LEN)) {
+				key_input(num, (const uint8_t*) &msg[KEYS_HDR_LEN], (uint8_t) msg[1]);
+			}
+#endif
+#if WS_DRIVER_THUMBNAILS
+			else if (((uint32_t) len == SCALE_LEN) && (msg[0] == SCALE_MAGIC)) {
+				set_scale(num, (uint8_t) msg[1]);
+			}
+#endif
+#if WS_DRIVER_PAUSE_HIDDEN
+			else if (((uint32_t) len == VISIBLE_LEN) && (msg[0] == VISIBLE_MAGIC)) {
+				set_hidden(num, msg[1] == 0);
+			}
+#endif
+#if WS_DRIVER_BENCHMARK
+			// Benchmark acknowledgement: message count and decode time in uS
+			else if ((uint32_t) len == 8) {
+				e2e_bench_ack(num,
+					((uint8_t) msg[0] << 24) | ((uint8_t) msg[1] << 16) | ((uint8_t) msg[2] << 8) | (uint8_t) msg[3],
+					((uint8_t) msg[4] << 24) | ((uint8_t) msg[5] << 16) | ((uint8_t) msg[6] << 8) | (uint8_t) msg[7]);
+			}
+#endif
+			break;
+		case WEBSOCKET_PING:
+		case WEBSOCKET_PONG:
+			// The server answers pings and times out clients missing the keepalive pongs
+			break;
+		default:
+			ESP_LOGI(TAG, "client %i send unhandled websocket type %d", num, type);
+			break;
+	}
+}
+
+// applies a browser's viewer options, holding it at 8 bits per pixel if held is set
+static void set_view_options(uint8_t num, uint8_t options, bool held) {
+#if (WS_DRIVER_LOSSY && (LV_COLOR_DEPTH > 8)) || WS_DRIVER_DRAW_STREAM
+	const static char* TAG = "websocket_callback";
+#endif
+
+#if WS_DRIVER_LOSSY && (LV_COLOR_DEPTH > 8)
+	frame_tx_set_lossy(num, held || (options & VIEW_LOSSY), !held);
+	viewers[num].held = held;
+	ESP_LOGI(TAG, "client %i %s", num, held ? "8-bit" : (options & VIEW_LOSSY) ? "lossy" : "exact");
+#else
+	(void) held;
+#endif
+#if WS_DRIVER_DRAW_STREAM
+	frame_tx_set_draw(num, (options & VIEW_DRAW) != 0);
+	if (options & VIEW_DRAW) ESP_LOGI(TAG, "client %i takes draw commands", num);
+#endif
+	frame_tx_set_credits(num, (options & VIEW_ACKS) ? config.credits : 0);
+	viewers[num].hints = (options & VIEW_HINTS) != 0;
+	viewers[num].anims = (options & VIEW_ANIMS) != 0;
+}
+
+// records what a browser announced in its hello, chooses how it is sent the screen and
+// tells it the choice
+static void viewer_hello(uint8_t num, const uint8_t* msg, uint32_t len) {
+	const static char* TAG = "websocket_callback";
+	uint8_t options = msg[2];
+	uint32_t encodings = ((msg[3] << 8) | msg[4]) & ENC_CAP_DRIVER & config.encodings;
+	bool held = false;
+	bool resumed = false;
+	uint32_t token = 0;
+	char reply[128];
+	int n;
+#if WS_DRIVER_RESUME && WS_DRIVER_SESSIONS
+	const bool same_slot = true;
+#elif WS_DRIVER_RESUME
+	const bool same_slot = false;
+#endif
+
+#if WS_DRIVER_DRAW_STREAM
+	// Draw commands are shared by every browser taking them, with the other header
+	if (options & VIEW_DRAW) encodings &= ~ENC_CAP_ALIGNED;
+#endif
+	viewers[num].version = msg[1];
+	viewers[num].depth = msg[5];
+	viewers[num].view_w = (msg[6] << 8) | msg[7];
+	viewers[num].view_h = (msg[8] << 8) | msg[9];
+	viewers[num].encodings = encodings;
+
+	// A browser that would rather have fewer bits per pixel than the display has is
+	// held at 8 bits, where they are built in, so it only ever gets half the bytes.  One
+	// that asked for lossy mode as well is refined to exact pixels as usual.
+#if WS_DRIVER_LOSSY && (LV_COLOR_DEPTH > 8)
+	held = (msg[5] != 0) && (msg[5] < LV_COLOR_DEPTH) && !(options & VIEW_LOSSY);
+#endif
+	set_view_options(num, options, held);
+	ESP_LOGI(TAG, "client %i speaks version %d, viewport %dx%d, encodings 0x%x", num, msg[1],
+		viewers[num].view_w, viewers[num].view_h, encodings);
+#if WS_DRIVER_RESUME
+	// A browser back from a lost connection is only resent what it missed, in the
+	// viewport it had so moving that resends what it newly shows.  With sessions its
+	// display is only the same in the same slot.
+	if (len >= HELLO_RESUME_LEN) {
+		resumed = frame_tx_resume(num, (msg[14] << 24) | (msg[15] << 16) | (msg[16] << 8) | msg[17],
+			(msg[18] << 24) | (msg[19] << 16) | (msg[20] << 8) | msg[21], same_slot);
+		if (resumed) {
+			__sync_fetch_and_and(&join_pending, ~(1u << num));
+			ESP_LOGI(TAG, "client %i resumed its session", num);
+		}
+	}
+	__sync_fetch_and_and(&hello_wait, ~(1u << num));
+	websocket_driver_wake();
+	token = esp_random() | 1;
+	frame_tx_set_token(num, token);
+#endif
+	if (len >= HELLO_VIEWPORT_LEN) {
+		const uint8_t vp[8] = {msg[10], msg[11], msg[12], msg[13], msg[6], msg[7], msg[8], msg[9]};
+		set_viewport(num, vp);
+	}
+
+	n = snprintf(reply, sizeof(reply), "{\"hello\":{\"version\":%d,\"encodings\":%u,\"depth\":%d,\"credits\":%u,\"token\":%u,\"resumed\":%s}}",
+		PROTO_VERSION, encodings, (held || (options & VIEW_LOSSY)) ? 8 : LV_COLOR_DEPTH,
+		(options & VIEW_ACKS) ? config.credits : 0, token, resumed ? "true" : "false");
+	frame_tx_send_text(num, reply, n);
+}
+
+// Keep a browser up to date only in the part of the screen its viewport message shows,
+// from the big-endian x, y, width and height in msg, in the pixels of its thumbnail if
+// it has one.  The browser is resent what it hasn't been sent there.
+static void set_viewport(uint8_t num, const uint8_t* msg) {
+	lv_coord_t w = lv_disp_get_hor_res(sessions[0].disp);
+	lv_coord_t h = lv_disp_get_ver_res(sessions[0].disp);
+	uint8_t shift = viewers[num].shift;
+	uint32_t x = ((msg[0] << 8) | msg[1]) << shift;
+	uint32_t y = ((msg[2] << 8) | msg[3]) << shift;
+	lv_area_t vp;
+
+	// An area off the screen or of no size leaves x2 < x1 and nothing to send
+	vp.x1 = LV_MATH_MIN(x, (uint32_t) w);
+	vp.y1 = LV_MATH_MIN(y, (uint32_t) h);
+	vp.x2 = LV_MATH_MIN(x + (((msg[4] << 8) | msg[5]) << shift), (uint32_t) w) - 1;
+	vp.y2 = LV_MATH_MIN(y + (((msg[6] << 8) | msg[7]) << shift), (uint32_t) h) - 1;
+	frame_tx_set_viewport(num, &vp);
+#if WS_DRIVER_WIFI_POWER
+	// A hidden tab sends a viewport of no size
+	websocket_driver_wake();
+#endif
+}
+
+// Remove the parts of regions outside viewport, returning how many regions are left
+static int clip_regions(lv_area_t* regions, int num_regions, const lv_area_t* viewport) {
+	int i;
+	int n = 0;
+
+	for (i=0; i<num_regions; i++) {
+		if (lv_area_intersect(&regions[n], &regions[i], viewport)) n++;
+	}
+	return n;
+}
+
+#if WS_DRIVER_THUMBNAILS
+// Send a browser the screen scaled down by 2^shift from now on, resending all of it.
+// The resend is queued behind the frames already packed at the old scale.
+static void set_scale(uint8_t num, uint8_t shift) {
+	const static char* TAG = "websocket_callback";
+	uint32_t len;
+
+	if ((shift > THUMB_MAX_SHIFT) || (shift == viewers[num].shift)) return;
+	if (shift != 0) {
+		xSemaphoreTake(thumb_mutex, portMAX_DELAY);
+		if (thumb_buf == NULL) {
+			len = ((LV_HOR_RES_MAX >> 1) + 1) * ((draw_lines >> 1) + 1);
+#if WS_DRIVER_SHADOW
+			if (shadow_fb_enabled()) {
+				len = LV_MATH_MAX(len, ((LV_HOR_RES_MAX + 1) >> 1) * ((LV_VER_RES_MAX + 1) >> 1));
+			}
+#endif
+			thumb_buf = heap_caps_malloc(len * sizeof(lv_color_t), MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+			if (thumb_buf == NULL) {
+				thumb_buf = heap_caps_malloc(len * sizeof(lv_color_t), MALLOC_CAP_8BIT);
+			}
+		}
+		xSemaphoreGive(thumb_mutex);
+		if (thumb_buf == NULL) {
+			ESP_LOGW(TAG, "No memory for the thumbnail of client %i", num);
+			return;
+		}
+	}
+	viewers[num].shift = shift;
+	ESP_LOGI(TAG, "client %i scaled 1/%d", num, 1 << shift);
+	__sync_fetch_and_or(&join_pending, 1u << num);
+	websocket_driver_wake();
+}
+
+// Returns the clients whose bits are set in clients that are sent thumbnails
+static uint32_t viewer_thumbs(uint32_t clients) {
+	uint32_t thumbs = 0;
+	uint32_t bits;
+
+	for (bits = clients; bits != 0; bits &= bits - 1) {
+		if (viewers[__builtin_ctz(bits)].shift != 0) thumbs |= bits & -bits;
+	}
+	return thumbs;
+}
+
+// Scale an area of the screen down by 2^shift, to the blocks of pixels it touches
+static void thumb_area_down(lv_area_t* area, uint8_t shift) {
+	area->x1 >>= shift;
+	area->y1 >>= shift;
+	area->x2 >>= shift;
+	area->y2 >>= shift;
+}
+
+// Load each pixel of dst_area, an area of the screen scaled down by 2^shift, as the
+// average of the block of pixels it scales from.  dst points to its first pixel in a
+// buffer dst_stride pixels wide and src holds the pixels of src_area; blocks only partly
+// in src_area are averaged over that part.
+static void thumb_scale(lv_color_t* dst, lv_coord_t dst_stride, const lv_area_t* dst_area, const lv_color_t* src, const lv_area_t* src_area, uint8_t shift) {
+	lv_coord_t stride = lv_area_get_width(src_area);
+	lv_coord_t x, y, bx, by;
+	lv_area_t block;
+	lv_color32_t c;
+	uint32_t r, g, b, n;
+
+	for (y = dst_area->y1; y <= dst_area->y2; y++) {
+		for (x = dst_area->x1; x <= dst_area->x2; x++) {
+			block.x1 = LV_MATH_MAX(x << shift, src_area->x1);
+			block.y1 = LV_MATH_MAX(y << shift, src_area->y1);
+			block.x2 = LV_MATH_MIN(((x + 1) << shift) - 1, src_area->x2);
+			block.y2 = LV_MATH_MIN(((y + 1) << shift) - 1, src_area->y2);
+			r = g = b = 0;
+			for (by = block.y1; by <= block.y2; by++) {
+				for (bx = block.x1; bx <= block.x2; bx++) {
+					c.full = lv_color_to32(src[(by - src_area->y1) * stride + (bx - src_area->x1)]);
+					r += c.ch.red;
+					g += c.ch.green;
+					b += c.ch.blue;
+				}
+			}
+			n = lv_area_get_size(&block);
+			dst[x - dst_area->x1] = lv_color_make((r + n / 2) / n, (g + n / 2) / n, (b + n / 2) / n);
+		}
+		dst += dst_stride;
+	}
+}
+#endif
+
+// Scale an area of a thumbnail 2^shift times smaller than the screen back up to the
+// pixels of the screen it shows
+static void thumb_area_up(lv_area_t* area, uint8_t shift) {
+	if (shift == 0) return;
+	area->x1 <<= shift;
+	area->y1 <<= shift;
+	area->x2 = LV_MATH_MIN(((area->x2 + 1) << shift) - 1, lv_disp_get_hor_res(NULL) - 1);
+	area->y2 = LV_MATH_MIN(((area->y2 + 1) << shift) - 1, lv_disp_get_ver_res(NULL) - 1);
+}
+
+// Returns the encodings every client whose bit is set in clients decodes, and
+// ENC_CAP_ALIGNED if they all take aligned headers
+static uint32_t viewer_encodings(uint32_t clients) {
+	int i;
+	uint32_t encodings = (clients != 0) ? (ENC_CAP_LEGACY | ENC_CAP_ALIGNED) : ENC_CAP_LEGACY;
+
+	for (i=0; i<WEBSOCKET_SERVER_MAX_CLIENTS; i++) {
+		if (clients & (1 << i)) {
+			encodings &= viewers[i].encodings;
+		}
+	}
+	return encodings;
+}
+
+// Returns the clients whose bits are set in clients that decode the same pixel
+// encodings and show the same viewport at the same scale as the lowest numbered of them
+static uint32_t viewer_group(uint32_t clients) {
+	uint32_t encodings = viewers[__builtin_ctz(clients)].encodings & ENC_CAP_PIXELS;
+	uint8_t shift = viewers[__builtin_ctz(clients)].shift;
+	uint32_t group = 0;
+	uint32_t bits;
+	lv_area_t vp, other;
+	bool clipped = frame_tx_get_viewport(__builtin_ctz(clients), &vp);
+	int i;
+
+	for (bits = clients; bits != 0; bits &= bits - 1) {
+		i = __builtin_ctz(bits);
+		if (((viewers[i].encodings & ENC_CAP_PIXELS) == encodings) && (viewers[i].shift == shift) &&
+			(frame_tx_get_viewport(i, &other) == clipped) &&
+			(!clipped || (memcmp(&vp, &other, sizeof(lv_area_t)) == 0))) {
+			group |= 1 << i;
+		}
+	}
+	return group;
+}
+
+#if !WS_DRIVER_ASSETS
+// FNV-1a hash of a served file, used as its ETag
+static uint32_t http_etag(const uint8_t* data, uint32_t len) {
+	uint32_t h = 2166136261u;
+
+	while (len--) {
+		h = (h ^ *data++) * 16777619u;
+	}
+	return h;
+}
+#endif
+
+// Returns true if the request's If-None-Match lists tag, n characters long
+static bool http_etag_listed(const ws_request_t* req, const char* tag, int n) {
+	int i;
+
+	for (i=0; (req->etag != NULL) && (i + n <= req->etag_len); i++) {
+		if (memcmp(&req->etag[i], tag, n) == 0) return true;
+	}
+	return false;
+}
+
+// Parses the request's Range for a len byte file.  Returns 1 loading first and last
+// for a single satisfiable range, -1 for an unsatisfiable one and 0 to send the whole
+// file, as for no Range, several ranges or one that doesn't parse.
+static int http_range(const ws_request_t* req, uint32_t len, uint32_t* first, uint32_t* last) {
+	const char* p = req->range;
+	const char* end = p + req->range_len;
+	bool has_first = false;
+	bool has_last = false;
+	uint32_t a = 0;
+	uint32_t b = 0;
+
+	if ((p == NULL) || (len == 0) || (req->range_len < 7) || (memcmp(p, "bytes=", 6) != 0)) return 0;
+	for (p += 6; (p < end) && (*p >= '0') && (*p <= '9'); p++) {
+		a = a * 10 + (*p - '0');
+		has_first = true;
+	}
+	if ((p == end) || (*p++ != '-')) return 0;
+	for (; (p < end) && (*p >= '0') && (*p <= '9'); p++) {
+		b = b * 10 + (*p - '0');
+		has_last = true;
+	}
+	if (p != end) return 0;
+	
+	if (!has_first) {
+		// The last b bytes
+		if (!has_last) return 0;
+		if (b == 0) return -1;
+		*first = (b < len) ? len - b : 0;
+		*last = len - 1;
+	} else {
+		if (has_last && (b < a)) return 0;
+		if (a >= len) return -1;
+		*first = a;
+		*last = (has_last && (b < len)) ? b : len - 1;
+	}
+	return 1;
+}
+
+// sends a file, the part of it a Range asks for, or just 304 Not Modified if the
+// browser's cached copy is current
+static void http_send_file(struct netconn *conn, const ws_request_t* req, const char* headers, const uint8_t* data, uint32_t len, uint32_t etag) {
+	char header[320];
+	char tag[12];
+	uint32_t first;
+	uint32_t last;
+	int n;
+
+	n = sprintf(tag, "\"%08x\"", etag);
+	if (http_etag_listed(req, tag, n)) {
+		n = sprintf(header, "HTTP/1.1 304 Not Modified\r\nETag: %s\r\n\r\n", tag);
+		netconn_write(conn, header, n, NETCONN_COPY);
+		return;
+	}
+
+	switch (http_range(req, len, &first, &last)) {
+		case 1:
+			n = snprintf(header, sizeof(header), "HTTP/1.1 206 Partial Content\r\n%sContent-Length: %u\r\n"
+				"Content-Range: bytes %u-%u/%u\r\nETag: %s\r\n\r\n", headers, last - first + 1, first, last, len, tag);
+			netconn_write(conn, header, n, NETCONN_COPY);
+			netconn_write(conn, data + first, last - first + 1, NETCONN_NOCOPY);
+			break;
+		case -1:
+			n = sprintf(header, "HTTP/1.1 416 Range Not Satisfiable\r\nContent-Range: bytes */%u\r\nContent-Length: 0\r\n\r\n", len);
+			netconn_write(conn, header, n, NETCONN_COPY);
+			break;
+		default:
+			n = snprintf(header, sizeof(header), "HTTP/1.1 200 OK\r\n%sContent-Length: %u\r\nAccept-Ranges: bytes\r\nETag: %s\r\n\r\n",
+				headers, len, tag);
+			netconn_write(conn, header, n, NETCONN_COPY);
+			netconn_write(conn, data, len, NETCONN_NOCOPY);
+			break;
+	}
+}
+
+#if WS_DRIVER_ASSETS
+// sends the asset at path, less its leading '/' and any query string, with gzip content
+// encoding when it was packed compressed as name.gz.  Pages and scripts must be
+// revalidated so a newly flashed image is picked up, other files are cached a day.
+static void http_send_asset(struct netconn *conn, const ws_request_t* req, const char* path, uint16_t path_len) {
+	const static char NOT_FOUND[] = "HTTP/1.1 404 Not Found\r\nContent-Length: 0\r\n\r\n";
+	static const struct {
+		const char* ext;
+		const char* type;
+		bool revalidate;
+	} TYPES[] = {
+		{ ".html", "text/html", true },
+		{ ".js", "application/javascript", true },
+		{ ".css", "text/css", true },
+		{ ".json", "application/json", true },
+		{ ".ico", "image/x-icon", false },
+		{ ".png", "image/png", false },
+		{ ".jpg", "image/jpeg", false },
+		{ ".svg", "image/svg+xml", false },
+	};
+	char name[32];
+	char headers[160];
+	const char* type = "application/octet-stream";
+	bool revalidate = false;
+	bool gzip;
+	asset_t asset;
+	int i, n;
+
+	while ((path_len > 0) && (*path == '/')) {
+		path++;
+		path_len--;
+	}
+	if (path_len + 4 > sizeof(name)) {
+		netconn_write(conn, NOT_FOUND, sizeof(NOT_FOUND) - 1, NETCONN_NOCOPY);
+		return;
+	}
+	memcpy(name, path, path_len);
+	memcpy(&name[path_len], ".gz", 4);
+	gzip = asset_fs_find(name, path_len + 3, &asset);
+	if (!gzip && !asset_fs_find(name, path_len, &asset)) {
+		netconn_write(conn, NOT_FOUND, sizeof(NOT_FOUND) - 1, NETCONN_NOCOPY);
+		return;
+	}
+
+	for (i=0; i<sizeof(TYPES)/sizeof(TYPES[0]); i++) {
+		n = strlen(TYPES[i].ext);
+		if ((path_len > n) && (memcmp(&path[path_len - n], TYPES[i].ext, n) == 0)) {
+			type = TYPES[i].type;
+			revalidate = TYPES[i].revalidate;
+			break;
+		}
+	}
+	snprintf(headers, sizeof(headers), "Content-Type: %s\r\n%sCache-Control: %s\r\n", type,
+		gzip ? "Content-Encoding: gzip\r\n" : "", revalidate ? "no-cache" : "max-age=86400");
+	http_send_file(conn, req, headers, asset.data, asset.len, asset.etag);
+}
+#endif
+
+// serves any clients.  Connections that haven't sent a request yet are put back on the
+// queue so a browser's idle preconnected socket doesn't hold up the handler.
+static void http_serve(http_conn_t* c) {
+	const static char* TAG = "http_server";
+#if !WS_DRIVER_ASSETS
+	// The page must be revalidated so a new firmware's page is picked up.  The icon
+	// rarely changes.
+	const static char HTML_HEADERS[] = "Content-Type: text/html\r\nContent-Encoding: gzip\r\nCache-Control: no-cache\r\n";
+	const static char ICO_HEADERS[] = "Content-Type: image/x-icon\r\nCache-Control: max-age=86400\r\n";
+	static uint32_t index_html_etag = 0;
+	static uint32_t favicon_ico_etag = 0;
+#endif
+
+	struct netconn* conn = c->conn;
+	struct netbuf* inbuf;
+	char* buf;
+	uint16_t buflen;
+	ws_request_t req;
+	bool get;
+	err_t err;
+
+#if !WS_DRIVER_ASSETS
+	// default page, gzip compressed by the build
+	extern const uint8_t index_html_start[] asm("_binary_index_html_gz_start");
+	extern const uint8_t index_html_end[] asm("_binary_index_html_gz_end");
+	const uint32_t index_html_len = index_html_end - index_html_start;
+	
+	// favicon.ico (automatically requested by browsers from the "root directory")
+	extern const uint8_t favicon_ico_start[] asm("_binary_favicon_ico_start");
+	extern const uint8_t favicon_ico_end[] asm("_binary_favicon_ico_end");
+	const uint32_t favicon_ico_len = favicon_ico_end - favicon_ico_start;
+
+	if (index_html_etag == 0) {
+		index_html_etag = http_etag(index_html_start, index_html_len);
+		favicon_ico_etag = http_etag(favicon_ico_start, favicon_ico_len);
+	}
+#endif
+
+	netconn_set_recvtimeout(conn, HTTP_POLL_MS);
+	err = netconn_recv(conn, &inbuf);
+	if (err == ERR_TIMEOUT) {
+		if (((xTaskGetTickCount() - c->accepted) < pdMS_TO_TICKS(HTTP_IDLE_MS)) &&
+			(xQueueSendToBack(client_queue, c, 0) == pdTRUE)) {
+			return;
+		}
+		ESP_LOGI(TAG, "idle connection, closing");
+		netconn_close(conn);
+		netconn_delete(conn);
+		return;
+	}
+	ESP_LOGI(TAG, "read from client");
+	if(err == ERR_OK) {
+		netbuf_data(inbuf, (void**)&buf, &buflen);
+		// The request line and the headers routed on are found in one pass
+		if (buf && ws_parse_request(buf, buflen, &req)) {
+			get = (req.method_len == 3) && (memcmp(req.method, "GET", 3) == 0);
+			
+			// default page
+			if (get && ws_request_path_is(&req, "/") && !req.upgrade) {
+				
+				ESP_LOGI(TAG, "Sending /");
+#if WS_DRIVER_ASSETS
+				http_send_asset(conn, &req, "index.html", 10);
+#else
+				http_send_file(conn, &req, HTML_HEADERS, index_html_start, index_html_len, index_html_etag);
+#endif
+				netconn_close(conn);
+				netconn_delete(conn);
+				netbuf_delete(inbuf);
+			}
+
+			// default page websocket
+			else if (get && ws_request_path_is(&req, "/") && req.upgrade) {
+				ESP_LOGI(TAG, "Requesting websocket on /");
+				netconn_set_recvtimeout(conn, HTTP_IDLE_MS);
+				ws_server_add_client_request(conn, &req, "/", NULL, websocket_callback);
+				netbuf_delete(inbuf);
+			}
+			
+#if WS_DRIVER_TRACE
+			else if(get && ws_request_path_is(&req, "/trace")) {
+				ESP_LOGI(TAG, "Sending /trace");
+				trace_rec_write(conn);
+				netconn_close(conn);
+				netconn_delete(conn);
+				netbuf_delete(inbuf);
+			}
+#endif
+			
+#if WS_DRIVER_INPUT_REC
+			else if(get && ws_request_path_is(&req, "/input")) {
+				ESP_LOGI(TAG, "Sending /input");
+				input_rec_write(conn);
+				netconn_close(conn);
+				netconn_delete(conn);
+				netbuf_delete(inbuf);
+			}
+			
+			else if((req.method_len == 4) && (memcmp(req.method, "POST", 4) == 0) && ws_request_path_is(&req, "/input")) {
+				ESP_LOGI(TAG, "Receiving /input");
+				input_rec_read(conn, &req, buf, buflen);
+				netconn_close(conn);
+				netconn_delete(conn);
+				netbuf_delete(inbuf);
+			}
+			
+			else if(get && (ws_request_path_is(&req, "/input/record") || ws_request_path_is(&req, "/input/replay") ||
+					ws_request_path_is(&req, "/input/stop"))) {
+				ESP_LOGI(TAG, "Input recorder request");
+				http_send_input_ctl(conn, req.path + 7);
+				netconn_close(conn);
+				netconn_delete(conn);
+				netbuf_delete(inbuf);
+			}
+#endif
+			
+#if WS_DRIVER_CAPTURE
+			else if(get && ws_request_path_is(&req, "/capture")) {
+				ESP_LOGI(TAG, "Sending /capture");
+				capture_rec_write(conn);
+				netconn_close(conn);
+				netconn_delete(conn);
+				netbuf_delete(inbuf);
+			}
+			
+			else if(get && (ws_request_path_is(&req, "/capture/start") || ws_request_path_is(&req, "/capture/stop"))) {
+				ESP_LOGI(TAG, "Capture request");
+				http_send_capture_ctl(conn, req.path + 9);
+				netconn_close(conn);
+				netconn_delete(conn);
+				netbuf_delete(inbuf);
+			}
+#endif
+			
+#if WS_DRIVER_SNAPSHOT
+			else if(get && ws_request_path_is(&req, "/snapshot")) {
+				ESP_LOGI(TAG, "Sending /snapshot");
+				http_send_snapshot(conn);
+				netconn_close(conn);
+				netconn_delete(conn);
+				netbuf_delete(inbuf);
+			}
+			
+			else if(get && ws_request_path_is(&req, "/snapshot.png")) {
+				ESP_LOGI(TAG, "Sending /snapshot.png");
+				http_send_snapshot_png(conn);
+				netconn_close(conn);
+				netconn_delete(conn);
+				netbuf_delete(inbuf);
+			}
+#endif
+			
+#if WS_DRIVER_METRICS
+			else if(get && ws_request_path_is(&req, "/metrics")) {
+				ESP_LOGI(TAG, "Sending /metrics");
+				http_send_metrics(conn);
+				netconn_close(conn);
+				netconn_delete(conn);
+				netbuf_delete(inbuf);
+			}
+#endif
+			
+#if WS_DRIVER_TUNE
+			else if(ws_request_path_is(&req, "/config") || ws_request_path_is(&req, "/config/reset")) {
+				ESP_LOGI(TAG, "Config request");
+				http_send_config(conn, &req, get);
+				netconn_close(conn);
+				netconn_delete(conn);
+				netbuf_delete(inbuf);
+			}
+#endif
+			
+#if WS_DRIVER_ASSETS
+			// anything else is looked up in the asset partition
+			else if(get && !req.upgrade) {
+				ESP_LOGI(TAG, "Sending %.*s", req.path_len, req.path);
+				http_send_asset(conn, &req, req.path, ws_request_path_len(&req));
+				netconn_close(conn);
+				netconn_delete(conn);
+				netbuf_delete(inbuf);
+			}
+#else
+			else if(get && ws_request_path_is(&req, "/favicon.ico")) {
+				ESP_LOGI(TAG, "Sending favicon.ico");
+				http_send_file(conn, &req, ICO_HEADERS, favicon_ico_start, favicon_ico_len, favicon_ico_etag);
+				netconn_close(conn);
+				netconn_delete(conn);
+				netbuf_delete(inbuf);
+			}
+#endif
+
+			else {
+				ESP_LOGI(TAG, "Unknown request");
+				netconn_close(conn);
+				netconn_delete(conn);
+				netbuf_delete(inbuf);
+			}
+		}
+		else {
+			ESP_LOGI(TAG, "Unknown request (empty?...)");
+			netconn_close(conn);
+			netconn_delete(conn);
+			netbuf_delete(inbuf);
+		}
+	}
+	else {
+		ESP_LOGE(TAG, "error on read, closing connection");
+		netconn_close(conn);
+		netconn_delete(conn);
+		netbuf_delete(inbuf);
+	}
+}
+
+#if WS_DRIVER_INPUT_REC
+// starts recording, starts replaying or stops the input recorder as cmd (the request
+// path after /input/) asks, replying with whether it could
+static void http_send_input_ctl(struct netconn *conn, const char* cmd) {
+	const static char OK[] = "HTTP/1.1 204 No Content\r\nCache-Control: no-store\r\nConnection: close\r\n\r\n";
+	const static char CONFLICT[] = "HTTP/1.1 409 Conflict\r\nContent-Length: 0\r\nConnection: close\r\n\r\n";
+	bool ok = true;
+	
+	if (strncmp(cmd, "record", 6) == 0) {
+		ok = input_rec_record();
+	} else if (strncmp(cmd, "replay", 6) == 0) {
+		ok = input_rec_replay();
+	} else {
+		input_rec_stop();
+	}
+	
+	if (ok) {
+		netconn_write(conn, OK, sizeof(OK) - 1, NETCONN_NOCOPY);
+	} else {
+		netconn_write(conn, CONFLICT, sizeof(CONFLICT) - 1, NETCONN_NOCOPY);
+	}
+}
+#endif
+
+#if WS_DRIVER_CAPTURE
+// starts or stops a capture as cmd (the request path after /capture/) asks, replying
+// with whether it could
+static void http_send_capture_ctl(struct netconn *conn, const char* cmd) {
+	const static char OK[] = "HTTP/1.1 204 No Content\r\nCache-Control: no-store\r\nConnection: close\r\n\r\n";
+	const static char CONFLICT[] = "HTTP/1.1 409 Conflict\r\nContent-Length: 0\r\nConnection: close\r\n\r\n";
+	bool ok = true;
+	
+	if (strncmp(cmd, "start", 5) == 0) {
+		ok = capture_rec_start();
+	} else {
+		capture_rec_stop();
+	}
+	
+	if (ok) {
+		netconn_write(conn, OK, sizeof(OK) - 1, NETCONN_NOCOPY);
+	} else {
+		netconn_write(conn, CONFLICT, sizeof(CONFLICT) - 1, NETCONN_NOCOPY);
+	}
+}
+#endif
+
+#if WS_DRIVER_SNAPSHOT
+// sends the screen as the shadow framebuffer holds it, so a page can paint it while its
+// websocket opens.  The body is the pixel messages a joining client would be sent, each
+// after its big-endian length, packed a frame at a time so a flush being sent in between
+// tears nothing the live stream won't redraw.  Sends 204 No Content if the shadow may not
+// hold the whole screen, which it only doesn't if the LVGL task is too busy to draw
+// the screen for a device nobody has watched yet.
+static void http_send_snapshot(struct netconn *conn) {
+	const static char* TAG = "http_server";
+	const static char NO_CONTENT[] = "HTTP/1.1 204 No Content\r\nCache-Control: no-store\r\n\r\n";
+	const static char UNAVAILABLE[] = "HTTP/1.1 503 Service Unavailable\r\nContent-Length: 0\r\n\r\n";
+	const static char HEADERS[] = "HTTP/1.1 200 OK\r\nContent-Type: application/octet-stream\r\nCache-Control: no-store\r\nConnection: close\r\n\r\n";
+	frame_t frame;
+	lv_area_t area;
+	const lv_color_t* src;
+	lv_coord_t stride;
+	uint8_t len[4];
+	int done;
+	
+	if (!snapshot_ready()) {
+		netconn_write(conn, NO_CONTENT, sizeof(NO_CONTENT) - 1, NETCONN_NOCOPY);
+		return;
+	}
+	frame.buf = malloc(frame_buf_len);
+	if (frame.buf == NULL) {
+		ESP_LOGE(TAG, "No memory for /snapshot");
+		netconn_write(conn, UNAVAILABLE, sizeof(UNAVAILABLE) - 1, NETCONN_NOCOPY);
+		return;
+	}
+	
+	netconn_write(conn, HEADERS, sizeof(HEADERS) - 1, NETCONN_NOCOPY);
+	src = shadow_fb_get_buf(&stride);
+	lv_area_set(&area, 0, 0, lv_disp_get_hor_res(sessions[0].disp) - 1, lv_disp_get_ver_res(sessions[0].disp) - 1);
+	do {
+		xSemaphoreTake(shadow_mutex, portMAX_DELAY);
+		done = pack_frame(&frame, &area, 1, src, 0, 0, stride, 0, false, ENC_CAP_DRIVER & ENC_CAP_PIXELS & ~ENC_CAP_ALIGNED, 0);
+		xSemaphoreGive(shadow_mutex);
+		len[0] = (frame.len >> 24) & 0xFF;
+		len[1] = (frame.len >> 16) & 0xFF;
+		len[2] = (frame.len >> 8) & 0xFF;
+		len[3] =  frame.len        & 0xFF;
+		if ((netconn_write(conn, len, sizeof(len), NETCONN_COPY) != ERR_OK) ||
+			(netconn_write(conn, frame.buf, frame.len, NETCONN_COPY) != ERR_OK)) {
+			break;
+		}
+	} while (done == 0);
+	free(frame.buf);
+}
+
+// sends the screen as the shadow framebuffer holds it as a PNG, for screenshots that
+// cost LVGL nothing.  Each row is copied out under the shadow's lock and encoded as it
+// is sent, so only a few rows are ever held and a flush landing part way through shows
+// in the rows after it.  Answers as /snapshot does if the shadow isn't whole.
+static void http_send_snapshot_png(struct netconn *conn) {
+	const static char* TAG = "http_server";
+	const static char NO_CONTENT[] = "HTTP/1.1 204 No Content\r\nCache-Control: no-store\r\n\r\n";
+	const static char UNAVAILABLE[] = "HTTP/1.1 503 Service Unavailable\r\nContent-Length: 0\r\n\r\n";
+	png_conn_t out = {conn, false};
+	png_enc_t* enc = NULL;
+	lv_color_t* row;
+	const lv_color_t* src;
+	lv_coord_t stride;
+	lv_coord_t w = lv_disp_get_hor_res(sessions[0].disp);
+	lv_coord_t h = lv_disp_get_ver_res(sessions[0].disp);
+	lv_coord_t y;
+	
+	if (!snapshot_ready()) {
+		netconn_write(conn, NO_CONTENT, sizeof(NO_CONTENT) - 1, NETCONN_NOCOPY);
+		return;
+	}
+	row = malloc(w * sizeof(lv_color_t));
+	if (row != NULL) {
+		enc = png_enc_begin(w, h, png_write, &out);
+	}
+	if (enc == NULL) {
+		ESP_LOGE(TAG, "No memory for /snapshot.png");
+		netconn_write(conn, UNAVAILABLE, sizeof(UNAVAILABLE) - 1, NETCONN_NOCOPY);
+		free(row);
+		return;
+	}
+	
+	src = shadow_fb_get_buf(&stride);
+	for (y = 0; y < h; y++) {
+		xSemaphoreTake(shadow_mutex, portMAX_DELAY);
+		memcpy(row, &src[y * stride], w * sizeof(lv_color_t));
+		xSemaphoreGive(shadow_mutex);
+		if (!png_enc_row(enc, row)) break;
+	}
+	(void) png_enc_end(enc);
+	free(row);
+}
+
+// writes a piece of /snapshot.png, after the HTTP header if it is the first
+static bool png_write(void* ctx, const uint8_t* data, int len) {
+	const static char HEADERS[] = "HTTP/1.1 200 OK\r\nContent-Type: image/png\r\nCache-Control: no-store\r\nConnection: close\r\n\r\n";
+	png_conn_t* out = (png_conn_t*) ctx;
+	
+	if (!out->started) {
+		out->started = true;
+		if (netconn_write(out->conn, HEADERS, sizeof(HEADERS) - 1, NETCONN_NOCOPY) != ERR_OK) return false;
+	}
+	return netconn_write(out->conn, data, len, NETCONN_COPY) == ERR_OK;
+}
+
+// waits for the LVGL task to draw the screen into the shadow framebuffer if nobody has
+// watched since the device started, returning whether the shadow holds the whole screen
+static bool snapshot_ready() {
+	if (shadow_fb_enabled() && shadow_stale) {
+		snapshot_request = true;
+		websocket_driver_wake();
+		(void) xSemaphoreTake(snapshot_done, pdMS_TO_TICKS(SNAPSHOT_WAIT_MS));
+	}
+	return shadow_fb_enabled() && !shadow_stale;
+}
+#endif
+
+#if WS_DRIVER_METRICS
+// sends plain text statistics in the Prometheus text format
+static void http_send_metrics(struct netconn *conn) {
+	const static char* TAG = "http_server";
+	char header[128];
+	char* buf;
+	int len, n;
+	
+	xSemaphoreTake(metrics_lock, portMAX_DELAY);
+	
+	// Have the LVGL task read its memory monitor, reporting the last reading if it is
+	// busy for longer
+	mem_mon_request = true;
+	websocket_driver_wake();
+	(void) xSemaphoreTake(mem_mon_done, pdMS_TO_TICKS(METRICS_MEM_WAIT_MS));
+	
+	// Room for tasks created while the text is built
+	len = METRICS_LEN + (uxTaskGetNumberOfTasks() + 4) * METRICS_TASK_LEN;
+	buf = malloc(len);
+	n = (buf != NULL) ? metrics_text(buf, len) : 0;
+	if (n > 0) {
+		if (n >= len) {
+			ESP_LOGW(TAG, "/metrics truncated");
+			n = len - 1;
+		}
+		len = sprintf(header, "HTTP/1.1 200 OK\r\nContent-Type: text/plain; version=0.0.4\r\nCache-Control: no-store\r\nContent-Length: %d\r\n\r\n", n);
+		netconn_write(conn, header, len, NETCONN_COPY);
+		netconn_write(conn, buf, n, NETCONN_COPY);
+	} else {
+		ESP_LOGE(TAG, "No memory for /metrics");
+		len = sprintf(header, "HTTP/1.1 503 Service Unavailable\r\nContent-Length: 0\r\n\r\n");
+		netconn_write(conn, header, len, NETCONN_COPY);
+	}
+	
+	free(buf);
+	xSemaphoreGive(metrics_lock);
+}
+
+// Load buf with the heap use of each memory region, LVGL's memory monitor, each
+// task's stack high-water mark and CPU time and each client's transmit counters.
+// Returns the length as snprintf() does, or 0 if there wasn't memory to list the tasks.
+static int metrics_text(char* buf, int len) {
+	frame_tx_stats_t stats;
+#if WS_DRIVER_WIFI_LINK
+	wifi_link_t link;
+#endif
+	int n = 0;
+	int i;
+#if configUSE_TRACE_FACILITY
+	TaskStatus_t* tasks;
+	UBaseType_t num_tasks;
+	uint32_t total_time;
+#endif
+	
+	n += metrics_heap(&buf[n], len - n, "internal", MALLOC_CAP_INTERNAL);
+	n += metrics_heap(&buf[n], len - n, "dma", MALLOC_CAP_DMA);
+	n += metrics_heap(&buf[n], len - n, "spiram", MALLOC_CAP_SPIRAM);
+	
+	if (n < len) n += snprintf(&buf[n], len - n,
+		"lvgl_mem_total_bytes %u\n"
+		"lvgl_mem_free_bytes %u\n"
+		"lvgl_mem_free_biggest_bytes %u\n"
+		"lvgl_mem_pool_free_bytes %u\n"
+		"lvgl_mem_used_blocks %u\n"
+		"lvgl_mem_free_blocks %u\n"
+		"lvgl_mem_used_percent %u\n"
+		"lvgl_mem_frag_percent %u\n",
+		mem_mon.total_size, mem_mon.free_size, mem_mon.free_biggest_size, mem_mon.pool_free_size,
+		mem_mon.used_cnt, mem_mon.free_cnt, mem_mon.used_pct, mem_mon.frag_pct);
+	
+#if LV_USE_REFR_PROF
+	// Draw time is in LV_REFR_PROF_TIME_EXPR units, CPU cycles by default
+	for (i=0; i<num_prof_types; i++) {
+		if (n < len) n += snprintf(&buf[n], len - n,
+			"lvgl_draw_cycles_total{type=\"%s\",phase=\"main\"} %llu\n"
+			"lvgl_draw_cycles_total{type=\"%s\",phase=\"post\"} %llu\n"
+			"lvgl_draw_calls_total{type=\"%s\"} %u\n",
+			prof_types[i].type, (unsigned long long) prof_types[i].main,
+			prof_types[i].type, (unsigned long long) prof_types[i].post,
+			prof_types[i].type, prof_types[i].calls);
+	}
+	for (i=0; i<num_prof_objs; i++) {
+		if (n < len) n += snprintf(&buf[n], len - n,
+			"lvgl_obj_draw_cycles_total{obj=\"%p\",type=\"%s\",phase=\"main\"} %llu\n"
+			"lvgl_obj_draw_cycles_total{obj=\"%p\",type=\"%s\",phase=\"post\"} %llu\n"
+			"lvgl_obj_draw_calls_total{obj=\"%p\",type=\"%s\"} %u\n",
+			prof_objs[i].obj, prof_objs[i].type, (unsigned long long) prof_objs[i].main,
+			prof_objs[i].obj, prof_objs[i].type, (unsigned long long) prof_objs[i].post,
+			prof_objs[i].obj, prof_objs[i].type, prof_objs[i].calls);
+	}
+#endif
+	
+#if LV_USE_TASK_PROF
+	// Run time is in LV_TASK_PROF_TIME_EXPR units, CPU cycles by default.  The time
+	// lv_task_handler() ran outside the tasks is its own, the rest of the elapsed time idle.
+	for (i=0; i<num_task_profs; i++) {
+		const char* name = (task_profs[i].task_cb == lv_disp_refr_task) ? "refr" :
+			(task_profs[i].task_cb == lv_indev_read_task) ? "indev" : "";
+		if (n < len) n += snprintf(&buf[n], len - n,
+			"lvgl_task_cycles_total{cb=\"%p\",name=\"%s\",prio=\"%u\"} %llu\n"
+			"lvgl_task_cycles_max{cb=\"%p\",name=\"%s\",prio=\"%u\"} %u\n"
+			"lvgl_task_calls_total{cb=\"%p\",name=\"%s\",prio=\"%u\"} %u\n",
+			task_profs[i].task_cb, name, task_profs[i].prio, (unsigned long long) task_profs[i].time,
+			task_profs[i].task_cb, name, task_profs[i].prio, task_profs[i].max,
+			task_profs[i].task_cb, name, task_profs[i].prio, task_profs[i].calls);
+	}
+	if (n < len) n += snprintf(&buf[n], len - n,
+		"lvgl_task_handler_cycles_total %llu\n"
+		"lvgl_task_elapsed_cycles_total %llu\n",
+		(unsigned long long) task_prof_busy, (unsigned long long) task_prof_elapsed);
+#endif
+	
+#if configUSE_TRACE_FACILITY
+	num_tasks = uxTaskGetNumberOfTasks() + 4;
+	tasks = malloc(num_tasks * sizeof(TaskStatus_t));
+	if (tasks == NULL) return 0;
+	num_tasks = uxTaskGetSystemState(tasks, num_tasks, &total_time);
+	for (i=0; i<num_tasks; i++) {
+		// Several tasks share a name so the task number tells them apart
+		if (n < len) n += snprintf(&buf[n], len - n, "task_stack_free_min_bytes{task=\"%s\",num=\"%u\"} %u\n",
+			tasks[i].pcTaskName, tasks[i].xTaskNumber, tasks[i].usStackHighWaterMark);
+#if configGENERATE_RUN_TIME_STATS
+		if (n < len) n += snprintf(&buf[n], len - n, "task_cpu_time_total{task=\"%s\",num=\"%u\"} %u\n",
+			tasks[i].pcTaskName, tasks[i].xTaskNumber, tasks[i].ulRunTimeCounter);
+#endif
+	}
+	free(tasks);
+#if configGENERATE_RUN_TIME_STATS
+	if (n < len) n += snprintf(&buf[n], len - n, "task_cpu_time_elapsed_total %u\n", total_time);
+#endif
+#endif
+	
+	if (n < len) n += snprintf(&buf[n], len - n,
+		"ws_encode_us_total %u\n"
+		"ws_encode_jobs_total %u\n"
+		"lvgl_flush_wait_us_total %u\n"
+		"lvgl_flush_waits_total %u\n",
+		encode_us, encode_jobs, flush_wait_us, flush_waits);
+	if (n < len) n += snprintf(&buf[n], len - n,
+		"lvgl_run_passes_total %u\n"
+		"lvgl_run_busy_us_total %u\n"
+		"lvgl_run_over_budget_total %u\n"
+		"lvgl_run_yields_total %u\n"
+		"lvgl_run_refr_slices_total %u\n",
+		run_stats.passes, run_stats.busy_us, run_stats.over_budget, run_stats.yields, run_stats.slices);
+	
+	if (n < len) n += snprintf(&buf[n], len - n, "ws_clients %d\n", num_connected_clients());
+	for (i=0; i<WEBSOCKET_SERVER_MAX_CLIENTS; i++) {
+		if (!frame_tx_get_stats(i, &stats)) continue;
+		if (n < len) n += snprintf(&buf[n], len - n,
+			"ws_client_tx_bytes_total{client=\"%d\"} %u\n"
+			"ws_client_tx_frames_total{client=\"%d\"} %u\n"
+			"ws_client_dropped_frames_total{client=\"%d\"} %u\n"
+			"ws_client_queued_frames{client=\"%d\"} %u\n",
+			i, stats.bytes, i, stats.sent, i, stats.dropped, i, stats.queued);
+#if WS_DRIVER_WIFI_LINK
+		if ((n < len) && wifi_link_get(i, &link)) n += snprintf(&buf[n], len - n,
+			"ws_client_rssi_dbm{client=\"%d\",mac=\"%02x:%02x:%02x:%02x:%02x:%02x\",phy=\"%s\"} %d\n"
+			"ws_client_link_weight_percent{client=\"%d\"} %u\n",
+			i, link.mac[0], link.mac[1], link.mac[2], link.mac[3], link.mac[4], link.mac[5],
+			wifi_link_phy_name(link.phy), link.rssi, i, link.weight);
+#endif
+	}
+	
+	return n;
+}
+
+// Load buf with the heap metrics of one memory region, returning their length as
+// snprintf() does.  Regions the board doesn't have are left out.
+static int metrics_heap(char* buf, int len, const char* region, uint32_t caps) {
+	multi_heap_info_t info;
+	
+	heap_caps_get_info(&info, caps);
+	if ((len <= 0) || ((info.total_free_bytes + info.total_allocated_bytes) == 0)) return 0;
+	return snprintf(buf, len,
+		"heap_free_bytes{region=\"%s\"} %u\n"
+		"heap_allocated_bytes{region=\"%s\"} %u\n"
+		"heap_free_min_bytes{region=\"%s\"} %u\n"
+		"heap_largest_free_block_bytes{region=\"%s\"} %u\n",
+		region, (uint32_t) info.total_free_bytes, region, (uint32_t) info.total_allocated_bytes,
+		region, (uint32_t) info.minimum_free_bytes, region, (uint32_t) info.largest_free_block);
+}
+#endif
+
+#if WS_DRIVER_TUNE
+// GET /config sends the parameters in use as JSON.  POST /config?name=value&... changes
+// them and saves them to NVS, POST /config/reset goes back to the menuconfig values.
+// Either sends the parameters as they are after, 400 if a name or value is bad or 500
+// if they could not be saved.
+static void http_send_config(struct netconn *conn, const ws_request_t* req, bool get) {
+	const static char* TAG = "http_server";
+	websocket_driver_config_t cfg;
+	char header[128];
+	char buf[512];
+	const char* query = memchr(req->path, '?', req->path_len);
+	bool post = (req->method_len == 4) && (memcmp(req->method, "POST", 4) == 0);
+	const char* status = NULL;
+	int len, n;
+	
+	xSemaphoreTake(tune_lock, portMAX_DELAY);
+	websocket_driver_get_config(&cfg);
+	if (post && ws_request_path_is(req, "/config/reset")) {
+		websocket_driver_config_default(&cfg);
+		websocket_driver_set_config(&cfg);
+		if (!tune_store_erase()) status = "500 Internal Server Error";
+		ESP_LOGI(TAG, "Configuration reset");
+	} else if (post && (query != NULL) && ws_request_path_is(req, "/config")) {
+		query++;
+		if (!tune_store_parse(&cfg, query, req->path + req->path_len - query)) {
+			status = "400 Bad Request";
+		} else {
+			websocket_driver_set_config(&cfg);
+			if (!tune_store_save(&cfg)) status = "500 Internal Server Error";
+		}
+	} else if (!get || !ws_request_path_is(req, "/config")) {
+		status = "400 Bad Request";
+	}
+	xSemaphoreGive(tune_lock);
+	
+	if (status == NULL) {
+		n = tune_store_format(&cfg, buf, sizeof(buf));
+		len = sprintf(header, "HTTP/1.1 200 OK\r\nContent-Type: application/json\r\nCache-Control: no-store\r\nContent-Length: %d\r\n\r\n", n);
+		netconn_write(conn, header, len, NETCONN_COPY);
+		netconn_write(conn, buf, n, NETCONN_COPY);
+	} else {
+		len = sprintf(header, "HTTP/1.1 %s\r\nContent-Length: 0\r\n\r\n", status);
+		netconn_write(conn, header, len, NETCONN_COPY);
+	}
+}
+#endif
+
+// handles clients when they first connect. passes to a queue
+static void server_task(void* pvParameters) {
+	const static char* TAG = "server_task";
+	struct netconn *conn, *newconn;
+	static err_t err;
+	http_conn_t c;
+
+	conn = netconn_new(NETCONN_TCP);
+	netconn_bind(conn, NULL, 80);
+	netconn_listen(conn);
+	ESP_LOGI(TAG,"server listening");
+	do {
+		err = netconn_accept(conn, &newconn);
+		ESP_LOGI(TAG, "new client");
+		if(err == ERR_OK) {
+			c.conn = newconn;
+			c.accepted = xTaskGetTickCount();
+			xQueueSendToBack(client_queue, &c, portMAX_DELAY);
+			//http_serve(newconn);
+		}
+	} while(err == ERR_OK);
+	netconn_close(conn);
+	netconn_delete(conn);
+	ESP_LOGE(TAG,"task ending, rebooting board");
+	esp_restart();
+}
+
+#if WS_DRIVER_RAW_PORT
+// accepts native viewers on WS_DRIVER_RAW_PORT.  They skip HTTP, so each is made a client
+// at once, with raw framing but otherwise like a browser.
+static void raw_server_task(void* pvParameters) {
+	const static char* TAG = "raw_server_task";
+	struct netconn *conn, *newconn;
+	err_t err;
+
+	conn = netconn_new(NETCONN_TCP);
+	if (netconn_bind(conn, NULL, WS_DRIVER_RAW_PORT) != ERR_OK) {
+		ESP_LOGE(TAG, "can't listen on port %d", WS_DRIVER_RAW_PORT);
+		netconn_delete(conn);
+		vTaskDelete(NULL);
+		return;
+	}
+	netconn_listen(conn);
+	ESP_LOGI(TAG, "raw viewers on port %d", WS_DRIVER_RAW_PORT);
+	do {
+		err = netconn_accept(conn, &newconn);
+		if (err == ERR_OK) {
+			ESP_LOGI(TAG, "new raw viewer");
+			netconn_set_recvtimeout(newconn, HTTP_IDLE_MS);
+			ws_server_add_client_raw(newconn, "/", websocket_callback);
+		}
+	} while (err == ERR_OK);
+	netconn_close(conn);
+	netconn_delete(conn);
+	ESP_LOGE(TAG, "task ending");
+	vTaskDelete(NULL);
+}
+#endif
+
+#if WS_DRIVER_TLS
+// accepts https and wss browsers on WS_DRIVER_TLS_PORT, running the handshake for each
+// before serving its request.  A browser resuming its session skips most of it.
+static void tls_server_task(void* pvParameters) {
+	const static char* TAG = "tls_server_task";
+	extern const uint8_t server_cert_start[] asm("_binary_server_cert_pem_start");
+	extern const uint8_t server_cert_end[] asm("_binary_server_cert_pem_end");
+	extern const uint8_t server_key_start[] asm("_binary_server_key_pem_start");
+	extern const uint8_t server_key_end[] asm("_binary_server_key_pem_end");
+	struct netconn *conn, *newconn;
+	ws_tls_t* tls;
+	err_t err;
+
+	// The embedded PEM text is terminated, which mbedTLS counts in its length
+	if (!ws_tls_init(server_cert_start, server_cert_end - server_cert_start,
+		server_key_start, server_key_end - server_key_start)) {
+		ESP_LOGE(TAG, "can't load the certificate and key");
+		vTaskDelete(NULL);
+		return;
+	}
+
+	conn = netconn_new(NETCONN_TCP);
+	if (netconn_bind(conn, NULL, WS_DRIVER_TLS_PORT) != ERR_OK) {
+		ESP_LOGE(TAG, "can't listen on port %d", WS_DRIVER_TLS_PORT);
+		netconn_delete(conn);
+		vTaskDelete(NULL);
+		return;
+	}
+	netconn_listen(conn);
+	ESP_LOGI(TAG, "https and wss on port %d", WS_DRIVER_TLS_PORT);
+	do {
+		err = netconn_accept(conn, &newconn);
+		if (err == ERR_OK) {
+			netconn_set_recvtimeout(newconn, HTTP_IDLE_MS);
+			tls = ws_tls_accept(newconn);
+			if (tls != NULL) {
+				tls_serve(newconn, tls);
+			} else {
+				ESP_LOGI(TAG, "handshake failed");
+				netconn_close(newconn);
+				netconn_delete(newconn);
+			}
+		}
+	} while (err == ERR_OK);
+	netconn_close(conn);
+	netconn_delete(conn);
+	ESP_LOGE(TAG, "task ending");
+	vTaskDelete(NULL);
+}
+
+
+// reads a request through the session and upgrades it to a client, whose frames are then
+// encrypted as they are sent, or answers it with the page and closes the connection
+static void tls_serve(struct netconn* conn, ws_tls_t* tls) {
+	const static char* TAG = "tls_server_task";
+	const static char NOT_FOUND[] = "HTTP/1.1 404 Not Found\r\nContent-Length: 0\r\n\r\n";
+	const static char HTML_HEADERS[] = "Content-Type: text/html\r\nContent-Encoding: gzip\r\nCache-Control: no-cache\r\n";
+	char buf[TLS_REQ_LEN];
+	char header[192];
+	char* data;
+	const uint8_t* page;
+	uint32_t page_len;
+	uint16_t len = 0;
+	uint16_t n;
+	ws_request_t req;
+	bool get;
+	err_t err;
+#if WS_DRIVER_ASSETS
+	asset_t asset;
+#else
+	extern const uint8_t index_html_start[] asm("_binary_index_html_gz_start");
+	extern const uint8_t index_html_end[] asm("_binary_index_html_gz_end");
+#endif
+
+	// A request usually comes in one record, but read on to the end of its headers, waiting
+	// up to the idle timeout for each part
+	while (len < sizeof(buf)) {
+		err = ws_tls_read(tls, &data, &n);
+		if (err == ERR_WOULDBLOCK) {
+			if (ws_tls_wait(tls) != ERR_OK) break;
+			continue;
+		}
+		if (err != ERR_OK) break;
+		n = LV_MATH_MIN(n, sizeof(buf) - len);
+		memcpy(&buf[len], data, n);
+		len += n;
+		if (ws_parse_request(buf, len, &req) && (req.body != NULL)) break;
+	}
+	if ((len == 0) || !ws_parse_request(buf, len, &req)) {
+		ws_tls_close(tls);
+		netconn_close(conn);
+		netconn_delete(conn);
+		return;
+	}
+	get = (req.method_len == 3) && (memcmp(req.method, "GET", 3) == 0);
+
+	if (get && ws_request_path_is(&req, "/") && req.upgrade) {
+		ESP_LOGI(TAG, "Requesting wss websocket on /");
+		ws_server_add_client_tls(conn, tls, &req, "/", NULL, websocket_callback);
+		return;
+	}
+
+	page = NULL;
+	page_len = 0;
+	if (get && ws_request_path_is(&req, "/")) {
+#if WS_DRIVER_ASSETS
+		if (asset_fs_find("index.html.gz", 13, &asset)) {
+			page = asset.data;
+			page_len = asset.len;
+		}
+#else
+		page = index_html_start;
+		page_len = index_html_end - index_html_start;
+#endif
+	}
+	if (page != NULL) {
+		ESP_LOGI(TAG, "Sending / over TLS");
+		n = snprintf(header, sizeof(header), "HTTP/1.1 200 OK\r\n%sContent-Length: %u\r\n\r\n", HTML_HEADERS, page_len);
+		if (ws_tls_write_all(tls, header, n) == ERR_OK) {
+			(void) ws_tls_write_all(tls, page, page_len);
+		}
+	} else {
+		(void) ws_tls_write_all(tls, NOT_FOUND, sizeof(NOT_FOUND) - 1);
+	}
+	ws_tls_close(tls);
+	netconn_close(conn);
+	netconn_delete(conn);
+}
+#endif
+
+// receives clients from queue, handles them.  WS_DRIVER_HTTP_TASKS of these share the
+// queue.
+static void server_handle_task(void* pvParameters) {
+	const static char* TAG = "server_handle_task";
+	http_conn_t c;
+	ESP_LOGI(TAG, "task starting");
+	for(;;) {
+		xQueueReceive(client_queue, &c, portMAX_DELAY);
+		if (!c.conn) continue;
+		http_serve(&c);
+	}
+	vTaskDelete(NULL);
+}
+
+// packs flushed buffers, releases them back to LVGL and queues them for the clients
+static void sender_task(void* pvParameters) {
+	const static char* TAG = "sender_task";
+	flush_job_t job;
+#if WS_DRIVER_METRICS || WS_DRIVER_PIPE_MON
+	int64_t start;
+#endif
+	ESP_LOGI(TAG, "task starting");
+	for(;;) {
+		xQueueReceive(flush_queue, &job, portMAX_DELAY);
+#if WS_DRIVER_METRICS || WS_DRIVER_PIPE_MON
+		start = esp_timer_get_time();
+#endif
+#if WS_DRIVER_MEM_LOW
+		govern_memory();
+#endif
+#if WS_DRIVER_SHADOW
+		if (job.join) {
+			send_join(&job);
+		} else
+#endif
+#if WS_DRIVER_SCROLL_COPY
+		if (job.copy) {
+			send_copy(&job);
+		} else
+#endif
+#if WS_DRIVER_ANIM_OFFLOAD
+		if (job.anim) {
+			send_anim(&job);
+		} else
+#endif
+		{
+			send_flush(&job);
+		}
+#if WS_DRIVER_METRICS
+		encode_us += (uint32_t) (esp_timer_get_time() - start);
+		encode_jobs++;
+#endif
+#if WS_DRIVER_PIPE_MON
+		pipe_mon_encoded((uint32_t) (esp_timer_get_time() - start));
+#endif
+	}
+	vTaskDelete(NULL);
+}
+
+#if WS_DRIVER_MEM_LOW
+// Let each client have only one frame waiting while internal memory is short, the full
+// depth again once a quarter more than WS_DRIVER_MEM_LOW is free so the limit doesn't
+// flap around it
+static void govern_memory()
+{
+	static bool short_mem = false;
+	uint32_t avail = heap_caps_get_free_size(MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+	
+	if (!short_mem && (avail < WS_DRIVER_MEM_LOW)) {
+		ESP_LOGW(TAG, "%u bytes free, clients limited to one frame waiting", avail);
+		frame_tx_set_depth(1);
+		short_mem = true;
+	} else if (short_mem && (avail >= WS_DRIVER_MEM_LOW + WS_DRIVER_MEM_LOW / 4)) {
+		ESP_LOGI(TAG, "%u bytes free, clients' frame limit lifted", avail);
+		frame_tx_set_depth(WS_DRIVER_FRAME_BUFS);
+		short_mem = false;
+	}
+}
+#endif
+
+// Pack a flushed buffer into frames and queue them for the connected clients that see
+// its display.  The pixel frames of the strips of a whole-screen refresh are fragments of
+// one message, ended after the last strip.
+static void send_flush(const flush_job_t* job)
+{
+	int num_regions = 0;
+	lv_area_t regions[MAX_FLUSH_REGIONS];
+	frame_t* frame = NULL;
+	uint32_t exact = job->clients;
+	uint32_t frame_clients = 0;
+#if WS_DRIVER_LOSSY
+	frame_t* lossy_frame = NULL;
+	uint32_t lossy = 0;
+	uint32_t lossy_clients = 0;
+#endif
+#if WS_DRIVER_DRAW_STREAM
+	frame_t* draw_frame = NULL;
+	uint32_t draw = 0;
+	uint32_t forget;
+	uint32_t pixels_len;
+	uint32_t images_len;
+#endif
+#if WS_DRIVER_SHADOW
+	bool shadow = shadow_fb_enabled() && (job->session == 0);
+	bool locked = false;
+#endif
+	bool wrapped = false;
+	
+	if (websocket_connected) {
+#if WS_DRIVER_SHADOW
+		// Only send the tiles that differ from what the browsers already have.  The
+		// shadow is of session 0's display, and a client resent part of it must get
+		// these tiles either in the resend or after it.
+		if (shadow) {
+			xSemaphoreTake(shadow_mutex, portMAX_DELAY);
+			locked = true;
+			num_regions = shadow_fb_update(&job->area, job->color_map, regions, MAX_FLUSH_REGIONS);
+		} else
+#endif
+		{
+			num_regions = job->num_regions;
+			memcpy(regions, job->regions, num_regions * sizeof(lv_area_t));
+		}
+		
+#if WS_DRIVER_LOSSY
+		// Clients in lossy mode get approximate pixels packed for them alone, unless
+		// the flush is refining them
+		lossy = frame_tx_clients(true) & ~job->refine & job->clients;
+		exact = (frame_tx_clients(false) | (frame_tx_clients(true) & job->refine)) & job->clients;
+		if (lossy != 0) {
+			lossy_frame = pack_groups(job, regions, num_regions, true, lossy, &lossy_clients);
+		}
+#endif
+		
+#if WS_DRIVER_DRAW_STREAM
+		// Clients taking draw commands are sent the ones that drew the buffer unless its
+		// pixels pack into one frame no larger.  Clients that lost glyphs have them all
+		// defined again by the next draw frame.  Only session 0's buffers are recorded.
+		// The pixels a draw frame competes with are packed for the other clients as one
+		// group, so while thumbnails, which must be scaled, are being sent everyone gets
+		// pixels.
+		draw = frame_tx_draw_clients(&forget) & job->clients;
+		draw_stream_forget(forget);
+		draw_resetting |= forget;
+#if WS_DRIVER_THUMBNAILS
+		if (viewer_thumbs(job->clients & frame_tx_connected()) != 0) draw = 0;
+#endif
+		if (job->session == 0) {
+			draw_stream_set_active(draw != 0);
+		}
+		if ((draw != 0) && (num_regions > 0)) {
+#if WS_DRIVER_LOSSY
+			// There may be only two frames, so don't hold a third
+			if (lossy_frame != NULL) {
+				frame_tx_send_to(lossy_frame, lossy_clients);
+				lossy_frame = NULL;
+			}
+#endif
+			draw_frame = pack_draw(job, draw, &images_len);
+		}
+		if (draw_frame != NULL) {
+			// Image bands are sent once, so only the rest competes with the pixels
+			frame = pack_flush(job, job->color_map, &job->area, regions, num_regions, false, exact & ~draw, 0, &pixels_len);
+			if ((frame != NULL) && (pixels_len == frame->len) && (frame->len <= draw_frame->len - images_len)) {
+				frame_tx_release(draw_frame);
+				draw_frame = NULL;
+			} else {
+				exact &= ~draw;
+			}
+			frame_clients = exact;
+		} else
+#endif
+		if (exact != 0) {
+#if WS_DRIVER_LOSSY
+			// Each further group needs a frame of its own
+			if ((lossy_frame != NULL) && (viewer_group(exact) != exact)) {
+				frame_tx_send_to(lossy_frame, lossy_clients);
+				lossy_frame = NULL;
+			}
+#endif
+#if WS_DRIVER_ZERO_COPY
+			frame = wrap_flush(job, regions, num_regions, exact, &frame_clients);
+			wrapped = (frame != NULL);
+#if WS_DRIVER_HEATMAP
+			if (wrapped && (job->session == 0)) heat_add(heat_bytes, &frame->area, frame->len, true);
+#endif
+			if (!wrapped)
+#endif
+			frame = pack_groups(job, regions, num_regions, false, exact, &frame_clients);
+		}
+	}
+#if WS_DRIVER_SNAPSHOT
+	// Nobody sees the flush, but the shadow is kept whole for /snapshot
+	else if (shadow) {
+		xSemaphoreTake(shadow_mutex, portMAX_DELAY);
+		locked = true;
+		(void) shadow_fb_update(&job->area, job->color_map, regions, MAX_FLUSH_REGIONS);
+	}
+#elif WS_DRIVER_SHADOW
+	else if (shadow) {
+		shadow_stale = true;
+	}
+#endif
+	
+	// LVGL may reuse its buffer now that the pixels have been packed, or once the last
+	// client has been written a frame sending the buffer itself
+#if WS_DRIVER_DRAW_STREAM
+	draw_stream_reset(job->color_map);
+#endif
+	if (!wrapped) {
+		release_buf(job->drv);
+	}
+	
+#if WS_DRIVER_DRAW_STREAM
+	if (draw_frame != NULL) {
+		draw_frame->draw_reset = draw_resetting & draw;
+		draw_resetting &= ~draw;
+		draw_stream_commit(draw);
+#if WS_DRIVER_HEATMAP
+		if (job->session == 0) heat_add(heat_bytes, &job->area, draw_frame->len, true);
+#endif
+		frame_tx_send_to(draw_frame, draw);
+	}
+#endif
+#if WS_DRIVER_LOSSY
+	if (lossy_frame != NULL) {
+		frame_tx_send_to(lossy_frame, lossy_clients);
+	}
+#endif
+	if (frame != NULL) {
+		frame_tx_send_to(frame, frame_clients);
+	}
+#if WS_DRIVER_WHOLE_SCREEN
+	if (job->whole_end && websocket_connected) {
+		frame_tx_end(job->clients);
+	}
+#endif
+#if WS_DRIVER_SHADOW
+	if (locked) {
+		xSemaphoreGive(shadow_mutex);
+	}
+#endif
+}
+
+// Give a flushed buffer back to LVGL, unless the panel is still being sent it
+static void release_buf(lv_disp_drv_t* drv)
+{
+#if WS_DRIVER_LCD
+	if ((drv == lcd_drv) && (__sync_sub_and_fetch(&lcd_holds, 1) != 0)) return;
+#endif
+	lv_disp_flush_ready(drv);
+	xSemaphoreGive(flush_done);
+}
+
+#if WS_DRIVER_LCD
+// Called from the SPI interrupt when the panel has been sent a strip, giving the buffer
+// back to LVGL if the sender task is done with it too
+static void lcd_flushed()
+{
+	BaseType_t woken = pdFALSE;
+
+	if (__sync_sub_and_fetch(&lcd_holds, 1) != 0) return;
+	lv_disp_flush_ready(lcd_drv);
+	xSemaphoreGiveFromISR(flush_done, &woken);
+	if (woken == pdTRUE) portYIELD_FROM_ISR();
+}
+#endif
+
+// Pack the regions of a flush once for each group of the clients whose bits are set in
+// clients that decode the same encodings and show the same viewport at the same scale,
+// so every client shares the frames packed for its group.  Only what is in the viewport
+// is packed and a group seeing none of the regions gets no frame.  Thumbnails are packed
+// as the blocks of pixels the regions touch.  Each frame but the last is queued as
+// soon as it is full.  Returns the last
+// frame, for the caller to queue once LVGL has its buffer back, and loads last_clients
+// with the group it is for.
+static frame_t* pack_groups(const flush_job_t* job, const lv_area_t* regions, int num_regions, bool lossy, uint32_t clients, uint32_t* last_clients)
+{
+	lv_area_t group_regions[MAX_FLUSH_REGIONS];
+	lv_area_t vp;
+	frame_t* frame = NULL;
+	uint32_t group;
+	int n;
+#if WS_DRIVER_THUMBNAILS
+	uint8_t shift;
+	int i;
+	const lv_color_t* src;
+	lv_area_t src_area;
+#if WS_DRIVER_SHADOW
+	lv_coord_t stride;
+#endif
+#endif
+
+	*last_clients = 0;
+	clients &= frame_tx_connected();
+	while (clients != 0) {
+		group = viewer_group(clients);
+		clients &= ~group;
+		memcpy(group_regions, regions, num_regions * sizeof(lv_area_t));
+		n = num_regions;
+		if (frame_tx_get_viewport(__builtin_ctz(group), &vp)) {
+			n = clip_regions(group_regions, n, &vp);
+			if (n == 0) continue;
+		}
+		if (frame != NULL) {
+			frame_tx_send_to(frame, *last_clients);
+		}
+		*last_clients = group;
+#if WS_DRIVER_THUMBNAILS
+		shift = viewers[__builtin_ctz(group)].shift;
+		if (shift != 0) {
+			// Blocks are scaled from the shadow framebuffer, already holding the flush,
+			// when it can be so those straddling the edge of the flush are whole
+			src = job->color_map;
+			lv_area_copy(&src_area, &job->area);
+#if WS_DRIVER_SHADOW
+			if (shadow_fb_enabled() && (job->session == 0)) {
+				src = shadow_fb_get_buf(&stride);
+				lv_area_set(&src_area, 0, 0, stride - 1, lv_disp_get_ver_res(NULL) - 1);
+			}
+#endif
+			lv_area_copy(&vp, &job->area);
+			thumb_area_down(&vp, shift);
+			xSemaphoreTake(thumb_mutex, portMAX_DELAY);
+			for (i=0; i<n; i++) {
+				thumb_area_down(&group_regions[i], shift);
+				thumb_scale(&thumb_buf[(group_regions[i].y1 - vp.y1) * lv_area_get_width(&vp) + (group_regions[i].x1 - vp.x1)],
+					lv_area_get_width(&vp), &group_regions[i], src, &src_area, shift);
+			}
+			frame = pack_flush(job, thumb_buf, &vp, group_regions, n, lossy, group, shift, NULL);
+			xSemaphoreGive(thumb_mutex);
+			continue;
+		}
+#endif
+		frame = pack_flush(job, job->color_map, &job->area, group_regions, n, lossy, group, 0, NULL);
+	}
+	return frame;
+}
+
+#if WS_DRIVER_ZERO_COPY
+// Returns a frame sending the draw buffer of a flush itself, its header written in the
+// room left in front of it, when it is one of the buffers with that room and the
+// clients whose bits are set in clients form a single group seeing it all unscaled.
+// Otherwise returns NULL for the regions to be packed.  The buffer is given back to
+// LVGL once the frame has been written to every client it is queued for.  An aligned
+// region can't be padded, so only whole words of pixels are sent this way.
+static frame_t* wrap_flush(const flush_job_t* job, const lv_area_t* regions, int num_regions, uint32_t clients, uint32_t* frame_clients)
+{
+	uint32_t len = lv_area_get_size(&job->area) * sizeof(lv_color_t);
+	uint8_t* hdr;
+	lv_area_t vp;
+	frame_t* frame;
+	bool aligned;
+	
+	if ((job->color_map != zero_copy_bufs[0]) && (job->color_map != zero_copy_bufs[1])) return NULL;
+	if ((num_regions != 1) || (memcmp(&regions[0], &job->area, sizeof(lv_area_t)) != 0)) return NULL;
+	clients &= frame_tx_connected();
+	if ((clients == 0) || (viewer_group(clients) != clients)) return NULL;
+	if (frame_tx_get_viewport(__builtin_ctz(clients), &vp)) return NULL;
+#if WS_DRIVER_THUMBNAILS
+	if (viewers[__builtin_ctz(clients)].shift != 0) return NULL;
+#endif
+	aligned = (viewer_encodings(clients) & ENC_CAP_ALIGNED) != 0;
+	if (aligned && (len & 3)) return NULL;
+	
+	hdr = (uint8_t*) job->color_map - (aligned ? PIXEL_ALIGNED_HEADER_LEN : PIXEL_BUF_HEADER_LEN);
+	frame = frame_tx_wrap(hdr, ((uint8_t*) job->color_map - hdr) + len, wrap_released, job->drv);
+	if (frame == NULL) return NULL;
+	(void) pack_header(hdr, &job->area, job->input_seq, 0, aligned);
+	lv_area_copy(&frame->area, &job->area);
+#if WS_DRIVER_WHOLE_SCREEN
+	frame->more = job->whole;
+#endif
+	*frame_clients = clients;
+	return frame;
+}
+
+// Called with the frames locked when the last client is done with a frame sending a
+// draw buffer, giving the buffer back to LVGL
+static void wrap_released(void* arg)
+{
+	release_buf((lv_disp_drv_t*) arg);
+}
+#endif
+
+// Pack the regions of a flush into frames from src, holding the pixels of src_area of the
+// screen scaled down by 2^shift, approximately if lossy is set, queueing each frame but
+// the last for the clients whose bits are set in clients as soon as it is full.  Returns
+// the last frame, for the caller to queue once LVGL has its buffer back, and loads len,
+// if given, with the bytes packed into all the frames.
+static frame_t* pack_flush(const flush_job_t* job, const lv_color_t* src, const lv_area_t* src_area, lv_area_t* regions, int num_regions, bool lossy, uint32_t clients, uint8_t shift, uint32_t* len)
+{
+	int i = 0;
+	lv_coord_t stride = lv_area_get_width(src_area);
+	frame_t* frame = NULL;
+	uint32_t packed = 0;
+	uint32_t encodings = viewer_encodings(clients);
+#if WS_DRIVER_BENCHMARK
+	int64_t start;
+#endif
+#if WS_DRIVER_TRACE
+	uint32_t pack_start;
+#endif
+	
+	while (i < num_regions) {
+		if (frame != NULL) {
+			frame_tx_send_to(frame, clients);
+		}
+		frame = frame_tx_get();
+#if WS_DRIVER_WHOLE_SCREEN
+		frame->more = job->whole;
+#endif
+#if WS_DRIVER_BENCHMARK
+		start = esp_timer_get_time();
+#endif
+#if WS_DRIVER_TRACE
+		pack_start = trace_rec_now();
+#endif
+		i += pack_frame(frame, &regions[i], num_regions - i, src,
+			src_area->x1, src_area->y1, stride, job->input_seq, lossy, encodings, shift);
+#if WS_DRIVER_BENCHMARK
+		e2e_bench_packed(frame->len, (uint32_t) (esp_timer_get_time() - start));
+#endif
+#if WS_DRIVER_TRACE
+		trace_rec_span(TRACE_PACK, pack_start, 0, &frame->area, frame->len);
+#endif
+#if WS_DRIVER_HEATMAP
+		if (job->session == 0) heat_add(heat_bytes, &frame->area, frame->len, true);
+#endif
+		packed += frame->len;
+	}
+	
+	if (len != NULL) *len = packed;
+	return frame;
+}
+
+#if WS_DRIVER_DRAW_STREAM
+// Pack the commands that drew a flushed buffer into a frame for the clients whose bits
+// are set in clients, loading images_len with the bytes of image bands sent with them.
+// Returns NULL when the buffer must be sent as pixels or the commands besides the image
+// bands are no smaller than its raw pixels.  Call draw_stream_commit() once it is queued.
+static frame_t* pack_draw(const flush_job_t* job, uint32_t clients, uint32_t* images_len)
+{
+	frame_t* frame;
+	uint8_t* buf;
+	int len;
+
+	*images_len = 0;
+	if (!draw_stream_valid(job->color_map)) return NULL;
+
+	frame = frame_tx_get();
+	buf = pack_header(frame->buf, &job->area, job->input_seq, 0, false);
+	frame->buf[0] |= PIXEL_ENC_DRAW;
+	len = draw_stream_pack(job->color_map, buf, frame_buf_len - (buf - frame->buf), clients, images_len);
+	if ((len < 0) || (((uint32_t) len - *images_len) > lv_area_get_size(&job->area) * sizeof(lv_color_t))) {
+		frame_tx_release(frame);
+		return NULL;
+	}
+	frame->len = (buf - frame->buf) + len;
+	lv_area_copy(&frame->area, &job->area);
+	frame->draw = true;
+	return frame;
+}
+#endif
+
+#if WS_DRIVER_SCROLL_COPY
+// Pack a copy into a frame of its own and queue it for the connected clients that see
+// its display and can apply one, if they show all of its area at full size: what they
+// haven't been sent outside their viewport mustn't be moved into it.  The others are
+// resent the area it changes.
+static void send_copy(const flush_job_t* job)
+{
+	lv_area_t dest;
+	lv_area_t vp;
+	frame_t* frames[2];
+	uint8_t* buf;
+	uint32_t copying = 0;
+	uint32_t aligned = 0;
+	int i;
+
+#if WS_DRIVER_SNAPSHOT
+	// Nobody sees the copy, but the shadow is kept whole for /snapshot
+	if (!websocket_connected || (job->clients == 0)) {
+		if (shadow_kept(job->session)) {
+			xSemaphoreTake(shadow_mutex, portMAX_DELAY);
+			shadow_fb_copy(&job->area, job->dx, job->dy);
+			xSemaphoreGive(shadow_mutex);
+		}
+		return;
+	}
+#else
+	if (!websocket_connected) return;
+#endif
+
+	// The pixels that land inside the area, and where they come from
+	lv_area_copy(&dest, &job->area);
+	if (job->dx > 0) dest.x1 += job->dx; else dest.x2 += job->dx;
+	if (job->dy > 0) dest.y1 += job->dy; else dest.y2 += job->dy;
+
+	for (i=0; i<WEBSOCKET_SERVER_MAX_CLIENTS; i++) {
+		if ((job->clients & (1u << i)) && (viewers[i].encodings & ENC_CAP_COPY) && (viewers[i].shift == 0) &&
+			(!frame_tx_get_viewport(i, &vp) || lv_area_is_in(&job->area, &vp))) {
+			copying |= 1 << i;
+			if (viewers[i].encodings & ENC_CAP_ALIGNED) aligned |= 1 << i;
+		}
+	}
+
+	// The browsers taking aligned headers are sent a copy of their own
+	for (i=0; i<2; i++) {
+		frames[i] = NULL;
+		if ((i == 0) ? (copying & ~aligned) == 0 : aligned == 0) continue;
+		frames[i] = frame_tx_get();
+		buf = pack_header(frames[i]->buf, &dest, job->input_seq, 0, i == 1);
+		frames[i]->buf[0] |= PIXEL_ENC_COPY;
+		if (i == 1) {
+			*buf++ =  (dest.x1 - job->dx)       & 0xFF;
+			*buf++ = ((dest.x1 - job->dx) >> 8) & 0xFF;
+			*buf++ =  (dest.y1 - job->dy)       & 0xFF;
+			*buf++ = ((dest.y1 - job->dy) >> 8) & 0xFF;
+		} else {
+			*buf++ = ((dest.x1 - job->dx) >> 8) & 0xFF;
+			*buf++ =  (dest.x1 - job->dx)       & 0xFF;
+			*buf++ = ((dest.y1 - job->dy) >> 8) & 0xFF;
+			*buf++ =  (dest.y1 - job->dy)       & 0xFF;
+		}
+		frames[i]->len = buf - frames[i]->buf;
+		lv_area_copy(&frames[i]->area, &job->area);
+		frames[i]->copy = true;
+		frames[i]->dx = job->dx;
+		frames[i]->dy = job->dy;
+	}
+
+#if WS_DRIVER_SHADOW
+	// Keep the shadow matching the browsers, and a resend from it on one side of the
+	// copy or the other
+	if (shadow_fb_enabled() && (job->session == 0)) {
+		xSemaphoreTake(shadow_mutex, portMAX_DELAY);
+		shadow_fb_copy(&job->area, job->dx, job->dy);
+		if (frames[0] != NULL) frame_tx_send_to(frames[0], copying & ~aligned);
+		if (frames[1] != NULL) frame_tx_send_to(frames[1], aligned);
+		xSemaphoreGive(shadow_mutex);
+		send_copy_damage(&dest, job->clients & ~copying);
+		return;
+	}
+#endif
+	if (frames[0] != NULL) frame_tx_send_to(frames[0], copying & ~aligned);
+	if (frames[1] != NULL) frame_tx_send_to(frames[1], aligned);
+	send_copy_damage(&dest, job->clients & ~copying);
+}
+
+// Queue the area a copy changes to be resent to the connected clients whose bits are
+// set in clients
+static void send_copy_damage(const lv_area_t* area, uint32_t clients)
+{
+	int i;
+
+	for (i=0; i<WEBSOCKET_SERVER_MAX_CLIENTS; i++) {
+		if (clients & (1u << i)) {
+			frame_tx_add_damage(i, area);
+		}
+	}
+}
+#endif
+
+// resends the areas that lagging clients dropped once they have caught up, and refines
+// what lossy clients were sent approximately once their link is idle
+static void resync_task(lv_task_t* task)
+{
+	int i, j, n, s;
+	lv_area_t areas[FRAME_TX_MAX_DAMAGE];
+	
+	for (i=0; i<WEBSOCKET_SERVER_MAX_CLIENTS; i++) {
+		// A client still waiting for its display is sent all of it anyway
+		s = client_session(i);
+		n = frame_tx_take_damage(i, areas, FRAME_TX_MAX_DAMAGE);
+		if ((n > 0) && (s >= 0)) {
+#if WS_DRIVER_SHADOW
+			// Send the current contents of the areas to just this client, approximately
+			// if it is held at 8 bits
+			if (shadow_fb_enabled() && (s == 0)) {
+				send_shadow(i, areas, n, viewers[i].held);
+				continue;
+			}
+#endif
+			// Otherwise have LVGL redraw them for everyone seeing its display
+			for (j=0; j<n; j++) {
+				lv_inv_area(sessions[s].disp, &areas[j]);
+			}
+			continue;
+		}
+		
+#if WS_DRIVER_LOSSY
+		n = frame_tx_take_refine(i, areas, FRAME_TX_MAX_DAMAGE);
+		if ((n > 0) && (s >= 0)) {
+#if WS_DRIVER_SHADOW
+			if (shadow_fb_enabled() && (s == 0)) {
+				send_shadow(i, areas, n, false);
+				continue;
+			}
+#endif
+			// Redraw them now, sending this client exact pixels
+			for (j=0; j<n; j++) {
+				lv_inv_area(sessions[s].disp, &areas[j]);
+			}
+			refining |= 1 << i;
+			lv_refr_now(sessions[s].disp);
+			refining &= ~(1 << i);
+		}
+#endif
+	}
+}
+
+#if WS_DRIVER_SHADOW
+// Send the area of a join from the shadow framebuffer to each of its clients, as much
+// as fits in a frame now and the rest once the client has caught up
+static void send_join(const flush_job_t* job)
+{
+	lv_area_t area;
+	int i;
+	
+	for (i=0; i<WEBSOCKET_SERVER_MAX_CLIENTS; i++) {
+		if (job->clients & (1u << i)) {
+			lv_area_copy(&area, &job->area);
+			send_shadow(i, &area, 1, viewers[i].held);
+		}
+	}
+}
+
+// Pack as much of the areas from the shadow framebuffer as fits in one frame and queue
+// it for a client, approximately if lossy is set, leaving out what is outside its
+// viewport and scaling it down for a thumbnail.  Whatever doesn't fit is left as damage
+// for the next round.
+static void send_shadow(uint8_t num, lv_area_t* areas, int num_areas, bool lossy)
+{
+	int i;
+	lv_coord_t stride;
+	const lv_color_t* src;
+	frame_t* frame;
+	lv_area_t vp;
+	uint8_t shift = viewers[num].shift;
+#if WS_DRIVER_THUMBNAILS
+	lv_area_t screen;
+#endif
+	
+	if (frame_tx_get_viewport(num, &vp)) {
+		num_areas = clip_regions(areas, num_areas, &vp);
+		if (num_areas == 0) return;
+	}
+	src = shadow_fb_get_buf(&stride);
+	frame = frame_tx_get();
+	xSemaphoreTake(shadow_mutex, portMAX_DELAY);
+#if WS_DRIVER_THUMBNAILS
+	if (shift != 0) {
+		xSemaphoreTake(thumb_mutex, portMAX_DELAY);
+		lv_area_set(&screen, 0, 0, stride - 1, lv_disp_get_ver_res(NULL) - 1);
+		lv_area_copy(&vp, &screen);
+		thumb_area_down(&vp, shift);
+		for (i=0; i<num_areas; i++) {
+			thumb_area_down(&areas[i], shift);
+			thumb_scale(&thumb_buf[areas[i].y1 * lv_area_get_width(&vp) + areas[i].x1], lv_area_get_width(&vp), &areas[i], src, &screen, shift);
+		}
+		src = thumb_buf;
+		stride = lv_area_get_width(&vp);
+	}
+#endif
+	for (i=pack_frame(frame, areas, num_areas, src, 0, 0, stride, sessions[0].pointer.seq, lossy, viewer_encodings(1u << num), shift); i<num_areas; i++) {
+		thumb_area_up(&areas[i], shift);
+		frame_tx_add_damage(num, &areas[i]);
+	}
+#if WS_DRIVER_THUMBNAILS
+	if (shift != 0) xSemaphoreGive(thumb_mutex);
+#endif
+#if WS_DRIVER_HEATMAP
+	heat_add(heat_bytes, &frame->area, frame->len, true);
+#endif
+	frame_tx_send_client(num, frame);
+	xSemaphoreGive(shadow_mutex);
+}
+#endif
+
+// Pack as many of the regions into frame as fit, splitting a region into bands of rows
+// if necessary.  src holds pixel (x0, y0) of a buffer stride pixels wide; both it and the
+// regions are of the screen scaled down by 2^shift.  Returns the
+// number of regions completely packed and leaves the remaining rows of a split region
+// in its entry.  At least one row is always packed into an empty frame.  Bands of rows
+// of a single colour are packed as fills.  With lossy set the other rows are quantised
+// to 8-bit pixels.  Only the ENC_CAP encodings set in encodings are used, and with
+// ENC_CAP_ALIGNED each region has the aligned header and is padded to whole words.
+static int pack_frame(frame_t* frame, lv_area_t* regions, int num_regions, const lv_color_t* src, lv_coord_t x0, lv_coord_t y0, lv_coord_t stride, uint16_t input_seq, bool lossy, uint32_t encodings, uint8_t shift)
+{
+	int i;
+	int rows;
+	uint8_t* buf = frame->buf;
+	uint8_t* end = &frame->buf[frame_buf_len];
+	uint8_t* start;
+	bool aligned = (encodings & ENC_CAP_ALIGNED) != 0;
+	const lv_color_t* p;
+	lv_coord_t w;
+#if WS_DRIVER_FILL
+	lv_coord_t h, n;
+#endif
+	lv_area_t band;
+	bool fill = false;
+	
+	i = 0;
+	while (i < num_regions) {
+		w = lv_area_get_width(&regions[i]);
+		p = &src[(regions[i].y1 - y0) * stride + (regions[i].x1 - x0)];
+		rows = lv_area_get_height(&regions[i]);
+		
+#if WS_DRIVER_FILL
+		// Send the leading rows as a fill if they are all one colour, otherwise pack
+		// the rows up to the next ones that are
+		if (encodings & ENC_CAP_FILL) {
+			n = uniform_rows(p, w, rows, stride);
+			fill = (n == rows) || ((n * w) >= FILL_MIN_PIXELS);
+			if (fill) {
+				if ((end - buf) < (PIXEL_REGION_EXTRA_LEN + (int) sizeof(lv_color_t))) break;
+				rows = n;
+			} else {
+				h = rows;
+				rows = LV_MATH_MAX(n, 1);
+				while (rows < h) {
+					n = uniform_rows(&p[rows * stride], w, h - rows, stride);
+					if ((n * w) >= FILL_MIN_PIXELS) break;
+					rows += LV_MATH_MAX(n, 1);
+				}
+			}
+		}
+#endif
+		
+		if (!fill) {
+			// Raw pixels are the largest a region can pack to
+			rows = LV_MATH_MIN(rows, (end - buf - PIXEL_REGION_EXTRA_LEN) / (w * (int) sizeof(lv_color_t)));
+			if (rows <= 0) break;
+		}
+		
+		lv_area_copy(&band, &regions[i]);
+		band.y2 = band.y1 + rows - 1;
+		
+		if (buf == frame->buf) {
+			lv_area_copy(&frame->area, &band);
+		} else {
+			lv_area_join(&frame->area, &frame->area, &band);
+		}
+		start = buf;
+#if WS_DRIVER_FILL
+		if (fill) {
+			buf = pack_fill(buf, &band, p[0], input_seq, shift, aligned);
+		} else
+#endif
+#if WS_DRIVER_LOSSY
+		if (lossy) {
+			buf = pack_lossy(buf, &band, p, stride, input_seq, encodings, shift);
+		} else
+#endif
+		{
+			buf = pack_region(buf, &band, p, stride, input_seq, encodings, shift);
+		}
+		while (aligned && ((buf - start) & 3)) {
+			*buf++ = 0;
+		}
+		
+		// Move on once the region is done, otherwise keep its remaining rows
+		if (band.y2 == regions[i].y2) {
+			i++;
+		} else {
+			regions[i].y1 = band.y2 + 1;
+		}
+	}
+	
+	// What the frame changes is tracked in the pixels of the screen
+	thumb_area_up(&frame->area, shift);
+	frame->len = buf - frame->buf;
+	frame->lossy = lossy;
+	return i;
+}
+
+// Load a region's header and pixel data into buf, returning the next free position.
+// src points to the region's first pixel in a buffer stride pixels wide.  Only the
+// ENC_CAP encodings set in encodings are used.
+static uint8_t* pack_region(uint8_t* buf, const lv_area_t* region, const lv_color_t* src, lv_coord_t stride, uint16_t input_seq, uint32_t encodings, uint8_t shift)
+{
+#if !WS_DRIVER_NATIVE
+	int x;
+#endif
+	int y;
+	lv_coord_t region_w = lv_area_get_width(region);
+	lv_coord_t region_h = lv_area_get_height(region);
+#if WS_DRIVER_RLE || WS_DRIVER_NATIVE
+	uint32_t len = 0;
+#endif
+#if WS_DRIVER_RLE || WS_DRIVER_PALETTE
+	uint8_t* hdr = buf;
+	uint32_t max_len = region_w * region_h * sizeof(lv_color_t);
+#endif
+#if WS_DRIVER_PALETTE
+	lv_color_t palette[PALETTE_MAX];
+	int colours = 0;
+#endif
+	
+	buf = pack_header(buf, region, input_seq, shift, (encodings & ENC_CAP_ALIGNED) != 0);
+	
+#if WS_DRIVER_PALETTE
+	// A region of few colours packs to their indices, if nothing else is smaller
+	if (encodings & ENC_CAP_PALETTE) {
+		colours = palette_build(palette, src, region_w, region_h, stride);
+	}
+	if (colours > 0) {
+		max_len = LV_MATH_MIN(max_len, palette_len(colours, region_w * region_h));
+	}
+#endif
+	
+#if WS_DRIVER_RLE
+	// Use the encoded data only if it is smaller than the raw pixels
+	if (encodings & ENC_CAP_RLE) {
+		len = pack_rle(buf, src, region_w, region_h, stride, max_len);
+	}
+	if (len != 0) {
+		hdr[0] |= PIXEL_ENC_RLE;
+		return buf + len;
+	}
+#endif
+	
+#if WS_DRIVER_PALETTE
+	if ((colours > 0) && (max_len < (region_w * region_h * sizeof(lv_color_t)))) {
+		hdr[0] |= PIXEL_PALETTE;
+		return buf + pack_palette(buf, palette, colours, src, region_w, region_h, stride);
+	}
+#endif
+	
+#if WS_DRIVER_NATIVE
+	// Copy the pixels as they are in memory
+	if (region_w == stride) {
+		len = region_w * region_h * sizeof(lv_color_t);
+		memcpy(buf, src, len);
+		return buf + len;
+	}
+	for (y=0; y<region_h; y++) {
+		memcpy(buf, &src[y * stride], region_w * sizeof(lv_color_t));
+		buf += region_w * sizeof(lv_color_t);
+	}
+#else
+	for (y=0; y<region_h; y++) {
+		if (pixel_depth == 32) {
+			// Load the 32-bit pixel data: RGBA8888
+			lv_color32_t* p32 = (lv_color32_t*) &src[y * stride];
+			for (x=0; x<region_w; x++) {
+				*buf++ = p32[x].ch.red;
+				*buf++ = p32[x].ch.green;
+				*buf++ = p32[x].ch.blue;
+				*buf++ = p32[x].ch.alpha;
+			}
+		} else if (pixel_depth == 16) {
+			// Load the 16-bit pixel data: RGB565
+			lv_color16_t* p16 = (lv_color16_t*) &src[y * stride];
+			for (x=0; x<region_w; x++) {
+				*buf++ = p16[x].full >> 8;
+				*buf++ = p16[x].full & 0xFF;
+			}
+		} else {
+			// Load the 8-bit pixel data: RGB332
+			lv_color8_t* p8 = (lv_color8_t*) &src[y * stride];
+			for (x=0; x<region_w; x++) {
+				*buf++ = p8[x].full;
+			}
+		}
+	}
+#endif
+	
+	return buf;
+}
+
+#if WS_DRIVER_LOSSY
+// Load a region's header and its pixels quantised to RGB332 into buf, returning the next
+// free position.  src points to the region's first pixel in a buffer stride pixels wide.
+// Run lengths are used only if ENC_CAP_RLE is set in encodings.
+static uint8_t* pack_lossy(uint8_t* buf, const lv_area_t* region, const lv_color_t* src, lv_coord_t stride, uint16_t input_seq, uint32_t encodings, uint8_t shift)
+{
+	int x, y;
+	lv_coord_t region_w = lv_area_get_width(region);
+	lv_coord_t region_h = lv_area_get_height(region);
+	uint8_t* hdr = buf;
+#if WS_DRIVER_RLE
+	uint32_t len = 0;
+#endif
+	
+	// The header declares 8-bit pixels, which have no byte order
+	buf = pack_header(buf, region, input_seq, shift, (encodings & ENC_CAP_ALIGNED) != 0);
+	hdr[0] = (hdr[0] & PIXEL_INPUT_SEQ) | 8;
+	
+#if WS_DRIVER_RLE
+	if (encodings & ENC_CAP_RLE) {
+		len = pack_rle332(buf, src, region_w, region_h, stride, region_w * region_h);
+	}
+	if (len != 0) {
+		hdr[0] |= PIXEL_ENC_RLE;
+		return buf + len;
+	}
+#endif
+	
+	for (y=0; y<region_h; y++) {
+		for (x=0; x<region_w; x++) {
+			*buf++ = lv_color_to8(src[x]);
+		}
+		src += stride;
+	}
+	
+	return buf;
+}
+#endif
+
+#if WS_DRIVER_FILL
+// Load the header of a region of the single colour c into buf, returning the next free
+// position
+static uint8_t* pack_fill(uint8_t* buf, const lv_area_t* region, lv_color_t c, uint16_t input_seq, uint8_t shift, bool aligned)
+{
+	uint8_t* hdr = buf;
+	
+	buf = pack_header(buf, region, input_seq, shift, aligned);
+	hdr[0] |= PIXEL_ENC_FILL;
+	return pack_pixel(buf, c);
+}
+
+// Returns how many of the first rows of a w x h block of pixels, from a buffer stride
+// pixels wide, are entirely the colour of its first pixel
+static lv_coord_t uniform_rows(const lv_color_t* src, lv_coord_t w, lv_coord_t h, lv_coord_t stride)
+{
+	lv_color_t c = src[0];
+	lv_coord_t x, y;
+	
+	for (y=0; y<h; y++) {
+		for (x=0; x<w; x++) {
+			if (src[x].full != c.full) return y;
+		}
+		src += stride;
+	}
+	return h;
+}
+#endif
+
+// Load the header of a region into buf, returning the position of its data.  The
+// screen is declared scaled down by 2^shift, as the region is.  An aligned header is
+// PIXEL_ALIGNED_HEADER_LEN bytes: the pixel depth byte, PIXEL_ALIGNED_MARK, then the
+// screen size, the region and the input sequence number, or 0, as little-endian 16-bit
+// words, so a browser reads it and the pixels after it through typed arrays.
+static uint8_t* pack_header(uint8_t* buf, const lv_area_t* region, uint16_t input_seq, uint8_t shift, bool aligned)
+{
+	uint8_t* hdr = buf;
+	int w, h;
+	
+	w = (lv_disp_get_hor_res(NULL) + (1 << shift) - 1) >> shift;
+	h = (lv_disp_get_ver_res(NULL) + (1 << shift) - 1) >> shift;
+	
+#if WS_DRIVER_ALIGNED
+	if (aligned) {
+		*buf++ = pixel_depth | PIXEL_ORDER;
+		*buf++ = PIXEL_ALIGNED_MARK;
+		*buf++ =  w                & 0xFF;
+		*buf++ = (w >> 8)          & 0xFF;
+		*buf++ =  h                & 0xFF;
+		*buf++ = (h >> 8)          & 0xFF;
+		*buf++ =  region->x1       & 0xFF;
+		*buf++ = (region->x1 >> 8) & 0xFF;
+		*buf++ =  region->y1       & 0xFF;
+		*buf++ = (region->y1 >> 8) & 0xFF;
+		*buf++ =  region->x2       & 0xFF;
+		*buf++ = (region->x2 >> 8) & 0xFF;
+		*buf++ =  region->y2       & 0xFF;
+		*buf++ = (region->y2 >> 8) & 0xFF;
+#if WS_DRIVER_INPUT_SEQ
+		hdr[0] |= PIXEL_INPUT_SEQ;
+#else
+		input_seq = 0;
+#endif
+		*buf++ =  input_seq        & 0xFF;
+		*buf++ = (input_seq >> 8)  & 0xFF;
+		return buf;
+	}
+#else
+	(void) aligned;
+#endif
+	
+	// Add a binary message containing the coordinates and 32-bit pixel
+	// data.  This must match the javascript unpacking routine in index.html.
+	// The pixel depth byte declares the byte order of the pixels.
+	//
+	// Load the region coordinates
+	*buf++ = pixel_depth | PIXEL_ORDER;
+	*buf++ = (w >> 8) & 0xFF;
+	*buf++ =  w       & 0xFF;
+	*buf++ = (h >> 8) & 0xFF;
+	*buf++ =  h       & 0xFF;
+	*buf++ = (region->x1 >> 8) & 0xFF;
+	*buf++ =  region->x1       & 0xFF;
+	*buf++ = (region->y1 >> 8) & 0xFF;
+	*buf++ =  region->y1       & 0xFF;
+	*buf++ = (region->x2 >> 8) & 0xFF;
+	*buf++ =  region->x2       & 0xFF;
+	*buf++ = (region->y2 >> 8) & 0xFF;
+	*buf++ =  region->y2       & 0xFF;
+	
+#if WS_DRIVER_INPUT_SEQ
+	hdr[0] |= PIXEL_INPUT_SEQ;
+	*buf++ = (input_seq >> 8) & 0xFF;
+	*buf++ =  input_seq       & 0xFF;
+#else
+	(void) hdr;
+	(void) input_seq;
+#endif
+	
+	return buf;
+}
+
+// Handle a pointer event from a client, made age mS ago
+static void pointer_input(uint8_t num, uint8_t flag, uint16_t x, uint16_t y, uint16_t seq, uint8_t age)
+{
+#if WS_DRIVER_THUMBNAILS
+	// A thumbnail's pixel is pointed at the middle of the block it shows
+	uint8_t shift = viewers[num].shift;
+
+	if (shift != 0) {
+		x = (x << shift) + (1 << (shift - 1));
+		y = (y << shift) + (1 << (shift - 1));
+	}
+#endif
+#if WS_DRIVER_TRACE
+	trace_rec_input(num, flag, x, y, seq);
+#endif
+	viewers[num].input = lv_tick_get();
+#if WS_DRIVER_CAPTURE
+	capture_rec_pointer(num, flag, x, y);
+#endif
+#if WS_DRIVER_INPUT_REC
+	if (!input_rec_pointer(flag, x, y)) return;
+#endif
+	push_pointer(num, flag, x, y, seq, age);
+}
+
+#if WS_DRIVER_INPUT_V2
+// Apply a browser's batch of pointer events from m up to end, see INPUT_MAGIC, as each
+// is decoded.  Only pointer 0 drives LittlevGL's pointer and only the press of its
+// buttons counts; the other pointers are followed so the deltas stay in step.
+static void compact_input(uint8_t num, const uint8_t* m, const uint8_t* end)
+{
+	int32_t x[INPUT_POINTERS] = {0};
+	int32_t y[INPUT_POINTERS] = {0};
+	uint32_t seq;
+	uint32_t dx;
+	uint32_t dy;
+	uint32_t dt;
+	uint32_t age = 0;
+	bool first = true;
+	uint8_t tag;
+	int id;
+
+	m = read_varint(m, end, &seq);
+	while ((m != NULL) && (m < end)) {
+		tag = *m++;
+		m = read_varint(m, end, &dx);
+		if (m != NULL) m = read_varint(m, end, &dy);
+		if (m != NULL) m = read_varint(m, end, &dt);
+		if (m == NULL) return;
+
+		// Zigzag varints count 0, -1, 1, -2...
+		id = tag >> 4;
+		x[id] += (int32_t) (dx >> 1) ^ -(int32_t) (dx & 1);
+		y[id] += (int32_t) (dy >> 1) ^ -(int32_t) (dy & 1);
+		age = first ? dt : ((dt < age) ? (age - dt) : 0);
+		first = false;
+		if (id == 0) {
+			pointer_input(num, tag & INPUT_PRESSED, LV_MATH_MAX(0, LV_MATH_MIN(x[0], 0xFFFF)),
+				LV_MATH_MAX(0, LV_MATH_MIN(y[0], 0xFFFF)), (uint16_t) seq, LV_MATH_MIN(age, 255));
+		}
+	}
+}
+
+// Read a varint of up to 32 bits at m into value, returning the byte after it or NULL if
+// it doesn't end before end
+static const uint8_t* read_varint(const uint8_t* m, const uint8_t* end, uint32_t* value)
+{
+	uint32_t v = 0;
+	int shift;
+
+	for (shift = 0; (m < end) && (shift < 32); shift += 7) {
+		v |= (uint32_t) (*m & 0x7F) << shift;
+		if ((*m++ & 0x80) == 0) {
+			*value = v;
+			return m;
+		}
+	}
+	return NULL;
+}
+#endif
+
+// Add a pointer event from a client made age mS ago to the ring of its session, dropping
+// it if LVGL has fallen that far behind, the client has no display yet or another client
+// controls it
+static void push_pointer(uint8_t num, uint8_t flag, uint16_t x, uint16_t y, uint16_t seq, uint8_t age)
+{
+	int session = client_session(num);
+	session_t* s;
+	
+	if (session < 0) return;
+	s = &sessions[session];
+#if WS_DRIVER_INPUT_LEASE
+	if (!lease_take(s, num, flag)) return;
+#endif
+	if (ring_push(s, num, flag, x, y, seq, age)) {
+#if WS_DRIVER_INPUT_LEASE
+		s->last.flag = flag;
+		s->last.x = x;
+		s->last.y = y;
+		s->last.seq = seq;
+#endif
+		websocket_driver_wake();
+	}
+}
+
+// Add a pointer event to the ring of session s.  If it is full the event replaces the
+// newest one that overflowed it instead, and false is returned if that slot still holds
+// a change in state LVGL hasn't seen.
+static bool ring_push(session_t* s, uint8_t num, uint8_t flag, uint16_t x, uint16_t y, uint16_t seq, uint8_t age)
+{
+	uint32_t h = s->head;
+	uint32_t n = s->latest_seq;
+	pointer_event_t* ev;
+	
+	if ((h - s->tail) < POINTER_RING_LEN) {
+		ev = &s->ring[h & (POINTER_RING_LEN - 1)];
+	} else {
+		// Moves may replace each other, a press or release only once LVGL took it
+		if ((n != s->latest_read) && (s->latest[n & 1].flag != flag)) return false;
+		n++;
+		ev = &s->latest[n & 1];
+		s->latest_head[n & 1] = h;
+	}
+	ev->time = lv_tick_get() - age;
+	ev->flag = flag;
+	ev->x = x;
+	ev->y = y;
+	ev->seq = seq;
+	ev->num = num;
+	__sync_synchronize();
+	if (n == s->latest_seq) {
+		s->head = h + 1;
+	} else {
+		s->latest_seq = n;
+	}
+	return true;
+}
+
+// Returns true if the LVGL task has pointer events of session s to read
+static bool pointer_pending(const session_t* s)
+{
+	return (s->tail != s->head) || (s->latest_seq != s->latest_read);
+}
+
+// Takes the newest event that overflowed the ring of session s into ev, returning false
+// if there is none or the ring holds newer ones.  Called by the LVGL task.
+static bool latest_take(session_t* s, pointer_event_t* ev)
+{
+	uint32_t n;
+	uint32_t h;
+	
+	do {
+		n = s->latest_seq;
+		if (n == s->latest_read) return false;
+		__sync_synchronize();
+		*ev = s->latest[n & 1];
+		h = s->latest_head[n & 1];
+		__sync_synchronize();
+		// Filled again meanwhile, the copy may be torn
+	} while (n != s->latest_seq);
+	s->latest_read = n;
+	return (h == s->head);
+}
+
+#if WS_DRIVER_INPUT_LEASE
+// Returns whether session s takes a pointer event with flag from client num.  Its
+// controller keeps the lease while it sends input at least every WS_DRIVER_INPUT_LEASE
+// mS; after that, or once it has gone, the next press from any client takes it.  A
+// controller losing the lease while pressed is released where it last was first, so
+// LVGL doesn't see the new controller's press as a jump in its drag.
+static bool lease_take(session_t* s, uint8_t num, uint8_t flag)
+{
+	int c = s->controller;
+	bool held = (c >= 0) && (clients[c].conn == s->controller_conn) && ws_is_connected(&clients[c]);
+	
+	if (held && (c == num)) {
+		s->lease_tick = lv_tick_get();
+		return true;
+	}
+	if (held && (lv_tick_elaps(s->lease_tick) < WS_DRIVER_INPUT_LEASE)) {
+		if (!(role_told & (1u << num))) send_role(num, false);
+		return false;
+	}
+	// Moves and releases don't start control
+	if (flag == 0) return false;
+	
+	if ((c >= 0) && (s->last.flag != 0)) {
+		(void) ring_push(s, c, 0, s->last.x, s->last.y, s->last.seq, 0);
+	}
+	if (held) send_role(c, false);
+	s->controller = num;
+	s->controller_conn = clients[num].conn;
+	s->lease_tick = lv_tick_get();
+	s->last.flag = 0;
+	send_role(num, true);
+	return true;
+}
+
+// Tell client num whether its input controls its display
+static void send_role(uint8_t num, bool controller)
+{
+	char msg[24];
+	int n;
+	
+	n = snprintf(msg, sizeof(msg), "{\"role\":\"%s\"}", controller ? "controller" : "viewer");
+	if (controller) {
+		__sync_fetch_and_and(&role_told, ~(1u << num));
+	} else {
+		__sync_fetch_and_or(&role_told, 1u << num);
+	}
+	(void) frame_tx_send_text(num, msg, n);
+}
+#endif
+
+#if WS_DRIVER_INPUT_SEQ
+// Tell a client the area its press with sequence number seq started scrolling, if any,
+// so it can move the pixels there itself until frames showing its drag arrive.  Only
+// objects larger than their parent, like a page's scrollable part, are reported: the
+// area is their parent's, with the directions they can be dragged in as dir (1
+// horizontal, 2 vertical).
+static void send_drag_hint(lv_indev_t* indev, uint8_t num, uint16_t seq)
+{
+	lv_obj_t* obj = indev->proc.types.pointer.act_obj;
+	lv_obj_t* parent;
+	lv_drag_dir_t dir;
+	lv_area_t area;
+	frame_t* frame;
+	
+	while ((obj != NULL) && lv_obj_get_drag_parent(obj)) {
+		obj = lv_obj_get_parent(obj);
+	}
+	if (obj == NULL) return;
+	dir = scroll_dirs(obj);
+	if (dir == 0) return;
+	parent = lv_obj_get_parent(obj);
+	if (!lv_area_intersect(&area, &parent->coords, &lv_obj_get_screen(parent)->coords)) return;
+#if WS_DRIVER_THUMBNAILS
+	thumb_area_down(&area, viewers[num].shift);
+#endif
+	
+	frame = frame_tx_get();
+	frame->len = snprintf((char*) frame->buf, frame_buf_len,
+		"{\"drag\":{\"seq\":%u,\"x1\":%d,\"y1\":%d,\"x2\":%d,\"y2\":%d,\"dir\":%u}}",
+		seq, area.x1, area.y1, area.x2, area.y2, dir);
+	frame->text = true;
+	lv_area_copy(&frame->area, &area);
+	frame_tx_send_client(num, frame);
+}
+#endif
+
+#if WS_DRIVER_INPUT_SEQ || WS_DRIVER_SCROLL
+// Returns the directions an object can be scrolled in: those it can be dragged in where
+// it is larger than its parent, like a page's scrollable part
+static lv_drag_dir_t scroll_dirs(lv_obj_t* obj)
+{
+	lv_obj_t* parent = lv_obj_get_parent(obj);
+	lv_drag_dir_t dir;
+	
+	if ((parent == NULL) || !lv_obj_get_drag(obj)) return 0;
+	dir = lv_obj_get_drag_dir(obj);
+	if (lv_obj_get_width(obj) <= lv_obj_get_width(parent)) dir &= ~LV_DRAG_DIR_HOR;
+	if (lv_obj_get_height(obj) <= lv_obj_get_height(parent)) dir &= ~LV_DRAG_DIR_VER;
+	return dir;
+}
+#endif
+
+#if WS_DRIVER_SCROLL
+// Handle a scroll from a client: SCROLL_BY or SCROLL_FLING, then the big-endian point
+// scrolled at and the signed distance or velocity.  Distances are summed until the LVGL
+// task applies them, so a fast wheel costs LVGL one move per loop.
+static void scroll_input(uint8_t num, const uint8_t* m)
+{
+	int session = client_session(num);
+	session_t* s;
+	uint16_t x = (m[1] << 8) | m[2];
+	uint16_t y = (m[3] << 8) | m[4];
+	int32_t dx = (int16_t) ((m[5] << 8) | m[6]);
+	int32_t dy = (int16_t) ((m[7] << 8) | m[8]);
+	
+	if (session < 0) return;
+	s = &sessions[session];
+#if WS_DRIVER_THUMBNAILS
+	// A thumbnail's pixel is a block of the screen
+	uint8_t shift = viewers[num].shift;
+	
+	if (shift != 0) {
+		x = (x << shift) + (1 << (shift - 1));
+		y = (y << shift) + (1 << (shift - 1));
+		dx *= 1 << shift;
+		dy *= 1 << shift;
+	}
+#endif
+	viewers[num].input = lv_tick_get();
+#if WS_DRIVER_INPUT_LEASE
+	// A scroll takes control like a press
+	if (!lease_take(s, num, 1)) return;
+#endif
+	s->scroll_at = ((uint32_t) x << 16) | y;
+	if (m[0] == SCROLL_FLING) {
+		dx = LV_MATH_MAX(LV_MATH_MIN(dx, INT16_MAX), -INT16_MAX);
+		dy = LV_MATH_MAX(LV_MATH_MIN(dy, INT16_MAX), -INT16_MAX);
+		s->fling = ((uint32_t) (uint16_t) dx << 16) | (uint16_t) dy;
+	} else {
+		__sync_fetch_and_add(&s->scroll_dx, dx);
+		__sync_fetch_and_add(&s->scroll_dy, dy);
+	}
+	websocket_driver_wake();
+}
+
+// Move the innermost scrollable under the point session s's clients scrolled at by the
+// distance they sent since the last call, or fling it.  The scrollable's own signal keeps
+// it in its page, and a new scroll stops a fling still running.
+static void scroll_apply(session_t* s)
+{
+	int32_t dx, dy;
+	uint32_t fling;
+	lv_drag_dir_t dir = 0;
+	lv_point_t p;
+	lv_obj_t* scrl;
+	
+	if ((s->scroll_dx == 0) && (s->scroll_dy == 0) && (s->fling == 0)) return;
+	dx = __sync_lock_test_and_set(&s->scroll_dx, 0);
+	dy = __sync_lock_test_and_set(&s->scroll_dy, 0);
+	fling = __sync_lock_test_and_set(&s->fling, 0);
+	if (fling != 0) {
+		dx = (int16_t) (fling >> 16);
+		dy = (int16_t) (fling & 0xFFFF);
+	}
+	if (dx != 0) dir |= LV_DRAG_DIR_HOR;
+	if (dy != 0) dir |= LV_DRAG_DIR_VER;
+	
+	p.x = s->scroll_at >> 16;
+	p.y = s->scroll_at & 0xFFFF;
+	scrl = scroll_target(s, &p, dir);
+	if (scrl == NULL) return;
+	dir = scroll_dirs(scrl);
+	if (!(dir & LV_DRAG_DIR_HOR)) dx = 0;
+	if (!(dir & LV_DRAG_DIR_VER)) dy = 0;
+	
+	lv_anim_del(scrl, (lv_anim_exec_xcb_t) lv_obj_set_x);
+	lv_anim_del(scrl, (lv_anim_exec_xcb_t) lv_obj_set_y);
+	s->scroll_obj = scrl;
+	s->scroll_dir = dir;
+	if (fling != 0) {
+		if (s->scroll_end != NULL) lv_task_set_prio(s->scroll_end, LV_TASK_PRIO_OFF);
+		scroll_fling(scrl, dx, dy);
+		return;
+	}
+	
+	lv_obj_set_pos(scrl, lv_obj_get_x(scrl) - dx, lv_obj_get_y(scrl) - dy);
+	if (s->scroll_end == NULL) {
+		s->scroll_end = lv_task_create(scroll_end_task, SCROLL_END_MS, LV_TASK_PRIO_OFF, s);
+		if (s->scroll_end == NULL) return;
+	}
+	lv_task_set_prio(s->scroll_end, LV_TASK_PRIO_LOW);
+	lv_task_reset(s->scroll_end);
+}
+
+// Returns the innermost object of session s's display under point p that can be scrolled
+// in one of the directions dir, or NULL
+static lv_obj_t* scroll_target(session_t* s, lv_point_t* p, lv_drag_dir_t dir)
+{
+	lv_obj_t* scrl;
+	
+	if ((s->disp == NULL) || (dir == 0)) return NULL;
+	scrl = scroll_find(lv_disp_get_layer_top(s->disp), p, dir);
+	if (scrl == NULL) scrl = scroll_find(lv_disp_get_scr_act(s->disp), p, dir);
+	return scrl;
+}
+
+// Returns the innermost of obj and its visible children under point p that can be
+// scrolled in one of the directions dir, or NULL
+static lv_obj_t* scroll_find(lv_obj_t* obj, const lv_point_t* p, lv_drag_dir_t dir)
+{
+	lv_obj_t* child;
+	lv_obj_t* found;
+	
+	if (lv_obj_get_hidden(obj) || !lv_area_is_point_on(&obj->coords, p)) return NULL;
+	// Children are listed from the top most
+	LV_LL_READ(obj->child_ll, child) {
+		found = scroll_find(child, p, dir);
+		if (found != NULL) return found;
+	}
+	return (scroll_dirs(obj) & dir) ? obj : NULL;
+}
+
+// Fling scrl at vx, vy pixels per second, slowing down as LVGL slows a thrown object:
+// by LV_INDEV_DEF_DRAG_THROW percent every LV_INDEV_DEF_READ_PERIOD
+static void scroll_fling(lv_obj_t* scrl, int32_t vx, int32_t vy)
+{
+	int32_t x = vx * LV_INDEV_DEF_READ_PERIOD / 1000;
+	int32_t y = vy * LV_INDEV_DEF_READ_PERIOD / 1000;
+	int32_t dist_x = 0, dist_y = 0;
+	uint16_t time = 0;
+	
+	while ((x != 0) || (y != 0)) {
+		x = x * (100 - LV_INDEV_DEF_DRAG_THROW) / 100;
+		y = y * (100 - LV_INDEV_DEF_DRAG_THROW) / 100;
+		dist_x += x;
+		dist_y += y;
+		time += LV_INDEV_DEF_READ_PERIOD;
+	}
+	if ((dist_x == 0) && (dist_y == 0)) {
+		scroll_end(scrl);
+		return;
+	}
+	
+#if LV_USE_ANIMATION
+	lv_anim_t a;
+	lv_anim_init(&a);
+	lv_anim_set_time(&a, time, 0);
+	lv_anim_set_path_cb(&a, lv_anim_path_ease_out);
+	if (dist_x != 0) {
+		lv_anim_set_values(&a, lv_obj_get_x(scrl), lv_obj_get_x(scrl) - dist_x);
+		lv_anim_set_exec_cb(&a, scrl, (lv_anim_exec_xcb_t) lv_obj_set_x);
+		// Both parts of a fling end together so one of them ends the scroll
+		if (dist_y == 0) lv_anim_set_ready_cb(&a, scroll_fling_ready);
+		lv_anim_create(&a);
+	}
+	if (dist_y != 0) {
+		lv_anim_set_values(&a, lv_obj_get_y(scrl), lv_obj_get_y(scrl) - dist_y);
+		lv_anim_set_exec_cb(&a, scrl, (lv_anim_exec_xcb_t) lv_obj_set_y);
+		lv_anim_set_ready_cb(&a, scroll_fling_ready);
+		lv_anim_create(&a);
+	}
+#else
+	lv_obj_set_pos(scrl, lv_obj_get_x(scrl) - dist_x, lv_obj_get_y(scrl) - dist_y);
+	scroll_end(scrl);
+#endif
+}
+
+// Ends the scroll of a finished fling
+static void scroll_fling_ready(lv_anim_t* a)
+{
+	scroll_end((lv_obj_t*) a->var);
+}
+
+// Ends the scroll of a session whose deltas have stopped, if what it scrolled is still
+// where they pointed
+static void scroll_end_task(lv_task_t* task)
+{
+	session_t* s = (session_t*) task->user_data;
+	lv_point_t p;
+	
+	lv_task_set_prio(task, LV_TASK_PRIO_OFF);
+	p.x = s->scroll_at >> 16;
+	p.y = s->scroll_at & 0xFFFF;
+	if ((s->scroll_obj != NULL) && (scroll_target(s, &p, s->scroll_dir) == s->scroll_obj)) {
+		scroll_end(s->scroll_obj);
+	}
+	s->scroll_obj = NULL;
+}
+
+// Tell a scrollable its scroll is over as LVGL does when a drag ends, so for example a
+// page hides its scrollbars and a roller settles on an option
+static void scroll_end(lv_obj_t* scrl)
+{
+	if (scrl->signal_cb(scrl, LV_SIGNAL_DRAG_END, NULL) != LV_RES_OK) return;
+	lv_event_send(scrl, LV_EVENT_DRAG_END, NULL);
+}
+#endif
+
+#if WS_DRIVER_KEYS
+// Handle a batch of n keys from a client, each a big-endian code point or LV_KEY_ code.
+// Characters are passed to LVGL encoded as it encodes text, LV_KEY_ codes as they are.
+static void key_input(uint8_t num, const uint8_t* m, int n)
+{
+	int session = client_session(num);
+	session_t* s;
+	uint32_t h, c;
+	
+	if (session < 0) return;
+	s = &sessions[session];
+	viewers[num].input = lv_tick_get();
+#if WS_DRIVER_INPUT_LEASE
+	// Typing takes control like a press
+	if (!lease_take(s, num, 1)) return;
+#endif
+	h = s->key_head;
+	for (int i=0; i<n; i++, m+=KEY_LEN) {
+		// Keys LVGL has fallen that far behind on are dropped
+		if ((h - s->key_tail) >= KEY_RING_LEN) break;
+		c = ((uint32_t) m[0] << 24) | ((uint32_t) m[1] << 16) | ((uint32_t) m[2] << 8) | m[3];
+		s->keys[h & (KEY_RING_LEN - 1)] = lv_txt_unicode_to_encoded(c);
+		h++;
+	}
+	__sync_synchronize();
+	s->key_head = h;
+	websocket_driver_wake();
+}
+
+// Give the text area the session's pointer last pressed the focus of the keypad's group
+// so the keys go to it, adding it to the group if it is in none.  A text area in another
+// group takes the keypad to that group.  Keys go to whatever that group focuses if the
+// pointer last pressed something else.
+static void key_focus(session_t* s)
+{
+	lv_obj_t* obj = s->indev->proc.types.pointer.last_obj;
+	lv_group_t* group;
+	
+	while ((obj != NULL) && !is_ta(obj)) {
+		obj = lv_obj_get_parent(obj);
+	}
+	if (obj == NULL) return;
+	
+	group = lv_obj_get_group(obj);
+	if (group == NULL) {
+		group = s->keypad->group;
+		if (group == NULL) return;
+		lv_group_add_obj(group, obj);
+	} else if (group != s->keypad->group) {
+		lv_indev_set_group(s->keypad, group);
+	}
+	if (lv_group_get_focused(group) != obj) lv_group_focus_obj(obj);
+}
+
+// Returns true if obj is a text area
+static bool is_ta(lv_obj_t* obj)
+{
+	lv_obj_type_t type;
+	
+	lv_obj_get_type(obj, &type);
+	return (strcmp(type.type[0], "lv_ta") == 0);
+}
+#endif
+
+// Returns the session whose display a client sees, or -1 while the LVGL task is still
+// to give it one
+static int client_session(uint8_t num)
+{
+#if WS_DRIVER_SESSIONS
+	if (join_pending & (1u << num)) return -1;
+	if (session_own & (1u << num)) return num;
+#endif
+	(void) num;
+	return 0;
+}
+
+// Returns the bits of the clients that see the display of session s
+static uint32_t session_clients(int s)
+{
+#if WS_DRIVER_SESSIONS
+	uint32_t mask = 0;
+	
+	for (int i=0; i<WEBSOCKET_SERVER_MAX_CLIENTS; i++) {
+		if (ws_is_connected(&clients[i]) && (client_session(i) == s)) mask |= 1 << i;
+	}
+	return mask;
+#else
+	(void) s;
+	return UINT32_MAX;
+#endif
+}
+
+// Returns the session of a display, 0 for one the driver didn't create
+static int disp_session(const lv_disp_drv_t* drv)
+{
+#if WS_DRIVER_SESSIONS
+	for (int i=1; i<NUM_SESSIONS; i++) {
+		if ((sessions[i].disp != NULL) && (&sessions[i].disp->driver == drv)) return i;
+	}
+#endif
+	(void) drv;
+	return 0;
+}
+
+// Returns the session of a pointer, 0 for one the driver didn't create
+static int indev_session(const lv_indev_drv_t* drv)
+{
+#if WS_DRIVER_SESSIONS
+	for (int i=1; i<NUM_SESSIONS; i++) {
+		if ((sessions[i].indev != NULL) && (&sessions[i].indev->driver == drv)) return i;
+	}
+#endif
+	(void) drv;
+	return 0;
+}
+
+#if WS_DRIVER_KEYS
+// Returns the session of a keypad, 0 for one the driver didn't create
+static int keypad_session(const lv_indev_drv_t* drv)
+{
+#if WS_DRIVER_SESSIONS
+	for (int i=1; i<NUM_SESSIONS; i++) {
+		if ((sessions[i].keypad != NULL) && (&sessions[i].keypad->driver == drv)) return i;
+	}
+#endif
+	(void) drv;
+	return 0;
+}
+#endif
+
+// Returns true if what session s draws must reach the shadow framebuffer even when
+// nobody sees it, to keep the whole screen there for /snapshot
+static bool shadow_kept(int s)
+{
+#if WS_DRIVER_SNAPSHOT
+	return (s == 0) && shadow_fb_enabled();
+#else
+	(void) s;
+	return false;
+#endif
+}
+
+#if WS_DRIVER_WHOLE_SCREEN
+// Returns true if the display being refreshed is redrawing its whole screen, as it does
+// after lv_disp_load_scr() or a theme change.  Areas invalidated along with the screen
+// have been joined into it by then.
+static bool whole_screen_refr(lv_disp_t* disp)
+{
+	uint32_t size = (uint32_t) lv_disp_get_hor_res(disp) * lv_disp_get_ver_res(disp);
+	int i;
+
+	for (i=0; i<disp->inv_p; i++) {
+		if (!disp->inv_area_joined[i] && (lv_area_get_size(&disp->inv_areas[i]) == size)) {
+			return true;
+		}
+	}
+	return false;
+}
+#endif
+
+#if WS_DRIVER_SNAPSHOT
+// Draw the whole screen into the shadow framebuffer for /snapshot if nobody has watched
+// it since the device started, returning once the last of it is there.  A screen
+// already drawn for a joining client is left alone.
+static void snapshot_draw()
+{
+	lv_disp_t* disp = sessions[0].disp;
+
+	if (!shadow_stale || !shadow_fb_enabled()) return;
+	shadow_stale = false;
+	lv_obj_invalidate(lv_disp_get_scr_act(disp));
+	lv_refr_now(disp);
+	while (lv_disp_get_buf(disp)->flushing) {
+		websocket_driver_wait(&disp->driver);
+	}
+}
+#endif
+
+// Draw the application's screen as soon as LVGL runs, while WiFi is still starting, so
+// the first browser isn't kept waiting for it.  With the snapshot the shadow framebuffer
+// then holds the screen for that browser to be sent, otherwise drawing it only warms
+// LittlevGL's font, label and image caches.
+static void boot_draw()
+{
+	int64_t start = esp_timer_get_time();
+
+#if WS_DRIVER_SNAPSHOT
+	snapshot_draw();
+#else
+	lv_disp_t* disp = sessions[0].disp;
+
+	lv_refr_now(disp);
+	while (lv_disp_get_buf(disp)->flushing) {
+		websocket_driver_wait(&disp->driver);
+	}
+#endif
+	ESP_LOGI(TAG, "Boot: first frame drawn in %d mS, %d mS after boot",
+		(int) ((esp_timer_get_time() - start) / 1000), (int) (esp_timer_get_time() / 1000));
+}
+
+// Start each client that connected since the last call, and has said hello or been
+// given long enough to, off with the whole screen of its display.  The client's slot
+// gets a display of its own on its first connection when there are sessions, and its
+// display is redrawn for it on later ones.  The
+// clients sharing the application's display are sent it from the shadow framebuffer
+// when it holds all of it, so the others see no extra traffic, and otherwise it is
+// redrawn for everyone.
+static void join_clients()
+{
+	static bool joined = false;
+	uint32_t pending = join_pending & ~hello_wait;
+	uint32_t shared = 0;
+	int i;
+#if WS_DRIVER_SHADOW
+	flush_job_t job;
+#endif
+	
+	for (i=0; i<WEBSOCKET_SERVER_MAX_CLIENTS; i++) {
+		if (!(pending & (1u << i))) continue;
+#if WS_DRIVER_SESSIONS
+		if ((i > 0) && (sessions[i].disp == NULL) && !session_create(i)) {
+			ESP_LOGW(TAG, "No memory for the display of client %d, sharing the first", i);
+		}
+		if ((i > 0) && (sessions[i].disp != NULL)) {
+			__sync_fetch_and_or(&session_own, 1u << i);
+			lv_obj_invalidate(lv_disp_get_scr_act(sessions[i].disp));
+			continue;
+		}
+#endif
+		shared |= 1u << i;
+	}
+	__sync_fetch_and_and(&join_pending, ~pending);
+	if (shared == 0) return;
+	
+#if WS_DRIVER_SHADOW
+	if (!joined) {
+		ESP_LOGI(TAG, "Boot: first browser %d mS after boot, %s", (int) (esp_timer_get_time() / 1000),
+			(shadow_fb_enabled() && !shadow_stale) ? "sent the screen drawn at boot" : "redrawing the screen");
+		joined = true;
+	}
+	// Queued behind the flushes already rendered so the shadow has them all
+	if (shadow_fb_enabled() && !shadow_stale) {
+		memset(&job, 0, sizeof(job));
+		job.join = true;
+		job.clients = shared;
+		lv_area_set(&job.area, 0, 0, lv_disp_get_hor_res(sessions[0].disp) - 1, lv_disp_get_ver_res(sessions[0].disp) - 1);
+		xQueueSendToBack(flush_queue, &job, portMAX_DELAY);
+		return;
+	}
+	shadow_stale = false;
+	shadow_fb_invalidate();
+#else
+	if (!joined) {
+		ESP_LOGI(TAG, "Boot: first browser %d mS after boot", (int) (esp_timer_get_time() / 1000));
+		joined = true;
+	}
+#endif
+	lv_obj_invalidate(lv_disp_get_scr_act(sessions[0].disp));
+}
+
+#if WS_DRIVER_RESUME
+// Stop waiting for the hello of the clients that connected HELLO_WAIT_MS ago, returning
+// the mS until the next wait ends or UINT32_MAX if none are waiting
+static uint32_t hello_expire()
+{
+	uint32_t next = UINT32_MAX;
+	uint32_t bits;
+	uint32_t elapsed;
+	int i;
+
+	for (bits = hello_wait; bits != 0; bits &= bits - 1) {
+		i = __builtin_ctz(bits);
+		elapsed = lv_tick_elaps(viewers[i].connected);
+		if (elapsed >= HELLO_WAIT_MS) {
+			__sync_fetch_and_and(&hello_wait, ~(1u << i));
+		} else {
+			next = LV_MATH_MIN(next, HELLO_WAIT_MS - elapsed);
+		}
+	}
+	return next;
+}
+#endif
+
+#if WS_DRIVER_SESSIONS
+// Register a display and pointer for session s like those of session 0, with draw
+// buffers of their own, and have the application build the display's user interface.
+// Returns false if there wasn't the memory for the buffers or, going by what session 0
+// took, for the user interface.
+static bool session_create(int s)
+{
+	lv_disp_drv_t disp_drv = sessions[0].disp->driver;
+	lv_indev_drv_t indev_drv = sessions[0].indev->driver;
+#if WS_DRIVER_KEYS
+	lv_indev_drv_t keypad_drv;
+#endif
+	lv_color_t* buf1 = NULL;
+	lv_color_t* buf2 = NULL;
+	lv_disp_t* disp = NULL;
+	lv_indev_t* indev = NULL;
+	lv_disp_t* def = lv_disp_get_default();
+	lv_mem_monitor_t mon;
+	
+	lv_mem_monitor(&mon);
+	if (mon.free_biggest_size >= session_mem) {
+		buf1 = heap_caps_malloc(session_buf_size * sizeof(lv_color_t), session_buf_caps);
+		buf2 = heap_caps_malloc(session_buf_size * sizeof(lv_color_t), session_buf_caps);
+	}
+	if ((buf1 != NULL) && (buf2 != NULL)) {
+		lv_disp_buf_init(&sessions[s].disp_buf, buf1, buf2, session_buf_size);
+		disp_drv.buffer = &sessions[s].disp_buf;
+		disp = lv_disp_drv_register(&disp_drv);
+	}
+	if (disp != NULL) {
+		indev_drv.disp = disp;
+		indev = lv_indev_drv_register(&indev_drv);
+		if (indev == NULL) lv_disp_remove(disp);
+	}
+	if (indev == NULL) {
+		if (buf1) heap_caps_free(buf1);
+		if (buf2) heap_caps_free(buf2);
+		return false;
+	}
+	
+	sessions[s].disp = disp;
+	sessions[s].indev = indev;
+#if WS_DRIVER_KEYS
+	// A keypad like session 0's, typing into a group of the session's own
+	if (sessions[0].keypad != NULL) {
+		keypad_drv = sessions[0].keypad->driver;
+		keypad_drv.disp = disp;
+		sessions[s].keypad = lv_indev_drv_register(&keypad_drv);
+		if (sessions[s].keypad != NULL) lv_indev_set_group(sessions[s].keypad, lv_group_create());
+	}
+#endif
+	if (session_cb != NULL) {
+		lv_disp_set_default(disp);
+		session_cb(disp);
+		lv_disp_set_default(def);
+	}
+	ESP_LOGI(TAG, "Created the display of client %d", s);
+	return true;
+}
+#endif
+
+static int num_connected_clients()
+{
+	// Called from the websocket callback, with the server's mutex held
+	return ws_server_len_all_from_callback();
+}
+
+
+// Return the time in mS until the next lv_task with work to do is due, UINT32_MAX if
+// there are none
+static uint32_t run_next_wait()
+{
+	lv_task_t* task;
+	uint32_t elapsed;
+	uint32_t wait = UINT32_MAX;
+	
+	// Tasks are sorted by priority with the disabled ones last
+	LV_LL_READ(LV_GC_ROOT(_lv_task_ll), task) {
+		if (task->prio == LV_TASK_PRIO_OFF) break;
+		if (run_task_idle(task)) continue;
+		
+		elapsed = lv_tick_elaps(task->last_run);
+		if (elapsed >= task->period) return 0;
+		wait = LV_MATH_MIN(wait, task->period - elapsed);
+	}
+#if WS_DRIVER_INPUT_REC
+	wait = LV_MATH_MIN(wait, input_rec_wait());
+#endif
+#if WS_DRIVER_RATE_CAPS
+	wait = LV_MATH_MIN(wait, caps_wait());
+#endif
+	
+	return wait;
+}
+
+// Evaluate LVGL whenever it has work, never returning
+static void lvgl_task(void* pvParameters)
+{
+	uint32_t wait_ms;
+#if WS_DRIVER_RESUME
+	uint32_t hello_ms;
+#endif
+	TickType_t wait;
+	int64_t pass_start;
+	uint32_t pass_us;
+#if WS_DRIVER_FRAME_BUDGET
+	uint32_t run_us = 0;    // Time run since the loop last blocked
+#endif
+	lv_indev_t* indev = NULL;
+	
+	while ((indev = lv_indev_get_next(indev)) != NULL) {
+		if (indev->driver.read_cb == websocket_driver_read) {
+			sessions[0].indev = indev;
+		}
+#if WS_DRIVER_KEYS
+		if (indev->driver.read_cb == websocket_driver_read_keys) {
+			sessions[0].keypad = indev;
+			// Text areas the pointer selects join a group of the keypad's own
+			if (indev->group == NULL) lv_indev_set_group(indev, lv_group_create());
+		}
+#endif
+	}
+	sessions[0].disp = lv_disp_get_default();
+#if WS_DRIVER_SESSIONS
+	lv_mem_monitor_t mon;
+	lv_mem_monitor(&mon);
+	session_mem = mon.total_size - mon.free_size;
+#endif
+	run_task = xTaskGetCurrentTaskHandle();
+#if LV_USE_OBJ_INV_DEFER
+	// Widgets updated several times between refreshes get their areas computed once
+	lv_obj_set_inv_defer(true);
+#endif
+	boot_draw();
+	
+	for (;;) {
+		pass_start = esp_timer_get_time();
+#if WS_DRIVER_METRICS
+		if (mem_mon_request) {
+			lv_mem_monitor(&mem_mon);
+#if LV_USE_REFR_PROF
+			num_prof_types = lv_refr_prof_get_types(prof_types, LV_REFR_PROF_TYPES + 1);
+			num_prof_objs = lv_refr_prof_get_objs(prof_objs, METRICS_PROF_OBJS);
+#endif
+#if LV_USE_TASK_PROF
+			num_task_profs = lv_task_prof_get(task_profs, METRICS_TASK_PROFS);
+			lv_task_prof_get_handler(&task_prof_elapsed, &task_prof_busy);
+#endif
+			mem_mon_request = false;
+			xSemaphoreGive(mem_mon_done);
+		}
+#endif
+#if WS_DRIVER_SNAPSHOT
+		if (snapshot_request) {
+			snapshot_draw();
+			snapshot_request = false;
+			xSemaphoreGive(snapshot_done);
+		}
+#endif
+#if LV_USE_CMD_QUEUE
+		// Keep the screen current for the next browser, lv_task_handler() applies them too
+		lv_cmd_run();
+#endif
+		wait_ms = UINT32_MAX;
+		// Only the panel needs the screen kept current while no browser is connected
+		if (websocket_connected || WS_DRIVER_LCD) {
+#if WS_DRIVER_RESUME
+			hello_ms = hello_expire();
+#endif
+			if ((join_pending & ~hello_wait) != 0) {
+				join_clients();
+			}
+			pace_indev_reads();
+#if WS_DRIVER_SCROLL
+			for (int i=0; i<NUM_SESSIONS; i++) {
+				scroll_apply(&sessions[i]);
+			}
+#endif
+#if WS_DRIVER_WIFI_LINK
+			wifi_link_sample();
+#endif
+#if WS_DRIVER_ADAPT_REFR
+			adapt_refr_period();
+#else
+			set_refr_period();
+#endif
+#if WS_DRIVER_CONSUMER_REFR
+			pause_refresh();
+#endif
+#if WS_DRIVER_FAIR_REFR
+			share_refresh();
+#endif
+#if WS_DRIVER_RATE_CAPS
+			caps_release();
+#endif
+			lv_task_handler();
+#if WS_DRIVER_SESSIONS
+			// Other tasks creating objects get the application's display
+			lv_disp_set_default(sessions[0].disp);
+#endif
+			wait_ms = run_next_wait();
+#if WS_DRIVER_RESUME
+			wait_ms = LV_MATH_MIN(wait_ms, hello_ms);
+#endif
+		}
+#if WS_DRIVER_WIFI_POWER
+		wait_ms = LV_MATH_MIN(wait_ms, wifi_power_update());
+#endif
+		
+		if (wait_ms == UINT32_MAX) {
+			wait = portMAX_DELAY;
+		} else {
+			wait = (wait_ms + portTICK_PERIOD_MS - 1) / portTICK_PERIOD_MS;
+		}
+		
+		pass_us = (uint32_t) (esp_timer_get_time() - pass_start);
+		run_stats.passes++;
+		run_stats.busy_us += pass_us;
+		if (pass_us > run_stats.max_pass_us) run_stats.max_pass_us = pass_us;
+#if WS_DRIVER_FRAME_BUDGET
+		if ((config.frame_budget != 0) && (pass_us > config.frame_budget * 1000)) run_stats.over_budget++;
+		// Work still due after a budget's worth gives the lower priority tasks a tick
+		run_us = (wait == 0) ? run_us + pass_us : 0;
+		if ((config.frame_budget != 0) && (run_us >= config.frame_budget * 1000)) {
+			wait = 1;
+			run_us = 0;
+			run_stats.yields++;
+		}
+#endif
+		(void) ulTaskNotifyTake(pdTRUE, wait);
+	}
+}
+
+#if WS_DRIVER_ADAPT_REFR
+// Scale the display refresh period by how busy the slowest client was sending what
+// LVGL produced over the last interval, relative to ADAPT_LOAD_PCT.  While a client
+// can't keep up LVGL refreshes less often, merging more changes into each frame,
+// until the client keeps up or WS_DRIVER_REFR_MAX is reached.  Every session's display
+// follows the period of session 0's.
+static void adapt_refr_period()
+{
+	static uint32_t last_time = 0;
+	static uint32_t last_bytes = 0;
+	lv_task_t* refr = lv_disp_get_refr_task(sessions[0].disp);
+	uint32_t elapsed = lv_tick_elaps(last_time);
+	uint32_t bytes;
+	uint64_t busy_us;
+	uint32_t period;
+	int i;
+	
+	if ((refr == NULL) || (elapsed < ADAPT_INTERVAL_MS)) return;
+	
+	bytes = frame_tx_queued_bytes();
+	busy_us = (uint64_t) (bytes - last_bytes) * frame_tx_slowest_cost() / 1024;
+	last_bytes = bytes;
+	last_time = lv_tick_get();
+	
+	// Move half way to the period that would have kept the client at the target load
+	period = (uint32_t) (busy_us * 100 / ADAPT_LOAD_PCT * refr->period / ((uint64_t) elapsed * 1000));
+	period = (refr->period + period) / 2;
+	period = LV_MATH_MAX(period, config.refr_period);
+	period = LV_MATH_MIN(period, LV_MATH_MAX(WS_DRIVER_REFR_MAX, config.refr_period));
+	
+	if (period != refr->period) {
+		ESP_LOGD(TAG, "Refresh period %u mS", period);
+		for (i=0; i<NUM_SESSIONS; i++) {
+			if (sessions[i].disp != NULL) {
+				lv_task_set_period(lv_disp_get_refr_task(sessions[i].disp), period);
+			}
+		}
+	}
+}
+#else
+// Refresh every session's display at the period in use, which /config may have changed
+static void set_refr_period()
+{
+	lv_task_t* refr;
+	int i;
+	
+	for (i=0; i<NUM_SESSIONS; i++) {
+		if (sessions[i].disp == NULL) continue;
+		refr = lv_disp_get_refr_task(sessions[i].disp);
+		if ((refr != NULL) && (refr->period != config.refr_period)) {
+			lv_task_set_period(refr, config.refr_period);
+		}
+	}
+}
+#endif
+
+
+#if WS_DRIVER_PAUSE_HIDDEN
+// Called from the websocket callback when a browser's page is hidden or shown
+static void set_hidden(uint8_t num, bool hidden)
+{
+	ESP_LOGI(TAG, "client %d %s", num, hidden ? "hidden" : "shown");
+	frame_tx_set_hidden(num, hidden);
+	websocket_driver_wake();
+}
+
+// Returns the clients a flush or copy of area is packed for, leaving out the hidden
+// ones, which are left to be resent area once they are shown
+static uint32_t skip_hidden(uint32_t clients, const lv_area_t* area)
+{
+	uint32_t connected = frame_tx_connected();
+	uint32_t hidden = clients & connected & frame_tx_hidden();
+	uint32_t bits;
+	
+	if (hidden == 0) return clients;
+	for (bits = hidden; bits != 0; bits &= bits - 1) {
+		frame_tx_add_damage(__builtin_ctz(bits), area);
+	}
+	return clients & connected & ~hidden;
+}
+#endif
+
+
+#if WS_DRIVER_RATE_CAPS
+// Returns the number of the cap of obj on disp, or of a free one if disp is NULL, or -1
+static int cap_slot(lv_disp_t* disp, lv_obj_t* obj)
+{
+	int i;
+	
+	for (i=0; i<WS_DRIVER_RATE_CAPS; i++) {
+		if ((rate_caps[i].disp == disp) && ((disp == NULL) || (rate_caps[i].obj == obj))) return i;
+	}
+	return -1;
+}
+
+
+// Load area with the part of the screen a cap covers, an object's including what it
+// draws outside its coordinates
+static void cap_area(const rate_cap_t* c, lv_area_t* area)
+{
+	lv_coord_t pad;
+	
+	if (c->obj == NULL) {
+		*area = c->area;
+		return;
+	}
+	lv_obj_get_coords(c->obj, area);
+	pad = lv_obj_get_ext_draw_pad(c->obj);
+	area->x1 -= pad;
+	area->y1 -= pad;
+	area->x2 += pad;
+	area->y2 += pad;
+}
+
+
+// Signal function of capped objects, ending their cap when they are deleted
+static lv_res_t cap_signal(lv_obj_t* obj, lv_signal_t sign, void* param)
+{
+	int i = cap_slot(lv_obj_get_disp(obj), obj);
+	lv_signal_cb_t signal_cb;
+	
+	if (i < 0) return LV_RES_OK;
+	signal_cb = rate_caps[i].signal_cb;
+	if (sign == LV_SIGNAL_CLEANUP) {
+		lv_obj_set_signal_cb(obj, signal_cb);
+		rate_caps[i].disp = NULL;
+	}
+	return signal_cb(obj, sign, param);
+}
+
+
+// Invalidate the areas held by each cap whose period has passed, before the refresh
+static void caps_release()
+{
+	rate_cap_t* c;
+	int i;
+	
+	caps_releasing = true;
+	for (i=0; i<WS_DRIVER_RATE_CAPS; i++) {
+		c = &rate_caps[i];
+		if ((c->disp == NULL) || !c->holding || (lv_tick_elaps(c->last) < c->period)) continue;
+		c->holding = false;
+		c->last = lv_tick_get();
+		lv_inv_area(c->disp, &c->held);
+	}
+	caps_releasing = false;
+}
+
+
+// Returns the mS until the first cap holding areas releases them, or UINT32_MAX
+static uint32_t caps_wait()
+{
+	uint32_t wait = UINT32_MAX;
+	uint32_t elapsed;
+	int i;
+	
+	for (i=0; i<WS_DRIVER_RATE_CAPS; i++) {
+		if ((rate_caps[i].disp == NULL) || !rate_caps[i].holding) continue;
+		elapsed = lv_tick_elaps(rate_caps[i].last);
+		if (elapsed >= rate_caps[i].period) return 0;
+		wait = LV_MATH_MIN(wait, rate_caps[i].period - elapsed);
+	}
+	return wait;
+}
+#endif
+
+#if WS_DRIVER_CONSUMER_REFR
+// Stop refreshing the displays none of whose browsers would be written a frame now,
+// because they are hidden or have every message their credits allow unacknowledged, so
+// nothing is drawn only to be dropped.  What is invalidated meanwhile waits in LVGL
+// until a browser can take it.  The display the shadow framebuffer keeps for /snapshot
+// is always drawn.
+static void pause_refresh()
+{
+	uint32_t consumers = frame_tx_consumers();
+	uint32_t paused = 0;
+	lv_task_t* refr;
+	bool pause;
+	int i;
+	
+	for (i=0; i<NUM_SESSIONS; i++) {
+		if (sessions[i].disp == NULL) continue;
+		refr = lv_disp_get_refr_task(sessions[i].disp);
+		pause = ((session_clients(i) & consumers) == 0) && !shadow_kept(i) && !((i == 0) && WS_DRIVER_LCD);
+		if (pause != (refr->prio == LV_TASK_PRIO_OFF)) {
+			ESP_LOGD(TAG, "Display %d %s", i, pause ? "paused" : "resumed");
+			lv_task_set_prio(refr, pause ? LV_TASK_PRIO_OFF : LV_TASK_PRIO_MID);
+			if (!pause) lv_task_ready(refr);
+		}
+		if (pause) paused |= 1 << i;
+	}
+	refr_paused = paused;
+}
+#endif
+
+
+#if WS_DRIVER_FAIR_REFR
+// Split the refresh slice between the session displays with areas to draw, in proportion
+// to their weight times the browsers showing them times the pixels they have to redraw,
+// so a display with a lot to draw no longer holds up the others' refreshes for a whole
+// slice in each pass of the LVGL loop.  Each gets at least half an even split, and a
+// refresh that ends at its share carries on in the next pass.
+static void share_refresh()
+{
+	uint64_t want[NUM_SESSIONS];
+	uint64_t total = 0;
+	uint32_t floor_ms;
+	uint32_t clients;
+	uint32_t px;
+	lv_disp_t* disp;
+	lv_task_t* refr;
+	int active = 0;
+	int i, j;
+	
+	for (i=0; i<NUM_SESSIONS; i++) {
+		want[i] = 0;
+		disp = sessions[i].disp;
+		if (disp == NULL) continue;
+		refr = lv_disp_get_refr_task(disp);
+		if ((refr == NULL) || (refr->prio == LV_TASK_PRIO_OFF) || (disp->inv_p == 0)) continue;
+		
+		px = 0;
+		for (j=0; j<disp->inv_p; j++) px += lv_area_get_size(&disp->inv_areas[j]);
+		// The panel and the snapshot take session 0's frames without a browser
+		clients = __builtin_popcount(session_clients(i));
+		want[i] = (uint64_t) sessions[i].refr_weight * LV_MATH_MAX(clients, 1) * px;
+		total += want[i];
+		active++;
+	}
+	
+	// Alone, a display has the whole slice
+	floor_ms = LV_MATH_MAX(config.refr_slice / (2 * LV_MATH_MAX(active, 1)), 1);
+	for (i=0; i<NUM_SESSIONS; i++) {
+		if ((active < 2) || (config.refr_slice == 0)) {
+			sessions[i].refr_share = 0;
+		} else {
+			// Displays invalidated later in the pass get the least
+			sessions[i].refr_share = LV_MATH_MAX((uint32_t) (want[i] * config.refr_slice / total), floor_ms);
+		}
+	}
+}
+#endif
+
+
+#if WS_DRIVER_WIFI_POWER
+// Stream while a connected browser that shows some of the screen has had input in the
+// last WS_DRIVER_WIFI_IDLE_S seconds, and save power otherwise.  Returns the mS until
+// the last of them goes idle, UINT32_MAX if only a browser can change the profile, or
+// WIFI_POWER_RETRY_MS while WiFi hasn't started to take it.
+static uint32_t wifi_power_update()
+{
+	uint32_t idle_ms = WS_DRIVER_WIFI_IDLE_S * 1000;
+	uint32_t active_ms = 0;
+	uint32_t bits, elapsed;
+	lv_area_t vp;
+	int i;
+	
+	for (bits = frame_tx_connected(); bits != 0; bits &= bits - 1) {
+		i = __builtin_ctz(bits);
+		if (frame_tx_hidden() & (1 << i)) continue;
+		if (frame_tx_get_viewport(i, &vp) && ((vp.x2 < vp.x1) || (vp.y2 < vp.y1))) continue;
+		elapsed = lv_tick_elaps(viewers[i].input);
+		if (elapsed < idle_ms) {
+			active_ms = LV_MATH_MAX(active_ms, idle_ms - elapsed);
+		}
+	}
+	
+	// Without power saving WiFi streams while any browser is connected
+	if (!config.wifi_save && (frame_tx_connected() != 0)) active_ms = idle_ms;
+	if (!wifi_power_set(active_ms != 0)) return WIFI_POWER_RETRY_MS;
+	return (active_ms != 0) ? active_ms : UINT32_MAX;
+}
+#endif
+
+
+#if WS_DRIVER_ANIM_PACE
+// Animation pacing callback: hold animations while the last flush is still being
+// packed or sent so each animation step costs at most one delivered frame
+static bool anim_pace()
+{
+	return (uxQueueMessagesWaiting(flush_queue) > 0) || frame_tx_in_flight();
+}
+#endif
+
+
+#if WS_DRIVER_ANIM_OFFLOAD
+// Animation offload callback.  A one shot animation of an object's x or y, or a fade out
+// of one with opacity scaling enabled, is described to the browsers when every browser
+// seeing its display runs animations at full size and sees all of the object with
+// nothing drawn over it.  Its start state is sent first, the browsers snapshot it and
+// move or fade the snapshot themselves while the object is hidden here, so the steps
+// aren't rendered.  Once its last animation ends or is deleted the object is shown and
+// its final state sent before the browsers drop the snapshot.
+static bool anim_offload(const lv_anim_t* a, bool start)
+{
+	lv_obj_t* obj = (lv_obj_t*) a->var;
+	lv_disp_t* disp = lv_obj_get_disp(obj);
+	anim_offload_t* o = NULL;
+	anim_offload_t* free_slot = NULL;
+	lv_obj_t* scr;
+	lv_obj_t* par;
+	lv_area_t area;
+	lv_area_t clip;
+	anim_msg_t msg;
+	uint32_t mask;
+	uint32_t seen = 0;
+	int i, path, s;
+	
+	for (i=0; i<ANIM_OFFLOADS; i++) {
+		if (anim_offloads[i].obj == obj) {
+			o = &anim_offloads[i];
+		} else if ((anim_offloads[i].obj == NULL) && (free_slot == NULL)) {
+			free_slot = &anim_offloads[i];
+		}
+	}
+	
+	memset(&msg, 0, sizeof(msg));
+	if (!start) {
+		if (o == NULL) return false;
+		if (--o->refs > 0) {
+			// Its other animations run on, the browsers hold this one where it stopped
+			msg.prop = anim_prop(a);
+			msg.from = (msg.prop == 'x') ? lv_obj_get_x(obj) : (msg.prop == 'y') ? lv_obj_get_y(obj) : lv_obj_get_opa_scale(obj);
+			msg.to = msg.from;
+			anim_queue(obj, o, &msg);
+			return false;
+		}
+		lv_obj_set_hidden(obj, o->hidden);
+		lv_refr_now(disp);
+		anim_queue(obj, o, &msg);
+		o->obj = NULL;
+		return false;
+	}
+	
+	msg.prop = anim_prop(a);
+	if (msg.prop == 0) return false;
+	if ((msg.prop == 'o') && (!lv_obj_get_opa_scale_enable(obj) || (a->start != LV_OPA_COVER))) return false;
+	for (path=0; path<sizeof(anim_path_cbs)/sizeof(anim_path_cbs[0]); path++) {
+		if (a->path_cb == anim_path_cbs[path]) break;
+	}
+	if (path == sizeof(anim_path_cbs)/sizeof(anim_path_cbs[0])) return false;
+	if ((o == NULL) && (free_slot == NULL)) return false;
+	
+	// Every browser seeing the display must run it, and none may be joining
+	if ((join_pending | hello_wait) != 0) return false;
+	s = disp_session(&disp->driver);
+	mask = session_clients(s);
+	for (i=0; i<WEBSOCKET_SERVER_MAX_CLIENTS; i++) {
+		if (!(mask & (1 << i)) || !ws_is_connected(&clients[i])) continue;
+		if (!viewers[i].anims || (viewers[i].shift != 0)) return false;
+		seen |= 1 << i;
+	}
+	if (seen == 0) return false;
+	
+	if (o == NULL) {
+		// The browsers must see all of the object, and nothing over the part of the
+		// screen its parents show it in
+		scr = lv_obj_get_screen(obj);
+		if ((scr != lv_disp_get_scr_act(disp)) && (scr != lv_disp_get_layer_top(disp))) return false;
+		if (lv_obj_get_style(obj)->body.opa != LV_OPA_COVER) return false;
+		lv_obj_get_coords(obj, &area);
+		area.x1 -= obj->ext_draw_pad;
+		area.y1 -= obj->ext_draw_pad;
+		area.x2 += obj->ext_draw_pad;
+		area.y2 += obj->ext_draw_pad;
+		lv_area_set(&clip, 0, 0, lv_disp_get_hor_res(disp) - 1, lv_disp_get_ver_res(disp) - 1);
+		for (par = obj; par != NULL; par = lv_obj_get_parent(par)) {
+			if (lv_obj_get_hidden(par)) return false;
+			if ((par != obj) && !lv_area_intersect(&clip, &clip, &par->coords)) return false;
+		}
+		if (!lv_area_is_in(&area, &clip) || anim_covered(disp, obj, &clip)) return false;
+		
+		o = free_slot;
+		o->obj = obj;
+		if (++anim_offload_id == 0) anim_offload_id = 1;
+		o->id = anim_offload_id;
+		o->refs = 0;
+		o->hidden = lv_obj_get_hidden(obj);
+		o->x = lv_obj_get_x(obj);
+		o->y = lv_obj_get_y(obj);
+		lv_area_copy(&o->area, &area);
+		lv_area_copy(&o->clip, &clip);
+		msg.snap = true;
+		
+		// The browsers snapshot the start state
+		if (disp->inv_p > 0) lv_refr_now(disp);
+	}
+	
+	msg.path = path;
+	msg.from = a->start;
+	msg.to = a->end;
+	msg.base = (msg.prop == 'x') ? o->x : (msg.prop == 'y') ? o->y : LV_OPA_COVER;
+	msg.at = a->act_time;
+	msg.ms = a->time;
+	anim_queue(obj, o, &msg);
+	o->refs++;
+	if (msg.snap) lv_obj_set_hidden(obj, true);
+	return true;
+}
 
-// Pre-allocated websocket buffer containing combined websocket header and pixel data
-static uint8_t msg_buf[DISP_BUF_SIZE * sizeof(lv_color_t) + STATIC_BUF_EXTRA_LEN];
+// Returns the property an animation changes that the browsers can run, or 0
+static char anim_prop(const lv_anim_t* a)
+{
+	if (a->exec_cb == (lv_anim_exec_xcb_t) lv_obj_set_x) return 'x';
+	if (a->exec_cb == (lv_anim_exec_xcb_t) lv_obj_set_y) return 'y';
+	if (a->exec_cb == (lv_anim_exec_xcb_t) lv_obj_set_opa_scale) return 'o';
+	return 0;
+}
 
-// Pixel depth in bits
-static int pixel_depth;
+// Returns true if a visible object drawn after obj, a sibling of it or of a parent or
+// one on a layer above its screen, overlaps clip
+static bool anim_covered(lv_disp_t* disp, lv_obj_t* obj, const lv_area_t* clip)
+{
+	lv_obj_t* layers[2] = { disp->top_layer, disp->sys_layer };
+	lv_obj_t* par;
+	lv_obj_t* sib;
+	lv_area_t common;
+	int i;
+	
+	// Children are drawn from the tail of the list to the head
+	for (; (par = lv_obj_get_parent(obj)) != NULL; obj = par) {
+		for (sib = lv_ll_get_prev(&par->child_ll, obj); sib != NULL; sib = lv_ll_get_prev(&par->child_ll, sib)) {
+			if (!lv_obj_get_hidden(sib) && lv_area_intersect(&common, &sib->coords, clip)) return true;
+		}
+	}
+	for (i=(obj == layers[0]) ? 1 : 0; i<2; i++) {
+		for (sib = lv_obj_get_child(layers[i], NULL); sib != NULL; sib = lv_obj_get_child(layers[i], sib)) {
+			if (!lv_obj_get_hidden(sib) && lv_area_intersect(&common, &sib->coords, clip)) return true;
+		}
+	}
+	return false;
+}
 
-// Current pointer value
-static pointer_t pointer;
+// Queue a message about an object's snapshot behind the flushes already rendered
+static void anim_queue(lv_obj_t* obj, const anim_offload_t* o, anim_msg_t* msg)
+{
+	lv_disp_t* disp = lv_obj_get_disp(obj);
+	flush_job_t job;
+	
+	memset(&job, 0, sizeof(job));
+	job.drv = &disp->driver;
+	job.session = disp_session(&disp->driver);
+	job.clients = session_clients(job.session);
+	job.anim = true;
+	lv_area_copy(&job.area, &o->area);
+	lv_area_copy(&job.regions[0], &o->clip);
+	msg->id = o->id;
+	job.anim_msg = *msg;
+	xQueueSendToBack(flush_queue, &job, portMAX_DELAY);
+}
 
+// Describe an animation of a snapshot to the connected clients that see its display.
+// A message they drop is lost, so the browsers also drop snapshots a while after their
+// animations end.
+static void send_anim(const flush_job_t* job)
+{
+	const anim_msg_t* m = &job->anim_msg;
+	const lv_area_t* c = &job->regions[0];
+	frame_t* frame;
+	
+	if (!websocket_connected) return;
+	frame = frame_tx_get();
+	if (m->prop == 0) {
+		frame->len = snprintf((char*) frame->buf, frame_buf_len, "{\"anim_end\":{\"id\":%u}}", m->id);
+	} else {
+		frame->len = snprintf((char*) frame->buf, frame_buf_len,
+			"{\"anim\":{\"id\":%u,\"snap\":%u,\"x1\":%d,\"y1\":%d,\"x2\":%d,\"y2\":%d,"
+			"\"cx1\":%d,\"cy1\":%d,\"cx2\":%d,\"cy2\":%d,\"prop\":\"%s\",\"from\":%d,\"to\":%d,"
+			"\"base\":%d,\"at\":%u,\"ms\":%u,\"path\":\"%s\"}}",
+			m->id, m->snap, job->area.x1, job->area.y1, job->area.x2, job->area.y2,
+			c->x1, c->y1, c->x2, c->y2, (m->prop == 'x') ? "x" : (m->prop == 'y') ? "y" : "opa",
+			m->from, m->to, m->base, m->at, m->ms, anim_paths[m->path]);
+	}
+	frame->text = true;
+	lv_area_copy(&frame->area, &job->area);
+	frame_tx_send_to(frame, job->clients);
+}
+#endif
 
-/**********************
- *  STATIC PROTOTYPES
- **********************/
-static void websocket_callback(uint8_t num, WEBSOCKET_TYPE_t type, char* msg, uint64_t len);
-static void http_serve(struct netconn *conn);
-static void server_task(void* pvParameters);
-static void server_handle_task(void* pvParameters);
-static int set_msg_buf(uint32_t msg_len);
-static int ws_send_nocopy_bin_all(uint32_t len);
-static int num_connected_clients();
 
- 
-/**********************
- *   GLOBAL FUNCTIONS
- **********************/
-void websocket_driver_init()
+// Reads each session's pointer at once when it has new events and at LVGL's read period
+// while it is pressed or dragging.  An idle pointer has nothing to read, so it is polled
+// every WS_DRIVER_INDEV_IDLE mS instead, or not at all if that is 0.  Keypads are paced
+// the same way.
+static void pace_indev_reads()
 {
-	ESP_LOGI(TAG, "Initialization.");
-	
-	ws_server_start();
-	xTaskCreate(&server_task, "server_task", 3000, NULL, 9, NULL);
-	xTaskCreate(&server_handle_task, "server_handle_task", 4000, NULL, 6, NULL);
+	bool pending;
+	int i;
 	
-#if LV_COLOR_DEPTH == 32
-	pixel_depth = 32;
-#elif LV_COLOR_DEPTH == 16
-	pixel_depth = 16;
+	for (i=0; i<NUM_SESSIONS; i++) {
+		if (sessions[i].indev == NULL) continue;
+		pending = pointer_pending(&sessions[i]);
+#if WS_DRIVER_INPUT_REC
+		// Replayed events are read as they fall due
+		if ((i == 0) && (input_rec_wait() == 0)) pending = true;
+#endif
+		pace_read(sessions[i].indev->driver.read_task, pending);
+#if WS_DRIVER_KEYS
+		if (sessions[i].keypad != NULL) {
+			pace_read(sessions[i].keypad->driver.read_task,
+				(sessions[i].key_tail != sessions[i].key_head));
+		}
+#endif
+	}
+}
+
+// Paces an input device's read task, pending if it has new events to read
+static void pace_read(lv_task_t* task, bool pending)
+{
+	if (!pending && run_task_idle(task)) {
+#if WS_DRIVER_INDEV_IDLE == 0
+		if (task->prio != LV_TASK_PRIO_OFF) lv_task_set_prio(task, LV_TASK_PRIO_OFF);
 #else
-	pixel_depth = 8;
+		if (task->period != WS_DRIVER_INDEV_IDLE) lv_task_set_period(task, WS_DRIVER_INDEV_IDLE);
 #endif
+		return;
+	}
 	
-	pointer.mutex = xSemaphoreCreateMutex();
-	pointer.flag = 0;
-	pointer.x = 0;
-	pointer.y = 0;
+	if (task->prio == LV_TASK_PRIO_OFF) lv_task_set_prio(task, LV_TASK_PRIO_MID);
+	if (task->period != LV_INDEV_DEF_READ_PERIOD) lv_task_set_period(task, LV_INDEV_DEF_READ_PERIOD);
+	// Read new events now rather than at the next read period
+	if (pending) lv_task_ready(task);
 }
 
-
-bool websocket_driver_available()
+#if WS_DRIVER_PREEMPT
+// Returns true if a session has pointer events, keys or scrolls LVGL hasn't read yet
+static bool input_waiting(const session_t* s)
 {
-	return websocket_connected;
+	if (pointer_pending(s)) return true;
+#if WS_DRIVER_KEYS
+	if (s->key_tail != s->key_head) return true;
+#endif
+#if WS_DRIVER_SCROLL
+	if ((s->scroll_dx != 0) || (s->scroll_dy != 0) || (s->fling != 0)) return true;
+#endif
+	return false;
 }
+#endif
 
-
-void websocket_driver_flush(lv_disp_drv_t * drv, const lv_area_t * area, lv_color_t * color_map)
+// Returns true for the periodic LVGL and driver tasks when they have nothing to do
+static bool run_task_idle(lv_task_t* task)
 {
+	lv_disp_t* disp = NULL;
+	session_t* s;
 	int i;
-	int hdr_len;
-	int w, h;
-	uint8_t* buf;
-	uint32_t size;
 	
-	if (websocket_connected) {
-		size = lv_area_get_width(area) * lv_area_get_height(area);
-		w = lv_disp_get_hor_res(NULL);
-		h = lv_disp_get_ver_res(NULL);
-
-		// Setup the direct websocket message header.  buf is set to the first location
-		// of the websocket payload.  The websocket message header is filled in.
-		hdr_len = set_msg_buf(size * sizeof(lv_color_t) + PIXEL_BUF_HEADER_LEN);
-		buf = &msg_buf[hdr_len];
-
-		// Add a binary message containing the coordinates and 32-bit pixel
-		// data.  This must match the javascript unpacking routine in index.html.
-		// This way we don't have to worry about endianness.
-		//
-		// Load the region coordinates
-		*buf++ = pixel_depth;
-		*buf++ = (w >> 8) & 0xFF;
-		*buf++ =  w       & 0xFF;
-		*buf++ = (h >> 8) & 0xFF;
-		*buf++ =  h       & 0xFF;
-		*buf++ = (area->x1 >> 8) & 0xFF;
-		*buf++ =  area->x1       & 0xFF;
-		*buf++ = (area->y1 >> 8) & 0xFF;
-		*buf++ =  area->y1       & 0xFF;
-		*buf++ = (area->x2 >> 8) & 0xFF;
-		*buf++ =  area->x2       & 0xFF;
-		*buf++ = (area->y2 >> 8) & 0xFF;
-		*buf++ =  area->y2       & 0xFF;
+	if (task == anim_task) {
+		return (lv_anim_count_running() == 0);
+	}
+	if (task == resync) {
+		return !frame_tx_damage_pending();
+	}
+	for (i=0; i<NUM_SESSIONS; i++) {
+		s = &sessions[i];
+		if ((s->indev != NULL) && (task == s->indev->driver.read_task)) {
+			// Presses need polling for long press and drags for their throw
+			return ((s->pointer.flag == 0) && !pointer_pending(s) &&
+				(s->indev->proc.types.pointer.drag_in_prog == 0));
+		}
+#if WS_DRIVER_KEYS
+		if ((s->keypad != NULL) && (task == s->keypad->driver.read_task)) {
+			return (!s->key_down && (s->key_tail == s->key_head));
+		}
+#endif
+	}
+	while ((disp = lv_disp_get_next(disp)) != NULL) {
+		if (task == disp->refr_task) {
+#if LV_USE_OBJ_INV_DEFER
+			// Marked objects may belong to any display, let them all look
+			if (lv_obj_get_inv_later_cnt() != 0) return false;
+#endif
+#if LV_USE_OBJ_LAYOUT_DEFER
+			if (lv_obj_get_layout_later_cnt() != 0) return false;
+#endif
+			return (disp->inv_p == 0);
+		}
+	}
+	
+	return false;
+}
+
+
+#if WS_DRIVER_TELEMETRY
+// sends every connected client a JSON summary of the last WS_DRIVER_TELEMETRY_MS:
+// refreshes, time spent rendering, pixels redrawn and the refresh period, then for each
+// client its frames, dropped frames, kB and time spent writing, its average write time
+// per kB and the frames it has waiting
+static void telemetry_task(void* pvParameters) {
+	static char buf[TELEMETRY_LEN];
+	static frame_tx_stats_t prev[WEBSOCKET_SERVER_MAX_CLIENTS];
+	frame_tx_stats_t cur;
+	uint32_t last_cnt = 0, last_ms = 0, last_px = 0;
+	uint32_t cnt, ms, px, period;
+	TickType_t last_tick;
+	lv_task_t* refr;
+	int i, n;
+	bool first;
+	
+	memset(prev, 0, sizeof(prev));
+	last_tick = xTaskGetTickCount();
+	
+	for (;;) {
+		vTaskDelayUntil(&last_tick, pdMS_TO_TICKS(WS_DRIVER_TELEMETRY_MS));
+		
+		cnt = render_cnt;
+		ms = render_ms;
+		px = render_px;
+		refr = lv_disp_get_refr_task(sessions[0].disp);
+		period = (refr != NULL) ? refr->period : 0;
+		
+		n = snprintf(buf, sizeof(buf), "{\"ms\":%u,\"refr\":%u,\"render_ms\":%u,\"px\":%u,\"period\":%u,\"heap\":%u,\"clients\":[",
+			WS_DRIVER_TELEMETRY_MS, cnt - last_cnt, ms - last_ms, px - last_px, period,
+			(uint32_t) heap_caps_get_free_size(MALLOC_CAP_8BIT));
+		last_cnt = cnt;
+		last_ms = ms;
+		last_px = px;
+		
+		first = true;
+		for (i=0; i<WEBSOCKET_SERVER_MAX_CLIENTS; i++) {
+			if (!frame_tx_get_stats(i, &cur)) continue;
 			
-		if (pixel_depth == 32) {
-			// Load the 32-bit pixel data: RGBA8888
-			lv_color32_t* p32 = (lv_color32_t*) color_map;
-			for (i=0; i<size; i++) {
-				*buf++ = p32[i].ch.red;
-				*buf++ = p32[i].ch.green;
-				*buf++ = p32[i].ch.blue;
-				*buf++ = p32[i].ch.alpha;
+			// Counters restart when a client connects
+			if (cur.seq != prev[i].seq) {
+				memset(&prev[i], 0, sizeof(frame_tx_stats_t));
 			}
-		} else if (pixel_depth == 16) {
-			// Load the 16-bit pixel data: RGB565
-			lv_color16_t* p16 = (lv_color16_t*) color_map;
-			for (i=0; i<size; i++) {
-				*buf++ = p16[i].full >> 8;
-				*buf++ = p16[i].full & 0xFF;
-			}
-		} else {
-			// Load the 8-bit pixel data: RGB332
-			lv_color8_t* p8 = (lv_color8_t*) color_map;
-			for (i=0; i<size; i++) {
-				*buf++ = p8[i].full;
+			if (!first && (n < sizeof(buf))) buf[n++] = ',';
+			if (n < sizeof(buf)) n += telemetry_client(&buf[n], sizeof(buf) - n, i, &prev[i], &cur);
+			prev[i] = cur;
+			first = false;
+		}
+		if (n < sizeof(buf)) n += snprintf(&buf[n], sizeof(buf) - n, "]}");
+		if (n >= sizeof(buf)) {
+			ESP_LOGW(TAG, "Telemetry message truncated");
+			continue;
+		}
+		
+		if (websocket_connected) {
+			for (i=0; i<WEBSOCKET_SERVER_MAX_CLIENTS; i++) {
+				(void) frame_tx_send_text(i, buf, n);
 			}
 		}
-			
-		// Send the buffer to the web page for display
-		i = ws_send_nocopy_bin_all(size * sizeof(lv_color_t) + PIXEL_BUF_HEADER_LEN + hdr_len);
 	}
-	
-	lv_disp_flush_ready(drv);
+	vTaskDelete(NULL);
 }
 
-
-bool websocket_driver_read(lv_indev_drv_t * drv, lv_indev_data_t * data)
+// Load buf with one client's telemetry entry, returning its length as snprintf() does.
+// It ends with the client's signal strength, PHY mode and weight once its link is known.
+static int telemetry_client(char* buf, int len, uint8_t num, const frame_tx_stats_t* prev, const frame_tx_stats_t* cur)
 {
-	xSemaphoreTake(pointer.mutex, portMAX_DELAY);
-	data->point.x = (int16_t) pointer.x;
-	data->point.y = (int16_t) pointer.y;
-	data->state = (pointer.flag == 0) ? LV_INDEV_STATE_REL : LV_INDEV_STATE_PR;
-	xSemaphoreGive(pointer.mutex);
+	int n;
+#if WS_DRIVER_WIFI_LINK
+	wifi_link_t link;
+#endif
 	
-	return false;
+	n = snprintf(buf, len, "{\"n\":%u,\"frames\":%u,\"dropped\":%u,\"kB\":%u,\"write_ms\":%u,\"us_per_kB\":%u,\"queue\":%u,\"unacked\":%u",
+		num, cur->sent - prev->sent, cur->dropped - prev->dropped,
+		(cur->bytes - prev->bytes) / 1024, (cur->write_us - prev->write_us) / 1000,
+		cur->cost, cur->queued, cur->unacked);
+#if WS_DRIVER_WIFI_LINK
+	if ((n < len) && wifi_link_get(num, &link)) {
+		n += snprintf(&buf[n], len - n, ",\"rssi\":%d,\"phy\":\"%s\",\"weight\":%u",
+			link.rssi, wifi_link_phy_name(link.phy), link.weight);
+	}
+#endif
+	if (n < len) n += snprintf(&buf[n], len - n, "}");
+	return n;
 }
+#endif
 
 
-/**********************
- *   STATIC FUNCTIONS
- **********************/
-// handles websocket events
-void websocket_callback(uint8_t num, WEBSOCKET_TYPE_t type, char* msg, uint64_t len) {
-	const static char* TAG = "websocket_callback";
-
-	switch(type) {
-		case WEBSOCKET_CONNECT:
-			ESP_LOGI(TAG, "client %i connected!", num);
-			websocket_connected = true;
-			// Force a redraw of the screen for the new client
-			lv_obj_invalidate(lv_disp_get_scr_act(lv_disp_get_default()));
-			break;
-		case WEBSOCKET_DISCONNECT_EXTERNAL:
-			ESP_LOGI(TAG, "client %i sent a disconnect message", num);
-			if (num_connected_clients() == 0) {
-				websocket_connected = false;
-			}
-			break;
-		case WEBSOCKET_DISCONNECT_INTERNAL:
-			ESP_LOGI(TAG, "client %i was disconnected", num);
-			if (num_connected_clients() == 0) {
-				websocket_connected = false;
+#if WS_DRIVER_HEATMAP
+// Add n to the counts of the first display's tiles area overlaps, or with share set,
+// share it between them by the pixels of area each holds
+static void heat_add(volatile uint32_t* counts, const lv_area_t* area, uint32_t n, bool share)
+{
+	lv_coord_t cols = (lv_disp_get_hor_res(sessions[0].disp) + WS_DRIVER_HEATMAP_TILE - 1) / WS_DRIVER_HEATMAP_TILE;
+	uint32_t size = lv_area_get_size(area);
+	lv_area_t tile, part;
+	lv_coord_t x, y;
+	
+	for (y=area->y1 / WS_DRIVER_HEATMAP_TILE; y<=area->y2 / WS_DRIVER_HEATMAP_TILE; y++) {
+		for (x=area->x1 / WS_DRIVER_HEATMAP_TILE; x<=area->x2 / WS_DRIVER_HEATMAP_TILE; x++) {
+			if ((x >= cols) || ((y * cols + x) >= HEAT_TILES)) break;
+			if (!share) {
+				counts[y * cols + x] += n;
+				continue;
 			}
-			break;
-		case WEBSOCKET_DISCONNECT_ERROR:
-			ESP_LOGI(TAG, "client %i was disconnected due to an error", num);
-			if (num_connected_clients() == 0) {
-				websocket_connected = false;
+			lv_area_set(&tile, x * WS_DRIVER_HEATMAP_TILE, y * WS_DRIVER_HEATMAP_TILE,
+				(x + 1) * WS_DRIVER_HEATMAP_TILE - 1, (y + 1) * WS_DRIVER_HEATMAP_TILE - 1);
+			if (lv_area_intersect(&part, &tile, area)) {
+				counts[y * cols + x] += (uint32_t) (((uint64_t) n * lv_area_get_size(&part)) / size);
 			}
-			break;
-		case WEBSOCKET_BIN:
-			if ((uint32_t) len == 5) {
-				xSemaphoreTake(pointer.mutex, portMAX_DELAY);
-				pointer.flag = (uint8_t) msg[0];
-				pointer.x = ((uint8_t) msg[1] << 8) | (uint8_t) msg[2];
-				pointer.y = ((uint8_t) msg[3] << 8) | (uint8_t) msg[4];
-				xSemaphoreGive(pointer.mutex);
+		}
+	}
+}
+
+// sends every connected client the flushes and bytes of each tile over the last
+// WS_DRIVER_HEATMAP_MS, as {"heat":{"ms":..,"tile":..,"cols":..,"rows":..,"flushes":[..],
+// "bytes":[..]}} with the tiles row by row
+static void heatmap_task(void* pvParameters) {
+	static char buf[HEATMAP_LEN];
+	static uint32_t prev_flushes[HEAT_TILES];
+	static uint32_t prev_bytes[HEAT_TILES];
+	TickType_t last_tick;
+	uint32_t v;
+	int cols, rows, i, n;
+	
+	memset(prev_flushes, 0, sizeof(prev_flushes));
+	memset(prev_bytes, 0, sizeof(prev_bytes));
+	last_tick = xTaskGetTickCount();
+	
+	for (;;) {
+		vTaskDelayUntil(&last_tick, pdMS_TO_TICKS(WS_DRIVER_HEATMAP_MS));
+		if (sessions[0].disp == NULL) continue;
+		
+		cols = (lv_disp_get_hor_res(sessions[0].disp) + WS_DRIVER_HEATMAP_TILE - 1) / WS_DRIVER_HEATMAP_TILE;
+		rows = (lv_disp_get_ver_res(sessions[0].disp) + WS_DRIVER_HEATMAP_TILE - 1) / WS_DRIVER_HEATMAP_TILE;
+		rows = LV_MATH_MIN(rows, HEAT_TILES / cols);
+		n = snprintf(buf, sizeof(buf), "{\"heat\":{\"ms\":%u,\"tile\":%u,\"cols\":%d,\"rows\":%d,\"flushes\":[",
+			WS_DRIVER_HEATMAP_MS, WS_DRIVER_HEATMAP_TILE, cols, rows);
+		for (i=0; i<cols*rows; i++) {
+			v = heat_flushes[i];
+			if (n < sizeof(buf)) n += snprintf(&buf[n], sizeof(buf) - n, i ? ",%u" : "%u", v - prev_flushes[i]);
+			prev_flushes[i] = v;
+		}
+		if (n < sizeof(buf)) n += snprintf(&buf[n], sizeof(buf) - n, "],\"bytes\":[");
+		for (i=0; i<cols*rows; i++) {
+			v = heat_bytes[i];
+			if (n < sizeof(buf)) n += snprintf(&buf[n], sizeof(buf) - n, i ? ",%u" : "%u", v - prev_bytes[i]);
+			prev_bytes[i] = v;
+		}
+		if (n < sizeof(buf)) n += snprintf(&buf[n], sizeof(buf) - n, "]}}");
+		if (n >= sizeof(buf)) {
+			ESP_LOGW(TAG, "Heatmap message truncated");
+			continue;
+		}
+		
+		if (websocket_connected) {
+			for (i=0; i<WEBSOCKET_SERVER_MAX_CLIENTS; i++) {
+				(void) frame_tx_send_text(i, buf, n);
 			}
-			break;
-		default:
-			ESP_LOGI(TAG, "client %i send unhandled websocket type %d", num, type);
-			break;
+		}
 	}
+	vTaskDelete(NULL);
 }
+#endif
 
-// serves any clients
-static void http_serve(struct netconn *conn) {
-	const static char* TAG = "http_server";
-	const static char HTML_HEADER[] = "HTTP/1.1 200 OK\nContent-type: text/html\n\n";
-	const static char ICO_HEADER[] = "HTTP/1.1 200 OK\nContent-type: image/x-icon\n\n";
 
-	struct netbuf* inbuf;
-	static char* buf;
-	static uint16_t buflen;
-	static err_t err;
+// Load one pixel in the same byte order used for raw pixel data
+static inline uint8_t* pack_pixel(uint8_t* buf, lv_color_t c)
+{
+#if WS_DRIVER_NATIVE
+	memcpy(buf, &c, sizeof(lv_color_t));
+	buf += sizeof(lv_color_t);
+#elif LV_COLOR_DEPTH == 32
+	*buf++ = c.ch.red;
+	*buf++ = c.ch.green;
+	*buf++ = c.ch.blue;
+	*buf++ = c.ch.alpha;
+#elif LV_COLOR_DEPTH == 16
+	*buf++ = c.full >> 8;
+	*buf++ = c.full & 0xFF;
+#else
+	*buf++ = c.full;
+#endif
+	return buf;
+}
 
-	// default page
-	extern const uint8_t index_html_start[] asm("_binary_index_html_start");
-	extern const uint8_t index_html_end[] asm("_binary_index_html_end");
-	const uint32_t index_html_len = index_html_end - index_html_start;
+#if WS_DRIVER_RLE
+// PackBits-style run-length encode a w x h block of pixels, from a buffer stride pixels
+// wide, into buf.  Runs may continue across rows.  Each control byte is followed by
+// pixel data:
+//   0x00 - 0x7F : (n + 1) literal pixels follow
+//   0x80 - 0xFF : the following pixel is repeated ((n & 0x7F) + 2) times
+// Returns the encoded length or 0 if it would not be smaller than max_len.
+static uint32_t pack_rle(uint8_t* buf, const lv_color_t* src, lv_coord_t w, lv_coord_t h, lv_coord_t stride, uint32_t max_len)
+{
+	uint8_t* start = buf;
+	uint8_t* end = buf + max_len;
+	uint8_t* ctrl = NULL;      // Control byte of the open literal sequence
+	lv_color_t run_c;
+	uint32_t run_n = 0;
+	uint32_t lit_n = 0;
+	int x, y;
 	
-	// favicon.ico (automatically requested by browsers from the "root directory")
-	extern const uint8_t favicon_ico_start[] asm("_binary_favicon_ico_start");
-	extern const uint8_t favicon_ico_end[] asm("_binary_favicon_ico_end");
-	const uint32_t favicon_ico_len = favicon_ico_end - favicon_ico_start;
-
-	netconn_set_recvtimeout(conn,1000); // allow a connection timeout of 1 second
-	ESP_LOGI(TAG, "reading from client...");
-	err = netconn_recv(conn, &inbuf);
-	ESP_LOGI(TAG, "read from client");
-	if(err == ERR_OK) {
-		netbuf_data(inbuf, (void**)&buf, &buflen);
-		if (buf) {
-			// default page
-			if (strstr(buf, "GET / ")
-				&& !strstr(buf, "Upgrade: websocket")) {
-				
-				ESP_LOGI(TAG, "Sending /");
-				netconn_write(conn, HTML_HEADER, sizeof(HTML_HEADER)-1, NETCONN_NOCOPY);
-				netconn_write(conn, index_html_start, index_html_len, NETCONN_NOCOPY);
-				netconn_close(conn);
-				netconn_delete(conn);
-				netbuf_delete(inbuf);
-			}
-
-			// default page websocket
-			else if (strstr(buf, "GET / ")
-					 && strstr(buf, "Upgrade: websocket")) {
-				ESP_LOGI(TAG, "Requesting websocket on /");
-				ws_server_add_client(conn, buf, buflen, "/", websocket_callback);
-				netbuf_delete(inbuf);
+	// Only compared once a run has started, set for the compiler
+	run_c.full = 0;
+	for (y=0; y<=h; y++) {
+		for (x=0; x<w; x++) {
+			// Extend the current run, first ending the final run once all rows are done
+			if (y < h) {
+				if ((run_n != 0) && (src[x].full == run_c.full) && (run_n < RLE_MAX_RUN)) {
+					run_n++;
+					continue;
+				}
+			} else if (run_n == 0) {
+				break;
 			}
 			
-			else if(strstr(buf,"GET /favicon.ico ")) {
-				ESP_LOGI(TAG, "Sending favicon.ico");
-				netconn_write(conn,ICO_HEADER, sizeof(ICO_HEADER)-1, NETCONN_NOCOPY);
-				netconn_write(conn,favicon_ico_start, favicon_ico_len, NETCONN_NOCOPY);
-				netconn_close(conn);
-				netconn_delete(conn);
-				netbuf_delete(inbuf);
-			}
-
-			else {
-				ESP_LOGI(TAG, "Unknown request");
-				netconn_close(conn);
-				netconn_delete(conn);
-				netbuf_delete(inbuf);
+			// Emit the pending run
+			if (run_n > 1) {
+				if ((buf + 1 + sizeof(lv_color_t)) >= end) return 0;
+				*buf++ = 0x80 | (run_n - 2);
+				buf = pack_pixel(buf, run_c);
+				ctrl = NULL;
+			} else if (run_n == 1) {
+				if ((ctrl == NULL) || (lit_n == RLE_MAX_LITERAL)) {
+					ctrl = buf++;
+					lit_n = 0;
+				}
+				if ((buf + sizeof(lv_color_t)) >= end) return 0;
+				buf = pack_pixel(buf, run_c);
+				*ctrl = lit_n++;
 			}
+			
+			if (y == h) break;
+			run_c = src[x];
+			run_n = 1;
 		}
-		else {
-			ESP_LOGI(TAG, "Unknown request (empty?...)");
-			netconn_close(conn);
-			netconn_delete(conn);
-			netbuf_delete(inbuf);
-		}
-	}
-	else {
-		ESP_LOGE(TAG, "error on read, closing connection");
-		netconn_close(conn);
-		netconn_delete(conn);
-		netbuf_delete(inbuf);
+		src += stride;
 	}
+	
+	return buf - start;
 }
+#endif
 
-// handles clients when they first connect. passes to a queue
-static void server_task(void* pvParameters) {
-	const static char* TAG = "server_task";
-	struct netconn *conn, *newconn;
-	static err_t err;
-	client_queue = xQueueCreate(client_queue_size, sizeof(struct netconn*));
-
-	conn = netconn_new(NETCONN_TCP);
-	netconn_bind(conn, NULL, 80);
-	netconn_listen(conn);
-	ESP_LOGI(TAG,"server listening");
-	do {
-		err = netconn_accept(conn, &newconn);
-		ESP_LOGI(TAG, "new client");
-		if(err == ERR_OK) {
-			xQueueSendToBack(client_queue, &newconn, portMAX_DELAY);
-			//http_serve(newconn);
+#if WS_DRIVER_PALETTE
+// Collect the colours of a w x h block of pixels, from a buffer stride pixels wide,
+// into palette.  Returns their number or 0 if there are more than PALETTE_MAX.
+static int palette_build(lv_color_t* palette, const lv_color_t* src, lv_coord_t w, lv_coord_t h, lv_coord_t stride)
+{
+	lv_color_t last = src[0];
+	int n = 1;
+	int i;
+	int x, y;
+	
+	palette[0] = last;
+	for (y=0; y<h; y++) {
+		for (x=0; x<w; x++) {
+			// Neighbouring pixels are mostly the same colour
+			if (src[x].full == last.full) continue;
+			last = src[x];
+			for (i=0; (i < n) && (palette[i].full != last.full); i++);
+			if (i == n) {
+				if (n == PALETTE_MAX) return 0;
+				palette[n++] = last;
+			}
 		}
-	} while(err == ERR_OK);
-	netconn_close(conn);
-	netconn_delete(conn);
-	ESP_LOGE(TAG,"task ending, rebooting board");
-	esp_restart();
+		src += stride;
+	}
+	
+	return n;
 }
 
-// receives clients from queue, handles them
-static void server_handle_task(void* pvParameters) {
-	const static char* TAG = "server_handle_task";
-	struct netconn* conn;
-	ESP_LOGI(TAG, "task starting");
-	for(;;) {
-		xQueueReceive(client_queue, &conn,portMAX_DELAY);
-		if (!conn) continue;
-		http_serve(conn);
-	}
-	vTaskDelete(NULL);
+// Returns the bits each pixel's index takes with a palette of colours colours
+static inline int palette_bits(int colours)
+{
+	return (colours <= 2) ? 1 : (colours <= 4) ? 2 : 4;
 }
 
-// Setup the websocket header, return the first position for payload
-// Note: We do not encrypt using the mask because that would slow us down...
-static int set_msg_buf(uint32_t msg_len)
+// Returns the length pack_palette() packs pixels pixels into
+static uint32_t palette_len(int colours, uint32_t pixels)
 {
-	int pos;
-	ws_header_t header;
-	
-	header.param.pos.ZERO = 0; // reset the whole header
-	header.param.pos.ONE  = 0;
+	return 1 + colours * sizeof(lv_color_t) + (pixels * palette_bits(colours) + 7) / 8;
+}
 
-	header.param.bit.FIN = 1; // all pieces are done (assume we aren't sending that huge of a message)
-	header.param.bit.OPCODE = WEBSOCKET_OPCODE_BIN;
+// Pack a w x h block of pixels, from a buffer stride pixels wide, as indices into the
+// palette of its colours, colours long, returning the packed length.  The data is:
+//   One byte of the number of colours less 1, then the colours as pixel data
+//   Each pixel's index in 1, 2 or 4 bits, for up to 2, 4 or 16 colours, packed most
+//   significant bits first and continuing across rows, with the last byte padded
+static uint32_t pack_palette(uint8_t* buf, const lv_color_t* palette, int colours, const lv_color_t* src, lv_coord_t w, lv_coord_t h, lv_coord_t stride)
+{
+	uint8_t* start = buf;
+	lv_color_t last = palette[0];
+	uint32_t index = 0;
+	uint32_t acc = 0;
+	int bits = palette_bits(colours);
+	int n = 0;
+	int i;
+	int x, y;
 	
-	// populate LEN field
-	pos = 2;
-	header.length = (uint64_t) msg_len;
-	if (msg_len <= 125) {
-		header.param.bit.LEN = msg_len;
-	}
-	else if (msg_len < 65536) {
-		header.param.bit.LEN = 126;
-		pos += 2;
+	*buf++ = colours - 1;
+	for (i=0; i<colours; i++) {
+		buf = pack_pixel(buf, palette[i]);
 	}
-	else {
-		header.param.bit.LEN = 127;
-		pos += 8;
-	}
-	
-	// Setup the websocket header bytes
-	msg_buf[0] = header.param.pos.ZERO;
-	msg_buf[1] = header.param.pos.ONE;
-	// put in the length, if necessary
-	if (header.param.bit.LEN == 126) {
-		msg_buf[2] = (msg_len >> 8) & 0xFF;
-		msg_buf[3] = (msg_len     ) & 0xFF;
-	}
-	if (header.param.bit.LEN == 127) {
-		msg_buf[2] = 0;
-		msg_buf[3] = 0;
-		msg_buf[4] = 0;
-		msg_buf[5] = 0;
-		msg_buf[6] = (msg_len >> 24) & 0xFF;
-		msg_buf[7] = (msg_len >> 16) & 0xFF;
-		msg_buf[8] = (msg_len >> 8)  & 0xFF;
-		msg_buf[9] = (msg_len)       & 0xFF;
-  	}
-  	
-  	return pos;
-}
-
-// Send our msg_buf out the websocket to all connected clients using nocopy
-// This function is an optimized version of the websocket_server's 
-// ws_server_send_bin_all() function eliminating a bunch of data copying.
-// Returns number of clients written.
-static int ws_send_nocopy_bin_all(uint32_t len)
-{
-	int ret = 0;
-	int err;
-  
-	// Grab the websocket server's mutex
-	xSemaphoreTake(xwebsocket_mutex,portMAX_DELAY);
-	
-	// Send to all connected clients
-	for (int i=0; i<WEBSOCKET_SERVER_MAX_CLIENTS; i++) {
-	    if (ws_is_connected(clients[i])) {
-			err = netconn_write(clients[i].conn, msg_buf, len, NETCONN_NOCOPY);
-			if (!err) {
-				ret += 1;
-			} else {
-				clients[i].scallback(i, WEBSOCKET_DISCONNECT_ERROR, NULL, 0);
-				ws_disconnect_client(&clients[i], 0);
+	
+	for (y=0; y<h; y++) {
+		for (x=0; x<w; x++) {
+			if (src[x].full != last.full) {
+				last = src[x];
+				for (index=0; (index < (colours - 1)) && (palette[index].full != last.full); index++);
+			}
+			acc = (acc << bits) | index;
+			n += bits;
+			if (n == 8) {
+				*buf++ = acc;
+				acc = 0;
+				n = 0;
 			}
 		}
+		src += stride;
+	}
+	if (n > 0) {
+		*buf++ = acc << (8 - n);
 	}
 	
-	xSemaphoreGive(xwebsocket_mutex);
-	
-	return ret;
+	return buf - start;
 }
+#endif
 
-static int num_connected_clients()
+#if WS_DRIVER_LOSSY && WS_DRIVER_RLE
+// Run-length encode a w x h block of pixels, from a buffer stride pixels wide, into buf
+// as pack_rle() does, after quantising them to RGB332.  Returns the encoded length or 0
+// if it would not be smaller than max_len.
+static uint32_t pack_rle332(uint8_t* buf, const lv_color_t* src, lv_coord_t w, lv_coord_t h, lv_coord_t stride, uint32_t max_len)
 {
-	int ret = 0;
+	uint8_t* start = buf;
+	uint8_t* end = buf + max_len;
+	uint8_t* ctrl = NULL;      // Control byte of the open literal sequence
+	uint8_t c;
+	uint8_t run_c = 0;
+	uint32_t run_n = 0;
+	uint32_t lit_n = 0;
+	int x, y;
 	
-	for (int i=0; i<WEBSOCKET_SERVER_MAX_CLIENTS; i++) {
-		if (ws_is_connected(clients[i])) ret++;
+	for (y=0; y<=h; y++) {
+		for (x=0; x<w; x++) {
+			// Extend the current run, first ending the final run once all rows are done
+			if (y < h) {
+				c = lv_color_to8(src[x]);
+				if ((run_n != 0) && (c == run_c) && (run_n < RLE_MAX_RUN)) {
+					run_n++;
+					continue;
+				}
+			} else if (run_n == 0) {
+				break;
+			}
+			
+			// Emit the pending run
+			if (run_n > 1) {
+				if ((buf + 2) >= end) return 0;
+				*buf++ = 0x80 | (run_n - 2);
+				*buf++ = run_c;
+				ctrl = NULL;
+			} else if (run_n == 1) {
+				if ((ctrl == NULL) || (lit_n == RLE_MAX_LITERAL)) {
+					ctrl = buf++;
+					lit_n = 0;
+				}
+				if ((buf + 1) >= end) return 0;
+				*buf++ = run_c;
+				*ctrl = lit_n++;
+			}
+			
+			if (y == h) break;
+			run_c = c;
+			run_n = 1;
+		}
+		src += stride;
 	}
 	
-	return ret;
+	return buf - start;
 }
+#endif
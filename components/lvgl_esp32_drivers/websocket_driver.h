@@ -21,21 +21,432 @@ extern "C" {
 #include <stdint.h>
 #include <stdbool.h>
 #include "lvgl/lvgl.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
 
 
 /*********************
 *      DEFINES
 *********************/
-#define DISP_BUF_SIZE (LV_HOR_RES_MAX * 30)
+// Lines LittlevGL draws at a time are chosen at boot from the free memory, within
+// these limits
+#define WS_DRIVER_MIN_LINES 10
+#define WS_DRIVER_MAX_LINES LV_VER_RES_MAX
+
+// Bytes of internal memory left free for WiFi, lwIP and the driver's tasks when the
+// draw buffers can't be placed in PSRAM
+#define WS_DRIVER_HEAP_RESERVE (64 * 1024)
+
+// Bytes each flushed area costs beyond its pixels: its region header, a websocket
+// header and the TCP/IP headers of the message carrying it
+#define WS_DRIVER_AREA_OVERHEAD (13 + 4 + 40)
+
+// The overhead in pixels, for the display driver's inv_area_cost so LittlevGL joins
+// nearby invalidated areas when that is cheaper than sending them separately
+#define WS_DRIVER_AREA_COST (WS_DRIVER_AREA_OVERHEAD / sizeof(lv_color_t))
+
+// Set to enable run-length encoding of the pixel data sent to the browser
+#define WS_DRIVER_RLE CONFIG_WEBSOCKET_DRIVER_RLE
+
+// Set to send single colour bands of rows as fills
+#define WS_DRIVER_FILL CONFIG_WEBSOCKET_DRIVER_FILL
+
+// Set to send regions of few colours as palette indices
+#define WS_DRIVER_PALETTE CONFIG_WEBSOCKET_DRIVER_PALETTE
+
+// Set to send browsers that announce them 16-byte region headers, regions padded to words
+#define WS_DRIVER_ALIGNED CONFIG_WEBSOCKET_DRIVER_ALIGNED
+
+// Set to let browsers ask for approximate pixels that are refined when their link is idle
+#define WS_DRIVER_LOSSY CONFIG_WEBSOCKET_DRIVER_LOSSY
+
+// Set to let browsers ask for the screen scaled down to a half or a quarter
+#define WS_DRIVER_THUMBNAILS CONFIG_WEBSOCKET_DRIVER_THUMBNAILS
+
+// Set to let browsers ask for the commands that drew each strip instead of its pixels,
+// which LittlevGL can only report for 16-bit color in the order it is stored
+#if CONFIG_WEBSOCKET_DRIVER_DRAW_STREAM && (LV_COLOR_DEPTH == 16) && (LV_COLOR_16_SWAP == 0)
+#define WS_DRIVER_DRAW_STREAM 1
+#define WS_DRIVER_DRAW_OPS CONFIG_WEBSOCKET_DRIVER_DRAW_OPS
+#else
+#define WS_DRIVER_DRAW_STREAM 0
+#endif
+
+// Set to send pixels in their in-memory byte order instead of repacking them
+#define WS_DRIVER_NATIVE CONFIG_WEBSOCKET_DRIVER_NATIVE
+// Set to send unencoded strips from the draw buffer they were drawn into
+#if CONFIG_WEBSOCKET_DRIVER_ZERO_COPY && CONFIG_WEBSOCKET_DRIVER_NATIVE
+#define WS_DRIVER_ZERO_COPY 1
+#else
+#define WS_DRIVER_ZERO_COPY 0
+#endif
+// Set to echo the sequence number of the last processed pointer event in each region
+#define WS_DRIVER_INPUT_SEQ CONFIG_WEBSOCKET_DRIVER_INPUT_SEQ
+// Set to take pointer events in the compact messages of protocol version 2
+#define WS_DRIVER_INPUT_V2 CONFIG_WEBSOCKET_DRIVER_INPUT_V2
+// mS between reads of a pointer that is released and has no events waiting, 0 to only
+// read it when a browser's event arrives
+#define WS_DRIVER_INDEV_IDLE CONFIG_WEBSOCKET_DRIVER_INDEV_IDLE
+// Set to take scroll distances and flings from browsers and apply them to the page under
+// their pointer
+#define WS_DRIVER_SCROLL CONFIG_WEBSOCKET_DRIVER_SCROLL
+// Set to take browsers' typing as a keypad typing into the text area last pressed
+#define WS_DRIVER_KEYS CONFIG_WEBSOCKET_DRIVER_KEYS
+// mS a refresh runs before input waiting for its display ends it between strips, the
+// rest being drawn after the input is handled, 0 to never cut a refresh short
+#define WS_DRIVER_PREEMPT CONFIG_WEBSOCKET_DRIVER_PREEMPT
+// mS after which a refresh always ends with the strip it is drawing, leaving the rest to
+// the next refresh, 0 for no limit
+#define WS_DRIVER_REFR_SLICE CONFIG_WEBSOCKET_DRIVER_REFR_SLICE
+// Set when the driver ends refreshes early, see websocket_driver_yield()
+#define WS_DRIVER_YIELD (WS_DRIVER_PREEMPT || WS_DRIVER_REFR_SLICE)
+// Pixels from the last press within which areas of a refresh are drawn first, the rest
+// following by their distance, 0 to draw them in the order they were invalidated
+#define WS_DRIVER_NEAR_FIRST CONFIG_WEBSOCKET_DRIVER_NEAR_FIRST
+// mS a browser's control of its display lasts after its last pointer event, 0 to take
+// input from every browser
+#define WS_DRIVER_INPUT_LEASE CONFIG_WEBSOCKET_DRIVER_INPUT_LEASE
+// mS a browser that lost its connection may resume its session for, only being resent
+// what changed, 0 to always resend the whole screen
+#define WS_DRIVER_RESUME CONFIG_WEBSOCKET_DRIVER_RESUME
+// Number of packed message buffers shared by the client senders
+#define WS_DRIVER_FRAME_BUFS CONFIG_WEBSOCKET_DRIVER_FRAME_BUFS
+// Number of messages a browser may not have acknowledged before its sender waits, 0 for
+// no limit
+#define WS_DRIVER_CREDITS CONFIG_WEBSOCKET_DRIVER_CREDITS
+// Size in bytes of each packed message buffer, 0 to hold a whole flush
+#define WS_DRIVER_FRAME_SIZE CONFIG_WEBSOCKET_DRIVER_FRAME_SIZE
+// Largest websocket fragment in bytes messages are written to clients in, with pings
+// and pongs going in between, 0 to write each as one frame
+#define WS_DRIVER_FRAGMENT CONFIG_WEBSOCKET_DRIVER_FRAGMENT
+// Grid in pixels that redrawn areas are rounded out to
+#define WS_DRIVER_ALIGN CONFIG_WEBSOCKET_DRIVER_ALIGN
+// Number of tasks serving HTTP requests
+#define WS_DRIVER_HTTP_TASKS CONFIG_WEBSOCKET_DRIVER_HTTP_TASKS
+// Set to fill half of large areas on the other core
+#define WS_DRIVER_SPLIT_FILL CONFIG_WEBSOCKET_DRIVER_SPLIT_FILL
+
+#define WS_DRIVER_ADAPT_REFR CONFIG_WEBSOCKET_DRIVER_ADAPT_REFR
+#if WS_DRIVER_ADAPT_REFR
+#define WS_DRIVER_REFR_MAX CONFIG_WEBSOCKET_DRIVER_REFR_MAX
+#endif
+// Number of areas or objects whose refresh rate may be capped
+#define WS_DRIVER_RATE_CAPS CONFIG_WEBSOCKET_DRIVER_RATE_CAPS
+
+#define WS_DRIVER_ANIM_PACE (CONFIG_WEBSOCKET_DRIVER_ANIM_PACE && LV_USE_ANIMATION)
+// Set to let browsers that ask for it run simple position and opacity animations
+#define WS_DRIVER_ANIM_OFFLOAD (CONFIG_WEBSOCKET_DRIVER_ANIM_OFFLOAD && LV_USE_ANIMATION)
+
+#define WS_DRIVER_TELEMETRY CONFIG_WEBSOCKET_DRIVER_TELEMETRY
+#if WS_DRIVER_TELEMETRY
+#define WS_DRIVER_TELEMETRY_MS CONFIG_WEBSOCKET_DRIVER_TELEMETRY_MS
+#endif
+// Set to send the browsers how often each tile was flushed, and its bytes, each window
+#define WS_DRIVER_HEATMAP CONFIG_WEBSOCKET_DRIVER_HEATMAP
+#if WS_DRIVER_HEATMAP
+#define WS_DRIVER_HEATMAP_TILE CONFIG_WEBSOCKET_DRIVER_HEATMAP_TILE
+#define WS_DRIVER_HEATMAP_MS CONFIG_WEBSOCKET_DRIVER_HEATMAP_MS
+#endif
+
+// Set to serve memory, task and client statistics on /metrics
+#define WS_DRIVER_METRICS CONFIG_WEBSOCKET_DRIVER_METRICS
+
+// Set to serve the tunable parameters on /config, changed with a POST and saved to NVS
+#define WS_DRIVER_TUNE CONFIG_WEBSOCKET_DRIVER_TUNE
+
+// Performance presets, see websocket_driver_config_preset(), and the one the parameters
+// start from
+#define WS_DRIVER_PRESET_CUSTOM      0
+#define WS_DRIVER_PRESET_THROUGHPUT  1
+#define WS_DRIVER_PRESET_LATENCY     2
+#define WS_DRIVER_PRESET_LOW_MEMORY  3
+#define WS_DRIVER_PRESET CONFIG_WEBSOCKET_DRIVER_PRESET
+
+// Set to record a trace of rendering and transmission, served on /trace
+#define WS_DRIVER_TRACE CONFIG_WEBSOCKET_DRIVER_TRACE
+#if WS_DRIVER_TRACE
+#define WS_DRIVER_TRACE_EVENTS CONFIG_WEBSOCKET_DRIVER_TRACE_EVENTS
+#endif
+
+// Set to record pointer input and replay it in place of the browsers'
+#define WS_DRIVER_INPUT_REC CONFIG_WEBSOCKET_DRIVER_INPUT_REC
+#if WS_DRIVER_INPUT_REC
+#define WS_DRIVER_INPUT_REC_EVENTS CONFIG_WEBSOCKET_DRIVER_INPUT_REC_EVENTS
+#endif
+
+// Set to capture the messages a viewer is sent to flash
+#define WS_DRIVER_CAPTURE CONFIG_WEBSOCKET_DRIVER_CAPTURE
+
+#define WS_DRIVER_BENCHMARK CONFIG_WEBSOCKET_DRIVER_BENCHMARK
+
+// Set to show the render, pack and send times on the display itself, see pipe_mon.h
+#define WS_DRIVER_PIPE_MON CONFIG_WEBSOCKET_DRIVER_PIPE_MON
+#if WS_DRIVER_PIPE_MON
+#define WS_DRIVER_PIPE_MON_MS CONFIG_WEBSOCKET_DRIVER_PIPE_MON_MS
+#endif
+
+// Set to time LittleVGL's drawing primitives and the driver's packing at startup
+#define WS_DRIVER_MICROBENCH CONFIG_WEBSOCKET_DRIVER_MICROBENCH
+
+// Set to sample each browser's WiFi link and weight clients on weak links as slower
+#define WS_DRIVER_WIFI_LINK CONFIG_WEBSOCKET_DRIVER_WIFI_LINK
+#if WS_DRIVER_WIFI_LINK
+#define WS_DRIVER_WEAK_RSSI CONFIG_WEBSOCKET_DRIVER_WEAK_RSSI
+#endif
+
+// Set to stop sending to browsers in hidden tabs until they are shown
+#define WS_DRIVER_PAUSE_HIDDEN CONFIG_WEBSOCKET_DRIVER_PAUSE_HIDDEN
+
+// Set to stop refreshing displays no browser is taking frames of
+#define WS_DRIVER_CONSUMER_REFR CONFIG_WEBSOCKET_DRIVER_CONSUMER_REFR
+
+// Set to switch WiFi between streaming and power saving with the browsers' activity
+#define WS_DRIVER_WIFI_POWER CONFIG_WEBSOCKET_DRIVER_WIFI_POWER
+#if WS_DRIVER_WIFI_POWER
+#define WS_DRIVER_WIFI_IDLE_S CONFIG_WEBSOCKET_DRIVER_WIFI_IDLE_S
+#define WS_DRIVER_WIFI_SAVE_TX_POWER CONFIG_WEBSOCKET_DRIVER_WIFI_SAVE_TX_POWER
+#ifdef CONFIG_WEBSOCKET_DRIVER_WIFI_HT40
+#define WS_DRIVER_WIFI_HT40 1
+#else
+#define WS_DRIVER_WIFI_HT40 0
+#endif
+#endif
+
+// Set to have the browsers move scrolled pixels themselves, see lv_disp_drv_t.copy_cb
+#define WS_DRIVER_SCROLL_COPY CONFIG_WEBSOCKET_DRIVER_SCROLL_COPY
+
+// Set to give each client slot its own display, see websocket_driver_set_session_cb()
+#define WS_DRIVER_SESSIONS CONFIG_WEBSOCKET_DRIVER_SESSIONS
+// Set to split each refresh slice between the session displays with something to draw, by
+// their weight and the pixels they redraw, see websocket_driver_set_session_weight()
+#if WS_DRIVER_SESSIONS && WS_DRIVER_REFR_SLICE
+#define WS_DRIVER_FAIR_REFR CONFIG_WEBSOCKET_DRIVER_FAIR_REFR
+#else
+#define WS_DRIVER_FAIR_REFR 0
+#endif
+
+// Refreshes are reported through the display driver's monitor_cb
+#define WS_DRIVER_MONITOR (WS_DRIVER_TELEMETRY || WS_DRIVER_BENCHMARK || WS_DRIVER_PIPE_MON)
+
+#define WS_DRIVER_LVGL_TASK CONFIG_WEBSOCKET_DRIVER_LVGL_TASK
+#if WS_DRIVER_LVGL_TASK
+#define WS_DRIVER_LVGL_STACK CONFIG_WEBSOCKET_DRIVER_LVGL_STACK
+#define WS_DRIVER_LVGL_PRIO CONFIG_WEBSOCKET_DRIVER_LVGL_PRIO
+#endif
+// Longest the LVGL loop runs back to back before blocking for a tick, 0 for no limit
+#define WS_DRIVER_FRAME_BUDGET CONFIG_WEBSOCKET_DRIVER_FRAME_BUDGET
+
+// Set to serve the page and its websocket over TLS as well
+#ifdef CONFIG_WEBSOCKET_DRIVER_TLS
+#define WS_DRIVER_TLS 1
+#define WS_DRIVER_TLS_PORT CONFIG_WEBSOCKET_DRIVER_TLS_PORT
+#else
+#define WS_DRIVER_TLS 0
+#endif
+
+// TCP port native viewers connect to with raw framing, 0 for none
+#define WS_DRIVER_RAW_PORT CONFIG_WEBSOCKET_DRIVER_RAW_PORT
+// Set to relay the raw viewer protocol over a UART
+#ifdef CONFIG_WEBSOCKET_DRIVER_SERIAL
+#define WS_DRIVER_SERIAL 1
+#define WS_DRIVER_SERIAL_UART CONFIG_WEBSOCKET_DRIVER_SERIAL_UART
+#define WS_DRIVER_SERIAL_BAUD CONFIG_WEBSOCKET_DRIVER_SERIAL_BAUD
+#define WS_DRIVER_SERIAL_TX_PIN CONFIG_WEBSOCKET_DRIVER_SERIAL_TX_PIN
+#define WS_DRIVER_SERIAL_RX_PIN CONFIG_WEBSOCKET_DRIVER_SERIAL_RX_PIN
+#else
+#define WS_DRIVER_SERIAL 0
+#endif
+
+// Set to mirror the application's display on a local SPI LCD, which is sent the draw
+// buffers as they are so only with 16-bit color in the panel's byte order
+#if defined(CONFIG_WEBSOCKET_DRIVER_LCD) && (LV_COLOR_DEPTH == 16) && LV_COLOR_16_SWAP
+#define WS_DRIVER_LCD 1
+#define WS_DRIVER_LCD_HOST CONFIG_WEBSOCKET_DRIVER_LCD_HOST
+#define WS_DRIVER_LCD_CLOCK_MHZ CONFIG_WEBSOCKET_DRIVER_LCD_CLOCK_MHZ
+#define WS_DRIVER_LCD_MOSI_PIN CONFIG_WEBSOCKET_DRIVER_LCD_MOSI_PIN
+#define WS_DRIVER_LCD_CLK_PIN CONFIG_WEBSOCKET_DRIVER_LCD_CLK_PIN
+#define WS_DRIVER_LCD_CS_PIN CONFIG_WEBSOCKET_DRIVER_LCD_CS_PIN
+#define WS_DRIVER_LCD_DC_PIN CONFIG_WEBSOCKET_DRIVER_LCD_DC_PIN
+#define WS_DRIVER_LCD_RST_PIN CONFIG_WEBSOCKET_DRIVER_LCD_RST_PIN
+#define WS_DRIVER_LCD_BCKL_PIN CONFIG_WEBSOCKET_DRIVER_LCD_BCKL_PIN
+#define WS_DRIVER_LCD_MADCTL CONFIG_WEBSOCKET_DRIVER_LCD_MADCTL
+#ifdef CONFIG_WEBSOCKET_DRIVER_LCD_INVERT
+#define WS_DRIVER_LCD_INVERT 1
+#else
+#define WS_DRIVER_LCD_INVERT 0
+#endif
+#else
+#define WS_DRIVER_LCD 0
+#endif
+
+// Set to send the display to an upstream relay, which fans it out to the browsers
+#ifdef CONFIG_WEBSOCKET_DRIVER_RELAY
+#define WS_DRIVER_RELAY 1
+#define WS_DRIVER_RELAY_HOST CONFIG_WEBSOCKET_DRIVER_RELAY_HOST
+#define WS_DRIVER_RELAY_PORT CONFIG_WEBSOCKET_DRIVER_RELAY_PORT
+#else
+#define WS_DRIVER_RELAY 0
+#endif
+
+// Cores for xTaskCreatePinnedToCore()
+#if WS_DRIVER_LVGL_TASK && defined(CONFIG_WEBSOCKET_DRIVER_LVGL_CORE) && (CONFIG_WEBSOCKET_DRIVER_LVGL_CORE >= 0)
+#define WS_DRIVER_LVGL_PINNED 1
+#define WS_DRIVER_LVGL_CORE CONFIG_WEBSOCKET_DRIVER_LVGL_CORE
+#else
+#define WS_DRIVER_LVGL_CORE tskNO_AFFINITY
+#endif
+#if defined(CONFIG_WEBSOCKET_DRIVER_NET_CORE) && (CONFIG_WEBSOCKET_DRIVER_NET_CORE >= 0)
+#define WS_DRIVER_NET_CORE CONFIG_WEBSOCKET_DRIVER_NET_CORE
+#else
+#define WS_DRIVER_NET_CORE tskNO_AFFINITY
+#endif
+
+// Network task priorities: accept connections first, then pack and transmit what
+// LittlevGL has rendered, serving page loads and telemetry last
+#define WS_DRIVER_SERVER_PRIO 9
+#define WS_DRIVER_SENDER_PRIO 7
+#define WS_DRIVER_CLIENT_TX_PRIO 7
+#define WS_DRIVER_HTTP_PRIO 6
+#define WS_DRIVER_TELEMETRY_PRIO 6
+// Set when LVGL reads its time from esp_timer, see LV_TICK_CUSTOM in lv_conf.h, and
+// needs no tick hook
+#define WS_DRIVER_TICK_ESP_TIMER CONFIG_WEBSOCKET_DRIVER_TICK_ESP_TIMER
+// Set to only send the tiles that differ from a shadow copy of the screen
+#define WS_DRIVER_SHADOW CONFIG_WEBSOCKET_DRIVER_SHADOW
+// Set to draw into two screen-sized buffers and send each refresh as one message
+#define WS_DRIVER_FULL_FRAME CONFIG_WEBSOCKET_DRIVER_FULL_FRAME
+// Free internal memory below which each client may have only one frame waiting, 0 for
+// no limit
+#define WS_DRIVER_MEM_LOW CONFIG_WEBSOCKET_DRIVER_MEM_LOW
+// Set to draw into internal memory on boards with PSRAM, keeping the message buffers
+// in PSRAM
+#define WS_DRIVER_DRAW_INTERNAL CONFIG_WEBSOCKET_DRIVER_DRAW_INTERNAL
+// Set to give the request handling tasks, and separately the tasks sending frames,
+// stacks in PSRAM
+#ifdef CONFIG_WEBSOCKET_DRIVER_STACKS_PSRAM
+#define WS_DRIVER_STACKS_PSRAM 1
+#else
+#define WS_DRIVER_STACKS_PSRAM 0
+#endif
+#ifdef CONFIG_WEBSOCKET_DRIVER_SENDER_STACKS_PSRAM
+#define WS_DRIVER_SENDER_STACKS_PSRAM 1
+#else
+#define WS_DRIVER_SENDER_STACKS_PSRAM 0
+#endif
+#if WS_DRIVER_SHADOW
+#define WS_DRIVER_TILE_SIZE CONFIG_WEBSOCKET_DRIVER_TILE_SIZE
+#endif
+// Set to send the strips of a whole-screen refresh as the fragments of one message
+#define WS_DRIVER_WHOLE_SCREEN CONFIG_WEBSOCKET_DRIVER_WHOLE_SCREEN
+// Set to keep the shadow framebuffer whole while nobody watches and serve it at
+// /snapshot, for a loading page to paint before its websocket opens
+#if WS_DRIVER_SHADOW && defined(CONFIG_WEBSOCKET_DRIVER_SNAPSHOT)
+#define WS_DRIVER_SNAPSHOT CONFIG_WEBSOCKET_DRIVER_SNAPSHOT
+#else
+#define WS_DRIVER_SNAPSHOT 0
+#endif
+// Set to serve the page and other files from the asset partition, which LittlevGL
+// reads on drive WS_DRIVER_ASSET_LETTER
+#define WS_DRIVER_ASSETS CONFIG_WEBSOCKET_DRIVER_ASSETS
+#define WS_DRIVER_ASSET_LETTER 'A'
+// Set to register the streaming PNG and JPEG image decoders
+#define WS_DRIVER_IMG_DEC CONFIG_WEBSOCKET_DRIVER_IMG_DEC
+
+
+/**********************
+ *      TYPEDEFS
+ **********************/
+// Builds the user interface of a session display, which is the default display during
+// the call
+typedef void (*websocket_driver_session_cb_t)(lv_disp_t * disp);
+
+// Work done by the LVGL loop, see websocket_driver_get_run_stats()
+typedef struct
+{
+	uint32_t passes;        // Passes through the loop, each running LVGL's due tasks
+	uint32_t busy_us;       // Time spent in them, wrapping
+	uint32_t max_pass_us;   // Longest pass since the last call
+	uint32_t over_budget;   // Passes longer than WS_DRIVER_FRAME_BUDGET
+	uint32_t yields;        // Times the loop blocked for a tick with work still due
+	uint32_t slices;        // Refreshes ended after WS_DRIVER_REFR_SLICE mS, finished later
+} websocket_driver_run_stats_t;
+
+// Parameters that can be changed without rebuilding, see websocket_driver_init().  Those
+// marked live apply at once, the rest the next time buffers and tasks are created.
+// Limits whose option was 0 in menuconfig are compiled out and have no effect.
+typedef struct
+{
+	uint32_t max_lines;     // Most lines drawn at a time
+	uint32_t frame_size;    // Size of each packed message buffer, 0 to hold a whole flush
+	uint32_t lvgl_stack;    // LVGL task's stack size and priority, with WS_DRIVER_LVGL_TASK
+	uint32_t lvgl_prio;
+	uint32_t sender_prio;   // Priority of the task packing frames
+	uint32_t credits;       // Live: messages a browser may have unacknowledged, from its hello
+	uint32_t fragment;      // Live: largest websocket fragment written, 0 for no limit
+	uint32_t frame_budget;  // Live: mS the LVGL loop runs before blocking, 0 for no limit
+	uint32_t preempt;       // Live: mS before waiting input ends a refresh, 0 for never
+	uint32_t refr_slice;    // Live: mS after which a refresh always ends, 0 for no limit
+	uint32_t near_first;    // Live: pixels from the pointer drawn first, 0 to keep LVGL's order
+	uint32_t refr_period;   // Live: mS between display refreshes, the least with adaptive refresh
+	uint32_t max_clients;   // Live: browsers served at once, more are refused
+	uint32_t wifi_save;     // Live: set to save WiFi power while browsers are idle
+	uint32_t encodings;     // Live: pixel encodings offered, 1 run-length, 2 palette, 4 fill, 8 copy
+} websocket_driver_config_t;
 
 
 /**********************
  * GLOBAL PROTOTYPES
  **********************/
-void websocket_driver_init();
+void websocket_driver_config_default(websocket_driver_config_t* cfg);
+bool websocket_driver_config_preset(websocket_driver_config_t* cfg, int preset);
+void websocket_driver_init(const websocket_driver_config_t* cfg);
+void websocket_driver_get_config(websocket_driver_config_t* cfg);
+void websocket_driver_set_config(const websocket_driver_config_t* cfg);
+BaseType_t websocket_driver_create_task(TaskFunction_t fn, const char* name, uint32_t stack, void* arg,
+	UBaseType_t prio, TaskHandle_t* handle, BaseType_t core, bool psram);
+uint32_t websocket_driver_init_buf(lv_disp_buf_t * disp_buf);
 bool websocket_driver_available();
+void websocket_driver_run();
+void websocket_driver_wake();
+void websocket_driver_get_run_stats(websocket_driver_run_stats_t* stats);
+void websocket_driver_station(const uint8_t* mac, bool connected);
+#if WS_DRIVER_SESSIONS
+void websocket_driver_set_session_cb(websocket_driver_session_cb_t cb);
+#endif
+#if WS_DRIVER_FAIR_REFR
+void websocket_driver_set_session_weight(int session, uint8_t weight);
+#endif
 void websocket_driver_flush(lv_disp_drv_t * drv, const lv_area_t * area, lv_color_t * color_map);
+void websocket_driver_rounder(lv_disp_drv_t * drv, lv_area_t * area);
+void websocket_driver_wait(lv_disp_drv_t * drv);
+#if WS_DRIVER_SCROLL_COPY
+void websocket_driver_copy(lv_disp_drv_t * drv, const lv_area_t * area, lv_coord_t dx, lv_coord_t dy);
+#endif
 bool websocket_driver_read(lv_indev_drv_t * drv, lv_indev_data_t * data);
+#if WS_DRIVER_KEYS
+bool websocket_driver_read_keys(lv_indev_drv_t * drv, lv_indev_data_t * data);
+#endif
+#if WS_DRIVER_YIELD
+bool websocket_driver_yield(lv_disp_drv_t * drv, uint32_t elapsed);
+#endif
+#if WS_DRIVER_NEAR_FIRST
+uint32_t websocket_driver_rank(lv_disp_drv_t * drv, const lv_area_t * area);
+#endif
+#if WS_DRIVER_RATE_CAPS
+int websocket_driver_cap_area(lv_disp_t* disp, const lv_area_t* area, uint32_t period);
+int websocket_driver_cap_obj(lv_obj_t* obj, uint32_t period);
+void websocket_driver_uncap(int cap);
+bool websocket_driver_hold(lv_disp_drv_t * drv, const lv_area_t * area);
+#endif
+#if WS_DRIVER_MONITOR
+void websocket_driver_monitor(lv_disp_drv_t * drv, uint32_t time, uint32_t px);
+#endif
+#if WS_DRIVER_TRACE
+void websocket_driver_trace(lv_disp_drv_t * drv, lv_disp_trace_t event, const lv_area_t * area);
+#endif
+#if WS_DRIVER_MICROBENCH
+uint32_t websocket_driver_pack(uint8_t* buf, const lv_area_t* area, const lv_color_t* src, lv_coord_t stride, bool encode);
+#endif
 
 
 #ifdef __cplusplus
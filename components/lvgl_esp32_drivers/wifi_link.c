@@ -0,0 +1,231 @@
+/**
+* WiFi link quality of each client of the LittleVGL websocket driver
+*
+* The websocket callback records each client's IP address as it connects and the
+* LVGL task samples the soft-AP's station list at most once every SAMPLE_MS, or
+* sooner after a station joins or leaves.  The stations' DHCP leases map their MAC
+* addresses to IP addresses, which match them to clients.  The results are guarded by
+* a spinlock since telemetry and /metrics read them from other tasks.
+*
+* The WiFi driver reports each station's RSSI and PHY mode but not its retries or
+* current PHY rate, so a weak signal and an 802.11b only station stand in for a link
+* that retries often.
+*
+*/
+
+/*********************
+ *      INCLUDES
+ *********************/
+#include "wifi_link.h"
+#include "frame_tx.h"
+#include "websocket_server.h"
+#include "esp_wifi.h"
+#include "tcpip_adapter.h"
+#include "esp_log.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include <string.h>
+
+
+/*********************
+ *      DEFINES
+ *********************/
+// Longest time in mS between samples of the station list
+#define SAMPLE_MS           1000
+
+// Weight added for each dB a client's signal is below the weak threshold, and the
+// most a client can be weighted
+#define WEIGHT_PER_DB       10
+#define WEIGHT_MAX          400
+
+// Weight of an 802.11b or long range only station, whose PHY rate is at most 11 Mbit/s
+#define WEIGHT_11B          200
+
+
+/**********************
+ *      TYPEDEFS
+ **********************/
+typedef struct
+{
+	uint32_t ip;       // Client's IPv4 address, 0 when the slot is not in use
+	bool matched;      // Set once the client has been matched to a station
+	wifi_link_t link;
+} client_link_t;
+
+
+/**********************
+ *  STATIC VARIABLES
+ **********************/
+static const char* TAG = "wifi_link";
+
+static client_link_t links[WEBSOCKET_SERVER_MAX_CLIENTS];
+static int8_t weak_rssi;
+static TickType_t last_sample;
+static volatile bool sample_due = true;
+static portMUX_TYPE link_mux = portMUX_INITIALIZER_UNLOCKED;
+
+
+/**********************
+ *  STATIC PROTOTYPES
+ **********************/
+static uint16_t link_weight(int8_t rssi, uint8_t phy);
+
+
+/**********************
+ *   GLOBAL FUNCTIONS
+ **********************/
+// Clients with an RSSI below weak_rssi dBm are weighted as slower
+void wifi_link_init(int8_t weak)
+{
+	memset(links, 0, sizeof(links));
+	weak_rssi = weak;
+	last_sample = xTaskGetTickCount();
+}
+
+
+// Called from the websocket callback when a client connects
+void wifi_link_connect(uint8_t num, struct netconn* conn)
+{
+	ip_addr_t addr;
+	u16_t port;
+	uint32_t ip = 0;
+
+	if (netconn_peer(conn, &addr, &port) == ERR_OK) {
+		ip = ip_2_ip4(&addr)->addr;
+	}
+
+	portENTER_CRITICAL(&link_mux);
+	links[num].ip = ip;
+	links[num].matched = false;
+	portEXIT_CRITICAL(&link_mux);
+
+	sample_due = true;
+}
+
+
+// Called from the websocket callback when a client disconnects
+void wifi_link_disconnect(uint8_t num)
+{
+	portENTER_CRITICAL(&link_mux);
+	links[num].ip = 0;
+	links[num].matched = false;
+	portEXIT_CRITICAL(&link_mux);
+}
+
+
+// Called from the WiFi event handler when a station joins or leaves the soft-AP.
+// The clients of a station that left are forgotten at once rather than at the next
+// sample, since their connections may take a while to time out.
+void wifi_link_station(const uint8_t* mac, bool connected)
+{
+	int i;
+
+	if (!connected) {
+		portENTER_CRITICAL(&link_mux);
+		for (i=0; i<WEBSOCKET_SERVER_MAX_CLIENTS; i++) {
+			if (links[i].matched && (memcmp(links[i].link.mac, mac, 6) == 0)) {
+				links[i].matched = false;
+			}
+		}
+		portEXIT_CRITICAL(&link_mux);
+	}
+	sample_due = true;
+}
+
+
+// Called from the LVGL task to sample the stations when a sample is due, passing each
+// client's weight on to the frame sender
+void wifi_link_sample()
+{
+	static wifi_sta_list_t stations;
+	static tcpip_adapter_sta_list_t leases;
+	client_link_t c;
+	int i, j, k;
+
+	if (!sample_due && ((xTaskGetTickCount() - last_sample) < pdMS_TO_TICKS(SAMPLE_MS))) return;
+	sample_due = false;
+	last_sample = xTaskGetTickCount();
+
+	if ((esp_wifi_ap_get_sta_list(&stations) != ESP_OK) ||
+		(tcpip_adapter_get_sta_list(&stations, &leases) != ESP_OK)) {
+		ESP_LOGD(TAG, "No station list");
+		return;
+	}
+
+	for (i=0; i<WEBSOCKET_SERVER_MAX_CLIENTS; i++) {
+		portENTER_CRITICAL(&link_mux);
+		c = links[i];
+		portEXIT_CRITICAL(&link_mux);
+		if (c.ip == 0) continue;
+
+		// Find the station holding the client's address
+		c.matched = false;
+		for (j=0; (j < leases.num) && !c.matched; j++) {
+			if (leases.sta[j].ip.addr != c.ip) continue;
+			for (k=0; k<stations.num; k++) {
+				if (memcmp(stations.sta[k].mac, leases.sta[j].mac, 6) != 0) continue;
+				memcpy(c.link.mac, stations.sta[k].mac, 6);
+				c.link.rssi = stations.sta[k].rssi;
+				c.link.phy = (stations.sta[k].phy_11b ? WIFI_LINK_PHY_11B : 0) |
+					(stations.sta[k].phy_11g ? WIFI_LINK_PHY_11G : 0) |
+					(stations.sta[k].phy_11n ? WIFI_LINK_PHY_11N : 0) |
+					(stations.sta[k].phy_lr ? WIFI_LINK_PHY_LR : 0);
+				c.link.weight = link_weight(c.link.rssi, c.link.phy);
+				c.matched = true;
+				break;
+			}
+		}
+
+		// Keep the result only if the client didn't reconnect meanwhile
+		portENTER_CRITICAL(&link_mux);
+		if (links[i].ip == c.ip) links[i] = c;
+		portEXIT_CRITICAL(&link_mux);
+
+		frame_tx_set_weight(i, c.matched ? c.link.weight : 100);
+	}
+}
+
+
+// Load link with a client's last sampled link quality.  Returns false if the client
+// isn't connected or hasn't been matched to a station.
+bool wifi_link_get(uint8_t num, wifi_link_t* link)
+{
+	bool matched;
+
+	portENTER_CRITICAL(&link_mux);
+	matched = links[num].matched;
+	*link = links[num].link;
+	portEXIT_CRITICAL(&link_mux);
+
+	return matched;
+}
+
+
+// Returns the name of the fastest of the PHY modes in phy
+const char* wifi_link_phy_name(uint8_t phy)
+{
+	if (phy & WIFI_LINK_PHY_11N) return "11n";
+	if (phy & WIFI_LINK_PHY_11G) return "11g";
+	if (phy & WIFI_LINK_PHY_11B) return "11b";
+	if (phy & WIFI_LINK_PHY_LR) return "lr";
+	return "";
+}
+
+
+/**********************
+ *   STATIC FUNCTIONS
+ **********************/
+// Returns the percentage a station's measured write cost is scaled by: 100 on a good
+// link, growing as its signal falls below the weak threshold
+static uint16_t link_weight(int8_t rssi, uint8_t phy)
+{
+	uint32_t weight = 100;
+
+	if (rssi < weak_rssi) {
+		weight += (weak_rssi - rssi) * WEIGHT_PER_DB;
+	}
+	if (((phy & (WIFI_LINK_PHY_11G | WIFI_LINK_PHY_11N)) == 0) && (weight < WEIGHT_11B)) {
+		weight = WEIGHT_11B;
+	}
+	return (weight > WEIGHT_MAX) ? WEIGHT_MAX : weight;
+}
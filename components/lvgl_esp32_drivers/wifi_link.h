@@ -0,0 +1,63 @@
+/**
+* WiFi link quality of each client of the LittleVGL websocket driver
+*
+* Matches each websocket client to the station it connects through, by its IP address
+* in the soft-AP's DHCP leases, and samples the station's signal strength and PHY
+* mode.  Clients on a weak link are given a higher weight so the adaptive refresh
+* period treats them as slower than their measured write cost alone shows.
+*
+*/
+#ifndef WIFI_LINK_H
+#define WIFI_LINK_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*********************
+ *      INCLUDES
+ *********************/
+#include <stdint.h>
+#include <stdbool.h>
+#include "lwip/api.h"
+
+
+/*********************
+ *      DEFINES
+ *********************/
+// PHY modes a station supports
+#define WIFI_LINK_PHY_11B   0x01
+#define WIFI_LINK_PHY_11G   0x02
+#define WIFI_LINK_PHY_11N   0x04
+#define WIFI_LINK_PHY_LR    0x08
+
+
+/**********************
+ *      TYPEDEFS
+ **********************/
+typedef struct
+{
+	uint8_t mac[6];    // Station MAC address
+	int8_t rssi;       // Signal strength in dBm at the last sample
+	uint8_t phy;       // WIFI_LINK_PHY_* modes
+	uint16_t weight;   // Percentage the client's write cost is scaled by
+} wifi_link_t;
+
+
+/**********************
+ * GLOBAL PROTOTYPES
+ **********************/
+void wifi_link_init(int8_t weak_rssi);
+void wifi_link_connect(uint8_t num, struct netconn* conn);
+void wifi_link_disconnect(uint8_t num);
+void wifi_link_station(const uint8_t* mac, bool connected);
+void wifi_link_sample();
+bool wifi_link_get(uint8_t num, wifi_link_t* link);
+const char* wifi_link_phy_name(uint8_t phy);
+
+
+#ifdef __cplusplus
+} /* extern "C" */
+#endif
+
+#endif /* WIFI_LINK_H */
@@ -0,0 +1,127 @@
+/**
+* WiFi power profiles of the LittleVGL websocket driver
+*
+* The streaming profile turns modem sleep off, allows 40 MHz channels if configured
+* and transmits at the power the application set, so frames and input go out as soon
+* as they are ready.  The saving profile lets the modem sleep, narrows the channel to
+* 20 MHz and lowers the transmit power.  The profiles can only be applied once WiFi
+* has started, so a profile that couldn't be is tried again at the next call.
+*
+* In soft-AP only mode the IDF's power save applies to no interface, since an AP must
+* stay awake for its stations, so the transmit power and bandwidth are what save power
+* there.  With a station interface as well it lets that sleep between beacons.
+*
+*/
+
+/*********************
+ *      INCLUDES
+ *********************/
+#include "wifi_power.h"
+#include "esp_wifi.h"
+#include "esp_log.h"
+
+
+/*********************
+ *      DEFINES
+ *********************/
+// Transmit power is in units of 0.25 dBm
+#define TX_POWER_DBM(p)     ((p) / 4), (((p) % 4) * 25)
+
+
+/**********************
+ *      TYPEDEFS
+ **********************/
+typedef enum
+{
+	PROFILE_NONE,       // Neither has been applied yet
+	PROFILE_SAVING,
+	PROFILE_STREAMING,
+} profile_t;
+
+
+/**********************
+ *  STATIC VARIABLES
+ **********************/
+static const char* TAG = "wifi_power";
+
+static int8_t save_power;
+static int8_t stream_power = 0;     // Read when a profile is first applied
+static bool stream_ht40;
+static volatile profile_t profile = PROFILE_NONE;
+
+
+/**********************
+ *  STATIC PROTOTYPES
+ **********************/
+static bool apply(profile_t p);
+
+
+/**********************
+ *   GLOBAL FUNCTIONS
+ **********************/
+// Save at save_tx_power, in units of 0.25 dBm, and stream on 40 MHz channels if ht40
+void wifi_power_init(int8_t save_tx_power, bool ht40)
+{
+	save_power = save_tx_power;
+	stream_ht40 = ht40;
+}
+
+
+// Called from the LVGL task to switch to the streaming or saving profile.  Returns
+// false if WiFi hasn't started and the profile must be set again later.
+bool wifi_power_set(bool streaming)
+{
+	profile_t p = streaming ? PROFILE_STREAMING : PROFILE_SAVING;
+
+	if (p == profile) return true;
+	if (!apply(p)) return false;
+	profile = p;
+	return true;
+}
+
+
+// Returns true while the streaming profile is applied
+bool wifi_power_streaming()
+{
+	return (profile == PROFILE_STREAMING);
+}
+
+
+/**********************
+ *   STATIC FUNCTIONS
+ **********************/
+static bool apply(profile_t p)
+{
+	int8_t power;
+	esp_err_t err;
+
+	// The power the application left is kept for streaming
+	if (stream_power == 0) {
+		if (esp_wifi_get_max_tx_power(&power) != ESP_OK) return false;
+		stream_power = power;
+		if (save_power > stream_power) save_power = stream_power;
+	}
+
+	if (p == PROFILE_STREAMING) {
+		err = esp_wifi_set_ps(WIFI_PS_NONE);
+		if (err == ESP_OK) err = esp_wifi_set_bandwidth(WIFI_IF_AP, stream_ht40 ? WIFI_BW_HT40 : WIFI_BW_HT20);
+		if (err == ESP_OK) err = esp_wifi_set_max_tx_power(stream_power);
+	} else {
+		err = esp_wifi_set_ps(WIFI_PS_MIN_MODEM);
+		if (err == ESP_OK) err = esp_wifi_set_bandwidth(WIFI_IF_AP, WIFI_BW_HT20);
+		if (err == ESP_OK) err = esp_wifi_set_max_tx_power(save_power);
+	}
+	if (err != ESP_OK) {
+		ESP_LOGD(TAG, "Profile not applied, error 0x%x", err);
+		return false;
+	}
+
+	if (p == PROFILE_STREAMING) {
+		ESP_LOGI(TAG, "Streaming: no modem sleep, %s MHz, %d.%02d dBm",
+			stream_ht40 ? "40" : "20", TX_POWER_DBM(stream_power));
+	} else {
+		ESP_LOGI(TAG, "Saving: modem sleep, 20 MHz, %d.%02d dBm",
+			TX_POWER_DBM(save_power));
+	}
+	return true;
+}
@@ -0,0 +1,34 @@
+/**
+* WiFi power profiles of the LittleVGL websocket driver
+*
+* Switches the soft-AP between a streaming profile, for the lowest latency while a
+* browser is being sent frames, and a power saving one while no browser is watching.
+*
+*/
+#ifndef WIFI_POWER_H
+#define WIFI_POWER_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*********************
+ *      INCLUDES
+ *********************/
+#include <stdint.h>
+#include <stdbool.h>
+
+
+/**********************
+ * GLOBAL PROTOTYPES
+ **********************/
+void wifi_power_init(int8_t save_tx_power, bool ht40);
+bool wifi_power_set(bool streaming);
+bool wifi_power_streaming();
+
+
+#ifdef __cplusplus
+} /* extern "C" */
+#endif
+
+#endif /* WIFI_POWER_H */
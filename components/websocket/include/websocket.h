@@ -25,6 +25,8 @@ extern "C" {
 #define WEBSOCKET_H
 
 #include "lwip/api.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
 
 // the different codes for the callbacks
 typedef enum {
@@ -71,6 +73,49 @@ typedef struct {
   bool received; // was a message successfully received?
 } ws_header_t;
 
+// RSV1 in the first byte of a frame header, set on the first frame of a message
+// compressed with permessage-deflate
+#define WS_HEADER_COMPRESSED 0x40
+
+// length of a raw client's frame header, see ws_fill_client_header()
+#define WS_RAW_HEADER_LEN 5
+
+// longest payload of a control frame
+#define WS_CONTROL_MAX_LEN 125
+
+// a ping or pong left for the task holding the client's write lock to send once the frame
+// it is writing ends, see ws_send_control()
+typedef struct {
+  volatile bool pending; // set once msg holds the frame's payload, until it is sent
+  uint8_t len;
+  char msg[WS_CONTROL_MAX_LEN];
+} ws_control_t;
+
+// longest Sec-WebSocket-Key accepted, and the length of the Sec-WebSocket-Accept value
+// answering it
+#define WS_KEY_MAX_LEN 64
+#define WS_ACCEPT_LEN 28
+
+// the parts of an HTTP request that requests are routed and upgraded on, found by
+// ws_parse_request(). the strings point into the request and aren't terminated
+typedef struct {
+  const char* method;   // request method, e.g. GET
+  uint16_t method_len;
+  const char* path;     // request target, with any query string
+  uint16_t path_len;
+  bool upgrade;         // set by "Upgrade: websocket"
+  const char* key;      // Sec-WebSocket-Key, NULL if absent
+  uint16_t key_len;
+  bool deflate;         // permessage-deflate offered with parameters the server can accept
+  bool deflate_bits;    // the offer limits the server's window, which must be answered
+  const char* etag;     // If-None-Match, NULL if absent
+  uint16_t etag_len;
+  const char* range;    // Range, NULL if absent
+  uint16_t range_len;
+  const char* body;     // the first byte after the headers, NULL if they weren't all read
+  uint32_t content_len; // Content-Length, 0 if absent
+} ws_request_t;
+
 // a client, with space for a server callback or a client callback (depending on use)
 typedef struct {
   struct netconn* conn; // the connection
@@ -78,12 +123,32 @@ typedef struct {
   char* protocol;		// the associated protocol, null terminated
   bool ping;            // did we send a ping?
   WEBSOCKET_OPCODES_t last_opcode; // the previous opcode
-  char* contin;         // any continuation piece
-  bool contin_text;     // is the continue a binary or text?
+  char* contin;         // the fragments of a message so far
+  uint8_t contin_first; // the first byte of its first fragment's header: opcode and RSV1
   uint64_t len;         // length of continuation
-  uint32_t unfinished;      // sometimes netconn doesn't read a full frame, treated similarly to a continuation frame
   void (*ccallback)(WEBSOCKET_TYPE_t type,char* msg,uint64_t len); // client callback
   void (*scallback)(uint8_t num,WEBSOCKET_TYPE_t type,char* msg,uint64_t len); // server callback
+  char* rx_buf;         // optional buffer for received messages, NULL to always malloc
+  uint32_t rx_buf_len;  // size of rx_buf
+  bool rx_held;         // the last message was read in place, in rx_in or the TLS session
+  // the frame parser's state, see ws_read(). a frame's header and payload are collected
+  // across however many segments they arrive in
+  uint32_t rx_ready;    // receive events whose segments haven't been taken yet
+  struct netbuf* rx_in; // the segment being parsed, NULL for a TLS record
+  char* rx_data;        // its bytes not parsed yet
+  uint16_t rx_data_len;
+  char rx_saved;        // the byte of rx_data a message read in place is terminated over
+  uint8_t rx_hdr[14];   // the frame header so far
+  uint8_t rx_hdr_len;
+  ws_header_t rx_header; // the header, once it is complete
+  char* rx_msg;         // the payload so far, NULL while it is being skipped
+  uint64_t rx_pos;      // payload bytes collected
+  SemaphoreHandle_t write_lock; // optional lock held while a frame is written, NULL for none
+  bool raw;             // frames have the raw header instead, see ws_fill_client_header()
+  struct ws_tls* tls;   // the TLS session frames are sent and received through, NULL for none
+  bool deflate;         // messages may be compressed with permessage-deflate, in both directions
+  ws_control_t ctrl_ping; // control frames waiting for the write lock
+  ws_control_t ctrl_pong;
 } ws_client_t;
 
 // returns the populated client struct
@@ -96,10 +161,47 @@ ws_client_t ws_connect_client(struct netconn* conn,
                               void (*scallback)(uint8_t num,WEBSOCKET_TYPE_t type,char* msg,uint64_t len)
                              );
 void ws_disconnect_client(ws_client_t* client,bool mask);
-bool ws_is_connected(ws_client_t client); // returns 1 if connected, status updates after send/read/connect/disconnect
+bool ws_is_connected(const ws_client_t* client); // returns 1 if connected, status updates after send/read/connect/disconnect
 int ws_send(ws_client_t* client,WEBSOCKET_OPCODES_t opcode,char* msg,uint64_t len,bool mask); // sends message. this function performs the masking
-char* ws_read(ws_client_t* client,ws_header_t* header); // unmasks and returns message. populates header.
-char* ws_hash_handshake(char* key,uint8_t len); // returns string of output
+void ws_lock_write(ws_client_t* client); // takes the client's write lock, for writing a frame with netconn directly
+void ws_unlock_write(ws_client_t* client); // sends any control frames left waiting before giving the lock
+// sends a ping or pong without waiting for the write lock: while another task holds it the
+// frame is left for that task to send once the frame it is writing ends. a pong left
+// waiting answers the earlier ping, later ones are dropped until it has gone
+int ws_send_control(ws_client_t* client,WEBSOCKET_OPCODES_t opcode,const char* msg,uint64_t len);
+// sends the control frames left waiting. for writing with the write lock held, between
+// frames, e.g. the fragments of a long message
+int ws_send_control_pending(ws_client_t* client);
+// sends the vectors as a single unmasked frame without copying them into a buffer.
+// the vectors' data must not change until it has been sent (NETCONN_NOCOPY) and the
+// vectors themselves are updated as they are written
+int ws_send_vectored(ws_client_t* client,WEBSOCKET_OPCODES_t opcode,struct netvector* vectors,uint16_t vectorcnt);
+// writes what it can of data before the send timeout as netconn_write_partly(), through
+// the client's TLS session if it has one. for writing a frame directly with the write
+// lock held
+err_t ws_write_partly(ws_client_t* client,const void* data,size_t len,uint8_t flags,size_t* written);
+int ws_fill_header(char* out,WEBSOCKET_OPCODES_t opcode,uint64_t len); // fills out (at least 10 bytes) with an unmasked frame header, returns its length
+int ws_fill_fragment_header(char* out,WEBSOCKET_OPCODES_t opcode,uint64_t len,bool fin); // as ws_fill_header() for a fragment of a message, the last if fin
+// as ws_fill_fragment_header() in the client's framing. a raw client's frames, in both
+// directions, have a WS_RAW_HEADER_LEN byte header instead: the first byte of the
+// websocket header (FIN bit and opcode) then the length as a 32 bit big-endian number,
+// and are never masked
+int ws_fill_client_header(const ws_client_t* client,char* out,WEBSOCKET_OPCODES_t opcode,uint64_t len,bool fin);
+// parses what has been received so far without waiting for more, returning the next
+// complete message unmasked and populating header, or NULL with header.received clear
+// once the data runs out part way through one, which is kept for the next call
+char* ws_read(ws_client_t* client,ws_header_t* header);
+void ws_read_done(ws_client_t* client,char* msg); // releases a message returned by ws_read
+void ws_received(ws_client_t* client,uint32_t events); // counts receive events, whose segments ws_read can take without waiting
+bool ws_pending(const ws_client_t* client); // true if the client has received data ws_read hasn't parsed
+// parses the request line and headers of the first len bytes of buf, which needn't be
+// terminated, in a single pass. returns false if the request line is incomplete
+bool ws_parse_request(const char* buf,uint16_t len,ws_request_t* req);
+bool ws_request_path_is(const ws_request_t* req,const char* path); // true if the path, less any query string, is path
+uint16_t ws_request_path_len(const ws_request_t* req); // the length of the path less any query string
+// loads accept with the terminated Sec-WebSocket-Accept value for key, using the SHA
+// accelerator and nothing from the heap. returns false for an empty or over long key
+bool ws_hash_handshake(const char* key,uint16_t len,char accept[WS_ACCEPT_LEN + 1]);
 
 #endif // ifndef WEBSOCKET_H
 
@@ -0,0 +1,63 @@
+
+/*
+esp32-websocket - a websocket component on esp-idf
+Copyright (C) 2019 Blake Felt - blake.w.felt@gmail.com
+
+This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifndef WEBSOCKET_DEFLATE_H
+#define WEBSOCKET_DEFLATE_H
+
+#include "sdkconfig.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef CONFIG_WEBSOCKET_SERVER_DEFLATE
+#define WEBSOCKET_SERVER_DEFLATE 1
+#define WEBSOCKET_SERVER_DEFLATE_HEAP CONFIG_WEBSOCKET_SERVER_DEFLATE_HEAP
+#else
+#define WEBSOCKET_SERVER_DEFLATE 0
+#endif
+
+// messages are compressed on their own (no context takeover) with matches reaching back
+// at most 1 << WS_DEFLATE_WINDOW_BITS bytes, so neither side keeps a window between
+// messages and the search needs nothing but a table of WS_DEFLATE_TABLE_LEN entries
+#define WS_DEFLATE_WINDOW_BITS 12
+#define WS_DEFLATE_TABLE_LEN 1024
+
+#define WS_DEFLATE_MIN_LEN 64 // shorter messages are sent as they are
+#define WS_DEFLATE_TAIL_LEN 4 // the empty stored block ending a sync flush, 00 00 ff ff
+#define WS_INFLATE_MAX_LEN 4096 // longest message inflated, longer ones are dropped
+
+// compresses len bytes of src into dst as deflate blocks ended by a sync flush, using
+// table for the search. returns the length of the compressed data, tail included, or 0
+// if it doesn't fit in dst_len bytes
+size_t ws_deflate(const uint8_t* src,size_t len,uint8_t* dst,size_t dst_len,uint16_t* table);
+
+// inflates a message, which had the sync flush tail taken off, into dst. back references
+// can only reach into the message itself. returns false if the data is bad or doesn't
+// fit in dst_len bytes
+bool ws_inflate(const uint8_t* src,size_t len,uint8_t* dst,size_t dst_len,size_t* out_len);
+
+#endif // ifndef WEBSOCKET_DEFLATE_H
+
+#ifdef __cplusplus
+}
+#endif
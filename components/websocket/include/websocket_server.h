@@ -25,10 +25,15 @@ extern "C" {
 #define WEBSOCKET_SERVER_H
 
 #include "websocket.h"
+#include "websocket_tls.h"
 
 #define WEBSOCKET_SERVER_MAX_CLIENTS CONFIG_WEBSOCKET_SERVER_MAX_CLIENTS
-#define WEBSOCKET_SERVER_QUEUE_SIZE CONFIG_WEBSOCKET_SERVER_QUEUE_SIZE
-#define WEBSOCKET_SERVER_QUEUE_TIMEOUT CONFIG_WEBSOCKET_SERVER_QUEUE_TIMEOUT
+#define WEBSOCKET_SERVER_RX_BUF_SIZE CONFIG_WEBSOCKET_SERVER_RX_BUF_SIZE
+#define WEBSOCKET_SERVER_RX_BUF_PSRAM CONFIG_WEBSOCKET_SERVER_RX_BUF_PSRAM
+#define WEBSOCKET_SERVER_ADMIT_HEAP CONFIG_WEBSOCKET_SERVER_ADMIT_HEAP
+#define WEBSOCKET_SERVER_LOW_LATENCY CONFIG_WEBSOCKET_SERVER_LOW_LATENCY
+#define WEBSOCKET_SERVER_SEND_TIMEOUT CONFIG_WEBSOCKET_SERVER_SEND_TIMEOUT
+#define WEBSOCKET_SERVER_PING_INTERVAL CONFIG_WEBSOCKET_SERVER_PING_INTERVAL
 #define WEBSOCKET_SERVER_TASK_STACK_DEPTH CONFIG_WEBSOCKET_SERVER_TASK_STACK_DEPTH
 #define WEBSOCKET_SERVER_TASK_PRIORITY CONFIG_WEBSOCKET_SERVER_TASK_PRIORITY
 #define WEBSOCKET_SERVER_PINNED CONFIG_WEBSOCKET_SERVER_PINNED
@@ -43,10 +48,17 @@ extern ws_client_t clients[WEBSOCKET_SERVER_MAX_CLIENTS];
 // starts the server
 int ws_server_start();
 
+#if configSUPPORT_STATIC_ALLOCATION
+// starts the server on a stack of WEBSOCKET_SERVER_TASK_STACK_DEPTH bytes the caller
+// provides, which may be in PSRAM, and its task control block in internal memory
+int ws_server_start_static(StackType_t* stack, StaticTask_t* task);
+#endif
+
 // ends the server
 int ws_server_stop();
 
-// adds a client, returns the client's number in the server
+// adds a client, returns the client's number in the server.  A client that can't be
+// accepted, as the server is full or short of memory, is answered with 503.
 int ws_server_add_client(struct netconn* conn,
                          char* msg,
                          uint16_t len,
@@ -66,8 +78,50 @@ int ws_server_add_client_protocol(struct netconn* conn,
                                                    char* msg,
                                                    uint64_t len));
 
+// the same for a request already parsed with ws_parse_request()
+int ws_server_add_client_request(struct netconn* conn,
+                                 const ws_request_t* req,
+                                 char* url,
+                                 char* protocol,
+                                 void (*callback)(uint8_t num,
+                                                  WEBSOCKET_TYPE_t type,
+                                                  char* msg,
+                                                  uint64_t len));
+// adds a connection accepted on a port of its own, with no HTTP request or handshake,
+// as a raw client (see ws_fill_client_header()). a client that can't be accepted is
+// closed
+int ws_server_add_client_raw(struct netconn* conn,
+                             char* url,
+                             void (*callback)(uint8_t num,
+                                              WEBSOCKET_TYPE_t type,
+                                              char* msg,
+                                              uint64_t len));
+#if WEBSOCKET_SERVER_TLS
+// the same for a request read through a TLS session on conn, whose frames are then sent
+// and received through the session. the session is ended with the connection
+int ws_server_add_client_tls(struct netconn* conn,
+                             struct ws_tls* tls,
+                             const ws_request_t* req,
+                             char* url,
+                             char* protocol,
+                             void (*callback)(uint8_t num,
+                                              WEBSOCKET_TYPE_t type,
+                                              char* msg,
+                                              uint64_t len));
+#endif
 int ws_server_len_url(char* url); // returns the number of connected clients to url
 int ws_server_len_all(); // returns the total number of connected clients
+int ws_server_len_all_from_callback(); // the same without the mutex, for the callback
+void ws_server_set_max_clients(int max); // refuses connections beyond max clients
+
+// hold a client's write lock while writing a frame to its netconn directly, so
+// server sends (pings, pongs and closes) don't land in the middle of it
+void ws_server_lock_client(int num);
+void ws_server_unlock_client(int num);
+
+// disconnects a client after a failed write, unless it has already been replaced by a
+// new connection
+void ws_server_drop_client(int num,struct netconn* conn);
 
 int ws_server_remove_client(int num); // removes the client with the set number
 int ws_server_remove_clients(char* url); // removes all clients connected to the specified url
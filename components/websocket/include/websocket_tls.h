@@ -0,0 +1,77 @@
+
+/*
+esp32-websocket - a websocket component on esp-idf
+Copyright (C) 2019 Blake Felt - blake.w.felt@gmail.com
+
+This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifndef WEBSOCKET_TLS_H
+#define WEBSOCKET_TLS_H
+
+#include "lwip/api.h"
+
+#ifdef CONFIG_WEBSOCKET_SERVER_TLS
+#define WEBSOCKET_SERVER_TLS 1
+#define WEBSOCKET_SERVER_TLS_RECORD_LEN CONFIG_WEBSOCKET_SERVER_TLS_RECORD_LEN
+#else
+#define WEBSOCKET_SERVER_TLS 0
+#endif
+
+// a TLS session on a connection, NULL for a plain connection
+typedef struct ws_tls ws_tls_t;
+
+#if WEBSOCKET_SERVER_TLS
+
+// sets up the server's certificate and key, both PEM with the terminator counted in the
+// length. returns false if they can't be parsed
+bool ws_tls_init(const unsigned char* cert,size_t cert_len,const unsigned char* key,size_t key_len);
+
+// runs the server side of the handshake on an accepted connection, waiting up to its
+// receive timeout for the browser. returns NULL if the handshake fails, leaving the
+// connection to the caller
+ws_tls_t* ws_tls_accept(struct netconn* conn);
+
+// points data at the plaintext of the next record, or the next part of it, which stays
+// valid until the next read. only what has already been received is decrypted, and
+// ERR_WOULDBLOCK returned if that isn't a whole record
+err_t ws_tls_read(ws_tls_t* tls,char** data,uint16_t* len);
+
+// waits up to the connection's receive timeout for the next segment and hands it to the
+// session, for a reader that got ERR_WOULDBLOCK and has nothing else to do meanwhile.
+// returns ERR_OK once data has arrived, or the connection's error
+err_t ws_tls_wait(ws_tls_t* tls);
+
+// encrypts up to WEBSOCKET_SERVER_TLS_RECORD_LEN bytes of data as a record and sends
+// it, setting written to the bytes taken. a small write with more set is held to go out
+// in the same record as the next one. when the connection's send buffer is full nothing
+// is taken and ERR_WOULDBLOCK returned, the write must then be repeated with the same
+// data
+err_t ws_tls_write(ws_tls_t* tls,const void* data,size_t len,bool more,size_t* written);
+err_t ws_tls_write_all(ws_tls_t* tls,const void* data,size_t len); // writes all of data, as netconn_write()
+
+bool ws_tls_pending(const ws_tls_t* tls); // true if data has been received that ws_tls_read() hasn't returned
+void ws_tls_close(ws_tls_t* tls); // tells the browser the session is closing and frees it, leaving the connection open
+
+#endif // if WEBSOCKET_SERVER_TLS
+
+#endif // ifndef WEBSOCKET_TLS_H
+
+#ifdef __cplusplus
+}
+#endif
@@ -18,11 +18,16 @@ This program is free software: you can redistribute it and/or modify
 */
 
 #include "websocket.h"
+#include "websocket_tls.h"
+#include "websocket_deflate.h"
 #include "lwip/tcp.h" // for the netconn structure
 #include "esp_system.h" // for esp_random
 #include "mbedtls/base64.h"
-#include "mbedtls/sha1.h"
+#include "hwcrypto/sha.h" // the SHA accelerator
 #include <string.h>
+#include <strings.h>
+
+#define WS_WRITE_STALL_TRIES 50 // send timeouts without progress before a write gives up
 
 ws_client_t ws_connect_client(struct netconn* conn,
                               char* url,
@@ -35,34 +40,75 @@ ws_client_t ws_connect_client(struct netconn* conn,
   client.ping = 0;
   client.last_opcode = 0;
   client.contin = NULL;
+  client.contin_first = 0;
   client.len = 0;
-  client.unfinished = 0;
   client.ccallback = ccallback;
   client.scallback = scallback;
+  client.rx_buf = NULL;
+  client.rx_buf_len = 0;
+  client.rx_ready = 0;
+  client.rx_in = NULL;
+  client.rx_data = NULL;
+  client.rx_data_len = 0;
+  client.rx_hdr_len = 0;
+  client.rx_msg = NULL;
+  client.rx_pos = 0;
+  client.write_lock = NULL;
+  client.raw = false;
+  client.tls = NULL;
+  client.rx_held = false;
+  client.deflate = false;
+  client.ctrl_ping.pending = false;
+  client.ctrl_pong.pending = false;
   return client;
 }
 
+// frees a message buffer unless it is the client's receive buffer
+static void ws_free_rx(ws_client_t* client,char* msg) {
+  if(msg != client->rx_buf) free(msg);
+}
+
 void ws_disconnect_client(ws_client_t* client,bool mask) {
   ws_send(client,WEBSOCKET_OPCODE_CLOSE,NULL,0,mask); // tell the client to close
   if(client->conn) {
     client->conn->callback = NULL; // shut off the callback
+#if WEBSOCKET_SERVER_TLS
+    if(client->tls) {
+      ws_tls_close(client->tls);
+      client->tls = NULL;
+    }
+#endif
     netconn_close(client->conn);
     netconn_delete(client->conn);
     client->conn = NULL;
   }
   client->url = NULL;
   client->last_opcode = 0;
-  if(client->len) {
-    if(client->contin)
-      free(client->contin);
-    client->len = 0;
+  if(client->contin) {
+    free(client->contin);
+    client->contin = NULL;
+  }
+  client->len = 0;
+
+  // drop a frame part way through. a message read in place stays valid until its
+  // netbuf is deleted by ws_read_done()
+  if(client->rx_msg) {
+    ws_free_rx(client,client->rx_msg);
+    client->rx_msg = NULL;
   }
+  if(!client->rx_held) {
+    netbuf_delete(client->rx_in);
+    client->rx_in = NULL;
+  }
+  client->rx_data_len = 0;
+  client->rx_hdr_len = 0;
+  client->rx_ready = 0;
   client->ccallback = NULL;
   client->scallback = NULL;
 }
 
-bool ws_is_connected(ws_client_t client) {
-  if(client.conn)
+bool ws_is_connected(const ws_client_t* client) {
+  if(client->conn)
     return 1;
   return 0;
 }
@@ -80,57 +126,93 @@ static void ws_encrypt_decrypt(char* msg,ws_header_t header) {
   }
 }
 
-int ws_send(ws_client_t* client,WEBSOCKET_OPCODES_t opcode,char* msg,uint64_t len,bool mask) {
-  char* out;
-  char* encrypt;
-  uint64_t pos;
-  uint64_t true_len;
+// writes all of the vectors. with a send timeout lwip returns after writing part of
+// them, so carry on from there until everything is queued, the connection fails or
+// WS_WRITE_STALL_TRIES timeouts pass without progress. the vectors are updated as
+// they are written. a TLS client's vectors are written a record at a time
+static err_t ws_write_vectors(ws_client_t* client,struct netvector* vectors,uint16_t vectorcnt,uint8_t flags) {
+  size_t written;
+  err_t err;
+  int stalled = 0;
+
+  for(;;) {
+    written = 0;
+#if WEBSOCKET_SERVER_TLS
+    if(client->tls)
+      err = ws_tls_write(client->tls,vectors->ptr,vectors->len,vectorcnt > 1 || (flags & NETCONN_MORE),&written);
+    else
+#endif
+    err = netconn_write_vectors_partly(client->conn,vectors,vectorcnt,flags,&written);
+    if(err != ERR_OK && err != ERR_WOULDBLOCK) return err;
+    if(!written && ++stalled >= WS_WRITE_STALL_TRIES) return ERR_WOULDBLOCK;
+    if(written) stalled = 0;
+    while(vectorcnt && written >= vectors->len) {
+      written -= vectors->len;
+      vectors++;
+      vectorcnt--;
+    }
+    if(!vectorcnt) return ERR_OK;
+    vectors->ptr = (const uint8_t*)vectors->ptr + written;
+    vectors->len -= written;
+  }
+}
+
+static err_t ws_write(ws_client_t* client,const void* data,size_t len,uint8_t flags) {
+  struct netvector vector;
+
+  vector.ptr = data;
+  vector.len = len;
+  return ws_write_vectors(client,&vector,1,flags);
+}
+
+err_t ws_write_partly(ws_client_t* client,const void* data,size_t len,uint8_t flags,size_t* written) {
+#if WEBSOCKET_SERVER_TLS
+  if(client->tls) return ws_tls_write(client->tls,data,len,flags & NETCONN_MORE,written);
+#endif
+  return netconn_write_partly(client->conn,data,len,flags,written);
+}
+
+void ws_received(ws_client_t* client,uint32_t events) {
+  client->rx_ready += events;
+}
+
+bool ws_pending(const ws_client_t* client) {
+  if(client->rx_data_len || client->rx_ready) return 1;
+#if WEBSOCKET_SERVER_TLS
+  if(client->tls) return ws_tls_pending(client->tls);
+#endif
+  return 0;
+}
+
+// fills out with an unmasked frame header, returns the header length
+int ws_fill_header(char* out,WEBSOCKET_OPCODES_t opcode,uint64_t len) {
+  return ws_fill_fragment_header(out,opcode,len,true);
+}
+
+// fills out with an unmasked frame header for a fragment of a message, the last if fin
+// is set. the first fragment has the message's opcode, the rest WEBSOCKET_OPCODE_CONT
+int ws_fill_fragment_header(char* out,WEBSOCKET_OPCODES_t opcode,uint64_t len,bool fin) {
   ws_header_t header;
-  int ret;
+  int pos;
 
   header.param.pos.ZERO = 0; // reset the whole header
   header.param.pos.ONE  = 0;
 
-  header.param.bit.FIN = 1; // all pieces are done (you don't need a huge message anyway...)
+  header.param.bit.FIN = fin ? 1 : 0;
   header.param.bit.OPCODE = opcode;
   // populate LEN field
   pos = 2;
-  header.length = len;
   if(len<=125) {
     header.param.bit.LEN = len;
   }
   else if(len<65536) {
     header.param.bit.LEN = 126;
-    pos += 2;
-  }
-  else {
-    header.param.bit.LEN = 127;
-    pos += 8;
-  }
-
-  if(mask) {
-    ws_generate_mask(&header); // get a key
-    encrypt = malloc(len); // allocate memory for the encryption
-    memcpy(encrypt,msg,len);
-    ws_encrypt_decrypt(encrypt,header); // encrypt it!
-    pos += 4; // add the position
-  }
-
-  true_len = pos+len; // get the length of the entire message
-  pos = 2;
-  out = malloc(true_len); // allocate dat memory
-
-  out[0] = header.param.pos.ZERO; // save header
-  out[1] = header.param.pos.ONE;
-
-  // put in the length, if necessary
-  if(header.param.bit.LEN == 126) {
     out[2] = (len >> 8) & 0xFF;
     out[3] = (len     ) & 0xFF;
     pos = 4;
   }
-  if(header.param.bit.LEN == 127) {
-    //memcpy(&out[2],&len,8);
+  else {
+    header.param.bit.LEN = 127;
     out[2] = (len >> 56) & 0xFF;
     out[3] = (len >> 48) & 0xFF;
     out[4] = (len >> 40) & 0xFF;
@@ -141,56 +223,239 @@ int ws_send(ws_client_t* client,WEBSOCKET_OPCODES_t opcode,char* msg,uint64_t le
     out[9] = (len)       & 0xFF;
     pos = 10;
   }
+  out[0] = header.param.pos.ZERO; // save header
+  out[1] = header.param.pos.ONE;
+  return pos;
+}
 
-  if(mask) {
-    out[pos] = header.key.part[0]; pos++;
-    out[pos] = header.key.part[1]; pos++;
-    out[pos] = header.key.part[2]; pos++;
-    out[pos] = header.key.part[3]; pos++;
-    memcpy(&out[pos],encrypt,len); // put in the encrypted message
-    free(encrypt);
+int ws_fill_client_header(const ws_client_t* client,char* out,WEBSOCKET_OPCODES_t opcode,uint64_t len,bool fin) {
+  if(!client->raw) return ws_fill_fragment_header(out,opcode,len,fin);
+  out[0] = (fin ? 0x80 : 0) | opcode;
+  out[1] = (len >> 24) & 0xFF;
+  out[2] = (len >> 16) & 0xFF;
+  out[3] = (len >> 8)  & 0xFF;
+  out[4] = (len)       & 0xFF;
+  return WS_RAW_HEADER_LEN;
+}
+
+// takes the client's write lock, if it has one, so frames sent from different tasks
+// don't interleave
+void ws_lock_write(ws_client_t* client) {
+  if(client->write_lock) xSemaphoreTake(client->write_lock,portMAX_DELAY);
+}
+
+// gives the client's write lock back, first sending the control frames left while it
+// was held. one left as the lock is given is sent here unless the task that left it
+// has taken the lock to send it itself
+void ws_unlock_write(ws_client_t* client) {
+  if(!client->write_lock) return;
+  (void) ws_send_control_pending(client);
+  xSemaphoreGive(client->write_lock);
+  if((client->ctrl_ping.pending || client->ctrl_pong.pending) && xSemaphoreTake(client->write_lock,0) == pdTRUE) {
+    (void) ws_send_control_pending(client);
+    xSemaphoreGive(client->write_lock);
   }
-  else {
-    memcpy(&out[pos],msg,len);
+}
+
+#if WEBSOCKET_SERVER_DEFLATE
+// sends msg compressed as one frame if that makes it shorter, setting err. returns
+// false, having sent nothing, if it doesn't
+static bool ws_send_deflated(ws_client_t* client,WEBSOCKET_OPCODES_t opcode,const char* msg,uint64_t len,int* err) {
+  char out[10];
+  struct netvector vectors[2];
+  uint16_t* table;
+  uint8_t* z;
+  size_t zlen;
+
+  table = malloc(WS_DEFLATE_TABLE_LEN * sizeof(uint16_t) + len);
+  if(!table) return 0;
+  z = (uint8_t*)&table[WS_DEFLATE_TABLE_LEN];
+  zlen = ws_deflate((const uint8_t*)msg,len,z,len,table);
+  if(zlen) {
+    zlen -= WS_DEFLATE_TAIL_LEN; // the browser puts it back
+    vectors[0].ptr = out;
+    vectors[0].len = ws_fill_header(out,opcode,zlen);
+    out[0] |= WS_HEADER_COMPRESSED;
+    vectors[1].ptr = z;
+    vectors[1].len = zlen;
+    *err = ws_write_vectors(client,vectors,2,NETCONN_COPY);
+  }
+  free(table);
+  return zlen != 0;
+}
+#endif
+
+static int ws_send_locked(ws_client_t* client,WEBSOCKET_OPCODES_t opcode,char* msg,uint64_t len,bool mask) {
+  char out[14]; // largest header plus the masking key
+  char chunk[64];
+  struct netvector vectors[2];
+  ws_header_t header;
+  int pos;
+  int ret;
+
+#if WEBSOCKET_SERVER_DEFLATE
+  if(!mask && client->deflate && len >= WS_DEFLATE_MIN_LEN &&
+     (opcode == WEBSOCKET_OPCODE_TEXT || opcode == WEBSOCKET_OPCODE_BIN) &&
+     ws_send_deflated(client,opcode,msg,len,&ret)) {
+    return ret;
+  }
+#endif
+
+  pos = ws_fill_client_header(client,out,opcode,len,true);
+
+  if(!mask || client->raw) {
+    // have lwip copy the header and message straight into its buffers
+    vectors[0].ptr = out;
+    vectors[0].len = pos;
+    vectors[1].ptr = msg;
+    vectors[1].len = len;
+    return ws_write_vectors(client,vectors,len ? 2 : 1,NETCONN_COPY);
   }
 
-  ret = netconn_write(client->conn,out,true_len,NETCONN_COPY); // finally! send it.
-  free(out); // free the entire message
+  ws_generate_mask(&header); // get a key
+  out[1] |= 0x80; // set the MASK bit
+  out[pos] = header.key.part[0]; pos++;
+  out[pos] = header.key.part[1]; pos++;
+  out[pos] = header.key.part[2]; pos++;
+  out[pos] = header.key.part[3]; pos++;
+  ret = ws_write(client,out,pos,NETCONN_COPY | (len ? NETCONN_MORE : 0));
+
+  // encrypt the message a piece at a time (the chunk size is a multiple of the key size)
+  for(uint64_t i=0; (ret == ERR_OK) && (i<len); i+=sizeof(chunk)) {
+    uint64_t n = ((len - i) < sizeof(chunk)) ? (len - i) : sizeof(chunk);
+    for(uint64_t j=0; j<n; j++) {
+      chunk[j] = msg[i+j] ^ header.key.part[j%4];
+    }
+    ret = ws_write(client,chunk,n,NETCONN_COPY | ((i+n < len) ? NETCONN_MORE : 0));
+  }
   return ret;
 }
 
-char* ws_read(ws_client_t* client,ws_header_t* header) {
-  char* ret;
-  char* append;
-  err_t err;
-  struct netbuf* inbuf;
-  struct netbuf* inbuf2;
-  char* buf;
-  char* buf2;
-  uint16_t len;
-  uint16_t len2;
-  uint64_t pos;
-  uint64_t cont_len;
-  uint64_t cont_pos;
-
-  // if we read from this previously (not cont frames), stop reading
-  if(client->unfinished) {
-    client->unfinished--;
-    return NULL;
+int ws_send(ws_client_t* client,WEBSOCKET_OPCODES_t opcode,char* msg,uint64_t len,bool mask) {
+  int ret;
+
+  ws_lock_write(client);
+  ret = ws_send_locked(client,opcode,msg,len,mask);
+  ws_unlock_write(client);
+  return ret;
+}
+
+// leaves the control frame for the write lock's holder, or sends it at once if the lock
+// is free. a frame still waiting from before keeps its place
+int ws_send_control(ws_client_t* client,WEBSOCKET_OPCODES_t opcode,const char* msg,uint64_t len) {
+  ws_control_t* ctrl = (opcode == WEBSOCKET_OPCODE_PING) ? &client->ctrl_ping : &client->ctrl_pong;
+
+  if(!client->write_lock) return ws_send(client,opcode,(char*) msg,len,0);
+  if(ctrl->pending) return ERR_OK;
+  if(len > WS_CONTROL_MAX_LEN) len = WS_CONTROL_MAX_LEN;
+  if(len) memcpy(ctrl->msg,msg,len);
+  ctrl->len = len;
+  __sync_synchronize();
+  ctrl->pending = true;
+
+  // whoever holds the lock sends it when giving it back
+  if(xSemaphoreTake(client->write_lock,0) == pdTRUE) ws_unlock_write(client);
+  return ERR_OK;
+}
+
+// sends the waiting control frames, each only marked sent once written so it isn't
+// replaced while it goes
+int ws_send_control_pending(ws_client_t* client) {
+  int ret = ERR_OK;
+
+  if(!client->conn) { // gone while they waited
+    client->ctrl_pong.pending = false;
+    client->ctrl_ping.pending = false;
+    return ERR_CLSD;
+  }
+  if(client->ctrl_pong.pending) {
+    ret = ws_send_locked(client,WEBSOCKET_OPCODE_PONG,client->ctrl_pong.msg,client->ctrl_pong.len,0);
+    __sync_synchronize();
+    client->ctrl_pong.pending = false;
+  }
+  if(ret == ERR_OK && client->ctrl_ping.pending) {
+    ret = ws_send_locked(client,WEBSOCKET_OPCODE_PING,client->ctrl_ping.msg,client->ctrl_ping.len,0);
+    __sync_synchronize();
+    client->ctrl_ping.pending = false;
   }
+  return ret;
+}
 
-  err = netconn_recv(client->conn,&inbuf);
-  if(err != ERR_OK) return NULL;
-  netbuf_data(inbuf,(void**)&buf, &len);
-  if(!buf) return NULL;
+int ws_send_vectored(ws_client_t* client,WEBSOCKET_OPCODES_t opcode,struct netvector* vectors,uint16_t vectorcnt) {
+  char header[10];
+  uint64_t len = 0;
+  int ret;
+
+  for(uint16_t i=0;i<vectorcnt;i++) {
+    len += vectors[i].len;
+  }
+
+  // the header is small and lives on the stack so it gets copied, the payload doesn't
+  ws_lock_write(client);
+  ret = ws_write(client,header,ws_fill_client_header(client,header,opcode,len,true),NETCONN_COPY | NETCONN_MORE);
+  if(ret == ERR_OK) ret = ws_write_vectors(client,vectors,vectorcnt,NETCONN_NOCOPY);
+  ws_unlock_write(client);
+  return ret;
+}
+
+// makes sure there are bytes to parse, taking the next piece of the client's stream once
+// the last is used up: the next buffer of the segment's chain, a segment left by a
+// receive event or, for a TLS client, the plaintext of a record that has all arrived.
+// returns false instead of waiting when there's nothing more yet
+static bool ws_rx_data(ws_client_t* client) {
+  if(client->rx_data_len) return 1;
+  if(client->rx_in) {
+    if(netbuf_next(client->rx_in) >= 0) {
+      netbuf_data(client->rx_in,(void**)&client->rx_data,&client->rx_data_len);
+      return 1;
+    }
+    netbuf_delete(client->rx_in);
+    client->rx_in = NULL;
+  }
+#if WEBSOCKET_SERVER_TLS
+  if(client->tls) {
+    if(ws_tls_read(client->tls,&client->rx_data,&client->rx_data_len) == ERR_OK) return 1;
+    client->rx_ready = 0;
+    return 0;
+  }
+#endif
+  if(!client->rx_ready) return 0;
+  client->rx_ready--;
+  if(netconn_recv(client->conn,&client->rx_in) != ERR_OK) {
+    client->rx_in = NULL;
+    client->rx_ready = 0;
+    return 0;
+  }
+  netbuf_data(client->rx_in,(void**)&client->rx_data,&client->rx_data_len);
+  return 1;
+}
+
+// the length of the frame header that starts with the two bytes collected
+static uint8_t ws_header_len(const ws_client_t* client) {
+  uint8_t len = 2;
+
+  if(client->raw) return WS_RAW_HEADER_LEN;
+  if((client->rx_hdr[1] & 0x7f) == 126) len = 4;
+  else if((client->rx_hdr[1] & 0x7f) == 127) len = 10;
+  if(client->rx_hdr[1] & 0x80) len += 4; // the mask
+  return len;
+}
+
+// decodes the collected frame header into rx_header
+static void ws_parse_header(ws_client_t* client) {
+  ws_header_t* header = &client->rx_header;
+  const uint8_t* buf = client->rx_hdr;
+  uint8_t pos = 2;
 
-  // get the header
   header->param.pos.ZERO = buf[0];
   header->param.pos.ONE  = buf[1];
-
-  // get the message length
-  pos = 2;
-  if(header->param.bit.LEN <= 125) {
+  if(client->raw) { // no length field or mask in the websocket header, a 32 bit length
+    header->param.pos.ONE = 0;
+    header->length = (uint32_t)buf[1] << 24 | (uint32_t)buf[2] << 16
+                   | (uint32_t)buf[3] << 8  | (uint32_t)buf[4];
+    pos = WS_RAW_HEADER_LEN;
+  }
+  else if(header->param.bit.LEN <= 125) {
     header->length = header->param.bit.LEN;
   }
   else if(header->param.bit.LEN == 126) {
@@ -204,118 +469,339 @@ char* ws_read(ws_client_t* client,ws_header_t* header) {
                    | (uint64_t)buf[8] << 8  | (uint64_t)buf[9];
     pos = 10;
   }
+  if(header->param.bit.MASK) memcpy(&(header->key.full),&buf[pos],4); // extract the key
+}
 
-  if(header->param.bit.MASK) {
-    memcpy(&(header->key.full),&buf[pos],4); // extract the key
-    pos += 4;
+#if WEBSOCKET_SERVER_DEFLATE
+// swaps a message compressed with permessage-deflate for its inflated copy, releasing
+// the compressed one. returns NULL if the client didn't negotiate compression or the
+// message doesn't inflate to at most WS_INFLATE_MAX_LEN bytes
+static char* ws_inflate_message(ws_client_t* client,ws_header_t* header,char* msg) {
+  char* out = NULL;
+  size_t len;
+
+  if(client->deflate) out = malloc(WS_INFLATE_MAX_LEN + 1);
+  if(out && !ws_inflate((const uint8_t*)msg,header->length,(uint8_t*)out,WS_INFLATE_MAX_LEN,&len)) {
+    free(out);
+    out = NULL;
   }
-
-  ret = malloc(header->length+1); // allocate memory, plus a byte
-  if(!ret) {
-    netbuf_delete(inbuf);
+  ws_read_done(client,msg);
+  if(!out) {
     header->received = 0;
     return NULL;
   }
+  out[len] = '\0';
+  header->length = len;
+  return out;
+}
+#endif
+
+// releases a message read in place, giving back the byte it was terminated over. its
+// segment is released once it is used up, or now if the client has disconnected
+static void ws_release_held(ws_client_t* client) {
+  if(!client->rx_held) return;
+  client->rx_held = 0;
+  if(client->rx_data_len) {
+    client->rx_data[0] = client->rx_saved;
+  }
+  else if(!client->conn && client->rx_in) {
+    netbuf_delete(client->rx_in);
+    client->rx_in = NULL;
+  }
+}
 
-  cont_len = len-pos; // get the actual length
-  memcpy(ret,&buf[pos],header->length); // allocate the total memory
-  cont_pos = cont_len; // get the initial position
-  // netconn gives messages in pieces, so we need to get those (different than OPCODE_CONT)
-  while(cont_len < header->length) { // while the actual length is less than the header stated
-    err = netconn_recv(client->conn,&inbuf2);
-    if(err != ERR_OK) {
-      netbuf_delete(inbuf2);
-      free(ret);
-      client->unfinished = 0;
-      header->received = 0;
-      return NULL;
+// takes a frame whose payload has been collected into msg. returns the message it ends,
+// populating header, or NULL for a fragment kept until the rest arrive or a message
+// dropped. a control frame may come between the fragments of a message
+static char* ws_complete_frame(ws_client_t* client,ws_header_t* header,char* msg) {
+  ws_header_t* frame = &client->rx_header;
+  uint8_t opcode = frame->param.bit.OPCODE;
+  char* contin;
+
+  msg[frame->length] = '\0'; // end string
+  ws_encrypt_decrypt(msg,*frame); // unencrypt, if necessary
+  *header = *frame;
+
+  if(opcode == WEBSOCKET_OPCODE_CONT) {
+    // append the fragment, dropping the message if there's no memory for it
+    contin = client->contin ? realloc(client->contin,client->len + frame->length + 1) : NULL;
+    if(contin) {
+      memcpy(&contin[client->len],msg,frame->length);
+      client->contin = contin;
+      client->len += frame->length;
     }
-    netbuf_data(inbuf2,(void**)&buf2, &len2);
-    // Prevent catastrophic failure due to memory leakage
-    if(cont_len + len2 > header->length) {
-      netbuf_delete(inbuf2);
-      free(ret);
-      client->unfinished = 0;
-      header->received = 0;
-      return NULL;
-    }
-    memcpy(&ret[cont_pos],buf2,len2);
-    cont_pos += len2;
-    if(!buf2) {
-      client->unfinished = 0;
-      header->received = 0;
+    else if(client->contin) {
+      free(client->contin);
+      client->contin = NULL;
+      client->len = 0;
     }
-    netbuf_delete(inbuf2);
-    client->unfinished++;
-    cont_len += len2;
-  }
-
-  ret[header->length] = '\0'; // end string
-  ws_encrypt_decrypt(ret,*header); // unencrypt, if necessary
-
-  if(header->param.bit.FIN == 0) { // if the message isn't done
-    if((header->param.bit.OPCODE == WEBSOCKET_OPCODE_CONT) &&
-       ((client->last_opcode==WEBSOCKET_OPCODE_BIN) || (client->last_opcode==WEBSOCKET_OPCODE_TEXT))) {
-         cont_len = header->length + client->len;
-         append = malloc(cont_len);
-         memcpy(append,client->contin,client->len);
-         memcpy(&append[client->len],ret,header->length);
-         free(client->contin);
-         client->contin = malloc(cont_len);
-         client->len = cont_len;
-
-         free(append);
-         free(ret);
-         netbuf_delete(inbuf);
-         //free(buf);
-         return NULL;
+    ws_read_done(client,msg);
+    if(!contin || !frame->param.bit.FIN) return NULL;
+
+    // hand back the whole message, with the first fragment's opcode and flags
+    msg = contin;
+    msg[client->len] = '\0';
+    header->param.pos.ZERO = client->contin_first | 0x80;
+    header->length = client->len;
+    client->contin = NULL;
+    client->len = 0;
+  }
+  else if(!frame->param.bit.FIN) {
+    // the first fragment of a message, which replaces any left unfinished
+    if(client->contin) free(client->contin);
+    client->contin = malloc(frame->length + 1);
+    client->len = 0;
+    if(client->contin) {
+      memcpy(client->contin,msg,frame->length);
+      client->len = frame->length;
+      client->contin_first = frame->param.pos.ZERO;
     }
-    else if((header->param.bit.OPCODE==WEBSOCKET_OPCODE_BIN) || (header->param.bit.OPCODE==WEBSOCKET_OPCODE_TEXT)) {
-      if(client->len) {
-        free(client->contin);
+    ws_read_done(client,msg);
+    return NULL;
+  }
+
+  client->last_opcode = header->param.bit.OPCODE;
+  header->received = 1;
+#if WEBSOCKET_SERVER_DEFLATE
+  if(header->param.pos.ZERO & WS_HEADER_COMPRESSED) return ws_inflate_message(client,header,msg);
+#endif
+  return msg;
+}
+
+char* ws_read(ws_client_t* client,ws_header_t* header) {
+  ws_header_t* frame = &client->rx_header;
+  uint64_t n;
+  char* msg;
+
+  // release a message read in place last time if the caller didn't
+  ws_release_held(client);
+  header->received = 0;
+
+  for(;;) {
+    // collect the header, which tells how much more of it there is after two bytes
+    if(client->rx_hdr_len < 2 || client->rx_hdr_len < ws_header_len(client)) {
+      if(!ws_rx_data(client)) return NULL;
+      n = ((client->rx_hdr_len < 2) ? 2 : ws_header_len(client)) - client->rx_hdr_len;
+      if(n > client->rx_data_len) n = client->rx_data_len;
+      memcpy(&client->rx_hdr[client->rx_hdr_len],client->rx_data,n);
+      client->rx_hdr_len += n;
+      client->rx_data += n;
+      client->rx_data_len -= n;
+      if(client->rx_hdr_len < 2 || client->rx_hdr_len < ws_header_len(client)) continue;
+      ws_parse_header(client);
+      client->rx_pos = 0;
+
+      // a payload that is all there with room after it for the terminator is unmasked
+      // in place and handed back from inside the segment, which is kept until
+      // ws_read_done(). a record's plaintext always has that room
+      if(frame->length < client->rx_data_len || (!client->rx_in && frame->length == client->rx_data_len)) {
+        msg = client->rx_data;
+        if(frame->length < client->rx_data_len) client->rx_saved = msg[frame->length];
+        client->rx_data += frame->length;
+        client->rx_data_len -= frame->length;
+        client->rx_hdr_len = 0;
+        client->rx_held = 1;
+        msg = ws_complete_frame(client,header,msg);
+        if(msg) return msg;
+        continue;
+      }
+
+      // otherwise use the client's receive buffer if the message fits. a payload there
+      // isn't memory for is skipped
+      if(client->rx_buf && (frame->length < client->rx_buf_len)) {
+        client->rx_msg = client->rx_buf;
+      }
+      else {
+        client->rx_msg = (frame->length < SIZE_MAX) ? malloc(frame->length+1) : NULL; // allocate memory, plus a byte
       }
-      client->contin = malloc(header->length);
-      memcpy(client->contin,ret,header->length);
-      client->len = header->length;
-      client->last_opcode = header->param.bit.OPCODE;
-
-      free(ret);
-      netbuf_delete(inbuf);
-      //free(buf);
-      return NULL;
     }
-    else { // there shouldn't be another FIN code....
-      free(ret);
-      netbuf_delete(inbuf);
-      //free(buf);
-      return NULL;
+
+    // collect the payload from as many segments as it came in
+    if(client->rx_pos < frame->length) {
+      if(!ws_rx_data(client)) return NULL;
+      n = frame->length - client->rx_pos;
+      if(n > client->rx_data_len) n = client->rx_data_len;
+      if(client->rx_msg) memcpy(&client->rx_msg[client->rx_pos],client->rx_data,n);
+      client->rx_pos += n;
+      client->rx_data += n;
+      client->rx_data_len -= n;
+      if(client->rx_pos < frame->length) continue;
     }
+
+    msg = client->rx_msg;
+    client->rx_msg = NULL;
+    client->rx_hdr_len = 0;
+    if(!msg) continue;
+    msg = ws_complete_frame(client,header,msg);
+    if(msg) return msg;
+  }
+}
+
+void ws_read_done(ws_client_t* client,char* msg) {
+  if(!msg) return;
+  if(client->rx_held) {
+    ws_release_held(client);
+  }
+  else {
+    ws_free_rx(client,msg);
   }
-  client->last_opcode = header->param.bit.OPCODE;
-  if(inbuf) netbuf_delete(inbuf);
-  header->received = 1;
-  return ret;
 }
 
-char* ws_hash_handshake(char* handshake,uint8_t len) {
-  const char hash[] = "258EAFA5-E914-47DA-95CA-C5AB0DC85B11";
-  const uint8_t hash_len = sizeof(hash);
-  char* ret;
-  char key[64];
+bool ws_hash_handshake(const char* key,uint16_t len,char accept[WS_ACCEPT_LEN + 1]) {
+  const char guid[] = "258EAFA5-E914-47DA-95CA-C5AB0DC85B11";
+  unsigned char buf[WS_KEY_MAX_LEN + sizeof(guid) - 1];
   unsigned char sha1sum[20];
-  unsigned int ret_len;
+  size_t ret_len;
 
-  if(!len) return NULL;
-  ret = malloc(32);
+  if(!len || len > WS_KEY_MAX_LEN) return 0;
 
-  memcpy(key,handshake,len);
-  strlcpy(&key[len],hash,sizeof(key));
-  mbedtls_sha1((unsigned char*)key,len+hash_len-1,sha1sum);
-  mbedtls_base64_encode(NULL, 0, &ret_len, sha1sum, 20);
-  if(!mbedtls_base64_encode((unsigned char*)ret,32,&ret_len,sha1sum,20)) {
-    ret[ret_len] = '\0';
-    return ret;
+  memcpy(buf,key,len);
+  memcpy(&buf[len],guid,sizeof(guid) - 1);
+  esp_sha(SHA1,buf,len + sizeof(guid) - 1,sha1sum);
+  if(mbedtls_base64_encode((unsigned char*)accept,WS_ACCEPT_LEN + 1,&ret_len,sha1sum,20)) return 0;
+  accept[ret_len] = '\0';
+  return 1;
+}
+
+// true if the name of a header line, name_len bytes long, is name in any case
+static bool header_is(const char* line,uint16_t name_len,const char* name) {
+  return (strlen(name) == name_len) && !strncasecmp(line,name,name_len);
+}
+
+// true if the first len bytes of s, less any spaces around them, are word in any case
+static bool token_is(const char* s,int len,const char* word) {
+  while(len && (*s == ' ' || *s == '\t')) {
+    s++;
+    len--;
   }
-  free(ret);
-  return NULL;
+  while(len && (s[len - 1] == ' ' || s[len - 1] == '\t')) len--;
+  return (strlen(word) == len) && !strncasecmp(s,word,len);
+}
+
+// looks through the offers in a Sec-WebSocket-Extensions value for a permessage-deflate
+// one the server can accept, with no parameter it doesn't know and a window no smaller
+// than the server's
+static void parse_extensions(const char* value,uint16_t len,ws_request_t* req) {
+  const char* end = value + len;
+  const char* offer_end;
+  const char* param_end;
+  const char* eq;
+  const char* p;
+  bool ok;
+  bool bits;
+  int n;
+
+  for(p = value; p < end && !req->deflate; p = offer_end + 1) {
+    offer_end = memchr(p,',',end - p);
+    if(!offer_end) offer_end = end;
+    param_end = memchr(p,';',offer_end - p);
+    if(!param_end) param_end = offer_end;
+    if(!token_is(p,param_end - p,"permessage-deflate")) continue;
+
+    ok = 1;
+    bits = 0;
+    for(p = param_end + 1; ok && p < offer_end; p = param_end + 1) {
+      param_end = memchr(p,';',offer_end - p);
+      if(!param_end) param_end = offer_end;
+      eq = memchr(p,'=',param_end - p);
+      if(token_is(p,(eq ? eq : param_end) - p,"server_max_window_bits")) {
+        n = 0;
+        for(eq = eq ? eq + 1 : param_end; eq < param_end; eq++) {
+          if(*eq >= '0' && *eq <= '9') n = n * 10 + (*eq - '0');
+        }
+        ok = (n >= WS_DEFLATE_WINDOW_BITS) && (n <= 15);
+        bits = 1;
+      }
+      else {
+        ok = token_is(p,(eq ? eq : param_end) - p,"client_max_window_bits") ||
+             token_is(p,param_end - p,"server_no_context_takeover") ||
+             token_is(p,param_end - p,"client_no_context_takeover");
+      }
+    }
+    req->deflate = ok;
+    req->deflate_bits = bits;
+  }
+}
+
+bool ws_parse_request(const char* buf,uint16_t len,ws_request_t* req) {
+  const char* end = buf + len;
+  const char* p;
+  const char* eol;
+  const char* sp;
+  const char* value;
+  uint16_t line_len;
+  uint16_t name_len;
+  uint16_t value_len;
+
+  memset(req,0,sizeof(ws_request_t));
+
+  // the request line is the method, the path and the version, separated by spaces
+  eol = memchr(buf,'\n',len);
+  if(!eol) return 0;
+  sp = memchr(buf,' ',eol - buf);
+  if(!sp) return 0;
+  req->method = buf;
+  req->method_len = sp - buf;
+  p = sp + 1;
+  sp = memchr(p,' ',eol - p);
+  if(!sp) return 0;
+  req->path = p;
+  req->path_len = sp - p;
+
+  // then a header per line up to an empty one
+  for(p = eol + 1; p < end; p = eol + 1) {
+    eol = memchr(p,'\n',end - p);
+    if(!eol) break;
+    line_len = eol - p;
+    if(line_len && p[line_len - 1] == '\r') line_len--;
+    if(!line_len) {
+      req->body = eol + 1;
+      break;
+    }
+    sp = memchr(p,':',line_len);
+    if(!sp) continue;
+    name_len = sp - p;
+    value = sp + 1;
+    while(value < p + line_len && (*value == ' ' || *value == '\t')) value++;
+    value_len = p + line_len - value;
+    while(value_len && (value[value_len - 1] == ' ' || value[value_len - 1] == '\t')) value_len--;
+
+    if(header_is(p,name_len,"Upgrade")) {
+      req->upgrade = (value_len == 9) && !strncasecmp(value,"websocket",9);
+    }
+    else if(header_is(p,name_len,"Sec-WebSocket-Key")) {
+      req->key = value;
+      req->key_len = value_len;
+    }
+    else if(header_is(p,name_len,"Sec-WebSocket-Extensions")) {
+      parse_extensions(value,value_len,req);
+    }
+    else if(header_is(p,name_len,"If-None-Match")) {
+      req->etag = value;
+      req->etag_len = value_len;
+    }
+    else if(header_is(p,name_len,"Range")) {
+      req->range = value;
+      req->range_len = value_len;
+    }
+    else if(header_is(p,name_len,"Content-Length")) {
+      req->content_len = 0;
+      for(int i=0;i<value_len && value[i] >= '0' && value[i] <= '9';i++) {
+        req->content_len = req->content_len * 10 + (value[i] - '0');
+      }
+    }
+  }
+  return 1;
+}
+
+uint16_t ws_request_path_len(const ws_request_t* req) {
+  const char* query = memchr(req->path,'?',req->path_len);
+
+  return query ? query - req->path : req->path_len;
+}
+
+bool ws_request_path_is(const ws_request_t* req,const char* path) {
+  uint16_t len = ws_request_path_len(req);
+
+  return (strlen(path) == len) && !memcmp(req->path,path,len);
 }
@@ -0,0 +1,352 @@
+
+/*
+esp32-websocket - a websocket component on esp-idf
+Copyright (C) 2019 Blake Felt - blake.w.felt@gmail.com
+
+This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "websocket_deflate.h"
+#include <string.h>
+
+#if WEBSOCKET_SERVER_DEFLATE
+
+#define MIN_MATCH 3
+#define MAX_MATCH 258
+
+// the length codes from 257 and the distance codes, as the first value each stands for
+// and the extra bits that follow it
+static const uint16_t len_base[29] = {
+  3,4,5,6,7,8,9,10,11,13,15,17,19,23,27,31,35,43,51,59,67,83,99,115,131,163,195,227,258
+};
+static const uint8_t len_extra[29] = {
+  0,0,0,0,0,0,0,0,1,1,1,1,2,2,2,2,3,3,3,3,4,4,4,4,5,5,5,5,0
+};
+static const uint16_t dist_base[30] = {
+  1,2,3,4,5,7,9,13,17,25,33,49,65,97,129,193,257,385,513,769,1025,1537,2049,3073,
+  4097,6145,8193,12289,16385,24577
+};
+static const uint8_t dist_extra[30] = {
+  0,0,0,0,1,1,2,2,3,3,4,4,5,5,6,6,7,7,8,8,9,9,10,10,11,11,12,12,13,13
+};
+
+typedef struct {
+  uint8_t* dst;
+  size_t len;
+  size_t pos; // carries on counting past len, which then failed
+  uint32_t bits;
+  int nbits;
+} bit_writer_t;
+
+typedef struct {
+  const uint8_t* src;
+  size_t len;
+  size_t pos;
+  uint32_t bits;
+  int nbits;
+  bool bad; // set on reading past the tail
+} bit_reader_t;
+
+// a canonical huffman code, as the number of codes of each length and the symbols in
+// code order
+typedef struct {
+  uint16_t count[16];
+  uint16_t symbol[288];
+} huffman_t;
+
+static void put_bits(bit_writer_t* w,uint32_t value,int n) {
+  w->bits |= value << w->nbits;
+  w->nbits += n;
+  while(w->nbits >= 8) {
+    if(w->pos < w->len) w->dst[w->pos] = w->bits;
+    w->pos++;
+    w->bits >>= 8;
+    w->nbits -= 8;
+  }
+}
+
+// huffman codes go out from their most significant bit
+static void put_code(bit_writer_t* w,uint32_t code,int n) {
+  uint32_t reversed = 0;
+
+  for(int i=0;i<n;i++) {
+    reversed = (reversed << 1) | (code & 1);
+    code >>= 1;
+  }
+  put_bits(w,reversed,n);
+}
+
+// writes a literal/length symbol in the fixed code
+static void put_symbol(bit_writer_t* w,int sym) {
+  if(sym < 144) put_code(w,0x30 + sym,8);
+  else if(sym < 256) put_code(w,0x190 + sym - 144,9);
+  else if(sym < 280) put_code(w,sym - 256,7);
+  else put_code(w,0xc0 + sym - 280,8);
+}
+
+// returns the code whose base is the largest not above value
+static int find_code(const uint16_t* base,int n,uint32_t value) {
+  int i = n - 1;
+
+  while(base[i] > value) i--;
+  return i;
+}
+
+static uint32_t hash3(const uint8_t* p) {
+  return (((uint32_t)p[0] << 16 | p[1] << 8 | p[2]) * 2654435761u >> 16) & (WS_DEFLATE_TABLE_LEN - 1);
+}
+
+// one block of the fixed code, greedily taking the match at the last position with the
+// same hash. the table holds positions modulo 65536, which is fine as any match found
+// is checked byte by byte
+size_t ws_deflate(const uint8_t* src,size_t len,uint8_t* dst,size_t dst_len,uint16_t* table) {
+  bit_writer_t w = {dst,dst_len,0,0,0};
+  size_t i = 0;
+  size_t best;
+  size_t max;
+  size_t dist;
+  uint32_t h;
+  int code;
+
+  memset(table,0,WS_DEFLATE_TABLE_LEN * sizeof(uint16_t));
+  put_bits(&w,2,3); // not the last block, fixed code
+
+  while(i < len) {
+    best = 0;
+    dist = 0;
+    if(len - i >= MIN_MATCH) {
+      h = hash3(&src[i]);
+      dist = (uint16_t)(i - table[h]);
+      table[h] = i;
+      if(dist && dist <= i && dist <= (1 << WS_DEFLATE_WINDOW_BITS)) {
+        max = (len - i < MAX_MATCH) ? len - i : MAX_MATCH;
+        while(best < max && src[i + best] == src[i + best - dist]) best++;
+      }
+    }
+    if(best >= MIN_MATCH) {
+      code = find_code(len_base,29,best);
+      put_symbol(&w,257 + code);
+      put_bits(&w,best - len_base[code],len_extra[code]);
+      code = find_code(dist_base,30,dist);
+      put_code(&w,code,5);
+      put_bits(&w,dist - dist_base[code],dist_extra[code]);
+      // later data can match from inside this one too
+      for(size_t j=i+1;j<i+best && len-j>=MIN_MATCH;j++) table[hash3(&src[j])] = j;
+      i += best;
+    }
+    else {
+      put_symbol(&w,src[i]);
+      i++;
+    }
+    if(w.pos > dst_len) return 0;
+  }
+  put_symbol(&w,256); // end of block
+
+  // sync flush, an empty stored block from the next byte
+  put_bits(&w,0,3);
+  if(w.nbits) put_bits(&w,0,8 - w.nbits);
+  put_bits(&w,0x0000,16);
+  put_bits(&w,0xffff,16);
+  return (w.pos > dst_len) ? 0 : w.pos;
+}
+
+// returns the message's next byte, then those of the sync flush tail taken off it
+static uint32_t next_byte(bit_reader_t* r) {
+  static const uint8_t tail[WS_DEFLATE_TAIL_LEN] = {0x00,0x00,0xff,0xff};
+
+  if(r->pos < r->len) return r->src[r->pos++];
+  if(r->pos < r->len + WS_DEFLATE_TAIL_LEN) return tail[r->pos++ - r->len];
+  r->bad = 1;
+  return 0;
+}
+
+static uint32_t get_bits(bit_reader_t* r,int n) {
+  uint32_t value;
+
+  while(r->nbits < n) {
+    r->bits |= next_byte(r) << r->nbits;
+    r->nbits += 8;
+  }
+  value = r->bits & ((1u << n) - 1);
+  r->bits >>= n;
+  r->nbits -= n;
+  return value;
+}
+
+// builds the code for n symbols from the lengths of their codes, 0 for unused ones.
+// returns false if there are more codes of some length than fit
+static bool build_code(huffman_t* h,const uint8_t* lengths,int n) {
+  uint16_t offs[16];
+  int left = 1;
+
+  memset(h->count,0,sizeof(h->count));
+  for(int i=0;i<n;i++) h->count[lengths[i]]++;
+  for(int len=1;len<16;len++) {
+    left = (left << 1) - h->count[len];
+    if(left < 0) return 0;
+  }
+  offs[1] = 0;
+  for(int len=1;len<15;len++) offs[len + 1] = offs[len] + h->count[len];
+  for(int i=0;i<n;i++) {
+    if(lengths[i]) h->symbol[offs[lengths[i]]++] = i;
+  }
+  return 1;
+}
+
+// returns the next symbol in code h, a bit at a time, or -1 for a code that isn't used
+static int decode(bit_reader_t* r,const huffman_t* h) {
+  int code = 0;
+  int first = 0;
+  int index = 0;
+
+  for(int len=1;len<16;len++) {
+    code |= get_bits(r,1);
+    if(code - h->count[len] < first) return h->symbol[index + code - first];
+    index += h->count[len];
+    first = (first + h->count[len]) << 1;
+    code <<= 1;
+  }
+  return -1;
+}
+
+// inflates the symbols of a block up to its end into dst from out
+static bool inflate_codes(bit_reader_t* r,const huffman_t* lens,const huffman_t* dists,uint8_t* dst,size_t dst_len,size_t* out) {
+  size_t len;
+  size_t dist;
+  int sym;
+
+  for(;;) {
+    sym = decode(r,lens);
+    if(sym < 0 || r->bad) return 0;
+    if(sym < 256) {
+      if(*out >= dst_len) return 0;
+      dst[(*out)++] = sym;
+    }
+    else if(sym == 256) {
+      return 1;
+    }
+    else {
+      sym -= 257;
+      if(sym >= 29) return 0;
+      len = len_base[sym] + get_bits(r,len_extra[sym]);
+      sym = decode(r,dists);
+      if(sym < 0 || sym >= 30) return 0;
+      dist = dist_base[sym] + get_bits(r,dist_extra[sym]);
+      if(r->bad || dist > *out || len > dst_len - *out) return 0;
+      for(;len;len--,(*out)++) dst[*out] = dst[*out - dist];
+    }
+  }
+}
+
+static bool inflate_stored(bit_reader_t* r,uint8_t* dst,size_t dst_len,size_t* out) {
+  uint32_t len;
+  uint32_t nlen;
+
+  r->bits = 0; // the rest of the byte is padding
+  r->nbits = 0;
+  len = next_byte(r);
+  len |= next_byte(r) << 8;
+  nlen = next_byte(r);
+  nlen |= next_byte(r) << 8;
+  if(r->bad || len != (~nlen & 0xffff) || len > dst_len - *out) return 0;
+  while(len--) dst[(*out)++] = next_byte(r);
+  return !r->bad;
+}
+
+static bool inflate_fixed(bit_reader_t* r,huffman_t* lens,huffman_t* dists,uint8_t* dst,size_t dst_len,size_t* out) {
+  uint8_t lengths[288];
+  int i;
+
+  for(i=0;i<144;i++) lengths[i] = 8;
+  for(;i<256;i++) lengths[i] = 9;
+  for(;i<280;i++) lengths[i] = 7;
+  for(;i<288;i++) lengths[i] = 8;
+  build_code(lens,lengths,288);
+  for(i=0;i<30;i++) lengths[i] = 5;
+  build_code(dists,lengths,30);
+  return inflate_codes(r,lens,dists,dst,dst_len,out);
+}
+
+static bool inflate_dynamic(bit_reader_t* r,huffman_t* lens,huffman_t* dists,uint8_t* dst,size_t dst_len,size_t* out) {
+  static const uint8_t order[19] = {16,17,18,0,8,7,9,6,10,5,11,4,12,3,13,2,14,1,15};
+  uint8_t lengths[286 + 30];
+  int nlen;
+  int ndist;
+  int ncode;
+  int sym;
+  int i;
+  int repeat;
+  uint8_t len;
+
+  nlen = get_bits(r,5) + 257;
+  ndist = get_bits(r,5) + 1;
+  ncode = get_bits(r,4) + 4;
+  if(nlen > 286 || ndist > 30) return 0;
+
+  // the code lengths are themselves coded, and run length encoded
+  memset(lengths,0,19);
+  for(i=0;i<ncode;i++) lengths[order[i]] = get_bits(r,3);
+  if(!build_code(lens,lengths,19)) return 0;
+  for(i=0;i<nlen+ndist;) {
+    sym = decode(r,lens);
+    if(sym < 0 || r->bad) return 0;
+    if(sym < 16) {
+      lengths[i++] = sym;
+      continue;
+    }
+    len = 0;
+    if(sym == 16) {
+      if(!i) return 0;
+      len = lengths[i - 1];
+      repeat = 3 + get_bits(r,2);
+    }
+    else if(sym == 17) {
+      repeat = 3 + get_bits(r,3);
+    }
+    else {
+      repeat = 11 + get_bits(r,7);
+    }
+    if(i + repeat > nlen + ndist) return 0;
+    while(repeat--) lengths[i++] = len;
+  }
+  if(!lengths[256]) return 0; // no end of block
+  if(!build_code(lens,lengths,nlen) || !build_code(dists,&lengths[nlen],ndist)) return 0;
+  return inflate_codes(r,lens,dists,dst,dst_len,out);
+}
+
+// the message ends once all its bytes are used, the rest of the last one and the tail
+// being the empty stored block of the sync flush. a sender that ended with a whole sync
+// flush anyway is fine too
+bool ws_inflate(const uint8_t* src,size_t len,uint8_t* dst,size_t dst_len,size_t* out_len) {
+  bit_reader_t r = {src,len,0,0,0,0};
+  huffman_t lens;
+  huffman_t dists;
+  uint32_t last = 0;
+  bool ok;
+
+  *out_len = 0;
+  while(!last && r.pos < len) {
+    last = get_bits(&r,1);
+    switch(get_bits(&r,2)) {
+      case 0: ok = inflate_stored(&r,dst,dst_len,out_len); break;
+      case 1: ok = inflate_fixed(&r,&lens,&dists,dst,dst_len,out_len); break;
+      case 2: ok = inflate_dynamic(&r,&lens,&dists,dst,dst_len,out_len); break;
+      default: ok = 0; break;
+    }
+    if(!ok) return 0;
+  }
+  return 1;
+}
+
+#endif // if WEBSOCKET_SERVER_DEFLATE
@@ -18,21 +18,92 @@ This program is free software: you can redistribute it and/or modify
 */
 
 #include "websocket_server.h"
+#include "websocket_tls.h"
+#include "websocket_deflate.h"
+#include "lwip/tcp.h"
+#include "esp_attr.h"
+#include "esp_heap_caps.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/semphr.h"
 #include "freertos/task.h"
 #include "freertos/queue.h"
+#include <stdio.h>
 #include <string.h>
 
+#define CLIENT_WORDS ((WEBSOCKET_SERVER_MAX_CLIENTS + 31) / 32)
+#define DROP_WAIT_MS 200 // how long dropping a client waits for a write to it to give up
+
+// Locks are always taken in the order: a client's read lock, xwebsocket_mutex, then a
+// client's write lock.  The read lock is held while the server task reads from the
+// client, which can block, so only code that disconnects that particular client has
+// to wait for it.
 SemaphoreHandle_t xwebsocket_mutex; // to lock the client array
-static QueueHandle_t xwebsocket_queue; // to hold the clients that send messages
+static volatile uint32_t rx_events[WEBSOCKET_SERVER_MAX_CLIENTS]; // receive events waiting per client
+static volatile uint32_t rx_pending[CLIENT_WORDS]; // bit per client with receive events waiting
+static volatile uint32_t connected[CLIENT_WORDS]; // bit per client with a connection, changed with xwebsocket_mutex held
+static volatile int num_connected; // number of bits set in connected
+static volatile int max_connected = WEBSOCKET_SERVER_MAX_CLIENTS; // clients admitted at once
 ws_client_t clients[WEBSOCKET_SERVER_MAX_CLIENTS]; // holds list of clients
+#if WEBSOCKET_SERVER_RX_BUF_PSRAM
+static EXT_RAM_ATTR char rx_buffers[WEBSOCKET_SERVER_MAX_CLIENTS][WEBSOCKET_SERVER_RX_BUF_SIZE]; // per-client receive buffers
+#else
+static char rx_buffers[WEBSOCKET_SERVER_MAX_CLIENTS][WEBSOCKET_SERVER_RX_BUF_SIZE]; // per-client receive buffers
+#endif
+static SemaphoreHandle_t read_locks[WEBSOCKET_SERVER_MAX_CLIENTS]; // per-client read locks
+static SemaphoreHandle_t write_locks[WEBSOCKET_SERVER_MAX_CLIENTS]; // per-client frame write locks
 static TaskHandle_t xtask; // the task itself
 
+// returns the first connected client numbered num or above, or
+// WEBSOCKET_SERVER_MAX_CLIENTS if there's none, so loops over the clients only visit
+// those connected
+static int next_client(int num) {
+  int w = num / 32;
+  uint32_t bits;
+
+  if(num >= WEBSOCKET_SERVER_MAX_CLIENTS) return WEBSOCKET_SERVER_MAX_CLIENTS;
+  bits = connected[w] & (~0u << (num % 32));
+  while(!bits) {
+    if(++w >= CLIENT_WORDS) return WEBSOCKET_SERVER_MAX_CLIENTS;
+    bits = connected[w];
+  }
+  return w * 32 + __builtin_ctz(bits);
+}
+
+// returns the lowest numbered client without a connection, or -1 if all are in use
+static int free_client() {
+  uint32_t bits;
+
+  for(int w=0;w<CLIENT_WORDS;w++) {
+    bits = ~connected[w];
+    if((w == CLIENT_WORDS - 1) && (WEBSOCKET_SERVER_MAX_CLIENTS % 32))
+      bits &= (1u << (WEBSOCKET_SERVER_MAX_CLIENTS % 32)) - 1;
+    if(bits) return w * 32 + __builtin_ctz(bits);
+  }
+  return -1;
+}
+
+// disconnects a client and frees its number. xwebsocket_mutex must be held
+static void close_client(int num) {
+  ws_disconnect_client(&clients[num], 0);
+  if(connected[num / 32] & (1u << (num % 32))) {
+    connected[num / 32] &= ~(1u << (num % 32));
+    num_connected--;
+  }
+}
+
+// runs in the lwip thread. the connection's socket field (only used by the sockets
+// layer) holds its client number, so the event is counted for that client and the
+// server task notified without any lookup
 static void background_callback(struct netconn* conn, enum netconn_evt evt,u16_t len) {
+  int num;
+
   switch(evt) {
     case NETCONN_EVT_RCVPLUS:
-      xQueueSendToBack(xwebsocket_queue,&conn,WEBSOCKET_SERVER_QUEUE_TIMEOUT);
+      num = conn->socket;
+      if(num < 0 || num >= WEBSOCKET_SERVER_MAX_CLIENTS) break;
+      __sync_fetch_and_add(&rx_events[num],1);
+      __sync_fetch_and_or(&rx_pending[num / 32],1u << (num % 32));
+      xTaskNotifyGive(xtask);
       break;
     default:
       break;
@@ -47,10 +118,11 @@ static void handle_read(uint8_t num) {
   msg = ws_read(&clients[num],&header);
 
   if(!header.received) {
-    if(msg) free(msg);
+    ws_read_done(&clients[num],msg);
     return;
   }
 
+  xSemaphoreTake(xwebsocket_mutex,portMAX_DELAY); // callbacks run with access
   switch(clients[num].last_opcode) {
     case WEBSOCKET_OPCODE_CONT:
       break;
@@ -61,7 +133,7 @@ static void handle_read(uint8_t num) {
       clients[num].scallback(num,WEBSOCKET_TEXT,msg,header.length);
       break;
     case WEBSOCKET_OPCODE_PING:
-      ws_send(&clients[num],WEBSOCKET_OPCODE_PONG,msg,header.length,0);
+      ws_send_control(&clients[num],WEBSOCKET_OPCODE_PONG,msg,header.length);
       clients[num].scallback(num,WEBSOCKET_PING,msg,header.length);
       break;
     case WEBSOCKET_OPCODE_PONG:
@@ -72,19 +144,69 @@ static void handle_read(uint8_t num) {
       break;
     case WEBSOCKET_OPCODE_CLOSE:
       clients[num].scallback(num,WEBSOCKET_DISCONNECT_EXTERNAL,NULL,0);
-      ws_disconnect_client(&clients[num], 0);
+      close_client(num);
       break;
     default:
       break;
   }
-  if(msg) free(msg);
+  xSemaphoreGive(xwebsocket_mutex); // return access
+  ws_read_done(&clients[num],msg);
+}
+
+// disconnects a client that stopped answering without waiting on its full send buffer.
+// a write still blocked on it holds the write lock the close frame needs, so rather than
+// hold xwebsocket_mutex until that write times out the client is left marked for the
+// next round of pings, or the writer's own drop once its write fails
+static void drop_client(uint8_t num) {
+  netconn_set_nonblocking(clients[num].conn,1);
+  if(xSemaphoreTake(write_locks[num],pdMS_TO_TICKS(DROP_WAIT_MS)) != pdTRUE) {
+    clients[num].ping = 1;
+    return;
+  }
+  xSemaphoreGive(write_locks[num]); // later writes return at once without blocking
+  clients[num].scallback(num,WEBSOCKET_DISCONNECT_ERROR,NULL,0);
+  close_client(num);
+}
+
+#if WEBSOCKET_SERVER_PING_INTERVAL
+
+// pings every client, dropping those that didn't answer the previous ping
+static void ping_clients() {
+  for(int i=next_client(0);i<WEBSOCKET_SERVER_MAX_CLIENTS;i=next_client(i+1)) {
+    if(!clients[i].conn) continue;
+    if(clients[i].ping) {
+      drop_client(i);
+      continue;
+    }
+    clients[i].ping = 1;
+    if(ws_send_control(&clients[i],WEBSOCKET_OPCODE_PING,NULL,0) != ERR_OK) {
+      drop_client(i);
+    }
+  }
+}
+#endif
+
+// hands the client's new receive events to its parser and handles every message that
+// has arrived. a frame that has only partly arrived is kept for the next events
+static void handle_events(uint8_t num) {
+  uint32_t n = __sync_lock_test_and_set(&rx_events[num],0);
+
+  xSemaphoreTake(read_locks[num],portMAX_DELAY);
+  ws_received(&clients[num],n);
+  while(clients[num].conn && ws_pending(&clients[num])) {
+    handle_read(num);
+  }
+  xSemaphoreGive(read_locks[num]);
 }
 
 static void ws_server_task(void* pvParameters) {
-  struct netconn* conn;
+  uint32_t bits;
+  TickType_t wait = portMAX_DELAY;
+#if WEBSOCKET_SERVER_PING_INTERVAL
+  TickType_t next_ping = xTaskGetTickCount() + pdMS_TO_TICKS(WEBSOCKET_SERVER_PING_INTERVAL);
+#endif
 
   xwebsocket_mutex = xSemaphoreCreateMutex();
-  xwebsocket_queue = xQueueCreate(WEBSOCKET_SERVER_QUEUE_SIZE, sizeof(struct netconn*));
 
   // initialize all clients
   for(int i=0;i<WEBSOCKET_SERVER_MAX_CLIENTS;i++) {
@@ -99,23 +221,41 @@ static void ws_server_task(void* pvParameters) {
   }
 
   for(;;) {
-    xQueueReceive(xwebsocket_queue,&conn,portMAX_DELAY);
-    if(!conn) continue; // if the connection was NULL, ignore it
-
-    xSemaphoreTake(xwebsocket_mutex,portMAX_DELAY); // take access
-    for(int i=0;i<WEBSOCKET_SERVER_MAX_CLIENTS;i++) {
-      if(clients[i].conn == conn) {
-        handle_read(i);
-        break;
+#if WEBSOCKET_SERVER_PING_INTERVAL
+    // wait for reads until the next round of pings is due
+    wait = next_ping - xTaskGetTickCount();
+    if((int32_t) wait <= 0) {
+      xSemaphoreTake(xwebsocket_mutex,portMAX_DELAY);
+      ping_clients();
+      xSemaphoreGive(xwebsocket_mutex);
+      next_ping += pdMS_TO_TICKS(WEBSOCKET_SERVER_PING_INTERVAL);
+      continue;
+    }
+#endif
+    ulTaskNotifyTake(pdTRUE,wait);
+
+    // only visit the clients that have something to read
+    for(int w=0;w<CLIENT_WORDS;w++) {
+      bits = __sync_lock_test_and_set(&rx_pending[w],0);
+      while(bits) {
+        handle_events(w * 32 + __builtin_ctz(bits));
+        bits &= bits - 1;
       }
     }
-    xSemaphoreGive(xwebsocket_mutex); // return access
   }
   vTaskDelete(NULL);
 }
 
+static void server_locks_init() {
+  for(int i=0;i<WEBSOCKET_SERVER_MAX_CLIENTS;i++) {
+    read_locks[i] = xSemaphoreCreateMutex();
+    write_locks[i] = xSemaphoreCreateMutex();
+  }
+}
+
 int ws_server_start() {
   if(xtask) return 0;
+  server_locks_init();
   #if WEBSOCKET_SERVER_PINNED
   xTaskCreatePinnedToCore(&ws_server_task,
                           "ws_server_task",
@@ -135,45 +275,165 @@ int ws_server_start() {
   return 1;
 }
 
+#if configSUPPORT_STATIC_ALLOCATION
+int ws_server_start_static(StackType_t* stack, StaticTask_t* task) {
+  if(xtask) return 0;
+  server_locks_init();
+  #if WEBSOCKET_SERVER_PINNED
+  xtask = xTaskCreateStaticPinnedToCore(&ws_server_task,
+                                        "ws_server_task",
+                                        WEBSOCKET_SERVER_TASK_STACK_DEPTH,
+                                        NULL,
+                                        WEBSOCKET_SERVER_TASK_PRIORITY,
+                                        stack,
+                                        task,
+                                        WEBSOCKET_SERVER_PINNED_CORE);
+  #else
+  xtask = xTaskCreateStatic(&ws_server_task,
+                            "ws_server_task",
+                            WEBSOCKET_SERVER_TASK_STACK_DEPTH,
+                            NULL,
+                            WEBSOCKET_SERVER_TASK_PRIORITY,
+                            stack,
+                            task);
+  #endif
+  return 1;
+}
+#endif
+
 int ws_server_stop() {
   if(!xtask) return 0;
   vTaskDelete(xtask);
   return 1;
 }
 
-static bool prepare_response(char* buf,uint32_t buflen,char* handshake,char* protocol) {
-  const char WS_HEADER[] = "Upgrade: websocket\r\n";
-  const char WS_KEY[] = "Sec-WebSocket-Key: ";
+// loads handshake with the response upgrading a request, returning its length or 0 if
+// the request can't be upgraded or the response doesn't fit. permessage-deflate is
+// accepted, setting deflate, if the browser offered it and there's the memory for
+// compressing messages. neither side keeps its window between messages
+static int prepare_response(const ws_request_t* req,char* handshake,int handshake_len,const char* protocol,bool* deflate) {
   const char WS_RSP[] = "HTTP/1.1 101 Switching Protocols\r\n" \
                         "Upgrade: websocket\r\n" \
                         "Connection: Upgrade\r\n" \
                         "Sec-WebSocket-Accept: %s\r\n" \
-                        "%s\r\n";
-
-  char* key_start;
-  char* key_end;
-  char* hashed_key;
-
-  if(!strstr(buf,WS_HEADER)) return 0;
-  if(!buflen) return 0;
-  key_start = strstr(buf,WS_KEY);
-  if(!key_start) return 0;
-  key_start += 19;
-  key_end = strstr(key_start,"\r\n");
-  if(!key_end) return 0;
-
-  hashed_key = ws_hash_handshake(key_start,key_end-key_start);
-  if(!hashed_key) return 0;
-  if(protocol) {
-    char tmp[256];
-    sprintf(tmp,WS_RSP,hashed_key,"Sec-WebSocket-Protocol: %s\r\n");
-    sprintf(handshake,tmp,protocol);
-  }
-  else {
-    sprintf(handshake,WS_RSP,hashed_key,"");
-  }
-  free(hashed_key);
-  return 1;
+                        "%s%s%s%s%s\r\n";
+  const char WS_DEFLATE[] = "Sec-WebSocket-Extensions: permessage-deflate; " \
+                            "server_no_context_takeover; client_no_context_takeover";
+  char accept[WS_ACCEPT_LEN + 1];
+  char params[40] = "\r\n";
+  int n;
+
+  if(!req->upgrade || !req->key) return 0;
+  if(!ws_hash_handshake(req->key,req->key_len,accept)) return 0;
+  *deflate = false;
+#if WEBSOCKET_SERVER_DEFLATE
+  *deflate = req->deflate &&
+             (heap_caps_get_free_size(MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT) >= WEBSOCKET_SERVER_DEFLATE_HEAP);
+  if(*deflate && req->deflate_bits) snprintf(params,sizeof(params),"; server_max_window_bits=%d\r\n",WS_DEFLATE_WINDOW_BITS);
+#endif
+  n = snprintf(handshake,handshake_len,WS_RSP,accept,
+               protocol ? "Sec-WebSocket-Protocol: " : "",
+               protocol ? protocol : "",
+               protocol ? "\r\n" : "",
+               *deflate ? WS_DEFLATE : "",
+               *deflate ? params : "");
+  if(n <= 0 || n >= handshake_len) return 0;
+  return n;
+}
+
+// writes all of data to a connection, through its TLS session if it has one
+static void write_all(struct netconn* conn,struct ws_tls* tls,const char* data,int len) {
+#if WEBSOCKET_SERVER_TLS
+  if(tls) {
+    ws_tls_write_all(tls,data,len);
+    return;
+  }
+#endif
+  netconn_write(conn,data,len,NETCONN_COPY);
+}
+
+// closes a connection that isn't a client, ending its TLS session if it has one
+static void close_conn(struct netconn* conn,struct ws_tls* tls) {
+#if WEBSOCKET_SERVER_TLS
+  if(tls) ws_tls_close(tls);
+#endif
+  netconn_close(conn);
+  netconn_delete(conn);
+}
+
+// answers an upgrade that can't be accepted now with 503 and closes the connection, so
+// the browser retries later. a raw client is just closed
+static void refuse_client(struct netconn* conn,struct ws_tls* tls,bool raw) {
+  const char RSP[] = "HTTP/1.1 503 Service Unavailable\r\n" \
+                     "Retry-After: 5\r\n" \
+                     "Content-Length: 0\r\n\r\n";
+
+  if(!raw) write_all(conn,tls,RSP,sizeof(RSP)-1);
+  close_conn(conn,tls);
+}
+
+// gives a connection a client number, sending handshake first if there is one
+static int admit_client(struct netconn* conn,
+                        struct ws_tls* tls,
+                        const char* handshake,
+                        int handshake_len,
+                        bool raw,
+                        bool deflate,
+                        char* url,
+                        void (*callback)(uint8_t num,
+                                         WEBSOCKET_TYPE_t type,
+                                         char* msg,
+                                         uint64_t len)) {
+  int ret;
+
+  // another connection's buffers could take the memory the rest of the system needs
+#if WEBSOCKET_SERVER_ADMIT_HEAP
+  if(heap_caps_get_free_size(MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT) < WEBSOCKET_SERVER_ADMIT_HEAP) {
+    refuse_client(conn,tls,raw);
+    return -1;
+  }
+#endif
+
+  xSemaphoreTake(xwebsocket_mutex,portMAX_DELAY);
+  ret = (num_connected < max_connected) ? free_client() : -1;
+  if(ret < 0) {
+    xSemaphoreGive(xwebsocket_mutex);
+    refuse_client(conn,tls,raw);
+    return -1;
+  }
+
+  // route the connection's receive events straight to its client
+  rx_events[ret] = 0;
+  conn->socket = ret;
+  conn->callback = background_callback;
+  if(handshake_len) write_all(conn,tls,handshake,handshake_len);
+
+  // apply the transport profile, leaving writes to return with what they managed
+  // after the send timeout
+#if WEBSOCKET_SERVER_LOW_LATENCY
+  tcp_nagle_disable(conn->pcb.tcp);
+#else
+  tcp_nagle_enable(conn->pcb.tcp);
+#endif
+  netconn_set_sendtimeout(conn,WEBSOCKET_SERVER_SEND_TIMEOUT);
+
+  clients[ret] = ws_connect_client(conn,url,NULL,callback);
+  clients[ret].rx_buf = rx_buffers[ret];
+  clients[ret].rx_buf_len = WEBSOCKET_SERVER_RX_BUF_SIZE;
+  clients[ret].write_lock = write_locks[ret];
+  clients[ret].raw = raw;
+  clients[ret].tls = tls;
+  clients[ret].deflate = deflate;
+  connected[ret / 32] |= 1u << (ret % 32);
+  num_connected++;
+  callback(ret,WEBSOCKET_CONNECT,NULL,0);
+  if(!ws_is_connected(&clients[ret])) {
+    callback(ret,WEBSOCKET_DISCONNECT_ERROR,NULL,0);
+    close_client(ret);
+    ret = -1;
+  }
+  xSemaphoreGive(xwebsocket_mutex);
+  return ret;
 }
 
 int ws_server_add_client_protocol(struct netconn* conn,
@@ -185,42 +445,74 @@ int ws_server_add_client_protocol(struct netconn* conn,
                                           WEBSOCKET_TYPE_t type,
                                           char* msg,
                                           uint64_t len)) {
-  int ret;
-  char handshake[256];
+  ws_request_t req;
 
-  if(!prepare_response(msg,len,handshake,protocol)) {
+  if(!len || !ws_parse_request(msg,len,&req)) {
     netconn_close(conn);
     netconn_delete(conn);
     return -2;
   }
+  return ws_server_add_client_request(conn,&req,url,protocol,callback);
+}
 
+int ws_server_add_client_request(struct netconn* conn,
+                         const ws_request_t* req,
+                         char* url,
+                         char* protocol,
+                         void (*callback)(uint8_t num,
+                                          WEBSOCKET_TYPE_t type,
+                                          char* msg,
+                                          uint64_t len)) {
+  int handshake_len;
+  char handshake[384];
+  bool deflate;
 
-  ret = -1;
-  xSemaphoreTake(xwebsocket_mutex,portMAX_DELAY);
-  conn->callback = background_callback;
-  netconn_write(conn,handshake,strlen(handshake),NETCONN_COPY);
+  handshake_len = prepare_response(req,handshake,sizeof(handshake),protocol,&deflate);
+  if(!handshake_len) {
+    netconn_close(conn);
+    netconn_delete(conn);
+    return -2;
+  }
+  return admit_client(conn,NULL,handshake,handshake_len,false,deflate,url,callback);
+}
 
-  for(int i=0;i<WEBSOCKET_SERVER_MAX_CLIENTS;i++) {
-    if(clients[i].conn) continue;
-    clients[i] = ws_connect_client(conn,url,NULL,callback);
-    callback(i,WEBSOCKET_CONNECT,NULL,0);
-    if(!ws_is_connected(clients[i])) {
-      callback(i,WEBSOCKET_DISCONNECT_ERROR,NULL,0);
-      ws_disconnect_client(&clients[i], 0);
-      break;
-    }
-    ret = i;
-    break;
+int ws_server_add_client_raw(struct netconn* conn,
+                             char* url,
+                             void (*callback)(uint8_t num,
+                                              WEBSOCKET_TYPE_t type,
+                                              char* msg,
+                                              uint64_t len)) {
+  return admit_client(conn,NULL,NULL,0,true,false,url,callback);
+}
+
+#if WEBSOCKET_SERVER_TLS
+int ws_server_add_client_tls(struct netconn* conn,
+                             struct ws_tls* tls,
+                             const ws_request_t* req,
+                             char* url,
+                             char* protocol,
+                             void (*callback)(uint8_t num,
+                                              WEBSOCKET_TYPE_t type,
+                                              char* msg,
+                                              uint64_t len)) {
+  int handshake_len;
+  char handshake[384];
+  bool deflate;
+
+  handshake_len = prepare_response(req,handshake,sizeof(handshake),protocol,&deflate);
+  if(!handshake_len) {
+    close_conn(conn,tls);
+    return -2;
   }
-  xSemaphoreGive(xwebsocket_mutex);
-  return ret;
+  return admit_client(conn,tls,handshake,handshake_len,false,deflate,url,callback);
 }
+#endif
 
 int ws_server_len_url(char* url) {
   int ret;
   ret = 0;
   xSemaphoreTake(xwebsocket_mutex,portMAX_DELAY);
-  for(int i=0;i<WEBSOCKET_SERVER_MAX_CLIENTS;i++) {
+  for(int i=next_client(0);i<WEBSOCKET_SERVER_MAX_CLIENTS;i=next_client(i+1)) {
     if(clients[i].url && strcmp(url,clients[i].url)) ret++;
   }
   xSemaphoreGive(xwebsocket_mutex);
@@ -242,83 +534,134 @@ int ws_server_add_client(struct netconn* conn,
 
 int ws_server_len_all() {
   int ret;
-  ret = 0;
   xSemaphoreTake(xwebsocket_mutex,portMAX_DELAY);
-  for(int i=0;i<WEBSOCKET_SERVER_MAX_CLIENTS;i++) {
-    if(clients[i].conn) ret++;
-  }
+  ret = num_connected;
   xSemaphoreGive(xwebsocket_mutex);
   return ret;
 }
 
+// limits the clients admitted at once, between 1 and WEBSOCKET_SERVER_MAX_CLIENTS. those
+// already connected stay
+void ws_server_set_max_clients(int max) {
+  if(max < 1) max = 1;
+  if(max > WEBSOCKET_SERVER_MAX_CLIENTS) max = WEBSOCKET_SERVER_MAX_CLIENTS;
+  max_connected = max;
+}
+
+int ws_server_len_all_from_callback() {
+  return num_connected;
+}
+
+void ws_server_lock_client(int num) {
+  xSemaphoreTake(write_locks[num],portMAX_DELAY);
+}
+
+// gives the lock back, sending the pings and pongs left for the client meanwhile
+void ws_server_unlock_client(int num) {
+  if(clients[num].write_lock == write_locks[num]) {
+    ws_unlock_write(&clients[num]);
+  } else {
+    xSemaphoreGive(write_locks[num]);
+  }
+}
+
+// takes access to one client, waiting for any read from it to finish so it can be
+// disconnected
+static void take_client(int num) {
+  xSemaphoreTake(read_locks[num],portMAX_DELAY);
+  xSemaphoreTake(xwebsocket_mutex,portMAX_DELAY);
+}
+
+static void give_client(int num) {
+  xSemaphoreGive(xwebsocket_mutex);
+  xSemaphoreGive(read_locks[num]);
+}
+
+void ws_server_drop_client(int num,struct netconn* conn) {
+  take_client(num);
+  if(conn && clients[num].conn == conn) {
+    drop_client(num);
+  }
+  give_client(num);
+}
+
 int ws_server_remove_client(int num) {
   int ret = 0;
-  xSemaphoreTake(xwebsocket_mutex,portMAX_DELAY);
-  if(ws_is_connected(clients[num])) {
+  take_client(num);
+  if(ws_is_connected(&clients[num])) {
     clients[num].scallback(num,WEBSOCKET_DISCONNECT_INTERNAL,NULL,0);
-    ws_disconnect_client(&clients[num], 0);
+    close_client(num);
     ret = 1;
   }
-  xSemaphoreGive(xwebsocket_mutex);
+  give_client(num);
   return ret;
 }
 
 int ws_server_remove_clients(char* url) {
   int ret = 0;
-  xSemaphoreTake(xwebsocket_mutex,portMAX_DELAY);
-  for(int i=0;i<WEBSOCKET_SERVER_MAX_CLIENTS;i++) {
-    if(ws_is_connected(clients[i]) && strcmp(url,clients[i].url)) {
+  for(int i=next_client(0);i<WEBSOCKET_SERVER_MAX_CLIENTS;i=next_client(i+1)) {
+    take_client(i);
+    if(ws_is_connected(&clients[i]) && strcmp(url,clients[i].url)) {
       clients[i].scallback(i,WEBSOCKET_DISCONNECT_INTERNAL,NULL,0);
-      ws_disconnect_client(&clients[i], 0);
+      close_client(i);
       ret += 1;
     }
+    give_client(i);
   }
-  xSemaphoreGive(xwebsocket_mutex);
   return ret;
 }
 
 int ws_server_remove_all() {
   int ret = 0;
-  xSemaphoreTake(xwebsocket_mutex,portMAX_DELAY);
-  for(int i=0;i<WEBSOCKET_SERVER_MAX_CLIENTS;i++) {
-    if(ws_is_connected(clients[i])) {
+  for(int i=next_client(0);i<WEBSOCKET_SERVER_MAX_CLIENTS;i=next_client(i+1)) {
+    take_client(i);
+    if(ws_is_connected(&clients[i])) {
       clients[i].scallback(i,WEBSOCKET_DISCONNECT_INTERNAL,NULL,0);
-      ws_disconnect_client(&clients[i], 0);
+      close_client(i);
       ret += 1;
     }
+    give_client(i);
+  }
+  return ret;
+}
+
+// sends to each connected client, or those on url if it isn't NULL, taking access to
+// one at a time so a client that is being read from only delays its own message
+static int send_each(char* url,WEBSOCKET_OPCODES_t opcode,char* msg,uint64_t len) {
+  int ret = 0;
+  for(int i=next_client(0);i<WEBSOCKET_SERVER_MAX_CLIENTS;i=next_client(i+1)) {
+    take_client(i);
+    if(ws_is_connected(&clients[i]) && (!url || (clients[i].url && !strcmp(clients[i].url,url)))) {
+      if(opcode == WEBSOCKET_OPCODE_TEXT)
+        ret += ws_server_send_text_client_from_callback(i,msg,len);
+      else
+        ret += ws_server_send_bin_client_from_callback(i,msg,len);
+    }
+    give_client(i);
   }
-  xSemaphoreGive(xwebsocket_mutex);
   return ret;
 }
 
 // The following functions are already written below, but without the mutex.
 
 int ws_server_send_text_client(int num,char* msg,uint64_t len) {
-  xSemaphoreTake(xwebsocket_mutex,portMAX_DELAY);
+  take_client(num);
   int ret = ws_server_send_text_client_from_callback(num, msg, len);
-  xSemaphoreGive(xwebsocket_mutex);
+  give_client(num);
   return ret;
 }
 
 int ws_server_send_text_clients(char* url,char* msg,uint64_t len) {
-  xSemaphoreTake(xwebsocket_mutex,portMAX_DELAY);
-  int ret = ws_server_send_text_clients_from_callback(url, msg, len);
-  xSemaphoreGive(xwebsocket_mutex);
-  return ret;
+  if(url == NULL) return 0;
+  return send_each(url,WEBSOCKET_OPCODE_TEXT,msg,len);
 }
 
 int ws_server_send_text_all(char* msg,uint64_t len) {
-  xSemaphoreTake(xwebsocket_mutex,portMAX_DELAY);
-  int ret = ws_server_send_text_all_from_callback(msg, len);
-  xSemaphoreGive(xwebsocket_mutex);
-  return ret;
+  return send_each(NULL,WEBSOCKET_OPCODE_TEXT,msg,len);
 }
 
 int ws_server_send_bin_all(char* msg,uint64_t len) {
-  xSemaphoreTake(xwebsocket_mutex,portMAX_DELAY);
-  int ret = ws_server_send_bin_all_from_callback(msg, len);
-  xSemaphoreGive(xwebsocket_mutex);
-  return ret;
+  return send_each(NULL,WEBSOCKET_OPCODE_BIN,msg,len);
 }
 
 // the following functions should be used inside of the callback. The regular versions
@@ -327,12 +670,12 @@ int ws_server_send_bin_all(char* msg,uint64_t len) {
 int ws_server_send_text_client_from_callback(int num,char* msg,uint64_t len) {
   int ret = 0;
   int err;
-  if(ws_is_connected(clients[num])) {
+  if(ws_is_connected(&clients[num])) {
     err = ws_send(&clients[num],WEBSOCKET_OPCODE_TEXT,msg,len,0);
     ret = 1;
     if(err) {
       clients[num].scallback(num,WEBSOCKET_DISCONNECT_ERROR,NULL,0);
-      ws_disconnect_client(&clients[num], 0);
+      close_client(num);
       ret = 0;
     }
   }
@@ -347,13 +690,13 @@ int ws_server_send_text_clients_from_callback(char* url,char* msg,uint64_t len)
     return ret;
   }
 
-  for(int i=0;i<WEBSOCKET_SERVER_MAX_CLIENTS;i++) {
-    if(clients[i].url != NULL && ws_is_connected(clients[i]) && !strcmp(clients[i].url,url)) {
+  for(int i=next_client(0);i<WEBSOCKET_SERVER_MAX_CLIENTS;i=next_client(i+1)) {
+    if(clients[i].url != NULL && ws_is_connected(&clients[i]) && !strcmp(clients[i].url,url)) {
       err = ws_send(&clients[i],WEBSOCKET_OPCODE_TEXT,msg,len,0);
       if(!err) ret += 1;
       else {
         clients[i].scallback(i,WEBSOCKET_DISCONNECT_ERROR,NULL,0);
-        ws_disconnect_client(&clients[i], 0);
+        close_client(i);
       }
     }
   }
@@ -363,13 +706,13 @@ int ws_server_send_text_clients_from_callback(char* url,char* msg,uint64_t len)
 int ws_server_send_text_all_from_callback(char* msg,uint64_t len) {
   int ret = 0;
   int err;
-  for(int i=0;i<WEBSOCKET_SERVER_MAX_CLIENTS;i++) {
-    if(ws_is_connected(clients[i])) {
+  for(int i=next_client(0);i<WEBSOCKET_SERVER_MAX_CLIENTS;i=next_client(i+1)) {
+    if(ws_is_connected(&clients[i])) {
       err = ws_send(&clients[i],WEBSOCKET_OPCODE_TEXT,msg,len,0);
       if(!err) ret += 1;
       else {
         clients[i].scallback(i,WEBSOCKET_DISCONNECT_ERROR,NULL,0);
-        ws_disconnect_client(&clients[i], 0);
+        close_client(i);
       }
     }
   }
@@ -380,12 +723,12 @@ int ws_server_send_bin_client_from_callback(int num,char* msg,uint64_t len)
 {
   int ret = 0;
   int err;
-  if(ws_is_connected(clients[num])) {
+  if(ws_is_connected(&clients[num])) {
     err = ws_send(&clients[num],WEBSOCKET_OPCODE_BIN,msg,len,0);
     ret = 1;
     if(err) {
       clients[num].scallback(num,WEBSOCKET_DISCONNECT_ERROR,NULL,0);
-      ws_disconnect_client(&clients[num], 0);
+      close_client(num);
       ret = 0;
     }
   }
@@ -401,13 +744,13 @@ int ws_server_send_bin_clients_from_callback(char* url,char* msg,uint64_t len)
     return ret;
   }
 
-  for(int i=0;i<WEBSOCKET_SERVER_MAX_CLIENTS;i++) {
-    if(clients[i].url != NULL && ws_is_connected(clients[i]) && !strcmp(clients[i].url,url)) {
+  for(int i=next_client(0);i<WEBSOCKET_SERVER_MAX_CLIENTS;i=next_client(i+1)) {
+    if(clients[i].url != NULL && ws_is_connected(&clients[i]) && !strcmp(clients[i].url,url)) {
       err = ws_send(&clients[i],WEBSOCKET_OPCODE_BIN,msg,len,0);
       if(!err) ret += 1;
       else {
         clients[i].scallback(i,WEBSOCKET_DISCONNECT_ERROR,NULL,0);
-        ws_disconnect_client(&clients[i], 0);
+        close_client(i);
       }
     }
   }
@@ -417,13 +760,13 @@ int ws_server_send_bin_clients_from_callback(char* url,char* msg,uint64_t len)
 int ws_server_send_bin_all_from_callback(char* msg,uint64_t len) {
   int ret = 0;
   int err;
-  for(int i=0;i<WEBSOCKET_SERVER_MAX_CLIENTS;i++) {
-    if(ws_is_connected(clients[i])) {
+  for(int i=next_client(0);i<WEBSOCKET_SERVER_MAX_CLIENTS;i=next_client(i+1)) {
+    if(ws_is_connected(&clients[i])) {
       err = ws_send(&clients[i],WEBSOCKET_OPCODE_BIN,msg,len,0);
       if(!err) ret += 1;
       else {
         clients[i].scallback(i,WEBSOCKET_DISCONNECT_ERROR,NULL,0);
-        ws_disconnect_client(&clients[i], 0);
+        close_client(i);
       }
     }
   }
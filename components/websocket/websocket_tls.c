@@ -0,0 +1,303 @@
+
+/*
+esp32-websocket - a websocket component on esp-idf
+Copyright (C) 2019 Blake Felt - blake.w.felt@gmail.com
+
+This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "websocket_tls.h"
+
+#if WEBSOCKET_SERVER_TLS
+
+#include "lwip/tcp.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "mbedtls/ssl.h"
+#include "mbedtls/entropy.h"
+#include "mbedtls/ctr_drbg.h"
+#include "mbedtls/x509_crt.h"
+#include "mbedtls/pk.h"
+#include "mbedtls/net_sockets.h" // for the error codes
+#if defined(MBEDTLS_SSL_TICKET_C)
+#include "mbedtls/ssl_ticket.h"
+#endif
+#if defined(MBEDTLS_SSL_CACHE_C)
+#include "mbedtls/ssl_cache.h"
+#endif
+#include <string.h>
+
+#define WS_TLS_RX_LEN 512 // plaintext returned by a read, a browser's input fits in one
+#define WS_TLS_HOLD_LEN 64 // longest write held for the next record, enough for a frame header
+#define WS_TLS_TICKET_LIFETIME 86400 // seconds a browser can resume its session for
+#define WS_TLS_STALL_TRIES 50 // send timeouts without progress before ws_tls_write_all() gives up
+
+struct ws_tls {
+  mbedtls_ssl_context ssl;
+  struct netconn* conn;
+  SemaphoreHandle_t lock; // held around calls into the session, which may come from the reader and writers
+  struct pbuf* in;        // received data not yet taken by the session
+  uint16_t in_pos;        // how much of in has been taken
+  bool block;             // wait for data when the session needs more, only while handshaking
+  uint16_t held;          // bytes held in out for the next record
+  char rx[WS_TLS_RX_LEN + 1]; // the plaintext of the last read, with room for a terminator
+  unsigned char out[WEBSOCKET_SERVER_TLS_RECORD_LEN]; // held writes and the start of the record they go out in
+};
+
+// shared by every session
+static mbedtls_ssl_config conf;
+static mbedtls_entropy_context entropy;
+static mbedtls_ctr_drbg_context ctr_drbg;
+static mbedtls_x509_crt cert_chain;
+static mbedtls_pk_context pkey;
+#if defined(MBEDTLS_SSL_SESSION_TICKETS) && defined(MBEDTLS_SSL_TICKET_C)
+static mbedtls_ssl_ticket_context ticket;
+#endif
+#if defined(MBEDTLS_SSL_CACHE_C)
+static mbedtls_ssl_cache_context cache;
+#endif
+
+// the suites the server prefers, in order. AES-GCM only needs the AES accelerator for
+// the records, the CBC suites also hash each record with the SHA accelerator
+static const int ciphersuites[] = {
+  MBEDTLS_TLS_ECDHE_ECDSA_WITH_AES_128_GCM_SHA256,
+  MBEDTLS_TLS_ECDHE_RSA_WITH_AES_128_GCM_SHA256,
+  MBEDTLS_TLS_RSA_WITH_AES_128_GCM_SHA256,
+  MBEDTLS_TLS_ECDHE_ECDSA_WITH_AES_128_CBC_SHA256,
+  MBEDTLS_TLS_ECDHE_RSA_WITH_AES_128_CBC_SHA256,
+  0
+};
+
+// hands the session received data, taking the next segment from the connection when
+// the last is used up. the session lock is held
+static int bio_recv(void* ctx,unsigned char* buf,size_t len) {
+  ws_tls_t* tls = ctx;
+  uint16_t n;
+  err_t err;
+
+  if(!tls->in) {
+    err = netconn_recv_tcp_pbuf_flags(tls->conn,&tls->in,tls->block ? 0 : NETCONN_DONTBLOCK);
+    if(err != ERR_OK) {
+      tls->in = NULL;
+      if(err == ERR_WOULDBLOCK) return MBEDTLS_ERR_SSL_WANT_READ;
+      if(err == ERR_TIMEOUT) return MBEDTLS_ERR_SSL_TIMEOUT;
+      return MBEDTLS_ERR_NET_CONN_RESET;
+    }
+    tls->in_pos = 0;
+  }
+
+  n = tls->in->tot_len - tls->in_pos;
+  if(n > len) n = len;
+  n = pbuf_copy_partial(tls->in,buf,n,tls->in_pos);
+  tls->in_pos += n;
+  if(tls->in_pos >= tls->in->tot_len) {
+    pbuf_free(tls->in);
+    tls->in = NULL;
+  }
+  return n;
+}
+
+// sends what it can of a record before the send timeout. lwip copies it, as the
+// session reuses its buffer for the next record. the session lock is held
+static int bio_send(void* ctx,const unsigned char* buf,size_t len) {
+  ws_tls_t* tls = ctx;
+  size_t written = 0;
+  err_t err;
+
+  err = netconn_write_partly(tls->conn,buf,len,NETCONN_COPY,&written);
+  if(written) return written;
+  if(err == ERR_OK || err == ERR_WOULDBLOCK) return MBEDTLS_ERR_SSL_WANT_WRITE;
+  return MBEDTLS_ERR_NET_SEND_FAILED;
+}
+
+bool ws_tls_init(const unsigned char* cert,size_t cert_len,const unsigned char* key,size_t key_len) {
+  const char pers[] = "websocket_tls";
+
+  mbedtls_ssl_config_init(&conf);
+  mbedtls_entropy_init(&entropy);
+  mbedtls_ctr_drbg_init(&ctr_drbg);
+  mbedtls_x509_crt_init(&cert_chain);
+  mbedtls_pk_init(&pkey);
+
+  if(mbedtls_ctr_drbg_seed(&ctr_drbg,mbedtls_entropy_func,&entropy,(const unsigned char*)pers,sizeof(pers)-1) ||
+     mbedtls_x509_crt_parse(&cert_chain,cert,cert_len) ||
+     mbedtls_pk_parse_key(&pkey,key,key_len,NULL,0) ||
+     mbedtls_ssl_config_defaults(&conf,MBEDTLS_SSL_IS_SERVER,MBEDTLS_SSL_TRANSPORT_STREAM,MBEDTLS_SSL_PRESET_DEFAULT) ||
+     mbedtls_ssl_conf_own_cert(&conf,&cert_chain,&pkey)) {
+    return 0;
+  }
+  mbedtls_ssl_conf_rng(&conf,mbedtls_ctr_drbg_random,&ctr_drbg);
+  mbedtls_ssl_conf_min_version(&conf,MBEDTLS_SSL_MAJOR_VERSION_3,MBEDTLS_SSL_MINOR_VERSION_3); // TLS 1.2
+  mbedtls_ssl_conf_ciphersuites(&conf,ciphersuites);
+#if defined(MBEDTLS_SSL_RENEGOTIATION)
+  // the reader and the writers share a session, which renegotiation would upset
+  mbedtls_ssl_conf_renegotiation(&conf,MBEDTLS_SSL_RENEGOTIATION_DISABLED);
+#endif
+
+  // a browser reconnecting resumes its session instead of a full handshake, from a
+  // ticket it keeps or failing that from the cache
+#if defined(MBEDTLS_SSL_SESSION_TICKETS) && defined(MBEDTLS_SSL_TICKET_C)
+  mbedtls_ssl_ticket_init(&ticket);
+  if(!mbedtls_ssl_ticket_setup(&ticket,mbedtls_ctr_drbg_random,&ctr_drbg,MBEDTLS_CIPHER_AES_128_GCM,WS_TLS_TICKET_LIFETIME)) {
+    mbedtls_ssl_conf_session_tickets_cb(&conf,mbedtls_ssl_ticket_write,mbedtls_ssl_ticket_parse,&ticket);
+  }
+#endif
+#if defined(MBEDTLS_SSL_CACHE_C)
+  mbedtls_ssl_cache_init(&cache);
+  mbedtls_ssl_conf_session_cache(&conf,&cache,mbedtls_ssl_cache_get,mbedtls_ssl_cache_set);
+#endif
+  return 1;
+}
+
+ws_tls_t* ws_tls_accept(struct netconn* conn) {
+  ws_tls_t* tls;
+  int ret;
+
+  tls = malloc(sizeof(ws_tls_t));
+  if(!tls) return NULL;
+  memset(tls,0,sizeof(ws_tls_t));
+  tls->conn = conn;
+  tls->lock = xSemaphoreCreateMutex();
+  mbedtls_ssl_init(&tls->ssl);
+  if(!tls->lock || mbedtls_ssl_setup(&tls->ssl,&conf)) {
+    ws_tls_close(tls);
+    return NULL;
+  }
+  mbedtls_ssl_set_bio(&tls->ssl,tls,bio_send,bio_recv,NULL);
+
+  // nothing else uses the session yet, so it can wait for the browser
+  tls->block = 1;
+  do {
+    ret = mbedtls_ssl_handshake(&tls->ssl);
+  } while(ret == MBEDTLS_ERR_SSL_WANT_WRITE);
+  tls->block = 0;
+  if(ret) {
+    ws_tls_close(tls);
+    return NULL;
+  }
+  return tls;
+}
+
+err_t ws_tls_read(ws_tls_t* tls,char** data,uint16_t* len) {
+  int ret;
+
+  xSemaphoreTake(tls->lock,portMAX_DELAY);
+  ret = mbedtls_ssl_read(&tls->ssl,(unsigned char*)tls->rx,WS_TLS_RX_LEN);
+  xSemaphoreGive(tls->lock);
+  if(ret > 0) {
+    *data = tls->rx;
+    *len = ret;
+    return ERR_OK;
+  }
+  if(ret == MBEDTLS_ERR_SSL_WANT_READ) return ERR_WOULDBLOCK;
+  return (ret == 0 || ret == MBEDTLS_ERR_SSL_PEER_CLOSE_NOTIFY) ? ERR_CLSD : ERR_ABRT;
+}
+
+err_t ws_tls_wait(ws_tls_t* tls) {
+  struct pbuf* p;
+  err_t err;
+
+  // wait outside the lock so writers aren't held up, then queue the segment behind any
+  // the session hasn't taken yet
+  err = netconn_recv_tcp_pbuf(tls->conn,&p);
+  if(err != ERR_OK) return err;
+  xSemaphoreTake(tls->lock,portMAX_DELAY);
+  if(tls->in) {
+    pbuf_cat(tls->in,p);
+  } else {
+    tls->in = p;
+    tls->in_pos = 0;
+  }
+  xSemaphoreGive(tls->lock);
+  return ERR_OK;
+}
+
+err_t ws_tls_write(ws_tls_t* tls,const void* data,size_t len,bool more,size_t* written) {
+  size_t n;
+  int ret;
+
+  *written = 0;
+  if(!len) return ERR_OK;
+  xSemaphoreTake(tls->lock,portMAX_DELAY);
+
+  // a header is held rather than sent as a record of its own
+  if(more && tls->held + len <= WS_TLS_HOLD_LEN) {
+    memcpy(&tls->out[tls->held],data,len);
+    tls->held += len;
+    *written = len;
+    xSemaphoreGive(tls->lock);
+    return ERR_OK;
+  }
+
+  // a record is filled to WEBSOCKET_SERVER_TLS_RECORD_LEN, with anything held at its
+  // start. the session copies the plaintext into its own buffer and encrypts it there,
+  // so a record is only written into out when there are held bytes to go before it.
+  // nothing changes if the record can't be sent, so the repeated write is the same
+  if(tls->held) {
+    n = WEBSOCKET_SERVER_TLS_RECORD_LEN - tls->held;
+    if(n > len) n = len;
+    memcpy(&tls->out[tls->held],data,n);
+    ret = mbedtls_ssl_write(&tls->ssl,tls->out,tls->held + n);
+    if(ret >= tls->held) { // the session sends less if the browser asked for shorter records
+      *written = ret - tls->held;
+      tls->held = 0;
+    }
+    else if(ret > 0) {
+      memmove(tls->out,&tls->out[ret],tls->held - ret);
+      tls->held -= ret;
+    }
+  }
+  else {
+    n = (len < WEBSOCKET_SERVER_TLS_RECORD_LEN) ? len : WEBSOCKET_SERVER_TLS_RECORD_LEN;
+    ret = mbedtls_ssl_write(&tls->ssl,data,n);
+    if(ret > 0) *written = ret;
+  }
+  xSemaphoreGive(tls->lock);
+
+  if(ret > 0) return ERR_OK;
+  if(ret == MBEDTLS_ERR_SSL_WANT_WRITE || ret == MBEDTLS_ERR_SSL_WANT_READ) return ERR_WOULDBLOCK;
+  return ERR_ABRT;
+}
+
+err_t ws_tls_write_all(ws_tls_t* tls,const void* data,size_t len) {
+  const char* p = data;
+  size_t written;
+  err_t err;
+  int stalled = 0;
+
+  while(len) {
+    err = ws_tls_write(tls,p,len,0,&written);
+    if(err != ERR_OK && err != ERR_WOULDBLOCK) return err;
+    if(!written && ++stalled >= WS_TLS_STALL_TRIES) return ERR_WOULDBLOCK;
+    if(written) stalled = 0;
+    p += written;
+    len -= written;
+  }
+  return ERR_OK;
+}
+
+bool ws_tls_pending(const ws_tls_t* tls) {
+  return tls->in || mbedtls_ssl_get_bytes_avail(&tls->ssl);
+}
+
+void ws_tls_close(ws_tls_t* tls) {
+  if(tls->lock) xSemaphoreTake(tls->lock,portMAX_DELAY);
+  if(tls->ssl.conf) (void)mbedtls_ssl_close_notify(&tls->ssl);
+  mbedtls_ssl_free(&tls->ssl);
+  if(tls->in) pbuf_free(tls->in);
+  if(tls->lock) vSemaphoreDelete(tls->lock);
+  free(tls);
+}
+
+#endif // if WEBSOCKET_SERVER_TLS
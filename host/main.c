@@ -0,0 +1,160 @@
+/* Host build of the websocket demo
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+
+   Runs main/main.c's application on Linux, without the WiFi setup, so the driver
+   can be profiled and run under sanitizers.
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_system.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "lvgl/lvgl.h"
+#include "lv_examples/lv_apps/demo/demo.h"
+#include "esp_freertos_hooks.h"
+#include "websocket_driver.h"
+#include "gpu_accel.h"
+#include "e2e_bench.h"
+#include "pipe_mon.h"
+#include "micro_bench.h"
+#include "draw_stream.h"
+
+
+/**********************
+ *  STATIC PROTOTYPES
+ **********************/
+static void boot_phase(const char* phase, int64_t start);
+#if !WS_DRIVER_TICK_ESP_TIMER
+static void lv_tick_task(void);
+#endif
+#if WS_DRIVER_SESSIONS
+static void session_create(lv_disp_t * disp);
+#endif
+
+
+/**********************
+ *   APPLICATION MAIN
+ **********************/
+int main(void) {
+	int64_t start = esp_timer_get_time();
+
+	setvbuf(stdout, NULL, _IOLBF, 0);
+
+	lv_init();
+
+	websocket_driver_init(NULL);
+	boot_phase("LVGL and driver init", start);
+
+	start = esp_timer_get_time();
+	gpu_accel_init();
+
+	static lv_disp_buf_t disp_buf;
+
+	// LVGL Display buffers, sized to the emulated heap
+	websocket_driver_init_buf(&disp_buf);
+
+	// Output
+	lv_disp_drv_t disp_drv;
+	lv_disp_drv_init(&disp_drv);
+	disp_drv.flush_cb = websocket_driver_flush;
+	disp_drv.buffer = &disp_buf;
+	disp_drv.inv_area_cost = WS_DRIVER_AREA_COST;
+	disp_drv.rounder_cb = websocket_driver_rounder;
+	disp_drv.wait_cb = websocket_driver_wait;
+#if WS_DRIVER_SCROLL_COPY
+	disp_drv.copy_cb = websocket_driver_copy;
+#endif
+	disp_drv.gpu_fill_cb = gpu_accel_fill;
+#if WS_DRIVER_DRAW_STREAM
+	disp_drv.draw_cb = draw_stream_record;
+#endif
+#if WS_DRIVER_MONITOR
+	disp_drv.monitor_cb = websocket_driver_monitor;
+#endif
+#if WS_DRIVER_TRACE
+	disp_drv.trace_cb = websocket_driver_trace;
+#endif
+#if WS_DRIVER_YIELD
+	disp_drv.yield_cb = websocket_driver_yield;
+#endif
+#if WS_DRIVER_NEAR_FIRST
+	disp_drv.rank_cb = websocket_driver_rank;
+#endif
+#if WS_DRIVER_RATE_CAPS
+	disp_drv.hold_cb = websocket_driver_hold;
+#endif
+	lv_disp_drv_register(&disp_drv);
+
+	// Input
+	lv_indev_drv_t indev_drv;
+	lv_indev_drv_init(&indev_drv);
+	indev_drv.read_cb = websocket_driver_read;
+	indev_drv.type = LV_INDEV_TYPE_POINTER;
+	lv_indev_drv_register(&indev_drv);
+#if WS_DRIVER_KEYS
+	indev_drv.read_cb = websocket_driver_read_keys;
+	indev_drv.type = LV_INDEV_TYPE_KEYPAD;
+	lv_indev_drv_register(&indev_drv);
+#endif
+
+#if !WS_DRIVER_TICK_ESP_TIMER
+	esp_register_freertos_tick_hook(lv_tick_task);
+#endif
+	boot_phase("display and input", start);
+
+	start = esp_timer_get_time();
+#if WS_DRIVER_MICROBENCH
+	micro_bench_run();
+	if (getenv("LVGL_HOST_BENCH_EXIT") != NULL) return 0;
+#endif
+#if WS_DRIVER_BENCHMARK
+	e2e_bench_create();
+#else
+	demo_create();
+#endif
+#if WS_DRIVER_PIPE_MON
+	pipe_mon_create();
+#endif
+#if WS_DRIVER_SESSIONS
+	websocket_driver_set_session_cb(session_create);
+#endif
+	boot_phase("user interface", start);
+
+	// As app_main does, return once the driver's tasks have LVGL, leaving them running
+	websocket_driver_run();
+	vTaskDelete(NULL);
+	return 0;
+}
+
+
+/**********************
+ *   STATIC FUNCTIONS
+ **********************/
+// Log how long a startup phase begun at start took, and when it finished
+static void boot_phase(const char* phase, int64_t start) {
+	int64_t now = esp_timer_get_time();
+
+	ESP_LOGI("boot", "%s took %d mS, done %d mS after boot", phase, (int) ((now - start) / 1000), (int) (now / 1000));
+}
+
+
+#if !WS_DRIVER_TICK_ESP_TIMER
+static void lv_tick_task(void) {
+	lv_tick_inc(portTICK_RATE_MS);
+}
+#endif
+
+
+#if WS_DRIVER_SESSIONS
+// Each browser after the first gets its own copy of the demo
+static void session_create(lv_disp_t * disp) {
+	demo_create();
+}
+#endif
@@ -0,0 +1,234 @@
+/**
+* ESP-IDF system, timer, logging and heap functions for the host build
+*
+*/
+
+/*********************
+ *      INCLUDES
+ *********************/
+#include "esp_system.h"
+#include "esp_timer.h"
+#include "esp_log.h"
+#include "esp_heap_caps.h"
+#include "host_compat.h"
+#include <stdio.h>
+#include <stdarg.h>
+#include <string.h>
+#include <pthread.h>
+#include <time.h>
+#include <sys/random.h>
+
+
+/*********************
+ *      DEFINES
+ *********************/
+// Allocations are preceded by a header recording their region and size, keeping
+// the alignment malloc gives
+#define HEAP_HEADER_LEN 16
+
+#define HEAP_INTERNAL   0
+#define HEAP_SPIRAM     1
+#define HEAP_REGIONS    2
+
+
+/**********************
+ *      TYPEDEFS
+ **********************/
+typedef struct
+{
+	size_t size;
+	size_t allocated;
+	size_t min_free;
+	size_t blocks;
+} heap_region_t;
+
+typedef struct
+{
+	size_t len;
+	int region;
+} heap_header_t;
+
+
+/**********************
+ *  STATIC VARIABLES
+ **********************/
+static pthread_once_t timer_once = PTHREAD_ONCE_INIT;
+static struct timespec timer_base;
+static pthread_mutex_t heap_lock = PTHREAD_MUTEX_INITIALIZER;
+static heap_region_t regions[HEAP_REGIONS] = {
+	{ HOST_HEAP_SIZE, 0, HOST_HEAP_SIZE, 0 },
+	{ HOST_SPIRAM_SIZE, 0, HOST_SPIRAM_SIZE, 0 }
+};
+
+
+/**********************
+ *  STATIC PROTOTYPES
+ **********************/
+static void timer_start(void);
+static int heap_region(uint32_t caps);
+
+
+/**********************
+ *   GLOBAL FUNCTIONS
+ **********************/
+// Microseconds since the first call, standing in for the time since boot
+int64_t esp_timer_get_time(void)
+{
+	struct timespec ts;
+
+	pthread_once(&timer_once, timer_start);
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (int64_t) (ts.tv_sec - timer_base.tv_sec) * 1000000 + (ts.tv_nsec - timer_base.tv_nsec) / 1000;
+}
+
+
+uint32_t esp_random(void)
+{
+	uint32_t r;
+
+	if (getrandom(&r, sizeof(r), 0) != sizeof(r)) {
+		r = (uint32_t) esp_timer_get_time();
+	}
+	return r;
+}
+
+
+void esp_restart(void)
+{
+	fprintf(stderr, "esp_restart called, exiting\n");
+	exit(1);
+}
+
+
+uint32_t esp_log_timestamp(void)
+{
+	return (uint32_t) (esp_timer_get_time() / 1000);
+}
+
+
+void esp_log_write(int level, const char* tag, const char* format, ...)
+{
+	va_list args;
+
+	va_start(args, format);
+	vfprintf(stdout, format, args);
+	va_end(args);
+	fflush(stdout);
+}
+
+
+void* heap_caps_malloc(size_t size, uint32_t caps)
+{
+	int r = heap_region(caps);
+	heap_header_t* h = NULL;
+
+	pthread_mutex_lock(&heap_lock);
+	if (size <= regions[r].size - regions[r].allocated) {
+		h = malloc(HEAP_HEADER_LEN + size);
+	}
+	if (h != NULL) {
+		h->len = size;
+		h->region = r;
+		regions[r].allocated += size;
+		regions[r].blocks++;
+		if ((regions[r].size - regions[r].allocated) < regions[r].min_free) {
+			regions[r].min_free = regions[r].size - regions[r].allocated;
+		}
+	}
+	pthread_mutex_unlock(&heap_lock);
+	return (h != NULL) ? (uint8_t*) h + HEAP_HEADER_LEN : NULL;
+}
+
+
+// Tries each of the num capability sets given in turn
+void* heap_caps_malloc_prefer(size_t size, size_t num, ...)
+{
+	va_list args;
+	void* ptr = NULL;
+
+	va_start(args, num);
+	while ((ptr == NULL) && (num-- > 0)) {
+		ptr = heap_caps_malloc(size, va_arg(args, uint32_t));
+	}
+	va_end(args);
+	return ptr;
+}
+
+
+void heap_caps_free(void* ptr)
+{
+	heap_header_t* h;
+
+	if (ptr == NULL) return;
+	h = (heap_header_t*) ((uint8_t*) ptr - HEAP_HEADER_LEN);
+	pthread_mutex_lock(&heap_lock);
+	regions[h->region].allocated -= h->len;
+	regions[h->region].blocks--;
+	pthread_mutex_unlock(&heap_lock);
+	free(h);
+}
+
+
+size_t heap_caps_get_free_size(uint32_t caps)
+{
+	int r = heap_region(caps);
+
+	return regions[r].size - regions[r].allocated;
+}
+
+
+size_t heap_caps_get_minimum_free_size(uint32_t caps)
+{
+	return regions[heap_region(caps)].min_free;
+}
+
+
+// The emulated regions don't fragment
+size_t heap_caps_get_largest_free_block(uint32_t caps)
+{
+	return heap_caps_get_free_size(caps);
+}
+
+
+void heap_caps_get_info(multi_heap_info_t* info, uint32_t caps)
+{
+	int r = heap_region(caps);
+
+	memset(info, 0, sizeof(multi_heap_info_t));
+	pthread_mutex_lock(&heap_lock);
+	info->total_free_bytes = regions[r].size - regions[r].allocated;
+	info->total_allocated_bytes = regions[r].allocated;
+	info->largest_free_block = info->total_free_bytes;
+	info->minimum_free_bytes = regions[r].min_free;
+	info->allocated_blocks = regions[r].blocks;
+	info->total_blocks = regions[r].blocks;
+	pthread_mutex_unlock(&heap_lock);
+}
+
+
+size_t host_strlcpy(char* dst, const char* src, size_t size)
+{
+	size_t len = strlen(src);
+
+	if (size > 0) {
+		size_t n = (len < size) ? len : size - 1;
+		memcpy(dst, src, n);
+		dst[n] = '\0';
+	}
+	return len;
+}
+
+
+/**********************
+ *   STATIC FUNCTIONS
+ **********************/
+static void timer_start(void)
+{
+	clock_gettime(CLOCK_MONOTONIC, &timer_base);
+}
+
+
+static int heap_region(uint32_t caps)
+{
+	return (caps & MALLOC_CAP_SPIRAM) ? HEAP_SPIRAM : HEAP_INTERNAL;
+}
@@ -0,0 +1,187 @@
+/**
+* ESP-IDF flash partitions for the host build
+*
+* "assets" is backed by the image the host Makefile packs into build/assets.bin, or
+* the file LVGL_HOST_ASSETS in the environment names.  It is mapped read only as the
+* flash cache would map it.
+*
+* "capture" is backed by build/capture.bin, or the file LVGL_HOST_CAPTURE names,
+* created erased at the size partitions.csv gives it.  Writes replace what is there
+* rather than only clearing bits, so what isn't erased first isn't caught.
+*
+*/
+
+/*********************
+ *      INCLUDES
+ *********************/
+#include "esp_partition.h"
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+
+/*********************
+ *      DEFINES
+ *********************/
+#ifndef HOST_ASSETS_BIN
+#define HOST_ASSETS_BIN "build/assets.bin"
+#endif
+
+#ifndef HOST_CAPTURE_BIN
+#define HOST_CAPTURE_BIN "build/capture.bin"
+#endif
+
+// Where partitions.csv places them
+#define ASSETS_ADDRESS  0x210000
+#define CAPTURE_ADDRESS 0x310000
+#define CAPTURE_SIZE    0xF0000
+
+#define SECTOR_SIZE     4096
+
+
+/**********************
+ *  STATIC VARIABLES
+ **********************/
+static esp_partition_t assets = { ESP_PARTITION_TYPE_DATA, 0x40, ASSETS_ADDRESS, 0, "assets", false };
+static int assets_fd = -1;
+static esp_partition_t capture = { ESP_PARTITION_TYPE_DATA, 0x41, CAPTURE_ADDRESS, CAPTURE_SIZE, "capture", false };
+static int capture_fd = -1;
+static void* mapped = NULL;
+static size_t mapped_len;
+
+
+/**********************
+ *  STATIC PROTOTYPES
+ **********************/
+static bool open_capture();
+static bool in_partition(const esp_partition_t* partition, size_t offset, size_t size);
+
+
+/**********************
+ *   GLOBAL FUNCTIONS
+ **********************/
+const esp_partition_t* esp_partition_find_first(esp_partition_type_t type, esp_partition_subtype_t subtype, const char* label)
+{
+	const char* env = getenv("LVGL_HOST_ASSETS");
+	struct stat st;
+
+	if ((label != NULL) && (strcmp(label, capture.label) == 0)) {
+		return open_capture() ? &capture : NULL;
+	}
+	if ((type != assets.type) || ((subtype != ESP_PARTITION_SUBTYPE_ANY) && (subtype != assets.subtype)) ||
+		((label != NULL) && (strcmp(label, assets.label) != 0))) {
+		return NULL;
+	}
+	if (assets_fd < 0) {
+		assets_fd = open((env != NULL) ? env : HOST_ASSETS_BIN, O_RDONLY);
+		if (assets_fd < 0) return NULL;
+		if ((fstat(assets_fd, &st) != 0) || (st.st_size == 0)) {
+			close(assets_fd);
+			assets_fd = -1;
+			return NULL;
+		}
+		assets.size = st.st_size;
+	}
+	return &assets;
+}
+
+
+esp_err_t esp_partition_mmap(const esp_partition_t* partition, size_t offset, size_t size,
+	spi_flash_mmap_memory_t memory, const void** out_ptr, spi_flash_mmap_handle_t* out_handle)
+{
+	// Keep to one mapping, at an offset the page size divides
+	if ((partition != &assets) || (mapped != NULL) || (offset % sysconf(_SC_PAGESIZE) != 0) ||
+		(offset + size > partition->size)) {
+		return ESP_ERR_INVALID_ARG;
+	}
+	mapped = mmap(NULL, size, PROT_READ, MAP_PRIVATE, assets_fd, offset);
+	if (mapped == MAP_FAILED) {
+		mapped = NULL;
+		return ESP_ERR_NO_MEM;
+	}
+	mapped_len = size;
+	*out_ptr = mapped;
+	*out_handle = 1;
+	return ESP_OK;
+}
+
+
+void spi_flash_munmap(spi_flash_mmap_handle_t handle)
+{
+	if (mapped != NULL) {
+		munmap(mapped, mapped_len);
+		mapped = NULL;
+	}
+}
+
+
+esp_err_t esp_partition_read(const esp_partition_t* partition, size_t src_offset, void* dst, size_t size)
+{
+	int fd = (partition == &capture) ? capture_fd : assets_fd;
+
+	if (!in_partition(partition, src_offset, size) || (pread(fd, dst, size, src_offset) != (ssize_t) size)) {
+		return ESP_ERR_INVALID_ARG;
+	}
+	return ESP_OK;
+}
+
+
+// Only the capture partition is writable
+esp_err_t esp_partition_write(const esp_partition_t* partition, size_t dst_offset, const void* src, size_t size)
+{
+	if ((partition != &capture) || !in_partition(partition, dst_offset, size) ||
+		(pwrite(capture_fd, src, size, dst_offset) != (ssize_t) size)) {
+		return ESP_ERR_INVALID_ARG;
+	}
+	return ESP_OK;
+}
+
+
+esp_err_t esp_partition_erase_range(const esp_partition_t* partition, size_t offset, size_t size)
+{
+	uint8_t erased[SECTOR_SIZE];
+	size_t pos;
+
+	if ((partition != &capture) || !in_partition(partition, offset, size) || (offset % SECTOR_SIZE != 0) ||
+		(size % SECTOR_SIZE != 0)) {
+		return ESP_ERR_INVALID_ARG;
+	}
+	memset(erased, 0xFF, sizeof(erased));
+	for (pos=offset; pos < offset + size; pos += SECTOR_SIZE) {
+		if (pwrite(capture_fd, erased, SECTOR_SIZE, pos) != SECTOR_SIZE) return ESP_FAIL;
+	}
+	return ESP_OK;
+}
+
+
+/**********************
+ *   STATIC FUNCTIONS
+ **********************/
+// Opens the capture partition's file, creating it erased if it isn't there
+static bool open_capture()
+{
+	const char* env = getenv("LVGL_HOST_CAPTURE");
+	struct stat st;
+
+	if (capture_fd >= 0) return true;
+	capture_fd = open((env != NULL) ? env : HOST_CAPTURE_BIN, O_RDWR | O_CREAT, 0644);
+	if (capture_fd < 0) return false;
+	if ((fstat(capture_fd, &st) == 0) && (st.st_size < CAPTURE_SIZE)) {
+		if ((ftruncate(capture_fd, CAPTURE_SIZE) != 0) ||
+			(esp_partition_erase_range(&capture, 0, CAPTURE_SIZE) != ESP_OK)) {
+			close(capture_fd);
+			capture_fd = -1;
+			return false;
+		}
+	}
+	return true;
+}
+
+
+static bool in_partition(const esp_partition_t* partition, size_t offset, size_t size)
+{
+	return ((partition == &assets) || (partition == &capture)) && (offset + size <= partition->size);
+}
@@ -0,0 +1,529 @@
+/**
+* FreeRTOS on POSIX threads for the host build
+*
+* Each task is a detached thread with its own notification count.  Threads that
+* weren't created as tasks, such as the one running main(), get a task the first
+* time they ask for their handle.  Queues and semaphores are a ring of items guarded
+* by a mutex with condition variables on the monotonic clock for timeouts.
+*
+*/
+
+/*********************
+ *      INCLUDES
+ *********************/
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+#include "esp_freertos_hooks.h"
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <time.h>
+#include <sched.h>
+
+
+/**********************
+ *      TYPEDEFS
+ **********************/
+typedef struct host_task
+{
+	pthread_t thread;
+	char name[configMAX_TASK_NAME_LEN];
+	TaskFunction_t fn;
+	void* arg;
+	UBaseType_t prio;
+	UBaseType_t number;
+	BaseType_t core;
+	uint32_t notify;
+	pthread_mutex_t lock;
+	pthread_cond_t cond;
+	struct host_task* next;
+} host_task_t;
+
+struct host_queue
+{
+	pthread_mutex_t lock;
+	pthread_cond_t not_empty;
+	pthread_cond_t not_full;
+	UBaseType_t len;
+	UBaseType_t item_size;
+	UBaseType_t count;
+	UBaseType_t head;          // Index of the oldest item
+	uint8_t* items;
+};
+
+
+/**********************
+ *  STATIC VARIABLES
+ **********************/
+static pthread_mutex_t tasks_lock = PTHREAD_MUTEX_INITIALIZER;
+static host_task_t* tasks = NULL;
+static UBaseType_t num_tasks = 0;
+static UBaseType_t next_number = 1;
+static __thread host_task_t* current = NULL;
+static pthread_once_t start_once = PTHREAD_ONCE_INIT;
+static struct timespec start_time;
+static esp_freertos_tick_cb_t tick_hook = NULL;
+
+
+/**********************
+ *  STATIC PROTOTYPES
+ **********************/
+static void host_start(void);
+static uint64_t host_now_us(void);
+static void host_deadline(struct timespec* ts, TickType_t ticks);
+static void host_cond_init(pthread_cond_t* cond);
+static host_task_t* task_new(const char* name, TaskFunction_t fn, void* arg, UBaseType_t prio, BaseType_t core);
+static void* task_thread(void* arg);
+static void tick_task(void* arg);
+static BaseType_t queue_send(QueueHandle_t queue, const void* item, TickType_t ticks, bool front);
+static BaseType_t queue_receive(QueueHandle_t queue, void* item, TickType_t ticks, bool peek);
+
+
+/**********************
+ *   GLOBAL FUNCTIONS
+ **********************/
+BaseType_t xPortGetCoreID(void)
+{
+	return sched_getcpu() & 1;
+}
+
+
+esp_err_t esp_register_freertos_tick_hook(esp_freertos_tick_cb_t cb)
+{
+	if (tick_hook != NULL) return ESP_ERR_NO_MEM;
+	tick_hook = cb;
+	xTaskCreate(tick_task, "tick", 2048, NULL, configMAX_PRIORITIES - 1, NULL);
+	return ESP_OK;
+}
+
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t fn, const char* name, uint32_t stack, void* arg,
+	UBaseType_t prio, TaskHandle_t* handle, BaseType_t core)
+{
+	host_task_t* t = task_new(name, fn, arg, prio, core);
+	pthread_attr_t attr;
+
+	// The host's stack frames are larger, so the ESP32 stack sizes are ignored
+	(void) stack;
+	if (handle) *handle = t;
+	pthread_attr_init(&attr);
+	pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+	if (pthread_create(&t->thread, &attr, task_thread, t) != 0) {
+		fprintf(stderr, "Could not start task %s\n", name);
+		abort();
+	}
+	pthread_attr_destroy(&attr);
+	return pdPASS;
+}
+
+
+BaseType_t xTaskCreate(TaskFunction_t fn, const char* name, uint32_t stack, void* arg,
+	UBaseType_t prio, TaskHandle_t* handle)
+{
+	return xTaskCreatePinnedToCore(fn, name, stack, arg, prio, handle, tskNO_AFFINITY);
+}
+
+
+#if configSUPPORT_STATIC_ALLOCATION
+// The task runs on its thread's own stack, the buffers given are left unused
+TaskHandle_t xTaskCreateStaticPinnedToCore(TaskFunction_t fn, const char* name, uint32_t stack, void* arg,
+	UBaseType_t prio, StackType_t* stack_buf, StaticTask_t* task_buf, BaseType_t core)
+{
+	TaskHandle_t handle;
+
+	(void) stack_buf;
+	(void) task_buf;
+	xTaskCreatePinnedToCore(fn, name, stack, arg, prio, &handle, core);
+	return handle;
+}
+
+
+TaskHandle_t xTaskCreateStatic(TaskFunction_t fn, const char* name, uint32_t stack, void* arg,
+	UBaseType_t prio, StackType_t* stack_buf, StaticTask_t* task_buf)
+{
+	return xTaskCreateStaticPinnedToCore(fn, name, stack, arg, prio, stack_buf, task_buf, tskNO_AFFINITY);
+}
+#endif
+
+
+// Only a task deleting itself is supported
+void vTaskDelete(TaskHandle_t task)
+{
+	host_task_t* t = (task != NULL) ? task : xTaskGetCurrentTaskHandle();
+	host_task_t** p;
+
+	pthread_mutex_lock(&tasks_lock);
+	for (p = &tasks; *p != NULL; p = &(*p)->next) {
+		if (*p == t) {
+			*p = t->next;
+			num_tasks--;
+			break;
+		}
+	}
+	pthread_mutex_unlock(&tasks_lock);
+	if (t == current) pthread_exit(NULL);
+}
+
+
+void vTaskDelay(TickType_t ticks)
+{
+	struct timespec ts;
+
+	host_deadline(&ts, ticks);
+	while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) != 0);
+}
+
+
+void vTaskDelayUntil(TickType_t* prev, TickType_t increment)
+{
+	TickType_t wait;
+
+	*prev += increment;
+	wait = *prev - xTaskGetTickCount();
+	if ((int32_t) wait > 0) {
+		vTaskDelay(wait);
+	}
+}
+
+
+TickType_t xTaskGetTickCount(void)
+{
+	return (TickType_t) (host_now_us() / (1000 * portTICK_PERIOD_MS));
+}
+
+
+TaskHandle_t xTaskGetCurrentTaskHandle(void)
+{
+	if (current == NULL) {
+		current = task_new("main", NULL, NULL, 1, tskNO_AFFINITY);
+		current->thread = pthread_self();
+	}
+	return current;
+}
+
+
+char* pcTaskGetTaskName(TaskHandle_t task)
+{
+	host_task_t* t = (task != NULL) ? task : xTaskGetCurrentTaskHandle();
+
+	return t->name;
+}
+
+
+BaseType_t xTaskNotifyGive(TaskHandle_t task)
+{
+	host_task_t* t = task;
+
+	pthread_mutex_lock(&t->lock);
+	t->notify++;
+	pthread_cond_signal(&t->cond);
+	pthread_mutex_unlock(&t->lock);
+	return pdPASS;
+}
+
+
+uint32_t ulTaskNotifyTake(BaseType_t clear, TickType_t ticks)
+{
+	host_task_t* t = xTaskGetCurrentTaskHandle();
+	struct timespec ts;
+	uint32_t n;
+
+	host_deadline(&ts, ticks);
+	pthread_mutex_lock(&t->lock);
+	while (t->notify == 0) {
+		if (ticks == portMAX_DELAY) {
+			pthread_cond_wait(&t->cond, &t->lock);
+		} else if ((ticks == 0) || (pthread_cond_timedwait(&t->cond, &t->lock, &ts) != 0)) {
+			break;
+		}
+	}
+	n = t->notify;
+	if (n > 0) {
+		t->notify = clear ? 0 : n - 1;
+	}
+	pthread_mutex_unlock(&t->lock);
+	return n;
+}
+
+
+UBaseType_t uxTaskGetNumberOfTasks(void)
+{
+	return num_tasks;
+}
+
+
+// Reports each task's CPU time for run time statistics.  Stack use isn't measured.
+UBaseType_t uxTaskGetSystemState(TaskStatus_t* status, UBaseType_t max, uint32_t* total_time)
+{
+	host_task_t* t;
+	clockid_t clock;
+	struct timespec ts;
+	UBaseType_t n = 0;
+
+	pthread_mutex_lock(&tasks_lock);
+	for (t = tasks; (t != NULL) && (n < max); t = t->next) {
+		memset(&status[n], 0, sizeof(TaskStatus_t));
+		status[n].xHandle = t;
+		status[n].pcTaskName = t->name;
+		status[n].xTaskNumber = t->number;
+		status[n].eCurrentState = (t == current) ? eRunning : eBlocked;
+		status[n].uxCurrentPriority = t->prio;
+		status[n].uxBasePriority = t->prio;
+		status[n].xCoreID = t->core;
+		if ((pthread_getcpuclockid(t->thread, &clock) == 0) && (clock_gettime(clock, &ts) == 0)) {
+			status[n].ulRunTimeCounter = (uint32_t) (ts.tv_sec * 1000000ull + ts.tv_nsec / 1000);
+		}
+		n++;
+	}
+	pthread_mutex_unlock(&tasks_lock);
+	if (total_time) *total_time = (uint32_t) host_now_us();
+	return n;
+}
+
+
+UBaseType_t uxTaskGetStackHighWaterMark(TaskHandle_t task)
+{
+	return 0;
+}
+
+
+QueueHandle_t xQueueCreate(UBaseType_t len, UBaseType_t item_size)
+{
+	QueueHandle_t q = calloc(1, sizeof(struct host_queue));
+
+	pthread_once(&start_once, host_start);
+	pthread_mutex_init(&q->lock, NULL);
+	host_cond_init(&q->not_empty);
+	host_cond_init(&q->not_full);
+	q->len = len;
+	q->item_size = item_size;
+	q->items = (item_size > 0) ? malloc(len * item_size) : NULL;
+	return q;
+}
+
+
+#if configSUPPORT_STATIC_ALLOCATION
+// The items are kept in memory of the queue's own, the buffers given are left unused
+QueueHandle_t xQueueCreateStatic(UBaseType_t len, UBaseType_t item_size, uint8_t* storage, StaticQueue_t* queue_buf)
+{
+	(void) storage;
+	(void) queue_buf;
+	return xQueueCreate(len, item_size);
+}
+#endif
+
+
+SemaphoreHandle_t xSemaphoreCreateCounting(UBaseType_t max, UBaseType_t initial)
+{
+	QueueHandle_t q = xQueueCreate(max, 0);
+
+	q->count = initial;
+	return q;
+}
+
+
+void vQueueDelete(QueueHandle_t queue)
+{
+	pthread_mutex_destroy(&queue->lock);
+	pthread_cond_destroy(&queue->not_empty);
+	pthread_cond_destroy(&queue->not_full);
+	free(queue->items);
+	free(queue);
+}
+
+
+BaseType_t xQueueSendToBack(QueueHandle_t queue, const void* item, TickType_t ticks)
+{
+	return queue_send(queue, item, ticks, false);
+}
+
+
+BaseType_t xQueueSendToFront(QueueHandle_t queue, const void* item, TickType_t ticks)
+{
+	return queue_send(queue, item, ticks, true);
+}
+
+
+BaseType_t xQueueReceive(QueueHandle_t queue, void* item, TickType_t ticks)
+{
+	return queue_receive(queue, item, ticks, false);
+}
+
+
+BaseType_t xQueuePeek(QueueHandle_t queue, void* item, TickType_t ticks)
+{
+	return queue_receive(queue, item, ticks, true);
+}
+
+
+UBaseType_t uxQueueMessagesWaiting(QueueHandle_t queue)
+{
+	UBaseType_t n;
+
+	pthread_mutex_lock(&queue->lock);
+	n = queue->count;
+	pthread_mutex_unlock(&queue->lock);
+	return n;
+}
+
+
+UBaseType_t uxQueueSpacesAvailable(QueueHandle_t queue)
+{
+	UBaseType_t n;
+
+	pthread_mutex_lock(&queue->lock);
+	n = queue->len - queue->count;
+	pthread_mutex_unlock(&queue->lock);
+	return n;
+}
+
+
+/**********************
+ *   STATIC FUNCTIONS
+ **********************/
+static void host_start(void)
+{
+	clock_gettime(CLOCK_MONOTONIC, &start_time);
+}
+
+
+// Microseconds since the first task or queue was created
+static uint64_t host_now_us(void)
+{
+	struct timespec ts;
+
+	pthread_once(&start_once, host_start);
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t) (ts.tv_sec - start_time.tv_sec) * 1000000 + (ts.tv_nsec - start_time.tv_nsec) / 1000;
+}
+
+
+// Load ts with the monotonic clock time ticks from now
+static void host_deadline(struct timespec* ts, TickType_t ticks)
+{
+	uint64_t ns;
+
+	clock_gettime(CLOCK_MONOTONIC, ts);
+	if (ticks == portMAX_DELAY) return;
+	ns = (uint64_t) ticks * portTICK_PERIOD_MS * 1000000 + ts->tv_nsec;
+	ts->tv_sec += ns / 1000000000;
+	ts->tv_nsec = ns % 1000000000;
+}
+
+
+static void host_cond_init(pthread_cond_t* cond)
+{
+	pthread_condattr_t attr;
+
+	pthread_condattr_init(&attr);
+	pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+	pthread_cond_init(cond, &attr);
+	pthread_condattr_destroy(&attr);
+}
+
+
+static host_task_t* task_new(const char* name, TaskFunction_t fn, void* arg, UBaseType_t prio, BaseType_t core)
+{
+	host_task_t* t = calloc(1, sizeof(host_task_t));
+
+	pthread_once(&start_once, host_start);
+	strncpy(t->name, name, sizeof(t->name) - 1);
+	t->fn = fn;
+	t->arg = arg;
+	t->prio = prio;
+	t->core = core;
+	pthread_mutex_init(&t->lock, NULL);
+	host_cond_init(&t->cond);
+
+	pthread_mutex_lock(&tasks_lock);
+	t->number = next_number++;
+	t->next = tasks;
+	tasks = t;
+	num_tasks++;
+	pthread_mutex_unlock(&tasks_lock);
+	return t;
+}
+
+
+static void* task_thread(void* arg)
+{
+	host_task_t* t = arg;
+
+	current = t;
+	pthread_setname_np(pthread_self(), t->name);
+	t->fn(t->arg);
+	vTaskDelete(NULL);
+	return NULL;
+}
+
+
+// Calls the tick hook once a tick, catching up on ticks missed while descheduled
+static void tick_task(void* arg)
+{
+	TickType_t prev = xTaskGetTickCount();
+
+	for (;;) {
+		vTaskDelayUntil(&prev, 1);
+		tick_hook();
+	}
+}
+
+
+static BaseType_t queue_send(QueueHandle_t q, const void* item, TickType_t ticks, bool front)
+{
+	struct timespec ts;
+	UBaseType_t i;
+
+	host_deadline(&ts, ticks);
+	pthread_mutex_lock(&q->lock);
+	while (q->count == q->len) {
+		if (ticks == portMAX_DELAY) {
+			pthread_cond_wait(&q->not_full, &q->lock);
+		} else if ((ticks == 0) || (pthread_cond_timedwait(&q->not_full, &q->lock, &ts) != 0)) {
+			pthread_mutex_unlock(&q->lock);
+			return pdFALSE;
+		}
+	}
+	if (q->item_size > 0) {
+		if (front) {
+			q->head = (q->head + q->len - 1) % q->len;
+			i = q->head;
+		} else {
+			i = (q->head + q->count) % q->len;
+		}
+		memcpy(&q->items[i * q->item_size], item, q->item_size);
+	}
+	q->count++;
+	pthread_cond_signal(&q->not_empty);
+	pthread_mutex_unlock(&q->lock);
+	return pdTRUE;
+}
+
+
+static BaseType_t queue_receive(QueueHandle_t q, void* item, TickType_t ticks, bool peek)
+{
+	struct timespec ts;
+
+	host_deadline(&ts, ticks);
+	pthread_mutex_lock(&q->lock);
+	while (q->count == 0) {
+		if (ticks == portMAX_DELAY) {
+			pthread_cond_wait(&q->not_empty, &q->lock);
+		} else if ((ticks == 0) || (pthread_cond_timedwait(&q->not_empty, &q->lock, &ts) != 0)) {
+			pthread_mutex_unlock(&q->lock);
+			return pdFALSE;
+		}
+	}
+	if (q->item_size > 0) {
+		memcpy(item, &q->items[q->head * q->item_size], q->item_size);
+	}
+	if (!peek) {
+		q->head = (q->item_size > 0) ? (q->head + 1) % q->len : 0;
+		q->count--;
+		pthread_cond_signal(&q->not_full);
+	}
+	pthread_mutex_unlock(&q->lock);
+	return pdTRUE;
+}
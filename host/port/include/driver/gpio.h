@@ -0,0 +1,56 @@
+/**
+* ESP-IDF GPIO driver for the host build
+*
+* There are no pins, levels set are ignored.
+*
+*/
+#ifndef DRIVER_GPIO_H
+#define DRIVER_GPIO_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*********************
+ *      INCLUDES
+ *********************/
+#include <stdint.h>
+#include "esp_err.h"
+
+
+/**********************
+ *      TYPEDEFS
+ **********************/
+typedef int gpio_num_t;
+
+typedef enum
+{
+	GPIO_MODE_DISABLE,
+	GPIO_MODE_INPUT,
+	GPIO_MODE_OUTPUT,
+} gpio_mode_t;
+
+
+/**********************
+ * GLOBAL PROTOTYPES
+ **********************/
+static inline void gpio_pad_select_gpio(uint8_t gpio_num)
+{
+}
+
+static inline esp_err_t gpio_set_direction(gpio_num_t gpio_num, gpio_mode_t mode)
+{
+	return ESP_OK;
+}
+
+static inline esp_err_t gpio_set_level(gpio_num_t gpio_num, uint32_t level)
+{
+	return ESP_OK;
+}
+
+
+#ifdef __cplusplus
+} /* extern "C" */
+#endif
+
+#endif /* DRIVER_GPIO_H */
@@ -0,0 +1,113 @@
+/**
+* ESP-IDF SPI master driver for the host build
+*
+* Transactions are taken in turn by a task standing in for the bus, which waits the
+* time they would take at the device's clock before calling its callbacks, so a
+* driver sending by DMA sees its transfers overlap its other work as on the ESP32.
+* Nothing is attached, what is sent is dropped.
+*
+*/
+#ifndef DRIVER_SPI_MASTER_H
+#define DRIVER_SPI_MASTER_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*********************
+ *      INCLUDES
+ *********************/
+#include <stdint.h>
+#include <stddef.h>
+#include "esp_err.h"
+#include "freertos/FreeRTOS.h"
+
+
+/*********************
+ *      DEFINES
+ *********************/
+#define SPI_TRANS_USE_RXDATA (1 << 2)
+#define SPI_TRANS_USE_TXDATA (1 << 3)
+
+
+/**********************
+ *      TYPEDEFS
+ **********************/
+typedef enum
+{
+	SPI_HOST = 0,
+	HSPI_HOST = 1,
+	VSPI_HOST = 2,
+} spi_host_device_t;
+
+typedef struct spi_transaction_t spi_transaction_t;
+typedef void (*transaction_cb_t)(spi_transaction_t* trans);
+
+struct spi_transaction_t
+{
+	uint32_t flags;
+	uint16_t cmd;
+	uint64_t addr;
+	size_t length;
+	size_t rxlength;
+	void* user;
+	union {
+		const void* tx_buffer;
+		uint8_t tx_data[4];
+	};
+	union {
+		void* rx_buffer;
+		uint8_t rx_data[4];
+	};
+};
+
+typedef struct
+{
+	int mosi_io_num;
+	int miso_io_num;
+	int sclk_io_num;
+	int quadwp_io_num;
+	int quadhd_io_num;
+	int max_transfer_sz;
+	uint32_t flags;
+	int intr_flags;
+} spi_bus_config_t;
+
+typedef struct
+{
+	uint8_t command_bits;
+	uint8_t address_bits;
+	uint8_t dummy_bits;
+	uint8_t mode;
+	uint16_t duty_cycle_pos;
+	uint16_t cs_ena_pretrans;
+	uint8_t cs_ena_posttrans;
+	int clock_speed_hz;
+	int input_delay_ns;
+	int spics_io_num;
+	uint32_t flags;
+	int queue_size;
+	transaction_cb_t pre_cb;
+	transaction_cb_t post_cb;
+} spi_device_interface_config_t;
+
+typedef struct host_spi_device* spi_device_handle_t;
+
+
+/**********************
+ * GLOBAL PROTOTYPES
+ **********************/
+esp_err_t spi_bus_initialize(spi_host_device_t host, const spi_bus_config_t* bus_config, int dma_chan);
+esp_err_t spi_bus_add_device(spi_host_device_t host, const spi_device_interface_config_t* dev_config,
+	spi_device_handle_t* handle);
+esp_err_t spi_device_queue_trans(spi_device_handle_t handle, spi_transaction_t* trans_desc, TickType_t ticks_to_wait);
+esp_err_t spi_device_get_trans_result(spi_device_handle_t handle, spi_transaction_t** trans_desc,
+	TickType_t ticks_to_wait);
+esp_err_t spi_device_transmit(spi_device_handle_t handle, spi_transaction_t* trans_desc);
+
+
+#ifdef __cplusplus
+} /* extern "C" */
+#endif
+
+#endif /* DRIVER_SPI_MASTER_H */
@@ -0,0 +1,90 @@
+/**
+* ESP-IDF UART driver for the host build
+*
+*/
+#ifndef DRIVER_UART_H
+#define DRIVER_UART_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*********************
+ *      INCLUDES
+ *********************/
+#include <stdint.h>
+#include <stddef.h>
+#include "esp_err.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+
+
+/*********************
+ *      DEFINES
+ *********************/
+#define UART_PIN_NO_CHANGE (-1)
+
+
+/**********************
+ *      TYPEDEFS
+ **********************/
+typedef int uart_port_t;
+
+typedef enum
+{
+	UART_DATA_5_BITS,
+	UART_DATA_6_BITS,
+	UART_DATA_7_BITS,
+	UART_DATA_8_BITS,
+} uart_word_length_t;
+
+typedef enum
+{
+	UART_PARITY_DISABLE,
+	UART_PARITY_EVEN = 2,
+	UART_PARITY_ODD,
+} uart_parity_t;
+
+typedef enum
+{
+	UART_STOP_BITS_1 = 1,
+	UART_STOP_BITS_1_5,
+	UART_STOP_BITS_2,
+} uart_stop_bits_t;
+
+typedef enum
+{
+	UART_HW_FLOWCTRL_DISABLE,
+	UART_HW_FLOWCTRL_RTS,
+	UART_HW_FLOWCTRL_CTS,
+	UART_HW_FLOWCTRL_CTS_RTS,
+} uart_hw_flowcontrol_t;
+
+typedef struct
+{
+	int baud_rate;
+	uart_word_length_t data_bits;
+	uart_parity_t parity;
+	uart_stop_bits_t stop_bits;
+	uart_hw_flowcontrol_t flow_ctrl;
+	uint8_t rx_flow_ctrl_thresh;
+} uart_config_t;
+
+
+/**********************
+ * GLOBAL PROTOTYPES
+ **********************/
+esp_err_t uart_param_config(uart_port_t uart_num, const uart_config_t* uart_config);
+esp_err_t uart_set_pin(uart_port_t uart_num, int tx_io_num, int rx_io_num, int rts_io_num, int cts_io_num);
+esp_err_t uart_driver_install(uart_port_t uart_num, int rx_buffer_size, int tx_buffer_size, int queue_size,
+	QueueHandle_t* uart_queue, int intr_alloc_flags);
+int uart_read_bytes(uart_port_t uart_num, uint8_t* buf, uint32_t length, TickType_t ticks_to_wait);
+int uart_write_bytes(uart_port_t uart_num, const char* src, size_t size);
+esp_err_t uart_get_buffered_data_len(uart_port_t uart_num, size_t* size);
+
+
+#ifdef __cplusplus
+} /* extern "C" */
+#endif
+
+#endif /* DRIVER_UART_H */
@@ -0,0 +1,13 @@
+/**
+* ESP-IDF placement attributes for the host build, which has no IRAM
+*
+*/
+#ifndef ESP_ATTR_H
+#define ESP_ATTR_H
+
+#define IRAM_ATTR
+#define DRAM_ATTR
+#define RTC_DATA_ATTR
+#define EXT_RAM_ATTR
+
+#endif /* ESP_ATTR_H */
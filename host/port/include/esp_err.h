@@ -0,0 +1,42 @@
+/**
+* ESP-IDF error codes for the host build
+*
+*/
+#ifndef ESP_ERR_H
+#define ESP_ERR_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*********************
+ *      INCLUDES
+ *********************/
+#include <stdint.h>
+#include <stdlib.h>
+
+
+/*********************
+ *      DEFINES
+ *********************/
+#define ESP_OK                0
+#define ESP_FAIL             -1
+#define ESP_ERR_NO_MEM        0x101
+#define ESP_ERR_INVALID_ARG   0x102
+#define ESP_ERR_INVALID_STATE 0x103
+#define ESP_ERR_TIMEOUT       0x107
+
+#define ESP_ERROR_CHECK(x) do { if ((x) != ESP_OK) abort(); } while (0)
+
+
+/**********************
+ *      TYPEDEFS
+ **********************/
+typedef int32_t esp_err_t;
+
+
+#ifdef __cplusplus
+} /* extern "C" */
+#endif
+
+#endif /* ESP_ERR_H */
@@ -0,0 +1,35 @@
+/**
+* ESP-IDF FreeRTOS hooks for the host build
+*
+*/
+#ifndef ESP_FREERTOS_HOOKS_H
+#define ESP_FREERTOS_HOOKS_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*********************
+ *      INCLUDES
+ *********************/
+#include "esp_err.h"
+
+
+/**********************
+ *      TYPEDEFS
+ **********************/
+typedef void (*esp_freertos_tick_cb_t)(void);
+
+
+/**********************
+ * GLOBAL PROTOTYPES
+ **********************/
+// The hook runs once a tick on a thread of its own
+esp_err_t esp_register_freertos_tick_hook(esp_freertos_tick_cb_t cb);
+
+
+#ifdef __cplusplus
+} /* extern "C" */
+#endif
+
+#endif /* ESP_FREERTOS_HOOKS_H */
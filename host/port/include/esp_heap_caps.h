@@ -0,0 +1,74 @@
+/**
+* ESP-IDF capability based heap for the host build
+*
+* Allocations come from malloc but are counted against emulated regions so the
+* driver sizes its buffers as it would on the ESP32.  The internal region holds
+* HOST_HEAP_SIZE bytes.  There is no PSRAM unless HOST_SPIRAM_SIZE is set, in which
+* case MALLOC_CAP_SPIRAM allocations are counted against a second region.
+*
+*/
+#ifndef ESP_HEAP_CAPS_H
+#define ESP_HEAP_CAPS_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*********************
+ *      INCLUDES
+ *********************/
+#include <stdint.h>
+#include <stddef.h>
+
+
+/*********************
+ *      DEFINES
+ *********************/
+#ifndef HOST_HEAP_SIZE
+#define HOST_HEAP_SIZE      (280 * 1024)
+#endif
+#ifndef HOST_SPIRAM_SIZE
+#define HOST_SPIRAM_SIZE    0
+#endif
+
+#define MALLOC_CAP_EXEC     (1 << 0)
+#define MALLOC_CAP_32BIT    (1 << 1)
+#define MALLOC_CAP_8BIT     (1 << 2)
+#define MALLOC_CAP_DMA      (1 << 3)
+#define MALLOC_CAP_SPIRAM   (1 << 10)
+#define MALLOC_CAP_INTERNAL (1 << 11)
+#define MALLOC_CAP_DEFAULT  (1 << 12)
+
+
+/**********************
+ *      TYPEDEFS
+ **********************/
+typedef struct
+{
+	size_t total_free_bytes;
+	size_t total_allocated_bytes;
+	size_t largest_free_block;
+	size_t minimum_free_bytes;
+	size_t allocated_blocks;
+	size_t free_blocks;
+	size_t total_blocks;
+} multi_heap_info_t;
+
+
+/**********************
+ * GLOBAL PROTOTYPES
+ **********************/
+void* heap_caps_malloc(size_t size, uint32_t caps);
+void* heap_caps_malloc_prefer(size_t size, size_t num, ...);
+void heap_caps_free(void* ptr);
+size_t heap_caps_get_free_size(uint32_t caps);
+size_t heap_caps_get_minimum_free_size(uint32_t caps);
+size_t heap_caps_get_largest_free_block(uint32_t caps);
+void heap_caps_get_info(multi_heap_info_t* info, uint32_t caps);
+
+
+#ifdef __cplusplus
+} /* extern "C" */
+#endif
+
+#endif /* ESP_HEAP_CAPS_H */
@@ -0,0 +1,55 @@
+/**
+* ESP-IDF logging on stdout for the host build
+*
+* Messages above CONFIG_LOG_DEFAULT_LEVEL are compiled out, as they are on the ESP32.
+*
+*/
+#ifndef ESP_LOG_H
+#define ESP_LOG_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*********************
+ *      INCLUDES
+ *********************/
+#include <stdint.h>
+#include "sdkconfig.h"
+
+
+/*********************
+ *      DEFINES
+ *********************/
+#define ESP_LOG_NONE    0
+#define ESP_LOG_ERROR   1
+#define ESP_LOG_WARN    2
+#define ESP_LOG_INFO    3
+#define ESP_LOG_DEBUG   4
+#define ESP_LOG_VERBOSE 5
+
+#define ESP_LOG_LEVEL(level, letter, tag, format, ...) do { \
+		if (CONFIG_LOG_DEFAULT_LEVEL >= (level)) { \
+			esp_log_write(level, tag, letter " (%u) %s: " format "\n", esp_log_timestamp(), tag, ##__VA_ARGS__); \
+		} \
+	} while (0)
+
+#define ESP_LOGE(tag, format, ...) ESP_LOG_LEVEL(ESP_LOG_ERROR, "E", tag, format, ##__VA_ARGS__)
+#define ESP_LOGW(tag, format, ...) ESP_LOG_LEVEL(ESP_LOG_WARN, "W", tag, format, ##__VA_ARGS__)
+#define ESP_LOGI(tag, format, ...) ESP_LOG_LEVEL(ESP_LOG_INFO, "I", tag, format, ##__VA_ARGS__)
+#define ESP_LOGD(tag, format, ...) ESP_LOG_LEVEL(ESP_LOG_DEBUG, "D", tag, format, ##__VA_ARGS__)
+#define ESP_LOGV(tag, format, ...) ESP_LOG_LEVEL(ESP_LOG_VERBOSE, "V", tag, format, ##__VA_ARGS__)
+
+
+/**********************
+ * GLOBAL PROTOTYPES
+ **********************/
+uint32_t esp_log_timestamp(void);
+void esp_log_write(int level, const char* tag, const char* format, ...) __attribute__ ((format (printf, 3, 4)));
+
+
+#ifdef __cplusplus
+} /* extern "C" */
+#endif
+
+#endif /* ESP_LOG_H */
@@ -0,0 +1,30 @@
+/**
+* ESP-IDF system functions for the host build
+*
+*/
+#ifndef ESP_SYSTEM_H
+#define ESP_SYSTEM_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*********************
+ *      INCLUDES
+ *********************/
+#include <stdint.h>
+#include "esp_err.h"
+
+
+/**********************
+ * GLOBAL PROTOTYPES
+ **********************/
+uint32_t esp_random(void);
+void esp_restart(void) __attribute__ ((noreturn));
+
+
+#ifdef __cplusplus
+} /* extern "C" */
+#endif
+
+#endif /* ESP_SYSTEM_H */
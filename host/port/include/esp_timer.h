@@ -0,0 +1,29 @@
+/**
+* ESP-IDF high resolution time for the host build
+*
+*/
+#ifndef ESP_TIMER_H
+#define ESP_TIMER_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*********************
+ *      INCLUDES
+ *********************/
+#include <stdint.h>
+#include "esp_err.h"
+
+
+/**********************
+ * GLOBAL PROTOTYPES
+ **********************/
+int64_t esp_timer_get_time(void);
+
+
+#ifdef __cplusplus
+} /* extern "C" */
+#endif
+
+#endif /* ESP_TIMER_H */
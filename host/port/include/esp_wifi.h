@@ -0,0 +1,79 @@
+/**
+* ESP-IDF soft-AP station list and power settings for the host build
+*
+*/
+#ifndef ESP_WIFI_H
+#define ESP_WIFI_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*********************
+ *      INCLUDES
+ *********************/
+#include <stdint.h>
+#include "esp_err.h"
+
+
+/*********************
+ *      DEFINES
+ *********************/
+#define ESP_WIFI_MAX_CONN_NUM 10
+
+
+/**********************
+ *      TYPEDEFS
+ **********************/
+typedef enum
+{
+	WIFI_IF_STA = 0,
+	WIFI_IF_AP,
+} wifi_interface_t;
+
+typedef enum
+{
+	WIFI_PS_NONE,
+	WIFI_PS_MIN_MODEM,
+	WIFI_PS_MAX_MODEM,
+} wifi_ps_type_t;
+
+typedef enum
+{
+	WIFI_BW_HT20 = 1,
+	WIFI_BW_HT40,
+} wifi_bandwidth_t;
+
+typedef struct
+{
+	uint8_t mac[6];
+	int8_t rssi;
+	uint32_t phy_11b:1;
+	uint32_t phy_11g:1;
+	uint32_t phy_11n:1;
+	uint32_t phy_lr:1;
+	uint32_t reserved:28;
+} wifi_sta_info_t;
+
+typedef struct
+{
+	wifi_sta_info_t sta[ESP_WIFI_MAX_CONN_NUM];
+	int num;
+} wifi_sta_list_t;
+
+
+/**********************
+ * GLOBAL PROTOTYPES
+ **********************/
+esp_err_t esp_wifi_ap_get_sta_list(wifi_sta_list_t* sta);
+esp_err_t esp_wifi_set_ps(wifi_ps_type_t type);
+esp_err_t esp_wifi_set_bandwidth(wifi_interface_t ifx, wifi_bandwidth_t bw);
+esp_err_t esp_wifi_get_max_tx_power(int8_t* power);
+esp_err_t esp_wifi_set_max_tx_power(int8_t power);
+
+
+#ifdef __cplusplus
+} /* extern "C" */
+#endif
+
+#endif /* ESP_WIFI_H */
@@ -0,0 +1,108 @@
+/**
+* FreeRTOS on POSIX threads for the host build
+*
+* Implements the part of the FreeRTOS API used by the websocket driver and server with
+* pthreads so the same sources run on Linux.  Tasks are threads, priorities and core
+* affinity are ignored and a tick is 1000 / CONFIG_FREERTOS_HZ mS of the monotonic
+* clock.
+*
+*/
+#ifndef FREERTOS_H
+#define FREERTOS_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*********************
+ *      INCLUDES
+ *********************/
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <pthread.h>
+#include "sdkconfig.h"
+#include "esp_attr.h"
+
+
+/*********************
+ *      DEFINES
+ *********************/
+#define configTICK_RATE_HZ        CONFIG_FREERTOS_HZ
+#define configMAX_PRIORITIES      25
+#define configMAX_TASK_NAME_LEN   CONFIG_FREERTOS_MAX_TASK_NAME_LEN
+
+#ifdef CONFIG_FREERTOS_USE_TRACE_FACILITY
+#define configUSE_TRACE_FACILITY  1
+#else
+#define configUSE_TRACE_FACILITY  0
+#endif
+#ifdef CONFIG_SUPPORT_STATIC_ALLOCATION
+#define configSUPPORT_STATIC_ALLOCATION 1
+#else
+#define configSUPPORT_STATIC_ALLOCATION 0
+#endif
+#ifdef CONFIG_FREERTOS_GENERATE_RUN_TIME_STATS
+#define configGENERATE_RUN_TIME_STATS 1
+#else
+#define configGENERATE_RUN_TIME_STATS 0
+#endif
+
+#define portMAX_DELAY             ((TickType_t) 0xFFFFFFFF)
+#define portTICK_PERIOD_MS        ((TickType_t) (1000 / configTICK_RATE_HZ))
+#define portTICK_RATE_MS          portTICK_PERIOD_MS
+#define portNUM_PROCESSORS        2
+#define pdMS_TO_TICKS(ms)         ((TickType_t) (((uint64_t) (ms) * configTICK_RATE_HZ) / 1000))
+
+#define pdFALSE                   0
+#define pdTRUE                    1
+#define pdPASS                    pdTRUE
+#define pdFAIL                    pdFALSE
+
+#define tskNO_AFFINITY            0x7FFFFFFF
+
+// Critical sections nest, as they do on the ESP32
+#define portMUX_INITIALIZER_UNLOCKED { PTHREAD_RECURSIVE_MUTEX_INITIALIZER_NP }
+#define portENTER_CRITICAL(mux)   pthread_mutex_lock(&(mux)->lock)
+#define portEXIT_CRITICAL(mux)    pthread_mutex_unlock(&(mux)->lock)
+#define portENTER_CRITICAL_ISR(mux) portENTER_CRITICAL(mux)
+#define portEXIT_CRITICAL_ISR(mux) portEXIT_CRITICAL(mux)
+#define portYIELD_FROM_ISR()      do {} while (0)
+
+
+/**********************
+ *      TYPEDEFS
+ **********************/
+typedef int BaseType_t;
+typedef unsigned int UBaseType_t;
+typedef uint32_t TickType_t;
+typedef uint8_t StackType_t;
+
+// Storage given to the static create functions, which the host doesn't use
+typedef struct
+{
+	void* unused[4];
+} StaticTask_t;
+
+typedef struct
+{
+	void* unused[4];
+} StaticQueue_t;
+
+typedef struct
+{
+	pthread_mutex_t lock;
+} portMUX_TYPE;
+
+
+/**********************
+ * GLOBAL PROTOTYPES
+ **********************/
+BaseType_t xPortGetCoreID(void);
+
+
+#ifdef __cplusplus
+} /* extern "C" */
+#endif
+
+#endif /* FREERTOS_H */
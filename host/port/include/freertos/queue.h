@@ -0,0 +1,46 @@
+/**
+* FreeRTOS queues on POSIX threads for the host build
+*
+*/
+#ifndef QUEUE_H
+#define QUEUE_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*********************
+ *      INCLUDES
+ *********************/
+#include "FreeRTOS.h"
+
+
+/**********************
+ *      TYPEDEFS
+ **********************/
+typedef struct host_queue* QueueHandle_t;
+
+
+/**********************
+ * GLOBAL PROTOTYPES
+ **********************/
+QueueHandle_t xQueueCreate(UBaseType_t len, UBaseType_t item_size);
+#if configSUPPORT_STATIC_ALLOCATION
+QueueHandle_t xQueueCreateStatic(UBaseType_t len, UBaseType_t item_size, uint8_t* storage, StaticQueue_t* queue_buf);
+#endif
+void vQueueDelete(QueueHandle_t queue);
+BaseType_t xQueueSendToBack(QueueHandle_t queue, const void* item, TickType_t ticks);
+BaseType_t xQueueSendToFront(QueueHandle_t queue, const void* item, TickType_t ticks);
+BaseType_t xQueueReceive(QueueHandle_t queue, void* item, TickType_t ticks);
+BaseType_t xQueuePeek(QueueHandle_t queue, void* item, TickType_t ticks);
+UBaseType_t uxQueueMessagesWaiting(QueueHandle_t queue);
+UBaseType_t uxQueueSpacesAvailable(QueueHandle_t queue);
+
+#define xQueueSend(q, item, ticks) xQueueSendToBack(q, item, ticks)
+
+
+#ifdef __cplusplus
+} /* extern "C" */
+#endif
+
+#endif /* QUEUE_H */
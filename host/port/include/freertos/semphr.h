@@ -0,0 +1,44 @@
+/**
+* FreeRTOS semaphores for the host build
+*
+* As in FreeRTOS, semaphores are queues of empty items: a mutex starts with its one
+* item available, a binary semaphore without it.
+*
+*/
+#ifndef SEMPHR_H
+#define SEMPHR_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*********************
+ *      INCLUDES
+ *********************/
+#include "queue.h"
+
+
+/**********************
+ *      TYPEDEFS
+ **********************/
+typedef QueueHandle_t SemaphoreHandle_t;
+
+
+/**********************
+ * GLOBAL PROTOTYPES
+ **********************/
+SemaphoreHandle_t xSemaphoreCreateCounting(UBaseType_t max, UBaseType_t initial);
+
+#define xSemaphoreCreateBinary()      xSemaphoreCreateCounting(1, 0)
+#define xSemaphoreCreateMutex()       xSemaphoreCreateCounting(1, 1)
+#define xSemaphoreTake(sem, ticks)    xQueueReceive(sem, NULL, ticks)
+#define xSemaphoreGive(sem)           xQueueSendToBack(sem, NULL, 0)
+#define xSemaphoreGiveFromISR(sem, w) xQueueSendToBack(sem, NULL, 0)
+#define vSemaphoreDelete(sem)         vQueueDelete(sem)
+
+
+#ifdef __cplusplus
+} /* extern "C" */
+#endif
+
+#endif /* SEMPHR_H */
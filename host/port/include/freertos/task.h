@@ -0,0 +1,78 @@
+/**
+* FreeRTOS tasks on POSIX threads for the host build
+*
+*/
+#ifndef TASK_H
+#define TASK_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*********************
+ *      INCLUDES
+ *********************/
+#include "FreeRTOS.h"
+
+
+/**********************
+ *      TYPEDEFS
+ **********************/
+typedef void* TaskHandle_t;
+typedef void (*TaskFunction_t)(void*);
+
+typedef enum
+{
+	eRunning = 0,
+	eReady,
+	eBlocked,
+	eSuspended,
+	eDeleted
+} eTaskState;
+
+typedef struct
+{
+	TaskHandle_t xHandle;
+	const char* pcTaskName;
+	UBaseType_t xTaskNumber;
+	eTaskState eCurrentState;
+	UBaseType_t uxCurrentPriority;
+	UBaseType_t uxBasePriority;
+	uint32_t ulRunTimeCounter;      // Thread CPU time in uS
+	StackType_t* pxStackBase;
+	uint32_t usStackHighWaterMark;  // Not measured, always 0
+	BaseType_t xCoreID;
+} TaskStatus_t;
+
+
+/**********************
+ * GLOBAL PROTOTYPES
+ **********************/
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t fn, const char* name, uint32_t stack, void* arg,
+	UBaseType_t prio, TaskHandle_t* handle, BaseType_t core);
+BaseType_t xTaskCreate(TaskFunction_t fn, const char* name, uint32_t stack, void* arg,
+	UBaseType_t prio, TaskHandle_t* handle);
+#if configSUPPORT_STATIC_ALLOCATION
+TaskHandle_t xTaskCreateStaticPinnedToCore(TaskFunction_t fn, const char* name, uint32_t stack, void* arg,
+	UBaseType_t prio, StackType_t* stack_buf, StaticTask_t* task_buf, BaseType_t core);
+TaskHandle_t xTaskCreateStatic(TaskFunction_t fn, const char* name, uint32_t stack, void* arg,
+	UBaseType_t prio, StackType_t* stack_buf, StaticTask_t* task_buf);
+#endif
+void vTaskDelete(TaskHandle_t task);
+void vTaskDelay(TickType_t ticks);
+void vTaskDelayUntil(TickType_t* prev, TickType_t increment);
+TickType_t xTaskGetTickCount(void);
+TaskHandle_t xTaskGetCurrentTaskHandle(void);
+char* pcTaskGetTaskName(TaskHandle_t task);
+BaseType_t xTaskNotifyGive(TaskHandle_t task);
+uint32_t ulTaskNotifyTake(BaseType_t clear, TickType_t ticks);
+UBaseType_t uxTaskGetNumberOfTasks(void);
+UBaseType_t uxTaskGetSystemState(TaskStatus_t* status, UBaseType_t max, uint32_t* total_time);
+UBaseType_t uxTaskGetStackHighWaterMark(TaskHandle_t task);
+
+
+#ifdef __cplusplus
+} /* extern "C" */
+#endif
+
+#endif /* TASK_H */
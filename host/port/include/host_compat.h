@@ -0,0 +1,31 @@
+/**
+* C library functions newlib provides and glibc may not, included ahead of every
+* source file in the host build
+*
+*/
+#ifndef HOST_COMPAT_H
+#define HOST_COMPAT_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*********************
+ *      INCLUDES
+ *********************/
+#include <stddef.h>
+
+
+/**********************
+ * GLOBAL PROTOTYPES
+ **********************/
+size_t host_strlcpy(char* dst, const char* src, size_t size);
+
+#define strlcpy host_strlcpy
+
+
+#ifdef __cplusplus
+} /* extern "C" */
+#endif
+
+#endif /* HOST_COMPAT_H */
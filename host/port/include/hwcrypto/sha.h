@@ -0,0 +1,41 @@
+/**
+* The SHA accelerator's one-shot hash, for the websocket handshake in the host build
+*
+*/
+#ifndef HWCRYPTO_SHA_H
+#define HWCRYPTO_SHA_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*********************
+ *      INCLUDES
+ *********************/
+#include <stddef.h>
+
+
+/**********************
+ *      TYPEDEFS
+ **********************/
+typedef enum {
+	SHA1 = 0,
+	SHA2_256,
+	SHA2_384,
+	SHA2_512,
+	SHA_TYPE_MAX
+} esp_sha_type;
+
+
+/**********************
+ * GLOBAL PROTOTYPES
+ **********************/
+// Only SHA1 is implemented
+void esp_sha(esp_sha_type sha_type, const unsigned char* input, size_t ilen, unsigned char* output);
+
+
+#ifdef __cplusplus
+} /* extern "C" */
+#endif
+
+#endif /* HWCRYPTO_SHA_H */
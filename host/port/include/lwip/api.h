@@ -0,0 +1,138 @@
+/**
+* lwIP netconn API on POSIX sockets for the host build
+*
+* A netconn wraps a socket.  Accepted connections get a reader thread that queues
+* what arrives as netbufs and raises NETCONN_EVT_RCVPLUS on the connection's
+* callback, as the lwIP thread does on the ESP32.  Only TCP is supported.
+*
+*/
+#ifndef LWIP_API_H
+#define LWIP_API_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*********************
+ *      INCLUDES
+ *********************/
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>              // Pulled in by lwIP's port headers on the ESP32
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include "lwip/err.h"
+#include "lwip/ip_addr.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+
+
+/*********************
+ *      DEFINES
+ *********************/
+#define NETCONN_NOFLAG    0x00
+#define NETCONN_NOCOPY    0x00
+#define NETCONN_COPY      0x01
+#define NETCONN_MORE      0x02
+#define NETCONN_DONTBLOCK 0x04
+
+
+/**********************
+ *      TYPEDEFS
+ **********************/
+typedef int8_t s8_t;
+typedef uint8_t u8_t;
+typedef int16_t s16_t;
+typedef uint16_t u16_t;
+typedef int32_t s32_t;
+typedef uint32_t u32_t;
+
+enum netconn_type
+{
+	NETCONN_TCP = 0x10
+};
+
+enum netconn_evt
+{
+	NETCONN_EVT_RCVPLUS,
+	NETCONN_EVT_RCVMINUS,
+	NETCONN_EVT_SENDPLUS,
+	NETCONN_EVT_SENDMINUS,
+	NETCONN_EVT_ERROR
+};
+
+struct netconn;
+typedef void (*netconn_callback)(struct netconn*, enum netconn_evt, u16_t len);
+
+struct tcp_pcb
+{
+	int fd;                         // Socket for TCP_NODELAY
+};
+
+struct netconn
+{
+	enum netconn_type type;
+	union
+	{
+		struct tcp_pcb* tcp;
+	} pcb;
+	int socket;                     // Free for the application, as with lwIP's sockets layer
+	netconn_callback callback;
+	s32_t send_timeout;             // mS, 0 to block
+	int recv_timeout;               // mS, 0 to block
+	bool nonblocking;
+	struct tcp_pcb tcp;
+	QueueHandle_t rx_queue;         // Received netbufs, NULL marks the end of the stream
+	bool rx_closed;
+	volatile bool closing;
+	bool has_reader;
+	pthread_t reader;
+};
+
+struct netbuf
+{
+	void* data;
+	u16_t len;
+};
+
+struct netvector
+{
+	const void* ptr;
+	size_t len;
+};
+
+
+/**********************
+ * GLOBAL PROTOTYPES
+ **********************/
+struct netconn* netconn_new(enum netconn_type type);
+err_t netconn_bind(struct netconn* conn, const ip_addr_t* addr, u16_t port);
+err_t netconn_listen(struct netconn* conn);
+err_t netconn_accept(struct netconn* conn, struct netconn** new_conn);
+err_t netconn_connect(struct netconn* conn, const ip_addr_t* addr, u16_t port);
+err_t netconn_recv(struct netconn* conn, struct netbuf** new_buf);
+err_t netconn_write_partly(struct netconn* conn, const void* data, size_t len, u8_t flags, size_t* written);
+err_t netconn_write_vectors_partly(struct netconn* conn, struct netvector* vectors, u16_t vectorcnt,
+	u8_t flags, size_t* written);
+err_t netconn_close(struct netconn* conn);
+err_t netconn_delete(struct netconn* conn);
+void netconn_set_nonblocking(struct netconn* conn, int val);
+void netconn_set_recvtimeout(struct netconn* conn, int timeout);
+void netconn_set_sendtimeout(struct netconn* conn, s32_t timeout);
+err_t netconn_getaddr(struct netconn* conn, ip_addr_t* addr, u16_t* port, u8_t local);
+err_t netconn_gethostbyname(const char* name, ip_addr_t* addr);
+err_t netbuf_data(struct netbuf* buf, void** data, u16_t* len);
+void netbuf_delete(struct netbuf* buf);
+s8_t netbuf_next(struct netbuf* buf);
+
+#define netconn_write(conn, data, len, flags) netconn_write_partly(conn, data, len, flags, NULL)
+#define netconn_peer(conn, addr, port) netconn_getaddr(conn, addr, port, 0)
+#define netconn_addr(conn, addr, port) netconn_getaddr(conn, addr, port, 1)
+
+
+#ifdef __cplusplus
+} /* extern "C" */
+#endif
+
+#endif /* LWIP_API_H */
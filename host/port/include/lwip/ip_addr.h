@@ -0,0 +1,43 @@
+/**
+* lwIP addresses for the host build
+*
+*/
+#ifndef LWIP_IP_ADDR_H
+#define LWIP_IP_ADDR_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*********************
+ *      INCLUDES
+ *********************/
+#include <stdint.h>
+#include <arpa/inet.h>
+
+
+/**********************
+ *      TYPEDEFS
+ **********************/
+// Addresses are in network byte order, as in lwIP
+typedef struct
+{
+	uint32_t addr;
+} ip4_addr_t;
+
+typedef ip4_addr_t ip_addr_t;
+
+
+/**********************
+ *      MACROS
+ **********************/
+#define ip_2_ip4(ipaddr) (ipaddr)
+#define IP_ADDR4(ipaddr, a, b, c, d) \
+	((ipaddr)->addr = htonl(((uint32_t) (a) << 24) | ((uint32_t) (b) << 16) | ((uint32_t) (c) << 8) | (uint32_t) (d)))
+
+
+#ifdef __cplusplus
+} /* extern "C" */
+#endif
+
+#endif /* LWIP_IP_ADDR_H */
@@ -0,0 +1,38 @@
+/**
+* lwIP TCP options for the host build
+*
+*/
+#ifndef LWIP_TCP_H
+#define LWIP_TCP_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*********************
+ *      INCLUDES
+ *********************/
+#include "lwip/api.h"
+#include "sdkconfig.h"
+
+
+/*********************
+ *      DEFINES
+ *********************/
+// Each connection's send buffer, as lwIP sizes it
+#define TCP_SND_BUF CONFIG_TCP_SND_BUF_DEFAULT
+
+
+/**********************
+ * GLOBAL PROTOTYPES
+ **********************/
+void tcp_nagle_disable(struct tcp_pcb* pcb);
+void tcp_nagle_enable(struct tcp_pcb* pcb);
+u16_t tcp_sndbuf(struct tcp_pcb* pcb);
+
+
+#ifdef __cplusplus
+} /* extern "C" */
+#endif
+
+#endif /* LWIP_TCP_H */
@@ -0,0 +1,34 @@
+/**
+* Base64 encoding for the websocket handshake in the host build
+*
+*/
+#ifndef MBEDTLS_BASE64_H
+#define MBEDTLS_BASE64_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*********************
+ *      INCLUDES
+ *********************/
+#include <stddef.h>
+
+
+/*********************
+ *      DEFINES
+ *********************/
+#define MBEDTLS_ERR_BASE64_BUFFER_TOO_SMALL -0x002A
+
+
+/**********************
+ * GLOBAL PROTOTYPES
+ **********************/
+int mbedtls_base64_encode(unsigned char* dst, size_t dlen, size_t* olen, const unsigned char* src, size_t slen);
+
+
+#ifdef __cplusplus
+} /* extern "C" */
+#endif
+
+#endif /* MBEDTLS_BASE64_H */
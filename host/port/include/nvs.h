@@ -0,0 +1,57 @@
+/**
+* ESP-IDF non-volatile storage for the host build, see port/nvs.c
+*
+*/
+#ifndef NVS_H
+#define NVS_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*********************
+ *      INCLUDES
+ *********************/
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_err.h"
+
+
+/*********************
+ *      DEFINES
+ *********************/
+#define ESP_ERR_NVS_BASE       0x1100
+#define ESP_ERR_NVS_NOT_FOUND  (ESP_ERR_NVS_BASE + 0x02)
+#define ESP_ERR_NVS_INVALID_LENGTH (ESP_ERR_NVS_BASE + 0x0c)
+
+// Longest namespace and key names
+#define NVS_KEY_NAME_MAX_SIZE 16
+
+
+/**********************
+ *      TYPEDEFS
+ **********************/
+typedef uint32_t nvs_handle;
+
+typedef enum {
+	NVS_READONLY,
+	NVS_READWRITE
+} nvs_open_mode;
+
+
+/**********************
+ * GLOBAL PROTOTYPES
+ **********************/
+esp_err_t nvs_open(const char* name, nvs_open_mode open_mode, nvs_handle* out_handle);
+esp_err_t nvs_get_blob(nvs_handle handle, const char* key, void* out_value, size_t* length);
+esp_err_t nvs_set_blob(nvs_handle handle, const char* key, const void* value, size_t length);
+esp_err_t nvs_erase_key(nvs_handle handle, const char* key);
+esp_err_t nvs_commit(nvs_handle handle);
+void nvs_close(nvs_handle handle);
+
+
+#ifdef __cplusplus
+} /* extern "C" */
+#endif
+
+#endif /* NVS_H */
@@ -0,0 +1,47 @@
+/**
+* ESP-IDF soft-AP DHCP leases for the host build
+*
+*/
+#ifndef TCPIP_ADAPTER_H
+#define TCPIP_ADAPTER_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*********************
+ *      INCLUDES
+ *********************/
+#include <stdint.h>
+#include "esp_err.h"
+#include "esp_wifi.h"
+#include "lwip/ip_addr.h"
+
+
+/**********************
+ *      TYPEDEFS
+ **********************/
+typedef struct
+{
+	uint8_t mac[6];
+	ip4_addr_t ip;
+} tcpip_adapter_sta_info_t;
+
+typedef struct
+{
+	tcpip_adapter_sta_info_t sta[ESP_WIFI_MAX_CONN_NUM];
+	int num;
+} tcpip_adapter_sta_list_t;
+
+
+/**********************
+ * GLOBAL PROTOTYPES
+ **********************/
+esp_err_t tcpip_adapter_get_sta_list(const wifi_sta_list_t* wifi_sta_list, tcpip_adapter_sta_list_t* tcpip_sta_list);
+
+
+#ifdef __cplusplus
+} /* extern "C" */
+#endif
+
+#endif /* TCPIP_ADAPTER_H */
@@ -0,0 +1,37 @@
+/**
+* Xtensa cycle counter for the host build
+*
+* Counts nanoseconds instead of CPU cycles, wrapping at 32 bits like the ESP32's.
+*
+*/
+#ifndef XTENSA_HAL_H
+#define XTENSA_HAL_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*********************
+ *      INCLUDES
+ *********************/
+#include <stdint.h>
+#include <time.h>
+
+
+/**********************
+ * GLOBAL PROTOTYPES
+ **********************/
+static inline uint32_t xthal_get_ccount(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint32_t) ((uint64_t) ts.tv_sec * 1000000000u + ts.tv_nsec);
+}
+
+
+#ifdef __cplusplus
+} /* extern "C" */
+#endif
+
+#endif /* XTENSA_HAL_H */
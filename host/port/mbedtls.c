@@ -0,0 +1,144 @@
+/**
+* SHA-1, in place of the SHA accelerator, and base64 encoding for the websocket
+* handshake in the host build
+*
+*/
+
+/*********************
+ *      INCLUDES
+ *********************/
+#include "hwcrypto/sha.h"
+#include "mbedtls/base64.h"
+#include <stdint.h>
+#include <string.h>
+
+
+/*********************
+ *      DEFINES
+ *********************/
+#define ROL(x, n) (((x) << (n)) | ((x) >> (32 - (n))))
+
+
+/**********************
+ *  STATIC VARIABLES
+ **********************/
+static const char base64_chars[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+
+/**********************
+ *  STATIC PROTOTYPES
+ **********************/
+static void sha1_block(uint32_t* h, const unsigned char* block);
+
+
+/**********************
+ *   GLOBAL FUNCTIONS
+ **********************/
+void esp_sha(esp_sha_type sha_type, const unsigned char* input, size_t len, unsigned char* output)
+{
+	uint32_t h[5] = { 0x67452301, 0xEFCDAB89, 0x98BADCFE, 0x10325476, 0xC3D2E1F0 };
+	unsigned char block[64];
+	uint64_t bits = (uint64_t) len * 8;
+	size_t i;
+
+	(void) sha_type;
+	for (; len >= 64; input += 64, len -= 64) {
+		sha1_block(h, input);
+	}
+
+	// The remainder, a 1 bit, zeros and the length in bits fill one or two blocks
+	memset(block, 0, sizeof(block));
+	memcpy(block, input, len);
+	block[len] = 0x80;
+	if (len >= 56) {
+		sha1_block(h, block);
+		memset(block, 0, sizeof(block));
+	}
+	for (i=0; i<8; i++) {
+		block[63 - i] = (unsigned char) (bits >> (8 * i));
+	}
+	sha1_block(h, block);
+
+	for (i=0; i<20; i++) {
+		output[i] = (unsigned char) (h[i / 4] >> (24 - 8 * (i % 4)));
+	}
+}
+
+
+// Like mbedtls, reports the length needed including the terminator in olen when dst
+// is too small
+int mbedtls_base64_encode(unsigned char* dst, size_t dlen, size_t* olen, const unsigned char* src, size_t slen)
+{
+	size_t need = 4 * ((slen + 2) / 3) + 1;
+	size_t i;
+	uint32_t v;
+	unsigned char* p = dst;
+
+	if ((dst == NULL) || (dlen < need)) {
+		*olen = need;
+		return MBEDTLS_ERR_BASE64_BUFFER_TOO_SMALL;
+	}
+	for (i=0; i<slen; i+=3) {
+		v = (uint32_t) src[i] << 16;
+		if (i + 1 < slen) v |= (uint32_t) src[i + 1] << 8;
+		if (i + 2 < slen) v |= src[i + 2];
+		*p++ = base64_chars[(v >> 18) & 0x3F];
+		*p++ = base64_chars[(v >> 12) & 0x3F];
+		*p++ = (i + 1 < slen) ? base64_chars[(v >> 6) & 0x3F] : '=';
+		*p++ = (i + 2 < slen) ? base64_chars[v & 0x3F] : '=';
+	}
+	*p = '\0';
+	*olen = p - dst;
+	return 0;
+}
+
+
+/**********************
+ *   STATIC FUNCTIONS
+ **********************/
+static void sha1_block(uint32_t* h, const unsigned char* block)
+{
+	uint32_t w[80];
+	uint32_t a, b, c, d, e, f, k, t;
+	int i;
+
+	for (i=0; i<16; i++) {
+		w[i] = (uint32_t) block[4 * i] << 24 | (uint32_t) block[4 * i + 1] << 16 |
+			(uint32_t) block[4 * i + 2] << 8 | block[4 * i + 3];
+	}
+	for (i=16; i<80; i++) {
+		w[i] = ROL(w[i - 3] ^ w[i - 8] ^ w[i - 14] ^ w[i - 16], 1);
+	}
+
+	a = h[0];
+	b = h[1];
+	c = h[2];
+	d = h[3];
+	e = h[4];
+	for (i=0; i<80; i++) {
+		if (i < 20) {
+			f = (b & c) | (~b & d);
+			k = 0x5A827999;
+		} else if (i < 40) {
+			f = b ^ c ^ d;
+			k = 0x6ED9EBA1;
+		} else if (i < 60) {
+			f = (b & c) | (b & d) | (c & d);
+			k = 0x8F1BBCDC;
+		} else {
+			f = b ^ c ^ d;
+			k = 0xCA62C1D6;
+		}
+		t = ROL(a, 5) + f + e + k + w[i];
+		e = d;
+		d = c;
+		c = ROL(b, 30);
+		b = a;
+		a = t;
+	}
+	h[0] += a;
+	h[1] += b;
+	h[2] += c;
+	h[3] += d;
+	h[4] += e;
+}
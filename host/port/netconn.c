@@ -0,0 +1,430 @@
+/**
+* lwIP netconn API on POSIX sockets for the host build
+*
+* Listening connections bind to the requested port plus 8000, so the web server's
+* port 80 becomes 8080 and the build runs without privileges.  LVGL_HOST_PORT in
+* the environment picks another port for the web server.
+*
+*/
+
+/*********************
+ *      INCLUDES
+ *********************/
+#include "lwip/api.h"
+#include "lwip/tcp.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/ioctl.h>
+#include <linux/sockios.h>
+#include <netdb.h>
+
+
+/*********************
+ *      DEFINES
+ *********************/
+// Largest netbuf the reader queues, about what a few TCP segments hold on the ESP32
+#define RX_CHUNK_LEN   2048
+
+// Netbufs a connection queues before its reader waits for them to be taken
+#define RX_QUEUE_LEN   32
+
+// How often a reader waiting on a full queue checks for the connection closing
+#define RX_RETRY_MS    100
+
+#define PORT_OFFSET    8000
+
+#define MAX_VECTORS    16
+
+
+/**********************
+ *  STATIC PROTOTYPES
+ **********************/
+static void* rx_thread(void* arg);
+static err_t map_errno(int err);
+
+
+/**********************
+ *   GLOBAL FUNCTIONS
+ **********************/
+struct netconn* netconn_new(enum netconn_type type)
+{
+	struct netconn* conn = calloc(1, sizeof(struct netconn));
+
+	conn->type = type;
+	conn->tcp.fd = -1;
+	conn->pcb.tcp = &conn->tcp;
+	conn->socket = -1;
+	return conn;
+}
+
+
+err_t netconn_bind(struct netconn* conn, const ip_addr_t* addr, u16_t port)
+{
+	struct sockaddr_in sa;
+	const char* env = getenv("LVGL_HOST_PORT");
+	int one = 1;
+
+	conn->tcp.fd = socket(AF_INET, SOCK_STREAM, 0);
+	if (conn->tcp.fd < 0) return map_errno(errno);
+	setsockopt(conn->tcp.fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+
+	memset(&sa, 0, sizeof(sa));
+	sa.sin_family = AF_INET;
+	sa.sin_addr.s_addr = (addr != NULL) ? addr->addr : htonl(INADDR_ANY);
+	sa.sin_port = htons((env != NULL && port == 80) ? atoi(env) : port + PORT_OFFSET);
+	if (bind(conn->tcp.fd, (struct sockaddr*) &sa, sizeof(sa)) != 0) {
+		fprintf(stderr, "Could not bind port %u: %s\n", ntohs(sa.sin_port), strerror(errno));
+		return ERR_USE;
+	}
+	printf("Listening on port %u\n", ntohs(sa.sin_port));
+	return ERR_OK;
+}
+
+
+err_t netconn_listen(struct netconn* conn)
+{
+	return (listen(conn->tcp.fd, 8) == 0) ? ERR_OK : map_errno(errno);
+}
+
+
+err_t netconn_accept(struct netconn* conn, struct netconn** new_conn)
+{
+	struct netconn* c;
+	int fd;
+
+	do {
+		fd = accept(conn->tcp.fd, NULL, NULL);
+	} while ((fd < 0) && (errno == EINTR));
+	if (fd < 0) return ERR_ABRT;
+
+	c = netconn_new(conn->type);
+	c->tcp.fd = fd;
+	c->rx_queue = xQueueCreate(RX_QUEUE_LEN, sizeof(struct netbuf*));
+	c->has_reader = (pthread_create(&c->reader, NULL, rx_thread, c) == 0);
+	*new_conn = c;
+	return ERR_OK;
+}
+
+
+// Connections to the device's own ports are offset as the ports it listens on
+err_t netconn_connect(struct netconn* conn, const ip_addr_t* addr, u16_t port)
+{
+	struct sockaddr_in sa;
+	const char* env = getenv("LVGL_HOST_PORT");
+	int ret;
+
+	conn->tcp.fd = socket(AF_INET, SOCK_STREAM, 0);
+	if (conn->tcp.fd < 0) return map_errno(errno);
+
+	memset(&sa, 0, sizeof(sa));
+	sa.sin_family = AF_INET;
+	sa.sin_addr.s_addr = addr->addr;
+	sa.sin_port = htons((env != NULL && port == 80) ? atoi(env) : port + PORT_OFFSET);
+	do {
+		ret = connect(conn->tcp.fd, (struct sockaddr*) &sa, sizeof(sa));
+	} while ((ret != 0) && (errno == EINTR));
+	if (ret != 0) return map_errno(errno);
+
+	conn->rx_queue = xQueueCreate(RX_QUEUE_LEN, sizeof(struct netbuf*));
+	conn->has_reader = (pthread_create(&conn->reader, NULL, rx_thread, conn) == 0);
+	return ERR_OK;
+}
+
+
+err_t netconn_recv(struct netconn* conn, struct netbuf** new_buf)
+{
+	TickType_t ticks;
+
+	*new_buf = NULL;
+	if (conn->rx_closed || (conn->rx_queue == NULL)) return ERR_CLSD;
+	if (conn->nonblocking) {
+		ticks = 0;
+	} else if (conn->recv_timeout > 0) {
+		ticks = (conn->recv_timeout + portTICK_PERIOD_MS - 1) / portTICK_PERIOD_MS;
+	} else {
+		ticks = portMAX_DELAY;
+	}
+	if (xQueueReceive(conn->rx_queue, new_buf, ticks) != pdTRUE) {
+		return conn->nonblocking ? ERR_WOULDBLOCK : ERR_TIMEOUT;
+	}
+	if (*new_buf == NULL) {
+		conn->rx_closed = true;
+		return ERR_CLSD;
+	}
+	return ERR_OK;
+}
+
+
+err_t netconn_write_partly(struct netconn* conn, const void* data, size_t len, u8_t flags, size_t* written)
+{
+	struct netvector vector;
+
+	vector.ptr = data;
+	vector.len = len;
+	return netconn_write_vectors_partly(conn, &vector, 1, flags, written);
+}
+
+
+// Writes everything unless written is given, when one send that makes progress is
+// enough.  When the send timeout passes first ERR_WOULDBLOCK is returned.
+err_t netconn_write_vectors_partly(struct netconn* conn, struct netvector* vectors, u16_t vectorcnt,
+	u8_t flags, size_t* written)
+{
+	struct iovec iov[MAX_VECTORS];
+	struct msghdr msg;
+	size_t total = 0;
+	size_t sent = 0;
+	size_t skip;
+	ssize_t n;
+	int send_flags = MSG_NOSIGNAL;
+	int i;
+
+	if (vectorcnt > MAX_VECTORS) return ERR_VAL;
+	if (flags & NETCONN_MORE) send_flags |= MSG_MORE;
+	if (conn->nonblocking || (flags & NETCONN_DONTBLOCK)) send_flags |= MSG_DONTWAIT;
+	for (i=0; i<vectorcnt; i++) {
+		total += vectors[i].len;
+	}
+
+	while (sent < total) {
+		// Describe what remains of the vectors
+		memset(&msg, 0, sizeof(msg));
+		msg.msg_iov = iov;
+		skip = sent;
+		for (i=0; i<vectorcnt; i++) {
+			if (skip >= vectors[i].len) {
+				skip -= vectors[i].len;
+				continue;
+			}
+			iov[msg.msg_iovlen].iov_base = (uint8_t*) vectors[i].ptr + skip;
+			iov[msg.msg_iovlen].iov_len = vectors[i].len - skip;
+			msg.msg_iovlen++;
+			skip = 0;
+		}
+
+		n = sendmsg(conn->tcp.fd, &msg, send_flags);
+		if (n < 0) {
+			if (errno == EINTR) continue;
+			if (written) *written = sent;
+			return map_errno(errno);
+		}
+		sent += n;
+		if (written) break;
+	}
+	if (written) *written = sent;
+	return ERR_OK;
+}
+
+
+// Stops both directions, which also ends the reader
+err_t netconn_close(struct netconn* conn)
+{
+	conn->closing = true;
+	if (conn->tcp.fd >= 0) {
+		shutdown(conn->tcp.fd, SHUT_RDWR);
+	}
+	return ERR_OK;
+}
+
+
+err_t netconn_delete(struct netconn* conn)
+{
+	struct netbuf* buf;
+
+	if (conn == NULL) return ERR_OK;
+	netconn_close(conn);
+	if (conn->has_reader) {
+		pthread_join(conn->reader, NULL);
+	}
+	if (conn->rx_queue != NULL) {
+		while (xQueueReceive(conn->rx_queue, &buf, 0) == pdTRUE) {
+			netbuf_delete(buf);
+		}
+		vQueueDelete(conn->rx_queue);
+	}
+	if (conn->tcp.fd >= 0) {
+		close(conn->tcp.fd);
+	}
+	free(conn);
+	return ERR_OK;
+}
+
+
+void netconn_set_nonblocking(struct netconn* conn, int val)
+{
+	conn->nonblocking = (val != 0);
+}
+
+
+void netconn_set_recvtimeout(struct netconn* conn, int timeout)
+{
+	conn->recv_timeout = timeout;
+}
+
+
+void netconn_set_sendtimeout(struct netconn* conn, s32_t timeout)
+{
+	struct timeval tv;
+
+	conn->send_timeout = timeout;
+	tv.tv_sec = timeout / 1000;
+	tv.tv_usec = (timeout % 1000) * 1000;
+	setsockopt(conn->tcp.fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+}
+
+
+err_t netconn_getaddr(struct netconn* conn, ip_addr_t* addr, u16_t* port, u8_t local)
+{
+	struct sockaddr_in sa;
+	socklen_t len = sizeof(sa);
+	int ret;
+
+	if (local) {
+		ret = getsockname(conn->tcp.fd, (struct sockaddr*) &sa, &len);
+	} else {
+		ret = getpeername(conn->tcp.fd, (struct sockaddr*) &sa, &len);
+	}
+	if ((ret != 0) || (sa.sin_family != AF_INET)) return ERR_CONN;
+	addr->addr = sa.sin_addr.s_addr;
+	*port = ntohs(sa.sin_port);
+	return ERR_OK;
+}
+
+
+err_t netconn_gethostbyname(const char* name, ip_addr_t* addr)
+{
+	struct addrinfo hints;
+	struct addrinfo* res;
+
+	memset(&hints, 0, sizeof(hints));
+	hints.ai_family = AF_INET;
+	hints.ai_socktype = SOCK_STREAM;
+	if ((getaddrinfo(name, NULL, &hints, &res) != 0) || (res == NULL)) return ERR_VAL;
+	addr->addr = ((struct sockaddr_in*) res->ai_addr)->sin_addr.s_addr;
+	freeaddrinfo(res);
+	return ERR_OK;
+}
+
+
+err_t netbuf_data(struct netbuf* buf, void** data, u16_t* len)
+{
+	*data = buf->data;
+	*len = buf->len;
+	return ERR_OK;
+}
+
+
+void netbuf_delete(struct netbuf* buf)
+{
+	if (buf == NULL) return;
+	free(buf->data);
+	free(buf);
+}
+
+
+// Each netbuf holds one chunk
+s8_t netbuf_next(struct netbuf* buf)
+{
+	return -1;
+}
+
+
+void tcp_nagle_disable(struct tcp_pcb* pcb)
+{
+	int one = 1;
+
+	setsockopt(pcb->fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+}
+
+
+void tcp_nagle_enable(struct tcp_pcb* pcb)
+{
+	int zero = 0;
+
+	setsockopt(pcb->fd, IPPROTO_TCP, TCP_NODELAY, &zero, sizeof(zero));
+}
+
+
+// The part of lwIP's send buffer a connection has free, from the bytes the kernel
+// holds unacknowledged
+u16_t tcp_sndbuf(struct tcp_pcb* pcb)
+{
+	int queued = 0;
+
+	if (ioctl(pcb->fd, SIOCOUTQ, &queued) < 0) queued = 0;
+	return (queued < TCP_SND_BUF) ? TCP_SND_BUF - queued : 0;
+}
+
+
+/**********************
+ *   STATIC FUNCTIONS
+ **********************/
+// Queues what arrives on a connection as netbufs, then NULL once it closes.  Each
+// netbuf is followed by a spare byte, which the websocket reader uses to terminate
+// messages in place.
+static void* rx_thread(void* arg)
+{
+	struct netconn* conn = arg;
+	struct netbuf* buf;
+	netconn_callback cb;
+	ssize_t n;
+	u16_t len;
+	bool done = false;
+
+	while (!done) {
+		buf = malloc(sizeof(struct netbuf));
+		buf->data = malloc(RX_CHUNK_LEN + 1);
+		do {
+			n = recv(conn->tcp.fd, buf->data, RX_CHUNK_LEN, 0);
+		} while ((n < 0) && (errno == EINTR));
+		if (n <= 0) {
+			netbuf_delete(buf);
+			buf = NULL;
+			done = true;
+		} else {
+			buf->len = n;
+			((char*) buf->data)[n] = '\0';
+		}
+
+		// The reader may free the netbuf as soon as it is queued
+		len = (buf != NULL) ? buf->len : 0;
+
+		// Give up on a full queue once the connection is shut down
+		while (xQueueSendToBack(conn->rx_queue, &buf, pdMS_TO_TICKS(RX_RETRY_MS)) != pdTRUE) {
+			if (conn->closing) {
+				netbuf_delete(buf);
+				return NULL;
+			}
+		}
+
+		cb = conn->callback;
+		if (cb) cb(conn, NETCONN_EVT_RCVPLUS, len);
+	}
+	return NULL;
+}
+
+
+static err_t map_errno(int err)
+{
+	switch (err) {
+		case EAGAIN:
+			return ERR_WOULDBLOCK;
+		case ECONNRESET:
+			return ERR_RST;
+		case EPIPE:
+		case ENOTCONN:
+			return ERR_CLSD;
+		case ENOMEM:
+		case ENOBUFS:
+			return ERR_MEM;
+		default:
+			return ERR_CONN;
+	}
+}
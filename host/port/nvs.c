@@ -0,0 +1,137 @@
+/**
+* ESP-IDF non-volatile storage for the host build
+*
+* Each blob is kept in a file of its own named after its namespace and key, build/nvs.
+* followed by them, or after the prefix LVGL_HOST_NVS in the environment gives, so
+* what is stored outlives the process as it would a restart.  Only blobs are
+* supported and each is written whole as it is set, making nvs_commit() a no-op.
+*
+*/
+
+/*********************
+ *      INCLUDES
+ *********************/
+#include "nvs.h"
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+
+/*********************
+ *      DEFINES
+ *********************/
+#ifndef HOST_NVS_PREFIX
+#define HOST_NVS_PREFIX "build/nvs."
+#endif
+
+// Namespaces that may be open at once
+#define MAX_HANDLES 4
+
+
+/**********************
+ *  STATIC VARIABLES
+ **********************/
+static char names[MAX_HANDLES][NVS_KEY_NAME_MAX_SIZE];
+
+
+/**********************
+ *  STATIC PROTOTYPES
+ **********************/
+static bool blob_path(nvs_handle handle, const char* key, char* path, size_t len);
+
+
+/**********************
+ *   GLOBAL FUNCTIONS
+ **********************/
+esp_err_t nvs_open(const char* name, nvs_open_mode open_mode, nvs_handle* out_handle)
+{
+	int i;
+	
+	(void) open_mode;
+	if (strlen(name) >= NVS_KEY_NAME_MAX_SIZE) return ESP_ERR_INVALID_ARG;
+	for (i=0; i<MAX_HANDLES; i++) {
+		if (names[i][0] == '\0') {
+			strcpy(names[i], name);
+			*out_handle = i + 1;
+			return ESP_OK;
+		}
+	}
+	return ESP_ERR_NO_MEM;
+}
+
+
+esp_err_t nvs_get_blob(nvs_handle handle, const char* key, void* out_value, size_t* length)
+{
+	char path[256];
+	FILE* f;
+	long size;
+	esp_err_t err = ESP_OK;
+	
+	if (!blob_path(handle, key, path, sizeof(path))) return ESP_ERR_INVALID_ARG;
+	f = fopen(path, "rb");
+	if (f == NULL) return ESP_ERR_NVS_NOT_FOUND;
+	fseek(f, 0, SEEK_END);
+	size = ftell(f);
+	rewind(f);
+	if (out_value != NULL) {
+		if ((size_t) size > *length) {
+			err = ESP_ERR_NVS_INVALID_LENGTH;
+		} else if (fread(out_value, 1, size, f) != (size_t) size) {
+			err = ESP_FAIL;
+		}
+	}
+	*length = size;
+	fclose(f);
+	return err;
+}
+
+
+esp_err_t nvs_set_blob(nvs_handle handle, const char* key, const void* value, size_t length)
+{
+	char path[256];
+	FILE* f;
+	bool ok;
+	
+	if (!blob_path(handle, key, path, sizeof(path))) return ESP_ERR_INVALID_ARG;
+	f = fopen(path, "wb");
+	if (f == NULL) return ESP_FAIL;
+	ok = (fwrite(value, 1, length, f) == length);
+	return ((fclose(f) == 0) && ok) ? ESP_OK : ESP_FAIL;
+}
+
+
+esp_err_t nvs_erase_key(nvs_handle handle, const char* key)
+{
+	char path[256];
+	
+	if (!blob_path(handle, key, path, sizeof(path))) return ESP_ERR_INVALID_ARG;
+	return (remove(path) == 0) ? ESP_OK : ESP_ERR_NVS_NOT_FOUND;
+}
+
+
+esp_err_t nvs_commit(nvs_handle handle)
+{
+	(void) handle;
+	return ESP_OK;
+}
+
+
+void nvs_close(nvs_handle handle)
+{
+	if ((handle >= 1) && (handle <= MAX_HANDLES)) names[handle - 1][0] = '\0';
+}
+
+
+/**********************
+ *   STATIC FUNCTIONS
+ **********************/
+// Put the name of the file holding the blob key of an open namespace in path
+static bool blob_path(nvs_handle handle, const char* key, char* path, size_t len)
+{
+	const char* prefix = getenv("LVGL_HOST_NVS");
+	
+	if ((handle < 1) || (handle > MAX_HANDLES) || (names[handle - 1][0] == '\0')) return false;
+	snprintf(path, len, "%s%s.%s", (prefix != NULL) ? prefix : HOST_NVS_PREFIX, names[handle - 1], key);
+	return true;
+}
@@ -0,0 +1,106 @@
+/**
+* ESP-IDF SPI master driver for the host build
+*
+* Each device has a task standing in for its bus, which takes the queued transactions
+* in turn and waits the time they would take at the device's clock, calling the pre
+* and post transfer callbacks around it as the driver's interrupt would.
+*
+*/
+
+/*********************
+ *      INCLUDES
+ *********************/
+#include "driver/spi_master.h"
+#include <stdlib.h>
+#include <time.h>
+#include "freertos/queue.h"
+#include "freertos/task.h"
+
+
+/**********************
+ *      TYPEDEFS
+ **********************/
+struct host_spi_device
+{
+	spi_device_interface_config_t config;
+	QueueHandle_t queued;
+	QueueHandle_t done;
+};
+
+
+/**********************
+ *  STATIC PROTOTYPES
+ **********************/
+static void bus_task(void* arg);
+
+
+/**********************
+ *   GLOBAL FUNCTIONS
+ **********************/
+esp_err_t spi_bus_initialize(spi_host_device_t host, const spi_bus_config_t* bus_config, int dma_chan)
+{
+	return ((host == HSPI_HOST) || (host == VSPI_HOST)) ? ESP_OK : ESP_ERR_INVALID_ARG;
+}
+
+
+esp_err_t spi_bus_add_device(spi_host_device_t host, const spi_device_interface_config_t* dev_config,
+	spi_device_handle_t* handle)
+{
+	struct host_spi_device* dev;
+
+	if ((dev_config->clock_speed_hz <= 0) || (dev_config->queue_size <= 0)) return ESP_ERR_INVALID_ARG;
+	dev = calloc(1, sizeof(struct host_spi_device));
+	if (dev == NULL) return ESP_ERR_NO_MEM;
+	dev->config = *dev_config;
+	dev->queued = xQueueCreate(dev_config->queue_size, sizeof(spi_transaction_t*));
+	dev->done = xQueueCreate(dev_config->queue_size, sizeof(spi_transaction_t*));
+	xTaskCreate(bus_task, "spi_bus", 2048, dev, configMAX_PRIORITIES - 1, NULL);
+	*handle = dev;
+	return ESP_OK;
+}
+
+
+esp_err_t spi_device_queue_trans(spi_device_handle_t handle, spi_transaction_t* trans_desc, TickType_t ticks_to_wait)
+{
+	return (xQueueSendToBack(handle->queued, &trans_desc, ticks_to_wait) == pdTRUE) ? ESP_OK : ESP_ERR_TIMEOUT;
+}
+
+
+esp_err_t spi_device_get_trans_result(spi_device_handle_t handle, spi_transaction_t** trans_desc,
+	TickType_t ticks_to_wait)
+{
+	return (xQueueReceive(handle->done, trans_desc, ticks_to_wait) == pdTRUE) ? ESP_OK : ESP_ERR_TIMEOUT;
+}
+
+
+esp_err_t spi_device_transmit(spi_device_handle_t handle, spi_transaction_t* trans_desc)
+{
+	spi_transaction_t* t;
+	esp_err_t err = spi_device_queue_trans(handle, trans_desc, portMAX_DELAY);
+
+	if (err != ESP_OK) return err;
+	return spi_device_get_trans_result(handle, &t, portMAX_DELAY);
+}
+
+
+/**********************
+ *   STATIC FUNCTIONS
+ **********************/
+static void bus_task(void* arg)
+{
+	struct host_spi_device* dev = (struct host_spi_device*) arg;
+	spi_transaction_t* t;
+	struct timespec ts;
+	uint64_t ns;
+
+	for (;;) {
+		xQueueReceive(dev->queued, &t, portMAX_DELAY);
+		if (dev->config.pre_cb) dev->config.pre_cb(t);
+		ns = (uint64_t) t->length * 1000000000ULL / dev->config.clock_speed_hz;
+		ts.tv_sec = ns / 1000000000ULL;
+		ts.tv_nsec = ns % 1000000000ULL;
+		nanosleep(&ts, NULL);
+		if (dev->config.post_cb) dev->config.post_cb(t);
+		xQueueSendToBack(dev->done, &t, portMAX_DELAY);
+	}
+}
@@ -0,0 +1,145 @@
+/**
+* ESP-IDF UART driver on pseudo terminals for the host build
+*
+* Each UART installed is a pseudo terminal whose name is printed, so a viewer opens
+* it as it would the USB-UART of a board.  Baud rates and pins are ignored.
+*
+*/
+
+/*********************
+ *      INCLUDES
+ *********************/
+#include "driver/uart.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <termios.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+
+
+/*********************
+ *      DEFINES
+ *********************/
+#define UART_NUM_MAX   3
+
+// How often a read checks for a viewer opening the terminal, in mS
+#define HANGUP_POLL_MS 10
+
+
+/**********************
+ *  STATIC VARIABLES
+ **********************/
+static int uart_fd[UART_NUM_MAX] = {-1, -1, -1};
+
+
+/**********************
+ *   GLOBAL FUNCTIONS
+ **********************/
+esp_err_t uart_param_config(uart_port_t uart_num, const uart_config_t* uart_config)
+{
+	return ((uart_num >= 0) && (uart_num < UART_NUM_MAX)) ? ESP_OK : ESP_FAIL;
+}
+
+
+esp_err_t uart_set_pin(uart_port_t uart_num, int tx_io_num, int rx_io_num, int rts_io_num, int cts_io_num)
+{
+	return ((uart_num >= 0) && (uart_num < UART_NUM_MAX)) ? ESP_OK : ESP_FAIL;
+}
+
+
+esp_err_t uart_driver_install(uart_port_t uart_num, int rx_buffer_size, int tx_buffer_size, int queue_size,
+	QueueHandle_t* uart_queue, int intr_alloc_flags)
+{
+	struct termios tio;
+	int fd;
+
+	if ((uart_num < 0) || (uart_num >= UART_NUM_MAX) || (uart_fd[uart_num] >= 0)) return ESP_FAIL;
+	fd = posix_openpt(O_RDWR | O_NOCTTY);
+	if ((fd < 0) || (grantpt(fd) != 0) || (unlockpt(fd) != 0)) {
+		if (fd >= 0) close(fd);
+		return ESP_FAIL;
+	}
+	// Pass bytes through untouched, as a UART does
+	tcgetattr(fd, &tio);
+	cfmakeraw(&tio);
+	tcsetattr(fd, TCSANOW, &tio);
+	uart_fd[uart_num] = fd;
+	printf("UART %d is %s\n", uart_num, ptsname(fd));
+	fflush(stdout);
+	return ESP_OK;
+}
+
+
+// Waits up to ticks_to_wait for each byte, as the IDF's does
+int uart_read_bytes(uart_port_t uart_num, uint8_t* buf, uint32_t length, TickType_t ticks_to_wait)
+{
+	struct pollfd p;
+	uint32_t copied = 0;
+	ssize_t n;
+	int ms = (ticks_to_wait == portMAX_DELAY) ? -1 : (int) (ticks_to_wait * portTICK_PERIOD_MS);
+	int waited = 0;
+
+	if ((uart_num < 0) || (uart_num >= UART_NUM_MAX) || (uart_fd[uart_num] < 0)) return -1;
+	p.fd = uart_fd[uart_num];
+	p.events = POLLIN;
+	while (copied < length) {
+		p.revents = 0;
+		if (poll(&p, 1, ms) < 0) {
+			if (errno == EINTR) continue;
+			break;
+		}
+		if (p.revents & POLLIN) {
+			n = read(p.fd, buf + copied, length - copied);
+			if (n <= 0) break;
+			copied += n;
+			waited = 0;
+		} else if (p.revents & POLLHUP) {
+			// No viewer has the other side open, so poll returns at once: wait in
+			// steps for one to open it
+			if ((ms >= 0) && (waited >= ms)) break;
+			usleep(HANGUP_POLL_MS * 1000);
+			waited += HANGUP_POLL_MS;
+		} else {
+			break;
+		}
+	}
+	return copied;
+}
+
+
+int uart_write_bytes(uart_port_t uart_num, const char* src, size_t size)
+{
+	size_t written = 0;
+	ssize_t n;
+
+	struct pollfd p;
+
+	if ((uart_num < 0) || (uart_num >= UART_NUM_MAX) || (uart_fd[uart_num] < 0)) return -1;
+	// With no viewer on the other side the bytes are lost, as on an unplugged UART
+	p.fd = uart_fd[uart_num];
+	p.events = POLLOUT;
+	if ((poll(&p, 1, 0) == 1) && (p.revents & POLLHUP)) return size;
+	while (written < size) {
+		n = write(uart_fd[uart_num], src + written, size - written);
+		if (n < 0) {
+			if (errno == EINTR) continue;
+			return -1;
+		}
+		written += n;
+	}
+	return written;
+}
+
+
+esp_err_t uart_get_buffered_data_len(uart_port_t uart_num, size_t* size)
+{
+	int n = 0;
+
+	if ((uart_num < 0) || (uart_num >= UART_NUM_MAX) || (uart_fd[uart_num] < 0)) return ESP_FAIL;
+	if (ioctl(uart_fd[uart_num], FIONREAD, &n) != 0) n = 0;
+	*size = n;
+	return ESP_OK;
+}
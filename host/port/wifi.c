@@ -0,0 +1,96 @@
+/**
+* ESP-IDF soft-AP station list and power settings for the host build
+*
+* There is one station, holding the loopback address so browsers on the same
+* machine are matched to it.  LVGL_HOST_RSSI in the environment sets the signal
+* strength it reports, -50 dBm by default, to try the weak link handling.  The power
+* settings are only kept, for the driver to read back.
+*
+*/
+
+/*********************
+ *      INCLUDES
+ *********************/
+#include "esp_wifi.h"
+#include "tcpip_adapter.h"
+#include <stdlib.h>
+#include <string.h>
+#include <arpa/inet.h>
+
+
+/*********************
+ *      DEFINES
+ *********************/
+#define DEFAULT_RSSI   -50
+
+// The IDF's default maximum transmit power, 19.5 dBm in 0.25 dBm units
+#define DEFAULT_POWER  78
+
+
+/**********************
+ *  STATIC VARIABLES
+ **********************/
+static const uint8_t station_mac[6] = {0x02, 0x00, 0x00, 0x00, 0x00, 0x01};
+static int8_t tx_power = DEFAULT_POWER;
+
+
+/**********************
+ *   GLOBAL FUNCTIONS
+ **********************/
+esp_err_t esp_wifi_ap_get_sta_list(wifi_sta_list_t* sta)
+{
+	const char* env = getenv("LVGL_HOST_RSSI");
+
+	memset(sta, 0, sizeof(wifi_sta_list_t));
+	memcpy(sta->sta[0].mac, station_mac, 6);
+	sta->sta[0].rssi = (env != NULL) ? atoi(env) : DEFAULT_RSSI;
+	sta->sta[0].phy_11b = 1;
+	sta->sta[0].phy_11g = 1;
+	sta->sta[0].phy_11n = 1;
+	sta->num = 1;
+	return ESP_OK;
+}
+
+
+esp_err_t tcpip_adapter_get_sta_list(const wifi_sta_list_t* wifi_sta_list, tcpip_adapter_sta_list_t* tcpip_sta_list)
+{
+	int i;
+
+	if ((wifi_sta_list == NULL) || (tcpip_sta_list == NULL)) return ESP_ERR_INVALID_ARG;
+	memset(tcpip_sta_list, 0, sizeof(tcpip_adapter_sta_list_t));
+	for (i=0; i<wifi_sta_list->num; i++) {
+		memcpy(tcpip_sta_list->sta[i].mac, wifi_sta_list->sta[i].mac, 6);
+		if (memcmp(wifi_sta_list->sta[i].mac, station_mac, 6) == 0) {
+			tcpip_sta_list->sta[i].ip.addr = htonl(INADDR_LOOPBACK);
+		}
+	}
+	tcpip_sta_list->num = wifi_sta_list->num;
+	return ESP_OK;
+}
+
+
+esp_err_t esp_wifi_set_ps(wifi_ps_type_t type)
+{
+	return ESP_OK;
+}
+
+
+esp_err_t esp_wifi_set_bandwidth(wifi_interface_t ifx, wifi_bandwidth_t bw)
+{
+	return ((bw == WIFI_BW_HT20) || (bw == WIFI_BW_HT40)) ? ESP_OK : ESP_ERR_INVALID_ARG;
+}
+
+
+esp_err_t esp_wifi_get_max_tx_power(int8_t* power)
+{
+	*power = tx_power;
+	return ESP_OK;
+}
+
+
+esp_err_t esp_wifi_set_max_tx_power(int8_t power)
+{
+	if ((power < 8) || (power > 84)) return ESP_ERR_INVALID_ARG;
+	tx_power = power;
+	return ESP_OK;
+}
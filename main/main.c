@@ -11,9 +11,11 @@
 #include <string.h>
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
+#include "freertos/semphr.h"
 #include "esp_system.h"
 #include "esp_wifi.h"
 #include "esp_log.h"
+#include "esp_timer.h"
 #include "esp_event_loop.h"
 #include "nvs_flash.h"
 #include "driver/gpio.h"
@@ -22,6 +24,11 @@
 #include "esp_freertos_hooks.h"
 
 #include "websocket_driver.h"
+#include "gpu_accel.h"
+#include "e2e_bench.h"
+#include "pipe_mon.h"
+#include "micro_bench.h"
+#include "draw_stream.h"
 
 
 /*********************
@@ -34,40 +41,82 @@
 /**********************
  *  STATIC VARIABLES
  **********************/
-
+// Given once WiFi has made the allocations it needs at startup
+static SemaphoreHandle_t wifi_init_done;
 
 
 /**********************
  *  STATIC PROTOTYPES
  **********************/
+static void wifi_task(void* pvParameters);
 static void wifi_setup();
+static void boot_phase(const char* phase, int64_t start);
 static esp_err_t wifi_event_handler(void* ctx, system_event_t* event);
+#if !WS_DRIVER_TICK_ESP_TIMER
 static void IRAM_ATTR lv_tick_task(void);
+#endif
+#if WS_DRIVER_SESSIONS
+static void session_create(lv_disp_t * disp);
+#endif
 
 
 /**********************
  *   APPLICATION MAIN
  **********************/
 void app_main() {
-	wifi_setup();
+	int64_t start = esp_timer_get_time();
+
+	// The network stack must be up for the driver's server, the access point can follow
+	tcpip_adapter_init();
+	// Parameters tuned on /config are kept in NVS
+	nvs_flash_init();
     lv_init();
+	websocket_driver_init(NULL);
+	boot_phase("LVGL and driver init", start);
+
+	// WiFi takes longest to start, so the user interface is built and drawn meanwhile
+	wifi_init_done = xSemaphoreCreateBinary();
+	xTaskCreatePinnedToCore(&wifi_task, "wifi_task", 4096, NULL, 5, NULL, WS_DRIVER_NET_CORE);
 
-	websocket_driver_init();
+	start = esp_timer_get_time();
+	gpu_accel_init();
 
-    static lv_color_t* buf1;
-    static lv_color_t* buf2;
     static lv_disp_buf_t disp_buf;
     
-    // LVGL Display buffers
-    buf1 = (lv_color_t *) malloc(DISP_BUF_SIZE * sizeof(lv_color_t));
-    buf2 = (lv_color_t *) malloc(DISP_BUF_SIZE * sizeof(lv_color_t));
-    lv_disp_buf_init(&disp_buf, buf1, buf2, DISP_BUF_SIZE);
+    // LVGL Display buffers, sized to the memory WiFi leaves
+    xSemaphoreTake(wifi_init_done, portMAX_DELAY);
+    websocket_driver_init_buf(&disp_buf);
 
 	// Output
     lv_disp_drv_t disp_drv;
     lv_disp_drv_init(&disp_drv);
     disp_drv.flush_cb = websocket_driver_flush;
     disp_drv.buffer = &disp_buf;
+    disp_drv.inv_area_cost = WS_DRIVER_AREA_COST;
+    disp_drv.rounder_cb = websocket_driver_rounder;
+    disp_drv.wait_cb = websocket_driver_wait;
+#if WS_DRIVER_SCROLL_COPY
+    disp_drv.copy_cb = websocket_driver_copy;
+#endif
+    disp_drv.gpu_fill_cb = gpu_accel_fill;
+#if WS_DRIVER_DRAW_STREAM
+    disp_drv.draw_cb = draw_stream_record;
+#endif
+#if WS_DRIVER_MONITOR
+    disp_drv.monitor_cb = websocket_driver_monitor;
+#endif
+#if WS_DRIVER_TRACE
+    disp_drv.trace_cb = websocket_driver_trace;
+#endif
+#if WS_DRIVER_YIELD
+    disp_drv.yield_cb = websocket_driver_yield;
+#endif
+#if WS_DRIVER_NEAR_FIRST
+    disp_drv.rank_cb = websocket_driver_rank;
+#endif
+#if WS_DRIVER_RATE_CAPS
+    disp_drv.hold_cb = websocket_driver_hold;
+#endif
     lv_disp_drv_register(&disp_drv);
 
 	// Input
@@ -76,20 +125,39 @@ void app_main() {
     indev_drv.read_cb = websocket_driver_read;
     indev_drv.type = LV_INDEV_TYPE_POINTER;
     lv_indev_drv_register(&indev_drv);
+#if WS_DRIVER_KEYS
+    indev_drv.read_cb = websocket_driver_read_keys;
+    indev_drv.type = LV_INDEV_TYPE_KEYPAD;
+    lv_indev_drv_register(&indev_drv);
+#endif
 
+#if !WS_DRIVER_TICK_ESP_TIMER
     esp_register_freertos_tick_hook(lv_tick_task);
+#endif
+	boot_phase("display and input", start);
+
+	start = esp_timer_get_time();
 
+#if WS_DRIVER_MICROBENCH
+    micro_bench_run();
+#endif
+#if WS_DRIVER_BENCHMARK
+    e2e_bench_create();
+#else
     demo_create();
+#endif
+#if WS_DRIVER_PIPE_MON
+    pipe_mon_create();
+#endif
+#if WS_DRIVER_SESSIONS
+    websocket_driver_set_session_cb(session_create);
+#endif
+	boot_phase("user interface", start);
 
-	// Evaluate LVGL while there is something to display on
-    while (1) {
-    	if (websocket_driver_available()) {
-        	vTaskDelay(1);
-        	lv_task_handler();
-        } else {
-        	vTaskDelay(100 / portTICK_RATE_MS);
-        }
-    }
+	// Evaluate LVGL whenever it has work while there is something to display on,
+	// drawing the screen straight away.
+	// With the driver's LVGL task enabled this returns and so does app_main.
+	websocket_driver_run();
 }
 
 
@@ -113,6 +181,7 @@ static esp_err_t wifi_event_handler(void* ctx, system_event_t* event) {
 					 event->event_info.sta_connected.mac[2],event->event_info.sta_connected.mac[3],
 					 event->event_info.sta_connected.mac[4],event->event_info.sta_connected.mac[5],
 					 event->event_info.sta_connected.aid);
+			websocket_driver_station(event->event_info.sta_connected.mac, true);
 			break;
 		case SYSTEM_EVENT_AP_STADISCONNECTED:
 			ESP_LOGI(TAG,"STA Disconnected, MAC=%02x:%02x:%02x:%02x:%02x:%02x AID=%i",
@@ -120,6 +189,7 @@ static esp_err_t wifi_event_handler(void* ctx, system_event_t* event) {
 					 event->event_info.sta_disconnected.mac[2],event->event_info.sta_disconnected.mac[3],
 					 event->event_info.sta_disconnected.mac[4],event->event_info.sta_disconnected.mac[5],
 					 event->event_info.sta_disconnected.aid);
+			websocket_driver_station(event->event_info.sta_disconnected.mac, false);
 			break;
 		case SYSTEM_EVENT_AP_PROBEREQRECVED:
 			ESP_LOGI(TAG,"AP Probe Received");
@@ -137,12 +207,19 @@ static esp_err_t wifi_event_handler(void* ctx, system_event_t* event) {
 }
 
 
+static void wifi_task(void* pvParameters) {
+	int64_t start = esp_timer_get_time();
+
+	wifi_setup();
+	boot_phase("WiFi", start);
+	vTaskDelete(NULL);
+}
+
+
+// Call after tcpip_adapter_init()
 static void wifi_setup() {
 	const char* TAG = "wifi_setup";
 	
-	ESP_LOGI(TAG,"starting tcpip adapter");
-	tcpip_adapter_init();
-	nvs_flash_init();
 	ESP_ERROR_CHECK(tcpip_adapter_dhcps_stop(TCPIP_ADAPTER_IF_AP));
 
 	tcpip_adapter_ip_info_t info;
@@ -162,6 +239,7 @@ static void wifi_setup() {
 	ESP_LOGI(TAG,"initializing WiFi");
 	wifi_init_config_t wifi_init_config = WIFI_INIT_CONFIG_DEFAULT();
 	ESP_ERROR_CHECK(esp_wifi_init(&wifi_init_config));
+	xSemaphoreGive(wifi_init_done);
 	ESP_ERROR_CHECK(esp_wifi_set_storage(WIFI_STORAGE_RAM));
 	ESP_ERROR_CHECK(esp_wifi_set_mode(WIFI_MODE_AP));
 
@@ -186,6 +264,24 @@ static void wifi_setup() {
 }
 
 
+// Log how long a startup phase begun at start took, and when it finished
+static void boot_phase(const char* phase, int64_t start) {
+	int64_t now = esp_timer_get_time();
+
+	ESP_LOGI("boot", "%s took %d mS, done %d mS after boot", phase, (int) ((now - start) / 1000), (int) (now / 1000));
+}
+
+
+#if !WS_DRIVER_TICK_ESP_TIMER
 static void IRAM_ATTR lv_tick_task(void) {
     lv_tick_inc(portTICK_RATE_MS);
 }
+#endif
+
+
+#if WS_DRIVER_SESSIONS
+// Each browser after the first gets its own copy of the demo
+static void session_create(lv_disp_t * disp) {
+	demo_create();
+}
+#endif
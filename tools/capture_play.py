@@ -0,0 +1,199 @@
+#!/usr/bin/env python3
+"""Plays back a frame capture of the LittleVGL websocket driver in a browser
+
+Serves the driver's webpage and, to each browser that opens it, sends the messages of a
+capture downloaded from the device's /capture at the times they were captured, so the
+page draws exactly what a viewer was shown.  What the browser sends is ignored.  The
+pointer events browsers sent the device during the capture are printed as their time
+comes.
+
+The capture starts with a header of b"LVCP", the version, the colour depth and the
+big-endian resolution, followed by records of the big-endian time in mS, a type and the
+big-endian length of what follows.  The type is the first byte of a websocket header
+for a message, or 0xFF for a pointer event of the client number, flag and big-endian x
+and y.  An erased (all 0xFF) time ends the records.
+
+Only the Python 3 standard library is used.
+
+Example, after `curl -o capture.bin http://192.168.4.1/capture`:
+
+    python3 tools/capture_play.py capture.bin
+    python3 tools/capture_play.py capture.bin --info
+"""
+
+import argparse
+import asyncio
+import base64
+import hashlib
+import os
+import struct
+import sys
+
+WS_GUID = b"258EAFA5-E914-47DA-95CA-C5AB0DC85B11"
+MAGIC = b"LVCP"
+VERSION = 1
+HEADER_LEN = 10
+RECORD_HEADER_LEN = 9
+TYPE_POINTER = 0xFF
+END_TIME = 0xFFFFFFFF
+
+PAGE = os.path.join(os.path.dirname(os.path.abspath(__file__)), "..", "components", "lvgl_esp32_drivers", "index.html")
+
+
+class Capture:
+    def __init__(self, data):
+        if len(data) < HEADER_LEN or data[:4] != MAGIC:
+            raise ValueError("not a capture")
+        if data[4] != VERSION:
+            raise ValueError("capture version %d, expected %d" % (data[4], VERSION))
+        self.depth = data[5]
+        self.width, self.height = struct.unpack_from(">HH", data, 6)
+        self.records = []
+        self.truncated = False
+        offset = HEADER_LEN
+        while offset + RECORD_HEADER_LEN <= len(data):
+            time, kind, length = struct.unpack_from(">IBI", data, offset)
+            if time == END_TIME:
+                break
+            offset += RECORD_HEADER_LEN
+            if offset + length > len(data):
+                # The partition filled up part way through
+                self.truncated = True
+                break
+            self.records.append((time, kind, data[offset:offset + length]))
+            offset += length
+        # Pointer events are written up to a poll period late
+        self.records.sort(key=lambda r: r[0])
+
+    def messages(self):
+        return [r for r in self.records if r[1] != TYPE_POINTER]
+
+    def pointers(self):
+        return [r for r in self.records if r[1] == TYPE_POINTER]
+
+    def duration(self):
+        return self.records[-1][0] if self.records else 0
+
+
+def describe_pointer(payload):
+    num, flag, x, y = struct.unpack(">BBHH", payload)
+    return "client %d %s at %d,%d" % (num, "press" if flag else "release", x, y)
+
+
+def frame(kind, payload):
+    """A server websocket frame whose first byte is kind"""
+    n = len(payload)
+    if n < 126:
+        header = struct.pack(">BB", kind, n)
+    elif n < 65536:
+        header = struct.pack(">BBH", kind, 126, n)
+    else:
+        header = struct.pack(">BBQ", kind, 127, n)
+    return header + payload
+
+
+class Player:
+    def __init__(self, capture, args):
+        self.capture = capture
+        self.args = args
+        page = open(PAGE, "rb").read()
+        # The device serves the page and its websocket on port 80, here they share --port
+        self.page = page.replace(b"'ws://'+location.hostname+'/'", b"'ws://'+location.host+'/'")
+
+    async def handle(self, reader, writer):
+        try:
+            request = await reader.readuntil(b"\r\n\r\n")
+            lines = request.decode(errors="replace").split("\r\n")
+            path = lines[0].split(" ")[1] if len(lines[0].split(" ")) > 1 else "/"
+            headers = {}
+            for line in lines[1:]:
+                if ":" in line:
+                    name, _, value = line.partition(":")
+                    headers[name.strip().lower()] = value.strip()
+            if headers.get("upgrade", "").lower() == "websocket":
+                await self.play(reader, writer, headers)
+            elif path == "/" or path.startswith("/?"):
+                writer.write(b"HTTP/1.1 200 OK\r\nContent-Type: text/html\r\nContent-Length: %d\r\n"
+                             b"Connection: close\r\n\r\n" % len(self.page) + self.page)
+            else:
+                writer.write(b"HTTP/1.1 404 Not Found\r\nContent-Length: 0\r\nConnection: close\r\n\r\n")
+            await writer.drain()
+        except (OSError, asyncio.IncompleteReadError, asyncio.LimitOverrunError):
+            pass
+        finally:
+            writer.close()
+
+    async def play(self, reader, writer, headers):
+        accept = base64.b64encode(hashlib.sha1(headers.get("sec-websocket-key", "").encode() + WS_GUID).digest())
+        writer.write(b"HTTP/1.1 101 Switching Protocols\r\nUpgrade: websocket\r\nConnection: Upgrade\r\n"
+                     b"Sec-WebSocket-Accept: " + accept + b"\r\n\r\n")
+        await writer.drain()
+        # The page's hello, acknowledgements and input go nowhere
+        drain = asyncio.ensure_future(self.discard(reader))
+        loop = asyncio.get_running_loop()
+        try:
+            while True:
+                print("playing %d messages over %.1f s" % (len(self.capture.messages()), self.capture.duration() / 1000))
+                start = loop.time()
+                for time, kind, payload in self.capture.records:
+                    delay = start + time / 1000 / self.args.speed - loop.time()
+                    if delay > 0:
+                        await asyncio.sleep(delay)
+                    if kind == TYPE_POINTER:
+                        print("%8.3f s  %s" % (time / 1000, describe_pointer(payload)))
+                    else:
+                        writer.write(frame(kind, payload))
+                        await writer.drain()
+                if not self.args.loop:
+                    break
+        finally:
+            drain.cancel()
+        print("done")
+
+    async def discard(self, reader):
+        while await reader.read(4096):
+            pass
+
+
+async def serve(player, args):
+    server = await asyncio.start_server(player.handle, args.bind, args.port)
+    print("open http://%s:%d/ to play the capture" % (args.bind if args.bind != "0.0.0.0" else "localhost", args.port))
+    async with server:
+        await server.serve_forever()
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split("\n")[0])
+    parser.add_argument("capture", help="capture downloaded from the device's /capture")
+    parser.add_argument("--port", type=int, default=8081, help="port to serve the page on (default 8081)")
+    parser.add_argument("--bind", default="0.0.0.0", help="address to serve on (default all)")
+    parser.add_argument("--speed", type=float, default=1, help="playback speed (default 1)")
+    parser.add_argument("--loop", action="store_true", help="play the capture over and over")
+    parser.add_argument("--info", action="store_true", help="describe the capture and exit")
+    args = parser.parse_args()
+
+    try:
+        capture = Capture(open(args.capture, "rb").read())
+    except (OSError, ValueError) as e:
+        sys.exit("%s: %s" % (args.capture, e))
+
+    if args.info:
+        messages = capture.messages()
+        print("%dx%d at %d bits per pixel, %.1f s" % (capture.width, capture.height, capture.depth,
+                                                      capture.duration() / 1000))
+        print("%d messages, %.1f kB" % (len(messages), sum(len(m[2]) for m in messages) / 1024))
+        print("%d pointer events" % len(capture.pointers()))
+        for time, _, payload in capture.pointers():
+            print("%8.3f s  %s" % (time / 1000, describe_pointer(payload)))
+        if capture.truncated:
+            print("the capture filled its partition and ends part way through a message")
+        return
+
+    try:
+        asyncio.run(serve(Player(capture, args), args))
+    except KeyboardInterrupt:
+        pass
+
+
+if __name__ == "__main__":
+    main()
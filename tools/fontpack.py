@@ -0,0 +1,216 @@
+#!/usr/bin/env python3
+"""Compresses the glyph bitmaps of a LittlevGL font written by lv_font_conv
+
+Rewrites a font C file made with --no-compress into the same compressed format
+lv_font_conv writes without it: each glyph's pixels, row after row, as a run-length
+encoded stream of bpp bit values, by default with every row XORed with the one above
+first (--no-prefilter leaves that out).  A value repeating the one before starts a run:
+every following 1 bit repeats it once more until a 0 bit and a new value, and the 11th
+1 bit is followed by a 6 bit count of further repeats.  LittlevGL needs
+LV_USE_FONT_COMPRESSED to draw the result.
+
+Useful when the original font files and options aren't at hand, as for the built-in
+fonts.  Every glyph is decoded again and checked before the file is written.
+
+Only the Python standard library is used, so the IDF's Python runs it.
+
+Example:
+
+    python3 tools/fontpack.py components/lvgl/lvgl/src/lv_font/lv_font_roboto_16.c
+"""
+
+import argparse
+import re
+import sys
+
+REPEAT_MAX = 11
+COUNT_BITS = 6
+
+BITMAP_RE = re.compile(r"(gylph_bitmap\[\] = \{\n)(.*?)(\n\};)", re.S)
+GLYPH_RE = re.compile(r"\{\.bitmap_index = (\d+), \.adv_w = -?\d+, \.box_h = (\d+), \.box_w = (\d+),")
+BPP_RE = re.compile(r"(\n\s*\.bpp = (\d+),)")
+
+
+class BitWriter:
+    def __init__(self):
+        self.bits = []
+
+    def put(self, value, length):
+        for i in range(length - 1, -1, -1):
+            self.bits.append((value >> i) & 1)
+
+    def bytes(self):
+        bits = self.bits + [0] * (-len(self.bits) % 8)
+        return bytes(int("".join(map(str, bits[i:i + 8])), 2) for i in range(0, len(bits), 8))
+
+
+def unpack(data, count, bpp):
+    mask = (1 << bpp) - 1
+    return [(data[(i * bpp) >> 3] >> (8 - ((i * bpp) & 7) - bpp)) & mask for i in range(count)]
+
+
+def prefilter(values, width):
+    return [v ^ values[i - width] if i >= width else v for i, v in enumerate(values)]
+
+
+def rle_encode(values, bpp):
+    """Mirrors rle_next() in lv_font_fmt_txt.c"""
+    w = BitWriter()
+    n = len(values)
+    i = 0
+    prev = 0
+    single = True
+    while i < n:
+        if single:
+            v = values[i]
+            w.put(v, bpp)
+            i += 1
+            if len(w.bits) > bpp and v == prev:
+                single = False
+                cnt = 0
+            prev = v
+            continue
+        cnt += 1
+        if values[i] != prev:
+            w.put(0, 1)
+            w.put(values[i], bpp)
+            prev = values[i]
+            i += 1
+            single = True
+        elif cnt < REPEAT_MAX:
+            w.put(1, 1)
+            i += 1
+        else:
+            run = 0
+            while i + run < n and values[i + run] == prev and run < (1 << COUNT_BITS) - 1:
+                run += 1
+            w.put(1, 1)
+            w.put(run, COUNT_BITS)
+            i += run
+            # The count is followed by a new value, read as a single one
+            if i < n:
+                w.put(values[i], bpp)
+                prev = values[i]
+                i += 1
+            single = True
+    return w.bytes()
+
+
+def rle_decode(data, count, bpp):
+    """Reference decoder, used to check the encoder"""
+    pos = [0]
+
+    def get(length):
+        v = 0
+        for _ in range(length):
+            v = (v << 1) | ((data[pos[0] >> 3] >> (7 - (pos[0] & 7))) & 1)
+            pos[0] += 1
+        return v
+
+    out = []
+    state = "single"
+    prev = cnt = 0
+    for _ in range(count):
+        if state == "single":
+            first = pos[0] == 0
+            v = get(bpp)
+            if not first and v == prev:
+                cnt = 0
+                state = "repeat"
+            prev = v
+        elif state == "repeat":
+            cnt += 1
+            if get(1):
+                v = prev
+                if cnt == REPEAT_MAX:
+                    cnt = get(COUNT_BITS)
+                    if cnt:
+                        state = "counter"
+                    else:
+                        v = prev = get(bpp)
+                        state = "single"
+            else:
+                v = prev = get(bpp)
+                state = "single"
+        else:
+            v = prev
+            cnt -= 1
+            if cnt == 0:
+                v = prev = get(bpp)
+                state = "single"
+        out.append(v)
+    return out
+
+
+def hex_lines(data):
+    lines = []
+    for i in range(0, len(data), 8):
+        lines.append("    " + ", ".join("0x%x" % b for b in data[i:i + 8]) + ",")
+    return lines
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split("\n")[0])
+    parser.add_argument("font", help="font C file, rewritten in place")
+    parser.add_argument("--no-prefilter", action="store_true", help="don't XOR the rows with the one above")
+    parser.add_argument("-o", "--output", help="write here instead")
+    args = parser.parse_args()
+
+    src = open(args.font).read()
+    if ".bitmap_format" in src:
+        sys.exit("%s: bitmaps are already compressed" % args.font)
+    m = BITMAP_RE.search(src)
+    bpp_m = BPP_RE.search(src)
+    if not m or not bpp_m:
+        sys.exit("%s: not a font written by lv_font_conv" % args.font)
+    bpp = int(bpp_m.group(2))
+    if bpp not in (1, 2, 4, 8):
+        sys.exit("%s: %d bpp is not supported" % (args.font, bpp))
+
+    plain = bytes(int(t, 16) for t in re.findall(r"0x[0-9a-fA-F]+", re.sub(r"/\*.*?\*/", "", m.group(2))))
+    # The glyph comments in the array, one per glyph from id 1
+    comments = re.findall(r"/\* U\+.*?\*/", m.group(2))
+    glyphs = [tuple(map(int, g)) for g in GLYPH_RE.findall(src)][1:]
+    if len(comments) != len(glyphs):
+        sys.exit("%s: %d glyph descriptions but %d bitmaps" % (args.font, len(glyphs), len(comments)))
+
+    body = []
+    index = []
+    out_len = 0
+    for comment, (ofs, h, w) in zip(comments, glyphs):
+        count = w * h
+        values = unpack(plain[ofs:], count, bpp) if count else []
+        filtered = values if args.no_prefilter else prefilter(values, w)
+        data = rle_encode(filtered, bpp) if count else b""
+        if rle_decode(data, count, bpp) != filtered:
+            sys.exit("%s: encoding check failed at %s" % (args.font, comment))
+        index.append(out_len)
+        out_len += len(data)
+        if body:
+            body.append("")
+        body.append("    " + comment)
+        body.extend(hex_lines(data))
+
+    # Rewrite the array, then each glyph's bitmap index in order
+    out = src[:m.start(2)] + "\n".join(body) + src[m.end(2):]
+    pos = [0]
+
+    def reindex(g):
+        i = pos[0]
+        pos[0] += 1
+        return g.group(0) if i == 0 else g.group(0).replace("bitmap_index = %s," % g.group(1),
+                                                             "bitmap_index = %d," % index[i - 1], 1)
+    out = GLYPH_RE.sub(reindex, out)
+    fmt = "LV_FONT_FMT_TXT_COMPRESSED_NO_PREFILTER" if args.no_prefilter else "LV_FONT_FMT_TXT_COMPRESSED"
+    out = BPP_RE.sub(lambda b: b.group(1) + "\n    .bitmap_format = %s," % fmt, out, 1)
+    # Keep the options in the header those lv_font_conv would take to write the same
+    out = out.replace(" --no-compress", "", 1)
+    if not args.no_prefilter:
+        out = out.replace(" --no-prefilter", "", 1)
+
+    open(args.output or args.font, "w").write(out)
+    print("%s: %d glyphs, bitmaps %d -> %d bytes" % (args.font, len(glyphs), len(plain), out_len))
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,89 @@
+#!/usr/bin/env python3
+"""Packs files into the asset partition image read by the LittleVGL websocket driver
+
+The image is a table of contents followed by the files, each aligned to 4 bytes so
+LittlevGL can draw a true color .bin image straight from mapped flash.  All values are
+little endian:
+
+    "LVAS"  magic
+    u32     number of entries
+    entry   per file: name (20 bytes, NUL padded), offset from the image start,
+            length and FNV-1a hash, served as its ETag
+
+A file is stored under its base name unless given as name=path.  The web server serves
+"x.gz" for a request for /x with gzip content encoding, and index.html for /.
+
+Only the Python standard library is used, so the IDF's Python runs it.
+
+Example, the page and icon plus the images in assets/:
+
+    python3 tools/mkassets.py -o build/assets.bin build/index.html.gz favicon.ico assets/*
+"""
+
+import argparse
+import os
+import struct
+import sys
+
+MAGIC = b"LVAS"
+NAME_LEN = 20
+ENTRY = struct.Struct("<%dsIII" % NAME_LEN)
+HEADER = struct.Struct("<4sI")
+ALIGN = 4
+
+
+def fnv1a(data):
+    h = 2166136261
+    for b in bytearray(data):
+        h = ((h ^ b) * 16777619) & 0xffffffff
+    return h
+
+
+def parse_size(text):
+    text = text.strip().upper()
+    scale = 1
+    if text.endswith("K"):
+        scale, text = 1024, text[:-1]
+    elif text.endswith("M"):
+        scale, text = 1024 * 1024, text[:-1]
+    return int(text, 0) * scale
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Pack files into a LittleVGL websocket driver asset image")
+    parser.add_argument("files", nargs="+", help="files to pack, as path or name=path")
+    parser.add_argument("-o", "--output", required=True, help="image to write")
+    parser.add_argument("--size", type=parse_size, help="partition size, e.g. 1M, to fail on an image that won't fit")
+    args = parser.parse_args()
+
+    files = []
+    for spec in args.files:
+        name, _, path = spec.rpartition("=")
+        if not name:
+            name = os.path.basename(path)
+        if len(name.encode()) >= NAME_LEN:
+            sys.exit("%s: names must be under %d bytes" % (name, NAME_LEN))
+        if any(name == n for n, _ in files):
+            sys.exit("%s: packed twice" % name)
+        with open(path, "rb") as f:
+            files.append((name, f.read()))
+
+    offset = HEADER.size + ENTRY.size * len(files)
+    toc = HEADER.pack(MAGIC, len(files))
+    body = b""
+    for name, data in files:
+        pad = -(offset + len(body)) % ALIGN
+        body += b"\0" * pad
+        toc += ENTRY.pack(name.encode(), offset + len(body), len(data), fnv1a(data))
+        body += data
+    image = toc + body
+
+    if args.size is not None and len(image) > args.size:
+        sys.exit("%s: %d bytes won't fit a %d byte partition" % (args.output, len(image), args.size))
+    with open(args.output, "wb") as f:
+        f.write(image)
+    print("%s: %d files, %d bytes" % (args.output, len(files), len(image)))
+
+
+if __name__ == "__main__":
+    main()
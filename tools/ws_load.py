@@ -0,0 +1,1051 @@
+#!/usr/bin/env python3
+"""Headless multi-client load generator for the LittleVGL websocket driver
+
+Opens N websocket sessions against the device the way index.html does, decodes every
+pixel message (region headers, pixel data and draw commands) so decode errors are
+caught, answers the server's pings and sends synthetic pointer traffic, batching moves
+per frame as the page does.  Each session opens with the hello index.html sends,
+announcing the encodings given by --encodings, and a region in an encoding it did not
+announce counts as a decode error.  Like the page it acknowledges the pixel messages it
+has decoded, so the driver's flow control holds it back, unless --no-acks is given.
+Every report period it prints each client's messages per second, throughput, input
+latency and disconnects.
+
+Input latency is the time from a pointer event being sent to the arrival of the first
+pixel message whose header echoes its sequence number, meaning the device had
+processed it before flushing that frame.  Against firmware built without input
+sequence numbers it falls back to the time from a press to the next pixel message, an
+upper bound on the time the device took to show its effect.  Sessions the device
+says are viewers, because another session holds its input lease, measure nothing as
+their input is ignored.
+
+With --deflate each session offers permessage-deflate as browsers do, inflating the
+messages the device compresses and compressing its own, and the summary gives how much
+smaller the compressed messages arrived.
+
+For a soak test, --replay plays the pointer events of a capture downloaded from the
+device's /capture instead of random taps, --metrics samples the device's /metrics every
+report period, and thresholds such as --min-fps, --max-p95 and --max-heap-loss are
+checked over the run after --warmup seconds.  The run then ends with a line per
+threshold and exits with status 1 if any was crossed, so it can gate a CI job.
+
+Only the Python 3 standard library is used.
+
+Example, 8 viewers tapping twice a second for a minute:
+
+    python3 tools/ws_load.py 192.168.4.1 -n 8 -t 60 --taps 2
+
+Four hours of 4 viewers replaying a capture, failing below 20 messages per second per
+viewer, above 150 mS p95 input latency or if the free heap falls by 1 kB an hour:
+
+    python3 tools/ws_load.py 192.168.4.1 -n 4 -t 14400 --period 60 --replay capture.bin \
+        --min-fps 20 --max-p95 150 --max-heap-loss 1024 --max-disconnects 0 --max-errors 0
+"""
+
+import argparse
+import asyncio
+import base64
+import hashlib
+import json
+import os
+import random
+import struct
+import sys
+import termios
+import time
+import tty
+import zlib
+
+from capture_play import TYPE_POINTER, Capture
+
+WS_GUID = b"258EAFA5-E914-47DA-95CA-C5AB0DC85B11"
+
+OPCODE_CONT = 0x0
+OPCODE_TEXT = 0x1
+OPCODE_BIN = 0x2
+OPCODE_CLOSE = 0x8
+OPCODE_PING = 0x9
+OPCODE_PONG = 0xA
+
+# Pixel depth byte: encoding in bits 7:6, palette flag in bit 2, input sequence flag in
+# bit 1, little-endian flag in bit 0.  A copy with the palette flag holds draw commands.
+PIXEL_HEADER_LEN = 13
+ENC_MASK = 0xC0
+ENC_RAW = 0x00
+ENC_RLE = 0x40
+ENC_COPY = 0x80
+ENC_FILL = 0xC0
+INPUT_SEQ = 0x02
+PALETTE = 0x04
+ORDER_LE = 0x01
+ENC_DRAW = ENC_COPY | PALETTE
+
+# Aligned region header: the pixel depth byte, a byte with bit 7 set and the header's
+# length, then the screen size, the region and the input sequence number as
+# little-endian 16-bit words.  The region's data is padded to a multiple of 4 bytes.
+ALIGNED_MARK = 0x80
+
+# Viewer options, sent in the hello
+VIEW_LOSSY = 0x01
+VIEW_DRAW = 0x02
+VIEW_ACKS = 0x04
+VIEW_ANIMS = 0x10
+
+# Hello: magic, protocol version, viewer options, encodings, preferred pixel depth,
+# viewport width and height and optionally its x and y
+HELLO = 0x48
+PROTO_VERSION = 2
+ENC_CAP = {"rle": 0x01, "palette": 0x02, "fill": 0x04, "copy": 0x08, "aligned": 0x20}
+ENC_CAP_ALL = 0x2F
+
+# Batch of pointer moves: magic, count and sequence number, then each move's x, y and
+# age in mS, sent once per animation frame as the page does
+MOVES = 0x4D
+MOVES_MAX = 16
+
+# Compact input, sent instead of both to a driver whose hello speaks version 2: magic and
+# the sequence number as a varint, then for each event a byte of the pointer (bits 7:4)
+# and buttons held (bits 3:0) and its x, y change as zigzag varints and the mS since the
+# event before, or for the first its age, as a varint
+INPUT = 0x49
+
+# Viewport: magic and the x, y, width and height of the part of the screen shown
+VIEWPORT = 0x56
+
+# Scroll: magic, 0 to scroll by or 1 to fling, the point scrolled at and the signed
+# distance in pixels or velocity in pixels per second
+SCROLL = 0x57
+SCROLL_BY = 0
+SCROLL_FLING = 1
+
+# Scale: magic and the power of two the screen is scaled down by, sent before the hello
+SCALE = 0x5A
+SCALE_SHIFT = {1: 0, 2: 1, 4: 2}
+
+# Visibility: magic and 0 when the page is hidden, 1 when it is shown
+VISIBLE = 0x53
+FRAME_PERIOD = 1 / 60
+
+# Draw commands, each followed by a fixed number of bytes except glyph definitions and
+# image rows
+CMD_END = 0x00
+CMD_GLYPH = 0x04
+CMD_ROWS = 0x08
+CMD_LEN = {0x01: 10, 0x02: 11, 0x03: 7, 0x05: 8, 0x06: 3, 0x07: 5, 0x09: 13}
+
+
+class DecodeError(Exception):
+    pass
+
+
+def rle_len(data, offset, pixels, bpp):
+    """Returns the number of bytes of PackBits-style data describing pixels pixels"""
+    start = offset
+    while pixels > 0:
+        if offset >= len(data):
+            raise DecodeError("RLE data ends early")
+        n = data[offset]
+        offset += 1
+        if n < 0x80:
+            count = n + 1
+            offset += count * bpp
+        else:
+            count = (n & 0x7F) + 2
+            offset += bpp
+        if count > pixels:
+            raise DecodeError("RLE run past the end of the region")
+        pixels -= count
+    if offset > len(data):
+        raise DecodeError("RLE data ends early")
+    return offset - start
+
+
+def palette_len(data, offset, pixels, bpp):
+    """Returns the number of bytes of a palette and the indices of pixels pixels"""
+    if offset >= len(data):
+        raise DecodeError("truncated palette")
+    colours = data[offset] + 1
+    if colours > 16:
+        raise DecodeError("palette of %d colours" % colours)
+    bits = 1 if colours <= 2 else 2 if colours <= 4 else 4
+    length = 1 + colours * bpp + (pixels * bits + 7) // 8
+    if offset + length > len(data):
+        raise DecodeError("palette data ends early")
+    return length
+
+
+def draw_len(data, offset):
+    """Returns the number of bytes of the draw commands starting at offset"""
+    start = offset
+    while True:
+        if offset >= len(data):
+            raise DecodeError("draw commands end early")
+        cmd = data[offset]
+        offset += 1
+        if cmd == CMD_END:
+            return offset - start
+        if cmd == CMD_GLYPH:
+            if offset + 4 > len(data):
+                raise DecodeError("truncated glyph definition")
+            w, h, bpp = data[offset + 1], data[offset + 2], data[offset + 3]
+            if bpp not in (1, 2, 4, 8):
+                raise DecodeError("glyph of %d bits per pixel" % bpp)
+            offset += 4 + (w * h * bpp + 7) // 8
+        elif cmd == CMD_ROWS:
+            if offset + 8 > len(data):
+                raise DecodeError("truncated image rows")
+            w, h, y = struct.unpack_from(">HHH", data, offset + 1)
+            rows = data[offset + 7]
+            if y + rows > h:
+                raise DecodeError("image rows %d-%d of %d" % (y, y + rows - 1, h))
+            offset += 8 + w * rows * 2
+        elif cmd in CMD_LEN:
+            offset += CMD_LEN[cmd]
+        else:
+            raise DecodeError("unknown draw command 0x%02x" % cmd)
+
+
+def decode_message(data, encodings=ENC_CAP_ALL):
+    """Walk the regions of a pixel message, returning (regions, pixels, size, seq) where
+    seq is the last input sequence number echoed, or None.  Regions in encodings whose
+    ENC_CAP bits are clear in encodings are rejected."""
+    offset = 0
+    regions = 0
+    pixels = 0
+    size = None
+    seq = None
+    while offset < len(data):
+        start = offset
+        if offset + PIXEL_HEADER_LEN > len(data):
+            raise DecodeError("truncated region header")
+        aligned = data[offset + 1] & ALIGNED_MARK
+        if aligned:
+            if not encodings & ENC_CAP["aligned"]:
+                raise DecodeError("aligned region sent without being announced")
+            if offset + (data[offset + 1] & ~ALIGNED_MARK) > len(data) or data[offset + 1] & ~ALIGNED_MARK < 16:
+                raise DecodeError("truncated aligned region header")
+            depth, _, w, h, x1, y1, x2, y2, echoed = struct.unpack_from("<BBHHHHHHH", data, offset)
+            offset += data[offset + 1] & ~ALIGNED_MARK
+            if depth & INPUT_SEQ:
+                seq = echoed
+        else:
+            depth, w, h, x1, y1, x2, y2 = struct.unpack_from(">BHHHHHH", data, offset)
+            offset += PIXEL_HEADER_LEN
+            if depth & INPUT_SEQ:
+                if offset + 2 > len(data):
+                    raise DecodeError("truncated input sequence number")
+                seq = struct.unpack_from(">H", data, offset)[0]
+                offset += 2
+        bpp = (depth & ~(ENC_MASK | PALETTE | INPUT_SEQ | ORDER_LE)) >> 3
+        if bpp not in (1, 2, 4):
+            raise DecodeError("bad pixel depth 0x%02x" % depth)
+        if x2 < x1 or y2 < y1 or x2 >= w or y2 >= h:
+            raise DecodeError("region %d,%d-%d,%d outside %dx%d" % (x1, y1, x2, y2, w, h))
+        n = (x2 - x1 + 1) * (y2 - y1 + 1)
+        check_encoding(depth, encodings)
+        if depth & (ENC_MASK | PALETTE) == ENC_DRAW:
+            offset += draw_len(data, offset)
+        elif depth & PALETTE:
+            if depth & ENC_MASK != ENC_RAW:
+                raise DecodeError("palette with encoding 0x%02x" % (depth & ENC_MASK))
+            offset += palette_len(data, offset, n, bpp)
+        elif depth & ENC_MASK == ENC_RLE:
+            offset += rle_len(data, offset, n, bpp)
+        elif depth & ENC_MASK == ENC_RAW:
+            offset += n * bpp
+            if offset > len(data):
+                raise DecodeError("raw pixel data ends early")
+        elif depth & ENC_MASK == ENC_COPY:
+            # The source of pixels already on the canvas, none are sent
+            if offset + 4 > len(data):
+                raise DecodeError("truncated copy source")
+            sx, sy = struct.unpack_from("<HH" if aligned else ">HH", data, offset)
+            offset += 4
+            if sx + x2 - x1 >= w or sy + y2 - y1 >= h:
+                raise DecodeError("copy source %d,%d outside %dx%d" % (sx, sy, w, h))
+            n = 0
+        elif depth & ENC_MASK == ENC_FILL:
+            # A single pixel the region is filled with
+            offset += bpp
+            if offset > len(data):
+                raise DecodeError("truncated fill pixel")
+        else:
+            raise DecodeError("unknown encoding 0x%02x" % (depth & ENC_MASK))
+        if aligned:
+            offset += -(offset - start) % 4
+            if offset > len(data):
+                raise DecodeError("aligned region padding ends early")
+        regions += 1
+        pixels += n
+        size = (w, h)
+    return regions, pixels, size, seq
+
+
+def check_encoding(depth, encodings):
+    if depth & (ENC_MASK | PALETTE) == ENC_DRAW:
+        return
+    for name, enc in (("palette", depth & PALETTE), ("rle", depth & ENC_MASK == ENC_RLE),
+                      ("copy", depth & ENC_MASK == ENC_COPY), ("fill", depth & ENC_MASK == ENC_FILL)):
+        if enc and not encodings & ENC_CAP[name]:
+            raise DecodeError("%s region sent without being announced" % name)
+
+
+def parse_viewport(text):
+    try:
+        x, y, w, h = (int(v) for v in text.split(","))
+    except ValueError:
+        raise argparse.ArgumentTypeError("viewport must be x,y,w,h")
+    return x, y, w, h
+
+
+def parse_encodings(text):
+    encodings = 0
+    for name in filter(None, text.split(",")):
+        if name not in ENC_CAP:
+            raise argparse.ArgumentTypeError("unknown encoding %s" % name)
+        encodings |= ENC_CAP[name]
+    return encodings
+
+
+def load_trace(path):
+    """Returns the width and height of a capture's screen and the pointer events of the
+    first session it recorded as (seconds from the first, flag, x, y)"""
+    capture = Capture(open(path, "rb").read())
+    events = [struct.unpack(">BBHH", payload) + (t,) for t, kind, payload in capture.records
+              if kind == TYPE_POINTER]
+    if not events:
+        raise ValueError("no pointer events")
+    first = min(num for num, _, _, _, _ in events)
+    events = [(t, flag, x, y) for num, flag, x, y, t in events if num == first]
+    return capture.width, capture.height, [((t - events[0][0]) / 1000, flag, x, y) for t, flag, x, y in events]
+
+
+async def fetch_metrics(args):
+    """Returns the samples of the device's /metrics by name and labels, such as
+    'heap_free_bytes{region="internal"}', or None if they couldn't be fetched"""
+    try:
+        reader, writer = await asyncio.wait_for(asyncio.open_connection(args.host, args.port), args.timeout)
+    except (OSError, asyncio.TimeoutError):
+        return None
+    try:
+        writer.write(b"GET /metrics HTTP/1.1\r\n"
+                     b"Host: " + args.host.encode() + b"\r\n"
+                     b"Connection: close\r\n\r\n")
+        await writer.drain()
+        response = await asyncio.wait_for(reader.read(), args.timeout)
+    except (OSError, asyncio.TimeoutError):
+        return None
+    finally:
+        writer.close()
+    header, _, body = response.partition(b"\r\n\r\n")
+    if not header.startswith(b"HTTP/1.1 200"):
+        return None
+    samples = {}
+    for line in body.decode(errors="replace").splitlines():
+        if line.startswith("#"):
+            continue
+        name, _, value = line.rpartition(" ")
+        try:
+            samples[name] = float(value)
+        except ValueError:
+            pass
+    return samples
+
+
+def trend(samples):
+    """Least squares slope of (seconds, value) samples, per hour, or None for fewer than 3"""
+    if len(samples) < 3:
+        return None
+    n = len(samples)
+    mean_t = sum(t for t, _ in samples) / n
+    mean_v = sum(v for _, v in samples) / n
+    var = sum((t - mean_t) ** 2 for t, _ in samples)
+    if var == 0:
+        return None
+    return sum((t - mean_t) * (v - mean_v) for t, v in samples) / var * 3600
+
+
+def percentile(samples, p):
+    if not samples:
+        return None
+    s = sorted(samples)
+    return s[min(len(s) - 1, int(len(s) * p / 100))]
+
+
+class Client:
+    def __init__(self, num, args):
+        self.num = num
+        self.args = args
+        self.encodings = getattr(args, "encodings", ENC_CAP_ALL)
+        self.acks = getattr(args, "acks", True)
+        # Pixel messages decoded and acknowledged since connecting, and the number the
+        # driver allows unacknowledged, None until its hello arrives
+        self.decoded = 0
+        self.acked = 0
+        self.credits = None
+        self.version = 1
+        self.reader = None
+        self.writer = None
+        self.connected = False
+        self.size = None
+        # Totals
+        self.connects = 0
+        self.disconnects = 0
+        self.refused = 0
+        self.decode_errors = 0
+        # Since the last report
+        self.msgs = 0
+        self.bytes = 0
+        self.regions = 0
+        self.latency = []
+        self.all_latency = []
+        self.press_time = None
+        # Sequence numbers of pointer events not yet echoed, oldest first
+        self.seq = 0
+        self.pending = []
+        # Set while the driver ignores this session's input for another's
+        self.viewing = False
+        # The token of the last connection and the messages decoded on it, sent again
+        # with --resume to be resent only what changed while disconnected
+        self.token = 0
+        self.resumes = 0
+        self.anims = 0
+        # Snapshots fetched with --snapshot before connecting, their bytes and the time
+        # each took to arrive
+        self.snapshots = 0
+        self.snapshot_bytes = 0
+        self.snapshot_time = []
+        # Set while the connection negotiated permessage-deflate, and the bytes of the
+        # compressed messages received as sent and once inflated
+        self.deflate = False
+        self.deflate_wire = 0
+        self.deflate_bytes = 0
+
+    async def fetch_snapshot(self):
+        # Fetch /snapshot as the page does while its websocket opens and decode its
+        # length-prefixed pixel messages.  An empty 204 No Content means the device had
+        # no snapshot.
+        start = time.monotonic()
+        reader, writer = await asyncio.wait_for(
+            asyncio.open_connection(self.args.host, self.args.port), self.args.timeout)
+        try:
+            writer.write(b"GET /snapshot HTTP/1.1\r\n"
+                         b"Host: " + self.args.host.encode() + b"\r\n\r\n")
+            await writer.drain()
+            response = await asyncio.wait_for(reader.read(), self.args.timeout)
+        finally:
+            writer.close()
+        header, _, body = response.partition(b"\r\n\r\n")
+        if not header.startswith(b"HTTP/1.1 200"):
+            return
+        offset = 0
+        try:
+            while offset < len(body):
+                if offset + 4 > len(body):
+                    raise DecodeError("truncated snapshot message length")
+                n = struct.unpack_from(">I", body, offset)[0]
+                offset += 4
+                if offset + n > len(body):
+                    raise DecodeError("snapshot message ends early")
+                decode_message(body[offset:offset + n], ENC_CAP_ALL)
+                offset += n
+        except DecodeError as e:
+            self.decode_errors += 1
+            if self.args.verbose:
+                print("client %d: snapshot: %s" % (self.num, e), file=sys.stderr)
+            return
+        self.snapshots += 1
+        self.snapshot_bytes += len(body)
+        self.snapshot_time.append(time.monotonic() - start)
+
+    def raw(self):
+        """True when speaking the raw framing, on the raw port or a serial link"""
+        return bool(getattr(self.args, "raw", None) or getattr(self.args, "serial", None))
+
+    async def open_serial(self):
+        # The serial link opens a session with the first bytes it is sent
+        fd = os.open(self.args.serial, os.O_RDWR | os.O_NOCTTY | os.O_NONBLOCK)
+        tty.setraw(fd)
+        attrs = termios.tcgetattr(fd)
+        speed = getattr(termios, "B%d" % self.args.baud, None)
+        if speed is not None:
+            attrs[4] = attrs[5] = speed
+            termios.tcsetattr(fd, termios.TCSANOW, attrs)
+        loop = asyncio.get_running_loop()
+        reader = asyncio.StreamReader()
+        await loop.connect_read_pipe(lambda: asyncio.StreamReaderProtocol(reader), os.fdopen(fd, "rb", 0))
+        transport, protocol = await loop.connect_write_pipe(
+            lambda: asyncio.StreamReaderProtocol(asyncio.StreamReader()), os.fdopen(os.dup(fd), "wb", 0))
+        return reader, asyncio.StreamWriter(transport, protocol, reader, loop)
+
+    async def connect(self):
+        self.deflate = False
+        if getattr(self.args, "serial", None):
+            await self.start(*await self.open_serial())
+            return
+        if getattr(self.args, "raw", None):
+            # The raw port starts the session as soon as it is accepted
+            reader, writer = await asyncio.wait_for(
+                asyncio.open_connection(self.args.host, self.args.raw), self.args.timeout)
+            await self.start(reader, writer)
+            return
+        key = base64.b64encode(os.urandom(16))
+        reader, writer = await asyncio.wait_for(
+            asyncio.open_connection(self.args.host, self.args.port), self.args.timeout)
+        extensions = b""
+        if getattr(self.args, "deflate", False):
+            extensions = b"Sec-WebSocket-Extensions: permessage-deflate; client_max_window_bits\r\n"
+        writer.write(b"GET / HTTP/1.1\r\n"
+                     b"Host: " + self.args.host.encode() + b"\r\n"
+                     b"Upgrade: websocket\r\n"
+                     b"Connection: Upgrade\r\n"
+                     b"Sec-WebSocket-Key: " + key + b"\r\n"
+                     + extensions +
+                     b"Sec-WebSocket-Version: 13\r\n\r\n")
+        await writer.drain()
+        try:
+            response = await asyncio.wait_for(reader.readuntil(b"\r\n\r\n"), self.args.timeout)
+        except asyncio.IncompleteReadError:
+            # The server closes sessions it has no free slot for
+            writer.close()
+            raise ConnectionRefusedError("closed during the handshake")
+        accept = base64.b64encode(hashlib.sha1(key + WS_GUID).digest())
+        if not response.startswith(b"HTTP/1.1 101") or accept not in response:
+            writer.close()
+            raise ConnectionRefusedError(response.split(b"\r\n")[0].decode(errors="replace"))
+        self.deflate = b"permessage-deflate" in response
+        await self.start(reader, writer)
+
+    async def start(self, reader, writer):
+        self.reader = reader
+        self.writer = writer
+        self.connected = True
+        self.connects += 1
+        applied = self.decoded
+        self.decoded = 0
+        self.acked = 0
+        self.credits = None
+        self.viewing = False
+        options = (VIEW_LOSSY if self.args.lossy else 0) | (VIEW_DRAW if self.args.draw else 0)
+        if getattr(self.args, "anim", False):
+            options |= VIEW_ANIMS
+        if self.acks:
+            options |= VIEW_ACKS
+        scale = getattr(self.args, "scale", 1)
+        if scale != 1:
+            self.send(OPCODE_BIN, struct.pack(">BB", SCALE, SCALE_SHIFT[scale]))
+        viewport = getattr(self.args, "viewport", None)
+        resume = getattr(self.args, "resume", False) and self.token != 0
+        hello = struct.pack(">BBBHB", HELLO, PROTO_VERSION, options, self.encodings,
+                            getattr(self.args, "depth", 0))
+        if viewport is not None:
+            x, y, w, h = viewport
+            hello += struct.pack(">HHHH", w, h, x, y)
+        elif resume:
+            # The resume fields follow the viewport's, so ask for all of the screen
+            hello += struct.pack(">HHHH", 0xFFFF, 0xFFFF, 0, 0)
+        else:
+            hello += struct.pack(">HH", 0, 0)
+        if resume:
+            hello += struct.pack(">II", self.token, applied)
+        self.send(OPCODE_BIN, hello)
+        if self.hidden():
+            self.send(OPCODE_BIN, struct.pack(">BB", VISIBLE, 0))
+
+    def hidden(self):
+        """The first --hidden sessions stay in a background tab"""
+        return self.num < getattr(self.args, "hidden", 0)
+
+    def send(self, opcode, payload):
+        if self.raw():
+            # Raw frames: the websocket first byte and a 32 bit length, unmasked
+            self.writer.write(struct.pack(">BI", 0x80 | opcode, len(payload)) + payload)
+            return
+        # Client frames must be masked.  Messages are compressed on their own, as the
+        # server asks, without the tail of the sync flush.
+        first = 0x80 | opcode
+        if self.deflate and opcode in (OPCODE_TEXT, OPCODE_BIN):
+            compress = zlib.compressobj(wbits=-15)
+            payload = (compress.compress(payload) + compress.flush(zlib.Z_SYNC_FLUSH))[:-4]
+            first |= 0x40
+        mask = os.urandom(4)
+        header = bytes([first])
+        if len(payload) < 126:
+            header += bytes([0x80 | len(payload)])
+        elif len(payload) < 65536:
+            header += bytes([0x80 | 126]) + struct.pack(">H", len(payload))
+        else:
+            header += bytes([0x80 | 127]) + struct.pack(">Q", len(payload))
+        masked = bytes(b ^ mask[i & 3] for i, b in enumerate(payload))
+        self.writer.write(header + mask + masked)
+
+    def next_seq(self):
+        # 16 bit sequence numbers, skipping 0 (no sequence number)
+        self.seq = self.seq % 65535 + 1
+        if not self.viewing:
+            self.pending = self.pending[-255:] + [(self.seq, time.monotonic())]
+        return self.seq
+
+    def send_pointer(self, flag, x, y):
+        if self.connected:
+            if self.version >= 2:
+                self.send_input([(x, y, time.monotonic(), flag)])
+            else:
+                self.send(OPCODE_BIN, struct.pack(">BHHH", flag, x, y, self.next_seq()))
+
+    def send_input(self, events):
+        """Send a compact batch of (x, y, time, buttons) pointer 0 events, oldest first"""
+        def varint(v):
+            out = b""
+            while v > 0x7F:
+                out += bytes([(v & 0x7F) | 0x80])
+                v >>= 7
+            return out + bytes([v])
+
+        def zigzag(v):
+            return -2 * v - 1 if v < 0 else 2 * v
+
+        now = time.monotonic()
+        payload = bytes([INPUT]) + varint(self.next_seq())
+        last_x, last_y, last_t = 0, 0, now
+        for i, (x, y, t, buttons) in enumerate(events):
+            dt = now - t if i == 0 else t - last_t
+            payload += bytes([buttons & 0x0F]) + varint(zigzag(x - last_x)) + \
+                varint(zigzag(y - last_y)) + varint(max(0, int(dt * 1000)))
+            last_x, last_y, last_t = x, y, t
+        self.send(OPCODE_BIN, payload)
+
+    def send_viewport(self, x, y, w, h):
+        """Report that only the w x h area at x, y of the screen is shown"""
+        if self.connected:
+            self.send(OPCODE_BIN, struct.pack(">BHHHH", VIEWPORT, x, y, w, h))
+
+    def send_moves(self, moves):
+        """Send a batch of (x, y, time) moves, oldest first"""
+        if self.connected and moves:
+            moves = moves[-MOVES_MAX:]
+            if self.version >= 2:
+                self.send_input([(x, y, t, 1) for x, y, t in moves])
+                return
+            now = time.monotonic()
+            payload = struct.pack(">BBH", MOVES, len(moves), self.next_seq())
+            for x, y, t in moves:
+                payload += struct.pack(">HHB", x, y, min(255, int((now - t) * 1000)))
+            self.send(OPCODE_BIN, payload)
+
+    def send_scroll(self, kind, x, y, dx, dy):
+        """Scroll what is under x, y by dx, dy pixels, or fling it at dx, dy pixels/s"""
+        if self.connected:
+            self.send(OPCODE_BIN, struct.pack(">BBHHhh", SCROLL, kind, x, y, dx, dy))
+
+    async def read_frame(self):
+        if self.raw():
+            b0, length = struct.unpack(">BI", await self.reader.readexactly(5))
+            return b0 & 0x80 != 0, b0 & 0x0F, b0 & 0x40 != 0, await self.reader.readexactly(length)
+        b0, b1 = await self.reader.readexactly(2)
+        length = b1 & 0x7F
+        if length == 126:
+            length = struct.unpack(">H", await self.reader.readexactly(2))[0]
+        elif length == 127:
+            length = struct.unpack(">Q", await self.reader.readexactly(8))[0]
+        mask = await self.reader.readexactly(4) if b1 & 0x80 else None
+        payload = await self.reader.readexactly(length)
+        if mask:
+            payload = bytes(b ^ mask[i & 3] for i, b in enumerate(payload))
+        return b0 & 0x80 != 0, b0 & 0x0F, b0 & 0x40 != 0, payload
+
+    async def receive(self):
+        message = b""
+        message_opcode = None
+        compressed = False
+        while True:
+            fin, opcode, rsv1, payload = await self.read_frame()
+            if opcode == OPCODE_PING:
+                self.send(OPCODE_PONG, payload)
+                continue
+            if opcode == OPCODE_PONG:
+                continue
+            if opcode == OPCODE_CLOSE:
+                self.send(OPCODE_CLOSE, payload[:2])
+                return
+            if opcode != OPCODE_CONT:
+                message_opcode = opcode
+                message = b""
+                compressed = rsv1
+            message += payload
+            if not fin:
+                continue
+            if compressed:
+                self.deflate_wire += len(message)
+                message = zlib.decompressobj(-15).decompress(message + b"\x00\x00\xff\xff")
+                self.deflate_bytes += len(message)
+            if message_opcode == OPCODE_BIN and message:
+                self.on_pixels(message)
+                self.decoded += 1
+                self.send_credit()
+            elif message_opcode == OPCODE_TEXT:
+                self.on_text(message)
+
+    def on_text(self, message):
+        try:
+            text = json.loads(message)
+        except ValueError:
+            return
+        if "hello" in text:
+            self.credits = text["hello"].get("credits", 0)
+            self.token = text["hello"].get("token", 0)
+            self.version = text["hello"].get("version", 1)
+            if text["hello"].get("resumed"):
+                self.resumes += 1
+        elif "anim" in text:
+            self.anims += 1
+        elif "role" in text:
+            self.viewing = (text["role"] == "viewer")
+            if self.viewing:
+                self.pending = []
+                self.press_time = None
+
+    def send_credit(self):
+        # Acknowledge as the page does, each time half the credits have been used
+        if not self.acks or self.credits == 0:
+            return
+        if self.credits is None or self.decoded - self.acked >= max(1, self.credits >> 1):
+            self.acked = self.decoded
+            self.send(OPCODE_BIN, struct.pack(">I", self.decoded))
+
+    def on_pixels(self, message):
+        now = time.monotonic()
+        self.msgs += 1
+        self.bytes += len(message)
+        try:
+            regions, pixels, size, seq = decode_message(message, self.encodings)
+            self.regions += regions
+            self.size = size or self.size
+            if seq is not None:
+                self.on_echo(seq, now)
+            elif self.press_time is not None:
+                self.latency.append(now - self.press_time)
+            self.press_time = None
+        except DecodeError as e:
+            self.decode_errors += 1
+            if self.args.verbose:
+                print("client %d: %s" % (self.num, e), file=sys.stderr)
+
+    def on_echo(self, seq, now):
+        # Echoes of sequence numbers this client didn't send (another client's) are ignored
+        for i, (s, t) in enumerate(self.pending):
+            if s == seq:
+                self.latency += [now - t for _, t in self.pending[:i + 1]]
+                del self.pending[:i + 1]
+                return
+
+    async def input_loop(self):
+        """Taps at random points, dragging part way across the screen between press and
+        release, at --taps per second"""
+        if getattr(self.args, "trace", None):
+            await self.replay_loop()
+            return
+        if self.args.taps <= 0 or self.hidden():
+            return
+        period = 1.0 / self.args.taps
+        while True:
+            await asyncio.sleep(period * random.uniform(0.5, 1.5))
+            if not self.connected or self.size is None:
+                continue
+            w, h = self.size
+            x, y = random.randrange(w), random.randrange(h)
+            self.send_pointer(1, x, y)
+            self.press_time = None if self.viewing else time.monotonic()
+            moves = []
+            batch_time = time.monotonic()
+            for _ in range(self.args.moves):
+                await asyncio.sleep(1 / self.args.move_rate)
+                x = min(max(x + random.randint(-8, 8), 0), w - 1)
+                y = min(max(y + random.randint(-8, 8), 0), h - 1)
+                moves.append((x, y, time.monotonic()))
+                if time.monotonic() - batch_time >= FRAME_PERIOD:
+                    self.send_moves(moves)
+                    moves = []
+                    batch_time = time.monotonic()
+            self.send_moves(moves)
+            await asyncio.sleep(0.05)
+            self.send_pointer(0, x, y)
+
+    async def replay_loop(self):
+        """Plays the pointer events of the --replay capture at their original timing, over
+        and over, scaled to the screen"""
+        if self.hidden():
+            return
+        trace_w, trace_h, events = self.args.trace
+        pressed = False
+        while True:
+            start = time.monotonic()
+            for t, flag, x, y in events:
+                delay = start + t - time.monotonic()
+                if delay > 0:
+                    await asyncio.sleep(delay)
+                if not self.connected or self.size is None:
+                    continue
+                w, h = self.size
+                x = min(x * w // trace_w, w - 1)
+                y = min(y * h // trace_h, h - 1)
+                self.send_pointer(flag, x, y)
+                if flag and not pressed:
+                    self.press_time = None if self.viewing else time.monotonic()
+                pressed = bool(flag)
+            # Release a pointer the capture ended pressed and pause before playing it again
+            if pressed and self.size is not None:
+                self.send_pointer(0, x, y)
+                pressed = False
+            await asyncio.sleep(1)
+
+    async def wheel_loop(self):
+        """Wheel scrolls at random points at --wheel per second, each sending a delta per
+        frame for a quarter of a second and ending in a fling, as a trackpad would"""
+        if self.args.wheel <= 0 or self.hidden():
+            return
+        period = 1.0 / self.args.wheel
+        while True:
+            await asyncio.sleep(period * random.uniform(0.5, 1.5))
+            if not self.connected or self.size is None:
+                continue
+            w, h = self.size
+            x, y = random.randrange(w), random.randrange(h)
+            dx, dy = random.choice([(0, 1), (0, -1), (1, 0), (-1, 0)])
+            step = random.randint(2, 12)
+            for _ in range(int(0.25 / FRAME_PERIOD)):
+                self.send_scroll(SCROLL_BY, x, y, dx * step, dy * step)
+                await asyncio.sleep(FRAME_PERIOD)
+            self.send_scroll(SCROLL_FLING, x, y, int(dx * step / FRAME_PERIOD), int(dy * step / FRAME_PERIOD))
+
+    async def run(self):
+        while True:
+            try:
+                if getattr(self.args, "snapshot", False):
+                    await self.fetch_snapshot()
+                await self.connect()
+                inputs = asyncio.ensure_future(self.input_loop())
+                wheel = asyncio.ensure_future(self.wheel_loop())
+                try:
+                    await self.receive()
+                finally:
+                    inputs.cancel()
+                    wheel.cancel()
+            except ConnectionRefusedError:
+                self.refused += 1
+            except (OSError, asyncio.IncompleteReadError, asyncio.TimeoutError,
+                    asyncio.LimitOverrunError):
+                pass
+            if self.connected:
+                self.disconnects += 1
+                self.connected = False
+                self.writer.close()
+            self.press_time = None
+            self.pending = []
+            if not self.args.reconnect:
+                return
+            await asyncio.sleep(self.args.reconnect_delay)
+
+    def report(self, period):
+        p50 = percentile(self.latency, 50)
+        p95 = percentile(self.latency, 95)
+        self.all_latency += self.latency
+        line = "%3d %-4s %6.1f %8.1f %7.1f %8s %8s %6d %7d %6d" % (
+            self.num, "up" if self.connected else "down", self.msgs / period,
+            self.bytes / 1024 / period, self.regions / max(self.msgs, 1),
+            "-" if p50 is None else "%.0f" % (p50 * 1000),
+            "-" if p95 is None else "%.0f" % (p95 * 1000),
+            self.disconnects, self.refused, self.decode_errors)
+        self.msgs = 0
+        self.bytes = 0
+        self.regions = 0
+        self.latency = []
+        return line
+
+
+HEADER = "  n conn  msg/s     kB/s reg/msg  p50(ms)  p95(ms)   disc refused errors"
+
+
+# /metrics samples whose trends are reported, the first checked by --max-heap-loss
+HEAP_METRICS = (("heap free", 'heap_free_bytes{region="internal"}'), ("lvgl free", "lvgl_mem_free_bytes"))
+
+
+async def main(args):
+    """Returns False if a threshold was crossed"""
+    clients = [Client(i, args) for i in range(args.clients)]
+    tasks = []
+    for c in clients:
+        tasks.append(asyncio.ensure_future(c.run()))
+        await asyncio.sleep(args.stagger)
+
+    # What the thresholds are checked against, from after the warm up
+    rates = {c.num: [] for c in clients if not c.hidden()}
+    latency = []
+    heap = {metric: [] for _, metric in HEAP_METRICS}
+    metrics = args.metrics or args.max_heap_loss is not None
+
+    start = time.monotonic()
+    last = start
+    while time.monotonic() - start < args.time:
+        await asyncio.sleep(min(args.period, args.time - (time.monotonic() - start)))
+        now = time.monotonic()
+        warm = now - start > args.warmup
+        print("t=%.0fs" % (now - start))
+        print(HEADER)
+        for c in clients:
+            if warm and c.num in rates:
+                rates[c.num].append(c.msgs / (now - last))
+                latency += c.latency
+            print(c.report(now - last))
+        last = now
+        if metrics:
+            samples = await fetch_metrics(args)
+            if samples is None:
+                print("metrics: unavailable")
+                continue
+            found = [(name, metric) for name, metric in HEAP_METRICS if metric in samples]
+            print("metrics: " + ", ".join("%s %d B" % (name, samples[metric]) for name, metric in found))
+            if warm:
+                for _, metric in found:
+                    heap[metric].append((now - start, samples[metric]))
+
+    for t in tasks:
+        t.cancel()
+
+    # Whole run summary
+    print("summary: %d clients, %d connects, %d disconnects, %d refused, %d decode errors" % (
+        len(clients), sum(c.connects for c in clients), sum(c.disconnects for c in clients),
+        sum(c.refused for c in clients), sum(c.decode_errors for c in clients)))
+    if args.resume:
+        print("resumed sessions: %d" % sum(c.resumes for c in clients))
+    if args.deflate:
+        wire = sum(c.deflate_wire for c in clients)
+        inflated = sum(c.deflate_bytes for c in clients)
+        print("compressed messages: %.1f kB received as %.1f kB (%.0f%%)" % (
+            inflated / 1024, wire / 1024, 100 * wire / inflated if inflated else 0))
+    if args.anim:
+        print("animations described: %d" % sum(c.anims for c in clients))
+    if args.snapshot:
+        times = [t for c in clients for t in c.snapshot_time]
+        print("snapshots: %d, %.1f kB" % (sum(c.snapshots for c in clients),
+                                          sum(c.snapshot_bytes for c in clients) / 1024), end="")
+        print(", p50 %.0f ms, max %.0f ms" % (percentile(times, 50) * 1000, max(times) * 1000) if times else "")
+    samples = [s for c in clients for s in c.all_latency]
+    if samples:
+        print("input latency: p50 %.0f ms, p95 %.0f ms, max %.0f ms over %d events" % (
+            percentile(samples, 50) * 1000, percentile(samples, 95) * 1000,
+            max(samples) * 1000, len(samples)))
+    for name, metric in HEAP_METRICS:
+        slope = trend(heap[metric])
+        if slope is not None:
+            print("%s trend: %+.0f B/hour over %d samples" % (name, slope, len(heap[metric])))
+
+    return check_thresholds(args, clients, rates, latency, heap)
+
+
+def check_thresholds(args, clients, rates, latency, heap):
+    """Prints a line for each threshold given and returns False if any was crossed.  A
+    threshold with nothing to measure it against, such as latency without input, fails."""
+    checks = []
+    if args.min_fps is not None:
+        # Each session's average over the periods after the warm up
+        means = [sum(r) / len(r) for r in rates.values() if r]
+        worst = min(means) if means else None
+        checks.append(("msg/s >= %g" % args.min_fps, worst, "%.1f slowest session",
+                       worst is not None and worst >= args.min_fps))
+    for p, limit in ((50, args.max_p50), (95, args.max_p95), (99, args.max_p99)):
+        if limit is not None:
+            value = percentile(latency, p)
+            value = None if value is None else value * 1000
+            checks.append(("p%d latency <= %g ms" % (p, limit), value, "%.0f ms",
+                           value is not None and value <= limit))
+    if args.max_heap_loss is not None:
+        slope = trend(heap[HEAP_METRICS[0][1]])
+        checks.append(("heap loss <= %.0f B/hour" % args.max_heap_loss, slope, "%+.0f B/hour",
+                       slope is not None and -slope <= args.max_heap_loss))
+    if args.max_disconnects is not None:
+        disconnects = sum(c.disconnects for c in clients)
+        checks.append(("disconnects <= %d" % args.max_disconnects, disconnects, "%d",
+                       disconnects <= args.max_disconnects))
+    if args.max_errors is not None:
+        errors = sum(c.decode_errors for c in clients)
+        checks.append(("decode errors <= %d" % args.max_errors, errors, "%d", errors <= args.max_errors))
+
+    for name, value, fmt, ok in checks:
+        print("threshold %-28s %-24s %s" % (name, "not measured" if value is None else fmt % value,
+                                           "ok" if ok else "FAILED"))
+    if checks:
+        print("soak test %s" % ("passed" if all(ok for _, _, _, ok in checks) else "FAILED"))
+    return all(ok for _, _, _, ok in checks)
+
+
+if __name__ == "__main__":
+    parser = argparse.ArgumentParser(description="Open many websocket viewers against the LittleVGL websocket driver")
+    parser.add_argument("host", help="device address, e.g. 192.168.4.1")
+    parser.add_argument("--port", type=int, default=80)
+    parser.add_argument("-n", "--clients", type=int, default=4, help="number of sessions (default 4)")
+    parser.add_argument("-t", "--time", type=float, default=30, help="seconds to run (default 30)")
+    parser.add_argument("--period", type=float, default=5, help="seconds between reports (default 5)")
+    parser.add_argument("--stagger", type=float, default=0.2, help="seconds between opening sessions (default 0.2)")
+    parser.add_argument("--taps", type=float, default=1, help="taps per second per client, 0 for none (default 1)")
+    parser.add_argument("--moves", type=int, default=3, help="pointer moves between press and release (default 3)")
+    parser.add_argument("--move-rate", type=float, default=50,
+                        help="pointer moves per second during a drag, batched per 60 Hz frame (default 50)")
+    parser.add_argument("--wheel", type=float, default=0,
+                        help="wheel scrolls per second per client, each ending in a fling, 0 for none (default 0)")
+    parser.add_argument("--lossy", action="store_true", help="ask for approximate pixels refined when idle")
+    parser.add_argument("--depth", type=int, default=0, choices=[0, 8],
+                        help="pixel depth to be held at, 8 for RGB332, 0 for the display's (default 0)")
+    parser.add_argument("--viewport", type=parse_viewport,
+                        help="only show the area x,y,w,h of the screen, as a zoomed phone would")
+    parser.add_argument("--hidden", type=int, default=0,
+                        help="number of sessions kept hidden, as background tabs, sending no input (default 0)")
+    parser.add_argument("--scale", type=int, default=1, choices=[1, 2, 4],
+                        help="ask for a thumbnail of the screen scaled down this many times (default 1)")
+    parser.add_argument("--draw", action="store_true", help="ask for draw commands instead of pixels")
+    parser.add_argument("--anim", action="store_true", help="ask to be described the animations the driver offloads")
+    parser.add_argument("--encodings", type=parse_encodings, default=ENC_CAP_ALL,
+                        help="comma separated encodings to announce, of rle, palette, fill, copy and aligned (default all)")
+    parser.add_argument("--no-acks", dest="acks", action="store_false",
+                        help="don't acknowledge decoded messages, leaving only TCP to hold the driver back")
+    parser.add_argument("--deflate", action="store_true",
+                        help="offer permessage-deflate, compressing messages both ways as browsers do")
+    parser.add_argument("--raw", type=int, metavar="PORT",
+                        help="connect to the driver's raw TCP port instead of upgrading a websocket")
+    parser.add_argument("--serial", metavar="DEVICE",
+                        help="be one viewer on the driver's serial link at DEVICE, e.g. /dev/ttyUSB0")
+    parser.add_argument("--baud", type=int, default=2000000, help="serial link baud rate (default 2000000)")
+    parser.add_argument("--timeout", type=float, default=5, help="seconds to wait for a connection (default 5)")
+    parser.add_argument("--no-reconnect", dest="reconnect", action="store_false", help="don't reopen closed sessions")
+    parser.add_argument("--reconnect-delay", type=float, default=1)
+    parser.add_argument("--resume", action="store_true",
+                        help="resume the last session when reconnecting, as the page does")
+    parser.add_argument("--snapshot", action="store_true",
+                        help="fetch /snapshot before each connection, as the page does")
+    parser.add_argument("-v", "--verbose", action="store_true", help="print decode errors")
+    soak = parser.add_argument_group("soak test", "thresholds checked over the run after --warmup, exiting with "
+                                     "status 1 if any is crossed")
+    soak.add_argument("--replay", metavar="CAPTURE",
+                      help="play the pointer events of a capture from the device's /capture instead of random taps")
+    soak.add_argument("--metrics", action="store_true", help="sample the device's /metrics every report period")
+    soak.add_argument("--warmup", type=float, default=10,
+                      help="seconds before samples count towards the thresholds (default 10)")
+    soak.add_argument("--min-fps", type=float, help="lowest average pixel messages per second of any session")
+    soak.add_argument("--max-p50", type=float, metavar="MS", help="highest median input latency")
+    soak.add_argument("--max-p95", type=float, metavar="MS", help="highest 95th percentile input latency")
+    soak.add_argument("--max-p99", type=float, metavar="MS", help="highest 99th percentile input latency")
+    soak.add_argument("--max-heap-loss", type=float, metavar="BYTES",
+                      help="fastest fall of the free internal heap per hour, sampling /metrics")
+    soak.add_argument("--max-disconnects", type=int, help="most sessions dropped")
+    soak.add_argument("--max-errors", type=int, help="most decode errors")
+    args = parser.parse_args()
+    if args.replay:
+        try:
+            args.trace = load_trace(args.replay)
+        except (OSError, ValueError) as e:
+            sys.exit("%s: %s" % (args.replay, e))
+    try:
+        if asyncio.run(main(args)) is False:
+            sys.exit(1)
+    except KeyboardInterrupt:
+        pass
@@ -0,0 +1,492 @@
+#!/usr/bin/env python3
+"""Relays the LittleVGL websocket driver's stream to any number of browsers
+
+A device built with the upstream relay option connects out to this relay on
+--device-port and is sent a hello as a viewer, so it packs and sends each frame once
+however many browsers are watching.  The device speaks the raw framing of its raw TCP
+port: the first byte of a websocket header and a 32 bit big-endian length, unmasked.
+The relay acknowledges the device's messages as index.html does, so the device's flow
+control follows the relay rather than the slowest browser.
+
+Every region is decoded into a copy of the screen.  A browser opening the page on --port
+is sent a hello allowing any number of unacknowledged messages and then the whole
+screen as one raw region, and from then on each of the device's messages as it came.
+A browser that can't keep up (more than --backlog bytes waiting to be sent to it) is
+skipped until it catches up, and is then sent the whole screen again, so it never
+decodes a copy or an update against pixels it missed.
+
+Input is taken from one browser at a time: the first to press, move, scroll or type
+holds control until it has sent no input for --lease seconds, and the others are told
+they are viewers, as the device tells browsers connected to it directly.  What else
+the browsers send (acknowledgements, hellos, viewports, scaling and visibility) only
+concerns the link between them and the relay and is dropped.
+
+Only the Python 3 standard library is used.
+
+Example, with the device set to connect to this machine:
+
+    python3 tools/ws_relay.py --port 8080
+"""
+
+import argparse
+import asyncio
+import base64
+import hashlib
+import json
+import os
+import struct
+import time
+
+WS_GUID = b"258EAFA5-E914-47DA-95CA-C5AB0DC85B11"
+
+OPCODE_CONT = 0x0
+OPCODE_TEXT = 0x1
+OPCODE_BIN = 0x2
+OPCODE_CLOSE = 0x8
+OPCODE_PING = 0x9
+OPCODE_PONG = 0xA
+
+# Pixel depth byte: encoding in bits 7:6, palette flag in bit 2, input sequence flag in
+# bit 1, little-endian flag in bit 0
+PIXEL_HEADER_LEN = 13
+ENC_MASK = 0xC0
+ENC_RAW = 0x00
+ENC_RLE = 0x40
+ENC_COPY = 0x80
+ENC_FILL = 0xC0
+INPUT_SEQ = 0x02
+PALETTE = 0x04
+ORDER_LE = 0x01
+
+# The relay's hello: only the pixel encodings, so no glyph or image state has to be
+# kept, acknowledging messages, at the device's own depth and for all of the screen
+HELLO = 0x48
+PROTO_VERSION = 1
+VIEW_ACKS = 0x04
+ENC_CAP_RLE = 0x01
+ENC_CAP_PALETTE = 0x02
+ENC_CAP_FILL = 0x04
+ENC_CAP_COPY = 0x08
+ENCODINGS = ENC_CAP_RLE | ENC_CAP_PALETTE | ENC_CAP_FILL | ENC_CAP_COPY
+
+# Browser input forwarded from the browser in control: pointer events of 5 or 7 bytes,
+# and batches of moves, scrolls and keys starting with their magic
+MOVES = 0x4D
+SCROLL = 0x57
+KEYS = 0x4B
+SCROLL_LEN = 10
+
+PAGE = os.path.join(os.path.dirname(os.path.abspath(__file__)), "..", "components", "lvgl_esp32_drivers", "index.html")
+
+
+class DecodeError(Exception):
+    pass
+
+
+def ws_frame(opcode, payload):
+    """A server websocket frame, unmasked"""
+    n = len(payload)
+    if n < 126:
+        header = struct.pack(">BB", 0x80 | opcode, n)
+    elif n < 65536:
+        header = struct.pack(">BBH", 0x80 | opcode, 126, n)
+    else:
+        header = struct.pack(">BBQ", 0x80 | opcode, 127, n)
+    return header + payload
+
+
+def raw_frame(opcode, payload):
+    """A raw frame: the websocket first byte and a 32 bit length"""
+    return struct.pack(">BI", 0x80 | opcode, len(payload)) + payload
+
+
+class Screen:
+    """The device's screen as its regions have drawn it"""
+
+    def __init__(self):
+        self.width = 0
+        self.height = 0
+        self.bpp = 0
+        self.order = 0
+        self.pixels = None
+
+    def resize(self, width, height, bpp, order):
+        if (width, height, bpp, order) != (self.width, self.height, self.bpp, self.order):
+            self.width, self.height, self.bpp, self.order = width, height, bpp, order
+            self.pixels = bytearray(width * height * bpp)
+
+    def snapshot(self):
+        """The whole screen as one raw region, or None before the first region"""
+        if self.pixels is None:
+            return None
+        return struct.pack(">BHHHHHH", self.bpp * 8 | self.order, self.width, self.height,
+                           0, 0, self.width - 1, self.height - 1) + bytes(self.pixels)
+
+    def apply(self, data):
+        """Draw each region of a binary message"""
+        offset = 0
+        while offset < len(data):
+            offset = self.region(data, offset)
+
+    def region(self, data, offset):
+        if offset + PIXEL_HEADER_LEN > len(data):
+            raise DecodeError("region header ends early")
+        depth, w, h, x1, y1, x2, y2 = struct.unpack_from(">BHHHHHH", data, offset)
+        offset += PIXEL_HEADER_LEN + (2 if depth & INPUT_SEQ else 0)
+        encoding = depth & ENC_MASK
+        bpp = (depth & ~(ENC_MASK | ORDER_LE | INPUT_SEQ | PALETTE)) >> 3
+        if encoding == ENC_COPY and depth & PALETTE:
+            raise DecodeError("draw commands, which were not asked for")
+        if x2 >= w or y2 >= h or x1 > x2 or y1 > y2 or bpp not in (1, 2, 4):
+            raise DecodeError("bad region %d,%d %d,%d of %dx%d" % (x1, y1, x2, y2, w, h))
+        self.resize(w, h, bpp, depth & ORDER_LE)
+        rw = x2 - x1 + 1
+        rh = y2 - y1 + 1
+
+        if encoding == ENC_COPY:
+            sx, sy = struct.unpack_from(">HH", data, offset)
+            self.copy(sx, sy, x1, y1, rw, rh)
+            return offset + 4
+        if encoding == ENC_FILL:
+            self.put(x1, y1, rw, rh, data[offset:offset + bpp] * (rw * rh))
+            return offset + bpp
+        if depth & PALETTE:
+            pixels, offset = self.unpalette(data, offset, rw * rh, bpp)
+        elif encoding == ENC_RLE:
+            pixels, offset = self.unrle(data, offset, rw * rh, bpp)
+        else:
+            end = offset + rw * rh * bpp
+            if end > len(data):
+                raise DecodeError("raw pixel data ends early")
+            pixels, offset = data[offset:end], end
+        self.put(x1, y1, rw, rh, pixels)
+        return offset
+
+    def put(self, x1, y1, rw, rh, pixels):
+        row = rw * self.bpp
+        stride = self.width * self.bpp
+        at = (y1 * self.width + x1) * self.bpp
+        for y in range(rh):
+            self.pixels[at:at + row] = pixels[y * row:(y + 1) * row]
+            at += stride
+
+    def copy(self, sx, sy, x1, y1, rw, rh):
+        # Rows are moved starting from the side they move towards, as the page does
+        row = rw * self.bpp
+        stride = self.width * self.bpp
+        rows = range(rh - 1, -1, -1) if y1 > sy else range(rh)
+        for y in rows:
+            src = ((sy + y) * self.width + sx) * self.bpp
+            dst = (y1 + y) * stride + x1 * self.bpp
+            self.pixels[dst:dst + row] = self.pixels[src:src + row]
+
+    @staticmethod
+    def unrle(data, offset, count, bpp):
+        out = []
+        while count > 0:
+            if offset >= len(data):
+                raise DecodeError("RLE data ends early")
+            n = data[offset]
+            offset += 1
+            if n < 0x80:
+                run = n + 1
+                out.append(data[offset:offset + run * bpp])
+                offset += run * bpp
+            else:
+                run = (n & 0x7F) + 2
+                out.append(data[offset:offset + bpp] * run)
+                offset += bpp
+            count -= run
+        if count < 0 or offset > len(data):
+            raise DecodeError("RLE data doesn't match the region")
+        return b"".join(out), offset
+
+    @staticmethod
+    def unpalette(data, offset, count, bpp):
+        colours = data[offset] + 1
+        palette = [data[offset + 1 + i * bpp:offset + 1 + (i + 1) * bpp] for i in range(colours)]
+        offset += 1 + colours * bpp
+        bits = 1 if colours <= 2 else 2 if colours <= 4 else 4
+        per_byte = 8 // bits
+        mask = (1 << bits) - 1
+        # The pixels of every possible index byte, most significant index first
+        table = [b"".join(palette[min((b >> (8 - bits * (i + 1))) & mask, colours - 1)] for i in range(per_byte))
+                 for b in range(256)]
+        nbytes = (count + per_byte - 1) // per_byte
+        if offset + nbytes > len(data):
+            raise DecodeError("palette indices end early")
+        pixels = b"".join(table[b] for b in data[offset:offset + nbytes])
+        return pixels[:count * bpp], offset + nbytes
+
+
+class Browser:
+    def __init__(self, writer):
+        self.writer = writer
+        self.stale = False
+        self.role = None
+
+    def backlog(self):
+        return self.writer.transport.get_write_buffer_size()
+
+    def send(self, opcode, payload):
+        self.writer.write(ws_frame(opcode, payload))
+
+
+class Relay:
+    def __init__(self, args):
+        self.args = args
+        page = open(PAGE, "rb").read()
+        # The device serves the page and its websocket on port 80, here they share --port
+        self.page = page.replace(b"'ws://'+location.hostname+'/'", b"'ws://'+location.host+'/'")
+        self.screen = Screen()
+        self.browsers = []
+        self.device = None
+        self.device_controls = True
+        self.controller = None
+        self.last_input = 0
+        self.messages = 0
+
+    # The device
+
+    async def handle_device(self, reader, writer):
+        if self.device is not None:
+            print("a second device connected, closing it")
+            writer.close()
+            return
+        print("device connected from %s" % (writer.get_extra_info("peername"),))
+        self.device = writer
+        self.device_controls = True
+        credits = None
+        acked = 0
+        count = 0
+        bench = False
+        message = b""
+        message_opcode = None
+        writer.write(raw_frame(OPCODE_BIN, struct.pack(">BBBHBHH", HELLO, PROTO_VERSION, VIEW_ACKS, ENCODINGS, 0, 0, 0)))
+        try:
+            while True:
+                b0, length = struct.unpack(">BI", await reader.readexactly(5))
+                payload = await reader.readexactly(length)
+                opcode = b0 & 0x0F
+                if opcode == OPCODE_PING:
+                    writer.write(raw_frame(OPCODE_PONG, payload))
+                    continue
+                if opcode == OPCODE_PONG:
+                    continue
+                if opcode == OPCODE_CLOSE:
+                    writer.write(raw_frame(OPCODE_CLOSE, payload[:2]))
+                    break
+                if opcode != OPCODE_CONT:
+                    message_opcode = opcode
+                    message = b""
+                message += payload
+                if not b0 & 0x80:
+                    continue
+
+                if message_opcode == OPCODE_TEXT:
+                    credits, bench = self.on_device_text(message, credits, bench)
+                elif message_opcode == OPCODE_BIN and message:
+                    start = time.monotonic()
+                    try:
+                        self.screen.apply(message)
+                    except DecodeError as e:
+                        print("decode error: %s" % e)
+                    self.fan_out(message)
+                    count += 1
+                    self.messages += 1
+                    # Acknowledge as the page does, each time half the credits have been used
+                    if bench:
+                        writer.write(raw_frame(OPCODE_BIN, struct.pack(
+                            ">II", count, int((time.monotonic() - start) * 1000000))))
+                    if credits is None or (credits > 0 and count - acked >= max(1, credits >> 1)):
+                        acked = count
+                        writer.write(raw_frame(OPCODE_BIN, struct.pack(">I", count)))
+                await writer.drain()
+        except (OSError, asyncio.IncompleteReadError):
+            pass
+        finally:
+            writer.close()
+            self.device = None
+            print("device disconnected")
+
+    def on_device_text(self, message, credits, bench):
+        try:
+            text = json.loads(message)
+        except ValueError:
+            return credits, bench
+        if "hello" in text:
+            hello = text["hello"]
+            print("device speaks version %s, encodings %s, %s-bit pixels, %s credits" % (
+                hello.get("version"), hello.get("encodings"), hello.get("depth"), hello.get("credits")))
+            return hello.get("credits", 0), bench
+        if "role" in text:
+            # Someone connected to the device directly holds its input
+            self.device_controls = (text["role"] != "viewer")
+            self.update_roles()
+            return credits, bench
+        if "bench" in text:
+            # The relay answers the benchmark, the browsers only see its report
+            bench = bool(text["bench"])
+            text["bench"] = False
+            message = json.dumps(text).encode()
+        for b in self.browsers:
+            if not b.stale:
+                b.send(OPCODE_TEXT, message)
+        return credits, bench
+
+    def fan_out(self, message):
+        snapshot = None
+        for b in self.browsers:
+            if b.backlog() > self.args.backlog:
+                b.stale = True
+            elif b.stale:
+                # The screen already includes this message
+                if snapshot is None:
+                    snapshot = self.screen.snapshot()
+                if snapshot is not None:
+                    b.send(OPCODE_BIN, snapshot)
+                b.stale = False
+            else:
+                b.send(OPCODE_BIN, message)
+
+    # The browsers
+
+    async def handle(self, reader, writer):
+        try:
+            request = await reader.readuntil(b"\r\n\r\n")
+            lines = request.decode(errors="replace").split("\r\n")
+            path = lines[0].split(" ")[1] if len(lines[0].split(" ")) > 1 else "/"
+            headers = {}
+            for line in lines[1:]:
+                if ":" in line:
+                    name, _, value = line.partition(":")
+                    headers[name.strip().lower()] = value.strip()
+            if headers.get("upgrade", "").lower() == "websocket":
+                await self.serve_browser(reader, writer, headers)
+            elif path == "/" or path.startswith("/?"):
+                writer.write(b"HTTP/1.1 200 OK\r\nContent-Type: text/html\r\nContent-Length: %d\r\n"
+                             b"Connection: close\r\n\r\n" % len(self.page) + self.page)
+            else:
+                writer.write(b"HTTP/1.1 404 Not Found\r\nContent-Length: 0\r\nConnection: close\r\n\r\n")
+            await writer.drain()
+        except (OSError, asyncio.IncompleteReadError, asyncio.LimitOverrunError):
+            pass
+        finally:
+            writer.close()
+
+    async def serve_browser(self, reader, writer, headers):
+        accept = base64.b64encode(hashlib.sha1(headers.get("sec-websocket-key", "").encode() + WS_GUID).digest())
+        writer.write(b"HTTP/1.1 101 Switching Protocols\r\nUpgrade: websocket\r\nConnection: Upgrade\r\n"
+                     b"Sec-WebSocket-Accept: " + accept + b"\r\n\r\n")
+        browser = Browser(writer)
+        # No credits, so the page doesn't acknowledge: the relay never holds a browser back
+        browser.send(OPCODE_TEXT, json.dumps({"hello": {
+            "version": PROTO_VERSION, "encodings": ENCODINGS, "depth": self.screen.bpp * 8,
+            "credits": 0, "token": 0, "resumed": False}}).encode())
+        snapshot = self.screen.snapshot()
+        if snapshot is not None:
+            browser.send(OPCODE_BIN, snapshot)
+        self.browsers.append(browser)
+        self.update_roles()
+        print("browser connected, %d watching" % len(self.browsers))
+        try:
+            while True:
+                b0, b1 = await reader.readexactly(2)
+                length = b1 & 0x7F
+                if length == 126:
+                    length = struct.unpack(">H", await reader.readexactly(2))[0]
+                elif length == 127:
+                    length = struct.unpack(">Q", await reader.readexactly(8))[0]
+                mask = await reader.readexactly(4) if b1 & 0x80 else None
+                payload = await reader.readexactly(length)
+                if mask:
+                    payload = bytes(b ^ mask[i & 3] for i, b in enumerate(payload))
+                opcode = b0 & 0x0F
+                if opcode == OPCODE_CLOSE:
+                    browser.send(OPCODE_CLOSE, payload[:2])
+                    break
+                if opcode == OPCODE_PING:
+                    browser.send(OPCODE_PONG, payload)
+                elif opcode == OPCODE_BIN and self.is_input(payload):
+                    self.on_input(browser, payload)
+                await writer.drain()
+        except (OSError, asyncio.IncompleteReadError):
+            pass
+        finally:
+            self.browsers.remove(browser)
+            if self.controller is browser:
+                self.controller = None
+                self.update_roles()
+            print("browser disconnected, %d watching" % len(self.browsers))
+
+    @staticmethod
+    def is_input(msg):
+        if len(msg) in (5, 7):
+            return True
+        if msg[0] == MOVES and len(msg) > 4 and len(msg) == 4 + msg[1] * 5:
+            return True
+        if msg[0] == SCROLL and len(msg) == SCROLL_LEN:
+            return True
+        return msg[0] == KEYS and len(msg) > 2 and len(msg) == 2 + msg[1] * 4
+
+    def on_input(self, browser, msg):
+        now = time.monotonic()
+        if self.controller is not browser:
+            if self.controller is not None and now - self.last_input < self.args.lease:
+                return
+            self.controller = browser
+            self.update_roles()
+        self.last_input = now
+        if self.device is not None and self.device_controls:
+            self.device.write(raw_frame(OPCODE_BIN, msg))
+
+    def update_roles(self):
+        """Tell each browser whether its input is used, when that changes"""
+        for b in self.browsers:
+            role = "controller" if self.device_controls and (self.controller in (None, b)) else "viewer"
+            if role != b.role:
+                b.role = role
+                b.send(OPCODE_TEXT, json.dumps({"role": role}).encode())
+
+
+async def report(relay, period):
+    while True:
+        await asyncio.sleep(period)
+        print("%s, %d browsers, %.1f messages/s" % ("device connected" if relay.device else "no device",
+                                                    len(relay.browsers), relay.messages / period))
+        relay.messages = 0
+
+
+async def serve(relay, args):
+    devices = await asyncio.start_server(relay.handle_device, args.bind, args.device_port)
+    browsers = await asyncio.start_server(relay.handle, args.bind, args.port)
+    where = args.bind if args.bind != "0.0.0.0" else "localhost"
+    print("waiting for the device on port %d, open http://%s:%d/ to watch" % (args.device_port, where, args.port))
+    if args.report:
+        asyncio.ensure_future(report(relay, args.report))
+    async with devices, browsers:
+        await asyncio.gather(devices.serve_forever(), browsers.serve_forever())
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split("\n")[0])
+    parser.add_argument("--port", type=int, default=8080, help="port to serve the page on (default 8080)")
+    parser.add_argument("--device-port", type=int, default=5801,
+                        help="port the device connects to (default 5801)")
+    parser.add_argument("--bind", default="0.0.0.0", help="address to serve on (default all)")
+    parser.add_argument("--lease", type=float, default=3,
+                        help="seconds a browser keeps control after its last input (default 3)")
+    parser.add_argument("--backlog", type=int, default=512 * 1024,
+                        help="bytes waiting for a browser before it is skipped (default 524288)")
+    parser.add_argument("--report", type=float, default=0, metavar="S",
+                        help="print the relay's state every S seconds")
+    args = parser.parse_args()
+
+    try:
+        asyncio.run(serve(Relay(args), args))
+    except KeyboardInterrupt:
+        pass
+
+
+if __name__ == "__main__":
+    main()